@@ -22,7 +22,15 @@
 #include "common/LogtailCommonFlags.h"
 #include "sender/Sender.h"
 #include "config/Config.h"
+#include "processor/LogToMetric.h"
+#include "processor/ProcessPipeline.h"
+#include "sender/AdaptiveBatchPolicy.h"
+#include "sender/ShardRouter.h"
+#include "common/StageProfiler.h"
+#include "common/TimeUtil.h"
+#include "common/MemoryBudget.h"
 #include <app_config/AppConfig.h>
+#include <algorithm>
 
 using namespace std;
 using namespace sls_logs;
@@ -31,17 +39,81 @@ DECLARE_FLAG_INT32(merge_log_count_limit);
 DECLARE_FLAG_INT32(same_topic_merge_send_count);
 DECLARE_FLAG_INT32(max_send_log_group_size);
 DECLARE_FLAG_STRING(ALIYUN_LOG_FILE_TAGS);
+DECLARE_FLAG_BOOL(enable_shard_route);
+DEFINE_FLAG_BOOL(enable_merge_item_coalesce,
+                 "send merge items of the same logstore ready in one flush as a log package list",
+                 false);
+DEFINE_FLAG_BOOL(enable_merge_item_schema_group,
+                 "group logs with the same content keys together in a log group before compression",
+                 false);
 
 namespace logtail {
 
-
 bool MergeItem::IsReady() {
-    return (mRawBytes > INT32_FLAG(batch_send_metric_size) || ((time(NULL) - mLastUpdateTime) >= mBatchSendInterval));
+    return (mRawBytes > mBatchSendMetricSize || ((time(NULL) - mLastUpdateTime) >= mBatchSendInterval));
+}
+
+void MergeItem::AddArenaLog(sls_logs::Log* log, const std::shared_ptr<google::protobuf::Arena>& arena) {
+    mLogGroup.mutable_logs()->UnsafeArenaAddAllocated(log);
+    if (mArenas.empty() || mArenas.back() != arena) {
+        mArenas.push_back(arena);
+    }
+}
+
+void MergeItem::GroupLogsBySchema() {
+    const int logSize = mLogGroup.logs_size();
+    if (logSize < 3) {
+        return;
+    }
+    std::vector<uint32_t> groups(logSize);
+    std::unordered_map<uint64_t, uint32_t> groupIndexes;
+    for (int i = 0; i < logSize; ++i) {
+        const sls_logs::Log& log = mLogGroup.logs(i);
+        uint64_t schema = HashCombine(0, log.contents_size());
+        for (int k = 0; k < log.contents_size(); ++k) {
+            schema = HashWithSeed(log.contents(k).key(), schema);
+        }
+        groups[i] = groupIndexes.insert(std::make_pair(schema, static_cast<uint32_t>(groupIndexes.size())))
+                        .first->second;
+    }
+    if (groupIndexes.size() == 1 || groupIndexes.size() == static_cast<size_t>(logSize)) {
+        return;
+    }
+
+    // Counting sort on group index, only pointers are moved so logs owned by arenas are untouched.
+    std::vector<uint32_t> offsets(groupIndexes.size() + 1, 0);
+    for (uint32_t group : groups) {
+        ++offsets[group + 1];
+    }
+    for (size_t i = 1; i < offsets.size(); ++i) {
+        offsets[i] += offsets[i - 1];
+    }
+    sls_logs::Log** logs = mLogGroup.mutable_logs()->mutable_data();
+    std::vector<sls_logs::Log*> sorted(logSize);
+    for (int i = 0; i < logSize; ++i) {
+        sorted[offsets[groups[i]]++] = logs[i];
+    }
+    std::copy(sorted.begin(), sorted.end(), logs);
+}
+
+MergeItem::~MergeItem() {
+    MemoryBudget::Sub(MEMORY_COMPONENT_AGGREGATOR, mRawBytes);
+    if (mArenas.empty()) {
+        return;
+    }
+    // logs may come from both heap and arenas, only heap ones are owned by mLogGroup
+    auto logs = mLogGroup.mutable_logs();
+    while (logs->size() > 0) {
+        sls_logs::Log* log = logs->UnsafeArenaReleaseLast();
+        if (log->GetArena() == NULL) {
+            delete log;
+        }
+    }
 }
 
 bool PackageListMergeBuffer::IsReady(int32_t curTime) {
     // should use 2 * INT32_FLAG(batch_send_interval)), package list interval should > merge item interval
-    return (mTotalRawBytes >= INT32_FLAG(batch_send_metric_size))
+    return (mTotalRawBytes >= mBatchSendMetricSize)
         || (mItemCount > 0 && (curTime - mFirstItemTime) >= 2 * INT32_FLAG(batch_send_interval));
 }
 
@@ -49,57 +121,66 @@ bool PackageListMergeBuffer::IsReady(int32_t curTime) {
 bool Aggregator::FlushReadyBuffer() {
     static Sender* sender = Sender::Instance();
     vector<MergeItem*> sendDataVec;
+    auto dispatchMergeItem = [&](MergeItem* item) {
+        if (item->mMergeType == MERGE_BY_TOPIC)
+            sendDataVec.push_back(item);
+        else
+            AddToPackageList(GetPackageList(item->mKey), item);
+    };
     {
         PTScopedLock lock(mMergeLock);
-        unordered_map<int64_t, MergeItem*>::iterator itr = mMergeMap.begin();
-        for (; itr != mMergeMap.end();) {
-            if (sender->IsFlush()
-                || (itr->second->IsReady()
-                    && sender->GetSenderFeedBackInterface()->IsValidToPush(itr->second->mLogstoreKey))) {
-                if (itr->second->mMergeType == MERGE_BY_TOPIC)
-                    sendDataVec.push_back(itr->second);
-                else {
-                    int64_t key = itr->second->mKey;
-                    unordered_map<int64_t, PackageListMergeBuffer*>::iterator pIter = mPackageListMergeMap.find(key);
-                    if (pIter == mPackageListMergeMap.end()) {
-                        PackageListMergeBuffer* tmpPtr = new PackageListMergeBuffer;
-                        pIter = mPackageListMergeMap.insert(std::make_pair(key, tmpPtr)).first;
-                    }
-                    pIter->second->AddMergeItem(itr->second);
-                }
-                itr = mMergeMap.erase(itr);
-            } else
-                itr++;
+        if (sender->IsFlush()) {
+            for (auto itr = mMergeMap.begin(); itr != mMergeMap.end(); ++itr) {
+                dispatchMergeItem(itr->second);
+            }
+            mMergeMap.clear();
+        } else {
+            int32_t curTime = time(NULL);
+            vector<MergeDeadline> retries;
+            MergeItem* item = NULL;
+            while ((item = PopReadyMergeItem(curTime, retries)) != NULL) {
+                dispatchMergeItem(item);
+            }
+            for (const MergeDeadline& deadline : retries) {
+                mMergeDeadlines.push(deadline);
+            }
         }
     }
 
     vector<vector<MergeItem*> > packageListVec;
-    int32_t curTime = time(NULL);
+    auto dispatchPackageList = [&](PackageListMergeBuffer* buffer) {
+        LOG_DEBUG(sLogger,
+                  ("Flush logstore merged packet, size", buffer->mMergeItems.size())("first time",
+                                                                                   buffer->mFirstItemTime));
+        if (buffer->mItemCount > 1)
+            packageListVec.push_back(buffer->mMergeItems);
+        else if (buffer->mItemCount == 1)
+            sendDataVec.push_back(buffer->mMergeItems[0]); // send LogGroup avoid more cost for LogPackageList
+        delete buffer;
+    };
     {
         PTScopedLock lock(mMergeLock);
-        unordered_map<int64_t, PackageListMergeBuffer*>::iterator pIter = mPackageListMergeMap.begin();
-        for (; pIter != mPackageListMergeMap.end();) {
-            if (sender->IsFlush()
-                || (pIter->second->IsReady(curTime) && pIter->second->mMergeItems.size() > 0
-                    && sender->GetSenderFeedBackInterface()->IsValidToPush(
-                        pIter->second->GetFirstItem()->mLogstoreKey))) {
-#ifdef LOGTAIL_DEBUG_FLAG
-                LOG_DEBUG(sLogger,
-                          ("Flush logstore merged packet, size", pIter->second->mMergeItems.size())(
-                              "first time", pIter->second->mFirstItemTime)("now", curTime));
-#endif
-                if (pIter->second->mItemCount > 1)
-                    packageListVec.push_back(pIter->second->mMergeItems);
-                else
-                    sendDataVec.push_back(
-                        pIter->second->mMergeItems[0]); // send LogGroup avoid more cost for LogPackageList
-                delete pIter->second;
-                pIter = mPackageListMergeMap.erase(pIter);
-            } else
-                pIter++;
+        if (sender->IsFlush()) {
+            for (auto pIter = mPackageListMergeMap.begin(); pIter != mPackageListMergeMap.end(); ++pIter) {
+                dispatchPackageList(pIter->second);
+            }
+            mPackageListMergeMap.clear();
+        } else {
+            int32_t curTime = time(NULL);
+            vector<MergeDeadline> retries;
+            PackageListMergeBuffer* buffer = NULL;
+            while ((buffer = PopReadyPackageList(curTime, retries)) != NULL) {
+                dispatchPackageList(buffer);
+            }
+            for (const MergeDeadline& deadline : retries) {
+                mPackageListDeadlines.push(deadline);
+            }
         }
     }
 
+    if (BOOL_FLAG(enable_merge_item_coalesce) && sendDataVec.size() > 1) {
+        CoalesceMergeItems(sendDataVec, packageListVec);
+    }
     if (sendDataVec.size() > 0)
         sender->SendCompressed(sendDataVec);
 
@@ -109,6 +190,154 @@ bool Aggregator::FlushReadyBuffer() {
     return true;
 }
 
+void Aggregator::FlushLogToMetric() {
+    static Sender* sender = Sender::Instance();
+    const bool force = sender->IsFlush();
+    const int32_t curTime = time(NULL);
+    for (const auto& item : ConfigManager::GetInstance()->GetAllConfig()) {
+        const Config* config = item.second;
+        if (!config->mProcessPipeline || !config->mProcessPipeline->mLogToMetric) {
+            continue;
+        }
+        LogToMetricAggregator& metric = *config->mProcessPipeline->mLogToMetric;
+        sls_logs::LogGroup logGroup;
+        if (metric.Flush(curTime, force, logGroup) == 0) {
+            continue;
+        }
+        logGroup.set_category(config->mCategory);
+        logGroup.set_topic(metric.GetConfig().mTopic);
+        LogGroupContext context(
+            config->mRegion, config->mProjectName, config->mCategory, config->mProcessPipeline->mCompressType);
+        context.mLogToMetricOutput = true;
+        Add(config->mProjectName, "", logGroup, config, config->mMergeType, 0, config->mRegion, "", context);
+    }
+}
+
+void Aggregator::AddToMergeMap(std::unordered_map<int64_t, MergeItem*>::iterator itr, MergeItem* item) {
+    item->mMergeSeq = ++mMergeSeq;
+    itr->second = item;
+    mMergeDeadlines.push(MergeDeadline{item->mLastUpdateTime + item->mBatchSendInterval, itr->first, item->mMergeSeq});
+}
+
+void Aggregator::CoalesceMergeItems(std::vector<MergeItem*>& items,
+                                    std::vector<std::vector<MergeItem*>>& packageLists) {
+    std::unordered_map<std::string, size_t> groupIndexes;
+    std::vector<std::vector<MergeItem*>> groups;
+    std::vector<MergeItem*> rest;
+    const int32_t curTime = time(NULL);
+    for (MergeItem* item : items) {
+        // A package list is sent with the shard hash key of its last item and records offset and checkpoint of
+        // its last item only, so items with hash keys are coalesced only if their keys are in the same shard.
+        const LogGroupContext& context = item->mLogGroupContext;
+        if (context.mExactlyOnceCheckpoint || context.mMarkOffsetFlag) {
+            rest.push_back(item);
+            continue;
+        }
+        int32_t shardId = -1;
+        if (!item->mShardHashKey.empty()) {
+            if (BOOL_FLAG(enable_shard_route)) {
+                shardId = ShardRouter::GetInstance()->GetShardId(item->mProjectName,
+                                                                 item->mLogGroup.category(),
+                                                                 item->mRegion,
+                                                                 item->mAliuid,
+                                                                 item->mShardHashKey,
+                                                                 curTime);
+            }
+            if (shardId < 0) {
+                rest.push_back(item);
+                continue;
+            }
+        }
+        std::string key = item->mProjectName + "\n" + item->mLogGroup.category() + "\n" + item->mRegion + "\n"
+            + item->mAliuid + "\n" + (item->mBufferOrNot ? "1" : "0") + "\n" + (shardId < 0 ? "" : ToString(shardId));
+        auto iter = groupIndexes.find(key);
+        if (iter == groupIndexes.end()) {
+            iter = groupIndexes.insert(std::make_pair(std::move(key), groups.size())).first;
+            groups.emplace_back();
+        }
+        groups[iter->second].push_back(item);
+    }
+    for (std::vector<MergeItem*>& group : groups) {
+        if (group.size() > 1) {
+            packageLists.push_back(std::move(group));
+        } else {
+            rest.push_back(group[0]);
+        }
+    }
+    items.swap(rest);
+}
+
+std::unordered_map<int64_t, PackageListMergeBuffer*>::iterator Aggregator::GetPackageList(int64_t key) {
+    auto pIter = mPackageListMergeMap.find(key);
+    if (pIter == mPackageListMergeMap.end()) {
+        PackageListMergeBuffer* tmpPtr = new PackageListMergeBuffer();
+        tmpPtr->mMergeSeq = ++mMergeSeq;
+        pIter = mPackageListMergeMap.insert(std::make_pair(key, tmpPtr)).first;
+    }
+    return pIter;
+}
+
+void Aggregator::AddToPackageList(std::unordered_map<int64_t, PackageListMergeBuffer*>::iterator pIter,
+                                  MergeItem* item) {
+    PackageListMergeBuffer* buffer = pIter->second;
+    const int32_t firstItemTime = buffer->mFirstItemTime;
+    buffer->AddMergeItem(item);
+    // The first item time only goes earlier, the entry with later deadline becomes stale.
+    if (buffer->mItemCount == 1 || buffer->mFirstItemTime != firstItemTime) {
+        mPackageListDeadlines.push(MergeDeadline{
+            buffer->mFirstItemTime + 2 * INT32_FLAG(batch_send_interval), pIter->first, buffer->mMergeSeq});
+    }
+}
+
+MergeItem* Aggregator::PopReadyMergeItem(int32_t curTime, std::vector<MergeDeadline>& retries) {
+    static Sender* sender = Sender::Instance();
+    while (!mMergeDeadlines.empty() && mMergeDeadlines.top().mDeadline <= curTime) {
+        const MergeDeadline deadline = mMergeDeadlines.top();
+        mMergeDeadlines.pop();
+        auto itr = mMergeMap.find(deadline.mKey);
+        if (itr == mMergeMap.end() || itr->second == NULL || itr->second->mMergeSeq != deadline.mSeq) {
+            continue;
+        }
+        MergeItem* item = itr->second;
+        if (!item->IsReady()) {
+            retries.push_back(deadline);
+            continue;
+        }
+        if (!sender->GetSenderFeedBackInterface()->IsValidToPush(item->mLogstoreKey)) {
+            AdaptiveBatchPolicy::GetInstance()->OnSendBlocked(item->mRegion, curTime);
+            retries.push_back(deadline);
+            continue;
+        }
+        mMergeMap.erase(itr);
+        return item;
+    }
+    return NULL;
+}
+
+PackageListMergeBuffer* Aggregator::PopReadyPackageList(int32_t curTime, std::vector<MergeDeadline>& retries) {
+    static Sender* sender = Sender::Instance();
+    while (!mPackageListDeadlines.empty() && mPackageListDeadlines.top().mDeadline <= curTime) {
+        const MergeDeadline deadline = mPackageListDeadlines.top();
+        mPackageListDeadlines.pop();
+        auto pIter = mPackageListMergeMap.find(deadline.mKey);
+        if (pIter == mPackageListMergeMap.end() || pIter->second->mMergeSeq != deadline.mSeq) {
+            continue;
+        }
+        PackageListMergeBuffer* buffer = pIter->second;
+        if (!buffer->IsReady(curTime) || buffer->mMergeItems.empty()) {
+            continue;
+        }
+        if (!sender->GetSenderFeedBackInterface()->IsValidToPush(buffer->GetFirstItem()->mLogstoreKey)) {
+            AdaptiveBatchPolicy::GetInstance()->OnSendBlocked(buffer->GetFirstItem()->mRegion, curTime);
+            retries.push_back(deadline);
+            continue;
+        }
+        mPackageListMergeMap.erase(pIter);
+        return buffer;
+    }
+    return NULL;
+}
+
 void Aggregator::AddPackIDForLogGroup(const std::string& packIDPrefix,
                                       int64_t logGroupKey,
                                       sls_logs::LogGroup& logGroup) {
@@ -130,7 +359,10 @@ bool Aggregator::Add(const std::string& projectName,
                      const uint32_t logGroupSize,
                      const std::string& defaultRegion,
                      const std::string& filename,
-                     const LogGroupContext& context) {
+                     const LogGroupContext& context,
+                     const std::shared_ptr<google::protobuf::Arena>& arena) {
+    static const std::string sEmptyConfigName;
+    StageProfileScope profileScope(config != NULL ? config->mConfigName : sEmptyConfigName, PROFILE_STAGE_AGGREGATE);
     if ((logGroupSize == 0 && logGroup.ByteSize() > INT32_FLAG(max_send_log_group_size))
         || (int32_t)logGroupSize > INT32_FLAG(max_send_log_group_size)) {
         LOG_ERROR(sLogger, ("invalid log group size", logGroupSize)("real size", logGroup.ByteSize()));
@@ -164,9 +396,17 @@ bool Aggregator::Add(const std::string& projectName,
     int32_t neededLogSize = FilterNoneUtf8Metric(logGroup, config, neededLogs, context);
     if (neededLogSize == 0)
         return true;
-    if (config != NULL && config->mSensitiveWordCastOptions.size() > (size_t)0) {
+    if (config != NULL && config->mSensitiveWordCastOptions.size() > (size_t)0 && !context.mLogToMetricOutput) {
         LogFilter::CastSensitiveWords(logGroup, config);
     }
+    // Logs of exactly once buffers are sent as they are, their checkpoints need the logs to be sent.
+    if (config != NULL && !context.mLogToMetricOutput && !context.mExactlyOnceCheckpoint
+        && config->mProcessPipeline && config->mProcessPipeline->mLogToMetric) {
+        config->mProcessPipeline->mLogToMetric->Add(logGroup, neededLogs);
+        if (neededLogs.empty()) {
+            return true;
+        }
+    }
 
     static Sender* sender = Sender::Instance();
     const string& region = (config == NULL ? defaultRegion : config->mRegion);
@@ -177,12 +417,17 @@ bool Aggregator::Add(const std::string& projectName,
     const string& source = logGroup.has_source() ? logGroup.source() : LogFileProfiler::mIpAddr;
     string shardHashKey = CalPostRequestShardHashKey(source, topic, config);
     // now shardHashKey is compute using machine level fields, so logGroupKey will not contain shardHashKey
-    int64_t logGroupKey
-        = HashString(projectName + "_" + category + "_" + topic + "_" + source + "_"
-                     + ((config != NULL && config->mLogType != STREAM_LOG && config->mLogType != PLUGIN_LOG)
-                            ? (config->mBasePath + config->mFilePattern)
-                            : "")
-                     + "_" + sourceId);
+    // Key of project, category, topic, source, [basePath+filePattern] and sourceId, the path and sourceId
+    // parts are precomputed by config and reader. Keys are only kept in memory, so they may change between
+    // versions.
+    const uint64_t logstoreKeyPart = HashWithSeed(category, HashWithSeed(projectName));
+    uint64_t logGroupKeyPart = HashWithSeed(source, HashWithSeed(topic, logstoreKeyPart));
+    if (config != NULL && config->mLogType != STREAM_LOG && config->mLogType != PLUGIN_LOG) {
+        logGroupKeyPart = HashCombine(logGroupKeyPart, config->mPathMergeKey);
+    }
+    logGroupKeyPart = HashCombine(logGroupKeyPart,
+                                  context.mSourceIdKey != 0 ? context.mSourceIdKey : HashWithSeed(sourceId));
+    int64_t logGroupKey = static_cast<int64_t>(logGroupKeyPart);
 
     // Replay checkpoint had already been merged, resend directly.
     if (context.mExactlyOnceCheckpoint && context.mExactlyOnceCheckpoint->IsComplete()) {
@@ -199,36 +444,42 @@ bool Aggregator::Add(const std::string& projectName,
         = config == NULL ? GenerateLogstoreFeedBackKey(projectName, category) : config->mLogstoreKey;
     int64_t key, logstoreKey;
     if (mergeType == MERGE_BY_LOGSTORE) {
-        logstoreKey = HashString(projectName + "_" + category);
+        logstoreKey = static_cast<int64_t>(logstoreKeyPart);
         key = logstoreKey;
     } else {
         key = logGroupKey;
     }
 
+    // Logs allocated on arena are moved into merge items without copy, merge items
+    // keep the arena alive until they are serialized.
+    const bool arenaOwned = arena && logGroup.GetArena() == arena.get();
     LogGroup discardLogGroup;
     vector<MergeItem*> sendDataVec;
     int32_t logByteSize = (logGroupSize == 0 ? logGroup.ByteSize() : logGroupSize) / logSize;
     decltype(logGroup.mutable_logs()->mutable_data()) mutableLogPtr = logGroup.mutable_logs()->mutable_data();
     int32_t neededIdx = 0;
     int32_t discardLogSize = logSize - neededLogSize;
-    if (discardLogSize > 0) {
+    if (discardLogSize > 0 && !arenaOwned) {
         discardLogGroup.mutable_logs()->Reserve(discardLogSize);
     }
-    int32_t logCountMin = INT32_FLAG(merge_log_count_limit) > 1 ? (INT32_FLAG(merge_log_count_limit) - 1) : 0;
-    int32_t logGroupByteMin = AppConfig::GetInstance()->GetMaxHoldedDataSize() > logByteSize
-        ? (AppConfig::GetInstance()->GetMaxHoldedDataSize() - logByteSize)
-        : 0;
+    // Line count limit only shrinks, byte limits grow up to half of the max send size.
+    static AdaptiveBatchPolicy* batchPolicy = AdaptiveBatchPolicy::GetInstance();
+    const int32_t maxBatchBytes = INT32_FLAG(max_send_log_group_size) / 2;
+    const int32_t logCountLimit
+        = batchPolicy->ScaleLimit(region, INT32_FLAG(merge_log_count_limit), INT32_FLAG(merge_log_count_limit));
+    const int32_t maxHoldedDataSize
+        = batchPolicy->ScaleLimit(region, AppConfig::GetInstance()->GetMaxHoldedDataSize(), maxBatchBytes);
+    const int32_t batchSendMetricSize
+        = batchPolicy->ScaleLimit(region, INT32_FLAG(batch_send_metric_size), maxBatchBytes);
+    int32_t logCountMin = logCountLimit > 1 ? (logCountLimit - 1) : 0;
+    int32_t logGroupByteMin = maxHoldedDataSize > logByteSize ? (maxHoldedDataSize - logByteSize) : 0;
 
     int32_t curTime = time(NULL);
     {
         PTScopedLock lock(mMergeLock);
         unordered_map<int64_t, PackageListMergeBuffer*>::iterator pIter;
         if (mergeType == MERGE_BY_LOGSTORE) {
-            pIter = mPackageListMergeMap.find(logstoreKey);
-            if (pIter == mPackageListMergeMap.end()) {
-                PackageListMergeBuffer* tmpPtr = new PackageListMergeBuffer();
-                pIter = mPackageListMergeMap.insert(std::make_pair(logstoreKey, tmpPtr)).first;
-            }
+            pIter = GetPackageList(logstoreKey);
         }
         unordered_map<int64_t, MergeItem*>::iterator itr = mMergeMap.find(logGroupKey);
         MergeItem* value = NULL;
@@ -237,6 +488,13 @@ bool Aggregator::Add(const std::string& projectName,
         else
             itr = mMergeMap.insert(std::make_pair(logGroupKey, value)).first;
 
+        if (value != NULL) {
+            // logs merged into an existing item were read later, keep read time of the earliest buffer
+            uint64_t& readTime = value->mLogGroupContext.mTimestamps.mReadTimeInMs;
+            if (readTime == 0) {
+                readTime = context.mTimestamps.mReadTimeInMs;
+            }
+        }
         bool mergeFinishedFlag = false, initFlag = false;
         for (int32_t logIdx = 0; logIdx < logSize; logIdx++) {
             if (neededIdx < neededLogSize && logIdx == neededLogs[neededIdx]) {
@@ -255,7 +513,7 @@ bool Aggregator::Add(const std::string& projectName,
                         }
 
                         if (mergeType == MERGE_BY_LOGSTORE)
-                            pIter->second->AddMergeItem(value);
+                            AddToPackageList(pIter, value);
                         else
                             sendDataVec.push_back(value);
                     }
@@ -295,10 +553,12 @@ bool Aggregator::Add(const std::string& projectName,
                                               batchSendInterval,
                                               context);
                     }
-                    itr->second = value;
                     initFlag = true;
 
                     value->mLastUpdateTime = curTime; // set the last update time before enqueue
+                    value->mLogGroupContext.mTimestamps.mAggregateTimeInMs = GetSteadyTimeInMilliSeconds();
+                    value->mBatchSendMetricSize = batchSendMetricSize;
+                    AddToMergeMap(itr, value);
                     (value->mLogGroup).mutable_logs()->Reserve(INT32_FLAG(merge_log_count_limit));
                     (value->mLogGroup).set_category(category);
                     (value->mLogGroup).set_topic(topic);
@@ -315,7 +575,11 @@ bool Aggregator::Add(const std::string& projectName,
                     AddPackIDForLogGroup(sourceId, logGroupKey, value->mLogGroup);
                 }
 
-                (value->mLogGroup).mutable_logs()->AddAllocated(*(mutableLogPtr + logIdx));
+                if (arenaOwned) {
+                    value->AddArenaLog(*(mutableLogPtr + logIdx), arena);
+                } else {
+                    (value->mLogGroup).mutable_logs()->AddAllocated(*(mutableLogPtr + logIdx));
+                }
                 if (context.mExactlyOnceCheckpoint) {
                     auto& logPosition = context.mExactlyOnceCheckpoint->positions[logIdx];
                     auto& cpt = value->mLogGroupContext.mExactlyOnceCheckpoint->data;
@@ -331,9 +595,10 @@ bool Aggregator::Add(const std::string& projectName,
                 // get first log time as log time of this log group in merge item
                 value->mLogTimeInMinute = (value->mLogGroup).logs(0).time() - (value->mLogGroup).logs(0).time() % 60;
                 value->mRawBytes += logByteSize;
+                MemoryBudget::Add(MEMORY_COMPONENT_AGGREGATOR, logByteSize);
                 value->mLines++;
                 neededIdx++;
-            } else
+            } else if (!arenaOwned)
                 discardLogGroup.mutable_logs()->AddAllocated(*(mutableLogPtr + logIdx));
         }
 
@@ -345,11 +610,17 @@ bool Aggregator::Add(const std::string& projectName,
             value->mLogGroupContext.mFileInfoPtr = context.mFileInfoPtr;
         }
 
-        for (int32_t logIdx = 0; logIdx < logSize; logIdx++)
-            logGroup.mutable_logs()->ReleaseLast();
+        // All logs have been handed over to merge items or discardLogGroup, drop them from
+        // @logGroup at once without copy.
+        if (arenaOwned) {
+            logGroup.mutable_logs()->UnsafeArenaExtractSubrange(0, logSize, NULL);
+        } else {
+            for (int32_t logIdx = 0; logIdx < logSize; logIdx++)
+                logGroup.mutable_logs()->ReleaseLast();
+        }
         if (value != NULL && (value->IsReady() || sender->IsFlush())) {
             if (mergeType == MERGE_BY_LOGSTORE)
-                (pIter->second)->AddMergeItem(value);
+                AddToPackageList(pIter, value);
             else
                 sendDataVec.push_back(value);
 
@@ -422,6 +693,9 @@ Aggregator::CalPostRequestShardHashKey(const std::string& source, const std::str
     if (keySize == 0)
         return "";
 
+    // Shard keys are mostly machine level fields, so the md5 of the last input is reused.
+    static thread_local string sLastInput;
+    static thread_local string sLastShardHashKey;
     string input;
     for (uint32_t idx = 0; idx < keySize; ++idx) {
         const string& key = config->mShardHashKey[idx];
@@ -439,7 +713,11 @@ Aggregator::CalPostRequestShardHashKey(const std::string& source, const std::str
         if (idx != (keySize - 1))
             input.append("_");
     }
-    return sdk::CalcMD5(input);
+    if (sLastShardHashKey.empty() || input != sLastInput) {
+        sLastShardHashKey = sdk::CalcMD5(input);
+        sLastInput.swap(input);
+    }
+    return sLastShardHashKey;
 }
 
 
@@ -485,7 +763,18 @@ int32_t Aggregator::FilterNoneUtf8Metric(sls_logs::LogGroup& logGroup,
                                          std::vector<int32_t>& neededLogs,
                                          const LogGroupContext& context) {
     static LogFilter* filterPtr = LogFilter::Instance();
-    if (config != NULL && config->mAdvancedConfig.mFilterExpressionRoot.get() != NULL) {
+    static const std::string sEmptyConfigName;
+    StageProfileScope profileScope(config != NULL ? config->mConfigName : sEmptyConfigName, PROFILE_STAGE_FILTER);
+    if (context.mLogToMetricOutput) {
+        neededLogs.resize(logGroup.logs_size());
+        for (int32_t i = 0; i < logGroup.logs_size(); ++i) {
+            neededLogs[i] = i;
+        }
+        return logGroup.logs_size();
+    }
+    if (config != NULL && config->mAdvancedConfig.mFilterExpressionProgram) {
+        neededLogs = filterPtr->Filter(logGroup, *config->mAdvancedConfig.mFilterExpressionProgram, context);
+    } else if (config != NULL && config->mAdvancedConfig.mFilterExpressionRoot.get() != NULL) {
         neededLogs = filterPtr->Filter(logGroup, config->mAdvancedConfig.mFilterExpressionRoot, context);
     } else if (config != NULL && config->mFilterRule) {
         neededLogs = filterPtr->Filter(logGroup, config->mFilterRule.get(), context);
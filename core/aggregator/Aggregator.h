@@ -16,14 +16,20 @@
 
 #pragma once
 #include <string>
+#include <memory>
+#include <google/protobuf/arena.h>
 #include "log_pb/sls_logs.pb.h"
 #include <unordered_map>
 #include <vector>
+#include <queue>
+#include <functional>
 #include "common/Lock.h"
 #include "common/LogGroupContext.h"
+#include "common/StringInterner.h"
 #include "common/Flags.h"
 
 DECLARE_FLAG_INT32(batch_send_interval);
+DECLARE_FLAG_INT32(batch_send_metric_size);
 
 namespace logtail {
 
@@ -35,29 +41,38 @@ struct MergeItem {
     int32_t mLastUpdateTime;
     int32_t mRawBytes;
     int32_t mLines;
-    std::string mProjectName;
-    std::string mConfigName;
+    InternedString mProjectName;
+    InternedString mConfigName;
     std::string mFilename;
     sls_logs::LogGroup mLogGroup;
     std::string mShardHashKey;
     bool mBufferOrNot;
-    std::string mAliuid;
-    std::string mRegion;
+    InternedString mAliuid;
+    InternedString mRegion;
     int64_t mKey; // for batchmap
     DATA_MERGE_TYPE mMergeType;
     LogstoreFeedBackKey mLogstoreKey;
     int32_t mLogTimeInMinute;
     int32_t mBatchSendInterval;
+    int32_t mBatchSendMetricSize; // scaled by AdaptiveBatchPolicy
+    uint64_t mMergeSeq = 0; // identifies the item in Aggregator::mMergeDeadlines
 
     LogGroupContext mLogGroupContext;
+    // Arenas owning the logs moved in by UnsafeArenaAddAllocated, the logs are
+    // detached from mLogGroup in destructor and freed along with the arenas.
+    std::vector<std::shared_ptr<google::protobuf::Arena> > mArenas;
 
     bool IsReady();
-    MergeItem(const std::string& projectName,
-              const std::string& configName,
+    void AddArenaLog(sls_logs::Log* log, const std::shared_ptr<google::protobuf::Arena>& arena);
+    // GroupLogsBySchema moves logs with the same content keys together, in order of first appearance, so
+    // compression finds longer matches. Relative order of logs with the same keys is kept.
+    void GroupLogsBySchema();
+    MergeItem(const InternedString& projectName,
+              const InternedString& configName,
               const std::string& filename,
               const bool bufferOrNot,
-              const std::string& aliuid,
-              const std::string& region,
+              const InternedString& aliuid,
+              const InternedString& region,
               int64_t key,
               DATA_MERGE_TYPE mergeType,
               const std::string& shardHashKey,
@@ -79,23 +94,30 @@ struct MergeItem {
         mLogstoreKey = logstoreKey;
         mLogTimeInMinute = -1;
         mBatchSendInterval = batchSendInterval;
+        mBatchSendMetricSize = INT32_FLAG(batch_send_metric_size);
         mLogGroupContext = context;
     }
+    ~MergeItem();
 };
 
 struct PackageListMergeBuffer {
     int32_t mTotalRawBytes;
     int32_t mFirstItemTime;
     int32_t mItemCount;
+    int32_t mBatchSendMetricSize; // of the first item
+    uint64_t mMergeSeq = 0; // identifies the buffer in Aggregator::mPackageListDeadlines
     std::vector<MergeItem*> mMergeItems;
 
     PackageListMergeBuffer() {
         mTotalRawBytes = 0;
         mItemCount = 0;
         mFirstItemTime = 0;
+        mBatchSendMetricSize = INT32_FLAG(batch_send_metric_size);
     }
 
     void AddMergeItem(MergeItem* item) {
+        if (mItemCount == 0)
+            mBatchSendMetricSize = item->mBatchSendMetricSize;
         mMergeItems.push_back(item);
         mTotalRawBytes += item->mRawBytes;
         mItemCount++;
@@ -121,6 +143,9 @@ public:
     }
 
     bool FlushReadyBuffer();
+    // FlushLogToMetric adds metric logs of ended log_to_metric windows of all configs, or of all windows if
+    // sender is flushing. Configs are read without lock, so it is only called by LogProcess thread 0.
+    void FlushLogToMetric();
     bool IsMergeMapEmpty();
 
     std::string CalPostRequestShardHashKey(const std::string& source, const std::string& topic, const Config* config);
@@ -133,11 +158,18 @@ public:
              const uint32_t logGroupSize,
              const std::string& defaultRegion = "",
              const std::string& filename = "",
-             const LogGroupContext& context = LogGroupContext());
+             const LogGroupContext& context = LogGroupContext(),
+             const std::shared_ptr<google::protobuf::Arena>& arena = nullptr);
 
     void CleanLogPackSeqMap();
     void CleanTimeoutLogPackSeq();
 
+    // CoalesceMergeItems moves merge items of the same logstore in @items into @packageLists, each of them
+    // is sent as one log package list instead of one request per item. Items with shard hash keys share a
+    // request only if ShardRouter knows their keys are in the same shard. Items which can not share a request
+    // are left in @items.
+    static void CoalesceMergeItems(std::vector<MergeItem*>& items, std::vector<std::vector<MergeItem*>>& packageLists);
+
 private:
     struct LogPackSeqInfo {
     public:
@@ -166,6 +198,28 @@ private:
 
     void AddPackIDForLogGroup(const std::string& packIDPrefix, int64_t logGroupKey, sls_logs::LogGroup& logGroup);
 
+    // MergeDeadline is the time when a merge item or package list of mKey becomes ready
+    // by time. Entries are not removed along with the item, they are skipped when popped
+    // if mSeq does not equal to the one of item in map.
+    struct MergeDeadline {
+        int32_t mDeadline;
+        int64_t mKey;
+        uint64_t mSeq;
+
+        bool operator>(const MergeDeadline& rhs) const { return mDeadline > rhs.mDeadline; }
+    };
+    typedef std::priority_queue<MergeDeadline, std::vector<MergeDeadline>, std::greater<MergeDeadline>>
+        MergeDeadlineQueue;
+
+    // Following methods must be called with mMergeLock held.
+    void AddToMergeMap(std::unordered_map<int64_t, MergeItem*>::iterator itr, MergeItem* item);
+    std::unordered_map<int64_t, PackageListMergeBuffer*>::iterator GetPackageList(int64_t key);
+    void AddToPackageList(std::unordered_map<int64_t, PackageListMergeBuffer*>::iterator pIter, MergeItem* item);
+    // PopReadyMergeItem returns the next merge item which is ready and valid to push, and
+    // removes it from mMergeMap, @retries collects ready ones which can not be pushed now.
+    MergeItem* PopReadyMergeItem(int32_t curTime, std::vector<MergeDeadline>& retries);
+    PackageListMergeBuffer* PopReadyPackageList(int32_t curTime, std::vector<MergeDeadline>& retries);
+
 private:
     Aggregator() = default;
     ~Aggregator() = default;
@@ -176,6 +230,11 @@ private:
 
     std::unordered_map<int64_t, MergeItem*> mMergeMap;
     std::unordered_map<int64_t, PackageListMergeBuffer*> mPackageListMergeMap;
+    // Deadlines of items in mMergeMap and mPackageListMergeMap, so flush only visits
+    // ready ones instead of all of them.
+    MergeDeadlineQueue mMergeDeadlines;
+    MergeDeadlineQueue mPackageListDeadlines;
+    uint64_t mMergeSeq = 0;
     PTMutex mMergeLock;
 
 #ifdef APSARA_UNIT_TEST_MAIN
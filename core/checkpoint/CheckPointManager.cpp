@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "CheckPointManager.h"
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <thread>
@@ -25,6 +26,8 @@
 #include "common/StringTools.h"
 #include "common/FileSystemUtil.h"
 #include "logger/Logger.h"
+#include "log_pb/checkpoint.pb.h"
+#include "CheckPointSnapshot.h"
 
 using namespace std;
 #if defined(__linux__)
@@ -39,6 +42,13 @@ DEFINE_FLAG_INT32(check_point_version, "now check point version xx.xx.xx such as
 DEFINE_FLAG_INT32(check_point_dump_interval, "default 15 min", 15 * 60);
 DEFINE_FLAG_INT32(check_point_max_count, "max check point count", 100000);
 DEFINE_FLAG_INT32(checkpoint_find_max_file_count, "", 1000);
+DEFINE_FLAG_BOOL(check_point_snapshot_dump_enable,
+                 "readers publish checkpoints to a snapshot table, periodic dumps write it on another thread "
+                 "instead of holding on event handling",
+                 true);
+DEFINE_FLAG_BOOL(check_point_store_enable,
+                 "keep checkpoints in a leveldb store and only write changed ones, instead of the json file",
+                 false);
 
 namespace logtail {
 
@@ -47,6 +57,7 @@ bool CheckPointManager::CheckVersion() {
 }
 
 void CheckPointManager::AddCheckPoint(CheckPoint* checkPointPtr) {
+    ScopedSpinLock lock(mCheckPointLock);
     DevInodeCheckPointHashMap::iterator it
         = mDevInodeCheckPointPtrMap.find(CheckPointKey(checkPointPtr->mDevInode, checkPointPtr->mConfigName));
     if (it != mDevInodeCheckPointPtrMap.end())
@@ -56,12 +67,14 @@ void CheckPointManager::AddCheckPoint(CheckPoint* checkPointPtr) {
 }
 
 void CheckPointManager::DeleteCheckPoint(DevInode devInode, const std::string& configName) {
+    ScopedSpinLock lock(mCheckPointLock);
     DevInodeCheckPointHashMap::iterator it = mDevInodeCheckPointPtrMap.find(CheckPointKey(devInode, configName));
     if (it != mDevInodeCheckPointPtrMap.end())
         mDevInodeCheckPointPtrMap.erase(it);
 }
 
 bool CheckPointManager::GetCheckPoint(DevInode devInode, const std::string& configName, CheckPointPtr& checkPointPtr) {
+    ScopedSpinLock lock(mCheckPointLock);
     DevInodeCheckPointHashMap::iterator it = mDevInodeCheckPointPtrMap.find(CheckPointKey(devInode, configName));
     if (it != mDevInodeCheckPointPtrMap.end()) {
         checkPointPtr = it->second;
@@ -102,6 +115,10 @@ CheckPointManager::DevInodeCheckPointHashMap& CheckPointManager::GetAllFileCheck
 
 
 void CheckPointManager::AddDirCheckPoint(const string& dirname) {
+    AddDirCheckPoint(mDirNameMap, dirname);
+}
+
+void CheckPointManager::AddDirCheckPoint(DirCheckPointMap& dirs, const string& dirname) {
     if (dirname.size() == 0)
         return;
     size_t last = dirname.size() - 1;
@@ -109,16 +126,21 @@ void CheckPointManager::AddDirCheckPoint(const string& dirname) {
         last--;
     last = dirname.rfind(PATH_SEPARATOR, last);
     string parent = dirname.substr(0, last);
-    std::unordered_map<std::string, DirCheckPointPtr>::iterator it = mDirNameMap.find(parent);
+    DirCheckPointMap::iterator it = dirs.find(parent);
     DirCheckPoint* ptr = NULL;
-    if (it == mDirNameMap.end()) {
+    if (it == dirs.end()) {
         ptr = new DirCheckPoint(parent);
-        mDirNameMap.insert(make_pair(parent, DirCheckPointPtr(ptr)));
+        dirs.insert(make_pair(parent, DirCheckPointPtr(ptr)));
     } else
         ptr = it->second.get();
     ptr->mSubDir.insert(dirname);
 }
 void CheckPointManager::LoadCheckPoint() {
+    // If the store is empty, e.g. it is just enabled, load the json file and the store is
+    // filled by the next dump.
+    if (BOOL_FLAG(check_point_store_enable) && LoadCheckPointFromStore()) {
+        return;
+    }
     Json::Value root;
     ParseConfResult cptRes = ParseConfig(AppConfig::GetInstance()->GetCheckPointFilePath(), root);
     // if new checkpoint file not exist, check old checkpoint file.
@@ -288,6 +310,60 @@ void CheckPointManager::LoadFileCheckPoint(const Json::Value& root) {
 }
 bool CheckPointManager::DumpCheckPointToLocal() {
     mLastDumpTime = time(NULL);
+    vector<const CheckPoint*> checkPoints;
+    checkPoints.reserve(mDevInodeCheckPointPtrMap.size());
+    for (auto it = mDevInodeCheckPointPtrMap.begin(); it != mDevInodeCheckPointPtrMap.end(); ++it) {
+        checkPoints.push_back(it->second.get());
+    }
+    return WriteCheckPoints(checkPoints, mDirNameMap);
+}
+
+bool CheckPointManager::StartDumpCheckPointSnapshot() {
+    mLastDumpTime = time(NULL);
+    if (mSnapshotDumping.exchange(true)) {
+        return false;
+    }
+    if (mSnapshotDumpThread.joinable()) {
+        mSnapshotDumpThread.join();
+    }
+    mSnapshotDumpThread = std::thread([this]() {
+        if (!DumpCheckPointSnapshot()) {
+            LOG_WARNING(sLogger, ("dump checkpoint snapshot to local", "fail"));
+        }
+        mSnapshotDumping = false;
+    });
+    return true;
+}
+
+bool CheckPointManager::DumpCheckPointSnapshot() {
+    vector<CheckPointSnapshotTable::CheckPointSnapshot> snapshots;
+    vector<string> dirs;
+    CheckPointSnapshotTable::GetInstance()->Collect(snapshots, dirs);
+    // Loaded checkpoints not taken by readers yet are kept, the ones published by readers are newer.
+    std::map<CheckPointKey, CheckPointSnapshotTable::CheckPointSnapshot> checkPointMap;
+    {
+        ScopedSpinLock lock(mCheckPointLock);
+        for (auto it = mDevInodeCheckPointPtrMap.begin(); it != mDevInodeCheckPointPtrMap.end(); ++it) {
+            checkPointMap[it->first] = it->second;
+        }
+    }
+    for (const auto& snapshot : snapshots) {
+        checkPointMap[CheckPointKey(snapshot->mDevInode, snapshot->mConfigName)] = snapshot;
+    }
+    vector<const CheckPoint*> checkPoints;
+    checkPoints.reserve(checkPointMap.size());
+    for (auto it = checkPointMap.begin(); it != checkPointMap.end(); ++it) {
+        checkPoints.push_back(it->second.get());
+    }
+    DirCheckPointMap dirMap;
+    for (const auto& dir : dirs) {
+        AddDirCheckPoint(dirMap, dir);
+    }
+    return WriteCheckPoints(checkPoints, dirMap);
+}
+
+bool CheckPointManager::WriteCheckPoints(vector<const CheckPoint*>& checkPoints, const DirCheckPointMap& dirs) {
+    std::lock_guard<std::mutex> lock(mDumpMutex);
     string checkPointFile = AppConfig::GetInstance()->GetCheckPointFilePath();
     string checkPointTempFile = checkPointFile + ".bak";
 
@@ -296,66 +372,41 @@ bool CheckPointManager::DumpCheckPointToLocal() {
         LogtailAlarm::GetInstance()->SendAlarm(CHECKPOINT_ALARM, "open check point file dir failed");
         return false;
     }
+    mReaderCount = static_cast<int32_t>(checkPoints.size());
+    if (checkPoints.size() > (size_t)INT32_FLAG(check_point_max_count)) {
+        const size_t count = checkPoints.size();
+        sort(checkPoints.begin(), checkPoints.end(), CheckPointManager::CheckPointCmpByUpdateTime);
+        checkPoints.resize(INT32_FLAG(check_point_max_count));
+        LOG_WARNING(sLogger, ("Too many check point", count));
+        LogtailAlarm::GetInstance()->SendAlarm(CHECKPOINT_ALARM, "Too many check point:" + ToString(count));
+    }
+    if (BOOL_FLAG(check_point_store_enable)) {
+        return DumpCheckPointToStore(checkPoints, dirs);
+    }
 
     Json::Value root;
-    mReaderCount = mDevInodeCheckPointPtrMap.size();
-    if (mDevInodeCheckPointPtrMap.size() <= (size_t)INT32_FLAG(check_point_max_count)) {
-        CheckPointManager::DevInodeCheckPointHashMap::iterator it;
-        for (it = mDevInodeCheckPointPtrMap.begin(); it != mDevInodeCheckPointPtrMap.end(); ++it) {
-            CheckPoint* checkPointPtr = it->second.get();
-            Json::Value leaf;
-            leaf["file_name"] = Json::Value(checkPointPtr->mFileName);
-            leaf["real_file_name"] = Json::Value(checkPointPtr->mRealFileName);
-            leaf["offset"] = Json::Value(ToString(checkPointPtr->mOffset));
-            leaf["sig_size"] = Json::Value(Json::UInt(checkPointPtr->mSignatureSize));
-            leaf["sig_hash"] = Json::Value(Json::UInt64(checkPointPtr->mSignatureHash));
-            leaf["update_time"] = Json::Value(checkPointPtr->mLastUpdateTime);
-            leaf["inode"] = Json::Value(Json::UInt64(checkPointPtr->mDevInode.inode));
-            leaf["dev"] = Json::Value(Json::UInt64(checkPointPtr->mDevInode.dev));
-            leaf["file_open"] = Json::Value(checkPointPtr->mFileOpenFlag);
-            leaf["config_name"] = Json::Value(checkPointPtr->mConfigName);
-            // forward compatible
-            leaf["sig"] = Json::Value(string(""));
-            // use filename + dev + inode + configName to prevent same filename conflict
-            root[checkPointPtr->mFileName + "*" + ToString(checkPointPtr->mDevInode.dev) + "*"
-                 + ToString(checkPointPtr->mDevInode.inode) + "*" + checkPointPtr->mConfigName]
-                = leaf;
-        }
-    } else {
-        vector<CheckPoint*> sortedCheckPointVec;
-        CheckPointManager::DevInodeCheckPointHashMap::iterator it;
-        for (it = mDevInodeCheckPointPtrMap.begin(); it != mDevInodeCheckPointPtrMap.end(); ++it) {
-            sortedCheckPointVec.push_back(it->second.get());
-        }
-        sort(sortedCheckPointVec.begin(), sortedCheckPointVec.end(), CheckPointManager::CheckPointCmpByUpdateTime);
-        for (int32_t i = 0; i < INT32_FLAG(check_point_max_count); ++i) {
-            CheckPoint* checkPointPtr = sortedCheckPointVec[i];
-            Json::Value leaf;
-            leaf["file_name"] = Json::Value(checkPointPtr->mFileName);
-            leaf["real_file_name"] = Json::Value(checkPointPtr->mRealFileName);
-            leaf["offset"] = Json::Value(ToString(checkPointPtr->mOffset));
-            leaf["sig_size"] = Json::Value(Json::UInt(checkPointPtr->mSignatureSize));
-            leaf["sig_hash"] = Json::Value(Json::UInt64(checkPointPtr->mSignatureHash));
-            leaf["update_time"] = Json::Value(checkPointPtr->mLastUpdateTime);
-            leaf["inode"] = Json::Value(Json::UInt64(checkPointPtr->mDevInode.inode));
-            leaf["dev"] = Json::Value(Json::UInt64(checkPointPtr->mDevInode.dev));
-            leaf["file_open"] = Json::Value(checkPointPtr->mFileOpenFlag);
-            leaf["config_name"] = Json::Value(checkPointPtr->mConfigName);
-            // forward compatible
-            leaf["sig"] = Json::Value(string(""));
-            // use filename + dev + inode + configName to prevent same filename conflict
-            root[checkPointPtr->mFileName + "*" + ToString(checkPointPtr->mDevInode.dev) + "*"
-                 + ToString(checkPointPtr->mDevInode.inode) + "*" + checkPointPtr->mConfigName]
-                = leaf;
-        }
-        LOG_WARNING(sLogger, ("Too many check point", mDevInodeCheckPointPtrMap.size()));
-        LogtailAlarm::GetInstance()->SendAlarm(CHECKPOINT_ALARM,
-                                               "Too many check point:" + ToString(mDevInodeCheckPointPtrMap.size()));
+    for (const CheckPoint* checkPointPtr : checkPoints) {
+        Json::Value leaf;
+        leaf["file_name"] = Json::Value(checkPointPtr->mFileName);
+        leaf["real_file_name"] = Json::Value(checkPointPtr->mRealFileName);
+        leaf["offset"] = Json::Value(ToString(checkPointPtr->mOffset));
+        leaf["sig_size"] = Json::Value(Json::UInt(checkPointPtr->mSignatureSize));
+        leaf["sig_hash"] = Json::Value(Json::UInt64(checkPointPtr->mSignatureHash));
+        leaf["update_time"] = Json::Value(checkPointPtr->mLastUpdateTime);
+        leaf["inode"] = Json::Value(Json::UInt64(checkPointPtr->mDevInode.inode));
+        leaf["dev"] = Json::Value(Json::UInt64(checkPointPtr->mDevInode.dev));
+        leaf["file_open"] = Json::Value(checkPointPtr->mFileOpenFlag);
+        leaf["config_name"] = Json::Value(checkPointPtr->mConfigName);
+        // forward compatible
+        leaf["sig"] = Json::Value(string(""));
+        // use filename + dev + inode + configName to prevent same filename conflict
+        root[checkPointPtr->mFileName + "*" + ToString(checkPointPtr->mDevInode.dev) + "*"
+             + ToString(checkPointPtr->mDevInode.inode) + "*" + checkPointPtr->mConfigName]
+            = leaf;
     }
 
-
     Json::Value dirJson;
-    for (unordered_map<string, DirCheckPointPtr>::iterator it = mDirNameMap.begin(); it != mDirNameMap.end(); ++it) {
+    for (auto it = dirs.begin(); it != dirs.end(); ++it) {
         DirCheckPoint* ptr = it->second.get();
         Json::Value value;
         for (set<string>::iterator itr = ptr->mSubDir.begin(); itr != ptr->mSubDir.end(); ++itr) {
@@ -398,11 +449,117 @@ bool CheckPointManager::DumpCheckPointToLocal() {
     }
     LOG_DEBUG(sLogger,
               ("dump checkpoint, version", INT32_FLAG(check_point_version))(
-                  "file check point", mDevInodeCheckPointPtrMap.size())("dir check point", mDirNameMap.size()));
+                  "file check point", checkPoints.size())("dir check point", dirs.size()));
 
     return true;
 }
 
+CheckPointStore* CheckPointManager::GetCheckPointStore() {
+    if (mCheckPointStore == nullptr) {
+        mCheckPointStore.reset(new CheckPointStore(AppConfig::GetInstance()->GetCheckPointFilePath() + "_store"));
+    }
+    return mCheckPointStore.get();
+}
+
+bool CheckPointManager::LoadCheckPointFromStore() {
+    CheckPointStore::EntryList entries;
+    if (!GetCheckPointStore()->Load(entries) || entries.empty()) {
+        return false;
+    }
+    mLoadVersion = INT32_FLAG(check_point_version);
+    int32_t fileCount = 0;
+    for (const auto& entry : entries) {
+        const string& key = entry.first;
+        if (key.size() > 1 && key[0] == 'f') {
+            FileCheckpointPB pb;
+            if (!pb.ParseFromString(entry.second)) {
+                LOG_WARNING(sLogger, ("failed to parse file checkpoint in store, discard it", key));
+                continue;
+            }
+            DevInode devInode(pb.dev(), pb.inode());
+            if (!devInode.IsValid()) {
+                LOG_WARNING(sLogger, ("can not find check point dev inode, discard it", pb.file_name()));
+                continue;
+            }
+            CheckPoint* ptr = new CheckPoint(pb.file_name(),
+                                             pb.offset(),
+                                             pb.sig_size(),
+                                             pb.sig_hash(),
+                                             devInode,
+                                             pb.config_name(),
+                                             pb.real_file_name(),
+                                             pb.file_open());
+            ptr->mLastUpdateTime = pb.update_time();
+            AddCheckPoint(ptr);
+            ++fileCount;
+        } else if (key.size() > 1 && key[0] == 'd') {
+            DirCheckpointPB pb;
+            if (!pb.ParseFromString(entry.second)) {
+                LOG_WARNING(sLogger, ("failed to parse dir checkpoint in store, discard it", key));
+                continue;
+            }
+            const string dirname = key.substr(1);
+            if (pb.update_time() < (time(NULL) - INT32_FLAG(file_check_point_time_out))) {
+                LOG_INFO(sLogger,
+                         ("load timeout dir check point, ignore", dirname)(ToString(pb.update_time()), time(NULL)));
+                continue;
+            }
+            DirCheckPoint* dir = new DirCheckPoint(dirname);
+            for (int i = 0; i < pb.sub_dir_size(); ++i) {
+                dir->mSubDir.insert(pb.sub_dir(i));
+            }
+            mDirNameMap.insert(make_pair(dirname, DirCheckPointPtr(dir)));
+        }
+    }
+    mReaderCount = fileCount;
+    LOG_INFO(sLogger,
+             ("load checkpoint from store", GetCheckPointStore()->GetPath())(
+                 "file check point", mDevInodeCheckPointPtrMap.size())("dir check point", mDirNameMap.size()));
+    return true;
+}
+
+bool CheckPointManager::DumpCheckPointToStore(const vector<const CheckPoint*>& checkPoints,
+                                              const DirCheckPointMap& dirs) {
+    CheckPointStore::EntryList entries;
+    entries.reserve(checkPoints.size() + dirs.size());
+    FileCheckpointPB filePB;
+    for (const CheckPoint* checkPointPtr : checkPoints) {
+        filePB.Clear();
+        filePB.set_file_name(checkPointPtr->mFileName);
+        filePB.set_real_file_name(checkPointPtr->mRealFileName);
+        filePB.set_offset(checkPointPtr->mOffset);
+        filePB.set_sig_size(checkPointPtr->mSignatureSize);
+        filePB.set_sig_hash(checkPointPtr->mSignatureHash);
+        filePB.set_update_time(checkPointPtr->mLastUpdateTime);
+        filePB.set_dev(checkPointPtr->mDevInode.dev);
+        filePB.set_inode(checkPointPtr->mDevInode.inode);
+        filePB.set_file_open(checkPointPtr->mFileOpenFlag);
+        filePB.set_config_name(checkPointPtr->mConfigName);
+        // The same key as the one in json checkpoint file, with a prefix.
+        entries.emplace_back("f" + checkPointPtr->mFileName + "*" + ToString(checkPointPtr->mDevInode.dev) + "*"
+                                 + ToString(checkPointPtr->mDevInode.inode) + "*" + checkPointPtr->mConfigName,
+                             filePB.SerializeAsString());
+    }
+    DirCheckpointPB dirPB;
+    for (auto it = dirs.begin(); it != dirs.end(); ++it) {
+        dirPB.Clear();
+        dirPB.set_update_time(it->second->mUpdateTime);
+        for (const auto& subDir : it->second->mSubDir) {
+            dirPB.add_sub_dir(subDir);
+        }
+        entries.emplace_back("d" + it->first, dirPB.SerializeAsString());
+    }
+
+    size_t writeCount = 0;
+    if (!GetCheckPointStore()->Dump(entries, &writeCount)) {
+        return false;
+    }
+    LOG_DEBUG(sLogger,
+              ("dump checkpoint to store, file check point", checkPoints.size())("dir check point", dirs.size())(
+                  "written", writeCount));
+    return true;
+}
+
 int32_t CheckPointManager::GetReaderCount() {
     return mReaderCount;
 }
@@ -444,6 +601,7 @@ void CheckPointManager::CheckTimeoutCheckPoint() {
 
 void CheckPointManager::RemoveAllCheckPoint() {
     mDirNameMap.clear();
+    ScopedSpinLock lock(mCheckPointLock);
     mDevInodeCheckPointPtrMap.clear();
 }
 
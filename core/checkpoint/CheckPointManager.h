@@ -15,8 +15,12 @@
  */
 
 #pragma once
+#include <atomic>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <unordered_map>
 #include <set>
 #include <ctime>
@@ -24,7 +28,9 @@
 #include <boost/optional.hpp>
 #include "common/DevInode.h"
 #include "common/EncodingConverter.h"
+#include "common/Lock.h"
 #include "common/SplitedFilePath.h"
+#include "CheckPointStore.h"
 
 #ifdef APSARA_UNIT_TEST_MAIN
 #include "AppConfig.h"
@@ -77,6 +83,7 @@ public:
 
 typedef std::shared_ptr<DirCheckPoint> DirCheckPointPtr;
 typedef std::shared_ptr<CheckPoint> CheckPointPtr;
+typedef std::unordered_map<std::string, DirCheckPointPtr> DirCheckPointMap;
 
 class CheckPointManager {
 public:
@@ -102,13 +109,41 @@ public:
 
 private:
     DevInodeCheckPointHashMap mDevInodeCheckPointPtrMap;
-    std::unordered_map<std::string, DirCheckPointPtr> mDirNameMap;
+    // Protects mDevInodeCheckPointPtrMap in Add/Delete/GetCheckPoint, which are called by readers
+    // on threads of ShardedEventProcessor. Others are called when event handling is paused.
+    SpinLock mCheckPointLock;
+    DirCheckPointMap mDirNameMap;
     int32_t mLastCheckTime;
     int32_t mLastDumpTime;
     int32_t mLoadVersion;
-    int32_t mReaderCount;
+    std::atomic<int32_t> mReaderCount;
+    // Created when check_point_store_enable is on.
+    std::unique_ptr<CheckPointStore> mCheckPointStore;
+    // Serializes writes of the checkpoint file or store, snapshots are written by mSnapshotDumpThread.
+    std::mutex mDumpMutex;
+    std::thread mSnapshotDumpThread;
+    std::atomic_bool mSnapshotDumping{false};
     CheckPointManager()
         : mLastCheckTime(time(NULL)), mLastDumpTime(time(NULL)), mLoadVersion(NO_CHECKPOINT_VERSION), mReaderCount(0) {}
+    ~CheckPointManager() {
+        if (mSnapshotDumpThread.joinable()) {
+            mSnapshotDumpThread.join();
+        }
+    }
+
+    CheckPointStore* GetCheckPointStore();
+    // LoadCheckPointFromStore returns false if no checkpoint store or it is empty.
+    bool LoadCheckPointFromStore();
+    // DumpCheckPointToStore writes changed checkpoints to checkpoint store instead of
+    // rewriting the json checkpoint file.
+    bool DumpCheckPointToStore(const std::vector<const CheckPoint*>& checkPoints, const DirCheckPointMap& dirs);
+    // WriteCheckPoints writes @checkPoints and @dirs to the checkpoint file or store, only the latest
+    // check_point_max_count checkpoints are kept if there are more.
+    bool WriteCheckPoints(std::vector<const CheckPoint*>& checkPoints, const DirCheckPointMap& dirs);
+    // DumpCheckPointSnapshot writes checkpoints in CheckPointSnapshotTable, along with loaded ones not
+    // taken by readers yet.
+    bool DumpCheckPointSnapshot();
+    static void AddDirCheckPoint(DirCheckPointMap& dirs, const std::string& dirname);
 
 public:
     bool CheckVersion();
@@ -120,6 +155,9 @@ public:
     void LoadDirCheckPoint(const Json::Value& root);
     void LoadFileCheckPoint(const Json::Value& root);
     bool DumpCheckPointToLocal();
+    // StartDumpCheckPointSnapshot dumps checkpoints published to CheckPointSnapshotTable on another thread,
+    // so event handling is not held on. Returns false if the last one is not finished.
+    bool StartDumpCheckPointSnapshot();
     int32_t GetReaderCount();
     bool GetCheckPoint(DevInode devInode, const std::string& configName, CheckPointPtr& checkPointPtr);
     bool GetDirCheckPoint(const std::string& filename, DirCheckPointPtr& checkPointPtr);
@@ -0,0 +1,85 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CheckPointSnapshot.h"
+#include <functional>
+
+namespace logtail {
+
+CheckPointSnapshotTable::Slot::Slot() {
+    CheckPointSnapshotTable::GetInstance()->Register(this);
+}
+
+CheckPointSnapshotTable::Slot::~Slot() {
+    CheckPointSnapshotTable::GetInstance()->Unregister(this);
+}
+
+CheckPointSnapshotTable::Shard& CheckPointSnapshotTable::GetShard(const Slot* slot) {
+    return mShards[std::hash<const Slot*>()(slot) % kShardCount];
+}
+
+void CheckPointSnapshotTable::Register(const Slot* slot) {
+    Shard& shard = GetShard(slot);
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+    shard.mSlots.insert(slot);
+}
+
+void CheckPointSnapshotTable::Unregister(const Slot* slot) {
+    Shard& shard = GetShard(slot);
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+    shard.mSlots.erase(slot);
+}
+
+void CheckPointSnapshotTable::AddDir(int wd, const std::string& path) {
+    std::lock_guard<std::mutex> lock(mDirMutex);
+    mDirs[wd] = path;
+}
+
+void CheckPointSnapshotTable::RemoveDir(int wd) {
+    std::lock_guard<std::mutex> lock(mDirMutex);
+    mDirs.erase(wd);
+}
+
+void CheckPointSnapshotTable::ClearDirs() {
+    std::lock_guard<std::mutex> lock(mDirMutex);
+    mDirs.clear();
+}
+
+void CheckPointSnapshotTable::Collect(std::vector<CheckPointSnapshot>& checkPoints, std::vector<std::string>& dirs) {
+    for (Shard& shard : mShards) {
+        // Slots can not be destroyed while their shard is locked.
+        std::lock_guard<std::mutex> lock(shard.mMutex);
+        for (const Slot* slot : shard.mSlots) {
+            CheckPointSnapshot checkPoint = slot->Get();
+            if (checkPoint) {
+                checkPoints.push_back(std::move(checkPoint));
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(mDirMutex);
+    for (const auto& item : mDirs) {
+        dirs.push_back(item.second);
+    }
+}
+
+size_t CheckPointSnapshotTable::GetSlotCount() {
+    size_t count = 0;
+    for (Shard& shard : mShards) {
+        std::lock_guard<std::mutex> lock(shard.mMutex);
+        count += shard.mSlots.size();
+    }
+    return count;
+}
+
+} // namespace logtail
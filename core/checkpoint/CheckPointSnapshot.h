@@ -0,0 +1,91 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "CheckPointManager.h"
+
+namespace logtail {
+
+// CheckPointSnapshotTable keeps the last checkpoint published by each reader and the dirs watched by the
+// dispatcher, so checkpoints can be dumped by another thread without holding on event handling.
+//
+// A reader publishes an immutable checkpoint into its slot by an atomic store, which never waits for the
+// dumping thread. The table is only locked when slots are created or destroyed and when slots are
+// collected, it is sharded so that collecting one shard does not block readers created in others.
+class CheckPointSnapshotTable {
+public:
+    typedef std::shared_ptr<const CheckPoint> CheckPointSnapshot;
+
+    // Slot is registered in the table while it is alive, it is neither copyable nor movable.
+    class Slot {
+    public:
+        Slot();
+        ~Slot();
+        Slot(const Slot&) = delete;
+        Slot& operator=(const Slot&) = delete;
+
+        void Publish(const CheckPointSnapshot& checkPoint) { std::atomic_store(&mCheckPoint, checkPoint); }
+        CheckPointSnapshot Get() const { return std::atomic_load(&mCheckPoint); }
+
+    private:
+        CheckPointSnapshot mCheckPoint;
+    };
+
+    static CheckPointSnapshotTable* GetInstance() {
+        static CheckPointSnapshotTable* sInstance = new CheckPointSnapshotTable;
+        return sInstance;
+    }
+
+    void AddDir(int wd, const std::string& path);
+    void RemoveDir(int wd);
+    void ClearDirs();
+
+    // Collect appends checkpoints published by all slots to @checkPoints and paths of watched dirs to @dirs.
+    void Collect(std::vector<CheckPointSnapshot>& checkPoints, std::vector<std::string>& dirs);
+
+    size_t GetSlotCount();
+
+private:
+    static const size_t kShardCount = 16;
+
+    struct Shard {
+        std::mutex mMutex;
+        std::unordered_set<const Slot*> mSlots;
+    };
+
+    CheckPointSnapshotTable() = default;
+
+    Shard& GetShard(const Slot* slot);
+    void Register(const Slot* slot);
+    void Unregister(const Slot* slot);
+
+    Shard mShards[kShardCount];
+    std::mutex mDirMutex;
+    std::unordered_map<int, std::string> mDirs;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class CheckPointSnapshotUnittest;
+#endif
+};
+
+} // namespace logtail
@@ -0,0 +1,112 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CheckPointStore.h"
+#include <memory>
+#include <leveldb/db.h>
+#include <leveldb/write_batch.h>
+#include "common/HashUtil.h"
+#include "logger/Logger.h"
+#include "profiler/LogtailAlarm.h"
+
+namespace logtail {
+
+CheckPointStore::CheckPointStore(const std::string& path) : mPath(path) {
+}
+
+CheckPointStore::~CheckPointStore() {
+    delete mDatabase;
+}
+
+bool CheckPointStore::Open() {
+    if (mDatabase != nullptr) {
+        return true;
+    }
+    leveldb::Options options;
+    options.create_if_missing = true;
+    leveldb::Status status = leveldb::DB::Open(options, mPath, &mDatabase);
+    if (!status.ok()) {
+        LOG_ERROR(sLogger, ("open check point store error", mPath)("status", status.ToString()));
+        LogtailAlarm::GetInstance()->SendAlarm(CHECKPOINT_ALARM,
+                                               "open check point store failed: " + status.ToString());
+        mDatabase = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool CheckPointStore::Load(EntryList& entries) {
+    if (!Open()) {
+        return false;
+    }
+    mDumpedHashes.clear();
+    std::unique_ptr<leveldb::Iterator> iter(mDatabase->NewIterator(leveldb::ReadOptions()));
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        entries.emplace_back(iter->key().ToString(), iter->value().ToString());
+        mDumpedHashes[entries.back().first] = HashValue(entries.back().second);
+    }
+    if (!iter->status().ok()) {
+        LOG_ERROR(sLogger, ("load check point store error", mPath)("status", iter->status().ToString()));
+        LogtailAlarm::GetInstance()->SendAlarm(CHECKPOINT_ALARM,
+                                               "load check point store failed: " + iter->status().ToString());
+        return false;
+    }
+    return true;
+}
+
+bool CheckPointStore::Dump(const EntryList& entries, size_t* writeCount) {
+    if (!Open()) {
+        return false;
+    }
+    leveldb::WriteBatch batch;
+    size_t count = 0;
+    std::unordered_map<std::string, uint64_t> dumpedHashes;
+    dumpedHashes.reserve(entries.size());
+    for (const auto& entry : entries) {
+        const uint64_t hash = HashValue(entry.second);
+        auto iter = mDumpedHashes.find(entry.first);
+        if (iter == mDumpedHashes.end() || iter->second != hash) {
+            batch.Put(entry.first, entry.second);
+            ++count;
+        }
+        dumpedHashes[entry.first] = hash;
+    }
+    for (const auto& dumped : mDumpedHashes) {
+        if (dumpedHashes.find(dumped.first) == dumpedHashes.end()) {
+            batch.Delete(dumped.first);
+            ++count;
+        }
+    }
+    if (count > 0) {
+        leveldb::Status status = mDatabase->Write(leveldb::WriteOptions(), &batch);
+        if (!status.ok()) {
+            LOG_ERROR(sLogger, ("dump check point store error", mPath)("status", status.ToString()));
+            LogtailAlarm::GetInstance()->SendAlarm(CHECKPOINT_ALARM,
+                                                   "dump check point store failed: " + status.ToString());
+            // A batch is applied atomically, the database is the same as last dump.
+            return false;
+        }
+    }
+    mDumpedHashes.swap(dumpedHashes);
+    if (writeCount != nullptr) {
+        *writeCount = count;
+    }
+    return true;
+}
+
+uint64_t CheckPointStore::HashValue(const std::string& value) {
+    return static_cast<uint64_t>(HashSignatureString(value.data(), value.size()));
+}
+
+} // namespace logtail
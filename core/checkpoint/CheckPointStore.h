@@ -0,0 +1,68 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace leveldb {
+class DB;
+}
+
+namespace logtail {
+
+// CheckPointStore keeps key-value entries of v1 checkpoints in a leveldb database.
+//
+// Dump makes the database hold exactly the given entries, but only writes entries whose
+// value changed since the last Load or Dump and deletes entries not given any more, so
+// the cost of disk writes is proportional to the count of changed checkpoints. Values
+// written are remembered by their hashes.
+//
+// Not thread safe, it is used in CheckPointManager when LogInput is held on.
+class CheckPointStore {
+public:
+    typedef std::vector<std::pair<std::string, std::string>> EntryList;
+
+    explicit CheckPointStore(const std::string& path);
+    ~CheckPointStore();
+
+    CheckPointStore(const CheckPointStore&) = delete;
+    CheckPointStore& operator=(const CheckPointStore&) = delete;
+
+    bool Open();
+    bool IsOpened() const { return mDatabase != nullptr; }
+
+    // Load reads all entries in database to @entries.
+    bool Load(EntryList& entries);
+
+    // Dump updates database to hold exactly @entries.
+    // @writeCount [out]: count of entries put or deleted, if not nullptr.
+    bool Dump(const EntryList& entries, size_t* writeCount = nullptr);
+
+    const std::string& GetPath() const { return mPath; }
+
+private:
+    static uint64_t HashValue(const std::string& value);
+
+    const std::string mPath;
+    leveldb::DB* mDatabase = nullptr;
+    std::unordered_map<std::string, uint64_t> mDumpedHashes;
+};
+
+} // namespace logtail
@@ -17,6 +17,7 @@
 #include <boost/filesystem.hpp>
 #include "common/Flags.h"
 #include "common/ScopeInvoker.h"
+#include "common/StartupTimeline.h"
 #include "common/TimeUtil.h"
 #include "logger/Logger.h"
 #include "profiler/LogtailAlarm.h"
@@ -30,6 +31,19 @@ DEFINE_FLAG_INT32(logtail_checkpoint_gc_threshold_sec, "30 minutes", 30 * 60);
 DEFINE_FLAG_DOUBLE(logtail_checkpoint_max_gc_count_ratio_per_round, "10%", 0.1);
 DEFINE_FLAG_INT64(logtail_checkpoint_max_used_time_per_round_in_msec, "500ms", 500);
 DEFINE_FLAG_INT32(logtail_checkpoint_expired_threshold_sec, "6 hours", 6 * 60 * 60);
+DEFINE_FLAG_INT32(logtail_checkpoint_write_batch_interval_ms,
+                  "combine checkpoint writes and flush them in one batch every interval, 0 means write at once",
+                  0);
+DEFINE_FLAG_INT32(logtail_checkpoint_write_batch_max_count, "flush at once when pending checkpoint writes reach", 4096);
+DEFINE_FLAG_INT32(logtail_checkpoint_bloom_filter_bits, "bits per key of bloom filter, 0 means no filter", 10);
+DEFINE_FLAG_INT32(logtail_checkpoint_block_cache_size_mb, "block cache of checkpoint database, MB", 8);
+DEFINE_FLAG_INT32(logtail_checkpoint_compact_min_delete_count,
+                  "compact checkpoint database when keys deleted since last compaction reach, 0 means never",
+                  4096);
+DEFINE_FLAG_INT32(logtail_checkpoint_compact_idle_write_count,
+                  "checkpoint database is idle if fewer keys are written in a GC round",
+                  256);
+DEFINE_FLAG_INT32(logtail_checkpoint_compact_min_interval_sec, "min interval of checkpoint database compaction", 3600);
 
 namespace logtail {
 
@@ -97,6 +111,9 @@ CheckpointManagerV2::CheckpointManagerV2() {
 
     if (open()) {
         mGCThreadPtr.reset(new std::thread([&]() { runGCLoop(); }));
+        if (INT32_FLAG(logtail_checkpoint_write_batch_interval_ms) > 0) {
+            mFlushThreadPtr.reset(new std::thread([&]() { runFlushLoop(); }));
+        }
     }
 }
 
@@ -106,6 +123,17 @@ CheckpointManagerV2::~CheckpointManagerV2() {
         mGCThreadPtr->join();
         mGCThreadPtr.reset();
     }
+    if (mFlushThreadPtr) {
+        {
+            std::lock_guard<std::mutex> lock(mPendingMutex);
+            mStopFlushThread = true;
+        }
+        mFlushCond.notify_all();
+        mFlushThreadPtr->join();
+        // Keep isWriteCombined true until the last flush is done.
+        Flush();
+        mFlushThreadPtr.reset();
+    }
 
     close();
 }
@@ -137,6 +165,8 @@ int64_t CheckpointManagerV2::scanCheckpoints(const std::vector<Config*>& exactly
         limitScanTimeInMs = 0;
     }
     shouldDeleteCptKeys.clear();
+    // Pending writes are not visible to the snapshot.
+    Flush();
 
     std::set<std::string> configNameSet;
     for (auto& cfg : exactlyOnceConfigs) {
@@ -145,6 +175,8 @@ int64_t CheckpointManagerV2::scanCheckpoints(const std::vector<Config*>& exactly
 
     leveldb::ReadOptions options;
     options.snapshot = mDatabase->GetSnapshot();
+    // Scanned blocks are read once, keep the cache for lookups of readers.
+    options.fill_cache = false;
     auto iter = mDatabase->NewIterator(options);
     ScopeInvoker invoker([&]() {
         delete iter;
@@ -307,9 +339,19 @@ uint64_t CheckpointManagerV2::DeleteCheckpoints(const std::vector<std::string>&
     for (auto& k : keys) {
         batch.Delete(k);
     }
+    // Hold the lock until written, so that a flush can not write dropped values after.
+    std::unique_lock<std::mutex> lock(mPendingMutex, std::defer_lock);
+    if (isWriteCombined()) {
+        lock.lock();
+        for (auto& k : keys) {
+            mPendingWrites.erase(k);
+        }
+    }
     auto status = mDatabase->Write(mDefaultWriteOption, &batch);
     auto const usedTimeInMs = GetCurrentTimeInMilliSeconds() - startTimeInMs;
     if (status.ok()) {
+        mWriteCount += keys.size();
+        mDeleteCountSinceCompact += keys.size();
         LOG_DEBUG(sLogger, ("delete checkpoints, count", keys.size()));
     } else {
         detail::logDatabaseError("batch_delete", std::to_string(keys.size()), status);
@@ -332,8 +374,16 @@ uint64_t CheckpointManagerV2::UpdatePrimaryCheckpoints(
         }
         batch.Put(key, data);
     }
+    std::unique_lock<std::mutex> lock(mPendingMutex, std::defer_lock);
+    if (isWriteCombined()) {
+        lock.lock();
+        for (auto& cptPair : checkpoints) {
+            mPendingWrites.erase(cptPair->first);
+        }
+    }
     auto status = mDatabase->Write(mDefaultWriteOption, &batch);
     if (status.ok()) {
+        mWriteCount += checkpoints.size();
         return GetCurrentTimeInMilliSeconds() - startTimeInMs;
     } else {
         detail::logDatabaseError("batch_update", std::to_string(checkpoints.size()), status);
@@ -354,12 +404,23 @@ uint64_t CheckpointManagerV2::DeletePrimaryCheckpoints(
 bool CheckpointManagerV2::open() {
     const auto databasePath = detail::getDatabasePath();
 #define METHOD_LOG_PATTERN ("path", databasePath)("method", "open")
+    StartupPhaseScope phase("checkpoint_v2_open");
     leveldb::Options options;
     options.create_if_missing = true;
+    if (INT32_FLAG(logtail_checkpoint_bloom_filter_bits) > 0) {
+        mFilterPolicy = leveldb::NewBloomFilterPolicy(INT32_FLAG(logtail_checkpoint_bloom_filter_bits));
+        options.filter_policy = mFilterPolicy;
+    }
+    if (INT32_FLAG(logtail_checkpoint_block_cache_size_mb) > 0) {
+        mBlockCache = leveldb::NewLRUCache(static_cast<size_t>(INT32_FLAG(logtail_checkpoint_block_cache_size_mb))
+                                           * 1024 * 1024);
+        options.block_cache = mBlockCache;
+    }
     leveldb::Status status = leveldb::DB::Open(options, databasePath, &mDatabase);
     if (!status.ok()) {
         detail::logDatabaseError("open", databasePath, status);
         mDatabase = nullptr;
+        close();
         return false;
     }
     LOG_DEBUG(sLogger, METHOD_LOG_PATTERN("checkpoint database opened", ""));
@@ -373,12 +434,26 @@ bool CheckpointManagerV2::close() {
         delete mDatabase;
         mDatabase = nullptr;
     }
+    // Used by database until it is deleted.
+    delete mBlockCache;
+    mBlockCache = nullptr;
+    delete mFilterPolicy;
+    mFilterPolicy = nullptr;
     return opened;
 }
 
 bool CheckpointManagerV2::readDatabase(const std::string& key, std::string& value) {
     ASSERT_LEVELDB_STATUS;
 
+    if (isWriteCombined()) {
+        std::lock_guard<std::mutex> lock(mPendingMutex);
+        auto iter = mPendingWrites.find(key);
+        if (iter != mPendingWrites.end()) {
+            value = iter->second;
+            return true;
+        }
+    }
+
     leveldb::Status s = mDatabase->Get(leveldb::ReadOptions(), key, &value);
     if (s.ok()) {
         return true;
@@ -411,8 +486,22 @@ bool CheckpointManagerV2::read(const std::string& key, std::string& value) {
 bool CheckpointManagerV2::write(const std::string& key, const std::string& value) {
     ASSERT_LEVELDB_STATUS;
 
+    if (isWriteCombined()) {
+        size_t pendingCount = 0;
+        {
+            std::lock_guard<std::mutex> lock(mPendingMutex);
+            mPendingWrites[key] = value;
+            pendingCount = mPendingWrites.size();
+        }
+        if (pendingCount >= static_cast<size_t>(INT32_FLAG(logtail_checkpoint_write_batch_max_count))) {
+            mFlushCond.notify_one();
+        }
+        return true;
+    }
+
     leveldb::Status s = mDatabase->Put(mDefaultWriteOption, key, value);
     if (s.ok()) {
+        ++mWriteCount;
         return true;
     }
     detail::logDatabaseError("write", key, s);
@@ -436,6 +525,7 @@ void CheckpointManagerV2::checkGCItems() {
     int32_t deletedCount = 0;
 
     PrimaryCheckpointPB cpt;
+    // Keys of all checkpoints collected in this round are deleted in one batch.
     std::vector<std::string> keys;
     std::lock_guard<std::mutex> lock(mMutex);
     const int32_t maxDeleteCount
@@ -464,15 +554,40 @@ void CheckpointManagerV2::checkGCItems() {
                 break;
             }
 
-            keys.clear();
-            keys.reserve(1 + cpt.concurrency());
             appendCheckpointKeys(key, cpt.concurrency(), keys);
-            DeleteCheckpoints(keys);
             LOG_INFO(sLogger, ("GC checkpoint", key)("time", curTime - createTime)("checkpoint", cpt.DebugString()));
             ++deletedCount;
         } while (0);
         iter = mGCItems.erase(iter);
     }
+    if (!keys.empty()) {
+        auto deleteUsedTimeInMs = DeleteCheckpoints(keys);
+        LOG_DEBUG(sLogger,
+                  ("GC checkpoints, count", deletedCount)("key count", keys.size())("delete used time",
+                                                                                    deleteUsedTimeInMs));
+    }
+}
+
+bool CheckpointManagerV2::compactIfIdle(time_t curTime) {
+    const uint64_t writeCount = mWriteCount.load();
+    const uint64_t roundWriteCount = writeCount - mLastCompactCheckWriteCount;
+    mLastCompactCheckWriteCount = writeCount;
+    if (INT32_FLAG(logtail_checkpoint_compact_min_delete_count) <= 0
+        || mDeleteCountSinceCompact.load()
+            < static_cast<uint64_t>(INT32_FLAG(logtail_checkpoint_compact_min_delete_count))
+        || roundWriteCount >= static_cast<uint64_t>(INT32_FLAG(logtail_checkpoint_compact_idle_write_count))
+        || curTime - mLastCompactTime < INT32_FLAG(logtail_checkpoint_compact_min_interval_sec)) {
+        return false;
+    }
+
+    auto const startTimeInMs = GetCurrentTimeInMilliSeconds();
+    const uint64_t deleteCount = mDeleteCountSinceCompact.exchange(0);
+    mDatabase->CompactRange(nullptr, nullptr);
+    mLastCompactTime = curTime;
+    LOG_INFO(sLogger,
+             ("compact checkpoint database, deleted keys", deleteCount)("round write count", roundWriteCount)(
+                 "used time", GetCurrentTimeInMilliSeconds() - startTimeInMs));
+    return true;
 }
 
 void CheckpointManagerV2::runGCLoop() {
@@ -494,10 +609,54 @@ void CheckpointManagerV2::runGCLoop() {
                      ("delete checkpoints", toDeleteCptKeys.size())("scan used time", scanUsedTimeInMs)(
                          "delete used time", deleteUsedTimeInMs));
         }
+
+        if (!mStopGCThread) {
+            compactIfIdle(time(NULL));
+        }
     }
     LOG_INFO(sLogger, ("runGCLoop exit", "done"));
 }
 
+void CheckpointManagerV2::Flush() {
+    if (nullptr == mDatabase || !isWriteCombined()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mPendingMutex);
+    flushUnlocked();
+}
+
+void CheckpointManagerV2::flushUnlocked() {
+    if (mPendingWrites.empty()) {
+        return;
+    }
+    leveldb::WriteBatch batch;
+    for (auto& item : mPendingWrites) {
+        batch.Put(item.first, item.second);
+    }
+    auto status = mDatabase->Write(mDefaultWriteOption, &batch);
+    if (!status.ok()) {
+        // Keep pending writes, retry next time.
+        detail::logDatabaseError("batch_flush", std::to_string(mPendingWrites.size()), status);
+        return;
+    }
+    LOG_DEBUG(sLogger, ("flush checkpoints, count", mPendingWrites.size()));
+    mWriteCount += mPendingWrites.size();
+    mPendingWrites.clear();
+}
+
+void CheckpointManagerV2::runFlushLoop() {
+    const auto interval = std::chrono::milliseconds(INT32_FLAG(logtail_checkpoint_write_batch_interval_ms));
+    std::unique_lock<std::mutex> lock(mPendingMutex);
+    while (!mStopFlushThread) {
+        mFlushCond.wait_for(lock, interval, [this]() {
+            return mStopFlushThread
+                || mPendingWrites.size() >= static_cast<size_t>(INT32_FLAG(logtail_checkpoint_write_batch_max_count));
+        });
+        flushUnlocked();
+    }
+    LOG_INFO(sLogger, ("runFlushLoop exit", "done"));
+}
+
 #ifdef APSARA_UNIT_TEST_MAIN
 void CheckpointManagerV2::rebuild() {
     bool opened = close();
@@ -15,13 +15,17 @@
  */
 
 #pragma once
+#include <atomic>
 #include <string>
 #include <unordered_map>
 #include <thread>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
 #include <vector>
+#include <leveldb/cache.h>
 #include <leveldb/db.h>
+#include <leveldb/filter_policy.h>
 #include "log_pb/checkpoint.pb.h"
 
 namespace logtail {
@@ -46,6 +50,12 @@ class Config;
 //  range checkpoints, that is why we call N concurrency.
 // - If order is import, the 1 primary checkpoint + N range checkpoints model downgrades
 //  to 1 primary + 1 range, ie. there is only one concurrency for the file.
+//
+// Storage layout: keys start with config name, and range keys are primary key plus
+//  suffix, so checkpoints of a config and of a file are adjacent in the database.
+//  Tables have bloom filters for point lookups of absent keys, blocks are cached in a
+//  sized LRU cache, and scans do not fill the cache. Compaction is run by GC thread
+//  when many keys are deleted and few writes happen, instead of after bursts of GC.
 class CheckpointManagerV2 {
 public:
     static std::string MakeRangeKey(const std::string& primaryKey, uint32_t idx);
@@ -119,6 +129,16 @@ public:
     // @return used time in milliseconds.
     uint64_t DeletePrimaryCheckpoints(const std::vector<std::pair<std::string, PrimaryCheckpointPB>*>& checkpoints);
 
+    // Flush writes combined checkpoint updates to database in one batch.
+    //
+    // If logtail_checkpoint_write_batch_interval_ms > 0, SetPB only updates the pending
+    //  write of the key in memory, reads see it at once, and a flush thread writes all
+    //  pending writes every interval, or once logtail_checkpoint_write_batch_max_count
+    //  keys are pending. So the database falls behind by at most one interval plus the
+    //  time of a write, which bounds the progress lost by an unexpected exit.
+    // Deletes and batch updates drop pending writes of their keys, scans flush first.
+    void Flush();
+
 private:
     CheckpointManagerV2();
     ~CheckpointManagerV2();
@@ -138,8 +158,22 @@ private:
     // Routine of GC thread.
     void runGCLoop();
 
+    // Routine of flush thread.
+    void runFlushLoop();
+
+    bool isWriteCombined() const { return mFlushThreadPtr != nullptr; }
+    // Called with mPendingMutex held.
+    void flushUnlocked();
+
     void checkGCItems();
 
+    // compactIfIdle compacts whole database if logtail_checkpoint_compact_min_delete_count keys
+    //  are deleted since last compaction and fewer than logtail_checkpoint_compact_idle_write_count
+    //  writes happened since last call, at most once per logtail_checkpoint_compact_min_interval_sec.
+    //
+    // @return true if compacted.
+    bool compactIfIdle(time_t curTime);
+
     // Scan whole database according to mode.
     //
     // Scan mode: full or partial.
@@ -168,8 +202,16 @@ private:
 private:
     std::string mDatabasePath;
     leveldb::DB* mDatabase = nullptr;
+    const leveldb::FilterPolicy* mFilterPolicy = nullptr;
+    leveldb::Cache* mBlockCache = nullptr;
     leveldb::WriteOptions mDefaultWriteOption;
 
+    // Counters for compactIfIdle, writes are counted by key.
+    std::atomic<uint64_t> mWriteCount{0};
+    std::atomic<uint64_t> mDeleteCountSinceCompact{0};
+    uint64_t mLastCompactCheckWriteCount = 0;
+    time_t mLastCompactTime = 0;
+
     volatile bool mStopGCThread = false;
     std::unique_ptr<std::thread> mGCThreadPtr;
     std::mutex mMutex;
@@ -177,6 +219,13 @@ private:
                        time_t /* create time */>
         mGCItems;
 
+    // Pending writes of SetPB, used when write is combined, key to value.
+    std::mutex mPendingMutex;
+    std::condition_variable mFlushCond;
+    std::unordered_map<std::string, std::string> mPendingWrites;
+    volatile bool mStopFlushThread = false;
+    std::unique_ptr<std::thread> mFlushThreadPtr;
+
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class CheckpointManagerV2Unittest;
     friend class ExactlyOnceReaderUnittest;
@@ -13,10 +13,46 @@
 // limitations under the License.
 
 #include "RangeCheckpoint.h"
+#include <algorithm>
 #include "CheckpointManagerV2.h"
 
 namespace logtail {
 
+void RangeCommitWatermark::Reset(uint64_t offset) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCommittedOffset = mDispatchedEnd = offset;
+    mAckedRanges.clear();
+}
+
+void RangeCommitWatermark::Dispatch(uint64_t offset, uint64_t length) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (offset < mDispatchedEnd) {
+        mCommittedOffset = offset;
+        mAckedRanges.clear();
+    } else if (offset > mDispatchedEnd) {
+        addAckedUnlocked(mDispatchedEnd, offset);
+    }
+    mDispatchedEnd = offset + length;
+}
+
+void RangeCommitWatermark::Ack(uint64_t offset, uint64_t length) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    addAckedUnlocked(offset, offset + length);
+}
+
+void RangeCommitWatermark::addAckedUnlocked(uint64_t offset, uint64_t end) {
+    if (end <= mCommittedOffset) {
+        return;
+    }
+    auto& rangeEnd = mAckedRanges[offset];
+    rangeEnd = std::max(rangeEnd, end);
+    auto iter = mAckedRanges.begin();
+    while (iter != mAckedRanges.end() && iter->first <= mCommittedOffset) {
+        mCommittedOffset = std::max(mCommittedOffset, iter->second);
+        iter = mAckedRanges.erase(iter);
+    }
+}
+
 void RangeCheckpoint::save() {
     static auto sCptM = CheckpointManagerV2::GetInstance();
     data.set_update_time(time(NULL));
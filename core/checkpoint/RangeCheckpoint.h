@@ -15,7 +15,10 @@
  */
 
 #pragma once
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "log_pb/checkpoint.pb.h"
@@ -24,6 +27,48 @@
 
 namespace logtail {
 
+// RangeCommitWatermark tracks the contiguous prefix of a file that has been acknowledged.
+//
+// Ranges of a file are sent concurrently and acknowledged out of order, the watermark only moves
+//  forward when all data before it has been acknowledged, so it is safe to resume from it.
+// Ranges of a file are dispatched to sender queue in file order (exactly once queue is bound
+//  to one process thread), so data skipped between two dispatched ranges, such as discarded
+//  lines, will never be sent and is treated as acknowledged.
+class RangeCommitWatermark {
+public:
+    explicit RangeCommitWatermark(uint64_t offset = 0) : mCommittedOffset(offset), mDispatchedEnd(offset) {}
+
+    // Reset drops all pending acks and restarts from @offset.
+    void Reset(uint64_t offset);
+
+    // Dispatch records a range bound to sender queue, called by Prepare. A range before the last one
+    //  means the file is read again, so it resets the watermark.
+    void Dispatch(uint64_t offset, uint64_t length);
+
+    // Ack records a range committed, called by Commit.
+    void Ack(uint64_t offset, uint64_t length);
+
+    uint64_t GetCommittedOffset() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mCommittedOffset;
+    }
+
+    // Count of acknowledged ranges waiting for earlier ones.
+    size_t GetPendingAckCount() const {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mAckedRanges.size();
+    }
+
+private:
+    void addAckedUnlocked(uint64_t offset, uint64_t end);
+
+    mutable std::mutex mMutex;
+    uint64_t mCommittedOffset;
+    uint64_t mDispatchedEnd;
+    // Acknowledged ranges after mCommittedOffset, offset to end.
+    std::map<uint64_t, uint64_t> mAckedRanges;
+};
+
 class RangeCheckpoint {
 public:
     size_t index;
@@ -31,16 +76,24 @@ public:
     LogstoreFeedBackKey fbKey;
     RangeCheckpointPB data;
     std::vector<std::pair<uint64_t, size_t>> positions;
+    // Shared by all range checkpoints of the file, nullptr if not tracked.
+    std::shared_ptr<RangeCommitWatermark> watermark;
 
     inline void Prepare() {
         positions.clear();
         data.set_committed(false);
         save();
+        if (watermark) {
+            watermark->Dispatch(data.read_offset(), data.read_length());
+        }
     }
 
     inline void Commit() {
         data.set_committed(true);
         save();
+        if (watermark) {
+            watermark->Ack(data.read_offset(), data.read_length());
+        }
     }
 
     inline void IncreaseSequenceID() { data.set_sequence_id(data.sequence_id() + 1); }
@@ -0,0 +1,269 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "BatchRead.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+// IORING_OP_READ comes with Linux 5.6 headers, as IORING_FEAT_RW_CUR_POS does.
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(IORING_FEAT_RW_CUR_POS)
+#define LOGTAIL_BATCH_READ_URING 1
+#endif
+#elif defined(_MSC_VER)
+#include <Windows.h>
+#endif
+
+namespace logtail {
+
+BatchRead::BatchRead(uint32_t queueDepth) : mQueueDepth(queueDepth > 0 ? queueDepth : 1) {
+    InitUring(mQueueDepth);
+}
+
+BatchRead::~BatchRead() {
+    DestroyUring();
+#if defined(_MSC_VER)
+    for (void* event : mEvents) {
+        CloseHandle(event);
+    }
+#endif
+}
+
+void BatchRead::Read(const std::vector<Request*>& requests) {
+    size_t begin = 0;
+    while (begin < requests.size()) {
+        size_t end = std::min(requests.size(), begin + mQueueDepth);
+        if (!ReadByOverlapped(requests, begin, end)) {
+            break;
+        }
+        begin = end;
+    }
+    while (mRingFd >= 0 && begin < requests.size()) {
+        size_t end = std::min(requests.size(), begin + mSqEntries);
+        if (!ReadByUring(requests, begin, end)) {
+            break;
+        }
+        begin = end;
+    }
+    for (; begin < requests.size(); ++begin) {
+        ReadByPread(*requests[begin]);
+    }
+}
+
+void BatchRead::ReadByPread(Request& request) {
+#if defined(__linux__)
+    while (true) {
+        ssize_t ret = pread(request.fd, request.buffer, request.size, request.offset);
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        request.result = ret < 0 ? -errno : ret;
+        return;
+    }
+#elif defined(_MSC_VER)
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.Offset = static_cast<DWORD>(request.offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(request.offset) >> 32);
+    DWORD nbytes = 0;
+    if ((ReadFile(request.handle, request.buffer, static_cast<DWORD>(request.size), NULL, &overlapped)
+         || GetLastError() == ERROR_IO_PENDING)
+        && GetOverlappedResult(request.handle, &overlapped, &nbytes, TRUE)) {
+        request.result = nbytes;
+    } else {
+        request.result = GetLastError() == ERROR_HANDLE_EOF ? 0 : -static_cast<int64_t>(GetLastError());
+    }
+#else
+    request.result = -ENOSYS;
+#endif
+}
+
+bool BatchRead::ReadByOverlapped(const std::vector<Request*>& requests, size_t begin, size_t end) {
+#if defined(_MSC_VER)
+    const size_t count = end - begin;
+    while (mEvents.size() < count) {
+        HANDLE event = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (event == NULL) {
+            return false;
+        }
+        mEvents.push_back(event);
+    }
+    // All reads are issued before any is waited for, each OVERLAPPED lives until its read completes.
+    std::vector<OVERLAPPED> overlapped(count);
+    std::vector<bool> issued(count, false);
+    for (size_t i = 0; i < count; ++i) {
+        Request& request = *requests[begin + i];
+        memset(&overlapped[i], 0, sizeof(OVERLAPPED));
+        overlapped[i].Offset = static_cast<DWORD>(request.offset);
+        overlapped[i].OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(request.offset) >> 32);
+        overlapped[i].hEvent = mEvents[i];
+        ResetEvent(mEvents[i]);
+        if (ReadFile(request.handle, request.buffer, static_cast<DWORD>(request.size), NULL, &overlapped[i])
+            || GetLastError() == ERROR_IO_PENDING) {
+            issued[i] = true;
+        } else {
+            request.result = GetLastError() == ERROR_HANDLE_EOF ? 0 : -static_cast<int64_t>(GetLastError());
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (!issued[i]) {
+            continue;
+        }
+        Request& request = *requests[begin + i];
+        DWORD nbytes = 0;
+        if (GetOverlappedResult(request.handle, &overlapped[i], &nbytes, TRUE)) {
+            request.result = nbytes;
+        } else {
+            request.result = GetLastError() == ERROR_HANDLE_EOF ? 0 : -static_cast<int64_t>(GetLastError());
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if defined(LOGTAIL_BATCH_READ_URING)
+
+bool BatchRead::InitUring(uint32_t queueDepth) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+    if (fd < 0) {
+        return false;
+    }
+    mRingFd = fd;
+    mSqEntries = params.sq_entries;
+    mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    mSqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    mSqRing = mmap(NULL, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    mCqRing = mmap(NULL, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    mSqes = mmap(NULL, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (mSqRing == MAP_FAILED || mCqRing == MAP_FAILED || mSqes == MAP_FAILED) {
+        DestroyUring();
+        return false;
+    }
+    char* sq = static_cast<char*>(mSqRing);
+    mSqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+    mSqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    mSqMask = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    mSqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(mCqRing);
+    mCqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    mCqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    mCqMask = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    mCqes = cq + params.cq_off.cqes;
+    return true;
+}
+
+void BatchRead::DestroyUring() {
+    if (mSqes != NULL && mSqes != MAP_FAILED) {
+        munmap(mSqes, mSqesSize);
+    }
+    if (mCqRing != NULL && mCqRing != MAP_FAILED) {
+        munmap(mCqRing, mCqRingSize);
+    }
+    if (mSqRing != NULL && mSqRing != MAP_FAILED) {
+        munmap(mSqRing, mSqRingSize);
+    }
+    mSqes = mCqRing = mSqRing = NULL;
+    if (mRingFd >= 0) {
+        // Requests in flight are cancelled by kernel when the ring is closed.
+        close(mRingFd);
+        mRingFd = -1;
+    }
+}
+
+bool BatchRead::ReadByUring(const std::vector<Request*>& requests, size_t begin, size_t end) {
+    struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(mSqes);
+    const uint32_t count = static_cast<uint32_t>(end - begin);
+    const uint32_t sqMask = *mSqMask;
+    const uint32_t sqTail = *mSqTail;
+    for (uint32_t i = 0; i < count; ++i) {
+        const Request& request = *requests[begin + i];
+        const uint32_t index = (sqTail + i) & sqMask;
+        struct io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = request.fd;
+        sqe->addr = reinterpret_cast<uint64_t>(request.buffer);
+        sqe->len = static_cast<uint32_t>(request.size);
+        sqe->off = static_cast<uint64_t>(request.offset);
+        sqe->user_data = i;
+        mSqArray[index] = index;
+    }
+    __atomic_store_n(mSqTail, sqTail + count, __ATOMIC_RELEASE);
+
+    bool rejected = false;
+    uint32_t submitted = 0;
+    uint32_t completed = 0;
+    const struct io_uring_cqe* cqes = static_cast<const struct io_uring_cqe*>(mCqes);
+    while (completed < count) {
+        int ret = static_cast<int>(syscall(
+            __NR_io_uring_enter, mRingFd, count - submitted, count - completed, IORING_ENTER_GETEVENTS, NULL, 0));
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Buffers of this batch might still be referenced by the ring, drop the ring.
+            DestroyUring();
+            return false;
+        }
+        submitted += static_cast<uint32_t>(ret);
+        uint32_t cqHead = *mCqHead;
+        const uint32_t cqTail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+        for (; cqHead != cqTail; ++cqHead, ++completed) {
+            const struct io_uring_cqe& cqe = cqes[cqHead & *mCqMask];
+            Request& request = *requests[begin + static_cast<size_t>(cqe.user_data)];
+            if (cqe.res == -EINVAL) {
+                // Kernels before Linux 5.6 reject IORING_OP_READ.
+                rejected = true;
+                ReadByPread(request);
+                continue;
+            }
+            request.result = cqe.res;
+        }
+        __atomic_store_n(mCqHead, cqHead, __ATOMIC_RELEASE);
+    }
+    if (rejected) {
+        DestroyUring();
+    }
+    return true;
+}
+
+#else
+
+bool BatchRead::InitUring(uint32_t queueDepth) {
+    return false;
+}
+
+void BatchRead::DestroyUring() {
+}
+
+bool BatchRead::ReadByUring(const std::vector<Request*>& requests, size_t begin, size_t end) {
+    return false;
+}
+
+#endif
+
+} // namespace logtail
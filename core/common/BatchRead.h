@@ -0,0 +1,91 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace logtail {
+
+// BatchRead reads ranges of many opened files with few system calls.
+//
+// On Linux with io_uring read support, the reads of a batch are submitted together through one io_uring
+// instance, and completions are reaped in the same system call. Otherwise, or if the kernel rejects the
+// requests, ranges are read one by one with pread.
+//
+// On Windows, overlapped reads of a batch are issued together, so reads of different files are in flight at
+// the same time, then each is waited for.
+//
+// A BatchRead is not thread safe, each thread should use its own.
+class BatchRead {
+public:
+    struct Request {
+        int fd = -1;
+        // The overlapped file HANDLE on Windows, where fd is not a real descriptor.
+        void* handle = nullptr;
+        char* buffer = nullptr;
+        size_t size = 0;
+        int64_t offset = 0;
+        // Bytes read, or -errno if the read fails.
+        int64_t result = 0;
+    };
+
+    // @queueDepth is the number of requests submitted at a time.
+    explicit BatchRead(uint32_t queueDepth = 256);
+    ~BatchRead();
+
+    BatchRead(const BatchRead&) = delete;
+    BatchRead& operator=(const BatchRead&) = delete;
+
+    // Read reads each of @requests and sets its result.
+    void Read(const std::vector<Request*>& requests);
+
+    bool IsUringEnabled() const { return mRingFd >= 0; }
+
+private:
+    bool InitUring(uint32_t queueDepth);
+    void DestroyUring();
+    // ReadByUring reads [@begin, @end) of @requests, returns false if io_uring does not work.
+    bool ReadByUring(const std::vector<Request*>& requests, size_t begin, size_t end);
+    static void ReadByPread(Request& request);
+    // ReadByOverlapped reads [@begin, @end) of @requests at once on Windows, returns false if not supported.
+    bool ReadByOverlapped(const std::vector<Request*>& requests, size_t begin, size_t end);
+
+    uint32_t mQueueDepth = 1;
+    // Manual reset events of overlapped reads on Windows, one for each request in flight.
+    std::vector<void*> mEvents;
+
+    int mRingFd = -1;
+    uint32_t mSqEntries = 0;
+    void* mSqRing = nullptr;
+    size_t mSqRingSize = 0;
+    void* mCqRing = nullptr;
+    size_t mCqRingSize = 0;
+    void* mSqes = nullptr;
+    size_t mSqesSize = 0;
+    // Offsets of ring fields, see io_uring_setup(2).
+    uint32_t* mSqHead = nullptr;
+    uint32_t* mSqTail = nullptr;
+    uint32_t* mSqMask = nullptr;
+    uint32_t* mSqArray = nullptr;
+    uint32_t* mCqHead = nullptr;
+    uint32_t* mCqTail = nullptr;
+    uint32_t* mCqMask = nullptr;
+    void* mCqes = nullptr;
+};
+
+} // namespace logtail
@@ -0,0 +1,223 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "BatchStat.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+// IORING_OP_STATX comes with Linux 5.6 headers, as IORING_FEAT_RW_CUR_POS does.
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(IORING_FEAT_RW_CUR_POS) \
+    && defined(STATX_BASIC_STATS)
+#define LOGTAIL_BATCH_STAT_URING 1
+#endif
+#endif
+
+namespace logtail {
+
+BatchStat::BatchStat(uint32_t queueDepth) {
+    InitUring(queueDepth > 0 ? queueDepth : 1);
+}
+
+BatchStat::~BatchStat() {
+    DestroyUring();
+}
+
+void BatchStat::Stat(const std::vector<std::string>& paths,
+                     std::vector<fsutil::PathStat>& stats,
+                     std::vector<int>& errnos) {
+    stats.resize(paths.size());
+    errnos.assign(paths.size(), 0);
+    size_t begin = 0;
+    while (mRingFd >= 0 && begin < paths.size()) {
+        size_t end = std::min(paths.size(), begin + mSqEntries);
+        if (!StatByUring(paths, begin, end, stats, errnos)) {
+            break;
+        }
+        begin = end;
+    }
+    for (; begin < paths.size(); ++begin) {
+        if (!fsutil::PathStat::stat(paths[begin], stats[begin])) {
+            errnos[begin] = errno != 0 ? errno : ENOENT;
+        }
+    }
+}
+
+#if defined(LOGTAIL_BATCH_STAT_URING)
+
+bool BatchStat::InitUring(uint32_t queueDepth) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+    if (fd < 0) {
+        return false;
+    }
+    mRingFd = fd;
+    mSqEntries = params.sq_entries;
+    mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    mSqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    mSqRing = mmap(NULL, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    mCqRing = mmap(NULL, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    mSqes = mmap(NULL, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (mSqRing == MAP_FAILED || mCqRing == MAP_FAILED || mSqes == MAP_FAILED) {
+        DestroyUring();
+        return false;
+    }
+    char* sq = static_cast<char*>(mSqRing);
+    mSqHead = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+    mSqTail = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    mSqMask = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    mSqArray = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(mCqRing);
+    mCqHead = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    mCqTail = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    mCqMask = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    mCqes = cq + params.cq_off.cqes;
+    mStatxBuffer.resize(sizeof(struct statx) * mSqEntries);
+    return true;
+}
+
+void BatchStat::DestroyUring() {
+    if (mSqes != NULL && mSqes != MAP_FAILED) {
+        munmap(mSqes, mSqesSize);
+    }
+    if (mCqRing != NULL && mCqRing != MAP_FAILED) {
+        munmap(mCqRing, mCqRingSize);
+    }
+    if (mSqRing != NULL && mSqRing != MAP_FAILED) {
+        munmap(mSqRing, mSqRingSize);
+    }
+    mSqes = mCqRing = mSqRing = NULL;
+    if (mRingFd >= 0) {
+        // Requests in flight are cancelled by kernel when the ring is closed.
+        close(mRingFd);
+        mRingFd = -1;
+    }
+}
+
+bool BatchStat::StatByUring(const std::vector<std::string>& paths,
+                            size_t begin,
+                            size_t end,
+                            std::vector<fsutil::PathStat>& stats,
+                            std::vector<int>& errnos) {
+    struct statx* results = reinterpret_cast<struct statx*>(mStatxBuffer.data());
+    struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(mSqes);
+    const uint32_t count = static_cast<uint32_t>(end - begin);
+    const uint32_t sqMask = *mSqMask;
+    const uint32_t sqTail = *mSqTail;
+    for (uint32_t i = 0; i < count; ++i) {
+        const uint32_t index = (sqTail + i) & sqMask;
+        struct io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_STATX;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64_t>(paths[begin + i].c_str());
+        sqe->len = STATX_BASIC_STATS;
+        sqe->off = reinterpret_cast<uint64_t>(&results[i]);
+        sqe->user_data = i;
+        mSqArray[index] = index;
+    }
+    __atomic_store_n(mSqTail, sqTail + count, __ATOMIC_RELEASE);
+
+    bool rejected = false;
+    uint32_t submitted = 0;
+    uint32_t completed = 0;
+    const struct io_uring_cqe* cqes = static_cast<const struct io_uring_cqe*>(mCqes);
+    while (completed < count) {
+        int ret = static_cast<int>(syscall(
+            __NR_io_uring_enter, mRingFd, count - submitted, count - completed, IORING_ENTER_GETEVENTS, NULL, 0));
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Buffers of this batch might still be referenced by the ring, drop the ring.
+            DestroyUring();
+            return false;
+        }
+        submitted += static_cast<uint32_t>(ret);
+        uint32_t cqHead = *mCqHead;
+        const uint32_t cqTail = __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE);
+        for (; cqHead != cqTail; ++cqHead, ++completed) {
+            const struct io_uring_cqe& cqe = cqes[cqHead & *mCqMask];
+            const size_t i = static_cast<size_t>(cqe.user_data);
+            if (cqe.res == -EINVAL) {
+                // Kernels before Linux 5.6 reject IORING_OP_STATX.
+                rejected = true;
+                errnos[begin + i] = fsutil::PathStat::stat(paths[begin + i], stats[begin + i]) ? 0 : errno;
+                continue;
+            }
+            if (cqe.res < 0) {
+                errnos[begin + i] = -cqe.res;
+                continue;
+            }
+            const struct statx& stx = results[i];
+            struct stat* st = stats[begin + i].GetRawStat();
+            memset(st, 0, sizeof(*st));
+            st->st_dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+            st->st_ino = stx.stx_ino;
+            st->st_mode = stx.stx_mode;
+            st->st_nlink = stx.stx_nlink;
+            st->st_uid = stx.stx_uid;
+            st->st_gid = stx.stx_gid;
+            st->st_rdev = makedev(stx.stx_rdev_major, stx.stx_rdev_minor);
+            st->st_size = stx.stx_size;
+            st->st_blksize = stx.stx_blksize;
+            st->st_blocks = stx.stx_blocks;
+            st->st_atim.tv_sec = stx.stx_atime.tv_sec;
+            st->st_atim.tv_nsec = stx.stx_atime.tv_nsec;
+            st->st_mtim.tv_sec = stx.stx_mtime.tv_sec;
+            st->st_mtim.tv_nsec = stx.stx_mtime.tv_nsec;
+            st->st_ctim.tv_sec = stx.stx_ctime.tv_sec;
+            st->st_ctim.tv_nsec = stx.stx_ctime.tv_nsec;
+        }
+        __atomic_store_n(mCqHead, cqHead, __ATOMIC_RELEASE);
+    }
+    if (rejected) {
+        DestroyUring();
+    }
+    return true;
+}
+
+#else
+
+bool BatchStat::InitUring(uint32_t queueDepth) {
+    return false;
+}
+
+void BatchStat::DestroyUring() {
+}
+
+bool BatchStat::StatByUring(const std::vector<std::string>& paths,
+                            size_t begin,
+                            size_t end,
+                            std::vector<fsutil::PathStat>& stats,
+                            std::vector<int>& errnos) {
+    return false;
+}
+
+#endif
+
+} // namespace logtail
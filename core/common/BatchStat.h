@@ -0,0 +1,78 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "common/FileSystemUtil.h"
+
+namespace logtail {
+
+// BatchStat stats many paths with few system calls.
+//
+// On Linux with io_uring statx support, the statx requests of a batch are submitted together through one
+// io_uring instance, and completions are reaped in the same system call. Otherwise, or if the kernel rejects
+// the requests, paths are stat'ed one by one as fsutil::PathStat::stat does.
+//
+// A BatchStat is not thread safe, each thread should use its own.
+class BatchStat {
+public:
+    // @queueDepth is the number of requests submitted at a time.
+    explicit BatchStat(uint32_t queueDepth = 256);
+    ~BatchStat();
+
+    BatchStat(const BatchStat&) = delete;
+    BatchStat& operator=(const BatchStat&) = delete;
+
+    // Stat stats each of @paths, and sets @stats[i] and @errnos[i] for @paths[i]: @errnos[i] is 0 if it
+    // succeeds, or the errno as fsutil::PathStat::stat sets.
+    void Stat(const std::vector<std::string>& paths, std::vector<fsutil::PathStat>& stats, std::vector<int>& errnos);
+
+    bool IsUringEnabled() const { return mRingFd >= 0; }
+
+private:
+    bool InitUring(uint32_t queueDepth);
+    void DestroyUring();
+    // StatByUring stats [@begin, @end) of @paths, returns false if io_uring does not work.
+    bool StatByUring(const std::vector<std::string>& paths,
+                     size_t begin,
+                     size_t end,
+                     std::vector<fsutil::PathStat>& stats,
+                     std::vector<int>& errnos);
+
+    int mRingFd = -1;
+    uint32_t mSqEntries = 0;
+    void* mSqRing = nullptr;
+    size_t mSqRingSize = 0;
+    void* mCqRing = nullptr;
+    size_t mCqRingSize = 0;
+    void* mSqes = nullptr;
+    size_t mSqesSize = 0;
+    // Offsets of ring fields, see io_uring_setup(2).
+    uint32_t* mSqHead = nullptr;
+    uint32_t* mSqTail = nullptr;
+    uint32_t* mSqMask = nullptr;
+    uint32_t* mSqArray = nullptr;
+    uint32_t* mCqHead = nullptr;
+    uint32_t* mCqTail = nullptr;
+    uint32_t* mCqMask = nullptr;
+    void* mCqes = nullptr;
+    // Buffer of statx results of a batch.
+    std::vector<char> mStatxBuffer;
+};
+
+} // namespace logtail
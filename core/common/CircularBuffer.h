@@ -15,111 +15,163 @@
  */
 
 #pragma once
+#include <unistd.h>
 #include <atomic>
-#include "MemoryBarrier.h"
+#include <cassert>
+#include <cstddef>
+#include <utility>
 #include "Semaphore.h"
 
 namespace logtail {
 
-template <class T, size_t N = 1000>
-class AbstractCircularBuffer {
-public:
-    virtual ~AbstractCircularBuffer() {}
-
-    virtual bool TryPushItem(const T&) = 0;
-    virtual void PushItem(const T&) = 0;
-    virtual bool TryPopItem(T&) = 0;
-    virtual void PopItem(T&) = 0;
-    virtual size_t GetItemNumber() = 0;
-};
+constexpr size_t RoundUpPowerOf2(size_t n, size_t size = 2) {
+    return size >= n ? size : RoundUpPowerOf2(n, size << 1);
+}
 
+// CircularBuffer is a lock-free ring for a single producer and a single consumer, use MpscRingQueue if there
+// are multiple producers.
+//
+// Capacity is N rounded up to the power of 2. Reader and writer positions only increase and are kept in
+// different cache lines, each side caches the position of the other side and reloads it only when the
+// buffer looks full (or empty), so the hot path touches no shared cache line except the item itself.
 template <class T, size_t N = 1000>
-class CircularBuffer : public AbstractCircularBuffer<T, N> {
+class CircularBuffer {
 public:
-    CircularBuffer() { mWriter = mReader = 0; }
-
-    bool TryPushItem(const T& item) {
-        size_t tmpWriter = mWriter;
-        size_t tmpReader = mReader;
-        size_t nextWriter = (tmpWriter + 1) % SIZE;
+    static const size_t CAPACITY = RoundUpPowerOf2(N);
 
-        // ensure we check the mReader *before* write the item into mData
-        ReadWriteBarrier();
+    CircularBuffer() = default;
+    CircularBuffer(const CircularBuffer&) = delete;
+    CircularBuffer& operator=(const CircularBuffer&) = delete;
 
-        if (nextWriter == tmpReader) {
-            // the buffer is full
+    bool TryPushItem(const T& item) {
+        size_t writer = mWriter.load(std::memory_order_relaxed);
+        if (!HasSpace(writer, 1)) {
             return false;
         }
+        mData[writer & MASK] = item;
+        mWriter.store(writer + 1, std::memory_order_release);
+        return true;
+    }
 
-        // cast off "volatile"
-        const_cast<T&>(mData[tmpWriter]) = item;
-
-        // ensure the item writes into mData *before* we update mWriter
-        WriteBarrier();
-
-        mWriter = nextWriter;
-        mItemNumber++;
+    // @item is moved only if it returns true.
+    bool TryPushItem(T&& item) {
+        size_t writer = mWriter.load(std::memory_order_relaxed);
+        if (!HasSpace(writer, 1)) {
+            return false;
+        }
+        mData[writer & MASK] = std::move(item);
+        mWriter.store(writer + 1, std::memory_order_release);
         return true;
     }
 
     void PushItem(const T& item) {
-        while (true) {
-            if (TryPushItem(item)) {
-                return;
-            }
+        while (!TryPushItem(item)) {
             usleep(SLEEP_TIME); // microseconds
         }
     }
 
-    bool TryPopItem(T& item) {
-        size_t tmpWriter = mWriter;
-        size_t tmpReader = mReader;
-
-        // ensure we check the mWriter *before* read the item from mData
-        ReadBarrier();
+    // PushBatch pushes the first items of @items as many as the buffer can hold, and returns the count pushed.
+    // The consumer sees the whole batch at once.
+    size_t PushBatch(const T* items, size_t count) {
+        size_t writer = mWriter.load(std::memory_order_relaxed);
+        if (count > CAPACITY) {
+            count = CAPACITY;
+        }
+        if (!HasSpace(writer, count)) {
+            // mReaderCache is reloaded by HasSpace.
+            count = CAPACITY - (writer - mReaderCache);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            mData[(writer + i) & MASK] = items[i];
+        }
+        if (count > 0) {
+            mWriter.store(writer + count, std::memory_order_release);
+        }
+        return count;
+    }
 
-        if (tmpWriter == tmpReader) {
-            // the buffer is empty
+    bool TryPopItem(T& item) {
+        size_t reader = mReader.load(std::memory_order_relaxed);
+        if (Available(reader, 1) == 0) {
             return false;
         }
-
-        // cast off "volatile"
-        item = const_cast<T&>(mData[tmpReader]);
-
-        // ensure we read the item *before* update mReader
-        ReadWriteBarrier();
-
-        size_t NextReader = (tmpReader + 1) % SIZE;
-        mReader = NextReader;
-        mItemNumber--;
+        // Moved out, so the slot does not hold resources until it is overwritten.
+        item = std::move(mData[reader & MASK]);
+        mReader.store(reader + 1, std::memory_order_release);
         return true;
     }
+
     void PopItem(T& item) {
-        while (true) {
-            if (TryPopItem(item)) {
-                return;
-            }
+        while (!TryPopItem(item)) {
             usleep(SLEEP_TIME); // microseconds
         }
     }
 
-    size_t GetItemNumber() { return mItemNumber; }
+    // PopBatch pops at most @maxCount items into @items, and returns the count popped.
+    size_t PopBatch(T* items, size_t maxCount) {
+        size_t reader = mReader.load(std::memory_order_relaxed);
+        size_t count = Available(reader, maxCount);
+        for (size_t i = 0; i < count; ++i) {
+            items[i] = std::move(mData[(reader + i) & MASK]);
+        }
+        if (count > 0) {
+            mReader.store(reader + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    // GetItemNumber can be called by any thread, the result may be stale.
+    size_t GetItemNumber() const {
+        // mReader is loaded first, it never passes the mWriter loaded later.
+        size_t reader = mReader.load(std::memory_order_acquire);
+        return mWriter.load(std::memory_order_acquire) - reader;
+    }
+
+    size_t Capacity() const { return CAPACITY; }
 
 private:
-    // Because we always "Keep One Item Open", the actually size should be N + 1
-    static const size_t SIZE = N + 1;
+    static const size_t MASK = CAPACITY - 1;
     static const int SLEEP_TIME = 10; // microsecond
-    volatile size_t mWriter;
-    volatile size_t mReader;
-    volatile T mData[SIZE];
-    std::atomic<size_t> mItemNumber;
+
+    // HasSpace is called by the producer, mReader is reloaded only when the cached one says no space.
+    bool HasSpace(size_t writer, size_t count) {
+        if (writer - mReaderCache + count <= CAPACITY) {
+            return true;
+        }
+        mReaderCache = mReader.load(std::memory_order_acquire);
+        return writer - mReaderCache + count <= CAPACITY;
+    }
+
+    // Available is called by the consumer and returns min(@maxCount, items ready).
+    size_t Available(size_t reader, size_t maxCount) {
+        if (mWriterCache - reader < maxCount) {
+            mWriterCache = mWriter.load(std::memory_order_acquire);
+        }
+        size_t count = mWriterCache - reader;
+        return count < maxCount ? count : maxCount;
+    }
+
+    // Written by the producer.
+    alignas(64) std::atomic<size_t> mWriter{0};
+    size_t mReaderCache = 0;
+    // Written by the consumer.
+    alignas(64) std::atomic<size_t> mReader{0};
+    size_t mWriterCache = 0;
+    alignas(64) T mData[CAPACITY];
 };
 
+template <class T, size_t N>
+const size_t CircularBuffer<T, N>::CAPACITY;
+
+// CircularBufferSem blocks on semaphores instead of sleeping, it holds at most N items. Batch APIs are not
+// exposed because semaphores count items one by one.
 template <class T, size_t N = 1000>
-class CircularBufferSem : public CircularBuffer<T, N> {
+class CircularBufferSem : private CircularBuffer<T, N> {
 public:
     CircularBufferSem() : mSemFull(N), mSemEmpty(0) {}
 
+    using CircularBuffer<T, N>::GetItemNumber;
+
     bool TryPushItem(const T& item) {
         if (CircularBuffer<T, N>::TryPushItem(item)) {
             mSemEmpty.Post();
@@ -159,4 +211,4 @@ private:
     Semaphore mSemEmpty;
 };
 
-} // namespace logtail
\ No newline at end of file
+} // namespace logtail
@@ -17,6 +17,7 @@
 #include <lz4/lz4.h>
 #include <zstd/zstd.h>
 #include <cstring>
+#include <memory>
 
 #include "log_pb/sls_logs.pb.h"
 
@@ -24,6 +25,145 @@ namespace logtail {
 
 const int32_t ZSTD_DEFAULT_LEVEL = 1;
 
+namespace {
+
+    // Output buffers larger than this are released after use.
+    const size_t kMaxKeptBufferSize = 16 * 1024 * 1024;
+
+    struct ZstdDCtxDeleter {
+        void operator()(ZSTD_DCtx* ctx) const { ZSTD_freeDCtx(ctx); }
+    };
+
+    // ZSTD_decompress allocates and initializes a new context for each call, which costs
+    // more than decompressing small packets.
+    ZSTD_DCtx* GetZstdDCtx() {
+        static thread_local std::unique_ptr<ZSTD_DCtx, ZstdDCtxDeleter> sDCtx(ZSTD_createDCtx());
+        return sDCtx.get();
+    }
+
+} // namespace
+
+Compressor::Compressor(sls_logs::SlsCompressType type, int32_t level) : mType(type), mLevel(level) {
+    switch (mType) {
+        case sls_logs::SLS_CMP_LZ4:
+            mLz4State.resize((LZ4_sizeofState() + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+            break;
+        case sls_logs::SLS_CMP_DEFLATE:
+            mDeflateStream = new z_stream;
+            memset(mDeflateStream, 0, sizeof(z_stream));
+            // Same as compress() of zlib.
+            if (deflateInit(mDeflateStream, Z_DEFAULT_COMPRESSION) != Z_OK) {
+                delete mDeflateStream;
+                mDeflateStream = NULL;
+            }
+            break;
+        case sls_logs::SLS_CMP_ZSTD:
+            mZstdCtx = ZSTD_createCCtx();
+            break;
+        default:
+            break;
+    }
+}
+
+Compressor::~Compressor() {
+    if (mZstdCtx != NULL) {
+        ZSTD_freeCCtx(mZstdCtx);
+    }
+    if (mDeflateStream != NULL) {
+        deflateEnd(mDeflateStream);
+        delete mDeflateStream;
+    }
+}
+
+bool Compressor::Compress(const char* src, uint32_t size, std::string& dst) {
+    if (mType == sls_logs::SLS_CMP_NONE) {
+        dst.assign(src, size);
+        return true;
+    }
+    size_t compressedSize = 0;
+    bool result = false;
+    try {
+        result = CompressToBuffer(src, size, compressedSize);
+    } catch (...) {
+    }
+    if (result) {
+        dst.assign(mBuffer.data(), compressedSize);
+    }
+    if (mBuffer.size() > kMaxKeptBufferSize) {
+        std::string().swap(mBuffer);
+    }
+    return result;
+}
+
+bool Compressor::CompressToBuffer(const char* src, uint32_t size, size_t& compressedSize) {
+    switch (mType) {
+        case sls_logs::SLS_CMP_LZ4: {
+            const int bound = LZ4_compressBound(size);
+            if (bound <= 0) {
+                return false;
+            }
+            if (mBuffer.size() < static_cast<size_t>(bound)) {
+                mBuffer.resize(bound);
+            }
+            const int length
+                = LZ4_compress_fast_extState(mLz4State.data(), src, &mBuffer[0], size, static_cast<int>(bound), 1);
+            if (length <= 0) {
+                return false;
+            }
+            compressedSize = length;
+            return true;
+        }
+        case sls_logs::SLS_CMP_DEFLATE: {
+            if (mDeflateStream == NULL || deflateReset(mDeflateStream) != Z_OK) {
+                return false;
+            }
+            const size_t bound = deflateBound(mDeflateStream, size);
+            if (mBuffer.size() < bound) {
+                mBuffer.resize(bound);
+            }
+            mDeflateStream->next_in = (Bytef*)src;
+            mDeflateStream->avail_in = size;
+            mDeflateStream->next_out = (Bytef*)&mBuffer[0];
+            mDeflateStream->avail_out = bound;
+            if (deflate(mDeflateStream, Z_FINISH) != Z_STREAM_END) {
+                return false;
+            }
+            compressedSize = mDeflateStream->total_out;
+            return true;
+        }
+        case sls_logs::SLS_CMP_ZSTD: {
+            if (mZstdCtx == NULL) {
+                return false;
+            }
+            const size_t bound = ZSTD_compressBound(size);
+            if (mBuffer.size() < bound) {
+                mBuffer.resize(bound);
+            }
+            const size_t length = ZSTD_compressCCtx(mZstdCtx, &mBuffer[0], bound, src, size, mLevel);
+            if (ZSTD_isError(length)) {
+                return false;
+            }
+            compressedSize = length;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+Compressor* GetThreadCompressor(sls_logs::SlsCompressType type, int32_t level) {
+    static thread_local std::unique_ptr<Compressor> sCompressors[sls_logs::SlsCompressType_ARRAYSIZE];
+    if (!sls_logs::SlsCompressType_IsValid(type)) {
+        return NULL;
+    }
+    std::unique_ptr<Compressor>& compressor = sCompressors[type];
+    if (!compressor) {
+        compressor.reset(new Compressor(type, level));
+    }
+    compressor->SetLevel(level);
+    return compressor.get();
+}
+
 bool UncompressData(sls_logs::SlsCompressType compressType,
                     const std::string& src,
                     uint32_t rawSize,
@@ -49,11 +189,9 @@ bool CompressData(sls_logs::SlsCompressType compressType, const std::string& src
             dst = src;
             return true;
         case sls_logs::SLS_CMP_LZ4:
-            return CompressLz4(src, dst);
         case sls_logs::SLS_CMP_DEFLATE:
-            return CompressDeflate(src, dst);
         case sls_logs::SLS_CMP_ZSTD:
-            return CompressZstd(src, dst, ZSTD_DEFAULT_LEVEL);
+            return GetThreadCompressor(compressType)->Compress(src, dst);
         default:
             return false;
     }
@@ -66,11 +204,9 @@ bool CompressData(sls_logs::SlsCompressType compressType, const char* src, uint3
             return true;
         }
         case sls_logs::SLS_CMP_LZ4:
-            return CompressLz4(src, size, dst);
         case sls_logs::SLS_CMP_DEFLATE:
-            return CompressDeflate(src, size, dst);
         case sls_logs::SLS_CMP_ZSTD:
-            return CompressZstd(src, size, dst, ZSTD_DEFAULT_LEVEL);
+            return GetThreadCompressor(compressType)->Compress(src, size, dst);
         default:
             return false;
     }
@@ -197,23 +333,11 @@ bool UncompressLz4(const char* srcPtr, const uint32_t srcSize, const uint32_t ra
     return true;
 }
 bool CompressDeflate(const char* srcPtr, const uint32_t srcSize, std::string& dst) {
-    int64_t dstLen = compressBound(srcSize);
-    dst.resize(dstLen);
-    if (compress((Bytef*)(dst.c_str()), (uLongf*)&dstLen, (const Bytef*)srcPtr, srcSize) == Z_OK) {
-        dst.resize(dstLen);
-        return true;
-    }
-    return false;
+    return GetThreadCompressor(sls_logs::SLS_CMP_DEFLATE)->Compress(srcPtr, srcSize, dst);
 }
 
 bool CompressDeflate(const std::string& src, std::string& dst) {
-    int64_t dstLen = compressBound(src.size());
-    dst.resize(dstLen);
-    if (compress((Bytef*)(dst.c_str()), (uLongf*)&dstLen, (const Bytef*)(src.c_str()), src.size()) == Z_OK) {
-        dst.resize(dstLen);
-        return true;
-    }
-    return false;
+    return CompressDeflate(src.c_str(), src.size(), dst);
 }
 
 bool UncompressDeflate(const char* srcPtr, const uint32_t srcSize, const int64_t rawSize, std::string& dst) {
@@ -238,18 +362,7 @@ bool UncompressLz4(const std::string& src, const uint32_t rawSize, std::string&
     return UncompressLz4(src.c_str(), src.length(), rawSize, dst);
 }
 bool CompressLz4(const char* srcPtr, const uint32_t srcSize, std::string& dst) {
-    uint32_t encodingSize = LZ4_compressBound(srcSize);
-    dst.resize(encodingSize);
-    char* compressed = const_cast<char*>(dst.c_str());
-    try {
-        encodingSize = LZ4_compress_default(srcPtr, compressed, srcSize, encodingSize);
-        if (encodingSize) {
-            dst.resize(encodingSize);
-            return true;
-        }
-    } catch (...) {
-    }
-    return false;
+    return GetThreadCompressor(sls_logs::SLS_CMP_LZ4)->Compress(srcPtr, srcSize, dst);
 }
 
 bool CompressLz4(const std::string& src, std::string& dst) {
@@ -265,7 +378,13 @@ bool UncompressZstd(const char* srcPtr, const uint32_t srcSize, const uint32_t r
     char* unCompressed = const_cast<char*>(dst.c_str());
     uint32_t length = 0;
     try {
-        length = ZSTD_decompress(unCompressed, rawSize, srcPtr, srcSize);
+        ZSTD_DCtx* ctx = GetZstdDCtx();
+        size_t const result = ctx != NULL ? ZSTD_decompressDCtx(ctx, unCompressed, rawSize, srcPtr, srcSize)
+                                          : ZSTD_decompress(unCompressed, rawSize, srcPtr, srcSize);
+        if (ZSTD_isError(result)) {
+            return false;
+        }
+        length = result;
     } catch (...) {
         return false;
     }
@@ -276,19 +395,7 @@ bool UncompressZstd(const char* srcPtr, const uint32_t srcSize, const uint32_t r
 }
 
 bool CompressZstd(const char* srcPtr, const uint32_t srcSize, std::string& dst, int32_t level) {
-    uint32_t encodingSize = ZSTD_compressBound(srcSize);
-    dst.resize(encodingSize);
-    char* compressed = const_cast<char*>(dst.c_str());
-    try {
-        size_t const cmp_size = ZSTD_compress(compressed, encodingSize, srcPtr, srcSize, level);
-        if (ZSTD_isError(cmp_size)) {
-            return false;
-        }
-        dst.resize(cmp_size);
-        return true;
-    } catch (...) {
-    }
-    return false;
+    return GetThreadCompressor(sls_logs::SLS_CMP_ZSTD, level)->Compress(srcPtr, srcSize, dst);
 }
 
 bool CompressZstd(const std::string& src, std::string& dst, int32_t level) {
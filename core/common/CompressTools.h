@@ -17,12 +17,48 @@
 #pragma once
 #include <string>
 #include <cstdint>
+#include <vector>
 #include "log_pb/sls_logs.pb.h"
 
+struct ZSTD_CCtx_s;
+struct z_stream_s;
+
 namespace logtail {
 
 extern const int32_t ZSTD_DEFAULT_LEVEL;
 
+// Compressor compresses data of one type, compression states and the output buffer are
+// reused across calls, so only the exactly sized result is allocated for each packet.
+// A Compressor must be used by one thread at a time, see GetThreadCompressor.
+class Compressor {
+public:
+    explicit Compressor(sls_logs::SlsCompressType type, int32_t level = ZSTD_DEFAULT_LEVEL);
+    ~Compressor();
+
+    bool Compress(const char* src, uint32_t size, std::string& dst);
+    bool Compress(const std::string& src, std::string& dst) { return Compress(src.data(), src.size(), dst); }
+
+    sls_logs::SlsCompressType GetType() const { return mType; }
+    void SetLevel(int32_t level) { mLevel = level; }
+
+private:
+    Compressor(const Compressor&) = delete;
+    Compressor& operator=(const Compressor&) = delete;
+
+    // CompressToBuffer compresses into mBuffer and sets @compressedSize.
+    bool CompressToBuffer(const char* src, uint32_t size, size_t& compressedSize);
+
+    const sls_logs::SlsCompressType mType;
+    int32_t mLevel;
+    std::string mBuffer;
+    ZSTD_CCtx_s* mZstdCtx = NULL;
+    std::vector<uint64_t> mLz4State;
+    z_stream_s* mDeflateStream = NULL;
+};
+
+// GetThreadCompressor returns the compressor of @type owned by current thread.
+Compressor* GetThreadCompressor(sls_logs::SlsCompressType type, int32_t level = ZSTD_DEFAULT_LEVEL);
+
 bool UncompressData(sls_logs::SlsCompressType compressType, const std::string& src, uint32_t rawSize, std::string& dst);
 
 bool CompressData(sls_logs::SlsCompressType compressType, const std::string& src, std::string& dst);
@@ -0,0 +1,63 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CpuQuotaTable.h"
+#include <algorithm>
+
+namespace logtail {
+
+void CpuQuotaTable::Quota::Refill(uint64_t nowMs) {
+    if (nowMs > mLastRefillMs) {
+        mDebtNs = std::max<int64_t>(0, mDebtNs - static_cast<int64_t>(nowMs - mLastRefillMs) * mNsPerMs);
+        mLastRefillMs = nowMs;
+    }
+}
+
+void CpuQuotaTable::Set(const LogstoreFeedBackKey& key, int32_t percent) {
+    ScopedSpinLock lock(mLock);
+    if (percent <= 0) {
+        mQuotas.erase(key);
+    } else {
+        // percent% of one millisecond.
+        mQuotas[key].mNsPerMs = static_cast<int64_t>(percent) * 10000;
+    }
+    mCount.store(mQuotas.size(), std::memory_order_relaxed);
+}
+
+void CpuQuotaTable::Charge(const LogstoreFeedBackKey& key, uint64_t cpuTimeNs, uint64_t nowMs) {
+    ScopedSpinLock lock(mLock);
+    auto iter = mQuotas.find(key);
+    if (iter == mQuotas.end()) {
+        return;
+    }
+    iter->second.Refill(nowMs);
+    iter->second.mDebtNs += static_cast<int64_t>(cpuTimeNs);
+}
+
+bool CpuQuotaTable::IsExceeded(const LogstoreFeedBackKey& key, uint64_t nowMs) {
+    ScopedSpinLock lock(mLock);
+    auto iter = mQuotas.find(key);
+    if (iter == mQuotas.end()) {
+        return false;
+    }
+    Quota& quota = iter->second;
+    quota.Refill(nowMs);
+    if (quota.mDebtNs <= quota.mNsPerMs * 1000) {
+        return false;
+    }
+    mThrottledCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace logtail
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include "common/Lock.h"
+#include "common/LogstoreFeedbackKey.h"
+
+namespace logtail {
+
+// CpuQuotaTable limits CPU time spent on items of logstore queues. CPU time charged to a queue is its debt, which
+// is paid back at the quota rate, and the queue should not be popped while the debt exceeds quota of one second.
+// So a queue can burst for a while, but its long-term usage is bounded by the quota.
+class CpuQuotaTable {
+public:
+    // Set limits queue @key to @percent of one core, the limit is removed if @percent <= 0.
+    void Set(const LogstoreFeedBackKey& key, int32_t percent);
+
+    // Empty returns true if no queue is limited, CPU time needs not be measured then.
+    bool Empty() const { return mCount.load(std::memory_order_relaxed) == 0; }
+
+    // Charge adds @cpuTimeNs spent on items of queue @key to its debt at @nowMs if the queue is limited.
+    void Charge(const LogstoreFeedBackKey& key, uint64_t cpuTimeNs, uint64_t nowMs);
+
+    // IsExceeded returns true if queue @key has used up its quota at @nowMs.
+    bool IsExceeded(const LogstoreFeedBackKey& key, uint64_t nowMs);
+
+    // GetThrottledCount returns times IsExceeded returned true since last call.
+    uint64_t GetThrottledCount() { return mThrottledCount.exchange(0, std::memory_order_relaxed); }
+
+private:
+    struct Quota {
+        int64_t mNsPerMs = 0;
+        int64_t mDebtNs = 0;
+        uint64_t mLastRefillMs = 0;
+
+        void Refill(uint64_t nowMs);
+    };
+
+    SpinLock mLock;
+    std::unordered_map<LogstoreFeedBackKey, Quota> mQuotas;
+    std::atomic<size_t> mCount{0};
+    std::atomic<uint64_t> mThrottledCount{0};
+};
+
+} // namespace logtail
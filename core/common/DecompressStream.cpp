@@ -0,0 +1,205 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "DecompressStream.h"
+#include <zlib/zlib.h>
+#include <zstd/zstd.h>
+#include <string.h>
+#include <algorithm>
+#include "logger/Logger.h"
+
+namespace logtail {
+
+namespace {
+
+const size_t kInputSize = 64 * 1024;
+const size_t kWindowSize = 256 * 1024;
+
+} // namespace
+
+const size_t DecompressStream::kHeadSize;
+
+DecompressStream::DecompressStream(Format format, const ReadFunc& read)
+    : mFormat(format), mRead(read), mInput(kInputSize), mWindow(kWindowSize) {
+    Reset();
+}
+
+DecompressStream::~DecompressStream() {
+    ReleaseStream();
+}
+
+DecompressStream::Format DecompressStream::DetectFormat(const char* head, size_t size) {
+    const unsigned char* magic = reinterpret_cast<const unsigned char*>(head);
+    if (size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return FORMAT_GZIP;
+    }
+    if (size >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        return FORMAT_ZSTD;
+    }
+    return FORMAT_NONE;
+}
+
+void DecompressStream::ReleaseStream() {
+    if (mZStream != nullptr) {
+        inflateEnd(mZStream);
+        delete mZStream;
+        mZStream = nullptr;
+    }
+    if (mZstdStream != nullptr) {
+        ZSTD_freeDStream(mZstdStream);
+        mZstdStream = nullptr;
+    }
+}
+
+bool DecompressStream::Reset() {
+    ReleaseStream();
+    mInputPos = mInputSize = 0;
+    mFileOffset = 0;
+    mWindowOffset = 0;
+    mWindowSize = 0;
+    mEnd = false;
+    mError = false;
+    mAtMemberEnd = false;
+    if (mFormat == FORMAT_GZIP) {
+        mZStream = new z_stream;
+        memset(mZStream, 0, sizeof(z_stream));
+        // 16 + MAX_WBITS accepts gzip only.
+        mError = inflateInit2(mZStream, 16 + MAX_WBITS) != Z_OK;
+    } else if (mFormat == FORMAT_ZSTD) {
+        mZstdStream = ZSTD_createDStream();
+        mError = mZstdStream == nullptr || ZSTD_isError(ZSTD_initDStream(mZstdStream));
+    } else {
+        mError = true;
+    }
+    return !mError;
+}
+
+bool DecompressStream::DecodeNext() {
+    mWindowOffset += static_cast<int64_t>(mWindowSize);
+    mWindowSize = 0;
+    while (mWindowSize == 0 && !mEnd && !mError) {
+        bool inputEnd = false;
+        if (mInputPos == mInputSize) {
+            const int nbytes = mRead(mInput.data(), mInput.size(), mFileOffset);
+            if (nbytes < 0) {
+                mError = true;
+                break;
+            }
+            mInputPos = 0;
+            mInputSize = static_cast<size_t>(nbytes);
+            mFileOffset += nbytes;
+            inputEnd = nbytes == 0;
+        }
+        if (mFormat == FORMAT_GZIP) {
+            mZStream->next_in = reinterpret_cast<Bytef*>(mInput.data() + mInputPos);
+            mZStream->avail_in = static_cast<uInt>(mInputSize - mInputPos);
+            mZStream->next_out = reinterpret_cast<Bytef*>(mWindow.data());
+            mZStream->avail_out = static_cast<uInt>(mWindow.size());
+            const int ret = inflate(mZStream, Z_NO_FLUSH);
+            mInputPos = mInputSize - mZStream->avail_in;
+            mWindowSize = mWindow.size() - mZStream->avail_out;
+            if (ret == Z_STREAM_END) {
+                // Another member may follow, the end is found by next read of input.
+                mError = inflateReset(mZStream) != Z_OK;
+                mAtMemberEnd = true;
+            } else if (ret == Z_DATA_ERROR && mAtMemberEnd && mWindowSize == 0) {
+                // Bytes after the last member, e.g. padding, are ignored.
+                mEnd = true;
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                LOG_WARNING(sLogger, ("inflate gzip file fail, ret", ret)("offset", mFileOffset));
+                mError = true;
+            } else if (mWindowSize > 0) {
+                mAtMemberEnd = false;
+            }
+        } else {
+            ZSTD_inBuffer in{mInput.data(), mInputSize, mInputPos};
+            ZSTD_outBuffer out{mWindow.data(), mWindow.size(), 0};
+            const size_t ret = ZSTD_decompressStream(mZstdStream, &out, &in);
+            if (ZSTD_isError(ret)) {
+                LOG_WARNING(sLogger, ("decompress zstd file fail", ZSTD_getErrorName(ret))("offset", mFileOffset));
+                mError = true;
+            }
+            mInputPos = in.pos;
+            mWindowSize = out.pos;
+        }
+        if (inputEnd && mWindowSize == 0) {
+            mEnd = true;
+        }
+    }
+    if (mError) {
+        mWindowSize = 0;
+        return false;
+    }
+    const int64_t headSize = static_cast<int64_t>(mHead.size());
+    if (headSize < static_cast<int64_t>(kHeadSize) && mWindowOffset <= headSize
+        && headSize < mWindowOffset + static_cast<int64_t>(mWindowSize)) {
+        const size_t pos = static_cast<size_t>(headSize - mWindowOffset);
+        mHead.append(mWindow.data() + pos, std::min(mWindowSize - pos, kHeadSize - mHead.size()));
+    }
+    return true;
+}
+
+int64_t DecompressStream::GetSize() {
+    if (mSize >= -1) {
+        return mSize;
+    }
+    if (!Reset()) {
+        mSize = -1;
+        return mSize;
+    }
+    while (!mEnd) {
+        if (!DecodeNext()) {
+            mSize = -1;
+            return mSize;
+        }
+    }
+    mSize = mWindowOffset;
+    Reset();
+    return mSize;
+}
+
+int DecompressStream::Read(char* buf, size_t size, int64_t offset) {
+    if (offset < 0) {
+        return -1;
+    }
+    if (offset + static_cast<int64_t>(size) <= static_cast<int64_t>(mHead.size())) {
+        memcpy(buf, mHead.data() + offset, size);
+        return static_cast<int>(size);
+    }
+    if (offset < mWindowOffset || mError) {
+        if (!Reset()) {
+            return -1;
+        }
+    }
+    size_t copied = 0;
+    while (copied < size) {
+        const int64_t cur = offset + static_cast<int64_t>(copied);
+        if (cur >= mWindowOffset + static_cast<int64_t>(mWindowSize)) {
+            if (mEnd) {
+                break;
+            }
+            if (!DecodeNext()) {
+                return copied > 0 ? static_cast<int>(copied) : -1;
+            }
+            continue;
+        }
+        const size_t pos = static_cast<size_t>(cur - mWindowOffset);
+        const size_t nbytes = std::min(size - copied, mWindowSize - pos);
+        memcpy(buf + copied, mWindow.data() + pos, nbytes);
+        copied += nbytes;
+    }
+    return static_cast<int>(copied);
+}
+
+} // namespace logtail
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct z_stream_s;
+struct ZSTD_DCtx_s;
+
+namespace logtail {
+
+// DecompressStream reads a gzip or zstd file as its decompressed data at given offsets, by decompressing it
+// forward. Concatenated gzip members and zstd frames are read as one stream. Reading forward skips data by
+// decompressing it, reading backward restarts from the beginning, except reads in the head which is kept for
+// signature checks. Offsets and sizes are of the decompressed data. It is not thread safe.
+class DecompressStream {
+public:
+    enum Format { FORMAT_NONE, FORMAT_GZIP, FORMAT_ZSTD };
+
+    // ReadFunc reads at most @size bytes of the compressed file at @offset, returns bytes read or -1 on error.
+    typedef std::function<int(char* buf, size_t size, int64_t offset)> ReadFunc;
+
+    DecompressStream(Format format, const ReadFunc& read);
+    ~DecompressStream();
+
+    // DetectFormat detects the format by magic number at the beginning of file.
+    static Format DetectFormat(const char* head, size_t size);
+
+    // GetSize returns the decompressed size, or -1 if the data can not be decompressed. The whole file is
+    // decompressed once for the first call. A truncated file, e.g. one still being compressed, ends where the
+    // data can be decompressed.
+    int64_t GetSize();
+
+    // Read reads at most @size bytes at @offset, returns bytes read, 0 at end or -1 on error.
+    int Read(char* buf, size_t size, int64_t offset);
+
+    Format GetFormat() const { return mFormat; }
+
+    static const size_t kHeadSize = 1024;
+
+private:
+    bool Reset();
+    void ReleaseStream();
+    // DecodeNext replaces the window with next decompressed data, @return false on error.
+    bool DecodeNext();
+
+    const Format mFormat;
+    const ReadFunc mRead;
+    z_stream_s* mZStream = nullptr;
+    ZSTD_DCtx_s* mZstdStream = nullptr;
+
+    std::vector<char> mInput;
+    size_t mInputPos = 0;
+    size_t mInputSize = 0;
+    int64_t mFileOffset = 0;
+
+    // Decompressed data in [mWindowOffset, mWindowOffset + mWindowSize).
+    std::vector<char> mWindow;
+    int64_t mWindowOffset = 0;
+    size_t mWindowSize = 0;
+    bool mEnd = false;
+    bool mError = false;
+    bool mAtMemberEnd = false; // a gzip member ends and no data of next one is decompressed
+
+    std::string mHead;
+    int64_t mSize = -2; // -2 means unknown
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class DecompressStreamUnittest;
+#endif
+};
+
+} // namespace logtail
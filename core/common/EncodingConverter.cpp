@@ -20,9 +20,102 @@
 #elif defined(_MSC_VER)
 #include <Windows.h>
 #endif
+#include <cstring>
+#if defined(__x86_64__) || defined(_M_X64)
+#define LOGTAIL_ASCII_SCANNER_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define LOGTAIL_ASCII_SCANNER_AVX2
+#include <immintrin.h>
+#endif
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace logtail {
 
+namespace {
+
+    const uint32_t kGbkTrailCount = 0xFE - 0x40 + 1;
+
+    inline uint32_t CountTrailingZero32(uint32_t mask) {
+#if defined(_MSC_VER)
+        unsigned long idx = 0;
+        _BitScanForward(&idx, mask);
+        return static_cast<uint32_t>(idx);
+#else
+        return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+    }
+
+    // AsciiPrefixLength returns the length of the longest prefix of [@src, @src + @size) without bytes >= 0x80.
+    typedef size_t (*AsciiPrefixLengthFunc)(const char*, size_t);
+
+    size_t AsciiPrefixLengthScalar(const char* src, size_t size) {
+        size_t offset = 0;
+        for (; offset + 8 <= size; offset += 8) {
+            uint64_t word;
+            memcpy(&word, src + offset, sizeof(word));
+            if ((word & 0x8080808080808080ULL) != 0) {
+                break;
+            }
+        }
+        while (offset < size && static_cast<unsigned char>(src[offset]) < 0x80) {
+            ++offset;
+        }
+        return offset;
+    }
+
+#if defined(LOGTAIL_ASCII_SCANNER_SSE2)
+    size_t AsciiPrefixLengthSSE2(const char* src, size_t size) {
+        size_t offset = 0;
+        for (; offset + 16 <= size; offset += 16) {
+            __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + offset));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(data));
+            if (mask != 0) {
+                return offset + CountTrailingZero32(mask);
+            }
+        }
+        return offset + AsciiPrefixLengthScalar(src + offset, size - offset);
+    }
+#endif
+
+#if defined(LOGTAIL_ASCII_SCANNER_AVX2)
+    __attribute__((target("avx2"))) size_t AsciiPrefixLengthAVX2(const char* src, size_t size) {
+        size_t offset = 0;
+        for (; offset + 32 <= size; offset += 32) {
+            __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + offset));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(data));
+            if (mask != 0) {
+                return offset + CountTrailingZero32(mask);
+            }
+        }
+        return offset + AsciiPrefixLengthSSE2(src + offset, size - offset);
+    }
+#endif
+
+    AsciiPrefixLengthFunc SelectAsciiPrefixLength() {
+#if defined(LOGTAIL_ASCII_SCANNER_AVX2)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return AsciiPrefixLengthAVX2;
+        }
+#endif
+#if defined(LOGTAIL_ASCII_SCANNER_SSE2)
+        return AsciiPrefixLengthSSE2;
+#else
+        return AsciiPrefixLengthScalar;
+#endif
+    }
+
+    size_t AsciiPrefixLength(const char* src, size_t size) {
+        static const AsciiPrefixLengthFunc sFunc = SelectAsciiPrefixLength();
+        return sFunc(src, size);
+    }
+
+} // namespace
+
 #if defined(__linux__)
 static iconv_t mGbk2Utf8Cd = (iconv_t)-1;
 #endif
@@ -131,6 +224,127 @@ bool EncodingConverter::ConvertGbk2Utf8(
 #endif
 }
 
+void EncodingConverter::InitGbk2Utf8Table() {
+    mGbk2Utf8Table.assign((0xFE - 0x81 + 1) * kGbkTrailCount, 0);
+#if defined(__linux__)
+    // Use a separate descriptor, chars without mapping should not break the state of mGbk2Utf8Cd.
+    iconv_t cd = iconv_open("UTF-8", "GBK");
+    if (cd == (iconv_t)(-1)) {
+        LOG_WARNING(sLogger, ("create GBK to UTF8 table fail, errno", strerror(errno)));
+        return;
+    }
+#endif
+    size_t mappedCount = 0;
+    for (uint32_t lead = 0x81; lead <= 0xFE; ++lead) {
+        for (uint32_t trail = 0x40; trail <= 0xFE; ++trail) {
+            char gbk[2] = {static_cast<char>(lead), static_cast<char>(trail)};
+            char utf8[8];
+            size_t utf8Length = 0;
+#if defined(__linux__)
+            char* in = gbk;
+            size_t inLeft = sizeof(gbk);
+            char* out = utf8;
+            size_t outLeft = sizeof(utf8);
+            if (iconv(cd, &in, &inLeft, &out, &outLeft) == (size_t)(-1) || inLeft != 0) {
+                iconv(cd, NULL, NULL, NULL, NULL);
+                continue;
+            }
+            utf8Length = out - utf8;
+#elif defined(_MSC_VER)
+            wchar_t wc[2];
+            if (MultiByteToWideChar(CP_ACP, MB_ERR_INVALID_CHARS, gbk, sizeof(gbk), wc, 2) != 1) {
+                continue;
+            }
+            int len = WideCharToMultiByte(CP_UTF8, 0, wc, 1, utf8, sizeof(utf8), NULL, NULL);
+            utf8Length = len > 0 ? static_cast<size_t>(len) : 0;
+#endif
+            if (utf8Length == 0 || utf8Length > 3) {
+                continue;
+            }
+            uint32_t value = static_cast<uint32_t>(utf8Length) << 24;
+            for (size_t i = 0; i < utf8Length; ++i) {
+                value |= static_cast<uint32_t>(static_cast<unsigned char>(utf8[i])) << (16 - 8 * i);
+            }
+            mGbk2Utf8Table[(lead - 0x81) * kGbkTrailCount + trail - 0x40] = value;
+            ++mappedCount;
+        }
+    }
+#if defined(__linux__)
+    iconv_close(cd);
+#endif
+    LOG_INFO(sLogger, ("init GBK to UTF8 table, mapped char count", mappedCount));
+}
+
+size_t EncodingConverter::ConvertLineByTable(const char* src, size_t length, char* des) {
+    const char* cur = src;
+    const char* end = src + length;
+    char* out = des;
+    while (cur < end) {
+        const size_t asciiLength = AsciiPrefixLength(cur, end - cur);
+        memcpy(out, cur, asciiLength);
+        cur += asciiLength;
+        out += asciiLength;
+        if (cur == end) {
+            break;
+        }
+        if (cur + 1 == end) {
+            return (size_t)-1;
+        }
+        const uint32_t lead = static_cast<unsigned char>(cur[0]);
+        const uint32_t trail = static_cast<unsigned char>(cur[1]);
+        if (lead < 0x81 || lead > 0xFE || trail < 0x40 || trail > 0xFE) {
+            return (size_t)-1;
+        }
+        const uint32_t value = mGbk2Utf8Table[(lead - 0x81) * kGbkTrailCount + trail - 0x40];
+        const uint32_t utf8Length = value >> 24;
+        if (utf8Length == 0) {
+            return (size_t)-1;
+        }
+        for (uint32_t i = 0; i < utf8Length; ++i) {
+            *out++ = static_cast<char>((value >> (16 - 8 * i)) & 0xFF);
+        }
+        cur += 2;
+    }
+    return out - des;
+}
+
+size_t EncodingConverter::ConvertGbk2Utf8ByTable(const char* src,
+                                                 size_t srcLength,
+                                                 char* des,
+                                                 const std::vector<size_t>& linePosVec) {
+    std::call_once(mGbk2Utf8TableOnce, [this]() { InitGbk2Utf8Table(); });
+    const size_t maxDestSize = srcLength * 2;
+    size_t beginIndex = 0;
+    size_t destIndex = 0;
+    for (size_t i = 0; i < linePosVec.size(); ++i) {
+        // include '\n'
+        const size_t lineLength = linePosVec[i] - beginIndex + 1;
+        size_t lineResult = ConvertLineByTable(src + beginIndex, lineLength, des + destIndex);
+        if (lineResult == (size_t)-1) {
+            size_t lineSrcLength = lineLength;
+            char* lineDes = NULL;
+            size_t lineDesLength = 0;
+            std::vector<size_t> lineLinePos(1, lineLength - 1);
+            ConvertGbk2Utf8(const_cast<char*>(src + beginIndex), &lineSrcLength, lineDes, &lineDesLength, lineLinePos);
+            if (lineDes != NULL && lineDesLength > 0 && lineDesLength <= maxDestSize - destIndex) {
+                memcpy(des + destIndex, lineDes, lineDesLength);
+                lineResult = lineDesLength;
+            } else {
+                memcpy(des + destIndex, src + beginIndex, lineLength);
+                lineResult = lineLength;
+            }
+            delete[] lineDes;
+        }
+        destIndex += lineResult;
+        beginIndex = linePosVec[i] + 1;
+    }
+    return destIndex;
+}
+
+bool EncodingConverter::IsAscii(const char* src, size_t length) {
+    return AsciiPrefixLength(src, length) == length;
+}
+
 std::string EncodingConverter::FromUTF8ToACP(const std::string& s) {
     if (s.empty())
         return s;
@@ -20,6 +20,8 @@
 #include <vector>
 #include <string>
 #include <cstddef>
+#include <cstdint>
+#include <mutex>
 
 namespace logtail {
 enum FileEncoding { ENCODING_UTF8, ENCODING_GBK };
@@ -51,12 +53,34 @@ public:
     bool
     ConvertGbk2Utf8(char* src, size_t* srcLength, char*& des, size_t* desLength, const std::vector<size_t>& linePosVec);
 
+    // ConvertGbk2Utf8ByTable converts @srcLength bytes of @src (in GBK) to UTF-8 into @des, which
+    // must have at least @srcLength * 2 bytes. Lines are split by @linePosVec as ConvertGbk2Utf8.
+    // ASCII runs are copied with SIMD and double-byte chars are looked up in a table built from
+    // the system converter at the first call. Lines with bytes not in the table are converted by
+    // ConvertGbk2Utf8, and copied without converting if it fails too.
+    // @return: the length of result in @des.
+    size_t
+    ConvertGbk2Utf8ByTable(const char* src, size_t srcLength, char* des, const std::vector<size_t>& linePosVec);
+
+    // IsAscii returns true if all bytes of [@src, @src + @length) are ASCII, which are the same in GBK and UTF-8.
+    static bool IsAscii(const char* src, size_t length);
+
     // FromUTF8ToACP converts @s encoded in UTF8 to ACP.
     // @return ACP string if convert successfully, otherwise @s will be returned.
     std::string FromUTF8ToACP(const std::string& s);
 
     // FromACPToUTF8 converts @s encoded in ACP (locale) to UTF8.
     std::string FromACPToUTF8(const std::string& s);
+
+private:
+    void InitGbk2Utf8Table();
+    // @return the length of result in @des, or -1 if any char of the line is not in the table.
+    size_t ConvertLineByTable(const char* src, size_t length, char* des);
+
+    // Indexed by (lead - 0x81) * 191 + (trail - 0x40), the high byte is the length of UTF-8 bytes
+    // stored in low 3 bytes, 0 means no mapping.
+    std::vector<uint32_t> mGbk2Utf8Table;
+    std::once_flag mGbk2Utf8TableOnce;
 };
 
 } // namespace logtail
@@ -15,6 +15,15 @@
 #include "FileEncryption.h"
 #include <time.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <cstring>
+#if defined(__x86_64__) || defined(_M_X64)
+#define LOGTAIL_ENCRYPTION_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#define LOGTAIL_ENCRYPTION_NEON
+#include <arm_neon.h>
+#endif
 #include "StringTools.h"
 #include "FileSystemUtil.h"
 #include "logger/Logger.h"
@@ -96,33 +105,94 @@ FileEncryption::~FileEncryption() {
     mKeyMap.clear();
 }
 
+namespace {
+
+    // XorBytes sets @des to @a xor @b byte by byte, @des may be @a.
+    inline void XorBytes(const char* a, const char* b, char* des, size_t length) {
+        size_t pos = 0;
+#if defined(LOGTAIL_ENCRYPTION_SSE2)
+        for (; pos + 16 <= length; pos += 16) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + pos));
+            __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + pos));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(des + pos), _mm_xor_si128(x, y));
+        }
+#elif defined(LOGTAIL_ENCRYPTION_NEON)
+        for (; pos + 16 <= length; pos += 16) {
+            uint8x16_t x = vld1q_u8(reinterpret_cast<const uint8_t*>(a + pos));
+            uint8x16_t y = vld1q_u8(reinterpret_cast<const uint8_t*>(b + pos));
+            vst1q_u8(reinterpret_cast<uint8_t*>(des + pos), veorq_u8(x, y));
+        }
+#endif
+        for (; pos + 8 <= length; pos += 8) {
+            uint64_t x, y;
+            memcpy(&x, a + pos, 8);
+            memcpy(&y, b + pos, 8);
+            x ^= y;
+            memcpy(des + pos, &x, 8);
+        }
+        for (; pos < length; ++pos) {
+            des[pos] = a[pos] ^ b[pos];
+        }
+    }
+
+    // XorKeyStream xors [@src, @src + @length) with the key, key stream is a multiple of the key,
+    // so each chunk of key stream size starts from the first byte of the key.
+    void XorKeyStream(const char* src, char* des, size_t length, const std::string& keyStream) {
+        for (size_t offset = 0; offset < length; offset += keyStream.size()) {
+            XorBytes(src + offset, keyStream.data(), des + offset, std::min(keyStream.size(), length - offset));
+        }
+    }
+
+} // namespace
+
+FileEncryption::KeyInfo* FileEncryption::GetEncryptKey(int32_t version) {
+    auto iter = mKeyMap.find(version);
+    if (iter != mKeyMap.end())
+        return iter->second;
+    if (version == 0)
+        return mDefaultKey;
+    LOG_ERROR(sLogger, ("key_version for encrypt is invalid", version));
+    return NULL;
+}
+
 // if encrypt success, must release memory(des) after call this function
 bool FileEncryption::Encrypt(const char* src, int32_t srcLength, char*& des, int32_t& desLength, int32_t version) {
-    KeyInfo* encryptKey;
-    if (mKeyMap.find(version) != mKeyMap.end())
-        encryptKey = mKeyMap[version];
-    else if (version == 0)
-        encryptKey = mDefaultKey;
-    else {
-        LOG_ERROR(sLogger, ("key_version for encrypt is invalid", version));
+    desLength = GetEncryptedLength(srcLength, version);
+    if (desLength <= 0) {
+        desLength = 0;
         return false;
     }
-    desLength = 0;
-    if (srcLength == 0)
+    des = new char[desLength];
+    if (!EncryptTo(src, srcLength, des, desLength, version)) {
+        delete[] des;
+        des = NULL;
+        desLength = 0;
         return false;
+    }
+    return true;
+}
+
+int32_t FileEncryption::GetEncryptedLength(int32_t srcLength, int32_t version) {
+    KeyInfo* encryptKey = GetEncryptKey(version);
+    if (encryptKey == NULL || encryptKey->mBlockBytes == 0 || srcLength < 0)
+        return -1;
     int32_t blockCount = srcLength / encryptKey->mBlockBytes;
     if ((srcLength % encryptKey->mBlockBytes) != 0) {
         blockCount += 1;
     }
-    desLength = blockCount * encryptKey->mBlockBytes;
-    des = new char[desLength];
-    for (int32_t pos = 0; pos < desLength; ++pos) {
+    return blockCount * encryptKey->mBlockBytes;
+}
+
+bool FileEncryption::EncryptTo(const char* src, int32_t srcLength, char* des, int32_t desLength, int32_t version) {
+    KeyInfo* encryptKey = GetEncryptKey(version);
+    if (encryptKey == NULL)
+        return false;
+    if (srcLength == 0 || desLength != GetEncryptedLength(srcLength, version))
+        return false;
+    XorKeyStream(src, des, srcLength, encryptKey->mKeyStream);
+    for (int32_t pos = srcLength; pos < desLength; ++pos) {
         int32_t byteIdx = pos % encryptKey->mBlockBytes;
-        if (pos < srcLength) {
-            des[pos] = src[pos] ^ encryptKey->mKey[byteIdx];
-        } else {
-            des[pos] = char((rand() % 94) + 33) ^ encryptKey->mKey[byteIdx];
-        }
+        des[pos] = char((rand() % 94) + 33) ^ encryptKey->mKey[byteIdx];
     }
     return true;
 }
@@ -136,7 +206,7 @@ bool FileEncryption::Decrypt(const char* src, int32_t srcLength, char* des, int3
         return false;
     }
 
-    if (srcLength == 0 || desLength > srcLength) {
+    if (srcLength == 0 || desLength > srcLength || desLength < 0) {
         LOG_ERROR(sLogger, ("decrypt error, srcLength:", srcLength)("desLength", desLength));
         return false;
     }
@@ -144,10 +214,7 @@ bool FileEncryption::Decrypt(const char* src, int32_t srcLength, char* des, int3
         LOG_ERROR(sLogger, ("decrypt error, key_version:", decryptKey->mVersion));
         return false;
     }
-    for (int32_t pos = 0; pos < desLength; ++pos) {
-        int32_t byteIdx = pos % decryptKey->mBlockBytes;
-        des[pos] = src[pos] ^ decryptKey->mKey[byteIdx];
-    }
+    XorKeyStream(src, des, desLength, decryptKey->mKeyStream);
     return true;
 }
 
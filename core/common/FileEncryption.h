@@ -31,6 +31,11 @@ public:
     };
     static bool CheckHeader(const std::string& filename, std::unordered_map<std::string, std::string>& kvMap);
     bool Encrypt(const char* src, int32_t srcLength, char*& des, int32_t& desLength, int32_t version = 0);
+    // GetEncryptedLength returns bytes of encryption of @srcLength bytes, or -1 if @version is invalid.
+    int32_t GetEncryptedLength(int32_t srcLength, int32_t version = 0);
+    // EncryptTo encrypts into @des provided by caller, @desLength must equal to GetEncryptedLength.
+    bool EncryptTo(const char* src, int32_t srcLength, char* des, int32_t desLength, int32_t version = 0);
+    // Decrypt can decrypt in place, i.e. @des equals to @src.
     bool Decrypt(const char* src, int32_t srcLength, char* des, int32_t desLength, int32_t version);
     int32_t GetDefaultKeyVersion() { return mDefaultKey->mVersion; }
 
@@ -46,20 +51,30 @@ public:
             mBlockBytes = (int32_t)key.size();
             mVersion = version;
             mKey = key;
+            while (!mKey.empty() && mKeyStream.size() < KEY_STREAM_MIN_BYTES) {
+                mKeyStream += mKey;
+            }
         }
 
         void Reset() {
             mKey = "";
+            mKeyStream = "";
             mBlockBytes = 0;
             mVersion = 0;
         }
 
         std::string mKey;
+        // mKey repeated, so data is xor-ed with it chunk by chunk instead of byte by byte.
+        std::string mKeyStream;
         int32_t mBlockBytes; // equal to mKey.size()
         int32_t mVersion;
+
+        static const size_t KEY_STREAM_MIN_BYTES = 256;
     };
 
 private:
+    KeyInfo* GetEncryptKey(int32_t version);
+
     std::map<int32_t, KeyInfo*> mKeyMap; // version and its key
     KeyInfo* mDefaultKey; // the latest version key
 
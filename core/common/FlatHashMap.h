@@ -0,0 +1,234 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace logtail {
+
+// FlatHashMap is an open addressing hash map with linear probing, keys and values are stored inline in one slot
+// array instead of one heap node per entry, so it suits tables of small keys such as pids and socket hashes.
+//
+// The interface follows the subset of std::unordered_map used by the observer. Erase leaves a tombstone, so
+// erasing while iterating is safe and returns the next iterator, but any insert may rehash and invalidate all
+// iterators. Keys and values must be default constructible, an erased slot is reset to release its value.
+template <class K, class V, class Hash = std::hash<K>, class KeyEqual = std::equal_to<K>>
+class FlatHashMap {
+public:
+    typedef std::pair<K, V> value_type;
+
+    template <bool Const>
+    class IteratorBase {
+        typedef typename std::conditional<Const, const FlatHashMap*, FlatHashMap*>::type MapPtr;
+        typedef typename std::conditional<Const, const value_type, value_type>::type Value;
+
+    public:
+        IteratorBase() = default;
+        IteratorBase(MapPtr map, size_t index) : mMap(map), mIndex(index) { SkipEmpty(); }
+        template <bool C, class = typename std::enable_if<Const && !C>::type>
+        IteratorBase(const IteratorBase<C>& other) : mMap(other.mMap), mIndex(other.mIndex) {}
+
+        Value& operator*() const { return mMap->mSlots[mIndex]; }
+        Value* operator->() const { return &mMap->mSlots[mIndex]; }
+        IteratorBase& operator++() {
+            ++mIndex;
+            SkipEmpty();
+            return *this;
+        }
+        bool operator==(const IteratorBase& other) const { return mIndex == other.mIndex; }
+        bool operator!=(const IteratorBase& other) const { return mIndex != other.mIndex; }
+
+    private:
+        void SkipEmpty() {
+            while (mIndex < mMap->mCtrl.size() && mMap->mCtrl[mIndex] != kFull) {
+                ++mIndex;
+            }
+        }
+
+        MapPtr mMap = nullptr;
+        size_t mIndex = 0;
+
+        friend class FlatHashMap;
+        template <bool>
+        friend class IteratorBase;
+    };
+
+    typedef IteratorBase<false> iterator;
+    typedef IteratorBase<true> const_iterator;
+
+    FlatHashMap() = default;
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, mCtrl.size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, mCtrl.size()); }
+
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    iterator find(const K& key) { return iterator(this, FindIndex(key)); }
+    const_iterator find(const K& key) const { return const_iterator(this, FindIndex(key)); }
+    size_t count(const K& key) const { return FindIndex(key) != mCtrl.size() ? 1 : 0; }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        std::pair<size_t, bool> rst = TryInsert(value.first);
+        if (rst.second) {
+            mSlots[rst.first].second = value.second;
+        }
+        return std::make_pair(iterator(this, rst.first), rst.second);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) {
+        std::pair<size_t, bool> rst = TryInsert(value.first);
+        if (rst.second) {
+            mSlots[rst.first].second = std::move(value.second);
+        }
+        return std::make_pair(iterator(this, rst.first), rst.second);
+    }
+
+    V& operator[](const K& key) { return mSlots[TryInsert(key).first].second; }
+
+    iterator erase(const_iterator pos) {
+        size_t index = pos.mIndex;
+        mCtrl[index] = kDeleted;
+        mSlots[index] = value_type();
+        --mSize;
+        ++mDeleted;
+        return iterator(this, index + 1);
+    }
+
+    size_t erase(const K& key) {
+        size_t index = FindIndex(key);
+        if (index == mCtrl.size()) {
+            return 0;
+        }
+        erase(const_iterator(this, index));
+        return 1;
+    }
+
+    // clear releases the slot array as well.
+    void clear() {
+        std::vector<uint8_t>().swap(mCtrl);
+        std::vector<value_type>().swap(mSlots);
+        mSize = 0;
+        mDeleted = 0;
+        mShift = 64;
+    }
+
+    void reserve(size_t count) {
+        if (count * 4 > mCtrl.size() * 3) {
+            Rehash(count);
+        }
+    }
+
+    size_t capacity() const { return mCtrl.size(); }
+
+    // GetMemoryUsage returns the bytes held by the map itself, memory owned by keys or values is not included.
+    size_t GetMemoryUsage() const {
+        return sizeof(*this) + mCtrl.capacity() * sizeof(uint8_t) + mSlots.capacity() * sizeof(value_type);
+    }
+
+private:
+    enum : uint8_t { kEmpty = 0, kFull = 1, kDeleted = 2 };
+
+    size_t HashIndex(const K& key) const {
+        // fibonacci hashing spreads identity hashes of integer keys over the high bits.
+        return static_cast<size_t>((static_cast<uint64_t>(mHash(key)) * 0x9E3779B97F4A7C15ULL) >> mShift);
+    }
+
+    size_t FindIndex(const K& key) const {
+        if (mSize == 0) {
+            return mCtrl.size();
+        }
+        const size_t mask = mCtrl.size() - 1;
+        // there is always an empty slot, the probe stops.
+        for (size_t i = HashIndex(key);; i = (i + 1) & mask) {
+            if (mCtrl[i] == kEmpty) {
+                return mCtrl.size();
+            }
+            if (mCtrl[i] == kFull && mEqual(mSlots[i].first, key)) {
+                return i;
+            }
+        }
+    }
+
+    // TryInsert returns the index of key and whether it's a new slot.
+    std::pair<size_t, bool> TryInsert(const K& key) {
+        size_t index = FindIndex(key);
+        if (index != mCtrl.size()) {
+            return std::make_pair(index, false);
+        }
+        // tombstones take slots as well, so a table full of them is rehashed at the same capacity.
+        if ((mSize + mDeleted + 1) * 4 > mCtrl.size() * 3) {
+            Rehash(mSize + 1);
+        }
+        index = FindFreeIndex(key);
+        if (mCtrl[index] == kDeleted) {
+            --mDeleted;
+        }
+        mCtrl[index] = kFull;
+        mSlots[index].first = key;
+        ++mSize;
+        return std::make_pair(index, true);
+    }
+
+    size_t FindFreeIndex(const K& key) const {
+        const size_t mask = mCtrl.size() - 1;
+        size_t i = HashIndex(key);
+        while (mCtrl[i] == kFull) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    // Rehash moves all entries to a table holding count entries at half load at least.
+    void Rehash(size_t count) {
+        size_t capacity = 16;
+        uint32_t shift = 60;
+        while (count * 2 > capacity) {
+            capacity *= 2;
+            --shift;
+        }
+        std::vector<uint8_t> ctrl(capacity, kEmpty);
+        std::vector<value_type> slots(capacity);
+        ctrl.swap(mCtrl);
+        slots.swap(mSlots);
+        mShift = shift;
+        mDeleted = 0;
+        for (size_t i = 0; i < ctrl.size(); ++i) {
+            if (ctrl[i] == kFull) {
+                size_t index = FindFreeIndex(slots[i].first);
+                mCtrl[index] = kFull;
+                mSlots[index] = std::move(slots[i]);
+            }
+        }
+    }
+
+    std::vector<uint8_t> mCtrl;
+    std::vector<value_type> mSlots;
+    size_t mSize = 0;
+    size_t mDeleted = 0;
+    uint32_t mShift = 64;
+    Hash mHash;
+    KeyEqual mEqual;
+};
+
+} // namespace logtail
@@ -17,6 +17,7 @@
 #include "FileSystemUtil.h"
 #include "murmurhash3.h"
 #include "LogFileOperator.h"
+#include "xxhash/xxhash.h"
 
 namespace logtail {
 
@@ -350,10 +351,11 @@ bool CheckFileSignature(const std::string& filePath, uint64_t sigHash, uint32_t
 }
 
 int64_t HashString(const std::string& data) {
-    int64_t hval = (int64_t)0xcbf29ce484222325ULL;
-    const char* buf = data.c_str();
-    size_t len = data.size();
-    const char* bp = buf;
+    return HashString(data.data(), data.size(), kHashStringSeed);
+}
+
+int64_t HashString(const char* data, size_t len, int64_t hval) {
+    const char* bp = data;
     const char* be = bp + len;
     while (bp < be) {
         hval ^= (uint64_t)*bp++;
@@ -368,4 +370,12 @@ int64_t HashSignatureString(const char* str, size_t strLen) {
     return *(int64_t*)hashVal;
 }
 
+uint64_t HashWithSeed(const std::string& str, uint64_t seed) {
+    return XXH3_64bits_withSeed(str.data(), str.size(), seed);
+}
+
+uint64_t HashCombine(uint64_t seed, uint64_t value) {
+    return XXH3_64bits_withSeed(&value, sizeof(value), seed);
+}
+
 } // namespace logtail
@@ -30,6 +30,16 @@ bool CheckAndUpdateSignature(const std::string& signature, uint64_t& sigHash, ui
 bool CheckFileSignature(const std::string& filePath, uint64_t sigHash, uint32_t sigSize, bool fuseMode = false);
 
 int64_t HashString(const std::string& str);
+
+const int64_t kHashStringSeed = (int64_t)0xcbf29ce484222325ULL;
+// HashString continues hash @hval with [@data, @data + @len), so hashing pieces one by one
+// starting with kHashStringSeed equals to HashString of their concatenation.
+int64_t HashString(const char* data, size_t len, int64_t hval);
 int64_t HashSignatureString(const char* str, size_t strLen);
 
+// HashWithSeed hashes @str with xxh3 seeded by @seed, chaining parts one by one builds a key of them
+// without joining strings. HashCombine mixes a hash got before, e.g. a precomputed one, into @seed.
+uint64_t HashWithSeed(const std::string& str, uint64_t seed = 0);
+uint64_t HashCombine(uint64_t seed, uint64_t value);
+
 } // namespace logtail
@@ -0,0 +1,91 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "HeavyHitters.h"
+#include <utility>
+
+namespace logtail {
+
+uint64_t HeavyHitters::Add(uint64_t key, uint64_t count) {
+    auto iter = mIndexes.find(key);
+    if (iter != mIndexes.end()) {
+        const size_t index = iter->second;
+        mHeap[index].mCount += count;
+        const uint64_t guaranteed = mHeap[index].mCount - mHeap[index].mError;
+        SiftDown(index);
+        return guaranteed;
+    }
+    if (mHeap.size() < mCapacity) {
+        mHeap.push_back(Counter{key, count, 0});
+        mIndexes[key] = mHeap.size() - 1;
+        SiftUp(mHeap.size() - 1);
+        return count;
+    }
+    // Replaces the minimum, which is at the root.
+    mIndexes.erase(mHeap[0].mKey);
+    mHeap[0].mKey = key;
+    mHeap[0].mError = mHeap[0].mCount;
+    mHeap[0].mCount += count;
+    mIndexes[key] = 0;
+    SiftDown(0);
+    return count;
+}
+
+uint64_t HeavyHitters::Estimate(uint64_t key) const {
+    auto iter = mIndexes.find(key);
+    return iter == mIndexes.end() ? 0 : mHeap[iter->second].mCount;
+}
+
+void HeavyHitters::Clear() {
+    mHeap.clear();
+    mIndexes.clear();
+}
+
+void HeavyHitters::SiftUp(size_t index) {
+    while (index > 0) {
+        const size_t parent = (index - 1) / 2;
+        if (mHeap[parent].mCount <= mHeap[index].mCount) {
+            break;
+        }
+        Swap(parent, index);
+        index = parent;
+    }
+}
+
+void HeavyHitters::SiftDown(size_t index) {
+    while (true) {
+        size_t smallest = index;
+        const size_t left = index * 2 + 1;
+        const size_t right = left + 1;
+        if (left < mHeap.size() && mHeap[left].mCount < mHeap[smallest].mCount) {
+            smallest = left;
+        }
+        if (right < mHeap.size() && mHeap[right].mCount < mHeap[smallest].mCount) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        Swap(smallest, index);
+        index = smallest;
+    }
+}
+
+void HeavyHitters::Swap(size_t a, size_t b) {
+    std::swap(mHeap[a], mHeap[b]);
+    mIndexes[mHeap[a].mKey] = a;
+    mIndexes[mHeap[b].mKey] = b;
+}
+
+} // namespace logtail
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace logtail {
+
+// HeavyHitters estimates counts of the most frequent keys in a stream with the Space-Saving algorithm, in
+// memory for @capacity keys. A key not tracked takes the place of the one with minimum count and inherits
+// that count as its error, so estimates never undercount, estimates minus errors never overcount, and any key
+// counted more than total / capacity is tracked.
+//
+// Add and Estimate cost O(log capacity). It is not thread safe.
+class HeavyHitters {
+public:
+    explicit HeavyHitters(size_t capacity) : mCapacity(capacity > 0 ? capacity : 1) {}
+
+    // Add counts @key @count times and returns the count of @key guaranteed, which is its estimate minus error.
+    uint64_t Add(uint64_t key, uint64_t count = 1);
+    // Estimate returns the upper bound of the count of @key, 0 if @key is not tracked.
+    uint64_t Estimate(uint64_t key) const;
+
+    void Clear();
+    size_t Size() const { return mHeap.size(); }
+    size_t GetCapacity() const { return mCapacity; }
+    // GetMemoryUsage returns the approximate bytes of tracked counters and their index.
+    size_t GetMemoryUsage() const {
+        return mHeap.capacity() * sizeof(Counter)
+            + mIndexes.size() * (sizeof(std::pair<const uint64_t, size_t>) + 2 * sizeof(void*))
+            + mIndexes.bucket_count() * sizeof(void*);
+    }
+
+private:
+    struct Counter {
+        uint64_t mKey;
+        uint64_t mCount;
+        uint64_t mError;
+    };
+
+    void SiftUp(size_t index);
+    void SiftDown(size_t index);
+    void Swap(size_t a, size_t b);
+
+    const size_t mCapacity;
+    std::vector<Counter> mHeap; // min heap by count
+    std::unordered_map<uint64_t, size_t> mIndexes; // key to position in mHeap
+};
+
+} // namespace logtail
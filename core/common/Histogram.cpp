@@ -0,0 +1,88 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Histogram.h"
+#include <algorithm>
+#include "StringTools.h"
+
+namespace logtail {
+
+size_t Histogram::GetBucketIndex(uint64_t value) {
+    if (value < 2 * SUB_BUCKET_COUNT) {
+        return static_cast<size_t>(value);
+    }
+    uint32_t magnitude = 63;
+    while ((value >> magnitude) == 0) {
+        --magnitude;
+    }
+    const uint32_t shift = magnitude - SUB_BUCKET_BITS;
+    const size_t index = (shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) - SUB_BUCKET_COUNT);
+    return std::min(index, BUCKET_COUNT - 1);
+}
+
+uint64_t Histogram::GetBucketUpperBound(size_t index) {
+    if (index < 2 * SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const uint64_t shift = index / SUB_BUCKET_COUNT - 1;
+    const uint64_t mantissa = SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void Histogram::Record(uint64_t value) {
+    ++mBuckets[GetBucketIndex(value)];
+    ++mCount;
+    mSum += value;
+    mMax = std::max(mMax, value);
+}
+
+void Histogram::Merge(const Histogram& other) {
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        mBuckets[i] += other.mBuckets[i];
+    }
+    mCount += other.mCount;
+    mSum += other.mSum;
+    mMax = std::max(mMax, other.mMax);
+}
+
+void Histogram::Reset() {
+    mCount = 0;
+    mSum = 0;
+    mMax = 0;
+    std::fill(mBuckets, mBuckets + BUCKET_COUNT, 0);
+}
+
+uint64_t Histogram::GetPercentile(double percentile) const {
+    if (mCount == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * mCount + 0.5);
+    rank = std::max<uint64_t>(1, std::min(rank, mCount));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += mBuckets[i];
+        if (seen >= rank) {
+            return std::min(GetBucketUpperBound(i), mMax);
+        }
+    }
+    return mMax;
+}
+
+std::string Histogram::ToString() const {
+    return "count:" + logtail::ToString(mCount) + ",avg:" + logtail::ToString(mCount > 0 ? mSum / mCount : 0)
+        + ",p50:" + logtail::ToString(GetPercentile(50)) + ",p90:" + logtail::ToString(GetPercentile(90))
+        + ",p99:" + logtail::ToString(GetPercentile(99)) + ",max:" + logtail::ToString(mMax);
+}
+
+} // namespace logtail
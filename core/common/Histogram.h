@@ -0,0 +1,60 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace logtail {
+
+// Histogram records non-negative values into log-linear buckets like HDR histogram: values below 32 are
+// exact, and larger values are grouped into 16 buckets per power of two, so a percentile is within about
+// 6% of the real value. Values larger than 2^40 are counted in the last bucket.
+//
+// It is not thread safe, the owner serializes access.
+class Histogram {
+public:
+    static const uint32_t SUB_BUCKET_BITS = 4;
+    static const uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const uint32_t MAX_VALUE_BITS = 40;
+    static const size_t BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    Histogram() { Reset(); }
+
+    void Record(uint64_t value);
+    void Merge(const Histogram& other);
+    void Reset();
+
+    uint64_t GetCount() const { return mCount; }
+    uint64_t GetSum() const { return mSum; }
+    uint64_t GetMax() const { return mMax; }
+    // GetPercentile returns the upper bound of the bucket holding @percentile (0-100) of values.
+    uint64_t GetPercentile(double percentile) const;
+
+    // ToString formats a summary as "count:3,avg:10,p50:9,p90:12,p99:12,max:12".
+    std::string ToString() const;
+
+    static size_t GetBucketIndex(uint64_t value);
+    static uint64_t GetBucketUpperBound(size_t index);
+
+private:
+    uint64_t mCount;
+    uint64_t mSum;
+    uint64_t mMax;
+    uint32_t mBuckets[BUCKET_COUNT];
+};
+
+} // namespace logtail
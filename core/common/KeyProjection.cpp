@@ -0,0 +1,46 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "KeyProjection.h"
+#include <algorithm>
+#include <cstring>
+
+namespace logtail {
+
+KeyProjection::KeyProjection(const std::vector<std::string>& keys) : mKeys(keys) {
+    std::sort(mKeys.begin(), mKeys.end(), [](const std::string& lhs, const std::string& rhs) {
+        return lhs.size() != rhs.size() ? lhs.size() < rhs.size() : lhs < rhs;
+    });
+    mKeys.erase(std::unique(mKeys.begin(), mKeys.end()), mKeys.end());
+}
+
+bool KeyProjection::Contains(const char* key, size_t length) const {
+    if (mKeys.empty()) {
+        return true;
+    }
+    for (const std::string& item : mKeys) {
+        if (item.size() < length) {
+            continue;
+        }
+        if (item.size() > length) {
+            return false;
+        }
+        if (memcmp(item.data(), key, length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace logtail
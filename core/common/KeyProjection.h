@@ -0,0 +1,41 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace logtail {
+
+// KeyProjection is the set of keys a config keeps, parsers skip extracting and serializing other keys. An
+// empty projection keeps all keys. Keys are few, so they are kept sorted by size and compared with memcmp,
+// which is cheaper than hashing each key of a line.
+class KeyProjection {
+public:
+    KeyProjection() = default;
+    explicit KeyProjection(const std::vector<std::string>& keys);
+
+    bool IsAll() const { return mKeys.empty(); }
+    bool Contains(const char* key, size_t length) const;
+    bool Contains(const std::string& key) const { return Contains(key.data(), key.size()); }
+    const std::vector<std::string>& GetKeys() const { return mKeys; }
+
+private:
+    std::vector<std::string> mKeys;
+};
+
+} // namespace logtail
@@ -0,0 +1,355 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "LineFeedScanner.h"
+#if defined(__x86_64__) || defined(_M_X64)
+#define LOGTAIL_LF_SCANNER_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define LOGTAIL_LF_SCANNER_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__)
+#define LOGTAIL_LF_SCANNER_NEON
+#include <arm_neon.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace logtail {
+
+namespace {
+
+    inline uint32_t CountTrailingZero32(uint32_t mask) {
+#if defined(_MSC_VER)
+        unsigned long idx = 0;
+        _BitScanForward(&idx, mask);
+        return static_cast<uint32_t>(idx);
+#else
+        return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+    }
+
+    inline uint32_t HighestBit32(uint32_t mask) {
+#if defined(_MSC_VER)
+        unsigned long idx = 0;
+        _BitScanReverse(&idx, mask);
+        return static_cast<uint32_t>(idx);
+#else
+        return 31U - static_cast<uint32_t>(__builtin_clz(mask));
+#endif
+    }
+
+    typedef const char* (*FindLineFeedFunc)(const char*, const char*);
+    typedef size_t (*FindAllLineFeedsFunc)(const char*, size_t, std::vector<int32_t>&);
+
+    struct LineFeedScanner {
+        const char* name;
+        FindLineFeedFunc findOne;
+        FindAllLineFeedsFunc findAll;
+        FindLineFeedFunc findLast;
+        FindLineFeedFunc findQuote;
+    };
+
+#if defined(LOGTAIL_LF_SCANNER_SSE2)
+    const char* FindLineFeedSSE2(const char* begin, const char* end) {
+        const __m128i lf = _mm_set1_epi8('\n');
+        const char* cur = begin;
+        for (; cur + 16 <= end; cur += 16) {
+            __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data, lf)));
+            if (mask != 0) {
+                return cur + CountTrailingZero32(mask);
+            }
+        }
+        return FindLineFeedScalar(cur, end);
+    }
+
+    const char* FindLastLineFeedSSE2(const char* begin, const char* end) {
+        const __m128i lf = _mm_set1_epi8('\n');
+        const char* cur = end;
+        for (; cur - begin >= 16; cur -= 16) {
+            __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur - 16));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data, lf)));
+            if (mask != 0) {
+                return cur - 16 + HighestBit32(mask);
+            }
+        }
+        const char* found = FindLastLineFeedScalar(begin, cur);
+        return found == cur ? end : found;
+    }
+
+    const char* FindQuoteOrBackslashSSE2(const char* begin, const char* end) {
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const char* cur = begin;
+        for (; cur + 16 <= end; cur += 16) {
+            __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+            __m128i cmp = _mm_or_si128(_mm_cmpeq_epi8(data, quote), _mm_cmpeq_epi8(data, backslash));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(cmp));
+            if (mask != 0) {
+                return cur + CountTrailingZero32(mask);
+            }
+        }
+        return FindQuoteOrBackslashScalar(cur, end);
+    }
+
+    size_t FindAllLineFeedsSSE2(const char* buffer, size_t size, std::vector<int32_t>& positions) {
+        const __m128i lf = _mm_set1_epi8('\n');
+        const size_t oldSize = positions.size();
+        size_t offset = 0;
+        for (; offset + 16 <= size; offset += 16) {
+            __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + offset));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data, lf)));
+            while (mask != 0) {
+                positions.push_back(static_cast<int32_t>(offset + CountTrailingZero32(mask)));
+                mask &= mask - 1;
+            }
+        }
+        for (; offset < size; ++offset) {
+            if (buffer[offset] == '\n') {
+                positions.push_back(static_cast<int32_t>(offset));
+            }
+        }
+        return positions.size() - oldSize;
+    }
+#endif
+
+#if defined(LOGTAIL_LF_SCANNER_AVX2)
+    __attribute__((target("avx2"))) const char* FindLineFeedAVX2(const char* begin, const char* end) {
+        const __m256i lf = _mm256_set1_epi8('\n');
+        const char* cur = begin;
+        for (; cur + 32 <= end; cur += 32) {
+            __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(data, lf)));
+            if (mask != 0) {
+                return cur + CountTrailingZero32(mask);
+            }
+        }
+        return FindLineFeedSSE2(cur, end);
+    }
+
+    __attribute__((target("avx2"))) const char* FindLastLineFeedAVX2(const char* begin, const char* end) {
+        const __m256i lf = _mm256_set1_epi8('\n');
+        const char* cur = end;
+        for (; cur - begin >= 32; cur -= 32) {
+            __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur - 32));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(data, lf)));
+            if (mask != 0) {
+                return cur - 32 + HighestBit32(mask);
+            }
+        }
+        const char* found = FindLastLineFeedSSE2(begin, cur);
+        return found == cur ? end : found;
+    }
+
+    __attribute__((target("avx2"))) const char* FindQuoteOrBackslashAVX2(const char* begin, const char* end) {
+        const __m256i quote = _mm256_set1_epi8('"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const char* cur = begin;
+        for (; cur + 32 <= end; cur += 32) {
+            __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cur));
+            __m256i cmp = _mm256_or_si256(_mm256_cmpeq_epi8(data, quote), _mm256_cmpeq_epi8(data, backslash));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(cmp));
+            if (mask != 0) {
+                return cur + CountTrailingZero32(mask);
+            }
+        }
+        return FindQuoteOrBackslashSSE2(cur, end);
+    }
+
+    __attribute__((target("avx2"))) size_t
+    FindAllLineFeedsAVX2(const char* buffer, size_t size, std::vector<int32_t>& positions) {
+        const __m256i lf = _mm256_set1_epi8('\n');
+        const size_t oldSize = positions.size();
+        size_t offset = 0;
+        for (; offset + 32 <= size; offset += 32) {
+            __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + offset));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(data, lf)));
+            while (mask != 0) {
+                positions.push_back(static_cast<int32_t>(offset + CountTrailingZero32(mask)));
+                mask &= mask - 1;
+            }
+        }
+        for (; offset < size; ++offset) {
+            if (buffer[offset] == '\n') {
+                positions.push_back(static_cast<int32_t>(offset));
+            }
+        }
+        return positions.size() - oldSize;
+    }
+#endif
+
+#if defined(LOGTAIL_LF_SCANNER_NEON)
+    // NEON has no movemask, narrow the compare result to 4 bits per byte instead.
+    inline uint64_t NeonLineFeedMask(const char* cur, uint8x16_t lf) {
+        uint8x16_t cmp = vceqq_u8(vld1q_u8(reinterpret_cast<const uint8_t*>(cur)), lf);
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)), 0);
+    }
+
+    const char* FindLineFeedNEON(const char* begin, const char* end) {
+        const uint8x16_t lf = vdupq_n_u8('\n');
+        const char* cur = begin;
+        for (; cur + 16 <= end; cur += 16) {
+            uint64_t mask = NeonLineFeedMask(cur, lf);
+            if (mask != 0) {
+                return cur + (__builtin_ctzll(mask) >> 2);
+            }
+        }
+        return FindLineFeedScalar(cur, end);
+    }
+
+    const char* FindLastLineFeedNEON(const char* begin, const char* end) {
+        const uint8x16_t lf = vdupq_n_u8('\n');
+        const char* cur = end;
+        for (; cur - begin >= 16; cur -= 16) {
+            uint64_t mask = NeonLineFeedMask(cur - 16, lf);
+            if (mask != 0) {
+                return cur - 16 + ((63 - __builtin_clzll(mask)) >> 2);
+            }
+        }
+        const char* found = FindLastLineFeedScalar(begin, cur);
+        return found == cur ? end : found;
+    }
+
+    const char* FindQuoteOrBackslashNEON(const char* begin, const char* end) {
+        const uint8x16_t quote = vdupq_n_u8('"');
+        const uint8x16_t backslash = vdupq_n_u8('\\');
+        const char* cur = begin;
+        for (; cur + 16 <= end; cur += 16) {
+            uint8x16_t data = vld1q_u8(reinterpret_cast<const uint8_t*>(cur));
+            uint8x16_t cmp = vorrq_u8(vceqq_u8(data, quote), vceqq_u8(data, backslash));
+            uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)), 0);
+            if (mask != 0) {
+                return cur + (__builtin_ctzll(mask) >> 2);
+            }
+        }
+        return FindQuoteOrBackslashScalar(cur, end);
+    }
+
+    size_t FindAllLineFeedsNEON(const char* buffer, size_t size, std::vector<int32_t>& positions) {
+        const uint8x16_t lf = vdupq_n_u8('\n');
+        const size_t oldSize = positions.size();
+        size_t offset = 0;
+        for (; offset + 16 <= size; offset += 16) {
+            uint64_t mask = NeonLineFeedMask(buffer + offset, lf);
+            while (mask != 0) {
+                uint32_t bit = static_cast<uint32_t>(__builtin_ctzll(mask));
+                positions.push_back(static_cast<int32_t>(offset + (bit >> 2)));
+                mask &= ~(0xFULL << (bit & ~3U));
+            }
+        }
+        for (; offset < size; ++offset) {
+            if (buffer[offset] == '\n') {
+                positions.push_back(static_cast<int32_t>(offset));
+            }
+        }
+        return positions.size() - oldSize;
+    }
+#endif
+
+    LineFeedScanner SelectLineFeedScanner() {
+#if defined(LOGTAIL_LF_SCANNER_AVX2)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return LineFeedScanner{"avx2",
+                                   FindLineFeedAVX2,
+                                   FindAllLineFeedsAVX2,
+                                   FindLastLineFeedAVX2,
+                                   FindQuoteOrBackslashAVX2};
+        }
+#endif
+#if defined(LOGTAIL_LF_SCANNER_SSE2)
+        return LineFeedScanner{"sse2",
+                               FindLineFeedSSE2,
+                               FindAllLineFeedsSSE2,
+                               FindLastLineFeedSSE2,
+                               FindQuoteOrBackslashSSE2};
+#elif defined(LOGTAIL_LF_SCANNER_NEON)
+        return LineFeedScanner{"neon",
+                               FindLineFeedNEON,
+                               FindAllLineFeedsNEON,
+                               FindLastLineFeedNEON,
+                               FindQuoteOrBackslashNEON};
+#else
+        return LineFeedScanner{"scalar",
+                               FindLineFeedScalar,
+                               FindAllLineFeedsScalar,
+                               FindLastLineFeedScalar,
+                               FindQuoteOrBackslashScalar};
+#endif
+    }
+
+    const LineFeedScanner& GetLineFeedScanner() {
+        static const LineFeedScanner sScanner = SelectLineFeedScanner();
+        return sScanner;
+    }
+
+} // namespace
+
+const char* FindLineFeedScalar(const char* begin, const char* end) {
+    while (begin < end && *begin != '\n') {
+        ++begin;
+    }
+    return begin;
+}
+
+const char* FindLastLineFeedScalar(const char* begin, const char* end) {
+    for (const char* cur = end; cur > begin;) {
+        if (*--cur == '\n') {
+            return cur;
+        }
+    }
+    return end;
+}
+
+size_t FindAllLineFeedsScalar(const char* buffer, size_t size, std::vector<int32_t>& positions) {
+    const size_t oldSize = positions.size();
+    for (size_t offset = 0; offset < size; ++offset) {
+        if (buffer[offset] == '\n') {
+            positions.push_back(static_cast<int32_t>(offset));
+        }
+    }
+    return positions.size() - oldSize;
+}
+
+const char* FindQuoteOrBackslashScalar(const char* begin, const char* end) {
+    while (begin < end && *begin != '"' && *begin != '\\') {
+        ++begin;
+    }
+    return begin;
+}
+
+const char* FindLineFeed(const char* begin, const char* end) {
+    return GetLineFeedScanner().findOne(begin, end);
+}
+
+const char* FindLastLineFeed(const char* begin, const char* end) {
+    return GetLineFeedScanner().findLast(begin, end);
+}
+
+size_t FindAllLineFeeds(const char* buffer, size_t size, std::vector<int32_t>& positions) {
+    return GetLineFeedScanner().findAll(buffer, size, positions);
+}
+
+const char* FindQuoteOrBackslash(const char* begin, const char* end) {
+    return GetLineFeedScanner().findQuote(begin, end);
+}
+
+const char* GetLineFeedScannerName() {
+    return GetLineFeedScanner().name;
+}
+
+} // namespace logtail
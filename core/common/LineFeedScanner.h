@@ -0,0 +1,52 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Vectorized '\n' scanning used by readers to split buffers into lines.
+// Implementation (AVX2/SSE2/NEON/scalar) is selected once at runtime according
+// to the features supported by current CPU.
+namespace logtail {
+
+// FindLineFeed returns the first '\n' in [@begin, @end), or @end if not found.
+const char* FindLineFeed(const char* begin, const char* end);
+
+// FindLastLineFeed returns the last '\n' in [@begin, @end), or @end if not found.
+const char* FindLastLineFeed(const char* begin, const char* end);
+
+// FindAllLineFeeds appends offsets (relative to @buffer) of all '\n' in
+// [@buffer, @buffer + @size) to @positions.
+// @return the number of line feeds found.
+size_t FindAllLineFeeds(const char* buffer, size_t size, std::vector<int32_t>& positions);
+
+// FindQuoteOrBackslash returns the first '"' or '\\' in [@begin, @end), or @end if not found, it finds the end
+// of JSON strings and escapes in them.
+const char* FindQuoteOrBackslash(const char* begin, const char* end);
+
+// GetLineFeedScannerName returns the name of selected implementation:
+// avx2, sse2, neon or scalar.
+const char* GetLineFeedScannerName();
+
+// Byte-by-byte implementation, the baseline for UT and benchmark.
+const char* FindLineFeedScalar(const char* begin, const char* end);
+const char* FindLastLineFeedScalar(const char* begin, const char* end);
+size_t FindAllLineFeedsScalar(const char* buffer, size_t size, std::vector<int32_t>& positions);
+const char* FindQuoteOrBackslashScalar(const char* begin, const char* end);
+
+} // namespace logtail
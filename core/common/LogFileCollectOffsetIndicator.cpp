@@ -30,18 +30,19 @@ DEFINE_FLAG_INT32(default_fuse_file_header_length, "default fuse file header len
 
 namespace logtail {
 
+void LogFileOffsetInfo::AddNode(const LogFileOffsetInfoNode& node) {
+    // Sequence numbers are assigned in emit order, so the node goes to the end in most cases.
+    mLogFileOffsetInfoNodes.emplace_hint(mLogFileOffsetInfoNodes.end(), node.mSequenceNum, node);
+}
+
 void LogFileOffsetInfo::SetSendFlag(int64_t seqNum) {
-    // set init flag to false
-    for (std::deque<LogFileOffsetInfoNode>::iterator iter = mLogFileOffsetInfoQueue.begin();
-         iter != mLogFileOffsetInfoQueue.end();
-         ++iter) {
-        if (seqNum == iter->mSequenceNum) {
-            iter->mSendFlag = true;
-            LOG_DEBUG(sLogger,
-                      ("set status, seq num", seqNum)("project", mLogFileInfo.mProjectName)(
-                          "log store", mLogFileInfo.mLogstore)("filename", mLogFileInfo.mFilename));
-            return;
-        }
+    std::map<int64_t, LogFileOffsetInfoNode>::iterator iter = mLogFileOffsetInfoNodes.find(seqNum);
+    if (iter != mLogFileOffsetInfoNodes.end()) {
+        iter->second.mSendFlag = true;
+        LOG_DEBUG(sLogger,
+                  ("set status, seq num", seqNum)("project", mLogFileInfo.mProjectName)(
+                      "log store", mLogFileInfo.mLogstore)("filename", mLogFileInfo.mFilename));
+        return;
     }
     LOG_ERROR(sLogger,
               ("failed to find seq num", seqNum)("project", mLogFileInfo.mProjectName)(
@@ -49,35 +50,36 @@ void LogFileOffsetInfo::SetSendFlag(int64_t seqNum) {
 }
 
 bool LogFileOffsetInfo::CalcOffset(int64_t& offset, int64_t& len, int64_t& filePos, int64_t& readPos, int64_t& size) {
-    if (mLogFileOffsetInfoQueue.empty())
+    if (mLogFileOffsetInfoNodes.empty())
         return false;
 
-    std::deque<LogFileOffsetInfoNode>::iterator iter = mLogFileOffsetInfoQueue.begin();
-    for (; iter != mLogFileOffsetInfoQueue.end(); ++iter) {
+    std::map<int64_t, LogFileOffsetInfoNode>::iterator nodeIter = mLogFileOffsetInfoNodes.begin();
+    for (; nodeIter != mLogFileOffsetInfoNodes.end(); ++nodeIter) {
+        const LogFileOffsetInfoNode& node = nodeIter->second;
         // succeeded node
-        if (iter->mSendFlag) {
+        if (node.mSendFlag) {
             LOG_DEBUG(sLogger,
                       ("find succeeded node, seq num",
-                       iter->mSequenceNum)("project", mLogFileInfo.mProjectName)("log store", mLogFileInfo.mLogstore)(
-                          "filename", mLogFileInfo.mFilename)("offset", iter->mOffset)("len", iter->mLen));
-            offset = iter->mOffset;
-            len = iter->mLen;
-            filePos = iter->mFileLastPos;
-            readPos = iter->mFileReadPos;
-            size = iter->mFileSize;
+                       node.mSequenceNum)("project", mLogFileInfo.mProjectName)("log store", mLogFileInfo.mLogstore)(
+                          "filename", mLogFileInfo.mFilename)("offset", node.mOffset)("len", node.mLen));
+            offset = node.mOffset;
+            len = node.mLen;
+            filePos = node.mFileLastPos;
+            readPos = node.mFileReadPos;
+            size = node.mFileSize;
         }
         // meet first failed node or init node(flag false), break
         else {
             LOG_DEBUG(sLogger,
                       ("find failed or init node, seq num",
-                       iter->mSequenceNum)("project", mLogFileInfo.mProjectName)("log store", mLogFileInfo.mLogstore)(
-                          "filename", mLogFileInfo.mFilename)("offset", iter->mOffset)("len", iter->mLen));
+                       node.mSequenceNum)("project", mLogFileInfo.mProjectName)("log store", mLogFileInfo.mLogstore)(
+                          "filename", mLogFileInfo.mFilename)("offset", node.mOffset)("len", node.mLen));
             break;
         }
     }
 
     // erase nodes from begin to first failed node(or end iterator)
-    mLogFileOffsetInfoQueue.erase(mLogFileOffsetInfoQueue.begin(), iter);
+    mLogFileOffsetInfoNodes.erase(mLogFileOffsetInfoNodes.begin(), nodeIter);
     return true;
 }
 
@@ -89,9 +91,9 @@ LogFileCollectOffsetIndicator::~LogFileCollectOffsetIndicator() {
 }
 
 void LogFileCollectOffsetIndicator::RecordFileOffset(LoggroupTimeValue* data) {
-    const std::string& project = data->mProjectName;
-    const std::string& logstore = data->mLogstore;
-    const std::string& configName = data->mConfigName;
+    const InternedString& project = data->mProjectName;
+    const InternedString& logstore = data->mLogstore;
+    const InternedString& configName = data->mConfigName;
     const std::string& filename = data->mFilename;
     int64_t seqNum = data->mLogGroupContext.mSeqNum;
 
@@ -105,14 +107,7 @@ void LogFileCollectOffsetIndicator::RecordFileOffset(LoggroupTimeValue* data) {
     LogFileInfo logFileInfo(project, logstore, configName, filename, devInode, data->mLogGroupContext.mFuseMode);
     LogFileOffsetInfoMap::iterator iter = mLogFileOffsetInfoMap.find(logFileInfo);
     if (iter == mLogFileOffsetInfoMap.end()) {
-        LogFileOffsetInfo* logFileOffsetInfo = new LogFileOffsetInfo(project,
-                                                                     logstore,
-                                                                     configName,
-                                                                     filename,
-                                                                     devInode,
-                                                                     data->mLogGroupContext.mFuseMode,
-                                                                     fd,
-                                                                     data->mLastUpdateTime);
+        LogFileOffsetInfo* logFileOffsetInfo = new LogFileOffsetInfo(logFileInfo, fd, data->mLastUpdateTime);
         iter = mLogFileOffsetInfoMap.insert(std::make_pair(logFileInfo, logFileOffsetInfo)).first;
     }
     LogFileOffsetInfo* logFileOffsetInfo = iter->second;
@@ -124,7 +119,7 @@ void LogFileCollectOffsetIndicator::RecordFileOffset(LoggroupTimeValue* data) {
                                fileInfoPtr->filePos,
                                fileInfoPtr->readPos,
                                fileInfoPtr->fileSize);
-    logFileOffsetInfo->mLogFileOffsetInfoQueue.push_back(node);
+    logFileOffsetInfo->AddNode(node);
 
     LOG_DEBUG(sLogger,
               ("insert sparse file info into map, project", project)("log store", logstore)("filename", filename)(
@@ -133,9 +128,9 @@ void LogFileCollectOffsetIndicator::RecordFileOffset(LoggroupTimeValue* data) {
 }
 
 void LogFileCollectOffsetIndicator::NotifySuccess(const LoggroupTimeValue* data) {
-    const std::string& project = data->mProjectName;
-    const std::string& logstore = data->mLogstore;
-    const std::string& configName = data->mConfigName;
+    const InternedString& project = data->mProjectName;
+    const InternedString& logstore = data->mLogstore;
+    const InternedString& configName = data->mConfigName;
     const std::string& filename = data->mFilename;
     int64_t seqNum = data->mLogGroupContext.mSeqNum;
 
@@ -209,9 +204,9 @@ void LogFileCollectOffsetIndicator::ClearAllFileOffset() {
     }
 }
 
-bool LogFileCollectOffsetIndicator::FindLogFileOffsetInfo(const std::string& project,
-                                                          const std::string& logstore,
-                                                          const std::string& configName,
+bool LogFileCollectOffsetIndicator::FindLogFileOffsetInfo(const InternedString& project,
+                                                          const InternedString& logstore,
+                                                          const InternedString& configName,
                                                           const std::string& filename,
                                                           const DevInode& devInode,
                                                           bool fuseMode,
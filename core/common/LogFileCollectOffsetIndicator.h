@@ -23,6 +23,7 @@
 #include "common/Lock.h"
 #include "common/DevInode.h"
 #include "common/StringTools.h"
+#include "common/StringInterner.h"
 #include "FileInfo.h"
 #include "util.h"
 
@@ -51,10 +52,12 @@ struct LogFileOffsetInfoNode {
     int64_t mFileSize;
 };
 
+// Project, logstore and config are interned, so they are compared and hashed by ID. Filenames are not, as
+// they are not bounded.
 struct LogFileInfo {
-    LogFileInfo(const std::string& project,
-                const std::string& logstore,
-                const std::string& configName,
+    LogFileInfo(const InternedString& project,
+                const InternedString& logstore,
+                const InternedString& configName,
                 const std::string& filename,
                 DevInode devInode,
                 bool fuseMode)
@@ -65,26 +68,6 @@ struct LogFileInfo {
           mDevInode(devInode),
           mFuseMode(fuseMode) {}
 
-    LogFileInfo(const LogFileInfo& rhs)
-        : mProjectName(rhs.mProjectName),
-          mLogstore(rhs.mLogstore),
-          mConfigName(rhs.mConfigName),
-          mFilename(rhs.mFilename),
-          mDevInode(rhs.mDevInode),
-          mFuseMode(rhs.mFuseMode) {}
-
-    LogFileInfo& operator=(const LogFileInfo& rhs) {
-        if (this != &rhs) {
-            mProjectName = rhs.mProjectName;
-            mLogstore = rhs.mLogstore;
-            mConfigName = rhs.mConfigName;
-            mFilename = rhs.mFilename;
-            mDevInode = rhs.mDevInode;
-            mFuseMode = rhs.mFuseMode;
-        }
-        return *this;
-    }
-
     bool operator==(const LogFileInfo& rhs) const {
         return mProjectName == rhs.mProjectName && mLogstore == rhs.mLogstore && mConfigName == rhs.mConfigName
             && mFilename == rhs.mFilename;
@@ -93,9 +76,9 @@ struct LogFileInfo {
     struct LogFileInfoHash {
         size_t operator()(const LogFileInfo& info) const {
             size_t seed = 0;
-            boost::hash_combine(seed, boost::hash_value(info.mProjectName));
-            boost::hash_combine(seed, boost::hash_value(info.mLogstore));
-            boost::hash_combine(seed, boost::hash_value(info.mConfigName));
+            boost::hash_combine(seed, info.mProjectName.Id());
+            boost::hash_combine(seed, info.mLogstore.Id());
+            boost::hash_combine(seed, info.mConfigName.Id());
             boost::hash_combine(seed, boost::hash_value(info.mFilename));
             return seed;
         }
@@ -103,11 +86,11 @@ struct LogFileInfo {
 
     std::string ToString() const {
         std::string str;
-        return str.append(mProjectName)
+        return str.append(mProjectName.Str())
             .append("_")
-            .append(mLogstore)
+            .append(mLogstore.Str())
             .append("_")
-            .append(mConfigName)
+            .append(mConfigName.Str())
             .append("_")
             .append(mFilename)
             .append("_")
@@ -116,9 +99,9 @@ struct LogFileInfo {
             .append(logtail::ToString(mDevInode.inode));
     }
 
-    std::string mProjectName;
-    std::string mLogstore;
-    std::string mConfigName;
+    InternedString mProjectName;
+    InternedString mLogstore;
+    InternedString mConfigName;
     std::string mFilename;
 
     DevInode mDevInode;
@@ -128,16 +111,10 @@ struct LogFileInfo {
 // record all sparse info, erase item after calc sparse offset and length
 class LogFileOffsetInfo {
 public:
-    LogFileOffsetInfo(const std::string& project,
-                      const std::string& logstore,
-                      const std::string configName,
-                      const std::string& filename,
-                      const DevInode& devInode,
-                      bool fuseMode,
-                      int fd,
-                      int32_t curTime)
-        : mLogFileInfo(project, logstore, configName, filename, devInode, fuseMode), mFd(fd), mLastUpdateTime(-1) {}
+    LogFileOffsetInfo(const LogFileInfo& logFileInfo, int fd, int32_t curTime)
+        : mLogFileInfo(logFileInfo), mFd(fd), mLastUpdateTime(-1) {}
 
+    void AddNode(const LogFileOffsetInfoNode& node);
     void SetSendFlag(int64_t seqNum); // send send flag to true
     bool CalcOffset(int64_t& offset, int64_t& len, int64_t& filePos, int64_t& readPos, int64_t& size);
 
@@ -155,7 +132,9 @@ public:
     LogFileInfo mLogFileInfo;
     int mFd;
 
-    std::deque<LogFileOffsetInfoNode> mLogFileOffsetInfoQueue;
+    // Nodes in flight ordered by sequence number, so a completion is found and the sent prefix is advanced
+    // in O(log n) however many nodes are in flight.
+    std::map<int64_t, LogFileOffsetInfoNode> mLogFileOffsetInfoNodes;
     int32_t mLastUpdateTime;
 };
 
@@ -217,9 +196,9 @@ private:
     ~LogFileCollectOffsetIndicator();
 
     void ClearAllFileOffset();
-    bool FindLogFileOffsetInfo(const std::string& project,
-                               const std::string& logstore,
-                               const std::string& configName,
+    bool FindLogFileOffsetInfo(const InternedString& project,
+                               const InternedString& logstore,
+                               const InternedString& configName,
                                const std::string& filename,
                                const DevInode& devInode,
                                bool fuseMode,
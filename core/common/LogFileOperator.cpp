@@ -17,11 +17,21 @@
 #include <io.h>
 #include <fcntl.h>
 #endif
+#include <algorithm>
+#include <cstring>
+#include "DecompressStream.h"
 #include "FileSystemUtil.h"
 #include "fuse/ulogfslib_file.h"
 
 namespace logtail {
 
+LogFileOperator::LogFileOperator(bool fuseMode) : mFuseMode(fuseMode) {
+}
+
+LogFileOperator::~LogFileOperator() {
+    Close();
+}
+
 int LogFileOperator::Open(const char* path, bool fuseMode) {
     if (!path || IsOpen()) {
         return -1;
@@ -37,7 +47,7 @@ int LogFileOperator::Open(const char* path, bool fuseMode) {
                                 FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
                                 NULL,
                                 OPEN_EXISTING,
-                                FILE_ATTRIBUTE_NORMAL,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_OVERLAPPED,
                                 NULL);
         if (INVALID_HANDLE_VALUE == hFile) {
             return -1;
@@ -112,22 +122,150 @@ int LogFileOperator::Pread(void* ptr, size_t size, size_t count, int64_t offset)
         return ulogfs_pread2(mFd, NULL, ptr, size * count, (off_t*)&offset);
     } else {
 #if defined(_MSC_VER)
-        LARGE_INTEGER liPos;
-        liPos.QuadPart = offset;
-        if (FALSE == SetFilePointerEx(mFile, liPos, NULL, FILE_BEGIN)) {
+        // The handle is overlapped, the offset goes with the read and it waits for completion.
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(offset) >> 32);
+        DWORD dwRead = 0;
+        if (FALSE == ::ReadFile(mFile, ptr, static_cast<DWORD>(size * count), NULL, &overlapped)
+            && GetLastError() != ERROR_IO_PENDING) {
             return 0;
         }
-        DWORD dwRead = 0;
-        if (FALSE == ::ReadFile(mFile, ptr, size * count, &dwRead, NULL)) {
+        if (FALSE == GetOverlappedResult(mFile, &overlapped, &dwRead, TRUE)) {
             return 0;
         }
         return static_cast<int>(dwRead);
 #else
-        return pread(mFd, ptr, size * count, offset);
+        if (mDecompressStream) {
+            return mDecompressStream->Read(static_cast<char*>(ptr), size * count, offset);
+        }
+        return RawPread(static_cast<char*>(ptr), size * count, offset);
 #endif
     }
 }
 
+void LogFileOperator::WillNeed(int64_t offset, int64_t length) {
+#if defined(__linux__)
+    if (mFuseMode || !IsOpen() || length <= 0 || mDecompressStream) {
+        return;
+    }
+    posix_fadvise(mFd, offset, length, POSIX_FADV_WILLNEED);
+#endif
+}
+
+bool LogFileOperator::IsBatchReadable() const {
+#if defined(__linux__) || defined(_MSC_VER)
+    return !mFuseMode && mMmapWindowSize == 0 && !mDecompressStream && IsOpen();
+#else
+    return false;
+#endif
+}
+
+bool LogFileOperator::EnableMmapRead(size_t windowSize) {
+#if defined(__linux__)
+    if (mFuseMode) {
+        return false;
+    }
+    UnmapWindow();
+    mMmapWindowSize = windowSize;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LogFileOperator::EnableDecompression() {
+#if defined(__linux__)
+    if (mFuseMode || !IsOpen()) {
+        return false;
+    }
+    char head[4];
+    const int nbytes = RawPread(head, sizeof(head), 0);
+    const DecompressStream::Format format = DecompressStream::DetectFormat(head, nbytes > 0 ? nbytes : 0);
+    if (format == DecompressStream::FORMAT_NONE) {
+        return false;
+    }
+    mDecompressStream.reset(new DecompressStream(
+        format, [this](char* buf, size_t size, int64_t offset) { return RawPread(buf, size, offset); }));
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if defined(__linux__)
+int LogFileOperator::RawPread(char* ptr, size_t length, int64_t offset) {
+    if (mMmapWindowSize > 0) {
+        return MmapPread(ptr, length, offset);
+    }
+    return pread(mFd, ptr, length, offset);
+}
+
+int LogFileOperator::MmapPread(char* ptr, size_t length, int64_t offset) {
+    size_t copied = 0;
+    while (copied < length) {
+        const int64_t cur = offset + static_cast<int64_t>(copied);
+        if (mMapAddr == NULL || cur < mMapOffset || cur >= mMapOffset + static_cast<int64_t>(mMapLength)) {
+            int ret = RemapWindow(cur);
+            if (ret == 0) {
+                break;
+            }
+            if (ret < 0) {
+                // Fall back to pread for the rest, such as mmap is not supported by file system.
+                ssize_t nbytes = pread(mFd, ptr + copied, length - copied, cur);
+                if (nbytes < 0) {
+                    return copied > 0 ? static_cast<int>(copied) : -1;
+                }
+                copied += nbytes;
+                break;
+            }
+        }
+        const size_t available = static_cast<size_t>(mMapOffset + static_cast<int64_t>(mMapLength) - cur);
+        const size_t n = std::min(available, length - copied);
+        memcpy(ptr + copied, mMapAddr + (cur - mMapOffset), n);
+        copied += n;
+    }
+    return static_cast<int>(copied);
+}
+
+int LogFileOperator::RemapWindow(int64_t offset) {
+    UnmapWindow();
+    struct stat st;
+    if (fstat(mFd, &st) != 0) {
+        return -1;
+    }
+    if (offset >= st.st_size) {
+        return 0;
+    }
+    static const int64_t sPageSize = sysconf(_SC_PAGESIZE);
+    const int64_t mapOffset = offset / sPageSize * sPageSize;
+    const size_t mapLength
+        = static_cast<size_t>(std::min(static_cast<int64_t>(mMmapWindowSize), st.st_size - mapOffset));
+    if (mapLength <= static_cast<size_t>(offset - mapOffset)) {
+        return -1;
+    }
+    void* addr = mmap(NULL, mapLength, PROT_READ, MAP_SHARED, mFd, mapOffset);
+    if (addr == MAP_FAILED) {
+        return -1;
+    }
+    madvise(addr, mapLength, MADV_SEQUENTIAL);
+    mMapAddr = static_cast<char*>(addr);
+    mMapOffset = mapOffset;
+    mMapLength = mapLength;
+    return 1;
+}
+
+void LogFileOperator::UnmapWindow() {
+    if (mMapAddr != NULL) {
+        munmap(mMapAddr, mMapLength);
+        mMapAddr = NULL;
+        mMapOffset = 0;
+        mMapLength = 0;
+    }
+}
+#endif
+
 size_t LogFileOperator::SkipHoleRead(void* ptr, size_t size, size_t count, int64_t* offset) {
     if (!mFuseMode || !ptr || !size || !count || !IsOpen()) {
         return 0;
@@ -172,6 +310,9 @@ int64_t LogFileOperator::GetFileSize() const {
         }
         return static_cast<int64_t>(liSize.QuadPart);
 #else
+        if (mDecompressStream) {
+            return mDecompressStream->GetSize();
+        }
         return static_cast<int64_t>(lseek(mFd, 0, SEEK_END));
 #endif
     }
@@ -194,6 +335,8 @@ int LogFileOperator::Close() {
         ret = (TRUE == CloseHandle(mFile)) ? 0 : -1;
         mFile = INVALID_HANDLE_VALUE;
 #else
+        mDecompressStream.reset();
+        UnmapWindow();
         ret = close(mFd);
 #endif
     }
@@ -18,6 +18,7 @@
 #include <cstdio>
 #include <string>
 #include <cstdint>
+#include <memory>
 #if defined(_MSC_VER)
 #include <Windows.h>
 #elif defined(__linux__)
@@ -25,18 +26,21 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #endif
 
 namespace logtail {
 
+class DecompressStream;
+
 namespace fsutil {
     class PathStat;
 }
 
 class LogFileOperator {
 public:
-    LogFileOperator(bool fuseMode = false) : mFuseMode(fuseMode) {}
-    ~LogFileOperator() { Close(); }
+    LogFileOperator(bool fuseMode = false);
+    ~LogFileOperator();
 
     // @return file descriptor when fuseMode is enabled or on Linux.
     //   An positve identifier is returned on Windows.
@@ -48,6 +52,32 @@ public:
 
     int Pread(void* ptr, size_t size, size_t count, int64_t offset);
 
+    // EnableMmapRead makes Pread copy from a sliding read-only mapping of
+    // @windowSize bytes instead of calling pread, windows are advised as
+    // sequential. Only for files that will not be truncated while reading
+    // (such as history files), otherwise access to the mapping raises SIGBUS.
+    // @return false if mmap read is not supported (Windows or fuse mode).
+    bool EnableMmapRead(size_t windowSize);
+
+    // EnableDecompression makes Pread and GetFileSize work on the decompressed content if the file is
+    // gzip or zstd, offsets are all uncompressed ones. Reads are sequential, a read before the current
+    // position decompresses from the beginning again unless it is in the first KB.
+    // @return false if the file is not compressed, or on Windows or fuse mode.
+    bool EnableDecompression();
+    bool IsDecompressing() const { return mDecompressStream != nullptr; }
+
+    // WillNeed advises the kernel to read [@offset, @offset + @length) ahead, no-op on Windows or fuse mode.
+    void WillNeed(int64_t offset, int64_t length);
+
+    // IsBatchReadable returns true if the fd can be read by BatchRead with the same result as Pread,
+    // false on fuse mode, mmap read or decompression.
+    bool IsBatchReadable() const;
+
+#if defined(_MSC_VER)
+    // GetHandle returns the handle opened for overlapped reads, INVALID_HANDLE_VALUE in fuse mode.
+    HANDLE GetHandle() const { return mFile; }
+#endif
+
     // For FUSE only.
     size_t SkipHoleRead(void* ptr, size_t size, size_t count, int64_t* offset);
 
@@ -70,15 +100,31 @@ private:
     LogFileOperator(const LogFileOperator&) = delete;
     LogFileOperator& operator=(const LogFileOperator&) = delete;
 
+#if defined(__linux__)
+    int RawPread(char* ptr, size_t length, int64_t offset);
+    int MmapPread(char* ptr, size_t length, int64_t offset);
+    // @return 1 if window covers @offset, 0 if @offset is not less than file size, -1 on error.
+    int RemapWindow(int64_t offset);
+    void UnmapWindow();
+#endif
+
 private:
     // We have to use HANDLE on Windows to support more simultaneous opened files,
-    // which is limit by C runtime (8192 file descriptors at most).
+    // which is limit by C runtime (8192 file descriptors at most). It is opened for
+    // overlapped reads, so reads take the offset and never move the file pointer.
 #if defined(_MSC_VER)
     HANDLE mFile = INVALID_HANDLE_VALUE;
 #endif
     int mFd = -1;
     bool mFuseMode;
 
+    size_t mMmapWindowSize = 0;
+    char* mMapAddr = NULL;
+    int64_t mMapOffset = 0;
+    size_t mMapLength = 0;
+
+    std::unique_ptr<DecompressStream> mDecompressStream;
+
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class LogFileOperatorUnittest;
 #endif
@@ -22,6 +22,15 @@
 
 namespace logtail {
 
+// PipelineTimestamps records when data passes each stage of the pipeline, in ms of the monotonic
+// clock (GetSteadyTimeInMilliSeconds), 0 means the stage is not recorded.
+struct PipelineTimestamps {
+    uint64_t mReadTimeInMs = 0; // read from file
+    uint64_t mAggregateTimeInMs = 0; // merge item created in aggregator
+    uint64_t mEnqueueTimeInMs = 0; // first pushed into sender queue
+    uint64_t mSendTimeInMs = 0; // last send request started
+};
+
 // store context info according to log group, may be used in closure callback
 struct LogGroupContext {
     LogGroupContext(const std::string& region = "",
@@ -66,6 +75,13 @@ struct LogGroupContext {
     bool mMarkOffsetFlag;
 
     RangeCheckpointPtr mExactlyOnceCheckpoint;
+
+    PipelineTimestamps mTimestamps;
+
+    // HashWithSeed of source id precomputed by reader, 0 means the aggregator hashes source id itself.
+    uint64_t mSourceIdKey = 0;
+    // Metric logs emitted by log_to_metric, they are neither filtered nor aggregated again.
+    bool mLogToMetricOutput = false;
 };
 
 } // namespace logtail
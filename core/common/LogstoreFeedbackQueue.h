@@ -23,6 +23,8 @@
 #include "MemoryBarrier.h"
 #include "Lock.h"
 #include "QueueManager.h"
+#include "TimeUtil.h"
+#include "CpuQuotaTable.h"
 
 #define MAX_CONFIG_PRIORITY_LEVEL (3)
 
@@ -151,8 +153,30 @@ public:
         return rst;
     }
 
+    // Pop at most @maxCount items and append them to @items.
+    //
+    // @return: same as PopItem, 2 if the queue becomes valid during popping.
+    int PopItems(std::vector<TT>& items, size_t maxCount) {
+        int rst = 0;
+        TT item;
+        while (items.size() < maxCount) {
+            int ret = PopItem(item);
+            if (ret == 0) {
+                break;
+            }
+            items.push_back(item);
+            if (ret > rst) {
+                rst = ret;
+            }
+        }
+        return rst;
+    }
+
     size_t GetSize() const { return mSize; }
 
+    // GetCredit returns how many items can be pushed before the queue becomes invalid.
+    size_t GetCredit() const { return mValid && mSize < HIGH_SIZE ? HIGH_SIZE - mSize : 0; }
+
     QueueType GetQueueType() const { return mType; }
 
 protected:
@@ -437,6 +461,92 @@ public:
         return rst != 0;
     }
 
+    // Batch version of CheckAndPopNextItem, pops at most @maxCount items of the
+    // same logstore in one lock acquisition, @items is cleared at first.
+    bool CheckAndPopNextItems(LogstoreFeedBackKey& startKey,
+                              std::vector<T>& items,
+                              size_t maxCount,
+                              LogstoreFeedBackInterface* pCheckObj,
+                              int32_t threadNo,
+                              int32_t threadNum) {
+        items.clear();
+        if (pCheckObj == NULL || maxCount == 0) {
+            return false;
+        }
+
+        int rst = 0;
+        do {
+            PTScopedLock dataLock(mLock);
+            if (mLogstoreQueueMap.empty()) {
+                return false;
+            }
+
+            // Iterate queues by priority at first.
+            for (size_t i = 0; i < MAX_CONFIG_PRIORITY_LEVEL; ++i) {
+                for (LogstoreFeedBackQueueVectorIterator iter = mPriorityQueueArray[i].begin();
+                     iter != mPriorityQueueArray[i].end();
+                     ++iter) {
+                    if (!CanPopItem(threadNo, threadNum, pCheckObj, iter->mKey, *(iter->mQueue))) {
+                        continue;
+                    }
+
+                    rst = iter->mQueue->PopItems(items, maxCount);
+                    if (rst == 0) {
+                        continue;
+                    }
+                    if (rst == 2 && mFeedBackObj != NULL) {
+                        mFeedBackObj->FeedBack(iter->mKey);
+                    }
+                    return true;
+                }
+            }
+
+            // Iterate queues, startKey is used for fairness.
+            LogstoreFeedBackQueueMapIterator startKeyIter = mLogstoreQueueMap.find(startKey);
+            if (startKeyIter == mLogstoreQueueMap.end()) {
+                startKeyIter = mLogstoreQueueMap.begin();
+            } else {
+                ++startKeyIter;
+            }
+
+            // Range: the key of last poped item -> end.
+            for (auto iter = startKeyIter; iter != mLogstoreQueueMap.end(); ++iter) {
+                if (!CanPopItem(threadNo, threadNum, pCheckObj, iter->first, iter->second)) {
+                    continue;
+                }
+
+                rst = iter->second.PopItems(items, maxCount);
+                if (rst == 0) {
+                    continue;
+                }
+                startKey = iter->first;
+                break;
+            }
+            if (rst != 0) {
+                break;
+            }
+
+            // Range: begin -> the key of last poped item.
+            for (auto iter = mLogstoreQueueMap.begin(); iter != startKeyIter; ++iter) {
+                if (!CanPopItem(threadNo, threadNum, pCheckObj, iter->first, iter->second)) {
+                    continue;
+                }
+
+                rst = iter->second.PopItems(items, maxCount);
+                if (rst == 0) {
+                    continue;
+                }
+                startKey = iter->first;
+                break;
+            }
+        } while (false);
+
+        if (rst == 2 && mFeedBackObj != NULL) {
+            mFeedBackObj->FeedBack(startKey);
+        }
+        return rst != 0;
+    }
+
     bool IsEmpty() {
         PTScopedLock dataLock(mLock);
         for (LogstoreFeedBackQueueMapIterator iter = mLogstoreQueueMap.begin(); iter != mLogstoreQueueMap.end();
@@ -523,6 +633,9 @@ public:
         }
     }
 
+    // CPU quotas of queues, queues which have used up their quotas are not popped.
+    CpuQuotaTable& GetCpuQuotas() { return mCpuQuotas; }
+
     void ConvertToExactlyOnceQueue(const LogstoreFeedBackKey& key) {
         PTScopedLock dataLock(mLock);
         mLogstoreQueueMap[key].SetType(QueueType::ExactlyOnce);
@@ -533,6 +646,7 @@ protected:
     TriggerEvent mTrigger;
     LogstoreFeedBackInterface* mFeedBackObj;
     LogstoreFeedBackQueueMap mLogstoreQueueMap;
+    CpuQuotaTable mCpuQuotas;
     LogstoreFeedBackQueueVector mPriorityQueueArray[MAX_CONFIG_PRIORITY_LEVEL];
 
 private:
@@ -540,11 +654,14 @@ private:
                     int32_t threadNum,
                     LogstoreFeedBackInterface* checkObj,
                     const LogstoreFeedBackKey& key,
-                    SingleLogStoreQueue& queue) const {
+                    SingleLogStoreQueue& queue) {
         // For each exactly once queue, only one thread can process it.
         if (queue.GetQueueType() == QueueType::ExactlyOnce && (key % threadNum != threadNo)) {
             return false;
         }
+        if (!mCpuQuotas.Empty() && mCpuQuotas.IsExceeded(key, GetSteadyTimeInMilliSeconds())) {
+            return false;
+        }
         return checkObj->IsValidToPush(key);
     }
 
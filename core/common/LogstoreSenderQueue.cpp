@@ -36,9 +36,29 @@ DEFINE_FLAG_INT32(client_send_concurrency_trigger,
 DEFINE_FLAG_INT32(client_send_concurrency_max, "max concurrency of one client", 512);
 DEFINE_FLAG_INT32(client_send_concurrency_max_update_time, "max update time seconds", 300);
 DEFINE_FLAG_DOUBLE(client_quota_send_retry_interval_scale, "", 2.0);
+DEFINE_FLAG_INT32(send_retry_backoff_base_ms,
+                  "first backoff of failed log groups before retry, doubled by each failure of logstore, 0 to disable",
+                  100);
+DEFINE_FLAG_INT32(send_retry_backoff_max_ms, "max backoff of failed log groups before retry", 10 * 1000);
+DEFINE_FLAG_INT32(sender_queue_shrink_min_slack_bytes,
+                  "payload of log groups pushed to sender queue is shrunk if unused capacity exceeds it, -1 to disable",
+                  4096);
 
 namespace logtail {
 
+void LoggroupTimeValue::ShrinkLogData() {
+    const int32_t minSlack = INT32_FLAG(sender_queue_shrink_min_slack_bytes);
+    if (minSlack < 0 || mLogData.capacity() - mLogData.size() <= static_cast<size_t>(minSlack)) {
+        return;
+    }
+    mLogData.shrink_to_fit();
+}
+
+size_t LoggroupTimeValue::MemoryUsage() const {
+    return sizeof(LoggroupTimeValue) + mLogData.capacity() + mFilename.capacity() + mTruncateInfo.capacity()
+        + mShardHashKey.capacity();
+}
+
 LogstoreSenderInfo::LogstoreSenderInfo()
     : mLastNetworkErrorCount(0),
       mLastQuotaExceedCount(0),
@@ -48,7 +68,8 @@ LogstoreSenderInfo::LogstoreSenderInfo()
       mQuotaRetryInterval((double)INT32_FLAG(client_quota_send_retry_interval)),
       mNetworkValidFlag(true),
       mQuotaValidFlag(true),
-      mSendConcurrency(INT32_FLAG(client_send_concurrency_max)) {
+      mSendConcurrency(INT32_FLAG(client_send_concurrency_max)),
+      mRetryBackoffMs(0) {
     mSendConcurrencyUpdateTime = time(NULL);
 }
 
@@ -102,6 +123,7 @@ bool LogstoreSenderInfo::RecordSendResult(SendResult rst, LogstoreSenderStatisti
             mQuotaValidFlag = true;
             mNetworkRetryInterval = (double)INT32_FLAG(client_disable_send_retry_interval);
             mQuotaRetryInterval = (double)INT32_FLAG(client_quota_send_retry_interval) + rand() % 5;
+            mRetryBackoffMs = 0;
             mSendConcurrency += 2;
             if (mSendConcurrency > INT32_FLAG(client_send_concurrency_max)) {
                 mSendConcurrency = INT32_FLAG(client_send_concurrency_max);
@@ -119,6 +141,7 @@ bool LogstoreSenderInfo::RecordSendResult(SendResult rst, LogstoreSenderStatisti
             mQuotaValidFlag = true;
             mNetworkRetryInterval = (double)INT32_FLAG(client_disable_send_retry_interval);
             mQuotaRetryInterval = (double)INT32_FLAG(client_quota_send_retry_interval) + rand() % 5;
+            mRetryBackoffMs = 0;
             // only if send success or discard, mSendConcurrency inc 2
             mSendConcurrency += 2;
             if (mSendConcurrency > INT32_FLAG(client_send_concurrency_max)) {
@@ -171,6 +194,22 @@ bool LogstoreSenderInfo::RecordSendResult(SendResult rst, LogstoreSenderStatisti
     return false;
 }
 
+uint32_t LogstoreSenderInfo::NextRetryDelayMs() {
+    if (INT32_FLAG(send_retry_backoff_base_ms) <= 0) {
+        return 0;
+    }
+    const uint32_t maxBackoff = (uint32_t)std::max(INT32_FLAG(send_retry_backoff_max_ms), 1);
+    if (mRetryBackoffMs == 0) {
+        mRetryBackoffMs = (uint32_t)INT32_FLAG(send_retry_backoff_base_ms);
+    } else {
+        mRetryBackoffMs = mRetryBackoffMs > maxBackoff / 2 ? maxBackoff : mRetryBackoffMs * 2;
+    }
+    mRetryBackoffMs = std::min(mRetryBackoffMs, maxBackoff);
+    // Jittered in [backoff / 2, backoff], so log groups failed together are not retried together.
+    const uint32_t half = mRetryBackoffMs / 2;
+    return mRetryBackoffMs - half + (uint32_t)(rand() % (half + 1));
+}
+
 bool LogstoreSenderInfo::OnRegionRecover(const std::string& region) {
     if (region == mRegion) {
         bool rst = !(mNetworkValidFlag && mQuotaValidFlag);
@@ -202,10 +241,36 @@ bool LogstoreSenderInfo::ConcurrencyValid() {
     return mSendConcurrency > 0;
 }
 
+const int64_t LogstoreSenderStatistics::QUEUE_DELAY_BUCKET_BOUNDS[] = {10, 100, 500, 1000, 5000, 30000};
+
 LogstoreSenderStatistics::LogstoreSenderStatistics() {
     Reset();
 }
 
+void LogstoreSenderStatistics::RecordQueueDelay(int64_t delayMs) {
+    size_t idx = 0;
+    while (idx + 1 < QUEUE_DELAY_BUCKET_COUNT && delayMs > QUEUE_DELAY_BUCKET_BOUNDS[idx]) {
+        ++idx;
+    }
+    ++mQueueDelayHistogram[idx];
+}
+
+std::string LogstoreSenderStatistics::QueueDelayHistogramToString() const {
+    std::string result;
+    for (size_t idx = 0; idx < QUEUE_DELAY_BUCKET_COUNT; ++idx) {
+        if (idx > 0) {
+            result.append(",");
+        }
+        if (idx + 1 < QUEUE_DELAY_BUCKET_COUNT) {
+            result.append("<=").append(ToString(QUEUE_DELAY_BUCKET_BOUNDS[idx]));
+        } else {
+            result.append("+inf");
+        }
+        result.append(":").append(ToString(mQueueDelayHistogram[idx]));
+    }
+    return result;
+}
+
 void LogstoreSenderStatistics::Reset() {
     mMaxUnsendTime = 0;
     mMinUnsendTime = 0;
@@ -217,6 +282,7 @@ void LogstoreSenderStatistics::Reset() {
     mSendSuccessCount = 0;
     mSendBlockFlag = false;
     mValidToSendFlag = false;
+    std::fill(mQueueDelayHistogram, mQueueDelayHistogram + QUEUE_DELAY_BUCKET_COUNT, 0);
 }
 
 } // namespace logtail
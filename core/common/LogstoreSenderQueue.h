@@ -18,22 +18,43 @@
 #include <unordered_map>
 #include <string>
 #include <deque>
+#include <map>
 #include <stdio.h>
+#include <algorithm>
+#include <vector>
 #include "logger/Logger.h"
 #include "LogGroupContext.h"
 #include "Lock.h"
 #include "LogstoreFeedbackQueue.h"
+#include "MemoryBudget.h"
+#include "TimeUtil.h"
+#include "TokenBucket.h"
+#include "StringInterner.h"
 
 namespace logtail {
 
-enum LoggroupSendStatus { LoggroupSendStatus_Idle, LoggroupSendStatus_Sending, LoggroupSendStatus_Ok };
+// LoggroupSendStatus_Waiting is a failed log group waiting for its retry backoff, it becomes idle when due.
+enum LoggroupSendStatus {
+    LoggroupSendStatus_Idle,
+    LoggroupSendStatus_Sending,
+    LoggroupSendStatus_Ok,
+    LoggroupSendStatus_Waiting
+};
 
 enum SEND_DATA_TYPE { LOG_PACKAGE_LIST, LOGGROUP_COMPRESSED };
 
 struct LogstoreSenderStatistics {
+    // Upper bounds in milliseconds of queueing delay buckets, the last bucket is unbounded.
+    static const int64_t QUEUE_DELAY_BUCKET_BOUNDS[];
+    static const size_t QUEUE_DELAY_BUCKET_COUNT = 7;
+
     LogstoreSenderStatistics();
     void Reset();
 
+    void RecordQueueDelay(int64_t delayMs);
+    // QueueDelayHistogramToString formats buckets as "<=10:3,<=100:1,...,+inf:0".
+    std::string QueueDelayHistogramToString() const;
+
     int32_t mMaxUnsendTime;
     int32_t mMinUnsendTime;
     int32_t mMaxSendSuccessTime;
@@ -44,6 +65,7 @@ struct LogstoreSenderStatistics {
     uint32_t mSendSuccessCount;
     bool mSendBlockFlag;
     bool mValidToSendFlag;
+    uint32_t mQueueDelayHistogram[QUEUE_DELAY_BUCKET_COUNT];
 };
 
 struct LoggroupTimeValue {
@@ -53,9 +75,9 @@ struct LoggroupTimeValue {
     int32_t mRawSize;
     int32_t mLogLines;
     bool mBufferOrNot; // false only when use exactly once
-    std::string mProjectName;
-    std::string mLogstore;
-    std::string mConfigName;
+    InternedString mProjectName;
+    InternedString mLogstore;
+    InternedString mConfigName;
     std::string mFilename;
 
     // truncate info
@@ -63,10 +85,15 @@ struct LoggroupTimeValue {
 
     int32_t mSendRetryTimes;
     int32_t mLastSendTime;
-    std::string mAliuid;
-    std::string mRegion;
+    uint64_t mLastSendTimeInMs; // for request latency
+    uint64_t mEnqueueTimeInMs = 0; // when the item becomes idle in sender queue, for queueing delay
+    uint32_t mCompressTimeInUs = 0;
+    size_t mQueuedBytes = 0; // bytes of the item counted into sender queue memory usage, see MemoryUsage
+    bool mColumnar = false; // mLogData is a compressed ColumnarLogGroup rather than a LogGroup
+    InternedString mAliuid;
+    InternedString mRegion;
     std::string mShardHashKey;
-    std::string mCurrentEndpoint;
+    InternedString mCurrentEndpoint;
     LoggroupSendStatus mStatus;
     LogstoreFeedBackKey mLogstoreKey;
     bool mRealIpFlag;
@@ -75,13 +102,13 @@ struct LoggroupTimeValue {
     int32_t mLogTimeInMinute;
     LogGroupContext mLogGroupContext;
 
-    LoggroupTimeValue(const std::string& projectName,
-                      const std::string& logstore,
-                      const std::string& configName,
+    LoggroupTimeValue(const InternedString& projectName,
+                      const InternedString& logstore,
+                      const InternedString& configName,
                       const std::string& filename,
                       bool bufferOrNot,
-                      const std::string& aliuid,
-                      const std::string& region,
+                      const InternedString& aliuid,
+                      const InternedString& region,
                       SEND_DATA_TYPE dataType,
                       int32_t lines,
                       int32_t rawSize,
@@ -102,6 +129,7 @@ struct LoggroupTimeValue {
         mLastUpdateTime = lastUpdateTime;
         mSendRetryTimes = 0;
         mLastSendTime = 0;
+        mLastSendTimeInMs = 0;
         mLogData.clear();
         mShardHashKey = shardHashKey;
         mStatus = LoggroupSendStatus_Idle;
@@ -111,6 +139,12 @@ struct LoggroupTimeValue {
         mLogGroupContext = context;
     }
 
+    // ShrinkLogData releases unused capacity of mLogData, compressors reserve the compress bound of raw data which
+    // is kept as long as the item is queued otherwise.
+    void ShrinkLogData();
+    // MemoryUsage returns heap bytes held by the item, including the item itself and capacity of its strings.
+    size_t MemoryUsage() const;
+
 #ifdef APSARA_UNIT_TEST_MAIN
     LoggroupTimeValue() {
     }
@@ -138,6 +172,8 @@ struct LogstoreSenderInfo {
     volatile bool mQuotaValidFlag;
     volatile int32_t mSendConcurrency;
     volatile int32_t mSendConcurrencyUpdateTime;
+    // backoff of failed log groups, doubled on each failure and cleared on success
+    uint32_t mRetryBackoffMs;
 
     LogstoreSenderInfo();
 
@@ -150,16 +186,54 @@ struct LogstoreSenderInfo {
     // RecordSendResult
     // @return true if need to trigger.
     bool RecordSendResult(SendResult rst, LogstoreSenderStatistics& statisticsItem);
+    // NextRetryDelayMs increases the backoff and returns the jittered delay of a failed log group, 0 if retry
+    // backoff is disabled.
+    uint32_t NextRetryDelayMs();
     // return value, recover sucess flag(if logstore is invalid before, return true, else return false)
     bool OnRegionRecover(const std::string& region);
 };
 
+// SenderTokenBuckets limits send bytes per second by levels, global -> region -> project -> logstore,
+// a log group is sent only if buckets of all levels have tokens. Buckets of logstores are kept in
+// their queues, and all buckets are accessed under the lock of sender queue.
+struct SenderTokenBuckets {
+    TokenBucket mGlobal;
+    std::unordered_map<std::string, TokenBucket> mRegions;
+    std::unordered_map<std::string, TokenBucket> mProjects;
+    int64_t mRegionRate = 0;
+    int64_t mProjectRate = 0;
+    int64_t mLogstoreRate = 0;
+    uint64_t mNowMs = 0;
+    // Set if any log group is held for tokens in the last pop.
+    bool mHeld = false;
+
+    bool IsEnabled() const {
+        return mGlobal.IsLimited() || mRegionRate > 0 || mProjectRate > 0 || mLogstoreRate > 0;
+    }
+
+    TokenBucket&
+    GetBucket(std::unordered_map<std::string, TokenBucket>& buckets, const std::string& key, int64_t rate) {
+        TokenBucket& bucket = buckets[key];
+        bucket.SetRate(rate);
+        bucket.Refill(mNowMs);
+        return bucket;
+    }
+};
+
 template <class PARAM>
 class SingleLogstoreSenderManager : public SingleLogstoreFeedbackQueue<LoggroupTimeValue*, PARAM> {
 public:
     SingleLogstoreSenderManager()
         : mLastSendTimeSecond(0), mLastSecondTotalBytes(0), mMaxSendBytesPerSecond(-1), mFlowControlExpireTime(0) {}
 
+    void SetScheduling(int32_t weight, int32_t priority) {
+        mWeight = weight > 0 ? weight : 1;
+        mPriority = (priority < 0 || priority > MAX_CONFIG_PRIORITY_LEVEL) ? 0 : priority;
+    }
+
+    // GetPriorityRank returns the order to schedule, priority 1 is the highest and 0 (no priority) is the lowest.
+    int32_t GetPriorityRank() const { return mPriority == 0 ? MAX_CONFIG_PRIORITY_LEVEL + 1 : mPriority; }
+
     void SetMaxSendBytesPerSecond(int32_t maxBytes, int32_t expireTime) {
         mMaxSendBytesPerSecond = maxBytes;
         mFlowControlExpireTime = expireTime;
@@ -184,14 +258,46 @@ public:
         }
     }
 
-    void GetAllIdleLoggroupWithLimit(std::vector<LoggroupTimeValue*>& logGroupVec,
+    // CopyAllSendingLoggroup appends copies of log groups being sent, exactly once log groups are skipped
+    // since their checkpoints are replayed instead.
+    void CopyAllSendingLoggroup(std::vector<LoggroupTimeValue*>& logGroupVec) {
+        if (this->mSize == 0 || QueueType::ExactlyOnce == this->mType) {
+            return;
+        }
+        for (uint64_t index = this->mRead; index < this->mWrite; ++index) {
+            LoggroupTimeValue* item = this->mArray[index % this->SIZE];
+            if (item != NULL && item->mStatus == LoggroupSendStatus_Sending) {
+                logGroupVec.push_back(new LoggroupTimeValue(*item));
+            }
+        }
+    }
+
+    // GetAllIdleLoggroupWithLimit pops idle log groups within limits. If @deficit is not NULL, it pops only while
+    // the deficit covers the raw size of the next log group, and the deficit is cleared once no idle log groups
+    // are left.
+    // @return true if it stops because the deficit is not enough.
+    bool GetAllIdleLoggroupWithLimit(std::vector<LoggroupTimeValue*>& logGroupVec,
                                      int32_t nowTime,
-                                     std::unordered_map<std::string, int>& regionConcurrencyLimits) {
+                                     std::unordered_map<std::string, int>& regionConcurrencyLimits,
+                                     SenderTokenBuckets* tokenBuckets = NULL,
+                                     int64_t* deficit = NULL) {
         bool expireFlag = (mFlowControlExpireTime > 0 && nowTime > mFlowControlExpireTime);
         if (this->mSize == 0 || (!expireFlag && mMaxSendBytesPerSecond == 0)) {
-            return;
+            if (deficit != NULL && this->mSize == 0) {
+                *deficit = 0;
+            }
+            return false;
         }
-        if (!expireFlag && mMaxSendBytesPerSecond > 0 && nowTime != mLastSendTimeSecond) {
+        // With token buckets, the limit of logstore is applied by its bucket instead of the window of one second.
+        TokenBucket* regionBucket = NULL;
+        TokenBucket* projectBucket = NULL;
+        if (tokenBuckets != NULL) {
+            mTokenBucket.SetRate((!expireFlag && mMaxSendBytesPerSecond > 0) ? mMaxSendBytesPerSecond
+                                                                             : tokenBuckets->mLogstoreRate);
+            mTokenBucket.Refill(tokenBuckets->mNowMs);
+            regionBucket = &tokenBuckets->GetBucket(
+                tokenBuckets->mRegions, mSenderInfo.mRegion, tokenBuckets->mRegionRate);
+        } else if (!expireFlag && mMaxSendBytesPerSecond > 0 && nowTime != mLastSendTimeSecond) {
             mLastSecondTotalBytes = 0;
             mLastSendTimeSecond = nowTime;
         }
@@ -201,7 +307,7 @@ public:
         if (iter != regionConcurrencyLimits.end())
             regionConcurrency = iter->second;
         if (0 == regionConcurrency) {
-            return;
+            return false;
         }
 
         uint64_t index = QueueType::ExactlyOnce == this->mType ? 0 : this->mRead;
@@ -215,12 +321,35 @@ public:
                 // check consurrency
                 // check first, when mMaxSendBytesPerSecond is 1000, and the packet size is 10K, we should send this
                 // packet. if not, this logstore will block
-                if ((!mSenderInfo.ConcurrencyValid())
-                    || (!expireFlag && mMaxSendBytesPerSecond > 0 && mLastSecondTotalBytes > mMaxSendBytesPerSecond)) {
-                    return;
+                if (!mSenderInfo.ConcurrencyValid()) {
+                    return false;
+                }
+                if (deficit != NULL && *deficit < item->mRawSize) {
+                    return true;
+                }
+                if (tokenBuckets != NULL) {
+                    if (projectBucket == NULL) {
+                        projectBucket = &tokenBuckets->GetBucket(
+                            tokenBuckets->mProjects, item->mProjectName, tokenBuckets->mProjectRate);
+                    }
+                    if (!tokenBuckets->mGlobal.HasToken() || !regionBucket->HasToken() || !projectBucket->HasToken()
+                        || !mTokenBucket.HasToken()) {
+                        tokenBuckets->mHeld = true;
+                        return false;
+                    }
+                    tokenBuckets->mGlobal.Consume(item->mRawSize);
+                    regionBucket->Consume(item->mRawSize);
+                    projectBucket->Consume(item->mRawSize);
+                    mTokenBucket.Consume(item->mRawSize);
+                } else if (!expireFlag && mMaxSendBytesPerSecond > 0
+                           && mLastSecondTotalBytes > mMaxSendBytesPerSecond) {
+                    return false;
                 }
                 mSenderInfo.ConcurrencyDec();
                 mLastSecondTotalBytes += item->mRawSize;
+                if (deficit != NULL) {
+                    *deficit -= item->mRawSize;
+                }
                 item->mStatus = LoggroupSendStatus_Sending;
                 logGroupVec.push_back(item);
                 if (-1 != regionConcurrency) {
@@ -233,6 +362,10 @@ public:
         if (iter != regionConcurrencyLimits.end()) {
             iter->second = regionConcurrency;
         }
+        if (deficit != NULL && index >= endIndex) {
+            *deficit = 0;
+        }
+        return false;
     }
 
     bool insertExactlyOnceItem(LoggroupTimeValue* item) {
@@ -288,6 +421,10 @@ public:
     // with empty item
     bool InsertItem(LoggroupTimeValue* item) {
         mSenderInfo.SetRegion(item->mRegion);
+        item->mEnqueueTimeInMs = GetCurrentTimeInMilliSeconds();
+        if (item->mLogGroupContext.mTimestamps.mEnqueueTimeInMs == 0) {
+            item->mLogGroupContext.mTimestamps.mEnqueueTimeInMs = GetSteadyTimeInMilliSeconds();
+        }
         if (QueueType::ExactlyOnce == this->mType) {
             return insertExactlyOnceItem(item);
         }
@@ -321,6 +458,7 @@ public:
         auto& checkpoint = item->mLogGroupContext.mExactlyOnceCheckpoint;
         this->mArray[checkpoint->index] = NULL;
         this->mSize--;
+        MemoryBudget::Sub(MEMORY_COMPONENT_SENDER_QUEUE, item->mQueuedBytes);
         delete item;
         if (!mExtraBuffers.empty()) {
             auto extraItem = mExtraBuffers.front();
@@ -350,6 +488,7 @@ public:
         for (; index < this->mWrite; ++index) {
             auto dataItem = this->mArray[index % this->SIZE];
             if (dataItem == item) {
+                MemoryBudget::Sub(MEMORY_COMPONENT_SENDER_QUEUE, item->mQueuedBytes);
                 if (deleteFlag) {
                     delete dataItem;
                 }
@@ -421,7 +560,15 @@ public:
         // network fail or quota fail
         if (sendRst != LogstoreSenderInfo::SendResult_OK && sendRst != LogstoreSenderInfo::SendResult_Buffered
             && sendRst != LogstoreSenderInfo::SendResult_DiscardFail) {
-            item->mStatus = LoggroupSendStatus_Idle;
+            const uint64_t nowMs = GetCurrentTimeInMilliSeconds();
+            const uint32_t delayMs = mSenderInfo.NextRetryDelayMs();
+            if (delayMs > 0) {
+                item->mStatus = LoggroupSendStatus_Waiting;
+                mRetryItems.insert(std::make_pair(nowMs + delayMs, item));
+            } else {
+                item->mStatus = LoggroupSendStatus_Idle;
+                item->mEnqueueTimeInMs = nowMs;
+            }
             return 0;
         }
         if (mSenderStatistics.mMaxSendSuccessTime < item->mLastUpdateTime) {
@@ -435,6 +582,25 @@ public:
         return mSenderInfo.CanSend(curTime);
     }
 
+    // PromoteRetryItems makes waiting log groups due before @nowMs idle, all of them if @nowMs is UINT64_MAX.
+    // @return count of log groups made idle.
+    size_t PromoteRetryItems(uint64_t nowMs) {
+        size_t count = 0;
+        const uint64_t enqueueTime = GetCurrentTimeInMilliSeconds();
+        while (!mRetryItems.empty() && mRetryItems.begin()->first <= nowMs) {
+            LoggroupTimeValue* item = mRetryItems.begin()->second;
+            item->mStatus = LoggroupSendStatus_Idle;
+            item->mEnqueueTimeInMs = enqueueTime;
+            mRetryItems.erase(mRetryItems.begin());
+            ++count;
+        }
+        return count;
+    }
+
+    size_t GetRetryItemCount() const { return mRetryItems.size(); }
+    // GetNextRetryTime returns when the first waiting log group is due, UINT64_MAX if none.
+    uint64_t GetNextRetryTime() const { return mRetryItems.empty() ? UINT64_MAX : mRetryItems.begin()->first; }
+
     LogstoreSenderInfo mSenderInfo;
     LogstoreSenderStatistics mSenderStatistics;
 
@@ -444,9 +610,18 @@ public:
 
     volatile int32_t mMaxSendBytesPerSecond; // <0, no flowControl, 0 pause sending,
     volatile int32_t mFlowControlExpireTime; // <=0 no expire
+    TokenBucket mTokenBucket; // used if token buckets of sender queue are enabled
+
+    // for weighted fair scheduling
+    int32_t mWeight = 1;
+    int32_t mPriority = 0; // same as priority of config, 1-3, 1 is the highest, 0 is no priority
+    int64_t mDeficit = 0;
 
     std::vector<RangeCheckpointPtr> mRangeCheckpoints;
     std::deque<LoggroupTimeValue*> mExtraBuffers;
+
+    // log groups waiting for retry by due time in milliseconds, they are still in the queue
+    std::multimap<uint64_t, LoggroupTimeValue*> mRetryItems;
 };
 
 template <class PARAM>
@@ -488,15 +663,89 @@ public:
         if (mUrgentFlag) {
             return true;
         }
+        if (MemoryBudget::IsSendBlocked()) {
+            return false;
+        }
         return singleQueue.IsValid();
     }
 
+    // GetPushCredit returns how many log groups of @key can be pushed before IsValidToPush returns false.
+    size_t GetPushCredit(const LogstoreFeedBackKey& key) {
+        PTScopedLock dataLock(mLock);
+        auto& singleQueue = mLogstoreSenderQueueMap[key];
+        if (singleQueue.GetQueueType() != QueueType::ExactlyOnce) {
+            if (mUrgentFlag) {
+                return singleQueue.GetCredit() > 0 ? singleQueue.GetCredit() : 1;
+            }
+            if (MemoryBudget::IsSendBlocked()) {
+                return 0;
+            }
+        }
+        return singleQueue.GetCredit();
+    }
+
     void SetLogstoreFlowControl(const LogstoreFeedBackKey& key, int32_t maxBytes, int32_t expireTime) {
         PTScopedLock dataLock(mLock);
         SingleLogStoreManager& singleQueue = mLogstoreSenderQueueMap[key];
         singleQueue.SetMaxSendBytesPerSecond(maxBytes, expireTime);
     }
 
+    // SetLogstoreScheduling sets the weight and priority used by fair scheduling, see FairPopItem.
+    void SetLogstoreScheduling(const LogstoreFeedBackKey& key, int32_t weight, int32_t priority) {
+        PTScopedLock dataLock(mLock);
+        SingleLogStoreManager& singleQueue = mLogstoreSenderQueueMap[key];
+        singleQueue.SetScheduling(weight, priority);
+    }
+
+    // SetSchedulingQuantum sets bytes added to the deficit of a logstore with weight 1 in each round,
+    // <= 0 disables fair scheduling.
+    void SetSchedulingQuantum(int64_t quantum) {
+        PTScopedLock dataLock(mLock);
+        mSchedulingQuantum = quantum > 0 ? quantum : 0;
+    }
+
+    // SetTokenBucketRates sets bytes per second of each level, <= 0 means unlimited. Token buckets are
+    // disabled if all levels are unlimited.
+    void SetTokenBucketRates(int64_t globalRate, int64_t regionRate, int64_t projectRate, int64_t logstoreRate) {
+        PTScopedLock dataLock(mLock);
+        mTokenBuckets.mGlobal.SetRate(globalRate);
+        mTokenBuckets.mRegionRate = regionRate;
+        mTokenBuckets.mProjectRate = projectRate;
+        mTokenBuckets.mLogstoreRate = logstoreRate;
+        if (!mTokenBuckets.IsEnabled()) {
+            mTokenBuckets.mRegions.clear();
+            mTokenBuckets.mProjects.clear();
+            mTokenBuckets.mHeld = false;
+        }
+    }
+
+    // IsHeldByTokenBucket returns true if log groups were left in the last pop for lack of tokens,
+    // so the caller should pop again once tokens are refilled rather than wait for new data.
+    bool IsHeldByTokenBucket() {
+        PTScopedLock dataLock(mLock);
+        return mTokenBuckets.mHeld;
+    }
+
+    // GetRetryWaitMs returns milliseconds until the first waiting log group is due, capped by @maxWaitMs.
+    int32_t GetRetryWaitMs(int32_t maxWaitMs) {
+        PTScopedLock dataLock(mLock);
+        if (mNextRetryTime == UINT64_MAX) {
+            return maxWaitMs;
+        }
+        const uint64_t nowMs = GetCurrentTimeInMilliSeconds();
+        if (mNextRetryTime <= nowMs) {
+            return 0;
+        }
+        return (int32_t)std::min<uint64_t>(mNextRetryTime - nowMs, (uint64_t)maxWaitMs);
+    }
+
+    // GetRetryStatus returns count of log groups waiting for retry at the last pop, and total count made idle.
+    void GetRetryStatus(size_t& waitingCount, uint64_t& promotedCount) {
+        PTScopedLock dataLock(mLock);
+        waitingCount = mRetryWaitingCount;
+        promotedCount = mRetryPromotedCount;
+    }
+
     void ConvertToExactlyOnceQueue(const LogstoreFeedBackKey& key, const std::vector<RangeCheckpointPtr>& checkpoints) {
         PTScopedLock dataLock(mLock);
         auto& queue = mLogstoreSenderQueueMap[key];
@@ -516,9 +765,12 @@ public:
         {
             PTScopedLock dataLock(mLock);
             SingleLogStoreManager& singleQueue = mLogstoreSenderQueueMap[key];
+            item->ShrinkLogData();
+            item->mQueuedBytes = item->MemoryUsage();
             if (!singleQueue.InsertItem(item)) {
                 return false;
             }
+            MemoryBudget::Add(MEMORY_COMPONENT_SENDER_QUEUE, item->mQueuedBytes);
         }
         Signal();
         return true;
@@ -533,6 +785,7 @@ public:
         if (mLogstoreSenderQueueMap.empty()) {
             return;
         }
+        PromoteRetryItems(GetCurrentTimeInMilliSeconds());
 
         // must check index before moving iterator
         mSenderQueueBeginIndex = mSenderQueueBeginIndex % mLogstoreSenderQueueMap.size();
@@ -541,31 +794,148 @@ public:
         LogstoreFeedBackQueueMapIterator beginIter = mLogstoreSenderQueueMap.begin();
         std::advance(beginIter, mSenderQueueBeginIndex++);
 
-        PopItem(
-            beginIter, mLogstoreSenderQueueMap.end(), itemVec, curTime, regionConcurrencyLimits, singleQueueFullFlag);
-        PopItem(
-            mLogstoreSenderQueueMap.begin(), beginIter, itemVec, curTime, regionConcurrencyLimits, singleQueueFullFlag);
+        SenderTokenBuckets* tokenBuckets = NULL;
+        if (mTokenBuckets.IsEnabled()) {
+            tokenBuckets = &mTokenBuckets;
+            tokenBuckets->mNowMs = GetCurrentTimeInMilliSeconds();
+            tokenBuckets->mHeld = false;
+            tokenBuckets->mGlobal.Refill(tokenBuckets->mNowMs);
+        }
+        const uint64_t nowMs = GetCurrentTimeInMilliSeconds();
+        if (mSchedulingQuantum > 0) {
+            std::vector<SingleLogStoreManager*> queues;
+            queues.reserve(mLogstoreSenderQueueMap.size());
+            CollectQueues(beginIter, mLogstoreSenderQueueMap.end(), curTime, queues);
+            CollectQueues(mLogstoreSenderQueueMap.begin(), beginIter, curTime, queues);
+            FairPopItem(queues, itemVec, curTime, nowMs, regionConcurrencyLimits, singleQueueFullFlag, tokenBuckets);
+            return;
+        }
+        PopItem(beginIter,
+                mLogstoreSenderQueueMap.end(),
+                itemVec,
+                curTime,
+                nowMs,
+                regionConcurrencyLimits,
+                singleQueueFullFlag,
+                tokenBuckets);
+        PopItem(mLogstoreSenderQueueMap.begin(),
+                beginIter,
+                itemVec,
+                curTime,
+                nowMs,
+                regionConcurrencyLimits,
+                singleQueueFullFlag,
+                tokenBuckets);
     }
 
     static void PopItem(LogstoreFeedBackQueueMapIterator beginIter,
                         LogstoreFeedBackQueueMapIterator endIter,
                         std::vector<LoggroupTimeValue*>& itemVec,
                         int32_t curTime,
+                        uint64_t nowMs,
                         std::unordered_map<std::string, int>& regionConcurrencyLimits,
-                        bool& singleQueueFullFlag) {
+                        bool& singleQueueFullFlag,
+                        SenderTokenBuckets* tokenBuckets = NULL) {
         for (LogstoreFeedBackQueueMapIterator iter = beginIter; iter != endIter; ++iter) {
             SingleLogStoreManager& singleQueue = iter->second;
             if (!singleQueue.IsValidToSend(curTime)) {
                 continue;
             }
-            singleQueue.GetAllIdleLoggroupWithLimit(itemVec, curTime, regionConcurrencyLimits);
+            const size_t popBegin = itemVec.size();
+            singleQueue.GetAllIdleLoggroupWithLimit(itemVec, curTime, regionConcurrencyLimits, tokenBuckets);
+            RecordQueueDelay(singleQueue, itemVec, popBegin, nowMs);
             singleQueueFullFlag |= !singleQueue.IsValid();
         }
     }
 
+    static void CollectQueues(LogstoreFeedBackQueueMapIterator beginIter,
+                              LogstoreFeedBackQueueMapIterator endIter,
+                              int32_t curTime,
+                              std::vector<SingleLogStoreManager*>& queues) {
+        for (LogstoreFeedBackQueueMapIterator iter = beginIter; iter != endIter; ++iter) {
+            if (iter->second.IsValidToSend(curTime)) {
+                queues.push_back(&iter->second);
+            }
+        }
+    }
+
+    // FairPopItem pops by deficit round robin within each priority level, from the highest level to the lowest.
+    // Each round adds quantum * weight bytes to the deficit of every logstore, and a logstore pops log groups
+    // while its deficit covers them, so logstores share concurrency by weight instead of by queue length.
+    void FairPopItem(std::vector<SingleLogStoreManager*>& queues,
+                     std::vector<LoggroupTimeValue*>& itemVec,
+                     int32_t curTime,
+                     uint64_t nowMs,
+                     std::unordered_map<std::string, int>& regionConcurrencyLimits,
+                     bool& singleQueueFullFlag,
+                     SenderTokenBuckets* tokenBuckets) {
+        std::stable_sort(queues.begin(), queues.end(), [](SingleLogStoreManager* lhs, SingleLogStoreManager* rhs) {
+            return lhs->GetPriorityRank() < rhs->GetPriorityRank();
+        });
+        std::vector<SingleLogStoreManager*> activeQueues;
+        for (size_t levelBegin = 0, levelEnd = 0; levelBegin < queues.size(); levelBegin = levelEnd) {
+            while (levelEnd < queues.size()
+                   && queues[levelEnd]->GetPriorityRank() == queues[levelBegin]->GetPriorityRank()) {
+                ++levelEnd;
+            }
+            activeQueues.assign(queues.begin() + levelBegin, queues.begin() + levelEnd);
+            while (!activeQueues.empty()) {
+                size_t activeCount = 0;
+                for (SingleLogStoreManager* singleQueue : activeQueues) {
+                    const int64_t quantum = mSchedulingQuantum * singleQueue->mWeight;
+                    singleQueue->mDeficit += quantum;
+                    const size_t popBegin = itemVec.size();
+                    bool waitDeficit = singleQueue->GetAllIdleLoggroupWithLimit(
+                        itemVec, curTime, regionConcurrencyLimits, tokenBuckets, &singleQueue->mDeficit);
+                    RecordQueueDelay(*singleQueue, itemVec, popBegin, nowMs);
+                    if (waitDeficit) {
+                        activeQueues[activeCount++] = singleQueue;
+                    } else {
+                        // Stopped by other limits, the deficit is not saved up for a burst later.
+                        singleQueue->mDeficit = std::min(singleQueue->mDeficit, quantum);
+                    }
+                }
+                activeQueues.resize(activeCount);
+            }
+        }
+        for (SingleLogStoreManager* singleQueue : queues) {
+            singleQueueFullFlag |= !singleQueue->IsValid();
+        }
+    }
+
+    // PromoteRetryItems makes due log groups of all logstores idle, it costs one check per logstore rather than
+    // one per log group.
+    void PromoteRetryItems(uint64_t nowMs) {
+        mNextRetryTime = UINT64_MAX;
+        mRetryWaitingCount = 0;
+        for (LogstoreFeedBackQueueMapIterator iter = mLogstoreSenderQueueMap.begin();
+             iter != mLogstoreSenderQueueMap.end();
+             ++iter) {
+            SingleLogStoreManager& singleQueue = iter->second;
+            if (singleQueue.GetRetryItemCount() == 0) {
+                continue;
+            }
+            mRetryPromotedCount += singleQueue.PromoteRetryItems(nowMs);
+            mRetryWaitingCount += singleQueue.GetRetryItemCount();
+            mNextRetryTime = std::min(mNextRetryTime, singleQueue.GetNextRetryTime());
+        }
+    }
+
+    static void RecordQueueDelay(SingleLogStoreManager& singleQueue,
+                                 const std::vector<LoggroupTimeValue*>& itemVec,
+                                 size_t popBegin,
+                                 uint64_t nowMs) {
+        for (size_t i = popBegin; i < itemVec.size(); ++i) {
+            const uint64_t enqueueTime = itemVec[i]->mEnqueueTimeInMs;
+            singleQueue.mSenderStatistics.RecordQueueDelay(enqueueTime < nowMs ? nowMs - enqueueTime : 0);
+        }
+    }
+
     void PopAllItem(std::vector<LoggroupTimeValue*>& itemVec, int32_t curTime, bool& singleQueueFullFlag) {
         singleQueueFullFlag = false;
         PTScopedLock dataLock(mLock);
+        // Backoff is not waited when flushing.
+        PromoteRetryItems(UINT64_MAX);
         for (LogstoreFeedBackQueueMapIterator iter = mLogstoreSenderQueueMap.begin();
              iter != mLogstoreSenderQueueMap.end();
              ++iter) {
@@ -574,6 +944,16 @@ public:
         }
     }
 
+    // CopyAllSendingItem appends copies of all log groups being sent, the caller owns them.
+    void CopyAllSendingItem(std::vector<LoggroupTimeValue*>& itemVec) {
+        PTScopedLock dataLock(mLock);
+        for (LogstoreFeedBackQueueMapIterator iter = mLogstoreSenderQueueMap.begin();
+             iter != mLogstoreSenderQueueMap.end();
+             ++iter) {
+            iter->second.CopyAllSendingLoggroup(itemVec);
+        }
+    }
+
     void OnLoggroupSendDone(LoggroupTimeValue* item, LogstoreSenderInfo::SendResult sendRst) {
         if (item == NULL) {
             return;
@@ -586,6 +966,9 @@ public:
             PTScopedLock dataLock(mLock);
             SingleLogStoreManager& singleQueue = mLogstoreSenderQueueMap[key];
             rst = singleQueue.OnSendDone(item, sendRst, needTrigger);
+            if (item->mStatus == LoggroupSendStatus_Waiting) {
+                mNextRetryTime = std::min(mNextRetryTime, singleQueue.GetNextRetryTime());
+            }
         }
         if (rst == 2 && mFeedBackObj != NULL) {
             APSARA_LOG_DEBUG(sLogger, ("OnLoggroupSendDone feedback", ""));
@@ -694,6 +1077,12 @@ protected:
     LogstoreFeedBackInterface* mFeedBackObj;
     bool mUrgentFlag;
     size_t mSenderQueueBeginIndex;
+    SenderTokenBuckets mTokenBuckets;
+    int64_t mSchedulingQuantum = 0;
+    // for retry backoff, updated by each pop
+    uint64_t mNextRetryTime = UINT64_MAX;
+    size_t mRetryWaitingCount = 0;
+    uint64_t mRetryPromotedCount = 0;
 
 private:
 #ifdef APSARA_UNIT_TEST_MAIN
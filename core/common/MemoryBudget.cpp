@@ -0,0 +1,91 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "MemoryBudget.h"
+#include "common/Flags.h"
+
+DEFINE_FLAG_INT32(log_buffer_memory_budget_mb, "budget of buffers read but not processed, MB, 0 means unlimited", 0);
+DEFINE_FLAG_INT32(process_queue_memory_budget_mb, "budget of buffers in process queue, MB, 0 means unlimited", 0);
+DEFINE_FLAG_INT32(aggregator_memory_budget_mb, "budget of logs in aggregator, MB, 0 means unlimited", 0);
+DEFINE_FLAG_INT32(sender_queue_memory_budget_mb, "budget of data in sender queue, MB, 0 means unlimited", 0);
+DEFINE_FLAG_INT32(secondary_buffer_memory_budget_mb,
+                  "budget of data waiting to be dumped to buffer file, MB, 0 means unlimited",
+                  0);
+DEFINE_FLAG_INT32(plugin_queue_memory_budget_mb, "budget of data sent by plugin in queue, MB, 0 means unlimited", 0);
+
+namespace logtail {
+
+std::atomic<int64_t> MemoryBudget::sUsages[MEMORY_COMPONENT_COUNT];
+
+int64_t MemoryBudget::GetBudget(MemoryComponent component) {
+    int32_t budgetMb = 0;
+    switch (component) {
+        case MEMORY_COMPONENT_LOG_BUFFER:
+            budgetMb = INT32_FLAG(log_buffer_memory_budget_mb);
+            break;
+        case MEMORY_COMPONENT_PROCESS_QUEUE:
+            budgetMb = INT32_FLAG(process_queue_memory_budget_mb);
+            break;
+        case MEMORY_COMPONENT_AGGREGATOR:
+            budgetMb = INT32_FLAG(aggregator_memory_budget_mb);
+            break;
+        case MEMORY_COMPONENT_SENDER_QUEUE:
+            budgetMb = INT32_FLAG(sender_queue_memory_budget_mb);
+            break;
+        case MEMORY_COMPONENT_SECONDARY_BUFFER:
+            budgetMb = INT32_FLAG(secondary_buffer_memory_budget_mb);
+            break;
+        case MEMORY_COMPONENT_PLUGIN_QUEUE:
+            budgetMb = INT32_FLAG(plugin_queue_memory_budget_mb);
+            break;
+        default:
+            break;
+    }
+    return budgetMb > 0 ? (int64_t)budgetMb * 1024 * 1024 : 0;
+}
+
+bool MemoryBudget::IsOverBudget(MemoryComponent component) {
+    const int64_t budget = GetBudget(component);
+    return budget > 0 && GetUsage(component) >= budget;
+}
+
+const char* MemoryBudget::GetName(MemoryComponent component) {
+    switch (component) {
+        case MEMORY_COMPONENT_LOG_BUFFER:
+            return "log_buffer";
+        case MEMORY_COMPONENT_PROCESS_QUEUE:
+            return "process_queue";
+        case MEMORY_COMPONENT_AGGREGATOR:
+            return "aggregator";
+        case MEMORY_COMPONENT_SENDER_QUEUE:
+            return "sender_queue";
+        case MEMORY_COMPONENT_SECONDARY_BUFFER:
+            return "secondary_buffer";
+        case MEMORY_COMPONENT_PLUGIN_QUEUE:
+            return "plugin_queue";
+        default:
+            return "unknown";
+    }
+}
+
+bool MemoryBudget::IsReadBlocked() {
+    return IsOverBudget(MEMORY_COMPONENT_LOG_BUFFER) || IsOverBudget(MEMORY_COMPONENT_PROCESS_QUEUE);
+}
+
+bool MemoryBudget::IsSendBlocked() {
+    return IsOverBudget(MEMORY_COMPONENT_AGGREGATOR) || IsOverBudget(MEMORY_COMPONENT_SENDER_QUEUE)
+        || IsOverBudget(MEMORY_COMPONENT_SECONDARY_BUFFER);
+}
+
+} // namespace logtail
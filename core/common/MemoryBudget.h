@@ -0,0 +1,64 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace logtail {
+
+enum MemoryComponent {
+    MEMORY_COMPONENT_LOG_BUFFER = 0, // buffers read from files and not processed yet
+    MEMORY_COMPONENT_PROCESS_QUEUE, // buffers waiting in process queue, a part of log buffers
+    MEMORY_COMPONENT_AGGREGATOR, // raw bytes of logs in merge items
+    MEMORY_COMPONENT_SENDER_QUEUE, // compressed data in sender queue
+    MEMORY_COMPONENT_SECONDARY_BUFFER, // compressed data waiting to be dumped to buffer file
+    MEMORY_COMPONENT_PLUGIN_QUEUE, // log groups sent by plugin and not consumed yet
+    MEMORY_COMPONENT_COUNT
+};
+
+// MemoryBudget counts bytes held by each component of the pipeline, a budget of each component is set by flag
+// in MB and 0 means unlimited. Components over budget only stop their producers, so data already held is
+// never dropped.
+class MemoryBudget {
+public:
+    static void Add(MemoryComponent component, int64_t bytes) {
+        sUsages[component].fetch_add(bytes, std::memory_order_relaxed);
+    }
+    static void Sub(MemoryComponent component, int64_t bytes) {
+        sUsages[component].fetch_sub(bytes, std::memory_order_relaxed);
+    }
+    static int64_t GetUsage(MemoryComponent component) { return sUsages[component].load(std::memory_order_relaxed); }
+
+    // GetBudget returns the budget in bytes, 0 if unlimited.
+    static int64_t GetBudget(MemoryComponent component);
+    static bool IsOverBudget(MemoryComponent component);
+    static const char* GetName(MemoryComponent component);
+
+    // IsReadBlocked returns true if reader should stop pushing buffers into process queue.
+    static bool IsReadBlocked();
+    // IsSendBlocked returns true if processor and plugin should stop pushing data into aggregator.
+    static bool IsSendBlocked();
+
+private:
+    static std::atomic<int64_t> sUsages[MEMORY_COMPONENT_COUNT];
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class MemoryBudgetUnittest;
+#endif
+};
+
+} // namespace logtail
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace logtail {
+
+// MpscRingQueue is a bounded lock-free queue for multiple producers and a single consumer, each cell carries a
+// sequence number telling whether it is ready to be written or read (Dmitry Vyukov's bounded queue).
+//
+// Capacity is rounded up to the power of 2, TryPush fails instead of blocking if the queue is full.
+template <typename T>
+class MpscRingQueue {
+public:
+    explicit MpscRingQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mMask = size - 1;
+        mCells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            mCells[i].mSequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRingQueue(const MpscRingQueue&) = delete;
+    MpscRingQueue& operator=(const MpscRingQueue&) = delete;
+
+    // TryPush can be called by multiple threads at the same time, @item is moved only if it returns true.
+    bool TryPush(T&& item) {
+        Cell* cell = NULL;
+        size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &mCells[pos & mMask];
+            size_t seq = cell->mSequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->mData = std::move(item);
+        cell->mSequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // TryPop must be called by only one thread.
+    bool TryPop(T& item) {
+        Cell* cell = &mCells[mDequeuePos & mMask];
+        size_t seq = cell->mSequence.load(std::memory_order_acquire);
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(mDequeuePos + 1) < 0) {
+            return false;
+        }
+        item = std::move(cell->mData);
+        cell->mData = T();
+        cell->mSequence.store(mDequeuePos + mMask + 1, std::memory_order_release);
+        ++mDequeuePos;
+        return true;
+    }
+
+    size_t Capacity() const { return mMask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> mSequence;
+        T mData;
+    };
+
+    std::unique_ptr<Cell[]> mCells;
+    size_t mMask = 0;
+    // Producers and the consumer update different positions, keep them in different cache lines.
+    alignas(64) std::atomic<size_t> mEnqueuePos{0};
+    alignas(64) size_t mDequeuePos = 0;
+};
+
+} // namespace logtail
@@ -0,0 +1,142 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "PathTrie.h"
+#include <algorithm>
+#include <cstring>
+
+namespace logtail {
+
+PathTrie::PathTrie(char separator) : mSeparator(separator) {
+}
+
+PathTrie::~PathTrie() {
+    Clear();
+}
+
+void PathTrie::Insert(const std::string& path, int value) {
+    Node* node = FindNode(path, true);
+    if (!node->mHasValue) {
+        node->mHasValue = true;
+        ++mSize;
+    }
+    node->mValue = value;
+}
+
+bool PathTrie::Find(const std::string& path, int& value) const {
+    const Node* node = FindNode(path);
+    if (node == NULL || !node->mHasValue) {
+        return false;
+    }
+    value = node->mValue;
+    return true;
+}
+
+bool PathTrie::Erase(const std::string& path) {
+    Node* node = FindNode(path, false);
+    if (node == NULL || !node->mHasValue) {
+        return false;
+    }
+    node->mHasValue = false;
+    --mSize;
+    // Nodes left with no value and no children are removed up to the nearest one still used.
+    while (node != &mRoot && !node->mHasValue && node->mChildren.empty()) {
+        Node* parent = node->mParent;
+        auto pos = LowerBound(parent, node->mName.data(), node->mName.size());
+        parent->mChildren.erase(pos);
+        delete node;
+        node = parent;
+    }
+    return true;
+}
+
+void PathTrie::FindSubtree(const std::string& path, std::vector<std::pair<std::string, int> >& result) const {
+    const Node* node = FindNode(path);
+    if (node == NULL) {
+        return;
+    }
+    std::string prefix = path.substr(0, path.size() - node->mName.size());
+    if (node->mParent != &mRoot) {
+        prefix.pop_back();
+    }
+    auto append = [&result](const std::string& subPath, int value) { result.emplace_back(subPath, value); };
+    Visit(node, prefix, append);
+}
+
+void PathTrie::FindAncestors(const std::string& path, std::vector<int>& values) const {
+    const Node* node = FindNode(path);
+    for (; node != NULL && node != &mRoot && node->mHasValue; node = node->mParent) {
+        values.push_back(node->mValue);
+    }
+}
+
+void PathTrie::Clear() {
+    for (Node* child : mRoot.mChildren) {
+        Free(child);
+    }
+    mRoot.mChildren.clear();
+    mSize = 0;
+}
+
+PathTrie::Node* PathTrie::FindNode(const std::string& path, bool create) {
+    Node* node = &mRoot;
+    size_t begin = 0;
+    while (true) {
+        size_t end = path.find(mSeparator, begin);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        const char* name = path.data() + begin;
+        const size_t len = end - begin;
+        auto pos = LowerBound(node, name, len);
+        if (pos != node->mChildren.end() && (*pos)->mName.size() == len
+            && memcmp((*pos)->mName.data(), name, len) == 0) {
+            node = *pos;
+        } else if (create) {
+            Node* child = new Node;
+            child->mName.assign(name, len);
+            child->mParent = node;
+            node->mChildren.insert(pos, child);
+            node = child;
+        } else {
+            return NULL;
+        }
+        if (end == path.size()) {
+            return node;
+        }
+        begin = end + 1;
+    }
+}
+
+const PathTrie::Node* PathTrie::FindNode(const std::string& path) const {
+    return const_cast<PathTrie*>(this)->FindNode(path, false);
+}
+
+std::vector<PathTrie::Node*>::const_iterator PathTrie::LowerBound(const Node* node, const char* name, size_t len) {
+    return std::lower_bound(
+        node->mChildren.begin(), node->mChildren.end(), name, [len](const Node* child, const char* key) {
+            int ret = memcmp(child->mName.data(), key, std::min(child->mName.size(), len));
+            return ret < 0 || (ret == 0 && child->mName.size() < len);
+        });
+}
+
+void PathTrie::Free(Node* node) {
+    for (Node* child : node->mChildren) {
+        Free(child);
+    }
+    delete node;
+}
+
+} // namespace logtail
@@ -0,0 +1,94 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace logtail {
+
+// PathTrie maps paths to int values with one path component per node, so paths under a dir share the nodes of
+// the dir and the subtree of a dir is walked without looking at other paths. Paths are split at each separator,
+// "/a/b", "/a/b/" and "a/b" are different paths.
+class PathTrie {
+public:
+    explicit PathTrie(char separator);
+    ~PathTrie();
+
+    // Insert sets the value of @path, the previous one is replaced.
+    void Insert(const std::string& path, int value);
+    bool Find(const std::string& path, int& value) const;
+    bool Erase(const std::string& path);
+    // FindSubtree appends @path and paths under it to @result with their values.
+    void FindSubtree(const std::string& path, std::vector<std::pair<std::string, int> >& result) const;
+    // FindAncestors appends values of @path and its ancestors to @values, the nearest first, and stops at the
+    // first one without value.
+    void FindAncestors(const std::string& path, std::vector<int>& values) const;
+    // ForEach calls @func(path, value) for all paths.
+    template <typename F>
+    void ForEach(F func) const {
+        std::string path;
+        for (const Node* child : mRoot.mChildren) {
+            Visit(child, path, func);
+        }
+    }
+
+    size_t Size() const { return mSize; }
+    void Clear();
+
+    PathTrie(const PathTrie&) = delete;
+    PathTrie& operator=(const PathTrie&) = delete;
+
+private:
+    struct Node {
+        std::string mName;
+        Node* mParent = nullptr;
+        std::vector<Node*> mChildren; // sorted by name
+        int mValue = 0;
+        bool mHasValue = false;
+    };
+
+    // FindNode returns NULL if @path has no node, it is created if @create is true.
+    Node* FindNode(const std::string& path, bool create);
+    const Node* FindNode(const std::string& path) const;
+    static std::vector<Node*>::const_iterator LowerBound(const Node* node, const char* name, size_t len);
+    static void Free(Node* node);
+
+    template <typename F>
+    void Visit(const Node* node, std::string& path, F& func) const {
+        const size_t size = path.size();
+        if (node->mParent != &mRoot) {
+            path += mSeparator;
+        }
+        path += node->mName;
+        if (node->mHasValue) {
+            func(path, node->mValue);
+        }
+        for (const Node* child : node->mChildren) {
+            Visit(child, path, func);
+        }
+        path.resize(size);
+    }
+
+    Node mRoot;
+    char mSeparator;
+    size_t mSize = 0;
+};
+
+} // namespace logtail
@@ -0,0 +1,66 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RegexCache.h"
+#include <algorithm>
+
+namespace logtail {
+
+RegexPtr RegexCache::Get(const std::string& pattern, boost::regex::flag_type flags) {
+    std::string key(reinterpret_cast<const char*>(&flags), sizeof(flags));
+    key.append(pattern);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto iter = mRegexes.find(key);
+        if (iter != mRegexes.end()) {
+            RegexPtr regex = iter->second.lock();
+            if (regex) {
+                return regex;
+            }
+        }
+    }
+
+    // Compiled without the lock, patterns might be slow to compile.
+    RegexPtr regex = std::make_shared<const boost::regex>(pattern, flags);
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::weak_ptr<const boost::regex>& entry = mRegexes[key];
+    RegexPtr cached = entry.lock();
+    if (cached) {
+        // Compiled by another thread at the same time.
+        return cached;
+    }
+    entry = regex;
+    if (mRegexes.size() >= mPurgeSize) {
+        PurgeExpired();
+    }
+    return regex;
+}
+
+size_t RegexCache::Size() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRegexes.size();
+}
+
+void RegexCache::PurgeExpired() {
+    for (auto iter = mRegexes.begin(); iter != mRegexes.end();) {
+        if (iter->second.expired()) {
+            iter = mRegexes.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+    mPurgeSize = std::max(static_cast<size_t>(64), mRegexes.size() * 2);
+}
+
+} // namespace logtail
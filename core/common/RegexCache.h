@@ -0,0 +1,62 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <boost/regex.hpp>
+
+namespace logtail {
+
+typedef std::shared_ptr<const boost::regex> RegexPtr;
+
+// RegexCache is the process-wide cache of compiled regexes, keyed by pattern and flags. Readers and filters
+// with the same pattern share one immutable regex, which is released when its last user is gone, so
+// recreating readers does not compile the pattern again while others still hold it.
+class RegexCache {
+public:
+    static RegexCache* GetInstance() {
+        static RegexCache* sInstance = new RegexCache;
+        return sInstance;
+    }
+
+    // Get returns the regex compiled from @pattern with @flags, it throws boost::regex_error as the
+    // constructor of boost::regex does if @pattern is invalid.
+    RegexPtr Get(const std::string& pattern, boost::regex::flag_type flags = boost::regex::normal);
+
+    // Size returns the count of cached patterns, including released ones not purged yet.
+    size_t Size() const;
+
+private:
+    RegexCache() = default;
+
+    // PurgeExpired removes entries of released regexes, called with mMutex held.
+    void PurgeExpired();
+
+    mutable std::mutex mMutex;
+    std::unordered_map<std::string, std::weak_ptr<const boost::regex>> mRegexes;
+    // Released entries are purged when the cache grows to this size, so the purge cost is amortized.
+    size_t mPurgeSize = 64;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class RegexCacheUnittest;
+#endif
+};
+
+} // namespace logtail
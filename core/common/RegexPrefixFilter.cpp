@@ -0,0 +1,350 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RegexPrefixFilter.h"
+#include <cctype>
+
+namespace logtail {
+
+namespace {
+
+    typedef std::bitset<256> CharSet;
+
+    // Long enough to reject continuation lines, and keeps MayMatch cheap.
+    const size_t kMaxPrefixLength = 32;
+
+    void AddRange(CharSet& set, unsigned char from, unsigned char to) {
+        for (unsigned int c = from; c <= to; ++c) {
+            set.set(c);
+        }
+    }
+
+    // Meaning of non-ASCII bytes depends on locale, so class escapes always accept them.
+    void AddNonAscii(CharSet& set) { AddRange(set, 0x80, 0xFF); }
+
+    // AddClassEscape handles \d \D \w \W \s \S.
+    bool AddClassEscape(char escape, CharSet& set) {
+        CharSet cls;
+        switch (tolower(escape)) {
+            case 'd':
+                AddRange(cls, '0', '9');
+                break;
+            case 'w':
+                AddRange(cls, '0', '9');
+                AddRange(cls, 'a', 'z');
+                AddRange(cls, 'A', 'Z');
+                cls.set('_');
+                break;
+            case 's':
+                AddRange(cls, '\t', '\r');
+                cls.set(' ');
+                break;
+            default:
+                return false;
+        }
+        if (isupper(escape)) {
+            cls.flip();
+        }
+        AddNonAscii(cls);
+        set |= cls;
+        return true;
+    }
+
+    bool GetControlEscape(char escape, unsigned char& c) {
+        switch (escape) {
+            case 't':
+                c = '\t';
+                return true;
+            case 'n':
+                c = '\n';
+                return true;
+            case 'r':
+                c = '\r';
+                return true;
+            case 'f':
+                c = '\f';
+                return true;
+            case 'v':
+                c = '\v';
+                return true;
+            case 'a':
+                c = '\a';
+                return true;
+            case 'e':
+                c = 0x1B;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // ParseEscape parses the escape sequence after '\' at @pos as a single char
+    // or a char class. Assertions (\b, \A, ...), back references and others are
+    // not supported.
+    bool ParseEscape(const std::string& regex, size_t& pos, CharSet& set) {
+        if (pos >= regex.size()) {
+            return false;
+        }
+        const char escape = regex[pos];
+        unsigned char c = 0;
+        if (AddClassEscape(escape, set)) {
+            ++pos;
+            return true;
+        }
+        if (GetControlEscape(escape, c)) {
+            set.set(c);
+            ++pos;
+            return true;
+        }
+        if (static_cast<unsigned char>(escape) < 0x80 && !isalnum(escape)) {
+            set.set(static_cast<unsigned char>(escape));
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    // ParseBracket parses [...] starting at @pos (points to '['), on success, @pos
+    // points to the char after ']'.
+    bool ParseBracket(const std::string& regex, size_t& pos, CharSet& set) {
+        size_t cur = pos + 1;
+        bool negative = false;
+        if (cur < regex.size() && regex[cur] == '^') {
+            negative = true;
+            ++cur;
+        }
+        CharSet cls;
+        bool first = true;
+        while (cur < regex.size()) {
+            char c = regex[cur];
+            if (c == ']' && !first) {
+                break;
+            }
+            first = false;
+            if (c == '[') {
+                // [:alpha:], [=a=], [.a.] are not supported.
+                if (cur + 1 < regex.size() && (regex[cur + 1] == ':' || regex[cur + 1] == '=' || regex[cur + 1] == '.')) {
+                    return false;
+                }
+            }
+            unsigned char from = static_cast<unsigned char>(c);
+            if (c == '\\') {
+                ++cur;
+                if (cur >= regex.size()) {
+                    return false;
+                }
+                const char escape = regex[cur];
+                if (AddClassEscape(escape, cls)) {
+                    ++cur;
+                    continue;
+                }
+                if (!GetControlEscape(escape, from)) {
+                    if (static_cast<unsigned char>(escape) >= 0x80 || isalnum(escape)) {
+                        return false;
+                    }
+                    from = static_cast<unsigned char>(escape);
+                }
+            }
+            ++cur;
+            // Range, such as a-z, '-' before ']' is a literal.
+            if (cur + 1 < regex.size() && regex[cur] == '-' && regex[cur + 1] != ']') {
+                unsigned char to = static_cast<unsigned char>(regex[cur + 1]);
+                if (to == '\\' || to == '[' || to < from) {
+                    return false;
+                }
+                AddRange(cls, from, to);
+                cur += 2;
+            } else {
+                cls.set(from);
+            }
+        }
+        if (cur >= regex.size()) {
+            return false;
+        }
+        if (negative) {
+            cls.flip();
+            AddNonAscii(cls);
+        }
+        set |= cls;
+        pos = cur + 1;
+        return true;
+    }
+
+    // ParseAtom parses a single char atom (literal, escape, '.' or bracket).
+    bool ParseAtom(const std::string& regex, size_t& pos, CharSet& set) {
+        const char c = regex[pos];
+        switch (c) {
+            case '\\':
+                ++pos;
+                return ParseEscape(regex, pos, set);
+            case '[':
+                return ParseBracket(regex, pos, set);
+            case '.':
+                set.set();
+                ++pos;
+                return true;
+            case '^':
+            case '$':
+            case '(':
+            case ')':
+            case '|':
+            case '*':
+            case '+':
+            case '?':
+            case '{':
+                return false;
+            default:
+                set.set(static_cast<unsigned char>(c));
+                ++pos;
+                return true;
+        }
+    }
+
+    // ParseQuantifier parses the quantifier at @pos if exists.
+    // @minRepeat: times the atom must repeat.
+    // @fixed: true if the atom repeats exactly @minRepeat times.
+    // @return false if the quantifier is malformed.
+    bool ParseQuantifier(const std::string& regex, size_t& pos, size_t& minRepeat, bool& fixed) {
+        minRepeat = 1;
+        fixed = true;
+        if (pos >= regex.size()) {
+            return true;
+        }
+        switch (regex[pos]) {
+            case '*':
+            case '?':
+                minRepeat = 0;
+                fixed = false;
+                ++pos;
+                break;
+            case '+':
+                fixed = false;
+                ++pos;
+                break;
+            case '{': {
+                size_t cur = pos + 1;
+                size_t minValue = 0;
+                size_t digits = 0;
+                while (cur < regex.size() && isdigit(regex[cur])) {
+                    minValue = minValue * 10 + (regex[cur] - '0');
+                    if (minValue > kMaxPrefixLength) {
+                        minValue = kMaxPrefixLength;
+                    }
+                    ++cur;
+                    ++digits;
+                }
+                if (digits == 0 || cur >= regex.size()) {
+                    return false;
+                }
+                if (regex[cur] == ',') {
+                    fixed = false;
+                    ++cur;
+                    bool sameMax = true;
+                    size_t maxValue = 0;
+                    size_t maxDigits = 0;
+                    while (cur < regex.size() && isdigit(regex[cur])) {
+                        maxValue = maxValue * 10 + (regex[cur] - '0');
+                        if (maxValue > kMaxPrefixLength) {
+                            sameMax = false;
+                        }
+                        ++cur;
+                        ++maxDigits;
+                    }
+                    if (maxDigits > 0 && sameMax && maxValue == minValue) {
+                        fixed = true;
+                    }
+                }
+                if (cur >= regex.size() || regex[cur] != '}') {
+                    return false;
+                }
+                minRepeat = minValue;
+                pos = cur + 1;
+                break;
+            }
+            default:
+                return true;
+        }
+        // Lazy or possessive suffix does not change the minimum repeat.
+        if (pos < regex.size() && (regex[pos] == '?' || regex[pos] == '+')) {
+            ++pos;
+        }
+        return true;
+    }
+
+    // HasTopLevelAlternation checks if @regex contains '|' out of groups, which
+    // makes the prefix optional.
+    bool HasTopLevelAlternation(const std::string& regex) {
+        int depth = 0;
+        for (size_t pos = 0; pos < regex.size(); ++pos) {
+            const char c = regex[pos];
+            if (c == '\\') {
+                ++pos;
+            } else if (c == '[') {
+                size_t cur = pos;
+                CharSet ignored;
+                if (!ParseBracket(regex, cur, ignored)) {
+                    return true;
+                }
+                pos = cur - 1;
+            } else if (c == '(') {
+                ++depth;
+            } else if (c == ')') {
+                --depth;
+            } else if (c == '|' && depth <= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // namespace
+
+RegexPrefixFilterPtr RegexPrefixFilter::Create(const std::string& regex) {
+    if (regex.empty() || HasTopLevelAlternation(regex)) {
+        return RegexPrefixFilterPtr();
+    }
+
+    RegexPrefixFilterPtr filter(new RegexPrefixFilter);
+    std::vector<CharSet>& prefix = filter->mPrefix;
+    // The regex is used with regex_match, so leading '^' is redundant.
+    size_t pos = regex[0] == '^' ? 1 : 0;
+    while (pos < regex.size() && prefix.size() < kMaxPrefixLength) {
+        CharSet set;
+        if (!ParseAtom(regex, pos, set)) {
+            break;
+        }
+        size_t minRepeat = 1;
+        bool fixed = true;
+        if (!ParseQuantifier(regex, pos, minRepeat, fixed)) {
+            break;
+        }
+        for (size_t i = 0; i < minRepeat && prefix.size() < kMaxPrefixLength; ++i) {
+            prefix.push_back(set);
+        }
+        if (!fixed) {
+            break;
+        }
+    }
+
+    // Trailing '.' only checks length, drop them.
+    while (!prefix.empty() && prefix.back().all()) {
+        prefix.pop_back();
+    }
+    if (prefix.empty()) {
+        return RegexPrefixFilterPtr();
+    }
+    return filter;
+}
+
+} // namespace logtail
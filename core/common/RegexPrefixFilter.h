@@ -0,0 +1,72 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <bitset>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace logtail {
+
+class RegexPrefixFilter;
+typedef std::shared_ptr<RegexPrefixFilter> RegexPrefixFilterPtr;
+
+// RegexPrefixFilter is a cheap byte-level check extracted from the fixed prefix
+// of a regex used with regex_match, such as log_begin_reg.
+// For example, ^\d{4}-\d{2} is converted to 7 char sets: [0-9]x4, '-', [0-9]x2.
+// A line that does not pass MayMatch can never match the regex, so the full
+// regex only has to be run on candidate lines.
+class RegexPrefixFilter {
+public:
+    // Create analyzes @regex (perl syntax, case sensitive).
+    // @return nullptr if no useful prefix can be extracted, such as .*, (a|b).*, a|b.
+    static RegexPrefixFilterPtr Create(const std::string& regex);
+
+    // MayMatch checks the NUL-terminated @line.
+    // @return false if @line can not match the regex.
+    bool MayMatch(const char* line) const {
+        for (size_t i = 0; i < mPrefix.size(); ++i) {
+            const unsigned char c = static_cast<unsigned char>(line[i]);
+            if (c == '\0' || !mPrefix[i].test(c)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool MayMatch(const char* line, size_t length) const {
+        if (length < mPrefix.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < mPrefix.size(); ++i) {
+            if (!mPrefix[i].test(static_cast<unsigned char>(line[i]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t GetPrefixLength() const { return mPrefix.size(); }
+
+private:
+    typedef std::bitset<256> CharSet;
+
+    std::vector<CharSet> mPrefix;
+};
+
+} // namespace logtail
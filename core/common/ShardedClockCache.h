@@ -0,0 +1,163 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common/HashUtil.h"
+#include "common/Lock.h"
+
+namespace logtail {
+
+// ShardedClockCache is a size-bounded cache keyed by a pair of strings, such as the directory and name of a file.
+//
+// Entries are spread over shards by the 64-bit hash of the key, each shard with a spin lock of its own, and the
+// key is kept in the entry to verify hits against hash collisions. A full shard evicts by the CLOCK policy: the
+// hand skips and clears entries referenced since it passed last time, and replaces the first unreferenced one.
+// Invalidate increases the generation of the cache instead of clearing it, entries of an older generation are
+// misses and are replaced first.
+template <class V>
+class ShardedClockCache {
+public:
+    explicit ShardedClockCache(size_t capacity, size_t shardCount = 16) {
+        if (shardCount == 0) {
+            shardCount = 1;
+        }
+        mShardCapacity = capacity / shardCount > 0 ? capacity / shardCount : 1;
+        for (size_t i = 0; i < shardCount; ++i) {
+            mShards.emplace_back(new Shard);
+        }
+    }
+
+    bool Get(const std::string& dir, const std::string& name, V& value) {
+        const uint64_t hash = Hash(dir, name);
+        Shard& shard = GetShard(hash);
+        ScopedSpinLock lock(shard.mLock);
+        auto itr = shard.mIndex.find(hash);
+        if (itr == shard.mIndex.end()) {
+            return false;
+        }
+        Entry& entry = shard.mEntries[itr->second];
+        if (entry.mGeneration != mGeneration.load(std::memory_order_relaxed) || entry.mDir != dir
+            || entry.mName != name) {
+            return false;
+        }
+        entry.mReferenced = true;
+        value = entry.mValue;
+        return true;
+    }
+
+    void Put(const std::string& dir, const std::string& name, const V& value) {
+        const uint64_t hash = Hash(dir, name);
+        Shard& shard = GetShard(hash);
+        ScopedSpinLock lock(shard.mLock);
+        size_t slot = 0;
+        auto itr = shard.mIndex.find(hash);
+        if (itr != shard.mIndex.end()) {
+            // Same key, stale entry or hash collision, the latest one wins.
+            slot = itr->second;
+        } else if (shard.mEntries.size() < mShardCapacity) {
+            slot = shard.mEntries.size();
+            shard.mEntries.emplace_back();
+            shard.mIndex[hash] = slot;
+        } else {
+            slot = Evict(shard);
+            shard.mIndex.erase(shard.mEntries[slot].mHash);
+            shard.mIndex[hash] = slot;
+        }
+        Entry& entry = shard.mEntries[slot];
+        entry.mHash = hash;
+        entry.mDir = dir;
+        entry.mName = name;
+        entry.mValue = value;
+        entry.mGeneration = mGeneration.load(std::memory_order_relaxed);
+        entry.mReferenced = true;
+    }
+
+    // Invalidate makes all cached entries misses.
+    void Invalidate() { mGeneration.fetch_add(1, std::memory_order_relaxed); }
+
+    // Clear removes all entries and frees their memory.
+    void Clear() {
+        for (auto& shard : mShards) {
+            ScopedSpinLock lock(shard->mLock);
+            shard->mIndex.clear();
+            std::vector<Entry>().swap(shard->mEntries);
+            shard->mHand = 0;
+        }
+    }
+
+    size_t Size() {
+        size_t size = 0;
+        for (auto& shard : mShards) {
+            ScopedSpinLock lock(shard->mLock);
+            size += shard->mEntries.size();
+        }
+        return size;
+    }
+
+    size_t GetCapacity() const { return mShardCapacity * mShards.size(); }
+
+private:
+    struct Entry {
+        uint64_t mHash = 0;
+        std::string mDir;
+        std::string mName;
+        V mValue;
+        uint64_t mGeneration = 0;
+        bool mReferenced = false;
+    };
+
+    struct Shard {
+        SpinLock mLock;
+        std::unordered_map<uint64_t, size_t> mIndex;
+        std::vector<Entry> mEntries;
+        size_t mHand = 0;
+    };
+
+    static uint64_t Hash(const std::string& dir, const std::string& name) {
+        int64_t hash = HashString(dir.data(), dir.size(), kHashStringSeed);
+        hash = HashString("<", 1, hash);
+        return static_cast<uint64_t>(HashString(name.data(), name.size(), hash));
+    }
+
+    Shard& GetShard(uint64_t hash) { return *mShards[(hash >> 32) % mShards.size()]; }
+
+    // Evict returns the slot to be replaced, the shard must be full.
+    size_t Evict(Shard& shard) {
+        const uint64_t generation = mGeneration.load(std::memory_order_relaxed);
+        while (true) {
+            size_t slot = shard.mHand;
+            shard.mHand = (shard.mHand + 1) % shard.mEntries.size();
+            Entry& entry = shard.mEntries[slot];
+            if (entry.mReferenced && entry.mGeneration == generation) {
+                entry.mReferenced = false;
+                continue;
+            }
+            return slot;
+        }
+    }
+
+    std::vector<std::unique_ptr<Shard>> mShards;
+    size_t mShardCapacity;
+    std::atomic<uint64_t> mGeneration{0};
+};
+
+} // namespace logtail
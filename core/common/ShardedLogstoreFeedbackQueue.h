@@ -0,0 +1,463 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include "LogstoreFeedbackQueue.h"
+
+namespace logtail {
+
+// ShardedLogstoreFeedbackQueue has the same interface and feedback/priority
+// semantics as LogstoreFeedbackQueue, but it does not serialize all pushes and
+// pops with one mutex:
+// - Each logstore queue is a bounded ring protected by its own spin lock.
+// - The map of queues is protected by a read-write lock, only adding/deleting
+//   queues and changing priorities take the write lock.
+// - Every queue owns a slot in an atomic ready-set bitmap, the bit is set when
+//   the ring is not empty, so pop only visits logstores that have data.
+template <class T, class PARAM = LogstoreFeedbackQueueParam>
+class ShardedLogstoreFeedbackQueue : public LogstoreFeedBackInterface {
+protected:
+    class SingleLogStoreQueue : public SingleLogstoreFeedbackQueue<T, PARAM> {
+    public:
+        SpinLock mQueueLock;
+        size_t mSlot = 0;
+    };
+
+    typedef std::unordered_map<LogstoreFeedBackKey, SingleLogStoreQueue> LogstoreFeedBackQueueMap;
+    typedef typename LogstoreFeedBackQueueMap::iterator LogstoreFeedBackQueueMapIterator;
+
+    struct SingleLogStorePriorityQueue {
+        SingleLogStoreQueue* mQueue;
+        LogstoreFeedBackKey mKey;
+        int32_t mPriority;
+
+        SingleLogStorePriorityQueue() {}
+
+        SingleLogStorePriorityQueue(int32_t priority, const LogstoreFeedBackKey& key, SingleLogStoreQueue* queue)
+            : mQueue(queue), mKey(key), mPriority(priority) {}
+    };
+
+    typedef std::vector<SingleLogStorePriorityQueue> LogstoreFeedBackQueueVector;
+
+    static const size_t kBitsPerWord = 64;
+
+public:
+    ShardedLogstoreFeedbackQueue() : mFeedBackObj(NULL), mReadyWordCount(0) {}
+
+    void SetParam(const size_t lowSize, const size_t highSize, const size_t maxSize) {
+        PARAM* pParam = PARAM::GetInstance();
+        pParam->SetLowSize(lowSize);
+        pParam->SetHighSize(highSize);
+        pParam->SetMaxSize(maxSize);
+    }
+
+    void SetFeedBackObject(LogstoreFeedBackInterface* pFeedbackObj) {
+        WriteLock lock(mMapLock);
+        mFeedBackObj = pFeedbackObj;
+    }
+
+    bool Wait(int32_t waitMs) { return mTrigger.Wait(waitMs); }
+
+    void Signal() { mTrigger.Trigger(); }
+
+    // A queue which does not exist yet is valid.
+    bool IsValid(const LogstoreFeedBackKey& key) {
+        ReadLock lock(mMapLock);
+        auto iter = mLogstoreQueueMap.find(key);
+        return iter == mLogstoreQueueMap.end() || iter->second.IsValid();
+    }
+
+    bool PushItem(const LogstoreFeedBackKey& key, const T& item) {
+        bool pushed = false;
+        bool found = false;
+        {
+            ReadLock lock(mMapLock);
+            auto iter = mLogstoreQueueMap.find(key);
+            if (iter != mLogstoreQueueMap.end()) {
+                found = true;
+                pushed = PushToQueue(iter->second, item);
+            }
+        }
+        if (!found) {
+            WriteLock lock(mMapLock);
+            pushed = PushToQueue(GetQueueNoLock(key), item);
+        }
+        if (pushed) {
+            mTrigger.Trigger();
+        }
+        return pushed;
+    }
+
+    // PopItem pops without checking downstream, for test only.
+    bool PopItem(LogstoreFeedBackKey& startKey, T& item) {
+        std::vector<T> items;
+        if (!PopNextItems(startKey, items, 1, NULL, 0, 1)) {
+            return false;
+        }
+        item = items[0];
+        return true;
+    }
+
+    bool CheckAndPopNextItem(LogstoreFeedBackKey& startKey,
+                             T& item,
+                             LogstoreFeedBackInterface* pCheckObj,
+                             int32_t threadNo,
+                             int32_t threadNum) {
+        std::vector<T> items;
+        if (!CheckAndPopNextItems(startKey, items, 1, pCheckObj, threadNo, threadNum)) {
+            return false;
+        }
+        item = items[0];
+        return true;
+    }
+
+    // Pops at most @maxCount items of the same logstore, @items is cleared at first.
+    bool CheckAndPopNextItems(LogstoreFeedBackKey& startKey,
+                              std::vector<T>& items,
+                              size_t maxCount,
+                              LogstoreFeedBackInterface* pCheckObj,
+                              int32_t threadNo,
+                              int32_t threadNum) {
+        items.clear();
+        if (pCheckObj == NULL) {
+            return false;
+        }
+        return PopNextItems(startKey, items, maxCount, pCheckObj, threadNo, threadNum);
+    }
+
+    bool IsEmpty() {
+        ReadLock lock(mMapLock);
+        for (auto iter = mLogstoreQueueMap.begin(); iter != mLogstoreQueueMap.end(); ++iter) {
+            if (!iter->second.IsEmpty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool IsEmpty(const LogstoreFeedBackKey& key) {
+        ReadLock lock(mMapLock);
+        auto iter = mLogstoreQueueMap.find(key);
+        return iter == mLogstoreQueueMap.end() || iter->second.IsEmpty();
+    }
+
+    // Lock blocks all operations until Unlock, used to hold on processors.
+    void Lock() { mMapLock.lock(); }
+
+    void Unlock() { mMapLock.unlock(); }
+
+    virtual void FeedBack(const LogstoreFeedBackKey& key) { mTrigger.Trigger(); }
+
+    virtual bool IsValidToPush(const LogstoreFeedBackKey& key) { return IsValid(key); }
+
+    void
+    GetStatus(int32_t& normalInvalidCount, int32_t& normalTotalCount, int32_t& eoInvalidCount, int32_t& eoTotalCount) {
+        ReadLock lock(mMapLock);
+        for (auto iter = mLogstoreQueueMap.begin(); iter != mLogstoreQueueMap.end(); ++iter) {
+            bool isExactlyOnceQueue = iter->second.GetQueueType() == QueueType::ExactlyOnce;
+            auto& invalid = isExactlyOnceQueue ? eoInvalidCount : normalInvalidCount;
+            auto& total = isExactlyOnceQueue ? eoTotalCount : normalTotalCount;
+
+            ++total;
+            if (!iter->second.IsValid()) {
+                ++invalid;
+            }
+        }
+    }
+
+    void Delete(const LogstoreFeedBackKey& key) {
+        WriteLock lock(mMapLock);
+        auto iter = mLogstoreQueueMap.find(key);
+        if (iter != mLogstoreQueueMap.end()) {
+            ReleaseSlotNoLock(iter->second.mSlot);
+            mLogstoreQueueMap.erase(iter);
+        }
+    }
+
+    void DeletePriority(const LogstoreFeedBackKey& key) {
+        WriteLock lock(mMapLock);
+        DeletePriorityNoLock(key);
+    }
+
+    void SetPriority(const LogstoreFeedBackKey& key, int32_t priority) {
+        WriteLock lock(mMapLock);
+        SetPriorityNoLock(key, priority);
+    }
+
+    void SetPriorityNoLock(const LogstoreFeedBackKey& key, int32_t priority) {
+        if (priority < 1 || priority > MAX_CONFIG_PRIORITY_LEVEL) {
+            return;
+        }
+        priority -= 1;
+        // should delete this key first
+        DeletePriorityNoLock(key);
+        mPriorityQueueArray[priority].push_back(SingleLogStorePriorityQueue(priority, key, &GetQueueNoLock(key)));
+    }
+
+    void DeletePriorityNoLock(const LogstoreFeedBackKey& key) {
+        for (size_t i = 0; i < MAX_CONFIG_PRIORITY_LEVEL; ++i) {
+            for (auto iter = mPriorityQueueArray[i].begin(); iter != mPriorityQueueArray[i].end(); ++iter) {
+                if (iter->mKey == key) {
+                    mPriorityQueueArray[i].erase(iter);
+                    return;
+                }
+            }
+        }
+    }
+
+    // CPU quotas of queues, queues which have used up their quotas are not popped.
+    CpuQuotaTable& GetCpuQuotas() { return mCpuQuotas; }
+
+    void ConvertToExactlyOnceQueue(const LogstoreFeedBackKey& key) {
+        WriteLock lock(mMapLock);
+        GetQueueNoLock(key).SetType(QueueType::ExactlyOnce);
+    }
+
+protected:
+    ReadWriteLock mMapLock;
+    TriggerEvent mTrigger;
+    LogstoreFeedBackInterface* mFeedBackObj;
+    LogstoreFeedBackQueueMap mLogstoreQueueMap;
+    CpuQuotaTable mCpuQuotas;
+    LogstoreFeedBackQueueVector mPriorityQueueArray[MAX_CONFIG_PRIORITY_LEVEL];
+
+    // Slot -> key, slots of deleted queues are reused.
+    std::vector<LogstoreFeedBackKey> mSlotKeys;
+    std::vector<size_t> mFreeSlots;
+    std::unique_ptr<std::atomic<uint64_t>[]> mReadyBits;
+    size_t mReadyWordCount;
+
+private:
+    // Must hold write lock.
+    SingleLogStoreQueue& GetQueueNoLock(const LogstoreFeedBackKey& key) {
+        auto iter = mLogstoreQueueMap.find(key);
+        if (iter != mLogstoreQueueMap.end()) {
+            return iter->second;
+        }
+        SingleLogStoreQueue& queue = mLogstoreQueueMap[key];
+        queue.mSlot = AllocateSlotNoLock(key);
+        return queue;
+    }
+
+    size_t AllocateSlotNoLock(const LogstoreFeedBackKey& key) {
+        if (!mFreeSlots.empty()) {
+            size_t slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+            mSlotKeys[slot] = key;
+            return slot;
+        }
+        size_t slot = mSlotKeys.size();
+        mSlotKeys.push_back(key);
+        if (mSlotKeys.size() > mReadyWordCount * kBitsPerWord) {
+            size_t wordCount = mReadyWordCount == 0 ? 1 : mReadyWordCount * 2;
+            std::unique_ptr<std::atomic<uint64_t>[]> readyBits(new std::atomic<uint64_t>[wordCount]);
+            for (size_t i = 0; i < wordCount; ++i) {
+                readyBits[i].store(i < mReadyWordCount ? mReadyBits[i].load() : 0);
+            }
+            mReadyBits.swap(readyBits);
+            mReadyWordCount = wordCount;
+        }
+        return slot;
+    }
+
+    void ReleaseSlotNoLock(size_t slot) {
+        ClearReady(slot);
+        mFreeSlots.push_back(slot);
+    }
+
+    static size_t CountTrailingZero(uint64_t word) {
+#if defined(_MSC_VER)
+        unsigned long idx = 0;
+        _BitScanForward64(&idx, word);
+        return static_cast<size_t>(idx);
+#else
+        return static_cast<size_t>(__builtin_ctzll(word));
+#endif
+    }
+
+    void SetReady(size_t slot) {
+        mReadyBits[slot / kBitsPerWord].fetch_or(1ULL << (slot % kBitsPerWord), std::memory_order_release);
+    }
+
+    void ClearReady(size_t slot) {
+        mReadyBits[slot / kBitsPerWord].fetch_and(~(1ULL << (slot % kBitsPerWord)), std::memory_order_release);
+    }
+
+    // @return the first ready slot in [begin, end), or end if not found.
+    size_t FindReadySlot(size_t begin, size_t end) const {
+        size_t slot = begin;
+        while (slot < end) {
+            uint64_t word = mReadyBits[slot / kBitsPerWord].load(std::memory_order_acquire) >> (slot % kBitsPerWord);
+            if (word == 0) {
+                slot = (slot / kBitsPerWord + 1) * kBitsPerWord;
+                continue;
+            }
+            slot += CountTrailingZero(word);
+            break;
+        }
+        return slot < end ? slot : end;
+    }
+
+    bool PushToQueue(SingleLogStoreQueue& queue, const T& item) {
+        ScopedSpinLock lock(queue.mQueueLock);
+        if (!queue.PushItem(item)) {
+            return false;
+        }
+        SetReady(queue.mSlot);
+        return true;
+    }
+
+    int PopFromQueue(SingleLogStoreQueue& queue, std::vector<T>& items, size_t maxCount) {
+        ScopedSpinLock lock(queue.mQueueLock);
+        int rst = queue.PopItems(items, maxCount);
+        if (queue.IsEmpty()) {
+            ClearReady(queue.mSlot);
+        }
+        return rst;
+    }
+
+    bool CanPopItem(int32_t threadNo,
+                    int32_t threadNum,
+                    LogstoreFeedBackInterface* checkObj,
+                    const LogstoreFeedBackKey& key,
+                    SingleLogStoreQueue& queue) {
+        // For each exactly once queue, only one thread can process it.
+        if (queue.GetQueueType() == QueueType::ExactlyOnce && (key % threadNum != threadNo)) {
+            return false;
+        }
+        if (!mCpuQuotas.Empty() && mCpuQuotas.IsExceeded(key, GetSteadyTimeInMilliSeconds())) {
+            return false;
+        }
+        return checkObj == NULL || checkObj->IsValidToPush(key);
+    }
+
+    // Pops items from ready slots in [begin, end), @return rst of PopItems.
+    int PopReadySlots(size_t begin,
+                      size_t end,
+                      LogstoreFeedBackKey& popKey,
+                      std::vector<T>& items,
+                      size_t maxCount,
+                      LogstoreFeedBackInterface* pCheckObj,
+                      int32_t threadNo,
+                      int32_t threadNum) {
+        for (size_t slot = FindReadySlot(begin, end); slot < end; slot = FindReadySlot(slot + 1, end)) {
+            const LogstoreFeedBackKey key = mSlotKeys[slot];
+            auto iter = mLogstoreQueueMap.find(key);
+            if (iter == mLogstoreQueueMap.end() || iter->second.mSlot != slot) {
+                // Stale slot, the queue is removed without releasing slot.
+                ClearReady(slot);
+                continue;
+            }
+            if (!CanPopItem(threadNo, threadNum, pCheckObj, key, iter->second)) {
+                continue;
+            }
+            int rst = PopFromQueue(iter->second, items, maxCount);
+            if (rst != 0) {
+                popKey = key;
+                return rst;
+            }
+        }
+        return 0;
+    }
+
+    bool PopNextItems(LogstoreFeedBackKey& startKey,
+                      std::vector<T>& items,
+                      size_t maxCount,
+                      LogstoreFeedBackInterface* pCheckObj,
+                      int32_t threadNo,
+                      int32_t threadNum) {
+        if (maxCount == 0) {
+            return false;
+        }
+
+        int rst = 0;
+        LogstoreFeedBackKey popKey = 0;
+        LogstoreFeedBackInterface* feedBackObj = NULL;
+        {
+            ReadLock lock(mMapLock);
+            if (mLogstoreQueueMap.empty()) {
+                return false;
+            }
+            feedBackObj = mFeedBackObj;
+
+            // Iterate queues by priority at first, don't set start key for fairness.
+            for (size_t i = 0; i < MAX_CONFIG_PRIORITY_LEVEL && rst == 0; ++i) {
+                for (auto iter = mPriorityQueueArray[i].begin(); iter != mPriorityQueueArray[i].end(); ++iter) {
+                    if (iter->mQueue->IsEmpty()
+                        || !CanPopItem(threadNo, threadNum, pCheckObj, iter->mKey, *(iter->mQueue))) {
+                        continue;
+                    }
+                    rst = PopFromQueue(*(iter->mQueue), items, maxCount);
+                    if (rst != 0) {
+                        popKey = iter->mKey;
+                        break;
+                    }
+                }
+            }
+
+            // Iterate ready slots, start from the slot next to startKey for fairness.
+            if (rst == 0) {
+                const size_t slotCount = mSlotKeys.size();
+                size_t startSlot = 0;
+                auto startIter = mLogstoreQueueMap.find(startKey);
+                if (startIter != mLogstoreQueueMap.end()) {
+                    startSlot = startIter->second.mSlot + 1;
+                }
+                rst = PopReadySlots(startSlot, slotCount, popKey, items, maxCount, pCheckObj, threadNo, threadNum);
+                if (rst == 0) {
+                    rst = PopReadySlots(0, startSlot, popKey, items, maxCount, pCheckObj, threadNo, threadNum);
+                }
+                if (rst != 0) {
+                    startKey = popKey;
+                }
+            }
+        }
+
+        if (rst == 2 && feedBackObj != NULL) {
+            feedBackObj->FeedBack(popKey);
+        }
+        return rst != 0;
+    }
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class ExactlyOnceReaderUnittest;
+    friend class SenderUnittest;
+    friend class QueueManagerUnittest;
+
+public:
+    // do not clear real data
+    void RemoveAll() {
+        WriteLock lock(mMapLock);
+        mLogstoreQueueMap.clear();
+        for (size_t i = 0; i < MAX_CONFIG_PRIORITY_LEVEL; ++i) {
+            mPriorityQueueArray[i].clear();
+        }
+        mSlotKeys.clear();
+        mFreeSlots.clear();
+        for (size_t i = 0; i < mReadyWordCount; ++i) {
+            mReadyBits[i].store(0);
+        }
+    }
+#endif
+};
+
+} // namespace logtail
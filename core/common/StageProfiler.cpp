@@ -0,0 +1,95 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "StageProfiler.h"
+#include <chrono>
+#if defined(__linux__)
+#include <time.h>
+#endif
+#include "common/Flags.h"
+
+DEFINE_FLAG_INT32(stage_profile_sample_interval,
+                  "time one of every such calls of each pipeline stage for profiling by config, 0 to disable",
+                  0);
+
+namespace logtail {
+
+namespace {
+
+    uint64_t GetWallTimeNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+} // namespace
+
+const char* StageProfiler::GetStageName(ProfileStage stage) {
+    static const char* sNames[PROFILE_STAGE_COUNT] = {"read", "split", "parse", "filter", "aggregate", "compress"};
+    return stage < PROFILE_STAGE_COUNT ? sNames[stage] : "unknown";
+}
+
+bool StageProfiler::ShouldSample() {
+    const int32_t interval = INT32_FLAG(stage_profile_sample_interval);
+    if (interval <= 0) {
+        return false;
+    }
+    static thread_local uint32_t sCallCount = 0;
+    return ++sCallCount % static_cast<uint32_t>(interval) == 0;
+}
+
+uint64_t StageProfiler::GetThreadCpuTimeNs() {
+#if defined(__linux__)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+    }
+#endif
+    // Wall time is used if thread cpu time is not available.
+    return GetWallTimeNs();
+}
+
+void StageProfiler::Record(const std::string& configName,
+                           ProfileStage stage,
+                           uint64_t cpuTimeNs,
+                           uint64_t wallTimeNs) {
+    ScopedSpinLock lock(mLock);
+    StageStat& stat = mStats[configName][stage];
+    ++stat.mSampleCount;
+    stat.mCpuTimeNs += cpuTimeNs;
+    stat.mWallTimeNs += wallTimeNs;
+}
+
+std::map<std::string, StageProfiler::ConfigStat> StageProfiler::GetStats(bool reset) {
+    std::map<std::string, ConfigStat> stats;
+    ScopedSpinLock lock(mLock);
+    stats.insert(mStats.begin(), mStats.end());
+    if (reset) {
+        mStats.clear();
+    }
+    return stats;
+}
+
+void StageProfileScope::Begin() {
+    mBeginCpuTimeNs = StageProfiler::GetThreadCpuTimeNs();
+    mBeginWallTimeNs = GetWallTimeNs();
+}
+
+void StageProfileScope::End() {
+    const uint64_t cpuTimeNs = StageProfiler::GetThreadCpuTimeNs() - mBeginCpuTimeNs;
+    const uint64_t wallTimeNs = GetWallTimeNs() - mBeginWallTimeNs;
+    StageProfiler::GetInstance()->Record(mConfigName, mStage, cpuTimeNs, wallTimeNs);
+}
+
+} // namespace logtail
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include "common/Lock.h"
+
+namespace logtail {
+
+enum ProfileStage {
+    PROFILE_STAGE_READ = 0,
+    PROFILE_STAGE_SPLIT,
+    PROFILE_STAGE_PARSE,
+    PROFILE_STAGE_FILTER,
+    PROFILE_STAGE_AGGREGATE, // including filter
+    PROFILE_STAGE_COMPRESS,
+    PROFILE_STAGE_COUNT
+};
+
+// StageProfiler records time spent in each stage of the pipeline by config. Only one of every
+// stage_profile_sample_interval calls of a thread is timed, totals are estimated from the samples.
+class StageProfiler {
+public:
+    struct StageStat {
+        uint64_t mSampleCount = 0;
+        uint64_t mCpuTimeNs = 0;
+        uint64_t mWallTimeNs = 0;
+    };
+    typedef std::array<StageStat, PROFILE_STAGE_COUNT> ConfigStat;
+
+    static StageProfiler* GetInstance() {
+        static StageProfiler* sProfiler = new StageProfiler;
+        return sProfiler;
+    }
+
+    static const char* GetStageName(ProfileStage stage);
+
+    // ShouldSample returns true for one of every stage_profile_sample_interval calls of the thread, it is always
+    // false if the interval is not positive.
+    static bool ShouldSample();
+
+    static uint64_t GetThreadCpuTimeNs();
+
+    void Record(const std::string& configName, ProfileStage stage, uint64_t cpuTimeNs, uint64_t wallTimeNs);
+
+    // GetStats returns sampled stats by config, they are cleared if @reset is true.
+    std::map<std::string, ConfigStat> GetStats(bool reset);
+
+private:
+    StageProfiler() = default;
+
+    SpinLock mLock;
+    std::unordered_map<std::string, ConfigStat> mStats;
+};
+
+// StageProfileScope times the scope if it is sampled, @configName must outlive it.
+class StageProfileScope {
+public:
+    StageProfileScope(const std::string& configName, ProfileStage stage)
+        : mConfigName(configName), mStage(stage), mSampled(StageProfiler::ShouldSample()) {
+        if (mSampled) {
+            Begin();
+        }
+    }
+
+    ~StageProfileScope() {
+        if (mSampled) {
+            End();
+        }
+    }
+
+    StageProfileScope(const StageProfileScope&) = delete;
+    StageProfileScope& operator=(const StageProfileScope&) = delete;
+
+private:
+    void Begin();
+    void End();
+
+    const std::string& mConfigName;
+    const ProfileStage mStage;
+    const bool mSampled;
+    uint64_t mBeginCpuTimeNs = 0;
+    uint64_t mBeginWallTimeNs = 0;
+};
+
+} // namespace logtail
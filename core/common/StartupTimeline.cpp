@@ -0,0 +1,132 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "StartupTimeline.h"
+#include <algorithm>
+#include <chrono>
+#include "common/StageProfiler.h"
+#include "common/StringTools.h"
+#include "logger/Logger.h"
+
+namespace logtail {
+
+namespace {
+
+    uint64_t GetSteadyTimeUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+} // namespace
+
+StartupTimeline::StartupTimeline() : mStartUs(GetSteadyTimeUs()) {
+}
+
+uint64_t StartupTimeline::GetElapsedUs() const {
+    const uint64_t now = GetSteadyTimeUs();
+    return now > mStartUs ? now - mStartUs : 0;
+}
+
+StartupTimeline::Phase* StartupTimeline::FindPhase(const std::string& name) {
+    for (auto& phase : mPhases) {
+        if (phase.mName == name) {
+            return &phase;
+        }
+    }
+    return nullptr;
+}
+
+void StartupTimeline::RecordPhase(const std::string& name, uint64_t beginUs, uint64_t wallUs, uint64_t cpuUs) {
+    if (IsFinished()) {
+        return;
+    }
+    ScopedSpinLock lock(mLock);
+    Phase* phase = FindPhase(name);
+    if (phase == nullptr) {
+        mPhases.emplace_back();
+        phase = &mPhases.back();
+        phase->mName = name;
+        phase->mBeginMs = beginUs / 1000;
+    }
+    phase->mWallUs += wallUs;
+    phase->mCpuUs += cpuUs;
+    ++phase->mCount;
+}
+
+void StartupTimeline::RecordMilestone(const std::string& name) {
+    const uint64_t elapsedUs = GetElapsedUs();
+    ScopedSpinLock lock(mLock);
+    if (FindPhase(name) != nullptr) {
+        return;
+    }
+    mPhases.emplace_back();
+    Phase& phase = mPhases.back();
+    phase.mName = name;
+    phase.mBeginMs = elapsedUs / 1000;
+    phase.mCount = 1;
+}
+
+void StartupTimeline::Finish() {
+    RecordMilestone("startup_finished");
+    mFinished = true;
+    LOG_INFO(sLogger, ("startup timeline", ToString()));
+}
+
+std::vector<StartupTimeline::Phase> StartupTimeline::GetPhases() const {
+    std::vector<Phase> phases;
+    {
+        ScopedSpinLock lock(mLock);
+        phases = mPhases;
+    }
+    std::stable_sort(phases.begin(), phases.end(), [](const Phase& lhs, const Phase& rhs) {
+        return lhs.mBeginMs < rhs.mBeginMs;
+    });
+    return phases;
+}
+
+std::string StartupTimeline::ToString() const {
+    std::string result;
+    for (const auto& phase : GetPhases()) {
+        if (!result.empty()) {
+            result += ',';
+        }
+        result += phase.mName + ':' + logtail::ToString(phase.mBeginMs) + ':' + logtail::ToString(phase.mWallUs / 1000)
+            + ':' + logtail::ToString(phase.mCpuUs / 1000);
+    }
+    return result;
+}
+
+StartupPhaseScope::StartupPhaseScope(const char* name)
+    : mName(name), mEnabled(!StartupTimeline::GetInstance()->IsFinished()) {
+    if (mEnabled) {
+        mBeginUs = StartupTimeline::GetInstance()->GetElapsedUs();
+        mBeginCpuTimeNs = StageProfiler::GetThreadCpuTimeNs();
+    }
+}
+
+StartupPhaseScope::~StartupPhaseScope() {
+    if (!mEnabled) {
+        return;
+    }
+    StartupTimeline* timeline = StartupTimeline::GetInstance();
+    const uint64_t endUs = timeline->GetElapsedUs();
+    const uint64_t endCpuTimeNs = StageProfiler::GetThreadCpuTimeNs();
+    timeline->RecordPhase(mName,
+                          mBeginUs,
+                          endUs > mBeginUs ? endUs - mBeginUs : 0,
+                          endCpuTimeNs > mBeginCpuTimeNs ? (endCpuTimeNs - mBeginCpuTimeNs) / 1000 : 0);
+}
+
+} // namespace logtail
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "common/Lock.h"
+
+namespace logtail {
+
+// StartupTimeline records wall and cpu time of each startup phase, phases recorded after Finish are ignored,
+// so the same code run by config reloads is not counted. A phase recorded several times (such as converting
+// each yaml config) is summed and keeps its first begin time. Milestones are points in time reached once,
+// they are recorded even after Finish (such as the first log group sent).
+class StartupTimeline {
+public:
+    struct Phase {
+        std::string mName;
+        uint64_t mBeginMs = 0; // since the timeline is created
+        uint64_t mWallUs = 0;
+        uint64_t mCpuUs = 0; // of the recording thread, 0 for milestones
+        uint32_t mCount = 0;
+    };
+
+    static StartupTimeline* GetInstance() {
+        static StartupTimeline* sTimeline = new StartupTimeline;
+        return sTimeline;
+    }
+
+    void RecordPhase(const std::string& name, uint64_t beginUs, uint64_t wallUs, uint64_t cpuUs);
+    // RecordMilestone keeps the first call of @name only.
+    void RecordMilestone(const std::string& name);
+    void Finish();
+
+    bool IsFinished() const { return mFinished.load(std::memory_order_relaxed); }
+    // GetElapsedUs returns microseconds since the timeline is created.
+    uint64_t GetElapsedUs() const;
+    // GetPhases returns phases and milestones in order of begin time.
+    std::vector<Phase> GetPhases() const;
+    // ToString formats phases as name:begin_ms:wall_ms:cpu_ms separated by comma, for status profile.
+    std::string ToString() const;
+
+private:
+    StartupTimeline();
+
+    Phase* FindPhase(const std::string& name);
+
+    const uint64_t mStartUs;
+    std::atomic_bool mFinished{false};
+    mutable SpinLock mLock;
+    std::vector<Phase> mPhases;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class StartupTimelineUnittest;
+#endif
+};
+
+// StartupPhaseScope records the scope as phase @name if startup is not finished.
+class StartupPhaseScope {
+public:
+    explicit StartupPhaseScope(const char* name);
+    ~StartupPhaseScope();
+
+    StartupPhaseScope(const StartupPhaseScope&) = delete;
+    StartupPhaseScope& operator=(const StartupPhaseScope&) = delete;
+
+private:
+    const char* mName;
+    const bool mEnabled;
+    uint64_t mBeginUs = 0;
+    uint64_t mBeginCpuTimeNs = 0;
+};
+
+} // namespace logtail
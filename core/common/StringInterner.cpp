@@ -0,0 +1,77 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "StringInterner.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "xxhash/xxhash.h"
+
+namespace logtail {
+
+namespace {
+
+    // Key refers to the string of an entry, so looking up does not build a string.
+    struct Key {
+        const char* mData;
+        size_t mSize;
+        uint64_t mHash;
+        bool operator==(const Key& other) const {
+            return mSize == other.mSize && memcmp(mData, other.mData, mSize) == 0;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return static_cast<size_t>(key.mHash); }
+    };
+
+    std::atomic<uint32_t> sNextId{1};
+
+} // namespace
+
+struct StringInterner::Shard {
+    mutable std::mutex mMutex;
+    std::unordered_map<Key, std::unique_ptr<InternedStringEntry>, KeyHash> mEntries;
+};
+
+StringInterner::StringInterner() : mShards(new Shard[kShardCount]) {
+}
+
+const InternedStringEntry* StringInterner::Intern(const char* data, size_t size) {
+    if (size == 0) {
+        return &mEmpty;
+    }
+    const uint64_t hash = XXH3_64bits(data, size);
+    Shard& shard = mShards[hash % kShardCount];
+    std::lock_guard<std::mutex> lock(shard.mMutex);
+    auto iter = shard.mEntries.find(Key{data, size, hash});
+    if (iter != shard.mEntries.end()) {
+        return iter->second.get();
+    }
+    std::unique_ptr<InternedStringEntry> entry(new InternedStringEntry{std::string(data, size), sNextId++});
+    const InternedStringEntry* result = entry.get();
+    shard.mEntries.emplace(Key{result->mValue.data(), size, hash}, std::move(entry));
+    return result;
+}
+
+size_t StringInterner::Size() const {
+    size_t size = 0;
+    for (size_t i = 0; i < kShardCount; ++i) {
+        std::lock_guard<std::mutex> lock(mShards[i].mMutex);
+        size += mShards[i].mEntries.size();
+    }
+    return size;
+}
+
+} // namespace logtail
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace logtail {
+
+struct InternedStringEntry {
+    std::string mValue;
+    uint32_t mId;
+};
+
+// StringInterner is the process-wide table of identifiers such as project, logstore, config name and region.
+// Each distinct string is stored once and never removed, so entries can be referenced by pointer from any
+// thread. Do not intern unbounded values such as file paths.
+class StringInterner {
+public:
+    static StringInterner* GetInstance() {
+        static StringInterner* sInstance = new StringInterner;
+        return sInstance;
+    }
+
+    const InternedStringEntry* Intern(const char* data, size_t size);
+    // GetEmpty returns the entry of "", its id is 0.
+    const InternedStringEntry* GetEmpty() const { return &mEmpty; }
+    size_t Size() const;
+
+private:
+    StringInterner();
+
+    struct Shard;
+    static const size_t kShardCount = 16;
+    Shard* mShards;
+    const InternedStringEntry mEmpty{std::string(), 0};
+};
+
+// InternedString is a handle of an interned string, copy and comparison cost a pointer, and hash is the id.
+// It converts to const std::string& implicitly, so it can be used where a string is read.
+class InternedString {
+public:
+    InternedString() : mEntry(StringInterner::GetInstance()->GetEmpty()) {}
+    InternedString(const std::string& str) : mEntry(StringInterner::GetInstance()->Intern(str.data(), str.size())) {}
+    InternedString(const char* str) : mEntry(StringInterner::GetInstance()->Intern(str, strlen(str))) {}
+
+    const std::string& Str() const { return mEntry->mValue; }
+    operator const std::string&() const { return mEntry->mValue; }
+    uint32_t Id() const { return mEntry->mId; }
+
+    const char* c_str() const { return mEntry->mValue.c_str(); }
+    const char* data() const { return mEntry->mValue.data(); }
+    size_t size() const { return mEntry->mValue.size(); }
+    size_t length() const { return mEntry->mValue.size(); }
+    bool empty() const { return mEntry->mValue.empty(); }
+
+    bool operator==(const InternedString& other) const { return mEntry == other.mEntry; }
+    bool operator!=(const InternedString& other) const { return mEntry != other.mEntry; }
+
+private:
+    const InternedStringEntry* mEntry;
+};
+
+inline bool operator==(const InternedString& lhs, const std::string& rhs) {
+    return lhs.Str() == rhs;
+}
+inline bool operator==(const std::string& lhs, const InternedString& rhs) {
+    return lhs == rhs.Str();
+}
+inline bool operator==(const InternedString& lhs, const char* rhs) {
+    return lhs.Str() == rhs;
+}
+inline bool operator!=(const InternedString& lhs, const std::string& rhs) {
+    return lhs.Str() != rhs;
+}
+inline bool operator!=(const std::string& lhs, const InternedString& rhs) {
+    return lhs != rhs.Str();
+}
+inline bool operator!=(const InternedString& lhs, const char* rhs) {
+    return lhs.Str() != rhs;
+}
+inline bool operator<(const InternedString& lhs, const InternedString& rhs) {
+    return lhs.Str() < rhs.Str();
+}
+
+inline std::string operator+(const InternedString& lhs, const InternedString& rhs) {
+    return lhs.Str() + rhs.Str();
+}
+inline std::string operator+(const InternedString& lhs, const std::string& rhs) {
+    return lhs.Str() + rhs;
+}
+inline std::string operator+(const std::string& lhs, const InternedString& rhs) {
+    return lhs + rhs.Str();
+}
+inline std::string operator+(const InternedString& lhs, const char* rhs) {
+    return lhs.Str() + rhs;
+}
+inline std::string operator+(const char* lhs, const InternedString& rhs) {
+    return lhs + rhs.Str();
+}
+inline std::string operator+(const InternedString& lhs, char rhs) {
+    return lhs.Str() + rhs;
+}
+
+inline std::ostream& operator<<(std::ostream& os, const InternedString& str) {
+    return os << str.Str();
+}
+
+inline std::string ToString(const InternedString& str) {
+    return str.Str();
+}
+
+} // namespace logtail
+
+namespace std {
+template <>
+struct hash<logtail::InternedString> {
+    size_t operator()(const logtail::InternedString& str) const { return str.Id(); }
+};
+} // namespace std
@@ -0,0 +1,208 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TDigest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+namespace logtail {
+
+constexpr double TDigest::kDefaultCompression;
+
+TDigest::TDigest(double compression) : mCompression(compression > 1 ? compression : 1) {
+}
+
+void TDigest::Add(double value, uint64_t weight) {
+    if (weight == 0) {
+        return;
+    }
+    addCentroid(value, weight);
+}
+
+void TDigest::Merge(const TDigest& other) {
+    for (const auto& c : other.mCentroids) {
+        addCentroid(c.mMean, c.mWeight);
+    }
+    for (const auto& c : other.mBuffer) {
+        addCentroid(c.mMean, c.mWeight);
+    }
+}
+
+void TDigest::Clear() {
+    mCentroids.clear();
+    mBuffer.clear();
+    mTotalWeight = 0;
+    mMin = 0;
+    mMax = 0;
+}
+
+void TDigest::addCentroid(double mean, uint64_t weight) {
+    if (mTotalWeight == 0) {
+        mMin = mean;
+        mMax = mean;
+    } else {
+        mMin = std::min(mMin, mean);
+        mMax = std::max(mMax, mean);
+    }
+    mTotalWeight += weight;
+    mBuffer.push_back(Centroid{mean, weight});
+    if (mBuffer.size() >= static_cast<size_t>(mCompression)) {
+        compress();
+    }
+}
+
+void TDigest::compress() {
+    if (mBuffer.empty()) {
+        return;
+    }
+    mBuffer.insert(mBuffer.end(), mCentroids.begin(), mCentroids.end());
+    std::sort(mBuffer.begin(), mBuffer.end(), [](const Centroid& l, const Centroid& r) {
+        return l.mMean < r.mMean;
+    });
+    mCentroids.clear();
+    // Uses the k1 scale function k(q) = compression / (2 * pi) * asin(2q - 1), a centroid covers
+    // at most one unit of k, so centroids near the tails are kept small.
+    const double total = static_cast<double>(mTotalWeight);
+    const double normalizer = mCompression / (2 * M_PI);
+    auto weightLimit = [total, normalizer](double weightSoFar) {
+        const double k = normalizer * std::asin(2 * weightSoFar / total - 1) + 1;
+        return total * (std::sin(std::min(k / normalizer, M_PI / 2)) + 1) / 2;
+    };
+    double weightSoFar = 0;
+    double limit = weightLimit(weightSoFar);
+    Centroid cur = mBuffer[0];
+    for (size_t i = 1; i < mBuffer.size(); ++i) {
+        const uint64_t proposed = cur.mWeight + mBuffer[i].mWeight;
+        if (weightSoFar + proposed <= limit) {
+            cur.mMean += (mBuffer[i].mMean - cur.mMean) * mBuffer[i].mWeight / proposed;
+            cur.mWeight = proposed;
+        } else {
+            weightSoFar += cur.mWeight;
+            limit = weightLimit(weightSoFar);
+            mCentroids.push_back(cur);
+            cur = mBuffer[i];
+        }
+    }
+    mCentroids.push_back(cur);
+    mBuffer.clear();
+}
+
+double TDigest::Quantile(double q) {
+    compress();
+    if (mCentroids.empty()) {
+        return 0;
+    }
+    if (q <= 0) {
+        return mMin;
+    }
+    if (q >= 1) {
+        return mMax;
+    }
+    if (mCentroids.size() == 1) {
+        return mCentroids[0].mMean;
+    }
+    // Each centroid is centered at the middle of its weight, values between two centers are
+    // interpolated, and the first and last half centroids are interpolated with min and max.
+    const double index = q * mTotalWeight;
+    const Centroid& first = mCentroids.front();
+    if (index < first.mWeight / 2.0) {
+        return mMin + (first.mMean - mMin) * index / (first.mWeight / 2.0);
+    }
+    double weightSoFar = first.mWeight / 2.0;
+    for (size_t i = 0; i + 1 < mCentroids.size(); ++i) {
+        const double dw = (mCentroids[i].mWeight + mCentroids[i + 1].mWeight) / 2.0;
+        if (weightSoFar + dw > index) {
+            return mCentroids[i].mMean + (mCentroids[i + 1].mMean - mCentroids[i].mMean) * (index - weightSoFar) / dw;
+        }
+        weightSoFar += dw;
+    }
+    const Centroid& last = mCentroids.back();
+    const double tail = last.mWeight / 2.0;
+    return last.mMean + (mMax - last.mMean) * std::min(1.0, (index - weightSoFar) / tail);
+}
+
+std::string TDigest::Serialize() {
+    compress();
+    std::string data;
+    data.reserve(32 + mCentroids.size() * 24);
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%g,%llu,%.9g,%.9g", mCompression, (unsigned long long)mTotalWeight, mMin, mMax);
+    data.append(buf);
+    for (const auto& c : mCentroids) {
+        snprintf(buf, sizeof(buf), ";%.9g:%llu", c.mMean, (unsigned long long)c.mWeight);
+        data.append(buf);
+    }
+    return data;
+}
+
+bool TDigest::Deserialize(const std::string& data) {
+    Clear();
+    const char* p = data.c_str();
+    char* end = nullptr;
+    const double compression = strtod(p, &end);
+    if (end == p || *end != ',' || compression < 1) {
+        return false;
+    }
+    p = end + 1;
+    const uint64_t count = strtoull(p, &end, 10);
+    if (end == p || *end != ',') {
+        return false;
+    }
+    p = end + 1;
+    const double minValue = strtod(p, &end);
+    if (end == p || *end != ',') {
+        return false;
+    }
+    p = end + 1;
+    const double maxValue = strtod(p, &end);
+    if (end == p) {
+        return false;
+    }
+    p = end;
+    uint64_t total = 0;
+    while (*p == ';') {
+        ++p;
+        const double mean = strtod(p, &end);
+        if (end == p || *end != ':') {
+            Clear();
+            return false;
+        }
+        p = end + 1;
+        const uint64_t weight = strtoull(p, &end, 10);
+        if (end == p) {
+            Clear();
+            return false;
+        }
+        p = end;
+        mCentroids.push_back(Centroid{mean, weight});
+        total += weight;
+    }
+    if (*p != '\0' || total != count) {
+        Clear();
+        return false;
+    }
+    mCompression = compression;
+    mTotalWeight = count;
+    mMin = minValue;
+    mMax = maxValue;
+    return true;
+}
+
+} // namespace logtail
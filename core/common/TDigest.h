@@ -0,0 +1,83 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace logtail {
+
+/**
+ * TDigest is a merging t-digest sketch used to keep latency distributions of aggregated
+ * protocol events and log-to-metric records, so quantiles such as p99 can be computed
+ * after the sketches of many intervals or hosts are merged.
+ *
+ * Values are appended into a small buffer and folded into the sorted centroids when the
+ * buffer is full, the number of centroids stays below about compression.
+ */
+class TDigest {
+public:
+    static constexpr double kDefaultCompression = 100;
+
+    explicit TDigest(double compression = kDefaultCompression);
+
+    void Add(double value, uint64_t weight = 1);
+
+    // Merge appends centroids of other, the cost is linear with centroids of both sketches.
+    void Merge(const TDigest& other);
+
+    void Clear();
+
+    bool IsEmpty() const { return mTotalWeight == 0; }
+    uint64_t Count() const { return mTotalWeight; }
+    double Min() const { return mMin; }
+    double Max() const { return mMax; }
+
+    // Quantile returns the estimated value at q in [0, 1], or 0 when empty.
+    double Quantile(double q);
+
+    /**
+     * Serialize encodes the sketch as
+     * `compression,count,min,max;mean:weight;mean:weight...` with centroids sorted by mean.
+     */
+    std::string Serialize();
+    bool Deserialize(const std::string& data);
+
+    size_t CentroidCount() {
+        compress();
+        return mCentroids.size();
+    }
+
+private:
+    struct Centroid {
+        double mMean;
+        uint64_t mWeight;
+    };
+
+    void addCentroid(double mean, uint64_t weight);
+    void compress();
+
+    double mCompression;
+    std::vector<Centroid> mCentroids; // compressed, sorted by mean
+    std::vector<Centroid> mBuffer; // not compressed yet
+    uint64_t mTotalWeight = 0;
+    double mMin = 0;
+    double mMax = 0;
+};
+
+} // namespace logtail
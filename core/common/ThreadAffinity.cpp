@@ -0,0 +1,207 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ThreadAffinity.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "common/Flags.h"
+#include "common/StringTools.h"
+#include "logger/Logger.h"
+
+DEFINE_FLAG_STRING(thread_affinity_profile,
+                   "placement of pipeline threads, empty to let them float, numa to keep them on one numa node",
+                   "");
+DEFINE_FLAG_STRING(input_thread_cpus, "cpu list like 0-3,8 to bind input threads to, overrides the profile", "");
+DEFINE_FLAG_STRING(process_thread_cpus, "cpu list like 0-3,8 to bind process threads to, overrides the profile", "");
+DEFINE_FLAG_STRING(sender_thread_cpus, "cpu list like 0-3,8 to bind sender threads to, overrides the profile", "");
+
+namespace logtail {
+
+namespace {
+
+    // Cpus left on the home node for input and sender threads before process threads go to other nodes.
+    const size_t kReservedHomeCpus = 2;
+
+    std::vector<int> GetAllowedCpus() {
+        std::vector<int> cpus;
+#if defined(__linux__)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &cpuSet)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+#endif
+        if (cpus.empty()) {
+            for (int cpu = 0; cpu < static_cast<int>(std::thread::hardware_concurrency()); ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+    std::vector<std::vector<int>> ToSingleCpuSets(const std::vector<int>& cpus) {
+        std::vector<std::vector<int>> sets;
+        for (int cpu : cpus) {
+            sets.push_back(std::vector<int>(1, cpu));
+        }
+        return sets;
+    }
+
+} // namespace
+
+std::vector<int> ParseCpuList(const std::string& str) {
+    std::vector<int> cpus;
+    for (const std::string& item : SplitString(str, ",")) {
+        std::string part = TrimString(item);
+        if (part.empty()) {
+            continue;
+        }
+        char* end = NULL;
+        long first = strtol(part.c_str(), &end, 10);
+        long last = first;
+        if (*end == '-') {
+            last = strtol(end + 1, &end, 10);
+        }
+        if (*end != '\0' || first < 0 || last < first || last >= 4096) {
+            continue;
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+bool BindCurrentThreadToCpus(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+#if defined(__linux__)
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &cpuSet);
+        }
+    }
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+    if (ret != 0) {
+        LOG_WARNING(sLogger, ("bind thread to cpus fail, error", ret)("cpu count", cpus.size()));
+        return false;
+    }
+#endif
+    return true;
+}
+
+std::vector<std::vector<int>> ThreadAffinity::ReadNumaNodes() {
+    const std::vector<int> allowed = GetAllowedCpus();
+    std::vector<std::vector<int>> nodes;
+    // Node ids are contiguous on all known platforms, stop at the first missing one.
+    for (int node = 0;; ++node) {
+        std::ifstream in("/sys/devices/system/node/node" + ToString(node) + "/cpulist");
+        std::string line;
+        if (!in || !std::getline(in, line)) {
+            break;
+        }
+        std::vector<int> cpus;
+        for (int cpu : ParseCpuList(line)) {
+            if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty()) {
+            nodes.push_back(cpus);
+        }
+    }
+    if (nodes.empty()) {
+        nodes.push_back(allowed);
+    }
+    return nodes;
+}
+
+ThreadAffinity::Plan ThreadAffinity::MakeNumaPlan(const std::vector<std::vector<int>>& nodes) {
+    Plan plan;
+    if (nodes.empty()) {
+        return plan;
+    }
+    size_t home = 0;
+    for (size_t i = 1; i < nodes.size(); ++i) {
+        if (nodes[i].size() > nodes[home].size()) {
+            home = i;
+        }
+    }
+    plan.mRoleCpus[THREAD_ROLE_INPUT].push_back(nodes[home]);
+    plan.mRoleCpus[THREAD_ROLE_SENDER].push_back(nodes[home]);
+    std::vector<std::vector<int>>& process = plan.mRoleCpus[THREAD_ROLE_PROCESS];
+    const size_t homeCount = nodes[home].size() > kReservedHomeCpus ? nodes[home].size() - kReservedHomeCpus : 1;
+    process.assign(homeCount, nodes[home]);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (i != home) {
+            process.insert(process.end(), nodes[i].size(), nodes[i]);
+        }
+    }
+    return plan;
+}
+
+void ThreadAffinity::Init() {
+    if (STRING_FLAG(thread_affinity_profile) == "numa") {
+        const std::vector<std::vector<int>> nodes = ReadNumaNodes();
+        if (nodes.size() > 1) {
+            mPlan = MakeNumaPlan(nodes);
+        }
+        LOG_INFO(sLogger, ("thread affinity profile", "numa")("node count", nodes.size()));
+    } else if (!STRING_FLAG(thread_affinity_profile).empty()) {
+        LOG_WARNING(sLogger, ("unknown thread affinity profile", STRING_FLAG(thread_affinity_profile)));
+    }
+    const std::string* cpuLists[THREAD_ROLE_COUNT]
+        = {&STRING_FLAG(input_thread_cpus), &STRING_FLAG(process_thread_cpus), &STRING_FLAG(sender_thread_cpus)};
+    for (int role = 0; role < THREAD_ROLE_COUNT; ++role) {
+        std::vector<int> cpus = ParseCpuList(*cpuLists[role]);
+        if (!cpus.empty()) {
+            mPlan.mRoleCpus[role] = ToSingleCpuSets(cpus);
+        }
+    }
+}
+
+std::vector<int> ThreadAffinity::GetCpus(ThreadRole role, int index) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mInited) {
+        Init();
+        mInited = true;
+    }
+    const std::vector<std::vector<int>>& sets = mPlan.mRoleCpus[role];
+    if (sets.empty() || index < 0) {
+        return std::vector<int>();
+    }
+    return sets[index % sets.size()];
+}
+
+void ThreadAffinity::BindCurrentThread(ThreadRole role, int index) {
+    std::vector<int> cpus = GetCpus(role, index);
+    if (!cpus.empty() && BindCurrentThreadToCpus(cpus)) {
+        LOG_INFO(sLogger, ("bind thread, role", role)("index", index)("cpus", cpus.size())("first cpu", cpus[0]));
+    }
+}
+
+} // namespace logtail
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace logtail {
+
+enum ThreadRole { THREAD_ROLE_INPUT = 0, THREAD_ROLE_PROCESS, THREAD_ROLE_SENDER, THREAD_ROLE_COUNT };
+
+// ParseCpuList parses a cpu list like "0-3,8,10-11", invalid parts are skipped.
+std::vector<int> ParseCpuList(const std::string& str);
+
+// BindCurrentThreadToCpus binds the calling thread to @cpus (linux only), it returns false on failure.
+bool BindCurrentThreadToCpus(const std::vector<int>& cpus);
+
+// ThreadAffinity decides the cpus of pipeline threads by role:
+// - input: LogInput and the observer event loop, which read data and allocate LogBuffers;
+// - process: LogProcess threads;
+// - sender: Sender daemon and curl threads.
+//
+// A cpu list flag of a role binds thread i to the i-th cpu round robin. Otherwise, with profile numa,
+// input and sender threads and as many process threads as fit are bound to the whole node with most cpus,
+// and the rest of process threads are spread over other nodes. Memory is placed on the node of the thread
+// touching it first, so LogBuffers are local to the process threads on that node.
+class ThreadAffinity {
+public:
+    // Plan holds cpu sets of each role, thread i of a role uses sets[i % sets.size()], no set means floating.
+    struct Plan {
+        std::vector<std::vector<int>> mRoleCpus[THREAD_ROLE_COUNT];
+    };
+
+    static ThreadAffinity* GetInstance() {
+        static ThreadAffinity* sInstance = new ThreadAffinity;
+        return sInstance;
+    }
+
+    // BindCurrentThread binds the calling thread, which is thread @index of @role, by the plan.
+    void BindCurrentThread(ThreadRole role, int index);
+    std::vector<int> GetCpus(ThreadRole role, int index);
+
+    // ReadNumaNodes returns cpus of each node allowed for this process, one node if topology is unknown.
+    static std::vector<std::vector<int>> ReadNumaNodes();
+    static Plan MakeNumaPlan(const std::vector<std::vector<int>>& nodes);
+
+private:
+    ThreadAffinity() = default;
+    void Init();
+
+    std::mutex mMutex;
+    bool mInited = false;
+    Plan mPlan;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class ThreadAffinityUnittest;
+#endif
+};
+
+} // namespace logtail
@@ -0,0 +1,209 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ThreadPool.h"
+#include <algorithm>
+#include "common/ThreadAffinity.h"
+#include "common/TimeUtil.h"
+#include "logger/Logger.h"
+#include "monitor/MetricRegistry.h"
+
+namespace logtail {
+
+// The pool and worker index of current thread, tasks added by a worker go to its own deque.
+static thread_local ThreadPool* sCurrentPool = nullptr;
+static thread_local size_t sCurrentWorker = 0;
+
+ThreadPool::ThreadPool(size_t num, const std::string& name, const std::vector<int>& cpus)
+    : mIsRunning(false), mThreadNum(num > 0 ? num : 1), mName(name), mCpus(cpus) {
+    for (size_t i = 0; i < mThreadNum; ++i) {
+        mWorkers.emplace_back(new Worker);
+    }
+    if (!mName.empty()) {
+        MetricRegistry* registry = MetricRegistry::GetInstance();
+        const MetricLabels labels{{"pool", mName}};
+        mQueueDepthGauge = registry->RegisterGauge("thread_pool_queue_depth", labels);
+        mStealCounter = registry->RegisterCounter("thread_pool_steal_count", labels);
+        mLatencyHistogram = registry->RegisterHistogram(
+            "thread_pool_task_latency_ms", {1, 5, 10, 50, 100, 500, 1000, 5000}, labels);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    if (mIsRunning) {
+        Stop();
+    }
+}
+
+void ThreadPool::Start() {
+    mIsRunning = true;
+    for (size_t i = 0; i < mThreadNum; i++) {
+        mThreads.emplace_back(std::thread(&ThreadPool::execute, this, i));
+    }
+}
+
+void ThreadPool::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mIdleMutex);
+        mIsRunning = false;
+        mIdleCond.notify_all();
+    }
+
+    for (auto& t : mThreads) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+    mThreads.clear();
+    for (auto& worker : mWorkers) {
+        std::lock_guard<std::mutex> lock(worker->mMutex);
+        worker->mItems.clear();
+    }
+    mPendingCount = 0;
+    if (mQueueDepthGauge != nullptr) {
+        mQueueDepthGauge->Set(0);
+    }
+}
+
+bool ThreadPool::Add(Task task) {
+    if (!mIsRunning) {
+        return false;
+    }
+    // Counted before pushed, so mPendingCount never goes below the real count.
+    mPendingCount.fetch_add(1);
+    Worker& worker = *mWorkers[PickWorker()];
+    {
+        std::lock_guard<std::mutex> lock(worker.mMutex);
+        worker.mItems.push_back(Item{std::move(task), GetCurrentTimeInMicroSeconds()});
+    }
+    OnAdded(1);
+    return true;
+}
+
+bool ThreadPool::AddBatch(std::vector<Task>& tasks) {
+    if (!mIsRunning) {
+        return false;
+    }
+    if (tasks.empty()) {
+        return true;
+    }
+    // Each worker gets a contiguous part of the batch.
+    const uint64_t now = GetCurrentTimeInMicroSeconds();
+    const size_t workerCount = std::min(mThreadNum, tasks.size());
+    const size_t first = PickWorker();
+    const size_t count = tasks.size();
+    mPendingCount.fetch_add(count);
+    size_t begin = 0;
+    for (size_t i = 0; i < workerCount; ++i) {
+        size_t end = begin + (tasks.size() - begin) / (workerCount - i);
+        Worker& worker = *mWorkers[(first + i) % mThreadNum];
+        std::lock_guard<std::mutex> lock(worker.mMutex);
+        for (size_t k = begin; k < end; ++k) {
+            worker.mItems.push_back(Item{std::move(tasks[k]), now});
+        }
+        begin = end;
+    }
+    tasks.clear();
+    OnAdded(count);
+    return true;
+}
+
+size_t ThreadPool::PickWorker() {
+    if (sCurrentPool == this) {
+        return sCurrentWorker;
+    }
+    return mNextWorker.fetch_add(1, std::memory_order_relaxed) % mThreadNum;
+}
+
+void ThreadPool::OnAdded(size_t count) {
+    if (mQueueDepthGauge != nullptr) {
+        mQueueDepthGauge->Set(static_cast<double>(mPendingCount.load()));
+    }
+    // mPendingCount is increased before mIdleCount is read, and idle workers check mPendingCount after
+    // increasing mIdleCount, so a worker going to sleep either sees the task or is notified.
+    if (mIdleCount.load() > 0) {
+        std::lock_guard<std::mutex> lock(mIdleMutex);
+        if (count > 1) {
+            mIdleCond.notify_all();
+        } else {
+            mIdleCond.notify_one();
+        }
+    }
+}
+
+bool ThreadPool::PopOrSteal(size_t index, Item& item) {
+    {
+        Worker& worker = *mWorkers[index];
+        std::lock_guard<std::mutex> lock(worker.mMutex);
+        if (!worker.mItems.empty()) {
+            item = std::move(worker.mItems.front());
+            worker.mItems.pop_front();
+            return true;
+        }
+    }
+    for (size_t i = 1; i < mThreadNum; ++i) {
+        Worker& victim = *mWorkers[(index + i) % mThreadNum];
+        std::lock_guard<std::mutex> lock(victim.mMutex);
+        if (!victim.mItems.empty()) {
+            item = std::move(victim.mItems.back());
+            victim.mItems.pop_back();
+            mStealCount.fetch_add(1, std::memory_order_relaxed);
+            if (mStealCounter != nullptr) {
+                mStealCounter->Add();
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::BindCpu(size_t index) {
+    if (mCpus.empty()) {
+        return;
+    }
+    int cpu = mCpus[index % mCpus.size()];
+    if (!BindCurrentThreadToCpus(std::vector<int>(1, cpu))) {
+        LOG_WARNING(sLogger, ("bind thread pool worker to cpu fail", mName)("cpu", cpu));
+    }
+}
+
+void ThreadPool::execute(size_t index) {
+    sCurrentPool = this;
+    sCurrentWorker = index;
+    BindCpu(index);
+    while (mIsRunning) {
+        Item item;
+        if (!PopOrSteal(index, item)) {
+            std::unique_lock<std::mutex> lock(mIdleMutex);
+            ++mIdleCount;
+            while (mIsRunning && mPendingCount.load() == 0) {
+                mIdleCond.wait(lock);
+            }
+            --mIdleCount;
+            continue;
+        }
+
+        size_t pending = mPendingCount.fetch_sub(1) - 1;
+        if (mQueueDepthGauge != nullptr) {
+            mQueueDepthGauge->Set(static_cast<double>(pending));
+            mLatencyHistogram->Observe((GetCurrentTimeInMicroSeconds() - item.mAddTimeUs) / 1000.0);
+        }
+        if (item.mTask) {
+            item.mTask();
+        }
+    }
+    sCurrentPool = nullptr;
+}
+
+} // namespace logtail
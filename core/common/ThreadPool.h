@@ -19,92 +19,123 @@
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
-#include <functional>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <queue>
 
 namespace logtail {
 
-class ThreadPool {
+class MetricGauge;
+class MetricCounter;
+class MetricHistogram;
+
+// ThreadPoolTask is a move-only callable, so tasks can own buffers or unique_ptrs without copying them.
+class ThreadPoolTask {
 public:
-    using Task = std::function<void()>;
-
-    explicit ThreadPool(size_t num) : mIsRunning(false), mThreadNum(num) {}
-
-    ~ThreadPool() {
-        if (mIsRunning) {
-            Stop();
-        }
-    }
-
-    void Start() {
-        mIsRunning = true;
-        for (size_t i = 0; i < mThreadNum; i++) {
-            mThreads.emplace_back(std::thread(&ThreadPool::execute, this));
-        }
-    }
-
-    void Stop() {
-        {
-            std::unique_lock<std::mutex> lock(mMutex);
-            mIsRunning = false;
-            mCond.notify_all();
-        }
-
-        for (auto& t : mThreads) {
-            if (t.joinable()) {
-                t.join();
-            }
-        }
-    }
-
-    void Add(const Task& task) {
-        if (mIsRunning) {
-            std::unique_lock<std::mutex> lock(mMutex);
-            mTasks.push(task);
-            mCond.notify_one();
-        }
-    }
-
-    size_t Size() const {
-        if (!mIsRunning) {
-            return 0;
-        }
-        std::unique_lock<std::mutex> lock(mMutex);
-        return mTasks.size();
-    }
+    ThreadPoolTask() = default;
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, ThreadPoolTask>::value>::type>
+    ThreadPoolTask(F&& func) : mImpl(new Impl<typename std::decay<F>::type>(std::forward<F>(func))) {}
+
+    ThreadPoolTask(ThreadPoolTask&&) = default;
+    ThreadPoolTask& operator=(ThreadPoolTask&&) = default;
+    ThreadPoolTask(const ThreadPoolTask&) = delete;
+    ThreadPoolTask& operator=(const ThreadPoolTask&) = delete;
+
+    explicit operator bool() const { return mImpl != nullptr; }
+    void operator()() { mImpl->Call(); }
 
 private:
-    void execute() {
-        while (mIsRunning) {
-            Task task;
-            {
-                std::unique_lock<std::mutex> lock(mMutex);
-                if (!mTasks.empty()) {
-                    task = mTasks.front();
-                    mTasks.pop();
-                } else if (mIsRunning && mTasks.empty()) {
-                    mCond.wait(lock);
-                }
-            }
-
-            if (task) {
-                task();
-            }
-        }
-    }
+    struct Base {
+        virtual ~Base() {}
+        virtual void Call() = 0;
+    };
+    template <typename F>
+    struct Impl : Base {
+        explicit Impl(F&& func) : mFunc(std::move(func)) {}
+        explicit Impl(const F& func) : mFunc(func) {}
+        void Call() override { mFunc(); }
+        F mFunc;
+    };
 
+    std::unique_ptr<Base> mImpl;
+};
+
+// ThreadPool runs tasks with a fixed number of workers, each worker has its own deque. Tasks added by a
+// worker go to its own deque, others are spread over workers round robin. A worker takes tasks from the
+// front of its deque and steals from the back of others when its deque is empty, so one slow queue does not
+// delay tasks while other workers are idle.
+//
+// If @name is not empty, queue depth, task latency (from Add to start) and steal count are exported to
+// MetricRegistry with label pool=@name. If @cpus is not empty, worker i is bound to cpus[i % cpus.size()]
+// (linux only). Tasks not run before Stop are dropped.
+class ThreadPool {
 public:
+    using Task = ThreadPoolTask;
+
+    explicit ThreadPool(size_t num, const std::string& name = "", const std::vector<int>& cpus = std::vector<int>());
+    ~ThreadPool();
+
+    void Start();
+    void Stop();
+
+    // Add returns false if the pool is not running.
+    bool Add(Task task);
+    // AddBatch moves all @tasks into the pool with one lock per worker, @tasks is cleared.
+    bool AddBatch(std::vector<Task>& tasks);
+
+    // Size returns the count of tasks not started.
+    size_t Size() const { return mIsRunning ? mPendingCount.load() : 0; }
+    size_t GetThreadNum() const { return mThreadNum; }
+    uint64_t GetStealCount() const { return mStealCount.load(std::memory_order_relaxed); }
+
     ThreadPool(const ThreadPool&) = delete;
     ThreadPool& operator=(const ThreadPool& other) = delete;
 
 private:
-    volatile bool mIsRunning;
-    mutable std::mutex mMutex;
-    std::condition_variable mCond;
-    size_t mThreadNum;
+    struct Item {
+        Task mTask;
+        uint64_t mAddTimeUs;
+    };
+
+    struct Worker {
+        std::mutex mMutex;
+        std::deque<Item> mItems;
+    };
+
+    void execute(size_t index);
+    bool PopOrSteal(size_t index, Item& item);
+    size_t PickWorker();
+    void OnAdded(size_t count);
+    void BindCpu(size_t index);
+
+    std::atomic_bool mIsRunning;
+    const size_t mThreadNum;
+    const std::string mName;
+    const std::vector<int> mCpus;
+    std::vector<std::unique_ptr<Worker>> mWorkers;
     std::vector<std::thread> mThreads;
-    std::queue<Task> mTasks;
+    std::atomic<size_t> mNextWorker{0};
+    std::atomic<size_t> mPendingCount{0};
+    std::atomic<uint64_t> mStealCount{0};
+
+    // Idle workers wait here, mIdleCount lets Add skip the lock when all workers are busy.
+    std::mutex mIdleMutex;
+    std::condition_variable mIdleCond;
+    std::atomic<int> mIdleCount{0};
+
+    MetricGauge* mQueueDepthGauge = nullptr;
+    MetricCounter* mStealCounter = nullptr;
+    MetricHistogram* mLatencyHistogram = nullptr;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class ThreadPoolUnittest;
+#endif
 };
 
 } // namespace logtail
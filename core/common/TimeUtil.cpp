@@ -59,6 +59,11 @@ uint64_t GetCurrentTimeInMilliSeconds() {
         .count();
 }
 
+uint64_t GetSteadyTimeInMilliSeconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
 int GetLocalTimeZoneOffsetSecond() {
     time_t nowTime = time(NULL);
     tm timeInfo;
@@ -132,6 +137,160 @@ const char* Strptime(const char* buf, const char* fmt, struct tm* tm, int32_t sp
     return ret;
 }
 
+bool FixedWidthTimeFormat::Compile(const char* fmt) {
+    mTokens.clear();
+    bool hasYear = false;
+    for (const char* cur = fmt; *cur != '\0'; ++cur) {
+        if (*cur != '%') {
+            mTokens.push_back(Token{0, *cur});
+            continue;
+        }
+        switch (*++cur) {
+            case 'Y':
+                hasYear = true;
+                /*FALLTHROUGH*/
+            case 'm':
+            case 'd':
+            case 'H':
+            case 'M':
+            case 'S':
+                mTokens.push_back(Token{*cur, 0});
+                break;
+            case 'F':
+                hasYear = true;
+                mTokens.insert(
+                    mTokens.end(), {Token{'Y', 0}, Token{0, '-'}, Token{'m', 0}, Token{0, '-'}, Token{'d', 0}});
+                break;
+            case 'T':
+                mTokens.insert(
+                    mTokens.end(), {Token{'H', 0}, Token{0, ':'}, Token{'M', 0}, Token{0, ':'}, Token{'S', 0}});
+                break;
+            case '%':
+                mTokens.push_back(Token{0, '%'});
+                break;
+            default:
+                mTokens.clear();
+                return false;
+        }
+    }
+    if (!hasYear) {
+        mTokens.clear();
+    }
+    return hasYear;
+}
+
+const char* FixedWidthTimeFormat::Parse(const char* buf, struct tm* tm) const {
+    if (mTokens.empty()) {
+        return NULL;
+    }
+    for (const Token& token : mTokens) {
+        if (token.conversion == 0) {
+            if (*buf != token.literal) {
+                return NULL;
+            }
+            ++buf;
+            continue;
+        }
+        const int width = token.conversion == 'Y' ? 4 : 2;
+        int value = 0;
+        for (int i = 0; i < width; ++i, ++buf) {
+            if (*buf < '0' || *buf > '9') {
+                return NULL;
+            }
+            value = value * 10 + (*buf - '0');
+        }
+        // Same ranges as strptime.
+        switch (token.conversion) {
+            case 'Y':
+                tm->tm_year = value - 1900;
+                break;
+            case 'm':
+                if (value < 1 || value > 12)
+                    return NULL;
+                tm->tm_mon = value - 1;
+                break;
+            case 'd':
+                if (value < 1 || value > 31)
+                    return NULL;
+                tm->tm_mday = value;
+                break;
+            case 'H':
+                if (value > 23)
+                    return NULL;
+                tm->tm_hour = value;
+                break;
+            case 'M':
+                if (value > 59)
+                    return NULL;
+                tm->tm_min = value;
+                break;
+            case 'S':
+                if (value > 61)
+                    return NULL;
+                tm->tm_sec = value;
+                break;
+        }
+    }
+    return buf;
+}
+
+const char* FastStrptime(const char* buf, const char* fmt, struct tm* tm) {
+    static thread_local std::string sFormat;
+    static thread_local FixedWidthTimeFormat sCompiledFormat;
+    if (sFormat.empty() || sFormat != fmt) {
+        sFormat = fmt;
+        sCompiledFormat.Compile(fmt);
+    }
+    return sCompiledFormat.Parse(buf, tm);
+}
+
+time_t MakeLocalTime(const struct tm& tm) {
+    struct HourCache {
+        int year = std::numeric_limits<int>::min();
+        int mon = 0;
+        int mday = 0;
+        int hour = 0;
+        time_t begin = 0;
+    };
+    static thread_local HourCache sCache;
+
+    struct tm localTm = tm;
+    localTm.tm_isdst = -1;
+    if (tm.tm_min < 0 || tm.tm_min > 59 || tm.tm_sec < 0 || tm.tm_sec > 61) {
+        return mktime(&localTm);
+    }
+    if (sCache.year != tm.tm_year || sCache.mon != tm.tm_mon || sCache.mday != tm.tm_mday
+        || sCache.hour != tm.tm_hour) {
+        localTm.tm_min = 0;
+        localTm.tm_sec = 0;
+        time_t begin = mktime(&localTm);
+        bool cacheable = begin != -1 && localTm.tm_min == 0 && localTm.tm_hour == tm.tm_hour;
+        if (cacheable) {
+            // Do not cache the hour if UTC offset changes inside it (DST shift), in which
+            // case one hour later is not the start of next hour.
+            const time_t end = begin + 3600;
+#if defined(_MSC_VER)
+            cacheable = localtime_s(&localTm, &end) == 0;
+#else
+            cacheable = localtime_r(&end, &localTm) != NULL;
+#endif
+            cacheable = cacheable && localTm.tm_min == 0 && localTm.tm_sec == 0
+                && localTm.tm_hour == (tm.tm_hour + 1) % 24;
+        }
+        if (!cacheable) {
+            localTm = tm;
+            localTm.tm_isdst = -1;
+            return mktime(&localTm);
+        }
+        sCache.year = tm.tm_year;
+        sCache.mon = tm.tm_mon;
+        sCache.mday = tm.tm_mday;
+        sCache.hour = tm.tm_hour;
+        sCache.begin = begin;
+    }
+    return sCache.begin + tm.tm_min * 60 + tm.tm_sec;
+}
+
 #if defined(__linux__)
 int ReadUtmp(const char* filename, int* n_entries, utmp** utmp_buf) {
     FILE* utmp_file;
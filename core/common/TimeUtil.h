@@ -16,6 +16,7 @@
 
 #pragma once
 #include <string>
+#include <vector>
 #include <ctime>
 #include <thread>
 
@@ -41,6 +42,9 @@ uint64_t GetCurrentTimeInMicroSeconds();
 uint64_t GetCurrentTimeInMilliSeconds();
 uint64_t GetCurrentTimeInNanoSeconds();
 
+// Get time of a monotonic clock in ms, only the difference of two values is meaningful.
+uint64_t GetSteadyTimeInMilliSeconds();
+
 // Get offset between current time zone and UTC in seconds.
 // For example, for UTC+8, returns 8*60*60.
 int GetLocalTimeZoneOffsetSecond();
@@ -66,6 +70,36 @@ inline void sleep(uint64_t s) {
 //     example, syslog following RFC3164 does not generate year information.
 const char* Strptime(const char* buf, const char* fmt, struct tm* tm, int32_t specifiedYear = -1);
 
+// FixedWidthTimeFormat is a compiled time format which only contains literal chars and
+// fixed width conversions (%Y %m %d %H %M %S, and %F %T composed of them), such as
+// "%Y-%m-%d %H:%M:%S" and ISO8601 "%Y-%m-%dT%H:%M:%S". Parsing by it is much cheaper
+// than strptime and gives the same result when the time string matches.
+class FixedWidthTimeFormat {
+public:
+    // Compile returns false if @fmt has other conversions or has no year.
+    bool Compile(const char* fmt);
+
+    // Parse returns the char following parsed time, or NULL if @buf does not match.
+    const char* Parse(const char* buf, struct tm* tm) const;
+
+private:
+    // Conversion char, or 0 for a literal char.
+    struct Token {
+        char conversion;
+        char literal;
+    };
+    std::vector<Token> mTokens;
+};
+
+// FastStrptime parses @buf by @fmt compiled as FixedWidthTimeFormat, the last compiled
+// format is cached for current thread.
+// @return NULL if @fmt is not fixed width or @buf does not match, try Strptime then.
+const char* FastStrptime(const char* buf, const char* fmt, struct tm* tm);
+
+// MakeLocalTime works like mktime with tm_isdst = -1. The start of last hour is cached
+// for current thread, so mktime is called once an hour for sequential log times.
+time_t MakeLocalTime(const struct tm& tm);
+
 int32_t GetSystemBootTime();
 
 // For feature enable_log_time_auto_adjust.
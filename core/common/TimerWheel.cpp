@@ -0,0 +1,104 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "TimerWheel.h"
+
+namespace logtail {
+
+TimerWheel::TimerWheel(int64_t now) : mNextTick(now + 1), mSlots(kLevelCount * kSlotCount) {
+}
+
+void TimerWheel::Schedule(int64_t id, int64_t deadline) {
+    auto iter = mTimers.find(id);
+    if (iter == mTimers.end()) {
+        iter = mTimers.emplace(id, Timer()).first;
+    } else {
+        iter->second.mSlot->erase(iter->second.mPos);
+    }
+    iter->second.mDeadline = deadline;
+    Insert(id, iter->second);
+}
+
+bool TimerWheel::Cancel(int64_t id) {
+    auto iter = mTimers.find(id);
+    if (iter == mTimers.end()) {
+        return false;
+    }
+    iter->second.mSlot->erase(iter->second.mPos);
+    mTimers.erase(iter);
+    return true;
+}
+
+void TimerWheel::Insert(int64_t id, Timer& timer) {
+    int64_t expires = timer.mDeadline;
+    if (expires < mNextTick) {
+        expires = mNextTick;
+    } else if (expires - mNextTick > kMaxSpan) {
+        // Found again on expiry and put back, till the real deadline is in span.
+        expires = mNextTick + kMaxSpan;
+    }
+    const int64_t delta = expires - mNextTick;
+    int level = 0;
+    while (level < kLevelCount - 1 && delta >= (int64_t(1) << (kLevelBits * (level + 1)))) {
+        ++level;
+    }
+    Slot& slot = mSlots[level * kSlotCount + ((expires >> (kLevelBits * level)) & kSlotMask)];
+    timer.mSlot = &slot;
+    timer.mPos = slot.insert(slot.end(), id);
+}
+
+int64_t TimerWheel::Cascade(int level) {
+    const int64_t index = (mNextTick >> (kLevelBits * level)) & kSlotMask;
+    Slot slot;
+    slot.swap(mSlots[level * kSlotCount + index]);
+    for (int64_t id : slot) {
+        Insert(id, mTimers[id]);
+    }
+    return index;
+}
+
+void TimerWheel::Advance(int64_t now, std::vector<int64_t>& expired) {
+    while (mNextTick <= now) {
+        const int64_t index = mNextTick & kSlotMask;
+        // Timers of the next range of a level move down when all lower levels have turned once.
+        if (index == 0) {
+            int level = 1;
+            while (level < kLevelCount && Cascade(level) == 0) {
+                ++level;
+            }
+        }
+        const int64_t tick = mNextTick++;
+        Slot slot;
+        slot.swap(mSlots[index]);
+        for (int64_t id : slot) {
+            auto iter = mTimers.find(id);
+            if (iter->second.mDeadline > tick) {
+                Insert(id, iter->second);
+            } else {
+                expired.push_back(id);
+                mTimers.erase(iter);
+            }
+        }
+    }
+}
+
+void TimerWheel::Clear() {
+    for (auto& slot : mSlots) {
+        slot.clear();
+    }
+    mTimers.clear();
+}
+
+} // namespace logtail
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace logtail {
+
+// TimerWheel is a hierarchical timer wheel with a resolution of one tick (seconds for its users), each id has
+// at most one deadline. Schedule and Cancel are O(1), Advance costs O(expired) plus one slot per passed tick,
+// and timers far away are moved to lower levels only when their level turns, so a large number of timers with
+// spread deadlines never needs a full sweep.
+//
+// Deadlines not after the current tick expire on next Advance, deadlines further than the span of all levels
+// (2^24 ticks) are clamped to it. It is not thread safe.
+class TimerWheel {
+public:
+    explicit TimerWheel(int64_t now);
+
+    // Schedule sets the deadline of @id, the previous one is replaced.
+    void Schedule(int64_t id, int64_t deadline);
+    // Cancel returns false if @id is not scheduled.
+    bool Cancel(int64_t id);
+    bool IsScheduled(int64_t id) const { return mTimers.find(id) != mTimers.end(); }
+
+    // Advance moves the wheel to @now and appends ids with deadline not after @now to @expired, they are no
+    // longer scheduled. A clock going backward does not move the wheel.
+    void Advance(int64_t now, std::vector<int64_t>& expired);
+
+    void Clear();
+    size_t Size() const { return mTimers.size(); }
+    int64_t GetCurrentTick() const { return mNextTick - 1; }
+
+private:
+    static const int kLevelBits = 6;
+    static const int kLevelCount = 4;
+    static const int64_t kSlotCount = 1 << kLevelBits;
+    static const int64_t kSlotMask = kSlotCount - 1;
+    static const int64_t kMaxSpan = (int64_t(1) << (kLevelBits * kLevelCount)) - 1;
+
+    typedef std::list<int64_t> Slot;
+
+    struct Timer {
+        int64_t mDeadline;
+        Slot* mSlot;
+        Slot::iterator mPos;
+    };
+
+    void Insert(int64_t id, Timer& timer);
+    // Cascade moves timers in the current slot of @level down, returns that slot index.
+    int64_t Cascade(int level);
+
+    // mNextTick is the first tick not processed yet.
+    int64_t mNextTick;
+    std::vector<Slot> mSlots; // kLevelCount * kSlotCount slots, level by level
+    std::unordered_map<int64_t, Timer> mTimers;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class TimerWheelUnittest;
+#endif
+};
+
+} // namespace logtail
@@ -0,0 +1,74 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+
+namespace logtail {
+
+// TokenBucket limits bytes per second with bursts up to one second of rate.
+//
+// Tokens may go negative, so an item larger than the remaining tokens is sent as soon as any
+// token is left and the debt is paid back by later refills, items are never blocked forever.
+// It is not thread safe, the owner serializes access.
+class TokenBucket {
+public:
+    // SetRate sets the limit to @bytesPerSecond, <= 0 means unlimited.
+    void SetRate(int64_t bytesPerSecond) {
+        if (bytesPerSecond == mRate) {
+            return;
+        }
+        // A bucket starts full when it becomes limited.
+        mTokens = mRate > 0 ? std::min(mTokens, static_cast<double>(std::max<int64_t>(bytesPerSecond, 0)))
+                            : static_cast<double>(std::max<int64_t>(bytesPerSecond, 0));
+        mRate = bytesPerSecond;
+    }
+
+    int64_t GetRate() const { return mRate; }
+    bool IsLimited() const { return mRate > 0; }
+
+    void Refill(uint64_t nowMs) {
+        if (mLastRefillMs == 0 || nowMs < mLastRefillMs) {
+            if (mLastRefillMs == 0) {
+                mTokens = static_cast<double>(std::max<int64_t>(mRate, 0));
+            }
+            mLastRefillMs = nowMs;
+            return;
+        }
+        if (IsLimited()) {
+            mTokens = std::min(static_cast<double>(mRate), mTokens + mRate * (nowMs - mLastRefillMs) / 1000.0);
+        }
+        mLastRefillMs = nowMs;
+    }
+
+    bool HasToken() const { return !IsLimited() || mTokens > 0; }
+
+    void Consume(int64_t bytes) {
+        if (IsLimited()) {
+            mTokens -= bytes;
+        }
+    }
+
+    double GetTokens() const { return mTokens; }
+
+private:
+    int64_t mRate = 0;
+    double mTokens = 0;
+    uint64_t mLastRefillMs = 0;
+};
+
+} // namespace logtail
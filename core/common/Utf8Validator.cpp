@@ -0,0 +1,294 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Utf8Validator.h"
+#include <cstdint>
+#include <cstring>
+#if defined(__x86_64__) || defined(_M_X64)
+#define LOGTAIL_UTF8_VALIDATOR_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define LOGTAIL_UTF8_VALIDATOR_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__)
+#define LOGTAIL_UTF8_VALIDATOR_NEON
+#include <arm_neon.h>
+#endif
+
+namespace logtail {
+
+namespace {
+
+    typedef bool (*IsValidUtf8Func)(const char*, size_t);
+
+    struct Utf8Validator {
+        const char* name;
+        IsValidUtf8Func isValid;
+    };
+
+    // Vectorized implementations follow the lookup algorithm of Keiser and Lemire ("Validating UTF-8 In Less
+    // Than One Instruction Per Byte"). Each byte is classified with its previous one by three nibble lookups,
+    // the AND of them is non-zero for an invalid pair. TOO_SHORT and TOO_LONG are about missing or unexpected
+    // continuations, the rest are overlong forms, surrogates and code points too large. The position of 3rd
+    // and 4th bytes is checked separately as TWO_CONTS is not an error there.
+    const uint8_t kTooShort = 1 << 0; // 11______ 0_______, 11______ 11______
+    const uint8_t kTooLong = 1 << 1; // 0_______ 10______
+    const uint8_t kOverlong3 = 1 << 2; // 11100000 100_____
+    const uint8_t kTooLarge = 1 << 3; // 11110100 1001____, 11110100 101_____, 111101__ 10______ ...
+    const uint8_t kSurrogate = 1 << 4; // 11101101 101_____
+    const uint8_t kOverlong2 = 1 << 5; // 1100000_ 10______
+    const uint8_t kTooLarge1000 = 1 << 6; // 11110101 1000____, 1111011_ 1000____, 11111___ 1000____
+    const uint8_t kOverlong4 = 1 << 6; // 11110000 1000____
+    const uint8_t kTwoConts = 1 << 7; // 10______ 10______
+    const uint8_t kCarry = kTooShort | kTooLong | kTwoConts;
+
+#define LOGTAIL_UTF8_BYTE_1_HIGH \
+    kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTwoConts, kTwoConts, \
+        kTwoConts, kTwoConts, kTooShort | kOverlong2, kTooShort, kTooShort | kOverlong3 | kSurrogate, \
+        kTooShort | kTooLarge | kTooLarge1000 | kOverlong4
+#define LOGTAIL_UTF8_BYTE_1_LOW \
+    kCarry | kOverlong3 | kOverlong2 | kOverlong4, kCarry | kOverlong2, kCarry, kCarry, kCarry | kTooLarge, \
+        kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000, \
+        kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000, \
+        kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000, \
+        kCarry | kTooLarge | kTooLarge1000 | kSurrogate, kCarry | kTooLarge | kTooLarge1000, \
+        kCarry | kTooLarge | kTooLarge1000
+#define LOGTAIL_UTF8_BYTE_2_HIGH \
+    kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, \
+        kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4, \
+        kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge, \
+        kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge, \
+        kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge, kTooShort, kTooShort, kTooShort, kTooShort
+
+#if defined(LOGTAIL_UTF8_VALIDATOR_SSE2)
+    // SSE2 has no byte shuffle for the lookups, only leading ASCII blocks are skipped in vectors, the rest from
+    // the first non-ASCII block is validated by scalar.
+    bool IsValidUtf8SSE2(const char* data, size_t size) {
+        // Bytes before the first non-ASCII block are all ASCII, so the block starts at a character.
+        size_t offset = 0;
+        for (; offset + 16 <= size; offset += 16) {
+            __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset));
+            if (_mm_movemask_epi8(input) != 0) {
+                break;
+            }
+        }
+        return IsValidUtf8Scalar(data + offset, size - offset);
+    }
+#endif
+
+#if defined(LOGTAIL_UTF8_VALIDATOR_AVX2)
+    struct Avx2State {
+        __m256i error;
+        __m256i prevInput;
+        __m256i prevIncomplete;
+    };
+
+    // Avx2Prev returns @input shifted right by N bytes with the last N bytes of @prevInput in front.
+    template <int N>
+    __attribute__((target("avx2"))) inline __m256i Avx2Prev(__m256i input, __m256i prevInput) {
+        return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prevInput, input, 0x21), 16 - N);
+    }
+
+    __attribute__((target("avx2"))) inline void Avx2CheckBlock(__m256i input, Avx2State& state) {
+        if (_mm256_movemask_epi8(input) == 0) {
+            // An ASCII block is fine unless the previous one ends with a truncated sequence.
+            state.error = _mm256_or_si256(state.error, state.prevIncomplete);
+            state.prevInput = input;
+            return;
+        }
+        const __m256i lowNibble = _mm256_set1_epi8(0x0f);
+        const __m256i prev1 = Avx2Prev<1>(input, state.prevInput);
+        const __m256i byte1High = _mm256_shuffle_epi8(
+            _mm256_setr_epi8(LOGTAIL_UTF8_BYTE_1_HIGH, LOGTAIL_UTF8_BYTE_1_HIGH),
+            _mm256_and_si256(_mm256_srli_epi16(prev1, 4), lowNibble));
+        const __m256i byte1Low = _mm256_shuffle_epi8(
+            _mm256_setr_epi8(LOGTAIL_UTF8_BYTE_1_LOW, LOGTAIL_UTF8_BYTE_1_LOW), _mm256_and_si256(prev1, lowNibble));
+        const __m256i byte2High = _mm256_shuffle_epi8(
+            _mm256_setr_epi8(LOGTAIL_UTF8_BYTE_2_HIGH, LOGTAIL_UTF8_BYTE_2_HIGH),
+            _mm256_and_si256(_mm256_srli_epi16(input, 4), lowNibble));
+        const __m256i special = _mm256_and_si256(_mm256_and_si256(byte1High, byte1Low), byte2High);
+
+        // 3rd and 4th bytes of sequences must be continuations, where special has TWO_CONTS set.
+        const __m256i prev2 = Avx2Prev<2>(input, state.prevInput);
+        const __m256i prev3 = Avx2Prev<3>(input, state.prevInput);
+        const __m256i isThird = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+        const __m256i isFourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+        const __m256i must23
+            = _mm256_and_si256(_mm256_or_si256(isThird, isFourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+        state.error = _mm256_or_si256(state.error, _mm256_xor_si256(must23, special));
+
+        // Leading bytes near the end need continuations from next block.
+        const __m256i maxValue = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                  static_cast<char>(0xf0 - 1),
+                                                  static_cast<char>(0xe0 - 1),
+                                                  static_cast<char>(0xc0 - 1));
+        state.prevIncomplete = _mm256_subs_epu8(input, maxValue);
+        state.prevInput = input;
+    }
+
+    __attribute__((target("avx2"))) bool IsValidUtf8AVX2(const char* data, size_t size) {
+        Avx2State state{_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+        size_t offset = 0;
+        for (; offset + 32 <= size; offset += 32) {
+            Avx2CheckBlock(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + offset)), state);
+        }
+        if (offset < size) {
+            // The tail is padded with '\0', truncated sequences are caught as TOO_SHORT.
+            char tail[32] = {0};
+            memcpy(tail, data + offset, size - offset);
+            Avx2CheckBlock(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(tail)), state);
+        }
+        const __m256i error = _mm256_or_si256(state.error, state.prevIncomplete);
+        return _mm256_testz_si256(error, error) != 0;
+    }
+#endif
+
+#if defined(LOGTAIL_UTF8_VALIDATOR_NEON)
+    struct NeonState {
+        uint8x16_t error;
+        uint8x16_t prevInput;
+        uint8x16_t prevIncomplete;
+    };
+
+    const uint8_t kByte1HighTable[16] = {LOGTAIL_UTF8_BYTE_1_HIGH};
+    const uint8_t kByte1LowTable[16] = {LOGTAIL_UTF8_BYTE_1_LOW};
+    const uint8_t kByte2HighTable[16] = {LOGTAIL_UTF8_BYTE_2_HIGH};
+    const uint8_t kMaxValue[16] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+                                   0xff, 0xff, 0xff, 0xff, 0xff, 0xf0 - 1, 0xe0 - 1, 0xc0 - 1};
+
+    inline void NeonCheckBlock(uint8x16_t input, NeonState& state) {
+        if (vmaxvq_u8(input) < 0x80) {
+            state.error = vorrq_u8(state.error, state.prevIncomplete);
+            state.prevInput = input;
+            return;
+        }
+        const uint8x16_t prev1 = vextq_u8(state.prevInput, input, 15);
+        const uint8x16_t byte1High = vqtbl1q_u8(vld1q_u8(kByte1HighTable), vshrq_n_u8(prev1, 4));
+        const uint8x16_t byte1Low = vqtbl1q_u8(vld1q_u8(kByte1LowTable), vandq_u8(prev1, vdupq_n_u8(0x0f)));
+        const uint8x16_t byte2High = vqtbl1q_u8(vld1q_u8(kByte2HighTable), vshrq_n_u8(input, 4));
+        const uint8x16_t special = vandq_u8(vandq_u8(byte1High, byte1Low), byte2High);
+
+        const uint8x16_t prev2 = vextq_u8(state.prevInput, input, 14);
+        const uint8x16_t prev3 = vextq_u8(state.prevInput, input, 13);
+        const uint8x16_t isThird = vqsubq_u8(prev2, vdupq_n_u8(0xe0 - 0x80));
+        const uint8x16_t isFourth = vqsubq_u8(prev3, vdupq_n_u8(0xf0 - 0x80));
+        const uint8x16_t must23 = vandq_u8(vorrq_u8(isThird, isFourth), vdupq_n_u8(0x80));
+        state.error = vorrq_u8(state.error, veorq_u8(must23, special));
+
+        state.prevIncomplete = vqsubq_u8(input, vld1q_u8(kMaxValue));
+        state.prevInput = input;
+    }
+
+    bool IsValidUtf8NEON(const char* data, size_t size) {
+        NeonState state{vdupq_n_u8(0), vdupq_n_u8(0), vdupq_n_u8(0)};
+        size_t offset = 0;
+        for (; offset + 16 <= size; offset += 16) {
+            NeonCheckBlock(vld1q_u8(reinterpret_cast<const uint8_t*>(data + offset)), state);
+        }
+        if (offset < size) {
+            uint8_t tail[16] = {0};
+            memcpy(tail, data + offset, size - offset);
+            NeonCheckBlock(vld1q_u8(tail), state);
+        }
+        return vmaxvq_u8(vorrq_u8(state.error, state.prevIncomplete)) == 0;
+    }
+#endif
+
+#undef LOGTAIL_UTF8_BYTE_1_HIGH
+#undef LOGTAIL_UTF8_BYTE_1_LOW
+#undef LOGTAIL_UTF8_BYTE_2_HIGH
+
+    Utf8Validator SelectUtf8Validator() {
+#if defined(LOGTAIL_UTF8_VALIDATOR_AVX2)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return Utf8Validator{"avx2", IsValidUtf8AVX2};
+        }
+#endif
+#if defined(LOGTAIL_UTF8_VALIDATOR_SSE2)
+        return Utf8Validator{"sse2", IsValidUtf8SSE2};
+#elif defined(LOGTAIL_UTF8_VALIDATOR_NEON)
+        return Utf8Validator{"neon", IsValidUtf8NEON};
+#else
+        return Utf8Validator{"scalar", IsValidUtf8Scalar};
+#endif
+    }
+
+    const Utf8Validator& GetUtf8Validator() {
+        static const Utf8Validator sValidator = SelectUtf8Validator();
+        return sValidator;
+    }
+
+} // namespace
+
+bool IsValidUtf8Scalar(const char* data, size_t size) {
+    const uint8_t* str = reinterpret_cast<const uint8_t*>(data);
+    size_t offset = 0;
+    while (offset < size) {
+        if (offset + 8 <= size) {
+            uint64_t word;
+            memcpy(&word, str + offset, sizeof(word));
+            if ((word & 0x8080808080808080ULL) == 0) {
+                offset += 8;
+                continue;
+            }
+        }
+        const uint8_t lead = str[offset];
+        if (lead < 0x80) {
+            ++offset;
+            continue;
+        }
+        size_t length = 0;
+        uint32_t unicode = 0;
+        if ((lead & 0xe0) == 0xc0) {
+            length = 2;
+            unicode = lead & 0x1f;
+        } else if ((lead & 0xf0) == 0xe0) {
+            length = 3;
+            unicode = lead & 0x0f;
+        } else if ((lead & 0xf8) == 0xf0) {
+            length = 4;
+            unicode = lead & 0x07;
+        } else {
+            return false;
+        }
+        if (offset + length > size) {
+            return false;
+        }
+        for (size_t i = 1; i < length; ++i) {
+            if ((str[offset + i] & 0xc0) != 0x80) {
+                return false;
+            }
+            unicode = (unicode << 6) | (str[offset + i] & 0x3f);
+        }
+        if ((length == 2 && unicode < 0x80) || (length == 3 && (unicode < 0x800 || (unicode >> 11) == 0x1b))
+            || (length == 4 && (unicode < 0x10000 || unicode > 0x10ffff))) {
+            return false;
+        }
+        offset += length;
+    }
+    return true;
+}
+
+bool IsValidUtf8(const char* data, size_t size) {
+    return GetUtf8Validator().isValid(data, size);
+}
+
+const char* GetUtf8ValidatorName() {
+    return GetUtf8Validator().name;
+}
+
+} // namespace logtail
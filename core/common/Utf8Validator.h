@@ -0,0 +1,36 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+
+// Vectorized UTF-8 validation used to skip repairing values which are already valid.
+// Implementation (AVX2/SSE2/NEON/scalar) is selected once at runtime according
+// to the features supported by current CPU.
+namespace logtail {
+
+// IsValidUtf8 returns true if [@data, @data + @size) is well-formed UTF-8 as RFC 3629, that is no truncated
+// sequences, overlong forms, surrogates or code points above U+10FFFF.
+bool IsValidUtf8(const char* data, size_t size);
+
+// GetUtf8ValidatorName returns the name of selected implementation:
+// avx2, sse2, neon or scalar.
+const char* GetUtf8ValidatorName();
+
+// Byte-by-byte implementation (with an 8 bytes ASCII fast path), the baseline for UT and benchmark.
+bool IsValidUtf8Scalar(const char* data, size_t size);
+
+} // namespace logtail
@@ -68,6 +68,23 @@ bool IsHttpsEndpoint(const string& endpoint) {
     return false;
 }
 
+EndpointAddressType GetEndpointAddressType(const std::string& endpoint) {
+    size_t begin = endpoint.find("://");
+    begin = begin == std::string::npos ? 0 : begin + 3;
+    size_t end = endpoint.find_first_of(":/", begin);
+    const std::string host = ToLowerCaseString(endpoint.substr(begin, end == std::string::npos ? end : end - begin));
+    if (EndWith(host, "-intranet" + util::kLogEndpointSuffix)) {
+        return EndpointAddressType::INTRANET;
+    }
+    if (EndWith(host, "-share" + util::kLogEndpointSuffix)) {
+        return EndpointAddressType::INNER;
+    }
+    if (EndWith(host, util::kLogEndpointSuffix) || host == util::kAccelerationDataEndpoint) {
+        return EndpointAddressType::PUBLIC;
+    }
+    return EndpointAddressType::INNER;
+}
+
 namespace util {
 
     const std::string kConfigPrefix = "/etc/ilogtail/conf/";
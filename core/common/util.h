@@ -43,6 +43,9 @@ std::string CalculateRandomUUID();
 // 2. .log.aliyuncs.com excluding -share.log.aliyuncs.com: PUBLIC.
 // 3. others including -share.log.aliyuncs.com: INNER.
 enum class EndpointAddressType { INNER, INTRANET, PUBLIC };
+// GetEndpointAddressType classifies @endpoint by its host, the protocol and port are ignored, the global
+// acceleration endpoint is PUBLIC.
+EndpointAddressType GetEndpointAddressType(const std::string& endpoint);
 bool IsHttpsEndpoint(const std::string& endpoint);
 
 namespace util {
@@ -18,14 +18,22 @@
 #endif
 #include "common/Constants.h"
 #include "common/FileSystemUtil.h"
+#include "common/HashUtil.h"
 #include "common/LogtailCommonFlags.h"
 #include "reader/LogFileReader.h"
+#include "reader/ContainerStdoutLogFileReader.h"
 #include "reader/DelimiterLogFileReader.h"
 #include "reader/JsonLogFileReader.h"
 #include "logger/Logger.h"
 #include "processor/LogFilter.h"
 
 DEFINE_FLAG_INT32(logreader_max_rotate_queue_size, "", 20);
+DEFINE_FLAG_INT64(file_read_rate_limit,
+                  "bytes per second read from each file while other events are waiting, 0 means unlimited",
+                  0);
+DEFINE_FLAG_INT64(config_read_rate_limit,
+                  "bytes per second read from files of each config while other events are waiting, 0 means unlimited",
+                  0);
 DECLARE_FLAG_STRING(raw_log_tag);
 DECLARE_FLAG_INT32(batch_send_interval);
 DECLARE_FLAG_INT32(reader_close_unused_file_time);
@@ -78,6 +86,8 @@ Config::AdvancedConfig::AdvancedConfig()
       mBatchSendInterval(INT32_FLAG(batch_send_interval)),
       mMaxRotateQueueSize(INT32_FLAG(logreader_max_rotate_queue_size)),
       mCloseUnusedReaderInterval(INT32_FLAG(reader_close_unused_file_time)),
+      mFileReadRateLimit(INT64_FLAG(file_read_rate_limit)),
+      mConfigReadRateLimit(INT64_FLAG(config_read_rate_limit)),
       mSearchCheckpointDirDepth(static_cast<uint16_t>(INT32_FLAG(search_checkpoint_default_dir_depth))) {
 }
 
@@ -119,6 +129,7 @@ Config::Config(const std::string& basePath,
 #endif
 
     ParseWildcardPath();
+    mPathMergeKey = HashWithSeed(mBasePath + mFilePattern);
     mTailLimit = 0;
     mTailExisted = false;
     mLogstoreKey = GenerateLogstoreFeedBackKey(GetProjectName(), GetCategory());
@@ -131,6 +142,7 @@ Config::Config(const std::string& basePath,
     mLogTimeZoneOffsetSecond = 0;
     mLogDelayAlarmBytes = 0;
     mPriority = 0;
+    mProcessCpuQuota = 0;
     mLogDelaySkipBytes = 0;
     mLocalFlag = false;
     mDockerFileFlag = false;
@@ -232,8 +244,10 @@ bool Config::IsMatch(const std::string& path, const std::string& name) {
         }
 
         // Normal base path.
-        for (size_t i = 0; i < mDockerContainerPaths->size(); ++i) {
-            const std::string& containerBasePath = (*mDockerContainerPaths)[i].mContainerPath;
+        size_t pos = 0;
+        DockerContainerPath* containerPath = NULL;
+        while ((containerPath = NextContainerPathByLogPath(path, pos)) != NULL) {
+            const std::string& containerBasePath = containerPath->mContainerPath;
             if (_IsPathMatched(containerBasePath, path, mMaxDepth)) {
                 if (!mHasBlacklist) {
                     return true;
@@ -523,7 +537,7 @@ LogFileReader* Config::CreateLogFileReader(const std::string& dir,
         CommonRegLogFileReader* commonRegLogFileReader = static_cast<CommonRegLogFileReader*>(reader);
         commonRegLogFileReader->SetTimeKey(mTimeKey);
         for (; regitr != mRegs->end(); ++regitr, ++keyitr) {
-            commonRegLogFileReader->AddUserDefinedFormat(*regitr, *keyitr);
+            commonRegLogFileReader->AddUserDefinedFormat(*regitr, *keyitr, mAdvancedConfig.mUseRe2Regex);
         }
     } else if (mLogType == DELIMITER_LOG) {
         reader = new DelimiterLogFileReader(mProjectName,
@@ -558,6 +572,17 @@ LogFileReader* Config::CreateLogFileReader(const std::string& dir,
                                        mDockerFileFlag);
         JsonLogFileReader* jsonLogFileReader = static_cast<JsonLogFileReader*>(reader);
         jsonLogFileReader->SetTimeKey(mTimeKey);
+        jsonLogFileReader->SetRawNestedValue(mAdvancedConfig.mJsonRawNestedValue);
+    } else if (mLogType == CONTAINER_STDOUT_LOG) {
+        reader = new ContainerStdoutLogFileReader(mProjectName,
+                                                  mCategory,
+                                                  dir,
+                                                  file,
+                                                  mTailLimit,
+                                                  STRING_DEEP_COPY(mTopicFormat),
+                                                  STRING_DEEP_COPY(mGroupTopic),
+                                                  mDiscardUnmatch,
+                                                  mDockerFileFlag);
     } else {
         LOG_ERROR(sLogger, ("log reader creation failed, unknown log type", mLogType)("project", GetProjectName())("logstore", GetCategory())("config", mConfigName));
     }
@@ -579,6 +604,7 @@ LogFileReader* Config::CreateLogFileReader(const std::string& dir,
         reader->SetConfigName(mConfigName);
         reader->SetRegion(mRegion);
         reader->SetLogBeginRegex(STRING_DEEP_COPY(mLogBeginReg));
+        reader->SetLogBeginRegexPrefilter(mLogBeginRegPrefilter);
         if (forceFromBeginning)
             reader->SetReadFromBeginning();
         reader->SetDevInode(devInode);
@@ -590,6 +616,7 @@ LogFileReader* Config::CreateLogFileReader(const std::string& dir,
         }
         reader->SetTimeFormat(mTimeFormat);
         reader->SetCloseUnusedInterval(mAdvancedConfig.mCloseUnusedReaderInterval);
+        reader->SetReadRateLimit(mAdvancedConfig.mFileReadRateLimit);
         reader->SetLogstoreKey(mLogstoreKey);
         reader->SetPluginFlag(mPluginProcessFlag);
         reader->SetSpecifiedYear(mAdvancedConfig.mSpecifiedYear);
@@ -598,6 +625,7 @@ LogFileReader* Config::CreateLogFileReader(const std::string& dir,
                                           mAdvancedConfig.mPreciseTimestampUnit);
         reader->SetTzOffsetSecond(mTimeZoneAdjust, mLogTimeZoneOffsetSecond);
         reader->SetAdjustApsaraMicroTimezone(mAdvancedConfig.mAdjustApsaraMicroTimezone);
+        reader->SetKeptKeys(mAdvancedConfig.mKeptKeys);
         
         if (mDockerFileFlag) {
             DockerContainerPath* containerPath = GetContainerPathByLogPath(dir);
@@ -627,6 +655,10 @@ LogFileReader* Config::CreateLogFileReader(const std::string& dir,
 
         auto readPolicy = mCollectBackwardTillBootTime ? LogFileReader::BACKWARD_TO_BOOT_TIME
                                                        : LogFileReader::BACKWARD_TO_FIXED_POS;
+        if (mAdvancedConfig.mReadFromTime > 0 && !mCollectBackwardTillBootTime) {
+            reader->SetReadFromTime(mAdvancedConfig.mReadFromTime);
+            readPolicy = LogFileReader::BACKWARD_TO_TIME;
+        }
         reader->InitReader(mTailExisted, readPolicy, mAdvancedConfig.mExactlyOnceConcurrency);
     }
 
@@ -640,6 +672,8 @@ bool Config::SetDockerFileFlag(bool supportWildcardPath) {
     if (!mDockerContainerPaths) {
         mDockerContainerPaths.reset(new std::vector<DockerContainerPath>());
     }
+    // Paths may be loaded from the previous config.
+    RebuildContainerPathIndex();
     mDockerFileFlag = true;
     return true;
 }
@@ -651,17 +685,57 @@ void Config::SetTailLimit(int32_t size) {
 }
 
 DockerContainerPath* Config::GetContainerPathByLogPath(const std::string& logPath) {
-    if (!mDockerContainerPaths) {
+    size_t pos = 0;
+    return NextContainerPathByLogPath(logPath, pos);
+}
+
+DockerContainerPath* Config::NextContainerPathByLogPath(const std::string& logPath, size_t& pos) {
+    if (!mDockerContainerPaths || mContainerPathIndex.empty()) {
         return NULL;
     }
-    for (size_t i = 0; i < mDockerContainerPaths->size(); ++i) {
-        if (_IsSubPath((*mDockerContainerPaths)[i].mContainerPath, logPath)) {
-            return &(*mDockerContainerPaths)[i];
+    // Look up each ancestor of logPath, from the shortest, so the cost does not grow with container count.
+    std::string ancestor;
+    for (size_t i = pos + 1; i <= logPath.size(); ++i) {
+        if (i < logPath.size() && logPath[i] != PATH_SEPARATOR[0]) {
+            continue;
+        }
+        ancestor.assign(logPath, 0, i);
+        auto iter = mContainerPathIndex.find(ancestor);
+        if (iter != mContainerPathIndex.end()) {
+            pos = i;
+            return &(*mDockerContainerPaths)[iter->second];
         }
     }
+    pos = logPath.size();
     return NULL;
 }
 
+DockerContainerPath* Config::GetContainerPathByID(const std::string& containerID) {
+    if (!mDockerContainerPaths) {
+        return NULL;
+    }
+    auto iter = mContainerIDIndex.find(containerID);
+    return iter == mContainerIDIndex.end() ? NULL : &(*mDockerContainerPaths)[iter->second];
+}
+
+void Config::RebuildContainerPathIndex() {
+    mContainerIDIndex.clear();
+    mContainerPathIndex.clear();
+    if (!mDockerContainerPaths) {
+        return;
+    }
+    for (size_t i = 0; i < mDockerContainerPaths->size(); ++i) {
+        IndexContainerPath(i);
+    }
+}
+
+void Config::IndexContainerPath(size_t index) {
+    const DockerContainerPath& containerPath = (*mDockerContainerPaths)[index];
+    mContainerIDIndex.emplace(containerPath.mContainerID, index);
+    // The first container wins if paths are duplicated.
+    mContainerPathIndex.emplace(containerPath.mContainerPath, index);
+}
+
 bool Config::IsSameDockerContainerPath(const std::string& paramsJSONStr, bool allFlag) {
     if (!mDockerContainerPaths)
         return true;
@@ -672,13 +746,8 @@ bool Config::IsSameDockerContainerPath(const std::string& paramsJSONStr, bool al
             LOG_ERROR(sLogger, ("invalid docker container params", "skip this path")("params", paramsJSONStr));
             return true;
         }
-        // try update
-        for (size_t i = 0; i < mDockerContainerPaths->size(); ++i) {
-            if ((*mDockerContainerPaths)[i] == dockerContainerPath) {
-                return true;
-            }
-        }
-        return false;
+        DockerContainerPath* containerPath = GetContainerPathByID(dockerContainerPath.mContainerID);
+        return containerPath != NULL && *containerPath == dockerContainerPath;
     }
 
     // check all
@@ -719,16 +788,26 @@ bool Config::UpdateDockerContainerPath(const std::string& paramsJSONStr, bool al
             LOG_ERROR(sLogger, ("invalid docker container params", "skip this path")("params", paramsJSONStr));
             return false;
         }
-        // try update
-        for (size_t i = 0; i < mDockerContainerPaths->size(); ++i) {
-            if ((*mDockerContainerPaths)[i].mContainerID == dockerContainerPath.mContainerID) {
-                // update
-                (*mDockerContainerPaths)[i] = dockerContainerPath;
-                return true;
+        auto iter = mContainerIDIndex.find(dockerContainerPath.mContainerID);
+        if (iter == mContainerIDIndex.end()) {
+            // add
+            mDockerContainerPaths->push_back(dockerContainerPath);
+            IndexContainerPath(mDockerContainerPaths->size() - 1);
+            return true;
+        }
+        // update
+        size_t index = iter->second;
+        bool hasDuplicatedPath = mContainerPathIndex.size() != mDockerContainerPaths->size();
+        std::string oldPath = (*mDockerContainerPaths)[index].mContainerPath;
+        (*mDockerContainerPaths)[index] = dockerContainerPath;
+        if (oldPath != dockerContainerPath.mContainerPath) {
+            if (hasDuplicatedPath) {
+                RebuildContainerPathIndex();
+            } else {
+                mContainerPathIndex.erase(oldPath);
+                mContainerPathIndex.emplace(dockerContainerPath.mContainerPath, index);
             }
         }
-        // add
-        mDockerContainerPaths->push_back(dockerContainerPath);
         return true;
     }
 
@@ -744,6 +823,7 @@ bool Config::UpdateDockerContainerPath(const std::string& paramsJSONStr, bool al
          ++iter) {
         mDockerContainerPaths->push_back(iter->second);
     }
+    RebuildContainerPathIndex();
     return true;
 }
 
@@ -755,13 +835,26 @@ bool Config::DeleteDockerContainerPath(const std::string& paramsJSONStr) {
     if (!DockerContainerPath::ParseByJSONStr(paramsJSONStr, dockerContainerPath)) {
         return false;
     }
-    for (std::vector<DockerContainerPath>::iterator iter = mDockerContainerPaths->begin();
-         iter != mDockerContainerPaths->end();
-         ++iter) {
-        if (iter->mContainerID == dockerContainerPath.mContainerID) {
-            mDockerContainerPaths->erase(iter);
-            break;
-        }
+    auto iter = mContainerIDIndex.find(dockerContainerPath.mContainerID);
+    if (iter == mContainerIDIndex.end()) {
+        return true;
+    }
+    // Move the last one to the deleted position, order of container paths does not matter.
+    size_t index = iter->second;
+    size_t last = mDockerContainerPaths->size() - 1;
+    bool hasDuplicatedPath = mContainerPathIndex.size() != mDockerContainerPaths->size();
+    mContainerIDIndex.erase(iter);
+    mContainerPathIndex.erase((*mDockerContainerPaths)[index].mContainerPath);
+    if (index != last) {
+        (*mDockerContainerPaths)[index] = std::move((*mDockerContainerPaths)[last]);
+    }
+    mDockerContainerPaths->pop_back();
+    if (hasDuplicatedPath) {
+        RebuildContainerPathIndex();
+    } else if (index != last) {
+        const DockerContainerPath& moved = (*mDockerContainerPaths)[index];
+        mContainerIDIndex[moved.mContainerID] = index;
+        mContainerPathIndex[moved.mContainerPath] = index;
     }
     return true;
 }
@@ -18,13 +18,16 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <unordered_map>
 #include <boost/regex.hpp>
 #include <re2/re2.h>
+#include <re2/set.h>
 #include "DockerFileConfig.h"
 #include "common/EncodingConverter.h"
 #include "common/LogstoreFeedbackQueue.h"
 #include "common/Flags.h"
 #include "common/TimeUtil.h"
+#include "common/RegexPrefixFilter.h"
 #include "aggregator/Aggregator.h"
 #include "processor/BaseFilterNode.h"
 #include "LogType.h"
@@ -34,8 +37,11 @@ namespace logtail {
 
 class LogFileReader;
 class EventDispatcher;
+struct LogToMetricConfig;
 class DevInode;
 struct LogFilterRule;
+class LogFilterProgram;
+struct ProcessPipeline;
 
 enum RegionType { REGION_PUB, REGION_CORP };
 enum CheckUpdateStat { NORMAL, UPDATE_CONFIG, UPDATE_BIN };
@@ -84,10 +90,18 @@ public:
         std::string mRawLogTag; // if mUploadRawLog is true, use this string as raw log tag
         int32_t mBatchSendInterval;
         BaseFilterNodePtr mFilterExpressionRoot;
+        // Compiled from mFilterExpressionRoot, NULL if it can not be compiled.
+        std::shared_ptr<LogFilterProgram> mFilterExpressionProgram;
         uint32_t mExactlyOnceConcurrency = 0;
         bool mEnableLogPositionMeta = false; // Add inode/offset to log.
         size_t mMaxRotateQueueSize;
+        // Rotated files and the live file are read at the same time, logs are ordered per file rather than per
+        // rotate queue.
+        bool mParallelRotatedRead = false;
         int32_t mCloseUnusedReaderInterval;
+        int64_t mFileReadRateLimit; // bytes per second of each file, <= 0 means unlimited
+        int64_t mConfigReadRateLimit; // bytes per second of all files of the config, <= 0 means unlimited
+        int32_t mReadFromTime = 0; // unix seconds, new files are read from the first log not before it if set
         int32_t mSpecifiedYear = -1; // Year deduction.
         uint16_t mSearchCheckpointDirDepth = 0; // Max directory depth when search checkpoint.
 
@@ -95,6 +109,13 @@ public:
         std::string mPreciseTimestampKey;
         TimeStampUnit mPreciseTimestampUnit;
         bool mAdjustApsaraMicroTimezone = false;
+        bool mUseRe2Regex = false; // Match REGEX_LOG with RE2 if the regex is supported by RE2.
+        bool mJsonRawNestedValue = false; // Parse JSON_LOG by SAX, nested values are kept as raw text.
+        // Keys of JSON_LOG and REGEX_LOG kept in logs, including keys used by filters, empty means all keys.
+        std::vector<std::string> mKeptKeys;
+        bool mCollapseRepeatedLines = false; // Collapse exact repeats of a line in the same buffer into one log.
+        // Logs are aggregated into metric logs before sent if set.
+        std::shared_ptr<LogToMetricConfig> mLogToMetric;
     };
 
 public:
@@ -107,6 +128,7 @@ public:
     LogType mLogType;
     std::string mConfigName; // name of log e.g. aliyun_com "##1.0##sls-zc-test$home-log"
     std::string mLogBeginReg; // the log begin line regex
+    RegexPrefixFilterPtr mLogBeginRegPrefilter; // extracted from mLogBeginReg, shared by readers
     std::string mProjectName; // project name
     bool mIsPreserve; // true is service dir, false is job dir
     int mPreserveDepth; // for job dir, the depth that will not be watch timeout
@@ -149,6 +171,9 @@ public:
     std::vector<std::string> mShardHashKey;
     bool mTailExisted;
     std::unordered_map<std::string, std::vector<SensitiveWordCastOption>> mSensitiveWordCastOptions;
+    // Regexes of cast options of keys with multiple options combined into one automaton,
+    // pattern i is the regex of option i, see ConfigManagerBase::CompileSensitiveWordCastSets.
+    std::unordered_map<std::string, std::shared_ptr<re2::RE2::Set>> mSensitiveWordCastSets;
     bool mUploadRawLog; // true to update raw log to sls
     bool mSimpleLogFlag;
     bool mTimeZoneAdjust;
@@ -160,14 +185,20 @@ public:
     int32_t mSendRateExpireTime; // send rate expire time, along with mMaxSendBytesPerSecond
     int64_t mLogDelayAlarmBytes; // if <=0, discard it, default 0.
     LogstoreFeedBackKey mLogstoreKey;
+    uint64_t mPathMergeKey = 0; // hash of mBasePath + mFilePattern, a part of merge keys in aggregator
     int32_t mPriority; // default is 0(no priority); 1-3, max priority is 1
+    int32_t mProcessCpuQuota; // percent of one core for processing logs of the logstore, <= 0 means unlimited
     int64_t mLogDelaySkipBytes; // if <=0, discard it, default 0.
 
     std::string mPluginConfig; // plugin config string
-    // mDockerContainerPaths is only modified when HoldOn
+    // mDockerContainerPaths is only modified when HoldOn, along with the indexes below
     std::shared_ptr<std::vector<DockerContainerPath>>
         mDockerContainerPaths; // docker file mapping paths, if mPluginConfig is true, mDockerContainerPaths must not be
                                // NULL
+    // Positions in mDockerContainerPaths by container id and by container path, they are kept along with
+    // mDockerContainerPaths, so container events and path lookups do not scan all containers.
+    std::unordered_map<std::string, size_t> mContainerIDIndex;
+    std::unordered_map<std::string, size_t> mContainerPathIndex;
     bool mLocalFlag; // this config is loaded from local or remote
     bool mDockerFileFlag; // docker file flag
     bool mPluginProcessFlag; // file config with plugin process
@@ -179,6 +210,9 @@ public:
     // for line count
     LineCountConfigPtr mLineCountConfig;
 
+    // Compiled by ConfigManager after the config is loaded, see ProcessPipeline.
+    std::shared_ptr<const ProcessPipeline> mProcessPipeline;
+
     bool mIsFuseMode = false;
     bool mMarkOffsetFlag = false;
     bool mCollectBackwardTillBootTime = false;
@@ -220,6 +254,7 @@ public:
         mDockerFileFlag = false;
         mPluginProcessFlag = false;
         mPriority = 0;
+        mProcessCpuQuota = 0;
         mLogDelaySkipBytes = 0;
         mDockerContainerPaths = NULL;
         mAcceptNoEnoughKeys = false;
@@ -250,6 +285,9 @@ public:
     bool DeleteDockerContainerPath(const std::string& paramsJSONStr);
 
     DockerContainerPath* GetContainerPathByLogPath(const std::string& logPath);
+    DockerContainerPath* GetContainerPathByID(const std::string& containerID);
+    // RebuildContainerPathIndex must be called after mDockerContainerPaths is replaced or modified directly.
+    void RebuildContainerPathIndex();
 
     bool IsMatch(const std::string& path, const std::string& name);
 
@@ -297,6 +335,11 @@ private:
     // IsFileNameInBlacklist checks if the file name is in blacklist.
     bool IsFileNameInBlacklist(const std::string& fileName) const;
 
+    // NextContainerPathByLogPath returns the container path which is @logPath or an ancestor of it and is
+    // longer than @pos, @pos is set to the size of the returned path, so callers can iterate all of them.
+    DockerContainerPath* NextContainerPathByLogPath(const std::string& logPath, size_t& pos);
+    void IndexContainerPath(size_t index);
+
 #if defined(APSARA_UNIT_TEST_MAIN)
     friend class ConfigUpdatorUnittest;
 #endif
@@ -0,0 +1,192 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ConfigPathIndex.h"
+#include <algorithm>
+#include "config/Config.h"
+#include "common/FileSystemUtil.h"
+
+namespace logtail {
+
+namespace {
+#if defined(_MSC_VER)
+    const char* const kWildcardChars = "*?[";
+#else
+    const char* const kWildcardChars = "*?[\\";
+#endif
+} // namespace
+
+bool ConfigPathIndex::GetKey(const Config* config, Key& key) {
+    if (config->mDockerFileFlag) {
+        return false;
+    }
+    const std::string& basePath = config->mBasePath;
+    size_t pos = basePath.find_first_of(kWildcardChars);
+    if (pos == std::string::npos) {
+        SplitPath(basePath, key.mComponents);
+    } else {
+        // Every path matched by wildcard base path starts with the directory before the first wildcard.
+        pos = basePath.rfind(PATH_SEPARATOR[0], pos);
+        if (pos == std::string::npos) {
+            return false;
+        }
+        SplitPath(basePath.substr(0, pos), key.mComponents);
+    }
+    if (config->mFilePattern.find_first_of(kWildcardChars) == std::string::npos) {
+        key.mFileName = config->mFilePattern;
+    }
+    key.mIndexed = true;
+    return true;
+}
+
+void ConfigPathIndex::SplitPath(const std::string& path, std::vector<std::string>& components) {
+    size_t begin = 0;
+    while (begin < path.size()) {
+        size_t end = path.find(PATH_SEPARATOR[0], begin);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        if (end > begin) {
+            components.emplace_back(path, begin, end - begin);
+        }
+        begin = end + 1;
+    }
+}
+
+bool ConfigPathIndex::RemoveFromVector(std::vector<Config*>& configs, Config* config) {
+    auto itr = std::find(configs.begin(), configs.end(), config);
+    if (itr == configs.end()) {
+        return false;
+    }
+    configs.erase(itr);
+    return true;
+}
+
+void ConfigPathIndex::Add(Config* config) {
+    if (mConfigKeys.find(config) != mConfigKeys.end()) {
+        return;
+    }
+    Key& key = mConfigKeys[config];
+    if (!GetKey(config, key)) {
+        mUnindexedConfigs.push_back(config);
+        return;
+    }
+    Node* node = &mRoot;
+    for (const auto& component : key.mComponents) {
+        std::unique_ptr<Node>& child = node->mChildren[component];
+        if (!child) {
+            child.reset(new Node);
+        }
+        node = child.get();
+    }
+    if (key.mFileName.empty()) {
+        node->mPatternConfigs.push_back(config);
+    } else {
+        node->mNameConfigs[key.mFileName].push_back(config);
+    }
+}
+
+void ConfigPathIndex::Remove(Config* config) {
+    auto keyItr = mConfigKeys.find(config);
+    if (keyItr == mConfigKeys.end()) {
+        return;
+    }
+    const Key& key = keyItr->second;
+    if (!key.mIndexed) {
+        RemoveFromVector(mUnindexedConfigs, config);
+        mConfigKeys.erase(keyItr);
+        return;
+    }
+    std::vector<Node*> nodes(1, &mRoot);
+    for (const auto& component : key.mComponents) {
+        auto childItr = nodes.back()->mChildren.find(component);
+        if (childItr == nodes.back()->mChildren.end()) {
+            break;
+        }
+        nodes.push_back(childItr->second.get());
+    }
+    if (nodes.size() == key.mComponents.size() + 1) {
+        Node* node = nodes.back();
+        if (key.mFileName.empty()) {
+            RemoveFromVector(node->mPatternConfigs, config);
+        } else {
+            auto nameItr = node->mNameConfigs.find(key.mFileName);
+            if (nameItr != node->mNameConfigs.end()) {
+                RemoveFromVector(nameItr->second, config);
+                if (nameItr->second.empty()) {
+                    node->mNameConfigs.erase(nameItr);
+                }
+            }
+        }
+        // Prune empty nodes from the deepest one.
+        for (size_t i = nodes.size() - 1; i > 0; --i) {
+            Node* child = nodes[i];
+            if (!child->mChildren.empty() || !child->mNameConfigs.empty() || !child->mPatternConfigs.empty()) {
+                break;
+            }
+            nodes[i - 1]->mChildren.erase(key.mComponents[i - 1]);
+        }
+    }
+    mConfigKeys.erase(keyItr);
+}
+
+void ConfigPathIndex::Clear() {
+    mRoot.mChildren.clear();
+    mRoot.mNameConfigs.clear();
+    mRoot.mPatternConfigs.clear();
+    mUnindexedConfigs.clear();
+    mConfigKeys.clear();
+}
+
+void ConfigPathIndex::AppendNodeConfigs(const Node& node, const std::string& name, std::vector<Config*>& candidates) {
+    candidates.insert(candidates.end(), node.mPatternConfigs.begin(), node.mPatternConfigs.end());
+    if (name.empty()) {
+        for (const auto& nameConfigs : node.mNameConfigs) {
+            candidates.insert(candidates.end(), nameConfigs.second.begin(), nameConfigs.second.end());
+        }
+        return;
+    }
+    auto itr = node.mNameConfigs.find(name);
+    if (itr != node.mNameConfigs.end()) {
+        candidates.insert(candidates.end(), itr->second.begin(), itr->second.end());
+    }
+}
+
+void ConfigPathIndex::GetCandidates(const std::string& path,
+                                    const std::string& name,
+                                    std::vector<Config*>& candidates) const {
+    candidates.insert(candidates.end(), mUnindexedConfigs.begin(), mUnindexedConfigs.end());
+    const Node* node = &mRoot;
+    AppendNodeConfigs(*node, name, candidates);
+    size_t begin = 0;
+    std::string component;
+    while (begin < path.size()) {
+        size_t end = path.find(PATH_SEPARATOR[0], begin);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        if (end > begin) {
+            component.assign(path, begin, end - begin);
+            auto itr = node->mChildren.find(component);
+            if (itr == node->mChildren.end()) {
+                return;
+            }
+            node = itr->second.get();
+            AppendNodeConfigs(*node, name, candidates);
+        }
+        begin = end + 1;
+    }
+}
+
+} // namespace logtail
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace logtail {
+
+class Config;
+
+// ConfigPathIndex finds configs that might match a file without testing every config.
+//
+// Configs are kept in a trie over the path components of their literal base path, the part before the first
+// wildcard for wildcard base paths. Configs whose file pattern has no wildcard are further indexed by the
+// file name. Candidates are a superset of configs matching the file, Config::IsMatch is still required.
+// Configs in docker are matched against container paths, which change without config updates, so that
+// they are always candidates.
+class ConfigPathIndex {
+public:
+    void Add(Config* config);
+    void Remove(Config* config);
+    void Clear();
+
+    // GetCandidates appends configs that might match the file @name in @path to @candidates, all configs
+    // under @path if @name is empty.
+    void GetCandidates(const std::string& path, const std::string& name, std::vector<Config*>& candidates) const;
+
+    size_t Size() const { return mConfigKeys.size(); }
+
+private:
+    struct Key {
+        bool mIndexed = false;
+        std::vector<std::string> mComponents;
+        std::string mFileName; // empty if file pattern has wildcards
+    };
+
+    struct Node {
+        std::unordered_map<std::string, std::unique_ptr<Node>> mChildren;
+        std::unordered_map<std::string, std::vector<Config*>> mNameConfigs;
+        std::vector<Config*> mPatternConfigs;
+    };
+
+    // GetKey returns false if @config can not be indexed by path.
+    static bool GetKey(const Config* config, Key& key);
+    static void SplitPath(const std::string& path, std::vector<std::string>& components);
+    static void AppendNodeConfigs(const Node& node, const std::string& name, std::vector<Config*>& candidates);
+    static bool RemoveFromVector(std::vector<Config*>& configs, Config* config);
+
+    Node mRoot;
+    std::vector<Config*> mUnindexedConfigs;
+    std::unordered_map<Config*, Key> mConfigKeys;
+};
+
+} // namespace logtail
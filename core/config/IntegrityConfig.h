@@ -48,31 +48,9 @@ struct IntegrityConfig {
         mCompiledTimeReg = new boost::regex(timeReg.c_str());
     }
 
-    IntegrityConfig(const IntegrityConfig& cfg)
-        : mAliuid(cfg.mAliuid),
-          mIntegritySwitch(cfg.mIntegritySwitch),
-          mIntegrityProjectName(cfg.mIntegrityProjectName),
-          mIntegrityLogstore(cfg.mIntegrityLogstore),
-          mLogTimeReg(cfg.mLogTimeReg),
-          mTimeFormat(cfg.mTimeFormat),
-          mTimePos(cfg.mTimePos) {
-        mCompiledTimeReg = new boost::regex(cfg.mLogTimeReg.c_str());
-    }
-
-    IntegrityConfig& operator=(const IntegrityConfig& cfg) {
-        if (this != &cfg) {
-            mAliuid = cfg.mAliuid;
-            mIntegritySwitch = cfg.mIntegritySwitch;
-            mIntegrityProjectName = cfg.mIntegrityProjectName;
-            mIntegrityLogstore = cfg.mIntegrityLogstore;
-            mLogTimeReg = cfg.mLogTimeReg;
-            mTimeFormat = cfg.mTimeFormat;
-            mCompiledTimeReg = new boost::regex(cfg.mLogTimeReg.c_str());
-            mTimePos = cfg.mTimePos;
-        }
-
-        return *this;
-    }
+    // Instances are shared by Config and log groups, so they are not copied.
+    IntegrityConfig(const IntegrityConfig&) = delete;
+    IntegrityConfig& operator=(const IntegrityConfig&) = delete;
 
     ~IntegrityConfig() { delete mCompiledTimeReg; }
 };
@@ -93,7 +71,8 @@ struct LineCountConfig {
           mLineCountLogstore(lineCountLogstore) {}
 };
 
-typedef std::shared_ptr<IntegrityConfig> IntegrityConfigPtr;
-typedef std::shared_ptr<LineCountConfig> LineCountConfigPtr;
+// Immutable after created by ConfigManager, log groups of the config reference the same instances.
+typedef std::shared_ptr<const IntegrityConfig> IntegrityConfigPtr;
+typedef std::shared_ptr<const LineCountConfig> LineCountConfigPtr;
 
 } // namespace logtail
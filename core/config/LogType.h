@@ -16,4 +16,4 @@
 
 #pragma once
 
-enum LogType { APSARA_LOG, REGEX_LOG, STREAM_LOG, JSON_LOG, DELIMITER_LOG, PLUGIN_LOG };
+enum LogType { APSARA_LOG, REGEX_LOG, STREAM_LOG, JSON_LOG, DELIMITER_LOG, PLUGIN_LOG, CONTAINER_STDOUT_LOG };
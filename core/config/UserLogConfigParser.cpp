@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "UserLogConfigParser.h"
+#include <algorithm>
 #include <vector>
 #include <boost/filesystem.hpp>
 #include "common/FileSystemUtil.h"
@@ -22,6 +23,9 @@
 #include "processor/UnaryFilterOperatorNode.h"
 #include "processor/RegexFilterValueNode.h"
 #include "processor/BinaryFilterOperatorNode.h"
+#include "processor/LogFilterProgram.h"
+#include "processor/LogFilter.h"
+#include "processor/LogToMetric.h"
 #include "logger/Logger.h"
 #include "Config.h"
 
@@ -97,6 +101,10 @@ void UserLogConfigParser::ParseAdvancedConfig(const Json::Value& originalVal, Co
             if (!root) {
                 throw ExceptionBase("invalid filter expression: " + val.toStyledString());
             }
+            std::shared_ptr<LogFilterProgram> program(new LogFilterProgram());
+            if (program->Compile(root)) {
+                cfg.mAdvancedConfig.mFilterExpressionProgram.swap(program);
+            }
             cfg.mAdvancedConfig.mFilterExpressionRoot.swap(root);
             LOG_INFO(sLogger, ("parse filter expression", val.toStyledString()));
         }
@@ -109,6 +117,14 @@ void UserLogConfigParser::ParseAdvancedConfig(const Json::Value& originalVal, Co
             LOG_INFO(sLogger, ("set max rotate queue size", cfg.mAdvancedConfig.mMaxRotateQueueSize));
         }
     }
+    // parallel_rotated_read
+    {
+        const Json::Value& val = advancedVal["parallel_rotated_read"];
+        if (val.isBool()) {
+            cfg.mAdvancedConfig.mParallelRotatedRead = val.asBool();
+            LOG_INFO(sLogger, ("set parallel rotated read", cfg.mAdvancedConfig.mParallelRotatedRead));
+        }
+    }
     // close_unused_reader_interval
     {
         const Json::Value& val = advancedVal["close_unused_reader_interval"];
@@ -117,6 +133,29 @@ void UserLogConfigParser::ParseAdvancedConfig(const Json::Value& originalVal, Co
             LOG_INFO(sLogger, ("set close unused reader interval", cfg.mAdvancedConfig.mCloseUnusedReaderInterval));
         }
     }
+    // file_read_rate_limit and config_read_rate_limit, bytes per second.
+    {
+        const Json::Value& val = advancedVal["file_read_rate_limit"];
+        if (val.isInt64()) {
+            cfg.mAdvancedConfig.mFileReadRateLimit = val.asInt64();
+            LOG_INFO(sLogger, ("set file read rate limit", cfg.mAdvancedConfig.mFileReadRateLimit));
+        }
+    }
+    {
+        const Json::Value& val = advancedVal["config_read_rate_limit"];
+        if (val.isInt64()) {
+            cfg.mAdvancedConfig.mConfigReadRateLimit = val.asInt64();
+            LOG_INFO(sLogger, ("set config read rate limit", cfg.mAdvancedConfig.mConfigReadRateLimit));
+        }
+    }
+    // read_from_time: unix seconds, files without checkpoint are read from the first log not before it.
+    {
+        const Json::Value& val = advancedVal["read_from_time"];
+        if (val.isUInt()) {
+            cfg.mAdvancedConfig.mReadFromTime = static_cast<int32_t>(val.asUInt());
+            LOG_INFO(sLogger, ("set read from time", cfg.mAdvancedConfig.mReadFromTime));
+        }
+    }
     // exactly once
     {
         const auto& val = advancedVal["exactly_once_concurrency"];
@@ -201,6 +240,142 @@ void UserLogConfigParser::ParseAdvancedConfig(const Json::Value& originalVal, Co
             cfg.mAdvancedConfig.mAdjustApsaraMicroTimezone = GetBoolValue(advancedVal, "adjust_apsara_micro_timezone");
         }
     }
+
+    // regex_engine: "boost"(default) or "re2".
+    if (cfg.mLogType == REGEX_LOG) {
+        const auto& val = advancedVal["regex_engine"];
+        if (val.isString() && val.asString() == "re2") {
+            cfg.mAdvancedConfig.mUseRe2Regex = true;
+        }
+    }
+
+    // json_raw_nested_value: keep nested objects and arrays of JSON_LOG as raw text.
+    if (cfg.mLogType == JSON_LOG) {
+        if (advancedVal.isMember("json_raw_nested_value") && advancedVal["json_raw_nested_value"].isBool()) {
+            cfg.mAdvancedConfig.mJsonRawNestedValue = GetBoolValue(advancedVal, "json_raw_nested_value");
+        }
+    }
+
+    // log_to_metric: logs are aggregated into metric logs by group keys and time windows.
+    if (advancedVal.isMember("log_to_metric")) {
+        ParseLogToMetric(advancedVal, cfg);
+    }
+    // kept_keys: only these keys of JSON_LOG and REGEX_LOG are extracted, others are skipped by parsers.
+    if (cfg.mLogType == JSON_LOG || cfg.mLogType == REGEX_LOG) {
+        ParseKeptKeys(advancedVal, cfg);
+    }
+    // collapse_repeated_lines: exact repeats of a line read at once are sent as one log with __repeat_count__.
+    {
+        const auto& val = advancedVal["collapse_repeated_lines"];
+        if (val.isBool()) {
+            cfg.mAdvancedConfig.mCollapseRepeatedLines = val.asBool();
+        }
+    }
+}
+
+void UserLogConfigParser::ParseKeptKeys(const Json::Value& advancedVal, Config& cfg) {
+    const auto& val = advancedVal["kept_keys"];
+    if (!val.isArray() || val.empty()) {
+        return;
+    }
+    std::vector<std::string> keys;
+    for (const auto& item : val) {
+        if (!item.isString()) {
+            throw ExceptionBase("kept_keys item must be string");
+        }
+        keys.push_back(item.asString());
+    }
+    // Filters run after parsing, keys they read must be kept. An expression which can not be compiled is
+    // evaluated by tree, its keys are unknown.
+    if (cfg.mAdvancedConfig.mFilterExpressionRoot.get() != NULL) {
+        if (!cfg.mAdvancedConfig.mFilterExpressionProgram) {
+            LOG_WARNING(sLogger,
+                        ("kept_keys is ignored, keys of filter expression are unknown", cfg.mConfigName)(
+                            "project", cfg.mProjectName)("logstore", cfg.mCategory));
+            return;
+        }
+        const auto& filterKeys = cfg.mAdvancedConfig.mFilterExpressionProgram->GetKeys();
+        keys.insert(keys.end(), filterKeys.begin(), filterKeys.end());
+    } else if (cfg.mFilterRule) {
+        keys.insert(keys.end(), cfg.mFilterRule->FilterKeys.begin(), cfg.mFilterRule->FilterKeys.end());
+    }
+    if (cfg.mAdvancedConfig.mLogToMetric) {
+        const LogToMetricConfig& metric = *cfg.mAdvancedConfig.mLogToMetric;
+        keys.insert(keys.end(), metric.mGroupKeys.begin(), metric.mGroupKeys.end());
+        keys.insert(keys.end(), metric.mValueKeys.begin(), metric.mValueKeys.end());
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    cfg.mAdvancedConfig.mKeptKeys.swap(keys);
+    LOG_INFO(sLogger, ("set kept keys", ToString(cfg.mAdvancedConfig.mKeptKeys))("config", cfg.mConfigName));
+}
+
+// Configurations:
+// log_to_metric: {
+//   Array<String> group_keys;
+//   Array<String> value_keys;
+//   Int window_seconds; // default 60
+//   Array<Double> quantiles; // in (0, 1), default [0.5, 0.9, 0.99]
+//   Double raw_log_sample_ratio; // in [0, 1], default 0
+//   String topic; // default "log_to_metric"
+// }
+void UserLogConfigParser::ParseLogToMetric(const Json::Value& advancedVal, Config& cfg) {
+    const auto& val = advancedVal["log_to_metric"];
+    if (!val.isObject()) {
+        throw ExceptionBase("log_to_metric must be object");
+    }
+    std::shared_ptr<LogToMetricConfig> metric = std::make_shared<LogToMetricConfig>();
+    auto parseKeys = [&val](const char* name, std::vector<std::string>& keys) {
+        const auto& keysVal = val[name];
+        if (!keysVal.isArray()) {
+            throw ExceptionBase(std::string("log_to_metric.") + name + " must be array");
+        }
+        for (const auto& item : keysVal) {
+            if (!item.isString()) {
+                throw ExceptionBase(std::string("log_to_metric.") + name + " item must be string");
+            }
+            keys.push_back(item.asString());
+        }
+    };
+    parseKeys("group_keys", metric->mGroupKeys);
+    parseKeys("value_keys", metric->mValueKeys);
+    if (val.isMember("window_seconds")) {
+        if (!val["window_seconds"].isInt() || val["window_seconds"].asInt() <= 0) {
+            throw ExceptionBase("log_to_metric.window_seconds must be positive integer");
+        }
+        metric->mWindowSeconds = val["window_seconds"].asInt();
+    }
+    if (val.isMember("quantiles")) {
+        const auto& quantilesVal = val["quantiles"];
+        if (!quantilesVal.isArray()) {
+            throw ExceptionBase("log_to_metric.quantiles must be array");
+        }
+        metric->mQuantiles.clear();
+        for (const auto& item : quantilesVal) {
+            if (!item.isNumeric() || item.asDouble() <= 0 || item.asDouble() >= 1) {
+                throw ExceptionBase("log_to_metric.quantiles item must be number in (0, 1)");
+            }
+            metric->mQuantiles.push_back(item.asDouble());
+        }
+    }
+    if (val.isMember("raw_log_sample_ratio")) {
+        const auto& ratioVal = val["raw_log_sample_ratio"];
+        if (!ratioVal.isNumeric() || ratioVal.asDouble() < 0 || ratioVal.asDouble() > 1) {
+            throw ExceptionBase("log_to_metric.raw_log_sample_ratio must be number in [0, 1]");
+        }
+        metric->mRawLogSampleRatio = ratioVal.asDouble();
+    }
+    if (val.isMember("topic")) {
+        if (!val["topic"].isString()) {
+            throw ExceptionBase("log_to_metric.topic must be string");
+        }
+        metric->mTopic = val["topic"].asString();
+    }
+    cfg.mAdvancedConfig.mLogToMetric = metric;
+    LOG_INFO(sLogger,
+             ("set log to metric, group keys", ToString(metric->mGroupKeys))(
+                 "value keys", ToString(metric->mValueKeys))("window seconds", metric->mWindowSeconds)(
+                 "config", cfg.mConfigName));
 }
 
 // Configurations:
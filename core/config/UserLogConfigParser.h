@@ -35,6 +35,14 @@ private:
     // @return if everything is ok, empty is returned, otherwise, returns exception string.
     static std::string ParseBlacklist(const Json::Value& advancedVal, Config& cfg);
 
+    // ParseKeptKeys parses kept_keys from @advancedVal into @cfg, keys read by filters of @cfg are added.
+    // @throw If an item is not string.
+    static void ParseKeptKeys(const Json::Value& advancedVal, Config& cfg);
+
+    // ParseLogToMetric parses log_to_metric from @advancedVal into @cfg.
+    // @throw If group_keys or value_keys is missing, or a field has wrong type or range.
+    static void ParseLogToMetric(const Json::Value& advancedVal, Config& cfg);
+
     static BaseFilterNodePtr ParseExpressionFromJSON(const Json::Value& value);
     static bool GetOperatorType(const std::string& type, FilterOperator& op);
     static bool GetNodeFuncType(const std::string& type, FilterNodeFunctionType& func);
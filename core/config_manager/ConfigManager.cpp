@@ -73,6 +73,10 @@ DEFINE_FLAG_STRING(default_access_key_id, "", "");
 DEFINE_FLAG_STRING(default_access_key, "", "");
 
 DEFINE_FLAG_INT32(config_update_interval, "second", 10);
+DEFINE_FLAG_INT32(config_server_rapid_check_times,
+                  "heartbeats sent every second after remote configs change, follow-up changes of a push arrive "
+                  "sooner",
+                  5);
 
 DEFINE_FLAG_INT32(file_tags_update_interval, "second", 1);
 
@@ -148,12 +152,16 @@ bool ConfigManager::CheckUpdateThread(bool configExistFlag) {
     usleep((rand() % 10) * 100 * 1000);
     int32_t lastCheckTime = 0;
     int32_t checkInterval = INT32_FLAG(config_update_interval);
+    int32_t rapidCheckTimes = 0;
     int32_t lastCheckTagsTime = 0;
     int32_t checkTagsInterval = INT32_FLAG(file_tags_update_interval);
     mConfigServiceClient->SendMetadata();
     while (mThreadIsRunning) {
         int32_t curTime = time(NULL);
-        if (curTime - lastCheckTime >= checkInterval) {
+        bool rapidCheck = rapidCheckTimes > 0 && curTime != lastCheckTime;
+        if (curTime - lastCheckTime >= checkInterval || rapidCheck) {
+            if (rapidCheck)
+                --rapidCheckTimes;
             if (AppConfig::GetInstance()->GetConfigServerAvailable()) {
                 AppConfig::ConfigServerAddress configServerAddress
                     = AppConfig::GetInstance()->GetOneConfigServerAddress(false);
@@ -164,10 +172,9 @@ bool ConfigManager::CheckUpdateThread(bool configExistFlag) {
                 if (checkResults.size() > 0) {
                     LOG_DEBUG(sLogger, ("fetch pipeline config, config file number", checkResults.size()));
                     configDetails = FetchPipelineConfig(configServerAddress, checkResults);
-                    if (checkResults.size() > 0) {
-                        UpdateRemoteConfig(checkResults, configDetails);
-                    } else
-                        configServerAddress = AppConfig::GetInstance()->GetOneConfigServerAddress(true);
+                    if (UpdateRemoteConfig(checkResults, configDetails) > 0) {
+                        rapidCheckTimes = INT32_FLAG(config_server_rapid_check_times);
+                    }
                 } else
                     configServerAddress = AppConfig::GetInstance()->GetOneConfigServerAddress(true);
             }
@@ -316,6 +323,10 @@ google::protobuf::RepeatedPtrField<configserver::proto::ConfigDetail> ConfigMana
             info->set_context(requestConfigs[i].context());
         }
     }
+    if (configInfos.empty()) {
+        // Only deleted configs, nothing to fetch.
+        return google::protobuf::RepeatedPtrField<configserver::proto::ConfigDetail>();
+    }
     fetchConfigReq.mutable_req_configs()->MergeFrom(configInfos);
 
     string operation = sdk::CONFIGSERVERAGENT;
@@ -361,7 +372,7 @@ google::protobuf::RepeatedPtrField<configserver::proto::ConfigDetail> ConfigMana
     }
 }
 
-void ConfigManager::UpdateRemoteConfig(
+int32_t ConfigManager::UpdateRemoteConfig(
     const google::protobuf::RepeatedPtrField<configserver::proto::ConfigCheckResult>& checkResults,
     const google::protobuf::RepeatedPtrField<configserver::proto::ConfigDetail>& configDetails) {
     static string serverConfigDirPath = AppConfig::GetInstance()->GetRemoteUserYamlConfigDirPath();
@@ -371,48 +382,54 @@ void ConfigManager::UpdateRemoteConfig(
         if (!res) {
             LOG_ERROR(sLogger, ("create remote config directory failed", serverConfigDirPath));
             AppConfig::GetInstance()->StopUsingConfigServer();
-            return;
+            return 0;
         }
     }
 
+    unordered_map<string, const configserver::proto::ConfigDetail*> detailMap;
+    for (int j = 0; j < configDetails.size(); j++) {
+        detailMap[configDetails[j].name()] = &configDetails[j];
+    }
+    int32_t updateCount = 0;
     string configName, oldConfigPath, newConfigPath;
-    ofstream newConfig;
-    configserver::proto::ConfigDetail configDetail;
-
-    for (int i = 0; i < checkResults.size(); i++) {    
-        configName = checkResults[i].name();
-
-        if (configserver::proto::NEW != checkResults[i].check_status()) {
-            oldConfigPath = serverConfigDirPath + configName + "@" + to_string(checkResults[i].old_version()) + ".yaml";
+    for (int i = 0; i < checkResults.size(); i++) {
+        const configserver::proto::ConfigCheckResult& checkResult = checkResults[i];
+        configName = checkResult.name();
+        oldConfigPath = serverConfigDirPath + configName + "@" + to_string(checkResult.old_version()) + ".yaml";
+        newConfigPath = serverConfigDirPath + configName + "@" + to_string(checkResult.new_version()) + ".yaml";
+        if (configserver::proto::DELETED == checkResult.check_status()) {
+            remove(oldConfigPath.c_str());
+            ++updateCount;
+            continue;
         }
-        if (configserver::proto::DELETED != checkResults[i].check_status()) {
-            for (int j = 0; j < configDetails.size(); j++)
-                if (configDetails[j].name() == configName) {
-                    configDetail = configDetails[j];
-                    break;
-                }
+        if (configserver::proto::NEW != checkResult.check_status()
+            && configserver::proto::MODIFIED != checkResult.check_status()) {
+            continue;
+        }
+        auto iter = detailMap.find(configName);
+        if (iter == detailMap.end()) {
+            // Keep the old version, the change is reported again by next heartbeat.
+            LOG_WARNING(sLogger, ("config detail not fetched", configName)("version", checkResult.new_version()));
+            continue;
         }
-        newConfigPath = serverConfigDirPath + configName + "@" + to_string(checkResults[i].new_version()) + ".yaml";
-
-        switch (checkResults[i].check_status()) {
-            case configserver::proto::DELETED:
-                remove(oldConfigPath.c_str());
-                break;
-            case configserver::proto::MODIFIED:
-                remove(oldConfigPath.c_str());
-                newConfig.open(newConfigPath.c_str(), ios::out);
-                newConfig << configDetail.detail();
-                newConfig.close();
-                break;
-            case configserver::proto::NEW:
-                newConfig.open(newConfigPath.c_str(), ios::out);
-                newConfig << configDetail.detail();
-                newConfig.close();
-                break;
-            default:
-                break;
+        // The new version is complete before the old one is removed, so the config is never missing when config
+        // dir is scanned, the larger version is used if both exist.
+        string tmpConfigPath = newConfigPath + ".tmp";
+        if (!OverwriteFile(tmpConfigPath, iter->second->detail())
+            || rename(tmpConfigPath.c_str(), newConfigPath.c_str()) != 0) {
+            LOG_WARNING(sLogger, ("write remote config failed", newConfigPath)("errno", errno));
+            remove(tmpConfigPath.c_str());
+            continue;
         }
+        if (configserver::proto::MODIFIED == checkResult.check_status()) {
+            remove(oldConfigPath.c_str());
+        }
+        ++updateCount;
+    }
+    if (updateCount > 0) {
+        LOG_INFO(sLogger, ("update remote configs", updateCount)("check results", checkResults.size()));
     }
+    return updateCount;
 }
 
 } // namespace logtail
@@ -86,7 +86,8 @@ private:
         const google::protobuf::RepeatedPtrField<configserver::proto::ConfigCheckResult>& requestConfigs
     );
     
-    void UpdateRemoteConfig(
+    // UpdateRemoteConfig writes changed configs to remote yaml config dir, returns the count of configs changed.
+    int32_t UpdateRemoteConfig(
         const google::protobuf::RepeatedPtrField<configserver::proto::ConfigCheckResult>& checkResults,
         const google::protobuf::RepeatedPtrField<configserver::proto::ConfigDetail>& configDetails
     );
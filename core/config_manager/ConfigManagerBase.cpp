@@ -29,6 +29,7 @@
 #include <set>
 #include <vector>
 #include <fstream>
+#include <thread>
 #include "common/util.h"
 #include "common/JsonUtil.h"
 #include "common/HashUtil.h"
@@ -42,6 +43,8 @@
 #include "common/StringTools.h"
 #include "common/GlobalPara.h"
 #include "common/version.h"
+#include "common/RegexCache.h"
+#include "common/StartupTimeline.h"
 #include "config/UserLogConfigParser.h"
 #include "profiler/LogtailAlarm.h"
 #include "profiler/LogFileProfiler.h"
@@ -53,6 +56,7 @@
 #include "event_handler/EventHandler.h"
 #include "controller/EventDispatcher.h"
 #include "sender/Sender.h"
+#include "processor/ProcessPipeline.h"
 #include "processor/LogProcess.h"
 #include "processor/LogFilter.h"
 #include "ConfigManagerBase.h"
@@ -72,6 +76,7 @@ DEFINE_FLAG_INT32(request_access_key_interval, "control the frenquency of GetAcc
 DEFINE_FLAG_INT32(logtail_sys_conf_update_interval, "control the frenquency of load local machine conf, seconds", 60);
 DEFINE_FLAG_INT32(wildcard_max_sub_dir_count, "", 1000);
 DEFINE_FLAG_INT32(config_match_max_cache_size, "", 1000000);
+DEFINE_FLAG_BOOL(enable_config_path_index, "match files only against configs indexed by base path", false);
 DEFINE_FLAG_INT32(multi_config_alarm_interval, "second", 600);
 DECLARE_FLAG_INT32(delay_bytes_upperlimit);
 DECLARE_FLAG_BOOL(global_network_success);
@@ -84,6 +89,9 @@ DEFINE_FLAG_INT32(docker_config_update_interval, "interval between docker config
 DEFINE_FLAG_STRING(default_data_integrity_project, "default data integrity project", "data_integrity");
 DEFINE_FLAG_STRING(default_data_integrity_log_store, "default data integrity log store", "data_integrity");
 DEFINE_FLAG_INT32(default_data_integrity_time_pos, "default data integrity time pos", 0);
+DEFINE_FLAG_INT32(sensitive_word_cast_set_max_mem,
+                  "max memory of the automaton combining sensitive cast regexes of one key, bytes",
+                  32 * 1024 * 1024);
 DEFINE_FLAG_STRING(default_log_time_reg,
                    "default log time reg",
                    "([0-9]{4})-(0[0-9]{1}|1[0-2])-(0[0-9]{1}|[12][0-9]{1}|3[01]) "
@@ -99,6 +107,14 @@ DEFINE_FLAG_STRING(fuse_customized_config_name,
                    "name of specified config for fuse, should not be used by user",
                    "__FUSE_CUSTOMIZED_CONFIG__");
 DEFINE_FLAG_BOOL(logtail_config_update_enable, "", true);
+DEFINE_FLAG_INT32(config_load_thread_count, "threads to parse local config files", 4);
+DEFINE_FLAG_INT32(yaml_config_max_file_size, "bytes", 16 * 1024 * 1024);
+DEFINE_FLAG_INT32(config_register_sync_depth,
+                  "descendants deeper than it are registered in background, 0 means registering all at once",
+                  3);
+DEFINE_FLAG_INT32(config_register_hot_dir_interval,
+                  "dirs modified within it are registered before others in background, seconds",
+                  3600);
 
 DECLARE_FLAG_BOOL(rapid_retry_update_config);
 DECLARE_FLAG_BOOL(default_global_fuse_mode);
@@ -176,6 +192,38 @@ ParseConfResult ParseConfig(const std::string& configName, YAML::Node& yamlRoot)
     return CONFIG_OK;
 }
 
+// ParseYamlConfigContent is ParseConfig for yaml @content read from file.
+static ParseConfResult ParseYamlConfigContent(const std::string& content, YAML::Node& yamlRoot) {
+    try {
+        yamlRoot = YAML::Load(content);
+    } catch (const YAML::ParserException& e) {
+        LOG_WARNING(sLogger, ("parse yaml failed", e.what()));
+        return CONFIG_INVALID_FORMAT;
+    } catch (...) {
+        return CONFIG_INVALID_FORMAT;
+    }
+    return CONFIG_OK;
+}
+
+// ParallelRun calls @fn with 0 to @count - 1 by config_load_thread_count threads.
+static void ParallelRun(size_t count, const std::function<void(size_t)>& fn) {
+    std::atomic<size_t> next(0);
+    auto run = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+    size_t threadCount = std::min<size_t>(std::max(INT32_FLAG(config_load_thread_count), 1), count);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back(run);
+    }
+    run();
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
 // CheckLogType validate @logTypeStr and convert it to @logType if it's valid.
 bool ConfigManagerBase::CheckLogType(const string& logTypeStr, LogType& logType) {
     if (logTypeStr == "common_reg_log")
@@ -190,6 +238,8 @@ bool ConfigManagerBase::CheckLogType(const string& logTypeStr, LogType& logType)
         logType = JSON_LOG;
     else if (logTypeStr == "plugin")
         logType = PLUGIN_LOG;
+    else if (logTypeStr == "container_stdout_log")
+        logType = CONTAINER_STDOUT_LOG;
     else {
         LOG_ERROR(sLogger, ("not supported log type", logTypeStr));
         return false;
@@ -325,6 +375,8 @@ void ConfigManagerBase::UpdatePluginStats(const Json::Value& config) {
             processor = "processor_delimiter_accelerate";
         } else if (logType == "apsara_log") {
             processor = "processor_apsara_accelerate";
+        } else if (logType == "container_stdout_log") {
+            processor = "processor_container_stdout_accelerate";
         } else {
             processor = "processor_stream_accelerate";
         }
@@ -586,6 +638,16 @@ void ConfigManagerBase::LoadSingleUserConfig(const std::string& logName, const J
                                     rawLogFlag,
                                     "",
                                     discardUnmatch);
+                // Analyze log begin regex once, readers use the prefilter to skip continuation
+                // lines without running the full regex.
+                if (!logBeingReg.empty() && logBeingReg != ".*") {
+                    config->mLogBeginRegPrefilter = RegexPrefixFilter::Create(logBeingReg);
+                    if (config->mLogBeginRegPrefilter) {
+                        LOG_INFO(sLogger,
+                                 ("create log begin regex prefilter, config", logName)("regex", logBeingReg)(
+                                     "prefix length", config->mLogBeginRegPrefilter->GetPrefixLength()));
+                    }
+                }
 
                 // normal log file config can have plugin too
                 if (!pluginConfig.empty() && !pluginConfigJson.isNull()) {
@@ -651,6 +713,7 @@ void ConfigManagerBase::LoadSingleUserConfig(const std::string& logName, const J
                     DockerContainerPath containerPath;
                     containerPath.mContainerPath = realPath;
                     config->mDockerContainerPaths->push_back(containerPath);
+                    config->RebuildContainerPathIndex();
                 }
 
                 config->mTopicFormat = GetStringValue(value, "topic_format", "default");
@@ -752,6 +815,27 @@ void ConfigManagerBase::LoadSingleUserConfig(const std::string& logName, const J
                     // if mPriority is 0, try to delete high level queue
                     LogProcess::GetInstance()->DeletePriorityWithHoldOn(config->mLogstoreKey);
                 }
+                config->mProcessCpuQuota = 0;
+                if (value.isMember("process_cpu_quota") && value["process_cpu_quota"].isInt()) {
+                    config->mProcessCpuQuota = value["process_cpu_quota"].asInt();
+                    if (config->mProcessCpuQuota > 0) {
+                        LOG_INFO(sLogger,
+                                 ("set logstore process cpu quota, project", config->mProjectName)(
+                                     "logstore", config->mCategory)("percent", config->mProcessCpuQuota));
+                    }
+                }
+                LogProcess::GetInstance()->SetCpuQuotaWithHoldOn(config->mLogstoreKey, config->mProcessCpuQuota);
+                int32_t sendWeight = 1;
+                if (value.isMember("send_weight") && value["send_weight"].isInt()) {
+                    sendWeight = value["send_weight"].asInt();
+                    if (sendWeight <= 0) {
+                        LOG_ERROR(sLogger,
+                                  ("invalid config send weight, project", config->mProjectName)(
+                                      "logstore", config->mCategory)("weight", sendWeight));
+                        sendWeight = 1;
+                    }
+                }
+                Sender::Instance()->SetLogstoreScheduling(config->mLogstoreKey, sendWeight, config->mPriority);
 
                 if (value.isMember("sensitive_keys") && value["sensitive_keys"].isArray()) {
                     GetSensitiveKeys(value["sensitive_keys"], config);
@@ -962,6 +1046,7 @@ void ConfigManagerBase::LoadSingleUserConfig(const std::string& logName, const J
             config->mMarkOffsetFlag = isFuseMode || markOffsetFlag;
             mHaveFuseConfigFlag = mHaveFuseConfigFlag || isFuseMode;
             config->mCollectBackwardTillBootTime = collectBackwardTillBootTime;
+            config->mProcessPipeline = ProcessPipeline::Compile(*config);
 
             // time format should not be blank here
             if ((collectBackwardTillBootTime || dataIntegritySwitch) && config->mTimeFormat.empty()) {
@@ -974,10 +1059,18 @@ void ConfigManagerBase::LoadSingleUserConfig(const std::string& logName, const J
                 LOG_ERROR(sLogger,
                           ("duplicated config name, last will be deleted",
                            logName)("last", configIter->second->mBasePath)("new", config->mBasePath));
+                {
+                    ScopedSpinLock indexLock(mConfigPathIndexLock);
+                    mConfigPathIndex.Remove(configIter->second);
+                    mConfigPathIndex.Add(config);
+                }
+                ++mConfigGeneration;
                 delete configIter->second;
                 configIter->second = config;
             } else {
                 mNameConfigMap[logName] = config;
+                ScopedSpinLock indexLock(mConfigPathIndexLock);
+                mConfigPathIndex.Add(config);
             }
             InsertProject(config->mProjectName);
             InsertRegion(config->mRegion);
@@ -1062,7 +1155,7 @@ LogFilterRule* ConfigManagerBase::GetFilterFule(const Json::Value& filterKeys, c
     for (uint32_t i = 0; i < filterKeys.size(); i++) {
         try {
             rulePtr->FilterKeys.push_back(filterKeys[i].asString());
-            rulePtr->FilterRegs.push_back(boost::regex(filterRegs[i].asString()));
+            rulePtr->FilterRegs.push_back(*RegexCache::GetInstance()->Get(filterRegs[i].asString()));
         } catch (const exception& e) {
             LOG_WARNING(sLogger, ("The filter is invalid", e.what()));
             delete rulePtr;
@@ -1073,35 +1166,155 @@ LogFilterRule* ConfigManagerBase::GetFilterFule(const Json::Value& filterKeys, c
             throw;
         }
     }
+    rulePtr->CompileProgram();
     return rulePtr;
 }
 
+// CollectUserConfigs puts user configs in @jsonRoot into @configs, configs of the same names are overwritten.
+static void CollectUserConfigs(const Json::Value& jsonRoot, std::unordered_map<std::string, Json::Value>& configs) {
+    if (!jsonRoot.isObject() || !jsonRoot.isMember(USER_CONFIG_NODE) || !jsonRoot[USER_CONFIG_NODE].isObject())
+        return;
+    const Json::Value& metrics = jsonRoot[USER_CONFIG_NODE];
+    Json::Value::Members logNames = metrics.getMemberNames();
+    for (size_t index = 0; index < logNames.size(); index++) {
+        configs[logNames[index]] = metrics[logNames[index]];
+    }
+}
+
 bool ConfigManagerBase::LoadAllConfig() {
     ClearPluginStats();
+    mLoadedUserConfigs.clear();
     bool rst = true;
     rst &= LoadJsonConfig(GetConfigJson());
+    CollectUserConfigs(GetConfigJson(), mLoadedUserConfigs);
     LOG_DEBUG(sLogger, ("load remote server config", rst)("now config count", mNameConfigMap.size()));
     rst &= LoadJsonConfig(GetLocalConfigJson());
+    CollectUserConfigs(GetLocalConfigJson(), mLoadedUserConfigs);
     LOG_DEBUG(sLogger, ("load local config", rst)("now config count", mNameConfigMap.size()));
     for (auto iter = mLocalConfigDirMap.begin(); iter != mLocalConfigDirMap.end(); ++iter) {
         rst &= LoadJsonConfig(iter->second);
+        CollectUserConfigs(iter->second, mLoadedUserConfigs);
         LOG_DEBUG(
             sLogger,
             ("load local user_config.d config", rst)("file", iter->first)("now config count", mNameConfigMap.size()));
     }
     for (auto iter = mYamlConfigDirMap.begin(); iter != mYamlConfigDirMap.end(); ++iter) {
-        Json::Value userLocalJsonConfig;
-        std::string fileName = iter->first;
-        if (ConfigYamlToJson::GetInstance()->GenerateLocalJsonConfig(fileName, iter->second, userLocalJsonConfig)) {
-            rst &= LoadJsonConfig(userLocalJsonConfig);
-            LOG_INFO(
-                sLogger,
-                ("load user_yaml_config.d config", rst)("file", fileName)("now config count", mNameConfigMap.size()));
+        if (iter->second.mValid) {
+            rst &= LoadJsonConfig(iter->second.mJsonConfig);
+            CollectUserConfigs(iter->second.mJsonConfig, mLoadedUserConfigs);
+            LOG_INFO(sLogger,
+                     ("load user_yaml_config.d config", rst)("file", iter->first)("now config count",
+                                                                                  mNameConfigMap.size()));
         }
     }
     return rst;
 }
 
+void ConfigManagerBase::GetAllUserConfigs(std::unordered_map<std::string, Json::Value>& configs) {
+    CollectUserConfigs(GetConfigJson(), configs);
+    CollectUserConfigs(GetLocalConfigJson(), configs);
+    for (auto iter = mLocalConfigDirMap.begin(); iter != mLocalConfigDirMap.end(); ++iter) {
+        CollectUserConfigs(iter->second, configs);
+    }
+    for (auto iter = mYamlConfigDirMap.begin(); iter != mYamlConfigDirMap.end(); ++iter) {
+        if (iter->second.mValid) {
+            CollectUserConfigs(iter->second.mJsonConfig, configs);
+        }
+    }
+}
+
+bool ConfigManagerBase::GetChangedConfigs(const std::unordered_map<std::string, Json::Value>& configs,
+                                          std::unordered_set<std::string>& changedNames) {
+    // Customized fuse config and mapping paths are generated from all configs.
+    if (HaveFuseConfig() || mHaveMappingPathConfig) {
+        return false;
+    }
+    for (auto iter = mLoadedUserConfigs.begin(); iter != mLoadedUserConfigs.end(); ++iter) {
+        auto newIter = configs.find(iter->first);
+        if (newIter == configs.end() || newIter->second != iter->second) {
+            changedNames.insert(iter->first);
+        }
+    }
+    for (auto iter = configs.begin(); iter != configs.end(); ++iter) {
+        if (mLoadedUserConfigs.find(iter->first) == mLoadedUserConfigs.end()) {
+            changedNames.insert(iter->first);
+        }
+    }
+    return true;
+}
+
+bool ConfigManagerBase::IsPluginConfigChanged(const std::unordered_map<std::string, Json::Value>& configs,
+                                              const std::unordered_set<std::string>& changedNames) {
+    for (auto iter = changedNames.begin(); iter != changedNames.end(); ++iter) {
+        Config* config = FindConfigByName(*iter);
+        if (config != NULL && (config->mLogType == PLUGIN_LOG || config->mPluginProcessFlag)) {
+            return true;
+        }
+        auto newIter = configs.find(*iter);
+        if (newIter == configs.end()) {
+            continue;
+        }
+        const Json::Value& value = newIter->second;
+        if (value.isMember("plugin") || GetStringValue(value, "log_type", "plugin") == "plugin") {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ConfigManagerBase::LoadChangedConfigs(const std::unordered_map<std::string, Json::Value>& configs,
+                                           const std::unordered_set<std::string>& changedNames) {
+    mAllDockerContainerPathMap.clear();
+    for (auto iter = changedNames.begin(); iter != changedNames.end(); ++iter) {
+        auto configIter = mNameConfigMap.find(*iter);
+        if (configIter == mNameConfigMap.end()) {
+            continue;
+        }
+        Config* config = configIter->second;
+        {
+            // Keep container paths for LoadSingleUserConfig as RemoveAllConfigs does.
+            PTScopedLock guard(mDockerContainerPathCmdLock);
+            if (config->mDockerContainerPaths) {
+                mAllDockerContainerPathMap[*iter] = config->mDockerContainerPaths;
+            }
+        }
+        {
+            ScopedSpinLock indexLock(mConfigPathIndexLock);
+            mConfigPathIndex.Remove(config);
+        }
+        ++mConfigGeneration;
+        delete config;
+        mNameConfigMap.erase(configIter);
+    }
+    ClearProjects();
+    ClearRegions();
+    for (auto iter = mNameConfigMap.begin(); iter != mNameConfigMap.end(); ++iter) {
+        InsertProject(iter->second->mProjectName);
+        InsertRegion(iter->second->mRegion);
+    }
+    for (auto iter = changedNames.begin(); iter != changedNames.end(); ++iter) {
+        auto newIter = configs.find(*iter);
+        if (newIter != configs.end()) {
+            LoadSingleUserConfig(newIter->first, newIter->second);
+        }
+    }
+    if (HaveFuseConfig()) {
+        CreateCustomizedFuseConfig();
+    }
+    ClearPluginStats();
+    for (auto iter = mNameConfigMap.begin(); iter != mNameConfigMap.end(); ++iter) {
+        auto newIter = configs.find(iter->first);
+        if (newIter != configs.end()) {
+            UpdatePluginStats(newIter->second);
+        }
+    }
+    mCacheFileConfigMap.Invalidate();
+    mCacheFileAllConfigMap.Invalidate();
+    ClearPendingRegisterDirs();
+    mLoadedUserConfigs = configs;
+    LOG_INFO(sLogger, ("load changed configs", changedNames.size())("now config count", mNameConfigMap.size()));
+}
+
 // LoadConfig constructs Config objects accroding to @jsonRoot.
 // This function is called by EventDispatcher's Dispatch thread (main thread).
 // It will iterate all log configs in @jsonRoot[USER_CONFIG_NODE], then call
@@ -1169,7 +1382,9 @@ bool ConfigManagerBase::RegisterHandlersRecursively(const std::string& path, Con
     return result;
 }
 
-ConfigManagerBase::ConfigManagerBase() {
+ConfigManagerBase::ConfigManagerBase()
+    : mCacheFileConfigMap(INT32_FLAG(config_match_max_cache_size)),
+      mCacheFileAllConfigMap(INT32_FLAG(config_match_max_cache_size)) {
     mEnvFlag = false;
     mStartTime = time(NULL);
     mRemoveConfigFlag = false;
@@ -1478,8 +1693,10 @@ bool ConfigManagerBase::RegisterHandlersWithinDepth(const std::string& path, Con
             if (!(EventDispatcher::GetInstance()->RegisterEventHandler(item.c_str(), config, mSharedHandler))) {
                 // break;// fail early, do not try to register others
                 result = false;
-            } else // sub dir will not be registered if parent dir fails
+            } else if (!DeferRegistration(item, config, depth - 1, false)) {
+                // sub dir will not be registered if parent dir fails
                 RegisterHandlersWithinDepth(item, config, depth - 1);
+            }
         }
     }
 
@@ -1509,13 +1726,82 @@ bool ConfigManagerBase::RegisterDescendants(const string& path, Config* config,
         string item = PathJoin(path, ent.Name());
         if (ent.IsDir() && MatchDirPattern(config, item)) {
             result = EventDispatcher::GetInstance()->RegisterEventHandler(item.c_str(), config, mSharedHandler);
-            if (result)
+            if (result && !DeferRegistration(item, config, withinDepth - 1, true))
                 RegisterDescendants(item, config, withinDepth - 1);
         }
     }
     return result;
 }
 
+bool ConfigManagerBase::DeferRegistration(const std::string& path, Config* config, int remainingDepth, bool preserve) {
+    if (INT32_FLAG(config_register_sync_depth) <= 0 || remainingDepth <= 0) {
+        return false;
+    }
+    int32_t depth = (preserve ? (config->mMaxDepth < 0 ? 100 : config->mMaxDepth) : config->mPreserveDepth)
+        - remainingDepth;
+    if (depth < INT32_FLAG(config_register_sync_depth)) {
+        return false;
+    }
+    PendingRegisterDir dir;
+    dir.mPath = path;
+    dir.mConfigName = config->mConfigName;
+    dir.mDepth = depth;
+    dir.mRemainingDepth = remainingDepth;
+    dir.mPreserve = preserve;
+    fsutil::PathStat buf;
+    if (fsutil::PathStat::stat(path, buf)) {
+        dir.mModifyTime = buf.GetMtime();
+    }
+    dir.mCold = time(NULL) - dir.mModifyTime > INT32_FLAG(config_register_hot_dir_interval);
+
+    PTScopedLock lock(mPendingRegisterDirsLock);
+    // The same dir is queued again by periodical RegisterHandlers before it is registered.
+    if (mPendingRegisterDirKeys.insert(dir.mConfigName + "#" + path).second) {
+        mPendingRegisterDirs.push(dir);
+        mHasPendingRegisterDirs = true;
+    }
+    return true;
+}
+
+void ConfigManagerBase::RegisterPendingDirs(int32_t timeBudgetMs) {
+    if (!mHasPendingRegisterDirs) {
+        return;
+    }
+    uint64_t beginTime = GetCurrentTimeInMilliSeconds();
+    int32_t count = 0;
+    while (GetCurrentTimeInMilliSeconds() - beginTime < (uint64_t)timeBudgetMs) {
+        PendingRegisterDir dir;
+        {
+            PTScopedLock lock(mPendingRegisterDirsLock);
+            if (mPendingRegisterDirs.empty()) {
+                mHasPendingRegisterDirs = false;
+                break;
+            }
+            dir = mPendingRegisterDirs.top();
+            mPendingRegisterDirs.pop();
+            mPendingRegisterDirKeys.erase(dir.mConfigName + "#" + dir.mPath);
+        }
+        // The config may be removed, or the dir may be deleted after it is queued.
+        Config* config = FindConfigByName(dir.mConfigName);
+        if (config == NULL || !EventDispatcher::GetInstance()->IsRegistered(dir.mPath.c_str())) {
+            continue;
+        }
+        if (dir.mPreserve)
+            RegisterDescendants(dir.mPath, config, dir.mRemainingDepth);
+        else
+            RegisterHandlersWithinDepth(dir.mPath, config, dir.mRemainingDepth);
+        ++count;
+    }
+    LOG_DEBUG(sLogger, ("register pending dirs", count)("time(ms)", GetCurrentTimeInMilliSeconds() - beginTime));
+}
+
+void ConfigManagerBase::ClearPendingRegisterDirs() {
+    PTScopedLock lock(mPendingRegisterDirsLock);
+    mPendingRegisterDirs = decltype(mPendingRegisterDirs)();
+    mPendingRegisterDirKeys.clear();
+    mHasPendingRegisterDirs = false;
+}
+
 Config* ConfigManagerBase::FindStreamLogTagMatch(const std::string& tag) {
     for (unordered_map<string, Config*>::iterator it = mNameConfigMap.begin(); it != mNameConfigMap.end(); ++it) {
         if (it->second->mLogType == STREAM_LOG && it->second->mStreamLogTag == tag) {
@@ -1531,50 +1817,41 @@ void ConfigManagerBase::ClearConfigMatchCache() {
     static int32_t s_lastClearAllTime = (int32_t)time(NULL) - rand() % 600;
     int32_t curTime = (int32_t)time(NULL);
 
-    ScopedSpinLock cachedLock(mCacheFileConfigMapLock);
-    if (curTime - s_lastClearTime > FORCE_CLEAR_INTERVAL
-        || mCacheFileConfigMap.size() > (size_t)INT32_FLAG(config_match_max_cache_size)) {
+    // Caches are bounded by config_match_max_cache_size, only expire them periodically.
+    if (curTime - s_lastClearTime > FORCE_CLEAR_INTERVAL) {
         s_lastClearTime = curTime;
-        mCacheFileConfigMap.clear();
+        mCacheFileConfigMap.Invalidate();
     }
-
-    ScopedSpinLock allCachedLock(mCacheFileAllConfigMapLock);
-    if (curTime - s_lastClearAllTime > FORCE_CLEAR_INTERVAL
-        || mCacheFileAllConfigMap.size() > (size_t)INT32_FLAG(config_match_max_cache_size)) {
+    if (curTime - s_lastClearAllTime > FORCE_CLEAR_INTERVAL) {
         s_lastClearAllTime = curTime;
-        mCacheFileAllConfigMap.clear();
+        mCacheFileAllConfigMap.Invalidate();
     }
 }
 
 Config* ConfigManagerBase::FindBestMatch(const string& path, const string& name) {
-    string cachedFileKey(path);
-    cachedFileKey.push_back('<');
-    cachedFileKey.append(name);
     bool acceptMultiConfig = AppConfig::GetInstance()->IsAcceptMultiConfig();
     {
-        ScopedSpinLock cachedLock(mCacheFileConfigMapLock);
-        std::unordered_map<string, std::pair<Config*, int32_t>>::iterator iter
-            = mCacheFileConfigMap.find(cachedFileKey);
-        if (iter != mCacheFileConfigMap.end()) {
+        std::pair<Config*, int32_t> cached;
+        if (mCacheFileConfigMap.Get(path, name, cached)) {
             // if need report alarm, do not return, just continue to find all match and send alarm
-            if (acceptMultiConfig || iter->second.second == 0
-                || time(NULL) - iter->second.second < INT32_FLAG(multi_config_alarm_interval)) {
-                return iter->second.first;
+            if (acceptMultiConfig || cached.second == 0
+                || time(NULL) - cached.second < INT32_FLAG(multi_config_alarm_interval)) {
+                return cached.first;
             }
         }
     }
-    unordered_map<string, Config*>::iterator itr = mNameConfigMap.begin();
     Config* prevMatch = NULL;
     size_t prevLen = 0;
     size_t curLen = 0;
     uint32_t nameRepeat = 0;
     string logNameList;
     vector<Config*> multiConfigs;
-    for (; itr != mNameConfigMap.end(); ++itr) {
-        Config* config = itr->second;
+    vector<Config*> candidates;
+    GetMatchCandidates(path, name, candidates);
+    for (Config* config : candidates) {
         if (config->mLogType != STREAM_LOG && config->mLogType != PLUGIN_LOG) {
             // exclude __FUSE_CONFIG__
-            if (itr->first == STRING_FLAG(fuse_customized_config_name)) {
+            if (config->mConfigName == STRING_FLAG(fuse_customized_config_name)) {
                 continue;
             }
 
@@ -1621,12 +1898,9 @@ Config* ConfigManagerBase::FindBestMatch(const string& path, const string& name)
                 (*iter)->mRegion);
         }
     }
-    {
-        ScopedSpinLock cachedLock(mCacheFileConfigMapLock);
-        // use operator [], force update time
-        mCacheFileConfigMap[cachedFileKey]
-            = std::make_pair(prevMatch, nameRepeat > 1 && !name.empty() ? (int32_t)time(NULL) : (int32_t)0);
-    }
+    // force update time
+    mCacheFileConfigMap.Put(
+        path, name, std::make_pair(prevMatch, nameRepeat > 1 && !name.empty() ? (int32_t)time(NULL) : (int32_t)0));
     return prevMatch;
 }
 
@@ -1634,34 +1908,29 @@ Config* ConfigManagerBase::FindBestMatch(const string& path, const string& name)
 int32_t
 ConfigManagerBase::FindAllMatch(vector<Config*>& allConfig, const std::string& path, const std::string& name /*= ""*/) {
     static AppConfig* appConfig = AppConfig::GetInstance();
-    string cachedFileKey(path);
-    cachedFileKey.push_back('<');
-    cachedFileKey.append(name);
     const int32_t maxMultiConfigSize = appConfig->GetMaxMultiConfigSize();
     {
-        ScopedSpinLock cachedLock(mCacheFileAllConfigMapLock);
-        auto iter = mCacheFileAllConfigMap.find(cachedFileKey);
-        if (iter != mCacheFileAllConfigMap.end()) {
-            if (iter->second.second == 0
-                || time(NULL) - iter->second.second < INT32_FLAG(multi_config_alarm_interval)) {
-                allConfig = iter->second.first;
+        std::pair<std::vector<Config*>, int32_t> cached;
+        if (mCacheFileAllConfigMap.Get(path, name, cached)) {
+            if (cached.second == 0 || time(NULL) - cached.second < INT32_FLAG(multi_config_alarm_interval)) {
+                allConfig = std::move(cached.first);
                 return (int32_t)allConfig.size();
             }
         }
     }
     bool alarmFlag = false;
-    unordered_map<string, Config*>::iterator itr = mNameConfigMap.begin();
-    for (; itr != mNameConfigMap.end(); ++itr) {
-        Config* config = itr->second;
+    vector<Config*> candidates;
+    GetMatchCandidates(path, name, candidates);
+    for (Config* config : candidates) {
         if (config->mLogType != STREAM_LOG && config->mLogType != PLUGIN_LOG) {
             // exclude __FUSE_CONFIG__
-            if (itr->first == STRING_FLAG(fuse_customized_config_name)) {
+            if (config->mConfigName == STRING_FLAG(fuse_customized_config_name)) {
                 continue;
             }
 
             bool match = config->IsMatch(path, name);
             if (match) {
-                allConfig.push_back(itr->second);
+                allConfig.push_back(config);
             }
         }
     }
@@ -1673,32 +1942,23 @@ ConfigManagerBase::FindAllMatch(vector<Config*>& allConfig, const std::string& p
         SendAllMatchAlarm(path, name, allConfig, maxMultiConfigSize);
         allConfig.resize(maxMultiConfigSize);
     }
-    {
-        ScopedSpinLock cachedLock(mCacheFileAllConfigMapLock);
-        // use operator [], force update time
-        mCacheFileAllConfigMap[cachedFileKey] = std::make_pair(allConfig, alarmFlag ? (int32_t)time(NULL) : (int32_t)0);
-    }
+    // force update time
+    mCacheFileAllConfigMap.Put(path, name, std::make_pair(allConfig, alarmFlag ? (int32_t)time(NULL) : (int32_t)0));
     return (int32_t)allConfig.size();
 }
 
 int32_t
 ConfigManagerBase::FindMatchWithForceFlag(std::vector<Config*>& allConfig, const string& path, const string& name) {
     const bool acceptMultiConfig = AppConfig::GetInstance()->IsAcceptMultiConfig();
-    string cachedFileKey(path);
-    cachedFileKey.push_back('<');
-    cachedFileKey.append(name);
     {
-        ScopedSpinLock cachedLock(mCacheFileAllConfigMapLock);
-        auto iter = mCacheFileAllConfigMap.find(cachedFileKey);
-        if (iter != mCacheFileAllConfigMap.end()) {
-            if (iter->second.second == 0
-                || time(NULL) - iter->second.second < INT32_FLAG(multi_config_alarm_interval)) {
-                allConfig = iter->second.first;
+        std::pair<std::vector<Config*>, int32_t> cached;
+        if (mCacheFileAllConfigMap.Get(path, name, cached)) {
+            if (cached.second == 0 || time(NULL) - cached.second < INT32_FLAG(multi_config_alarm_interval)) {
+                allConfig = std::move(cached.first);
                 return (int32_t)allConfig.size();
             }
         }
     }
-    auto itr = mNameConfigMap.begin();
     Config* prevMatch = NULL;
     size_t prevLen = 0;
     int32_t preCreateTime = INT_MAX;
@@ -1706,11 +1966,12 @@ ConfigManagerBase::FindMatchWithForceFlag(std::vector<Config*>& allConfig, const
     uint32_t nameRepeat = 0;
     string logNameList;
     vector<Config*> multiConfigs;
-    for (; itr != mNameConfigMap.end(); ++itr) {
-        Config* config = itr->second;
+    vector<Config*> candidates;
+    GetMatchCandidates(path, name, candidates);
+    for (Config* config : candidates) {
         if (config->mLogType != STREAM_LOG && config->mLogType != PLUGIN_LOG) {
             // exclude __FUSE_CONFIG__
-            if (itr->first == STRING_FLAG(fuse_customized_config_name)) {
+            if (config->mConfigName == STRING_FLAG(fuse_customized_config_name)) {
                 continue;
             }
 
@@ -1769,14 +2030,32 @@ ConfigManagerBase::FindMatchWithForceFlag(std::vector<Config*>& allConfig, const
     if (prevMatch != NULL) {
         allConfig.push_back(prevMatch);
     }
-    {
-        ScopedSpinLock cachedLock(mCacheFileAllConfigMapLock);
-        // use operator [], force update time
-        mCacheFileAllConfigMap[cachedFileKey] = std::make_pair(allConfig, alarmFlag ? (int32_t)time(NULL) : (int32_t)0);
-    }
+    // force update time
+    mCacheFileAllConfigMap.Put(path, name, std::make_pair(allConfig, alarmFlag ? (int32_t)time(NULL) : (int32_t)0));
     return (int32_t)allConfig.size();
 }
 
+void ConfigManagerBase::GetMatchCandidates(const std::string& path,
+                                           const std::string& name,
+                                           std::vector<Config*>& candidates) {
+    if (BOOL_FLAG(enable_config_path_index)) {
+        ScopedSpinLock indexLock(mConfigPathIndexLock);
+        // Configs may be put into mNameConfigMap directly, rebuild the index if it is out of sync.
+        if (mConfigPathIndex.Size() != mNameConfigMap.size()) {
+            mConfigPathIndex.Clear();
+            for (auto& item : mNameConfigMap) {
+                mConfigPathIndex.Add(item.second);
+            }
+        }
+        mConfigPathIndex.GetCandidates(path, name, candidates);
+        return;
+    }
+    candidates.reserve(mNameConfigMap.size());
+    for (auto& item : mNameConfigMap) {
+        candidates.push_back(item.second);
+    }
+}
+
 void ConfigManagerBase::SendAllMatchAlarm(const string& path,
                                           const string& name,
                                           vector<Config*>& allConfig,
@@ -1814,6 +2093,7 @@ Config* ConfigManagerBase::FindConfigByName(const std::string& configName) {
 
 void ConfigManagerBase::RemoveAllConfigs() {
     mAllDockerContainerPathMap.clear();
+    ++mConfigGeneration;
 
     // Save all configs' container path map into mAllDockerContainerPathMap for later reload.
     {
@@ -1827,10 +2107,13 @@ void ConfigManagerBase::RemoveAllConfigs() {
     }
 
     mNameConfigMap.clear();
-    ScopedSpinLock lock(mCacheFileConfigMapLock);
-    mCacheFileConfigMap.clear();
-    ScopedSpinLock allLock(mCacheFileAllConfigMapLock);
-    mCacheFileAllConfigMap.clear();
+    {
+        ScopedSpinLock indexLock(mConfigPathIndexLock);
+        mConfigPathIndex.Clear();
+    }
+    ClearPendingRegisterDirs();
+    mCacheFileConfigMap.Invalidate();
+    mCacheFileAllConfigMap.Invalidate();
     ClearProjects();
     ClearRegions();
     ClearRegionAliuidMap();
@@ -2305,6 +2588,34 @@ void ConfigManagerBase::GetSensitiveKeys(const Json::Value& value, Config* pConf
             // throw ExceptionBase(string("The sensitive key config is invalid, config : ") + pConfig->mConfigName);
         }
     }
+    CompileSensitiveWordCastSets(pConfig);
+}
+
+void ConfigManagerBase::CompileSensitiveWordCastSets(Config* pConfig) {
+    pConfig->mSensitiveWordCastSets.clear();
+    for (const auto& item : pConfig->mSensitiveWordCastOptions) {
+        // One regex is scanned once anyway.
+        if (item.second.size() < 2) {
+            continue;
+        }
+        RE2::Options options;
+        options.set_max_mem(INT32_FLAG(sensitive_word_cast_set_max_mem));
+        std::shared_ptr<re2::RE2::Set> regexSet(new re2::RE2::Set(options, RE2::UNANCHORED));
+        bool added = true;
+        for (const SensitiveWordCastOption& opt : item.second) {
+            if (regexSet->Add(opt.mRegex->pattern(), NULL) < 0) {
+                added = false;
+                break;
+            }
+        }
+        if (!added || !regexSet->Compile()) {
+            LOG_WARNING(sLogger,
+                        ("compile sensitive cast options of key into one automaton failed, key", item.first)(
+                            "config", pConfig->mConfigName));
+            continue;
+        }
+        pConfig->mSensitiveWordCastSets[item.first] = regexSet;
+    }
 }
 
 bool ConfigManagerBase::GetLocalConfigUpdate() {
@@ -2414,10 +2725,12 @@ bool ConfigManagerBase::GetLocalConfigDirUpdate() {
 
     std::sort(v.begin(), v.end());
     std::unordered_map<std::string, Json::Value> localConfigDirMap;
+    std::vector<Json::Value> subConfJsons(v.size());
+    std::vector<ParseConfResult> results(v.size());
+    ParallelRun(v.size(), [&](size_t i) { results[i] = ParseConfig(v[i], subConfJsons[i]); });
     for (size_t i = 0; i < v.size(); i++) {
-        Json::Value subConfJson;
-        ParseConfResult res = ParseConfig(v[i], subConfJson);
-        if (res == CONFIG_OK) {
+        const Json::Value& subConfJson = subConfJsons[i];
+        if (results[i] == CONFIG_OK) {
             auto iter = mLocalConfigDirMap.find(v[i]);
             if (iter == mLocalConfigDirMap.end() || iter->second != subConfJson) {
                 updateFlag = true;
@@ -2458,18 +2771,43 @@ bool ConfigManagerBase::GetYamlConfigDirUpdate() {
 
     if (updateFlag) {
         std::sort(filepathes.begin(), filepathes.end());
-        std::unordered_map<std::string, YAML::Node> configDirMap;
+        // Files are parsed and converted to json only if their content changes.
+        std::unordered_map<std::string, YamlConfigItem> configDirMap;
+        std::vector<YamlConfigItem> items(filepathes.size());
+        std::vector<YAML::Node> subConfYamls(filepathes.size());
+        std::vector<ParseConfResult> results(filepathes.size(), CONFIG_NOT_EXIST);
+        std::vector<char> reused(filepathes.size(), false); // not vector<bool>, threads set adjacent elements
+        ParallelRun(filepathes.size(), [&](size_t i) {
+            std::string content;
+            if (!ReadFileContent(filepathes[i], content, INT32_FLAG(yaml_config_max_file_size))) {
+                return;
+            }
+            items[i].mContentHash = HashString(content);
+            auto iter = mYamlConfigDirMap.find(filepathes[i]);
+            if (iter != mYamlConfigDirMap.end() && iter->second.mContentHash == items[i].mContentHash) {
+                items[i] = iter->second;
+                reused[i] = true;
+                results[i] = CONFIG_OK;
+                return;
+            }
+            results[i] = ParseYamlConfigContent(content, subConfYamls[i]);
+        });
+        size_t convertCount = 0;
         for (size_t i = 0; i < filepathes.size(); i++) {
-            YAML::Node subConfYaml;
-            ParseConfResult res = ParseConfig(filepathes[i], subConfYaml);
-            if (res == CONFIG_OK) {
-                LOG_INFO(sLogger, ("user yaml config file loaded", filepathes[i]));
-                configDirMap[filepathes[i]] = subConfYaml;
-            } else {
+            if (results[i] != CONFIG_OK) {
                 LOG_INFO(sLogger, ("invalid user yaml config file", filepathes[i]));
                 continue;
             }
+            if (!reused[i]) {
+                LOG_INFO(sLogger, ("user yaml config file loaded", filepathes[i]));
+                StartupPhaseScope phase("config_yaml_to_json");
+                items[i].mValid = ConfigYamlToJson::GetInstance()->GenerateLocalJsonConfig(
+                    filepathes[i], subConfYamls[i], items[i].mJsonConfig);
+                ++convertCount;
+            }
+            configDirMap[filepathes[i]] = items[i];
         }
+        LOG_INFO(sLogger, ("user yaml config files", filepathes.size())("converted", convertCount));
         if (mYamlConfigDirMap.size() != configDirMap.size()) {
             LOG_INFO(sLogger,
                      ("user yaml config removed or added, last", mYamlConfigDirMap.size())("now", configDirMap.size()));
@@ -2872,17 +3210,12 @@ void ConfigManagerBase::GetContainerStoppedEvents(std::vector<Event*>& eventVec)
         if (!DockerContainerPath::ParseByJSONStr(cmd->mParams, dockerContainerPath)) {
             continue;
         }
-        std::vector<DockerContainerPath>::iterator iter = config->mDockerContainerPaths->begin();
-        std::vector<DockerContainerPath>::iterator iend = config->mDockerContainerPaths->end();
-        for (; iter != iend; ++iter) {
-            if (iter->mContainerID == dockerContainerPath.mContainerID) {
-                break;
-            }
-        }
-        if (iter == iend) {
+        DockerContainerPath* containerPath = config->GetContainerPathByID(dockerContainerPath.mContainerID);
+        if (containerPath == NULL) {
             continue;
         }
-        Event* pStoppedEvent = new Event(iter->mContainerPath, "", EVENT_ISDIR | EVENT_CONTAINER_STOPPED, -1, 0);
+        Event* pStoppedEvent
+            = new Event(containerPath->mContainerPath, "", EVENT_ISDIR | EVENT_CONTAINER_STOPPED, -1, 0);
         LOG_DEBUG(
             sLogger,
             ("GetContainerStoppedEvent Type", pStoppedEvent->GetType())("Source", pStoppedEvent->GetSource())(
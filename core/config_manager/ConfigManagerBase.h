@@ -22,14 +22,17 @@
 #include <unordered_set>
 #include <functional>
 #include <atomic>
+#include <queue>
 #include <json/json.h>
 #include <yaml-cpp/yaml.h>
 #include "common/LogtailCommonFlags.h"
 #include "common/MemoryBarrier.h"
 #include "common/LogstoreFeedbackQueue.h"
 #include "config/Config.h"
+#include "config/ConfigPathIndex.h"
 #include "common/MemoryBarrier.h"
 #include "common/Lock.h"
+#include "common/ShardedClockCache.h"
 #include "common/Thread.h"
 #include "event/Event.h"
 #include "sdk/Common.h"
@@ -86,7 +89,13 @@ protected:
     Json::Value mLocalConfigJson;
     Json::Value mFileTagsJson;
     std::unordered_map<std::string, Json::Value> mLocalConfigDirMap;
-    std::unordered_map<std::string, YAML::Node> mYamlConfigDirMap;
+    // A yaml config file and json converted from it, they are reused until the content hash changes.
+    struct YamlConfigItem {
+        int64_t mContentHash = 0;
+        bool mValid = false; // converted successfully
+        Json::Value mJsonConfig;
+    };
+    std::unordered_map<std::string, YamlConfigItem> mYamlConfigDirMap;
 
     std::unordered_map<std::string, int64_t> mServerYamlConfigVersionMap; // the key is config name
     std::unordered_map<std::string, int64_t> mYamlConfigMTimeMap; // the key is config name
@@ -94,6 +103,12 @@ protected:
     std::unordered_map<std::string, std::unordered_map<std::string, int>> mPluginStats;
 
     std::unordered_map<std::string, Config*> mNameConfigMap;
+    std::atomic<int64_t> mConfigGeneration{0};
+    // Raw json of user configs loaded last time, LoadChangedConfigs compares new configs with them.
+    std::unordered_map<std::string, Json::Value> mLoadedUserConfigs;
+    // Index of configs in mNameConfigMap by path, used by matching if enable_config_path_index is set.
+    ConfigPathIndex mConfigPathIndex;
+    SpinLock mConfigPathIndexLock;
     EventHandler* mSharedHandler;
     // one modify handler corresponds to one "leaf" directory
     std::unordered_map<std::string, EventHandler*> mDirEventHandlerMap;
@@ -151,12 +166,11 @@ protected:
     std::atomic_int mLastConfigUpdateTime{0};
     std::atomic_int mLastConfigGetTime{0};
 
-    SpinLock mCacheFileConfigMapLock;
+    // key : dir and file name of matching
     // value : best config, multi config last alarmTime, and if alarmTime is 0, it means no multi config
-    std::unordered_map<std::string, std::pair<Config*, int32_t>> mCacheFileConfigMap;
+    ShardedClockCache<std::pair<Config*, int32_t>> mCacheFileConfigMap;
 
-    SpinLock mCacheFileAllConfigMapLock;
-    std::unordered_map<std::string, std::pair<std::vector<Config*>, int32_t>> mCacheFileAllConfigMap;
+    ShardedClockCache<std::pair<std::vector<Config*>, int32_t>> mCacheFileAllConfigMap;
 
     PTMutex mDockerContainerPathCmdLock;
     std::vector<DockerContainerPathCmd*> mDockerContainerPathCmdVec;
@@ -181,6 +195,32 @@ protected:
     PTMutex mRegionAliuidMapLock;
     std::map<std::string, std::set<std::string>> mRegionAliuidMap;
 
+    // A directory whose descendants are registered in background, see RegisterPendingDirs.
+    struct PendingRegisterDir {
+        std::string mPath;
+        std::string mConfigName;
+        int32_t mDepth = 0; // depth from the base path
+        int32_t mRemainingDepth = 0; // depth argument of RegisterDescendants or RegisterHandlersWithinDepth
+        bool mPreserve = true; // registered by RegisterDescendants if true
+        bool mCold = false;
+        time_t mModifyTime = 0;
+    };
+    // Hot and shallow directories first, recently modified first among them.
+    struct PendingRegisterDirCompare {
+        bool operator()(const PendingRegisterDir& lhs, const PendingRegisterDir& rhs) const {
+            if (lhs.mCold != rhs.mCold)
+                return lhs.mCold;
+            if (lhs.mDepth != rhs.mDepth)
+                return lhs.mDepth > rhs.mDepth;
+            return lhs.mModifyTime < rhs.mModifyTime;
+        }
+    };
+    PTMutex mPendingRegisterDirsLock;
+    std::priority_queue<PendingRegisterDir, std::vector<PendingRegisterDir>, PendingRegisterDirCompare>
+        mPendingRegisterDirs;
+    std::unordered_set<std::string> mPendingRegisterDirKeys;
+    std::atomic_bool mHasPendingRegisterDirs{false};
+
     /**
      * @brief CreateCustomizedFuseConfig, call this after starting, insert it into config map
      * @return
@@ -248,11 +288,38 @@ public:
     void ClearPluginStats();
 
     bool LoadAllConfig();
+    /**
+     * @brief Collect raw json of all user configs, a config is overwritten by the one with same name in later source,
+     * as LoadAllConfig does.
+     */
+    void GetAllUserConfigs(std::unordered_map<std::string, Json::Value>& configs);
+    /**
+     * @brief Compare @configs with the ones loaded last time.
+     * @param changedNames names of configs changed, added or removed
+     * @return false if configs cannot be reloaded incrementally, LoadAllConfig should be used
+     */
+    bool GetChangedConfigs(const std::unordered_map<std::string, Json::Value>& configs,
+                           std::unordered_set<std::string>& changedNames);
+    // IsPluginConfigChanged returns true if any of @changedNames is or was processed by plugin system.
+    bool IsPluginConfigChanged(const std::unordered_map<std::string, Json::Value>& configs,
+                               const std::unordered_set<std::string>& changedNames);
+    /**
+     * @brief Replace configs in @changedNames with the ones in @configs, other Config objects are kept, so
+     * handlers and readers of them are not affected. It must be called when LogInput is held on.
+     */
+    void LoadChangedConfigs(const std::unordered_map<std::string, Json::Value>& configs,
+                            const std::unordered_set<std::string>& changedNames);
     const std::unordered_map<std::string, Config*>& GetAllConfig() { return mNameConfigMap; }
     void RegisterWildcardPath(Config* config, const std::string& path, int32_t depth);
     bool RegisterHandlers(const std::string& basePath, Config* config);
     bool RegisterHandlers();
     bool RegisterHandlersRecursively(const std::string& dir, Config* config, bool checkTimeout);
+    /**
+     * @brief Register descendants deferred by RegisterHandlers, it is called by LogInput thread.
+     * @param timeBudgetMs stop after it and leave the rest to the next call
+     */
+    void RegisterPendingDirs(int32_t timeBudgetMs);
+    bool HasPendingRegisterDirs() const { return mHasPendingRegisterDirs; }
     /**
      * @brief HasFuseConfig
      * @return true if global fuse flag is true and there is
@@ -344,12 +411,19 @@ public:
     int32_t
     FindMatchWithForceFlag(std::vector<Config*>& allConfig, const std::string& path, const std::string& name = "");
 
+    // GetMatchCandidates returns configs to be tested by Config::IsMatch for the file @name in @path.
+    void GetMatchCandidates(const std::string& path, const std::string& name, std::vector<Config*>& candidates);
+
     Config* FindStreamLogTagMatch(const std::string& tag);
 
     Config* FindDSConfigByCategory(const std::string& dsCtegory);
 
     Config* FindConfigByName(const std::string& configName);
 
+    // GetConfigGeneration returns a number increased whenever configs in mNameConfigMap are deleted, a config
+    // found by FindConfigByName stays valid as long as the generation is not changed.
+    int64_t GetConfigGeneration() const { return mConfigGeneration.load(std::memory_order_acquire); }
+
     // handler must be created by new, because when path timeout, we would call delete on it
     void AddNewHandler(const std::string& path, EventHandler* handler) { mDirEventHandlerMap[path] = handler; }
     /**delete the timeout dir
@@ -492,9 +566,15 @@ private:
      */
     bool RegisterHandlersWithinDepth(const std::string& path, Config* config, int depth);
     bool RegisterDescendants(const std::string& path, Config* config, int withinDepth);
+    // DeferRegistration queues descendants of registered @path if it is deeper than config_register_sync_depth,
+    // returns false if they should be registered now.
+    bool DeferRegistration(const std::string& path, Config* config, int remainingDepth, bool preserve);
+    void ClearPendingRegisterDirs();
     bool CheckLogType(const std::string& logTypeStr, LogType& logType);
     std::vector<std::string> GetStringVector(const Json::Value& value);
     LogFilterRule* GetFilterFule(const Json::Value& filterKeys, const Json::Value& filterRegs);
+    // CompileSensitiveWordCastSets combines regexes of sensitive cast options of each key.
+    void CompileSensitiveWordCastSets(Config* pConfig);
     void GetRegexAndKeys(const Json::Value& value, Config* configPtr);
     void GetSensitiveKeys(const Json::Value& value, Config* pConfig);
 
@@ -561,6 +641,7 @@ private:
     friend class FuseFileUnittest;
     friend class MultiServerConfigUpdatorUnitest;
     friend class CreateModifyHandlerUnittest;
+    friend class PluginTagsCacheUnittest;
 #endif
 };
 
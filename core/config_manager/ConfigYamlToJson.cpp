@@ -31,6 +31,7 @@ const std::string INPUT_FILE_LOG = "file_log";
 const std::string PROCESSOR_REGEX_ACCELERATE = "processor_regex_accelerate";
 const std::string PROCESSOR_JSON_ACCELERATE = "processor_json_accelerate";
 const std::string PROCESSOR_DELIMITER_ACCELERATE = "processor_delimiter_accelerate";
+const std::string PROCESSOR_CONTAINER_STDOUT_ACCELERATE = "processor_container_stdout_accelerate";
 
 const std::string PROCESSOR_SPLIT_LINE_LOG_USING_SEP = "processor_split_log_string";
 const std::string PROCESSOR_SPLIT_LINE_LOG_USING_REG = "processor_split_log_regex";
@@ -112,6 +113,7 @@ ConfigYamlToJson::ConfigYamlToJson() {
     mFilePluginToLogTypeMap[PROCESSOR_REGEX_ACCELERATE] = "common_reg_log";
     mFilePluginToLogTypeMap[PROCESSOR_JSON_ACCELERATE] = "json_log";
     mFilePluginToLogTypeMap[PROCESSOR_DELIMITER_ACCELERATE] = "delimiter_log";
+    mFilePluginToLogTypeMap[PROCESSOR_CONTAINER_STDOUT_ACCELERATE] = "container_stdout_log";
 }
 
 string ConfigYamlToJson::GetTransforKey(const string yamlKey) {
@@ -26,6 +26,7 @@
 #include <limits.h>
 #include <errno.h>
 #include <vector>
+#include <boost/thread.hpp>
 #include <sys/types.h>
 #if !defined(LOGTAIL_NO_TC_MALLOC)
 #include <gperftools/malloc_extension.h>
@@ -41,6 +42,7 @@
 #include "common/GlobalPara.h"
 #include "common/FileSystemUtil.h"
 #include "common/TimeUtil.h"
+#include "common/Thread.h"
 #ifdef __linux__
 #include "streamlog/StreamLogManager.h"
 #include "ObserverManager.h"
@@ -55,9 +57,12 @@
 #include "profiler/LogtailAlarm.h"
 #include "profiler/LogIntegrity.h"
 #include "profiler/LogLineCount.h"
+#include "profiler/IntegrityNotifier.h"
+#include "logger/HotLogger.h"
 #include "log_pb/metric.pb.h"
 #include "log_pb/sls_logs.pb.h"
 #include "checkpoint/CheckPointManager.h"
+#include "checkpoint/CheckPointSnapshot.h"
 #include "checkpoint/CheckpointManagerV2.h"
 #include "shennong/MetricSender.h"
 #include "polling/PollingDirFile.h"
@@ -83,8 +88,14 @@ DECLARE_FLAG_INT32(check_point_dump_interval);
 DECLARE_FLAG_INT32(ilogtail_max_epoll_events);
 DECLARE_FLAG_INT32(ilogtail_epoll_wait_events);
 DECLARE_FLAG_INT64(max_logtail_writer_packet_size);
+DECLARE_FLAG_INT32(logtail_checkpoint_write_batch_interval_ms);
+DECLARE_FLAG_INT32(check_handler_timeout_interval);
+DECLARE_FLAG_BOOL(check_point_snapshot_dump_enable);
 DEFINE_FLAG_INT32(ilogtail_epoll_time_out, "default time out is 1s", 1);
 DEFINE_FLAG_INT32(main_loop_check_interval, "seconds", 60);
+DEFINE_FLAG_INT32(symlink_full_check_interval,
+                  "seconds, check all symbolic link dirs even if their parent dirs are not changed",
+                  600);
 DEFINE_FLAG_INT32(existed_file_active_timeout,
                   "when first monitor directory, file modified in 120 seconds will be collected",
                   120);
@@ -92,11 +103,26 @@ DEFINE_FLAG_INT32(tcmalloc_release_memory_interval, "force release memory held b
 DEFINE_FLAG_BOOL(merge_shennong_metric, "merge LogGroup into LogPackageList if true", true);
 DEFINE_FLAG_BOOL(fs_events_inotify_enable, "", true);
 DEFINE_FLAG_INT32(checkpoint_find_max_cache_size, "", 100000);
+DEFINE_FLAG_INT32(checkpoint_validate_thread_count,
+                  "threads to validate checkpoints at startup, 0 means validating in the main thread",
+                  0);
+DEFINE_FLAG_BOOL(checkpoint_restore_recent_first,
+                 "push events of checkpoints in recently updated dirs first when restoring checkpoints",
+                 false);
 DEFINE_FLAG_INT32(max_watch_dir_count, "", 100 * 1000);
 DEFINE_FLAG_STRING(inotify_watcher_dirs_dump_filename, "", "inotify_watcher_dirs");
 DEFINE_FLAG_INT32(exit_flushout_duration, "exit process flushout duration", 20 * 1000);
+DEFINE_FLAG_BOOL(exit_spill_enable,
+                 "write data left into buffer files at exit instead of waiting for sending, for fast upgrade",
+                 false);
+DEFINE_FLAG_INT32(exit_spill_duration, "exit process spill duration, ms", 3 * 1000);
 DEFINE_FLAG_INT32(search_checkpoint_default_dir_depth, "0 means only search current directory", 0);
 DEFINE_FLAG_BOOL(enable_polling_discovery, "", true);
+DEFINE_FLAG_INT32(ds_socket_read_buffer_size, "min bytes read from domain socket each time", 64 * 1024);
+DEFINE_FLAG_INT32(ds_socket_max_reads_per_event, "max reads of a domain socket fd in one epoll wake-up", 16);
+DEFINE_FLAG_BOOL(enable_incremental_config_update,
+                 "reload changed configs only, readers of unchanged configs are kept",
+                 true);
 
 #define PBMSG 0
 
@@ -107,7 +133,13 @@ typedef struct MessageHdr {
     uint32_t len;
 } MessageHdr;
 
-EventDispatcherBase::EventDispatcherBase() : mWatchNum(0), mInotifyWatchNum(0), mStreamLogManagerPtr(NULL) {
+EventDispatcherBase::EventDispatcherBase()
+    : mWatchNum(0),
+      mInotifyWatchNum(0),
+      mPathTrie(PATH_SEPARATOR[0]),
+      mDirTimeoutWheel(time(NULL)),
+      mHandlerTimeoutWheel(time(NULL)),
+      mStreamLogManagerPtr(NULL) {
     /*
      * May add multiple inotify fd instances in the future,
      * so use epoll here though a little more sophisticated than select
@@ -189,10 +221,7 @@ bool EventDispatcherBase::RegisterEventHandler(const char* path, Config* config,
     }
     uint64_t inode = statBuf.GetDevInode().inode;
     int wd;
-    MapType<std::string, int>::Type::iterator pathIter = mPathWdMap.find(path);
-    if (pathIter != mPathWdMap.end()) {
-        wd = pathIter->second;
-
+    if (mPathTrie.Find(path, wd)) {
         if (inode != mWdDirInfoMap[wd]->mInode) {
             LOG_INFO(sLogger,
                      ("dir's inode was changed", path)("inode_before", mWdDirInfoMap[wd]->mInode)("inode_now", inode));
@@ -459,8 +488,8 @@ EventDispatcherBase::validateCheckpoint(CheckPointPtr& checkpoint,
     }
 
     // delete checkpoint if file path is not exist
-    MapType<std::string, int>::Type::iterator pathIter = mPathWdMap.find(path);
-    if (pathIter == mPathWdMap.end()) {
+    int wd;
+    if (!mPathTrie.Find(path, wd)) {
         LOG_INFO(sLogger,
                  ("delete checkpoint", "file path no longer exists")("config", checkpoint->mConfigName)(
                      "log reader queue name", checkpoint->mFileName)("real file path", checkpoint->mRealFileName)(
@@ -468,7 +497,6 @@ EventDispatcherBase::validateCheckpoint(CheckPointPtr& checkpoint,
         return ValidateCheckpointResult::kLogDirNotWatched;
     }
 
-    int wd = pathIter->second;
     DevInode devInode = GetFileDevInode(realFilePath);
     if (devInode.IsValid() && checkpoint->mDevInode == devInode) {
         if (!CheckFileSignature(
@@ -599,18 +627,82 @@ EventDispatcherBase::validateCheckpoint(CheckPointPtr& checkpoint,
     return ValidateCheckpointResult::kDevInodeNotFound;
 }
 
+void EventDispatcherBase::validateCheckpoints(std::vector<CheckPointPtr>& checkpoints,
+                                              std::vector<ValidateCheckpointResult>& results,
+                                              std::map<DevInode, SplitedFilePath>& cachePathDevInodeMap,
+                                              std::vector<Event*>& eventVec) {
+    results.assign(checkpoints.size(), ValidateCheckpointResult::kNormal);
+    size_t threadCount = INT32_FLAG(checkpoint_validate_thread_count) > 0
+        ? static_cast<size_t>(INT32_FLAG(checkpoint_validate_thread_count))
+        : 0;
+    threadCount = std::min(threadCount, checkpoints.size());
+    if (threadCount <= 1) {
+        for (size_t i = 0; i < checkpoints.size(); ++i) {
+            results[i] = validateCheckpoint(checkpoints[i], cachePathDevInodeMap, eventVec);
+        }
+        return;
+    }
+
+    // Checkpoints of the same dir go to the same thread, so searching by dev inode can still hit the cache.
+    std::vector<std::vector<size_t>> shards(threadCount);
+    for (size_t i = 0; i < checkpoints.size(); ++i) {
+        const std::string& filePath = checkpoints[i]->mFileName;
+        const std::string dir = filePath.substr(0, filePath.find_last_of(PATH_SEPARATOR));
+        shards[std::hash<std::string>()(dir) % threadCount].push_back(i);
+    }
+    std::vector<std::map<DevInode, SplitedFilePath>> caches(threadCount, cachePathDevInodeMap);
+    std::vector<std::vector<Event*>> shardEvents(threadCount);
+    {
+        std::vector<ThreadPtr> threads;
+        for (size_t t = 0; t < threadCount; ++t) {
+            threads.push_back(CreateThread([this, t, &shards, &checkpoints, &results, &caches, &shardEvents]() {
+                for (size_t idx : shards[t]) {
+                    results[idx] = validateCheckpoint(checkpoints[idx], caches[t], shardEvents[t]);
+                }
+            }));
+        }
+        // Threads are joined when released.
+    }
+    cachePathDevInodeMap.clear();
+    for (size_t t = 0; t < threadCount; ++t) {
+        cachePathDevInodeMap.insert(caches[t].begin(), caches[t].end());
+        eventVec.insert(eventVec.end(), shardEvents[t].begin(), shardEvents[t].end());
+    }
+    LOG_INFO(sLogger,
+             ("validate checkpoints in parallel, thread count", threadCount)("checkpoint count", checkpoints.size()));
+}
+
 void EventDispatcherBase::AddExistedCheckPointFileEvents() {
     // All checkpoint will be add into event queue or be deleted
     // This operation will delete not existed file's check point
     std::map<DevInode, SplitedFilePath> cachePathDevInodeMap;
     auto& checkPointMap = CheckPointManager::Instance()->GetAllFileCheckPoint();
     LOG_INFO(sLogger, ("start to verify existed checkpoints, total checkpoint count", checkPointMap.size()));
-    std::vector<CheckPointManager::CheckPointKey> deleteKeyVec;
-    std::vector<Event*> eventVec;
+    std::vector<CheckPointManager::CheckPointKey> keyVec;
+    std::vector<CheckPointPtr> checkpointVec;
+    keyVec.reserve(checkPointMap.size());
+    checkpointVec.reserve(checkPointMap.size());
     for (auto iter = checkPointMap.begin(); iter != checkPointMap.end(); ++iter) {
-        auto const result = validateCheckpoint(iter->second, cachePathDevInodeMap, eventVec);
-        if (!(result == ValidateCheckpointResult::kNormal || result == ValidateCheckpointResult::kRotate)) {
-            deleteKeyVec.push_back(iter->first);
+        keyVec.push_back(iter->first);
+        checkpointVec.push_back(iter->second);
+    }
+    std::vector<ValidateCheckpointResult> resultVec;
+    std::vector<Event*> eventVec;
+    validateCheckpoints(checkpointVec, resultVec, cachePathDevInodeMap, eventVec);
+
+    // The latest update time of valid checkpoints in each log dir, used to push recent events first.
+    std::unordered_map<std::string, int32_t> dirUpdateTimeMap;
+    auto updateDirTime = [&dirUpdateTimeMap](const CheckPointPtr& checkpoint) {
+        const std::string& filePath = checkpoint->mFileName;
+        int32_t& updateTime = dirUpdateTimeMap[filePath.substr(0, filePath.find_last_of(PATH_SEPARATOR))];
+        updateTime = std::max(updateTime, checkpoint->mLastUpdateTime);
+    };
+    std::vector<CheckPointManager::CheckPointKey> deleteKeyVec;
+    for (size_t i = 0; i < resultVec.size(); ++i) {
+        if (resultVec[i] == ValidateCheckpointResult::kNormal || resultVec[i] == ValidateCheckpointResult::kRotate) {
+            updateDirTime(checkpointVec[i]);
+        } else {
+            deleteKeyVec.push_back(keyVec[i]);
         }
     }
     for (size_t i = 0; i < deleteKeyVec.size(); ++i) {
@@ -633,20 +725,30 @@ void EventDispatcherBase::AddExistedCheckPointFileEvents() {
                   "")("config size", exactlyOnceConfigs.size())("scanned checkpoint size", exactlyOnceCpts.size()));
         std::vector<std::pair<std::string, PrimaryCheckpointPB>*> batchUpdateCpts;
         std::vector<std::pair<std::string, PrimaryCheckpointPB>*> batchDeleteCpts;
+        std::vector<CheckPointPtr> v1Cpts;
+        v1Cpts.reserve(exactlyOnceCpts.size());
+        for (size_t idx = 0; idx < exactlyOnceCpts.size(); ++idx) {
+            auto& cpt = exactlyOnceCpts[idx].second;
+            v1Cpts.push_back(std::make_shared<CheckPoint>(cpt.log_path(),
+                                                          0,
+                                                          cpt.sig_size(),
+                                                          cpt.sig_hash(),
+                                                          DevInode(cpt.dev(), cpt.inode()),
+                                                          cpt.config_name(),
+                                                          cpt.real_path(),
+                                                          1));
+            v1Cpts.back()->mLastUpdateTime = cpt.update_time();
+        }
+        std::vector<ValidateCheckpointResult> results;
+        validateCheckpoints(v1Cpts, results, cachePathDevInodeMap, eventVec);
         for (size_t idx = 0; idx < exactlyOnceCpts.size(); ++idx) {
             auto& cptPair = exactlyOnceCpts[idx];
             auto& cpt = cptPair.second;
-            auto v1Cpt = std::make_shared<CheckPoint>(cpt.log_path(),
-                                                      0,
-                                                      cpt.sig_size(),
-                                                      cpt.sig_hash(),
-                                                      DevInode(cpt.dev(), cpt.inode()),
-                                                      cpt.config_name(),
-                                                      cpt.real_path(),
-                                                      1);
-            const auto result = validateCheckpoint(v1Cpt, cachePathDevInodeMap, eventVec);
+            auto& v1Cpt = v1Cpts[idx];
+            const auto result = results[idx];
             switch (result) {
                 case ValidateCheckpointResult::kNormal:
+                    updateDirTime(v1Cpt);
                     break;
 
                 case ValidateCheckpointResult::kRotate:
@@ -655,6 +757,7 @@ void EventDispatcherBase::AddExistedCheckPointFileEvents() {
                               cptPair.first)("old checkpoint", cpt.DebugString())("new path", v1Cpt->mRealFileName));
                     cpt.set_real_path(v1Cpt->mRealFileName);
                     batchUpdateCpts.push_back(&cptPair);
+                    updateDirTime(v1Cpt);
                     break;
 
                 default:
@@ -688,15 +791,34 @@ void EventDispatcherBase::AddExistedCheckPointFileEvents() {
     if (eventVec.size() > 0) {
         // Sort by Source/Object (length+alphabet) in event to adjust the order of rotating files.
         // eg. /log/a.log.10 -> /log/a.log.9 -> /log/a.log.8 -> ...
-        std::sort(eventVec.begin(), eventVec.end(), Event::CompareByFullPath);
+        if (BOOL_FLAG(checkpoint_restore_recent_first)) {
+            // Events of recently updated dirs go first, so active files resume collection before stale ones.
+            // The order of events in the same dir is kept for rotating files.
+            auto dirUpdateTime = [&dirUpdateTimeMap](const Event* event) {
+                auto iter = dirUpdateTimeMap.find(event->GetSource());
+                return iter == dirUpdateTimeMap.end() ? 0 : iter->second;
+            };
+            std::sort(eventVec.begin(), eventVec.end(), [&dirUpdateTime](const Event* lhs, const Event* rhs) {
+                const int32_t lhsTime = dirUpdateTime(lhs);
+                const int32_t rhsTime = dirUpdateTime(rhs);
+                if (lhsTime != rhsTime) {
+                    return lhsTime > rhsTime;
+                }
+                return Event::CompareByFullPath(lhs, rhs);
+            });
+        } else {
+            std::sort(eventVec.begin(), eventVec.end(), Event::CompareByFullPath);
+        }
         LogInput::GetInstance()->PushEventQueue(eventVec);
     }
 }
 
 bool EventDispatcherBase::AddTimeoutWatch(const char* path) {
-    MapType<string, int>::Type::iterator itr = mPathWdMap.find(path);
-    if (itr != mPathWdMap.end()) {
-        mWdUpdateTimeMap[itr->second] = time(NULL);
+    int wd;
+    if (mPathTrie.Find(path, wd)) {
+        time_t curTime = time(NULL);
+        mWdUpdateTimeMap[wd] = curTime;
+        mDirTimeoutWheel.Schedule(wd, curTime + INT32_FLAG(timeout_interval));
         return true;
     } else {
         return false;
@@ -704,17 +826,23 @@ bool EventDispatcherBase::AddTimeoutWatch(const char* path) {
 }
 
 void EventDispatcherBase::AddOneToOneMapEntry(DirInfo* dirInfo, int wd) {
-    mPathWdMap[dirInfo->mPath] = wd;
+    mPathTrie.Insert(dirInfo->mPath, wd);
     mWdDirInfoMap[wd] = dirInfo;
+    CheckPointSnapshotTable::GetInstance()->AddDir(wd, dirInfo->mPath);
+    // Spread by wd, so dirs registered at once are not checked at once.
+    int32_t interval = std::max(INT32_FLAG(check_handler_timeout_interval), 1);
+    mHandlerTimeoutWheel.Schedule(wd, time(NULL) + 1 + static_cast<uint32_t>(wd) % interval);
 }
 
 void EventDispatcherBase::RemoveOneToOneMapEntry(int wd) {
-    MapType<int, DirInfo*>::Type::iterator itr = mWdDirInfoMap.find(wd);
+    WdDirInfoMap::iterator itr = mWdDirInfoMap.find(wd);
     if (itr == mWdDirInfoMap.end())
         return;
-    mPathWdMap.erase((itr->second)->mPath);
+    mPathTrie.Erase((itr->second)->mPath);
     delete itr->second;
     mWdDirInfoMap.erase(itr);
+    mHandlerTimeoutWheel.Cancel(wd);
+    CheckPointSnapshotTable::GetInstance()->RemoveDir(wd);
 }
 
 // add timeout propagation and process logic
@@ -863,6 +991,9 @@ bool EventDispatcherBase::Dispatch() {
         }
 #endif
 
+#if defined(__linux__)
+        MetricSender::GetInstance()->Flush();
+#endif
         ExtraWork();
         curTime = time(NULL);
         DumpCheckPointPeriod(curTime);
@@ -892,16 +1023,16 @@ void EventDispatcherBase::DumpInotifyWatcherDirs() {
         return;
     }
     string outline = string("WatchNum: ") + ToString(mWatchNum) + ", NotifyNum: " + ToString(mInotifyWatchNum)
-        + ", WdUpdateTimeMap: " + ToString(mWdUpdateTimeMap.size()) + ", PathWdMap: " + ToString(mPathWdMap.size())
+        + ", WdUpdateTimeMap: " + ToString(mWdUpdateTimeMap.size()) + ", PathTrie: " + ToString(mPathTrie.Size())
         + ", WdDirInfoMap: " + ToString(mWdDirInfoMap.size()) + ", BrokenLinkSet: " + ToString(mBrokenLinkSet.size())
         + "\n";
     fwrite(outline.c_str(), 1, outline.size(), pFile);
 
     string info = "directory\twatch_descriptor\n";
-    for (MapType<string, int>::Type::iterator iter = mPathWdMap.begin(); iter != mPathWdMap.end(); ++iter) {
-        if (iter->second > 0)
-            info.append(iter->first).append("\t").append(ToString(iter->second)).append("\n");
-    }
+    mPathTrie.ForEach([&info](const string& path, int wd) {
+        if (wd > 0)
+            info.append(path).append("\t").append(ToString(wd)).append("\n");
+    });
     fwrite(info.c_str(), 1, info.size(), pFile);
     fclose(pFile);
 }
@@ -909,16 +1040,49 @@ void EventDispatcherBase::DumpInotifyWatcherDirs() {
 void EventDispatcherBase::CheckSymbolicLink() {
     // consider symbolic link like this: a -> b -> c
     // "a" and "b" is symbolic link, "c" is a directory, "a" is registered in inotify
+    int32_t curTime = time(NULL);
+    if (curTime - mLastFullSymlinkCheckTime >= INT32_FLAG(symlink_full_check_interval)) {
+        mSymlinkStateMap.clear();
+        mLastFullSymlinkCheckTime = curTime;
+    }
+    // Links under the same dir share one stat of it.
+    std::unordered_map<string, SymlinkState> parentStates;
+    auto getParentState = [&parentStates](const string& path, SymlinkState& state) {
+        size_t pos = path.rfind(PATH_SEPARATOR[0]);
+        string parent = pos == string::npos ? string() : path.substr(0, pos);
+        auto iter = parentStates.find(parent);
+        if (iter == parentStates.end()) {
+            SymlinkState& parentState = parentStates[parent];
+            fsutil::PathStat parentStat;
+            if (fsutil::PathStat::stat(parent.empty() ? PATH_SEPARATOR : parent, parentStat)) {
+                parentState.mParentDevInode = parentStat.GetDevInode();
+                parentStat.GetLastWriteTime(parentState.mParentMtimeSec, parentState.mParentMtimeNsec);
+            }
+            iter = parentStates.find(parent);
+        }
+        state = iter->second;
+        return state.mParentDevInode.IsValid();
+    };
+
     vector<string> dirToCheck(mBrokenLinkSet.begin(), mBrokenLinkSet.end());
-    for (MapType<string, int>::Type::iterator iter = mPathWdMap.begin(); iter != mPathWdMap.end(); ++iter) {
-        string path = iter->first;
-        int wd = iter->second;
-        if (mWdDirInfoMap.find(wd) == mWdDirInfoMap.end())
+    mPathTrie.ForEach([&](const string& path, int wd) {
+        WdDirInfoMap::iterator dirItr = mWdDirInfoMap.find(wd);
+        if (dirItr == mWdDirInfoMap.end()) {
             LOG_WARNING(sLogger,
-                        ("maybe something wrong, path in mPathWdMap", path)("but wd not exist in mWdDirInfoMap", wd));
-        else if (mWdDirInfoMap[wd]->mIsSymbolicLink)
-            dirToCheck.push_back(path);
-    }
+                        ("maybe something wrong, path in mPathTrie", path)("but wd not exist in mWdDirInfoMap", wd));
+            return;
+        }
+        if (!dirItr->second->mIsSymbolicLink)
+            return;
+        // The link is not replaced or removed if its parent dir is not changed. The parent is stat before the
+        // link, so a change between them is found by next check.
+        SymlinkState parentState;
+        bool hasParent = getParentState(path, parentState);
+        auto stateIter = mSymlinkStateMap.find(path);
+        if (hasParent && stateIter != mSymlinkStateMap.end() && parentState == stateIter->second)
+            return;
+        dirToCheck.push_back(path);
+    });
     vector<string> dirToAdd;
     for (vector<string>::iterator dirIter = dirToCheck.begin(); dirIter != dirToCheck.end(); ++dirIter) {
         string path = *dirIter;
@@ -930,6 +1094,7 @@ void EventDispatcherBase::CheckSymbolicLink() {
             if (mBrokenLinkSet.find(path) != mBrokenLinkSet.end()) {
                 mBrokenLinkSet.erase(path);
             }
+            mSymlinkStateMap.erase(path);
             UnregisterAllDir(path);
         } else {
             fsutil::PathStat statBuf;
@@ -937,6 +1102,7 @@ void EventDispatcherBase::CheckSymbolicLink() {
             {
                 // when "b" was removed, there will be no inotify event
                 LOG_WARNING(sLogger, ("existed symbolic link invalid, remove inotify monitor", path));
+                mSymlinkStateMap.erase(path);
                 UnregisterAllDir(path);
                 mBrokenLinkSet.insert(path);
             } else if (statBuf.IsDir()) {
@@ -946,6 +1112,9 @@ void EventDispatcherBase::CheckSymbolicLink() {
                 if (mBrokenLinkSet.find(path) != mBrokenLinkSet.end()) {
                     mBrokenLinkSet.erase(path);
                 }
+                SymlinkState parentState;
+                if (lstatBuf.IsLink() && getParentState(path, parentState))
+                    mSymlinkStateMap[path] = parentState;
                 dirToAdd.push_back(path);
             }
         }
@@ -965,18 +1134,11 @@ std::vector<std::pair<std::string, EventHandler*>>
 EventDispatcherBase::FindAllSubDirAndHandler(const std::string& baseDir) {
     LOG_DEBUG(sLogger, ("Find all sub dir", baseDir));
     std::vector<std::pair<std::string, EventHandler*>> dirAndHandlers;
-    size_t baseDirSize = baseDir.size();
-    MapType<std::string, int>::Type::iterator it = mPathWdMap.begin();
-    for (; it != mPathWdMap.end(); ++it) {
-        const string& pathName = it->first;
-        size_t pathNameSize = pathName.size();
-        if (baseDirSize > pathNameSize) {
-            continue;
-        }
-        if (memcmp(baseDir.c_str(), pathName.c_str(), baseDirSize) == 0
-            && (pathNameSize == baseDirSize || pathName[baseDirSize] == PATH_SEPARATOR[0])) {
-            dirAndHandlers.push_back(std::make_pair(it->first, mWdDirInfoMap[it->second]->mHandler));
-        }
+    std::vector<std::pair<std::string, int>> subDirs;
+    mPathTrie.FindSubtree(baseDir, subDirs);
+    dirAndHandlers.reserve(subDirs.size());
+    for (auto& subDir : subDirs) {
+        dirAndHandlers.push_back(std::make_pair(std::move(subDir.first), mWdDirInfoMap[subDir.second]->mHandler));
     }
     return dirAndHandlers;
 }
@@ -990,10 +1152,9 @@ void EventDispatcherBase::UnregisterAllDir(const string& baseDir) {
 }
 
 void EventDispatcherBase::UnregisterEventHandler(const char* path) {
-    MapType<std::string, int>::Type::iterator pos = mPathWdMap.find(path);
-    if (pos == mPathWdMap.end())
+    int wd;
+    if (!mPathTrie.Find(path, wd))
         return;
-    int wd = pos->second;
     if (mWdDirInfoMap[wd]->mIsSymbolicLink) {
         fsutil::PathStat lstatBuf;
         if (fsutil::PathStat::lstat(path, lstatBuf)) // TODO: Need review, might be a bug.
@@ -1003,7 +1164,9 @@ void EventDispatcherBase::UnregisterEventHandler(const char* path) {
         }
     }
     RemoveOneToOneMapEntry(wd);
+    mSymlinkStateMap.erase(path);
     mWdUpdateTimeMap.erase(wd);
+    mDirTimeoutWheel.Cancel(wd);
     if (mEventListener->IsValidID(wd) && mEventListener->IsInit()) {
         mEventListener->RemoveWatch(wd);
         mInotifyWatchNum--;
@@ -1030,22 +1193,20 @@ DirRegisterStatus EventDispatcherBase::IsDirRegistered(const string& path) {
     }
     uint64_t inode = statBuf.GetDevInode().inode;
 
-    MapType<string, int>::Type::iterator pathIter = mPathWdMap.find(path);
-    if (pathIter != mPathWdMap.end() && inode == mWdDirInfoMap[pathIter->second]->mInode) {
+    int wd;
+    if (mPathTrie.Find(path, wd) && inode == mWdDirInfoMap[wd]->mInode) {
         return PATH_INODE_REGISTERED;
     }
     return PATH_INODE_NOT_REGISTERED;
 }
 
 bool EventDispatcherBase::IsRegistered(const char* path) {
-    MapType<string, int>::Type::iterator itr = mPathWdMap.find(path);
-    if (itr == mPathWdMap.end())
-        return false;
-    return true;
+    int wd;
+    return mPathTrie.Find(path, wd);
 }
 
 bool EventDispatcherBase::IsRegistered(int wd, std::string& path) {
-    MapType<int, DirInfo*>::Type::iterator itr = mWdDirInfoMap.find(wd);
+    WdDirInfoMap::iterator itr = mWdDirInfoMap.find(wd);
     if (itr == mWdDirInfoMap.end())
         return false;
     else {
@@ -1055,21 +1216,24 @@ bool EventDispatcherBase::IsRegistered(int wd, std::string& path) {
 }
 
 void EventDispatcherBase::HandleTimeout() {
-    // increment each watcher's timeout account, if bound meets,
-    // call timeout handler
-    vector<string*> sources;
-    vector<EventHandler*> handlers;
-
     time_t curTime = time(NULL);
-    MapType<int, time_t>::Type::iterator itr = mWdUpdateTimeMap.begin();
-    for (; itr != mWdUpdateTimeMap.end(); ++itr) {
-        if (curTime - (itr->second) >= INT32_FLAG(timeout_interval)) {
-            // add to vector then batch process to avoid possible iterator change problem
-            // mHandler may remove what itr points to, thus change the layout of the map container
-            // what follows may not work
-            // Event ev(source, string(), EVENT_TIMEOUT);
-            // mTimoutHandler->Handle(ev);
-            sources.push_back(&(mWdDirInfoMap[itr->first]->mPath));
+    std::vector<int64_t> expired;
+    mDirTimeoutWheel.Advance(curTime, expired);
+    // Copied, mTimeoutHandler removes DirInfo of the dir and maybe its descendants.
+    vector<string> sources;
+    for (int64_t id : expired) {
+        int wd = static_cast<int>(id);
+        MapType<int, time_t>::Type::iterator itr = mWdUpdateTimeMap.find(wd);
+        WdDirInfoMap::iterator dirItr = mWdDirInfoMap.find(wd);
+        if (itr == mWdUpdateTimeMap.end() || dirItr == mWdDirInfoMap.end()) {
+            continue;
+        }
+        if (curTime - itr->second >= INT32_FLAG(timeout_interval)) {
+            sources.push_back(dirItr->second->mPath);
+            // Checked again later if the handler keeps it.
+            mDirTimeoutWheel.Schedule(wd, curTime + INT32_FLAG(timeout_interval));
+        } else {
+            mDirTimeoutWheel.Schedule(wd, itr->second + INT32_FLAG(timeout_interval));
         }
     }
     // when we reach this function, for any dir p and its
@@ -1077,40 +1241,30 @@ void EventDispatcherBase::HandleTimeout() {
     // but in vector sources, p may appear before c, this is
     // not a problem if what we do is irrelevant to the order whose
     // timeout handler is called when both are timeout at the same time.
-    vector<string*>::iterator itr1 = sources.begin();
-    for (; itr1 != sources.end(); ++itr1) {
-        Event ev(*(*itr1), string(), EVENT_TIMEOUT, 0);
+    for (vector<string>::iterator itr = sources.begin(); itr != sources.end(); ++itr) {
+        Event ev(*itr, string(), EVENT_TIMEOUT, 0);
         mTimeoutHandler->Handle(ev);
     }
 }
 
 void EventDispatcherBase::PropagateTimeout(const char* path) {
-    char* tmp = strdup(path);
-    MapType<string, int>::Type::iterator pathpos = mPathWdMap.find(tmp);
-    if (pathpos == mPathWdMap.end()) {
+    std::vector<int> wds;
+    mPathTrie.FindAncestors(path, wds);
+    if (wds.empty()) {
         // walkarond of bug#5760293, should find the scenarios
-        LogtailAlarm::GetInstance()->SendAlarm(
-            INVALID_MEMORY_ACCESS_ALARM, "PropagateTimeout access invalid key of mPathWdMap, path : " + string(tmp));
-        LOG_ERROR(sLogger, ("PropagateTimeout access invalid key of mPathWdMap, path", string(tmp)));
-        free(tmp);
+        LogtailAlarm::GetInstance()->SendAlarm(INVALID_MEMORY_ACCESS_ALARM,
+                                               "PropagateTimeout access invalid key of mPathTrie, path : "
+                                                   + string(path));
+        LOG_ERROR(sLogger, ("PropagateTimeout access invalid key of mPathTrie, path", string(path)));
         return;
     }
-    MapType<int, time_t>::Type::iterator pos = mWdUpdateTimeMap.find(pathpos->second);
-    char* slashpos;
     time_t curTime = time(NULL);
-    while (pos != mWdUpdateTimeMap.end()) {
-        pos->second = curTime;
-        slashpos = strrchr(tmp, '/');
-        if (slashpos == NULL)
-            break;
-        *slashpos = '\0';
-        pathpos = mPathWdMap.find(tmp);
-        if (pathpos != mPathWdMap.end())
-            pos = mWdUpdateTimeMap.find(pathpos->second);
-        else
+    for (size_t i = 0; i < wds.size(); ++i) {
+        MapType<int, time_t>::Type::iterator pos = mWdUpdateTimeMap.find(wds[i]);
+        if (pos == mWdUpdateTimeMap.end())
             break;
+        pos->second = curTime;
     }
-    free(tmp);
 }
 
 void EventDispatcherBase::StartTimeCount() {
@@ -1121,7 +1275,7 @@ void EventDispatcherBase::StartTimeCount() {
     }
 }
 void EventDispatcherBase::DumpAllHandlersMeta(bool remove) {
-    MapType<int, DirInfo*>::Type::iterator it;
+    WdDirInfoMap::iterator it;
     vector<int> timeout;
     for (it = mWdDirInfoMap.begin(); it != mWdDirInfoMap.end(); ++it) {
         ((it->second)->mHandler)->DumpReaderMeta(true, remove);
@@ -1145,11 +1299,116 @@ void EventDispatcherBase::DumpAllHandlersMeta(bool remove) {
         CheckPointManager::Instance()->AddDirCheckPoint(path);
     }
 }
+void EventDispatcherBase::DumpHandlersMeta(const std::unordered_set<std::string>& configNames) {
+    ConfigManager* configManager = ConfigManager::GetInstance();
+    // Dirs under paths of new configs may have files to be read by them.
+    vector<string> basePaths;
+    for (auto iter = configNames.begin(); iter != configNames.end(); ++iter) {
+        Config* config = configManager->FindConfigByName(*iter);
+        if (config == NULL)
+            continue;
+        if (config->mDockerFileFlag) {
+            for (size_t i = 0; i < config->mDockerContainerPaths->size(); ++i) {
+                basePaths.push_back((*config->mDockerContainerPaths)[i].mContainerPath);
+            }
+        } else if (!config->mWildcardPaths.empty()) {
+            basePaths.push_back(config->mWildcardPaths[0]);
+        } else {
+            basePaths.push_back(config->mBasePath);
+        }
+    }
+    vector<int> related;
+    for (WdDirInfoMap::iterator it = mWdDirInfoMap.begin(); it != mWdDirInfoMap.end(); ++it) {
+        const DirInfo* dirInfo = it->second;
+        bool isRelated = dirInfo->mHandler->HasReaderOfConfigs(configNames)
+            || configManager->FindBestMatch(dirInfo->mPath) == NULL;
+        for (size_t i = 0; !isRelated && i < basePaths.size(); ++i) {
+            isRelated = StartWith(dirInfo->mPath, basePaths[i]);
+        }
+        if (isRelated)
+            related.push_back(it->first);
+    }
+    for (size_t i = 0; i < related.size(); ++i) {
+        mWdDirInfoMap[related[i]]->mHandler->DumpReaderMeta(true, true);
+    }
+    for (size_t i = 0; i < related.size(); ++i) {
+        mWdDirInfoMap[related[i]]->mHandler->DumpReaderMeta(false, true);
+        configManager->AddHandlerToDelete(mWdDirInfoMap[related[i]]->mHandler);
+    }
+    for (size_t i = 0; i < related.size(); ++i) {
+        string path = mWdDirInfoMap[related[i]]->mPath;
+        UnregisterEventHandler(path.c_str());
+        configManager->RemoveHandler(path, false);
+        if (configManager->FindBestMatch(path) != NULL)
+            CheckPointManager::Instance()->AddDirCheckPoint(path);
+    }
+    LOG_INFO(sLogger, ("dump handlers of changed configs, dir count", related.size())("left", mWdDirInfoMap.size()));
+}
+
+// UpdateChangedConfigs keeps Config objects, handlers and readers of unchanged configs, so files of them are
+// read from opened fds as soon as LogInput resumes. LogInput is still held on while configs are replaced, since
+// it and process threads look up configs without locks, but it only lasts for the changed configs.
+bool EventDispatcherBase::UpdateChangedConfigs() {
+    ConfigManager* configManager = ConfigManager::GetInstance();
+    std::unordered_map<std::string, Json::Value> configs;
+    std::unordered_set<std::string> changedNames;
+    configManager->GetAllUserConfigs(configs);
+    if (!configManager->GetChangedConfigs(configs, changedNames))
+        return false;
+    if (changedNames.empty()) {
+        LOG_INFO(sLogger, ("main thread", "no config changed"));
+        configManager->FinishUpdateConfig();
+        return true;
+    }
+    bool pluginChanged = configManager->IsPluginConfigChanged(configs, changedNames);
+#if defined(__linux__)
+    if (mStreamLogManagerPtr != NULL) {
+        ((StreamLogManager*)mStreamLogManagerPtr)->ShutdownConfigUsage();
+    }
+    ObserverManager::GetInstance()->HoldOn(false);
+#endif
+    LOG_INFO(sLogger,
+             ("main thread", "start update changed configs")("count", changedNames.size())("plugin", pluginChanged));
+    auto updateStart = GetCurrentTimeInMilliSeconds();
+    LogInput::GetInstance()->HoldOn();
+    if (pluginChanged)
+        LogtailPlugin::GetInstance()->HoldOn(false);
+    mBrokenLinkSet.clear();
+
+    PollingDirFile::GetInstance()->ClearCache();
+    configManager->LoadChangedConfigs(configs, changedNames);
+    configManager->CleanUnusedUserAK();
+    DumpHandlersMeta(changedNames);
+    if (configManager->GetConfigRemoveFlag()) {
+        LOG_INFO(sLogger, ("dump checkpoint to local", ""));
+        CheckPointManager::Instance()->DumpCheckPointToLocal();
+        configManager->SetConfigRemoveFlag(false);
+    }
+    CheckPointManager::Instance()->ResetLastDumpTime();
+
+    if (pluginChanged)
+        LogtailPlugin::GetInstance()->Resume();
+    LogInput::GetInstance()->Resume(true);
+#if defined(__linux__)
+    if (mStreamLogManagerPtr != NULL) {
+        ((StreamLogManager*)mStreamLogManagerPtr)->StartupConfigUsage();
+    }
+    ObserverManager::GetInstance()->Resume();
+#endif
+    LOG_INFO(sLogger, ("update changed configs", "done")("time(ms)", GetCurrentTimeInMilliSeconds() - updateStart));
+    configManager->FinishUpdateConfig();
+    return true;
+}
+
 void EventDispatcherBase::UpdateConfig() {
-    if (ConfigManager::GetInstance()->IsUpdateContainerPaths())
+    // Container paths are applied to all docker configs, handlers of them are rebuilt.
+    bool updateContainerPaths = ConfigManager::GetInstance()->IsUpdateContainerPaths();
+    if (updateContainerPaths)
         ConfigManager::GetInstance()->StartUpdateConfig();
     if (ConfigManager::GetInstance()->IsUpdateConfig() == false)
         return;
+    if (BOOL_FLAG(enable_incremental_config_update) && !updateContainerPaths && UpdateChangedConfigs())
+        return;
 #if defined(__linux__)
     if (mStreamLogManagerPtr != NULL) {
         ((StreamLogManager*)mStreamLogManagerPtr)->ShutdownConfigUsage();
@@ -1218,6 +1477,7 @@ void EventDispatcherBase::ExitProcess() {
     if (mStreamLogManagerPtr != NULL) {
         ((StreamLogManager*)mStreamLogManagerPtr)->Shutdown();
     }
+    MetricSender::GetInstance()->Flush(true);
 #endif
 
     LOG_INFO(sLogger, ("LogInput", "hold on"));
@@ -1233,6 +1493,9 @@ void EventDispatcherBase::ExitProcess() {
 
     // added by xianzhi(bowen.gbw@antfin.com)
     // should dump line count and integrity data to local file
+    if (!IntegrityNotifier::GetInstance()->Drain(1000)) {
+        LOG_WARNING(sLogger, ("drain integrity notify queue", "timeout"));
+    }
     LOG_INFO(sLogger, ("dump line count data to local file", "start"));
     LogLineCount::GetInstance()->DumpLineCountDataToLocal();
 
@@ -1267,16 +1530,31 @@ void EventDispatcherBase::ExitProcess() {
     // hode on again
     LogProcess::GetInstance()->HoldOn();
 
-    LOG_INFO(sLogger, ("flush out sender data", "start"));
-    if (!(Sender::Instance()->FlushOut(INT32_FLAG(exit_flushout_duration))))
-        LOG_WARNING(sLogger, ("flush out sender data", "fail"));
-    else
-        LOG_INFO(sLogger, ("flush out sender data", "success"));
+    if (BOOL_FLAG(exit_spill_enable)) {
+        // Data left is sent by DaemonBufferSender after restart.
+        LOG_INFO(sLogger, ("spill sender data to buffer file", "start"));
+        if (!(Sender::Instance()->SpillOut(INT32_FLAG(exit_spill_duration))))
+            LOG_WARNING(sLogger, ("spill sender data to buffer file", "fail"));
+        else
+            LOG_INFO(sLogger, ("spill sender data to buffer file", "success"));
+    } else {
+        LOG_INFO(sLogger, ("flush out sender data", "start"));
+        if (!(Sender::Instance()->FlushOut(INT32_FLAG(exit_flushout_duration))))
+            LOG_WARNING(sLogger, ("flush out sender data", "fail"));
+        else
+            LOG_INFO(sLogger, ("flush out sender data", "success"));
+    }
+    if (INT32_FLAG(logtail_checkpoint_write_batch_interval_ms) > 0) {
+        // Write exactly once checkpoints updated by sender callbacks.
+        CheckpointManagerV2::GetInstance()->Flush();
+    }
 
 #ifdef LOGTAIL_RUNTIME_PLUGIN
     LogtailRuntimePlugin::GetInstance()->UnLoadPluginBase();
 #endif
 
+    HotLogger::GetInstance()->Stop();
+
 #if defined(_MSC_VER)
     ReleaseWindowsSignalObject();
 #endif
@@ -1284,16 +1562,39 @@ void EventDispatcherBase::ExitProcess() {
     exit(0);
 }
 
-void EventDispatcherBase::ProcessHandlerTimeOut() {
-    MapType<int, DirInfo*>::Type::iterator mapIter = mWdDirInfoMap.begin();
-    for (; mapIter != mWdDirInfoMap.end(); ++mapIter) {
+void EventDispatcherBase::ProcessHandlerTimeOut(bool all) {
+    time_t curTime = time(NULL);
+    int32_t interval = std::max(INT32_FLAG(check_handler_timeout_interval), 1);
+    std::vector<int64_t> expired;
+    mHandlerTimeoutWheel.Advance(curTime, expired);
+    if (all) {
+        for (WdDirInfoMap::iterator mapIter = mWdDirInfoMap.begin(); mapIter != mWdDirInfoMap.end();
+             ++mapIter) {
+            mapIter->second->mHandler->HandleTimeOut();
+            mHandlerTimeoutWheel.Schedule(mapIter->first, curTime + interval);
+        }
+        return;
+    }
+    for (int64_t id : expired) {
+        int wd = static_cast<int>(id);
+        WdDirInfoMap::iterator mapIter = mWdDirInfoMap.find(wd);
+        if (mapIter == mWdDirInfoMap.end()) {
+            continue;
+        }
         mapIter->second->mHandler->HandleTimeOut();
+        mHandlerTimeoutWheel.Schedule(wd, curTime + interval);
     }
-    return;
 }
 
 void EventDispatcherBase::DumpCheckPointPeriod(int32_t curTime) {
     if (CheckPointManager::Instance()->NeedDump(curTime)) {
+        // Readers publish their checkpoints, dispatch goes on while they are written.
+        if (BOOL_FLAG(check_point_snapshot_dump_enable)) {
+            if (!CheckPointManager::Instance()->StartDumpCheckPointSnapshot()) {
+                LOG_WARNING(sLogger, ("skip dump checkpoint snapshot", "last dump is not finished"));
+            }
+            return;
+        }
         LOG_INFO(sLogger, ("Start dump checkpoint, hold on LogInput", curTime));
         LogInput::GetInstance()->HoldOn();
         DumpAllHandlersMeta(false);
@@ -1459,176 +1760,97 @@ void EventDispatcherBase::ErasePacketBuffer(int eventFd) {
 }
 #endif
 
-// true means Read total header
-// false means Read part header or occur error
 #if defined(__linux__)
-bool EventDispatcherBase::ReadDSPacketHdr(int eventFd) {
-    SingleDSPacket* singleDSPacketPtr = mPacketBuffer[eventFd];
-
-    if (singleDSPacketPtr->mRecvSize >= MSG_HDR_LEN)
-        return true;
-
-    int recvHdrLen = recv(eventFd,
-                          singleDSPacketPtr->mPacketHdr + singleDSPacketPtr->mRecvSize,
-                          MSG_HDR_LEN - singleDSPacketPtr->mRecvSize,
-                          MSG_DONTWAIT);
-    int totalRecvLen = recvHdrLen + singleDSPacketPtr->mRecvSize;
-
-    if (recvHdrLen <= 0)
-        return HandleReadException(eventFd, recvHdrLen, MSG_HDR_LEN);
-
-    singleDSPacketPtr->mRecvSize = totalRecvLen;
-    if (totalRecvLen == MSG_HDR_LEN)
-        return true;
-    else if (totalRecvLen < MSG_HDR_LEN)
-        return false;
-    else {
-        LOG_ERROR(sLogger,
-                  ("RecvLength Exceed total Length", ToString(totalRecvLen))("Header Length", ToString(MSG_HDR_LEN)));
-        return HandleReadException(eventFd, recvHdrLen, MSG_HDR_LEN);
+bool EventDispatcherBase::ReadDSPacket(int eventFd, uint32_t type, const char* packet, uint32_t size) {
+    if (type == PBMSG) {
+        // send the message
+        oas::MetricGroup metricGroup;
+        if (metricGroup.ParseFromArray(packet, size)) {
+            // Empty metricGroup is ignored, others are sent in batches by MetricSender.
+            MetricSender::GetInstance()->AddMetric(metricGroup, size);
+        } else {
+            LOG_ERROR(sLogger, ("Parse Protobuffer Message", "Failed"));
+            LogtailAlarm::GetInstance()->SendAlarm(METRIC_GROUP_PARSE_FAIL_ALARM,
+                                                   "desearlize from metricgroup fail");
+        }
+    } else if (type == INSIGHT_CMD_TYPE) {
+        static LogtailInsightDispatcher* insightDispatcher = LogtailInsightDispatcher::GetInstance();
+        int32_t ret = insightDispatcher->ExecuteCommand(eventFd, packet, size);
+        if (ret == -2) {
+            // ret is -2, meet send error, we should close fd
+            ErasePacketBuffer(eventFd);
+            close(eventFd);
+
+            struct epoll_event ee;
+            ee.events = 0;
+            ee.data.fd = eventFd;
+            epoll_ctl(mEpollFd, EPOLL_CTL_DEL, eventFd, &ee);
+
+            LOG_ERROR(sLogger,
+                      ("error while sending log group to logtail insight", "close fd and remove fd from epoll"));
+            return false;
+        }
+    } else {
+        LOG_WARNING(sLogger, ("Data Type is not support", type));
     }
+
+    return true;
 }
 #endif
 
 #if defined(__linux__)
-bool EventDispatcherBase::ReadDSPacket(int eventFd) {
-    SingleDSPacket* singleDSPacketPtr = mPacketBuffer[eventFd];
-    if (singleDSPacketPtr->mRecvSize < MSG_HDR_LEN)
-        return false;
-
-    if (singleDSPacketPtr->mRecvSize == MSG_HDR_LEN) // already get the whole head
-    {
-        MessageHdr* msgHdrPtr;
-        msgHdrPtr = (MessageHdr*)(singleDSPacketPtr->mPacketHdr);
-
-        if ((msgHdrPtr->len > 0) && (msgHdrPtr->len < INT64_FLAG(max_logtail_writer_packet_size))) {
-            singleDSPacketPtr->mPacket = new char[msgHdrPtr->len];
-            singleDSPacketPtr->mPacketSize = msgHdrPtr->len;
-            singleDSPacketPtr->mPacketType = msgHdrPtr->type;
-        } else {
-            LOG_ERROR(sLogger, ("Wrong Packet Message Size", ToString(msgHdrPtr->len)));
-            return HandleReadException(eventFd, 0, msgHdrPtr->len);
+bool EventDispatcherBase::ReadDSPackets(int eventFd, SingleDSPacket* packetBuffer) {
+    int64_t offset = 0;
+    while (packetBuffer->mSize - offset >= MSG_HDR_LEN) {
+        MessageHdr msgHdr;
+        memcpy(&msgHdr, packetBuffer->mBuffer + offset, MSG_HDR_LEN);
+        if (msgHdr.len == 0 || msgHdr.len >= INT64_FLAG(max_logtail_writer_packet_size)) {
+            LOG_ERROR(sLogger, ("Wrong Packet Message Size", ToString(msgHdr.len)));
+            return HandleReadException(eventFd, 0, msgHdr.len);
         }
+        if (packetBuffer->mSize - offset < MSG_HDR_LEN + (int64_t)msgHdr.len)
+            break;
+        if (!ReadDSPacket(eventFd, msgHdr.type, packetBuffer->mBuffer + offset + MSG_HDR_LEN, msgHdr.len))
+            return false;
+        offset += MSG_HDR_LEN + msgHdr.len;
     }
-
-    int recvLen = recv(eventFd,
-                       singleDSPacketPtr->mPacket + singleDSPacketPtr->mRecvSize - MSG_HDR_LEN,
-                       singleDSPacketPtr->mPacketSize - singleDSPacketPtr->mRecvSize + MSG_HDR_LEN,
-                       MSG_DONTWAIT);
-    int totalRecvLen = recvLen + singleDSPacketPtr->mRecvSize;
-    if (recvLen <= 0)
-        return HandleReadException(eventFd, recvLen, singleDSPacketPtr->mPacketSize);
-
-    if (totalRecvLen == (int)(singleDSPacketPtr->mPacketSize) + MSG_HDR_LEN) {
-        if (singleDSPacketPtr->mPacketType == PBMSG) {
-            // send the message
-            oas::MetricGroup metricGroup;
-            string msgStr;
-            msgStr.assign(singleDSPacketPtr->mPacket, singleDSPacketPtr->mPacketSize);
-            if (metricGroup.ParseFromString(msgStr)) {
-                if (metricGroup.metrics_size() > 0) // directly ignore empty metricGroup
-                {
-                    LogGroup logGroup;
-                    logGroup.set_source(metricGroup.metrics(0).source());
-                    logGroup.set_category(metricGroup.metricname());
-                    logGroup.set_topic(metricGroup.key());
-                    logGroup.set_machineuuid(ConfigManager::GetInstance()->GetUUID());
-                    Log* logPtr;
-                    for (int i = 0; i < metricGroup.metrics_size(); i++) {
-                        const oas::Metric& metric = metricGroup.metrics(i);
-                        logPtr = logGroup.add_logs();
-                        logPtr->set_time(metric.time());
-                        for (int j = 0; j < metric.contextgroup_size(); ++j) {
-                            Log_Content* logContentPtr = logPtr->add_contents();
-                            logContentPtr->set_key(metric.contextgroup(j).key());
-                            logContentPtr->set_value(metric.contextgroup(j).value());
-                        }
-                    }
-                    Config* config = ConfigManager::GetInstance()->FindDSConfigByCategory(logGroup.category());
-                    MetricSender::SendMetric(logGroup); // Sender::Send() will erase log group
-                    if (config != NULL) {
-                        std::vector<sls_logs::LogTag> empty;
-                        LogFileProfiler::GetInstance()->AddProfilingData(config->mConfigName,
-                                                                         config->mRegion,
-                                                                         config->mProjectName,
-                                                                         config->mCategory,
-                                                                         "",
-                                                                         empty,
-                                                                         msgStr.size(),
-                                                                         0,
-                                                                         logGroup.logs_size(),
-                                                                         0,
-                                                                         0,
-                                                                         0,
-                                                                         0,
-                                                                         0,
-                                                                         "");
-                        // send to SLS project
-                        if (!Sender::Instance()->Send(
-                                config->mProjectName,
-                                "",
-                                logGroup,
-                                config,
-                                BOOL_FLAG(merge_shennong_metric) ? MERGE_BY_LOGSTORE : MERGE_BY_TOPIC,
-                                (uint32_t)(msgStr.size() * DOUBLE_FLAG(loggroup_bytes_inflation)))) {
-                            LogtailAlarm::GetInstance()->SendAlarm(DISCARD_DATA_ALARM,
-                                                                   "push metric data into batch map fail",
-                                                                   config->mProjectName,
-                                                                   config->mCategory,
-                                                                   config->mRegion);
-                            LOG_ERROR(sLogger,
-                                      ("push metric data into batch map fail, discard logs", logGroup.logs_size())(
-                                          "project", config->mProjectName)("logstore", config->mCategory));
-                        }
-                    }
-                }
-            } else {
-                LOG_ERROR(sLogger, ("Parse Protobuffer Message", "Failed"));
-                LogtailAlarm::GetInstance()->SendAlarm(METRIC_GROUP_PARSE_FAIL_ALARM,
-                                                       "desearlize from metricgroup fail");
-            }
-        } else if (singleDSPacketPtr->mPacketType == INSIGHT_CMD_TYPE) {
-            static LogtailInsightDispatcher* insightDispatcher = LogtailInsightDispatcher::GetInstance();
-            int32_t ret = insightDispatcher->ExecuteCommand(
-                eventFd, singleDSPacketPtr->mPacket, singleDSPacketPtr->mPacketSize);
-            if (ret == -2) {
-                // ret is -2, meet send error, we should close fd
-                close(eventFd);
-
-                struct epoll_event ee;
-                ee.events = 0;
-                ee.data.fd = eventFd;
-                epoll_ctl(mEpollFd, EPOLL_CTL_DEL, eventFd, &ee);
-
-                LOG_ERROR(sLogger,
-                          ("error while sending log group to logtail insight", "close fd and remove fd from epoll"));
-                return false;
-            }
-        } else {
-            LOG_WARNING(sLogger, ("Data Type is not support", singleDSPacketPtr->mPacketType));
-        }
-
-        singleDSPacketPtr->Reset(); // reset packet buffer state
-    } else if (totalRecvLen < (int)(singleDSPacketPtr->mPacketSize) + MSG_HDR_LEN) {
-        singleDSPacketPtr->mRecvSize = totalRecvLen;
-    }
-
+    packetBuffer->Consume(offset, 2 * (int64_t)INT32_FLAG(ds_socket_read_buffer_size));
     return true;
 }
 #endif
 
+// Packets are parsed from the receive buffer of the connection without copy, and the fd is read until
+// EAGAIN (at most ds_socket_max_reads_per_event times) in one epoll wake-up.
 #if defined(__linux__)
 bool EventDispatcherBase::ReadMessages(int eventFd) {
-    // determine eventFd exist
-    if (mPacketBuffer.find(eventFd) == mPacketBuffer.end()) {
-        SingleDSPacket* singleDSPacketPtr = new SingleDSPacket();
-        mPacketBuffer[eventFd] = singleDSPacketPtr;
+    SingleDSPacket*& packetBuffer = mPacketBuffer[eventFd];
+    if (packetBuffer == NULL)
+        packetBuffer = new SingleDSPacket();
+
+    const int64_t readSize = INT32_FLAG(ds_socket_read_buffer_size);
+    for (int i = 0; i < INT32_FLAG(ds_socket_max_reads_per_event); ++i) {
+        int64_t capacity = std::max(readSize, packetBuffer->mSize + readSize / 2);
+        if (packetBuffer->mSize >= MSG_HDR_LEN) {
+            // Make room for the whole pending packet, its header is checked by ReadDSPackets.
+            MessageHdr msgHdr;
+            memcpy(&msgHdr, packetBuffer->mBuffer, MSG_HDR_LEN);
+            capacity = std::max(capacity, MSG_HDR_LEN + (int64_t)msgHdr.len);
+        }
+        packetBuffer->Reserve(capacity);
+
+        const int64_t room = packetBuffer->mCapacity - packetBuffer->mSize;
+        int recvLen = recv(eventFd, packetBuffer->mBuffer + packetBuffer->mSize, room, MSG_DONTWAIT);
+        if (recvLen < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            return true;
+        if (recvLen <= 0)
+            return HandleReadException(eventFd, recvLen, MSG_HDR_LEN);
+        packetBuffer->mSize += recvLen;
+        if (!ReadDSPackets(eventFd, packetBuffer))
+            return false;
+        if (recvLen < room)
+            return true; // drained
     }
-
-    if (ReadDSPacketHdr(eventFd))
-        return ReadDSPacket(eventFd);
-    else
-        return false;
+    return true;
 }
 #endif
 
@@ -1666,12 +1888,15 @@ bool EventDispatcherBase::AddStreamLogTcpSocketToEpoll() {
 void EventDispatcherBase::CleanEnviroments() {
     mMainThreadRunning = false;
     sleep(2); // INT32_FLAG(ilogtail_epoll_time_out) + 1
-    mPathWdMap.clear();
-    for (MapType<int, DirInfo*>::Type::iterator iter = mWdDirInfoMap.begin(); iter != mWdDirInfoMap.end(); ++iter)
+    mPathTrie.Clear();
+    for (WdDirInfoMap::iterator iter = mWdDirInfoMap.begin(); iter != mWdDirInfoMap.end(); ++iter)
         delete iter->second;
     mWdDirInfoMap.clear();
+    CheckPointSnapshotTable::GetInstance()->ClearDirs();
     mBrokenLinkSet.clear();
     mWdUpdateTimeMap.clear();
+    mDirTimeoutWheel.Clear();
+    mHandlerTimeoutWheel.Clear();
     for (std::unordered_map<int64_t, SingleDSPacket*>::iterator iter = mPacketBuffer.begin();
          iter != mPacketBuffer.end();
          ++iter)
@@ -1687,7 +1912,7 @@ void EventDispatcherBase::CleanEnviroments() {
 
 int32_t EventDispatcherBase::GetInotifyWatcherCount() {
     int32_t inotifyWatcherCount = 0;
-    for (MapType<int, DirInfo*>::Type::iterator iter = mWdDirInfoMap.begin(); iter != mWdDirInfoMap.end(); ++iter) {
+    for (WdDirInfoMap::iterator iter = mWdDirInfoMap.begin(); iter != mWdDirInfoMap.end(); ++iter) {
         if (iter->first >= 0)
             ++inotifyWatcherCount;
     }
@@ -29,6 +29,10 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
+#include "common/FileSystemUtil.h"
+#include "common/FlatHashMap.h"
+#include "common/PathTrie.h"
+#include "common/TimerWheel.h"
 #include "profiler/LogFileProfiler.h"
 #include "polling/PollingModify.h"
 #include "polling/PollingDirFile.h"
@@ -44,23 +48,43 @@ class Event;
 
 const int MSG_HDR_LEN = 8;
 
+// SingleDSPacket buffers bytes received from a domain socket connection. Packets are parsed in place and
+// the buffer is reused by following packets of the connection, it is shrunk after a large packet.
 typedef struct SingleDSPacket {
 public:
-    int64_t mPacketSize;
-    int64_t mRecvSize;
-    char mPacketHdr[MSG_HDR_LEN];
-    char* mPacket;
-    int8_t mPacketType;
+    char* mBuffer;
+    int64_t mCapacity;
+    int64_t mSize; // bytes received and not consumed yet
+
+    SingleDSPacket() : mBuffer(NULL), mCapacity(0), mSize(0) {}
+    ~SingleDSPacket() { delete[] mBuffer; }
+
+    // Reserve makes room for at least @capacity bytes, received bytes are kept.
+    void Reserve(int64_t capacity) {
+        if (capacity <= mCapacity)
+            return;
+        char* buffer = new char[capacity];
+        if (mSize > 0)
+            memcpy(buffer, mBuffer, mSize);
+        delete[] mBuffer;
+        mBuffer = buffer;
+        mCapacity = capacity;
+    }
 
-    SingleDSPacket() : mPacketSize(0), mRecvSize(0), mPacket(NULL), mPacketType(0) {}
+    // Consume drops @size parsed bytes at the front, buffer larger than @keepCapacity is freed when empty.
+    void Consume(int64_t size, int64_t keepCapacity) {
+        mSize -= size;
+        if (mSize > 0) {
+            memmove(mBuffer, mBuffer + size, mSize);
+        } else if (mCapacity > keepCapacity) {
+            Reset();
+        }
+    }
 
     void Reset() {
-        memset(mPacketHdr, 0, MSG_HDR_LEN);
-        mPacketSize = mRecvSize = mPacketType = 0;
-        if (mPacket) {
-            delete[] mPacket;
-            mPacket = NULL;
-        }
+        delete[] mBuffer;
+        mBuffer = NULL;
+        mCapacity = mSize = 0;
     }
 } SingleDSPacket;
 
@@ -115,14 +139,14 @@ public:
     void StopAllDir(const std::string& baseDir);
 
     EventHandler* GetHandler(const char* path) {
-        MapType<std::string, int>::Type::iterator itr = mPathWdMap.find(path);
-        if (itr == mPathWdMap.end())
+        int wd;
+        if (!mPathTrie.Find(path, wd))
             return NULL;
         else
-            return mWdDirInfoMap[itr->second]->mHandler;
+            return mWdDirInfoMap[wd]->mHandler;
     }
 
-    size_t GetHandlerCount() { return mPathWdMap.size(); }
+    size_t GetHandlerCount() { return mPathTrie.Size(); }
 
     /** Test whether a directory is registered.
      *
@@ -172,8 +196,9 @@ public:
     bool ReadMessages(int eventFd);
 
     void ErasePacketBuffer(int eventFd);
-    bool ReadDSPacketHdr(int eventFd);
-    bool ReadDSPacket(int eventFd);
+    // ReadDSPackets handles complete packets in the buffer of @eventFd, returns false if fd is closed.
+    bool ReadDSPackets(int eventFd, SingleDSPacket* packetBuffer);
+    bool ReadDSPacket(int eventFd, uint32_t type, const char* packet, uint32_t size);
 
     /** Enter the event loop, dispatch to the approiate handler when an event occurs.
      * Propagate timeout.
@@ -192,20 +217,33 @@ public:
 #endif
     virtual void ExtraWork() = 0;
     void DumpAllHandlersMeta(bool);
+    // DumpHandlersMeta dumps and removes handlers of dirs related to @configNames only.
+    void DumpHandlersMeta(const std::unordered_set<std::string>& configNames);
     std::vector<std::pair<std::string, EventHandler*> > FindAllSubDirAndHandler(const std::string& baseDir);
     void UnregisterAllDir(const std::string& basePath);
     bool IsRegistered(int wd, std::string& path);
+    // CheckSymbolicLink re-resolves broken links and symbolic link dirs whose parent dir has changed since last
+    // check, all of them every symlink_full_check_interval.
     void CheckSymbolicLink();
+    // InvalidateSymlinkState makes CheckSymbolicLink resolve @dir/@name again, for events of it in @dir.
+    void InvalidateSymlinkState(const std::string& dir, const std::string& name) {
+        if (!mSymlinkStateMap.empty())
+            mSymlinkStateMap.erase(dir + PATH_SEPARATOR + name);
+    }
 
     void DumpCheckPointPeriod(int32_t curTime);
 
     void StartTimeCount();
     void PropagateTimeout(const char* path);
+    // HandleTimeout sends EVENT_TIMEOUT for dirs not updated for timeout_interval, only dirs whose deadline
+    // has passed in mDirTimeoutWheel are checked, so it is cheap to call often.
     void HandleTimeout();
 
     void ReadInotifyEvents(std::vector<Event*>& eventVec);
 
-    void ProcessHandlerTimeOut();
+    // ProcessHandlerTimeOut calls HandleTimeOut of handlers due in mHandlerTimeoutWheel, each handler once per
+    // check_handler_timeout_interval. All handlers are called if @all is true.
+    void ProcessHandlerTimeOut(bool all = false);
     void AddExistedCheckPointFileEvents();
 
     bool FindCheckPointInPath(const std::string& path,
@@ -223,6 +261,8 @@ protected:
     void AddOneToOneMapEntry(DirInfo* dirInfo, int wd);
     void RemoveOneToOneMapEntry(int wd);
     void UpdateConfig();
+    // UpdateChangedConfigs reloads changed configs only, returns false if all configs should be reloaded.
+    bool UpdateChangedConfigs();
     void RemoveDSProfilers();
     void SendDSProfileData();
     void ExitProcess();
@@ -248,6 +288,13 @@ protected:
     ValidateCheckpointResult validateCheckpoint(CheckPointPtr& checkpoint,
                                                 std::map<DevInode, SplitedFilePath>& cachePathDevInodeMap,
                                                 std::vector<Event*>& eventVec);
+    // validateCheckpoints validates checkpoints and stores the result of checkpoints[i] in results[i].
+    // If checkpoint_validate_thread_count is positive, checkpoints are sharded by log dir to worker threads,
+    // each with its own copy of the find cache, so a dir is never searched by two threads at once.
+    void validateCheckpoints(std::vector<CheckPointPtr>& checkpoints,
+                             std::vector<ValidateCheckpointResult>& results,
+                             std::map<DevInode, SplitedFilePath>& cachePathDevInodeMap,
+                             std::vector<Event*>& eventVec);
 
     int mListenFd;
     int mWatchNum;
@@ -263,11 +310,31 @@ protected:
         typedef std::unordered_map<KeyType, ValueType> Type;
     };
 
-    MapType<std::string, int>::Type mPathWdMap;
-    MapType<int, DirInfo*>::Type mWdDirInfoMap;
+    typedef FlatHashMap<int, DirInfo*> WdDirInfoMap;
+
+    // Paths share nodes of their parent dirs, and dirs are found by wd without a node per entry.
+    PathTrie mPathTrie;
+    WdDirInfoMap mWdDirInfoMap;
     std::set<std::string> mBrokenLinkSet;
+    // SymlinkState is the parent dir of a symbolic link dir when the link was found valid by CheckSymbolicLink.
+    struct SymlinkState {
+        DevInode mParentDevInode;
+        int64_t mParentMtimeSec = 0;
+        int64_t mParentMtimeNsec = 0;
+
+        bool operator==(const SymlinkState& other) const {
+            return mParentDevInode == other.mParentDevInode && mParentMtimeSec == other.mParentMtimeSec
+                && mParentMtimeNsec == other.mParentMtimeNsec;
+        }
+    };
+    std::unordered_map<std::string, SymlinkState> mSymlinkStateMap;
+    int32_t mLastFullSymlinkCheckTime = 0;
     // for timeout issue
     MapType<int, time_t>::Type mWdUpdateTimeMap;
+    // Deadlines by wd. Updates of mWdUpdateTimeMap are not rescheduled, a dir refreshed before its deadline is
+    // scheduled again when the deadline comes.
+    TimerWheel mDirTimeoutWheel;
+    TimerWheel mHandlerTimeoutWheel;
     std::unordered_map<int64_t, SingleDSPacket*> mPacketBuffer;
     void* mStreamLogManagerPtr;
     volatile bool mMainThreadRunning;
@@ -283,6 +350,8 @@ protected:
     friend class SenderUnittest;
     friend class FuseFileUnittest;
     friend class MultiServerConfigUpdatorUnitest;
+    friend class DiscoveryBenchmark;
+    friend class CheckpointBenchmark;
 
     void CleanEnviroments();
     int32_t GetInotifyWatcherCount();
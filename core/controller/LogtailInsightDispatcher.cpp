@@ -17,8 +17,12 @@
 #include "common/Flags.h"
 #include "common/TimeUtil.h"
 #include "common/LogFileCollectOffsetIndicator.h"
+#include "common/StageProfiler.h"
+#include "common/StartupTimeline.h"
+#include "monitor/CpuProfiler.h"
 
 DEFINE_FLAG_INT32(default_wait_second, "default wait time for non-block fd, milliseconds", 50);
+DECLARE_FLAG_INT32(stage_profile_sample_interval);
 
 using namespace std;
 
@@ -132,6 +136,64 @@ int32_t LogtailInsightDispatcher::ExecuteCommand(int fd, const char* cmdBuf, int
             }
         }
 
+        std::string data = logGroup.SerializeAsString();
+        header.len = data.size();
+        int sendResult
+            = SendToFDWithWait(fd, (const char*)&header, sizeof(header), INT32_FLAG(default_wait_second) * 2);
+        if (sendResult != sizeof(header)) {
+            return -2;
+        }
+        sendResult = SendToFDWithWait(fd, data.c_str(), data.size(), INT32_FLAG(default_wait_second));
+        if (sendResult != (int)data.size()) {
+            return -2;
+        }
+        return sendResult;
+    } else if (cmdType == "profile") {
+        bool resetFlag = cmd.contents_size() >= 2 && cmd.contents(1).value() == "reset";
+        sls_logs::LogGroup logGroup;
+        GetStageProfile(&logGroup, resetFlag);
+
+        std::string data = logGroup.SerializeAsString();
+        header.len = data.size();
+        int sendResult
+            = SendToFDWithWait(fd, (const char*)&header, sizeof(header), INT32_FLAG(default_wait_second) * 2);
+        if (sendResult != sizeof(header)) {
+            return -2;
+        }
+        sendResult = SendToFDWithWait(fd, data.c_str(), data.size(), INT32_FLAG(default_wait_second));
+        if (sendResult != (int)data.size()) {
+            return -2;
+        }
+        return sendResult;
+    } else if (cmdType == "startup") {
+        sls_logs::LogGroup logGroup;
+        GetStartupTimeline(&logGroup);
+
+        std::string data = logGroup.SerializeAsString();
+        header.len = data.size();
+        int sendResult
+            = SendToFDWithWait(fd, (const char*)&header, sizeof(header), INT32_FLAG(default_wait_second) * 2);
+        if (sendResult != sizeof(header)) {
+            return -2;
+        }
+        sendResult = SendToFDWithWait(fd, data.c_str(), data.size(), INT32_FLAG(default_wait_second));
+        if (sendResult != (int)data.size()) {
+            return -2;
+        }
+        return sendResult;
+    } else if (cmdType == "cpuprofile") {
+        if (cmd.contents_size() < 2) {
+            LOG_ERROR(sLogger, ("invalid command cpuprofile", "content size < 2"));
+            SendErrorToFD(fd, "invalid command : cpuprofile");
+            return -1;
+        }
+        std::vector<std::string> args;
+        for (int i = 1; i < cmd.contents_size(); ++i) {
+            args.push_back(cmd.contents(i).value());
+        }
+        sls_logs::LogGroup logGroup;
+        StartCpuProfile(&logGroup, args);
+
         std::string data = logGroup.SerializeAsString();
         header.len = data.size();
         int sendResult
@@ -204,6 +266,134 @@ int LogtailInsightDispatcher::GetFileProgress(const std::string& filename, sls_l
     return result;
 }
 
+// Times are estimated from samples, in microseconds.
+void LogtailInsightDispatcher::GetStageProfile(sls_logs::LogGroup* logGroup, bool reset) {
+    const uint64_t sampleInterval = INT32_FLAG(stage_profile_sample_interval) > 0
+        ? static_cast<uint64_t>(INT32_FLAG(stage_profile_sample_interval))
+        : 0;
+    std::map<std::string, StageProfiler::ConfigStat> stats = StageProfiler::GetInstance()->GetStats(reset);
+    for (auto iter = stats.begin(); iter != stats.end(); ++iter) {
+        sls_logs::Log* log = logGroup->add_logs();
+        log->set_time(time(NULL));
+
+        sls_logs::Log_Content* content = log->add_contents();
+        content->set_key("configName");
+        content->set_value(iter->first);
+
+        content = log->add_contents();
+        content->set_key("sampleInterval");
+        content->set_value(ToString(sampleInterval));
+
+        for (int32_t stage = 0; stage < PROFILE_STAGE_COUNT; ++stage) {
+            const StageProfiler::StageStat& stat = iter->second[stage];
+            const std::string stageName = StageProfiler::GetStageName(static_cast<ProfileStage>(stage));
+            content = log->add_contents();
+            content->set_key(stageName + "_samples");
+            content->set_value(ToString(stat.mSampleCount));
+
+            content = log->add_contents();
+            content->set_key(stageName + "_cpu_us");
+            content->set_value(ToString(stat.mCpuTimeNs * sampleInterval / 1000));
+
+            content = log->add_contents();
+            content->set_key(stageName + "_wall_us");
+            content->set_value(ToString(stat.mWallTimeNs * sampleInterval / 1000));
+        }
+    }
+    if (sampleInterval == 0) {
+        sls_logs::Log* log = logGroup->add_logs();
+        log->set_time(time(NULL));
+        sls_logs::Log_Content* content = log->add_contents();
+        content->set_key("error");
+        content->set_value("stage profile is disabled, set stage_profile_sample_interval to enable it");
+    }
+}
+
+// Begin times are milliseconds since startup begins, durations are in microseconds.
+void LogtailInsightDispatcher::GetStartupTimeline(sls_logs::LogGroup* logGroup) {
+    StartupTimeline* timeline = StartupTimeline::GetInstance();
+    std::vector<StartupTimeline::Phase> phases = timeline->GetPhases();
+    for (const auto& phase : phases) {
+        sls_logs::Log* log = logGroup->add_logs();
+        log->set_time(time(NULL));
+
+        sls_logs::Log_Content* content = log->add_contents();
+        content->set_key("phase");
+        content->set_value(phase.mName);
+
+        content = log->add_contents();
+        content->set_key("begin_ms");
+        content->set_value(ToString(phase.mBeginMs));
+
+        content = log->add_contents();
+        content->set_key("wall_us");
+        content->set_value(ToString(phase.mWallUs));
+
+        content = log->add_contents();
+        content->set_key("cpu_us");
+        content->set_value(ToString(phase.mCpuUs));
+
+        content = log->add_contents();
+        content->set_key("count");
+        content->set_value(ToString(phase.mCount));
+    }
+    sls_logs::Log* log = logGroup->add_logs();
+    log->set_time(time(NULL));
+    sls_logs::Log_Content* content = log->add_contents();
+    content->set_key("isFinished");
+    content->set_value(ToString(timeline->IsFinished()));
+}
+
+void LogtailInsightDispatcher::StartCpuProfile(sls_logs::LogGroup* logGroup, const std::vector<std::string>& args) {
+    CpuProfiler* profiler = CpuProfiler::GetInstance();
+    std::string error;
+    bool started = false;
+    if (args[0] != "status") {
+        try {
+            const int32_t seconds = StringTo<int32_t>(args[0]);
+            const int32_t frequency = args.size() > 1 ? StringTo<int32_t>(args[1]) : 0;
+            started = profiler->Start(seconds, frequency, args.size() > 2 && args[2] == "upload", error);
+        } catch (...) {
+            error = "invalid arguments, should be <seconds> [frequency] [upload] or status";
+        }
+    }
+    const CpuProfiler::Result result = profiler->GetLastResult();
+    sls_logs::Log* log = logGroup->add_logs();
+    log->set_time(time(NULL));
+
+    sls_logs::Log_Content* content = log->add_contents();
+    content->set_key("started");
+    content->set_value(ToString(started));
+
+    content = log->add_contents();
+    content->set_key("error");
+    content->set_value(error);
+
+    content = log->add_contents();
+    content->set_key("running");
+    content->set_value(ToString(profiler->IsRunning()));
+
+    content = log->add_contents();
+    content->set_key("last_path");
+    content->set_value(result.mPath);
+
+    content = log->add_contents();
+    content->set_key("last_start_time");
+    content->set_value(ToString(result.mStartTime));
+
+    content = log->add_contents();
+    content->set_key("last_samples");
+    content->set_value(ToString(result.mSampleCount));
+
+    content = log->add_contents();
+    content->set_key("last_dropped");
+    content->set_value(ToString(result.mDroppedCount));
+
+    content = log->add_contents();
+    content->set_key("last_stacks");
+    content->set_value(ToString(result.mStackCount));
+}
+
 void LogtailInsightDispatcher::BuildLogGroup(sls_logs::LogGroup* logGroup,
                                              const LogFileInfo& info,
                                              const LogFileCollectProgress& progress) {
@@ -212,15 +402,15 @@ void LogtailInsightDispatcher::BuildLogGroup(sls_logs::LogGroup* logGroup,
 
     sls_logs::Log_Content* content = log->add_contents();
     content->set_key("project");
-    content->set_value(info.mProjectName);
+    content->set_value(info.mProjectName.Str());
 
     content = log->add_contents();
     content->set_key("logstore");
-    content->set_value(info.mLogstore);
+    content->set_value(info.mLogstore.Str());
 
     content = log->add_contents();
     content->set_key("configName");
-    content->set_value(info.mConfigName);
+    content->set_value(info.mConfigName.Str());
 
     content = log->add_contents();
     content->set_key("filename");
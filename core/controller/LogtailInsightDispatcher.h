@@ -25,6 +25,7 @@
 #include <stddef.h>
 #include <string>
 #include <map>
+#include <vector>
 #include "log_pb/sls_logs.pb.h"
 
 namespace logtail {
@@ -49,6 +50,13 @@ private:
     bool GetAllFileProgress(sls_logs::LogGroup* logGroup);
     int GetFileProgress(const std::string& filename, sls_logs::LogGroup* logGroup);
     void BuildLogGroup(sls_logs::LogGroup* logGroup, const LogFileInfo& info, const LogFileCollectProgress& progress);
+    // GetStageProfile adds one log for each config with estimated time spent in each pipeline stage.
+    void GetStageProfile(sls_logs::LogGroup* logGroup, bool reset);
+    // GetStartupTimeline adds one log for each startup phase and milestone.
+    void GetStartupTimeline(sls_logs::LogGroup* logGroup);
+    // StartCpuProfile starts a cpu profile by arguments "<seconds> [frequency] [upload]" unless @args is "status",
+    // and adds one log with the state and the last result of the profiler.
+    void StartCpuProfile(sls_logs::LogGroup* logGroup, const std::vector<std::string>& args);
 };
 
 } // namespace logtail
@@ -15,10 +15,11 @@
 #include "BlockEventManager.h"
 #include "processor/LogProcess.h"
 #include "common/HashUtil.h"
+#include "common/MemoryBudget.h"
 #include "common/StringTools.h"
 #include "polling/PollingEventQueue.h"
 
-DEFINE_FLAG_INT32(max_block_event_timeout, "max block event timeout, seconds", 3);
+DEFINE_FLAG_INT32(max_block_event_timeout, "max block event timeout, seconds, events are woken by feedback", 30);
 
 namespace logtail {
 
@@ -50,8 +51,17 @@ void BlockedEventManager::UpdateBlockEvent(const LogstoreFeedBackKey& logstoreKe
     }
     // LOG_DEBUG(sLogger, ("Add block event ", pEvent->GetSource())(pEvent->GetObject(),
     // pEvent->GetInode())(pEvent->GetConfigName(), hashKey));
-    ScopedSpinLock lock(mLock);
-    mBlockEventMap[hashKey].Update(logstoreKey, pEvent, curTime);
+    {
+        ScopedSpinLock lock(mLock);
+        mBlockEventMap[hashKey].Update(logstoreKey, pEvent, curTime);
+    }
+    if (MemoryBudget::IsReadBlocked()) {
+        mMemoryBlocked = true;
+    }
+    // The queue may drain before the event is added, feedback of it is missed then.
+    if (LogProcess::GetInstance()->IsValidToReadLog(logstoreKey)) {
+        FeedBack(logstoreKey);
+    }
 }
 
 void BlockedEventManager::GetTimeoutEvent(std::vector<Event*>& eventVec, int32_t curTime) {
@@ -76,6 +86,39 @@ void BlockedEventManager::GetTimeoutEvent(std::vector<Event*>& eventVec, int32_t
     }
 }
 
+void BlockedEventManager::GetMemoryRecoveredEvent(std::vector<Event*>& eventVec) {
+    if (!mMemoryBlocked || MemoryBudget::IsReadBlocked()) {
+        return;
+    }
+    mMemoryBlocked = false;
+    std::unordered_set<LogstoreFeedBackKey> keys;
+    {
+        ScopedSpinLock lock(mLock);
+        for (auto iter = mBlockEventMap.begin(); iter != mBlockEventMap.end(); ++iter) {
+            keys.insert(iter->second.mLogstoreKey);
+        }
+    }
+    // Check queues without mLock, FeedBack is called with the lock of process queue held.
+    LogProcess* pProcess = LogProcess::GetInstance();
+    for (auto iter = keys.begin(); iter != keys.end();) {
+        if (pProcess->IsValidToReadLog(*iter)) {
+            ++iter;
+        } else {
+            iter = keys.erase(iter);
+        }
+    }
+    ScopedSpinLock lock(mLock);
+    for (auto iter = mBlockEventMap.begin(); iter != mBlockEventMap.end();) {
+        BlockedEvent& blockedEvent = iter->second;
+        if (blockedEvent.mEvent != NULL && keys.find(blockedEvent.mLogstoreKey) != keys.end()) {
+            eventVec.push_back(blockedEvent.mEvent);
+            iter = mBlockEventMap.erase(iter);
+            continue;
+        }
+        ++iter;
+    }
+}
+
 void BlockedEventManager::FeedBack(const LogstoreFeedBackKey& key) {
     // LOG_DEBUG(sLogger, ("Get feedback block event  ", key));
     std::vector<Event*> eventVec;
@@ -98,6 +141,7 @@ void BlockedEventManager::FeedBack(const LogstoreFeedBackKey& key) {
     if (eventVec.size() > 0) {
         // use polling event queue, it is thread safe
         PollingEventQueue::GetInstance()->PushEvent(eventVec);
+        mTrigger.Trigger();
     }
 }
 
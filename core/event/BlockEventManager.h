@@ -15,8 +15,10 @@
  */
 
 #pragma once
+#include <atomic>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include "common/LogstoreFeedbackQueue.h"
 #include "common/Flags.h"
 #include "common/Lock.h"
@@ -38,8 +40,16 @@ public:
                           const Event& event,
                           const DevInode& devInode,
                           int32_t curTime);
+    // GetTimeoutEvent returns events whose timeout expires and queue is valid, it is a fallback in case
+    // feedback is missed, blocked events are woken by FeedBack normally.
     void GetTimeoutEvent(std::vector<Event*>& eventVec, int32_t curTime);
+    // GetMemoryRecoveredEvent returns events that can be read again after memory budget of reading is
+    // recovered, process queue does not feed back for them.
+    void GetMemoryRecoveredEvent(std::vector<Event*>& eventVec);
+    // FeedBack moves blocked events of @key into polling event queue and wakes WaitFeedBack.
     virtual void FeedBack(const LogstoreFeedBackKey& key);
+    // WaitFeedBack waits at most @waitMs, returns true if some events are fed back.
+    bool WaitFeedBack(int32_t waitMs) { return mTrigger.Wait(waitMs); }
     virtual bool IsValidToPush(const LogstoreFeedBackKey& key) {
         // should not be used
         return true;
@@ -77,6 +87,13 @@ protected:
 
     std::unordered_map<int64_t, BlockedEvent> mBlockEventMap;
     SpinLock mLock;
+    TriggerEvent mTrigger;
+    // set if some events are blocked when memory budget of reading is exceeded
+    std::atomic_bool mMemoryBlocked{false};
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class BlockEventManagerUnittest;
+#endif
 };
 
 } // namespace logtail
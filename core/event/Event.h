@@ -46,6 +46,8 @@ private:
     uint64_t mInode;
     int64_t mHashKey;
     std::string mConfigName;
+    // The MODIFY event of a file whose data may be gone soon, see LogFileReader::GetBytesAtRisk.
+    bool mAtRisk = false;
 
 public:
     Event(const Event& ev) {
@@ -58,6 +60,7 @@ public:
         mInode = ev.mInode;
         mHashKey = ev.mHashKey;
         mConfigName = ev.mConfigName;
+        mAtRisk = ev.mAtRisk;
     }
 
     Event(const std::string& source, const std::string& object, EventType type, int wd, uint32_t cookie = 0)
@@ -124,6 +127,10 @@ public:
     void SetHashKey(int64_t hashKey) { mHashKey = hashKey; }
 
     void SetConfigName(const std::string& configName) { mConfigName = configName; }
+
+    bool IsAtRisk() const { return mAtRisk; }
+
+    void SetAtRisk(bool atRisk) { mAtRisk = atRisk; }
  
     bool IsCreate() const { return mType & EVENT_CREATE; }
 
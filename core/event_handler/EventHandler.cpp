@@ -13,7 +13,9 @@
 // limitations under the License.
 
 #include "EventHandler.h"
+#include <algorithm>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 #include "common/util.h"
@@ -31,11 +33,20 @@
 #include "fuse/FuseFileBlacklist.h"
 #include "common/LogFileCollectOffsetIndicator.h"
 #include "LogInput.h"
+#include "monitor/Monitor.h"
+#include "checkpoint/CheckPointManager.h"
 
 using namespace std;
 using namespace sls_logs;
 
 DEFINE_FLAG_INT64(read_file_time_slice, "microseconds", 50 * 1000);
+DECLARE_FLAG_BOOL(at_risk_read_priority_enable);
+DECLARE_FLAG_BOOL(check_point_snapshot_dump_enable);
+DEFINE_FLAG_INT32(at_risk_read_time_slice_factor,
+                  "read time slice of files with data at risk is multiplied by it if at_risk_read_priority_enable",
+                  4);
+DECLARE_FLAG_INT64(config_read_rate_limit);
+DEFINE_FLAG_INT32(read_rate_limit_max_delay, "max milliseconds a file out of read budget waits, ms", 1000);
 DEFINE_FLAG_INT32(logreader_timeout_interval,
                   "reader hasn't updated for a long time will be removed, seconds",
                   86400 * 30);
@@ -62,9 +73,31 @@ DEFINE_FLAG_INT32(logreader_filerotate_remove_interval,
                   "when file is rotate, reader will be removed after seconds",
                   600);
 DEFINE_FLAG_INT32(rotate_overflow_error_interval, "second", 60);
+DEFINE_FLAG_INT32(rotated_read_lane_restart_interval,
+                  "seconds, catch-up of rotated files is restarted if not read for it with parallel rotated read",
+                  3);
+DEFINE_FLAG_INT32(logreader_hibernate_interval,
+                  "reader of closed file that has been read will be hibernated after seconds, 0 means never",
+                  1800);
 
 namespace logtail {
 
+namespace {
+
+const uint64_t kMinReadRateDelayMs = 10;
+
+// GetBucketDelay returns milliseconds for @bucket to pay back its debt, 0 if it has tokens.
+uint64_t GetBucketDelay(const TokenBucket& bucket) {
+    if (bucket.HasToken()) {
+        return 0;
+    }
+    const uint64_t delay = static_cast<uint64_t>(-bucket.GetTokens() * 1000 / bucket.GetRate()) + 1;
+    return std::min(std::max(delay, kMinReadRateDelayMs),
+                    static_cast<uint64_t>(std::max(INT32_FLAG(read_rate_limit_max_delay), 1)));
+}
+
+} // namespace
+
 void NormalEventHandler::Handle(const Event& event) {
     bool fileCreateModify = false;
     if (event.IsCreate() || event.IsMoveTo()) {
@@ -197,6 +230,16 @@ bool CreateModifyHandler::DumpReaderMeta(bool isRotatorReader, bool checkConfigF
     return true;
 }
 
+bool CreateModifyHandler::HasReaderOfConfigs(const std::unordered_set<std::string>& configNames) const {
+    for (ModifyHandlerMap::const_iterator iter = mModifyHandlerPtrMap.begin(); iter != mModifyHandlerPtrMap.end();
+         ++iter) {
+        if (configNames.find(iter->first) != configNames.end()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 ModifyHandler* CreateModifyHandler::GetOrCreateModifyHandler(const std::string& configName, Config* pConfig) {
     ModifyHandlerMap::iterator iter = mModifyHandlerPtrMap.find(configName);
     if (iter != mModifyHandlerPtrMap.end()) {
@@ -270,12 +313,26 @@ void CreateModifyHandler::Handle(const Event& event) {
                 return;
             }
 
+            // Inotify events have no dev and inode, they are resolved once here instead of by each handler.
+            const Event* dispatchEvent = &event;
+            std::unique_ptr<Event> resolvedEvent;
+            if (pConfigVec.size() > 1 && !DevInode(event.GetDev(), event.GetInode()).IsValid()
+                && (event.IsModify() || event.IsCreate() || event.IsMoveTo())) {
+                DevInode devInode = GetFileDevInode(path);
+                if (devInode.IsValid()) {
+                    resolvedEvent.reset(new Event(event));
+                    resolvedEvent->SetDev(devInode.dev);
+                    resolvedEvent->SetInode(devInode.inode);
+                    dispatchEvent = resolvedEvent.get();
+                }
+            }
+
             for (vector<Config*>::iterator configIter = pConfigVec.begin(); configIter != pConfigVec.end();
                  ++configIter) {
                 Config* pConfig = *configIter;
                 LOG_DEBUG(sLogger,
                           ("Process event with multi config", pConfigVec.size())(event.GetSource(), event.GetObject()));
-                GetOrCreateModifyHandler(pConfig->mConfigName, pConfig)->Handle(event);
+                GetOrCreateModifyHandler(pConfig->mConfigName, pConfig)->Handle(*dispatchEvent);
 
                 if (pConfig->mIsFuseMode) {
                     FuseFileBlacklist::GetInstance()->RemoveFromBlackList(path);
@@ -306,10 +363,85 @@ ModifyHandler::ModifyHandler(const std::string& configName, Config* pConfig) : m
     } else {
         mReadFileTimeSlice = INT64_FLAG(read_file_time_slice);
     }
+    mConfigReadRateBucket.SetRate(pConfig != NULL ? pConfig->mAdvancedConfig.mConfigReadRateLimit
+                                                  : INT64_FLAG(config_read_rate_limit));
+    mParallelRotatedRead = pConfig != NULL && pConfig->mAdvancedConfig.mParallelRotatedRead;
     mLastOverflowErrorTime = 0;
 }
 
 ModifyHandler::~ModifyHandler() {
+    static FileReaderIndex* sIndex = FileReaderIndex::GetInstance();
+    for (const auto& item : mDevInodeReaderMap) {
+        sIndex->Remove(item.first, this, FileReaderIndex::READER_ACTIVE);
+    }
+    for (const auto& item : mRotatorReaderMap) {
+        sIndex->Remove(item.first, this, FileReaderIndex::READER_ROTATOR);
+    }
+    for (const auto& item : mHibernatedReaderMap) {
+        sIndex->Remove(item.first, this, FileReaderIndex::READER_HIBERNATED);
+    }
+}
+
+void ModifyHandler::AddActiveReader(const DevInode& devInode, const LogFileReaderPtr& reader) {
+    mDevInodeReaderMap[devInode] = reader;
+    FileReaderIndex::GetInstance()->Add(devInode, this, FileReaderIndex::READER_ACTIVE);
+}
+
+void ModifyHandler::EraseActiveReader(const DevInode& devInode) {
+    if (mDevInodeReaderMap.erase(devInode) > 0) {
+        FileReaderIndex::GetInstance()->Remove(devInode, this, FileReaderIndex::READER_ACTIVE);
+    }
+    mCatchUpLaneTimes.erase(devInode);
+}
+
+void ModifyHandler::MoveToRotatorReader(const LogFileReaderPtr& reader) {
+    const DevInode& devInode = reader->GetDevInode();
+    EraseActiveReader(devInode);
+    mRotatorReaderMap[devInode] = reader;
+    FileReaderIndex::GetInstance()->Add(devInode, this, FileReaderIndex::READER_ROTATOR);
+}
+
+void ModifyHandler::EraseRotatorReader(const DevInode& devInode) {
+    if (mRotatorReaderMap.erase(devInode) > 0) {
+        FileReaderIndex::GetInstance()->Remove(devInode, this, FileReaderIndex::READER_ROTATOR);
+    }
+}
+
+void ModifyHandler::ScheduleCatchUpLane(const Event& event, const LogFileReaderPtr& head) {
+    const int32_t curTime = time(NULL);
+    auto iter = mCatchUpLaneTimes.find(head->GetDevInode());
+    if (iter != mCatchUpLaneTimes.end() && curTime - iter->second < INT32_FLAG(rotated_read_lane_restart_interval)) {
+        return;
+    }
+    mCatchUpLaneTimes[head->GetDevInode()] = curTime;
+    LOG_DEBUG(sLogger,
+              ("start catch-up lane of rotated file", head->GetLogPath())("real path", head->GetRealLogPath())(
+                  "config", mConfigName)("file inode", head->GetDevInode().inode));
+    Event* ev = new Event(event.GetSource(),
+                          event.GetObject(),
+                          event.GetType(),
+                          event.GetWd(),
+                          event.GetCookie(),
+                          head->GetDevInode().dev,
+                          head->GetDevInode().inode);
+    ev->SetConfigName(mConfigName);
+    LogInput::GetInstance()->PushEventQueue(ev);
+}
+
+void ModifyHandler::EraseFromReaderArray(LogFileReaderPtrArray& readerArray, const LogFileReaderPtr& reader) {
+    for (LogFileReaderPtrArray::iterator iter = readerArray.begin(); iter != readerArray.end(); ++iter) {
+        if (*iter == reader) {
+            readerArray.erase(iter);
+            return;
+        }
+    }
+}
+
+uint64_t ModifyHandler::GetReadRateDelay(LogFileReader& reader, uint64_t nowMs) {
+    TokenBucket& fileBucket = reader.GetReadRateBucket();
+    fileBucket.Refill(nowMs);
+    mConfigReadRateBucket.Refill(nowMs);
+    return std::max(GetBucketDelay(fileBucket), GetBucketDelay(mConfigReadRateBucket));
 }
 
 void ModifyHandler::MakeSpaceForNewReader() {
@@ -333,7 +465,7 @@ void ModifyHandler::MakeSpaceForNewReader() {
 
     for (int i = 0; i < deleteCount; ++i) {
         LogFileReader* pReader = sortReaderArray[i];
-        mDevInodeReaderMap.erase(pReader->GetDevInode());
+        EraseActiveReader(pReader->GetDevInode());
         LogFileReaderPtrArray& readerArray = *pReader->GetReaderArray();
         for (LogFileReaderPtrArray::iterator iter = readerArray.begin(); iter != readerArray.end(); ++iter) {
             if (iter->get() == pReader) {
@@ -444,7 +576,7 @@ LogFileReaderPtr ModifyHandler::CreateLogFileReaderPtr(
 
     backFlag ? readerArray.push_back(readerPtr) : readerArray.push_front(readerPtr);
     readerPtr->SetReaderArray(&readerArray);
-    mDevInodeReaderMap[devInode] = readerPtr;
+    AddActiveReader(devInode, readerPtr);
 
     LOG_INFO(
         sLogger,
@@ -457,6 +589,24 @@ LogFileReaderPtr ModifyHandler::CreateLogFileReaderPtr(
 }
 
 
+void ModifyHandler::PrepareBatchRead(const Event& event, std::vector<BatchRead::Request*>& requests) {
+    if (!event.IsModify()) {
+        return;
+    }
+    DevInode devInode(event.GetDev(), event.GetInode());
+    if (!devInode.IsValid()) {
+        return;
+    }
+    DevInodeLogFileReaderMap::iterator iter = mDevInodeReaderMap.find(devInode);
+    if (iter == mDevInodeReaderMap.end()) {
+        return;
+    }
+    BatchRead::Request* request = iter->second->PrepareTailRead();
+    if (request != NULL) {
+        requests.push_back(request);
+    }
+}
+
 void ModifyHandler::Handle(const Event& event) {
     const string& path = event.GetSource();
     const string& name = event.GetObject();
@@ -476,8 +626,15 @@ void ModifyHandler::Handle(const Event& event) {
         }
     }
 
-    DevInodeLogFileReaderMap::iterator devInodeIter
-        = devInode.IsValid() ? mDevInodeReaderMap.find(devInode) : mDevInodeReaderMap.end();
+    // States of the file in this handler, so maps without its reader are not looked up.
+    const uint32_t readerStates = devInode.IsValid() ? FileReaderIndex::GetInstance()->GetStates(devInode, this) : 0;
+    DevInodeLogFileReaderMap::iterator devInodeIter = (readerStates & FileReaderIndex::READER_ACTIVE)
+        ? mDevInodeReaderMap.find(devInode)
+        : mDevInodeReaderMap.end();
+    if (devInodeIter == mDevInodeReaderMap.end() && (readerStates & FileReaderIndex::READER_HIBERNATED)
+        && (event.IsModify() || event.IsCreate())) {
+        WakeUpReader(devInode);
+    }
 
     // when file is deleted or movefrom, we can't find devinode, so set all log reader's delete flag
     if (event.IsDeleted() || event.IsMoveFrom()) {
@@ -529,7 +686,7 @@ void ModifyHandler::Handle(const Event& event) {
     } else if (event.IsModify()) {
         // devInode cannot be found, this means a rotate file(like a.log.1) has event, and reader for rotate file is
         // moved to mRotatorReaderMap
-        if (devInode.IsValid() && devInodeIter == mDevInodeReaderMap.end()) {
+        if (devInodeIter == mDevInodeReaderMap.end() && (readerStates & FileReaderIndex::READER_ROTATOR)) {
             DevInodeLogFileReaderMap::iterator rotateIter = mRotatorReaderMap.find(devInode);
             // the reader for file(whether it's a.log or a.log.1) exists in mDevInodeReaderMap or mRotatorReaderMap
             // if we can find reader in mRotatorReaderMap, it means the file after rotating(a.log.1) also matches config
@@ -550,7 +707,7 @@ void ModifyHandler::Handle(const Event& event) {
                         return;
                         break;
                     case LogFileReader::FileCompareResult_SigChange:
-                        mRotatorReaderMap.erase(rotateIter);
+                        EraseRotatorReader(devInode);
                         break;
                     case LogFileReader::FileCompareResult_SigSameSizeChange: {
                         rotatorReader->UpdateLogPath(logPath);
@@ -563,8 +720,8 @@ void ModifyHandler::Handle(const Event& event) {
                             readerArray.push_front(rotatorReader);
                         }
                         rotatorReader->SetReaderArray(&readerArray);
-                        mDevInodeReaderMap[devInode] = rotatorReader;
-                        mRotatorReaderMap.erase(rotateIter);
+                        EraseRotatorReader(devInode);
+                        AddActiveReader(devInode, rotatorReader);
                         devInodeIter = mDevInodeReaderMap.find(devInode);
                     } break;
                     case LogFileReader::FileCompareResult_SigSameSizeSame:
@@ -580,6 +737,7 @@ void ModifyHandler::Handle(const Event& event) {
         }
         uint64_t beginTime = GetCurrentTimeInMicroSeconds();
         LogFileReaderPtrArray* readerArrayPtr = NULL;
+        LogFileReaderPtr eventReader; // reader of the file of the event, if known
         if (!devInode.IsValid()) {
             // call stat failed, but we should try to find reader because the log file may be moved to another name
             NameLogFileReaderMap::iterator iter = mNameReaderMap.find(name);
@@ -614,12 +772,14 @@ void ModifyHandler::Handle(const Event& event) {
                     readerPtr->DisableSkipFirstModify();
                     return;
                 }
+                eventReader = readerPtr;
                 readerArrayPtr = readerPtr->GetReaderArray();
             } else {
                 return;
             }
         } else {
             devInodeIter->second->UpdateLogPath(logPath);
+            eventReader = devInodeIter->second;
             readerArrayPtr = devInodeIter->second->GetReaderArray();
         }
         if (readerArrayPtr->size() == 0) {
@@ -627,6 +787,18 @@ void ModifyHandler::Handle(const Event& event) {
             return;
         }
         LogFileReaderPtr reader = (*readerArrayPtr)[0];
+        // With parallel rotated read, the file of the event is read on its own lane instead of after the rotated
+        // files before it, and the head of the queue is kept read on a catch-up lane by events of its own.
+        bool parallelLane = false;
+        if (mParallelRotatedRead && readerArrayPtr->size() > (size_t)1) {
+            if (eventReader && eventReader != reader) {
+                ScheduleCatchUpLane(event, reader);
+                reader = eventReader;
+                parallelLane = true;
+            } else {
+                mCatchUpLaneTimes[reader->GetDevInode()] = static_cast<int32_t>(time(NULL));
+            }
+        }
         // If file modified, it means the file is existed, then we should set fileDeletedFlag to false
         // NOTE: This may override the correct delete flag, which will cause fd close delay!
         // reader->SetFileDeleted(false);
@@ -651,9 +823,14 @@ void ModifyHandler::Handle(const Event& event) {
                     "log reader queue name", reader->GetLogPath())("log reader queue size", readerArrayPtr->size() - 1)(
                     "file device", reader->GetDevInode().dev)("file inode", reader->GetDevInode().inode)(
                     "file size", reader->GetFileSize())("rotator reader pool size", mRotatorReaderMap.size() + 1));
+            if (parallelLane) {
+                // Files before it are read by the catch-up lane.
+                EraseFromReaderArray(*readerArrayPtr, reader);
+                MoveToRotatorReader(reader);
+                return;
+            }
             readerArrayPtr->pop_front();
-            mDevInodeReaderMap.erase(reader->GetDevInode());
-            mRotatorReaderMap[reader->GetDevInode()] = reader;
+            MoveToRotatorReader(reader);
             if (readerArrayPtr->size() == 0) {
                 return;
             }
@@ -693,8 +870,12 @@ void ModifyHandler::Handle(const Event& event) {
                          "log reader queue name", reader->GetLogPath())(
                          "log reader queue size", readerArrayPtr->size() - 1)("file device", reader->GetDevInode().dev)(
                          "file inode", reader->GetDevInode().inode)("file size", reader->GetFileSize()));
-            readerArrayPtr->pop_front();
-            mDevInodeReaderMap.erase(reader->GetDevInode());
+            if (parallelLane) {
+                EraseFromReaderArray(*readerArrayPtr, reader);
+            } else {
+                readerArrayPtr->pop_front();
+            }
+            EraseActiveReader(reader->GetDevInode());
             // delete this reader, do not insert into rotator reader map
             // repush this event and wait for create reader
             Event* ev = new Event(event);
@@ -710,6 +891,7 @@ void ModifyHandler::Handle(const Event& event) {
                          "file size", reader->GetFileSize())("last file position", reader->GetLastFilePos()));
             reader->CloseFilePtr();
         }
+        const bool atRiskPriority = BOOL_FLAG(at_risk_read_priority_enable);
         bool hasMoreData;
         do {
             if (!LogProcess::GetInstance()->IsValidToReadLog(reader->GetLogstoreKey())) {
@@ -728,14 +910,38 @@ void ModifyHandler::Handle(const Event& event) {
                             + " ,logstore:" + reader->GetCategory());
                 }
 
+                Event blockedEvent(event);
+                blockedEvent.SetAtRisk(atRiskPriority && reader->GetBytesAtRisk() > 0);
                 BlockedEventManager::GetInstance()->UpdateBlockEvent(
-                    reader->GetLogstoreKey(), mConfigName, event, reader->GetDevInode(), curTime);
+                    reader->GetLogstoreKey(), mConfigName, blockedEvent, reader->GetDevInode(), curTime);
                 return;
             }
+            // Budgets are only checked and charged while other events are waiting, so a file reads in bursts when
+            // the node is idle, and a flooding file gives way to others. Files with data at risk are not limited.
+            const bool chargeReadBudget = (reader->GetReadRateBucket().IsLimited()
+                                           || mConfigReadRateBucket.IsLimited())
+                && reader->GetBytesAtRisk() == 0 && LogInput::GetInstance()->HasPendingEvents();
+            if (chargeReadBudget) {
+                const uint64_t nowMs = GetCurrentTimeInMilliSeconds();
+                const uint64_t delayMs = GetReadRateDelay(*reader, nowMs);
+                if (delayMs > 0) {
+                    LOG_DEBUG(sLogger,
+                              ("read log breakout", "out of read budget")("delay ms", delayMs)(
+                                  "path", event.GetSource())("file", event.GetObject()));
+                    Event* ev = new Event(event);
+                    ev->SetConfigName(mConfigName);
+                    LogInput::GetInstance()->PushDelayedEvent(ev, nowMs + delayMs);
+                    return;
+                }
+            }
             LogBuffer* logBuffer = NULL;
             hasMoreData = reader->ReadLog(logBuffer);
             int32_t pushRetry = 0;
             if (logBuffer != NULL) {
+                if (chargeReadBudget) {
+                    reader->GetReadRateBucket().Consume(logBuffer->bufferSize);
+                    mConfigReadRateBucket.Consume(logBuffer->bufferSize);
+                }
                 LogFileProfiler::GetInstance()->AddProfilingReadBytes(reader->GetConfigName(),
                                                                       reader->GetRegion(),
                                                                       reader->GetProjectName(),
@@ -746,7 +952,8 @@ void ModifyHandler::Handle(const Event& event) {
                                                                       reader->GetDevInode().inode,
                                                                       reader->GetFileSize(),
                                                                       reader->GetLastFilePos(),
-                                                                      time(NULL));
+                                                                      time(NULL),
+                                                                      reader->GetBytesAtRisk());
                 logBuffer->SetDependecy(reader);
                 while (!LogProcess::GetInstance()->PushBuffer(logBuffer)) // 10ms
                 {
@@ -770,13 +977,21 @@ void ModifyHandler::Handle(const Event& event) {
                 }
                 break;
             }
-            if (pushRetry >= 5 || GetCurrentTimeInMicroSeconds() - beginTime > mReadFileTimeSlice) {
+            // The time slice shrinks under resource pressure, so reading yields to other events more often.
+            // Files with data at risk get a longer one, so they are read to end before being released.
+            const bool atRisk = atRiskPriority && reader->GetBytesAtRisk() > 0;
+            const uint64_t readFileTimeSlice
+                = (atRisk ? mReadFileTimeSlice * std::max(INT32_FLAG(at_risk_read_time_slice_factor), 1)
+                          : mReadFileTimeSlice)
+                >> LogtailMonitor::Instance()->GetDegradeLevel();
+            if (pushRetry >= 5 || GetCurrentTimeInMicroSeconds() - beginTime > readFileTimeSlice) {
                 LOG_DEBUG(
                     sLogger,
                     ("read log breakout", "file io cost 1 time slice (50ms) or push blocked")("pushRetry", pushRetry)(
                         "begin time", beginTime)("path", event.GetSource())("file", event.GetObject()));
                 Event* ev = new Event(event);
                 ev->SetConfigName(mConfigName);
+                ev->SetAtRisk(atRisk);
                 LogInput::GetInstance()->PushEventQueue(ev);
                 break;
             }
@@ -806,7 +1021,7 @@ void ModifyHandler::Handle(const Event& event) {
             }
         } while (true);
 
-        if (!hasMoreData && readerArrayPtr->size() > (size_t)1) {
+        if (!hasMoreData && !parallelLane && readerArrayPtr->size() > (size_t)1) {
             // when a rotated reader finish its reading, it's unlikely that there will be data again
             // so release file fd as quick as possible (open again if new data coming)
             LOG_INFO(
@@ -819,8 +1034,7 @@ void ModifyHandler::Handle(const Event& event) {
                     "file size", reader->GetFileSize())("rotator reader pool size", mRotatorReaderMap.size() + 1));
             reader->CloseFilePtr();
             readerArrayPtr->pop_front();
-            mDevInodeReaderMap.erase(reader->GetDevInode());
-            mRotatorReaderMap[reader->GetDevInode()] = reader;
+            MoveToRotatorReader(reader);
             // need to push modify event again, but without dev inode
             // use head dev + inode
             Event* ev = new Event(event.GetSource(),
@@ -889,7 +1103,7 @@ void ModifyHandler::HandleTimeOut() {
                         "log reader queue name", (*iter)->GetLogPath())("log reader queue size", 0)(
                         "file device", (*iter)->GetDevInode().dev)("file inode", (*iter)->GetDevInode().inode)(
                         "file size", (*iter)->GetFileSize())("last file position", (*iter)->GetLastFilePos()));
-                mDevInodeReaderMap.erase((*iter)->GetDevInode());
+                EraseActiveReader((*iter)->GetDevInode());
                 readerArray.erase(iter);
             }
         }
@@ -904,6 +1118,10 @@ void ModifyHandler::HandleTimeOut() {
                               "action", "close")("reason", "file no new data timeout"));
             }
         }
+        if (readerArray.size() == 1 && HibernateReader(readerArray[0], nowTime)) {
+            actioned = true;
+            readerArray.clear();
+        }
         if (!actioned && readerArray.size() > 0) {
             LOG_DEBUG(sLogger,
                       ("HandleTimeOut filename", readerIter->first)("dir", readerArray[0]->GetLogPath().c_str())(
@@ -931,6 +1149,18 @@ bool ModifyHandler::DumpReaderMeta(bool isRotatorReader, bool checkConfigFlag) {
         for (DevInodeLogFileReaderMap::iterator it = mDevInodeReaderMap.begin(); it != mDevInodeReaderMap.end(); ++it) {
             it->second->DumpMetaToMem(checkConfigFlag);
         }
+        for (auto& item : mHibernatedReaderMap) {
+            if (checkConfigFlag) {
+                size_t index = item.second.mLogPath.rfind(PATH_SEPARATOR);
+                if (index == string::npos || index == item.second.mLogPath.size() - 1
+                    || ConfigManager::GetInstance()->FindBestMatch(item.second.mLogPath.substr(0, index),
+                                                                   item.second.mLogPath.substr(index + 1))
+                        == NULL) {
+                    continue;
+                }
+            }
+            CheckPointManager::Instance()->AddCheckPoint(MakeCheckPoint(item.first, item.second));
+        }
     } else {
         for (DevInodeLogFileReaderMap::iterator it = mRotatorReaderMap.begin(); it != mRotatorReaderMap.end(); ++it) {
             it->second->DumpMetaToMem(checkConfigFlag);
@@ -951,6 +1181,19 @@ void ModifyHandler::DeleteTimeoutReader() {
 void ModifyHandler::DeleteTimeoutReader(int32_t timeoutInterval) {
     time_t curTime = time(NULL);
 
+    for (auto iter = mHibernatedReaderMap.begin(); iter != mHibernatedReaderMap.end();) {
+        if (curTime - iter->second.mLastUpdateTime > timeoutInterval) {
+            LOG_INFO(sLogger,
+                     ("remove the hibernated reader", "current file has not been updated for a long time")(
+                         "config", mConfigName)("log reader queue name", iter->second.mLogPath)(
+                         "file device", iter->first.dev)("file inode", iter->first.inode));
+            FileReaderIndex::GetInstance()->Remove(iter->first, this, FileReaderIndex::READER_HIBERNATED);
+            iter = mHibernatedReaderMap.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
     NameLogFileReaderMap::iterator readerIter = mNameReaderMap.begin();
     for (; readerIter != mNameReaderMap.end();) {
         LogFileReaderPtrArray& readerArray = readerIter->second;
@@ -965,7 +1208,7 @@ void ModifyHandler::DeleteTimeoutReader(int32_t timeoutInterval) {
                                                                              readerArray.size() - 1)(
                              "file device", (*iter)->GetDevInode().dev)("file inode", (*iter)->GetDevInode().inode)(
                              "file size", (*iter)->GetFileSize())("last file position", (*iter)->GetLastFilePos()));
-                mDevInodeReaderMap.erase((*iter)->GetDevInode());
+                EraseActiveReader((*iter)->GetDevInode());
                 iter = readerArray.erase(iter);
             }
             // if current reader is not timeout, we should skip check last reader
@@ -984,6 +1227,73 @@ void ModifyHandler::DeleteTimeoutReader(int32_t timeoutInterval) {
     }
 }
 
+bool ModifyHandler::HibernateReader(const LogFileReaderPtr& reader, time_t curTime) {
+    if (INT32_FLAG(logreader_hibernate_interval) <= 0
+        || curTime - reader->GetLastUpdateTime() <= INT32_FLAG(logreader_hibernate_interval)
+        || !reader->IsHibernatable()) {
+        return false;
+    }
+    // Held by the reader array and mDevInodeReaderMap only, no log buffer depends on it.
+    if (reader.use_count() > 2) {
+        return false;
+    }
+    HibernatedReader& hibernated = mHibernatedReaderMap[reader->GetDevInode()];
+    hibernated.mLogPath = reader->GetLogPath();
+    if (reader->GetRealLogPath() != reader->GetLogPath()) {
+        hibernated.mRealLogPath = reader->GetRealLogPath();
+    }
+    hibernated.mLastFilePos = reader->GetLastFilePos();
+    hibernated.mSignatureHash = reader->GetSignatureHash();
+    hibernated.mSignatureSize = reader->GetSignatureSize();
+    hibernated.mLastUpdateTime = static_cast<int32_t>(reader->GetLastUpdateTime());
+    hibernated.mLastEventTime = reader->GetLastEventTime();
+    if (BOOL_FLAG(check_point_snapshot_dump_enable)) {
+        hibernated.mCheckPointSlot.reset(new CheckPointSnapshotTable::Slot);
+        hibernated.mCheckPointSlot->Publish(
+            CheckPointSnapshotTable::CheckPointSnapshot(MakeCheckPoint(reader->GetDevInode(), hibernated)));
+    }
+    LOG_DEBUG(sLogger,
+              ("hibernate the reader", "file has not been updated for some time and has been read")(
+                  "config", mConfigName)("log reader queue name", reader->GetLogPath())(
+                  "file device", reader->GetDevInode().dev)("file inode", reader->GetDevInode().inode)(
+                  "last file position", reader->GetLastFilePos())("hibernated count", mHibernatedReaderMap.size()));
+    FileReaderIndex::GetInstance()->Add(reader->GetDevInode(), this, FileReaderIndex::READER_HIBERNATED);
+    EraseActiveReader(reader->GetDevInode());
+    return true;
+}
+
+bool ModifyHandler::WakeUpReader(const DevInode& devInode) {
+    auto iter = mHibernatedReaderMap.find(devInode);
+    if (iter == mHibernatedReaderMap.end()) {
+        return false;
+    }
+    CheckPoint* checkPoint = MakeCheckPoint(devInode, iter->second);
+    // The file is being modified, do not skip the event.
+    checkPoint->mFileOpenFlag = 1;
+    CheckPointManager::Instance()->AddCheckPoint(checkPoint);
+    LOG_DEBUG(sLogger,
+              ("wake up the hibernated reader", iter->second.mLogPath)("config", mConfigName)(
+                  "file device", devInode.dev)("file inode", devInode.inode)("last file position",
+                                                                             iter->second.mLastFilePos));
+    mHibernatedReaderMap.erase(iter);
+    FileReaderIndex::GetInstance()->Remove(devInode, this, FileReaderIndex::READER_HIBERNATED);
+    return true;
+}
+
+CheckPoint* ModifyHandler::MakeCheckPoint(const DevInode& devInode, const HibernatedReader& hibernated) const {
+    CheckPoint* checkPoint = new CheckPoint(hibernated.mLogPath,
+                                            hibernated.mLastFilePos,
+                                            hibernated.mSignatureSize,
+                                            hibernated.mSignatureHash,
+                                            devInode,
+                                            mConfigName,
+                                            hibernated.mRealLogPath.empty() ? hibernated.mLogPath
+                                                                            : hibernated.mRealLogPath,
+                                            0);
+    checkPoint->mLastUpdateTime = hibernated.mLastEventTime;
+    return checkPoint;
+}
+
 void ModifyHandler::DeleteRollbackReader() {
     int32_t curTime = time(NULL);
     DevInodeLogFileReaderMap::iterator readerIter = mRotatorReaderMap.begin();
@@ -1007,7 +1317,7 @@ void ModifyHandler::DeleteRollbackReader() {
     }
     vector<DevInode>::iterator keyIter = deletedReaderKeys.begin();
     for (; keyIter != deletedReaderKeys.end(); ++keyIter)
-        mRotatorReaderMap.erase(*keyIter);
+        EraseRotatorReader(*keyIter);
 }
 
 } // namespace logtail
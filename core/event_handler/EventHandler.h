@@ -16,15 +16,18 @@
 
 #pragma once
 #include "reader/LogFileReader.h"
+#include "FileReaderIndex.h"
 #include <time.h>
 #include <map>
 #include <deque>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace logtail {
 
 class Config;
 class Event;
+class CheckPoint;
 
 struct RenameInfo {
     std::string mOldName;
@@ -38,6 +41,11 @@ public:
     virtual void Handle(const Event& event) = 0;
     virtual void HandleTimeOut() = 0;
     virtual bool DumpReaderMeta(bool isRotatorReader, bool checkConfigFlag) = 0;
+    // HasReaderOfConfigs returns true if the handler reads files for any of @configNames.
+    virtual bool HasReaderOfConfigs(const std::unordered_set<std::string>& configNames) const { return false; }
+    // PrepareBatchRead adds reads that Handle of @event will need to @requests, they are read in one batch
+    // before events are handled.
+    virtual void PrepareBatchRead(const Event& event, std::vector<BatchRead::Request*>& requests) {}
     virtual ~EventHandler() {}
 };
 
@@ -55,17 +63,60 @@ private:
     typedef std::unordered_map<std::string, LogFileReaderPtrArray> NameLogFileReaderMap;
     typedef std::unordered_map<DevInode, LogFileReaderPtr, DevInodeHash, DevInodeEqual> DevInodeLogFileReaderMap;
 
+    // HibernatedReader is what is left of an idle reader, enough to make its checkpoint. Config fields are
+    // not kept, they are the same for all readers of the handler.
+    struct HibernatedReader {
+        std::string mLogPath;
+        std::string mRealLogPath; // empty if it is the same as mLogPath
+        int64_t mLastFilePos;
+        uint64_t mSignatureHash;
+        uint32_t mSignatureSize;
+        int32_t mLastUpdateTime;
+        int32_t mLastEventTime;
+        // Keeps the checkpoint in CheckPointSnapshotTable while the reader is hibernated.
+        std::unique_ptr<CheckPointSnapshotTable::Slot> mCheckPointSlot;
+    };
+    typedef std::unordered_map<DevInode, HibernatedReader, DevInodeHash, DevInodeEqual> DevInodeHibernatedReaderMap;
+
     NameLogFileReaderMap mNameReaderMap;
     DevInodeLogFileReaderMap mDevInodeReaderMap;
     DevInodeLogFileReaderMap mRotatorReaderMap;
+    DevInodeHibernatedReaderMap mHibernatedReaderMap;
     uint64_t mReadFileTimeSlice;
+    bool mParallelRotatedRead;
+    // Last time the head of each rotate queue was read while the live file was read on its own lane, only used
+    // with mParallelRotatedRead.
+    std::unordered_map<DevInode, int32_t, DevInodeHash, DevInodeEqual> mCatchUpLaneTimes;
+    // Read budget of all files of the config, handlers are never called by two threads at the same time.
+    TokenBucket mConfigReadRateBucket;
     std::string mConfigName;
     int32_t mLastOverflowErrorTime;
 
+    // Readers are put into and taken out of the maps above by these, so FileReaderIndex is kept in sync.
+    void AddActiveReader(const DevInode& devInode, const LogFileReaderPtr& reader);
+    void EraseActiveReader(const DevInode& devInode);
+    void MoveToRotatorReader(const LogFileReaderPtr& reader);
+    void EraseRotatorReader(const DevInode& devInode);
+
+    // ScheduleCatchUpLane pushes a modify event of @head, the oldest file of its rotate queue, if it has not been
+    // read for rotated_read_lane_restart_interval, so rotated files are still caught up while the live file is read.
+    void ScheduleCatchUpLane(const Event& event, const LogFileReaderPtr& head);
+    static void EraseFromReaderArray(LogFileReaderPtrArray& readerArray, const LogFileReaderPtr& reader);
+
     void DeleteTimeoutReader();
     void DeleteTimeoutReader(int32_t timeoutInterval);
     void DeleteRollbackReader();
     void MakeSpaceForNewReader();
+    // HibernateReader releases @reader if it has been idle for logreader_hibernate_interval and is hibernatable,
+    // the caller removes it from its reader array if it returns true.
+    bool HibernateReader(const LogFileReaderPtr& reader, time_t curTime);
+    // WakeUpReader puts the checkpoint of the hibernated reader of @devInode back to CheckPointManager, so the
+    // reader created for next event continues from where it was.
+    bool WakeUpReader(const DevInode& devInode);
+    CheckPoint* MakeCheckPoint(const DevInode& devInode, const HibernatedReader& hibernated) const;
+    // GetReadRateDelay refills read budgets of @reader and the config to @nowMs, returns 0 if both have budget
+    // left, else milliseconds to wait for it.
+    uint64_t GetReadRateDelay(LogFileReader& reader, uint64_t nowMs);
 
 
     static bool CompareReaderByUpdateTime(const LogFileReader* left, const LogFileReader* right) {
@@ -89,6 +140,11 @@ public:
     virtual void Handle(const Event& event);
     virtual void HandleTimeOut();
     virtual bool DumpReaderMeta(bool isRotatorReader, bool checkConfigFlag);
+    virtual bool HasReaderOfConfigs(const std::unordered_set<std::string>& configNames) const {
+        return configNames.find(mConfigName) != configNames.end();
+    }
+    // Only MODIFY events with dev and inode are prepared, others would need a stat to find the reader.
+    virtual void PrepareBatchRead(const Event& event, std::vector<BatchRead::Request*>& requests);
 
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class ConfigUpdatorUnittest;
@@ -142,6 +198,7 @@ public:
     virtual void Handle(const Event& event);
     virtual void HandleTimeOut();
     virtual bool DumpReaderMeta(bool isRotatorReader, bool checkConfigFlag);
+    virtual bool HasReaderOfConfigs(const std::unordered_set<std::string>& configNames) const;
 
     ModifyHandler* GetOrCreateModifyHandler(const std::string& configName, Config* pConfig = NULL);
 
@@ -0,0 +1,74 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "FileReaderIndex.h"
+
+namespace logtail {
+
+void FileReaderIndex::Add(const DevInode& devInode, const ModifyHandler* handler, ReaderState state) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    EntryArray& entries = mEntries[devInode];
+    for (auto& entry : entries) {
+        if (entry.mHandler == handler) {
+            entry.mStates |= state;
+            return;
+        }
+    }
+    Entry entry = {handler, static_cast<uint32_t>(state)};
+    entries.push_back(entry);
+}
+
+void FileReaderIndex::Remove(const DevInode& devInode, const ModifyHandler* handler, ReaderState state) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto iter = mEntries.find(devInode);
+    if (iter == mEntries.end()) {
+        return;
+    }
+    EntryArray& entries = iter->second;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].mHandler != handler) {
+            continue;
+        }
+        entries[i].mStates &= ~static_cast<uint32_t>(state);
+        if (entries[i].mStates == 0) {
+            entries[i] = entries.back();
+            entries.pop_back();
+        }
+        break;
+    }
+    if (entries.empty()) {
+        mEntries.erase(iter);
+    }
+}
+
+uint32_t FileReaderIndex::GetStates(const DevInode& devInode, const ModifyHandler* handler) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto iter = mEntries.find(devInode);
+    if (iter == mEntries.end()) {
+        return 0;
+    }
+    for (const auto& entry : iter->second) {
+        if (entry.mHandler == handler) {
+            return entry.mStates;
+        }
+    }
+    return 0;
+}
+
+size_t FileReaderIndex::GetFileCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
+
+} // namespace logtail
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "common/DevInode.h"
+
+namespace logtail {
+
+class ModifyHandler;
+
+// FileReaderIndex maps dev and inode of files to the handlers holding readers of them, across all configs. The
+// state of a file in a handler, active, rotated or hibernated, is found by one lookup instead of probing each map
+// of the handler, and a file read by several configs is known without asking every handler.
+//
+// Handlers of different configs run on different threads, so it is locked.
+class FileReaderIndex {
+public:
+    enum ReaderState {
+        READER_ACTIVE = 1, // in mDevInodeReaderMap
+        READER_ROTATOR = 2, // in mRotatorReaderMap
+        READER_HIBERNATED = 4, // in mHibernatedReaderMap
+    };
+
+    static FileReaderIndex* GetInstance() {
+        static FileReaderIndex* sIndex = new FileReaderIndex;
+        return sIndex;
+    }
+
+    void Add(const DevInode& devInode, const ModifyHandler* handler, ReaderState state);
+    void Remove(const DevInode& devInode, const ModifyHandler* handler, ReaderState state);
+    // GetStates returns ReaderState bits of readers of @devInode held by @handler, 0 if none.
+    uint32_t GetStates(const DevInode& devInode, const ModifyHandler* handler) const;
+    size_t GetFileCount() const;
+
+private:
+    FileReaderIndex() = default;
+
+    struct Entry {
+        const ModifyHandler* mHandler;
+        uint32_t mStates;
+    };
+    // Few configs read the same file, entries are scanned.
+    typedef std::vector<Entry> EntryArray;
+
+    mutable std::mutex mMutex;
+    std::unordered_map<DevInode, EntryArray, DevInodeHash, DevInodeEqual> mEntries;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class ModifyHandlerUnittest;
+#endif
+};
+
+} // namespace logtail
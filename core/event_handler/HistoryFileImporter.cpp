@@ -13,19 +13,40 @@
 // limitations under the License.
 
 #include "HistoryFileImporter.h"
-#include "common/Thread.h"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <json/json.h>
 #include "common/TimeUtil.h"
 #include "common/RuntimeUtil.h"
 #include "common/FileSystemUtil.h"
+#include "common/Flags.h"
 #include "config_manager/ConfigManager.h"
 #include "processor/LogProcess.h"
 #include "logger/Logger.h"
 #include "reader/LogFileReader.h"
+#include "reader/FileTimeIndex.h"
+
+DEFINE_FLAG_INT32(history_file_mmap_window_size,
+                  "mmap window size to read history files, 0 means reading them by pread",
+                  64 * 1024 * 1024);
+DEFINE_FLAG_INT32(history_file_import_thread_count, "threads to read ranges of history files", 4);
+DEFINE_FLAG_INT64(history_file_range_size,
+                  "history files larger than it are split into ranges read concurrently, bytes",
+                  256 * 1024 * 1024);
+DEFINE_FLAG_INT64(history_file_max_bytes_per_sec, "read limit of history files per logstore, 0 means unlimited", 0);
+DEFINE_FLAG_INT32(history_file_checkpoint_dump_interval, "seconds", 5);
 
 namespace logtail {
 
 HistoryFileImporter::HistoryFileImporter() {
-    LOG_INFO(sLogger, ("HistoryFileImporter", "init"));
+    LOG_INFO(sLogger, ("HistoryFileImporter", "init")("threads", INT32_FLAG(history_file_import_thread_count)));
+    LoadCheckPoint();
+    for (int32_t i = 0; i < std::max(INT32_FLAG(history_file_import_thread_count), 1); ++i) {
+        mWorkers.push_back(CreateThread([this]() { WorkerRun(); }));
+    }
     static auto _doNotQuitThread = CreateThread([this]() { Run(); });
 }
 
@@ -43,80 +64,282 @@ void HistoryFileImporter::Run() {
             LOG_WARNING(sLogger, ("get all files", "failed"));
             continue;
         }
-        ProcessEvent(event, objList);
+
+        std::shared_ptr<ImportJob> job(new ImportJob);
+        job->mEvent = event;
+        job->mFileCount = objList.size();
+        job->mStartTime = GetCurrentTimeInMilliSeconds();
+        std::vector<ImportTask> tasks;
+        for (const auto& fileName : objList) {
+            std::vector<HistoryFileRange> ranges;
+            SplitFile(event, fileName, ranges);
+            for (const auto& range : ranges) {
+                job->mCheckPointKeys.push_back(range.CheckPointKey());
+                if (range.mReadPos < range.mEndPos) {
+                    tasks.push_back(ImportTask{job, range});
+                }
+            }
+        }
+        LOG_INFO(sLogger,
+                 ("begin load history files, count", objList.size())("ranges", tasks.size())(
+                     "file list", ToString(objList)));
+        if (tasks.empty()) {
+            LOG_INFO(sLogger, ("load history files", "done")("event", event.String()));
+            continue;
+        }
+        job->mPendingRanges = static_cast<int>(tasks.size());
+        std::lock_guard<std::mutex> lock(mTaskMux);
+        mTasks.insert(mTasks.end(), tasks.begin(), tasks.end());
+        mTaskCond.notify_all();
     }
 }
 
-void HistoryFileImporter::LoadCheckPoint() {
-    std::string historyDataPath = GetProcessExecutionDir() + "history_file_checkpoint";
-    FILE* readPtr = fopen(historyDataPath.c_str(), "r");
-    if (readPtr != NULL) {
-        fclose(readPtr);
+void HistoryFileImporter::WorkerRun() {
+    while (true) {
+        ImportTask task;
+        {
+            std::unique_lock<std::mutex> lock(mTaskMux);
+            mTaskCond.wait(lock, [this]() { return !mTasks.empty(); });
+            task = mTasks.front();
+            mTasks.pop_front();
+        }
+        ProcessRange(task);
+        FinishRange(task);
     }
 }
 
-void HistoryFileImporter::ProcessEvent(const HistoryFileEvent& event, const std::vector<std::string>& fileNames) {
-    static LogProcess* logProcess = LogProcess::GetInstance();
-
-    auto& config = event.mConfig;
-    LOG_INFO(sLogger, ("begin load history files, count", fileNames.size())("file list", ToString(fileNames)));
-    for (size_t i = 0; i < fileNames.size(); ++i) {
-        auto startTime = GetCurrentTimeInMilliSeconds();
-        const std::string& fileName = fileNames[i];
-        const std::string filePath = PathJoin(event.mDirName, fileName);
-        LOG_INFO(sLogger,
-                 ("[progress]", std::string("[") + ToString(i + 1) + "/" + ToString(fileNames.size()) + "]")(
-                     "process", "begin")("file", filePath));
-
-        // create reader
-        DevInode devInode = GetFileDevInode(filePath);
-        if (!devInode.IsValid()) {
-            LOG_WARNING(sLogger,
-                        ("[progress]", std::string("[") + ToString(i + 1) + "/" + ToString(fileNames.size()) + "]")(
-                            "process", "failed")("file", filePath)("reason", "invalid dev inode"));
-            continue;
+int64_t HistoryFileImporter::FindLineBoundary(int fd, int64_t pos, int64_t fileSize) {
+    char buffer[64 * 1024];
+    while (pos < fileSize) {
+        ssize_t n = pread(fd, buffer, std::min<int64_t>(sizeof(buffer), fileSize - pos), pos);
+        if (n <= 0) {
+            return fileSize;
+        }
+        const char* newLine = static_cast<const char*>(memchr(buffer, '\n', n));
+        if (newLine != NULL) {
+            return pos + (newLine - buffer) + 1;
         }
+        pos += n;
+    }
+    return fileSize;
+}
 
-        LogFileReaderPtr readerSharePtr(config->CreateLogFileReader(event.mDirName, fileName, devInode, true));
-        if (readerSharePtr == NULL) {
-            LOG_WARNING(sLogger,
-                        ("[progress]", std::string("[") + ToString(i + 1) + "/" + ToString(fileNames.size()) + "]")(
-                            "process", "failed")("file", filePath)("reason", "create log file reader failed"));
-            continue;
+void HistoryFileImporter::SplitFile(const HistoryFileEvent& event,
+                                    const std::string& fileName,
+                                    std::vector<HistoryFileRange>& ranges) {
+    const std::string filePath = PathJoin(event.mDirName, fileName);
+    DevInode devInode = GetFileDevInode(filePath);
+    if (!devInode.IsValid()) {
+        LOG_WARNING(sLogger, ("split history file", "failed")("file", filePath)("reason", "invalid dev inode"));
+        return;
+    }
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG_WARNING(sLogger, ("split history file", "failed")("file", filePath)("errno", errno));
+        return;
+    }
+    struct stat buf;
+    if (fstat(fd, &buf) != 0) {
+        LOG_WARNING(sLogger, ("split history file", "failed")("file", filePath)("errno", errno));
+        close(fd);
+        return;
+    }
+    const int64_t fileSize = buf.st_size;
+    const std::string& logBeginReg = event.mConfig->mLogBeginReg;
+    // A range may start in the middle of a multiline log.
+    const bool splittable = logBeginReg.empty() || logBeginReg == ".*";
+    const int64_t rangeSize = std::max<int64_t>(INT64_FLAG(history_file_range_size), 1024 * 1024);
+
+    int64_t pos = std::min<int64_t>(event.mStartPos, fileSize);
+    if (event.mStartTime > 0 && !event.mConfig->mTimeFormat.empty()) {
+        // Not cached, so ranges and their checkpoint keys are the same each time the file is split.
+        FileTimeIndex index(event.mConfig->mTimeFormat);
+        auto read = [fd](char* buf, size_t size, int64_t offset) {
+            const ssize_t nbytes = pread(fd, buf, size, offset);
+            return nbytes > 0 ? static_cast<size_t>(nbytes) : 0;
+        };
+        const int64_t timePos = index.Seek(read, fileSize, event.mStartTime);
+        if (timePos < 0) {
+            LOG_WARNING(sLogger, ("seek start time of history file", "failed")("file", filePath));
+        } else {
+            pos = std::max(pos, timePos);
         }
-        if (!readerSharePtr->UpdateFilePtr()) {
-            LOG_WARNING(sLogger,
-                        ("[progress]", std::string("[") + ToString(i + 1) + "/" + ToString(fileNames.size()) + "]")(
-                            "process", "failed")("file", filePath)("reason", "open file ptr failed"));
-            continue;
+    }
+    std::lock_guard<std::mutex> lock(mCheckPointMux);
+    while (pos < fileSize) {
+        HistoryFileRange range;
+        range.mFileName = fileName;
+        range.mDevInode = devInode;
+        range.mStartPos = pos;
+        range.mEndPos = splittable && fileSize - pos > rangeSize ? FindLineBoundary(fd, pos + rangeSize, fileSize)
+                                                                  : fileSize;
+        range.mReadPos = pos;
+        auto iter = mCheckPoints.find(range.CheckPointKey());
+        if (iter != mCheckPoints.end()) {
+            range.mReadPos = std::min(std::max(iter->second, range.mStartPos), range.mEndPos);
         }
-        readerSharePtr->SetLastFilePos(event.mStartPos);
-        int64_t fileSize = 0;
-        readerSharePtr->CheckFileSignatureAndOffset(fileSize);
-
-        bool doneFlag = false;
-        while (true) {
-            while (!logProcess->IsValidToReadLog(readerSharePtr->GetLogstoreKey())) {
-                usleep(1000 * 10);
+        ranges.push_back(range);
+        pos = range.mEndPos;
+    }
+    close(fd);
+    LOG_INFO(sLogger, ("split history file", filePath)("size", fileSize)("ranges", ranges.size()));
+}
+
+void HistoryFileImporter::WaitBudget(const LogstoreFeedBackKey& key) {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mBudgetMux);
+            TokenBucket& bucket = mBudgets[key];
+            bucket.SetRate(INT64_FLAG(history_file_max_bytes_per_sec));
+            bucket.Refill(GetCurrentTimeInMilliSeconds());
+            if (bucket.HasToken()) {
+                return;
             }
-            LogBuffer* logBuffer = NULL;
-            readerSharePtr->ReadLog(logBuffer);
-            if (logBuffer != NULL) {
-                logBuffer->logFileReader = readerSharePtr;
-                logProcess->PushBuffer(logBuffer, 100000000);
-            } else {
-                // when ReadLog return false, retry once
-                if (doneFlag) {
-                    break;
-                }
-                doneFlag = true;
+        }
+        usleep(10 * 1000);
+    }
+}
+
+void HistoryFileImporter::ConsumeBudget(const LogstoreFeedBackKey& key, int64_t bytes) {
+    std::lock_guard<std::mutex> lock(mBudgetMux);
+    mBudgets[key].Consume(bytes);
+}
+
+void HistoryFileImporter::ProcessRange(const ImportTask& task) {
+    static LogProcess* logProcess = LogProcess::GetInstance();
+
+    const HistoryFileEvent& event = task.mJob->mEvent;
+    const HistoryFileRange& range = task.mRange;
+    auto startTime = GetCurrentTimeInMilliSeconds();
+    const std::string filePath = PathJoin(event.mDirName, range.mFileName);
+    const std::string progress = std::string("[") + ToString(range.mStartPos) + "," + ToString(range.mEndPos) + ")";
+    LOG_INFO(sLogger, ("[progress]", progress)("process", "begin")("file", filePath)("read pos", range.mReadPos));
+
+    DevInode devInode = GetFileDevInode(filePath);
+    if (devInode != range.mDevInode) {
+        LOG_WARNING(sLogger,
+                    ("[progress]", progress)("process", "failed")("file", filePath)("reason", "file is changed"));
+        return;
+    }
+    LogFileReaderPtr readerSharePtr(
+        event.mConfig->CreateLogFileReader(event.mDirName, range.mFileName, devInode, true));
+    if (readerSharePtr == NULL) {
+        LOG_WARNING(sLogger,
+                    ("[progress]", progress)("process", "failed")("file", filePath)(
+                        "reason", "create log file reader failed"));
+        return;
+    }
+    if (!readerSharePtr->UpdateFilePtr()) {
+        LOG_WARNING(sLogger,
+                    ("[progress]", progress)("process", "failed")("file", filePath)("reason", "open file ptr failed"));
+        return;
+    }
+    if (INT32_FLAG(history_file_mmap_window_size) > 0) {
+        readerSharePtr->EnableMmapRead(INT32_FLAG(history_file_mmap_window_size));
+    }
+    readerSharePtr->SetLastFilePos(range.mReadPos);
+    readerSharePtr->SetReadEndPos(range.mEndPos);
+    int64_t fileSize = 0;
+    readerSharePtr->CheckFileSignatureAndOffset(fileSize);
+
+    const LogstoreFeedBackKey logstoreKey = readerSharePtr->GetLogstoreKey();
+    const std::string checkPointKey = range.CheckPointKey();
+    bool doneFlag = false;
+    while (readerSharePtr->GetLastFilePos() < range.mEndPos) {
+        while (!logProcess->IsValidToReadLog(logstoreKey)) {
+            usleep(1000 * 10);
+        }
+        WaitBudget(logstoreKey);
+        const int64_t lastPos = readerSharePtr->GetLastFilePos();
+        LogBuffer* logBuffer = NULL;
+        readerSharePtr->ReadLog(logBuffer);
+        ConsumeBudget(logstoreKey, readerSharePtr->GetLastFilePos() - lastPos);
+        if (logBuffer != NULL) {
+            logBuffer->logFileReader = readerSharePtr;
+            logProcess->PushBuffer(logBuffer, 100000000);
+            // Saved as read, buffers in process queue are lost on crash like other readers.
+            std::lock_guard<std::mutex> lock(mCheckPointMux);
+            mCheckPoints[checkPointKey] = readerSharePtr->GetLastFilePos();
+            mCheckPointDirty = true;
+        } else {
+            // when ReadLog return false, retry once
+            if (doneFlag) {
+                break;
             }
+            doneFlag = true;
         }
-        auto doneTime = GetCurrentTimeInMilliSeconds();
-        LOG_INFO(sLogger,
-                 ("[progress]", std::string("[") + ToString(i + 1) + "/" + ToString(fileNames.size()) + "]")(
-                     "process", "done")("file", filePath)("file size", fileSize)(
-                     "offset", readerSharePtr->GetLastFilePos())("time(ms)", doneTime - startTime));
+        DumpCheckPoint(false);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mCheckPointMux);
+        mCheckPoints[checkPointKey] = std::max(readerSharePtr->GetLastFilePos(), range.mEndPos);
+        mCheckPointDirty = true;
+    }
+    auto doneTime = GetCurrentTimeInMilliSeconds();
+    LOG_INFO(sLogger,
+             ("[progress]", progress)("process", "done")("file", filePath)("file size", fileSize)(
+                 "offset", readerSharePtr->GetLastFilePos())("time(ms)", doneTime - startTime));
+}
+
+void HistoryFileImporter::FinishRange(const ImportTask& task) {
+    ImportJob& job = *task.mJob;
+    if (--job.mPendingRanges > 0) {
+        DumpCheckPoint(false);
+        return;
     }
+    // Checkpoints only resume unfinished events, the same event pushed again after done is imported again.
+    {
+        std::lock_guard<std::mutex> lock(mCheckPointMux);
+        for (const auto& key : job.mCheckPointKeys) {
+            mCheckPoints.erase(key);
+        }
+        mCheckPointDirty = true;
+    }
+    DumpCheckPoint(true);
+    LOG_INFO(sLogger,
+             ("load history files", "done")("event", job.mEvent.String())("file count", job.mFileCount)(
+                 "time(ms)", GetCurrentTimeInMilliSeconds() - job.mStartTime));
 }
+
+void HistoryFileImporter::LoadCheckPoint() {
+    std::string historyDataPath = GetProcessExecutionDir() + "history_file_checkpoint";
+    std::string content;
+    if (!ReadFileContent(historyDataPath, content, 64 * 1024 * 1024)) {
+        return;
+    }
+    Json::Value root;
+    Json::Reader reader;
+    if (!reader.parse(content, root) || !root.isObject()) {
+        LOG_WARNING(sLogger, ("invalid history file checkpoint", historyDataPath));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mCheckPointMux);
+    for (const auto& key : root.getMemberNames()) {
+        if (root[key].isInt64()) {
+            mCheckPoints[key] = root[key].asInt64();
+        }
+    }
+    LOG_INFO(sLogger, ("load history file checkpoint, count", mCheckPoints.size()));
+}
+
+void HistoryFileImporter::DumpCheckPoint(bool force) {
+    std::lock_guard<std::mutex> lock(mCheckPointMux);
+    int64_t now = time(NULL);
+    if (!mCheckPointDirty || (!force && now - mLastDumpTime < INT32_FLAG(history_file_checkpoint_dump_interval))) {
+        return;
+    }
+    mLastDumpTime = now;
+    mCheckPointDirty = false;
+    Json::Value root(Json::objectValue);
+    for (const auto& item : mCheckPoints) {
+        root[item.first] = Json::Int64(item.second);
+    }
+    std::string historyDataPath = GetProcessExecutionDir() + "history_file_checkpoint";
+    std::string tmpPath = historyDataPath + ".tmp";
+    if (!OverwriteFile(tmpPath, Json::FastWriter().write(root))
+        || rename(tmpPath.c_str(), historyDataPath.c_str()) != 0) {
+        LOG_WARNING(sLogger, ("dump history file checkpoint", "failed")("errno", errno));
+    }
+}
+
 } // namespace logtail
@@ -15,11 +15,19 @@
  */
 
 #pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include "common/StringTools.h"
 #include "common/CircularBuffer.h"
+#include "common/DevInode.h"
+#include "common/LogstoreFeedbackKey.h"
+#include "common/Thread.h"
+#include "common/TokenBucket.h"
 #include "config/Config.h"
 
 namespace logtail {
@@ -29,9 +37,11 @@ struct HistoryFileEvent {
     std::string mDirName;
     std::string mFileName;
     int64_t mStartPos;
+    // unix seconds, files are imported from the first log not before it if set
+    int32_t mStartTime;
     std::shared_ptr<Config> mConfig;
 
-    HistoryFileEvent() : mStartPos(0) {}
+    HistoryFileEvent() : mStartPos(0), mStartTime(0) {}
 
     std::string String() const {
         return std::string("config:") + mConfigName + ", dir:" + mDirName + ", filename:" + mFileName,
@@ -39,6 +49,25 @@ struct HistoryFileEvent {
     }
 };
 
+// HistoryFileRange is a part of a history file in [mStartPos, mEndPos), both ends are at line boundaries.
+// Files of multiline logs are not split, their range ends at the file size when they are listed.
+struct HistoryFileRange {
+    std::string mFileName;
+    DevInode mDevInode;
+    int64_t mStartPos = 0;
+    int64_t mEndPos = 0;
+    // position to read from, it is after mStartPos if the range is resumed from checkpoint
+    int64_t mReadPos = 0;
+
+    std::string CheckPointKey() const {
+        return ToString(mDevInode.dev) + ":" + ToString(mDevInode.inode) + ":" + ToString(mStartPos);
+    }
+};
+
+// HistoryFileImporter imports files of local events. Large files are split into ranges at line boundaries,
+// ranges of all files are read by several threads through mmap, reading of each logstore is limited by
+// history_file_max_bytes_per_sec, and progress of each range is saved as checkpoint, so an event pushed
+// again after restart continues from where it stopped.
 class HistoryFileImporter {
 public:
     HistoryFileImporter();
@@ -51,18 +80,57 @@ public:
     void PushEvent(const HistoryFileEvent& event);
 
 private:
+    struct ImportJob {
+        HistoryFileEvent mEvent;
+        std::atomic_int mPendingRanges{0};
+        size_t mFileCount = 0;
+        int64_t mStartTime = 0;
+        std::vector<std::string> mCheckPointKeys;
+    };
+
+    struct ImportTask {
+        std::shared_ptr<ImportJob> mJob;
+        HistoryFileRange mRange;
+    };
+
     void Run();
+    void WorkerRun();
 
-    // @todo
     void LoadCheckPoint();
+    void DumpCheckPoint(bool force);
+
+    // SplitFile splits @fileName into ranges of history_file_range_size, ranges before the checkpoint
+    // are skipped. If mStartTime of @event is set, the first range starts at the first log not before it.
+    void SplitFile(const HistoryFileEvent& event, const std::string& fileName, std::vector<HistoryFileRange>& ranges);
+    // FindLineBoundary returns the position after the first '\n' at or after @pos, or @fileSize.
+    static int64_t FindLineBoundary(int fd, int64_t pos, int64_t fileSize);
 
-    // @todo multi line, flush last buffer
-    void ProcessEvent(const HistoryFileEvent& event, const std::vector<std::string>& fileNames);
+    void ProcessRange(const ImportTask& task);
+    // WaitBudget blocks until logstore @key has budget to read, ConsumeBudget charges bytes read.
+    void WaitBudget(const LogstoreFeedBackKey& key);
+    void ConsumeBudget(const LogstoreFeedBackKey& key, int64_t bytes);
+    void FinishRange(const ImportTask& task);
 
     static const int32_t HISTORY_EVENT_MAX = 10000;
     CircularBufferSem<HistoryFileEvent, HISTORY_EVENT_MAX> mEventQueue;
+
+    std::mutex mTaskMux;
+    std::condition_variable mTaskCond;
+    std::deque<ImportTask> mTasks;
+    std::vector<ThreadPtr> mWorkers;
+
+    std::mutex mBudgetMux;
+    std::unordered_map<LogstoreFeedBackKey, TokenBucket> mBudgets;
+
+    std::mutex mCheckPointMux;
+    // key of range -> read offset
     std::unordered_map<std::string, int64_t> mCheckPoints;
-    FILE* mCheckPointPtr;
+    bool mCheckPointDirty = false;
+    int64_t mLastDumpTime = 0;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class HistoryFileImporterUnittest;
+#endif
 };
 
 } // namespace logtail
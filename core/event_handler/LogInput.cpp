@@ -14,6 +14,7 @@
 
 #include "LogInput.h"
 #include <time.h>
+#include <algorithm>
 #include "common/LogtailCommonFlags.h"
 #include "common/RuntimeUtil.h"
 #include "common/StringTools.h"
@@ -36,8 +37,10 @@
 #include "event/BlockEventManager.h"
 #include "config_manager/ConfigManager.h"
 #include "logger/Logger.h"
+#include "common/ThreadAffinity.h"
 #include "EventHandler.h"
 #include "HistoryFileImporter.h"
+#include "ShardedEventProcessor.h"
 
 using namespace std;
 
@@ -49,13 +52,28 @@ DEFINE_FLAG_INT32(check_handler_timeout_interval, "seconds", 180);
 DEFINE_FLAG_INT32(dump_inotify_watcher_interval, "seconds", 180);
 DEFINE_FLAG_INT32(clear_config_match_interval, "seconds", 600);
 DEFINE_FLAG_INT32(check_block_event_interval, "seconds", 1);
+DEFINE_FLAG_INT32(log_input_cpu_pace_ms,
+                  "pause of reading per event for each 1.0 of cpu usage level over limit, milliseconds",
+                  200);
 DEFINE_FLAG_STRING(local_event_data_file_name, "local event data file name", "local_event.json");
 DEFINE_FLAG_INT32(read_local_event_interval, "seconds", 60);
 DEFINE_FLAG_BOOL(force_close_file_on_container_stopped,
                  "whether close file handler immediately when associate container stopped",
                  false);
+DEFINE_FLAG_INT32(event_handle_thread_count,
+                  "threads to handle modify events, events are sharded by handler, 0 means in LogInput thread",
+                  0);
+DEFINE_FLAG_INT32(event_handle_batch_size, "max count of modify events handled by threads at a time", 1024);
+DEFINE_FLAG_BOOL(event_priority_enable,
+                 "process create, delete, rotation and other non-modify events before queued modify events",
+                 false);
+DEFINE_FLAG_BOOL(at_risk_read_priority_enable,
+                 "read deleted, rotated and container stopped files with unread data before other modify events",
+                 false);
+DEFINE_FLAG_INT32(register_pending_dirs_budget_ms, "max time to register deferred dirs in a loop, ms", 20);
 
 DECLARE_FLAG_BOOL(global_network_success);
+DECLARE_FLAG_INT32(reader_fd_budget);
 DECLARE_FLAG_BOOL(send_prefer_real_ip);
 DECLARE_FLAG_BOOL(ilogtail_discard_old_data);
 
@@ -121,7 +139,8 @@ void LogInput::HoldOn() {
 }
 
 void LogInput::TryReadEvents(bool forceRead) {
-    if (mInteruptFlag)
+    // Events are only read by LogInput thread, handlers on ShardedEventProcessor threads skip it.
+    if (mInteruptFlag || ShardedEventProcessor::IsWorkerThread())
         return;
 
     if (!forceRead) {
@@ -154,52 +173,29 @@ void LogInput::TryReadEvents(bool forceRead) {
     mLastReadEventTime = ((int32_t)time(NULL));
 }
 
+// FlowControl paces reading only when CPU usage (or resource pressure) exceeds its budget, the pause grows
+// with the overshoot and ends as soon as the level drops back, events are still read while pausing.
 void LogInput::FlowControl() {
-    const static int32_t FLOW_CONTROL_SLEEP_MICROSECONDS = 20 * 1000; // 20ms
-    const static int32_t MAX_SLEEP_COUNT = 50; // 1s
-    static int32_t sleepCount = 10;
-    static int32_t lastCheckTime = 0;
-    int32_t i = 0;
-    while (i < sleepCount) {
-        if (mInteruptFlag)
-            return;
-        usleep(FLOW_CONTROL_SLEEP_MICROSECONDS);
-        ++i;
-        if (i % 5 == 0)
-            TryReadEvents(true);
+    const static int32_t FLOW_CONTROL_SLICE_MS = 20;
+    const static int32_t MAX_PAUSE_MS = 1000;
+    static int64_t sLastCheckMs = 0;
+    static double sCpuUsageLevel = 0.0;
+
+    int64_t curMs = GetCurrentTimeInMilliSeconds();
+    if (curMs - sLastCheckMs >= 100) {
+        sLastCheckMs = curMs;
+        // Memory pressure also slows down reading when degradation is enabled.
+        sCpuUsageLevel = std::max<double>(LogtailMonitor::Instance()->GetRealtimeCpuLevel(),
+                                          LogtailMonitor::Instance()->GetResourcePressure());
     }
-
-    if (mInteruptFlag)
+    if (sCpuUsageLevel < 1.0)
         return;
-    int32_t curTime = time(NULL);
-    if (curTime - lastCheckTime >= 1) {
-        lastCheckTime = curTime;
-        double cpuUsageLevel = LogtailMonitor::Instance()->GetRealtimeCpuLevel();
-        if (cpuUsageLevel >= 1.5) {
-            sleepCount += 5;
-            if (sleepCount > MAX_SLEEP_COUNT)
-                sleepCount = MAX_SLEEP_COUNT;
-        } else if (cpuUsageLevel >= 1.2) {
-            sleepCount += 2;
-            if (sleepCount > MAX_SLEEP_COUNT)
-                sleepCount = MAX_SLEEP_COUNT;
-        } else if (cpuUsageLevel >= 1.0) {
-            if (sleepCount < MAX_SLEEP_COUNT)
-                ++sleepCount;
-        } else if (cpuUsageLevel >= 0.9) {
-        } else if (cpuUsageLevel >= 0.6) {
-            if (sleepCount > 0)
-                --sleepCount;
-        } else if (cpuUsageLevel >= 0.3) {
-            sleepCount -= 2;
-            if (sleepCount < 0)
-                sleepCount = 0;
-        } else {
-            sleepCount -= 5;
-            if (sleepCount < 0)
-                sleepCount = 0;
-        }
-        LOG_DEBUG(sLogger, ("cpuUsageLevel", cpuUsageLevel)("sleepCount", sleepCount));
+
+    int32_t pauseMs = std::min<int32_t>(MAX_PAUSE_MS, (sCpuUsageLevel - 1.0) * INT32_FLAG(log_input_cpu_pace_ms));
+    LOG_DEBUG(sLogger, ("cpuUsageLevel", sCpuUsageLevel)("pauseMs", pauseMs));
+    for (int32_t pausedMs = 0; pausedMs < pauseMs && !mInteruptFlag; pausedMs += FLOW_CONTROL_SLICE_MS) {
+        usleep(std::min(FLOW_CONTROL_SLICE_MS, pauseMs - pausedMs) * 1000);
+        TryReadEvents(false);
     }
 }
 
@@ -264,6 +260,9 @@ bool LogInput::ReadLocalEvents() {
         historyFileEvent.mDirName = source;
         historyFileEvent.mFileName = object;
         historyFileEvent.mConfigName = configName;
+        if (eventItem.isMember("start_time") && eventItem["start_time"].isUInt()) {
+            historyFileEvent.mStartTime = static_cast<int32_t>(eventItem["start_time"].asUInt());
+        }
         historyFileEvent.mConfig.reset(new Config(*pConfig));
 
         vector<string> objList;
@@ -305,6 +304,9 @@ void LogInput::ProcessEvent(EventDispatcher* dispatcher, Event* ev) {
     if (ev->IsTimeout())
         dispatcher->UnregisterAllDir(source);
     else {
+        // A symbolic link dir may be replaced or removed, it is resolved again by next CheckSymbolicLink.
+        if (!object.empty() && (ev->IsCreate() || ev->IsMoveFrom() || ev->IsMoveTo() || ev->IsDeleted()))
+            dispatcher->InvalidateSymlinkState(source, object);
         if (ev->IsDir()
             && (ev->IsMoveFrom() || (ev->IsContainerStopped() && BOOL_FLAG(force_close_file_on_container_stopped)))) {
             string path = source;
@@ -338,6 +340,48 @@ void LogInput::ProcessEvent(EventDispatcher* dispatcher, Event* ev) {
     delete ev;
 }
 
+void LogInput::ProcessModifyEvents(EventDispatcher* dispatcher, Event* ev) {
+    const size_t batchSize = static_cast<size_t>(std::max(INT32_FLAG(event_handle_batch_size), 1));
+    vector<ShardedEventProcessor::Task> tasks;
+    vector<Event*> noHandlerEvents;
+    Event* nextEvent = NULL;
+    while (true) {
+        EventHandler* handler = dispatcher->GetHandler(ev->GetSource().c_str());
+        if (handler) {
+            tasks.push_back(std::make_pair(handler, ev));
+        } else {
+            noHandlerEvents.push_back(ev);
+        }
+        if (tasks.size() + noHandlerEvents.size() >= batchSize) {
+            break;
+        }
+        ev = PopEventQueue();
+        if (ev == NULL) {
+            break;
+        }
+        ++mEventProcessCount;
+        if (ev->GetType() != EVENT_MODIFY) {
+            nextEvent = ev;
+            break;
+        }
+    }
+
+    // Dispatcher is not changed by handlers of MODIFY events, so it is safe to look up handlers
+    // before and propagate timeout after.
+    mEventProcessor->Process(tasks);
+    for (auto& task : tasks) {
+        dispatcher->PropagateTimeout(task.second->GetSource().c_str());
+        delete task.second;
+    }
+    // Directories are registered for them in ProcessEvent, which changes dispatcher.
+    for (auto noHandlerEvent : noHandlerEvents) {
+        ProcessEvent(dispatcher, noHandlerEvent);
+    }
+    if (nextEvent != NULL) {
+        ProcessEvent(dispatcher, nextEvent);
+    }
+}
+
 void LogInput::CheckAndUpdateCriticalMetric(int32_t curTime) {
 #ifndef LOGTAIL_RUNTIME_PLUGIN
     int32_t lastGetConfigTime = ConfigManager::GetInstance()->GetLastConfigGetTime();
@@ -393,6 +437,11 @@ void LogInput::CheckAndUpdateCriticalMetric(int32_t curTime) {
     LogtailMonitor::Instance()->UpdateMetric("event_tps", 1.0 * mEventProcessCount / (curTime - mLastUpdateMetricTime));
     LogtailMonitor::Instance()->UpdateMetric("open_fd",
                                              GloablFileDescriptorManager::GetInstance()->GetOpenedFilePtrSize());
+    uint64_t fdEvictCount = 0;
+    uint64_t fdReopenCount = 0;
+    GloablFileDescriptorManager::GetInstance()->GetEvictStatus(fdEvictCount, fdReopenCount);
+    LogtailMonitor::Instance()->UpdateMetric("fd_evict", fdEvictCount);
+    LogtailMonitor::Instance()->UpdateMetric("fd_reopen", fdReopenCount);
     LogtailMonitor::Instance()->UpdateMetric("register_handler", EventDispatcher::GetInstance()->GetHandlerCount());
     LogtailMonitor::Instance()->UpdateMetric("reader_count", CheckPointManager::Instance()->GetReaderCount());
     LogtailMonitor::Instance()->UpdateMetric("multi_config", AppConfig::GetInstance()->IsAcceptMultiConfig());
@@ -401,6 +450,7 @@ void LogInput::CheckAndUpdateCriticalMetric(int32_t curTime) {
 
 void* LogInput::ProcessLoop() {
     LOG_DEBUG(sLogger, ("LogInputThread", "Start"));
+    ThreadAffinity::GetInstance()->BindCurrentThread(THREAD_ROLE_INPUT, 0);
     EventDispatcher* dispatcher = EventDispatcher::GetInstance();
     dispatcher->StartTimeCount();
     int32_t prevTime = time(NULL);
@@ -420,19 +470,33 @@ void* LogInput::ProcessLoop() {
     mEventProcessCount = 0;
     BlockedEventManager* pBlockedEventManager = BlockedEventManager::GetInstance();
     LogProcess::GetInstance()->SetFeedBack(pBlockedEventManager);
+    if (INT32_FLAG(event_handle_thread_count) > 0) {
+        mEventProcessor.reset(new ShardedEventProcessor(INT32_FLAG(event_handle_thread_count)));
+        LOG_INFO(sLogger, ("handle modify events in threads", mEventProcessor->GetThreadCount()));
+    }
     string path;
     while (true) {
         ReadLock lock(mAccessMainThreadRWL);
         TryReadEvents(false);
+        ReleaseDelayedEvents(GetCurrentTimeInMilliSeconds());
         Event* ev = PopEventQueue();
         if (ev != NULL) {
             ++mEventProcessCount;
             if (mIdleFlag)
                 delete ev;
+            else if (mEventProcessor && ev->GetType() == EVENT_MODIFY)
+                ProcessModifyEvents(dispatcher, ev);
             else
                 ProcessEvent(dispatcher, ev);
-        } else
-            usleep(INT32_FLAG(log_input_thread_wait_interval));
+        } else {
+            // Blocked events are fed back once their process queue drains, read them at once.
+            if (pBlockedEventManager->WaitFeedBack(INT32_FLAG(log_input_thread_wait_interval) / 1000))
+                TryReadEvents(true);
+            std::vector<Event*> recoveredEvents;
+            pBlockedEventManager->GetMemoryRecoveredEvent(recoveredEvents);
+            if (!recoveredEvents.empty())
+                PushEventQueue(recoveredEvents);
+        }
         if (mIdleFlag)
             continue;
 
@@ -456,18 +520,17 @@ void* LogInput::ProcessLoop() {
             CheckAndUpdateCriticalMetric(curTime);
             mLastUpdateMetricTime = curTime;
         }
+        bool forceClear = false;
         if (curTime - lastForceClearFlag > 600 && GetForceClearFlag()) {
             lastForceClearFlag = curTime;
-            prevTime = 0;
             lastCheckDir = 0;
             lastCheckHandlerTimeOut = 0;
             lastCheckSymbolicLink = 0;
+            forceClear = true;
         }
 
-        if (curTime - prevTime >= INT32_FLAG(timeout_interval)) {
-            dispatcher->HandleTimeout();
-            prevTime = curTime;
-        }
+        // Only dirs and handlers due are checked, timeout work is spread over loops.
+        dispatcher->HandleTimeout();
 
         if (curTime - lastCheckDir >= mCheckBaseDirInterval) {
             // do not need to clear file checkpoint, we will clear all checkpoint after DumpCheckPointToLocal
@@ -476,15 +539,19 @@ void* LogInput::ProcessLoop() {
             ConfigManager::GetInstance()->RegisterHandlers();
             lastCheckDir = curTime;
         }
+        // Descendants deferred by RegisterHandlers are registered a slice at a time, so events are not delayed.
+        ConfigManager::GetInstance()->RegisterPendingDirs(INT32_FLAG(register_pending_dirs_budget_ms));
 
         if (curTime - lastCheckSymbolicLink >= mCheckSymbolicLinkInterval) {
             dispatcher->CheckSymbolicLink();
             lastCheckSymbolicLink = curTime;
         }
 
+        dispatcher->ProcessHandlerTimeOut(forceClear);
         if (curTime - lastCheckHandlerTimeOut >= INT32_FLAG(check_handler_timeout_interval)) {
-            // call handle timeout
-            dispatcher->ProcessHandlerTimeOut();
+            if (INT32_FLAG(reader_fd_budget) > 0) {
+                GloablFileDescriptorManager::GetInstance()->EvictIdleFiles(INT32_FLAG(reader_fd_budget));
+            }
             lastCheckHandlerTimeOut = curTime;
         }
 
@@ -505,31 +572,18 @@ void* LogInput::ProcessLoop() {
 
 void LogInput::PushEventQueue(std::vector<Event*>& eventVec) {
     for (std::vector<Event*>::iterator iter = eventVec.begin(); iter != eventVec.end(); ++iter) {
-        string key;
-        key.append((*iter)->GetSource())
-            .append(">")
-            .append((*iter)->GetObject())
-            .append(">")
-            .append(ToString((*iter)->GetDev()))
-            .append(">")
-            .append(ToString((*iter)->GetInode()))
-            .append(">")
-            .append((*iter)->GetConfigName());
-        int64_t hashKey = HashSignatureString(key.c_str(), key.size());
-        if ((*iter)->GetType() == EVENT_MODIFY) {
-            if (mModifyEventSet.find(hashKey) != mModifyEventSet.end()) {
-                delete (*iter);
-                *iter = NULL;
-                continue;
-            } else
-                mModifyEventSet.insert(hashKey);
+        if (!EnqueueEvent(*iter)) {
+            *iter = NULL;
         }
-        mInotifyEventQueue.push(*iter);
-        (*iter)->SetHashKey(hashKey);
     }
 }
 
 void LogInput::PushEventQueue(Event* ev) {
+    EnqueueEvent(ev);
+}
+
+bool LogInput::EnqueueEvent(Event* ev, uint64_t readyTimeMs) {
+    std::lock_guard<std::mutex> lock(mEventQueueLock);
     string key;
     key.append(ev->GetSource())
         .append(">")
@@ -544,23 +598,67 @@ void LogInput::PushEventQueue(Event* ev) {
     if (ev->GetType() == EVENT_MODIFY) {
         if (mModifyEventSet.find(hashKey) != mModifyEventSet.end()) {
             delete ev;
-            return;
+            return false;
         } else
             mModifyEventSet.insert(hashKey);
     }
     ev->SetHashKey(hashKey);
-    mInotifyEventQueue.push(ev);
+    if (readyTimeMs > 0) {
+        mDelayedEvents.insert(std::make_pair(readyTimeMs, ev));
+    } else {
+        QueueEvent(ev);
+    }
+    return true;
+}
+
+void LogInput::QueueEvent(Event* ev) {
+    // Under a log storm, plenty of MODIFY events are queued, create/delete/rotation events
+    // should not wait for all of them.
+    if (BOOL_FLAG(event_priority_enable) && ev->GetType() != EVENT_MODIFY) {
+        mPriorityEventQueue.push(ev);
+    } else if (BOOL_FLAG(at_risk_read_priority_enable) && ev->IsAtRisk()) {
+        // Files whose fd is going to be released or which may be removed by rotation are read first.
+        mAtRiskEventQueue.push(ev);
+    } else {
+        mInotifyEventQueue.push(ev);
+    }
+}
+
+void LogInput::PushDelayedEvent(Event* ev, uint64_t readyTimeMs) {
+    EnqueueEvent(ev, std::max<uint64_t>(readyTimeMs, 1));
+}
+
+void LogInput::ReleaseDelayedEvents(uint64_t nowMs) {
+    std::lock_guard<std::mutex> lock(mEventQueueLock);
+    while (!mDelayedEvents.empty() && mDelayedEvents.begin()->first <= nowMs) {
+        QueueEvent(mDelayedEvents.begin()->second);
+        mDelayedEvents.erase(mDelayedEvents.begin());
+    }
+}
+
+bool LogInput::HasPendingEvents() {
+    std::lock_guard<std::mutex> lock(mEventQueueLock);
+    return !mPriorityEventQueue.empty() || !mAtRiskEventQueue.empty() || !mInotifyEventQueue.empty();
 }
 
 Event* LogInput::PopEventQueue() {
-    if (mInotifyEventQueue.size() > 0) {
-        Event* ev = mInotifyEventQueue.front();
+    std::lock_guard<std::mutex> lock(mEventQueueLock);
+    Event* ev = NULL;
+    if (mPriorityEventQueue.size() > 0) {
+        ev = mPriorityEventQueue.front();
+        mPriorityEventQueue.pop();
+    } else if (mAtRiskEventQueue.size() > 0) {
+        ev = mAtRiskEventQueue.front();
+        mAtRiskEventQueue.pop();
+    } else if (mInotifyEventQueue.size() > 0) {
+        ev = mInotifyEventQueue.front();
         mInotifyEventQueue.pop();
-        if (ev->GetType() == EVENT_MODIFY)
-            mModifyEventSet.erase(ev->GetHashKey());
-        return ev;
+    } else {
+        return NULL;
     }
-    return NULL;
+    if (ev->GetType() == EVENT_MODIFY)
+        mModifyEventSet.erase(ev->GetHashKey());
+    return ev;
 }
 
 #ifdef APSARA_UNIT_TEST_MAIN
@@ -573,6 +671,10 @@ void LogInput::CleanEnviroments() {
             break;
         delete ev;
     }
+    for (auto& item : mDelayedEvents) {
+        delete item.second;
+    }
+    mDelayedEvents.clear();
     mModifyEventSet.clear();
 }
 #endif
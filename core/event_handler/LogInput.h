@@ -18,6 +18,9 @@
 #define __LOG_ILOGTAIL_LOG_INPUT_H__
 
 #include <string>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <vector>
 #include <unordered_set>
@@ -28,6 +31,7 @@ namespace logtail {
 
 class Event;
 class EventDispatcher;
+class ShardedEventProcessor;
 
 class LogInput : public LogRunnable {
 public:
@@ -42,6 +46,11 @@ public:
     void HoldOn();
     void PushEventQueue(std::vector<Event*>& eventVec);
     void PushEventQueue(Event* ev);
+    // PushDelayedEvent pushes MODIFY event @ev into event queue at @readyTimeMs, it is used for files out of read
+    // budget. The same MODIFY events are dropped meanwhile, as they are while queued.
+    void PushDelayedEvent(Event* ev, uint64_t readyTimeMs);
+    // HasPendingEvents returns true if some events are waiting in event queues, delayed events are not counted.
+    bool HasPendingEvents();
     void TryReadEvents(bool forceRead);
     void FlowControl();
     bool IsInterupt() { return mInteruptFlag; }
@@ -63,11 +72,34 @@ private:
     ~LogInput();
     void* ProcessLoop();
     void ProcessEvent(EventDispatcher* dispatcher, Event* ev);
+    // ProcessModifyEvents handles @ev and following MODIFY events in queue on mEventProcessor
+    // threads, it stops at the first non-MODIFY event and handles it after the batch.
+    void ProcessModifyEvents(EventDispatcher* dispatcher, Event* ev);
+    // EnqueueEvent pushes @ev into event queue, or deletes it if the same MODIFY event is queued. If @readyTimeMs
+    // is not 0, @ev is kept in mDelayedEvents until then.
+    // @return false if @ev is deleted.
+    bool EnqueueEvent(Event* ev, uint64_t readyTimeMs = 0);
+    // QueueEvent pushes @ev into the queue of its priority, mEventQueueLock is held by caller.
+    void QueueEvent(Event* ev);
+    // ReleaseDelayedEvents pushes delayed events ready at @nowMs into event queue.
+    void ReleaseDelayedEvents(uint64_t nowMs);
     Event* PopEventQueue();
     void CheckAndUpdateCriticalMetric(int32_t curTime);
 
     std::queue<Event*> mInotifyEventQueue;
+    // Events other than MODIFY when event_priority_enable is on, they are popped before
+    // events in mInotifyEventQueue.
+    std::queue<Event*> mPriorityEventQueue;
+    // MODIFY events of files with data at risk when at_risk_read_priority_enable is on, they are popped after
+    // mPriorityEventQueue. An event already queued in mInotifyEventQueue stays there.
+    std::queue<Event*> mAtRiskEventQueue;
     std::unordered_set<int64_t> mModifyEventSet;
+    // Delayed events by ready time in milliseconds, their hash keys are in mModifyEventSet.
+    std::multimap<uint64_t, Event*> mDelayedEvents;
+    // Protects event queues, handlers push events back from mEventProcessor threads.
+    std::mutex mEventQueueLock;
+    // Created when event_handle_thread_count > 0.
+    std::unique_ptr<ShardedEventProcessor> mEventProcessor;
     ReadWriteLock mAccessMainThreadRWL;
     int32_t mCheckBaseDirInterval;
     int32_t mCheckSymbolicLinkInterval;
@@ -0,0 +1,116 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ShardedEventProcessor.h"
+#include <memory>
+#include "EventHandler.h"
+#include "common/BatchRead.h"
+#include "common/Flags.h"
+#include "event/Event.h"
+
+DECLARE_FLAG_INT32(batch_tail_read_size);
+
+namespace logtail {
+
+namespace {
+
+    thread_local bool sIsWorkerThread = false;
+
+    size_t GetShardIndex(const EventHandler* handler, size_t shardCount) {
+        // Handlers are heap allocated and aligned, mix the bits before taking modulo.
+        uint64_t key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handler)) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(key >> 32) % shardCount;
+    }
+
+} // namespace
+
+ShardedEventProcessor::ShardedEventProcessor(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+    mShards.resize(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        mThreads.push_back(CreateThread([this, i]() { Run(i); }));
+    }
+}
+
+ShardedEventProcessor::~ShardedEventProcessor() {
+    {
+        std::lock_guard<std::mutex> lock(mMux);
+        mStopped = true;
+    }
+    mTaskCond.notify_all();
+    mThreads.clear();
+}
+
+bool ShardedEventProcessor::IsWorkerThread() {
+    return sIsWorkerThread;
+}
+
+void ShardedEventProcessor::Process(const std::vector<Task>& tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mMux);
+    for (auto& shard : mShards) {
+        shard.clear();
+    }
+    for (const auto& task : tasks) {
+        mShards[GetShardIndex(task.first, mShards.size())].push_back(task);
+    }
+    mPendingShardCount = mShards.size();
+    ++mRound;
+    mTaskCond.notify_all();
+    mDoneCond.wait(lock, [this]() { return mPendingShardCount == 0; });
+}
+
+void ShardedEventProcessor::Run(size_t index) {
+    sIsWorkerThread = true;
+    std::unique_ptr<BatchRead> batchRead;
+    std::vector<BatchRead::Request*> requests;
+    uint64_t lastRound = 0;
+    std::unique_lock<std::mutex> lock(mMux);
+    while (true) {
+        mTaskCond.wait(lock, [this, lastRound]() { return mStopped || mRound != lastRound; });
+        if (mStopped) {
+            return;
+        }
+        lastRound = mRound;
+        // The shard is not touched by Process until all shards are done.
+        std::vector<Task>& shard = mShards[index];
+        lock.unlock();
+        // Tail reads of files modified in this shard are submitted at once, handlers take data from them.
+        if (INT32_FLAG(batch_tail_read_size) > 0) {
+            requests.clear();
+            for (const auto& task : shard) {
+                task.first->PrepareBatchRead(*task.second, requests);
+            }
+            if (!requests.empty()) {
+                if (!batchRead) {
+                    batchRead.reset(new BatchRead());
+                }
+                batchRead->Read(requests);
+            }
+        }
+        for (const auto& task : shard) {
+            task.first->Handle(*task.second);
+        }
+        lock.lock();
+        if (--mPendingShardCount == 0) {
+            mDoneCond.notify_one();
+        }
+    }
+}
+
+} // namespace logtail
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <boost/thread.hpp>
+#include "common/Thread.h"
+
+namespace logtail {
+
+class Event;
+class EventHandler;
+
+// ShardedEventProcessor handles a batch of events on several threads. Events are sharded by
+// their handler, so events of the same handler, and so of the same file, are handled by one
+// thread in order, and a handler is never called by two threads at the same time.
+//
+// Process is called by LogInput thread only, and returns after all events are handled.
+class ShardedEventProcessor {
+public:
+    typedef std::pair<EventHandler*, Event*> Task;
+
+    explicit ShardedEventProcessor(size_t threadCount);
+    ~ShardedEventProcessor();
+
+    ShardedEventProcessor(const ShardedEventProcessor&) = delete;
+    ShardedEventProcessor& operator=(const ShardedEventProcessor&) = delete;
+
+    // Process calls Handle of each task's handler with its event. Events are not deleted. If batch_tail_read_size
+    // is positive, reads prepared by PrepareBatchRead of the handlers are done in one batch per thread first.
+    void Process(const std::vector<Task>& tasks);
+
+    size_t GetThreadCount() const { return mThreads.size(); }
+
+    // IsWorkerThread returns true if it is called in a thread of any ShardedEventProcessor.
+    static bool IsWorkerThread();
+
+private:
+    void Run(size_t index);
+
+    std::mutex mMux;
+    std::condition_variable mTaskCond;
+    std::condition_variable mDoneCond;
+    std::vector<std::vector<Task>> mShards;
+    uint64_t mRound = 0;
+    size_t mPendingShardCount = 0;
+    bool mStopped = false;
+    std::vector<ThreadPtr> mThreads;
+};
+
+} // namespace logtail
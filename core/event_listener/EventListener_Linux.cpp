@@ -16,6 +16,9 @@
 #include <sys/inotify.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <fcntl.h>
+#include <sys/fanotify.h>
+#include <sys/vfs.h>
 #include "logger/Logger.h"
 #include "profiler/LogtailAlarm.h"
 #include "common/ErrorUtil.h"
@@ -23,9 +26,29 @@
 #include "controller/EventDispatcher.h"
 
 DECLARE_FLAG_BOOL(fs_events_inotify_enable);
+DEFINE_FLAG_BOOL(fs_events_fanotify_enable,
+                 "watch dirs by fanotify filesystem marks instead of inotify watches if supported, "
+                 "events of all files in the marked filesystems are read",
+                 false);
+DEFINE_FLAG_INT32(fs_events_fanotify_max_read_count, "max reads of fanotify fd in one batch of events", 16);
 
 namespace logtail {
 
+// FAN_REPORT_DFID_NAME needs Linux 5.9 and newer headers.
+#if defined(FAN_REPORT_DFID_NAME)
+namespace {
+    const uint64_t kFanotifyEventMask = FAN_CREATE | FAN_MODIFY | FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO
+        | FAN_DELETE_SELF | FAN_ONDIR;
+
+    std::string MakeFanotifyHandleKey(const void* fsid, const struct file_handle* handle) {
+        std::string key(static_cast<const char*>(fsid), sizeof(__kernel_fsid_t));
+        key.append(reinterpret_cast<const char*>(&handle->handle_type), sizeof(handle->handle_type));
+        key.append(reinterpret_cast<const char*>(handle->f_handle), handle->handle_bytes);
+        return key;
+    }
+} // namespace
+#endif
+
 const uint32_t EventListener::mWatchEventMask
     = IN_CREATE | IN_MODIFY | IN_MASK_ADD | IN_DELETE_SELF | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE;
 
@@ -35,27 +58,105 @@ logtail::EventListener::~EventListener() {
 
 bool logtail::EventListener::Init() {
     mInotifyFd = inotify_init();
+    if (BOOL_FLAG(fs_events_fanotify_enable) && !InitFanotify()) {
+        LOG_WARNING(sLogger, ("init fanotify fd failed, use inotify only", ErrnoToString(GetErrno())));
+    }
     return mInotifyFd != -1;
 }
 
+bool logtail::EventListener::InitFanotify() {
+#if defined(FAN_REPORT_DFID_NAME)
+    mFanotifyFd = fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME | FAN_NONBLOCK | FAN_CLOEXEC, O_RDONLY);
+    if (mFanotifyFd >= 0) {
+        LOG_INFO(sLogger, ("init fanotify fd", "success"));
+    }
+    return mFanotifyFd >= 0;
+#else
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
 int logtail::EventListener::AddWatch(const char* dir) {
+    if (mFanotifyFd >= 0) {
+        int wd = AddFanotifyWatch(dir);
+        if (wd >= 0) {
+            return wd;
+        }
+    }
     return inotify_add_watch(mInotifyFd, dir, mWatchEventMask);
-    ;
+}
+
+int logtail::EventListener::AddFanotifyWatch(const char* dir) {
+#if defined(FAN_REPORT_DFID_NAME)
+    struct statfs fsStat;
+    if (statfs(dir, &fsStat) != 0) {
+        return -1;
+    }
+    std::string fsid(reinterpret_cast<const char*>(&fsStat.f_fsid), sizeof(fsStat.f_fsid));
+    auto markItr = mFanotifyFsidMarks.find(fsid);
+    if (markItr == mFanotifyFsidMarks.end()) {
+        // Some filesystems, such as overlayfs of old kernels, do not support it, dirs in them use inotify.
+        bool marked
+            = fanotify_mark(mFanotifyFd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, kFanotifyEventMask, AT_FDCWD, dir) == 0;
+        LOG_INFO(sLogger,
+                 ("fanotify mark filesystem", dir)("success", marked)("error",
+                                                                      marked ? "" : ErrnoToString(GetErrno())));
+        markItr = mFanotifyFsidMarks.emplace(fsid, marked).first;
+    }
+    if (!markItr->second) {
+        return -1;
+    }
+
+    union {
+        struct file_handle mHandle;
+        char mBuffer[sizeof(struct file_handle) + MAX_HANDLE_SZ];
+    } handleBuffer;
+    handleBuffer.mHandle.handle_bytes = MAX_HANDLE_SZ;
+    int mountId = 0;
+    if (name_to_handle_at(AT_FDCWD, dir, &handleBuffer.mHandle, &mountId, 0) != 0) {
+        return -1;
+    }
+    std::string key = MakeFanotifyHandleKey(&fsStat.f_fsid, &handleBuffer.mHandle);
+    // Same dir returns the same id as inotify does.
+    auto itr = mFanotifyHandleWdMap.find(key);
+    if (itr != mFanotifyHandleWdMap.end()) {
+        return itr->second;
+    }
+    int wd = mNextFanotifyWd++;
+    mFanotifyHandleWdMap[key] = wd;
+    mFanotifyWdHandleMap[wd] = key;
+    return wd;
+#else
+    return -1;
+#endif
 }
 
 bool logtail::EventListener::RemoveWatch(int wd) {
+    if (wd >= kFanotifyWdBase) {
+        auto itr = mFanotifyWdHandleMap.find(wd);
+        if (itr == mFanotifyWdHandleMap.end()) {
+            return false;
+        }
+        mFanotifyHandleWdMap.erase(itr->second);
+        mFanotifyWdHandleMap.erase(itr);
+        return true;
+    }
     return inotify_rm_watch(mInotifyFd, wd) != -1;
 }
 
 int32_t logtail::EventListener::ReadEvents(std::vector<logtail::Event*>& eventVec) {
     eventVec.clear();
+    if (mFanotifyFd >= 0) {
+        ReadFanotifyEvents(eventVec);
+    }
     if (mInotifyFd < 0) {
-        return 0;
+        return (int32_t)eventVec.size();
     }
     int len = 0;
     ioctl(mInotifyFd, FIONREAD, &len);
     if (len < 1)
-        return 0;
+        return (int32_t)eventVec.size();
     static char* s_lastHalfEventBuf = new char[65536];
     static int32_t s_lastHalfEventSize = 0;
 
@@ -67,7 +168,7 @@ int32_t logtail::EventListener::ReadEvents(std::vector<logtail::Event*>& eventVe
     if (readLen == 0) {
         LOG_ERROR(sLogger, ("read inotify fd error", ErrnoToString(GetErrno()))("read len", len));
         delete[] buffer;
-        return 0;
+        return (int32_t)eventVec.size();
     }
     // update len
     len = readLen + s_lastHalfEventSize;
@@ -121,6 +222,92 @@ int32_t logtail::EventListener::ReadEvents(std::vector<logtail::Event*>& eventVe
     return (int32_t)eventVec.size();
 }
 
+void logtail::EventListener::ReadFanotifyEvents(std::vector<Event*>& eventVec) {
+#if defined(FAN_REPORT_DFID_NAME)
+    // Reads are batched until the fd is drained, a read returns whole events only.
+    static char* s_fanotifyBuf = new char[65536];
+    static EventDispatcher* dispatcher = EventDispatcher::GetInstance();
+    for (int32_t count = 0; count < INT32_FLAG(fs_events_fanotify_max_read_count); ++count) {
+        ssize_t len = read(mFanotifyFd, s_fanotifyBuf, 65536);
+        if (len <= 0) {
+            if (len < 0 && errno != EAGAIN) {
+                LOG_ERROR(sLogger, ("read fanotify fd error", ErrnoToString(GetErrno())));
+            }
+            return;
+        }
+        if (!BOOL_FLAG(fs_events_inotify_enable)) {
+            continue;
+        }
+        struct fanotify_event_metadata* metadata = (struct fanotify_event_metadata*)s_fanotifyBuf;
+        for (; FAN_EVENT_OK(metadata, len); metadata = FAN_EVENT_NEXT(metadata, len)) {
+            if (metadata->vers != FANOTIFY_METADATA_VERSION) {
+                LOG_ERROR(sLogger, ("fanotify metadata version mismatch", metadata->vers));
+                return;
+            }
+            if (metadata->fd >= 0) {
+                close(metadata->fd);
+            }
+            if (metadata->mask & FAN_Q_OVERFLOW) {
+                LOG_INFO(sLogger, ("fanotify event queue overflow", "miss fanotify events"));
+                LogtailAlarm::GetInstance()->SendAlarm(INOTIFY_EVENT_OVERFLOW_ALARM, "fanotify event queue overflow");
+                continue;
+            }
+            if (dispatcher->IsInterupt()) {
+                continue;
+            }
+
+            // The first info record identifies the parent dir and the name.
+            const char* info = (const char*)metadata + metadata->metadata_len;
+            const char* infoEnd = (const char*)metadata + metadata->event_len;
+            const struct fanotify_event_info_fid* fid = NULL;
+            while (info + sizeof(struct fanotify_event_info_header) <= infoEnd) {
+                const struct fanotify_event_info_header* header = (const struct fanotify_event_info_header*)info;
+                if (header->len == 0) {
+                    break;
+                }
+                if (header->info_type == FAN_EVENT_INFO_TYPE_DFID_NAME
+                    || header->info_type == FAN_EVENT_INFO_TYPE_DFID) {
+                    fid = (const struct fanotify_event_info_fid*)info;
+                    break;
+                }
+                info += header->len;
+            }
+            if (fid == NULL) {
+                continue;
+            }
+            const struct file_handle* handle = (const struct file_handle*)fid->handle;
+            auto itr = mFanotifyHandleWdMap.find(MakeFanotifyHandleKey(&fid->fsid, handle));
+            if (itr == mFanotifyHandleWdMap.end()) {
+                // Not a registered dir, inotify would not report it either.
+                continue;
+            }
+            std::string name;
+            if (fid->hdr.info_type == FAN_EVENT_INFO_TYPE_DFID_NAME) {
+                name = (const char*)handle->f_handle + handle->handle_bytes;
+                if (name == ".") {
+                    // Event of the dir itself.
+                    name.clear();
+                }
+            }
+
+            EventType etype = 0;
+            etype |= (metadata->mask & FAN_DELETE_SELF) && name.empty() ? EVENT_TIMEOUT : 0;
+            etype |= metadata->mask & FAN_CREATE ? EVENT_CREATE : 0;
+            etype |= metadata->mask & FAN_MODIFY ? EVENT_MODIFY : 0;
+            etype |= metadata->mask & FAN_ONDIR ? EVENT_ISDIR : 0;
+            etype |= metadata->mask & FAN_MOVED_FROM ? EVENT_MOVE_FROM : 0;
+            etype |= metadata->mask & FAN_MOVED_TO ? EVENT_MOVE_TO : 0;
+            etype |= metadata->mask & FAN_DELETE ? EVENT_DELETE : 0;
+            std::string path;
+            if ((etype & ~EVENT_ISDIR) != 0 && dispatcher->IsRegistered(itr->second, path)) {
+                // fanotify has no cookie to pair moves.
+                eventVec.push_back(new Event(path, name, etype, itr->second, 0));
+            }
+        }
+    }
+#endif
+}
+
 bool logtail::EventListener::IsInit() {
     return mInotifyFd != -1;
 }
@@ -128,6 +315,13 @@ bool logtail::EventListener::IsInit() {
 void logtail::EventListener::Destroy() {
     if (mInotifyFd >= 0)
         close(mInotifyFd);
+    if (mFanotifyFd >= 0) {
+        close(mFanotifyFd);
+        mFanotifyFd = -1;
+    }
+    mFanotifyHandleWdMap.clear();
+    mFanotifyWdHandleMap.clear();
+    mFanotifyFsidMarks.clear();
 }
 
 bool EventListener::IsValidID(int id) {
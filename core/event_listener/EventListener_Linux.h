@@ -18,6 +18,7 @@
 #define LOGTAIL_EVENTLISTENER_H
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "event/Event.h"
 
@@ -47,7 +48,24 @@ public:
 
 private:
     EventListener() = default;
+
+    // Watches added by fanotify use ids from kFanotifyWdBase, so that they never conflict with inotify ones.
+    static const int kFanotifyWdBase = 1 << 30;
+
+    bool InitFanotify();
+    // AddFanotifyWatch marks the filesystem of @dir once and maps the file handle of @dir to a watch id,
+    // it returns -1 if @dir can not be watched by fanotify.
+    int AddFanotifyWatch(const char* dir);
+    void ReadFanotifyEvents(std::vector<Event*>& eventVec);
+
     int32_t mInotifyFd = -1;
+    // Reports events of whole filesystems by the file handle of the parent dir and the name, used if
+    // fs_events_fanotify_enable is set and supported by kernel.
+    int32_t mFanotifyFd = -1;
+    int mNextFanotifyWd = kFanotifyWdBase;
+    std::unordered_map<std::string, int> mFanotifyHandleWdMap; // key is fsid and file handle of dir
+    std::unordered_map<int, std::string> mFanotifyWdHandleMap;
+    std::unordered_map<std::string, bool> mFanotifyFsidMarks; // if the filesystem is marked successfully
 };
 
 } // namespace logtail
@@ -13,21 +13,84 @@
 // limitations under the License.
 
 #include "EventListener_Windows.h"
+#include <Windows.h>
+#include "logger/Logger.h"
+#include "profiler/LogtailAlarm.h"
+#include "common/ErrorUtil.h"
+#include "common/Flags.h"
+#include "common/FileSystemUtil.h"
+#include "event/Event.h"
+#include "controller/EventDispatcher.h"
+
+DECLARE_FLAG_BOOL(fs_events_inotify_enable);
+DEFINE_FLAG_BOOL(fs_events_windows_notify_enable,
+                 "watch dirs by ReadDirectoryChangesW, polling is the only way to find changes if not set",
+                 true);
+DEFINE_FLAG_INT32(fs_events_windows_notify_buffer_size,
+                  "buffer size of each watched dir, changes are lost if it is filled before read, max 64KB",
+                  65536);
+DEFINE_FLAG_INT32(fs_events_windows_max_read_count, "max completed reads handled in one batch of events", 256);
 
 namespace logtail {
 
+namespace {
+    const DWORD kNotifyFilter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE
+        | FILE_NOTIFY_CHANGE_LAST_WRITE;
+
+    // Paths of logtail are in ANSI code page on windows.
+    std::string WideToAnsi(const WCHAR* src, int srcLen) {
+        int len = WideCharToMultiByte(CP_ACP, 0, src, srcLen, NULL, 0, NULL, NULL);
+        if (len <= 0) {
+            return std::string();
+        }
+        std::string dst(len, '\0');
+        WideCharToMultiByte(CP_ACP, 0, src, srcLen, &dst[0], len, NULL, NULL);
+        return dst;
+    }
+} // namespace
+
+struct EventListener::Watch {
+    int mWd = -1;
+    HANDLE mHandle = INVALID_HANDLE_VALUE;
+    OVERLAPPED mOverlapped;
+    bool mPending = false;
+    std::string mFileId;
+    // ReadDirectoryChangesW needs a DWORD aligned buffer.
+    std::vector<DWORD> mBuffer;
+};
+
 EventListener::~EventListener() {
+    Destroy();
 }
 
 bool EventListener::Init() {
-    return true;
+    if (!BOOL_FLAG(fs_events_windows_notify_enable)) {
+        LOG_INFO(sLogger, ("windows change notification is disabled", "use polling only"));
+        return true;
+    }
+    if (mCompletionPort != nullptr) {
+        return true;
+    }
+    // One thread reads the port, concurrency is not used.
+    mCompletionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+    return mCompletionPort != nullptr;
 }
 
 bool EventListener::IsInit() {
-    return true;
+    return mCompletionPort != nullptr;
 }
 
 void EventListener::Destroy() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto& item : mWatches) {
+        CloseWatch(*item.second);
+    }
+    mWatches.clear();
+    mFileIdWdMap.clear();
+    if (mCompletionPort != nullptr) {
+        CloseHandle(mCompletionPort);
+        mCompletionPort = nullptr;
+    }
 }
 
 bool EventListener::IsValidID(int id) {
@@ -35,17 +98,196 @@ bool EventListener::IsValidID(int id) {
 }
 
 int EventListener::AddWatch(const char* dir) {
-    static int counter = 0;
-    auto ret = counter++;
-    return (ret >= 0) ? ret : 0;
+    if (mCompletionPort == nullptr) {
+        return -1;
+    }
+    HANDLE handle = CreateFileA(dir,
+                                FILE_LIST_DIRECTORY,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL,
+                                OPEN_EXISTING,
+                                FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                                NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(handle, &info)) {
+        DWORD error = GetLastError();
+        CloseHandle(handle);
+        SetLastError(error);
+        return -1;
+    }
+    std::string fileId = std::to_string(info.dwVolumeSerialNumber) + ":"
+        + std::to_string((static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto itr = mFileIdWdMap.find(fileId);
+    if (itr != mFileIdWdMap.end()) {
+        CloseHandle(handle);
+        return itr->second;
+    }
+    std::unique_ptr<Watch> watch(new Watch);
+    watch->mWd = mNextWd++;
+    watch->mHandle = handle;
+    watch->mFileId = fileId;
+    int32_t bufferSize = INT32_FLAG(fs_events_windows_notify_buffer_size);
+    watch->mBuffer.resize((bufferSize > 4096 ? bufferSize : 4096) / sizeof(DWORD));
+    // The completion key is the wd, so that completions of removed watches are recognized and dropped.
+    if (CreateIoCompletionPort(handle, mCompletionPort, static_cast<ULONG_PTR>(watch->mWd), 0) == NULL
+        || !IssueRead(*watch)) {
+        DWORD error = GetLastError();
+        CloseHandle(handle);
+        SetLastError(error);
+        return -1;
+    }
+    int wd = watch->mWd;
+    mFileIdWdMap[fileId] = wd;
+    mWatches[wd] = std::move(watch);
+    return wd;
 }
 
 bool EventListener::RemoveWatch(int wd) {
-    return 0;
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto itr = mWatches.find(wd);
+    if (itr == mWatches.end()) {
+        return false;
+    }
+    CloseWatch(*itr->second);
+    mFileIdWdMap.erase(itr->second->mFileId);
+    mWatches.erase(itr);
+    return true;
+}
+
+bool EventListener::IssueRead(Watch& watch) {
+    memset(&watch.mOverlapped, 0, sizeof(watch.mOverlapped));
+    watch.mPending = ReadDirectoryChangesW(watch.mHandle,
+                                           watch.mBuffer.data(),
+                                           static_cast<DWORD>(watch.mBuffer.size() * sizeof(DWORD)),
+                                           FALSE,
+                                           kNotifyFilter,
+                                           NULL,
+                                           &watch.mOverlapped,
+                                           NULL)
+        != FALSE;
+    return watch.mPending;
+}
+
+void EventListener::CloseWatch(Watch& watch) {
+    if (watch.mPending) {
+        // The buffer is written until the read is cancelled, wait for it before the buffer is freed. The
+        // completion is still queued to the port, and dropped by ReadEvents as the wd is not found.
+        DWORD size = 0;
+        CancelIoEx(watch.mHandle, &watch.mOverlapped);
+        GetOverlappedResult(watch.mHandle, &watch.mOverlapped, &size, TRUE);
+        watch.mPending = false;
+    }
+    CloseHandle(watch.mHandle);
+    watch.mHandle = INVALID_HANDLE_VALUE;
 }
 
 int32_t EventListener::ReadEvents(std::vector<Event*>& eventVec) {
-    return 0;
+    eventVec.clear();
+    if (mCompletionPort == nullptr) {
+        return 0;
+    }
+    static EventDispatcher* dispatcher = EventDispatcher::GetInstance();
+    for (int32_t count = 0; count < INT32_FLAG(fs_events_windows_max_read_count); ++count) {
+        DWORD size = 0;
+        ULONG_PTR key = 0;
+        LPOVERLAPPED overlapped = NULL;
+        BOOL success = GetQueuedCompletionStatus(mCompletionPort, &size, &key, &overlapped, 0);
+        if (overlapped == NULL) {
+            // Timeout, nothing completed.
+            break;
+        }
+        DWORD error = success ? ERROR_SUCCESS : GetLastError();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto itr = mWatches.find(static_cast<int>(key));
+        if (itr == mWatches.end()) {
+            continue;
+        }
+        Watch& watch = *itr->second;
+        watch.mPending = false;
+        if (error == ERROR_OPERATION_ABORTED) {
+            continue;
+        }
+        if (error == ERROR_NOTIFY_ENUM_DIR || (error == ERROR_SUCCESS && size == 0)) {
+            // Buffer overflowed, changes of this read are lost and found by polling later.
+            LOG_INFO(sLogger, ("windows change notification buffer overflow", "miss events")("wd", watch.mWd));
+            LogtailAlarm::GetInstance()->SendAlarm(INOTIFY_EVENT_OVERFLOW_ALARM,
+                                                   "windows change notification buffer overflow");
+        } else if (error == ERROR_SUCCESS) {
+            if (BOOL_FLAG(fs_events_inotify_enable) && !dispatcher->IsInterupt()) {
+                ParseNotifyBuffer(watch, size, eventVec);
+            }
+        }
+        if (error == ERROR_SUCCESS || error == ERROR_NOTIFY_ENUM_DIR) {
+            if (IssueRead(watch)) {
+                continue;
+            }
+            error = GetLastError();
+        }
+        // The dir is deleted or not accessible anymore, the same as IN_DELETE_SELF of inotify.
+        LOG_DEBUG(sLogger, ("windows change notification stopped", watch.mWd)("error", ErrnoToString(error)));
+        std::string path;
+        if (dispatcher->IsRegistered(watch.mWd, path)) {
+            eventVec.push_back(new Event(path, "", EVENT_TIMEOUT, watch.mWd, 0));
+        }
+    }
+    return (int32_t)eventVec.size();
+}
+
+void EventListener::ParseNotifyBuffer(Watch& watch, uint32_t size, std::vector<Event*>& eventVec) {
+    static EventDispatcher* dispatcher = EventDispatcher::GetInstance();
+    std::string path;
+    if (!dispatcher->IsRegistered(watch.mWd, path)) {
+        return;
+    }
+    const char* buffer = reinterpret_cast<const char*>(watch.mBuffer.data());
+    uint32_t offset = 0;
+    uint32_t moveCookie = 0;
+    while (offset + sizeof(FILE_NOTIFY_INFORMATION) <= size) {
+        const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+        std::string name = WideToAnsi(info->FileName, static_cast<int>(info->FileNameLength / sizeof(WCHAR)));
+        EventType etype = 0;
+        switch (info->Action) {
+            case FILE_ACTION_ADDED:
+                etype = EVENT_CREATE;
+                break;
+            case FILE_ACTION_MODIFIED: {
+                // Dirs are reported as modified when their children change, inotify does not report them.
+                DWORD attributes = GetFileAttributesA(PathJoin(path, name).c_str());
+                if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+                    etype = EVENT_MODIFY;
+                }
+                break;
+            }
+            case FILE_ACTION_REMOVED:
+                etype = EVENT_DELETE;
+                break;
+            case FILE_ACTION_RENAMED_OLD_NAME:
+                // The new name follows the old name in the same buffer, they share a cookie as inotify does.
+                moveCookie = mNextMoveCookie++;
+                etype = EVENT_MOVE_FROM;
+                break;
+            case FILE_ACTION_RENAMED_NEW_NAME:
+                etype = EVENT_MOVE_TO;
+                break;
+        }
+        if (etype != 0 && !name.empty()) {
+            uint32_t cookie = (etype & (EVENT_MOVE_FROM | EVENT_MOVE_TO)) ? moveCookie : 0;
+            eventVec.push_back(new Event(path, name, etype, watch.mWd, cookie));
+        }
+        if (etype == EVENT_MOVE_TO) {
+            moveCookie = 0;
+        }
+        if (info->NextEntryOffset == 0) {
+            break;
+        }
+        offset += info->NextEntryOffset;
+    }
 }
 
-} // namespace logtail
\ No newline at end of file
+} // namespace logtail
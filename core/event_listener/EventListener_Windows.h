@@ -15,13 +15,20 @@
  */
 
 #pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace logtail {
 
 class Event;
 
+// EventListener watches dirs by ReadDirectoryChangesW, reads of all dirs are overlapped and complete to one
+// I/O completion port, so ReadEvents collects changes of all dirs without blocking. Dirs that can not be
+// watched are left to polling, as well as all dirs if fs_events_windows_notify_enable is not set.
 class EventListener {
 public:
     ~EventListener();
@@ -44,6 +51,23 @@ public:
 
 private:
     EventListener() = default;
+
+    // Watch holds the dir handle and the buffer of the pending read, defined in cpp to keep windows.h out.
+    struct Watch;
+
+    // IssueRead starts the next overlapped read of @watch, it returns false if the dir is gone.
+    bool IssueRead(Watch& watch);
+    void ParseNotifyBuffer(Watch& watch, uint32_t size, std::vector<Event*>& eventVec);
+    void CloseWatch(Watch& watch);
+
+    void* mCompletionPort = nullptr;
+    int mNextWd = 1;
+    uint32_t mNextMoveCookie = 1;
+    // Watches are added and removed by dispatcher, and read by LogInput thread.
+    std::mutex mMutex;
+    std::unordered_map<int, std::unique_ptr<Watch>> mWatches;
+    // Same dir returns the same id as inotify does, key is volume serial number and file index of dir.
+    std::unordered_map<std::string, int> mFileIdWdMap;
 };
 
-} // namespace logtail
\ No newline at end of file
+} // namespace logtail
@@ -386,6 +386,11 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        // Only file command has a brief output.
+        if (cmdType != "file") {
+            detailFlag = true;
+        }
+
         pthread_t tid;
         int waitSeconds = 5;
         pthread_create(&tid, NULL, logtail::LogtailInsight::ForcedExitTimer, (void*)&waitSeconds);
@@ -401,7 +406,11 @@ int main(int argc, char* argv[]) {
         cout << "       status logfile [--format=line | json] index project logstore fileFullPath \n             get "
                 "log file status with line or json style. default --format=line \n";
         cout << "       status history beginIndex endIndex  project logstore [fileFullPath] \n             query "
-                "logstore | logfile history status.  \n\n";
+                "logstore | logfile history status.  \n";
+        cout << "       status command profile [reset] [--format=json] \n             get time spent in each "
+                "stage by config, estimated from samples, reset to clear. requires stage_profile_sample_interval \n";
+        cout << "       status command startup [--format=json] \n             get wall and cpu time of each "
+                "startup phase \n\n";
         cout << "index :   from 1 to 60. in all, it means last $(index) minutes; in active/logstore/logfile/history, "
                 "it means last $(index)*10 minutes \n";
     } else {
@@ -173,23 +173,92 @@ void RawLogGroup::pack_logs(std::string* output) const {
 void RawLogGroup::pack_logtags(std::string* output) const {
     for (size_t size = 0; size < logtags_.size(); ++size) {
         const LogTag& logTag = logtags_[size];
+        AppendLogTag(output, logTag.first, logTag.second);
+    }
+}
 
-        // use only 1 malloc
-        size_t k_len = logTag.first.size();
-        size_t v_len = logTag.second.size();
-        const char* k = logTag.first.c_str();
-        const char* v = logTag.second.c_str();
-        uint32_t tag_size
-            = sizeof(char) * (k_len + v_len) + uint32_size((uint32_t)k_len) + uint32_size((uint32_t)v_len) + 2;
-        output->push_back(0x32);
-        uint32_pack(tag_size, output);
-        output->push_back(0x0A);
-        uint32_pack((uint32_t)k_len, output);
-        output->append(k, k_len);
-        output->push_back(0x12);
-        uint32_pack((uint32_t)v_len, output);
-        output->append(v, v_len);
+void RawLogGroup::AppendLogTag(std::string* output, const std::string& key, const std::string& value) {
+    size_t k_len = key.size();
+    size_t v_len = value.size();
+    uint32_t tag_size
+        = sizeof(char) * (k_len + v_len) + uint32_size((uint32_t)k_len) + uint32_size((uint32_t)v_len) + 2;
+    output->push_back(0x32);
+    uint32_pack(tag_size, output);
+    output->push_back(0x0A);
+    uint32_pack((uint32_t)k_len, output);
+    output->append(key.data(), k_len);
+    output->push_back(0x12);
+    uint32_pack((uint32_t)v_len, output);
+    output->append(value.data(), v_len);
+}
+
+/**
+ * Parse a base-128 varint of at most 5 bytes at `*pos`, and move `*pos` after it.
+ *
+ * \return
+ *      false if the varint is truncated or longer than 5 bytes.
+ */
+static inline bool uint32_parse(const uint8_t** pos, const uint8_t* end, uint32_t* value) {
+    uint32_t rv = 0;
+    for (unsigned i = 0; i < 5; ++i) {
+        if (*pos >= end) {
+            return false;
+        }
+        uint8_t byte = *(*pos)++;
+        rv |= (uint32_t)(byte & 0x7f) << (7 * i);
+        if ((byte & 0x80) == 0) {
+            *value = rv;
+            return true;
+        }
     }
+    return false;
+}
+
+bool RawLogGroup::ReadCategory(const char* data, size_t size, std::string& category) {
+    category.clear();
+    const uint8_t* pos = reinterpret_cast<const uint8_t*>(data);
+    const uint8_t* end = pos + size;
+    while (pos < end) {
+        uint32_t key = 0;
+        if (!uint32_parse(&pos, end, &key)) {
+            return false;
+        }
+        uint32_t len = 0;
+        switch (key & 0x07) {
+            case 0: // varint, skip up to 10 bytes
+                for (unsigned i = 0;; ++i) {
+                    if (pos >= end || i == 10) {
+                        return false;
+                    }
+                    if ((*pos++ & 0x80) == 0) {
+                        break;
+                    }
+                }
+                continue;
+            case 1:
+                len = 8;
+                break;
+            case 2:
+                if (!uint32_parse(&pos, end, &len)) {
+                    return false;
+                }
+                break;
+            case 5:
+                len = 4;
+                break;
+            default:
+                return false;
+        }
+        if ((size_t)(end - pos) < len) {
+            return false;
+        }
+        // The last one wins, the same as parsing.
+        if (key == 0x12) {
+            category.assign(reinterpret_cast<const char*>(pos), len);
+        }
+        pos += len;
+    }
+    return true;
 }
 
 void RawLogGroup::pack_others(std::string* output) const {
@@ -90,6 +90,13 @@ public:
     // contents.  All required fields must be set.
     bool AppendToString(std::string* output) const;
 
+    // Serialized LogGroups can be concatenated, so a tag appended to the serialized data is the same as the one
+    // added before serialization.
+    static void AppendLogTag(std::string* output, const std::string& key, const std::string& value);
+    // ReadCategory gets Category of serialized LogGroup @data without parsing logs, returns false if @data is not
+    // a valid LogGroup at the top level. @category is empty if it is not set.
+    static bool ReadCategory(const char* data, size_t size, std::string& category);
+
 private:
     void set_has_category();
     void clear_has_category();
@@ -0,0 +1,278 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "HotLogger.h"
+#include <chrono>
+#include <cstdio>
+#include "common/Flags.h"
+#include "common/TimeUtil.h"
+#include "Logger.h"
+
+DEFINE_FLAG_INT32(hot_log_min_level, "min level of hot logs recorded, 0 trace, 1 debug, 2 info, 3 warning", 2);
+DEFINE_FLAG_INT32(hot_log_ring_size, "bytes of hot log ring of each thread", 64 * 1024);
+DEFINE_FLAG_INT32(hot_log_flush_interval_ms, "interval of decoding hot logs to log file", 200);
+
+namespace logtail {
+
+char* HotLogArg::Encode(char* dst) const {
+    *dst++ = static_cast<char>(mType);
+    if (mType == TYPE_STRING) {
+        memcpy(dst, &mSize, sizeof(mSize));
+        dst += sizeof(mSize);
+        memcpy(dst, mValue.mString, mSize);
+        return dst + mSize;
+    }
+    memcpy(dst, &mValue, sizeof(uint64_t));
+    return dst + sizeof(uint64_t);
+}
+
+const char* HotLogArg::Decode(const char* src, std::string& out) {
+    const Type type = static_cast<Type>(*src++);
+    if (type == TYPE_STRING) {
+        uint16_t size = 0;
+        memcpy(&size, src, sizeof(size));
+        src += sizeof(size);
+        out.append(src, size);
+        return src + size;
+    }
+    char buf[32];
+    switch (type) {
+        case TYPE_BOOL: {
+            int64_t value = 0;
+            memcpy(&value, src, sizeof(value));
+            out.append(value != 0 ? "true" : "false");
+            break;
+        }
+        case TYPE_INT: {
+            int64_t value = 0;
+            memcpy(&value, src, sizeof(value));
+            out.append(std::to_string(value));
+            break;
+        }
+        case TYPE_UINT: {
+            uint64_t value = 0;
+            memcpy(&value, src, sizeof(value));
+            out.append(std::to_string(value));
+            break;
+        }
+        case TYPE_DOUBLE: {
+            double value = 0;
+            memcpy(&value, src, sizeof(value));
+            snprintf(buf, sizeof(buf), "%g", value);
+            out.append(buf);
+            break;
+        }
+        default:
+            break;
+    }
+    return src + sizeof(uint64_t);
+}
+
+HotLogRing::HotLogRing(size_t capacity) {
+    size_t size = 1024;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    mBuffer.reset(new char[size]);
+    mMask = size - 1;
+}
+
+bool HotLogRing::Write(const HotLogFormat* format, uint64_t timeInUs, std::initializer_list<HotLogArg> args) {
+    size_t size = sizeof(Header);
+    for (const HotLogArg& arg : args) {
+        size += arg.EncodedSize();
+    }
+    size = (size + 7) & ~static_cast<size_t>(7);
+    const size_t capacity = mMask + 1;
+    if (size > capacity / 2) {
+        return false;
+    }
+    size_t head = mHead.load(std::memory_order_relaxed);
+    const size_t tail = mTail.load(std::memory_order_acquire);
+    size_t offset = head & mMask;
+    // Records are contiguous, the rest of the ring is skipped if the record can not fit in it.
+    const size_t padding = capacity - offset < size ? capacity - offset : 0;
+    if (capacity - (head - tail) < size + padding) {
+        return false;
+    }
+    if (padding > 0) {
+        // Only size and arg count are written, at least 8 bytes are left since records are aligned.
+        Header* header = reinterpret_cast<Header*>(&mBuffer[offset]);
+        header->mSize = static_cast<uint32_t>(padding);
+        header->mArgCount = kPadding;
+        head += padding;
+        offset = 0;
+    }
+    Header* header = reinterpret_cast<Header*>(&mBuffer[offset]);
+    header->mSize = static_cast<uint32_t>(size);
+    header->mArgCount = static_cast<uint32_t>(args.size());
+    header->mFormat = format;
+    header->mTimeInUs = timeInUs;
+    char* dst = &mBuffer[offset + sizeof(Header)];
+    for (const HotLogArg& arg : args) {
+        dst = arg.Encode(dst);
+    }
+    mHead.store(head + size, std::memory_order_release);
+    return true;
+}
+
+size_t HotLogRing::Read(const Reader& reader) {
+    size_t tail = mTail.load(std::memory_order_relaxed);
+    const size_t head = mHead.load(std::memory_order_acquire);
+    size_t count = 0;
+    std::string message;
+    while (tail != head) {
+        const Header* header = reinterpret_cast<const Header*>(&mBuffer[tail & mMask]);
+        if (header->mArgCount != kPadding) {
+            const char* src = reinterpret_cast<const char*>(header + 1);
+            uint32_t argCount = header->mArgCount;
+            message.clear();
+            for (const char* fmt = header->mFormat->mFormat; *fmt != '\0'; ++fmt) {
+                if (fmt[0] == '{' && fmt[1] == '}' && argCount > 0) {
+                    src = HotLogArg::Decode(src, message);
+                    --argCount;
+                    ++fmt;
+                } else {
+                    message.push_back(*fmt);
+                }
+            }
+            // Arguments without placeholder are appended.
+            for (; argCount > 0; --argCount) {
+                message.push_back(' ');
+                src = HotLogArg::Decode(src, message);
+            }
+            reader(header->mFormat, header->mTimeInUs, message);
+            ++count;
+        }
+        tail += header->mSize;
+    }
+    mTail.store(tail, std::memory_order_release);
+    return count;
+}
+
+std::atomic_int HotLogger::sMinLevel{HOT_LOG_INFO};
+
+HotLogger::HotLogger() {
+}
+
+void HotLogger::Log(const HotLogFormat* format, std::initializer_list<HotLogArg> args) {
+    if (!GetThreadRing()->Write(format, GetCurrentTimeInMicroSeconds(), args)) {
+        mDroppedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+HotLogRing* HotLogger::GetThreadRing() {
+    struct ThreadRing {
+        std::shared_ptr<HotLogRing> mRing;
+        ~ThreadRing() {
+            if (mRing) {
+                mRing->mClosed.store(true, std::memory_order_release);
+            }
+        }
+    };
+    static thread_local ThreadRing sRing;
+    if (!sRing.mRing) {
+        sRing.mRing = std::make_shared<HotLogRing>(INT32_FLAG(hot_log_ring_size));
+        std::lock_guard<std::mutex> lock(mRingMux);
+        mRings.push_back(sRing.mRing);
+    }
+    return sRing.mRing.get();
+}
+
+static spdlog::level::level_enum ToSpdlogLevel(HotLogLevel level) {
+    switch (level) {
+        case HOT_LOG_TRACE:
+            return spdlog::level::trace;
+        case HOT_LOG_DEBUG:
+            return spdlog::level::debug;
+        case HOT_LOG_INFO:
+            return spdlog::level::info;
+        default:
+            return spdlog::level::warn;
+    }
+}
+
+size_t HotLogger::Flush(const Sink& sink) {
+    std::vector<std::shared_ptr<HotLogRing> > rings;
+    {
+        std::lock_guard<std::mutex> lock(mRingMux);
+        for (auto iter = mRings.begin(); iter != mRings.end();) {
+            rings.push_back(*iter);
+            // Nothing is written after closed, the ring is read for the last time.
+            if ((*iter)->mClosed.load(std::memory_order_acquire)) {
+                iter = mRings.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mFlushMux);
+    size_t count = 0;
+    std::string line;
+    for (auto& ring : rings) {
+        count += ring->Read([&](const HotLogFormat* format, uint64_t timeInUs, const std::string& message) {
+            line.clear();
+            line.append(format->mFile).append(":").append(std::to_string(format->mLine)).append("\t");
+            line.append(message).append("\tlog_time_us:").append(std::to_string(timeInUs));
+            if (sink) {
+                sink(format->mLevel, line);
+            } else if (sLogger) {
+                sLogger->log(ToSpdlogLevel(format->mLevel), "{}", line);
+            }
+        });
+    }
+    return count;
+}
+
+void HotLogger::Start() {
+    SetMinLevel(static_cast<HotLogLevel>(INT32_FLAG(hot_log_min_level)));
+    std::lock_guard<std::mutex> lock(mMux);
+    if (mThread) {
+        return;
+    }
+    mStopped = false;
+    mThread = CreateThread([this]() { Run(); });
+}
+
+void HotLogger::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mMux);
+        if (!mThread) {
+            return;
+        }
+        mStopped = true;
+    }
+    mStopCond.notify_one();
+    mThread.reset();
+    Flush();
+}
+
+void HotLogger::Run() {
+    while (true) {
+        Flush();
+        const uint64_t droppedCount = GetDroppedCount();
+        if (droppedCount > 0 && sLogger) {
+            LOG_WARNING(sLogger, ("hot logs are dropped for full rings, count", droppedCount));
+        }
+        std::unique_lock<std::mutex> lock(mMux);
+        if (mStopCond.wait_for(lock,
+                               std::chrono::milliseconds(INT32_FLAG(hot_log_flush_interval_ms)),
+                               [this]() { return mStopped; })) {
+            return;
+        }
+    }
+}
+
+} // namespace logtail
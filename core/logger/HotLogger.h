@@ -0,0 +1,191 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <boost/thread.hpp>
+#include "common/Thread.h"
+
+// Hot logs with level below it are compiled out, build with -DLOGTAIL_HOT_LOG_MIN_LEVEL=0 to keep trace logs.
+#ifndef LOGTAIL_HOT_LOG_MIN_LEVEL
+#define LOGTAIL_HOT_LOG_MIN_LEVEL 1
+#endif
+
+namespace logtail {
+
+enum HotLogLevel { HOT_LOG_TRACE = 0, HOT_LOG_DEBUG, HOT_LOG_INFO, HOT_LOG_WARNING };
+
+// HotLogFormat is the static descriptor of a call site, its address is the format id of records.
+struct HotLogFormat {
+    HotLogLevel mLevel;
+    const char* mFile;
+    int mLine;
+    const char* mFormat; // each "{}" is replaced by an argument in order
+};
+
+// HotLogArg is an argument of hot log, strings are copied into the ring and truncated to kMaxStringSize.
+class HotLogArg {
+public:
+    enum Type : uint8_t { TYPE_BOOL, TYPE_INT, TYPE_UINT, TYPE_DOUBLE, TYPE_STRING };
+    static const size_t kMaxStringSize = 256;
+
+    HotLogArg(bool value) : mType(TYPE_BOOL) { mValue.mInt = value ? 1 : 0; }
+    template <typename T,
+              typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, int>::type = 0>
+    HotLogArg(T value) : mType(TYPE_INT) {
+        mValue.mInt = static_cast<int64_t>(value);
+    }
+    template <typename T,
+              typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value, int>::type = 0>
+    HotLogArg(T value) : mType(TYPE_UINT) {
+        mValue.mUint = static_cast<uint64_t>(value);
+    }
+    template <typename T, typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
+    HotLogArg(T value) : mType(TYPE_INT) {
+        mValue.mInt = static_cast<int64_t>(value);
+    }
+    HotLogArg(double value) : mType(TYPE_DOUBLE) { mValue.mDouble = value; }
+    HotLogArg(const char* value) : mType(TYPE_STRING) { SetString(value, value == NULL ? 0 : strlen(value)); }
+    HotLogArg(const std::string& value) : mType(TYPE_STRING) { SetString(value.data(), value.size()); }
+
+    // EncodedSize returns the bytes written by Encode.
+    size_t EncodedSize() const { return mType == TYPE_STRING ? 1 + sizeof(uint16_t) + mSize : 1 + sizeof(uint64_t); }
+    char* Encode(char* dst) const;
+    // Decode appends text of the argument at @src to @out, and returns the position after it.
+    static const char* Decode(const char* src, std::string& out);
+
+private:
+    void SetString(const char* data, size_t size) {
+        mValue.mString = data;
+        mSize = static_cast<uint16_t>(size < kMaxStringSize ? size : kMaxStringSize);
+    }
+
+    Type mType;
+    uint16_t mSize = 0;
+    union {
+        int64_t mInt;
+        uint64_t mUint;
+        double mDouble;
+        const char* mString;
+    } mValue;
+};
+
+// HotLogRing is a byte ring of one thread, written by the thread and read by the decoder.
+class HotLogRing {
+public:
+    explicit HotLogRing(size_t capacity);
+
+    // Write returns false if the ring has no room for the record, the record is dropped.
+    bool Write(const HotLogFormat* format, uint64_t timeInUs, std::initializer_list<HotLogArg> args);
+
+    typedef std::function<void(const HotLogFormat* format, uint64_t timeInUs, const std::string& message)> Reader;
+    // Read decodes all records written, and returns the count of them.
+    size_t Read(const Reader& reader);
+
+    bool IsEmpty() const { return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_relaxed); }
+
+    // Set by the writer thread when it exits.
+    std::atomic_bool mClosed{false};
+
+private:
+    struct Header {
+        uint32_t mSize; // of the whole record, aligned to 8 bytes
+        uint32_t mArgCount; // kPadding if the rest of the ring is skipped
+        const HotLogFormat* mFormat;
+        uint64_t mTimeInUs;
+    };
+    static const uint32_t kPadding = UINT32_MAX;
+
+    std::unique_ptr<char[]> mBuffer;
+    size_t mMask;
+    alignas(64) std::atomic<size_t> mHead{0};
+    alignas(64) std::atomic<size_t> mTail{0};
+};
+
+// HotLogger records hot path logs as the format id and binary arguments into rings of threads, they are
+// decoded and written to sLogger by a background thread. Compared with LOG_DEBUG, no string is built by
+// the logging thread, and logs are dropped instead of blocking when a ring is full.
+class HotLogger {
+public:
+    static HotLogger* GetInstance() {
+        static HotLogger* ptr = new HotLogger();
+        return ptr;
+    }
+
+    static bool ShouldLog(HotLogLevel level) { return level >= sMinLevel.load(std::memory_order_relaxed); }
+    static void SetMinLevel(HotLogLevel level) { sMinLevel.store(level, std::memory_order_relaxed); }
+
+    void Log(const HotLogFormat* format, std::initializer_list<HotLogArg> args);
+
+    typedef std::function<void(HotLogLevel level, const std::string& line)> Sink;
+    // Flush decodes records of all threads into @sink, or sLogger if @sink is empty, and returns the count.
+    size_t Flush(const Sink& sink = Sink());
+
+    // Start starts the decoder thread, Stop flushes records left and stops it.
+    void Start();
+    void Stop();
+
+    // GetDroppedCount returns records dropped for full rings since last call.
+    uint64_t GetDroppedCount() { return mDroppedCount.exchange(0); }
+
+private:
+    HotLogger();
+    ~HotLogger() = default;
+
+    HotLogRing* GetThreadRing();
+    void Run();
+
+    static std::atomic_int sMinLevel;
+
+    std::mutex mRingMux;
+    std::vector<std::shared_ptr<HotLogRing> > mRings;
+    std::mutex mFlushMux; // rings are read by one thread at a time
+    std::atomic<uint64_t> mDroppedCount{0};
+
+    std::mutex mMux;
+    std::condition_variable mStopCond;
+    bool mStopped = false;
+    ThreadPtr mThread;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class HotLoggerUnittest;
+#endif
+};
+
+} // namespace logtail
+
+#define LOG_HOT_X(level, format, ...) \
+    do { \
+        if (level >= LOGTAIL_HOT_LOG_MIN_LEVEL && logtail::HotLogger::ShouldLog(level)) { \
+            static const logtail::HotLogFormat sHotLogFormat = {level, __FILE__, __LINE__, format}; \
+            logtail::HotLogger::GetInstance()->Log(&sHotLogFormat, {__VA_ARGS__}); \
+        } \
+    } while (0)
+
+#define LOG_HOT_TRACE(format, ...) LOG_HOT_X(logtail::HOT_LOG_TRACE, format, ##__VA_ARGS__)
+#define LOG_HOT_DEBUG(format, ...) LOG_HOT_X(logtail::HOT_LOG_DEBUG, format, ##__VA_ARGS__)
+#define LOG_HOT_INFO(format, ...) LOG_HOT_X(logtail::HOT_LOG_INFO, format, ##__VA_ARGS__)
+#define LOG_HOT_WARNING(format, ...) LOG_HOT_X(logtail::HOT_LOG_WARNING, format, ##__VA_ARGS__)
@@ -29,7 +29,9 @@
 #include "common/MachineInfoUtil.h"
 #include "common/ErrorUtil.h"
 #include "common/GlobalPara.h"
+#include "common/StartupTimeline.h"
 #include "logger/Logger.h"
+#include "logger/HotLogger.h"
 #ifdef LOGTAIL_RUNTIME_PLUGIN
 #include "plugin/LogtailRuntimePlugin.h"
 #endif
@@ -109,7 +111,10 @@ static void overwrite_community_edition_flags() {
 
 // Main routine of worker process.
 void do_worker_process() {
+    // Startup phases are timed from here.
+    StartupTimeline::GetInstance();
     Logger::Instance().InitGlobalLoggers();
+    HotLogger::GetInstance()->Start();
 
     struct sigaction sigtermSig;
     sigemptyset(&sigtermSig.sa_mask);
@@ -163,11 +168,14 @@ void do_worker_process() {
 
     overwrite_community_edition_flags();
 
-    char* configEnv = getenv(STRING_FLAG(ilogtail_config_env_name).c_str());
-    if (configEnv == NULL || strlen(configEnv) == 0) {
-        AppConfig::GetInstance()->LoadAppConfig(STRING_FLAG(ilogtail_config));
-    } else {
-        AppConfig::GetInstance()->LoadAppConfig(configEnv);
+    {
+        StartupPhaseScope phase("app_config_load");
+        char* configEnv = getenv(STRING_FLAG(ilogtail_config_env_name).c_str());
+        if (configEnv == NULL || strlen(configEnv) == 0) {
+            AppConfig::GetInstance()->LoadAppConfig(STRING_FLAG(ilogtail_config));
+        } else {
+            AppConfig::GetInstance()->LoadAppConfig(configEnv);
+        }
     }
 
     const std::string& interface = AppConfig::GetInstance()->GetBindInterface();
@@ -202,13 +210,19 @@ void do_worker_process() {
     }
 
 #ifdef LOGTAIL_RUNTIME_PLUGIN
-    LogtailRuntimePlugin::GetInstance()->LoadPluginBase();
+    {
+        StartupPhaseScope phase("runtime_plugin_load");
+        LogtailRuntimePlugin::GetInstance()->LoadPluginBase();
+    }
 #endif
 
     // load local config first
-    ConfigManager::GetInstance()->GetLocalConfigUpdate();
-    ConfigManager::GetInstance()->LoadConfig(AppConfig::GetInstance()->GetUserConfigPath());
-    ConfigManager::GetInstance()->LoadDockerConfig();
+    {
+        StartupPhaseScope phase("config_load");
+        ConfigManager::GetInstance()->GetLocalConfigUpdate();
+        ConfigManager::GetInstance()->LoadConfig(AppConfig::GetInstance()->GetUserConfigPath());
+        ConfigManager::GetInstance()->LoadDockerConfig();
+    }
     // mNameCoonfigMap is empty, configExistFlag is false
     bool configExistFlag = !ConfigManager::GetInstance()->GetAllConfig().empty();
 
@@ -251,13 +265,25 @@ void do_worker_process() {
 
     LogtailMonitor::Instance()->InitMonitor();
     LogFilter::Instance()->InitFilter(STRING_FLAG(user_log_config));
-    Sender::Instance()->InitSender();
+    {
+        StartupPhaseScope phase("sender_init");
+        Sender::Instance()->InitSender();
+    }
     LogtailPlugin* pPlugin = LogtailPlugin::GetInstance();
-    if (pPlugin->LoadPluginBase()) {
-        pPlugin->Resume();
+    {
+        StartupPhaseScope phase("plugin_load");
+        if (pPlugin->LoadPluginBase()) {
+            pPlugin->Resume();
+        }
+    }
+    {
+        StartupPhaseScope phase("observer_reload");
+        ObserverManager::GetInstance()->Reload();
+    }
+    {
+        StartupPhaseScope phase("checkpoint_load");
+        CheckPointManager::Instance()->LoadCheckPoint();
     }
-    ObserverManager::GetInstance()->Reload();
-    CheckPointManager::Instance()->LoadCheckPoint();
 
     // added by xianzhi(bowen.gbw@antfin.com)
     // read local data_integrity json file and line count file
@@ -285,8 +311,15 @@ void do_worker_process() {
 
     ConfigManager::GetInstance()->InitConfigServiceClient();
     ConfigManager::GetInstance()->InitUpdateConfig(configExistFlag);
-    ConfigManager::GetInstance()->RegisterHandlers();
-    EventDispatcher::GetInstance()->AddExistedCheckPointFileEvents();
+    {
+        StartupPhaseScope phase("handler_register");
+        ConfigManager::GetInstance()->RegisterHandlers();
+    }
+    {
+        StartupPhaseScope phase("checkpoint_event_restore");
+        EventDispatcher::GetInstance()->AddExistedCheckPointFileEvents();
+    }
+    StartupTimeline::GetInstance()->Finish();
 
     // [Main thread] Run the Dispatch routine.
     EventDispatcher::GetInstance()->Dispatch();
@@ -0,0 +1,189 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "CgroupResource.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include "common/FileSystemUtil.h"
+#include "common/StringTools.h"
+#include "logger/Logger.h"
+
+namespace logtail {
+
+// Limits larger than this are used by cgroup v1 for unlimited.
+static const int64_t kUnlimitedMemBytes = int64_t(1) << 62;
+
+static bool ParseInt64(const std::string& str, int64_t& value) {
+    char* end = NULL;
+    value = strtoll(str.c_str(), &end, 10);
+    return end != str.c_str() && *end == '\0';
+}
+
+static bool ReadFirstLine(const std::string& path, std::string& line) {
+    std::ifstream fin(path);
+    if (!fin.good()) {
+        return false;
+    }
+    std::getline(fin, line);
+    line = TrimString(line);
+    return !line.empty();
+}
+
+static bool ReadInt64(const std::string& path, int64_t& value) {
+    std::string line;
+    if (!ReadFirstLine(path, line) || line == "max") {
+        return false;
+    }
+    return ParseInt64(line, value);
+}
+
+// ReadStatValue gets the value of @key in stat files like memory.stat, which has a "key value" per line.
+static bool ReadStatValue(const std::string& path, const std::string& key, int64_t& value) {
+    std::ifstream fin(path);
+    std::string name;
+    int64_t number = 0;
+    while (fin >> name >> number) {
+        if (name == key) {
+            value = number;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string CgroupResource::FindDir(const std::string& base, const std::string& path, const std::string& probeFile) {
+    if (path != "/" && CheckExistance(base + path + "/" + probeFile)) {
+        return base + path;
+    }
+    if (CheckExistance(base + "/" + probeFile)) {
+        return base;
+    }
+    return "";
+}
+
+bool CgroupResource::Init(const std::string& mountRoot, const std::string& selfCgroupFile) {
+    mVersion = CGROUP_NONE;
+    mCpuDir.clear();
+    mMemoryDir.clear();
+
+    std::ifstream fin(selfCgroupFile);
+    if (!fin.good()) {
+        return false;
+    }
+    // Each line is "hierarchy-ID:controller-list:cgroup-path", cgroup v2 has a single line "0::path".
+    std::string line;
+    std::string unifiedPath;
+    while (std::getline(fin, line)) {
+        size_t first = line.find(':');
+        size_t second = first == std::string::npos ? std::string::npos : line.find(':', first + 1);
+        if (second == std::string::npos) {
+            continue;
+        }
+        const std::string controllers = line.substr(first + 1, second - first - 1);
+        const std::string path = line.substr(second + 1);
+        if (controllers.empty()) {
+            unifiedPath = path;
+            continue;
+        }
+        std::vector<std::string> names = SplitString(controllers, ",");
+        for (const auto& name : names) {
+            if (name == "cpu" && mCpuDir.empty()) {
+                mCpuDir = FindDir(mountRoot + "/" + controllers, path, "cpu.cfs_quota_us");
+                if (mCpuDir.empty()) {
+                    mCpuDir = FindDir(mountRoot + "/cpu", path, "cpu.cfs_quota_us");
+                }
+            } else if (name == "memory" && mMemoryDir.empty()) {
+                mMemoryDir = FindDir(mountRoot + "/memory", path, "memory.limit_in_bytes");
+            }
+        }
+    }
+    if (!mCpuDir.empty() || !mMemoryDir.empty()) {
+        mVersion = CGROUP_V1;
+    } else if (!unifiedPath.empty() && CheckExistance(mountRoot + "/cgroup.controllers")) {
+        mCpuDir = FindDir(mountRoot, unifiedPath, "cpu.max");
+        mMemoryDir = FindDir(mountRoot, unifiedPath, "memory.max");
+        if (!mCpuDir.empty() || !mMemoryDir.empty()) {
+            mVersion = CGROUP_V2;
+        }
+    }
+    LOG_INFO(sLogger, ("cgroup version", mVersion)("cpu dir", mCpuDir)("memory dir", mMemoryDir));
+    return mVersion != CGROUP_NONE;
+}
+
+double CgroupResource::GetCpuQuotaCores() const {
+    if (mCpuDir.empty()) {
+        return -1;
+    }
+    int64_t quota = -1, period = 0;
+    if (mVersion == CGROUP_V2) {
+        // "$MAX $PERIOD", $MAX is "max" if unlimited
+        std::string line;
+        if (!ReadFirstLine(mCpuDir + "/cpu.max", line)) {
+            return -1;
+        }
+        std::istringstream iss(line);
+        std::string max;
+        iss >> max >> period;
+        if (max == "max" || !ParseInt64(max, quota)) {
+            return -1;
+        }
+    } else {
+        if (!ReadInt64(mCpuDir + "/cpu.cfs_quota_us", quota) || !ReadInt64(mCpuDir + "/cpu.cfs_period_us", period)) {
+            return -1;
+        }
+    }
+    if (quota <= 0 || period <= 0) {
+        return -1;
+    }
+    return static_cast<double>(quota) / period;
+}
+
+int64_t CgroupResource::GetMemLimitMb() const {
+    if (mMemoryDir.empty()) {
+        return -1;
+    }
+    int64_t limit = -1;
+    const std::string file = mVersion == CGROUP_V2 ? "/memory.max" : "/memory.limit_in_bytes";
+    if (!ReadInt64(mMemoryDir + file, limit) || limit <= 0 || limit >= kUnlimitedMemBytes) {
+        return -1;
+    }
+    return limit / 1024 / 1024;
+}
+
+int64_t CgroupResource::GetMemUsageMb() const {
+    if (mMemoryDir.empty()) {
+        return -1;
+    }
+    int64_t usage = 0, inactiveFile = 0;
+    if (mVersion == CGROUP_V2) {
+        if (!ReadInt64(mMemoryDir + "/memory.current", usage)) {
+            return -1;
+        }
+        ReadStatValue(mMemoryDir + "/memory.stat", "inactive_file", inactiveFile);
+    } else {
+        if (!ReadInt64(mMemoryDir + "/memory.usage_in_bytes", usage)) {
+            return -1;
+        }
+        ReadStatValue(mMemoryDir + "/memory.stat", "total_inactive_file", inactiveFile);
+    }
+    if (inactiveFile > 0 && inactiveFile < usage) {
+        usage -= inactiveFile;
+    }
+    return usage / 1024 / 1024;
+}
+
+} // namespace logtail
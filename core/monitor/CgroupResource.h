@@ -0,0 +1,55 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <string>
+
+namespace logtail {
+
+// CgroupResource reads the CPU quota and the memory limit and usage of the cgroup which
+// current process belongs to, both cgroup v1 and v2 are supported. When running in a
+// container, they are the resources Logtail can really use rather than those of the host.
+class CgroupResource {
+public:
+    enum Version { CGROUP_NONE = 0, CGROUP_V1 = 1, CGROUP_V2 = 2 };
+
+    // Init locates the cgroup directories by @selfCgroupFile under @mountRoot.
+    // @return false if no cgroup controllers are found, the getters return unlimited then.
+    bool Init(const std::string& mountRoot = "/sys/fs/cgroup",
+              const std::string& selfCgroupFile = "/proc/self/cgroup");
+
+    Version GetVersion() const { return mVersion; }
+
+    // GetCpuQuotaCores returns the CPU quota in cores, or a non-positive value if unlimited.
+    double GetCpuQuotaCores() const;
+    // GetMemLimitMb returns the memory limit in MB, or -1 if unlimited.
+    int64_t GetMemLimitMb() const;
+    // GetMemUsageMb returns the memory usage in MB excluding inactive page cache, which is
+    // what the OOM killer looks at, or -1 if unknown.
+    int64_t GetMemUsageMb() const;
+
+private:
+    // FindDir returns the directory of a controller holding @probeFile, the nested path is tried first,
+    // and then the mount point, which is the cgroup itself when cgroup namespace is used.
+    static std::string FindDir(const std::string& base, const std::string& path, const std::string& probeFile);
+
+    Version mVersion = CGROUP_NONE;
+    std::string mCpuDir;
+    std::string mMemoryDir;
+};
+
+} // namespace logtail
@@ -0,0 +1,343 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CpuProfiler.h"
+#if defined(__linux__)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+#include "app_config/AppConfig.h"
+#include "common/FileSystemUtil.h"
+#include "common/Flags.h"
+#include "common/StringTools.h"
+#include "config_manager/ConfigManager.h"
+#include "log_pb/sls_logs.pb.h"
+#include "logger/Logger.h"
+#include "profile_sender/ProfileSender.h"
+#include "profiler/LogFileProfiler.h"
+
+DEFINE_FLAG_STRING(cpu_profiler_control_file,
+                   "file under data dir to start a cpu profile, content is seconds [frequency] [upload]",
+                   "cpu_profile");
+DEFINE_FLAG_INT32(cpu_profiler_max_seconds, "max seconds of a cpu profile", 300);
+DEFINE_FLAG_INT32(cpu_profiler_default_frequency, "default sampling frequency of cpu profile, Hz", 99);
+DEFINE_FLAG_INT32(cpu_profiler_max_samples, "max samples kept by a cpu profile, 264 bytes each", 32768);
+DEFINE_FLAG_INT32(cpu_profiler_max_upload_stacks, "max stacks of a cpu profile uploaded to profile project", 1000);
+
+namespace logtail {
+
+#if defined(__linux__)
+namespace {
+
+const int kMaxDepth = 32;
+// Frames of the signal handler and the signal trampoline.
+const int kSkippedFrames = 2;
+
+struct Sample {
+    std::atomic<int32_t> mDepth{0};
+    pid_t mTid = 0;
+    void* mFrames[kMaxDepth];
+};
+
+Sample* sSamples = nullptr;
+size_t sSampleCapacity = 0;
+std::atomic<uint64_t> sSampleCount{0};
+std::atomic_bool sSampling{false};
+// Handlers in flight, samples are not read or freed until it drops to zero after sampling stops.
+std::atomic<int32_t> sActiveHandlers{0};
+
+// HandleProfSignal only uses async signal safe calls, backtrace is safe once libgcc is loaded by a call before.
+void HandleProfSignal(int, siginfo_t*, void*) {
+    const int savedErrno = errno;
+    sActiveHandlers.fetch_add(1);
+    if (sSampling.load()) {
+        const uint64_t index = sSampleCount.fetch_add(1);
+        if (index < sSampleCapacity) {
+            Sample& sample = sSamples[index];
+            sample.mTid = static_cast<pid_t>(syscall(SYS_gettid));
+            sample.mDepth.store(backtrace(sample.mFrames, kMaxDepth), std::memory_order_release);
+        }
+    }
+    sActiveHandlers.fetch_sub(1);
+    errno = savedErrno;
+}
+
+std::string GetThreadName(pid_t tid) {
+    std::string name;
+    if (!ReadFileContent("/proc/self/task/" + ToString(tid) + "/comm", name, 64)) {
+        return "thread-" + ToString(tid);
+    }
+    name = TrimString(name);
+    // ';' and ' ' are separators of folded stacks.
+    std::replace(name.begin(), name.end(), ';', '_');
+    std::replace(name.begin(), name.end(), ' ', '_');
+    return name.empty() ? "thread-" + ToString(tid) : name;
+}
+
+std::string GetFrameName(void* address) {
+    Dl_info info;
+    if (dladdr(address, &info) == 0) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "[%p]", address);
+        return buffer;
+    }
+    std::string name;
+    if (info.dli_sname != nullptr) {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+        name = (status == 0 && demangled != nullptr) ? demangled : info.dli_sname;
+        free(demangled);
+    } else {
+        // Not a dynamic symbol, resolved offline by addr2line with module and offset.
+        const char* module = info.dli_fname != nullptr ? strrchr(info.dli_fname, '/') : nullptr;
+        module = module != nullptr ? module + 1 : (info.dli_fname != nullptr ? info.dli_fname : "?");
+        char buffer[32];
+        snprintf(buffer,
+                 sizeof(buffer),
+                 "+0x%lx]",
+                 static_cast<unsigned long>(static_cast<char*>(address) - static_cast<char*>(info.dli_fbase)));
+        name = std::string("[") + module + buffer;
+    }
+    std::replace(name.begin(), name.end(), ';', ':');
+    std::replace(name.begin(), name.end(), ' ', '_');
+    return name;
+}
+
+} // namespace
+#endif
+
+bool CpuProfiler::Start(int32_t seconds, int32_t frequency, bool upload, std::string& error) {
+#if defined(__linux__)
+    if (seconds <= 0 || seconds > INT32_FLAG(cpu_profiler_max_seconds)) {
+        error = "seconds should be in [1, " + ToString(INT32_FLAG(cpu_profiler_max_seconds)) + "]";
+        return false;
+    }
+    if (frequency <= 0) {
+        frequency = INT32_FLAG(cpu_profiler_default_frequency);
+    }
+    if (frequency > 1000) {
+        error = "frequency should be in [1, 1000]";
+        return false;
+    }
+    bool expected = false;
+    if (!mRunning.compare_exchange_strong(expected, true)) {
+        error = "cpu profile is running";
+        return false;
+    }
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+    mThread = std::thread(&CpuProfiler::Run, this, seconds, frequency, upload);
+    LOG_INFO(sLogger, ("start cpu profile, seconds", seconds)("frequency", frequency)("upload", upload));
+    return true;
+#else
+    error = "cpu profile is only supported on Linux";
+    return false;
+#endif
+}
+
+CpuProfiler::Result CpuProfiler::GetLastResult() {
+    std::lock_guard<std::mutex> lock(mResultMutex);
+    return mLastResult;
+}
+
+void CpuProfiler::CheckControlFile() {
+    const std::string path = AppConfig::GetInstance()->GetLogtailSysConfDir() + STRING_FLAG(cpu_profiler_control_file);
+    std::string content;
+    if (!ReadFileContent(path, content, 256)) {
+        return;
+    }
+    remove(path.c_str());
+    std::vector<std::string> args = SplitString(TrimString(content), " ");
+    int32_t seconds = 0, frequency = 0;
+    try {
+        seconds = args.empty() ? 0 : StringTo<int32_t>(args[0]);
+        frequency = args.size() > 1 ? StringTo<int32_t>(args[1]) : 0;
+    } catch (...) {
+        LOG_WARNING(sLogger, ("invalid cpu profile control file", path)("content", content));
+        return;
+    }
+    std::string error;
+    if (!Start(seconds, frequency, args.size() > 2 && args[2] == "upload", error)) {
+        LOG_WARNING(sLogger, ("start cpu profile fail", error)("control file", path));
+    }
+}
+
+CpuProfiler::FoldedStacks
+CpuProfiler::FoldStacks(const std::vector<std::pair<std::string, std::vector<void*>>>& stacks) {
+    FoldedStacks folded;
+#if defined(__linux__)
+    std::unordered_map<void*, std::string> frameNames;
+    std::unordered_map<std::string, uint64_t> counts;
+    for (const auto& stack : stacks) {
+        std::string key = stack.first;
+        for (auto iter = stack.second.rbegin(); iter != stack.second.rend(); ++iter) {
+            auto nameIter = frameNames.find(*iter);
+            if (nameIter == frameNames.end()) {
+                nameIter = frameNames.emplace(*iter, GetFrameName(*iter)).first;
+            }
+            key.append(";").append(nameIter->second);
+        }
+        ++counts[key];
+    }
+    folded.assign(counts.begin(), counts.end());
+    std::sort(folded.begin(),
+              folded.end(),
+              [](const std::pair<std::string, uint64_t>& lhs, const std::pair<std::string, uint64_t>& rhs) {
+                  return lhs.second != rhs.second ? lhs.second > rhs.second : lhs.first < rhs.first;
+              });
+#endif
+    return folded;
+}
+
+void CpuProfiler::Run(int32_t seconds, int32_t frequency, bool upload) {
+#if defined(__linux__)
+    // Samples are taken on other threads, and the sleep below is not interrupted.
+    sigset_t profSet;
+    sigemptyset(&profSet);
+    sigaddset(&profSet, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &profSet, nullptr);
+
+    const size_t capacity = static_cast<size_t>(std::max(INT32_FLAG(cpu_profiler_max_samples), 1));
+    std::unique_ptr<Sample[]> samples(new Sample[capacity]);
+    sSamples = samples.get();
+    sSampleCapacity = capacity;
+    sSampleCount = 0;
+
+    // Loads libgcc, which backtrace may do with malloc at the first call.
+    void* warmup[1];
+    backtrace(warmup, 1);
+    // The handler is kept after the profile, a pending SIGPROF would kill the process with the default action.
+    static std::once_flag sInstallFlag;
+    std::call_once(sInstallFlag, []() {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = HandleProfSignal;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, nullptr);
+    });
+
+    Result result;
+    result.mStartTime = time(NULL);
+    result.mSeconds = seconds;
+    sSampling = true;
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / frequency;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sleep(seconds);
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sSampling = false;
+    while (sActiveHandlers.load() > 0) {
+        usleep(1000);
+    }
+
+    result.mSampleCount = sSampleCount.load();
+    const size_t count = std::min<size_t>(result.mSampleCount, capacity);
+    result.mDroppedCount = result.mSampleCount - count;
+    std::unordered_map<pid_t, std::string> threadNames;
+    std::vector<std::pair<std::string, std::vector<void*>>> stacks;
+    stacks.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const Sample& sample = samples[i];
+        const int32_t depth = sample.mDepth.load(std::memory_order_acquire);
+        if (depth <= kSkippedFrames) {
+            continue;
+        }
+        auto nameIter = threadNames.find(sample.mTid);
+        if (nameIter == threadNames.end()) {
+            nameIter = threadNames.emplace(sample.mTid, GetThreadName(sample.mTid)).first;
+        }
+        stacks.emplace_back(nameIter->second,
+                            std::vector<void*>(sample.mFrames + kSkippedFrames, sample.mFrames + depth));
+    }
+    sSamples = nullptr;
+    samples.reset();
+
+    const FoldedStacks folded = FoldStacks(stacks);
+    result.mStackCount = folded.size();
+    const std::string path
+        = AppConfig::GetInstance()->GetLogtailSysConfDir() + "cpu_profile_" + ToString(result.mStartTime) + ".folded";
+    if (WriteFoldedStacks(path, folded)) {
+        result.mPath = path;
+    }
+    LOG_INFO(sLogger,
+             ("cpu profile done, path", path)("samples", result.mSampleCount)("dropped", result.mDroppedCount)(
+                 "stacks", result.mStackCount));
+    if (upload) {
+        Upload(result, frequency, folded);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mResultMutex);
+        mLastResult = result;
+    }
+#endif
+    mRunning = false;
+}
+
+bool CpuProfiler::WriteFoldedStacks(const std::string& path, const FoldedStacks& stacks) {
+    std::ofstream out(path, std::ios::trunc);
+    for (const auto& stack : stacks) {
+        out << stack.first << ' ' << stack.second << '\n';
+    }
+    out.close();
+    if (!out) {
+        LOG_ERROR(sLogger, ("write cpu profile fail", path)("errno", errno));
+        return false;
+    }
+    return true;
+}
+
+void CpuProfiler::Upload(const Result& result, int32_t frequency, const FoldedStacks& stacks) {
+    const std::string region = ConfigManager::GetInstance()->GetDefaultProfileRegion();
+    const size_t maxStacks = static_cast<size_t>(std::max(INT32_FLAG(cpu_profiler_max_upload_stacks), 0));
+    sls_logs::LogGroup logGroup;
+    logGroup.set_category("logtail_cpu_profile");
+    logGroup.set_source(LogFileProfiler::mIpAddr);
+    for (size_t i = 0; i < stacks.size() && i < maxStacks; ++i) {
+        sls_logs::Log* log = logGroup.add_logs();
+        log->set_time(result.mStartTime);
+        auto addContent = [log](const std::string& key, const std::string& value) {
+            sls_logs::Log_Content* content = log->add_contents();
+            content->set_key(key);
+            content->set_value(value);
+        };
+        addContent("start_time", ToString(result.mStartTime));
+        addContent("seconds", ToString(result.mSeconds));
+        addContent("frequency", ToString(frequency));
+        addContent("samples", ToString(result.mSampleCount));
+        addContent("stack", stacks[i].first);
+        addContent("count", ToString(stacks[i].second));
+    }
+    if (logGroup.logs_size() > 0) {
+        ProfileSender().SendToProfileProject(region, logGroup);
+    }
+}
+
+} // namespace logtail
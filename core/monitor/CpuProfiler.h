@@ -0,0 +1,88 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace logtail {
+
+// CpuProfiler samples stacks of all threads by SIGPROF on demand, so a busy agent can be profiled where perf
+// can not be attached. ITIMER_PROF counts the CPU of the whole process and its signal is taken by a running
+// thread, so samples of each thread are proportional to its CPU.
+//
+// A profile runs for some seconds on a background thread, then stacks are written to the data dir in folded
+// format, one "thread;root;...;leaf count" per line, which is the input of flamegraph.pl and pprof converters,
+// and uploaded to the profile project if asked. Frames are named by dynamic symbols, others are written as
+// module+offset to be resolved offline. It is started by LogtailInsight command "cpuprofile" or by the control
+// file cpu_profiler_control_file. Linux only.
+class CpuProfiler {
+public:
+    struct Result {
+        std::string mPath;
+        int32_t mStartTime = 0;
+        int32_t mSeconds = 0;
+        uint64_t mSampleCount = 0;
+        // Samples beyond cpu_profiler_max_samples.
+        uint64_t mDroppedCount = 0;
+        size_t mStackCount = 0;
+    };
+
+    typedef std::vector<std::pair<std::string, uint64_t>> FoldedStacks;
+
+    static CpuProfiler* GetInstance() {
+        static CpuProfiler* ptr = new CpuProfiler();
+        return ptr;
+    }
+
+    // Start profiles for @seconds at @frequency Hz, returns false with @error if a profile is running or
+    // profiling is not supported.
+    bool Start(int32_t seconds, int32_t frequency, bool upload, std::string& error);
+    bool IsRunning() const { return mRunning; }
+    Result GetLastResult();
+
+    // CheckControlFile starts a profile if the control file exists, its content is "seconds [frequency]
+    // [upload]" and it is removed once read. It is called by LogtailMonitor every second.
+    void CheckControlFile();
+
+    // FoldStacks names frames of @stacks, each one is a thread name and frames from leaf to root as returned by
+    // backtrace, and counts them by folded stack, in descending order of count.
+    static FoldedStacks FoldStacks(const std::vector<std::pair<std::string, std::vector<void*>>>& stacks);
+
+private:
+    CpuProfiler() = default;
+    ~CpuProfiler() = default;
+
+    void Run(int32_t seconds, int32_t frequency, bool upload);
+    bool WriteFoldedStacks(const std::string& path, const FoldedStacks& stacks);
+    void Upload(const Result& result, int32_t frequency, const FoldedStacks& stacks);
+
+    std::atomic_bool mRunning{false};
+    std::thread mThread;
+    std::mutex mResultMutex;
+    Result mLastResult;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class CpuProfilerUnittest;
+#endif
+};
+
+} // namespace logtail
@@ -0,0 +1,279 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "MetricRegistry.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace logtail {
+
+static uint64_t DoubleToBits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double BitsToDouble(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static std::string FormatMetricValue(double value) {
+    if (std::isinf(value)) {
+        return value > 0 ? "+Inf" : "-Inf";
+    }
+    if (std::fabs(value) < 9007199254740992.0 && value == std::floor(value)) {
+        return std::to_string(static_cast<int64_t>(value));
+    }
+    return std::to_string(value);
+}
+
+static std::string PrometheusName(const std::string& name) {
+    std::string result(name);
+    for (size_t i = 0; i < result.size(); ++i) {
+        char c = result[i];
+        bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':';
+        if (!valid && !(c >= '0' && c <= '9' && i > 0)) {
+            result[i] = '_';
+        }
+    }
+    return result;
+}
+
+static void AppendPrometheusLabels(std::string& text, const MetricLabels& labels, const std::string& le) {
+    if (labels.empty() && le.empty()) {
+        return;
+    }
+    text.push_back('{');
+    bool first = true;
+    auto appendLabel = [&text, &first](const std::string& key, const std::string& value) {
+        if (!first) {
+            text.push_back(',');
+        }
+        first = false;
+        text.append(PrometheusName(key)).append("=\"");
+        for (char c : value) {
+            if (c == '\\' || c == '"') {
+                text.push_back('\\');
+                text.push_back(c);
+            } else if (c == '\n') {
+                text.append("\\n");
+            } else {
+                text.push_back(c);
+            }
+        }
+        text.push_back('"');
+    };
+    for (const auto& label : labels) {
+        appendLabel(label.first, label.second);
+    }
+    if (!le.empty()) {
+        appendLabel("le", le);
+    }
+    text.push_back('}');
+}
+
+static std::string LabelsKey(const MetricLabels& labels) {
+    std::string key;
+    for (const auto& label : labels) {
+        if (!key.empty()) {
+            key.push_back(',');
+        }
+        key.append(label.first).append("=").append(label.second);
+    }
+    return key;
+}
+
+void MetricGauge::Set(double value) {
+    mBits.store(DoubleToBits(value), std::memory_order_relaxed);
+}
+
+double MetricGauge::Get() const {
+    return BitsToDouble(mBits.load(std::memory_order_relaxed));
+}
+
+MetricHistogram::MetricHistogram(const std::vector<double>& bounds)
+    : mBounds(bounds), mBuckets(new std::atomic<uint64_t>[bounds.size() + 1]) {
+    std::sort(mBounds.begin(), mBounds.end());
+    for (size_t i = 0; i <= mBounds.size(); ++i) {
+        mBuckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void MetricHistogram::Observe(double value) {
+    size_t index = std::lower_bound(mBounds.begin(), mBounds.end(), value) - mBounds.begin();
+    mBuckets[index].fetch_add(1, std::memory_order_relaxed);
+    mCount.fetch_add(1, std::memory_order_relaxed);
+    uint64_t oldBits = mSumBits.load(std::memory_order_relaxed);
+    while (!mSumBits.compare_exchange_weak(
+        oldBits, DoubleToBits(BitsToDouble(oldBits) + value), std::memory_order_relaxed)) {
+    }
+}
+
+double MetricHistogram::GetSum() const {
+    return BitsToDouble(mSumBits.load(std::memory_order_relaxed));
+}
+
+MetricRegistry::Entry*
+MetricRegistry::FindOrCreate(const std::string& name, const MetricLabels& labels, MetricType type, bool& created) {
+    // '\0' sorts before any character, so metrics of the same name are adjacent.
+    std::string key = name;
+    key.push_back('\0');
+    key.append(LabelsKey(labels));
+    auto iter = mEntries.find(key);
+    if (iter != mEntries.end()) {
+        created = false;
+        return iter->second->mType == type ? iter->second.get() : nullptr;
+    }
+    created = true;
+    std::unique_ptr<Entry> entry(new Entry);
+    entry->mName = name;
+    entry->mLabels = labels;
+    entry->mType = type;
+    Entry* ptr = entry.get();
+    mEntries.insert(std::make_pair(key, std::move(entry)));
+    return ptr;
+}
+
+MetricCounter* MetricRegistry::RegisterCounter(const std::string& name, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mMux);
+    bool created = false;
+    Entry* entry = FindOrCreate(name, labels, COUNTER, created);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    if (created) {
+        entry->mCounter.reset(new MetricCounter);
+    }
+    return entry->mCounter.get();
+}
+
+MetricGauge* MetricRegistry::RegisterGauge(const std::string& name, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mMux);
+    bool created = false;
+    Entry* entry = FindOrCreate(name, labels, GAUGE, created);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    if (created) {
+        entry->mGauge.reset(new MetricGauge);
+    }
+    return entry->mGauge.get();
+}
+
+MetricHistogram* MetricRegistry::RegisterHistogram(const std::string& name,
+                                                   const std::vector<double>& bounds,
+                                                   const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mMux);
+    bool created = false;
+    Entry* entry = FindOrCreate(name, labels, HISTOGRAM, created);
+    if (entry == nullptr) {
+        return nullptr;
+    }
+    if (created) {
+        entry->mHistogram.reset(new MetricHistogram(bounds));
+    }
+    return entry->mHistogram.get();
+}
+
+std::string MetricRegistry::ToPrometheusText() const {
+    static const char* kTypeNames[] = {"counter", "gauge", "histogram"};
+    std::string text;
+    std::lock_guard<std::mutex> lock(mMux);
+    const Entry* last = nullptr;
+    for (const auto& item : mEntries) {
+        const Entry& entry = *item.second;
+        const std::string name = PrometheusName(entry.mName);
+        if (last == nullptr || last->mName != entry.mName) {
+            text.append("# TYPE ").append(name).append(" ").append(kTypeNames[entry.mType]).append("\n");
+        }
+        last = &entry;
+        switch (entry.mType) {
+            case COUNTER:
+                text.append(name);
+                AppendPrometheusLabels(text, entry.mLabels, "");
+                text.append(" ").append(std::to_string(entry.mCounter->Get())).append("\n");
+                break;
+            case GAUGE:
+                text.append(name);
+                AppendPrometheusLabels(text, entry.mLabels, "");
+                text.append(" ").append(FormatMetricValue(entry.mGauge->Get())).append("\n");
+                break;
+            case HISTOGRAM: {
+                const MetricHistogram& histogram = *entry.mHistogram;
+                const std::vector<double>& bounds = histogram.GetBounds();
+                uint64_t cumulative = 0;
+                for (size_t i = 0; i <= bounds.size(); ++i) {
+                    cumulative += histogram.GetBucketCount(i);
+                    text.append(name).append("_bucket");
+                    AppendPrometheusLabels(
+                        text, entry.mLabels, i < bounds.size() ? FormatMetricValue(bounds[i]) : "+Inf");
+                    text.append(" ").append(std::to_string(cumulative)).append("\n");
+                }
+                text.append(name).append("_sum");
+                AppendPrometheusLabels(text, entry.mLabels, "");
+                text.append(" ").append(FormatMetricValue(histogram.GetSum())).append("\n");
+                text.append(name).append("_count");
+                AppendPrometheusLabels(text, entry.mLabels, "");
+                text.append(" ").append(std::to_string(histogram.GetCount())).append("\n");
+                break;
+            }
+        }
+    }
+    return text;
+}
+
+void MetricRegistry::ExportTo(std::map<std::string, std::string>& metrics) const {
+    std::lock_guard<std::mutex> lock(mMux);
+    for (const auto& item : mEntries) {
+        const Entry& entry = *item.second;
+        const std::string labels = entry.mLabels.empty() ? "" : "{" + LabelsKey(entry.mLabels) + "}";
+        const std::string key = entry.mName + labels;
+        switch (entry.mType) {
+            case COUNTER:
+                metrics[key] = std::to_string(entry.mCounter->Get());
+                break;
+            case GAUGE:
+                metrics[key] = FormatMetricValue(entry.mGauge->Get());
+                break;
+            case HISTOGRAM: {
+                const MetricHistogram& histogram = *entry.mHistogram;
+                const std::vector<double>& bounds = histogram.GetBounds();
+                std::string buckets;
+                for (size_t i = 0; i <= bounds.size(); ++i) {
+                    if (!buckets.empty()) {
+                        buckets.push_back(',');
+                    }
+                    buckets.append(i < bounds.size() ? FormatMetricValue(bounds[i]) : "+Inf")
+                        .append(":")
+                        .append(std::to_string(histogram.GetBucketCount(i)));
+                }
+                metrics[key] = buckets;
+                metrics[entry.mName + "_count" + labels] = std::to_string(histogram.GetCount());
+                metrics[entry.mName + "_sum" + labels] = FormatMetricValue(histogram.GetSum());
+                break;
+            }
+        }
+    }
+}
+
+size_t MetricRegistry::GetMetricCount() const {
+    std::lock_guard<std::mutex> lock(mMux);
+    return mEntries.size();
+}
+
+} // namespace logtail
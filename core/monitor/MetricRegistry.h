@@ -0,0 +1,121 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace logtail {
+
+typedef std::vector<std::pair<std::string, std::string>> MetricLabels;
+
+// MetricCounter is a monotonic counter.
+class MetricCounter {
+public:
+    void Add(uint64_t value = 1) { mValue.fetch_add(value, std::memory_order_relaxed); }
+    uint64_t Get() const { return mValue.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> mValue{0};
+};
+
+// MetricGauge keeps the last value set.
+class MetricGauge {
+public:
+    void Set(double value);
+    double Get() const;
+
+private:
+    // bits of the double value, std::atomic<double> has no portable lock-free guarantee.
+    std::atomic<uint64_t> mBits{0};
+};
+
+// MetricHistogram counts values into buckets, the upper bounds are fixed when it's registered and an
+// extra +Inf bucket is appended.
+class MetricHistogram {
+public:
+    explicit MetricHistogram(const std::vector<double>& bounds);
+
+    void Observe(double value);
+
+    const std::vector<double>& GetBounds() const { return mBounds; }
+    // GetBucketCount returns the non-cumulative count of bucket index, bounds.size() is the +Inf bucket.
+    uint64_t GetBucketCount(size_t index) const { return mBuckets[index].load(std::memory_order_relaxed); }
+    uint64_t GetCount() const { return mCount.load(std::memory_order_relaxed); }
+    double GetSum() const;
+
+private:
+    std::vector<double> mBounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> mBuckets;
+    std::atomic<uint64_t> mCount{0};
+    std::atomic<uint64_t> mSumBits{0};
+};
+
+// MetricRegistry owns metrics identified by name and labels. Metrics are never removed, so handles got
+// from Register* can be kept (e.g. in statics) and updated from hot loops without locks or allocations,
+// only registering and exporting take the lock.
+//
+// Registering the same name and labels again returns the same metric, nullptr is returned if the type
+// registered before is different.
+class MetricRegistry {
+public:
+    static MetricRegistry* GetInstance() {
+        static MetricRegistry* ptr = new MetricRegistry();
+        return ptr;
+    }
+
+    MetricCounter* RegisterCounter(const std::string& name, const MetricLabels& labels = MetricLabels());
+    MetricGauge* RegisterGauge(const std::string& name, const MetricLabels& labels = MetricLabels());
+    MetricHistogram* RegisterHistogram(const std::string& name,
+                                       const std::vector<double>& bounds,
+                                       const MetricLabels& labels = MetricLabels());
+
+    // ToPrometheusText exports all metrics in the Prometheus text exposition format.
+    std::string ToPrometheusText() const;
+
+    // ExportTo exports all metrics as strings for SLS status profiles, keys are "name{k=v,...}" or name if
+    // there is no label. Histograms are exported as name_count, name_sum and name with bucket counts.
+    void ExportTo(std::map<std::string, std::string>& metrics) const;
+
+    size_t GetMetricCount() const;
+
+private:
+    enum MetricType { COUNTER, GAUGE, HISTOGRAM };
+
+    struct Entry {
+        std::string mName;
+        MetricLabels mLabels;
+        MetricType mType;
+        std::unique_ptr<MetricCounter> mCounter;
+        std::unique_ptr<MetricGauge> mGauge;
+        std::unique_ptr<MetricHistogram> mHistogram;
+    };
+
+    MetricRegistry() = default;
+    Entry* FindOrCreate(const std::string& name, const MetricLabels& labels, MetricType type, bool& created);
+
+    mutable std::mutex mMux;
+    std::map<std::string, std::unique_ptr<Entry>> mEntries; // key: name{labels}, sorted to group names
+};
+
+} // namespace logtail
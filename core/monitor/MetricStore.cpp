@@ -13,12 +13,19 @@
 // limitations under the License.
 
 #include "MetricStore.h"
+#include <map>
 #include <json/json.h>
+#include "MetricRegistry.h"
 
 namespace logtail {
 
 std::string MetricStore::MetricToString() {
     Json::Value rootValue;
+    std::map<std::string, std::string> registryMetrics;
+    MetricRegistry::GetInstance()->ExportTo(registryMetrics);
+    for (const auto& item : registryMetrics) {
+        rootValue[item.first] = Json::Value(item.second);
+    }
     ScopedSpinLock lock(mMonitorMetricLock);
     auto iter = mLogtailMetric.begin();
     for (; iter != mLogtailMetric.end(); ++iter) {
@@ -38,32 +45,23 @@ std::string MetricStore::CheckLogtailStatus() {
     int32_t openFdCount = 0;
     double processTps = 0.;
 
-    ScopedSpinLock lock(mMonitorMetricLock);
-    auto iter = mLogtailMetric.find("process_queue_full");
-    if (iter != mLogtailMetric.end()) {
-        processFull = StringTo<int32_t>(iter->second);
-    }
-
-    iter = mLogtailMetric.find("send_queue_full");
-    if (iter != mLogtailMetric.end()) {
-        sendFull = StringTo<int32_t>(iter->second);
-    }
-
-    iter = mLogtailMetric.find("sender_invalid");
-    if (iter != mLogtailMetric.end()) {
-        senderInvalid = StringTo<int32_t>(iter->second);
-    }
+    // queue and throughput metrics are kept in the registry.
+    static MetricRegistry* sRegistry = MetricRegistry::GetInstance();
+    static MetricGauge* sProcessFull = sRegistry->RegisterGauge("process_queue_full");
+    static MetricGauge* sSendFull = sRegistry->RegisterGauge("send_queue_full");
+    static MetricGauge* sSenderInvalid = sRegistry->RegisterGauge("sender_invalid");
+    static MetricGauge* sProcessTps = sRegistry->RegisterGauge("process_tps");
+    processFull = static_cast<int32_t>(sProcessFull->Get());
+    sendFull = static_cast<int32_t>(sSendFull->Get());
+    senderInvalid = static_cast<int32_t>(sSenderInvalid->Get());
+    processTps = sProcessTps->Get();
 
-    iter = mLogtailMetric.find("open_fd");
+    ScopedSpinLock lock(mMonitorMetricLock);
+    auto iter = mLogtailMetric.find("open_fd");
     if (iter != mLogtailMetric.end()) {
         openFdCount = StringTo<int32_t>(iter->second);
     }
 
-    iter = mLogtailMetric.find("process_tps");
-    if (iter != mLogtailMetric.end()) {
-        processTps = StringTo<double>(iter->second);
-    }
-
     metricStr = "ok";
     if (processTps > 20.)
         metricStr = "busy";
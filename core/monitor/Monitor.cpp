@@ -19,6 +19,7 @@
 #elif defined(_MSC_VER)
 #include <Psapi.h>
 #endif
+#include <algorithm>
 #include <functional>
 #include <fstream>
 #include "common/Constants.h"
@@ -31,9 +32,15 @@
 #include "common/GlobalPara.h"
 #include "common/version.h"
 #include "common/MachineInfoUtil.h"
+#include "common/FileSystemUtil.h"
+#include "common/StartupTimeline.h"
 #include "log_pb/sls_logs.pb.h"
 #include "logger/Logger.h"
+#include "MetricRegistry.h"
+#include "CpuProfiler.h"
 #include "sender/Sender.h"
+#include "sender/AdaptiveBatchPolicy.h"
+#include "sender/AdaptiveCompressPolicy.h"
 #include "profiler/LogFileProfiler.h"
 #include "profiler/LogtailAlarm.h"
 #include "config_manager/ConfigManager.h"
@@ -49,8 +56,24 @@ using namespace std;
 using namespace sls_logs;
 
 DEFINE_FLAG_BOOL(logtail_dump_monitor_info, "enable to dump Logtail monitor info (CPU, mem)", false);
+DEFINE_FLAG_STRING(logtail_prometheus_metrics_file,
+                   "file to dump metrics in Prometheus text format every monitor interval, empty means disabled",
+                   "");
+DEFINE_FLAG_BOOL(enable_cgroup_resource_limit,
+                 "bound cpu and memory limits by the quota and limit of the cgroup of Logtail",
+                 false);
+DEFINE_FLAG_DOUBLE(cgroup_resource_limit_ratio, "ratio of cgroup cpu quota and memory limit used as limits", 0.9);
+DEFINE_FLAG_BOOL(enable_resource_degradation,
+                 "slow down reading and shrink batches before restarting when cpu or memory exceeds limits",
+                 false);
+DEFINE_FLAG_DOUBLE(resource_degradation_soft_ratio, "ratio of the limits to start degradation", 0.8);
+DEFINE_FLAG_INT32(resource_degradation_recover_interval,
+                  "seconds below the soft limit before lowering degrade level",
+                  10);
 DECLARE_FLAG_BOOL(send_prefer_real_ip);
 DECLARE_FLAG_BOOL(check_profile_region);
+DECLARE_FLAG_BOOL(enable_adaptive_compress);
+DECLARE_FLAG_BOOL(enable_process_thread_scaling);
 
 namespace logtail {
 
@@ -104,6 +127,9 @@ bool LogtailMonitor::InitMonitor() {
     }
     mCpuArrayForScaleIdx = 0;
 #endif
+    if (BOOL_FLAG(enable_cgroup_resource_limit) && mCgroupResource.Init()) {
+        UpdateCgroupLimits();
+    }
 
     // Initialize monitor thread.
     mMonitorRunning = true;
@@ -134,12 +160,24 @@ void LogtailMonitor::Monitor() {
         sleep(1);
         GetCpuStat(curCpuStat);
 
-        // Update mRealtimeCpuStat for InputFlowControl.
-        if (AppConfig::GetInstance()->IsInputFlowControl()) {
+        // Update mRealtimeCpuStat for InputFlowControl, degradation, adaptive compression and process threads.
+        const bool degradation = BOOL_FLAG(enable_resource_degradation);
+        const bool adaptiveCompress = BOOL_FLAG(enable_adaptive_compress);
+        if (AppConfig::GetInstance()->IsInputFlowControl() || degradation || adaptiveCompress
+            || BOOL_FLAG(enable_process_thread_scaling)) {
             CalCpuStat(curCpuStat, mRealtimeCpuStat);
         }
+        if (adaptiveCompress) {
+            AdaptiveCompressPolicy::GetInstance()->SetCpuLevel(GetRealtimeCpuLevel());
+        }
+
+        CpuProfiler::GetInstance()->CheckControlFile();
 
         int32_t monitorTime = time(NULL);
+        if (degradation) {
+            GetMemStat();
+            UpdateDegradeLevel(monitorTime);
+        }
 #if defined(__linux__) // TODO: Add auto scale support for Windows.
         // Update related CPU statistics for controlling resource auto scale (Linux only).
         if (AppConfig::GetInstance()->IsResourceAutoScale()) {
@@ -166,6 +204,7 @@ void LogtailMonitor::Monitor() {
             LOG_DEBUG(sLogger, ("Memory is upper limit", "run gabbage collection."));
             LogInput::GetInstance()->SetForceClearFlag(true);
         }
+        UpdateCgroupLimits();
         GetMemStat();
         CalCpuStat(curCpuStat, mCpuStat);
         // CalCpuLimit and CalMemLimit will check if the number of violation (CPU
@@ -190,6 +229,10 @@ void LogtailMonitor::Monitor() {
             if (!DumpMonitorInfo(monitorTime))
                 LOG_ERROR(sLogger, ("Fail to dump monitor info", ""));
         }
+        if (!STRING_FLAG(logtail_prometheus_metrics_file).empty()) {
+            if (!DumpPrometheusMetrics(STRING_FLAG(logtail_prometheus_metrics_file)))
+                LOG_ERROR(sLogger, ("Fail to dump prometheus metrics", STRING_FLAG(logtail_prometheus_metrics_file)));
+        }
     }
 }
 
@@ -241,6 +284,13 @@ bool LogtailMonitor::SendStatusProfile(bool suicide) {
 #endif
     // Memory usage of Logtail process.
     AddLogContent(logPtr, "mem", mMemStat.mRss);
+    if (mCgroupResource.GetVersion() != CgroupResource::CGROUP_NONE) {
+        AddLogContent(logPtr, "cgroup_cpu_limit", mCgroupCpuLimit);
+        AddLogContent(logPtr, "cgroup_mem_limit", mCgroupMemLimitMb);
+    }
+    if (BOOL_FLAG(enable_resource_degradation)) {
+        AddLogContent(logPtr, "degrade_level", GetDegradeLevel());
+    }
     // The version, uuid of Logtail.
     AddLogContent(logPtr, "version", ILOGTAIL_VERSION);
     AddLogContent(logPtr, "uuid", ConfigManager::GetInstance()->GetUUID());
@@ -261,6 +311,7 @@ bool LogtailMonitor::SendStatusProfile(bool suicide) {
     AddLogContent(logPtr, "load", GetLoadAvg());
 #endif
     AddLogContent(logPtr, "plugin_stats", ConfigManager::GetInstance()->GeneratePluginStatString());
+    AddLogContent(logPtr, "startup_timeline", StartupTimeline::GetInstance()->ToString());
     // Metrics.
     vector<string> allProfileRegion;
     ConfigManager::GetInstance()->GetAllProfileRegion(allProfileRegion);
@@ -282,6 +333,11 @@ bool LogtailMonitor::SendStatusProfile(bool suicide) {
         UpdateMetric("env_config_count", envTags.size());
     }
     UpdateMetric("used_sending_concurrency", Sender::Instance()->GetSendingBufferCount());
+    std::map<std::string, std::string> sendHistograms;
+    Sender::Instance()->DumpSendHistograms(sendHistograms);
+    for (const auto& item : sendHistograms) {
+        UpdateMetric("send_histogram@" + item.first, item.second);
+    }
 
     AddLogContent(logPtr, "metric_json", MetricToString());
     AddLogContent(logPtr, "status", CheckLogtailStatus());
@@ -411,11 +467,72 @@ void LogtailMonitor::CalCpuStat(const CpuStat& curCpu, CpuStat& savedCpu) {
 #endif
 }
 
-bool LogtailMonitor::CheckCpuLimit() {
+void LogtailMonitor::UpdateCgroupLimits() {
+    if (mCgroupResource.GetVersion() == CgroupResource::CGROUP_NONE) {
+        return;
+    }
+    const double ratio = DOUBLE_FLAG(cgroup_resource_limit_ratio);
+    const double cpuQuota = mCgroupResource.GetCpuQuotaCores();
+    const int64_t memLimit = mCgroupResource.GetMemLimitMb();
+    const float cpuLimit = cpuQuota > 0 ? static_cast<float>(cpuQuota * ratio) : 0;
+    const int64_t memLimitMb = memLimit > 0 ? static_cast<int64_t>(memLimit * ratio) : -1;
+    if (cpuLimit != mCgroupCpuLimit || memLimitMb != mCgroupMemLimitMb) {
+        LOG_INFO(sLogger, ("cgroup cpu limit", cpuLimit)("cgroup mem limit mb", memLimitMb));
+    }
+    mCgroupCpuLimit = cpuLimit;
+    mCgroupMemLimitMb = memLimitMb;
+}
+
+float LogtailMonitor::GetCpuUsageLimit() const {
     float cpuUsageLimit = AppConfig::GetInstance()->IsResourceAutoScale()
         ? AppConfig::GetInstance()->GetScaledCpuUsageUpLimit()
         : AppConfig::GetInstance()->GetCpuUsageUpLimit();
-    if (cpuUsageLimit < mCpuStat.mCpuUsage) {
+    return LimitByCgroupCpu(cpuUsageLimit);
+}
+
+int64_t LogtailMonitor::GetMemUsageLimitMb() const {
+    int64_t memUsageLimit = AppConfig::GetInstance()->GetMemUsageUpLimit();
+    if (mCgroupMemLimitMb > 0 && mCgroupMemLimitMb < memUsageLimit) {
+        memUsageLimit = mCgroupMemLimitMb;
+    }
+    return memUsageLimit;
+}
+
+void LogtailMonitor::UpdateDegradeLevel(int32_t curTime) {
+    const float cpuLimit = GetCpuUsageLimit();
+    const int64_t memLimit = GetMemUsageLimitMb();
+    const float cpuPressure = cpuLimit > 0 ? mRealtimeCpuStat.mCpuUsage / cpuLimit : 0;
+    const float memPressure = memLimit > 0 ? static_cast<float>(mMemStat.mRss) / memLimit : 0;
+    const float pressure = std::max(cpuPressure, memPressure);
+    mResourcePressure.store(pressure, std::memory_order_relaxed);
+
+    const int32_t oldLevel = GetDegradeLevel();
+    int32_t level = oldLevel;
+    if (pressure >= 1.0) {
+        level = std::min(level + 1, MAX_DEGRADE_LEVEL);
+        mLastDegradeTime = curTime;
+    } else if (pressure >= DOUBLE_FLAG(resource_degradation_soft_ratio)) {
+        level = std::max(level, 1);
+        mLastDegradeTime = curTime;
+    } else if (level > 0 && curTime - mLastDegradeTime >= INT32_FLAG(resource_degradation_recover_interval)) {
+        --level;
+        mLastDegradeTime = curTime;
+    }
+    if (level == oldLevel) {
+        return;
+    }
+    mDegradeLevel.store(level, std::memory_order_relaxed);
+    // Each level halves batch size limits, so less data is held in memory.
+    AdaptiveBatchPolicy::GetInstance()->SetResourceScale(1.0 / (1 << level));
+    LOG_INFO(sLogger,
+             ("change degrade level", level)("old level", oldLevel)("cpu usage", mRealtimeCpuStat.mCpuUsage)(
+                 "cpu limit", cpuLimit)("mem rss", mMemStat.mRss)("mem limit", memLimit));
+}
+
+bool LogtailMonitor::CheckCpuLimit() {
+    // With degradation, violations are only counted at the max level, so restarting is the last resort.
+    if (GetCpuUsageLimit() < mCpuStat.mCpuUsage
+        && (!BOOL_FLAG(enable_resource_degradation) || GetDegradeLevel() == MAX_DEGRADE_LEVEL)) {
         if (++mCpuStat.mViolateNum > INT32_FLAG(cpu_limit_num))
             return true;
     } else
@@ -424,7 +541,8 @@ bool LogtailMonitor::CheckCpuLimit() {
 }
 
 bool LogtailMonitor::CheckMemLimit() {
-    if (mMemStat.mRss > AppConfig::GetInstance()->GetMemUsageUpLimit()) {
+    if (mMemStat.mRss > GetMemUsageLimitMb()
+        && (!BOOL_FLAG(enable_resource_degradation) || GetDegradeLevel() == MAX_DEGRADE_LEVEL)) {
         if (++mMemStat.mViolateNum > INT32_FLAG(mem_limit_num))
             return true;
     } else
@@ -461,6 +579,18 @@ bool LogtailMonitor::DumpMonitorInfo(time_t monitorTime) {
     return true;
 }
 
+bool LogtailMonitor::DumpPrometheusMetrics(const std::string& path) {
+    const std::string tmpPath = path + ".tmp";
+    if (!OverwriteFile(tmpPath, MetricRegistry::GetInstance()->ToPrometheusText())) {
+        return false;
+    }
+#if defined(_MSC_VER)
+    // rename fails on Windows if the target exists.
+    remove(path.c_str());
+#endif
+    return rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
 bool LogtailMonitor::IsHostIpChanged() {
     if (AppConfig::GetInstance()->GetConfigIP().empty()) {
         const std::string& interface = AppConfig::GetInstance()->GetBindInterface();
@@ -574,7 +704,7 @@ void LogtailMonitor::CheckScaledCpuUsageUpLimit() {
     // we can not scale up, otherwise, we can increase mScaledCpuUsageUpLimit by
     // mScaledCpuUsageStep.
     if (mCpuArrayForScaleIdx % CPU_STAT_FOR_SCALE_ARRAY_SIZE == 0) {
-        if ((mScaledCpuUsageUpLimit + mScaledCpuUsageStep) >= (mCpuCores * machineCpuUsageThreshold))
+        if ((mScaledCpuUsageUpLimit + mScaledCpuUsageStep) >= LimitByCgroupCpu(mCpuCores * machineCpuUsageThreshold))
             return;
         for (int32_t i = 0; i < CPU_STAT_FOR_SCALE_ARRAY_SIZE; ++i) {
             if ((mOsCpuArrayForScale[i] / machineCpuUsageThreshold) >= 0.95
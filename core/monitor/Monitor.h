@@ -16,7 +16,9 @@
 
 #pragma once
 #include "MetricStore.h"
+#include <atomic>
 #include <string>
+#include "CgroupResource.h"
 #include "common/Thread.h"
 #include "profile_sender/ProfileSender.h"
 #if defined(_MSC_VER)
@@ -88,7 +90,16 @@ public:
 
     // GetRealtimeCpuLevel return a value to indicates current CPU usage level.
     // LogInput use it to do flow control.
-    float GetRealtimeCpuLevel() { return mRealtimeCpuStat.mCpuUsage / mScaledCpuUsageUpLimit; }
+    float GetRealtimeCpuLevel() { return mRealtimeCpuStat.mCpuUsage / LimitByCgroupCpu(mScaledCpuUsageUpLimit); }
+
+    // Levels of graceful degradation (flag enable_resource_degradation). When CPU or memory usage gets close
+    // to the limits, LogInput slows down reading and Aggregator shrinks batches more at each level, restarting
+    // is the last resort if the usage still exceeds limits at the max level.
+    static const int32_t MAX_DEGRADE_LEVEL = 3;
+    int32_t GetDegradeLevel() const { return mDegradeLevel.load(std::memory_order_relaxed); }
+    // GetResourcePressure returns the max ratio of CPU and memory usage to their limits, 0 if degradation
+    // is disabled.
+    float GetResourcePressure() const { return mResourcePressure.load(std::memory_order_relaxed); }
 
 private:
     ThreadPtr mMonitorThreadPtr;
@@ -121,6 +132,16 @@ private:
 #endif
     ProfileSender mProfileSender;
 
+    // Limits of the cgroup of Logtail (flag enable_cgroup_resource_limit), scaled by
+    // cgroup_resource_limit_ratio, 0 or -1 if unlimited.
+    CgroupResource mCgroupResource;
+    float mCgroupCpuLimit = 0;
+    int64_t mCgroupMemLimitMb = -1;
+
+    std::atomic_int mDegradeLevel{0};
+    std::atomic<float> mResourcePressure{0};
+    int32_t mLastDegradeTime = 0;
+
 private:
     // GetCpuStat gets current CPU statistics of Logtail process and save it to @cpuStat.
     // @return true if get successfully.
@@ -132,6 +153,20 @@ private:
     // set @curCpu to @savedCpu after calculation.
     void CalCpuStat(const CpuStat& curCpu, CpuStat& savedCpu);
 
+    // UpdateCgroupLimits reads the CPU quota and memory limit of cgroup again, they may be changed
+    // when container is resized.
+    void UpdateCgroupLimits();
+    float LimitByCgroupCpu(float limit) const {
+        return (mCgroupCpuLimit > 0 && mCgroupCpuLimit < limit) ? mCgroupCpuLimit : limit;
+    }
+    // GetCpuUsageLimit and GetMemUsageLimitMb return the limits from configuration bounded by cgroup.
+    float GetCpuUsageLimit() const;
+    int64_t GetMemUsageLimitMb() const;
+
+    // UpdateDegradeLevel raises the degrade level every second while the usage exceeds limits, and lowers
+    // it after resource_degradation_recover_interval seconds below the soft limit.
+    void UpdateDegradeLevel(int32_t curTime);
+
     // CheckCpuLimit checks if current cpu usage exceeds limit.
     // @return true if the cpu usage exceeds limit continuously.
     bool CheckCpuLimit();
@@ -151,6 +186,10 @@ private:
     // DumpMonitorInfo dumps simple monitor information to local.
     bool DumpMonitorInfo(time_t monitorTime);
 
+    // DumpPrometheusMetrics writes metrics of MetricRegistry to path in Prometheus text format. It's written
+    // to a temporary file and renamed, so collectors never read a partial file.
+    bool DumpPrometheusMetrics(const std::string& path);
+
 #if defined(__linux__)
     // GetLoadAvg gets system load information.
     std::string GetLoadAvg();
@@ -173,6 +212,7 @@ private:
 
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class ConfigUpdatorUnittest;
+    friend class MonitorDegradeUnittest;
 #endif
 };
 
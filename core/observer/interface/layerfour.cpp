@@ -34,14 +34,84 @@ void NetStatisticsKey::ToPB(sls_logs::Log* log) const {
     AddAnyLogContent(log, observer::kType, ObserverMetricsTypeToString(ObserverMetricsType::L4_METRICS));
 }
 
+size_t NetStaticticsMap::Index(const NetStatisticsKey& key) const {
+    // Fibonacci hashing spreads pid and sock hash over the high bits used as index.
+    uint64_t hash = uint64_t(NetStatisticsKeyHash()(key)) * 0x9E3779B97F4A7C15ULL;
+    return size_t(hash ^ (hash >> 32)) & (mSlots.size() - 1);
+}
+
 logtail::NetStatisticsTCP& NetStaticticsMap::GetStatisticsItem(const logtail::NetStatisticsKey& key) {
-    auto findRst = mHashMap.find(key);
-    if (findRst != mHashMap.end()) {
-        return findRst->second;
+    static NetStatisticsKeyEqual sEqual;
+    if (mSlots.empty()) {
+        mSlots.resize(kInitialCapacity);
+    }
+    const size_t mask = mSlots.size() - 1;
+    size_t index = Index(key);
+    Slot* stale = nullptr;
+    while (mSlots[index].mEpoch != 0) {
+        Slot& slot = mSlots[index];
+        if (sEqual(slot.mKey, key)) {
+            if (slot.mEpoch != mEpoch) {
+                slot.mKey = key;
+                slot.mValue = NetStatisticsTCP();
+                slot.mEpoch = mEpoch;
+                ++mLiveCount;
+            }
+            return slot.mValue;
+        }
+        if (stale == nullptr && slot.mEpoch != mEpoch) {
+            stale = &slot;
+        }
+        index = (index + 1) & mask;
+    }
+    // Slots are never emptied before rehash, so the chain of any key stays unbroken when a stale one is reused.
+    if (stale == nullptr && (mUsedCount + 1) * 4 > mSlots.size() * 3) {
+        Rehash();
+        return GetStatisticsItem(key);
+    }
+    Slot& slot = stale != nullptr ? *stale : mSlots[index];
+    if (stale == nullptr) {
+        ++mUsedCount;
+    }
+    slot.mKey = key;
+    slot.mValue = NetStatisticsTCP();
+    slot.mEpoch = mEpoch;
+    ++mLiveCount;
+    return slot.mValue;
+}
+
+void NetStaticticsMap::Clear() {
+    mLiveCount = 0;
+    if (++mEpoch == 0) {
+        // Epochs wrapped, slots of old epochs could be taken as live.
+        for (Slot& slot : mSlots) {
+            slot.mEpoch = 0;
+        }
+        mUsedCount = 0;
+        mEpoch = 1;
+    }
+}
+
+void NetStaticticsMap::Rehash() {
+    size_t capacity = mSlots.size();
+    while ((mLiveCount + 1) * 2 > capacity) {
+        capacity *= 2;
+    }
+    std::vector<Slot> slots(capacity);
+    slots.swap(mSlots);
+    const size_t mask = capacity - 1;
+    mUsedCount = 0;
+    for (const Slot& slot : slots) {
+        if (slot.mEpoch != mEpoch) {
+            continue;
+        }
+        size_t index = Index(slot.mKey);
+        while (mSlots[index].mEpoch != 0) {
+            index = (index + 1) & mask;
+        }
+        mSlots[index] = slot;
+        ++mUsedCount;
     }
-    static NetStatisticsTCP sNewTcp;
-    auto insertIter = mHashMap.insert(std::make_pair(key, sNewTcp));
-    return insertIter.first->second;
 }
 
 } // namespace logtail
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <vector>
 #include "network.h"
 #include "xxhash/xxhash.h"
 #include "metas/ServiceMetaCache.h"
@@ -70,11 +71,47 @@ typedef std::unordered_map<NetStatisticsKey, NetStatisticsTCP, NetStatisticsKeyH
     NetStatisticsHashMap;
 
 
-struct NetStaticticsMap {
-    NetStatisticsHashMap mHashMap;
-
+// NetStaticticsMap keeps the statistics of current flush interval by connection. It is an open addressing table
+// whose slots live across intervals: Clear only starts a new epoch, so entries of older epochs are reset when
+// the same connection comes back or reused by new ones, and no memory is freed between flushes. ForEach visits
+// entries touched in the current epoch only, which are the deltas to flush.
+class NetStaticticsMap {
+public:
     NetStatisticsTCP& GetStatisticsItem(const NetStatisticsKey& key);
-    inline void Clear() { mHashMap.clear(); }
+    void Clear();
+
+    template <typename F>
+    void ForEach(F&& func) const {
+        for (const Slot& slot : mSlots) {
+            if (slot.mEpoch == mEpoch) {
+                func(slot.mKey, slot.mValue);
+            }
+        }
+    }
+    size_t Size() const { return mLiveCount; }
+    size_t Capacity() const { return mSlots.size(); }
+
+private:
+    static const size_t kInitialCapacity = 1024;
+
+    struct Slot {
+        NetStatisticsKey mKey;
+        NetStatisticsTCP mValue;
+        uint32_t mEpoch = 0; // 0 means the slot is never used
+    };
+
+    size_t Index(const NetStatisticsKey& key) const;
+    // Rehash moves entries of current epoch into a table large enough for them, stale entries are dropped.
+    void Rehash();
+
+    std::vector<Slot> mSlots;
+    uint32_t mEpoch = 1;
+    size_t mUsedCount = 0; // slots ever used in mSlots, live or stale
+    size_t mLiveCount = 0;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class NetStatisticsMapUnittest;
+#endif
 };
 
 
@@ -0,0 +1,120 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "metricbatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace logtail {
+
+static const char* kMetricNameKey = "__name__";
+static const char* kMetricLabelsKey = "__labels__";
+static const char* kMetricTimeNanoKey = "__time_nano__";
+static const char* kMetricValueKey = "__value__";
+static const char* kMetricLabelsKVSeparator = "#$#";
+
+MetricBatch::MetricBatch(uint64_t timeNano) : mTimeNano(timeNano), mTimeNanoStr(std::to_string(timeNano)) {
+}
+
+uint32_t MetricBatch::AddName(const std::string& name) {
+    auto iter = mNameIndex.find(name);
+    if (iter != mNameIndex.end()) {
+        return iter->second;
+    }
+    uint32_t id = static_cast<uint32_t>(mNames.size());
+    mNames.push_back(name);
+    mNameIndex.insert(std::make_pair(name, id));
+    return id;
+}
+
+uint32_t MetricBatch::AddLabels(Labels& labels) {
+    std::sort(labels.begin(), labels.end(), [](const std::pair<std::string, std::string>& l,
+                                               const std::pair<std::string, std::string>& r) {
+        return l.first < r.first;
+    });
+    std::string formatted;
+    for (const auto& label : labels) {
+        if (!formatted.empty()) {
+            formatted.push_back('|');
+        }
+        formatted.append(label.first).append(kMetricLabelsKVSeparator);
+        // '|' separates labels, so it must not appear in values.
+        size_t begin = formatted.size();
+        formatted.append(label.second);
+        std::replace(formatted.begin() + begin, formatted.end(), '|', '_');
+    }
+    auto iter = mLabelsIndex.find(formatted);
+    if (iter != mLabelsIndex.end()) {
+        return iter->second;
+    }
+    uint32_t id = static_cast<uint32_t>(mLabels.size());
+    mLabelsIndex.insert(std::make_pair(formatted, id));
+    mLabels.push_back(std::move(formatted));
+    return id;
+}
+
+void MetricBatch::ToLog(size_t index, sls_logs::Log* log) const {
+    log->set_time(static_cast<uint32_t>(mTimeNano / 1000000000ULL));
+    auto content = log->add_contents();
+    content->set_key(kMetricNameKey);
+    content->set_value(mNames[mNameIds[index]]);
+    content = log->add_contents();
+    content->set_key(kMetricLabelsKey);
+    content->set_value(mLabels[mLabelsIds[index]]);
+    content = log->add_contents();
+    content->set_key(kMetricTimeNanoKey);
+    content->set_value(mTimeNanoStr);
+    content = log->add_contents();
+    content->set_key(kMetricValueKey);
+    content->set_value(FormatValue(mValues[index]));
+}
+
+void MetricBatch::ToLogs(std::vector<sls_logs::Log>& logs) const {
+    size_t lastSize = logs.size();
+    logs.resize(lastSize + mValues.size());
+    for (size_t i = 0; i < mValues.size(); ++i) {
+        ToLog(i, &logs[lastSize + i]);
+    }
+}
+
+void MetricBatch::Clear() {
+    mNames.clear();
+    mNameIndex.clear();
+    mLabels.clear();
+    mLabelsIndex.clear();
+    mNameIds.clear();
+    mLabelsIds.clear();
+    mValues.clear();
+}
+
+void MetricBatch::MoveLabels(sls_logs::Log& log, Labels& labels) {
+    labels.reserve(labels.size() + log.contents_size());
+    for (auto& content : *log.mutable_contents()) {
+        labels.emplace_back(std::move(*content.mutable_key()), std::move(*content.mutable_value()));
+    }
+    log.clear_contents();
+}
+
+std::string MetricBatch::FormatValue(double value) {
+    // most observer values are counters, print them without the fraction part.
+    if (std::fabs(value) < 9007199254740992.0 && value == std::floor(value)) {
+        return std::to_string(static_cast<int64_t>(value));
+    }
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.10g", value);
+    return buf;
+}
+
+} // namespace logtail
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "log_pb/sls_logs.pb.h"
+
+namespace logtail {
+
+// MetricBatch stores metric points in columns of name id, label set id and value. Names and label
+// sets are interned, so all values of an aggregated item share one formatted label set and no
+// string is built per point until the batch is encoded.
+class MetricBatch {
+public:
+    typedef std::vector<std::pair<std::string, std::string>> Labels;
+
+    explicit MetricBatch(uint64_t timeNano = 0);
+
+    uint32_t AddName(const std::string& name);
+
+    // AddLabels sorts labels by key and formats them into the metricstore label format, the same label
+    // set added again gets the same id.
+    uint32_t AddLabels(Labels& labels);
+
+    void AddPoint(uint32_t nameId, uint32_t labelsId, double value) {
+        mNameIds.push_back(nameId);
+        mLabelsIds.push_back(labelsId);
+        mValues.push_back(value);
+    }
+
+    size_t GetPointCount() const { return mValues.size(); }
+    size_t GetLabelsCount() const { return mLabels.size(); }
+    uint64_t GetTimeNano() const { return mTimeNano; }
+    const std::string& GetName(size_t index) const { return mNames[mNameIds[index]]; }
+    const std::string& GetLabels(size_t index) const { return mLabels[mLabelsIds[index]]; }
+    double GetValue(size_t index) const { return mValues[index]; }
+
+    // ToLog encodes the point at index as a metricstore log with __name__, __labels__, __time_nano__
+    // and __value__ contents.
+    void ToLog(size_t index, sls_logs::Log* log) const;
+    void ToLogs(std::vector<sls_logs::Log>& logs) const;
+
+    void Clear();
+
+    // MoveLabels moves all contents of log into labels, used to reuse the ToPB of keys.
+    static void MoveLabels(sls_logs::Log& log, Labels& labels);
+
+    static std::string FormatValue(double value);
+
+private:
+    uint64_t mTimeNano;
+    std::string mTimeNanoStr;
+    std::vector<std::string> mNames;
+    std::unordered_map<std::string, uint32_t> mNameIndex;
+    std::vector<std::string> mLabels;
+    std::unordered_map<std::string, uint32_t> mLabelsIndex;
+    std::vector<uint32_t> mNameIds;
+    std::vector<uint32_t> mLabelsIds;
+    std::vector<double> mValues;
+};
+
+} // namespace logtail
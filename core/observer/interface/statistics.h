@@ -19,6 +19,7 @@
 #include "Monitor.h"
 #include "iostream"
 #include "profiler/LogtailAlarm.h"
+#include <atomic>
 #include <cstdint>
 #include <sstream>
 
@@ -150,6 +151,10 @@ struct NetworkStatistic {
     uint32_t mEbpfGCReleaseFDCount{0};
     uint32_t mEbpfDisableProcesses{0};
     uint32_t mEbpfUsingConnections{0};
+    // current ebpf sampling rate, kept across flushes.
+    uint32_t mEbpfSamplingRate{100};
+    // bytes of the process and connection tables at the last gc, kept across flushes.
+    uint64_t mTableBytes{0};
 
     void FlushMetrics() {
         static auto sMonitor = LogtailMonitor::Instance();
@@ -169,6 +174,8 @@ struct NetworkStatistic {
         sMonitor->UpdateMetric("observer_ebpf_disable_processes", mEbpfDisableProcesses);
         sMonitor->UpdateMetric("observer_ebpf_holding_connections", mEbpfUsingConnections);
         sMonitor->UpdateMetric("observer_ebpf_lost_count", mEbpfLostCount);
+        sMonitor->UpdateMetric("observer_ebpf_sampling_rate", mEbpfSamplingRate);
+        sMonitor->UpdateMetric("observer_table_bytes", mTableBytes);
         doClear();
     }
 
@@ -188,7 +195,8 @@ struct NetworkStatistic {
            << " mEbpfLostCount: " << statistic.mEbpfLostCount << " mEbpfGCCount: " << statistic.mEbpfGCCount
            << " mEbpfGCReleaseFDCount: " << statistic.mEbpfGCReleaseFDCount
            << " mEbpfDisableProcesses: " << statistic.mEbpfDisableProcesses
-           << " mEbpfUsingConnections: " << statistic.mEbpfUsingConnections;
+           << " mEbpfUsingConnections: " << statistic.mEbpfUsingConnections
+           << " mEbpfSamplingRate: " << statistic.mEbpfSamplingRate << " mTableBytes: " << statistic.mTableBytes;
         return os;
     }
 
@@ -225,21 +233,22 @@ private:
 
 // Global statistics for protocol
 struct ProtocolStatistic {
-    uint32_t mHTTPParseFailCount{0};
-    uint32_t mRedisParseFailCount{0};
-    uint32_t mMySQLParseFailCount{0};
-    uint32_t mPgSQLParseFailCount{0};
-    uint32_t mDNSParseFailCount{0};
-    uint32_t mHTTPDropCount{0};
-    uint32_t mRedisDropCount{0};
-    uint32_t mMySQLDropCount{0};
-    uint32_t mPgSQLDropCount{0};
-    uint32_t mDNSDropCount{0};
-    uint32_t mHTTPCount{0};
-    uint32_t mRedisCount{0};
-    uint32_t mMySQLCount{0};
-    uint32_t mPgSQLCount{0};
-    uint32_t mDNSCount{0};
+    // counters are atomic because parse threads may update them concurrently.
+    std::atomic_uint32_t mHTTPParseFailCount{0};
+    std::atomic_uint32_t mRedisParseFailCount{0};
+    std::atomic_uint32_t mMySQLParseFailCount{0};
+    std::atomic_uint32_t mPgSQLParseFailCount{0};
+    std::atomic_uint32_t mDNSParseFailCount{0};
+    std::atomic_uint32_t mHTTPDropCount{0};
+    std::atomic_uint32_t mRedisDropCount{0};
+    std::atomic_uint32_t mMySQLDropCount{0};
+    std::atomic_uint32_t mPgSQLDropCount{0};
+    std::atomic_uint32_t mDNSDropCount{0};
+    std::atomic_uint32_t mHTTPCount{0};
+    std::atomic_uint32_t mRedisCount{0};
+    std::atomic_uint32_t mMySQLCount{0};
+    std::atomic_uint32_t mPgSQLCount{0};
+    std::atomic_uint32_t mDNSCount{0};
 
     static ProtocolStatistic* GetInstance() {
         static auto ptr = new ProtocolStatistic();
@@ -254,21 +263,21 @@ struct ProtocolStatistic {
     void FlushMetrics() {
         static auto sMonitor = LogtailMonitor::Instance();
 
-        sMonitor->UpdateMetric("observer_protocol_http_drop_count", mHTTPDropCount);
-        sMonitor->UpdateMetric("observer_protocol_dns_drop_count", mDNSDropCount);
-        sMonitor->UpdateMetric("observer_protocol_mysql_drop_count", mMySQLDropCount);
-        sMonitor->UpdateMetric("observer_protocol_pgsql_drop_count", mPgSQLDropCount);
-        sMonitor->UpdateMetric("observer_protocol_redis_drop_count", mRedisDropCount);
-        sMonitor->UpdateMetric("observer_protocol_http_count", mHTTPCount);
-        sMonitor->UpdateMetric("observer_protocol_dns_count", mDNSCount);
-        sMonitor->UpdateMetric("observer_protocol_mysql_count", mMySQLCount);
-        sMonitor->UpdateMetric("observer_protocol_pgsql_count", mPgSQLCount);
-        sMonitor->UpdateMetric("observer_protocol_redis_count", mRedisCount);
-        sMonitor->UpdateMetric("observer_protocol_http_parse_fail_count", mHTTPParseFailCount);
-        sMonitor->UpdateMetric("observer_protocol_dns_parse_fail_count", mDNSParseFailCount);
-        sMonitor->UpdateMetric("observer_protocol_mysql_parse_fail_count", mMySQLParseFailCount);
-        sMonitor->UpdateMetric("observer_protocol_pgsql_parse_fail_count", mPgSQLParseFailCount);
-        sMonitor->UpdateMetric("observer_protocol_redis_parse_fail_count", mRedisParseFailCount);
+        sMonitor->UpdateMetric("observer_protocol_http_drop_count", mHTTPDropCount.load());
+        sMonitor->UpdateMetric("observer_protocol_dns_drop_count", mDNSDropCount.load());
+        sMonitor->UpdateMetric("observer_protocol_mysql_drop_count", mMySQLDropCount.load());
+        sMonitor->UpdateMetric("observer_protocol_pgsql_drop_count", mPgSQLDropCount.load());
+        sMonitor->UpdateMetric("observer_protocol_redis_drop_count", mRedisDropCount.load());
+        sMonitor->UpdateMetric("observer_protocol_http_count", mHTTPCount.load());
+        sMonitor->UpdateMetric("observer_protocol_dns_count", mDNSCount.load());
+        sMonitor->UpdateMetric("observer_protocol_mysql_count", mMySQLCount.load());
+        sMonitor->UpdateMetric("observer_protocol_pgsql_count", mPgSQLCount.load());
+        sMonitor->UpdateMetric("observer_protocol_redis_count", mRedisCount.load());
+        sMonitor->UpdateMetric("observer_protocol_http_parse_fail_count", mHTTPParseFailCount.load());
+        sMonitor->UpdateMetric("observer_protocol_dns_parse_fail_count", mDNSParseFailCount.load());
+        sMonitor->UpdateMetric("observer_protocol_mysql_parse_fail_count", mMySQLParseFailCount.load());
+        sMonitor->UpdateMetric("observer_protocol_pgsql_parse_fail_count", mPgSQLParseFailCount.load());
+        sMonitor->UpdateMetric("observer_protocol_redis_parse_fail_count", mRedisParseFailCount.load());
         doClear();
     }
 
@@ -279,16 +288,21 @@ struct ProtocolStatistic {
     }
 
     friend std::ostream& operator<<(std::ostream& os, const ProtocolStatistic& statistic) {
-        os << "mHTTPParseFailCount: " << statistic.mHTTPParseFailCount
-           << " mRedisParseFailCount: " << statistic.mRedisParseFailCount
-           << " mMySQLParseFailCount: " << statistic.mMySQLParseFailCount
-           << " mPgSQLParseFailCount: " << statistic.mPgSQLParseFailCount
-           << " mDNSParseFailCount: " << statistic.mDNSParseFailCount << " mHTTPDropCount: " << statistic.mHTTPDropCount
-           << " mRedisDropCount: " << statistic.mRedisDropCount << " mMySQLDropCount: " << statistic.mMySQLDropCount
-           << " mPgSQLDropCount: " << statistic.mPgSQLDropCount << " mDNSDropCount: " << statistic.mDNSDropCount
-           << " mHTTPCount: " << statistic.mHTTPCount << " mRedisCount: " << statistic.mRedisCount
-           << " mMySQLCount: " << statistic.mMySQLCount << " mPgSQLCount: " << statistic.mPgSQLCount
-           << " mDNSCount: " << statistic.mDNSCount;
+        os << "mHTTPParseFailCount: " << statistic.mHTTPParseFailCount.load()
+           << " mRedisParseFailCount: " << statistic.mRedisParseFailCount.load()
+           << " mMySQLParseFailCount: " << statistic.mMySQLParseFailCount.load()
+           << " mPgSQLParseFailCount: " << statistic.mPgSQLParseFailCount.load()
+           << " mDNSParseFailCount: " << statistic.mDNSParseFailCount.load()
+           << " mHTTPDropCount: " << statistic.mHTTPDropCount.load()
+           << " mRedisDropCount: " << statistic.mRedisDropCount.load()
+           << " mMySQLDropCount: " << statistic.mMySQLDropCount.load()
+           << " mPgSQLDropCount: " << statistic.mPgSQLDropCount.load()
+           << " mDNSDropCount: " << statistic.mDNSDropCount.load()
+           << " mHTTPCount: " << statistic.mHTTPCount.load()
+           << " mRedisCount: " << statistic.mRedisCount.load()
+           << " mMySQLCount: " << statistic.mMySQLCount.load()
+           << " mPgSQLCount: " << statistic.mPgSQLCount.load()
+           << " mDNSCount: " << statistic.mDNSCount.load();
         return os;
     }
 
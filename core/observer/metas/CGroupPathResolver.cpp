@@ -137,6 +137,17 @@ void ResolveAllCGroupProcsPaths(const std::string& basePath, std::vector<std::st
     resolveAllCGroupProcsPaths(basePath, allPaths);
 }
 
+std::string CGroupProcsRootPath(const std::string& basePath, const std::string& procsPath) {
+    static const std::vector<std::string> sRootDirs = {"/kubepods.slice/", "/kubepods/", "/docker/"};
+    for (const auto& rootDir : sRootDirs) {
+        std::string rootPath = basePath + rootDir;
+        if (procsPath.compare(0, rootPath.size(), rootPath) == 0) {
+            return rootPath.substr(0, rootPath.size() - 1);
+        }
+    }
+    return basePath;
+}
+
 
 bool KubernetesCGroupPathMatcher::IsMatch(const std::string& path) {
     std::string exception;
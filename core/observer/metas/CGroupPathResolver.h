@@ -58,6 +58,9 @@ std::string CGroupBasePath(const std::string& sysfs_path);
 
 void ResolveAllCGroupProcsPaths(const std::string& bashPath, std::vector<std::string>& allPaths);
 
+// CGroupProcsRootPath returns the dir ResolveAllCGroupProcsPaths resolved procsPath from.
+std::string CGroupProcsRootPath(const std::string& basePath, const std::string& procsPath);
+
 KubernetesCGroupPathMatcher* GetCGroupMatcher(const std::string& path, CONTAINER_TYPE type);
 
 std::string ExtractPodWorkloadName(const std::string& podName);
@@ -0,0 +1,127 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CGroupWatcher.h"
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "common/ErrorUtil.h"
+#include "common/FileSystemUtil.h"
+#include "logger/Logger.h"
+
+namespace logtail {
+
+bool CGroupWatcher::Init(const std::string& rootDir, size_t maxWatches) {
+    Close();
+    mFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mFd < 0) {
+        LOG_WARNING(sLogger, ("init cgroup inotify fd failed", ErrnoToString(GetErrno())));
+        return false;
+    }
+    mRootDir = rootDir;
+    mMaxWatches = maxWatches;
+    if (!AddWatchRecursively(rootDir, nullptr)) {
+        LOG_WARNING(sLogger, ("watch cgroup dirs failed, root", rootDir)("watched", mWatchDirs.size()));
+        Close();
+        return false;
+    }
+    LOG_INFO(sLogger, ("watch cgroup dirs success, root", rootDir)("watched", mWatchDirs.size()));
+    return true;
+}
+
+void CGroupWatcher::Close() {
+    if (mFd >= 0) {
+        close(mFd);
+        mFd = -1;
+    }
+    mWatchDirs.clear();
+}
+
+bool CGroupWatcher::AddWatchRecursively(const std::string& dir, std::vector<std::string>* createdDirs) {
+    if (mWatchDirs.size() >= mMaxWatches) {
+        return false;
+    }
+    int wd = inotify_add_watch(mFd, dir.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM | IN_ONLYDIR);
+    if (wd < 0) {
+        // the dir was removed before it's watched.
+        return GetErrno() == ENOENT || GetErrno() == ENOTDIR;
+    }
+    mWatchDirs[wd] = dir;
+    if (createdDirs != nullptr) {
+        createdDirs->push_back(dir);
+    }
+    fsutil::Dir subDirs(dir);
+    if (!subDirs.Open()) {
+        return true;
+    }
+    while (auto entry = subDirs.ReadNext(false)) {
+        if (entry.IsDir() && !AddWatchRecursively(dir + "/" + entry.Name(), createdDirs)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CGroupWatcher::Poll(std::vector<std::string>& createdDirs, std::vector<std::string>& removedDirs) {
+    if (mFd < 0) {
+        return false;
+    }
+    char buffer[16 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (true) {
+        ssize_t len = read(mFd, buffer, sizeof(buffer));
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            LOG_WARNING(sLogger, ("read cgroup inotify events failed", ErrnoToString(GetErrno())));
+            return false;
+        }
+        if (len == 0) {
+            return true;
+        }
+        for (char* ptr = buffer; ptr < buffer + len;) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+            ptr += sizeof(struct inotify_event) + event->len;
+            if (event->mask & IN_Q_OVERFLOW) {
+                LOG_WARNING(sLogger, ("cgroup inotify events overflow, root", mRootDir));
+                return false;
+            }
+            auto iter = mWatchDirs.find(event->wd);
+            if (iter == mWatchDirs.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                mWatchDirs.erase(iter);
+                continue;
+            }
+            if ((event->mask & IN_ISDIR) == 0 || event->len == 0) {
+                continue;
+            }
+            std::string path = iter->second + "/" + event->name;
+            if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                if (!AddWatchRecursively(path, &createdDirs)) {
+                    LOG_WARNING(sLogger, ("watch cgroup dir failed", path)("watched", mWatchDirs.size()));
+                    return false;
+                }
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                removedDirs.push_back(path);
+            }
+        }
+    }
+}
+
+} // namespace logtail
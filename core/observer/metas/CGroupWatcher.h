@@ -0,0 +1,63 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace logtail {
+
+// CGroupWatcher watches a cgroup hierarchy with inotify, and reports cgroup dirs created or removed since the
+// last poll. Moving processes between cgroups raises no inotify event on cgroup.procs, so it only tells which
+// containers are started or stopped.
+class CGroupWatcher {
+public:
+    CGroupWatcher() = default;
+    CGroupWatcher(const CGroupWatcher&) = delete;
+    CGroupWatcher& operator=(const CGroupWatcher&) = delete;
+    ~CGroupWatcher() { Close(); }
+
+    // Init watches rootDir and all dirs under it, it fails when there are more than maxWatches dirs.
+    bool Init(const std::string& rootDir, size_t maxWatches);
+
+    void Close();
+
+    bool IsOpen() const { return mFd >= 0; }
+
+    /**
+     * @brief Poll reads pending events without blocking.
+     * @param createdDirs dirs created, dirs under a created dir are included as they are watched.
+     * @param removedDirs dirs removed.
+     * @return false if events are lost, callers must rescan the whole hierarchy.
+     */
+    bool Poll(std::vector<std::string>& createdDirs, std::vector<std::string>& removedDirs);
+
+    const std::string& GetRootDir() const { return mRootDir; }
+
+    size_t GetWatchCount() const { return mWatchDirs.size(); }
+
+private:
+    bool AddWatchRecursively(const std::string& dir, std::vector<std::string>* createdDirs);
+
+    int mFd = -1;
+    size_t mMaxWatches = 0;
+    std::string mRootDir;
+    std::unordered_map<int, std::string> mWatchDirs;
+};
+
+} // namespace logtail
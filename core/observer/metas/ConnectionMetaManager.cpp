@@ -91,6 +91,9 @@ ConnectionInfoPtr ConnectionMetaManager::GetConnectionInfo(uint32_t pid, uint32_
         ++mConnMetaStatistic->mGetSocketInfoFailCount;
         return nullptr;
     }
+    if (mRefreshThread) {
+        return GetConnectionInfoFromSnapshot(pid, inode);
+    }
     auto meta = mConnectionMeta.find(inode);
     if (meta != mConnectionMeta.end()) {
         return meta->second;
@@ -125,8 +128,128 @@ ConnectionInfoPtr ConnectionMetaManager::GetConnectionInfo(uint32_t pid, uint32_
     return nullptr;
 }
 
+ConnectionInfoPtr ConnectionMetaManager::GetConnectionInfoFromSnapshot(uint32_t pid, uint32_t inode) {
+    uint64_t generation = mGeneration.load(std::memory_order_acquire);
+    if (generation != mLookupGeneration) {
+        mLookupSnapshot = std::atomic_load(&mSnapshot);
+        mLookupGeneration = generation;
+        mLookupMissPids.clear();
+    }
+    if (mLookupSnapshot != nullptr) {
+        auto meta = mLookupSnapshot->find(inode);
+        if (meta != mLookupSnapshot->end()) {
+            return meta->second;
+        }
+    }
+    LOG_DEBUG(sLogger, ("ConnectionManager find info in snapshot", "fail")("pid", pid)("inode", inode));
+    ++mConnMetaStatistic->mGetSocketInfoFailCount;
+    // each pid is reported once per generation.
+    if (mLookupMissPids.insert(pid).second) {
+        {
+            std::lock_guard<std::mutex> lock(mRefreshMux);
+            mPendingPids.insert(pid);
+        }
+        mRefreshCond.notify_one();
+    }
+    return nullptr;
+}
+
+void ConnectionMetaManager::StartRefresher(uint32_t intervalSec) {
+    if (mRefreshThread || mBashProcPath.empty()) {
+        return;
+    }
+    mRefreshIntervalSec = intervalSec > 0 ? intervalSec : 1;
+    mRefreshStopped = false;
+    mRefreshThread = CreateThread([this]() { RunRefresher(); });
+    LOG_INFO(sLogger, ("start observer connection refresher", "success")("interval", mRefreshIntervalSec));
+}
+
+void ConnectionMetaManager::StopRefresher() {
+    if (!mRefreshThread) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mRefreshMux);
+        mRefreshStopped = true;
+    }
+    mRefreshCond.notify_all();
+    mRefreshThread.reset();
+    mPendingPids.clear();
+    mNamespacePids.clear();
+    std::atomic_store(&mSnapshot, std::shared_ptr<const ConnectionInfoMap>());
+    mLookupSnapshot.reset();
+    mLookupMissPids.clear();
+    static auto sProberManger = NamespacedProberManger::GetInstance(this->mBashProcPath);
+    sProberManger->GarbageCollection();
+}
+
+void ConnectionMetaManager::RunRefresher() {
+    std::unique_lock<std::mutex> lock(mRefreshMux);
+    auto nextFullRefresh = std::chrono::steady_clock::now();
+    while (!mRefreshStopped) {
+        bool full = std::chrono::steady_clock::now() >= nextFullRefresh;
+        std::unordered_set<uint32_t> pendingPids;
+        pendingPids.swap(mPendingPids);
+        lock.unlock();
+        RefreshSnapshot(pendingPids, full);
+        lock.lock();
+        if (full) {
+            nextFullRefresh = std::chrono::steady_clock::now() + std::chrono::seconds(mRefreshIntervalSec);
+        }
+        mRefreshCond.wait_until(
+            lock, nextFullRefresh, [this]() { return mRefreshStopped || !mPendingPids.empty(); });
+    }
+}
+
+void ConnectionMetaManager::RefreshSnapshot(const std::unordered_set<uint32_t>& pendingPids, bool full) {
+    static auto sProberManger = NamespacedProberManger::GetInstance(this->mBashProcPath);
+    std::unordered_map<uint32_t, uint32_t> namespacePids;
+    for (uint32_t pid : pendingPids) {
+        auto prober = sProberManger->GetOrCreateProber(pid);
+        if (prober != nullptr && mNamespacePids.find(prober->Inode()) == mNamespacePids.end()) {
+            namespacePids.insert(std::make_pair(prober->Inode(), pid));
+        }
+    }
+    if (!full && namespacePids.empty()) {
+        return;
+    }
+    std::shared_ptr<ConnectionInfoMap> infos = std::make_shared<ConnectionInfoMap>();
+    auto current = std::atomic_load(&mSnapshot);
+    if (full) {
+        namespacePids.insert(mNamespacePids.begin(), mNamespacePids.end());
+    } else if (current != nullptr) {
+        *infos = *current;
+    }
+    for (const auto& item : namespacePids) {
+        auto prober = sProberManger->GetOrCreateProber(item.second);
+        // the pid exited or moved to another namespace, the namespace is dumped again once a new pid misses.
+        if (prober == nullptr || prober->Inode() != item.first) {
+            mNamespacePids.erase(item.first);
+            continue;
+        }
+        prober->FetchInetConnections(*infos);
+        prober->FetchUnixConnections(*infos);
+        ++mRefreshFetchCount;
+        mNamespacePids[item.first] = item.second;
+    }
+    if (full) {
+        // probers are created again in the next full refresh, as the netlink GC does.
+        sProberManger->GarbageCollection();
+    }
+    std::atomic_store(&mSnapshot, std::shared_ptr<const ConnectionInfoMap>(infos));
+    mGeneration.fetch_add(1, std::memory_order_release);
+    LOG_DEBUG(sLogger,
+              ("publish connection snapshot", full ? "full" : "incremental")("namespaces", namespacePids.size())(
+                  "connections", infos->size()));
+}
+
 bool ConnectionMetaManager::GarbageCollection() {
-    mConnectionMeta.erase(this->mConnectionMeta.begin(), this->mConnectionMeta.end());
+    if (mRefreshThread) {
+        // the refresher replaces the snapshot by itself.
+        mConnMetaStatistic->mFetchNetlinkCount += mRefreshFetchCount.exchange(0);
+        return true;
+    }
+    mConnectionMeta.clear();
     mProberFetchLog.erase(this->mProberFetchLog.begin(), this->mProberFetchLog.end());
     static auto sProberManger = NamespacedProberManger::GetInstance(this->mBashProcPath);
     sProberManger->GarbageCollection();
@@ -196,7 +319,7 @@ bool NetLinkProber::SendMsg(const msgType& realMsg, std::string& errorMsg) {
 }
 
 template <typename msgType>
-bool NetLinkProber::ReceiveMsg(std::unordered_map<uint32_t, ConnectionInfoPtr>& infos, std::string& errorMsg) {
+bool NetLinkProber::ReceiveMsg(ConnectionInfoMap& infos, std::string& errorMsg) {
     static int bufSize = 8192;
     long buffer[bufSize / sizeof(long)];
 
@@ -244,7 +367,7 @@ bool NetLinkProber::ReceiveMsg(std::unordered_map<uint32_t, ConnectionInfoPtr>&
     return true;
 }
 
-void NetLinkProber::FetchInetConnections(std::unordered_map<uint32_t, ConnectionInfoPtr>& infos, int connStat) {
+void NetLinkProber::FetchInetConnections(ConnectionInfoMap& infos, int connStat) {
     inet_diag_req_v2 req = {};
     req.sdiag_protocol = IPPROTO_TCP;
     req.idiag_states = connStat;
@@ -294,7 +417,7 @@ void NetLinkProber::FetchInetConnections(std::unordered_map<uint32_t, Connection
     }
 }
 
-void NetLinkProber::FetchUnixConnections(std::unordered_map<uint32_t, ConnectionInfoPtr>& infos, int connStat) {
+void NetLinkProber::FetchUnixConnections(ConnectionInfoMap& infos, int connStat) {
     unix_diag_req req = {};
     std::string errorMsg;
     req.sdiag_family = AF_UNIX;
@@ -322,7 +445,7 @@ NetLinkProber::~NetLinkProber() {
 
 bool ExtractDiagMsg(const inet_diag_msg& msg,
                     uint32_t len,
-                    std::unordered_map<uint32_t, ConnectionInfoPtr>& infos,
+                    ConnectionInfoMap& infos,
                     std::string& errorMsg) {
     if (len < sizeof(msg)) {
         errorMsg = "no enough netlink data";
@@ -373,7 +496,7 @@ bool ExtractDiagMsg(const inet_diag_msg& msg,
 
 bool ExtractDiagMsg(const unix_diag_msg& msg,
                     uint32_t len,
-                    std::unordered_map<uint32_t, ConnectionInfoPtr>& infos,
+                    ConnectionInfoMap& infos,
                     std::string& errorMsg) {
     if (len < sizeof(msg)) {
         errorMsg = "no enough netlink data";
@@ -16,15 +16,22 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <ostream>
 #include <iostream>
 #include <boost/filesystem/operations.hpp>
+#include <boost/thread.hpp>
 #include "Logger.h"
+#include "common/Thread.h"
+#include "common/FlatHashMap.h"
 #include "interface/network.h"
 #include "linux/rtnetlink.h"
 #include "interface/helper.h"
@@ -69,6 +76,7 @@ struct ConnectionInfo {
 };
 
 typedef std::shared_ptr<ConnectionInfo> ConnectionInfoPtr;
+typedef FlatHashMap<uint32_t, ConnectionInfoPtr> ConnectionInfoMap;
 
 struct ConnectionInfoPtrHashFn {
     size_t operator()(const ConnectionInfoPtr& ptr) const {
@@ -108,11 +116,11 @@ class NetLinkProber {
 public:
     explicit NetLinkProber(uint32_t pid, uint32_t inode, const std::string& procPath = "/proc/");
 
-    void FetchInetConnections(std::unordered_map<uint32_t, ConnectionInfoPtr>& infos,
+    void FetchInetConnections(ConnectionInfoMap& infos,
                               int connStat
                               = (1 << (int)TCPConnectionStat::Established) | (1 << (int)TCPConnectionStat::Listening));
 
-    void FetchUnixConnections(std::unordered_map<uint32_t, ConnectionInfoPtr>& infos,
+    void FetchUnixConnections(ConnectionInfoMap& infos,
                               int connStat
                               = (1 << (int)TCPConnectionStat::Established) | (1 << (int)TCPConnectionStat::Listening));
 
@@ -139,7 +147,7 @@ private:
      * 2. pixie
      */
     template <typename msgType>
-    bool ReceiveMsg(std::unordered_map<uint32_t, ConnectionInfoPtr>& infos, std::string& errorMsg);
+    bool ReceiveMsg(ConnectionInfoMap& infos, std::string& errorMsg);
 
     int mFd = -1;
     int8_t mStatus = 0;
@@ -180,14 +188,51 @@ public:
 
     void Print();
 
+    // StartRefresher dumps connections of all known network namespaces in a background thread every intervalSec
+    // seconds and publishes them as an immutable snapshot. GetConnectionInfo then only looks up the snapshot,
+    // a miss asks the refresher to dump the namespace of the pid instead of fetching netlink in place.
+    void StartRefresher(uint32_t intervalSec);
+
+    void StopRefresher();
+
+    // GetGeneration returns the number of snapshots published by the refresher.
+    uint64_t GetGeneration() const { return mGeneration.load(std::memory_order_acquire); }
+
 private:
     ConnectionMetaManager() { mConnMetaStatistic = ConnectionMetaStatistic::GetInstance(); }
 
+    ConnectionInfoPtr GetConnectionInfoFromSnapshot(uint32_t pid, uint32_t inode);
+
+    void RunRefresher();
+
+    // RefreshSnapshot dumps the namespaces of pendingPids not known yet, and all known namespaces when full is
+    // true, then publishes a new snapshot.
+    void RefreshSnapshot(const std::unordered_set<uint32_t>& pendingPids, bool full);
+
 private:
     ConnectionMetaStatistic* mConnMetaStatistic;
     std::string mBashProcPath;
-    std::unordered_map<uint32_t, ConnectionInfoPtr> mConnectionMeta{};
+    ConnectionInfoMap mConnectionMeta{};
     std::unordered_set<uint32_t> mProberFetchLog{};
+
+    // guarded by mRefreshMux.
+    std::mutex mRefreshMux;
+    std::condition_variable mRefreshCond;
+    std::unordered_set<uint32_t> mPendingPids{};
+    bool mRefreshStopped = false;
+    uint32_t mRefreshIntervalSec = 0;
+    ThreadPtr mRefreshThread;
+    // only touched by the refresher thread, network ns inode -> a pid in the namespace.
+    std::unordered_map<uint32_t, uint32_t> mNamespacePids{};
+    // published by the refresher with std::atomic_store, mGeneration is increased after each publish.
+    std::shared_ptr<const ConnectionInfoMap> mSnapshot;
+    std::atomic<uint64_t> mGeneration{0};
+    std::atomic<uint32_t> mRefreshFetchCount{0};
+    // only touched by the lookup thread, the snapshot is reloaded only when the generation changes, so a hit
+    // takes no lock.
+    std::shared_ptr<const ConnectionInfoMap> mLookupSnapshot;
+    uint64_t mLookupGeneration = 0;
+    std::unordered_set<uint32_t> mLookupMissPids{};
 };
 
 
@@ -24,6 +24,13 @@
 #include <stdlib.h>
 
 DEFINE_FLAG_INT32(sls_observer_process_update_interval, "SLS Observer Process Update Interval", 300);
+DEFINE_FLAG_BOOL(sls_observer_cgroup_watch,
+                 "SLS Observer watch cgroup dirs by inotify and only parse changed cgroups between full rescans",
+                 false);
+DEFINE_FLAG_INT32(sls_observer_cgroup_full_rescan_interval,
+                  "SLS Observer meta flushes between two full cgroup rescans when cgroup dirs are watched",
+                  10);
+DEFINE_FLAG_INT32(sls_observer_cgroup_max_watch_dirs, "SLS Observer max watched cgroup dirs", 20000);
 
 
 namespace logtail {
@@ -31,20 +38,47 @@ namespace logtail {
 void ContainerProcessGroup::FlushOutMetrics(uint64_t timeNano,
                                             std::vector<sls_logs::Log>& allData,
                                             std::vector<std::pair<std::string, std::string>>& tags,
-                                            uint64_t interval) {
+                                            uint64_t interval,
+                                            double sampleFactor) {
+    for (auto& shardAggregator : mShardAggregators) {
+        mAggregator.MergeFrom(*shardAggregator);
+    }
     auto& metaTags = mMetaPtr->GetFormattedMeta();
-    mAggregator.FlushOutMetrics(timeNano, allData, metaTags, tags, interval);
+    mAggregator.FlushOutMetrics(timeNano, allData, metaTags, tags, interval, sampleFactor);
+}
+
+void ContainerProcessGroup::FlushOutMetrics(MetricBatch& batch,
+                                            std::vector<std::pair<std::string, std::string>>& tags,
+                                            uint64_t interval,
+                                            double sampleFactor) {
+    for (auto& shardAggregator : mShardAggregators) {
+        mAggregator.MergeFrom(*shardAggregator);
+    }
+    mAggregator.FlushOutMetrics(batch, mMetaPtr->GetFormattedMeta(), tags, interval, sampleFactor);
 }
 
 void ContainerProcessGroupManager::FlushOutMetrics(std::vector<sls_logs::Log>& allData,
                                                    std::vector<std::pair<std::string, std::string>>& tags,
-                                                   uint64_t interval) {
+                                                   uint64_t interval,
+                                                   double sampleFactor) {
     uint64_t timeNano = GetCurrentTimeInNanoSeconds();
     for (auto& iter : mPureProcessGroupMap) {
-        iter.second->FlushOutMetrics(timeNano, allData, tags, interval);
+        iter.second->FlushOutMetrics(timeNano, allData, tags, interval, sampleFactor);
+    }
+    for (auto& iter : mContainerProcessGroupMap) {
+        iter.second->FlushOutMetrics(timeNano, allData, tags, interval, sampleFactor);
+    }
+}
+
+void ContainerProcessGroupManager::FlushOutMetrics(MetricBatch& batch,
+                                                   std::vector<std::pair<std::string, std::string>>& tags,
+                                                   uint64_t interval,
+                                                   double sampleFactor) {
+    for (auto& iter : mPureProcessGroupMap) {
+        iter.second->FlushOutMetrics(batch, tags, interval, sampleFactor);
     }
     for (auto& iter : mContainerProcessGroupMap) {
-        iter.second->FlushOutMetrics(timeNano, allData, tags, interval);
+        iter.second->FlushOutMetrics(batch, tags, interval, sampleFactor);
     }
 }
 
@@ -114,6 +148,14 @@ int32_t ContainerProcessGroupManager::DetectContainerType(const std::string& pro
 }
 
 void ContainerProcessGroupManager::FlushMetas() {
+    if (mCGroupWatcher.IsOpen() && mWatchedFlushCount < INT32_FLAG(sls_observer_cgroup_full_rescan_interval)) {
+        ++mWatchedFlushCount;
+        if (FlushWatchedCGroups()) {
+            return;
+        }
+        mCGroupWatcher.Close();
+    }
+    mWatchedFlushCount = 0;
     // ProcessMetaStatistic is the gauge value, so must clear history data before fetching meta.
     ProcessMetaStatistic::Clear();
     std::vector<std::string> paths;
@@ -147,12 +189,16 @@ void ContainerProcessGroupManager::FlushMetas() {
             return;
         }
     }
+    // watch before parsing, so cgroups created during the rescan are parsed again by the next flush.
+    if (BOOL_FLAG(sls_observer_cgroup_watch) && !mCGroupWatcher.IsOpen()) {
+        mCGroupWatcher.Init(CGroupProcsRootPath(this->mGgoupBasePath, paths[0]),
+                            INT32_FLAG(sls_observer_cgroup_max_watch_dirs));
+    }
+    mCGroupPids.clear();
+    mPendingCGroupProcsPaths.clear();
     size_t ignoredPathCount = 0;
     for (auto& p : paths) {
-        std::vector<int32_t> pids;
-        std::string containerID;
-        std::string podID;
-        int32_t rst = ParseCgroupPath(p, pids, containerID, podID);
+        int32_t rst = FlushCGroupProcs(p, pidSet);
         if (rst == -1) {
             ignoredPathCount++;
             LOG_DEBUG(sLogger, ("parse cgroup path ignored, rst", rst)("path", p));
@@ -161,52 +207,119 @@ void ContainerProcessGroupManager::FlushMetas() {
         if (rst < -1) {
             mProcessMetaStatistic->mCgroupPathParseFailCount++;
             LOG_DEBUG(sLogger, ("parse cgroup path failed, rst", rst)("path", p));
+        }
+    }
+    mProcessMetaStatistic->mCgroupPathTotalCount = paths.size() - ignoredPathCount;
+    mProcessMetaStatistic->mWatchProcessCount = pidSet.size();
+    LOG_INFO(sLogger, ("flush meta success", mProcessMetaStatistic->ToString()));
+    FlushPids(pidSet);
+}
+
+int32_t ContainerProcessGroupManager::FlushCGroupProcs(const std::string& procsPath,
+                                                       std::unordered_set<uint32_t>& pidSet) {
+    std::vector<int32_t> pids;
+    std::string containerID;
+    std::string podID;
+    int32_t rst = ParseCgroupPath(procsPath, pids, containerID, podID);
+    if (rst != 0) {
+        return rst;
+    }
+    std::vector<uint32_t>& cgroupPids = mCGroupPids[procsPath];
+    cgroupPids.clear();
+    bool containerMetaFetched = false;
+    K8sContainerMeta containerMeta;
+    for (const auto& pid : pids) {
+        if (pid == 0) {
             continue;
         }
-        bool containerMetaFetched = false;
-        K8sContainerMeta containerMeta;
-        for (const auto& pid : pids) {
-            if (pid == 0) {
-                continue;
-            }
-            pidSet.insert(pid);
-            ProcessMetaPtr& metaPtr = mProcessMetaMap[pid];
-            if (metaPtr.get() == nullptr) {
-                metaPtr.reset(new ProcessMeta);
+        pidSet.insert(pid);
+        cgroupPids.push_back(pid);
+        ProcessMetaPtr& metaPtr = mProcessMetaMap[pid];
+        if (metaPtr.get() == nullptr) {
+            metaPtr.reset(new ProcessMeta);
+        }
+        ProcessMeta* meta = metaPtr.get();
+        if (meta->Pod.PodUUID != podID || meta->Container.ContainerID != containerID
+            || meta->Container.ContainerName.empty()) {
+            meta->Clear();
+            meta->PID = pid;
+            meta->Container.ContainerID = containerID;
+            meta->Pod.PodUUID = podID;
+            if (!containerMetaFetched) {
+                containerMetaFetched = true;
+                containerMeta = LogtailPlugin::GetInstance()->GetContainerMeta(containerID);
+                mProcessMetaStatistic->mFetchContainerMetaCount++;
+                if (containerMeta.ContainerName.empty()) {
+                    mProcessMetaStatistic->mFetchContainerMetaFailCount++;
+                }
+                LOG_DEBUG(sLogger,
+                          ("flushMeta get container meta for pid",
+                           pid)("id", containerID)("meta", containerMeta.ToString()));
             }
-            ProcessMeta* meta = metaPtr.get();
-            if (meta->Pod.PodUUID != podID || meta->Container.ContainerID != containerID
-                || meta->Container.ContainerName.empty()) {
-                meta->Clear();
-                meta->PID = pid;
-                meta->Container.ContainerID = containerID;
-                meta->Pod.PodUUID = podID;
-                if (!containerMetaFetched) {
-                    containerMetaFetched = true;
-                    containerMeta = LogtailPlugin::GetInstance()->GetContainerMeta(containerID);
-                    mProcessMetaStatistic->mFetchContainerMetaCount++;
-                    if (containerMeta.ContainerName.empty()) {
-                        mProcessMetaStatistic->mFetchContainerMetaFailCount++;
-                    }
-                    LOG_DEBUG(sLogger,
-                              ("flushMeta get container meta for pid",
-                               pid)("id", containerID)("meta", containerMeta.ToString()));
+            meta->Pod.NameSpace = containerMeta.K8sNamespace;
+            meta->Pod.PodName = containerMeta.PodName;
+            meta->Pod.WorkloadName = ExtractPodWorkloadName(containerMeta.PodName);
+            meta->Container.ContainerName = containerMeta.ContainerName;
+            meta->Container.Image = containerMeta.Image;
+            meta->Pod.Labels = containerMeta.k8sLabels;
+            meta->Container.Labels = containerMeta.containerLabels;
+            meta->Container.Envs = containerMeta.envs;
+        }
+    }
+    return 0;
+}
+
+bool ContainerProcessGroupManager::FlushWatchedCGroups() {
+    std::vector<std::string> createdDirs;
+    std::vector<std::string> removedDirs;
+    if (!mCGroupWatcher.Poll(createdDirs, removedDirs)) {
+        return false;
+    }
+    ProcessMetaStatistic::Clear();
+    for (const auto& dir : removedDirs) {
+        // processes must leave a cgroup before it's removed, so pids of it and the cgroups under it are gone.
+        const std::string procsPath = dir + "/cgroup.procs";
+        const std::string prefix = dir + "/";
+        for (auto iter = mCGroupPids.begin(); iter != mCGroupPids.end();) {
+            if (iter->first.compare(0, prefix.size(), prefix) == 0) {
+                for (uint32_t pid : iter->second) {
+                    mProcessMetaMap.erase(pid);
                 }
-                meta->Pod.NameSpace = containerMeta.K8sNamespace;
-                meta->Pod.PodName = containerMeta.PodName;
-                meta->Pod.WorkloadName = ExtractPodWorkloadName(containerMeta.PodName);
-                meta->Container.ContainerName = containerMeta.ContainerName;
-                meta->Container.Image = containerMeta.Image;
-                meta->Pod.Labels = containerMeta.k8sLabels;
-                meta->Container.Labels = containerMeta.containerLabels;
-                meta->Container.Envs = containerMeta.envs;
+                iter = mCGroupPids.erase(iter);
+            } else {
+                ++iter;
             }
         }
+        mPendingCGroupProcsPaths.erase(procsPath);
     }
-    mProcessMetaStatistic->mCgroupPathTotalCount = paths.size() - ignoredPathCount;
+    for (const auto& dir : createdDirs) {
+        mPendingCGroupProcsPaths.insert(dir + "/cgroup.procs");
+    }
+    std::unordered_set<uint32_t> pidSet;
+    for (auto iter = mPendingCGroupProcsPaths.begin(); iter != mPendingCGroupProcsPaths.end();) {
+        int32_t rst = FlushCGroupProcs(*iter, pidSet);
+        // a new cgroup has no pids until the container process is moved in.
+        if (rst == -1) {
+            ++iter;
+            continue;
+        }
+        if (rst < -1) {
+            mProcessMetaStatistic->mCgroupPathParseFailCount++;
+            LOG_DEBUG(sLogger, ("parse cgroup path failed, rst", rst)("path", *iter));
+        }
+        iter = mPendingCGroupProcsPaths.erase(iter);
+    }
+    pidSet.clear();
+    for (const auto& item : mCGroupPids) {
+        pidSet.insert(item.second.begin(), item.second.end());
+    }
+    mProcessMetaStatistic->mCgroupPathTotalCount = mCGroupPids.size();
     mProcessMetaStatistic->mWatchProcessCount = pidSet.size();
-    LOG_INFO(sLogger, ("flush meta success", mProcessMetaStatistic->ToString()));
+    LOG_DEBUG(sLogger,
+              ("flush watched cgroups success, created", createdDirs.size())("removed", removedDirs.size())(
+                  "pending", mPendingCGroupProcsPaths.size())("meta", mProcessMetaStatistic->ToString()));
     FlushPids(pidSet);
+    return true;
 }
 
 void ContainerProcessGroupManager::FlushPids(const std::unordered_set<uint32_t>& existedPids) {
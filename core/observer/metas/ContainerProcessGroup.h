@@ -20,6 +20,7 @@
 #include "common/Thread.h"
 #include "common/Lock.h"
 #include "CGroupPathResolver.h"
+#include "CGroupWatcher.h"
 #include "interface/statistics.h"
 
 #include <network/protocols/ProtocolEventAggregators.h>
@@ -27,6 +28,7 @@
 #include <unordered_set>
 #include <mutex>
 #include <memory>
+#include <vector>
 #include <condition_variable>
 #include <ostream>
 
@@ -48,14 +50,37 @@ struct ContainerProcessGroup {
         return mAllProcesses.empty();
     }
 
+    /**
+     * @brief InitShardAggregators creates one aggregator for each parse thread, so parse threads never share one.
+     * @param shardCount count of parse threads
+     */
+    void InitShardAggregators(size_t shardCount) {
+        while (mShardAggregators.size() < shardCount) {
+            mShardAggregators.emplace_back(new ProtocolEventAggregators);
+            mShardAggregators.back()->SetProcessMeta(mMetaPtr);
+        }
+    }
+
+    ProtocolEventAggregators* GetShardAggregator(size_t shard) { return mShardAggregators[shard].get(); }
+
+    /**
+     * @note shard aggregators are merged into mAggregator before flushed, callers must make sure that
+     * no parse thread is running.
+     */
     void FlushOutMetrics(uint64_t timeNano,
                          std::vector<sls_logs::Log>& allData,
                          std::vector<std::pair<std::string, std::string>>& tags,
-                         uint64_t interval);
+                         uint64_t interval,
+                         double sampleFactor = 1.0);
+    void FlushOutMetrics(MetricBatch& batch,
+                         std::vector<std::pair<std::string, std::string>>& tags,
+                         uint64_t interval,
+                         double sampleFactor = 1.0);
 
     std::unordered_set<uint32_t> mAllProcesses;
     ProcessMetaPtr mMetaPtr;
     ProtocolEventAggregators mAggregator;
+    std::vector<std::unique_ptr<ProtocolEventAggregators>> mShardAggregators;
 };
 
 typedef std::shared_ptr<ContainerProcessGroup> ContainerProcessGroupPtr;
@@ -141,9 +166,17 @@ public:
         }
     }
 
+    /**
+     * @param sampleFactor captured counts are scaled by it to make up for the connections not sampled.
+     */
     void FlushOutMetrics(std::vector<sls_logs::Log>& allData,
                          std::vector<std::pair<std::string, std::string>>& tags,
-                         uint64_t interval);
+                         uint64_t interval,
+                         double sampleFactor = 1.0);
+    void FlushOutMetrics(MetricBatch& batch,
+                         std::vector<std::pair<std::string, std::string>>& tags,
+                         uint64_t interval,
+                         double sampleFactor = 1.0);
 
 
     void FlushMetas();
@@ -153,6 +186,18 @@ public:
 protected:
     void FlushPids(const std::unordered_set<uint32_t>& existedPids);
 
+    /**
+     * @brief FlushWatchedCGroups only parses cgroups created since the last flush and drops cgroups removed.
+     * @return false if the watcher lost events, a full rescan is needed.
+     */
+    bool FlushWatchedCGroups();
+
+    /**
+     * @brief FlushCGroupProcs updates metas of the pids in the cgroup procs path.
+     * @return result of ParseCgroupPath
+     */
+    int32_t FlushCGroupProcs(const std::string& procsPath, std::unordered_set<uint32_t>& pidSet);
+
     // 0 means success, -1 means ignored path,
     int32_t
     ParseCgroupPath(const std::string& path, std::vector<int32_t>& pids, std::string& containerID, std::string& podID);
@@ -181,6 +226,13 @@ private:
     // matcher and containerType would be kept in the whole life cycle;
     KubernetesCGroupPathMatcher* mMatcher = NULL;
     CONTAINER_TYPE mContainerType = CONTAINER_TYPE_UNKNOWN;
+
+    // cgroup.procs path -> pids read at the last flush, the watcher updates it between full rescans.
+    std::unordered_map<std::string, std::vector<uint32_t>> mCGroupPids;
+    // cgroups created but without pids yet, they are parsed again at each flush until the next full rescan.
+    std::unordered_set<std::string> mPendingCGroupProcsPaths;
+    CGroupWatcher mCGroupWatcher;
+    int32_t mWatchedFlushCount = 0;
 };
 
 } // namespace logtail
@@ -13,70 +13,174 @@
 // limitations under the License.
 
 #include "ServiceMetaCache.h"
+#include <arpa/inet.h>
 #include "Logger.h"
+#include "xxhash/xxhash.h"
 
 namespace logtail {
 
+ServiceMetaKey ServiceMetaKey::FromString(const std::string& ip) {
+    ServiceMetaKey key;
+    if (ip.find(':') != std::string::npos) {
+        uint64_t addr[2];
+        if (inet_pton(AF_INET6, ip.c_str(), addr) == 1) {
+            key.High = addr[0];
+            key.Low = addr[1];
+            key.KeyType = kIPV6;
+            return key;
+        }
+    } else {
+        uint32_t addr;
+        if (inet_pton(AF_INET, ip.c_str(), &addr) == 1) {
+            key.Low = addr;
+            key.KeyType = kIPV4;
+            return key;
+        }
+    }
+    key.High = XXH64(ip.data(), ip.size(), 0);
+    key.Low = XXH64(ip.data(), ip.size(), key.High);
+    key.KeyType = kHashed;
+    return key;
+}
+
+bool ServiceMetaCache::isExpired(const ServiceMeta& meta, long now) {
+    return meta.time <= now - INT64_FLAG(sls_observer_network_hostname_timeout);
+}
+
+uint32_t ServiceMetaCache::find(const ServiceMetaKey& key, long now) {
+    auto iter = mIndexMap.find(key);
+    if (iter == mIndexMap.end()) {
+        return kNil;
+    }
+    const uint32_t index = iter->second;
+    if (!isExpired(mNodes[index].Meta, now)) {
+        return index;
+    }
+    LOG_TRACE(sLogger, ("remove expired service meta", mNodes[index].Meta.ToString()));
+    mIndexMap.erase(iter);
+    unlink(index);
+    mNodes[index].Meta = ServiceMeta();
+    mFreeNodes.push_back(index);
+    return kNil;
+}
+
+void ServiceMetaCache::unlink(uint32_t index) {
+    Node& node = mNodes[index];
+    if (node.Prev != kNil) {
+        mNodes[node.Prev].Next = node.Next;
+    } else {
+        mHead = node.Next;
+    }
+    if (node.Next != kNil) {
+        mNodes[node.Next].Prev = node.Prev;
+    } else {
+        mTail = node.Prev;
+    }
+    node.Prev = kNil;
+    node.Next = kNil;
+}
+
+void ServiceMetaCache::moveToFront(uint32_t index) {
+    if (mHead == index) {
+        return;
+    }
+    // A linked node other than the head always has a previous one.
+    if (mNodes[index].Prev != kNil) {
+        unlink(index);
+    }
+    Node& node = mNodes[index];
+    node.Prev = kNil;
+    node.Next = mHead;
+    if (mHead != kNil) {
+        mNodes[mHead].Prev = index;
+    }
+    mHead = index;
+    if (mTail == kNil) {
+        mTail = index;
+    }
+}
+
 const ServiceMeta& ServiceMetaCache::Get(const std::string& remoteIP, ProtocolType protocolType) {
-    if (mIndexMap.find(remoteIP) == mIndexMap.end()) {
+    const long now = time(nullptr);
+    const uint32_t index = find(ServiceMetaKey::FromString(remoteIP), now);
+    if (index == kNil) {
         return *sEmptyHost;
     }
-    mData.splice(mData.begin(), mData, mIndexMap[remoteIP]);
-    mData.begin()->second.Category = DetectRemoteServiceCategory(protocolType);
-    mData.front().second.time = time(nullptr);
-    return mData.front().second;
+    moveToFront(index);
+    ServiceMeta& meta = mNodes[index].Meta;
+    meta.Category = DetectRemoteServiceCategory(protocolType);
+    meta.time = now;
+    return meta;
 }
 
 const ServiceMeta& ServiceMetaCache::Get(const std::string& remoteIP) {
-    if (mIndexMap.find(remoteIP) == mIndexMap.end()) {
+    const long now = time(nullptr);
+    const uint32_t index = find(ServiceMetaKey::FromString(remoteIP), now);
+    if (index == kNil) {
         return *sEmptyHost;
     }
-    mData.splice(mData.begin(), mData, mIndexMap[remoteIP]);
-    mData.front().second.time = time(nullptr);
-    return mData.front().second;
+    moveToFront(index);
+    ServiceMeta& meta = mNodes[index].Meta;
+    meta.time = now;
+    return meta;
 }
 
-
-void ServiceMetaCache::Put(const std::string& remoteIP, const std::string& host, ProtocolType protocolType) {
-    if (!Get(remoteIP, ProtocolType_NumProto).Host.empty()) {
-        mData.begin()->second.Host = host;
-        mData.begin()->second.Category = DetectRemoteServiceCategory(protocolType);
-        mData.begin()->second.time = time(nullptr);
-    } else {
-        if (mData.size() == cap) {
-            std::string delKey = std::move(mData.back().first);
-            mData.pop_back();
-            mIndexMap.erase(delKey);
+ServiceMeta& ServiceMetaCache::Put(const std::string& remoteIP, const std::string& host, ProtocolType protocolType) {
+    const long now = time(nullptr);
+    const ServiceMetaKey key = ServiceMetaKey::FromString(remoteIP);
+    uint32_t index = find(key, now);
+    if (index == kNil) {
+        if (!mFreeNodes.empty()) {
+            index = mFreeNodes.back();
+            mFreeNodes.pop_back();
+        } else if (mNodes.size() < cap) {
+            index = static_cast<uint32_t>(mNodes.size());
+            mNodes.emplace_back();
+        } else {
+            // The least recently used one is evicted.
+            index = mTail;
+            mIndexMap.erase(mNodes[index].Key);
+            unlink(index);
         }
-        mData.emplace_front(remoteIP, ServiceMeta{host, DetectRemoteServiceCategory(protocolType), time(nullptr)});
-        mIndexMap[remoteIP] = mData.begin();
+        mNodes[index].Key = key;
+        mIndexMap[key] = index;
     }
+    moveToFront(index);
+    ServiceMeta& meta = mNodes[index].Meta;
+    meta.Host = host;
+    meta.Category = DetectRemoteServiceCategory(protocolType);
+    meta.time = now;
+    return meta;
 }
 
 
 void ServiceMetaManager::AddHostName(uint32_t pid, const std::string& hostname, const std::string& ip) {
+    ScopedSpinLock lock(mLock);
     auto meta = mHostnameMetas.find(pid);
     if (meta == mHostnameMetas.end()) {
         meta = mHostnameMetas.insert(std::make_pair(pid, new ServiceMetaCache(200))).first;
     }
-    meta->second->Put(ip, hostname, ProtocolType_HTTP);
-    LOG_TRACE(sLogger, ("ServiceMeta ADD hostname, ip", ip)("data", meta->second->mData.begin()->second.ToString()));
+    const ServiceMeta& data = meta->second->Put(ip, hostname, ProtocolType_HTTP);
+    LOG_TRACE(sLogger, ("ServiceMeta ADD hostname, ip", ip)("data", data.ToString()));
 }
 
 const ServiceMeta&
 ServiceMetaManager::GetOrPutServiceMeta(uint32_t pid, const std::string& ip, ProtocolType protocolType) {
+    ScopedSpinLock lock(mLock);
     auto& meta = doGetOrPutServiceMeta(pid, ip, protocolType);
     LOG_TRACE(sLogger, ("ServiceMeta GET or PUT, pid", pid)("ip", ip)("data", meta.ToString()));
     return meta;
 }
 
 const ServiceMeta& ServiceMetaManager::GetServiceMeta(uint32_t pid, const std::string& ip) {
+    ScopedSpinLock lock(mLock);
     auto& meta = doGetServiceMeta(pid, ip);
     LOG_TRACE(sLogger, ("ServiceMeta GET, pid", pid)("ip", ip)("data", meta.ToString()));
     return meta;
 }
 
 void ServiceMetaManager::OnProcessDestroy(uint32_t pid) {
+    ScopedSpinLock lock(mLock);
     auto meta = mHostnameMetas.find(pid);
     if (meta == mHostnameMetas.end()) {
         return;
@@ -87,18 +191,10 @@ void ServiceMetaManager::OnProcessDestroy(uint32_t pid) {
 }
 
 void ServiceMetaManager::GarbageTimeoutHostname(long currentTime) {
-    long timeoutTime = currentTime - INT64_FLAG(sls_observer_network_hostname_timeout);
+    ScopedSpinLock lock(mLock);
     for (auto iter = mHostnameMetas.begin(); iter != mHostnameMetas.end();) {
-        while (!iter->second->mData.empty()) {
-            if (iter->second->mData.back().second.time > timeoutTime) {
-                break;
-            }
-            LOG_TRACE(sLogger, ("destroy host name remove history meta", iter->second->mData.back().second.ToString()));
-            std::string delKey = std::move(iter->second->mData.back().first);
-            iter->second->mIndexMap.erase(delKey);
-            iter->second->mData.pop_back();
-        }
-        if (iter->second->mData.empty()) {
+        if (iter->second->IsExpired(currentTime)) {
+            LOG_TRACE(sLogger, ("destroy expired host names, pid", iter->first)("count", iter->second->Size()));
             delete iter->second;
             iter = mHostnameMetas.erase(iter);
         } else {
@@ -115,15 +211,13 @@ ServiceMetaManager::doGetOrPutServiceMeta(uint32_t pid, const std::string& ip, P
             return *sEmptyHost;
         }
         meta = mHostnameMetas.insert(std::make_pair(pid, new ServiceMetaCache(200))).first;
-        meta->second->Put(ip, "", protocolType);
-        return meta->second->mData.begin()->second;
+        return meta->second->Put(ip, "", protocolType);
     }
     auto& data = meta->second->Get(ip, protocolType);
     if (!data.Empty()) {
         return data;
     }
-    meta->second->Put(ip, "", protocolType);
-    return meta->second->mData.begin()->second;
+    return meta->second->Put(ip, "", protocolType);
 }
 
 inline const ServiceMeta& ServiceMetaManager::doGetServiceMeta(uint32_t pid, const std::string& ip) {
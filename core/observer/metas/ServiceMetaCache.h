@@ -20,9 +20,12 @@
 #include <utility>
 #include <list>
 #include <unordered_map>
+#include <vector>
 #include <ostream>
 #include "interface/type.h"
 #include "network/NetworkConfig.h"
+#include "common/Lock.h"
+#include "common/FlatHashMap.h"
 
 namespace logtail {
 
@@ -93,24 +96,70 @@ private:
     std::unordered_map<K, typename std::list<std::pair<K, V>>::iterator> mIndexMap;
 };
 
-// todo: Use LRUCache to refine ServiceMetaCache
+// ServiceMetaKey is the binary form of a remote ip, strings not parsed as ip are kept by their 128 bits hash.
+struct ServiceMetaKey {
+    enum Type : uint8_t { kNone, kIPV4, kIPV6, kHashed };
+
+    static ServiceMetaKey FromString(const std::string& ip);
+
+    bool operator==(const ServiceMetaKey& rhs) const {
+        return High == rhs.High && Low == rhs.Low && KeyType == rhs.KeyType;
+    }
+
+    uint64_t High{0};
+    uint64_t Low{0};
+    Type KeyType{kNone};
+};
+
+struct ServiceMetaKeyHash {
+    size_t operator()(const ServiceMetaKey& key) const {
+        return size_t((key.High * 0x9E3779B97F4A7C15ULL) ^ key.Low ^ key.KeyType);
+    }
+};
+
+// ServiceMetaCache is a LRU of at most cap metas, nodes are linked by index in one array, so Get, Put and
+// eviction are O(1) without allocation once the array is full. Metas not used for
+// sls_observer_network_hostname_timeout seconds are expired lazily when looked up, so no sweep is needed.
 class ServiceMetaCache {
 public:
     ServiceMetaCache() = delete;
 
 private:
-    uint32_t cap = 0;
-    std::list<std::pair<std::string, ServiceMeta>> mData;
-    std::unordered_map<std::string, std::list<std::pair<std::string, ServiceMeta>>::iterator> mIndexMap;
+    static const uint32_t kNil = UINT32_MAX;
 
-private:
-    explicit ServiceMetaCache(uint32_t capacity) { cap = capacity; }
+    struct Node {
+        ServiceMetaKey Key;
+        ServiceMeta Meta;
+        uint32_t Prev{kNil};
+        uint32_t Next{kNil};
+    };
+
+    explicit ServiceMetaCache(uint32_t capacity) : cap(capacity > 0 ? capacity : 1) {}
 
     const ServiceMeta& Get(const std::string& remoteIP, ProtocolType protocolType);
 
     const ServiceMeta& Get(const std::string& remoteIP);
 
-    void Put(const std::string& remoteIP, const std::string& host, ProtocolType protocolType);
+    // Put returns the meta stored, which is the most recently used one.
+    ServiceMeta& Put(const std::string& remoteIP, const std::string& host, ProtocolType protocolType);
+
+    size_t Size() const { return mIndexMap.size(); }
+    bool Empty() const { return mIndexMap.empty(); }
+    // IsExpired means all metas are expired, because the most recently used one is.
+    bool IsExpired(long now) const { return mHead == kNil || isExpired(mNodes[mHead].Meta, now); }
+
+    // find returns kNil if key is not found, an expired node is removed.
+    uint32_t find(const ServiceMetaKey& key, long now);
+    void moveToFront(uint32_t index);
+    void unlink(uint32_t index);
+    static bool isExpired(const ServiceMeta& meta, long now);
+
+    uint32_t cap = 0;
+    std::vector<Node> mNodes;
+    std::vector<uint32_t> mFreeNodes;
+    uint32_t mHead = kNil;
+    uint32_t mTail = kNil;
+    FlatHashMap<ServiceMetaKey, uint32_t, ServiceMetaKeyHash> mIndexMap;
 
     friend class ServiceMetaManager;
     friend class HostnameMetaUnittest;
@@ -135,7 +184,8 @@ public:
     // OnProcessDestroy delete cache metas.
     void OnProcessDestroy(uint32_t pid);
 
-    // GarbageTimeoutHostname delete the unused metas.
+    // GarbageTimeoutHostname deletes caches of processes whose metas are all expired at @currentTime (seconds),
+    // it costs O(1) per process because metas are expired lazily.
     void GarbageTimeoutHostname(long currentTime);
 
 private:
@@ -145,7 +195,9 @@ private:
 
 
 private:
-    std::unordered_map<uint32_t, ServiceMetaCache*> mHostnameMetas;
+    // AddHostName may be called by multiple parse threads.
+    SpinLock mLock;
+    FlatHashMap<uint32_t, ServiceMetaCache*> mHostnameMetas;
     friend class HostnameMetaUnittest;
 };
 
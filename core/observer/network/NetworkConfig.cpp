@@ -201,6 +201,7 @@ std::string NetworkConfig::SetFromJsonString() {
             Json::Value& pcapValue = obserValue["PCAP"];
             OBSERVER_CONFIG_EXTRACT_BOOL(pcapValue, Enabled, false, PCAP);
             OBSERVER_CONFIG_EXTRACT_BOOL(pcapValue, Promiscuous, true, PCAP);
+            OBSERVER_CONFIG_EXTRACT_BOOL(pcapValue, RingEnabled, false, PCAP);
             OBSERVER_CONFIG_EXTRACT_INT(pcapValue, TimeoutMs, 0, PCAP);
             OBSERVER_CONFIG_EXTRACT_STRING(pcapValue, Filter, "", PCAP);
             OBSERVER_CONFIG_EXTRACT_STRING(pcapValue, Interface, "", PCAP);
@@ -305,6 +306,7 @@ std::string NetworkConfig::ToString() const {
         rst.append("PCAPInterface : ").append(mPCAPInterface).append("\t");
         rst.append("PCAPTimeoutMs : ").append(std::to_string(mPCAPTimeoutMs)).append("\t");
         rst.append("PCAPPromiscuous : ").append(std::to_string(mPCAPPromiscuous)).append("\t");
+        rst.append("PCAPRingEnabled : ").append(std::to_string(mPCAPRingEnabled)).append("\t");
     }
     rst.append("Sampling : ").append(std::to_string(mSampling)).append("\t");
     rst.append("FlushOutL4Interval : ").append(std::to_string(mFlushOutL4Interval)).append("\t");
@@ -356,6 +358,7 @@ void NetworkConfig::Clear() {
     mPCAPFilter.clear();
     mPCAPInterface.clear();
     mPCAPPromiscuous = true;
+    mPCAPRingEnabled = false;
     mPCAPTimeoutMs = 0;
     mFlushOutL4Interval = 60;
     mFlushOutL7Interval = 15;
@@ -121,6 +121,8 @@ struct NetworkConfig {
     std::string mPCAPFilter;
     std::string mPCAPInterface;
     bool mPCAPPromiscuous = true;
+    // read packets from the AF_PACKET TPACKET_V3 mmap ring instead of the libpcap copy path.
+    bool mPCAPRingEnabled = false;
     int mPCAPTimeoutMs = 0;
     uint32_t mPCAPCacheConnSize = 2000;
     // collect config
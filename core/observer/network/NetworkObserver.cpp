@@ -28,6 +28,7 @@
 #include "LogtailPlugin.h"
 #include "Constants.h"
 #include "LogFileProfiler.h"
+#include "common/ThreadAffinity.h"
 
 DEFINE_FLAG_INT64(sls_observer_network_ebpf_connection_gc_interval,
                   "SLS Observer NetWork connection gc interval seconds",
@@ -36,12 +37,47 @@ DEFINE_FLAG_INT64(sls_observer_network_max_save_size,
                   "SLS Observer NetWork max save file size",
                   1024LL * 1024LL * 1024LL);
 DEFINE_FLAG_STRING(sls_observer_network_save_filename, "SLS Observer NetWork save disk's file name", "ebpf.dump");
+DEFINE_FLAG_INT32(sls_observer_network_parse_thread_count,
+                  "SLS Observer NetWork threads to parse protocols, sharded by connection, 0 means event loop thread",
+                  0);
+DEFINE_FLAG_INT32(sls_observer_network_parse_queue_size,
+                  "SLS Observer NetWork max queued packets of each parse thread",
+                  4096);
+DEFINE_FLAG_BOOL(sls_observer_network_netlink_background_refresh,
+                 "SLS Observer NetWork dump netlink connections in a background thread instead of on lookup miss",
+                 false);
+
+DEFINE_FLAG_BOOL(sls_observer_network_metricstore_output,
+                 "SLS Observer NetWork output metrics in metricstore format rather than one log per item",
+                 false);
+DEFINE_FLAG_BOOL(sls_observer_network_adaptive_sampling,
+                 "SLS Observer NetWork adjust ebpf sampling rate by cpu level to keep within cpu limit",
+                 false);
+DEFINE_FLAG_INT32(sls_observer_network_adaptive_sampling_interval,
+                  "SLS Observer NetWork interval seconds to adjust sampling rate",
+                  5);
+DEFINE_FLAG_INT32(sls_observer_network_adaptive_sampling_min_rate, "SLS Observer NetWork min sampling rate", 5);
+DEFINE_FLAG_INT32(sls_observer_network_adaptive_sampling_step,
+                  "SLS Observer NetWork sampling rate increased each time when cpu is idle",
+                  10);
+DEFINE_FLAG_DOUBLE(sls_observer_network_adaptive_sampling_low_cpu_level,
+                   "SLS Observer NetWork raise sampling rate below the cpu level",
+                   0.7);
+DEFINE_FLAG_DOUBLE(sls_observer_network_adaptive_sampling_high_cpu_level,
+                   "SLS Observer NetWork halve sampling rate above the cpu level",
+                   1.0);
 
 DECLARE_FLAG_INT32(merge_log_count_limit);
 
 namespace logtail {
 
 NetworkObserver::~NetworkObserver() {
+    mParseWorkers.reset();
+    for (auto& shardProcesses : mShardProcesses) {
+        for (auto& shardProcess : shardProcesses) {
+            delete shardProcess.second;
+        }
+    }
     for (auto& mAllProcess : mAllProcesses) {
         delete mAllProcess.second;
     }
@@ -51,6 +87,9 @@ void NetworkObserver::HoldOn(bool exitFlag) {
         mEBPFWrapper->HoldOn(exitFlag);
     }
     mEventLoopThreadRWL.lock();
+    if (mParseWorkers) {
+        mParseWorkers->WaitIdle();
+    }
     LOG_INFO(sLogger, ("hold on", "observer"));
 }
 
@@ -72,10 +111,15 @@ uint32_t NetworkObserver::EBPFConnectionGC(uint64_t nowTimeNs) {
     }
     std::unordered_set<int32_t> pids;
     GetAllPids(pids);
+    if (mParseWorkers) {
+        mParseWorkers->WaitIdle();
+    }
     for (auto& connId : connIds) {
-        auto findIter = mAllProcesses.find(connId.tgid);
-        if (findIter != mAllProcesses.end()) {
-            if (findIter->second->HasConnection(EBPFWrapper::ConvertConnIdToSockHash(&connId))) {
+        uint32_t sockHash = EBPFWrapper::ConvertConnIdToSockHash(&connId);
+        auto& processes = mParseWorkers ? mShardProcesses[sockHash % mShardProcesses.size()] : mAllProcesses;
+        auto findIter = processes.find(connId.tgid);
+        if (findIter != processes.end()) {
+            if (findIter->second->HasConnection(sockHash)) {
                 continue;
             }
         }
@@ -109,9 +153,24 @@ void NetworkObserver::GarbageCollection(uint64_t nowTimeNs) {
     size_t maxSizeLimit = 1024 * 1024;
     ++mNetworkStatistic->mGCCount;
     ProtocolDebugStatistic::Clear();
+    if (mParseWorkers) {
+        mParseWorkers->WaitIdle();
+        // shard process observers share the container process group with the one in mAllProcesses, which is
+        // only released after all of its shard process observers.
+        for (auto& shardProcesses : mShardProcesses) {
+            for (auto iter = shardProcesses.begin(); iter != shardProcesses.end();) {
+                if (iter->second->GarbageCollection(maxSizeLimit, nowTimeNs)) {
+                    delete iter->second;
+                    iter = shardProcesses.erase(iter);
+                } else {
+                    ++iter;
+                }
+            }
+        }
+    }
     for (auto iter = mAllProcesses.begin(); iter != mAllProcesses.end();) {
         ProcessObserver* observer = iter->second;
-        if (observer->GarbageCollection(maxSizeLimit, nowTimeNs)) {
+        if (!HasShardProcess(iter->first) && observer->GarbageCollection(maxSizeLimit, nowTimeNs)) {
             LOG_DEBUG(sLogger,
                       ("delete processor observer when gc, meta", observer->GetProcessMeta()->ToString())("pid",
                                                                                                           iter->first));
@@ -127,28 +186,68 @@ void NetworkObserver::GarbageCollection(uint64_t nowTimeNs) {
         } else {
             ++iter;
         }
-        mServiceMetaManager->GarbageTimeoutHostname(nowTimeNs / 1000000);
     }
+    // Metas are expired lazily, only caches of processes without metas alive are released.
+    mServiceMetaManager->GarbageTimeoutHostname(nowTimeNs / 1000000000);
+    size_t tableBytes = mAllProcesses.GetMemoryUsage();
+    for (const auto& item : mAllProcesses) {
+        tableBytes += item.second->GetMemoryUsage();
+    }
+    for (const auto& shardProcesses : mShardProcesses) {
+        tableBytes += shardProcesses.GetMemoryUsage();
+        for (const auto& item : shardProcesses) {
+            tableBytes += item.second->GetMemoryUsage();
+        }
+    }
+    mNetworkStatistic->mTableBytes = tableBytes;
+}
+
+bool NetworkObserver::HasShardProcess(uint32_t pid) const {
+    for (auto& shardProcesses : mShardProcesses) {
+        if (shardProcesses.find(pid) != shardProcesses.end()) {
+            return true;
+        }
+    }
+    return false;
 }
 
-void NetworkObserver::FlushOutMetrics(std::vector<sls_logs::Log>& allData) {
+void NetworkObserver::FlushOutMetrics(std::vector<sls_logs::Log>& allData, MetricBatch* batch) {
     static ContainerProcessGroupManager* containerProcessGroupManager = ContainerProcessGroupManager::GetInstance();
-    containerProcessGroupManager->FlushOutMetrics(allData, mConfig->mTags, mConfig->mFlushOutL7Interval);
+    // shard aggregators are merged when flushed, so parse threads must be idle.
+    if (mParseWorkers) {
+        mParseWorkers->WaitIdle();
+    }
+    double sampleFactor = 1.0;
+    if (mSamplingController) {
+        sampleFactor = mSamplingController->TakeSampleFactor(GetCurrentTimeInNanoSeconds());
+    }
+    if (batch != nullptr) {
+        containerProcessGroupManager->FlushOutMetrics(
+            *batch, mConfig->mTags, mConfig->mFlushOutL7Interval, sampleFactor);
+        return;
+    }
+    containerProcessGroupManager->FlushOutMetrics(
+        allData, mConfig->mTags, mConfig->mFlushOutL7Interval, sampleFactor);
 }
 
-void NetworkObserver::FlushStatistics(logtail::NetStaticticsMap& statisticsMap, std::vector<sls_logs::Log>& allData) {
+void NetworkObserver::FlushStatistics(logtail::NetStaticticsMap& statisticsMap,
+                                      std::vector<sls_logs::Log>& allData,
+                                      MetricBatch* batch) {
     static ContainerProcessGroupManager* cpgManager = ContainerProcessGroupManager::GetInstance();
     MergedNetStatisticsHashMap mergedMap;
-    for (auto& item : statisticsMap.mHashMap) {
-        auto iter = mergedMap.find(item.first);
+    // Only connections updated in this interval are visited, the map keeps others for reuse.
+    statisticsMap.ForEach([&mergedMap](const NetStatisticsKey& key, const NetStatisticsTCP& value) {
+        auto iter = mergedMap.find(key);
         if (iter == mergedMap.end()) {
-            mergedMap.insert(std::make_pair(item.first, item.second));
+            mergedMap.insert(std::make_pair(key, value));
         } else {
-            iter->second.Merge(item.second);
+            iter->second.Merge(value);
         }
-    }
+    });
     size_t lastSize = allData.size();
-    allData.resize(mergedMap.size() + lastSize);
+    if (batch == nullptr) {
+        allData.resize(mergedMap.size() + lastSize);
+    }
 
     ::google::protobuf::RepeatedPtrField<sls_logs::Log_Content> gTags;
     gTags.Reserve(mConfig->mTags.size());
@@ -158,10 +257,18 @@ void NetworkObserver::FlushStatistics(logtail::NetStaticticsMap& statisticsMap,
         content->set_value(tag.second);
     }
 
-    for (auto iter = mergedMap.begin(); iter != mergedMap.end() && lastSize < allData.size(); ++iter) {
-        sls_logs::Log* log = &allData[lastSize];
-        log->mutable_contents()->Reserve(16);
-        log->mutable_contents()->CopyFrom(gTags);
+    std::vector<uint32_t> nameIds;
+    if (batch != nullptr) {
+        const std::string prefix = ObserverMetricsTypeToString(ObserverMetricsType::L4_METRICS) + "_";
+        nameIds.push_back(batch->AddName(prefix + observer::kSendBytes));
+        nameIds.push_back(batch->AddName(prefix + observer::kRecvBytes));
+        nameIds.push_back(batch->AddName(prefix + observer::kSendpackets));
+        nameIds.push_back(batch->AddName(prefix + observer::kRecvPackets));
+    }
+    sls_logs::Log keyLog;
+    MetricBatch::Labels labels;
+    for (auto iter = mergedMap.begin(); iter != mergedMap.end() && (batch != nullptr || lastSize < allData.size());
+         ++iter) {
         Json::Value root;
         Json::StreamWriterBuilder builder;
         builder["indentation"] = ""; // If you want whitespace-less output
@@ -179,29 +286,84 @@ void NetworkObserver::FlushStatistics(logtail::NetStaticticsMap& statisticsMap,
                 root[item.first] = item.second;
             }
         }
-        AddAnyLogContent(log, observer::kLocalInfo, Json::writeString(builder, root));
-        AddAnyLogContent(log, observer::kInterval, this->mConfig->mFlushOutL4Interval);
-        iter->first.ToPB(log);
-        iter->second.ToPB(log);
+        if (batch != nullptr) {
+            labels = mConfig->mTags;
+            labels.emplace_back(observer::kLocalInfo, Json::writeString(builder, root));
+            labels.emplace_back(observer::kInterval, std::to_string(this->mConfig->mFlushOutL4Interval));
+            iter->first.ToPB(&keyLog);
+            MetricBatch::MoveLabels(keyLog, labels);
+            uint32_t labelsId = batch->AddLabels(labels);
+            batch->AddPoint(nameIds[0], labelsId, iter->second.Base.SendBytes);
+            batch->AddPoint(nameIds[1], labelsId, iter->second.Base.RecvBytes);
+            batch->AddPoint(nameIds[2], labelsId, iter->second.Base.SendPackets);
+            batch->AddPoint(nameIds[3], labelsId, iter->second.Base.RecvPackets);
+        } else {
+            sls_logs::Log* log = &allData[lastSize];
+            log->mutable_contents()->Reserve(16);
+            log->mutable_contents()->CopyFrom(gTags);
+            AddAnyLogContent(log, observer::kLocalInfo, Json::writeString(builder, root));
+            AddAnyLogContent(log, observer::kInterval, this->mConfig->mFlushOutL4Interval);
+            iter->first.ToPB(log);
+            iter->second.ToPB(log);
+            ++lastSize;
+        }
         mNetworkStatistic->mInputBytes += iter->second.Base.RecvBytes;
         mNetworkStatistic->mInputBytes += iter->second.Base.SendBytes;
         mNetworkStatistic->mInputEvents += iter->second.Base.RecvPackets;
         mNetworkStatistic->mInputEvents += iter->second.Base.SendPackets;
-        ++lastSize;
     }
 }
 
-void NetworkObserver::FlushOutStatistics(std::vector<sls_logs::Log>& allData) {
+void NetworkObserver::SendOutput(std::vector<sls_logs::Log>& logs, const MetricBatch& batch) {
+    if (batch.GetPointCount() > 0) {
+        mNetworkStatistic->mOutputEvents += batch.GetPointCount();
+        if (!mSenderFunc) {
+            return;
+        }
+        // plugins only accept logs, so the batch is encoded in advance.
+        if (mConfig->mLastApplyedConfig->mPluginProcessFlag) {
+            batch.ToLogs(logs);
+            mSenderFunc(logs, mConfig->mLastApplyedConfig);
+        } else {
+            OutputMetricBatch(batch, mConfig->mLastApplyedConfig);
+        }
+        return;
+    }
+    if (mSenderFunc) {
+        mSenderFunc(logs, mConfig->mLastApplyedConfig);
+    }
+    mNetworkStatistic->mOutputEvents += logs.size();
+    for (const auto& item : logs) {
+        mNetworkStatistic->mOutputBytes += item.GetCachedSize();
+    }
+}
+
+void NetworkObserver::UpdateSampling(uint64_t nowTimeNs) {
+    if (!mSamplingController) {
+        mSamplingController.reset(
+            new SamplingController(INT32_FLAG(sls_observer_network_adaptive_sampling_min_rate),
+                                   INT32_FLAG(sls_observer_network_adaptive_sampling_step),
+                                   DOUBLE_FLAG(sls_observer_network_adaptive_sampling_low_cpu_level),
+                                   DOUBLE_FLAG(sls_observer_network_adaptive_sampling_high_cpu_level)));
+    }
+    // the rate configured by user may be changed by reloading.
+    mSamplingController->SetMaxRate(mConfig->mSampling, nowTimeNs);
+    int32_t rate = mSamplingController->Update(LogtailMonitor::Instance()->GetRealtimeCpuLevel(), nowTimeNs);
+    mEBPFWrapper->UpdateSampling(rate);
+    mNetworkStatistic->mEbpfSamplingRate = rate;
+}
+
+void NetworkObserver::FlushOutStatistics(std::vector<sls_logs::Log>& allData, MetricBatch* batch) {
     // pcap wrapper, do not need to add meta
     if (mPCAPWrapper != nullptr) {
         NetStaticticsMap& statisticsMap = mPCAPWrapper->GetStatistics();
-        FlushStatistics(statisticsMap, allData);
+        FlushStatistics(statisticsMap, allData, batch);
         statisticsMap.Clear();
     }
 
     if (mEBPFWrapper != nullptr) {
         NetStaticticsMap& statisticsMap = mEBPFWrapper->GetStatistics();
-        FlushStatistics(statisticsMap, allData);
+        FlushStatistics(statisticsMap, allData, batch);
         statisticsMap.Clear();
     }
 }
@@ -219,6 +381,9 @@ ProcessObserver* NetworkObserver::GetProcess(PacketEventHeader* header, bool cre
     ProcessMetaPtr processMeta = containerProcessGroupManager->GetProcessMeta(header->PID);
     ContainerProcessGroupPtr groupPtr
         = containerProcessGroupManager->GetContainerProcessGroupPtr(processMeta, header->PID);
+    if (mParseWorkers) {
+        groupPtr->InitShardAggregators(mParseWorkers->GetShardCount());
+    }
     newProc->SetProcessGroup(groupPtr);
     mAllProcesses.insert(std::make_pair(header->PID, newProc));
     return newProc;
@@ -267,6 +432,11 @@ int NetworkObserver::OnPacketEvent(void* event, size_t len) {
                 }
                 break;
             }
+            if (mParseWorkers) {
+                proc->UpdateLastDataTime(header->TimeNano);
+                DispatchPacketEvent(proc, event, len);
+                break;
+            }
             proc->OnData(header, data);
         } break;
         case PacketEventType_Connected:
@@ -279,11 +449,54 @@ int NetworkObserver::OnPacketEvent(void* event, size_t len) {
             if (proc == nullptr) {
                 break;
             }
+            if (mParseWorkers) {
+                DispatchPacketEvent(proc, event, len);
+                break;
+            }
             proc->ConnectionMarkDeleted(header);
         } break;
     }
     return 0;
 }
+
+void NetworkObserver::DispatchPacketEvent(ProcessObserver* process, void* event, size_t len) {
+    // the packet buffer is only valid in current callback, so copy it for the parse thread.
+    std::shared_ptr<std::string> buffer(new std::string);
+    PacketEventToBuffer(event, static_cast<int32_t>(len), *buffer);
+    if (buffer->empty()) {
+        return;
+    }
+    const size_t shard = static_cast<PacketEventHeader*>(event)->SockHash % mParseWorkers->GetShardCount();
+    mParseWorkers->Submit(shard,
+                          [this, shard, process, buffer]() { OnShardPacketEvent(shard, process, *buffer); });
+}
+
+void NetworkObserver::OnShardPacketEvent(size_t shard, ProcessObserver* process, std::string& buffer) {
+    void* event = nullptr;
+    int32_t len = 0;
+    // skip the size prefix written by PacketEventToBuffer.
+    BufferToPacketEvent(&buffer.at(4), static_cast<int32_t>(buffer.size() - 4), event, len);
+    if (event == nullptr) {
+        return;
+    }
+    auto header = static_cast<PacketEventHeader*>(event);
+    auto& processes = mShardProcesses[shard];
+    auto findIter = processes.find(header->PID);
+    if (findIter == processes.end()) {
+        if (header->EventType != PacketEventType_Data) {
+            return;
+        }
+        auto newProc = new ProcessObserver(header->TimeNano);
+        newProc->SetProcessGroup(process->GetProcessGroup(), shard);
+        findIter = processes.insert(std::make_pair(header->PID, newProc)).first;
+    }
+    if (header->EventType == PacketEventType_Data) {
+        auto data = reinterpret_cast<PacketEventData*>((char*)event + sizeof(PacketEventHeader));
+        findIter->second->OnData(header, data);
+    } else {
+        findIter->second->ConnectionMarkDeleted(header);
+    }
+}
 void NetworkObserver::OnProcessDestroyed(uint32_t pid, const char* command, size_t len) {
     auto findIter = mAllProcesses.find(pid);
     if (findIter != mAllProcesses.end()) {
@@ -356,6 +569,7 @@ void NetworkObserver::Reload() {
 
 void NetworkObserver::EventLoop() {
     LOG_INFO(sLogger, ("start observer network event loop", "success"));
+    ThreadAffinity::GetInstance()->BindCurrentThread(THREAD_ROLE_INPUT, 1);
     ContainerProcessGroupManager::GetInstance()->Init();
     if (mConfig->mLocalFileEnabled) {
         mReplayFilePtr = fopen64(STRING_FLAG(sls_observer_network_save_filename).c_str(), "rb+");
@@ -399,6 +613,12 @@ void NetworkObserver::EventLoop() {
                 mLastProbeDisableProcessNs = nowTimeNs;
                 mEBPFWrapper->ProbeProcessStat();
             }
+            if (BOOL_FLAG(sls_observer_network_adaptive_sampling)
+                && nowTimeNs - mLastSamplingTimeNs
+                    >= INT32_FLAG(sls_observer_network_adaptive_sampling_interval) * 1000ULL * 1000ULL * 1000ULL) {
+                mLastSamplingTimeNs = nowTimeNs;
+                UpdateSampling(nowTimeNs);
+            }
             int32_t rst = mEBPFWrapper->ProcessPackets(100, 100);
             if (rst >= 100) {
                 hasMoreData = true;
@@ -450,6 +670,9 @@ void NetworkObserver::EventLoop() {
         if (nowTimeNs - mLastFlushNetlinkTimeNs >= mConfig->mFlushNetlinkInterval * 1000ULL * 1000ULL * 1000ULL) {
             mLastFlushNetlinkTimeNs = nowTimeNs;
             ConnectionMetaManager::GetInstance()->Init();
+            if (BOOL_FLAG(sls_observer_network_netlink_background_refresh)) {
+                ConnectionMetaManager::GetInstance()->StartRefresher(mConfig->mFlushNetlinkInterval);
+            }
             ConnectionMetaManager::GetInstance()->GarbageCollection();
         }
 
@@ -457,28 +680,18 @@ void NetworkObserver::EventLoop() {
         if (nowTimeNs - mLastL4FlushTimeNs >= mConfig->mFlushOutL4Interval * 1000ULL * 1000ULL * 1000ULL) {
             mLastL4FlushTimeNs = nowTimeNs;
             std::vector<sls_logs::Log> allLogs;
-            FlushOutStatistics(allLogs);
-            if (mSenderFunc) {
-                mSenderFunc(allLogs, mConfig->mLastApplyedConfig);
-            }
-            mNetworkStatistic->mOutputEvents += allLogs.size();
-            for (const auto& item : allLogs) {
-                mNetworkStatistic->mOutputBytes += item.GetCachedSize();
-            }
+            MetricBatch batch(GetCurrentTimeInNanoSeconds());
+            FlushOutStatistics(allLogs, BOOL_FLAG(sls_observer_network_metricstore_output) ? &batch : nullptr);
+            SendOutput(allLogs, batch);
         }
 
         // flush observer metrics
         if (nowTimeNs - mLastL7FlushTimeNs >= mConfig->mFlushOutL7Interval * 1000ULL * 1000ULL * 1000ULL) {
             mLastL7FlushTimeNs = nowTimeNs;
             std::vector<sls_logs::Log> allLogs;
-            FlushOutMetrics(allLogs);
-            if (mSenderFunc) {
-                mSenderFunc(allLogs, mConfig->mLastApplyedConfig);
-            }
-            mNetworkStatistic->mOutputEvents += allLogs.size();
-            for (const auto& item : allLogs) {
-                mNetworkStatistic->mOutputBytes += item.GetCachedSize();
-            }
+            MetricBatch batch(GetCurrentTimeInNanoSeconds());
+            FlushOutMetrics(allLogs, BOOL_FLAG(sls_observer_network_metricstore_output) ? &batch : nullptr);
+            SendOutput(allLogs, batch);
         }
         // flush profile metrics
         if ((nowTimeNs - lastProfilingTime) >= INT32_FLAG(monitor_interval) * 1000ULL * 1000ULL * 1000ULL) {
@@ -511,8 +724,27 @@ void NetworkObserver::BindSender() {
     mSenderFunc = this->mConfig->mLastApplyedConfig->mPluginProcessFlag ? OutputPluginProcess : OutputDirectly;
 }
 
+void NetworkObserver::InitParseWorkers(size_t threadCount) {
+    mParseWorkers.reset();
+    for (auto& shardProcesses : mShardProcesses) {
+        for (auto& shardProcess : shardProcesses) {
+            delete shardProcess.second;
+        }
+    }
+    mShardProcesses.clear();
+    if (threadCount == 0) {
+        return;
+    }
+    mShardProcesses.resize(threadCount);
+    mParseWorkers.reset(new ShardedWorkerPool(threadCount, INT32_FLAG(sls_observer_network_parse_queue_size)));
+    LOG_INFO(sLogger, ("observer parse threads", threadCount));
+}
+
 inline void NetworkObserver::StartEventLoop() {
     if (!mEventLoopThread) {
+        if (INT32_FLAG(sls_observer_network_parse_thread_count) > 0) {
+            InitParseWorkers(INT32_FLAG(sls_observer_network_parse_thread_count));
+        }
         mEventLoopThread = CreateThread([this]() { EventLoop(); });
     }
 }
@@ -526,8 +758,41 @@ int NetworkObserver::OutputPluginProcess(std::vector<sls_logs::Log>& logs, Confi
     return 0;
 }
 
-int NetworkObserver::OutputDirectly(std::vector<sls_logs::Log>& logs, Config* config) {
+static void InitObserverLogGroup(sls_logs::LogGroup& logGroup, Config* config) {
+    sls_logs::LogTag* logTagPtr = logGroup.add_logtags();
+    logTagPtr->set_key(LOG_RESERVED_KEY_HOSTNAME);
+    logTagPtr->set_value(LogFileProfiler::mHostname.substr(0, 99));
+    std::string userDefinedId = ConfigManager::GetInstance()->GetUserDefinedIdSet();
+    if (!userDefinedId.empty()) {
+        logTagPtr = logGroup.add_logtags();
+        logTagPtr->set_key(LOG_RESERVED_KEY_USER_DEFINED_ID);
+        logTagPtr->set_value(userDefinedId.substr(0, 99));
+    }
+    logGroup.set_category(config->mCategory);
+    logGroup.set_source(LogFileProfiler::mIpAddr);
+    if (!config->mGroupTopic.empty()) {
+        logGroup.set_topic(config->mGroupTopic);
+    }
+}
+
+static int SendObserverLogGroup(sls_logs::LogGroup& logGroup, size_t logCount, Config* config) {
     static auto sSenderInstance = Sender::Instance();
+    if (!sSenderInstance->Send(
+            config->mProjectName, "", logGroup, config, config->mMergeType, (uint32_t)(logCount * 1024))) {
+        LogtailAlarm::GetInstance()->SendAlarm(DISCARD_DATA_ALARM,
+                                               "push observer data into batch map fail",
+                                               config->mProjectName,
+                                               config->mCategory,
+                                               config->mRegion);
+        LOG_ERROR(sLogger,
+                  ("push observer data into batch map fail, discard logs",
+                   logGroup.logs_size())("project", config->mProjectName)("logstore", config->mCategory));
+        return -1;
+    }
+    return 0;
+}
+
+int NetworkObserver::OutputDirectly(std::vector<sls_logs::Log>& logs, Config* config) {
     uint32_t nowTime = time(nullptr);
     const size_t maxCount = INT32_FLAG(merge_log_count_limit) / 4;
     for (size_t beginIndex = 0; beginIndex < logs.size(); beginIndex += maxCount) {
@@ -536,39 +801,34 @@ int NetworkObserver::OutputDirectly(std::vector<sls_logs::Log>& logs, Config* co
             endIndex = logs.size();
         }
         sls_logs::LogGroup logGroup;
-        sls_logs::LogTag* logTagPtr = logGroup.add_logtags();
-        logTagPtr->set_key(LOG_RESERVED_KEY_HOSTNAME);
-        logTagPtr->set_value(LogFileProfiler::mHostname.substr(0, 99));
-        std::string userDefinedId = ConfigManager::GetInstance()->GetUserDefinedIdSet();
-        if (!userDefinedId.empty()) {
-            logTagPtr = logGroup.add_logtags();
-            logTagPtr->set_key(LOG_RESERVED_KEY_USER_DEFINED_ID);
-            logTagPtr->set_value(userDefinedId.substr(0, 99));
-        }
-        logGroup.set_category(config->mCategory);
-        logGroup.set_source(LogFileProfiler::mIpAddr);
-        if (!config->mGroupTopic.empty()) {
-            logGroup.set_topic(config->mGroupTopic);
-        }
+        InitObserverLogGroup(logGroup, config);
         for (size_t i = beginIndex; i < endIndex; ++i) {
             sls_logs::Log* log = logGroup.add_logs();
             log->mutable_contents()->CopyFrom(*(logs[i].mutable_contents()));
             log->set_time(nowTime);
         }
-        if (!sSenderInstance->Send(config->mProjectName,
-                                   "",
-                                   logGroup,
-                                   config,
-                                   config->mMergeType,
-                                   (uint32_t)((endIndex - beginIndex) * 1024))) {
-            LogtailAlarm::GetInstance()->SendAlarm(DISCARD_DATA_ALARM,
-                                                   "push observer data into batch map fail",
-                                                   config->mProjectName,
-                                                   config->mCategory,
-                                                   config->mRegion);
-            LOG_ERROR(sLogger,
-                      ("push observer data into batch map fail, discard logs",
-                       logGroup.logs_size())("project", config->mProjectName)("logstore", config->mCategory));
+        if (SendObserverLogGroup(logGroup, endIndex - beginIndex, config) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int NetworkObserver::OutputMetricBatch(const MetricBatch& batch, Config* config) {
+    const size_t maxCount = INT32_FLAG(merge_log_count_limit) / 4;
+    for (size_t beginIndex = 0; beginIndex < batch.GetPointCount(); beginIndex += maxCount) {
+        size_t endIndex = beginIndex + maxCount;
+        if (endIndex > batch.GetPointCount()) {
+            endIndex = batch.GetPointCount();
+        }
+        sls_logs::LogGroup logGroup;
+        InitObserverLogGroup(logGroup, config);
+        logGroup.mutable_logs()->Reserve(endIndex - beginIndex);
+        // points are encoded into the log group directly, no intermediate log is built.
+        for (size_t i = beginIndex; i < endIndex; ++i) {
+            batch.ToLog(i, logGroup.add_logs());
+        }
+        if (SendObserverLogGroup(logGroup, endIndex - beginIndex, config) != 0) {
             return -1;
         }
     }
@@ -26,10 +26,16 @@
 #include "common/Lock.h"
 #include "common/TimeUtil.h"
 #include "common/StringPiece.h"
+#include "common/FlatHashMap.h"
 #include "metas/ContainerProcessGroup.h"
 #include "ConnectionObserver.h"
 #include "metas/ConnectionMetaManager.h"
 #include "interface/layerfour.h"
+#include "interface/metricbatch.h"
+#include "ShardedWorkerPool.h"
+#include "SamplingController.h"
+#include <memory>
+#include <vector>
 
 namespace logtail {
 class ProcessObserver;
@@ -88,6 +94,7 @@ private:
     void BindSender();
     static int OutputPluginProcess(std::vector<sls_logs::Log>& logs, Config* cfg);
     static int OutputDirectly(std::vector<sls_logs::Log>& logs, Config* cfg);
+    static int OutputMetricBatch(const MetricBatch& batch, Config* cfg);
 
     /**
      * @brief Process bytes by different protocol processors.
@@ -98,27 +105,62 @@ private:
 
     int OnPacketEvent(void* event, size_t len);
 
+    /**
+     * @brief Copy the packet and parse it in the parse thread chosen by connection hash.
+     * @param process the process observer of event loop thread, which holds the container process group.
+     */
+    void DispatchPacketEvent(ProcessObserver* process, void* event, size_t len);
+
+    /**
+     * @brief Parse packet in a parse thread, only the process observers of the shard are touched.
+     * @param buffer packet copied by PacketEventToBuffer.
+     */
+    void OnShardPacketEvent(size_t shard, ProcessObserver* process, std::string& buffer);
+
+    bool HasShardProcess(uint32_t pid) const;
+
+    void InitParseWorkers(size_t threadCount);
+
     void OnProcessDestroyed(uint32_t pid, const char* command, size_t len);
 
     /**
      * @brief Output layer 4 statistics
      * @param allData allData stores all observer logs
      */
-    void FlushOutStatistics(std::vector<sls_logs::Log>& allData);
+    void FlushOutStatistics(std::vector<sls_logs::Log>& allData, MetricBatch* batch = nullptr);
     /**
      * @brief Read logs from ContainerProcessGroupManager
      * @param allData allData stores all observer protocol logs
      */
-    void FlushOutMetrics(std::vector<sls_logs::Log>& allData);
+    void FlushOutMetrics(std::vector<sls_logs::Log>& allData, MetricBatch* batch = nullptr);
 
-    void FlushStatistics(logtail::NetStaticticsMap& map, std::vector<sls_logs::Log>& logs);
+    /**
+     * @param batch when not null, statistics are written into it rather than logs.
+     */
+    void FlushStatistics(logtail::NetStaticticsMap& map,
+                         std::vector<sls_logs::Log>& logs,
+                         MetricBatch* batch = nullptr);
+
+    /**
+     * @brief Send logs, or the metric batch when sls_observer_network_metricstore_output is enabled.
+     */
+    void SendOutput(std::vector<sls_logs::Log>& logs, const MetricBatch& batch);
+
+    /**
+     * @brief Adjust ebpf sampling rate by the CPU level of logtail.
+     */
+    void UpdateSampling(uint64_t nowTimeNs);
 
     void ReloadSource();
 
     // create a still running thread to process observer data.
     void StartEventLoop();
 
-    std::unordered_map<uint32_t, ProcessObserver*> mAllProcesses;
+    FlatHashMap<uint32_t, ProcessObserver*> mAllProcesses;
+    // When parse workers exist, packets are parsed by the process observers of the connection's shard, and
+    // mAllProcesses only keeps process metas and filters for event loop thread.
+    std::unique_ptr<ShardedWorkerPool> mParseWorkers;
+    std::vector<FlatHashMap<uint32_t, ProcessObserver*>> mShardProcesses;
     std::function<int(std::vector<sls_logs::Log>&, Config*)> mSenderFunc;
     ThreadPtr mEventLoopThread;
     ReadWriteLock mEventLoopThreadRWL;
@@ -130,6 +172,8 @@ private:
     uint64_t mLastFlushNetlinkTimeNs = 0;
     uint64_t mLastProbeDisableProcessNs = 0;
     uint64_t mLastCleanAllDisableProcessNs = 0;
+    uint64_t mLastSamplingTimeNs = 0;
+    std::unique_ptr<SamplingController> mSamplingController;
     FILE* mDumpFilePtr = nullptr;
     FILE* mReplayFilePtr = nullptr;
     int64_t mDumpSize = 0;
@@ -150,6 +194,7 @@ private:
     friend class ProtocolMySqlUnittest;
     friend class ProtocolRedisUnittest;
     friend class ProtocolPgSqlUnittest;
+    friend class ObserverBenchmark;
 };
 
 } // namespace logtail
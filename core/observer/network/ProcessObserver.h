@@ -21,6 +21,7 @@
 #include <unordered_map>
 #include "network/protocols/ProtocolEventAggregators.h"
 #include <vector>
+#include "common/FlatHashMap.h"
 #include "metas/ProcessMeta.h"
 #include "metas/ContainerProcessGroup.h"
 #include "NetworkConfig.h"
@@ -74,6 +75,24 @@ public:
         mAllAggregator = &mProcessGroupPtr->mAggregator;
     }
 
+    /**
+     * @brief SetProcessGroup binds the observer to the aggregator of a parse thread.
+     * @param shard index of the parse thread, the shard aggregators of group must be initialized.
+     */
+    void SetProcessGroup(const ContainerProcessGroupPtr& groupPtr, size_t shard) {
+        mProcessGroupPtr = groupPtr;
+        mAllAggregator = mProcessGroupPtr->GetShardAggregator(shard);
+    }
+
+    const ContainerProcessGroupPtr& GetProcessGroup() const { return mProcessGroupPtr; }
+
+    void UpdateLastDataTime(uint64_t timeNs) { mLastDataTimeNs = timeNs; }
+
+    // GetMemoryUsage returns the bytes of the observer and its connection table, parser caches are not included.
+    size_t GetMemoryUsage() const {
+        return sizeof(*this) + mAllConnections.GetMemoryUsage() + mAllConnections.size() * sizeof(ConnectionObserver);
+    }
+
     /**
      * @brief GarbageCollection
      * @param size_limit_bytes
@@ -83,7 +102,7 @@ public:
     bool GarbageCollection(size_t size_limit_bytes, uint64_t nowTimeNs);
 
 protected:
-    std::unordered_map<uint32_t, ConnectionObserver*> mAllConnections;
+    FlatHashMap<uint32_t, ConnectionObserver*> mAllConnections;
     uint64_t mLastDataTimeNs = 0;
     ContainerProcessGroupPtr mProcessGroupPtr;
     ProtocolEventAggregators* mAllAggregator = NULL;
@@ -0,0 +1,72 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "SamplingController.h"
+#include <algorithm>
+
+namespace logtail {
+
+SamplingController::SamplingController(int32_t minRate,
+                                       int32_t increaseStep,
+                                       double lowCpuLevel,
+                                       double highCpuLevel)
+    : mMinRate(std::max(minRate, 1)),
+      mIncreaseStep(std::max(increaseStep, 1)),
+      mLowCpuLevel(lowCpuLevel),
+      mHighCpuLevel(highCpuLevel) {
+}
+
+void SamplingController::SetMaxRate(int32_t maxRate, uint64_t nowNs) {
+    mMaxRate = std::min(std::max(maxRate, 0), 100);
+    if (mRateBeginNs == 0) {
+        mRateBeginNs = nowNs;
+        mPeriodBeginNs = nowNs;
+        mRate = mMaxRate;
+        return;
+    }
+    if (mRate > mMaxRate) {
+        setRate(mMaxRate, nowNs);
+    }
+}
+
+int32_t SamplingController::Update(double cpuLevel, uint64_t nowNs) {
+    if (cpuLevel >= mHighCpuLevel) {
+        // never goes below the min rate, or whole processes would be lost.
+        setRate(std::min(mMaxRate, std::max(mRate / 2, mMinRate)), nowNs);
+    } else if (cpuLevel < mLowCpuLevel) {
+        setRate(std::min(mRate + mIncreaseStep, mMaxRate), nowNs);
+    }
+    return mRate;
+}
+
+double SamplingController::TakeSampleFactor(uint64_t nowNs) {
+    const double sum = mWeightedRateSum + static_cast<double>(mRate) * (nowNs - mRateBeginNs);
+    const uint64_t duration = nowNs - mPeriodBeginNs;
+    mWeightedRateSum = 0;
+    mRateBeginNs = nowNs;
+    mPeriodBeginNs = nowNs;
+    const double avgRate = duration == 0 ? mRate : sum / duration;
+    return avgRate <= 0 ? 1.0 : 100.0 / avgRate;
+}
+
+void SamplingController::setRate(int32_t rate, uint64_t nowNs) {
+    if (rate == mRate) {
+        return;
+    }
+    mWeightedRateSum += static_cast<double>(mRate) * (nowNs - mRateBeginNs);
+    mRateBeginNs = nowNs;
+    mRate = rate;
+}
+
+} // namespace logtail
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstdint>
+
+namespace logtail {
+
+// SamplingController adjusts the percentage of connections captured by ebpf according to the CPU level of
+// logtail, so the observer keeps within its CPU budget during traffic spikes instead of disabling processes.
+//
+// The rate is halved when CPU level exceeds the high level and raised step by step when it falls below the low
+// level. The time weighted average rate is kept, so aggregated counts can be scaled back.
+class SamplingController {
+public:
+    SamplingController(int32_t minRate, int32_t increaseStep, double lowCpuLevel, double highCpuLevel);
+
+    // SetMaxRate sets the rate configured by user, which the controller never exceeds.
+    void SetMaxRate(int32_t maxRate, uint64_t nowNs);
+
+    // Update adjusts the rate by cpuLevel, and returns the new rate in [0, 100].
+    int32_t Update(double cpuLevel, uint64_t nowNs);
+
+    int32_t GetRate() const { return mRate; }
+
+    // TakeSampleFactor returns 100 / average rate since last call, the factor to scale captured counts by.
+    double TakeSampleFactor(uint64_t nowNs);
+
+private:
+    void setRate(int32_t rate, uint64_t nowNs);
+
+    const int32_t mMinRate;
+    const int32_t mIncreaseStep;
+    const double mLowCpuLevel;
+    const double mHighCpuLevel;
+    int32_t mMaxRate = 100;
+    int32_t mRate = 100;
+    uint64_t mRateBeginNs = 0;
+    uint64_t mPeriodBeginNs = 0;
+    double mWeightedRateSum = 0; // sum of rate * duration in current period
+};
+
+} // namespace logtail
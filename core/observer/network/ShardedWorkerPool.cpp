@@ -0,0 +1,93 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ShardedWorkerPool.h"
+
+namespace logtail {
+
+ShardedWorkerPool::ShardedWorkerPool(size_t shardCount, size_t capacity) : mCapacity(capacity > 0 ? capacity : 1) {
+    for (size_t i = 0; i < shardCount; ++i) {
+        mShards.emplace_back(new Shard);
+    }
+    for (auto& shard : mShards) {
+        Shard* s = shard.get();
+        s->mThread = CreateThread([this, s]() { Run(*s); });
+    }
+}
+
+ShardedWorkerPool::~ShardedWorkerPool() {
+    WaitIdle();
+    for (auto& shard : mShards) {
+        {
+            std::lock_guard<std::mutex> lock(shard->mMux);
+            shard->mStopped = true;
+        }
+        shard->mTaskCond.notify_one();
+        shard->mThread.reset();
+    }
+}
+
+void ShardedWorkerPool::Submit(size_t shard, std::function<void()> task) {
+    Shard& s = *mShards[shard % mShards.size()];
+    std::unique_lock<std::mutex> lock(s.mMux);
+    s.mIdleCond.wait(lock, [this, &s]() { return s.mTasks.size() < mCapacity; });
+    s.mTasks.push_back(std::move(task));
+    // The worker only waits when no task is queued.
+    if (s.mTasks.size() == 1) {
+        lock.unlock();
+        s.mTaskCond.notify_one();
+    }
+}
+
+void ShardedWorkerPool::WaitIdle() {
+    for (auto& shard : mShards) {
+        Shard& s = *shard;
+        std::unique_lock<std::mutex> lock(s.mMux);
+        s.mIdleCond.wait(lock, [&s]() { return s.mTasks.empty() && s.mRunningCount == 0; });
+    }
+}
+
+size_t ShardedWorkerPool::GetPendingCount() {
+    size_t count = 0;
+    for (auto& shard : mShards) {
+        std::lock_guard<std::mutex> lock(shard->mMux);
+        count += shard->mTasks.size() + shard->mRunningCount;
+    }
+    return count;
+}
+
+void ShardedWorkerPool::Run(Shard& shard) {
+    std::deque<std::function<void()>> tasks;
+    std::unique_lock<std::mutex> lock(shard.mMux);
+    while (true) {
+        shard.mTaskCond.wait(lock, [&shard]() { return shard.mStopped || !shard.mTasks.empty(); });
+        if (shard.mTasks.empty()) {
+            return;
+        }
+        // Takes all queued tasks at once, so the producer only contends on the lock once per batch.
+        tasks.swap(shard.mTasks);
+        shard.mRunningCount = tasks.size();
+        lock.unlock();
+        shard.mIdleCond.notify_all();
+        for (auto& task : tasks) {
+            task();
+        }
+        tasks.clear();
+        lock.lock();
+        shard.mRunningCount = 0;
+        shard.mIdleCond.notify_all();
+    }
+}
+
+} // namespace logtail
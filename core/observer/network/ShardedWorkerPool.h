@@ -0,0 +1,66 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <boost/thread.hpp>
+#include "common/Thread.h"
+
+namespace logtail {
+
+// ShardedWorkerPool runs tasks on a fixed number of shards, each shard has its own worker
+// thread, and tasks of the same shard are run one at a time in submit order. So state only
+// touched by tasks of one shard needs no lock.
+//
+// Submit blocks while the shard already has capacity tasks waiting.
+class ShardedWorkerPool {
+public:
+    ShardedWorkerPool(size_t shardCount, size_t capacity);
+    ~ShardedWorkerPool();
+
+    void Submit(size_t shard, std::function<void()> task);
+
+    // WaitIdle blocks until all submitted tasks are done.
+    void WaitIdle();
+
+    // GetPendingCount returns the number of tasks submitted but not done yet.
+    size_t GetPendingCount();
+
+    size_t GetShardCount() const { return mShards.size(); }
+
+private:
+    struct Shard {
+        std::mutex mMux;
+        std::condition_variable mTaskCond;
+        std::condition_variable mIdleCond;
+        std::deque<std::function<void()>> mTasks;
+        size_t mRunningCount = 0;
+        bool mStopped = false;
+        ThreadPtr mThread;
+    };
+
+    void Run(Shard& shard);
+
+    const size_t mCapacity;
+    std::vector<std::unique_ptr<Shard>> mShards;
+};
+
+} // namespace logtail
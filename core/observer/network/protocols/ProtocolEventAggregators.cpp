@@ -21,7 +21,8 @@ void ProtocolEventAggregators::FlushOutMetrics(uint64_t timeNano,
                                                std::vector<sls_logs::Log>& allData,
                                                std::vector<std::pair<std::string, std::string>>& processTags,
                                                std::vector<std::pair<std::string, std::string>>& globalTags,
-                                               uint64_t interval) {
+                                               uint64_t interval,
+                                               double sampleFactor) {
     Json::Value root;
     Json::StreamWriterBuilder builder;
     builder["indentation"] = ""; // If you want whitespace-less output
@@ -40,23 +41,55 @@ void ProtocolEventAggregators::FlushOutMetrics(uint64_t timeNano,
 
 
     if (mDNSAggregators != nullptr) {
-        mDNSAggregators->FlushLogs(allData, pTags, gTags, interval);
+        mDNSAggregators->FlushLogs(allData, pTags, gTags, interval, sampleFactor);
     }
 
     if (mHTTPAggregators != nullptr) {
-        mHTTPAggregators->FlushLogs(allData, pTags, gTags, interval);
+        mHTTPAggregators->FlushLogs(allData, pTags, gTags, interval, sampleFactor);
     }
 
     if (mMySQLAggregators != nullptr) {
-        mMySQLAggregators->FlushLogs(allData, pTags, gTags, interval);
+        mMySQLAggregators->FlushLogs(allData, pTags, gTags, interval, sampleFactor);
     }
 
     if (mRedisAggregators != nullptr) {
-        mRedisAggregators->FlushLogs(allData, pTags, gTags, interval);
+        mRedisAggregators->FlushLogs(allData, pTags, gTags, interval, sampleFactor);
     }
 
     if (mPgSQLAggregators != nullptr) {
-        mPgSQLAggregators->FlushLogs(allData, pTags, gTags, interval);
+        mPgSQLAggregators->FlushLogs(allData, pTags, gTags, interval, sampleFactor);
+    }
+}
+
+void ProtocolEventAggregators::FlushOutMetrics(MetricBatch& batch,
+                                               std::vector<std::pair<std::string, std::string>>& processTags,
+                                               std::vector<std::pair<std::string, std::string>>& globalTags,
+                                               uint64_t interval,
+                                               double sampleFactor) {
+    Json::Value root;
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    for (auto& tag : processTags) {
+        root[tag.first] = tag.second;
+    }
+    MetricBatch::Labels commonLabels(globalTags);
+    commonLabels.emplace_back(observer::kLocalInfo, Json::writeString(builder, root));
+    commonLabels.emplace_back(observer::kInterval, std::to_string(interval));
+
+    if (mDNSAggregators != nullptr) {
+        mDNSAggregators->FlushMetrics(batch, commonLabels, sampleFactor);
+    }
+    if (mHTTPAggregators != nullptr) {
+        mHTTPAggregators->FlushMetrics(batch, commonLabels, sampleFactor);
+    }
+    if (mMySQLAggregators != nullptr) {
+        mMySQLAggregators->FlushMetrics(batch, commonLabels, sampleFactor);
+    }
+    if (mRedisAggregators != nullptr) {
+        mRedisAggregators->FlushMetrics(batch, commonLabels, sampleFactor);
+    }
+    if (mPgSQLAggregators != nullptr) {
+        mPgSQLAggregators->FlushMetrics(batch, commonLabels, sampleFactor);
     }
 }
 
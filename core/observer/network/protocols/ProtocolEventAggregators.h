@@ -103,13 +103,58 @@ public:
 
     const ProcessMetaPtr& GetProcessMeta() const { return mMetaPtr; }
 
+    /**
+     * @brief GetMemoryUsage returns the approximate bytes held by the aggregators of all protocols.
+     */
+    size_t GetMemoryUsage() const {
+        size_t bytes = sizeof(*this);
+        bytes += mDNSAggregators != NULL ? mDNSAggregators->GetMemoryUsage() : 0;
+        bytes += mHTTPAggregators != NULL ? mHTTPAggregators->GetMemoryUsage() : 0;
+        bytes += mMySQLAggregators != NULL ? mMySQLAggregators->GetMemoryUsage() : 0;
+        bytes += mRedisAggregators != NULL ? mRedisAggregators->GetMemoryUsage() : 0;
+        bytes += mPgSQLAggregators != NULL ? mPgSQLAggregators->GetMemoryUsage() : 0;
+        return bytes;
+    }
+
     void SetProcessMeta(const ProcessMetaPtr& metaPtr) { mMetaPtr = metaPtr; }
 
+    /**
+     * @brief MergeFrom moves the aggregated events of other protocol aggregators into current ones.
+     * @param other aggregators filled by a parse thread, would be empty after merged.
+     */
+    void MergeFrom(ProtocolEventAggregators& other) {
+        if (other.mDNSAggregators != NULL) {
+            GetDNSAggregator()->MergeFrom(*other.mDNSAggregators);
+        }
+        if (other.mHTTPAggregators != NULL) {
+            GetHTTPAggregator()->MergeFrom(*other.mHTTPAggregators);
+        }
+        if (other.mMySQLAggregators != NULL) {
+            GetMySQLAggregator()->MergeFrom(*other.mMySQLAggregators);
+        }
+        if (other.mRedisAggregators != NULL) {
+            GetRedisAggregator()->MergeFrom(*other.mRedisAggregators);
+        }
+        if (other.mPgSQLAggregators != NULL) {
+            GetPgSQLAggregator()->MergeFrom(*other.mPgSQLAggregators);
+        }
+    }
+
     void FlushOutMetrics(uint64_t timeNano,
                          std::vector<sls_logs::Log>& allData,
                          std::vector<std::pair<std::string, std::string>>& processTags,
                          std::vector<std::pair<std::string, std::string>>& globalTags,
-                         uint64_t interval);
+                         uint64_t interval,
+                         double sampleFactor = 1.0);
+
+    /**
+     * @brief FlushOutMetrics writes the aggregated events into batch rather than logs.
+     */
+    void FlushOutMetrics(MetricBatch& batch,
+                         std::vector<std::pair<std::string, std::string>>& processTags,
+                         std::vector<std::pair<std::string, std::string>>& globalTags,
+                         uint64_t interval,
+                         double sampleFactor = 1.0);
 
 protected:
     DNSProtocolEventAggregator* mDNSAggregators = NULL;
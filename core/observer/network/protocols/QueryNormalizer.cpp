@@ -0,0 +1,173 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "QueryNormalizer.h"
+#include <strings.h>
+
+namespace logtail {
+
+namespace {
+
+inline bool isIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$'
+        || static_cast<unsigned char>(c) >= 0x80;
+}
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+inline bool endsWith(const std::string& s, const char* suffix, size_t len) {
+    return s.size() >= len && s.compare(s.size() - len, len, suffix) == 0;
+}
+
+// skipQuoted returns the position after the closing @quote of the literal starting at @pos, doubled quotes and
+// backslashes escape it.
+size_t skipQuoted(const std::string& sql, size_t pos, char quote) {
+    for (++pos; pos < sql.size(); ++pos) {
+        if (sql[pos] == '\\') {
+            ++pos;
+        } else if (sql[pos] == quote) {
+            if (pos + 1 < sql.size() && sql[pos + 1] == quote) {
+                ++pos;
+            } else {
+                return pos + 1;
+            }
+        }
+    }
+    return sql.size();
+}
+
+// appendLiteral writes a ?, unless it continues a list of literals already written as ?.
+void appendLiteral(std::string& out) {
+    if (endsWith(out, "?, ", 3)) {
+        out.resize(out.size() - 2);
+    } else if (endsWith(out, "?,", 2)) {
+        out.resize(out.size() - 1);
+    } else {
+        out.push_back('?');
+    }
+}
+
+// appendCloseParen writes a ), and drops the row just closed if it repeats the previous one, as in
+// VALUES (?), (?).
+void appendCloseParen(std::string& out) {
+    out.push_back(')');
+    if (endsWith(out, "(?), (?)", 8)) {
+        out.resize(out.size() - 5);
+    } else if (endsWith(out, "(?),(?)", 7)) {
+        out.resize(out.size() - 4);
+    }
+}
+
+} // namespace
+
+std::string NormalizeSQL(const std::string& sql, bool doubleQuotedString) {
+    std::string out;
+    out.reserve(sql.size());
+    bool pendingSpace = false;
+    size_t pos = 0;
+    while (pos < sql.size()) {
+        const char c = sql[pos];
+        if (isSpace(c)) {
+            pendingSpace = true;
+            ++pos;
+            continue;
+        }
+        if ((c == '-' && pos + 1 < sql.size() && sql[pos + 1] == '-') || (c == '#' && doubleQuotedString)) {
+            pos = sql.find('\n', pos);
+            pos = pos == std::string::npos ? sql.size() : pos;
+            pendingSpace = true;
+            continue;
+        }
+        if (c == '/' && pos + 1 < sql.size() && sql[pos + 1] == '*') {
+            pos = sql.find("*/", pos + 2);
+            pos = pos == std::string::npos ? sql.size() : pos + 2;
+            pendingSpace = true;
+            continue;
+        }
+        if (pendingSpace && !out.empty() && c != ',' && c != ')' && out.back() != '(') {
+            out.push_back(' ');
+        }
+        pendingSpace = false;
+
+        if (c == '\'' || (c == '"' && doubleQuotedString)) {
+            pos = skipQuoted(sql, pos, c);
+            appendLiteral(out);
+        } else if (c == '"' || c == '`') {
+            const size_t end = skipQuoted(sql, pos, c);
+            out.append(sql, pos, end - pos);
+            pos = end;
+        } else if (c >= '0' && c <= '9' && (out.empty() || !isIdentifierChar(out.back()))) {
+            // Hex, decimals and exponents are consumed as a whole.
+            while (pos < sql.size() && (isIdentifierChar(sql[pos]) || sql[pos] == '.')) {
+                const char prev = sql[pos++];
+                if ((prev == 'e' || prev == 'E') && pos < sql.size() && (sql[pos] == '+' || sql[pos] == '-')) {
+                    ++pos;
+                }
+            }
+            // A sign right after an operator or a list separator belongs to the number.
+            if (endsWith(out, "-", 1) && out.size() >= 2 && !isIdentifierChar(out[out.size() - 2])
+                && out[out.size() - 2] != ')') {
+                out.pop_back();
+                while (!out.empty() && out.back() == ' ') {
+                    out.pop_back();
+                }
+                if (!out.empty() && out.back() != '(') {
+                    out.push_back(' ');
+                }
+            }
+            appendLiteral(out);
+        } else if (isIdentifierChar(c)) {
+            while (pos < sql.size() && isIdentifierChar(sql[pos])) {
+                out.push_back(sql[pos++]);
+            }
+        } else if (c == ')') {
+            appendCloseParen(out);
+            ++pos;
+        } else {
+            out.push_back(c);
+            ++pos;
+        }
+    }
+    return out;
+}
+
+std::string NormalizeRedisCommand(const std::string& cmd) {
+    static const char* const sContainerCommands[] = {"ACL",     "CLIENT", "CLUSTER", "COMMAND", "CONFIG",
+                                                     "FUNCTION", "MEMORY", "MODULE",  "OBJECT",  "SCRIPT",
+                                                     "SLOWLOG",  "XGROUP", "XINFO"};
+    size_t begin = cmd.find_first_not_of(' ');
+    if (begin == std::string::npos) {
+        return std::string();
+    }
+    size_t end = cmd.find(' ', begin);
+    std::string out = cmd.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+    for (const char* container : sContainerCommands) {
+        if (end != std::string::npos && strcasecmp(out.c_str(), container) == 0) {
+            begin = cmd.find_first_not_of(' ', end);
+            if (begin != std::string::npos) {
+                end = cmd.find(' ', begin);
+                out.append(" ").append(cmd, begin, end == std::string::npos ? std::string::npos : end - begin);
+            }
+            break;
+        }
+    }
+    if (end != std::string::npos && cmd.find_first_not_of(' ', end) != std::string::npos) {
+        out.append(" ?");
+    }
+    return out;
+}
+
+} // namespace logtail
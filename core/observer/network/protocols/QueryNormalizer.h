@@ -0,0 +1,33 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <string>
+
+namespace logtail {
+
+// NormalizeSQL turns @sql into its shape in one pass, so queries different only in literals are aggregated
+// together: quoted strings and numbers become ?, lists of literals like IN (1, 2, 3) or multi-row VALUES are
+// collapsed into one, comments are removed and whitespaces are squeezed. Identifiers, keywords and bind
+// placeholders ($1, ?) are kept as they are. With @doubleQuotedString (MySQL), "..." is a string literal, or
+// else it is an identifier.
+std::string NormalizeSQL(const std::string& sql, bool doubleQuotedString);
+
+// NormalizeRedisCommand keeps the command of @cmd, and the subcommand for container commands like CONFIG GET,
+// arguments are replaced by one ?.
+std::string NormalizeRedisCommand(const std::string& cmd);
+
+} // namespace logtail
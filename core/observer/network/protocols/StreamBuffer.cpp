@@ -0,0 +1,110 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "StreamBuffer.h"
+#include "common/Flags.h"
+
+DEFINE_FLAG_INT32(sls_observer_network_stream_buffer_max_size,
+                  "SLS Observer NetWork max bytes kept for a fragmented message of a connection direction",
+                  64 * 1024);
+DEFINE_FLAG_INT32(sls_observer_network_stream_buffer_pool_size, "SLS Observer NetWork stream buffer pool size", 1024);
+
+namespace logtail {
+
+StreamBufferPool::~StreamBufferPool() {
+    for (auto buffer : mFreeBuffers) {
+        delete buffer;
+    }
+}
+
+std::string* StreamBufferPool::Acquire() {
+    {
+        ScopedSpinLock lock(mLock);
+        if (!mFreeBuffers.empty()) {
+            std::string* buffer = mFreeBuffers.back();
+            mFreeBuffers.pop_back();
+            return buffer;
+        }
+    }
+    return new std::string;
+}
+
+void StreamBufferPool::Release(std::string* buffer) {
+    buffer->clear();
+    {
+        ScopedSpinLock lock(mLock);
+        if (mFreeBuffers.size() < (size_t)INT32_FLAG(sls_observer_network_stream_buffer_pool_size)) {
+            mFreeBuffers.push_back(buffer);
+            return;
+        }
+    }
+    delete buffer;
+}
+
+size_t StreamBufferPool::GetFreeCount() {
+    ScopedSpinLock lock(mLock);
+    return mFreeBuffers.size();
+}
+
+SlsStringPiece StreamBuffer::Begin(const char* data, size_t size, size_t realSize, uint64_t timeNano) {
+    mTimeNano = timeNano;
+    mTruncated = realSize > size;
+    if (Size() == 0) {
+        mInBuffer = false;
+        mKeptSize = 0;
+        mData = data;
+        mDataSize = size;
+        return {data, size};
+    }
+    mInBuffer = true;
+    mKeptSize = mBuffer->size();
+    mBuffer->append(data, size);
+    return {mBuffer->data(), mBuffer->size()};
+}
+
+void StreamBuffer::End(size_t consumed) {
+    size_t total = mInBuffer ? mBuffer->size() : mDataSize;
+    if (consumed >= total || mTruncated
+        || total - consumed > (size_t)INT32_FLAG(sls_observer_network_stream_buffer_max_size)) {
+        Reset();
+        return;
+    }
+    if (mInBuffer) {
+        if (consumed >= mKeptSize) {
+            mKeptTimeNano = mTimeNano;
+        }
+        mBuffer->erase(0, consumed);
+    } else {
+        if (mBuffer == nullptr) {
+            mBuffer = StreamBufferPool::GetInstance()->Acquire();
+        }
+        mBuffer->assign(mData + consumed, total - consumed);
+        mKeptTimeNano = mTimeNano;
+    }
+    mInBuffer = false;
+    mData = nullptr;
+}
+
+void StreamBuffer::Reset() {
+    if (mBuffer != nullptr) {
+        StreamBufferPool::GetInstance()->Release(mBuffer);
+        mBuffer = nullptr;
+    }
+    mInBuffer = false;
+    mData = nullptr;
+    mDataSize = 0;
+    mKeptSize = 0;
+}
+
+} // namespace logtail
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "common/Lock.h"
+#include "network/protocols/utils.h"
+
+namespace logtail {
+
+// StreamBufferPool keeps released buffers of StreamBuffer, so connections with fragmented messages
+// don't allocate a new buffer for every message.
+class StreamBufferPool {
+public:
+    static StreamBufferPool* GetInstance() {
+        static StreamBufferPool* sPool = new StreamBufferPool;
+        return sPool;
+    }
+
+    ~StreamBufferPool();
+
+    std::string* Acquire();
+
+    void Release(std::string* buffer);
+
+    size_t GetFreeCount();
+
+private:
+    SpinLock mLock;
+    std::vector<std::string*> mFreeBuffers;
+};
+
+// StreamBuffer keeps the unparsed tail of one direction of a connection between data events, so a
+// message split across events is parsed once when it is complete.
+//
+// Begin returns the data to parse in the event. When nothing is kept from the last events, the data of the
+// event is returned without copy, otherwise it is appended to the kept tail. The parser consumes complete
+// messages from the front, and End keeps the rest for the next event.
+class StreamBuffer {
+public:
+    StreamBuffer() = default;
+    ~StreamBuffer() { Reset(); }
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    SlsStringPiece Begin(const char* data, size_t size, size_t realSize, uint64_t timeNano);
+
+    // End keeps the data after consumed bytes. Nothing is kept when the data of the event is truncated,
+    // because the following data can't be joined to it, or when the tail exceeds the size limit.
+    void End(size_t consumed);
+
+    // GetTimeNano returns the time of the event where the data at offset of the last Begin arrived.
+    uint64_t GetTimeNano(size_t offset) const {
+        return mInBuffer && offset < mKeptSize ? mKeptTimeNano : mTimeNano;
+    }
+
+    // IsTruncated returns true if the data of the last Begin is truncated by the capture size.
+    bool IsTruncated() const { return mTruncated; }
+
+    size_t Size() const { return mBuffer == nullptr ? 0 : mBuffer->size(); }
+
+    // GetKeptTimeNano returns the time of the kept data, valid when Size() > 0.
+    uint64_t GetKeptTimeNano() const { return mKeptTimeNano; }
+
+    void Reset();
+
+private:
+    std::string* mBuffer = nullptr;
+    const char* mData = nullptr;
+    size_t mDataSize = 0;
+    size_t mKeptSize = 0;
+    uint64_t mKeptTimeNano = 0;
+    uint64_t mTimeNano = 0;
+    bool mInBuffer = false;
+    bool mTruncated = false;
+};
+
+} // namespace logtail
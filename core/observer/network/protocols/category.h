@@ -126,6 +126,8 @@ struct DBAggKey {
 
     std::string ProtocolType() { return ProtocolTypeToString(PT); }
 
+    static ObserverMetricsType MetricsType() { return ObserverMetricsType::L7_DB_METRICS; }
+
     friend std::ostream& operator<<(std::ostream& Os, const DBAggKey& Key) {
         Os << "ConnKey: " << Key.ConnKey << " QueryCmd: " << Key.QueryCmd << " Query: " << Key.Query
            << " Version: " << Key.Version << " Status: " << Key.Status;
@@ -144,6 +146,20 @@ struct DBAggKey {
     int8_t Status{-1};
 };
 
+// Queries without a place in a full aggregator are aggregated by command into this one.
+const char kCollapsedQuery[] = "__other__";
+
+template <ProtocolType PT>
+bool CollapseAggKey(DBAggKey<PT>& key) {
+    key.Query = kCollapsedQuery;
+    return true;
+}
+
+template <ProtocolType PT>
+bool IsCollapsedAggKey(const DBAggKey<PT>& key) {
+    return key.Query == kCollapsedQuery;
+}
+
 template <ProtocolType PT>
 struct RequestAggKey {
     RequestAggKey() = default;
@@ -192,6 +208,8 @@ struct RequestAggKey {
 
     std::string ProtocolType() { return ProtocolTypeToString(PT); }
 
+    static ObserverMetricsType MetricsType() { return ObserverMetricsType::L7_REQ_METRICS; }
+
     friend std::ostream& operator<<(std::ostream& Os, const RequestAggKey& Key) {
         Os << "ConnKey: " << Key.ConnKey << " ReqType: " << Key.ReqType << " ReqDomain: " << Key.ReqDomain
            << " ReqResource: " << Key.ReqResource << " Version: " << Key.Version << " RespCode: " << Key.RespCode
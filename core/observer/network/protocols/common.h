@@ -20,11 +20,17 @@
 #include <deque>
 #include "log_pb/sls_logs.pb.h"
 #include "interface/helper.h"
+#include "interface/metricbatch.h"
 #include "LogtailAlarm.h"
 #include "metas/ServiceMetaCache.h"
 #include "Logger.h"
+#include "common/TDigest.h"
+#include "common/HeavyHitters.h"
+#include <algorithm>
 #include <unordered_map>
 #include <ostream>
+#include <atomic>
+#include <cmath>
 
 namespace logtail {
 
@@ -82,6 +88,7 @@ struct CommonProtocolAggResult {
         TotalLatencyNs = 0;
         TotalReqBytes = 0;
         TotalRespBytes = 0;
+        LatencyDigest.Clear();
     }
 
     bool IsEmpty() const { return TotalCount == 0; }
@@ -91,6 +98,7 @@ struct CommonProtocolAggResult {
         TotalLatencyNs += info.LatencyNs;
         TotalReqBytes += info.ReqBytes;
         TotalRespBytes += info.RespBytes;
+        LatencyDigest.Add(static_cast<double>(info.LatencyNs));
     }
 
     void Merge(CommonProtocolAggResult& aggResult) {
@@ -98,20 +106,58 @@ struct CommonProtocolAggResult {
         TotalLatencyNs += aggResult.TotalLatencyNs;
         TotalReqBytes += aggResult.TotalReqBytes;
         TotalRespBytes += aggResult.TotalRespBytes;
+        LatencyDigest.Merge(aggResult.LatencyDigest);
     }
 
-    void ToPB(sls_logs::Log* log) const {
-        AddAnyLogContent(log, observer::kCount, TotalCount);
-        AddAnyLogContent(log, observer::kLatencyNs, TotalLatencyNs);
-        AddAnyLogContent(log, observer::kReqBytes, TotalReqBytes);
-        AddAnyLogContent(log, observer::kRespBytes, TotalRespBytes);
-        AddAnyLogContent(log, observer::kTdigestLatency, std::string("xxxxx"));
+    /**
+     * @param sampleFactor totals are scaled by it to make up for the events not sampled, the latency
+     * distribution is kept as it is.
+     */
+    void ToPB(sls_logs::Log* log, double sampleFactor = 1.0) {
+        AddAnyLogContent(log, observer::kCount, scale(TotalCount, sampleFactor));
+        AddAnyLogContent(log, observer::kLatencyNs, scale(TotalLatencyNs, sampleFactor));
+        AddAnyLogContent(log, observer::kReqBytes, scale(TotalReqBytes, sampleFactor));
+        AddAnyLogContent(log, observer::kRespBytes, scale(TotalRespBytes, sampleFactor));
+        AddAnyLogContent(log, observer::kTdigestLatency, LatencyDigest.Serialize());
+    }
+
+    /**
+     * @brief AddMetricNames interns the names of values written by ToMetrics, in the same order.
+     */
+    static void AddMetricNames(MetricBatch& batch, const std::string& prefix, std::vector<uint32_t>& nameIds) {
+        nameIds.clear();
+        nameIds.push_back(batch.AddName(prefix + observer::kCount));
+        nameIds.push_back(batch.AddName(prefix + observer::kLatencyNs));
+        nameIds.push_back(batch.AddName(prefix + observer::kReqBytes));
+        nameIds.push_back(batch.AddName(prefix + observer::kRespBytes));
+        nameIds.push_back(batch.AddName(prefix + "latency_p50_ns"));
+        nameIds.push_back(batch.AddName(prefix + "latency_p99_ns"));
+    }
+
+    /**
+     * @brief ToMetrics is the same as ToPB, except that the latency distribution is written as quantiles
+     * because metricstores could not merge digests.
+     */
+    void ToMetrics(MetricBatch& batch, const std::vector<uint32_t>& nameIds, uint32_t labelsId, double sampleFactor) {
+        batch.AddPoint(nameIds[0], labelsId, scale(TotalCount, sampleFactor));
+        batch.AddPoint(nameIds[1], labelsId, scale(TotalLatencyNs, sampleFactor));
+        batch.AddPoint(nameIds[2], labelsId, scale(TotalReqBytes, sampleFactor));
+        batch.AddPoint(nameIds[3], labelsId, scale(TotalRespBytes, sampleFactor));
+        batch.AddPoint(nameIds[4], labelsId, LatencyDigest.Quantile(0.5));
+        batch.AddPoint(nameIds[5], labelsId, LatencyDigest.Quantile(0.99));
     }
 
     int64_t TotalCount{0};
     int64_t TotalLatencyNs{0};
     int64_t TotalReqBytes{0};
     int64_t TotalRespBytes{0};
+    // LatencyDigest keeps the distribution of LatencyNs, so quantiles are computable after merged.
+    TDigest LatencyDigest;
+
+private:
+    static int64_t scale(int64_t value, double sampleFactor) {
+        return sampleFactor == 1.0 ? value : static_cast<int64_t>(std::llround(value * sampleFactor));
+    }
 };
 
 
@@ -122,10 +168,13 @@ struct CommonProtocolAggResult {
  */
 template <typename ProtocolEventKey, typename ProtocolEventAggResult>
 struct CommonProtocolEventAggItem {
+    typedef ProtocolEventKey KeyType;
+    typedef ProtocolEventAggResult AggResultType;
+
     CommonProtocolEventAggItem() = default;
-    void ToPB(sls_logs::Log* log) {
+    void ToPB(sls_logs::Log* log, double sampleFactor = 1.0) {
         Key.ToPB(log);
-        AggResult.ToPB(log);
+        AggResult.ToPB(log, sampleFactor);
     }
     void Merge(CommonProtocolEventAggItem<ProtocolEventKey, ProtocolEventAggResult>& aggItem) {
         AggResult.Merge(aggItem.AggResult);
@@ -183,17 +232,38 @@ public:
         delete item;
     }
 
+    size_t UnusedSize() const { return mUnUsed.size(); }
+
 private:
     size_t mMaxCount;
     std::deque<ProtocolEventAggItem*> mUnUsed;
 };
 
+/**
+ * CollapseAggKey turns key into the key aggregating events of keys without a place in a full aggregator, it
+ * returns false if the key type could not be collapsed. IsCollapsedAggKey tells keys collapsed.
+ */
+template <typename ProtocolEventKey>
+bool CollapseAggKey(ProtocolEventKey&) {
+    return false;
+}
+template <typename ProtocolEventKey>
+bool IsCollapsedAggKey(const ProtocolEventKey&) {
+    return false;
+}
+
 // 通用的协议的聚类器实现
+// When full, keys that could be collapsed are kept by their counts: a heavy hitters sketch counts keys of
+// current interval, a new key counted more than the least one in aggregator takes its place and the evicted
+// one is merged into its collapsed key, others are aggregated into their collapsed keys directly. Collapsed
+// keys may exceed the max size by a quarter, so totals are kept while memory stays bounded.
 template <typename ProtocolEvent, typename ProtocolEventAggItem, typename ProtocolEventAggItemManager>
 class CommonProtocolEventAggregator {
 public:
     CommonProtocolEventAggregator(uint32_t maxClientAggSize, uint32_t maxServerAggSize)
-        : mClientAggMaxSize(maxClientAggSize), mServerAggMaxSize(maxServerAggSize) {}
+        : mHeavyHitters(2 * std::max(maxClientAggSize, maxServerAggSize)),
+          mClientAggMaxSize(maxClientAggSize),
+          mServerAggMaxSize(maxServerAggSize) {}
 
     ~CommonProtocolEventAggregator() {
         for (auto iter = mProtocolEventAggMap.begin(); iter != mProtocolEventAggMap.end(); ++iter) {
@@ -201,20 +271,33 @@ public:
         }
     }
     bool AddEvent(ProtocolEvent&& event) {
-        auto key = event.Key;
-        auto hashVal = key.Hash();
+        auto hashVal = event.Key.Hash();
+        const uint64_t guaranteed = mHeavyHitters.Add(hashVal);
         auto findRst = mProtocolEventAggMap.find(hashVal);
         if (findRst == mProtocolEventAggMap.end()) {
-            if (isFull(event.Key.ConnKey.Role)) {
-                static uint32_t sLastDropTime{0};
-                auto now = time(nullptr);
-                LOG_DEBUG(sLogger, ("aggregator is full, some events would be dropped", event.Key.ToString()));
-                if (now - sLastDropTime > 60) {
-                    sLastDropTime = now;
-                    LOG_ERROR(sLogger, ("aggregator is full, some events would be dropped", event.Key.ProtocolType()));
+            // A key counted more than the least one takes its place, others go to their collapsed keys.
+            const bool evicted = guaranteed > 1 && guaranteed > mEvictThreshold && isFull(event.Key.ConnKey.Role)
+                && evictLeast(guaranteed);
+            if (!evicted && isFull(event.Key.ConnKey.Role)) {
+                if (CollapseAggKey(event.Key)) {
+                    hashVal = event.Key.Hash();
+                    findRst = mProtocolEventAggMap.find(hashVal);
+                }
+                if (findRst == mProtocolEventAggMap.end() && (!IsCollapsedAggKey(event.Key) || isOverflowFull())) {
+                    // aggregators may be used by multiple parse threads.
+                    static std::atomic<time_t> sLastDropTime{0};
+                    auto now = time(nullptr);
+                    LOG_DEBUG(sLogger, ("aggregator is full, some events would be dropped", event.Key.ToString()));
+                    if (now - sLastDropTime > 60) {
+                        sLastDropTime = now;
+                        LOG_ERROR(sLogger,
+                                  ("aggregator is full, some events would be dropped", event.Key.ProtocolType()));
+                    }
+                    return false;
                 }
-                return false;
             }
+        }
+        if (findRst == mProtocolEventAggMap.end()) {
             auto item = mAggItemManager.Create(std::move(event.Key));
             findRst = mProtocolEventAggMap.insert(std::make_pair(hashVal, item)).first;
         }
@@ -222,10 +305,48 @@ public:
         return true;
     }
 
+    /**
+     * @brief MergeFrom moves all aggregated items of other into current aggregator, other would be empty after merged.
+     * @return false means some items are dropped because current aggregator is full.
+     */
+    bool MergeFrom(CommonProtocolEventAggregator& other) {
+        bool success = true;
+        for (auto iter = other.mProtocolEventAggMap.begin(); iter != other.mProtocolEventAggMap.end();) {
+            ProtocolEventAggItem* item = iter->second;
+            if (!item->AggResult.IsEmpty()) {
+                auto findRst = mProtocolEventAggMap.find(iter->first);
+                if (findRst == mProtocolEventAggMap.end() && isFull(item->Key.ConnKey.Role)
+                    && CollapseAggKey(item->Key)) {
+                    findRst = mProtocolEventAggMap.find(item->Key.Hash());
+                    if (findRst == mProtocolEventAggMap.end() && !isOverflowFull()) {
+                        mProtocolEventAggMap.insert(std::make_pair(item->Key.Hash(), item));
+                        iter = other.mProtocolEventAggMap.erase(iter);
+                        continue;
+                    }
+                }
+                if (findRst != mProtocolEventAggMap.end()) {
+                    findRst->second->Merge(*item);
+                } else if (isFull(item->Key.ConnKey.Role)) {
+                    success = false;
+                } else {
+                    // the item is moved as a whole, so no key copy is needed.
+                    mProtocolEventAggMap.insert(std::make_pair(iter->first, item));
+                    iter = other.mProtocolEventAggMap.erase(iter);
+                    continue;
+                }
+            }
+            other.mAggItemManager.Delete(item);
+            iter = other.mProtocolEventAggMap.erase(iter);
+        }
+        return success;
+    }
+
     void FlushLogs(std::vector<sls_logs::Log>& allData,
                    const std::string& tags,
                    google::protobuf::RepeatedPtrField<sls_logs::Log_Content>& globalTags,
-                   uint64_t interval) {
+                   uint64_t interval,
+                   double sampleFactor = 1.0) {
+        resetHeavyHitters();
         for (auto iter = mProtocolEventAggMap.begin(); iter != mProtocolEventAggMap.end();) {
             if (iter->second->AggResult.IsEmpty()) {
                 mAggItemManager.Delete(iter->second);
@@ -235,7 +356,7 @@ public:
                 newLog.mutable_contents()->CopyFrom(globalTags);
                 AddAnyLogContent(&newLog, observer::kLocalInfo, tags);
                 AddAnyLogContent(&newLog, observer::kInterval, interval);
-                iter->second->ToPB(&newLog);
+                iter->second->ToPB(&newLog, sampleFactor);
                 iter->second->Clear(); // wait for next clear
                 allData.push_back(std::move(newLog));
                 ++iter;
@@ -243,6 +364,46 @@ public:
         }
     }
 
+    /**
+     * @brief FlushMetrics is the same as FlushLogs, except that items are written into batch, all values of
+     * an item share one label set made of commonLabels and the key.
+     */
+    void FlushMetrics(MetricBatch& batch, const MetricBatch::Labels& commonLabels, double sampleFactor = 1.0) {
+        std::vector<uint32_t> nameIds;
+        ProtocolEventAggItem::AggResultType::AddMetricNames(
+            batch,
+            ObserverMetricsTypeToString(ProtocolEventAggItem::KeyType::MetricsType()) + "_",
+            nameIds);
+        resetHeavyHitters();
+        sls_logs::Log keyLog;
+        MetricBatch::Labels labels;
+        for (auto iter = mProtocolEventAggMap.begin(); iter != mProtocolEventAggMap.end();) {
+            if (iter->second->AggResult.IsEmpty()) {
+                mAggItemManager.Delete(iter->second);
+                iter = mProtocolEventAggMap.erase(iter);
+            } else {
+                labels = commonLabels;
+                iter->second->Key.ToPB(&keyLog);
+                MetricBatch::MoveLabels(keyLog, labels);
+                iter->second->AggResult.ToMetrics(batch, nameIds, batch.AddLabels(labels), sampleFactor);
+                iter->second->Clear(); // wait for next clear
+                ++iter;
+            }
+        }
+    }
+
+    /**
+     * @brief GetMemoryUsage returns the approximate bytes held by aggregated and cached items, their index and
+     * the heavy hitters, heap memory owned by keys and results (strings, digests) is not included.
+     */
+    size_t GetMemoryUsage() const {
+        // Each node of the unordered_map holds the value and the next pointer, plus the cached hash.
+        const size_t nodeBytes
+            = sizeof(typename decltype(mProtocolEventAggMap)::value_type) + 2 * sizeof(void*) + sizeof(size_t);
+        const size_t itemCount = mProtocolEventAggMap.size() + mAggItemManager.UnusedSize();
+        return sizeof(*this) + itemCount * sizeof(ProtocolEventAggItem) + mProtocolEventAggMap.size() * nodeBytes + mProtocolEventAggMap.bucket_count() * sizeof(void*)
+            + mHeavyHitters.GetMemoryUsage();
+    }
 
 private:
     bool isFull(PacketRoleType role) {
@@ -254,8 +415,74 @@ private:
         }
         return true;
     }
+
+    // Collapsed keys are allowed a quarter more than max size.
+    bool isOverflowFull() const {
+        const size_t maxSize = std::max(mClientAggMaxSize, mServerAggMaxSize);
+        return mProtocolEventAggMap.size() >= maxSize + maxSize / 4;
+    }
+
+    /**
+     * @brief evictLeast merges the item counted least in current interval into its collapsed key, to make room
+     * for a key counted at least count times. Items are compared by their estimates, which never undercount.
+     * @return false if no item is counted less than count.
+     */
+    bool evictLeast(uint64_t count) {
+        auto victim = mProtocolEventAggMap.end();
+        uint64_t least = count;
+        for (auto iter = mProtocolEventAggMap.begin(); iter != mProtocolEventAggMap.end(); ++iter) {
+            if (IsCollapsedAggKey(iter->second->Key)) {
+                continue;
+            }
+            const uint64_t estimate = mHeavyHitters.Estimate(iter->first);
+            if (estimate < least) {
+                least = estimate;
+                victim = iter;
+            }
+        }
+        // Later keys counted not more than least would not evict others until next scan.
+        mEvictThreshold = least;
+        if (victim == mProtocolEventAggMap.end()) {
+            return false;
+        }
+        ProtocolEventAggItem* item = victim->second;
+        if (item->AggResult.IsEmpty()) {
+            mProtocolEventAggMap.erase(victim);
+            mAggItemManager.Delete(item);
+            return true;
+        }
+        auto key = item->Key;
+        if (!CollapseAggKey(key)) {
+            return false;
+        }
+        const uint64_t hashVal = key.Hash();
+        auto findRst = mProtocolEventAggMap.find(hashVal);
+        if (findRst != mProtocolEventAggMap.end()) {
+            findRst->second->Merge(*item);
+            mProtocolEventAggMap.erase(victim);
+            mAggItemManager.Delete(item);
+            return true;
+        }
+        if (isOverflowFull()) {
+            // The events of victim would be lost without a place for its collapsed key.
+            return false;
+        }
+        // The item becomes its collapsed key as a whole.
+        mProtocolEventAggMap.erase(victim);
+        item->Key = std::move(key);
+        mProtocolEventAggMap.insert(std::make_pair(hashVal, item));
+        return true;
+    }
+
+    void resetHeavyHitters() {
+        mHeavyHitters.Clear();
+        mEvictThreshold = 0;
+    }
+
     ProtocolEventAggItemManager mAggItemManager;
     std::unordered_map<uint64_t, ProtocolEventAggItem*> mProtocolEventAggMap;
+    HeavyHitters mHeavyHitters;
+    uint64_t mEvictThreshold = 0;
     uint32_t mClientAggMaxSize;
     uint32_t mServerAggMaxSize;
 };
@@ -372,6 +599,11 @@ private:
             }
             ++idx;
         }
+        // pipelined requests parsed from the same data event have the same timeNano, match the first one.
+        while (idx - 2 >= this->mHeadRequestsIdx
+               && this->GetReqByIndex(idx - 2)->TimeNano == this->GetReqByIndex(idx - 1)->TimeNano) {
+            --idx;
+        }
         this->mHeadRequestsIdx = idx - 1;
         req = this->GetReqFront();
         if (req == nullptr) {
@@ -121,6 +121,24 @@ struct HTTPParser {
         return {};
     }
 
+    // ReadContentLength returns -1 if the message has no Content-Length header.
+    int64_t ReadContentLength() {
+        static const std::string sContentName("Content-Length");
+        auto val = ReadHeaderVal(sContentName);
+        if (val.Size() == 0) {
+            return -1;
+        }
+        char* end = nullptr;
+        int64_t len = std::strtoll(val.mPtr, &end, 10);
+        return end == val.mPtr || len < 0 ? -1 : len;
+    }
+
+    bool IsChunked() {
+        static const std::string sChunkedName("Transfer-Encoding");
+        static const std::string sChunkedVal = "chunked";
+        return ReadHeaderVal(sChunkedName) == sChunkedVal;
+    }
+
     static int isChunkedMsg(const char* buf, size_t size) {
         if (size > 4) {
             bool commonChunked = *(buf + size - 1) == '\n' && *(buf + size - 2) == '\r';
@@ -145,4 +163,126 @@ struct HTTPParser {
 private:
 };
 
+// HTTPBodySkipper skips the body of a message across data events, so the data after the body is parsed
+// as the next message of the connection.
+class HTTPBodySkipper {
+public:
+    void StartContent(uint64_t len) {
+        mState = len > 0 ? State::Content : State::None;
+        mLeft = len;
+    }
+
+    void StartChunked() {
+        mState = State::ChunkSize;
+        mLeft = 0;
+        mHexCount = 0;
+    }
+
+    bool Active() const { return mState != State::None; }
+
+    void Reset() { mState = State::None; }
+
+    // Skip consumes the body in data and returns the consumed bytes, Active() is false once the body ends.
+    size_t Skip(const char* data, size_t size) {
+        size_t pos = 0;
+        while (pos < size && mState != State::None) {
+            char c = data[pos];
+            switch (mState) {
+                case State::Content:
+                case State::ChunkData: {
+                    size_t step = mLeft < size - pos ? mLeft : size - pos;
+                    pos += step;
+                    mLeft -= step;
+                    if (mLeft == 0) {
+                        mState = mState == State::Content ? State::None : State::ChunkDataEnd;
+                    }
+                    continue;
+                }
+                case State::ChunkSize: {
+                    int digit = HexValue(c);
+                    if (digit >= 0 && mHexCount < 15) {
+                        mLeft = (mLeft << 4) + digit;
+                        ++mHexCount;
+                    } else if (mHexCount == 0) {
+                        // not a chunked body, lose the body and parse the data as next message.
+                        Reset();
+                        return pos;
+                    } else {
+                        mState = State::ChunkSizeLine;
+                        continue;
+                    }
+                    break;
+                }
+                case State::ChunkSizeLine:
+                    // chunk extensions are ignored
+                    if (c == '\n') {
+                        mState = mLeft == 0 ? State::TrailerLineStart : State::ChunkData;
+                    }
+                    break;
+                case State::ChunkDataEnd:
+                    if (c == '\n') {
+                        mState = State::ChunkSize;
+                        mLeft = 0;
+                        mHexCount = 0;
+                    }
+                    break;
+                case State::TrailerLineStart:
+                    if (c == '\n') {
+                        mState = State::None;
+                    } else if (c != '\r') {
+                        mState = State::TrailerLine;
+                    }
+                    break;
+                case State::TrailerLine:
+                    if (c == '\n') {
+                        mState = State::TrailerLineStart;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            ++pos;
+        }
+        return pos;
+    }
+
+    // SkipLost skips the bytes not captured at the end of the data, the chunked body could not be followed.
+    void SkipLost(uint64_t lost) {
+        if (mState == State::Content && lost < mLeft) {
+            mLeft -= lost;
+            return;
+        }
+        Reset();
+    }
+
+private:
+    enum class State {
+        None,
+        Content,
+        ChunkSize,
+        ChunkSizeLine,
+        ChunkData,
+        ChunkDataEnd,
+        TrailerLineStart,
+        TrailerLine,
+    };
+
+    static int HexValue(char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    State mState = State::None;
+    uint64_t mLeft = 0;
+    int mHexCount = 0;
+};
+
 } // end of namespace logtail
\ No newline at end of file
@@ -27,76 +27,91 @@ ParseResult HTTPProtocolParser::OnPacket(PacketType pktType,
                                          const char* pkt,
                                          int32_t pktSize,
                                          int32_t pktRealSize) {
-    // Currently, only accept packets with header.
-    //        if (msgType == MessageType_Request) {
-    //            if (reqCategory == HTTPBodyPacketCategory::Chunked) {
-    //                int res = HTTPParser::isChunkedMsg(pkt, pktSize);
-    //                if (res == 0) {
-    //                    reqCategory = HTTPBodyPacketCategory::Unkonwn;
-    //                    return ParseResult_Partial;
-    //                } else if (res > 0) {
-    //                    return ParseResult_Partial;
-    //                } else {
-    //                    reqCategory = HTTPBodyPacketCategory::Unkonwn;
-    //                }
-    //            } else if (reqCategory == HTTPBodyPacketCategory::MoreContent) {
-    //                if (pktRealSize == mReqMoreContentCapacity) {
-    //                    reqCategory = HTTPBodyPacketCategory::Unkonwn;
-    //                    mReqMoreContentCapacity=0;
-    //                    return ParseResult_Partial;
-    //                } else if (pktRealSize < mReqMoreContentCapacity) {
-    //                    mReqMoreContentCapacity -= pktRealSize;
-    //                    return ParseResult_Partial;
-    //                } else {
-    //                    reqCategory = HTTPBodyPacketCategory::Unkonwn;
-    //                }
-    //            }
-    //        }else if(msgType == MessageType_Response){
-    //            if (respCategory == HTTPBodyPacketCategory::Chunked) {
-    //                int res = HTTPParser::isChunkedMsg(pkt, pktSize);
-    //                if (res == 0) {
-    //                    mRespMoreContentCapacity=0;
-    //                    respCategory = HTTPBodyPacketCategory::Unkonwn;
-    //                    return ParseResult_Partial;
-    //                } else if (res > 0) {
-    //                    return ParseResult_Partial;
-    //                } else {
-    //                    respCategory = HTTPBodyPacketCategory::Unkonwn;
-    //                }
-    //            } else if (respCategory == HTTPBodyPacketCategory::MoreContent) {
-    //                if (pktRealSize == mRespMoreContentCapacity) {
-    //                    respCategory = HTTPBodyPacketCategory::Unkonwn;
-    //                    return ParseResult_Partial;
-    //                } else if (pktRealSize < mRespMoreContentCapacity) {
-    //                    mRespMoreContentCapacity -= pktRealSize;
-    //                    return ParseResult_Partial;
-    //                } else {
-    //                    respCategory = HTTPBodyPacketCategory::Unkonwn;
-    //                }
-    //            }
-    //        }
-
-    HTTPParser parser;
-    if (msgType == MessageType_Request) {
-        parser.ParseRequest(pkt, pktSize);
-        //            reqCategory = parser.bodyPacketCategory;
-        //            mReqMoreContentCapacity = parser.bodySize;
-    } else if (msgType == MessageType_Response) {
-        parser.ParseResp(pkt, pktSize);
-        //            this->respCategory = parser.bodyPacketCategory;
-        //            this->mRespMoreContentCapacity = parser.bodySize;
-    }
     LOG_TRACE(sLogger,
               ("http got data", std::string(pkt, pktSize))("message_type", MessageTypeToString(msgType))(
                   "raw_data", charToHexString(pkt, pktSize, pktSize))("connection_id", header->SockHash));
-    if (parser.status == -1) {
-        LOG_DEBUG(sLogger,
-                  ("http_parse_fail", "")("data", charToHexString(pkt, pktSize, pktSize))("srcPort", header->SrcPort)(
-                      "dstPort", header->DstPort)("message_type", MessageTypeToString(msgType)));
-        return ParseResult_Fail;
+    if (msgType != MessageType_Request && msgType != MessageType_Response) {
+        // nothing could be stitched without the direction.
+        return ParseResult_OK;
+    }
+    StreamBuffer& buffer = msgType == MessageType_Request ? mReqBuffer : mRespBuffer;
+    HTTPBodySkipper& skipper = msgType == MessageType_Request ? mReqBodySkipper : mRespBodySkipper;
+    SlsStringPiece stream = buffer.Begin(pkt, pktSize, pktRealSize, header->TimeNano);
+    if (skipper.Active()) {
+        // a new message at the start of the event means the body is shorter than expected, such as the
+        // response of HEAD request.
+        HTTPParser parser;
+        ParseHeader(parser, msgType, stream.mPtr, stream.mLen);
+        if (parser.status > 0) {
+            skipper.Reset();
+        }
+    }
+    ParseResult result = ParseResult_Partial;
+    size_t offset = 0;
+    while (offset < stream.mLen) {
+        const char* msg = stream.mPtr + offset;
+        size_t left = stream.mLen - offset;
+        if (skipper.Active()) {
+            offset += skipper.Skip(msg, left);
+            continue;
+        }
+        HTTPParser parser;
+        ParseHeader(parser, msgType, msg, left);
+        if (parser.status == -1) {
+            LOG_DEBUG(sLogger,
+                      ("http_parse_fail", "")("data", charToHexString(msg, left, left))("srcPort", header->SrcPort)(
+                          "dstPort", header->DstPort)("message_type", MessageTypeToString(msgType)));
+            buffer.End(stream.mLen);
+            return result == ParseResult_Partial ? ParseResult_Fail : result;
+        }
+        size_t headerLen = parser.status;
+        int32_t msgBytes = left + pktRealSize - pktSize;
+        if (parser.status == -2) {
+            if (!buffer.IsTruncated()) {
+                // wait for the rest of the header.
+                break;
+            }
+            // the header is cut by the capture size and would never be completed, use the parsed part.
+            headerLen = left;
+        } else {
+            int64_t contentLen = parser.ReadContentLength();
+            if (msgType == MessageType_Response
+                && (parser.packet.msg.resp.code / 100 == 1 || parser.packet.msg.resp.code == 204
+                    || parser.packet.msg.resp.code == 304)) {
+                contentLen = 0;
+            }
+            if (contentLen >= 0) {
+                skipper.StartContent(contentLen);
+                msgBytes = headerLen + contentLen;
+            } else if (parser.IsChunked()) {
+                skipper.StartChunked();
+            }
+        }
+        InsertMessage(parser, pktType, msgType, header, buffer.GetTimeNano(offset), msgBytes, result);
+        offset += headerLen;
+    }
+    if (buffer.IsTruncated() && skipper.Active()) {
+        skipper.SkipLost(pktRealSize - pktSize);
     }
+    buffer.End(offset);
+    return result;
+}
 
+void HTTPProtocolParser::ParseHeader(HTTPParser& parser, MessageType msgType, const char* msg, size_t msgSize) {
+    if (msgType == MessageType_Request) {
+        parser.ParseRequest(msg, msgSize);
+    } else {
+        parser.ParseResp(msg, msgSize);
+    }
+}
 
+void HTTPProtocolParser::InsertMessage(HTTPParser& parser,
+                                       PacketType pktType,
+                                       MessageType msgType,
+                                       PacketEventHeader* header,
+                                       uint64_t timeNano,
+                                       int32_t msgBytes,
+                                       ParseResult& result) {
     bool insertSuccess = true;
     if (msgType == MessageType_Request) {
         std::string host = parser.ReadHeaderVal("Host").ToString();
@@ -110,27 +125,37 @@ ParseResult HTTPProtocolParser::OnPacket(PacketType pktType,
         int pos = parser.packet.msg.req.url.Find('?');
         std::string url = std::string(parser.packet.msg.req.url.mPtr, pos == -1 ? parser.packet.msg.req.url.mLen : pos);
         insertSuccess = mCache.InsertReq([&](HTTPRequestInfo* req) {
-            req->TimeNano = header->TimeNano;
+            req->TimeNano = timeNano;
             req->Method = parser.packet.msg.req.method.ToString();
             req->URL = std::move(url);
             req->Version = std::to_string(parser.packet.common.version);
             req->Host = std::move(host);
-            req->ReqBytes = pktRealSize;
+            req->ReqBytes = msgBytes;
             LOG_TRACE(sLogger, ("http insert req hash", header->SockHash)("data", req->ToString()));
         });
-    } else if (msgType == MessageType_Response) {
+    } else {
         insertSuccess = mCache.InsertResp([&](HTTPResponseInfo* info) {
-            info->TimeNano = header->TimeNano;
+            info->TimeNano = timeNano;
             info->RespCode = parser.packet.msg.resp.code;
-            info->RespBytes = pktRealSize;
+            info->RespBytes = msgBytes;
             LOG_TRACE(sLogger, ("http insert resp hash", header->SockHash)("data", info->ToString()));
         });
     }
-    return insertSuccess ? ParseResult_OK : ParseResult_Drop;
+    if (!insertSuccess) {
+        result = ParseResult_Drop;
+    } else if (result == ParseResult_Partial) {
+        result = ParseResult_OK;
+    }
 }
 
 bool HTTPProtocolParser::GarbageCollection(size_t size_limit_bytes, uint64_t expireTimeNs) {
-    return mCache.GarbageCollection(expireTimeNs);
+    if (mReqBuffer.Size() > 0 && mReqBuffer.GetKeptTimeNano() < expireTimeNs) {
+        mReqBuffer.Reset();
+    }
+    if (mRespBuffer.Size() > 0 && mRespBuffer.GetKeptTimeNano() < expireTimeNs) {
+        mRespBuffer.Reset();
+    }
+    return mCache.GarbageCollection(expireTimeNs) && mReqBuffer.Size() == 0 && mRespBuffer.Size() == 0;
 }
 
 int32_t HTTPProtocolParser::GetCacheSize() {
@@ -21,6 +21,7 @@
 #include "network/protocols/http/type.h"
 #include "observer/interface/network.h"
 #include "inner_parser.h"
+#include "network/protocols/StreamBuffer.h"
 
 namespace logtail {
 
@@ -107,8 +108,22 @@ public:
     int32_t GetCacheSize();
 
 private:
+    static void ParseHeader(HTTPParser& parser, MessageType msgType, const char* msg, size_t msgSize);
+
+    void InsertMessage(HTTPParser& parser,
+                       PacketType pktType,
+                       MessageType msgType,
+                       PacketEventHeader* header,
+                       uint64_t timeNano,
+                       int32_t msgBytes,
+                       ParseResult& result);
+
     HttpCache mCache;
     CommonAggKey mKey;
+    StreamBuffer mReqBuffer;
+    StreamBuffer mRespBuffer;
+    HTTPBodySkipper mReqBodySkipper;
+    HTTPBodySkipper mRespBodySkipper;
 
     friend class ProtocolHttpUnittest;
 };
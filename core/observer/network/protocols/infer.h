@@ -66,6 +66,22 @@ enum class PostgreSqlTag {
 }
 
 
+namespace logtail {
+// HTTP signatures are compared with the first 8 bytes loaded once, each signature is a masked compare
+// instead of a byte by byte compare.
+struct HTTPSignature {
+    uint64_t Value;
+    uint64_t Mask;
+    MessageType Type;
+
+    HTTPSignature(const char* sig, MessageType type) : Value(0), Mask(0), Type(type) {
+        size_t len = strlen(sig);
+        memcpy(&Value, sig, len);
+        memset(&Mask, 0xff, len);
+    }
+};
+} // namespace logtail
+
 static __inline MessageType
 infer_http_message(const char* buf, int32_t count, const uint16_t srcPort, const uint16_t dstPort) {
     // Smallest HTTP response is 17 characters:
@@ -81,23 +97,20 @@ infer_http_message(const char* buf, int32_t count, const uint16_t srcPort, const
         return MessageType_Request;
     }
 
-    if (buf[0] == 'H' && buf[1] == 'T' && buf[2] == 'T' && buf[3] == 'P') {
-        return MessageType_Response;
-    }
-    if (buf[0] == 'G' && buf[1] == 'E' && buf[2] == 'T') {
-        return MessageType_Request;
-    }
-    if (buf[0] == 'H' && buf[1] == 'E' && buf[2] == 'A' && buf[3] == 'D') {
-        return MessageType_Request;
-    }
-    if (buf[0] == 'P' && buf[1] == 'O' && buf[2] == 'S' && buf[3] == 'T') {
-        return MessageType_Request;
-    }
-    if (buf[0] == 'P' && buf[1] == 'U' && buf[2] == 'T') {
-        return MessageType_Request;
-    }
-    if (buf[0] == 'D' && buf[1] == 'E' && buf[2] == 'L' && buf[3] == 'E' && buf[4] == 'T' && buf[5] == 'E') {
-        return MessageType_Request;
+    static const logtail::HTTPSignature sSignatures[] = {
+        logtail::HTTPSignature("HTTP", MessageType_Response),
+        logtail::HTTPSignature("GET", MessageType_Request),
+        logtail::HTTPSignature("HEAD", MessageType_Request),
+        logtail::HTTPSignature("POST", MessageType_Request),
+        logtail::HTTPSignature("PUT", MessageType_Request),
+        logtail::HTTPSignature("DELETE", MessageType_Request),
+    };
+    uint64_t head;
+    memcpy(&head, buf, sizeof(head));
+    for (const logtail::HTTPSignature& sig : sSignatures) {
+        if ((head & sig.Mask) == sig.Value) {
+            return sig.Type;
+        }
     }
     return MessageType_None;
 }
@@ -19,6 +19,7 @@
 #include <map>
 #include <utility>
 #include "network/protocols/mysql/type.h"
+#include "network/protocols/QueryNormalizer.h"
 #include "observer/interface/network.h"
 #include "inner_parser.h"
 
@@ -56,7 +57,7 @@ public:
                 event.Info.ReqBytes = requestInfo->ReqBytes;
                 event.Info.RespBytes = responseInfo->RespBytes;
                 event.Key.QueryCmd = ToLowerCaseString(requestInfo->SQL.substr(0, requestInfo->SQL.find_first_of(' ')));
-                event.Key.Query = std::move(requestInfo->SQL);
+                event.Key.Query = NormalizeSQL(requestInfo->SQL, true);
                 event.Key.Status = responseInfo->OK;
                 event.Key.ConnKey = mKey;
                 return true;
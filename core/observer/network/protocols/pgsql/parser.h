@@ -20,6 +20,7 @@
 #include <ostream>
 
 #include "network/protocols/pgsql/type.h"
+#include "network/protocols/QueryNormalizer.h"
 
 #include "interface/network.h"
 #include "inner_parser.h"
@@ -77,7 +78,7 @@ public:
                 event.Info.RespBytes = responseInfo->RespBytes;
                 event.Key.ConnKey = mKey;
                 event.Key.QueryCmd = ToLowerCaseString(requestInfo->SQL.substr(0, requestInfo->SQL.find_first_of(' ')));
-                event.Key.Query = std::move(requestInfo->SQL);
+                event.Key.Query = NormalizeSQL(requestInfo->SQL, false);
                 event.Key.Status = responseInfo->OK;
                 return true;
             });
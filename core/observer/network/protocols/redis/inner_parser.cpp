@@ -12,12 +12,99 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cctype>
 #include <iostream>
 #include <string>
 
 #include "inner_parser.h"
 namespace logtail {
 
+static const int kRedisMaxNestedDepth = 8;
+
+// returns the position after the \r\n of the line at pos, 0 if the line is not complete, -1 if illegal.
+static int64_t RedisLineEnd(const char* data, size_t size, size_t pos) {
+    const char* lf = (const char*)memchr(data + pos, '\n', size - pos);
+    if (lf == nullptr) {
+        return 0;
+    }
+    if (lf == data + pos || *(lf - 1) != '\r') {
+        return -1;
+    }
+    return lf - data + 1;
+}
+
+static bool RedisReadNumber(const char* begin, const char* end, int64_t& number) {
+    bool negative = begin < end && *begin == '-';
+    if (negative) {
+        ++begin;
+    }
+    if (begin == end || end - begin > 18) {
+        return false;
+    }
+    number = 0;
+    for (; begin < end; ++begin) {
+        if (*begin < '0' || *begin > '9') {
+            return false;
+        }
+        number = number * 10 + (*begin - '0');
+    }
+    if (negative) {
+        number = -number;
+    }
+    return true;
+}
+
+// returns the position after the value at pos, 0 if the value is not complete, -1 if illegal.
+static int64_t RedisValueEnd(const char* data, size_t size, size_t pos, int depth) {
+    if (pos >= size) {
+        return 0;
+    }
+    char type = data[pos];
+    int64_t lineEnd = RedisLineEnd(data, size, pos);
+    if (lineEnd <= 0) {
+        return lineEnd;
+    }
+    int64_t number = 0;
+    switch (type) {
+        case '+':
+        case '-':
+        case ':':
+            return lineEnd;
+        case '$':
+            if (!RedisReadNumber(data + pos + 1, data + lineEnd - 2, number)) {
+                return -1;
+            }
+            if (number < 0) {
+                return lineEnd;
+            }
+            if (lineEnd + number + 2 > (int64_t)size) {
+                return 0;
+            }
+            if (data[lineEnd + number] != '\r' || data[lineEnd + number + 1] != '\n') {
+                return -1;
+            }
+            return lineEnd + number + 2;
+        case '*':
+            if (!RedisReadNumber(data + pos + 1, data + lineEnd - 2, number) || depth >= kRedisMaxNestedDepth) {
+                return -1;
+            }
+            for (int64_t i = 0; i < number; ++i) {
+                lineEnd = RedisValueEnd(data, size, lineEnd, depth + 1);
+                if (lineEnd <= 0) {
+                    return lineEnd;
+                }
+            }
+            return lineEnd;
+        default:
+            // inline command, such as PING\r\n
+            return isalpha((unsigned char)type) ? lineEnd : -1;
+    }
+}
+
+int64_t RedisParser::MessageLength(const char* data, size_t size) {
+    return RedisValueEnd(data, size, 0, 0);
+}
+
 SlsStringPiece RedisParser::readUtilNewLine() {
     const char* s = readChar();
     const char* ch = s;
@@ -54,6 +54,10 @@ public:
 
     void print();
 
+    // MessageLength returns the length of the first complete message in data, 0 if the message is not
+    // complete yet, and -1 if data is not a redis message. Pipelined messages are split by it.
+    static int64_t MessageLength(const char* data, size_t size);
+
 public:
     RedisData redisData;
 };
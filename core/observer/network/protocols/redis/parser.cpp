@@ -28,53 +28,100 @@ ParseResult RedisProtocolParser::OnPacket(PacketType pktType,
                                           const char* pkt,
                                           int32_t pktSize,
                                           int32_t pktRealSize) {
-    RedisParser redis(pkt, pktSize);
     LOG_TRACE(sLogger,
               ("message_type", MessageTypeToString(msgType))("redis date", charToHexString(pkt, pktSize, pktSize)));
+    if (msgType != MessageType_Request && msgType != MessageType_Response) {
+        // nothing could be stitched without the direction.
+        return ParseResult_OK;
+    }
+    StreamBuffer& buffer = msgType == MessageType_Request ? mReqBuffer : mRespBuffer;
+    SlsStringPiece stream = buffer.Begin(pkt, pktSize, pktRealSize, header->TimeNano);
+    ParseResult result = ParseResult_Partial;
+    size_t offset = 0;
+    // pipelined messages are parsed one by one, the incomplete tail is kept for the next event.
+    while (offset < stream.mLen) {
+        const char* msg = stream.mPtr + offset;
+        size_t left = stream.mLen - offset;
+        int64_t len = RedisParser::MessageLength(msg, left);
+        int32_t msgBytes = len;
+        if (len == 0 && buffer.IsTruncated()) {
+            // the rest is cut by the capture size and would never be completed, parse the captured part.
+            len = left;
+            msgBytes = left + pktRealSize - pktSize;
+        }
+        if (len == 0) {
+            break;
+        }
+        if (len < 0 || !ParseMessage(msgType, header, msg, len, buffer.GetTimeNano(offset), msgBytes, result)) {
+            LOG_DEBUG(sLogger,
+                      ("redis_parse_fail", "illegal message")("data", charToHexString(msg, left, left))(
+                          "srcPort", header->SrcPort)("dstPort", header->DstPort));
+            buffer.End(stream.mLen);
+            return result == ParseResult_Partial ? ParseResult_Fail : result;
+        }
+        offset += len;
+    }
+    buffer.End(offset);
+    return result;
+}
+
+bool RedisProtocolParser::ParseMessage(MessageType msgType,
+                                       PacketEventHeader* header,
+                                       const char* msg,
+                                       size_t msgSize,
+                                       uint64_t timeNano,
+                                       int32_t msgBytes,
+                                       ParseResult& result) {
+    RedisParser redis(msg, msgSize);
     try {
         redis.parse();
-    } catch (const std::runtime_error& re) {
-        LOG_DEBUG(sLogger,
-                  ("redis_parse_fail", re.what())("data", charToHexString(pkt, pktSize, pktSize))(
-                      "srcPort", header->SrcPort)("dstPort", header->DstPort));
-        return ParseResult_Fail;
     } catch (const std::exception& ex) {
         LOG_DEBUG(sLogger,
-                  ("redis_parse_fail", ex.what())("data", charToHexString(pkt, pktSize, pktSize))(
+                  ("redis_parse_fail", ex.what())("data", charToHexString(msg, msgSize, msgSize))(
                       "srcPort", header->SrcPort)("dstPort", header->DstPort));
-        return ParseResult_Fail;
+        return false;
     } catch (...) {
-        LOG_DEBUG(
-            sLogger,
-            ("redis_parse_fail", "Unknown failure occurred when parse")("data", charToHexString(pkt, pktSize, pktSize))(
-                "srcPort", header->SrcPort)("dstPort", header->DstPort));
-        return ParseResult_Fail;
+        LOG_DEBUG(sLogger,
+                  ("redis_parse_fail", "Unknown failure occurred when parse")(
+                      "data", charToHexString(msg, msgSize, msgSize))("srcPort", header->SrcPort)(
+                      "dstPort", header->DstPort));
+        return false;
     }
-
-    if (redis.OK()) {
-        bool insertSuccess = true;
-        if (msgType == MessageType_Request) {
-            insertSuccess = mCache.InsertReq([&](RedisRequestInfo* info) {
-                info->TimeNano = header->TimeNano;
-                info->ReqBytes = pktRealSize;
-                info->CMD = redis.redisData.GetCommands();
-                LOG_TRACE(sLogger, ("redis insert req", info->ToString()));
-            });
-        } else if (msgType == MessageType_Response) {
-            insertSuccess = mCache.InsertResp([&](RedisResponseInfo* info) {
-                info->TimeNano = header->TimeNano;
-                info->RespBytes = pktRealSize;
-                info->isOK = !redis.redisData.isError;
-                LOG_TRACE(sLogger, ("redis insert resp", info->ToString()));
-            });
-        }
-        return insertSuccess ? ParseResult_OK : ParseResult_Drop;
+    if (!redis.OK()) {
+        return false;
     }
-    return ParseResult_Fail;
+    bool insertSuccess = true;
+    if (msgType == MessageType_Request) {
+        insertSuccess = mCache.InsertReq([&](RedisRequestInfo* info) {
+            info->TimeNano = timeNano;
+            info->ReqBytes = msgBytes;
+            info->CMD = redis.redisData.GetCommands();
+            LOG_TRACE(sLogger, ("redis insert req", info->ToString()));
+        });
+    } else {
+        insertSuccess = mCache.InsertResp([&](RedisResponseInfo* info) {
+            info->TimeNano = timeNano;
+            info->RespBytes = msgBytes;
+            info->isOK = !redis.redisData.isError;
+            LOG_TRACE(sLogger, ("redis insert resp", info->ToString()));
+        });
+    }
+    if (!insertSuccess) {
+        result = ParseResult_Drop;
+    } else if (result == ParseResult_Partial) {
+        result = ParseResult_OK;
+    }
+    return true;
 }
 
 bool RedisProtocolParser::GarbageCollection(size_t size_limit_bytes, uint64_t expireTimeNs) {
-    return mCache.GarbageCollection(expireTimeNs);
+    if (mReqBuffer.Size() > 0 && mReqBuffer.GetKeptTimeNano() < expireTimeNs) {
+        mReqBuffer.Reset();
+    }
+    if (mRespBuffer.Size() > 0 && mRespBuffer.GetKeptTimeNano() < expireTimeNs) {
+        mRespBuffer.Reset();
+    }
+    return mCache.GarbageCollection(expireTimeNs) && mReqBuffer.Size() == 0 && mRespBuffer.Size() == 0;
 }
 
 int32_t RedisProtocolParser::GetCacheSize() {
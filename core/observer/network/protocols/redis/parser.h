@@ -21,8 +21,10 @@
 #include <deque>
 #include <ostream>
 #include "network/protocols/redis/type.h"
+#include "network/protocols/QueryNormalizer.h"
 #include "observer/interface/network.h"
 #include "inner_parser.h"
+#include "network/protocols/StreamBuffer.h"
 
 namespace logtail {
 
@@ -68,7 +70,7 @@ public:
             event.Info.RespBytes = resp->RespBytes;
             event.Key.ConnKey = mKey;
             event.Key.QueryCmd = ToLowerCaseString(req->CMD.substr(0, req->CMD.find_first_of(' ')));
-            event.Key.Query = std::move(req->CMD);
+            event.Key.Query = NormalizeRedisCommand(req->CMD);
             event.Key.Status = resp->isOK;
             return true;
         });
@@ -95,8 +97,19 @@ public:
     int32_t GetCacheSize();
 
 private:
+    // ParseMessage parses a complete message and inserts it into the cache, returns false if it's illegal.
+    bool ParseMessage(MessageType msgType,
+                      PacketEventHeader* header,
+                      const char* msg,
+                      size_t msgSize,
+                      uint64_t timeNano,
+                      int32_t msgBytes,
+                      ParseResult& result);
+
     RedisCache mCache;
     CommonAggKey mKey;
+    StreamBuffer mReqBuffer;
+    StreamBuffer mRespBuffer;
 
     friend class ProtocolRedisUnittest;
 };
@@ -394,6 +394,7 @@ bool EBPFWrapper::Init(std::function<int(StringPiece)> processor) {
     set_ebpf_int_config((int32_t)TGID_FILTER, 0, mConfig->mEBPFPid);
     set_ebpf_int_config((int32_t)SELF_FILTER, 0, getpid());
     set_ebpf_int_config((int32_t)DATA_SAMPLING, 0, mConfig->mSampling);
+    mSampling = mConfig->mSampling;
     set_ebpf_int_config((int32_t)PERF_BUFFER_PAGE, (int32_t)DATA_HAND, 512);
     LOG_INFO(sLogger, ("init ebpf source", "success"));
     mInitSuccess = true;
@@ -705,6 +706,15 @@ bool EBPFWrapper::isAppendMySQLMsg(conn_data_event_t* pEvent) {
     return true;
 }
 
+void EBPFWrapper::UpdateSampling(int32_t rate) {
+    if (!mInitSuccess || rate == mSampling) {
+        return;
+    }
+    set_ebpf_int_config((int32_t)DATA_SAMPLING, 0, rate);
+    LOG_INFO(sLogger, ("update ebpf sampling rate, from", mSampling)("to", rate));
+    mSampling = rate;
+}
+
 void EBPFWrapper::DisableProcess(uint32_t pid) {
     if (!mStartSuccess) {
         return;
@@ -92,6 +92,10 @@ public:
     void CleanAllDisableProcesses();
     int32_t GetDisablesProcessCount();
 
+    // UpdateSampling sets the percentage of connections whose data would be captured by kernel.
+    void UpdateSampling(int32_t rate);
+    int32_t GetSampling() const { return mSampling; }
+
 protected:
     SocketCategory ConvertDataToPacketHeader(struct conn_data_event_t* event, PacketEventHeader* header);
     bool ConvertCtrlToPacketHeader(struct conn_ctrl_event_t* event, PacketEventHeader* header);
@@ -113,6 +117,7 @@ private:
     bool mInitSuccess = false;
     bool mStartSuccess = false;
     uint64_t mDeltaTimeNs = 0;
+    int32_t mSampling = 100;
     std::unordered_map<uint32_t, uint64_t> mDisabledProcesses;
 
     ConnectionMetaManager* mConnectionMetaManager;
@@ -36,6 +36,7 @@ typedef int (*pcap_setfilter_func)(pcap_t*, struct bpf_program*);
 typedef int (*pcap_dispatch_func)(pcap_t*, int, pcap_handler, u_char*);
 typedef void (*pcap_close_func)(pcap_t*);
 typedef char* (*pcap_geterr_func)(pcap_t*);
+typedef pcap_t* (*pcap_open_dead_func)(int, int);
 
 pcap_compile_func g_pcap_compile_func = NULL; // pcap_compile
 pcap_lookupdev_func g_pcap_lookupdev_func = NULL; // pcap_lookupdev
@@ -45,11 +46,22 @@ pcap_setfilter_func g_pcap_setfilter_func = NULL; // pcap_setfilter
 pcap_dispatch_func g_pcap_dispatch_func = NULL; // pcap_dispatch
 pcap_close_func g_pcap_close_func = NULL; // pcap_close
 pcap_geterr_func g_pcap_geterr_func = NULL; // pcap_geterr
+pcap_open_dead_func g_pcap_open_dead_func = NULL; // pcap_open_dead
+
+DEFINE_FLAG_INT32(sls_observer_network_pcap_ring_block_size, "SLS Observer NetWork PCAP ring block size", 1 << 22);
+DEFINE_FLAG_INT32(sls_observer_network_pcap_ring_block_count, "SLS Observer NetWork PCAP ring block count", 64);
+DEFINE_FLAG_INT32(sls_observer_network_pcap_ring_frame_size, "SLS Observer NetWork PCAP ring frame size", 2048);
+DEFINE_FLAG_INT32(sls_observer_network_pcap_infer_max_fail_count,
+                  "SLS Observer NetWork PCAP data events to infer the protocol of a connection before giving up",
+                  16);
+DEFINE_FLAG_INT32(sls_observer_network_pcap_ring_block_timeout_ms,
+                  "SLS Observer NetWork PCAP ring block retire timeout ms",
+                  10);
 
 static bool PCAPLoadSuccess() {
     return g_pcap_compile_func != NULL && g_pcap_lookupdev_func != NULL && g_pcap_lookupnet_func != NULL
         && g_pcap_open_live_func != NULL && g_pcap_setfilter_func != NULL && g_pcap_dispatch_func != NULL
-        && g_pcap_geterr_func != NULL && g_pcap_close_func != NULL;
+        && g_pcap_geterr_func != NULL && g_pcap_close_func != NULL && g_pcap_open_dead_func != NULL;
 }
 
 #define LOAD_PCAP_FUNC(funcName) \
@@ -66,6 +78,10 @@ static bool PCAPLoadSuccess() {
 
 namespace logtail {
 bool PCAPWrapper::Stop() {
+    if (mRingReader.IsOpen()) {
+        LOG_INFO(sLogger, ("pcap ring close", "begin")("dropped packets", mRingReader.GetDropCount()));
+        mRingReader.Close();
+    }
     if (mHandle != NULL && g_pcap_close_func != NULL) {
         LOG_INFO(sLogger, ("pcap close", "begin"));
         g_pcap_close_func(mHandle);
@@ -97,6 +113,7 @@ bool PCAPWrapper::Init(std::function<int(StringPiece)> processor) {
         LOAD_PCAP_FUNC(pcap_dispatch);
         LOAD_PCAP_FUNC(pcap_close);
         LOAD_PCAP_FUNC(pcap_geterr);
+        LOAD_PCAP_FUNC(pcap_open_dead);
 
         LOG_INFO(sLogger, ("load pcap dynamic library", "success"));
     }
@@ -130,6 +147,10 @@ bool PCAPWrapper::Init(std::function<int(StringPiece)> processor) {
         return false;
     }
 
+    if (mConfig->mPCAPRingEnabled) {
+        return InitRing(netInterface, netp, maskp);
+    }
+
     // the device that we specified in the previous section
     // snaplen is an integer which defines the maximum number of bytes to be captured by pcap
     // promisc, when set to true, brings the interface into promiscuous mode (however, even if it is set to false, it is
@@ -180,7 +201,56 @@ bool PCAPWrapper::Init(std::function<int(StringPiece)> processor) {
     return true;
 }
 
+bool PCAPWrapper::InitRing(const char* netInterface, bpf_u_int32 netp, bpf_u_int32 maskp) {
+    // the handle is only used to compile the filter, packets are read from the ring.
+    mHandle = g_pcap_open_dead_func(DLT_EN10MB, BUFSIZ);
+    if (mHandle == NULL) {
+        LOG_ERROR(sLogger, ("init pcap ring when open pcap dead handle error", ""));
+        LogtailAlarm::GetInstance()->SendAlarm(OBSERVER_INIT_ALARM, "cannot open pcap dead handle");
+        return false;
+    }
+    mLocalAddress = GetHostIpValueByInterface(std::string(netInterface));
+    mLocalMaskAddress = netp;
+    if (g_pcap_compile_func(mHandle, &mBPFFilter, mConfig->mPCAPFilter.c_str(), 0, netp) == PCAP_ERROR) {
+        LOG_ERROR(sLogger,
+                  ("init pcap ring when compile bpf filter error, err", g_pcap_geterr_func(mHandle))(
+                      "filter", mConfig->mPCAPFilter));
+        LogtailAlarm::GetInstance()->SendAlarm(
+            OBSERVER_INIT_ALARM, "compile pcap bpf filter error, err: " + std::string(g_pcap_geterr_func(mHandle)));
+        return false;
+    }
+    if (!mRingReader.Open(netInterface,
+                          mConfig->mPCAPPromiscuous,
+                          INT32_FLAG(sls_observer_network_pcap_ring_block_size),
+                          INT32_FLAG(sls_observer_network_pcap_ring_block_count),
+                          INT32_FLAG(sls_observer_network_pcap_ring_frame_size),
+                          INT32_FLAG(sls_observer_network_pcap_ring_block_timeout_ms))
+        || !mRingReader.AttachFilter(mBPFFilter.bf_insns, mBPFFilter.bf_len)) {
+        LOG_ERROR(sLogger, ("init pcap ring error, err", mRingReader.GetErrorMessage()));
+        LogtailAlarm::GetInstance()->SendAlarm(OBSERVER_INIT_ALARM,
+                                               "init pcap ring error, err: " + mRingReader.GetErrorMessage());
+        mRingReader.Close();
+        return false;
+    }
+    LOG_INFO(sLogger,
+             ("init pcap ring", "success")("net interface", netInterface)("filter", mConfig->mPCAPFilter)(
+                 "mask", maskp));
+    return true;
+}
+
 int32_t PCAPWrapper::ProcessPackets(int32_t maxProcessPackets, int32_t maxProcessDurationMs) {
+    if (mRingReader.IsOpen()) {
+        int32_t rst = mRingReader.ReadBlocks(
+            maxProcessPackets,
+            mConfig->mPCAPTimeoutMs,
+            [this](const u_char* packet, uint32_t capLen, uint32_t wireLen, uint64_t timeNano) {
+                ProcessPacket(packet, capLen, wireLen, timeNano);
+            });
+        if (rst < 0) {
+            LOG_WARNING(sLogger, ("pcap ring read error, code", rst)("error", mRingReader.GetErrorMessage()));
+        }
+        return rst;
+    }
     if (g_pcap_dispatch_func == NULL || g_pcap_geterr_func == NULL || mHandle == NULL) {
         return -2;
     }
@@ -203,6 +273,13 @@ int32_t PCAPWrapper::ProcessPackets(int32_t maxProcessPackets, int32_t maxProces
     return maxProcessPackets;
 }
 void PCAPWrapper::PCAPCallBack(const struct pcap_pkthdr* header, const u_char* packet) {
+    ProcessPacket(packet,
+                  header->caplen,
+                  header->len,
+                  uint64_t(header->ts.tv_sec) * 1000000000LL + header->ts.tv_usec * 1000LL);
+}
+
+void PCAPWrapper::ProcessPacket(const u_char* packet, uint32_t capLen, uint32_t wireLen, uint64_t timeNano) {
     assert(mPacketProcessor);
     /* First, lets make sure we have an IP packet */
     struct ether_header* eth_header;
@@ -261,7 +338,7 @@ void PCAPWrapper::PCAPCallBack(const struct pcap_pkthdr* header, const u_char* p
     bool retran = false;
     bool zeroWindow = false;
     if (protocol == IPPROTO_UDP) {
-        if (ethernet_header_length + ip_header_length + sizeof(udphdr) >= header->caplen) {
+        if (ethernet_header_length + ip_header_length + sizeof(udphdr) >= capLen) {
             // invalid length
             return;
         }
@@ -274,8 +351,8 @@ void PCAPWrapper::PCAPCallBack(const struct pcap_pkthdr* header, const u_char* p
             return;
         }
         payload_raw_length = payload_length = udpLength - sizeof(udphdr);
-        if (udpLength + ethernet_header_length + ip_header_length > header->caplen) {
-            payload_length = header->caplen - ethernet_header_length + ip_header_length - sizeof(udphdr);
+        if (udpLength + ethernet_header_length + ip_header_length > capLen) {
+            payload_length = capLen - ethernet_header_length + ip_header_length - sizeof(udphdr);
         }
         payload = udp_header + sizeof(udphdr);
     } else if (protocol == IPPROTO_TCP) {
@@ -285,7 +362,7 @@ void PCAPWrapper::PCAPCallBack(const struct pcap_pkthdr* header, const u_char* p
         to find the beginning of the TCP header */
         tcp_header = packet + ethernet_header_length + ip_header_length;
         struct tcphdr* tcpHeaderSturct = (struct tcphdr*)tcp_header;
-        if (ethernet_header_length + ip_header_length + sizeof(tcphdr) >= header->caplen) {
+        if (ethernet_header_length + ip_header_length + sizeof(tcphdr) >= capLen) {
             // invalid length
             return;
         }
@@ -307,8 +384,8 @@ void PCAPWrapper::PCAPCallBack(const struct pcap_pkthdr* header, const u_char* p
         /* Add up all the header sizes to find the payload offset */
         int total_headers_size = ethernet_header_length + ip_header_length + tcp_header_length;
         // printf("Size of all headers combined: %d bytes\n", total_headers_size);
-        payload_length = header->caplen - total_headers_size;
-        payload_raw_length = header->len - total_headers_size;
+        payload_length = capLen - total_headers_size;
+        payload_raw_length = wireLen - total_headers_size;
         // printf("Payload size: %d bytes\n", payload_length);
         payload = packet + total_headers_size;
     } else {
@@ -361,7 +438,7 @@ void PCAPWrapper::PCAPCallBack(const struct pcap_pkthdr* header, const u_char* p
         = XXH32((void*)(&eventHeader->SrcAddr), (char*)(&eventHeader->DstPort) - (char*)(&eventHeader->SrcAddr) + 2, 0);
     eventHeader->EventType = PacketEventType_Data;
     eventHeader->PID = 0;
-    eventHeader->TimeNano = uint64_t(header->ts.tv_sec) * 1000000000LL + header->ts.tv_usec * 1000LL;
+    eventHeader->TimeNano = timeNano;
     PacketEventData* eventData = (PacketEventData*)(packetBuffer + sizeof(PacketEventHeader));
     eventData->Buffer = (char*)payload;
     eventData->BufferLen = payload_length;
@@ -369,15 +446,32 @@ void PCAPWrapper::PCAPCallBack(const struct pcap_pkthdr* header, const u_char* p
     eventData->PktType = packetType;
 
     auto res = caches.Get(eventHeader->SockHash, nullptr);
-    if (res == nullptr) {
+    if (res != nullptr && res->Role == PacketRoleType::Unknown
+        && res->FailCount >= INT32_FLAG(sls_observer_network_pcap_infer_max_fail_count)) {
+        // the connection is not any supported protocol, stop inferring for every data event.
+        eventData->PtlType = ProtocolType_None;
+        eventData->MsgType = MessageType_None;
+        eventHeader->RoleType = PacketRoleType::Unknown;
+    } else if (res == nullptr || res->Role == PacketRoleType::Unknown) {
         std::tuple<ProtocolType, MessageType> inferRst
             = infer_protocol(eventHeader, packetType, (char*)payload, payload_length, payload_raw_length);
         eventData->PtlType = std::get<0>(inferRst);
         eventData->MsgType = std::get<1>(inferRst);
         eventHeader->RoleType = InferServerOrClient(packetType, eventData->MsgType);
-        if (eventHeader->RoleType != PacketRoleType::Unknown) {
-            caches.Put(
-                eventHeader->SockHash, std::move(std::make_pair(eventHeader->RoleType, eventData->PtlType)), nullptr);
+        if (res == nullptr) {
+            PCAPConnInferResult inferResult;
+            inferResult.Role = eventHeader->RoleType;
+            inferResult.Protocol = eventData->PtlType;
+            inferResult.FailCount = eventHeader->RoleType == PacketRoleType::Unknown ? 1 : 0;
+            caches.Put(eventHeader->SockHash, std::move(inferResult), nullptr);
+        } else {
+            caches.Get(eventHeader->SockHash, [&](PCAPConnInferResult* inferResult) {
+                inferResult->Role = eventHeader->RoleType;
+                inferResult->Protocol = eventData->PtlType;
+                if (inferResult->Role == PacketRoleType::Unknown) {
+                    ++inferResult->FailCount;
+                }
+            });
         }
         LOG_DEBUG(sLogger,
                   ("receive data event:new conn, addr",
@@ -386,8 +480,8 @@ void PCAPWrapper::PCAPCallBack(const struct pcap_pkthdr* header, const u_char* p
                       "msg", MessageTypeToString(eventData->MsgType))("hash", eventHeader->SockHash));
         LOG_TRACE(sLogger, ("data", charToHexString(eventData->Buffer, eventData->RealLen, eventData->RealLen)));
     } else {
-        eventData->PtlType = res->second;
-        eventHeader->RoleType = res->first;
+        eventData->PtlType = res->Protocol;
+        eventHeader->RoleType = res->Role;
         if (eventData->PktType == PacketType_In) {
             eventData->MsgType
                 = eventHeader->RoleType == PacketRoleType::Client ? MessageType_Response : MessageType_Request;
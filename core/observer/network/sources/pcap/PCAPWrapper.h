@@ -32,10 +32,18 @@
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
 #include "common/DynamicLibHelper.h"
+#include "PacketRingReader.h"
 
 
 namespace logtail {
 
+struct PCAPConnInferResult {
+    PacketRoleType Role = PacketRoleType::Unknown;
+    ProtocolType Protocol = ProtocolType_None;
+    // data events of the connection failed to infer the protocol.
+    int32_t FailCount = 0;
+};
+
 class PCAPWrapper {
 public:
     PCAPWrapper(NetworkConfig* config) : mConfig(config), caches(config->mPCAPCacheConnSize) {}
@@ -73,11 +81,18 @@ public:
 
     void PCAPCallBack(const struct pcap_pkthdr* packet_header, const u_char* packet_content);
 
+    // ProcessPacket parses the headers in place, the payload passed to the processor points into packet.
+    void ProcessPacket(const u_char* packet, uint32_t capLen, uint32_t wireLen, uint64_t timeNano);
+
     NetStaticticsMap& GetStatistics() { return mStatistics; }
 
     friend class PCAPWrapperUnittest;
 
 private:
+    // InitRing captures packets with the TPACKET_V3 ring instead of pcap_dispatch, libpcap is only used to
+    // compile the filter.
+    bool InitRing(const char* netInterface, bpf_u_int32 netp, bpf_u_int32 maskp);
+
     NetworkConfig* mConfig;
     std::function<int(StringPiece)> mPacketProcessor;
     char mErrBuf[PCAP_ERRBUF_SIZE] = {'\0'};
@@ -87,7 +102,8 @@ private:
     bpf_u_int32 mLocalMaskAddress = 0;
     DynamicLibLoader* mPCAPLib = NULL;
     NetStaticticsMap mStatistics;
-    LRUCache<uint32_t, std::pair<PacketRoleType,ProtocolType>> caches;
+    LRUCache<uint32_t, PCAPConnInferResult> caches;
+    PacketRingReader mRingReader;
 };
 
 } // namespace logtail
\ No newline at end of file
@@ -0,0 +1,185 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "PacketRingReader.h"
+
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/filter.h>
+
+namespace logtail {
+
+bool PacketRingReader::Open(const std::string& netInterface,
+                            bool promiscuous,
+                            uint32_t blockSize,
+                            uint32_t blockCount,
+                            uint32_t frameSize,
+                            uint32_t blockTimeoutMs) {
+    Close();
+    int pageSize = getpagesize();
+    if (blockSize == 0 || blockSize % pageSize != 0 || blockCount == 0 || frameSize < TPACKET_ALIGNMENT
+        || blockSize % frameSize != 0) {
+        return SetError("invalid ring size, block size must be a multiple of page size and frame size");
+    }
+    mFd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (mFd < 0) {
+        return SetError(std::string("create packet socket failed: ") + strerror(errno));
+    }
+    int version = TPACKET_V3;
+    if (setsockopt(mFd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0) {
+        return SetError(std::string("set TPACKET_V3 failed: ") + strerror(errno));
+    }
+    tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = blockSize;
+    req.tp_block_nr = blockCount;
+    req.tp_frame_size = frameSize;
+    req.tp_frame_nr = blockSize / frameSize * blockCount;
+    req.tp_retire_blk_tov = blockTimeoutMs;
+    if (setsockopt(mFd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0) {
+        return SetError(std::string("set packet rx ring failed: ") + strerror(errno));
+    }
+    mRingSize = size_t(blockSize) * blockCount;
+    void* ring = mmap(nullptr, mRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, mFd, 0);
+    if (ring == MAP_FAILED) {
+        mRingSize = 0;
+        return SetError(std::string("mmap packet rx ring failed: ") + strerror(errno));
+    }
+    mRing = (uint8_t*)ring;
+    mBlockSize = blockSize;
+    mBlockCount = blockCount;
+    mCurrentBlock = 0;
+
+    // bind after the ring is set up, so that no packet is queued to the socket without the ring.
+    mIfIndex = netInterface.empty() ? 0 : if_nametoindex(netInterface.c_str());
+    if (!netInterface.empty() && mIfIndex == 0) {
+        return SetError("cannot find net interface " + netInterface);
+    }
+    sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = mIfIndex;
+    if (bind(mFd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        return SetError(std::string("bind packet socket failed: ") + strerror(errno));
+    }
+    if (promiscuous && mIfIndex != 0) {
+        packet_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        mreq.mr_ifindex = mIfIndex;
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(mFd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0) {
+            return SetError(std::string("set promiscuous mode failed: ") + strerror(errno));
+        }
+    }
+    mErrMsg.clear();
+    return true;
+}
+
+bool PacketRingReader::AttachFilter(const void* instructions, uint16_t len) {
+    if (mFd < 0) {
+        return SetError("packet socket is not opened");
+    }
+    sock_fprog prog;
+    prog.len = len;
+    prog.filter = (sock_filter*)instructions;
+    if (setsockopt(mFd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) != 0) {
+        mErrMsg = std::string("attach bpf filter failed: ") + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void PacketRingReader::Close() {
+    if (mRing != nullptr) {
+        munmap(mRing, mRingSize);
+        mRing = nullptr;
+        mRingSize = 0;
+    }
+    if (mFd >= 0) {
+        // the promiscuous membership is dropped by the kernel when the socket is closed.
+        close(mFd);
+        mFd = -1;
+    }
+    mIfIndex = 0;
+    mCurrentBlock = 0;
+}
+
+int32_t PacketRingReader::ReadBlocks(int32_t maxPackets, int32_t timeoutMs, const PacketCallback& callback) {
+    if (mRing == nullptr) {
+        return -2;
+    }
+    int32_t processedPackets = 0;
+    while (processedPackets < maxPackets) {
+        tpacket_block_desc* block = (tpacket_block_desc*)(mRing + size_t(mCurrentBlock) * mBlockSize);
+        if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+            // only wait when nothing is processed in this round
+            if (processedPackets > 0 || timeoutMs <= 0) {
+                break;
+            }
+            pollfd pfd;
+            pfd.fd = mFd;
+            pfd.events = POLLIN | POLLERR;
+            pfd.revents = 0;
+            int rst = poll(&pfd, 1, timeoutMs);
+            if (rst < 0 && errno != EINTR) {
+                mErrMsg = std::string("poll packet socket failed: ") + strerror(errno);
+                return -1;
+            }
+            if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+                break;
+            }
+        }
+        if (block->hdr.bh1.block_status & TP_STATUS_LOSING) {
+            tpacket_stats_v3 stats;
+            socklen_t len = sizeof(stats);
+            if (getsockopt(mFd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0) {
+                mDropCount += stats.tp_drops;
+            }
+        }
+        processedPackets += WalkBlock(block, callback);
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        mCurrentBlock = (mCurrentBlock + 1) % mBlockCount;
+    }
+    return processedPackets;
+}
+
+uint32_t PacketRingReader::WalkBlock(const tpacket_block_desc* block, const PacketCallback& callback) {
+    uint32_t packetCount = block->hdr.bh1.num_pkts;
+    const uint8_t* pos = (const uint8_t*)block + block->hdr.bh1.offset_to_first_pkt;
+    for (uint32_t i = 0; i < packetCount; ++i) {
+        const tpacket3_hdr* header = (const tpacket3_hdr*)pos;
+        callback((const u_char*)pos + header->tp_mac,
+                 header->tp_snaplen,
+                 header->tp_len,
+                 uint64_t(header->tp_sec) * 1000000000ULL + header->tp_nsec);
+        pos += header->tp_next_offset;
+    }
+    return packetCount;
+}
+
+bool PacketRingReader::SetError(const std::string& msg) {
+    mErrMsg = msg;
+    Close();
+    return false;
+}
+
+} // namespace logtail
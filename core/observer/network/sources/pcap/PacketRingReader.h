@@ -0,0 +1,84 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <linux/if_packet.h>
+
+namespace logtail {
+
+// PacketRingReader captures packets from an AF_PACKET socket with a TPACKET_V3 mmap ring.
+// The kernel fills whole blocks of packets, and the packets are handed to the callback by
+// pointers into the ring, so nothing is copied before the protocol parsers. A block is
+// returned to the kernel after all of its packets are consumed, so the pointers are only
+// valid inside the callback.
+class PacketRingReader {
+public:
+    // data points to the link layer header, capLen bytes are captured of the wireLen bytes packet.
+    typedef std::function<void(const u_char* data, uint32_t capLen, uint32_t wireLen, uint64_t timeNano)>
+        PacketCallback;
+
+    PacketRingReader() = default;
+    ~PacketRingReader() { Close(); }
+
+    PacketRingReader(const PacketRingReader&) = delete;
+    PacketRingReader& operator=(const PacketRingReader&) = delete;
+
+    bool Open(const std::string& netInterface,
+              bool promiscuous,
+              uint32_t blockSize,
+              uint32_t blockCount,
+              uint32_t frameSize,
+              uint32_t blockTimeoutMs);
+
+    // AttachFilter attaches a classic bpf program, e.g. compiled by pcap_compile, to the socket.
+    bool AttachFilter(const void* instructions, uint16_t len);
+
+    void Close();
+
+    bool IsOpen() const { return mFd >= 0; }
+
+    // ReadBlocks waits at most timeoutMs for a ready block, then consumes ready blocks until maxPackets
+    // packets are processed. Blocks are consumed as a whole.
+    // @return packets processed, < 0 error
+    int32_t ReadBlocks(int32_t maxPackets, int32_t timeoutMs, const PacketCallback& callback);
+
+    // WalkBlock hands every packet in the block to the callback and returns the number of packets.
+    static uint32_t WalkBlock(const tpacket_block_desc* block, const PacketCallback& callback);
+
+    const std::string& GetErrorMessage() const { return mErrMsg; }
+
+    uint64_t GetDropCount() const { return mDropCount; }
+
+private:
+    bool SetError(const std::string& msg);
+
+    int mFd = -1;
+    int mIfIndex = 0;
+    uint8_t* mRing = nullptr;
+    size_t mRingSize = 0;
+    uint32_t mBlockSize = 0;
+    uint32_t mBlockCount = 0;
+    uint32_t mCurrentBlock = 0;
+    uint64_t mDropCount = 0;
+    std::string mErrMsg;
+};
+
+} // namespace logtail
@@ -0,0 +1,280 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "DelimiterModeBitmaskParser.h"
+#include <cstring>
+#if defined(__x86_64__) || defined(_M_X64)
+#define LOGTAIL_DELIMITER_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define LOGTAIL_DELIMITER_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__)
+#define LOGTAIL_DELIMITER_NEON
+#include <arm_neon.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace logtail {
+
+namespace {
+
+    const int32_t kBlockSize = 64;
+
+    inline uint32_t CountTrailingZero64(uint64_t mask) {
+#if defined(_MSC_VER)
+        unsigned long idx = 0;
+        _BitScanForward64(&idx, mask);
+        return static_cast<uint32_t>(idx);
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(mask));
+#endif
+    }
+
+    inline uint32_t PopCount64(uint64_t mask) {
+#if defined(_MSC_VER)
+        return static_cast<uint32_t>(__popcnt64(mask));
+#else
+        return static_cast<uint32_t>(__builtin_popcountll(mask));
+#endif
+    }
+
+    // PrefixXor sets bit i to the parity of bits [0, i] of @mask, so bits between an
+    // opening quote (inclusive) and its closing quote (exclusive) are set.
+    inline uint64_t PrefixXor(uint64_t mask) {
+        mask ^= mask << 1;
+        mask ^= mask << 2;
+        mask ^= mask << 4;
+        mask ^= mask << 8;
+        mask ^= mask << 16;
+        mask ^= mask << 32;
+        return mask;
+    }
+
+    // BlockMaskFunc sets bit i of @quoteMask/@separatorMask if block[i] is quote/separator,
+    // @block must have kBlockSize readable bytes.
+    typedef void (*BlockMaskFunc)(
+        const char* block, char quote, char separator, uint64_t& quoteMask, uint64_t& separatorMask);
+
+    struct BlockScanner {
+        const char* name;
+        BlockMaskFunc buildMasks;
+    };
+
+#if !defined(LOGTAIL_DELIMITER_SSE2) && !defined(LOGTAIL_DELIMITER_NEON)
+    void BuildMasksScalar(const char* block, char quote, char separator, uint64_t& quoteMask, uint64_t& separatorMask) {
+        quoteMask = 0;
+        separatorMask = 0;
+        for (int32_t i = 0; i < kBlockSize; ++i) {
+            quoteMask |= static_cast<uint64_t>(block[i] == quote) << i;
+            separatorMask |= static_cast<uint64_t>(block[i] == separator) << i;
+        }
+    }
+#endif
+
+#if defined(LOGTAIL_DELIMITER_SSE2)
+    void BuildMasksSSE2(const char* block, char quote, char separator, uint64_t& quoteMask, uint64_t& separatorMask) {
+        const __m128i q = _mm_set1_epi8(quote);
+        const __m128i s = _mm_set1_epi8(separator);
+        quoteMask = 0;
+        separatorMask = 0;
+        for (int32_t i = 0; i < kBlockSize; i += 16) {
+            __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+            quoteMask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data, q))))
+                << i;
+            separatorMask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data, s))))
+                << i;
+        }
+    }
+#endif
+
+#if defined(LOGTAIL_DELIMITER_AVX2)
+    __attribute__((target("avx2"))) void
+    BuildMasksAVX2(const char* block, char quote, char separator, uint64_t& quoteMask, uint64_t& separatorMask) {
+        const __m256i q = _mm256_set1_epi8(quote);
+        const __m256i s = _mm256_set1_epi8(separator);
+        __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+        quoteMask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, q)))
+            | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, q)))) << 32;
+        separatorMask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, s)))
+            | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, s)))) << 32;
+    }
+#endif
+
+#if defined(LOGTAIL_DELIMITER_NEON)
+    // NEON has no movemask, weight each byte of compare results by its bit and add pairwise.
+    inline uint64_t NeonMask64(uint8x16_t c0, uint8x16_t c1, uint8x16_t c2, uint8x16_t c3) {
+        const uint8x16_t weight
+            = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+        uint8x16_t sum0 = vpaddq_u8(vandq_u8(c0, weight), vandq_u8(c1, weight));
+        uint8x16_t sum1 = vpaddq_u8(vandq_u8(c2, weight), vandq_u8(c3, weight));
+        sum0 = vpaddq_u8(sum0, sum1);
+        sum0 = vpaddq_u8(sum0, sum0);
+        return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
+    }
+
+    void BuildMasksNEON(const char* block, char quote, char separator, uint64_t& quoteMask, uint64_t& separatorMask) {
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(block);
+        const uint8x16_t q = vdupq_n_u8(static_cast<uint8_t>(quote));
+        const uint8x16_t s = vdupq_n_u8(static_cast<uint8_t>(separator));
+        uint8x16_t d0 = vld1q_u8(data);
+        uint8x16_t d1 = vld1q_u8(data + 16);
+        uint8x16_t d2 = vld1q_u8(data + 32);
+        uint8x16_t d3 = vld1q_u8(data + 48);
+        quoteMask = NeonMask64(vceqq_u8(d0, q), vceqq_u8(d1, q), vceqq_u8(d2, q), vceqq_u8(d3, q));
+        separatorMask = NeonMask64(vceqq_u8(d0, s), vceqq_u8(d1, s), vceqq_u8(d2, s), vceqq_u8(d3, s));
+    }
+#endif
+
+    BlockScanner SelectBlockScanner() {
+#if defined(LOGTAIL_DELIMITER_AVX2)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return BlockScanner{"avx2", BuildMasksAVX2};
+        }
+#endif
+#if defined(LOGTAIL_DELIMITER_SSE2)
+        return BlockScanner{"sse2", BuildMasksSSE2};
+#elif defined(LOGTAIL_DELIMITER_NEON)
+        return BlockScanner{"neon", BuildMasksNEON};
+#else
+        return BlockScanner{"scalar", BuildMasksScalar};
+#endif
+    }
+
+    const BlockScanner& GetBlockScanner() {
+        static const BlockScanner sScanner = SelectBlockScanner();
+        return sScanner;
+    }
+
+} // namespace
+
+DelimiterModeBitmaskParser::DelimiterModeBitmaskParser(char quote, char separator)
+    : mQuote(quote), mSeparator(separator) {
+}
+
+bool DelimiterModeBitmaskParser::ParseDelimiterLine(const char* buffer,
+                                                    int32_t begin,
+                                                    int32_t end,
+                                                    std::vector<DelimiterColumnSpan>& columns) const {
+    const BlockMaskFunc buildMasks = GetBlockScanner().buildMasks;
+    // All ones if the previous block ends inside quotes.
+    uint64_t insideCarry = 0;
+    int32_t columnBegin = begin;
+    uint32_t quoteCount = 0;
+    for (int32_t blockBegin = begin; blockBegin < end; blockBegin += kBlockSize) {
+        uint64_t quoteMask = 0;
+        uint64_t separatorMask = 0;
+        const int32_t blockSize = end - blockBegin;
+        if (blockSize >= kBlockSize) {
+            buildMasks(buffer + blockBegin, mQuote, mSeparator, quoteMask, separatorMask);
+        } else {
+            char tail[kBlockSize];
+            memcpy(tail, buffer + blockBegin, blockSize);
+            memset(tail + blockSize, 0, kBlockSize - blockSize);
+            buildMasks(tail, mQuote, mSeparator, quoteMask, separatorMask);
+            const uint64_t validMask = (1ULL << blockSize) - 1;
+            quoteMask &= validMask;
+            separatorMask &= validMask;
+        }
+
+        const uint64_t insideMask = PrefixXor(quoteMask) ^ insideCarry;
+        insideCarry = static_cast<uint64_t>(static_cast<int64_t>(insideMask) >> 63);
+        uint64_t columnEnds = separatorMask & ~insideMask;
+        // Bits of this block belonging to emitted columns.
+        uint64_t consumedMask = 0;
+        while (columnEnds != 0) {
+            const uint32_t bit = CountTrailingZero64(columnEnds);
+            const uint64_t belowMask = (1ULL << bit) - 1;
+            quoteCount += PopCount64(quoteMask & belowMask & ~consumedMask);
+            const int32_t columnEnd = blockBegin + static_cast<int32_t>(bit);
+            if (!AddColumn(buffer, columnBegin, columnEnd, quoteCount, columns)) {
+                columns.clear();
+                return false;
+            }
+            columnBegin = columnEnd + 1;
+            quoteCount = 0;
+            consumedMask = belowMask | (1ULL << bit);
+            columnEnds &= columnEnds - 1;
+        }
+        quoteCount += PopCount64(quoteMask & ~consumedMask);
+    }
+    // Unclosed quote.
+    if (insideCarry != 0 || !AddColumn(buffer, columnBegin, end, quoteCount, columns)) {
+        columns.clear();
+        return false;
+    }
+    return true;
+}
+
+bool DelimiterModeBitmaskParser::AddColumn(const char* buffer,
+                                           int32_t begin,
+                                           int32_t end,
+                                           uint32_t quoteCount,
+                                           std::vector<DelimiterColumnSpan>& columns) const {
+    if (quoteCount == 0) {
+        columns.push_back(DelimiterColumnSpan{begin, end - begin, false});
+        return true;
+    }
+    // Quote is only allowed to wrap the whole column.
+    if (buffer[begin] != mQuote || end - begin < 2 || buffer[end - 1] != mQuote) {
+        return false;
+    }
+    if (quoteCount == 2) {
+        columns.push_back(DelimiterColumnSpan{begin + 1, end - begin - 2, false});
+        return true;
+    }
+    // Quotes inside must be doubled.
+    for (int32_t i = begin + 1; i < end - 1; ++i) {
+        if (buffer[i] == mQuote) {
+            if (i + 1 >= end - 1 || buffer[i + 1] != mQuote) {
+                return false;
+            }
+            ++i;
+        }
+    }
+    columns.push_back(DelimiterColumnSpan{begin + 1, end - begin - 2, true});
+    return true;
+}
+
+void DelimiterModeBitmaskParser::AppendColumnValue(const char* buffer,
+                                                   const DelimiterColumnSpan& column,
+                                                   std::string& value) const {
+    const char* cur = buffer + column.begin;
+    const char* end = cur + column.length;
+    if (!column.escaped) {
+        value.append(cur, end);
+        return;
+    }
+    while (cur < end) {
+        const char* quote = static_cast<const char*>(memchr(cur, mQuote, end - cur));
+        if (quote == NULL) {
+            value.append(cur, end);
+            break;
+        }
+        // Keep one of the doubled quotes.
+        value.append(cur, quote + 1);
+        cur = quote + 2;
+    }
+}
+
+const char* DelimiterModeBitmaskParser::GetBlockScannerName() {
+    return GetBlockScanner().name;
+}
+
+} // namespace logtail
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace logtail {
+
+// DelimiterColumnSpan locates a column value in the parsed buffer, surrounding
+// quotes of quoted column are excluded.
+struct DelimiterColumnSpan {
+    int32_t begin;
+    int32_t length;
+    // escaped is true if value contains doubled quotes, use AppendColumnValue to get it.
+    bool escaped;
+};
+
+// DelimiterModeBitmaskParser accepts the same syntax as DelimiterModeFsmParser.
+// Instead of walking the FSM for each char, it builds quote and separator bitmasks
+// for 64 bytes at a time (AVX2/SSE2/NEON/scalar selected at runtime), marks quoted
+// regions by prefix-XOR of the quote mask, and emits a column for each separator
+// outside of quotes. Columns are returned as spans of the buffer, values are only
+// copied when they contain escaped quotes.
+class DelimiterModeBitmaskParser {
+public:
+    DelimiterModeBitmaskParser(char quote, char separator);
+
+    // ParseDelimiterLine appends columns of [@begin, @end) of @buffer to @columns.
+    // @return false if line is malformed, @columns is cleared.
+    bool ParseDelimiterLine(const char* buffer,
+                            int32_t begin,
+                            int32_t end,
+                            std::vector<DelimiterColumnSpan>& columns) const;
+
+    // AppendColumnValue appends unescaped value of @column to @value.
+    void AppendColumnValue(const char* buffer, const DelimiterColumnSpan& column, std::string& value) const;
+
+    // GetBlockScannerName returns the name of selected implementation:
+    // avx2, sse2, neon or scalar.
+    static const char* GetBlockScannerName();
+
+private:
+    bool AddColumn(const char* buffer,
+                   int32_t begin,
+                   int32_t end,
+                   uint32_t quoteCount,
+                   std::vector<DelimiterColumnSpan>& columns) const;
+
+    const char mQuote;
+    const char mSeparator;
+};
+
+} // namespace logtail
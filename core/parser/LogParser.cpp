@@ -15,6 +15,7 @@
 #include "LogParser.h"
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
 #include <vector>
 #include <regex>
 #include "common/StringTools.h"
@@ -33,10 +34,11 @@ using namespace sls_logs;
 
 namespace logtail {
 
-static const char* SLS_KEY_LEVEL = "__LEVEL__";
-static const char* SLS_KEY_THREAD = "__THREAD__";
-static const char* SLS_KEY_FILE = "__FILE__";
-static const char* SLS_KEY_LINE = "__LINE__";
+// Keys are strings to avoid building temporary ones for each log.
+static const std::string SLS_KEY_LEVEL = "__LEVEL__";
+static const std::string SLS_KEY_THREAD = "__THREAD__";
+static const std::string SLS_KEY_FILE = "__FILE__";
+static const std::string SLS_KEY_LINE = "__LINE__";
 static const int32_t MAX_BASE_FIELD_NUM = 10;
 const char* LogParser::UNMATCH_LOG_KEY = "__raw_log__";
 
@@ -64,6 +66,45 @@ bool LogParser::IsPrefixString(const char* all, const string& prefix) {
     return true;
 }
 
+// Size of 'YYYY-mm-dd HH:MM:SS' and 'YYYY-mm-dd HH:MM:' in apsara log time.
+static const size_t APSARA_DATE_SIZE = 19;
+static const size_t APSARA_MINUTE_SIZE = 17;
+
+// ParseTwoDigits returns the value of two decimal digits at @buffer, or -1 if they are not digits.
+static int32_t ParseTwoDigits(const char* buffer) {
+    if (buffer[0] < '0' || buffer[0] > '9' || buffer[1] < '0' || buffer[1] > '9') {
+        return -1;
+    }
+    return (buffer[0] - '0') * 10 + (buffer[1] - '0');
+}
+
+// ParseApsaraMicroPart parses the fraction after '.' of apsara log time, at most 6 chars before ']' are
+// used and padded with '0', like '819' is 819000.
+static int32_t ParseApsaraMicroPart(const char* buffer) {
+    int32_t size = 0;
+    while (size < 6 && buffer[size] && buffer[size] != ']') {
+        ++size;
+    }
+    int32_t value = 0;
+    for (int32_t i = 0; i < 6; ++i) {
+        char c = i < size ? buffer[i] : '0';
+        if (c < '0' || c > '9') {
+            break;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+// GetApsaraDateMicroTime returns the micro part of '[YYYY-mm-dd HH:MM:SS.micro]' without scanning the line
+// again, and falls back to GetApsaraLogMicroTime if the fraction is not right after the date.
+static int32_t GetApsaraDateMicroTime(const char* dateBuffer, const char* buffer) {
+    if (dateBuffer[APSARA_DATE_SIZE] == '.') {
+        return ParseApsaraMicroPart(dateBuffer + APSARA_DATE_SIZE + 1);
+    }
+    return LogParser::GetApsaraLogMicroTime(buffer);
+}
+
 time_t
 LogParser::ApsaraEasyReadLogTimeParser(const char* buffer, string& timeStr, time_t& lastLogTime, int64_t& microTime) {
     int beg_index = 0;
@@ -96,23 +137,37 @@ LogParser::ApsaraEasyReadLogTimeParser(const char* buffer, string& timeStr, time
     }
     // test other date format case
     {
-        if (IsPrefixString(buffer + beg_index + 1, timeStr) == true) {
-            microTime = (int64_t)lastLogTime * 1000000 + GetApsaraLogMicroTime(buffer);
-            return lastLogTime;
+        // timeStr is the cached 'YYYY-mm-dd HH:MM:SS' of lastLogTime, logs of the same second reuse it
+        // and logs of the same minute only add the difference of seconds, strptime is skipped for both.
+        const char* dateBuffer = buffer + beg_index + 1;
+        if (timeStr.size() == APSARA_DATE_SIZE && strncmp(dateBuffer, timeStr.data(), APSARA_MINUTE_SIZE) == 0) {
+            if (dateBuffer[APSARA_MINUTE_SIZE] == timeStr[APSARA_MINUTE_SIZE]
+                && dateBuffer[APSARA_MINUTE_SIZE + 1] == timeStr[APSARA_MINUTE_SIZE + 1]) {
+                microTime = (int64_t)lastLogTime * 1000000 + GetApsaraDateMicroTime(dateBuffer, buffer);
+                return lastLogTime;
+            }
+            int32_t second = ParseTwoDigits(dateBuffer + APSARA_MINUTE_SIZE);
+            if (second >= 0 && second < 60) {
+                lastLogTime += second - ParseTwoDigits(timeStr.data() + APSARA_MINUTE_SIZE);
+                timeStr[APSARA_MINUTE_SIZE] = dateBuffer[APSARA_MINUTE_SIZE];
+                timeStr[APSARA_MINUTE_SIZE + 1] = dateBuffer[APSARA_MINUTE_SIZE + 1];
+                microTime = (int64_t)lastLogTime * 1000000 + GetApsaraDateMicroTime(dateBuffer, buffer);
+                return lastLogTime;
+            }
         }
         struct tm tm;
         memset(&tm, 0, sizeof(tm));
-        if (NULL == strptime(buffer + beg_index + 1, "%Y-%m-%d %H:%M:%S", &tm)) {
+        if (NULL == FastStrptime(buffer + beg_index + 1, "%Y-%m-%d %H:%M:%S", &tm)
+            && NULL == strptime(buffer + beg_index + 1, "%Y-%m-%d %H:%M:%S", &tm)) {
             LOG_WARNING(sLogger,
                         ("parse apsara log time", "fail")("string", buffer)("timeformat", "%Y-%m-%d %H:%M:%S"));
             return 0;
         }
-        tm.tm_isdst = -1;
-        lastLogTime = mktime(&tm);
+        lastLogTime = MakeLocalTime(tm);
         // if the time is valid (strptime not return NULL), the date value size must be 19 ,like '2013-09-11 03:11:05'
-        timeStr = string(buffer + beg_index + 1, 19);
+        timeStr.assign(dateBuffer, APSARA_DATE_SIZE);
 
-        microTime = (int64_t)lastLogTime * 1000000 + GetApsaraLogMicroTime(buffer);
+        microTime = (int64_t)lastLogTime * 1000000 + GetApsaraDateMicroTime(dateBuffer, buffer);
         return lastLogTime;
     }
 }
@@ -120,7 +175,7 @@ LogParser::ApsaraEasyReadLogTimeParser(const char* buffer, string& timeStr, time
 void LogParser::AddUnmatchLog(const char* buffer, sls_logs::LogGroup& logGroup, uint32_t& logGroupSize) {
     Log* logPtr = logGroup.add_logs();
     logPtr->set_time(time(NULL));
-    AddLog(logPtr, UNMATCH_LOG_KEY, buffer, logGroupSize);
+    AddLog(logPtr, UNMATCH_LOG_KEY, strlen(UNMATCH_LOG_KEY), buffer, strlen(buffer), logGroupSize);
 }
 
 #if defined(_MSC_VER)
@@ -159,7 +214,8 @@ static bool StdRegexLogLineParser(const char* buffer,
                                   const string& logPath,
                                   ParseLogError& error,
                                   uint32_t& logGroupSize,
-                                  int32_t tzOffsetSecond) {
+                                  int32_t tzOffsetSecond,
+                                  const vector<bool>* keptKeys) {
     std::regex stdReg;
     std::string exception;
     try {
@@ -185,12 +241,10 @@ static bool StdRegexLogLineParser(const char* buffer,
                               ("parse regex log fail", buffer)("exception", exception)("project", projectName)(
                                   "logstore", category)("file", logPath));
                 }
-                LogtailAlarm::GetInstance()->SendAlarm(REGEX_MATCH_ALARM,
-                                                       "errorlog:" + string(buffer)
-                                                           + " | exception:" + string(exception),
-                                                       projectName,
-                                                       category,
-                                                       region);
+                LogtailAlarm::GetInstance()->CountAlarm(
+                    REGEX_MATCH_ALARM, projectName, category, region, [buffer, &exception]() {
+                        return "errorlog:" + string(buffer) + " | exception:" + string(exception);
+                    });
             }
         } else {
             if (AppConfig::GetInstance()->IsLogParseAlarmValid()) {
@@ -199,8 +253,10 @@ static bool StdRegexLogLineParser(const char* buffer,
                                 ("parse regex log fail", buffer)("project", projectName)("logstore",
                                                                                          category)("file", logPath));
                 }
-                LogtailAlarm::GetInstance()->SendAlarm(
-                    REGEX_MATCH_ALARM, "errorlog:" + string(buffer), projectName, category, region);
+                LogtailAlarm::GetInstance()->CountAlarm(
+                    REGEX_MATCH_ALARM, projectName, category, region, [buffer]() {
+                        return "errorlog:" + string(buffer);
+                    });
             }
         }
         error = PARSE_LOG_REGEX_ERROR;
@@ -212,12 +268,10 @@ static bool StdRegexLogLineParser(const char* buffer,
                             ("parse key count not match", match.size())("parse regex log fail", buffer)(
                                 "project", projectName)("logstore", category)("file", logPath));
             }
-            LogtailAlarm::GetInstance()->SendAlarm(REGEX_MATCH_ALARM,
-                                                   "parse key count not match" + ToString(match.size() - 1)
-                                                       + "errorlog:" + string(buffer),
-                                                   projectName,
-                                                   category,
-                                                   region);
+            LogtailAlarm::GetInstance()->CountAlarm(
+                REGEX_MATCH_ALARM, projectName, category, region, [&]() {
+                    return "parse key count not match" + ToString(match.size() - 1) + "errorlog:" + string(buffer);
+                });
         }
 
         error = PARSE_LOG_REGEX_ERROR;
@@ -243,13 +297,16 @@ static bool StdRegexLogLineParser(const char* buffer,
 
     if (parseSuccess) {
         Log* logPtr = logGroup.add_logs();
-        logPtr->set_time(logTime);
+        logPtr->set_time(logTime - tzOffsetSecond);
         if (preciseTimestampConfig.enabled) {
             LogParser::AddLog(logPtr, preciseTimestampConfig.key, std::to_string(preciseTimestamp), logGroupSize);
         }
 
         for (uint32_t i = 0; i < keys.size(); i++) {
-            LogParser::AddLog(logPtr, keys[i], match[i + 1].str(), logGroupSize);
+            if (keptKeys != NULL && !(*keptKeys)[i]) {
+                continue;
+            }
+            LogParser::AddLog(logPtr, keys[i], match[i + 1].first, match[i + 1].length(), logGroupSize);
         }
         return true;
     } else if (!discardUnmatch) {
@@ -260,6 +317,39 @@ static bool StdRegexLogLineParser(const char* buffer,
 }
 #endif
 
+// RegexMatchCaptures matches the whole @buffer with @re2Reg if it is not NULL, otherwise
+// with @reg. Captured groups (0 is the whole match) are stored into @captures as views of
+// @buffer, unmatched groups are empty.
+static bool RegexMatchCaptures(const char* buffer,
+                               const boost::regex& reg,
+                               const re2::RE2* re2Reg,
+                               string& exception,
+                               vector<re2::StringPiece>& captures) {
+    if (re2Reg != NULL) {
+        re2::StringPiece text(buffer);
+        captures.resize(re2Reg->NumberOfCapturingGroups() + 1);
+        if (!re2Reg->Match(text, 0, text.size(), re2::RE2::ANCHOR_BOTH, captures.data(), captures.size())) {
+            return false;
+        }
+        for (auto& capture : captures) {
+            if (capture.data() == NULL) {
+                capture = re2::StringPiece(buffer, 0);
+            }
+        }
+        return true;
+    }
+
+    boost::match_results<const char*> what;
+    if (!BoostRegexMatch(buffer, reg, exception, what, boost::match_default)) {
+        return false;
+    }
+    captures.resize(what.size());
+    for (size_t i = 0; i < what.size(); ++i) {
+        captures[i] = what[i].matched ? re2::StringPiece(what[i].first, what[i].length()) : re2::StringPiece(buffer, 0);
+    }
+    return true;
+}
+
 bool LogParser::RegexLogLineParser(const char* buffer,
                                    const boost::regex& reg,
                                    LogGroup& logGroup,
@@ -277,31 +367,35 @@ bool LogParser::RegexLogLineParser(const char* buffer,
                                    const string& logPath,
                                    ParseLogError& error,
                                    uint32_t& logGroupSize,
-                                   int32_t tzOffsetSecond) {
-    boost::match_results<const char*> what;
+                                   int32_t tzOffsetSecond,
+                                   const re2::RE2* re2Reg,
+                                   const vector<bool>* keptKeys) {
+    vector<re2::StringPiece> captures;
     string exception;
     uint64_t preciseTimestamp = 0;
     bool parseSuccess = true;
-    if (!BoostRegexMatch(buffer, reg, exception, what, boost::match_default)) {
+    if (!RegexMatchCaptures(buffer, reg, re2Reg, exception, captures)) {
 #if defined(_MSC_VER) // Try std::regex on Windows.
-        return StdRegexLogLineParser(buffer,
-                                     reg.str(),
-                                     logGroup,
-                                     discardUnmatch,
-                                     keys,
-                                     category,
-                                     timeFormat,
-                                     preciseTimestampConfig,
-                                     timeIndex,
-                                     timeStr,
-                                     logTime,
-                                     specifiedYear,
-                                     projectName,
-                                     region,
-                                     logPath,
-                                     error,
-                                     logGroupSize,
-                                     tzOffsetSecond);
+        if (re2Reg == NULL)
+            return StdRegexLogLineParser(buffer,
+                                         reg.str(),
+                                         logGroup,
+                                         discardUnmatch,
+                                         keys,
+                                         category,
+                                         timeFormat,
+                                         preciseTimestampConfig,
+                                         timeIndex,
+                                         timeStr,
+                                         logTime,
+                                         specifiedYear,
+                                         projectName,
+                                         region,
+                                         logPath,
+                                         error,
+                                         logGroupSize,
+                                         tzOffsetSecond,
+                                         keptKeys);
 #endif
 
         if (!exception.empty()) {
@@ -311,12 +405,10 @@ bool LogParser::RegexLogLineParser(const char* buffer,
                               ("parse regex log fail", buffer)("exception", exception)("project", projectName)(
                                   "logstore", category)("file", logPath));
                 }
-                LogtailAlarm::GetInstance()->SendAlarm(REGEX_MATCH_ALARM,
-                                                       "errorlog:" + string(buffer)
-                                                           + " | exception:" + string(exception),
-                                                       projectName,
-                                                       category,
-                                                       region);
+                LogtailAlarm::GetInstance()->CountAlarm(
+                    REGEX_MATCH_ALARM, projectName, category, region, [buffer, &exception]() {
+                        return "errorlog:" + string(buffer) + " | exception:" + string(exception);
+                    });
             }
         } else {
             if (AppConfig::GetInstance()->IsLogParseAlarmValid()) {
@@ -325,25 +417,25 @@ bool LogParser::RegexLogLineParser(const char* buffer,
                                 ("parse regex log fail", buffer)("project", projectName)("logstore",
                                                                                          category)("file", logPath));
                 }
-                LogtailAlarm::GetInstance()->SendAlarm(
-                    REGEX_MATCH_ALARM, "errorlog:" + string(buffer), projectName, category, region);
+                LogtailAlarm::GetInstance()->CountAlarm(
+                    REGEX_MATCH_ALARM, projectName, category, region, [buffer]() {
+                        return "errorlog:" + string(buffer);
+                    });
             }
         }
         error = PARSE_LOG_REGEX_ERROR;
         parseSuccess = false;
-    } else if (what.size() <= keys.size()) {
+    } else if (captures.size() <= keys.size()) {
         if (AppConfig::GetInstance()->IsLogParseAlarmValid()) {
             if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
                 LOG_WARNING(sLogger,
-                            ("parse key count not match", what.size())("parse regex log fail", buffer)(
+                            ("parse key count not match", captures.size())("parse regex log fail", buffer)(
                                 "project", projectName)("logstore", category)("file", logPath));
             }
-            LogtailAlarm::GetInstance()->SendAlarm(REGEX_MATCH_ALARM,
-                                                   "parse key count not match" + ToString(what.size())
-                                                       + "errorlog:" + string(buffer),
-                                                   projectName,
-                                                   category,
-                                                   region);
+            LogtailAlarm::GetInstance()->CountAlarm(
+                REGEX_MATCH_ALARM, projectName, category, region, [&]() {
+                    return "parse key count not match" + ToString(captures.size()) + "errorlog:" + string(buffer);
+                });
         }
 
         error = PARSE_LOG_REGEX_ERROR;
@@ -352,7 +444,7 @@ bool LogParser::RegexLogLineParser(const char* buffer,
                              timeStr,
                              logTime,
                              preciseTimestamp,
-                             what[timeIndex + 1].str().c_str(),
+                             string(captures[timeIndex + 1].data(), captures[timeIndex + 1].size()),
                              timeFormat,
                              preciseTimestampConfig,
                              specifiedYear,
@@ -369,9 +461,12 @@ bool LogParser::RegexLogLineParser(const char* buffer,
 
     if (parseSuccess) {
         Log* logPtr = logGroup.add_logs();
-        logPtr->set_time(logTime);
+        logPtr->set_time(logTime - tzOffsetSecond);
         for (uint32_t i = 0; i < keys.size(); i++) {
-            AddLog(logPtr, keys[i], what[i + 1].str(), logGroupSize);
+            if (keptKeys != NULL && !(*keptKeys)[i]) {
+                continue;
+            }
+            AddLog(logPtr, keys[i], captures[i + 1].data(), captures[i + 1].size(), logGroupSize);
         }
         if (preciseTimestampConfig.enabled) {
             AddLog(logPtr, preciseTimestampConfig.key, std::to_string(preciseTimestamp), logGroupSize);
@@ -394,11 +489,13 @@ bool LogParser::RegexLogLineParser(const char* buffer,
                                    const string& region,
                                    const string& logPath,
                                    ParseLogError& error,
-                                   uint32_t& logGroupSize) {
-    boost::match_results<const char*> what;
+                                   uint32_t& logGroupSize,
+                                   const re2::RE2* re2Reg,
+                                   const vector<bool>* keptKeys) {
+    vector<re2::StringPiece> captures;
     string exception;
     bool parseSuccess = true;
-    if (!BoostRegexMatch(buffer, reg, exception, what, boost::match_default)) {
+    if (!RegexMatchCaptures(buffer, reg, re2Reg, exception, captures)) {
         if (!exception.empty()) {
             if (AppConfig::GetInstance()->IsLogParseAlarmValid()) {
                 if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
@@ -406,12 +503,10 @@ bool LogParser::RegexLogLineParser(const char* buffer,
                               ("parse regex log fail", buffer)("exception", exception)("project", projectName)(
                                   "logstore", category)("file", logPath));
                 }
-                LogtailAlarm::GetInstance()->SendAlarm(REGEX_MATCH_ALARM,
-                                                       "errorlog:" + string(buffer)
-                                                           + " | exception:" + string(exception),
-                                                       projectName,
-                                                       category,
-                                                       region);
+                LogtailAlarm::GetInstance()->CountAlarm(
+                    REGEX_MATCH_ALARM, projectName, category, region, [buffer, &exception]() {
+                        return "errorlog:" + string(buffer) + " | exception:" + string(exception);
+                    });
             }
         } else {
             if (AppConfig::GetInstance()->IsLogParseAlarmValid()) {
@@ -420,27 +515,27 @@ bool LogParser::RegexLogLineParser(const char* buffer,
                                 ("parse regex log fail", buffer)("project", projectName)("logstore",
                                                                                          category)("file", logPath));
                 }
-                LogtailAlarm::GetInstance()->SendAlarm(
-                    REGEX_MATCH_ALARM, string("errorlog:") + string(buffer), projectName, category, region);
+                LogtailAlarm::GetInstance()->CountAlarm(
+                    REGEX_MATCH_ALARM, projectName, category, region, [buffer]() {
+                        return "errorlog:" + string(buffer);
+                    });
             }
         }
 
         error = PARSE_LOG_REGEX_ERROR;
         parseSuccess = false;
 
-    } else if (what.size() <= keys.size()) {
+    } else if (captures.size() <= keys.size()) {
         if (AppConfig::GetInstance()->IsLogParseAlarmValid()) {
             if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
                 LOG_WARNING(sLogger,
-                            ("parse key count not match", what.size())("parse regex log fail", buffer)(
+                            ("parse key count not match", captures.size())("parse regex log fail", buffer)(
                                 "project", projectName)("logstore", category)("file", logPath));
             }
-            LogtailAlarm::GetInstance()->SendAlarm(REGEX_MATCH_ALARM,
-                                                   "parse key count not match" + ToString(what.size())
-                                                       + "errorlog:" + string(buffer),
-                                                   projectName,
-                                                   category,
-                                                   region);
+            LogtailAlarm::GetInstance()->CountAlarm(
+                REGEX_MATCH_ALARM, projectName, category, region, [&]() {
+                    return "parse key count not match" + ToString(captures.size()) + "errorlog:" + string(buffer);
+                });
         }
 
         error = PARSE_LOG_REGEX_ERROR;
@@ -456,7 +551,10 @@ bool LogParser::RegexLogLineParser(const char* buffer,
     Log* logPtr = logGroup.add_logs();
     logPtr->set_time(logTime); // current system time, no need history check
     for (uint32_t i = 0; i < keys.size(); i++) {
-        AddLog(logPtr, keys[i], what[i + 1].str(), logGroupSize);
+        if (keptKeys != NULL && !(*keptKeys)[i]) {
+            continue;
+        }
+        AddLog(logPtr, keys[i], captures[i + 1].data(), captures[i + 1].size(), logGroupSize);
     }
     return true;
 }
@@ -483,8 +581,15 @@ bool LogParser::ParseLogTime(const char* buffer,
         // NOTE: This method can only work until 2286/11/21 1:46:39 (9999999999).
         bool keepTimeStr = (strcmp("%s", timeFormat) != 0);
         const char* strptimeResult = NULL;
+        // Fixed width formats are parsed without strptime, and the parsed part of time
+        // string is cached directly instead of formatting the time again.
+        bool fixedWidth = false;
         if (keepTimeStr) {
-            strptimeResult = Strptime(curTimeStr.c_str(), timeFormat, &tm, specifiedYear);
+            strptimeResult = FastStrptime(curTimeStr.c_str(), timeFormat, &tm);
+            fixedWidth = strptimeResult != NULL;
+            if (!fixedWidth) {
+                strptimeResult = Strptime(curTimeStr.c_str(), timeFormat, &tm, specifiedYear);
+            }
         } else {
             strptimeResult = Strptime(curTimeStr.substr(0, 10).c_str(), timeFormat, &tm);
         }
@@ -495,20 +600,21 @@ bool LogParser::ParseLogTime(const char* buffer,
                                 ("parse time fail", curTimeStr)("project", projectName)("logstore", category)(
                                     "file", logPath)("keep time str", keepTimeStr));
                 }
-                LogtailAlarm::GetInstance()->SendAlarm(PARSE_TIME_FAIL_ALARM,
-                                                       curTimeStr + " " + timeFormat
-                                                           + " flag: " + std::to_string(keepTimeStr),
-                                                       projectName,
-                                                       category,
-                                                       region);
+                LogtailAlarm::GetInstance()->CountAlarm(
+                    PARSE_TIME_FAIL_ALARM, projectName, category, region, [&]() {
+                        return curTimeStr + " " + timeFormat + " flag: " + std::to_string(keepTimeStr);
+                    });
             }
 
             error = PARSE_LOG_TIMEFORMAT_ERROR;
             return false;
         }
-        tm.tm_isdst = -1;
-        logTime = mktime(&tm);
-        timeStr = ConvertToTimeStamp(logTime, timeFormat);
+        logTime = MakeLocalTime(tm);
+        if (fixedWidth) {
+            timeStr.assign(curTimeStr.c_str(), strptimeResult - curTimeStr.c_str());
+        } else {
+            timeStr = ConvertToTimeStamp(logTime, timeFormat);
+        }
 
         if (preciseTimestampConfig.enabled) {
             preciseTimestamp = GetPreciseTimestamp(logTime, strptimeResult, preciseTimestampConfig, tzOffsetSecond);
@@ -528,8 +634,9 @@ bool LogParser::ParseLogTime(const char* buffer,
                             ("discard history data", buffer)("timestamp", logTime)("project", projectName)(
                                 "logstore", category)("file", logPath));
             }
-            LogtailAlarm::GetInstance()->SendAlarm(
-                OUTDATED_LOG_ALARM, string("logTime: ") + ToString(logTime), projectName, category, region);
+            LogtailAlarm::GetInstance()->CountAlarm(OUTDATED_LOG_ALARM, projectName, category, region, [logTime]() {
+                return string("logTime: ") + ToString(logTime);
+            });
         }
         error = PARSE_LOG_HISTORY_ERROR;
         return false;
@@ -541,35 +648,13 @@ bool LogParser::WholeLineModeParser(
     const char* buffer, LogGroup& logGroup, const string& key, time_t logTime, uint32_t& logGroupSize) {
     Log* logPtr = logGroup.add_logs();
     logPtr->set_time(logTime); // current system time, no need history check
-    AddLog(logPtr, key, buffer, logGroupSize);
+    AddLog(logPtr, key, buffer, strlen(buffer), logGroupSize);
     return true;
 }
 
 int32_t LogParser::GetApsaraLogMicroTime(const char* buffer) {
-    int begIndex = 0;
-    char tmp [6];   
-    while (buffer[begIndex]) {
-        if (buffer[begIndex] == '.') {
-            begIndex++;
-            break;
-        }
-        begIndex++;
-    }   
-    int index = 0;
-    while(buffer[begIndex + index] && index <6) {
-        if (buffer[begIndex + index] == ']'){
-            break;
-        }
-        tmp[index] = buffer[begIndex + index];
-        index ++;
-    }
-    if (index < 6) {
-        for (int i = index; i < 6; i ++) {
-            tmp[i] = '0';
-        }
-    }
-    char* endPtr;
-    return strtol(tmp, &endPtr, 10);
+    const char* dot = strchr(buffer, '.');
+    return ParseApsaraMicroPart(dot != NULL ? dot + 1 : buffer + strlen(buffer));
 }
 
 
@@ -641,17 +726,17 @@ static int32_t ParseApsaraBaseFields(const char* buffer, Log* logPtr, uint32_t&
         endIndex = endIndexArray[i];
         if ((findFieldBitMap & 0x1) == 0 && IsFieldLevel(buffer, beginIndex, endIndex)) {
             findFieldBitMap |= 0x1;
-            LogParser::AddLog(logPtr, SLS_KEY_LEVEL, string(buffer + beginIndex, endIndex - beginIndex), logGroupSize);
+            LogParser::AddLog(logPtr, SLS_KEY_LEVEL, buffer + beginIndex, endIndex - beginIndex, logGroupSize);
         } else if ((findFieldBitMap & 0x10) == 0 && IsFieldThread(buffer, beginIndex, endIndex)) {
             findFieldBitMap |= 0x10;
-            LogParser::AddLog(logPtr, SLS_KEY_THREAD, string(buffer + beginIndex, endIndex - beginIndex), logGroupSize);
+            LogParser::AddLog(logPtr, SLS_KEY_THREAD, buffer + beginIndex, endIndex - beginIndex, logGroupSize);
         } else if ((findFieldBitMap & 0x100) == 0 && IsFieldFileLine(buffer, beginIndex, endIndex)) {
             findFieldBitMap |= 0x100;
             int32_t colonIndex = FindColonIndex(buffer, beginIndex, endIndex);
-            LogParser::AddLog(logPtr, SLS_KEY_FILE, string(buffer + beginIndex, colonIndex - beginIndex), logGroupSize);
+            LogParser::AddLog(logPtr, SLS_KEY_FILE, buffer + beginIndex, colonIndex - beginIndex, logGroupSize);
             if (colonIndex < endIndex) {
                 LogParser::AddLog(
-                    logPtr, SLS_KEY_LINE, string(buffer + colonIndex + 1, endIndex - colonIndex - 1), logGroupSize);
+                    logPtr, SLS_KEY_LINE, buffer + colonIndex + 1, endIndex - colonIndex - 1, logGroupSize);
             }
         }
     }
@@ -720,7 +805,7 @@ bool LogParser::ApsaraEasyReadLogLineParser(const char* buffer,
     }
 
     Log* logPtr = logGroup.add_logs();
-    logPtr->set_time(logTime);
+    logPtr->set_time(logTime - tzOffsetSecond);
     int32_t beg_index = 0;
     int32_t colon_index = -1;
     int32_t index = -1;
@@ -731,8 +816,10 @@ bool LogParser::ApsaraEasyReadLogLineParser(const char* buffer,
             if (buffer[index] == '\t' || buffer[index] == '\0') {
                 if (colon_index >= 0) {
                     AddLog(logPtr,
-                           string(buffer + beg_index, colon_index - beg_index),
-                           string(buffer + colon_index + 1, index - colon_index - 1),
+                           buffer + beg_index,
+                           colon_index - beg_index,
+                           buffer + colon_index + 1,
+                           index - colon_index - 1,
                            logGroupSize);
                     colon_index = -1;
                 }
@@ -745,13 +832,20 @@ bool LogParser::ApsaraEasyReadLogLineParser(const char* buffer,
     if (adjustApsaraMicroTimezone) {
         logTime_in_micro = (int64_t)logTime_in_micro - (int64_t)tzOffsetSecond * (int64_t) 1000000;
     }
-    char s_micro[20] = {0};
-#if defined(__linux__)
-    sprintf(s_micro, "%ld", logTime_in_micro);
-#elif defined(_MSC_VER)
-    sprintf(s_micro, "%lld", logTime_in_micro);
-#endif
-    AddLog(logPtr, "microtime", string(s_micro), logGroupSize);
+    // Digits are written backwards into a local buffer, no string is created for the value.
+    char s_micro[24];
+    char* microEnd = s_micro + sizeof(s_micro);
+    char* microBegin = microEnd;
+    uint64_t microAbs = logTime_in_micro < 0 ? 0 - (uint64_t)logTime_in_micro : (uint64_t)logTime_in_micro;
+    do {
+        *--microBegin = static_cast<char>('0' + microAbs % 10);
+        microAbs /= 10;
+    } while (microAbs > 0);
+    if (logTime_in_micro < 0) {
+        *--microBegin = '-';
+    }
+    static const string sMicroTimeKey = "microtime";
+    AddLog(logPtr, sMicroTimeKey, microBegin, microEnd - microBegin, logGroupSize);
     return true;
 }
 
@@ -762,6 +856,22 @@ void LogParser::AddLog(Log* logPtr, const string& key, const string& value, uint
     logGroupSize += key.size() + value.size() + 5;
 }
 
+void LogParser::AddLog(
+    Log* logPtr, const string& key, const char* value, size_t valueLen, uint32_t& logGroupSize) {
+    Log_Content* logContentPtr = logPtr->add_contents();
+    logContentPtr->set_key(key);
+    logContentPtr->set_value(value, valueLen);
+    logGroupSize += key.size() + valueLen + 5;
+}
+
+void LogParser::AddLog(
+    Log* logPtr, const char* key, size_t keyLen, const char* value, size_t valueLen, uint32_t& logGroupSize) {
+    Log_Content* logContentPtr = logPtr->add_contents();
+    logContentPtr->set_key(key, keyLen);
+    logContentPtr->set_value(value, valueLen);
+    logGroupSize += keyLen + valueLen + 5;
+}
+
 
 void LogParser::AdjustLogTime(sls_logs::Log* logPtr, int mLogTimeZoneOffsetSecond, int timeZoneOffsetSecond) {
     logPtr->set_time(logPtr->time() - mLogTimeZoneOffsetSecond + timeZoneOffsetSecond);
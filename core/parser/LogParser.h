@@ -17,7 +17,10 @@
 #pragma once
 #include <stdint.h>
 #include <boost/regex.hpp>
+#include <memory>
 #include <vector>
+#include <re2/re2.h>
+#include "common/RegexCache.h"
 #include "common/TimeUtil.h"
 #include "config_manager/ConfigManager.h"
 
@@ -29,11 +32,17 @@ class Log;
 namespace logtail {
 
 struct UserDefinedFormat {
-    boost::regex mReg;
+    RegexPtr mReg; // shared by readers with the same regex, see RegexCache
+    std::shared_ptr<re2::RE2> mRe2Reg; // used instead of mReg if not NULL
     std::vector<std::string> mKeys;
+    // Captures of mKeys[i] are not added if mKeptKeys[i] is false, empty means all are added.
+    std::vector<bool> mKeptKeys;
     bool mIsWholeLineMode;
-    UserDefinedFormat(const boost::regex& reg, const std::vector<std::string>& keys, bool isWholeLineMode)
-        : mReg(reg), mKeys(keys), mIsWholeLineMode(isWholeLineMode) {}
+    UserDefinedFormat(const RegexPtr& reg,
+                      const std::vector<std::string>& keys,
+                      bool isWholeLineMode,
+                      const std::shared_ptr<re2::RE2>& re2Reg = nullptr)
+        : mReg(reg), mRe2Reg(re2Reg), mKeys(keys), mIsWholeLineMode(isWholeLineMode) {}
 };
 
 enum ParseLogError {
@@ -74,6 +83,8 @@ public:
     // Log time parsing: use @timeIndex to decide which field should be considered
     // as log time, and @timeFormat is used to parse it (strptime). @timeStr and
     // @logTime is the parsed result in string and time_t format.
+    // If @re2Reg is not NULL, it is used to match instead of @reg.
+    // If @keptKeys is not NULL, captures of keys[i] are added only if (*keptKeys)[i] is true.
     static bool RegexLogLineParser(const char* buffer,
                                    const boost::regex& reg,
                                    sls_logs::LogGroup& logGroup,
@@ -91,7 +102,9 @@ public:
                                    const std::string& logPath,
                                    ParseLogError& error,
                                    uint32_t& logGroupSize,
-                                   int32_t mTzOffsetSecond);
+                                   int32_t mTzOffsetSecond,
+                                   const re2::RE2* re2Reg = NULL,
+                                   const std::vector<bool>* keptKeys = NULL);
     // RegexLogLineParser with specified log time.
     static bool RegexLogLineParser(const char* buffer,
                                    const boost::regex& reg,
@@ -104,9 +117,21 @@ public:
                                    const std::string& region,
                                    const std::string& logPath,
                                    ParseLogError& error,
-                                   uint32_t& logGroupSize);
+                                   uint32_t& logGroupSize,
+                                   const re2::RE2* re2Reg = NULL,
+                                   const std::vector<bool>* keptKeys = NULL);
 
     static void AddLog(sls_logs::Log* logPtr, const std::string& key, const std::string& value, uint32_t& logGroupSize);
+    static void AddLog(
+        sls_logs::Log* logPtr, const std::string& key, const char* value, size_t valueLen, uint32_t& logGroupSize);
+    // Key and value are copied into the log directly, so parsers can pass pieces of the buffer without building
+    // strings first.
+    static void AddLog(sls_logs::Log* logPtr,
+                       const char* key,
+                       size_t keyLen,
+                       const char* value,
+                       size_t valueLen,
+                       uint32_t& logGroupSize);
 
     static int32_t GetApsaraLogMicroTime(const char* buffer);
 
@@ -13,9 +13,13 @@
 // limitations under the License.
 
 #include "LogtailPlugin.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
 //#include "LogtailPluginAdapter.h"
 #include "common/LogtailCommonFlags.h"
 #include "common/TimeUtil.h"
+#include "common/MemoryBudget.h"
 #include "logger/Logger.h"
 #include "config_manager/ConfigManager.h"
 #include "sender/Sender.h"
@@ -23,9 +27,15 @@
 #include "profiler/LogFileProfiler.h"
 #include "app_config/AppConfig.h"
 #include "common/DynamicLibHelper.h"
+#include "processor/NativeProcessor.h"
 using namespace std;
 using namespace logtail;
 
+DEFINE_FLAG_INT32(plugin_send_ring_size,
+                  "log groups sent by plugin are compressed by a separate thread through a ring of the size, "
+                  "0 to compress them in plugin threads",
+                  0);
+
 LogtailPlugin* LogtailPlugin::s_instance = NULL;
 
 LogtailPlugin::LogtailPlugin() {
@@ -36,6 +46,8 @@ LogtailPlugin::LogtailPlugin() {
     mResumeFun = NULL;
     mLoadGlobalConfigFun = NULL;
     mProcessRawLogFun = NULL;
+    mProcessRawLogV2Fun = NULL;
+    mProcessRawLogsV2Fun = NULL;
     mPluginValid = false;
     mPluginAlarmConfig.mCategory = "logtail_alarm";
     mPluginAlarmConfig.mAliuid = STRING_FLAG(logtail_profile_aliuid);
@@ -103,6 +115,10 @@ void LogtailPlugin::HoldOn(bool exitFlag) {
         LOG_INFO(sLogger, ("logtail plugin HoldOn", "start"));
         auto holdOnStart = GetCurrentTimeInMilliSeconds();
         mHoldOnFun(exitFlag ? 1 : 0);
+        // Configs may be removed after hold on, log groups of them must be in sender before.
+        if (mSendRing) {
+            mSendRing->WaitEmpty();
+        }
         auto holdOnCost = GetCurrentTimeInMilliSeconds() - holdOnStart;
         LOG_INFO(sLogger, ("logtail plugin HoldOn", "success")("cost", holdOnCost));
         if (holdOnCost >= 60 * 1000) {
@@ -190,10 +206,113 @@ void LogtailPlugin::ProcessRawLogV2(const std::string& configName,
     }
 }
 
+void LogtailPlugin::ProcessRawLogsV2(const std::string& configName, const std::vector<PluginRawLog>& rawLogs) {
+    if (!mPluginValid) {
+        return;
+    }
+    if (mProcessRawLogsV2Fun == NULL) {
+        for (const auto& rawLog : rawLogs) {
+            ProcessRawLogV2(configName, rawLog.rawLog, rawLog.rawLogSize, rawLog.packId, rawLog.topic, *rawLog.tags);
+        }
+        return;
+    }
+
+    std::vector<GoSlice> goRawLogs;
+    std::vector<GoString> goPackIds;
+    std::vector<GoString> goTopics;
+    std::vector<GoSlice> goTags;
+    goRawLogs.reserve(rawLogs.size());
+    goPackIds.reserve(rawLogs.size());
+    goTopics.reserve(rawLogs.size());
+    goTags.reserve(rawLogs.size());
+    for (const auto& rawLog : rawLogs) {
+        if (rawLog.rawLogSize <= 0) {
+            continue;
+        }
+        GoSlice goRawLog;
+        goRawLog.data = (void*)rawLog.rawLog;
+        goRawLog.len = goRawLog.cap = rawLog.rawLogSize - 1;
+        goRawLogs.push_back(goRawLog);
+        GoString goPackId;
+        goPackId.n = rawLog.packId.size();
+        goPackId.p = rawLog.packId.c_str();
+        goPackIds.push_back(goPackId);
+        GoString goTopic;
+        goTopic.n = rawLog.topic.size();
+        goTopic.p = rawLog.topic.c_str();
+        goTopics.push_back(goTopic);
+        GoSlice goTag;
+        goTag.data = (void*)rawLog.tags->c_str();
+        goTag.len = goTag.cap = rawLog.tags->length();
+        goTags.push_back(goTag);
+    }
+    if (goRawLogs.empty()) {
+        return;
+    }
+
+    GoString goConfigName;
+    goConfigName.n = configName.size();
+    goConfigName.p = configName.c_str();
+    GoSlice goRawLogSlice{goRawLogs.data(), (GoInt)goRawLogs.size(), (GoInt)goRawLogs.size()};
+    GoSlice goPackIdSlice{goPackIds.data(), (GoInt)goPackIds.size(), (GoInt)goPackIds.size()};
+    GoSlice goTopicSlice{goTopics.data(), (GoInt)goTopics.size(), (GoInt)goTopics.size()};
+    GoSlice goTagSlice{goTags.data(), (GoInt)goTags.size(), (GoInt)goTags.size()};
+    GoInt rst = mProcessRawLogsV2Fun(goConfigName, goRawLogSlice, goPackIdSlice, goTopicSlice, goTagSlice);
+    if (rst != (GoInt)0) {
+        LOG_WARNING(sLogger, ("process raw logs V2 error", configName)("count", goRawLogs.size())("result", rst));
+    }
+}
+
 int LogtailPlugin::IsValidToSend(long long logstoreKey) {
+    if (MemoryBudget::IsOverBudget(MEMORY_COMPONENT_PLUGIN_QUEUE)) {
+        return -1;
+    }
     return Sender::Instance()->GetSenderFeedBackInterface()->IsValidToPush(logstoreKey) ? 0 : -1;
 }
 
+int LogtailPlugin::GetSendCredit(long long logstoreKey) {
+    if (MemoryBudget::IsOverBudget(MEMORY_COMPONENT_PLUGIN_QUEUE)) {
+        return 0;
+    }
+    size_t credit = Sender::Instance()->GetQueue().GetPushCredit(logstoreKey);
+    // Log groups in send ring are not in sender queue yet, they are shared by all logstores.
+    PluginSendRing* sendRing = LogtailPlugin::GetInstance()->mSendRing.get();
+    if (sendRing != NULL) {
+        size_t pending = sendRing->GetPendingCount();
+        credit = pending < credit ? credit - pending : 0;
+    }
+    return static_cast<int>(std::min(credit, static_cast<size_t>(std::numeric_limits<int>::max())));
+}
+
+long long LogtailPlugin::CreateNativeProcessor(const char* config, int configSize) {
+    std::string error;
+    return NativeProcessorManager::GetInstance()->Create(std::string(config, configSize), error);
+}
+
+int LogtailPlugin::NativeProcess(
+    long long processorId, const char* pbBuffer, int pbSize, char** output, int* outputSize) {
+    std::string result;
+    if (!NativeProcessorManager::GetInstance()->Process(processorId, pbBuffer, pbSize, result)) {
+        return -1;
+    }
+    // One more byte so an empty log group is not a NULL output.
+    *output = static_cast<char*>(malloc(result.size() + 1));
+    if (*output == NULL) {
+        return -1;
+    }
+    memcpy(*output, result.data(), result.size());
+    *outputSize = static_cast<int>(result.size());
+    return 0;
+}
+
+int LogtailPlugin::DestroyNativeProcessor(long long processorId) {
+    return NativeProcessorManager::GetInstance()->Destroy(processorId) ? 0 : -1;
+}
+
+void LogtailPlugin::FreeNativeOutput(char* output) {
+    free(output);
+}
+
 int LogtailPlugin::SendPb(const char* configName,
                           int32_t configNameSize,
                           const char* logstoreName,
@@ -213,6 +332,37 @@ int LogtailPlugin::SendPbV2(const char* configName,
                             int32_t lines,
                             const char* shardHash,
                             int shardHashSize) {
+    // The buffer is owned by plugin, it has to be copied before the call returns.
+    PluginSendRing* sendRing = LogtailPlugin::GetInstance()->mSendRing.get();
+    if (sendRing != NULL) {
+        PluginSendRing::Item item;
+        item.mConfigName.assign(configName, configNameSize);
+        if (logstoreSize > 0 && logstoreName != NULL) {
+            item.mLogstore.assign(logstoreName, (size_t)logstoreSize);
+        }
+        if (shardHashSize > 0 && shardHash != NULL) {
+            item.mShardHash.assign(shardHash, (size_t)shardHashSize);
+        }
+        item.mData.assign(pbBuffer, pbSize);
+        item.mLines = lines;
+        if (sendRing->TryPush(std::move(item))) {
+            return 0;
+        }
+        // Ring is full, consumer is slower than plugin, compress in this thread to slow plugin down.
+    }
+    return SendPbV2Sync(
+        configName, configNameSize, logstoreName, logstoreSize, pbBuffer, pbSize, lines, shardHash, shardHashSize);
+}
+
+int LogtailPlugin::SendPbV2Sync(const char* configName,
+                                int32_t configNameSize,
+                                const char* logstoreName,
+                                int logstoreSize,
+                                char* pbBuffer,
+                                int32_t pbSize,
+                                int32_t lines,
+                                const char* shardHash,
+                                int shardHashSize) {
     static Config* alarmConfig = &(LogtailPlugin::GetInstance()->mPluginAlarmConfig);
     static Config* profileConfig = &(LogtailPlugin::GetInstance()->mPluginProfileConfig);
     static Config* containerConfig = &(LogtailPlugin::GetInstance()->mPluginContainerConfig);
@@ -339,27 +489,64 @@ bool LogtailPlugin::LoadPluginBase() {
         }
         LOG_INFO(sLogger, ("check plugin adapter version success, version", version));
 
-        // Be compatible with old libPluginAdapter.so, V2 -> V1.
-        auto registerV2Fun = (RegisterLogtailCallBackV2)loader.LoadMethod("RegisterLogtailCallBackV2", error);
+        // Be compatible with old libPluginAdapter.so, V3 -> V2 -> V1.
+        auto registerV3Fun = (RegisterLogtailCallBackV3)loader.LoadMethod("RegisterLogtailCallBackV3", error);
         if (error.empty()) {
-            registerV2Fun(LogtailPlugin::IsValidToSend,
+            registerV3Fun(LogtailPlugin::IsValidToSend,
                           LogtailPlugin::SendPb,
                           LogtailPlugin::SendPbV2,
-                          LogtailPlugin::ExecPluginCmd);
+                          LogtailPlugin::ExecPluginCmd,
+                          LogtailPlugin::GetSendCredit);
         } else {
-            LOG_WARNING(sLogger, ("load RegisterLogtailCallBackV2 failed", error)("try to load V1", ""));
-
-            auto registerFun = (RegisterLogtailCallBack)loader.LoadMethod("RegisterLogtailCallBack", error);
-            if (!error.empty()) {
-                LOG_WARNING(sLogger, ("load RegisterLogtailCallBack failed", error));
-                return false;
+            LOG_INFO(sLogger, ("load RegisterLogtailCallBackV3 failed", error)("try to load V2", ""));
+
+            auto registerV2Fun = (RegisterLogtailCallBackV2)loader.LoadMethod("RegisterLogtailCallBackV2", error);
+            if (error.empty()) {
+                registerV2Fun(LogtailPlugin::IsValidToSend,
+                              LogtailPlugin::SendPb,
+                              LogtailPlugin::SendPbV2,
+                              LogtailPlugin::ExecPluginCmd);
+            } else {
+                LOG_WARNING(sLogger, ("load RegisterLogtailCallBackV2 failed", error)("try to load V1", ""));
+
+                auto registerFun = (RegisterLogtailCallBack)loader.LoadMethod("RegisterLogtailCallBack", error);
+                if (!error.empty()) {
+                    LOG_WARNING(sLogger, ("load RegisterLogtailCallBack failed", error));
+                    return false;
+                }
+                registerFun(LogtailPlugin::IsValidToSend, LogtailPlugin::SendPb, LogtailPlugin::ExecPluginCmd);
             }
-            registerFun(LogtailPlugin::IsValidToSend, LogtailPlugin::SendPb, LogtailPlugin::ExecPluginCmd);
+        }
+
+        auto registerNativeFun = (RegisterLogtailNativeProcessorCallBack)loader.LoadMethod(
+            "RegisterLogtailNativeProcessorCallBack", error);
+        if (error.empty()) {
+            registerNativeFun(LogtailPlugin::CreateNativeProcessor,
+                              LogtailPlugin::NativeProcess,
+                              LogtailPlugin::DestroyNativeProcessor,
+                              LogtailPlugin::FreeNativeOutput);
+        } else {
+            LOG_INFO(sLogger, ("load RegisterLogtailNativeProcessorCallBack failed", error)("native processor", "off"));
         }
 
         mPluginAdapterPtr = loader.Release();
     }
 
+    if (mSendRing == nullptr && INT32_FLAG(plugin_send_ring_size) > 0) {
+        mSendRing.reset(new PluginSendRing(INT32_FLAG(plugin_send_ring_size), [](PluginSendRing::Item& item) {
+            SendPbV2Sync(item.mConfigName.data(),
+                         item.mConfigName.size(),
+                         item.mLogstore.data(),
+                         item.mLogstore.size(),
+                         &item.mData[0],
+                         item.mData.size(),
+                         item.mLines,
+                         item.mShardHash.data(),
+                         item.mShardHash.size());
+        }));
+        LOG_INFO(sLogger, ("log groups sent by plugin are passed through ring, size", mSendRing->Capacity()));
+    }
+
     InitPluginBaseFun initBase = NULL;
     InitPluginBaseV2Fun initBaseV2 = NULL;
     // load plugin base
@@ -418,6 +605,14 @@ bool LogtailPlugin::LoadPluginBase() {
             return false;
         }
 
+        // Optional, raw logs are passed one by one by plugins without it.
+        mProcessRawLogsV2Fun = (ProcessRawLogsV2Fun)loader.LoadMethod("ProcessRawLogsV2", error);
+        if (!error.empty()) {
+            LOG_INFO(sLogger, ("plugin does not support ProcessRawLogsV2, message", error));
+            mProcessRawLogsV2Fun = NULL;
+            error.clear();
+        }
+
         mGetContainerMetaFun = (GetContainerMetaFun)loader.LoadMethod("GetContainerMeta", error);
         if (!error.empty()) {
             LOG_ERROR(sLogger, ("load GetContainerMeta error, Message", error));
@@ -19,8 +19,12 @@
 #include <cstdlib>
 #include <ostream>
 #include <numeric>
+#include <memory>
+#include <string>
+#include <vector>
 #include <json/json.h>
 #include "config/Config.h"
+#include "plugin/PluginSendRing.h"
 #if defined(_MSC_VER)
 #include <stddef.h>
 #endif
@@ -114,6 +118,8 @@ typedef GoInt (*LoadConfigFun)(GoString p, GoString l, GoString c, GoInt64 k, Go
 typedef GoInt (*UnloadConfigFun)(GoString p, GoString l, GoString c);
 typedef GoInt (*ProcessRawLogFun)(GoString c, GoSlice l, GoString p, GoString t);
 typedef GoInt (*ProcessRawLogV2Fun)(GoString c, GoSlice l, GoString p, GoString t, GoSlice tags);
+// Slices of []byte, string, string and []byte, one element for each raw log.
+typedef GoInt (*ProcessRawLogsV2Fun)(GoString c, GoSlice l, GoSlice p, GoSlice t, GoSlice tags);
 typedef void (*HoldOnFun)(GoInt);
 typedef void (*ResumeFun)();
 typedef GoInt (*InitPluginBaseFun)();
@@ -144,11 +150,28 @@ typedef int (*SendPbV2Fun)(const char* configName,
 typedef int (*PluginCtlCmdFun)(
     const char* configName, int configNameSize, int optId, const char* params, int paramsLen);
 
+typedef int (*GetSendCreditFun)(long long logstoreKey);
+
+typedef long long (*NativeProcessorCreateFun)(const char* config, int configSize);
+typedef int (*NativeProcessFun)(
+    long long processorId, const char* pbBuffer, int pbSize, char** output, int* outputSize);
+typedef int (*NativeProcessorDestroyFun)(long long processorId);
+typedef void (*NativeOutputFreeFun)(char* output);
+typedef void (*RegisterLogtailNativeProcessorCallBack)(NativeProcessorCreateFun createFun,
+                                                       NativeProcessFun processFun,
+                                                       NativeProcessorDestroyFun destroyFun,
+                                                       NativeOutputFreeFun freeFun);
+
 typedef void (*RegisterLogtailCallBack)(IsValidToSendFun checkFun, SendPbFun sendFun, PluginCtlCmdFun cmdFun);
 typedef void (*RegisterLogtailCallBackV2)(IsValidToSendFun checkFun,
                                           SendPbFun sendFun,
                                           SendPbV2Fun sendV2Fun,
                                           PluginCtlCmdFun cmdFun);
+typedef void (*RegisterLogtailCallBackV3)(IsValidToSendFun checkFun,
+                                          SendPbFun sendFun,
+                                          SendPbV2Fun sendV2Fun,
+                                          PluginCtlCmdFun cmdFun,
+                                          GetSendCreditFun creditFun);
 
 typedef int (*PluginAdapterVersion)();
 }
@@ -202,6 +225,19 @@ public:
                          const std::string& topic,
                          const std::string& tags);
 
+    // PluginRawLog is a raw log passed by ProcessRawLogsV2.
+    struct PluginRawLog {
+        char* rawLog;
+        int32_t rawLogSize; // including the tailing '\0'
+        std::string packId;
+        std::string topic;
+        std::shared_ptr<const std::string> tags;
+    };
+
+    // ProcessRawLogsV2 passes @rawLogs to plugin in one call, it is the same as calling ProcessRawLogV2 for each of
+    // them, which is the fallback if plugin does not export ProcessRawLogsV2.
+    void ProcessRawLogsV2(const std::string& configName, const std::vector<PluginRawLog>& rawLogs);
+
     void ProcessLog(const std::string& configName,
                     sls_logs::Log& log,
                     const std::string& packId,
@@ -210,6 +246,10 @@ public:
 
     static int IsValidToSend(long long logstoreKey);
 
+    // GetSendCredit returns how many log groups of @logstoreKey plugin can send now without being rejected,
+    // so plugin can batch and pace its output instead of retrying on IsValidToSend.
+    static int GetSendCredit(long long logstoreKey);
+
     static int SendPb(const char* configName,
                       int32_t configNameSize,
                       const char* logstore,
@@ -230,9 +270,27 @@ public:
 
     static int ExecPluginCmd(const char* configName, int configNameSize, int cmdId, const char* params, int paramsLen);
 
+    // Native processors let plugin pipelines run processors such as processor_regex by parsers of logtail, see
+    // logtail::NativeProcessor. Output is allocated by malloc and released by FreeNativeOutput.
+    static long long CreateNativeProcessor(const char* config, int configSize);
+    static int NativeProcess(long long processorId, const char* pbBuffer, int pbSize, char** output, int* outputSize);
+    static int DestroyNativeProcessor(long long processorId);
+    static void FreeNativeOutput(char* output);
+
     K8sContainerMeta GetContainerMeta(const std::string& containerID);
 
 private:
+    // SendPbV2Sync compresses and pushes the log group into sender in the calling thread.
+    static int SendPbV2Sync(const char* configName,
+                            int32_t configNameSize,
+                            const char* logstore,
+                            int logstoreSize,
+                            char* pbBuffer,
+                            int32_t pbSize,
+                            int32_t lines,
+                            const char* shardHash,
+                            int shardHashSize);
+
     void* mPluginBasePtr;
     void* mPluginAdapterPtr;
 
@@ -243,12 +301,15 @@ private:
     ResumeFun mResumeFun;
     ProcessRawLogFun mProcessRawLogFun;
     ProcessRawLogV2Fun mProcessRawLogV2Fun;
+    ProcessRawLogsV2Fun mProcessRawLogsV2Fun;
     volatile bool mPluginValid;
     logtail::Config mPluginAlarmConfig;
     logtail::Config mPluginProfileConfig;
     logtail::Config mPluginContainerConfig;
     ProcessLogsFun mProcessLogsFun;
     GetContainerMetaFun mGetContainerMetaFun;
+    // Log groups sent by plugin are passed to it when plugin_send_ring_size is set.
+    std::unique_ptr<logtail::PluginSendRing> mSendRing;
 
     // Configuration for plugin system in JSON format.
     Json::Value mPluginCfg;
@@ -19,6 +19,11 @@ IsValidToSendFun gAdapterIsValidToSendFun = NULL;
 SendPbFun gAdapterSendPbFun = NULL;
 SendPbV2Fun gAdapterSendPbV2Fun = NULL;
 PluginCtlCmdFun gPluginCtlCmdFun = NULL;
+GetSendCreditFun gAdapterGetSendCreditFun = NULL;
+NativeProcessorCreateFun gNativeProcessorCreateFun = NULL;
+NativeProcessFun gNativeProcessFun = NULL;
+NativeProcessorDestroyFun gNativeProcessorDestroyFun = NULL;
+NativeOutputFreeFun gNativeOutputFreeFun = NULL;
 
 void RegisterLogtailCallBack(IsValidToSendFun checkFun, SendPbFun sendFun, PluginCtlCmdFun cmdFun) {
     fprintf(stderr, "[PluginAdapter] register fun %p %p %p\n", checkFun, sendFun, cmdFun);
@@ -38,6 +43,27 @@ void RegisterLogtailCallBackV2(IsValidToSendFun checkFun,
     gPluginCtlCmdFun = cmdFun;
 }
 
+void RegisterLogtailCallBackV3(IsValidToSendFun checkFun,
+                               SendPbFun sendV1Fun,
+                               SendPbV2Fun sendV2Fun,
+                               PluginCtlCmdFun cmdFun,
+                               GetSendCreditFun creditFun) {
+    fprintf(stderr, "register fun v3 %p %p %p %p %p\n", checkFun, sendV1Fun, sendV2Fun, cmdFun, creditFun);
+    RegisterLogtailCallBackV2(checkFun, sendV1Fun, sendV2Fun, cmdFun);
+    gAdapterGetSendCreditFun = creditFun;
+}
+
+void RegisterLogtailNativeProcessorCallBack(NativeProcessorCreateFun createFun,
+                                            NativeProcessFun processFun,
+                                            NativeProcessorDestroyFun destroyFun,
+                                            NativeOutputFreeFun freeFun) {
+    fprintf(stderr, "register native processor fun %p %p %p %p\n", createFun, processFun, destroyFun, freeFun);
+    gNativeProcessorCreateFun = createFun;
+    gNativeProcessFun = processFun;
+    gNativeProcessorDestroyFun = destroyFun;
+    gNativeOutputFreeFun = freeFun;
+}
+
 int LogtailIsValidToSend(long long logstoreKey) {
     if (gAdapterIsValidToSendFun == NULL) {
         return -1;
@@ -45,6 +71,17 @@ int LogtailIsValidToSend(long long logstoreKey) {
     return gAdapterIsValidToSendFun(logstoreKey);
 }
 
+int LogtailGetSendCredit(long long logstoreKey) {
+    if (gAdapterGetSendCreditFun != NULL) {
+        return gAdapterGetSendCreditFun(logstoreKey);
+    }
+    // Logtail registered by V1/V2 only tells if the logstore is valid, that is one log group.
+    if (gAdapterIsValidToSendFun == NULL) {
+        return -1;
+    }
+    return gAdapterIsValidToSendFun(logstoreKey) == 0 ? 1 : 0;
+}
+
 int LogtailSendPb(const char* configName,
                   int configNameSize,
                   const char* logstore,
@@ -81,9 +118,41 @@ int LogtailCtlCmd(const char* configName, int configNameSize, int optId, const c
     return gPluginCtlCmdFun(configName, configNameSize, optId, params, paramsLen);
 }
 
+long long LogtailNativeProcessorCreate(const char* config, int configSize) {
+    if (gNativeProcessorCreateFun == NULL) {
+        return -1;
+    }
+    return gNativeProcessorCreateFun(config, configSize);
+}
+
+int LogtailNativeProcess(long long processorId, const char* pbBuffer, int pbSize, char** output, int* outputSize) {
+    if (gNativeProcessFun == NULL) {
+        return -1;
+    }
+    return gNativeProcessFun(processorId, pbBuffer, pbSize, output, outputSize);
+}
+
+int LogtailNativeProcessorDestroy(long long processorId) {
+    if (gNativeProcessorDestroyFun == NULL) {
+        return -1;
+    }
+    return gNativeProcessorDestroyFun(processorId);
+}
+
+void LogtailNativeFree(char* output) {
+    if (gNativeOutputFreeFun != NULL) {
+        gNativeOutputFreeFun(output);
+    }
+}
+
 // # 300
 //   - Add LogtailSendPbV2.
 //   - Update RegisterLogtailCallBack to register LogtailSendPBV2.
+// # 301
+//   - Add LogtailGetSendCredit and RegisterLogtailCallBackV3 to register it.
+// # 302
+//   - Add LogtailNativeProcessorCreate, LogtailNativeProcess, LogtailNativeProcessorDestroy, LogtailNativeFree
+//     and RegisterLogtailNativeProcessorCallBack to register them.
 int PluginAdapterVersion() {
-    return 300;
+    return 302;
 }
\ No newline at end of file
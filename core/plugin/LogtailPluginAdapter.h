@@ -48,6 +48,12 @@ typedef int (*SendPbV2Fun)(const char* configName,
                            int shardHashSize);
 typedef int (*PluginCtlCmdFun)(
     const char* configName, int configNameSize, int optId, const char* params, int paramsLen);
+typedef int (*GetSendCreditFun)(long long logstoreKey);
+typedef long long (*NativeProcessorCreateFun)(const char* config, int configSize);
+typedef int (*NativeProcessFun)(
+    long long processorId, const char* pbBuffer, int pbSize, char** output, int* outputSize);
+typedef int (*NativeProcessorDestroyFun)(long long processorId);
+typedef void (*NativeOutputFreeFun)(char* output);
 
 PLUGIN_ADAPTER_API void RegisterLogtailCallBack(IsValidToSendFun checkFun, SendPbFun sendFun, PluginCtlCmdFun cmdFun);
 
@@ -56,8 +62,23 @@ PLUGIN_ADAPTER_API void RegisterLogtailCallBackV2(IsValidToSendFun checkFun,
                                                   SendPbV2Fun sendV2Fun,
                                                   PluginCtlCmdFun cmdFun);
 
+PLUGIN_ADAPTER_API void RegisterLogtailCallBackV3(IsValidToSendFun checkFun,
+                                                  SendPbFun sendV1Fun,
+                                                  SendPbV2Fun sendV2Fun,
+                                                  PluginCtlCmdFun cmdFun,
+                                                  GetSendCreditFun creditFun);
+
+PLUGIN_ADAPTER_API void RegisterLogtailNativeProcessorCallBack(NativeProcessorCreateFun createFun,
+                                                               NativeProcessFun processFun,
+                                                               NativeProcessorDestroyFun destroyFun,
+                                                               NativeOutputFreeFun freeFun);
+
 PLUGIN_ADAPTER_API int LogtailIsValidToSend(long long logstoreKey);
 
+// LogtailGetSendCredit returns how many log groups can be sent to @logstoreKey now, plugin should send
+// at most that many before asking again. 0 means the logstore is busy, -1 means logtail is not registered.
+PLUGIN_ADAPTER_API int LogtailGetSendCredit(long long logstoreKey);
+
 PLUGIN_ADAPTER_API int LogtailSendPb(const char* configName,
                                      int configNameSize,
                                      const char* logstore,
@@ -79,6 +100,19 @@ PLUGIN_ADAPTER_API int LogtailSendPbV2(const char* configName,
 PLUGIN_ADAPTER_API int
 LogtailCtlCmd(const char* configName, int configNameSize, int cmdId, const char* params, int paramsLen);
 
+// LogtailNativeProcessorCreate creates a native processor of logtail from the plugin processor config
+// {"type": "...", "detail": {...}}, returns its id, or -1 if logtail does not support it natively.
+PLUGIN_ADAPTER_API long long LogtailNativeProcessorCreate(const char* config, int configSize);
+
+// LogtailNativeProcess processes the serialized log group by processor @processorId, returns 0 and the serialized
+// result in @output, which must be released by LogtailNativeFree, or -1 on failure.
+PLUGIN_ADAPTER_API int
+LogtailNativeProcess(long long processorId, const char* pbBuffer, int pbSize, char** output, int* outputSize);
+
+PLUGIN_ADAPTER_API int LogtailNativeProcessorDestroy(long long processorId);
+
+PLUGIN_ADAPTER_API void LogtailNativeFree(char* output);
+
 // version for logtail plugin adapter, used for check plugin adapter version
 PLUGIN_ADAPTER_API int PluginAdapterVersion();
 
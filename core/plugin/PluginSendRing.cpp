@@ -0,0 +1,81 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "PluginSendRing.h"
+#include <chrono>
+#include "common/MemoryBudget.h"
+
+namespace logtail {
+
+PluginSendRing::PluginSendRing(size_t capacity, ConsumeFunc consume)
+    : mQueue(capacity), mConsume(std::move(consume)) {
+    mThread = CreateThread([this]() { Run(); });
+}
+
+PluginSendRing::~PluginSendRing() {
+    {
+        std::lock_guard<std::mutex> lock(mMux);
+        mStopped = true;
+    }
+    mDoorbell.notify_one();
+    mThread.reset();
+}
+
+bool PluginSendRing::TryPush(Item&& item) {
+    // Counted before pushed, so the consumer never sleeps with an item being pushed.
+    ++mPending;
+    const size_t bytes = item.mData.size();
+    MemoryBudget::Add(MEMORY_COMPONENT_PLUGIN_QUEUE, bytes);
+    if (!mQueue.TryPush(std::move(item))) {
+        MemoryBudget::Sub(MEMORY_COMPONENT_PLUGIN_QUEUE, bytes);
+        --mPending;
+        return false;
+    }
+    if (mSleeping.load()) {
+        std::lock_guard<std::mutex> lock(mMux);
+        mDoorbell.notify_one();
+    }
+    return true;
+}
+
+void PluginSendRing::WaitEmpty() {
+    std::unique_lock<std::mutex> lock(mMux);
+    mEmptyCond.wait(lock, [this]() { return mPending.load() == 0; });
+}
+
+void PluginSendRing::Run() {
+    Item item;
+    while (true) {
+        if (mQueue.TryPop(item)) {
+            MemoryBudget::Sub(MEMORY_COMPONENT_PLUGIN_QUEUE, item.mData.size());
+            mConsume(item);
+            item = Item();
+            if (--mPending == 0) {
+                std::lock_guard<std::mutex> lock(mMux);
+                mEmptyCond.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mMux);
+        if (mStopped && mPending.load() == 0) {
+            return;
+        }
+        mSleeping = true;
+        mDoorbell.wait_for(
+            lock, std::chrono::milliseconds(100), [this]() { return mStopped || mPending.load() > 0; });
+        mSleeping = false;
+    }
+}
+
+} // namespace logtail
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <boost/thread.hpp>
+#include "common/MpscRingQueue.h"
+#include "common/Thread.h"
+
+namespace logtail {
+
+// PluginSendRing passes log groups sent by plugin to a consumer thread, so that plugin threads return without
+// waiting for compression. The consumer sleeps while the ring is empty, and is woken by a doorbell from producers.
+class PluginSendRing {
+public:
+    struct Item {
+        std::string mConfigName;
+        std::string mLogstore;
+        std::string mShardHash;
+        std::string mData;
+        int32_t mLines = 0;
+    };
+    typedef std::function<void(Item&)> ConsumeFunc;
+
+    PluginSendRing(size_t capacity, ConsumeFunc consume);
+    // Items left are consumed before the consumer thread exits.
+    ~PluginSendRing();
+
+    // TryPush returns false if the ring is full, @item is not moved in that case.
+    bool TryPush(Item&& item);
+
+    // WaitEmpty blocks until all pushed items are consumed.
+    void WaitEmpty();
+
+    size_t GetPendingCount() const { return mPending.load(); }
+    size_t Capacity() const { return mQueue.Capacity(); }
+
+private:
+    void Run();
+
+    MpscRingQueue<Item> mQueue;
+    ConsumeFunc mConsume;
+    // Items pushed or being pushed but not consumed yet.
+    std::atomic<size_t> mPending{0};
+    std::atomic_bool mSleeping{false};
+    std::mutex mMux;
+    std::condition_variable mDoorbell;
+    std::condition_variable mEmptyCond;
+    bool mStopped = false;
+    ThreadPtr mThread;
+};
+
+} // namespace logtail
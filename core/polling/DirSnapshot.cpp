@@ -0,0 +1,85 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "DirSnapshot.h"
+#include <algorithm>
+#include "common/HashUtil.h"
+
+namespace logtail {
+
+static bool EntryLess(const DirSnapshotEntry& lhs, const DirSnapshotEntry& rhs) {
+    return lhs.mNameHash < rhs.mNameHash || (lhs.mNameHash == rhs.mNameHash && lhs.mInode < rhs.mInode);
+}
+
+uint64_t DirSnapshot::HashName(const std::string& name) {
+    return static_cast<uint64_t>(HashString(name.data(), name.size(), kHashStringSeed));
+}
+
+void DirSnapshot::Add(const std::string& name, uint64_t inode, uint64_t size, int64_t modifyTime) {
+    mEntries.push_back(DirSnapshotEntry{HashName(name), inode, size, modifyTime});
+}
+
+void DirSnapshot::Seal() {
+    std::sort(mEntries.begin(), mEntries.end(), EntryLess);
+    mEntries.shrink_to_fit();
+}
+
+void DirSnapshot::Diff(const DirSnapshot& oldSnapshot,
+                       const DirSnapshot& newSnapshot,
+                       std::vector<DirSnapshotChange>& changes) {
+    std::vector<const DirSnapshotEntry*> deleted, created;
+    auto oldIter = oldSnapshot.mEntries.begin(), oldEnd = oldSnapshot.mEntries.end();
+    auto newIter = newSnapshot.mEntries.begin(), newEnd = newSnapshot.mEntries.end();
+    while (oldIter != oldEnd || newIter != newEnd) {
+        if (newIter == newEnd || (oldIter != oldEnd && oldIter->mNameHash < newIter->mNameHash)) {
+            deleted.push_back(&*oldIter++);
+        } else if (oldIter == oldEnd || newIter->mNameHash < oldIter->mNameHash) {
+            created.push_back(&*newIter++);
+        } else if (oldIter->mInode != newIter->mInode) {
+            // Same name with another inode, the file is replaced.
+            deleted.push_back(&*oldIter++);
+            created.push_back(&*newIter++);
+        } else {
+            if (oldIter->mSize != newIter->mSize || oldIter->mModifyTime != newIter->mModifyTime) {
+                changes.push_back(DirSnapshotChange{DirSnapshotChange::MODIFY, &*oldIter, &*newIter});
+            }
+            ++oldIter;
+            ++newIter;
+        }
+    }
+
+    // Pair deleted and created entries by inode, usually only a few files change in a round.
+    auto inodeLess = [](const DirSnapshotEntry* lhs, const DirSnapshotEntry* rhs) { return lhs->mInode < rhs->mInode; };
+    std::sort(created.begin(), created.end(), inodeLess);
+    std::vector<bool> renamed(created.size(), false);
+    for (const DirSnapshotEntry* entry : deleted) {
+        auto iter = std::lower_bound(created.begin(), created.end(), entry, inodeLess);
+        while (iter != created.end() && (*iter)->mInode == entry->mInode && renamed[iter - created.begin()]) {
+            ++iter;
+        }
+        if (iter != created.end() && (*iter)->mInode == entry->mInode) {
+            renamed[iter - created.begin()] = true;
+            changes.push_back(DirSnapshotChange{DirSnapshotChange::RENAME, entry, *iter});
+        } else {
+            changes.push_back(DirSnapshotChange{DirSnapshotChange::DELETE, entry, NULL});
+        }
+    }
+    for (size_t i = 0; i < created.size(); ++i) {
+        if (!renamed[i]) {
+            changes.push_back(DirSnapshotChange{DirSnapshotChange::CREATE, NULL, created[i]});
+        }
+    }
+}
+
+} // namespace logtail
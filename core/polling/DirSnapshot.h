@@ -0,0 +1,68 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace logtail {
+
+// DirSnapshotEntry is the state of a file in a directory listing, the name is kept as hash only.
+struct DirSnapshotEntry {
+    uint64_t mNameHash;
+    uint64_t mInode;
+    uint64_t mSize;
+    // Last modified time in nanoseconds.
+    int64_t mModifyTime;
+};
+
+struct DirSnapshotChange {
+    enum Type { CREATE, MODIFY, DELETE, RENAME };
+
+    Type mType;
+    // Entry in the old snapshot, NULL for CREATE.
+    const DirSnapshotEntry* mOld;
+    // Entry in the new snapshot, NULL for DELETE.
+    const DirSnapshotEntry* mNew;
+};
+
+// DirSnapshot records files of a directory as a vector sorted by name hash, about 32 bytes per file,
+// so two listings can be compared by one merge walk.
+class DirSnapshot {
+public:
+    static uint64_t HashName(const std::string& name);
+
+    void Add(const std::string& name, uint64_t inode, uint64_t size, int64_t modifyTime);
+    // Seal sorts entries added, it must be called before Diff.
+    void Seal();
+
+    // Diff compares @oldSnapshot with @newSnapshot and appends changes to @changes. A deleted entry and a
+    // created entry with the same inode are reported as one RENAME.
+    static void
+    Diff(const DirSnapshot& oldSnapshot, const DirSnapshot& newSnapshot, std::vector<DirSnapshotChange>& changes);
+
+    size_t Size() const { return mEntries.size(); }
+    bool Empty() const { return mEntries.empty(); }
+    void Clear() { std::vector<DirSnapshotEntry>().swap(mEntries); }
+    void Swap(DirSnapshot& other) { mEntries.swap(other.mEntries); }
+    const std::vector<DirSnapshotEntry>& GetEntries() const { return mEntries; }
+
+private:
+    std::vector<DirSnapshotEntry> mEntries;
+};
+
+} // namespace logtail
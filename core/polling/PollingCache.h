@@ -22,9 +22,22 @@
 #include <unordered_map>
 #include <ctime>
 #include "common/SplitedFilePath.h"
+#include "DirSnapshot.h"
 
 namespace logtail {
 
+// DirListCache records the last listing of a directory by a config.
+struct DirListCache {
+    // Last modified time of the directory in nanoseconds when it was listed.
+    int64_t mModifyTime = 0;
+    // When the directory was listed, in seconds.
+    int32_t mListTime = 0;
+    // Sub directories polled recursively by the listing.
+    std::vector<std::string> mSubDirs;
+    // Files of the listing, only recorded when polling_dir_snapshot is set.
+    DirSnapshot mFiles;
+};
+
 struct DirFileCache {
     DirFileCache() {}
     DirFileCache(bool configMatched) : mConfigMatched(configMatched) {}
@@ -44,6 +57,9 @@ struct DirFileCache {
     void SetLastEventTime(int32_t curTime) { mLastEventTime = curTime; }
     int32_t GetLastEventTime() const { return mLastEventTime; }
 
+    // Listings of the directory, the key is config name, only used for directories.
+    std::unordered_map<std::string, DirListCache> mListCaches;
+
 private:
     // It indicates if the related file/dir has generated event.
     bool mEventFlag = false;
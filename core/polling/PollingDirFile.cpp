@@ -56,6 +56,11 @@ DEFINE_FLAG_INT32(polling_max_stat_count, "max stat count in each round", 100000
 DEFINE_FLAG_INT32(polling_max_stat_count_per_dir, "max stat count per dir in each round", 100000);
 DEFINE_FLAG_INT32(polling_max_stat_count_per_config, "max stat count per config in each round", 100000);
 DEFINE_FLAG_INT32(polling_modify_repush_interval, "polling modify event repush interval, seconds", 10);
+DEFINE_FLAG_BOOL(polling_dir_skip_unmodified,
+                 "do not list dirs whose modify time is not changed since last listing, only poll their sub dirs",
+                 false);
+DEFINE_FLAG_INT32(polling_dir_full_list_round, "list all dirs every rounds if polling_dir_skip_unmodified is set", 20);
+DEFINE_FLAG_BOOL(polling_dir_snapshot, "compare files of dir listings to find renamed files", true);
 DECLARE_FLAG_INT32(wildcard_max_sub_dir_count);
 
 using namespace std;
@@ -246,6 +251,77 @@ void PollingDirFile::Polling() {
 // removed or renamed. Howerver, modifying the content of a file within it will not update
 // LMD, and add/remove/rename file/directory in its subdirectory will also not upadte LMD.
 // NOTE: So, we can not find changes in subdirectories of the directory according to LMD.
+bool PollingDirFile::GetUnmodifiedSubDirs(const Config* config,
+                                          const std::string& dirPath,
+                                          int64_t modifyTime,
+                                          std::vector<std::string>& subDirs) {
+    // Full listing regularly keeps cache items of files from being cleared as unavailable, and finds files
+    // whose changes are not reflected by modify time of the directory.
+    const int32_t fullListRound = std::max(
+        1, std::min(INT32_FLAG(polling_dir_full_list_round), INT32_FLAG(delete_dir_file_round) / 2));
+    if (mCurrentRound % fullListRound == 0) {
+        return false;
+    }
+    ScopedSpinLock lock(mCacheLock);
+    auto iter = mDirCacheMap.find(dirPath);
+    if (iter == mDirCacheMap.end()) {
+        return false;
+    }
+    auto listIter = iter->second.mListCaches.find(config->mConfigName);
+    if (listIter == iter->second.mListCaches.end()) {
+        return false;
+    }
+    const DirListCache& listCache = listIter->second;
+    // Modify time of some filesystems is in seconds, changes in the same second of the last listing
+    // might not change it.
+    if (listCache.mModifyTime != modifyTime || listCache.mListTime <= modifyTime / NANO_CONVERTING + 1) {
+        return false;
+    }
+    subDirs = listCache.mSubDirs;
+    return true;
+}
+
+bool PollingDirFile::UpdateDirListCache(const Config* config,
+                                        const std::string& dirPath,
+                                        int64_t modifyTime,
+                                        std::vector<std::string>& subDirs,
+                                        DirSnapshot& files) {
+    ScopedSpinLock lock(mCacheLock);
+    auto iter = mDirCacheMap.find(dirPath);
+    if (iter == mDirCacheMap.end()) {
+        return false;
+    }
+    DirListCache& listCache = iter->second.mListCaches[config->mConfigName];
+    const bool listed = listCache.mListTime != 0;
+    listCache.mModifyTime = modifyTime;
+    listCache.mListTime = static_cast<int32_t>(time(NULL));
+    listCache.mSubDirs.swap(subDirs);
+    listCache.mFiles.Swap(files);
+    return listed;
+}
+
+void PollingDirFile::CheckDirSnapshot(const std::string& dirPath,
+                                      const DirSnapshot& lastFiles,
+                                      const DirSnapshot& files,
+                                      const std::vector<std::pair<uint64_t, std::string>>& fileNames) {
+    std::vector<DirSnapshotChange> changes;
+    DirSnapshot::Diff(lastFiles, files, changes);
+    for (const auto& change : changes) {
+        // New and modified files are found by their modify time, but a renamed file keeps its modify time,
+        // it would be ignored if it is older than polling_file_first_watch_timeout.
+        if (change.mType != DirSnapshotChange::RENAME) {
+            continue;
+        }
+        for (const auto& fileName : fileNames) {
+            if (fileName.first == change.mNew->mNameHash) {
+                LOG_DEBUG(sLogger, ("add renamed file to modify event", fileName.second)("dir", dirPath));
+                mNewFileVec.push_back(SplitedFilePath(dirPath, fileName.second));
+                break;
+            }
+        }
+    }
+}
+
 bool PollingDirFile::CheckAndUpdateDirMatchCache(const string& dirPath,
                                                  const fsutil::PathStat& statBuf,
                                                  bool& newFlag) {
@@ -349,6 +425,32 @@ bool PollingDirFile::PollingNormalConfigPath(
         PollingEventQueue::GetInstance()->PushEvent(new Event(srcPath, obj, EVENT_CREATE | EVENT_ISDIR, -1, 0));
     }
 
+    int64_t sec, nsec;
+    statBuf.GetLastWriteTime(sec, nsec);
+    const int64_t modifyTime = NANO_CONVERTING * sec + nsec;
+    std::vector<std::string> subDirs;
+    if (BOOL_FLAG(polling_dir_skip_unmodified) && !isNewDirectory
+        && GetUnmodifiedSubDirs(pConfig, dirPath, modifyTime, subDirs)) {
+        // Entries of the directory are not changed, only sub directories need to be polled.
+        for (const auto& subDir : subDirs) {
+            if (!mRuningFlag || mHoldOnFlag)
+                break;
+            if (++mStatCount % INT32_FLAG(dirfile_stat_count) == 0) {
+                usleep(INT32_FLAG(dirfile_stat_sleep) * 1000);
+            }
+            fsutil::PathStat buf;
+            if (fsutil::PathStat::stat(PathJoin(dirPath, subDir), buf) && buf.IsDir()) {
+                PollingNormalConfigPath(pConfig, dirPath, subDir, buf, depth + 1);
+            }
+        }
+        return true;
+    }
+    subDirs.clear();
+    bool listCompleted = true;
+    // Files matched and not added to mNewFileVec, for comparing with the last listing.
+    DirSnapshot files;
+    std::vector<std::pair<uint64_t, std::string>> fileNames;
+
     // Iterate directories and files in dirPath.
     fsutil::Dir dir(dirPath);
     if (!dir.Open()) {
@@ -369,8 +471,10 @@ bool PollingDirFile::PollingNormalConfigPath(
     int32_t nowStatCount = 0;
     fsutil::Entry ent;
     while (ent = dir.ReadNext(false)) {
-        if (!mRuningFlag || mHoldOnFlag)
+        if (!mRuningFlag || mHoldOnFlag) {
+            listCompleted = false;
             break;
+        }
 
         if (++mStatCount % INT32_FLAG(dirfile_stat_count) == 0) {
             usleep(INT32_FLAG(dirfile_stat_sleep) * 1000);
@@ -385,6 +489,7 @@ bool PollingDirFile::PollingNormalConfigPath(
                                                        + ToString(nowStatCount) + " total count:" + ToString(mStatCount)
                                                        + " path: " + dirPath + " project:" + pConfig->mProjectName
                                                        + " logstore:" + pConfig->mCategory);
+            listCompleted = false;
             break;
         }
 
@@ -398,6 +503,7 @@ bool PollingDirFile::PollingNormalConfigPath(
                                                        + " path: " + dirPath + " project:" + pConfig->mProjectName
                                                        + " logstore:" + pConfig->mCategory,
                                                    pConfig->mRegion);
+            listCompleted = false;
             break;
         }
 
@@ -445,10 +551,18 @@ bool PollingDirFile::PollingNormalConfigPath(
         // a symbolic file is DIR or REG.
         if (buf.IsDir() && (!needCheckDirMatch || ConfigManager::GetInstance()->MatchDirPattern(pConfig, item))) {
             PollingNormalConfigPath(pConfig, dirPath, entName, buf, depth + 1);
+            subDirs.push_back(entName);
         } else if (buf.IsRegFile()) {
             if (CheckAndUpdateFileMatchCache(dirPath, entName, buf, needFindBestMatch)) {
                 LOG_DEBUG(sLogger, ("add to modify event", entName)("round", mCurrentRound));
                 mNewFileVec.push_back(SplitedFilePath(dirPath, entName));
+            } else if (BOOL_FLAG(polling_dir_snapshot)) {
+                fileNames.emplace_back(DirSnapshot::HashName(entName), entName);
+            }
+            if (BOOL_FLAG(polling_dir_snapshot)) {
+                int64_t fileSec, fileNsec;
+                buf.GetLastWriteTime(fileSec, fileNsec);
+                files.Add(entName, buf.GetDevInode().inode, buf.GetFileSize(), NANO_CONVERTING * fileSec + fileNsec);
             }
         } else {
             // Ignore other file type.
@@ -457,6 +571,13 @@ bool PollingDirFile::PollingNormalConfigPath(
         }
     }
 
+    if (listCompleted && (BOOL_FLAG(polling_dir_skip_unmodified) || BOOL_FLAG(polling_dir_snapshot))) {
+        files.Seal();
+        DirSnapshot lastFiles(files);
+        if (UpdateDirListCache(pConfig, dirPath, modifyTime, subDirs, lastFiles) && !fileNames.empty()) {
+            CheckDirSnapshot(dirPath, lastFiles, files, fileNames);
+        }
+    }
     return true;
 }
 
@@ -76,6 +76,30 @@ private:
     // @return true if at least one directory was found during polling.
     bool PollingWildcardConfigPath(const Config* pConfig, const std::string& dirPath, int depth);
 
+    // GetUnmodifiedSubDirs returns true if @dirPath is not modified since it was listed for @config
+    // last time, and sub directories polled by that listing are returned in @subDirs.
+    // @modifyTime: last modified time of @dirPath in nanoseconds.
+    bool GetUnmodifiedSubDirs(const Config* config,
+                              const std::string& dirPath,
+                              int64_t modifyTime,
+                              std::vector<std::string>& subDirs);
+
+    // UpdateDirListCache records a complete listing of @dirPath for @config, @files is swapped with the
+    // snapshot of the last listing.
+    // @return false if @dirPath has not been listed for @config before.
+    bool UpdateDirListCache(const Config* config,
+                            const std::string& dirPath,
+                            int64_t modifyTime,
+                            std::vector<std::string>& subDirs,
+                            DirSnapshot& files);
+
+    // CheckDirSnapshot compares files of two listings of @dirPath, renamed files whose new names are
+    // in @fileNames are added to mNewFileVec.
+    void CheckDirSnapshot(const std::string& dirPath,
+                          const DirSnapshot& lastFiles,
+                          const DirSnapshot& files,
+                          const std::vector<std::pair<uint64_t, std::string>>& fileNames);
+
     // CheckAndUpdateDirMatchCache updates dir cache (add if not existing).
     // The caller of this method should make sure that there is at least one config matches
     // @dirPath.
@@ -136,6 +160,7 @@ private:
 
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class PollingUnittest;
+    friend class DiscoveryBenchmark;
 #endif
 };
 
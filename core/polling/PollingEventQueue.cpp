@@ -24,6 +24,24 @@ DECLARE_FLAG_INT32(max_file_not_exist_times);
 
 namespace logtail {
 
+namespace {
+
+    std::string GetModifyEventKey(const Event* pEvent) {
+        std::string key;
+        key.append(pEvent->GetSource())
+            .append(">")
+            .append(pEvent->GetObject_())
+            .append(">")
+            .append(ToString(pEvent->GetDev()))
+            .append(">")
+            .append(ToString(pEvent->GetInode()))
+            .append(">")
+            .append(pEvent->GetConfigName());
+        return key;
+    }
+
+} // namespace
+
 void PollingEventQueue::PushEvent(const std::vector<Event*>& eventVec) {
     for (size_t i = 0; i < eventVec.size(); ++i) {
         Event* pEvent = eventVec[i];
@@ -36,7 +54,9 @@ void PollingEventQueue::PushEvent(const std::vector<Event*>& eventVec) {
         {
             std::lock_guard<std::mutex> lock(mQueueLock);
             if (mEventQueue.size() < (size_t)INT32_FLAG(max_polling_event_queue_size)) {
-                mEventQueue.insert(mEventQueue.end(), eventVec.begin(), eventVec.end());
+                for (size_t i = 0; i < eventVec.size(); ++i) {
+                    EnqueueEvent(eventVec[i]);
+                }
                 break;
             }
         }
@@ -60,6 +80,15 @@ void PollingEventQueue::PopAllEvents(std::vector<Event*>& allEvents) {
     std::lock_guard<std::mutex> lock(mQueueLock);
     allEvents.insert(allEvents.end(), mEventQueue.begin(), mEventQueue.end());
     mEventQueue.clear();
+    mModifyEventKeys.clear();
+}
+
+void PollingEventQueue::EnqueueEvent(Event* pEvent) {
+    if (pEvent->GetType() == EVENT_MODIFY && !mModifyEventKeys.insert(GetModifyEventKey(pEvent)).second) {
+        delete pEvent;
+        return;
+    }
+    mEventQueue.push_back(pEvent);
 }
 
 PollingEventQueue::PollingEventQueue() {
@@ -77,7 +106,7 @@ void PollingEventQueue::PushEvent(Event* pEvent) {
         {
             std::lock_guard<std::mutex> lock(mQueueLock);
             if (mEventQueue.size() < (size_t)INT32_FLAG(max_polling_event_queue_size)) {
-                mEventQueue.push_back(pEvent);
+                EnqueueEvent(pEvent);
                 break;
             }
         }
@@ -99,6 +128,7 @@ void PollingEventQueue::Clear() {
         delete *iter;
     }
     mEventQueue.clear();
+    mModifyEventKeys.clear();
 }
 
 Event* PollingEventQueue::FindEvent(const std::string& src, const std::string& obj, int32_t eventType) {
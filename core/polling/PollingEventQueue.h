@@ -18,6 +18,8 @@
 #include <vector>
 #include <deque>
 #include <mutex>
+#include <string>
+#include <unordered_set>
 
 namespace logtail {
 
@@ -39,8 +41,14 @@ private:
     PollingEventQueue();
     ~PollingEventQueue();
 
+    // EnqueueEvent is called with mQueueLock held, it deletes @pEvent if the same MODIFY
+    // event is already in queue.
+    void EnqueueEvent(Event* pEvent);
+
     std::mutex mQueueLock;
     std::deque<Event*> mEventQueue;
+    // Keys of MODIFY events in mEventQueue, to coalesce MODIFY events of the same file.
+    std::unordered_set<std::string> mModifyEventKeys;
 
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class EventDispatcher;
@@ -18,10 +18,12 @@
 #include <sys/file.h>
 #endif
 #include <sys/stat.h>
+#include <algorithm>
 #include "common/Flags.h"
 #include "common/StringTools.h"
 #include "common/TimeUtil.h"
 #include "common/FileSystemUtil.h"
+#include "common/BatchStat.h"
 #include "event/Event.h"
 #include "logger/Logger.h"
 #include "profiler/LogtailAlarm.h"
@@ -35,6 +37,10 @@ DEFINE_FLAG_INT32(modify_stat_count, "sleep when dir file stat count up to", 100
 DEFINE_FLAG_INT32(modify_stat_sleepMs, "sleep time when dir file stat up to 1000, ms", 10);
 DEFINE_FLAG_INT32(modify_cache_max, "max modify chache size, if exceed, delete 0.2 oldest", 100000);
 DEFINE_FLAG_INT32(modify_cache_make_space_interval, "second", 600);
+DEFINE_FLAG_BOOL(modify_stat_batch_enable,
+                 "stat files in modify cache in batches (io_uring statx on Linux), no sleep between stats",
+                 false);
+DEFINE_FLAG_INT32(modify_stat_batch_size, "count of files stat'ed in one batch", 256);
 
 namespace logtail {
 
@@ -244,41 +250,28 @@ void PollingModify::Polling() {
 
             vector<SplitedFilePath> deletedFileVec;
             vector<Event*> pollingEventVec;
-            int32_t statCount = 0;
             LogtailMonitor::Instance()->UpdateMetric("polling_modify_size", mModifyCacheMap.size());
-            for (auto iter = mModifyCacheMap.begin(); iter != mModifyCacheMap.end(); ++iter) {
-                if (!mRuningFlag || mHoldOnFlag)
-                    break;
-
-                const SplitedFilePath& filePath = iter->first;
-                ModifyCheckCache& modifyCache = iter->second;
-                fsutil::PathStat logFileStat;
-                if (!fsutil::PathStat::stat(PathJoin(filePath.mFileDir, filePath.mFileName), logFileStat)) {
-                    if (errno == ENOENT) {
-                        LOG_DEBUG(sLogger, ("file deleted", PathJoin(filePath.mFileDir, filePath.mFileName)));
-                        if (UpdateDeletedFile(filePath, modifyCache, pollingEventVec)) {
-                            deletedFileVec.push_back(filePath);
-                        }
-                    } else {
-                        LOG_DEBUG(sLogger, ("get file info error", PathJoin(filePath.mFileDir, filePath.mFileName)));
+            if (BOOL_FLAG(modify_stat_batch_enable)) {
+                CheckFilesByBatchStat(deletedFileVec, pollingEventVec);
+            } else {
+                mBatchStat.reset();
+                int32_t statCount = 0;
+                for (auto iter = mModifyCacheMap.begin(); iter != mModifyCacheMap.end(); ++iter) {
+                    if (!mRuningFlag || mHoldOnFlag)
+                        break;
+
+                    const SplitedFilePath& filePath = iter->first;
+                    fsutil::PathStat logFileStat;
+                    int statErrno = 0;
+                    if (!fsutil::PathStat::stat(PathJoin(filePath.mFileDir, filePath.mFileName), logFileStat)) {
+                        statErrno = errno;
                     }
-                } else {
-                    int64_t sec, nsec;
-                    logFileStat.GetLastWriteTime(sec, nsec);
-                    timespec mtim{sec, nsec};
-                    auto devInode = logFileStat.GetDevInode();
-                    UpdateFile(filePath,
-                               modifyCache,
-                               devInode.dev,
-                               devInode.inode,
-                               logFileStat.GetFileSize(),
-                               mtim,
-                               pollingEventVec);
-                }
+                    CheckFile(filePath, iter->second, statErrno, logFileStat, deletedFileVec, pollingEventVec);
 
-                ++statCount;
-                if (statCount % INT32_FLAG(modify_stat_count) == 0) {
-                    usleep(1000 * INT32_FLAG(modify_stat_sleepMs));
+                    ++statCount;
+                    if (statCount % INT32_FLAG(modify_stat_count) == 0) {
+                        usleep(1000 * INT32_FLAG(modify_stat_sleepMs));
+                    }
                 }
             }
 
@@ -298,6 +291,64 @@ void PollingModify::Polling() {
     LOG_INFO(sLogger, ("PollingModify::Polling", "stop"));
 }
 
+void PollingModify::CheckFile(const SplitedFilePath& filePath,
+                              ModifyCheckCache& modifyCache,
+                              int statErrno,
+                              fsutil::PathStat& logFileStat,
+                              std::vector<SplitedFilePath>& deletedFileVec,
+                              std::vector<Event*>& eventVec) {
+    if (statErrno != 0) {
+        if (statErrno == ENOENT) {
+            LOG_DEBUG(sLogger, ("file deleted", PathJoin(filePath.mFileDir, filePath.mFileName)));
+            if (UpdateDeletedFile(filePath, modifyCache, eventVec)) {
+                deletedFileVec.push_back(filePath);
+            }
+        } else {
+            LOG_DEBUG(sLogger, ("get file info error", PathJoin(filePath.mFileDir, filePath.mFileName)));
+        }
+        return;
+    }
+    int64_t sec, nsec;
+    logFileStat.GetLastWriteTime(sec, nsec);
+    timespec mtim{sec, nsec};
+    auto devInode = logFileStat.GetDevInode();
+    UpdateFile(filePath, modifyCache, devInode.dev, devInode.inode, logFileStat.GetFileSize(), mtim, eventVec);
+}
+
+void PollingModify::CheckFilesByBatchStat(std::vector<SplitedFilePath>& deletedFileVec,
+                                          std::vector<Event*>& eventVec) {
+    const size_t batchSize = static_cast<size_t>(std::max(INT32_FLAG(modify_stat_batch_size), 1));
+    if (mBatchStat == nullptr) {
+        mBatchStat.reset(new BatchStat(batchSize));
+        LOG_INFO(sLogger, ("PollingModify stats files in batches, io_uring", mBatchStat->IsUringEnabled()));
+    }
+
+    std::vector<ModifyCheckCacheMap::iterator> batchIters;
+    std::vector<std::string> batchPaths;
+    std::vector<fsutil::PathStat> batchStats;
+    std::vector<int> batchErrnos;
+    batchIters.reserve(batchSize);
+    batchPaths.reserve(batchSize);
+    auto iter = mModifyCacheMap.begin();
+    while (iter != mModifyCacheMap.end() && mRuningFlag && !mHoldOnFlag) {
+        batchIters.clear();
+        batchPaths.clear();
+        for (; iter != mModifyCacheMap.end() && batchIters.size() < batchSize; ++iter) {
+            batchIters.push_back(iter);
+            batchPaths.push_back(PathJoin(iter->first.mFileDir, iter->first.mFileName));
+        }
+        mBatchStat->Stat(batchPaths, batchStats, batchErrnos);
+        for (size_t i = 0; i < batchIters.size(); ++i) {
+            CheckFile(batchIters[i]->first,
+                      batchIters[i]->second,
+                      batchErrnos[i],
+                      batchStats[i],
+                      deletedFileVec,
+                      eventVec);
+        }
+    }
+}
+
 #ifdef APSARA_UNIT_TEST_MAIN
 bool PollingModify::FindNewFile(const std::string& dir, const std::string& fileName) {
     PTScopedLock lock(mFileLock);
@@ -18,6 +18,7 @@
 #include "PollingCache.h"
 #include <map>
 #include <deque>
+#include <memory>
 #include <vector>
 #include "common/Lock.h"
 #include "common/Thread.h"
@@ -29,6 +30,10 @@
 namespace logtail {
 
 class Event;
+class BatchStat;
+namespace fsutil {
+    class PathStat;
+}
 
 class PollingModify : public LogRunnable {
 public:
@@ -85,6 +90,19 @@ private:
     bool
     UpdateDeletedFile(const SplitedFilePath& filePath, ModifyCheckCache& modifyCache, std::vector<Event*>& eventVec);
 
+    // CheckFile updates corresponding cache of the file with the result of stat,
+    // @statErrno is 0 if @logFileStat is valid.
+    void CheckFile(const SplitedFilePath& filePath,
+                   ModifyCheckCache& modifyCache,
+                   int statErrno,
+                   fsutil::PathStat& logFileStat,
+                   std::vector<SplitedFilePath>& deletedFileVec,
+                   std::vector<Event*>& eventVec);
+
+    // CheckFilesByBatchStat checks all files in modify cache, files are stat'ed in batches
+    // by mBatchStat instead of one by one.
+    void CheckFilesByBatchStat(std::vector<SplitedFilePath>& deletedFileVec, std::vector<Event*>& eventVec);
+
 private:
     PTMutex mPollingThreadLock;
     volatile bool mRuningFlag;
@@ -99,6 +117,9 @@ private:
 
     ModifyCheckCacheMap mModifyCacheMap;
 
+    // Only used by polling thread, created when modify_stat_batch_enable is on.
+    std::unique_ptr<BatchStat> mBatchStat;
+
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class PollingUnittest;
     bool FindNewFile(const std::string& dir, const std::string& fileName);
@@ -40,6 +40,10 @@ public:
         return false;
     }
 
+    FilterOperator GetOperator() const { return op; }
+    const BaseFilterNodePtr& GetLeft() const { return left; }
+    const BaseFilterNodePtr& GetRight() const { return right; }
+
 private:
     FilterOperator op;
     BaseFilterNodePtr left;
@@ -13,10 +13,14 @@
 // limitations under the License.
 
 #include "LogFilter.h"
+#include <algorithm>
 #include <re2/re2.h>
+#include <re2/set.h>
 #include "profiler/LogtailAlarm.h"
 #include "app_config/AppConfig.h"
 #include "common/util.h"
+#include "common/RegexCache.h"
+#include "common/Utf8Validator.h"
 #include "sdk/Common.h"
 #include "logger/Logger.h"
 #include "config_manager/ConfigManager.h"
@@ -58,8 +62,10 @@ bool LogFilter::InitFilter(const string& configName) {
             LogFilterRule* filterRule = new LogFilterRule();
             for (uint32_t i = 0; i < keys.size(); i++) {
                 filterRule->FilterKeys.push_back(keys[i].asString());
-                filterRule->FilterRegs.push_back(boost::regex(regs[i].asString()));
+                // Copies of boost::regex share the compiled program of the cached one.
+                filterRule->FilterRegs.push_back(*RegexCache::GetInstance()->Get(regs[i].asString()));
             }
+            filterRule->CompileProgram();
             mFilters[projectName + "_" + category] = filterRule;
         }
     } catch (...) {
@@ -89,6 +95,9 @@ vector<int32_t> LogFilter::Filter(const std::string& projectName, const std::str
 
     const LogFilterRule& rule = *(it->second);
     LogGroupContext context(region, projectName, logGroup.category());
+    if (rule.Program) {
+        return rule.Program->Filter(logGroup, context);
+    }
     for (int32_t i = 0; i < log_size; i++) {
         if (IsMatched(logGroup.logs(i), rule, context)) {
             result.push_back(i);
@@ -111,6 +120,9 @@ LogFilter::Filter(const LogGroup& logGroup, const LogFilterRule* filterRule, con
         }
         return result;
     }
+    if (filterRule->Program) {
+        return filterRule->Program->Filter(logGroup, context);
+    }
 
     for (int32_t i = 0; i < log_size; i++) {
         try {
@@ -146,9 +158,15 @@ LogFilter::Filter(const sls_logs::LogGroup& logGroup, BaseFilterNodePtr node, co
     return index;
 }
 
+std::vector<int32_t> LogFilter::Filter(const sls_logs::LogGroup& logGroup,
+                                       const LogFilterProgram& program,
+                                       const LogGroupContext& context) {
+    return program.Filter(logGroup, context);
+}
+
 bool LogFilter::IsMatched(const Log& log, const LogFilterRule& rule, const LogGroupContext& context) {
     const std::vector<std::string>& keys = rule.FilterKeys;
-    const std::vector<boost::regex> regs = rule.FilterRegs;
+    const std::vector<boost::regex>& regs = rule.FilterRegs;
     string exception;
     for (uint32_t i = 0; i < keys.size(); i++) {
         bool found = false;
@@ -183,17 +201,78 @@ void LogFilter::CastSensitiveWords(sls_logs::LogGroup& logGroup, const Config* p
     if (pConfig->mSensitiveWordCastOptions.empty() || logGroup.logs_size() == 0) {
         return;
     }
+    // Contents of each key with cast options are gathered into a column, then each
+    // option is applied to the whole column in one pass.
+    typedef std::pair<const std::vector<SensitiveWordCastOption>*, std::vector<sls_logs::Log_Content*>> Column;
+    std::vector<Column> columns;
     int32_t logSize = logGroup.logs_size();
     for (int32_t i = 0; i < logSize; ++i) {
         sls_logs::Log* pLog = logGroup.mutable_logs(i);
         int32_t contentSize = pLog->contents_size();
         for (int32_t j = 0; j < contentSize; ++j) {
             sls_logs::Log_Content* pContent = pLog->mutable_contents(j);
-            CastOneSensitiveWord(pContent, pConfig);
+            auto findRst = pConfig->mSensitiveWordCastOptions.find(pContent->key());
+            if (findRst == pConfig->mSensitiveWordCastOptions.end()) {
+                continue;
+            }
+            // Few keys have cast options, linear search is enough.
+            size_t idx = 0;
+            while (idx < columns.size() && columns[idx].first != &findRst->second) {
+                ++idx;
+            }
+            if (idx == columns.size()) {
+                columns.push_back(Column(&findRst->second, std::vector<sls_logs::Log_Content*>()));
+                columns.back().second.reserve(logSize);
+            }
+            columns[idx].second.push_back(pContent);
+        }
+    }
+    for (const Column& column : columns) {
+        const std::vector<SensitiveWordCastOption>& optionVec = *column.first;
+        auto setIter = pConfig->mSensitiveWordCastSets.find(optionVec.front().key);
+        if (setIter != pConfig->mSensitiveWordCastSets.end()) {
+            for (sls_logs::Log_Content* pContent : column.second) {
+                CastSensitiveWordsBySet(pContent, optionVec, *setIter->second);
+            }
+            continue;
+        }
+        for (const SensitiveWordCastOption& opt : optionVec) {
+            for (sls_logs::Log_Content* pContent : column.second) {
+                CastSensitiveWord(pContent, opt);
+            }
         }
     }
 }
 
+void LogFilter::CastSensitiveWordsBySet(sls_logs::Log_Content* pContent,
+                                        const std::vector<SensitiveWordCastOption>& optionVec,
+                                        const re2::RE2::Set& regexSet) {
+    std::vector<int> matched;
+    if (!regexSet.Match(pContent->value(), &matched)) {
+        return;
+    }
+    std::sort(matched.begin(), matched.end());
+    // Options are applied in order, value is scanned again only after it is changed
+    // as the replacement may enable or disable following options.
+    size_t idx = 0;
+    while (idx < matched.size()) {
+        const int id = matched[idx++];
+        if (!CastSensitiveWord(pContent, optionVec[id]) || idx == matched.size()) {
+            continue;
+        }
+        std::vector<int> remaining;
+        regexSet.Match(pContent->value(), &remaining);
+        matched.clear();
+        for (int next : remaining) {
+            if (next > id) {
+                matched.push_back(next);
+            }
+        }
+        std::sort(matched.begin(), matched.end());
+        idx = 0;
+    }
+}
+
 void LogFilter::CastOneSensitiveWord(sls_logs::Log_Content* pContent, const Config* pConfig) {
     const string& key = pContent->key();
     std::unordered_map<std::string, std::vector<SensitiveWordCastOption> >::const_iterator findRst
@@ -202,75 +281,88 @@ void LogFilter::CastOneSensitiveWord(sls_logs::Log_Content* pContent, const Conf
         return;
     }
     const std::vector<SensitiveWordCastOption>& optionVec = findRst->second;
-    string* pVal = pContent->mutable_value();
+    auto setIter = pConfig->mSensitiveWordCastSets.find(key);
+    if (setIter != pConfig->mSensitiveWordCastSets.end()) {
+        CastSensitiveWordsBySet(pContent, optionVec, *setIter->second);
+        return;
+    }
     for (size_t i = 0; i < optionVec.size(); ++i) {
-        const SensitiveWordCastOption& opt = optionVec[i];
-        if (!opt.mRegex || !opt.mRegex->ok()) {
-            continue;
-        }
-        bool rst = false;
+        CastSensitiveWord(pContent, optionVec[i]);
+    }
+}
 
-        if (opt.option == SensitiveWordCastOption::CONST_OPTION) {
-            if (opt.replaceAll) {
-                rst = RE2::GlobalReplace(pVal, *(opt.mRegex), opt.constValue);
-            } else {
-                rst = RE2::Replace(pVal, *(opt.mRegex), opt.constValue);
-            }
+bool LogFilter::CastSensitiveWord(sls_logs::Log_Content* pContent, const SensitiveWordCastOption& opt) {
+    if (!opt.mRegex || !opt.mRegex->ok()) {
+        return false;
+    }
+    string* pVal = pContent->mutable_value();
+    bool rst = false;
+
+    if (opt.option == SensitiveWordCastOption::CONST_OPTION) {
+        if (opt.replaceAll) {
+            rst = RE2::GlobalReplace(pVal, *(opt.mRegex), opt.constValue);
         } else {
-            re2::StringPiece srcStr(*pVal);
-            size_t maxSize = pVal->size();
-            size_t beginPos = 0;
-            rst = true;
-            string destStr;
-            do {
-                re2::StringPiece findRst;
-                if (!re2::RE2::FindAndConsume(&srcStr, *(opt.mRegex), &findRst)) {
-                    if (beginPos == (size_t)0) {
-                        rst = false;
-                    }
-                    break;
-                }
-                // like  xxxx, psw=123abc,xx
-                size_t beginOffset = findRst.data() + findRst.size() - pVal->data();
-                size_t endOffset = srcStr.empty() ? maxSize : srcStr.data() - pVal->data();
-                if (beginOffset < beginPos || endOffset <= beginPos || endOffset > maxSize) {
+            rst = RE2::Replace(pVal, *(opt.mRegex), opt.constValue);
+        }
+    } else {
+        re2::StringPiece srcStr(*pVal);
+        size_t maxSize = pVal->size();
+        size_t beginPos = 0;
+        rst = true;
+        string destStr;
+        do {
+            re2::StringPiece findRst;
+            if (!re2::RE2::FindAndConsume(&srcStr, *(opt.mRegex), &findRst)) {
+                if (beginPos == (size_t)0) {
                     rst = false;
-                    break;
-                }
-                // add : xxxx, psw
-                destStr.append(pVal->substr(beginPos, beginOffset - beginPos));
-                // md5: 123abc
-                destStr.append(sdk::CalcMD5(pVal->substr(beginOffset, endOffset - beginOffset)));
-                beginPos = endOffset;
-                // refine for  : xxxx. psw=123abc
-                if (endOffset >= maxSize) {
-                    break;
                 }
-
-            } while (opt.replaceAll);
-
-            if (rst && beginPos < pVal->size()) {
-                // add ,xx
-                destStr.append(pVal->substr(beginPos));
+                break;
+            }
+            // like  xxxx, psw=123abc,xx
+            size_t beginOffset = findRst.data() + findRst.size() - pVal->data();
+            size_t endOffset = srcStr.empty() ? maxSize : srcStr.data() - pVal->data();
+            if (beginOffset < beginPos || endOffset <= beginPos || endOffset > maxSize) {
+                rst = false;
+                break;
             }
-            if (rst) {
-                pContent->set_value(destStr);
-                pVal = pContent->mutable_value();
+            // add : xxxx, psw
+            destStr.append(pVal->substr(beginPos, beginOffset - beginPos));
+            // md5: 123abc
+            destStr.append(sdk::CalcMD5(pVal->substr(beginOffset, endOffset - beginOffset)));
+            beginPos = endOffset;
+            // refine for  : xxxx. psw=123abc
+            if (endOffset >= maxSize) {
+                break;
             }
-        }
 
-        // if (!rst)
-        //{
-        //     LOG_WARNING(sLogger, ("cast sensitive word fail", opt.constValue)(pConfig->mProjectName,
-        //     pConfig->mCategory)); LogtailAlarm::GetInstance()->SendAlarm(CAST_SENSITIVE_WORD_ALARM, "cast sensitive
-        //     word fail", pConfig->mProjectName, pConfig->mCategory, pConfig->mRegion);
-        // }
+        } while (opt.replaceAll);
+
+        if (rst && beginPos < pVal->size()) {
+            // add ,xx
+            destStr.append(pVal->substr(beginPos));
+        }
+        if (rst) {
+            pContent->set_value(destStr);
+        }
     }
+
+    // if (!rst)
+    //{
+    //     LOG_WARNING(sLogger, ("cast sensitive word fail", opt.constValue)(pConfig->mProjectName,
+    //     pConfig->mCategory)); LogtailAlarm::GetInstance()->SendAlarm(CAST_SENSITIVE_WORD_ALARM, "cast sensitive
+    //     word fail", pConfig->mProjectName, pConfig->mCategory, pConfig->mRegion);
+    // }
+    return rst;
 }
 
 static const char UTF8_BYTE_PREFIX = 0x80;
 static const char UTF8_BYTE_MASK = 0xc0;
 void FilterNoneUtf8(const string& strSrc) {
+    // Most values are valid, they are checked in vectors and left untouched, the repair below only runs for
+    // values with invalid sequences.
+    if (IsValidUtf8(strSrc.data(), strSrc.size())) {
+        return;
+    }
     string* str = const_cast<string*>(&strSrc);
 #define FILL_BLUNK_AND_CONTINUE_IF_TRUE(stat) \
     if (stat) { \
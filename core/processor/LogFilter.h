@@ -17,18 +17,31 @@
 #pragma once
 #include <unordered_map>
 #include <boost/regex.hpp>
+#include <re2/re2.h>
+#include <re2/set.h>
 #include <vector>
 #include <string>
 #include "log_pb/sls_logs.pb.h"
 #include "BaseFilterNode.h"
+#include "LogFilterProgram.h"
 
 namespace logtail {
 
 class Config;
+struct SensitiveWordCastOption;
 
 struct LogFilterRule {
     std::vector<std::string> FilterKeys;
     std::vector<boost::regex> FilterRegs;
+    // Program compiled from FilterKeys and FilterRegs, see CompileProgram.
+    LogFilterProgramPtr Program;
+
+    void CompileProgram() {
+        Program.reset(new LogFilterProgram());
+        if (!Program->Compile(FilterKeys, FilterRegs)) {
+            Program.reset();
+        }
+    }
 };
 
 class LogFilter {
@@ -38,6 +51,13 @@ private:
     bool IsMatched(const sls_logs::Log& log, const LogFilterRule& rule, const LogGroupContext& context);
 
     static void CastOneSensitiveWord(sls_logs::Log_Content* pContent, const Config* pConfig);
+    // CastSensitiveWord casts value of @pContent by @opt, returns true if value is changed.
+    static bool CastSensitiveWord(sls_logs::Log_Content* pContent, const SensitiveWordCastOption& opt);
+    // CastSensitiveWordsBySet finds options matching @pContent by @regexSet in one scan and
+    // only applies them, value is not touched if none matches.
+    static void CastSensitiveWordsBySet(sls_logs::Log_Content* pContent,
+                                        const std::vector<SensitiveWordCastOption>& optionVec,
+                                        const re2::RE2::Set& regexSet);
     LogFilter() {}
 
     ~LogFilter() {
@@ -65,6 +85,9 @@ public:
     std::vector<int32_t>
     Filter(const sls_logs::LogGroup& logGroup, BaseFilterNodePtr node, const LogGroupContext& context);
 
+    std::vector<int32_t>
+    Filter(const sls_logs::LogGroup& logGroup, const LogFilterProgram& program, const LogGroupContext& context);
+
     static void CastSensitiveWords(sls_logs::LogGroup& logGroup, const Config* pConfig);
 
 #ifdef APSARA_UNIT_TEST_MAIN
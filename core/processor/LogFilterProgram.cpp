@@ -0,0 +1,369 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "LogFilterProgram.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <set>
+#include "BinaryFilterOperatorNode.h"
+#include "UnaryFilterOperatorNode.h"
+#include "RegexFilterValueNode.h"
+#include "common/util.h"
+#include "app_config/AppConfig.h"
+#include "profiler/LogtailAlarm.h"
+#include "logger/Logger.h"
+
+namespace logtail {
+
+namespace {
+
+    const int32_t kAccept = -1;
+    const int32_t kReject = -2;
+    const int32_t kUnresolvedSlot = -2;
+
+    const int32_t kCheapCost = 1;
+    const int32_t kRegexCost = 16;
+
+    bool IsRegexMetaChar(char c) { return strchr("\\^$.|?*+()[]{}", c) != NULL; }
+
+    bool IsLiteral(const std::string& exp, size_t len) {
+        for (size_t i = 0; i < len; ++i) {
+            if (exp[i] == '\0' || IsRegexMetaChar(exp[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int32_t FindContent(const sls_logs::Log& log, const std::string& key) {
+        for (int i = 0; i < log.contents_size(); ++i) {
+            if (log.contents(i).key() == key) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    bool IsLiteralPrefix(const std::string& exp) {
+        return exp.size() >= 2 && exp.compare(exp.size() - 2, 2, ".*") == 0 && IsLiteral(exp, exp.size() - 2);
+    }
+
+    // IsCheapRegex returns true if @regex can be matched without regex engine.
+    bool IsCheapRegex(const boost::regex& regex) {
+        if (regex.flags() != boost::regex::normal) {
+            return false;
+        }
+        const std::string exp = regex.str();
+        return exp == ".*" || IsLiteral(exp, exp.size()) || IsLiteralPrefix(exp);
+    }
+
+} // namespace
+
+void LogFilterProgram::Reset() {
+    mKeys.clear();
+    mMatchers.clear();
+    mInstructions.clear();
+    mEntry = kAccept;
+}
+
+bool LogFilterProgram::Compile(const BaseFilterNodePtr& root) {
+    Reset();
+    mAlarmIfParseAlarmValid = true;
+    bool valid = true;
+    if (!root) {
+        return true;
+    }
+    mEntry = CompileNode(root, kAccept, kReject, valid);
+    if (!valid) {
+        Reset();
+    }
+    return valid;
+}
+
+bool LogFilterProgram::Compile(const std::vector<std::string>& keys, const std::vector<boost::regex>& regs) {
+    Reset();
+    mAlarmIfParseAlarmValid = false;
+    if (keys.size() != regs.size()) {
+        return false;
+    }
+    // Rules are ANDed in order, the first rule is the entry.
+    int32_t next = kAccept;
+    for (size_t i = keys.size(); i > 0; --i) {
+        next = AddInstruction(AddSlot(keys[i - 1]), AddMatcher(regs[i - 1]), next, kReject);
+    }
+    mEntry = next;
+    return true;
+}
+
+int32_t LogFilterProgram::AddSlot(const std::string& key) {
+    for (size_t i = 0; i < mKeys.size(); ++i) {
+        if (mKeys[i] == key) {
+            return static_cast<int32_t>(i);
+        }
+    }
+    mKeys.push_back(key);
+    return static_cast<int32_t>(mKeys.size() - 1);
+}
+
+int32_t LogFilterProgram::AddMatcher(const boost::regex& regex) {
+    Matcher matcher;
+    const std::string exp = regex.str();
+    if (!IsCheapRegex(regex)) {
+        matcher.type = MATCH_REGEX;
+        matcher.regex = regex;
+    } else if (exp == ".*") {
+        matcher.type = MATCH_ANY;
+    } else if (IsLiteral(exp, exp.size())) {
+        matcher.type = MATCH_LITERAL;
+        matcher.literal = exp;
+    } else {
+        matcher.type = MATCH_PREFIX;
+        matcher.literal = exp.substr(0, exp.size() - 2);
+    }
+    mMatchers.push_back(matcher);
+    return static_cast<int32_t>(mMatchers.size() - 1);
+}
+
+int32_t LogFilterProgram::AddInstruction(int32_t slot, int32_t matcher, int32_t onTrue, int32_t onFalse) {
+    mInstructions.push_back(Instruction{slot, matcher, onTrue, onFalse});
+    return static_cast<int32_t>(mInstructions.size() - 1);
+}
+
+int32_t LogFilterProgram::GetCost(const BaseFilterNodePtr& node, bool& valid) const {
+    if (!node) {
+        return 0;
+    }
+    if (auto binary = dynamic_cast<const BinaryFilterOperatorNode*>(node.get())) {
+        return GetCost(binary->GetLeft(), valid) + GetCost(binary->GetRight(), valid);
+    }
+    if (auto unary = dynamic_cast<const UnaryFilterOperatorNode*>(node.get())) {
+        return GetCost(unary->GetChild(), valid);
+    }
+    if (auto value = dynamic_cast<const RegexFilterValueNode*>(node.get())) {
+        return IsCheapRegex(value->GetRegex()) ? kCheapCost : kRegexCost;
+    }
+    valid = false;
+    return 0;
+}
+
+int32_t LogFilterProgram::CompileNode(const BaseFilterNodePtr& node, int32_t onTrue, int32_t onFalse, bool& valid) {
+    if (auto binary = dynamic_cast<const BinaryFilterOperatorNode*>(node.get())) {
+        BaseFilterNodePtr first = binary->GetLeft();
+        BaseFilterNodePtr second = binary->GetRight();
+        // BinaryFilterOperatorNode is false if any operand is missing.
+        if (!first || !second
+            || (binary->GetOperator() != AND_OPERATOR && binary->GetOperator() != OR_OPERATOR)) {
+            return onFalse;
+        }
+        if (GetCost(second, valid) < GetCost(first, valid)) {
+            first.swap(second);
+        }
+        // Operands are compiled backwards, so the second is the jump target of the first.
+        if (binary->GetOperator() == AND_OPERATOR) {
+            int32_t secondEntry = CompileNode(second, onTrue, onFalse, valid);
+            return CompileNode(first, secondEntry, onFalse, valid);
+        }
+        int32_t secondEntry = CompileNode(second, onTrue, onFalse, valid);
+        return CompileNode(first, onTrue, secondEntry, valid);
+    }
+    if (auto unary = dynamic_cast<const UnaryFilterOperatorNode*>(node.get())) {
+        if (!unary->GetChild()) {
+            return onFalse;
+        }
+        return CompileNode(unary->GetChild(), onFalse, onTrue, valid);
+    }
+    if (auto value = dynamic_cast<const RegexFilterValueNode*>(node.get())) {
+        return AddInstruction(AddSlot(value->GetKey()), AddMatcher(value->GetRegex()), onTrue, onFalse);
+    }
+    valid = false;
+    return onFalse;
+}
+
+bool LogFilterProgram::MatchValue(const Matcher& matcher,
+                                  const std::string& value,
+                                  const LogGroupContext& context) const {
+    // Values are matched as C strings like BoostRegexMatch does.
+    switch (matcher.type) {
+        case MATCH_ANY:
+            return true;
+        case MATCH_LITERAL:
+            return value.compare(0, matcher.literal.size(), matcher.literal) == 0
+                && (value.size() == matcher.literal.size() || value[matcher.literal.size()] == '\0');
+        case MATCH_PREFIX:
+            return value.compare(0, matcher.literal.size(), matcher.literal) == 0;
+        default:
+            break;
+    }
+    std::string exception;
+    bool result = BoostRegexMatch(value.c_str(), matcher.regex, exception);
+    if (!result && !exception.empty()
+        && (!mAlarmIfParseAlarmValid || AppConfig::GetInstance()->IsLogParseAlarmValid())) {
+        LOG_ERROR(sLogger, ("regex_match in Filter fail", exception));
+        if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
+            context.SendAlarm(REGEX_MATCH_ALARM, "regex_match in Filter fail:" + exception);
+        }
+    }
+    return result;
+}
+
+bool LogFilterProgram::Match(const sls_logs::Log& log,
+                             const LogGroupContext& context,
+                             std::vector<int32_t>& slotIndexes) const {
+    std::fill(slotIndexes.begin(), slotIndexes.end(), kUnresolvedSlot);
+    int32_t pc = mEntry;
+    while (pc >= 0) {
+        const Instruction& instruction = mInstructions[pc];
+        int32_t& index = slotIndexes[instruction.slot];
+        if (index == kUnresolvedSlot) {
+            index = FindContent(log, mKeys[instruction.slot]);
+        }
+        // Missing key is false as RegexFilterValueNode.
+        bool result = index >= 0 && MatchValue(mMatchers[instruction.matcher], log.contents(index).value(), context);
+        pc = result ? instruction.onTrue : instruction.onFalse;
+    }
+    return pc == kAccept;
+}
+
+std::vector<std::pair<std::string, std::string>> LogFilterProgram::GetRequiredLiterals() const {
+    typedef std::set<std::pair<std::string, std::string>> LiteralSet;
+    // Required literals from each instruction to accept, reject is the universal set.
+    struct Required {
+        bool all;
+        LiteralSet literals;
+    };
+    if (mEntry < 0) {
+        return std::vector<std::pair<std::string, std::string>>();
+    }
+    const Required accept{false, LiteralSet()};
+    const Required reject{true, LiteralSet()};
+    std::vector<Required> required(mEntry + 1);
+    auto get = [&](int32_t pc) -> const Required& {
+        return pc == kAccept ? accept : (pc == kReject ? reject : required[pc]);
+    };
+    // Jump targets are always before the instruction.
+    for (int32_t pc = 0; pc <= mEntry; ++pc) {
+        const Instruction& instruction = mInstructions[pc];
+        const Matcher& matcher = mMatchers[instruction.matcher];
+        Required onTrue = get(instruction.onTrue);
+        if (!onTrue.all && (matcher.type == MATCH_LITERAL || matcher.type == MATCH_PREFIX)
+            && !matcher.literal.empty()) {
+            onTrue.literals.emplace(mKeys[instruction.slot], matcher.literal);
+        }
+        const Required& onFalse = get(instruction.onFalse);
+        if (onTrue.all) {
+            required[pc] = onFalse;
+        } else if (onFalse.all) {
+            required[pc] = onTrue;
+        } else {
+            required[pc].all = false;
+            std::set_intersection(onTrue.literals.begin(),
+                                  onTrue.literals.end(),
+                                  onFalse.literals.begin(),
+                                  onFalse.literals.end(),
+                                  std::inserter(required[pc].literals, required[pc].literals.end()));
+        }
+    }
+    if (required[mEntry].all) {
+        return std::vector<std::pair<std::string, std::string>>();
+    }
+    return std::vector<std::pair<std::string, std::string>>(required[mEntry].literals.begin(),
+                                                            required[mEntry].literals.end());
+}
+
+void LogFilterProgram::MatchColumn(const Matcher& matcher,
+                                   const std::vector<const std::string*>& column,
+                                   std::vector<uint8_t>& results,
+                                   const LogGroupContext& context) const {
+    results.resize(column.size());
+    const size_t size = matcher.literal.size();
+    switch (matcher.type) {
+        case MATCH_ANY:
+            for (size_t i = 0; i < column.size(); ++i) {
+                results[i] = column[i] != NULL;
+            }
+            break;
+        case MATCH_PREFIX:
+            for (size_t i = 0; i < column.size(); ++i) {
+                results[i] = column[i] != NULL && column[i]->compare(0, size, matcher.literal) == 0;
+            }
+            break;
+        default:
+            for (size_t i = 0; i < column.size(); ++i) {
+                results[i] = column[i] != NULL && MatchValue(matcher, *column[i], context);
+            }
+            break;
+    }
+}
+
+std::vector<int32_t> LogFilterProgram::Filter(const sls_logs::LogGroup& logGroup,
+                                              const LogGroupContext& context) const {
+    const int32_t logCount = logGroup.logs_size();
+    std::vector<int32_t> index;
+    if (mEntry == kReject) {
+        return index;
+    }
+    index.resize(logCount);
+    for (int32_t i = 0; i < logCount; ++i) {
+        index[i] = i;
+    }
+    if (mEntry == kAccept || logCount == 0) {
+        return index;
+    }
+
+    // Jump targets are always before the instruction, so instructions are evaluated
+    // from the entry down to 0, each one over all logs reaching it.
+    std::vector<std::vector<int32_t>> selections(mEntry + 1);
+    selections[mEntry].swap(index);
+    // Content index of each slot for each log, resolved by the first instruction reading it.
+    std::vector<std::vector<int32_t>> slotIndexes(mKeys.size());
+    std::vector<const std::string*> column;
+    std::vector<uint8_t> results;
+    for (int32_t pc = mEntry; pc >= 0; --pc) {
+        std::vector<int32_t>& selection = selections[pc];
+        if (selection.empty()) {
+            continue;
+        }
+        const Instruction& instruction = mInstructions[pc];
+        std::vector<int32_t>& contentIndexes = slotIndexes[instruction.slot];
+        if (contentIndexes.empty()) {
+            contentIndexes.assign(logCount, kUnresolvedSlot);
+        }
+        column.resize(selection.size());
+        for (size_t i = 0; i < selection.size(); ++i) {
+            const sls_logs::Log& log = logGroup.logs(selection[i]);
+            int32_t& contentIndex = contentIndexes[selection[i]];
+            if (contentIndex == kUnresolvedSlot) {
+                contentIndex = FindContent(log, mKeys[instruction.slot]);
+            }
+            // Missing key is false as RegexFilterValueNode.
+            column[i] = contentIndex >= 0 ? &log.contents(contentIndex).value() : NULL;
+        }
+        MatchColumn(mMatchers[instruction.matcher], column, results, context);
+        for (size_t i = 0; i < selection.size(); ++i) {
+            const int32_t next = results[i] ? instruction.onTrue : instruction.onFalse;
+            if (next >= 0) {
+                selections[next].push_back(selection[i]);
+            } else if (next == kAccept) {
+                index.push_back(selection[i]);
+            }
+        }
+        std::vector<int32_t>().swap(selection);
+    }
+    // Logs reach the end from different instructions.
+    std::sort(index.begin(), index.end());
+    return index;
+}
+
+} // namespace logtail
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/regex.hpp>
+#include "log_pb/sls_logs.pb.h"
+#include "common/LogGroupContext.h"
+#include "BaseFilterNode.h"
+
+namespace logtail {
+
+// LogFilterProgram is a filter compiled into a flat list of instructions, each one
+// matches a key against a prebuilt matcher and jumps to the next instruction by the
+// result, so AND/OR/NOT short-circuit without recursion or virtual calls.
+//
+// - Keys are interned into slots, each slot is looked up at most once per log.
+// - Regexes which are literals, literal prefixes or .* are matched without regex.
+// - Cheaper operands of AND/OR are evaluated first.
+class LogFilterProgram {
+public:
+    // Compile compiles the expression tree @root, returns false if it contains
+    // unknown nodes, the tree should be used directly then.
+    bool Compile(const BaseFilterNodePtr& root);
+
+    // Compile compiles AND of regex matches of @keys, @keys and @regs must have the same size.
+    bool Compile(const std::vector<std::string>& keys, const std::vector<boost::regex>& regs);
+
+    // Filter returns indexes of logs in @logGroup matching the program. Logs are
+    // evaluated in batch: each instruction gathers values of its key from all logs
+    // reaching it into a column, matches the column in one pass and forwards the
+    // selected logs to the next instructions.
+    std::vector<int32_t> Filter(const sls_logs::LogGroup& logGroup, const LogGroupContext& context) const;
+
+    // Match returns true if @log matches the program, @slotIndexes is the scratch
+    // with GetSlotCount() elements.
+    bool Match(const sls_logs::Log& log, const LogGroupContext& context, std::vector<int32_t>& slotIndexes) const;
+
+    // GetRequiredLiterals returns (key, literal) pairs, the value of key in every accepted log matches a
+    // literal or literal prefix, so the value contains the literal. They are from matches which every
+    // path to accept goes through with true, sorted by key, empty if the program has none or accepts all.
+    std::vector<std::pair<std::string, std::string>> GetRequiredLiterals() const;
+
+    // GetKeys returns keys the program reads from logs.
+    const std::vector<std::string>& GetKeys() const { return mKeys; }
+    size_t GetSlotCount() const { return mKeys.size(); }
+    size_t GetInstructionCount() const { return mInstructions.size(); }
+
+private:
+    enum MatcherType { MATCH_ANY, MATCH_LITERAL, MATCH_PREFIX, MATCH_REGEX };
+
+    struct Matcher {
+        MatcherType type;
+        std::string literal;
+        boost::regex regex;
+    };
+
+    struct Instruction {
+        int32_t slot;
+        int32_t matcher;
+        int32_t onTrue;
+        int32_t onFalse;
+    };
+
+    void Reset();
+    int32_t AddSlot(const std::string& key);
+    int32_t AddMatcher(const boost::regex& regex);
+    int32_t GetCost(const BaseFilterNodePtr& node, bool& valid) const;
+    // CompileNode appends instructions of @node and returns its entry, @onTrue/@onFalse are
+    // the entries to jump to by the result of @node.
+    int32_t CompileNode(const BaseFilterNodePtr& node, int32_t onTrue, int32_t onFalse, bool& valid);
+    int32_t AddInstruction(int32_t slot, int32_t matcher, int32_t onTrue, int32_t onFalse);
+    bool MatchValue(const Matcher& matcher, const std::string& value, const LogGroupContext& context) const;
+    // MatchColumn sets @results[i] to whether @column[i] matches, NULL values do not match.
+    void MatchColumn(const Matcher& matcher,
+                     const std::vector<const std::string*>& column,
+                     std::vector<uint8_t>& results,
+                     const LogGroupContext& context) const;
+
+    std::vector<std::string> mKeys;
+    std::vector<Matcher> mMatchers;
+    std::vector<Instruction> mInstructions;
+    int32_t mEntry = 0;
+    // Filter rules always report regex errors, expressions only if log parse alarm is valid.
+    bool mAlarmIfParseAlarmValid = false;
+};
+
+typedef std::shared_ptr<LogFilterProgram> LogFilterProgramPtr;
+
+} // namespace logtail
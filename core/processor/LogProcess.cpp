@@ -14,6 +14,11 @@
 
 #include "LogProcess.h"
 #include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <time.h>
 #include <sys/types.h>
 #if defined(__linux__)
@@ -21,12 +26,15 @@
 #include <unistd.h>
 #endif
 #include "common/Constants.h"
+#include "common/LineFeedScanner.h"
 #include "common/TimeUtil.h"
 #include "common/LogtailCommonFlags.h"
 #include "common/LogGroupContext.h"
 #include "plugin/LogtailPlugin.h"
 #include "reader/LogFileReader.h"
+#include "reader/LogBufferPool.h"
 #include "monitor/Monitor.h"
+#include "monitor/MetricRegistry.h"
 #include "parser/LogParser.h"
 #include "sdk/Client.h"
 #include "sender/Sender.h"
@@ -35,7 +43,10 @@
 #include "profiler/LogtailAlarm.h"
 #include "profiler/LogIntegrity.h"
 #include "profiler/LogLineCount.h"
+#include "profiler/IntegrityNotifier.h"
 #include "config/IntegrityConfig.h"
+#include "processor/ProcessPipeline.h"
+#include "processor/RepeatedLineTable.h"
 #include "app_config/AppConfig.h"
 #include "profiler/LogFileProfiler.h"
 #include "config_manager/ConfigManager.h"
@@ -43,12 +54,22 @@
 #include "aggregator/Aggregator.h"
 #include "fuse/FuseFileBlacklist.h"
 #include "common/LogFileCollectOffsetIndicator.h"
+#include "common/RuntimeUtil.h"
+#include "common/StageProfiler.h"
+#include "common/MemoryBudget.h"
+#include "common/ThreadAffinity.h"
 
 
 using namespace sls_logs;
 using namespace std;
 
+DECLARE_FLAG_BOOL(enable_process_thread_scaling);
+DECLARE_FLAG_INT32(process_thread_min_count);
+DECLARE_FLAG_INT32(process_thread_max_count);
 DEFINE_FLAG_INT32(process_buffer_count_upperlimit_perthread, "", 25);
+DEFINE_FLAG_BOOL(enable_process_queue_spill, "spill read buffers to local files if process queue is full", false);
+DEFINE_FLAG_STRING(process_queue_spill_dir, "dir of process queue spill files under execution dir", "process_spill");
+DEFINE_FLAG_INT32(process_queue_spill_max_size_mb, "max total size of process queue spill files, MB", 1024);
 DEFINE_FLAG_INT32(merge_send_packet_interval, "", 1);
 DEFINE_FLAG_INT32(debug_logprocess_queue_flag, "0 disable, 1 true, 2 false", 0);
 #if defined(_MSC_VER)
@@ -59,9 +80,491 @@ DEFINE_FLAG_BOOL(enable_chinese_tag_path, "Enable Chinese __tag__.__path__", tru
 #endif
 DEFINE_FLAG_STRING(raw_log_tag, "", "__raw__");
 DEFINE_FLAG_INT32(default_flush_merged_buffer_interval, "default flush merged buffer, seconds", 1);
+DEFINE_FLAG_INT32(process_thread_batch_size, "max buffers of the same logstore popped by process thread at once", 8);
+DEFINE_FLAG_INT32(process_log_group_arena_max_block_size, "max block size of arena for parsed log group", 256 * 1024);
+DEFINE_FLAG_INT32(process_parallel_parse_chunk_size,
+                  "buffers larger than it are split into chunks parsed by multiple process threads, 0 to disable",
+                  0);
+DEFINE_FLAG_BOOL(process_fused_split_parse,
+                 "parse single line logs while splitting the buffer, without building the line index",
+                 true);
+DEFINE_FLAG_BOOL(plugin_raw_log_batch_enable,
+                 "pass raw logs of the same config popped at once to plugin in one call, V2 mode only",
+                 false);
+DEFINE_FLAG_BOOL(process_filter_pushdown_enable,
+                 "drop lines without literals required by the filter of config before they are parsed",
+                 true);
+DEFINE_FLAG_INT32(process_repeated_line_max_distinct,
+                  "max distinct lines of a buffer tracked by collapse_repeated_lines, new lines after it are kept",
+                  4096);
+DEFINE_FLAG_INT32(process_log_to_metric_max_groups,
+                  "max groups of a window of log_to_metric, logs of new groups after it are counted as __other__",
+                  1000);
 
 namespace logtail {
 
+namespace {
+
+    const std::string TAG_DELIMITER = "^^^";
+    const std::string TAG_SEPARATOR = "~=~";
+    const std::string TAG_PREFIX = "__tag__:";
+
+    // BuildPluginTags builds tags passed to plugin in V2 mode, except the file offset which differs between buffers,
+    // __hostname__ will be added in plugin.
+    std::string BuildPluginTags(const std::string& logPath, const std::string& userDefinedId, LogFileReader* reader) {
+        std::string passingTags;
+        passingTags.append(TAG_PREFIX)
+            .append(LOG_RESERVED_KEY_PATH)
+            .append(TAG_SEPARATOR)
+            .append(logPath.substr(0, 511));
+        if (!userDefinedId.empty()) {
+            passingTags.append(TAG_DELIMITER)
+                .append(TAG_PREFIX)
+                .append(LOG_RESERVED_KEY_USER_DEFINED_ID)
+                .append(TAG_SEPARATOR)
+                .append(userDefinedId.substr(0, 99));
+        }
+        const std::vector<sls_logs::LogTag>& extraTags = reader->GetExtraTags();
+        for (size_t i = 0; i < extraTags.size(); ++i) {
+            passingTags.append(TAG_DELIMITER)
+                .append(TAG_PREFIX)
+                .append(extraTags[i].key())
+                .append(TAG_SEPARATOR)
+                .append(extraTags[i].value());
+        }
+        return passingTags;
+    }
+
+    // BuildLogTags builds tags added to every log group of the reader.
+    std::shared_ptr<const std::vector<sls_logs::LogTag>>
+    BuildLogTags(const std::string& logPath, const std::string& userDefinedId, LogFileReader* reader) {
+        std::shared_ptr<std::vector<sls_logs::LogTag>> logTags = std::make_shared<std::vector<sls_logs::LogTag>>();
+        const std::vector<sls_logs::LogTag>& extraTags = reader->GetExtraTags();
+        logTags->reserve(4 + extraTags.size());
+        sls_logs::LogTag logTag;
+        logTag.set_key(LOG_RESERVED_KEY_HOSTNAME);
+        logTag.set_value(LogFileProfiler::mHostname.substr(0, 99));
+        logTags->push_back(logTag);
+        logTag.set_key(LOG_RESERVED_KEY_PATH);
+        logTag.set_value(logPath.substr(0, 511));
+        logTags->push_back(logTag);
+
+        // zone info for ant
+        const std::string& alipayZone = AppConfig::GetInstance()->GetAlipayZone();
+        if (!alipayZone.empty()) {
+            logTag.set_key(LOG_RESERVED_KEY_ALIPAY_ZONE);
+            logTag.set_value(alipayZone);
+            logTags->push_back(logTag);
+        }
+
+        if (userDefinedId.size() > 0) {
+            logTag.set_key(LOG_RESERVED_KEY_USER_DEFINED_ID);
+            logTag.set_value(userDefinedId.substr(0, 99));
+            logTags->push_back(logTag);
+        }
+
+        logTags->insert(logTags->end(), extraTags.begin(), extraTags.end());
+        return logTags;
+    }
+
+    void AppendPluginOffsetTag(std::string& passingTags, int64_t offset) {
+        passingTags.append(TAG_DELIMITER)
+            .append(TAG_PREFIX)
+            .append(LOG_RESERVED_KEY_FILE_OFFSET)
+            .append(TAG_SEPARATOR)
+            .append(std::to_string(offset));
+    }
+
+    struct ParseLinesContext {
+        LogBuffer* logBuffer;
+        LogFileReader* logFileReader;
+        Config* config;
+        const std::vector<int32_t>& logIndex;
+        uint32_t lines;
+        // See ProcessPipeline::mRequiredLiterals.
+        const std::vector<std::string>& requiredLiterals;
+        bool collapseRepeatedLines;
+    };
+
+    struct ParseLinesStats {
+        uint64_t parseFailures = 0;
+        uint64_t regexMatchFailures = 0;
+        uint64_t parseTimeFailures = 0;
+        uint64_t historyFailures = 0;
+        uint64_t collapsedLines = 0;
+        std::string errorLine;
+
+        void Merge(ParseLinesStats& other) {
+            parseFailures += other.parseFailures;
+            regexMatchFailures += other.regexMatchFailures;
+            parseTimeFailures += other.parseTimeFailures;
+            historyFailures += other.historyFailures;
+            collapsedLines += other.collapsedLines;
+            if (errorLine.empty()) {
+                errorLine.swap(other.errorLine);
+            }
+        }
+    };
+
+    // Lines are parsed by readers in batches of kParseBatchLines, one virtual call for a batch.
+    const uint32_t kParseBatchLines = 64;
+
+    // LineParseState is kept between lines parsed into the same log group.
+    struct LineParseState {
+        LogLineParseState readerState;
+        int32_t successLogSize = 0;
+        // Lines parsed into the log group so far, NULL if repeats are not collapsed.
+        RepeatedLineTable* repeatedLines = NULL;
+    };
+
+    // BeginRepeatedLines makes @state collapse repeated lines with the table of current thread if enabled, the
+    // table holds lines of one log group only.
+    void BeginRepeatedLines(const ParseLinesContext& context, LineParseState& state) {
+        if (!context.collapseRepeatedLines) {
+            return;
+        }
+        static thread_local std::unique_ptr<RepeatedLineTable> sTable;
+        if (!sTable) {
+            const int32_t maxDistinct = std::max(1, INT32_FLAG(process_repeated_line_max_distinct));
+            sTable.reset(new RepeatedLineTable(static_cast<size_t>(maxDistinct)));
+        }
+        sTable->Clear();
+        state.repeatedLines = sTable.get();
+    }
+
+    // EndRepeatedLines adds the count of copies to each log whose line is repeated.
+    void EndRepeatedLines(LineParseState& state, LogGroup& logGroup, uint32_t& logGroupSize) {
+        if (state.repeatedLines == NULL) {
+            return;
+        }
+        for (const RepeatedLineTable::Entry& entry : state.repeatedLines->GetEntries()) {
+            if (entry.mRepeats > 0 && entry.mLogIndex >= 0 && entry.mLogIndex < logGroup.logs_size()) {
+                LogParser::AddLog(logGroup.mutable_logs(entry.mLogIndex),
+                                  LOG_RESERVED_KEY_REPEAT_COUNT,
+                                  std::to_string(entry.mRepeats + 1),
+                                  logGroupSize);
+            }
+        }
+        state.repeatedLines->Clear();
+        state.repeatedLines = NULL;
+    }
+
+    bool ContainsLiteral(const char* data, size_t size, const std::string& literal) {
+        const char* end = data + size;
+        const char first = literal[0];
+        for (const char* cur = data; static_cast<size_t>(end - cur) >= literal.size(); ++cur) {
+            cur = static_cast<const char*>(memchr(cur, first, end - cur - literal.size() + 1));
+            if (cur == NULL) {
+                return false;
+            }
+            if (memcmp(cur + 1, literal.data() + 1, literal.size() - 1) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // SelectLinesWithLiterals moves lines containing all @literals to the front of @offsets and @lengths,
+    // returns the count of them. Lines are searched over their bytes in file, NUL and line feed do not
+    // match any literal.
+    uint32_t SelectLinesWithLiterals(const char* buffer,
+                                     const std::vector<std::string>& literals,
+                                     int32_t* offsets,
+                                     int32_t* lengths,
+                                     uint32_t count) {
+        uint32_t selected = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            bool matched = true;
+            for (const std::string& literal : literals) {
+                if (!ContainsLiteral(buffer + offsets[i], static_cast<size_t>(lengths[i]), literal)) {
+                    matched = false;
+                    break;
+                }
+            }
+            if (matched) {
+                offsets[selected] = offsets[i];
+                lengths[selected] = lengths[i];
+                ++selected;
+            }
+        }
+        return selected;
+    }
+
+    // SelectNewLines moves lines which are not repeats of lines added to @table to the front of @offsets
+    // and @lengths, returns the count of them. @entries are their entries in @table, -1 if not added.
+    uint32_t SelectNewLines(const char* buffer,
+                            RepeatedLineTable& table,
+                            int32_t* offsets,
+                            int32_t* lengths,
+                            int32_t* entries,
+                            uint32_t count) {
+        uint32_t selected = 0;
+        for (uint32_t i = 0; i < count; ++i) {
+            const char* line = buffer + offsets[i];
+            // The line feed has been replaced by NUL, the last line of buffer has neither.
+            size_t size = static_cast<size_t>(lengths[i]);
+            if (size > 0 && line[size - 1] == '\0') {
+                --size;
+            }
+            int32_t entry = -1;
+            if (table.IsRepeat(line, size, entry)) {
+                continue;
+            }
+            offsets[selected] = offsets[i];
+            lengths[selected] = lengths[i];
+            entries[selected] = entry;
+            ++selected;
+        }
+        return selected;
+    }
+
+    // ParseLogLineBatch parses @count NUL-terminated lines at @offsets of buffer, @lengths are the bytes of
+    // lines in file (with line feed), used by exactly once positions. Lines rejected by required literals
+    // of the filter are dropped like filtered logs, so are repeats of previous lines if collapsed.
+    void ParseLogLineBatch(const ParseLinesContext& context,
+                           LineParseState& state,
+                           const int32_t* offsets,
+                           const int32_t* lengths,
+                           uint32_t count,
+                           LogGroup& logGroup,
+                           uint32_t& logGroupSize,
+                           ParseLinesStats& stats,
+                           std::vector<std::pair<uint64_t, size_t>>* positions) {
+        LogBuffer* logBuffer = context.logBuffer;
+        Config* config = context.config;
+        int32_t selectedOffsets[kParseBatchLines];
+        int32_t selectedLengths[kParseBatchLines];
+        int32_t entries[kParseBatchLines];
+        if (!context.requiredLiterals.empty() || state.repeatedLines != NULL) {
+            std::copy(offsets, offsets + count, selectedOffsets);
+            std::copy(lengths, lengths + count, selectedLengths);
+            offsets = selectedOffsets;
+            lengths = selectedLengths;
+        }
+        if (!context.requiredLiterals.empty()) {
+            count = SelectLinesWithLiterals(
+                logBuffer->buffer, context.requiredLiterals, selectedOffsets, selectedLengths, count);
+        }
+        if (state.repeatedLines != NULL && count > 0) {
+            const uint32_t newCount = SelectNewLines(
+                logBuffer->buffer, *state.repeatedLines, selectedOffsets, selectedLengths, entries, count);
+            stats.collapsedLines += count - newCount;
+            count = newCount;
+        }
+        if (count == 0) {
+            return;
+        }
+        LogLineParseResult results[kParseBatchLines];
+        context.logFileReader->ParseLogLines(
+            logBuffer->buffer, offsets, count, logGroup, state.readerState, logGroupSize, results);
+        for (uint32_t i = 0; i < count; ++i) {
+            const char* line = logBuffer->buffer + offsets[i];
+            const LogLineParseResult& result = results[i];
+            if (!result.mSuccess) {
+                ++stats.parseFailures;
+                if (result.mError == PARSE_LOG_REGEX_ERROR)
+                    ++stats.regexMatchFailures;
+                else if (result.mError == PARSE_LOG_TIMEFORMAT_ERROR)
+                    ++stats.parseTimeFailures;
+                else if (result.mError == PARSE_LOG_HISTORY_ERROR)
+                    ++stats.historyFailures;
+                if (stats.errorLine.empty())
+                    stats.errorLine = string(line);
+            }
+            // add source line, time zone is adjusted by parsers with offset of the reader
+            if (state.successLogSize >= result.mLogEnd) {
+                continue;
+            }
+            if (state.repeatedLines != NULL && entries[i] >= 0) {
+                state.repeatedLines->SetLogIndex(entries[i], state.successLogSize);
+            }
+            sls_logs::Log* logPtr = logGroup.mutable_logs(state.successLogSize);
+            if (logPtr != NULL) {
+                if (config->mUploadRawLog) {
+                    LogParser::AddLog(logPtr, config->mAdvancedConfig.mRawLogTag, line, logGroupSize);
+                }
+                if (AppConfig::GetInstance()->EnableLogTimeAutoAdjust()) {
+                    logPtr->set_time(logPtr->time() + GetTimeDelta());
+                }
+            }
+            state.successLogSize = result.mLogEnd;
+
+            if (positions != NULL || (config->mAdvancedConfig.mEnableLogPositionMeta && logPtr != NULL)) {
+                auto const fileOffset = logBuffer->beginOffset + offsets[i];
+                if (config->mAdvancedConfig.mEnableLogPositionMeta && logPtr != NULL) {
+                    auto content = logPtr->add_contents();
+                    content->set_key(LOG_RESERVED_KEY_FILE_OFFSET);
+                    content->set_value(std::to_string(fileOffset));
+                }
+
+                // Record log positions for exactly once.
+                if (positions != NULL) {
+                    positions->emplace_back(std::make_pair(fileOffset, static_cast<size_t>(lengths[i])));
+                }
+            }
+        }
+    }
+
+    // ParseLogLines parses lines [@begin, @end) of buffer into @logGroup, log positions
+    // are appended to @positions if it is not NULL.
+    void ParseLogLines(const ParseLinesContext& context,
+                       uint32_t begin,
+                       uint32_t end,
+                       LogGroup& logGroup,
+                       uint32_t& logGroupSize,
+                       ParseLinesStats& stats,
+                       std::vector<std::pair<uint64_t, size_t>>* positions) {
+        const std::vector<int32_t>& logIndex = context.logIndex;
+        const uint32_t lines = context.lines;
+        const int32_t bufferSize = context.logBuffer->bufferSize;
+        LineParseState state;
+        state.successLogSize = logGroup.logs_size();
+        BeginRepeatedLines(context, state);
+        int32_t lengths[kParseBatchLines];
+        for (uint32_t batchBegin = begin; batchBegin < end; batchBegin += kParseBatchLines) {
+            const uint32_t count = std::min(kParseBatchLines, end - batchBegin);
+            for (uint32_t k = 0; k < count; k++) {
+                const uint32_t i = batchBegin + k;
+                if (1 == lines) {
+                    lengths[k] = bufferSize;
+                } else if (i != lines - 1) {
+                    lengths[k] = logIndex[i + 1] - logIndex[i];
+                } else {
+                    lengths[k] = bufferSize - logIndex[i];
+                }
+            }
+            ParseLogLineBatch(
+                context, state, &logIndex[batchBegin], lengths, count, logGroup, logGroupSize, stats, positions);
+        }
+        EndRepeatedLines(state, logGroup, logGroupSize);
+    }
+
+    // SplitAndParseLogLines splits the buffer of a single line reader and parses lines in small batches as soon
+    // as their line feeds are found, so the lines are still in cache when parsed. It returns the count of lines.
+    uint32_t SplitAndParseLogLines(const ParseLinesContext& context,
+                                   LogGroup& logGroup,
+                                   uint32_t& logGroupSize,
+                                   ParseLinesStats& stats,
+                                   std::vector<std::pair<uint64_t, size_t>>* positions) {
+        char* buffer = context.logBuffer->buffer;
+        const char* bufferEnd = buffer + context.logBuffer->bufferSize;
+        LineParseState state;
+        state.successLogSize = logGroup.logs_size();
+        BeginRepeatedLines(context, state);
+        int32_t offsets[kParseBatchLines];
+        int32_t lengths[kParseBatchLines];
+        uint32_t count = 0;
+        uint32_t lines = 0;
+        char* begin = buffer;
+        while (true) {
+            char* lf = const_cast<char*>(FindLineFeed(begin, bufferEnd));
+            char* next = lf;
+            if (lf != bufferEnd) {
+                *lf = '\0';
+                ++next;
+            }
+            offsets[count] = static_cast<int32_t>(begin - buffer);
+            lengths[count] = static_cast<int32_t>(next - begin);
+            ++count;
+            ++lines;
+            if (count == kParseBatchLines || lf == bufferEnd) {
+                ParseLogLineBatch(context, state, offsets, lengths, count, logGroup, logGroupSize, stats, positions);
+                count = 0;
+            }
+            if (lf == bufferEnd) {
+                EndRepeatedLines(state, logGroup, logGroupSize);
+                return lines;
+            }
+            begin = next;
+        }
+    }
+
+    // GetParseChunkCount returns how many chunks the buffer should be split into,
+    // each chunk has at least process_parallel_parse_chunk_size bytes.
+    uint32_t GetParseChunkCount(int32_t threadCount, int32_t bufferSize, uint32_t lines) {
+        const int32_t chunkSize = INT32_FLAG(process_parallel_parse_chunk_size);
+        if (chunkSize <= 0 || threadCount <= 1 || bufferSize < 2 * chunkSize) {
+            return 1;
+        }
+        uint32_t count = static_cast<uint32_t>(std::min(threadCount, bufferSize / chunkSize));
+        return std::min(count, lines);
+    }
+
+    // ParseLogLinesInChunks splits lines into @chunkCount chunks of nearly equal bytes
+    // and parses them in parallel by process threads. Each chunk is parsed into its own
+    // log group on @arena, then logs are moved into @logGroup in line order.
+    void ParseLogLinesInChunks(LogProcess& process,
+                               const ParseLinesContext& context,
+                               uint32_t chunkCount,
+                               google::protobuf::Arena* arena,
+                               LogGroup& logGroup,
+                               uint32_t& logGroupSize,
+                               ParseLinesStats& stats,
+                               std::vector<std::pair<uint64_t, size_t>>* positions) {
+        struct ParseChunk {
+            uint32_t begin;
+            uint32_t end;
+            LogGroup* logGroup;
+            uint32_t logGroupSize;
+            ParseLinesStats stats;
+            std::vector<std::pair<uint64_t, size_t>> positions;
+        };
+        const std::vector<int32_t>& logIndex = context.logIndex;
+        const int32_t bufferSize = context.logBuffer->bufferSize;
+        std::vector<ParseChunk> chunks(chunkCount);
+        uint32_t begin = 0;
+        for (uint32_t i = 0; i < chunkCount; ++i) {
+            uint32_t end = context.lines;
+            if (i + 1 < chunkCount) {
+                const int32_t offset = static_cast<int32_t>(static_cast<int64_t>(bufferSize) * (i + 1) / chunkCount);
+                end = std::lower_bound(logIndex.begin() + begin + 1, logIndex.begin() + context.lines, offset)
+                    - logIndex.begin();
+                // Leave at least one line for each of the remaining chunks.
+                end = std::min(end, context.lines - (chunkCount - i - 1));
+            }
+            chunks[i].begin = begin;
+            chunks[i].end = end;
+            chunks[i].logGroup = google::protobuf::Arena::CreateMessage<LogGroup>(arena);
+            chunks[i].logGroupSize = 0;
+            begin = end;
+        }
+
+        std::vector<std::function<void()>> tasks;
+        tasks.reserve(chunkCount);
+        for (auto& chunk : chunks) {
+            ParseChunk* chunkPtr = &chunk;
+            tasks.emplace_back([&context, chunkPtr, positions]() {
+                ParseLogLines(context,
+                              chunkPtr->begin,
+                              chunkPtr->end,
+                              *chunkPtr->logGroup,
+                              chunkPtr->logGroupSize,
+                              chunkPtr->stats,
+                              positions != NULL ? &chunkPtr->positions : NULL);
+            });
+        }
+        process.RunParseChunks(tasks);
+
+        for (auto& chunk : chunks) {
+            auto* logs = chunk.logGroup->mutable_logs();
+            const int logCount = logs->size();
+            if (logCount > 0) {
+                std::vector<sls_logs::Log*> extracted(logCount);
+                logs->UnsafeArenaExtractSubrange(0, logCount, extracted.data());
+                for (sls_logs::Log* log : extracted) {
+                    logGroup.mutable_logs()->UnsafeArenaAddAllocated(log);
+                }
+            }
+            logGroupSize += chunk.logGroupSize;
+            stats.Merge(chunk.stats);
+            if (positions != NULL) {
+                positions->insert(positions->end(), chunk.positions.begin(), chunk.positions.end());
+            }
+        }
+    }
+
+} // namespace
+
 LogProcess::LogProcess() : mAccessProcessThreadRWL(ReadWriteLock::PREFER_WRITER) {
     size_t concurrencyCount = (size_t)AppConfig::GetInstance()->GetSendRequestConcurrency();
     if (concurrencyCount < 20) {
@@ -93,18 +596,57 @@ void LogProcess::Start() {
     mInitialized = true;
     Sender::Instance()->SetFeedBackInterface(&mLogFeedbackQueue);
     mThreadCount = AppConfig::GetInstance()->GetProcessThreadCount();
+    if (BOOL_FLAG(enable_process_thread_scaling)) {
+        // Threads of the max count are created, the ones not active are parked.
+        mThreadScaler.reset(new ProcessThreadScaler(std::min(INT32_FLAG(process_thread_min_count), mThreadCount),
+                                                    std::max(INT32_FLAG(process_thread_max_count), mThreadCount),
+                                                    mThreadCount));
+        mThreadCount = mThreadScaler->GetMaxCount();
+        mActiveThreadCount = mThreadScaler->GetCount();
+        LOG_INFO(sLogger,
+                 ("scale process threads, min", mThreadScaler->GetMinCount())("max", mThreadCount)(
+                     "initial", mActiveThreadCount.load()));
+    } else {
+        mActiveThreadCount = mThreadCount;
+    }
+    if (BOOL_FLAG(enable_process_queue_spill)) {
+        mQueueSpill.reset(new ProcessQueueSpill(GetProcessExecutionDir() + STRING_FLAG(process_queue_spill_dir),
+                                                INT32_FLAG(process_queue_spill_max_size_mb) * 1024ULL * 1024ULL));
+    }
     // mBufferCountLimit = INT32_FLAG(process_buffer_count_upperlimit_perthread) * mThreadCount;
     mProcessThreads = new ThreadPtr[mThreadCount];
     mThreadFlags = new bool[mThreadCount];
+    IntegrityNotifier::GetInstance()->Start();
     for (int32_t threadNo = 0; threadNo < mThreadCount; ++threadNo)
         mProcessThreads[threadNo] = CreateThread([this, threadNo]() { ProcessLoop(threadNo); });
 }
 
+bool LogProcess::PushToQueue(const LogstoreFeedBackKey& logstoreKey, LogBuffer* buffer) {
+    if (!mLogFeedbackQueue.PushItem(logstoreKey, buffer)) {
+        return false;
+    }
+    MemoryBudget::Add(MEMORY_COMPONENT_PROCESS_QUEUE, buffer->bufferSize);
+    return true;
+}
+
+void LogProcess::RestoreSpilledBuffers(const LogstoreFeedBackKey& logstoreKey) {
+    mQueueSpill->Restore(
+        logstoreKey,
+        [this, &logstoreKey]() { return mLogFeedbackQueue.IsValidToPush(logstoreKey); },
+        [this, &logstoreKey](LogBuffer* buffer) { return PushToQueue(logstoreKey, buffer); });
+}
+
 bool LogProcess::PushBuffer(LogBuffer* buffer, int32_t retryTimes) {
+    const LogstoreFeedBackKey logstoreKey = buffer->logFileReader->GetLogstoreKey();
+    const ProcessQueueSpill::PushFunc push
+        = [this, &logstoreKey](LogBuffer* item) { return PushToQueue(logstoreKey, item); };
     int32_t retry = 0;
     while (true) {
         retry++;
-        if (!mLogFeedbackQueue.PushItem((buffer->logFileReader)->GetLogstoreKey(), buffer)) {
+        const bool pushed = mQueueSpill
+            ? mQueueSpill->PushOrSpill(logstoreKey, buffer, mLogFeedbackQueue.IsValidToPush(logstoreKey), push)
+            : PushToQueue(logstoreKey, buffer);
+        if (!pushed) {
             if (retry % 100 == 0) {
                 LOG_ERROR(sLogger,
                           ("Push log process buffer queue failed", ToString(buffer->bufferSize))(
@@ -125,6 +667,12 @@ bool LogProcess::IsValidToReadLog(const LogstoreFeedBackKey& logstoreKey) {
     if (INT32_FLAG(debug_logprocess_queue_flag) > 0) {
         return INT32_FLAG(debug_logprocess_queue_flag) == 1;
     }
+    if (MemoryBudget::IsReadBlocked()) {
+        return false;
+    }
+    if (mQueueSpill && mQueueSpill->CanSpill()) {
+        return true;
+    }
     return mLogFeedbackQueue.IsValidToPush(logstoreKey);
 }
 
@@ -141,6 +689,10 @@ void LogProcess::DeletePriorityWithHoldOn(const LogstoreFeedBackKey& logstoreKey
     mLogFeedbackQueue.DeletePriorityNoLock(logstoreKey);
 }
 
+void LogProcess::SetCpuQuotaWithHoldOn(const LogstoreFeedBackKey& logstoreKey, int32_t percent) {
+    mLogFeedbackQueue.GetCpuQuotas().Set(logstoreKey, percent);
+}
+
 void LogProcess::HoldOn() {
     mAccessProcessThreadRWL.lock();
     mLogFeedbackQueue.Lock();
@@ -195,8 +747,89 @@ bool LogProcess::FlushOut(int32_t waitMs) {
     return false;
 }
 
+void LogProcess::ScaleThreads(int32_t curTime) {
+    int32_t invalidCount = 0;
+    int32_t totalCount = 0;
+    int32_t eoInvalidCount = 0;
+    int32_t eoTotalCount = 0;
+    mLogFeedbackQueue.GetStatus(invalidCount, totalCount, eoInvalidCount, eoTotalCount);
+    const uint64_t popCount = mPopCount.exchange(0);
+    const uint64_t latencySum = mPopLatencySumMs.exchange(0);
+    const double latencyMs = popCount > 0 ? static_cast<double>(latencySum) / popCount : 0.0;
+    const int32_t count = mThreadScaler->Update(invalidCount + eoInvalidCount,
+                                                totalCount + eoTotalCount,
+                                                latencyMs,
+                                                LogtailMonitor::Instance()->GetRealtimeCpuLevel(),
+                                                curTime);
+    if (count != mActiveThreadCount.load()) {
+        std::lock_guard<std::mutex> lock(mParkMux);
+        mActiveThreadCount = count;
+        mParkCond.notify_all();
+    }
+}
+
+bool LogProcess::ParkIfInactive(int32_t threadNo) {
+    if (threadNo < mActiveThreadCount.load()) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(mParkMux);
+    mParkCond.wait(lock, [this, threadNo]() { return threadNo < mActiveThreadCount.load(); });
+    return true;
+}
+
+bool LogProcess::RunChunkTask() {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mChunkTaskMux);
+        if (mChunkTasks.empty()) {
+            return false;
+        }
+        task = std::move(mChunkTasks.front());
+        mChunkTasks.pop_front();
+    }
+    task();
+    return true;
+}
+
+void LogProcess::RunParseChunks(std::vector<std::function<void()>>& tasks) {
+    if (tasks.empty()) {
+        return;
+    }
+    // Shared with helpers, the last helper may still hold it after the caller returns.
+    struct ChunkLatch {
+        std::mutex mux;
+        std::condition_variable cv;
+        size_t pending = 0;
+    };
+    std::shared_ptr<ChunkLatch> latch = std::make_shared<ChunkLatch>();
+    latch->pending = tasks.size() - 1;
+    {
+        std::lock_guard<std::mutex> lock(mChunkTaskMux);
+        for (size_t i = 1; i < tasks.size(); ++i) {
+            std::function<void()>* task = &tasks[i];
+            mChunkTasks.emplace_back([task, latch]() {
+                (*task)();
+                std::lock_guard<std::mutex> latchLock(latch->mux);
+                if (--latch->pending == 0) {
+                    latch->cv.notify_one();
+                }
+            });
+        }
+    }
+    for (size_t i = 1; i < tasks.size(); ++i) {
+        mLogFeedbackQueue.Signal();
+    }
+    tasks[0]();
+    // Help to drain pending chunks, including those of other threads.
+    while (RunChunkTask()) {
+    }
+    std::unique_lock<std::mutex> lock(latch->mux);
+    latch->cv.wait(lock, [&latch]() { return latch->pending == 0; });
+}
+
 void* LogProcess::ProcessLoop(int32_t threadNo) {
     LOG_DEBUG(sLogger, ("LogProcessThread", "Start")("threadNo", threadNo));
+    ThreadAffinity::GetInstance()->BindCurrentThread(THREAD_ROLE_PROCESS, threadNo);
     LogstoreFeedBackKey logstoreKey = 0;
     static int32_t lastMergeTime = 0;
     static atomic_int s_processCount{0};
@@ -204,32 +837,52 @@ void* LogProcess::ProcessLoop(int32_t threadNo) {
     static atomic_int s_processLines{0};
     // only thread 0 update metric
     int32_t lastUpdateMetricTime = time(NULL);
-    int localTimeZoneOffsetSecond = GetLocalTimeZoneOffsetSecond();
-    LOG_INFO(sLogger, ("local timezone offset second", localTimeZoneOffsetSecond));
 #ifdef LOGTAIL_DEBUG_FLAG
     int32_t lastPrintTime = time(NULL);
     uint64_t processCount = 0;
     uint64_t waitTime = 0;
     uint64_t waitCount = 0;
 #endif
+    std::vector<LogBuffer*> logBuffers;
+    google::protobuf::ArenaOptions arenaOptions;
+    arenaOptions.start_block_size = 4 * 1024;
+    arenaOptions.max_block_size = INT32_FLAG(process_log_group_arena_max_block_size);
     while (true) {
-        LogBuffer* logBuffer = NULL;
         mThreadFlags[threadNo] = false;
 
         int32_t curTime = time(NULL);
         if (threadNo == 0 && curTime - lastMergeTime >= INT32_FLAG(default_flush_merged_buffer_interval)) {
             lastMergeTime = curTime;
             static Aggregator* aggregator = Aggregator::GetInstance();
+            aggregator->FlushLogToMetric();
             aggregator->FlushReadyBuffer();
         }
 
         if (threadNo == 0 && curTime - lastUpdateMetricTime >= 40) {
+            static MetricRegistry* sRegistry = MetricRegistry::GetInstance();
+            static MetricGauge* sProcessTps = sRegistry->RegisterGauge("process_tps");
+            static MetricGauge* sProcessBytesPs = sRegistry->RegisterGauge("process_bytes_ps");
+            static MetricGauge* sProcessLinesPs = sRegistry->RegisterGauge("process_lines_ps");
+            static MetricGauge* sProcessQueueFull = sRegistry->RegisterGauge("process_queue_full");
+            static MetricGauge* sProcessQueueTotal = sRegistry->RegisterGauge("process_queue_total");
+            static MetricGauge* sPoolHit = sRegistry->RegisterGauge("read_buffer_pool_hit");
+            static MetricGauge* sPoolMiss = sRegistry->RegisterGauge("read_buffer_pool_miss");
+            static MetricGauge* sPoolResidentBytes = sRegistry->RegisterGauge("read_buffer_pool_resident_bytes");
+            static MetricGauge* sActiveThreadCount = sRegistry->RegisterGauge("process_thread_active_count");
+            static MetricGauge* sCpuThrottled = sRegistry->RegisterGauge("process_cpu_quota_throttled");
             static auto sMonitor = LogtailMonitor::Instance();
 
+            sActiveThreadCount->Set(mActiveThreadCount.load());
+            if (mQueueSpill) {
+                static MetricGauge* sSpilledBytes = sRegistry->RegisterGauge("process_queue_spilled_bytes");
+                static MetricGauge* sSpilledCount = sRegistry->RegisterGauge("process_queue_spilled_count");
+                sSpilledBytes->Set(mQueueSpill->GetSpilledBytes());
+                sSpilledCount->Set(mQueueSpill->GetSpilledCount());
+            }
             // atomic counter will be negative if process speed is too fast.
-            sMonitor->UpdateMetric("process_tps", 1.0 * s_processCount / (curTime - lastUpdateMetricTime));
-            sMonitor->UpdateMetric("process_bytes_ps", 1.0 * s_processBytes / (curTime - lastUpdateMetricTime));
-            sMonitor->UpdateMetric("process_lines_ps", 1.0 * s_processLines / (curTime - lastUpdateMetricTime));
+            sProcessTps->Set(1.0 * s_processCount / (curTime - lastUpdateMetricTime));
+            sProcessBytesPs->Set(1.0 * s_processBytes / (curTime - lastUpdateMetricTime));
+            sProcessLinesPs->Set(1.0 * s_processLines / (curTime - lastUpdateMetricTime));
             lastUpdateMetricTime = curTime;
             s_processCount = 0;
             s_processBytes = 0;
@@ -241,27 +894,69 @@ void* LogProcess::ProcessLoop(int32_t threadNo) {
             int32_t eoInvalidCount = 0;
             int32_t eoTotalCount = 0;
             mLogFeedbackQueue.GetStatus(invalidCount, totalCount, eoInvalidCount, eoTotalCount);
-            sMonitor->UpdateMetric("process_queue_full", invalidCount);
-            sMonitor->UpdateMetric("process_queue_total", totalCount);
+            sProcessQueueFull->Set(invalidCount);
+            sProcessQueueTotal->Set(totalCount);
             if (eoTotalCount > 0) {
                 sMonitor->UpdateMetric("eo_process_queue_full", eoInvalidCount);
                 sMonitor->UpdateMetric("eo_process_queue_total", eoTotalCount);
             }
+
+            uint64_t poolHitCount = 0;
+            uint64_t poolMissCount = 0;
+            uint64_t poolResidentBytes = 0;
+            LogBufferPool::GetInstance()->GetStatus(poolHitCount, poolMissCount, poolResidentBytes);
+            sPoolHit->Set(poolHitCount);
+            sPoolMiss->Set(poolMissCount);
+            sPoolResidentBytes->Set(poolResidentBytes);
+            sCpuThrottled->Set(mLogFeedbackQueue.GetCpuQuotas().GetThrottledCount());
         }
 
         if (threadNo == 0) {
-            LogIntegrity::GetInstance()->SendLogIntegrityInfo();
-            LogLineCount::GetInstance()->SendLineCountData();
+            static IntegrityNotifier* sNotifier = IntegrityNotifier::GetInstance();
+            if (!sNotifier->IsStarted()) {
+                LogIntegrity::GetInstance()->SendLogIntegrityInfo();
+                LogLineCount::GetInstance()->SendLineCountData();
+            }
 
             DoFuseHandling();
         }
 
+        if (threadNo == 0 && mThreadScaler) {
+            ScaleThreads(curTime);
+        }
+        // Thread 0 is always active, it does the work above.
+        if (ParkIfInactive(threadNo)) {
+            continue;
+        }
+
+        // chunks of large buffers are parsed before popping new buffers
+        if (RunChunkTask()) {
+            continue;
+        }
+
         // if have no data, wait 100 ms for new data or timeout, then continue to check again
-        if (!mLogFeedbackQueue.CheckAndPopNextItem(
-                logstoreKey, logBuffer, Sender::Instance()->GetSenderFeedBackInterface(), threadNo, mThreadCount)) {
+        if (!mLogFeedbackQueue.CheckAndPopNextItems(logstoreKey,
+                                                    logBuffers,
+                                                    INT32_FLAG(process_thread_batch_size),
+                                                    Sender::Instance()->GetSenderFeedBackInterface(),
+                                                    threadNo,
+                                                    mActiveThreadCount.load())) {
             mLogFeedbackQueue.Wait(100);
             continue;
         }
+        const uint64_t popTimeInMs = mThreadScaler ? GetSteadyTimeInMilliSeconds() : 0;
+        for (LogBuffer* logBuffer : logBuffers) {
+            MemoryBudget::Sub(MEMORY_COMPONENT_PROCESS_QUEUE, logBuffer->bufferSize);
+            if (mThreadScaler && popTimeInMs > logBuffer->readTimeInMs) {
+                mPopLatencySumMs.fetch_add(popTimeInMs - logBuffer->readTimeInMs, std::memory_order_relaxed);
+            }
+        }
+        if (mQueueSpill) {
+            RestoreSpilledBuffers(logstoreKey);
+        }
+        if (mThreadScaler) {
+            mPopCount.fetch_add(logBuffers.size(), std::memory_order_relaxed);
+        }
 
 #ifdef LOGTAIL_DEBUG_FLAG
         ++processCount;
@@ -278,338 +973,334 @@ void* LogProcess::ProcessLoop(int32_t threadNo) {
         {
             ReadLock lock(mAccessProcessThreadRWL);
             mThreadFlags[threadNo] = true;
-            s_processCount++;
-            s_processBytes += (logBuffer->bufferSize);
-            LogFileReaderPtr logFileReader = logBuffer->logFileReader;
-            auto logPath = logFileReader->GetConvertedPath();
+            // Buffers of a batch are popped from one queue, CPU time of the batch is charged to its quota.
+            const LogstoreFeedBackKey batchKey = logBuffers.front()->logFileReader->GetLogstoreKey();
+            CpuQuotaTable& cpuQuotas = mLogFeedbackQueue.GetCpuQuotas();
+            const uint64_t batchCpuBeginNs = cpuQuotas.Empty() ? 0 : StageProfiler::GetThreadCpuTimeNs();
+            std::string configName;
+            Config* config = NULL;
+            std::shared_ptr<const ProcessPipeline> pipeline;
+            // Tags of buffers are built with it, it changes only when configs are updated.
+            const std::string userDefinedId = ConfigManager::GetInstance()->GetUserDefinedIdSet();
+            // Raw logs of the same config passed to plugin in one call, see plugin_raw_log_batch_enable.
+            std::string pluginConfigName;
+            std::vector<LogtailPlugin::PluginRawLog> pluginRawLogs;
+            std::vector<LogBuffer*> pluginBuffers;
+            auto flushPluginRawLogs = [&]() {
+                LogtailPlugin::GetInstance()->ProcessRawLogsV2(pluginConfigName, pluginRawLogs);
+                pluginRawLogs.clear();
+                for (LogBuffer* buffer : pluginBuffers) {
+                    delete buffer;
+                }
+                pluginBuffers.clear();
+            };
+            for (LogBuffer* logBuffer : logBuffers) {
+                s_processCount++;
+                s_processBytes += (logBuffer->bufferSize);
+                LogFileReaderPtr logFileReader = logBuffer->logFileReader;
+                auto logPath = logFileReader->GetConvertedPath();
 #if defined(_MSC_VER)
-            if (BOOL_FLAG(enable_chinese_tag_path)) {
-                logPath = EncodingConverter::GetInstance()->FromACPToUTF8(logPath);
-            }
+                if (BOOL_FLAG(enable_chinese_tag_path)) {
+                    logPath = EncodingConverter::GetInstance()->FromACPToUTF8(logPath);
+                }
 #endif
 
-            Config* config = ConfigManager::GetInstance()->FindConfigByName(logFileReader->GetConfigName());
-            if (config == NULL) {
-                LOG_INFO(sLogger,
-                         ("can not find config while processing log, maybe config updated. config",
-                          logFileReader->GetConfigName())("project", logFileReader->GetProjectName())(
-                             "logstore", logFileReader->GetCategory()));
-                delete[] logBuffer->buffer;
-                delete logBuffer;
-                continue;
-            }
-
-            // Mixed mode, pass buffer to plugin system.
-            if (logFileReader->GetPluginFlag()) {
-                if (!config->PassingTagsToPlugin()) // V1
-                {
-                    LogtailPlugin::GetInstance()->ProcessRawLog(logFileReader->GetConfigName(),
-                                                                logBuffer->buffer,
-                                                                logBuffer->bufferSize,
-                                                                logFileReader->GetSourceId(),
-                                                                logFileReader->GetTopicName());
-                } else // V2
-                {
-                    static const std::string TAG_DELIMITER = "^^^";
-                    static const std::string TAG_SEPARATOR = "~=~";
-                    static const std::string TAG_PREFIX = "__tag__:";
-
-                    // Collect tags to pass, __hostname__ will be added in plugin.
-                    std::string passingTags;
-                    passingTags.append(TAG_PREFIX)
-                        .append(LOG_RESERVED_KEY_PATH)
-                        .append(TAG_SEPARATOR)
-                        .append(logPath.substr(0, 511));
-
-                    std::string userDefinedId = ConfigManager::GetInstance()->GetUserDefinedIdSet();
-                    if (!userDefinedId.empty()) {
-                        passingTags.append(TAG_DELIMITER)
-                            .append(TAG_PREFIX)
-                            .append(LOG_RESERVED_KEY_USER_DEFINED_ID)
-                            .append(TAG_SEPARATOR)
-                            .append(userDefinedId.substr(0, 99));
-                    }
-                    const std::vector<sls_logs::LogTag>& extraTags = logFileReader->GetExtraTags();
-                    for (size_t i = 0; i < extraTags.size(); ++i) {
-                        passingTags.append(TAG_DELIMITER)
-                            .append(TAG_PREFIX)
-                            .append(extraTags[i].key())
-                            .append(TAG_SEPARATOR)
-                            .append(extraTags[i].value());
+                // Buffers in a batch usually belong to the same config, compile pipeline only when config changes.
+                Config* readerConfig = logFileReader->GetConfig();
+                if (readerConfig != config || readerConfig == NULL) {
+                    config = readerConfig;
+                    configName = logFileReader->GetConfigName();
+                    if (config != NULL) {
+                        // Configs not loaded by ConfigManager (tests) are compiled here.
+                        pipeline = config->mProcessPipeline ? config->mProcessPipeline
+                                                            : ProcessPipeline::Compile(*config);
                     }
+                }
+                if (config == NULL) {
+                    LOG_INFO(sLogger,
+                             ("can not find config while processing log, maybe config updated. config",
+                              logFileReader->GetConfigName())("project", logFileReader->GetProjectName())(
+                                 "logstore", logFileReader->GetCategory()));
+                    delete logBuffer;
+                    continue;
+                }
 
-                    if (config->mAdvancedConfig.mEnableLogPositionMeta) {
-                        passingTags.append(TAG_DELIMITER)
-                            .append(TAG_PREFIX)
-                            .append(LOG_RESERVED_KEY_FILE_OFFSET)
-                            .append(TAG_SEPARATOR)
-                            .append(std::to_string(logBuffer->beginOffset));
+                // Mixed mode, pass buffer to plugin system.
+                if (logFileReader->GetPluginFlag()) {
+                    if (pipeline->mPluginStage == ProcessPipeline::PLUGIN_STAGE_RAW_LOG) // V1
+                    {
+                        LogtailPlugin::GetInstance()->ProcessRawLog(logFileReader->GetConfigName(),
+                                                                    logBuffer->buffer,
+                                                                    logBuffer->bufferSize,
+                                                                    logFileReader->GetSourceId(),
+                                                                    logFileReader->GetTopicName());
+                    } else if (pipeline->mPluginStage == ProcessPipeline::PLUGIN_STAGE_RAW_LOGS_V2) // V2, batched
+                    {
+                        // Buffer is kept until the batch is passed.
+                        if (!pluginRawLogs.empty() && pluginConfigName != configName) {
+                            flushPluginRawLogs();
+                        }
+                        if (pluginRawLogs.empty()) {
+                            pluginConfigName = configName;
+                        }
+                        std::shared_ptr<const std::string> tags
+                            = logFileReader->GetCachedPluginTags(logPath, userDefinedId);
+                        if (!tags) {
+                            tags = std::make_shared<const std::string>(
+                                BuildPluginTags(logPath, userDefinedId, logFileReader.get()));
+                            logFileReader->SetCachedPluginTags(logPath, userDefinedId, tags);
+                        }
+                        if (pipeline->mAppendPositionMeta) {
+                            std::shared_ptr<std::string> tagsWithOffset = std::make_shared<std::string>(*tags);
+                            AppendPluginOffsetTag(*tagsWithOffset, logBuffer->beginOffset);
+                            tags = tagsWithOffset;
+                        }
+                        pluginRawLogs.push_back(LogtailPlugin::PluginRawLog{logBuffer->buffer,
+                                                                            logBuffer->bufferSize,
+                                                                            logFileReader->GetSourceId(),
+                                                                            logFileReader->GetTopicName(),
+                                                                            tags});
+                        pluginBuffers.push_back(logBuffer);
+                        continue;
+                    } else // V2
+                    {
+                        std::string passingTags = BuildPluginTags(logPath, userDefinedId, logFileReader.get());
+                        if (pipeline->mAppendPositionMeta) {
+                            AppendPluginOffsetTag(passingTags, logBuffer->beginOffset);
+                        }
+
+                        LogtailPlugin::GetInstance()->ProcessRawLogV2(logFileReader->GetConfigName(),
+                                                                      logBuffer->buffer,
+                                                                      logBuffer->bufferSize,
+                                                                      logFileReader->GetSourceId(),
+                                                                      logFileReader->GetTopicName(),
+                                                                      passingTags);
                     }
 
-                    LogtailPlugin::GetInstance()->ProcessRawLogV2(logFileReader->GetConfigName(),
-                                                                  logBuffer->buffer,
-                                                                  logBuffer->bufferSize,
-                                                                  logFileReader->GetSourceId(),
-                                                                  logFileReader->GetTopicName(),
-                                                                  passingTags);
+                    delete logBuffer;
+                    continue;
                 }
 
-                delete[] logBuffer->buffer;
-                delete logBuffer;
-                continue;
-            }
+                int32_t bufferSize = logBuffer->bufferSize;
+                char* buffer = logBuffer->buffer;
+                int32_t lineFeed = 0;
+                vector<int32_t> logIndex;
+                // Single line buffers parsed by this thread are split while parsed, see SplitAndParseLogLines.
+                const bool fusedSplitParse = BOOL_FLAG(process_fused_split_parse) && bufferSize > 0
+                    && logFileReader->IsSingleLineSplit()
+                    && GetParseChunkCount(mActiveThreadCount, bufferSize, std::numeric_limits<uint32_t>::max()) <= 1;
+                if (!fusedSplitParse) {
+                    StageProfileScope profileScope(configName, PROFILE_STAGE_SPLIT);
+                    logIndex = logFileReader->LogSplit(buffer, bufferSize, lineFeed, logBuffer->checkedLinesSize);
+                }
+
+                const string& projectName = config->GetProjectName();
+                const string& category = config->GetCategory();
+                // A non-empty buffer has at least one line, the real count is known after parsed if fused.
+                uint32_t lines = fusedSplitParse ? 1 : logIndex.size();
+                //////////////////////////////////////////////
+                // for profiling
+                uint64_t readBytes = bufferSize;
+                uint64_t skipBytes = 0;
+                uint64_t splitLines = lines;
+                uint64_t parseFailures = 0;
+                uint64_t regexMatchFailures = 0;
+                uint64_t parseTimeFailures = 0;
+                uint64_t historyFailures = 0;
+                uint64_t collapsedLines = 0;
+                uint64_t sendFailures = 0;
+                string errorLine;
+                //////////////////////////////////////////////
+
+                if (lines == 0) {
+                    if (AppConfig::GetInstance()->IsLogParseAlarmValid()) {
+                        if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
+                            LogtailAlarm::GetInstance()->SendAlarm(
+                                SPLIT_LOG_FAIL_ALARM,
+                                "split log lines fail, please check log_begin_regex, file:" + logPath
+                                    + ", logs:" + string(buffer, 0, 1024),
+                                projectName,
+                                category,
+                                config->mRegion);
+                        }
+                        LOG_ERROR(sLogger,
+                                  ("split log lines fail", "please check log_begin_regex")("file_name", logPath)(
+                                      "read bytes", readBytes)("first 1KB log", string(buffer, 0, 1024)));
+                    }
+                    // if not discard unmatch data, we add whole data block when data splitted fail
+                    if (pipeline->mKeepUnmatch) {
+                        logIndex.push_back(0);
+                        lines = 1;
+                    }
+                }
+                if (lines > 0) {
+                    // @debug
+                    // static int linesCount = 0;
+                    // linesCount += lines;
+                    // LOG_INFO(sLogger, ("Logprocess lines", lines)("Total lines", linesCount));
+                    // Logs and contents are allocated on arena and freed at once after the merge
+                    // items holding them are serialized by sender.
+                    std::shared_ptr<google::protobuf::Arena> arena(new google::protobuf::Arena(arenaOptions));
+                    LogGroup& logGroup = *google::protobuf::Arena::CreateMessage<LogGroup>(arena.get());
+                    uint32_t logGroupSize = 0;
+                    int32_t parseStartTime = (int32_t)time(NULL);
+                    ParseLinesContext parseContext{logBuffer,
+                                                   logFileReader.get(),
+                                                   config,
+                                                   logIndex,
+                                                   lines,
+                                                   pipeline->mRequiredLiterals,
+                                                   pipeline->mCollapseRepeatedLines};
+                    ParseLinesStats parseStats;
+                    std::vector<std::pair<uint64_t, size_t>>* positions
+                        = logBuffer->exactlyOnceCheckpoint ? &logBuffer->exactlyOnceCheckpoint->positions : NULL;
+                    const uint32_t chunkCount = GetParseChunkCount(mActiveThreadCount, bufferSize, lines);
+                    {
+                        // CPU time of chunks parsed by other threads is not counted.
+                        StageProfileScope profileScope(configName, PROFILE_STAGE_PARSE);
+                        if (fusedSplitParse) {
+                            lines = SplitAndParseLogLines(parseContext, logGroup, logGroupSize, parseStats, positions);
+                            lineFeed = static_cast<int32_t>(lines);
+                            splitLines = lines;
+                        } else if (chunkCount <= 1) {
+                            ParseLogLines(parseContext, 0, lines, logGroup, logGroupSize, parseStats, positions);
+                        } else {
+                            ParseLogLinesInChunks(*this,
+                                                  parseContext,
+                                                  chunkCount,
+                                                  arena.get(),
+                                                  logGroup,
+                                                  logGroupSize,
+                                                  parseStats,
+                                                  positions);
+                        }
+                    }
+                    // add lines count
+                    s_processLines += (lines);
+                    parseFailures = parseStats.parseFailures;
+                    regexMatchFailures = parseStats.regexMatchFailures;
+                    parseTimeFailures = parseStats.parseTimeFailures;
+                    historyFailures = parseStats.historyFailures;
+                    collapsedLines = parseStats.collapsedLines;
+                    errorLine.swap(parseStats.errorLine);
 
-            int32_t bufferSize = logBuffer->bufferSize;
-            char* buffer = logBuffer->buffer;
-            int32_t lineFeed = 0;
-            vector<int32_t> logIndex = logFileReader->LogSplit(buffer, bufferSize, lineFeed);
-
-            const string& projectName = config->GetProjectName();
-            const string& category = config->GetCategory();
-            ParseLogError error;
-            uint32_t lines = logIndex.size();
-            //////////////////////////////////////////////
-            // for profiling
-            uint64_t readBytes = bufferSize;
-            uint64_t skipBytes = 0;
-            uint64_t splitLines = lines;
-            uint64_t parseFailures = 0;
-            uint64_t regexMatchFailures = 0;
-            uint64_t parseTimeFailures = 0;
-            uint64_t historyFailures = 0;
-            uint64_t sendFailures = 0;
-            string errorLine;
-            //////////////////////////////////////////////
-
-            if (lines == 0) {
-                if (AppConfig::GetInstance()->IsLogParseAlarmValid()) {
-                    if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
+                    // check whether processing is too slow
+                    int32_t parseEndTime = (int32_t)time(NULL);
+                    if (parseEndTime - parseStartTime > 1) {
                         LogtailAlarm::GetInstance()->SendAlarm(
-                            SPLIT_LOG_FAIL_ALARM,
-                            "split log lines fail, please check log_begin_regex, file:" + logPath
-                                + ", logs:" + string(buffer, 0, 1024),
+                            PROCESS_TOO_SLOW_ALARM,
+                            string("parse ") + ToString(logGroup.logs_size()) + " logs, buffer size "
+                                + ToString(bufferSize) + "time used seconds : "
+                                + ToString(parseEndTime - parseStartTime),
                             projectName,
                             category,
                             config->mRegion);
+                        LOG_WARNING(sLogger,
+                                    ("process log too slow, parse logs", logGroup.logs_size())(
+                                        "buffer size", bufferSize)("time used seconds", parseEndTime - parseStartTime)(
+                                        "project", projectName)("logstore", category));
                     }
-                    LOG_ERROR(sLogger,
-                              ("split log lines fail", "please check log_begin_regex")("file_name", logPath)(
-                                  "read bytes", readBytes)("first 1KB log", string(buffer, 0, 1024)));
-                }
-                // if not discard unmatch data, we add whole data block when data splitted fail
-                if (!config->mDiscardUnmatch) {
-                    logIndex.push_back(0);
-                    lines = 1;
-                }
-            }
-            // add lines count
-            s_processLines += (lines);
-            if (lines > 0) {
-                // @debug
-                // static int linesCount = 0;
-                // linesCount += lines;
-                // LOG_INFO(sLogger, ("Logprocess lines", lines)("Total lines", linesCount));
-                LogGroup logGroup;
-                time_t lastLogLineTime = 0;
-                string lastLogTimeStr = "";
-                uint32_t logGroupSize = 0;
-                int32_t successLogSize = 0;
-                int32_t parseStartTime = (int32_t)time(NULL);
-                for (uint32_t i = 0; i < lines; i++) {
-                    bool successful = logFileReader->ParseLogLine(
-                        buffer + logIndex[i], logGroup, error, lastLogLineTime, lastLogTimeStr, logGroupSize);
-                    if (!successful) {
-                        ++parseFailures;
-                        if (error == PARSE_LOG_REGEX_ERROR)
-                            ++regexMatchFailures;
-                        else if (error == PARSE_LOG_TIMEFORMAT_ERROR)
-                            ++parseTimeFailures;
-                        else if (error == PARSE_LOG_HISTORY_ERROR)
-                            ++historyFailures;
-                        if (errorLine.empty())
-                            errorLine = string(buffer + logIndex[i]);
-                    }
-                    // add source line, time zone adjust
-                    if (successLogSize < logGroup.logs_size()) {
-                        sls_logs::Log* logPtr = logGroup.mutable_logs(successLogSize);
-                        if (logPtr != NULL) {
-                            if (config->mUploadRawLog) {
-                                LogParser::AddLog(
-                                    logPtr, config->mAdvancedConfig.mRawLogTag, buffer + logIndex[i], logGroupSize);
-                            }
-                            if (successful && config->mTimeZoneAdjust) {
-                                LogParser::AdjustLogTime(
-                                    logPtr, config->mLogTimeZoneOffsetSecond, localTimeZoneOffsetSecond);
-                            }
-                            if (AppConfig::GetInstance()->EnableLogTimeAutoAdjust()) {
-                                logPtr->set_time(logPtr->time() + GetTimeDelta());
-                            }
+                    if (logGroup.logs_size() > 0) {
+                        std::shared_ptr<const std::vector<sls_logs::LogTag>> logTags
+                            = logFileReader->GetCachedLogTags(logPath, userDefinedId);
+                        if (!logTags) {
+                            logTags = BuildLogTags(logPath, userDefinedId, logFileReader.get());
+                            logFileReader->SetCachedLogTags(logPath, userDefinedId, logTags);
                         }
-                        successLogSize = logGroup.logs_size();
-
-                        if (logBuffer->exactlyOnceCheckpoint
-                            || (config->mAdvancedConfig.mEnableLogPositionMeta && logPtr != NULL)) {
-                            auto const offset = logBuffer->beginOffset + logIndex[i];
-                            if (config->mAdvancedConfig.mEnableLogPositionMeta && logPtr != NULL) {
-                                auto content = logPtr->add_contents();
-                                content->set_key(LOG_RESERVED_KEY_FILE_OFFSET);
-                                content->set_value(std::to_string(offset));
-                            }
-
-                            // Record log positions for exactly once.
-                            if (logBuffer->exactlyOnceCheckpoint) {
-                                int32_t length = 0;
-                                if (1 == lines) {
-                                    length = logBuffer->bufferSize;
-                                } else if (i != lines - 1) {
-                                    length = logIndex[i + 1] - logIndex[i];
-                                } else {
-                                    length = logBuffer->bufferSize - logIndex[i];
-                                }
-                                logBuffer->exactlyOnceCheckpoint->positions.emplace_back(
-                                    std::make_pair(offset, static_cast<size_t>(length)));
-                            }
+                        logGroup.mutable_logtags()->Reserve(logGroup.logtags_size() + logTags->size() + 1);
+                        for (const sls_logs::LogTag& logTag : *logTags) {
+                            *logGroup.add_logtags() = logTag;
                         }
-                    }
-                }
 
-                // check whether processing is too slow
-                int32_t parseEndTime = (int32_t)time(NULL);
-                if (parseEndTime - parseStartTime > 1) {
-                    LogtailAlarm::GetInstance()->SendAlarm(
-                        PROCESS_TOO_SLOW_ALARM,
-                        string("parse ") + ToString(logGroup.logs_size()) + " logs, buffer size " + ToString(bufferSize)
-                            + "time used seconds : " + ToString(parseEndTime - parseStartTime),
-                        projectName,
-                        category,
-                        config->mRegion);
-                    LOG_WARNING(sLogger,
-                                ("process log too slow, parse logs", logGroup.logs_size())("buffer size", bufferSize)(
-                                    "time used seconds",
-                                    parseEndTime - parseStartTime)("project", projectName)("logstore", category));
-                }
-                if (logGroup.logs_size() > 0) {
-                    sls_logs::LogTag* logTagPtr = logGroup.add_logtags();
-                    logTagPtr->set_key(LOG_RESERVED_KEY_HOSTNAME);
-                    logTagPtr->set_value(LogFileProfiler::mHostname.substr(0, 99));
-                    logTagPtr = logGroup.add_logtags();
-                    logTagPtr->set_key(LOG_RESERVED_KEY_PATH);
-                    logTagPtr->set_value(logPath.substr(0, 511));
-
-                    // zone info for ant
-                    const std::string& alipayZone = AppConfig::GetInstance()->GetAlipayZone();
-                    if (!alipayZone.empty()) {
-                        logTagPtr = logGroup.add_logtags();
-                        logTagPtr->set_key(LOG_RESERVED_KEY_ALIPAY_ZONE);
-                        logTagPtr->set_value(alipayZone);
-                    }
-
-                    string userDefinedId = ConfigManager::GetInstance()->GetUserDefinedIdSet();
-                    if (userDefinedId.size() > 0) {
-                        logTagPtr = logGroup.add_logtags();
-                        logTagPtr->set_key(LOG_RESERVED_KEY_USER_DEFINED_ID);
-                        logTagPtr->set_value(userDefinedId.substr(0, 99));
-                    }
-
-                    const std::vector<sls_logs::LogTag>& extraTags = logFileReader->GetExtraTags();
-                    for (size_t i = 0; i < extraTags.size(); ++i) {
-                        logTagPtr = logGroup.add_logtags();
-                        logTagPtr->set_key(extraTags[i].key());
-                        logTagPtr->set_value(extraTags[i].value());
-                    }
-
-                    // add truncate info to loggroup
-                    if (config->mIsFuseMode && logBuffer->truncateInfo.get() != NULL
-                        && logBuffer->truncateInfo->empty() == false) {
-                        sls_logs::LogTag* logTagPtr = logGroup.add_logtags();
-                        logTagPtr->set_key(LOG_RESERVED_KEY_TRUNCATE_INFO);
-                        logTagPtr->set_value(logBuffer->truncateInfo->toString());
-                    }
+                        // add truncate info to loggroup
+                        if (pipeline->mAppendTruncateInfo && logBuffer->truncateInfo.get() != NULL
+                            && logBuffer->truncateInfo->empty() == false) {
+                            sls_logs::LogTag* logTagPtr = logGroup.add_logtags();
+                            logTagPtr->set_key(LOG_RESERVED_KEY_TRUNCATE_INFO);
+                            logTagPtr->set_value(logBuffer->truncateInfo->toString());
+                        }
 
-                    if (logGroup.category() != category) {
-                        logGroup.set_category(category);
-                    }
+                        if (logGroup.category() != category) {
+                            logGroup.set_category(category);
+                        }
 
-                    if (logGroup.topic().empty()) {
-                        logGroup.set_topic(logFileReader->GetTopicName());
-                    }
+                        if (logGroup.topic().empty()) {
+                            logGroup.set_topic(logFileReader->GetTopicName());
+                        }
 
-                    IntegrityConfig* integrityConfig = NULL;
-                    LineCountConfig* lineCountConfig = NULL;
-                    if (config->mIntegrityConfig->mIntegritySwitch) {
-                        integrityConfig = new IntegrityConfig(config->mIntegrityConfig->mAliuid,
-                                                              config->mIntegrityConfig->mIntegritySwitch,
-                                                              config->mIntegrityConfig->mIntegrityProjectName,
-                                                              config->mIntegrityConfig->mIntegrityLogstore,
-                                                              config->mIntegrityConfig->mLogTimeReg,
-                                                              config->mIntegrityConfig->mTimeFormat,
-                                                              config->mIntegrityConfig->mTimePos);
-                    }
-                    if (config->mLineCountConfig->mLineCountSwitch) {
-                        lineCountConfig = new LineCountConfig(config->mLineCountConfig->mAliuid,
-                                                              config->mLineCountConfig->mLineCountSwitch,
-                                                              config->mLineCountConfig->mLineCountProjectName,
-                                                              config->mLineCountConfig->mLineCountLogstore);
-                    }
-                    IntegrityConfigPtr integrityConfigPtr(integrityConfig);
-                    LineCountConfigPtr lineCountConfigPtr(lineCountConfig);
-                    sls_logs::SlsCompressType compressType = sdk::Client::GetCompressType(config->mCompressType);
-
-                    LogGroupContext context(config->mRegion,
-                                            projectName,
-                                            config->mCategory,
-                                            compressType,
-                                            logBuffer->fileInfo,
-                                            integrityConfigPtr,
-                                            lineCountConfigPtr,
-                                            -1,
-                                            logFileReader->GetFuseMode(),
-                                            logFileReader->GetMarkOffsetFlag(),
-                                            logBuffer->exactlyOnceCheckpoint);
-                    if (!Sender::Instance()->Send(projectName,
-                                                  logFileReader->GetSourceId(),
-                                                  logGroup,
-                                                  config,
-                                                  config->mMergeType,
-                                                  (uint32_t)(logGroupSize * DOUBLE_FLAG(loggroup_bytes_inflation)),
-                                                  "",
-                                                  logPath,
-                                                  context)) {
-                        LogtailAlarm::GetInstance()->SendAlarm(DISCARD_DATA_ALARM,
-                                                               "push file data into batch map fail",
-                                                               projectName,
-                                                               category,
-                                                               config->mRegion);
-                        LOG_ERROR(sLogger,
-                                  ("push file data into batch map fail, discard logs", logGroup.logs_size())(
-                                      "project", projectName)("logstore", category)("filename", logPath));
+                        LogGroupContext context(config->mRegion,
+                                                projectName,
+                                                config->mCategory,
+                                                pipeline->mCompressType,
+                                                logBuffer->fileInfo,
+                                                pipeline->mIntegrityConfig,
+                                                pipeline->mLineCountConfig,
+                                                -1,
+                                                logFileReader->GetFuseMode(),
+                                                logFileReader->GetMarkOffsetFlag(),
+                                                logBuffer->exactlyOnceCheckpoint);
+                        context.mTimestamps.mReadTimeInMs = logBuffer->readTimeInMs;
+                        context.mSourceIdKey = logFileReader->GetSourceIdKey();
+                        if (!Sender::Instance()->Send(projectName,
+                                                      logFileReader->GetSourceId(),
+                                                      logGroup,
+                                                      config,
+                                                      config->mMergeType,
+                                                      (uint32_t)(logGroupSize * DOUBLE_FLAG(loggroup_bytes_inflation)),
+                                                      "",
+                                                      logPath,
+                                                      context,
+                                                      arena)) {
+                            LogtailAlarm::GetInstance()->SendAlarm(DISCARD_DATA_ALARM,
+                                                                   "push file data into batch map fail",
+                                                                   projectName,
+                                                                   category,
+                                                                   config->mRegion);
+                            LOG_ERROR(sLogger,
+                                      ("push file data into batch map fail, discard logs", logGroup.logs_size())(
+                                          "project", projectName)("logstore", category)("filename", logPath));
+                        }
                     }
                 }
-            }
 
-            LogFileProfiler::GetInstance()->AddProfilingData(config->mConfigName,
-                                                             config->mRegion,
-                                                             projectName,
-                                                             category,
-                                                             logPath,
-                                                             logFileReader->GetExtraTags(),
-                                                             readBytes,
-                                                             skipBytes,
-                                                             splitLines,
-                                                             parseFailures,
-                                                             regexMatchFailures,
-                                                             parseTimeFailures,
-                                                             historyFailures,
-                                                             sendFailures,
-                                                             errorLine);
-            LOG_DEBUG(sLogger,
-                      ("project", projectName)("logstore", category)("filename", logPath)("read_bytes", readBytes)(
-                          "line_feed", lineFeed)("split_lines", splitLines)("parse_failures", parseFailures)(
-                          "parse_time_failures", parseTimeFailures)("regex_match_failures", regexMatchFailures)(
-                          "history_failures", historyFailures));
+                LogFileProfilingEntryPtr profilingEntry = logFileReader->GetProfilingEntry();
+                if (!profilingEntry
+                    || !profilingEntry->Match(config->mConfigName, config->mRegion, projectName, category, logPath)) {
+                    profilingEntry = LogFileProfiler::GetInstance()->CreateProfilingEntry(
+                        config->mConfigName,
+                        config->mRegion,
+                        projectName,
+                        category,
+                        logPath,
+                        logFileReader->GetExtraTags());
+                    logFileReader->SetProfilingEntry(profilingEntry);
+                }
+                LogFileProfiler::GetInstance()->AddProfilingData(profilingEntry,
+                                                                 readBytes,
+                                                                 skipBytes,
+                                                                 splitLines,
+                                                                 parseFailures,
+                                                                 regexMatchFailures,
+                                                                 parseTimeFailures,
+                                                                 historyFailures,
+                                                                 sendFailures,
+                                                                 errorLine,
+                                                                 collapsedLines);
+                LOG_DEBUG(sLogger,
+                          ("project", projectName)("logstore", category)("filename", logPath)("read_bytes", readBytes)(
+                              "line_feed", lineFeed)("split_lines", splitLines)("parse_failures", parseFailures)(
+                              "parse_time_failures", parseTimeFailures)("regex_match_failures", regexMatchFailures)(
+                              "history_failures", historyFailures));
 
-            delete[] logBuffer->buffer;
-            delete logBuffer;
+                delete logBuffer;
+            }
+            if (!pluginRawLogs.empty()) {
+                flushPluginRawLogs();
+            }
+            if (batchCpuBeginNs > 0) {
+                cpuQuotas.Charge(
+                    batchKey, StageProfiler::GetThreadCpuTimeNs() - batchCpuBeginNs, GetSteadyTimeInMilliSeconds());
+            }
         }
     }
     LOG_WARNING(sLogger, ("LogProcessThread", "Exit")("threadNo", threadNo));
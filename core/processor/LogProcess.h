@@ -16,22 +16,39 @@
 
 #pragma once
 #include <boost/regex.hpp>
+#include <deque>
+#include <functional>
 #include <map>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <utility>
 #include "common/LogstoreFeedbackQueue.h"
+#include "common/ShardedLogstoreFeedbackQueue.h"
 #include "common/LogRunnable.h"
 #include "common/Thread.h"
 #include "common/Lock.h"
 #include "log_pb/sls_logs.pb.h"
+#include "ProcessQueueSpill.h"
+#include "ProcessThreadScaler.h"
 
 namespace logtail {
 // forward declaration
 struct LogBuffer;
 class Config;
 
+// ReadWriteLock sleeps after each shared unlock on Windows, which is too slow for
+// the hot path of process queue, so the single mutex queue is used there.
+#if defined(_MSC_VER)
+typedef LogstoreFeedbackQueue<LogBuffer*> ProcessQueue;
+#else
+typedef ShardedLogstoreFeedbackQueue<LogBuffer*> ProcessQueue;
+#endif
+
 class LogProcess : public LogRunnable {
 public:
     static LogProcess* GetInstance() {
@@ -62,6 +79,10 @@ public:
     // must not call this when processer is working
     void DeletePriorityWithHoldOn(const LogstoreFeedBackKey& logstoreKey);
 
+    // call it after holdon or processor not started
+    // must not call this when processer is working
+    void SetCpuQuotaWithHoldOn(const LogstoreFeedBackKey& logstoreKey, int32_t percent);
+
     // process thread hold on should after input thread hold on
     // because process hold on will lock mLogFeedbackQueue, if input thread not hold on first,
     // input thread may try to lock mLogFeedbackQueue by call IsValidToReadLog or PushBuffer,
@@ -81,7 +102,12 @@ public:
     //************************************
     bool FlushOut(int32_t waitMs);
 
-    LogstoreFeedbackQueue<LogBuffer*>& GetQueue() { return mLogFeedbackQueue; }
+    ProcessQueue& GetQueue() { return mLogFeedbackQueue; }
+
+    // RunParseChunks runs @tasks with the help of idle process threads and returns
+    // after all of them are done. The caller runs the first task and any task not
+    // taken by others, so it never waits for a task which is not started.
+    void RunParseChunks(std::vector<std::function<void()>>& tasks);
 
 private:
     LogProcess();
@@ -89,13 +115,39 @@ private:
 
     void DoFuseHandling();
 
+    // RunChunkTask runs one pending chunk task, returns false if there is none.
+    bool RunChunkTask();
+
+    // ScaleThreads updates the count of active threads by mThreadScaler, called by thread 0.
+    void ScaleThreads(int32_t curTime);
+    // PushToQueue pushes @buffer to mLogFeedbackQueue without spilling.
+    bool PushToQueue(const LogstoreFeedBackKey& logstoreKey, LogBuffer* buffer);
+    // RestoreSpilledBuffers pushes spilled buffers of @logstoreKey back while its queue is valid.
+    void RestoreSpilledBuffers(const LogstoreFeedBackKey& logstoreKey);
+    // ParkIfInactive blocks thread @threadNo while it's not active, returns true if it has been parked.
+    bool ParkIfInactive(int32_t threadNo);
+
     bool mInitialized;
     ThreadPtr* mProcessThreads;
-    int32_t mThreadCount;
-    LogstoreFeedbackQueue<LogBuffer*> mLogFeedbackQueue;
+    int32_t mThreadCount; // count of threads created, the max count if threads are scaled
+    ProcessQueue mLogFeedbackQueue;
     volatile bool* mThreadFlags; // whether thread is sending data or wait
     // int32_t mBufferCountLimit;
     ReadWriteLock mAccessProcessThreadRWL;
+    // Chunks of large buffers waiting for idle process threads, see RunParseChunks.
+    std::mutex mChunkTaskMux;
+    std::deque<std::function<void()>> mChunkTasks;
+
+    // Threads with threadNo not less than mActiveThreadCount wait on mParkCond, see enable_process_thread_scaling.
+    std::atomic<int32_t> mActiveThreadCount{0};
+    std::unique_ptr<ProcessThreadScaler> mThreadScaler;
+    std::mutex mParkMux;
+    std::condition_variable mParkCond;
+    // Latency from read to pop of buffers since last ScaleThreads.
+    std::atomic<uint64_t> mPopLatencySumMs{0};
+    std::atomic<uint64_t> mPopCount{0};
+    // Buffers are spilled to disk when their queue is full, see enable_process_queue_spill.
+    std::unique_ptr<ProcessQueueSpill> mQueueSpill;
 
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class SenderUnittest;
@@ -0,0 +1,181 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "LogToMetric.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+namespace logtail {
+
+namespace {
+
+    const std::string kOtherValue = "__other__";
+
+    std::string FormatDouble(double value) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.9g", value);
+        return buf;
+    }
+
+    // ParseDouble accepts values which are numbers as a whole, such as "12" and "0.5", but not "12ms".
+    bool ParseDouble(const std::string& str, double& value) {
+        if (str.empty()) {
+            return false;
+        }
+        char* end = NULL;
+        errno = 0;
+        value = strtod(str.c_str(), &end);
+        return errno == 0 && end == str.c_str() + str.size();
+    }
+
+    void AddContent(sls_logs::Log& log, const std::string& key, const std::string& value) {
+        sls_logs::Log_Content* content = log.add_contents();
+        content->set_key(key);
+        content->set_value(value);
+    }
+
+} // namespace
+
+LogToMetricAggregator::LogToMetricAggregator(const LogToMetricConfig& config, size_t maxGroups)
+    : mConfig(config), mMaxGroups(maxGroups > 0 ? maxGroups : 1) {
+    if (mConfig.mWindowSeconds <= 0) {
+        mConfig.mWindowSeconds = 1;
+    }
+    for (size_t i = 0; i < mConfig.mGroupKeys.size(); ++i) {
+        mOverflowKey.append(kOtherValue).push_back('\0');
+    }
+    // A key of real values always has one more byte per value than the values, see AddLog.
+    mOverflowKey.push_back('\0');
+}
+
+void LogToMetricAggregator::Add(const sls_logs::LogGroup& logGroup, std::vector<int32_t>& neededLogs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    size_t kept = 0;
+    for (int32_t index : neededLogs) {
+        AddLog(logGroup.logs(index));
+        mSampleCredit += mConfig.mRawLogSampleRatio;
+        if (mSampleCredit >= 1) {
+            mSampleCredit -= 1;
+            neededLogs[kept++] = index;
+        }
+    }
+    neededLogs.resize(kept);
+}
+
+void LogToMetricAggregator::AddLog(const sls_logs::Log& log) {
+    const size_t groupKeyCount = mConfig.mGroupKeys.size();
+    const size_t keyCount = groupKeyCount + mConfig.mValueKeys.size();
+    mFound.assign(keyCount, NULL);
+    for (int i = 0; i < log.contents_size(); ++i) {
+        const sls_logs::Log_Content& content = log.contents(i);
+        for (size_t k = 0; k < keyCount; ++k) {
+            const std::string& key = k < groupKeyCount ? mConfig.mGroupKeys[k] : mConfig.mValueKeys[k - groupKeyCount];
+            if (mFound[k] == NULL && content.key() == key) {
+                mFound[k] = &content.value();
+            }
+        }
+    }
+    // Each value is followed by a flag byte, so a missing key differs from an empty value.
+    mKey.clear();
+    for (size_t k = 0; k < groupKeyCount; ++k) {
+        if (mFound[k] != NULL) {
+            mKey.append(*mFound[k]).push_back('\1');
+        } else {
+            mKey.push_back('\0');
+        }
+    }
+
+    const int32_t windowStart = static_cast<int32_t>(log.time()) / mConfig.mWindowSeconds * mConfig.mWindowSeconds;
+    Window& window = mWindows[windowStart];
+    auto iter = window.find(mKey);
+    if (iter == window.end()) {
+        if (window.size() >= mMaxGroups) {
+            iter = window.find(mOverflowKey);
+        }
+        if (iter == window.end()) {
+            const bool overflow = window.size() >= mMaxGroups;
+            iter = window.emplace(overflow ? mOverflowKey : mKey, Group()).first;
+            Group& group = iter->second;
+            group.mValues.resize(groupKeyCount);
+            group.mHasValues.resize(groupKeyCount, true);
+            for (size_t k = 0; k < groupKeyCount; ++k) {
+                if (overflow) {
+                    group.mValues[k] = kOtherValue;
+                } else if (mFound[k] != NULL) {
+                    group.mValues[k] = *mFound[k];
+                } else {
+                    group.mHasValues[k] = false;
+                }
+            }
+            group.mStats.resize(mConfig.mValueKeys.size());
+        }
+    }
+    Group& group = iter->second;
+    ++group.mCount;
+    for (size_t k = groupKeyCount; k < keyCount; ++k) {
+        double value = 0;
+        if (mFound[k] != NULL && ParseDouble(*mFound[k], value)) {
+            ValueStat& stat = group.mStats[k - groupKeyCount];
+            stat.mDigest.Add(value);
+            stat.mSum += value;
+        }
+    }
+}
+
+size_t LogToMetricAggregator::Flush(int32_t now, bool force, sls_logs::LogGroup& logGroup) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    size_t count = 0;
+    while (!mWindows.empty()) {
+        auto iter = mWindows.begin();
+        if (!force && iter->first + mConfig.mWindowSeconds > now) {
+            break;
+        }
+        for (auto& item : iter->second) {
+            AppendGroup(iter->first, item.second, logGroup);
+            ++count;
+        }
+        mWindows.erase(iter);
+    }
+    return count;
+}
+
+void LogToMetricAggregator::AppendGroup(int32_t windowStart, Group& group, sls_logs::LogGroup& logGroup) const {
+    sls_logs::Log* log = logGroup.add_logs();
+    log->set_time(static_cast<uint32_t>(windowStart));
+    for (size_t k = 0; k < mConfig.mGroupKeys.size(); ++k) {
+        if (group.mHasValues[k]) {
+            AddContent(*log, mConfig.mGroupKeys[k], group.mValues[k]);
+        }
+    }
+    AddContent(*log, "window_seconds", std::to_string(mConfig.mWindowSeconds));
+    AddContent(*log, "count", std::to_string(group.mCount));
+    for (size_t k = 0; k < mConfig.mValueKeys.size(); ++k) {
+        const std::string& key = mConfig.mValueKeys[k];
+        ValueStat& stat = group.mStats[k];
+        AddContent(*log, key + "_count", std::to_string(stat.mDigest.Count()));
+        if (stat.mDigest.IsEmpty()) {
+            continue;
+        }
+        AddContent(*log, key + "_sum", FormatDouble(stat.mSum));
+        AddContent(*log, key + "_min", FormatDouble(stat.mDigest.Min()));
+        AddContent(*log, key + "_max", FormatDouble(stat.mDigest.Max()));
+        for (double q : mConfig.mQuantiles) {
+            AddContent(*log, key + "_p" + FormatDouble(q * 100), FormatDouble(stat.mDigest.Quantile(q)));
+        }
+        AddContent(*log, key + "_sketch", stat.mDigest.Serialize());
+    }
+}
+
+} // namespace logtail
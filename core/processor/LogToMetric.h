@@ -0,0 +1,95 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common/TDigest.h"
+#include "log_pb/sls_logs.pb.h"
+
+namespace logtail {
+
+// LogToMetricConfig is advanced.log_to_metric of a config.
+struct LogToMetricConfig {
+    std::vector<std::string> mGroupKeys;
+    // Numeric values of these keys are summarized by sketches, others are ignored.
+    std::vector<std::string> mValueKeys;
+    int32_t mWindowSeconds = 60;
+    std::vector<double> mQuantiles{0.5, 0.9, 0.99};
+    // Fraction of logs still sent as they are, in [0, 1].
+    double mRawLogSampleRatio = 0;
+    std::string mTopic = "log_to_metric";
+};
+
+// LogToMetricAggregator groups logs of a config by values of group keys over windows of log time, and
+// replaces them with one metric log per group and window: the values of group keys, count, and for each
+// value key its count, sum, min, max, quantiles and the serialized t-digest. Sketches of the same group
+// from other windows, late logs or hosts can be merged by consumers, so a window closed too early only
+// costs one more record. It is thread safe.
+class LogToMetricAggregator {
+public:
+    // At most @maxGroups groups are kept in a window, logs of new groups after it go to a group whose values
+    // are all "__other__".
+    LogToMetricAggregator(const LogToMetricConfig& config, size_t maxGroups);
+
+    // Add aggregates logs of @logGroup at @neededLogs, those not sampled as raw logs are removed from
+    // @neededLogs.
+    void Add(const sls_logs::LogGroup& logGroup, std::vector<int32_t>& neededLogs);
+
+    // Flush appends metric logs of windows ended before @now to @logGroup, or of all windows if @force, and
+    // returns the count of them.
+    size_t Flush(int32_t now, bool force, sls_logs::LogGroup& logGroup);
+
+    const LogToMetricConfig& GetConfig() const { return mConfig; }
+
+private:
+    struct ValueStat {
+        TDigest mDigest;
+        double mSum = 0;
+    };
+    struct Group {
+        std::vector<std::string> mValues; // of group keys
+        std::vector<bool> mHasValues; // false if the group key is missing in logs of the group
+        uint64_t mCount = 0;
+        std::vector<ValueStat> mStats; // of value keys
+    };
+    typedef std::unordered_map<std::string, Group> Window;
+
+    void AddLog(const sls_logs::Log& log);
+    void AppendGroup(int32_t windowStart, Group& group, sls_logs::LogGroup& logGroup) const;
+
+    LogToMetricConfig mConfig;
+    const size_t mMaxGroups;
+    std::string mOverflowKey;
+    std::mutex mMutex;
+    // Windows by start time.
+    std::map<int32_t, Window> mWindows;
+    double mSampleCredit = 0;
+    // Scratch of AddLog, values of group keys and value keys found in a log.
+    std::vector<const std::string*> mFound;
+    std::string mKey;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class LogToMetricUnittest;
+#endif
+};
+
+} // namespace logtail
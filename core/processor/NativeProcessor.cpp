@@ -0,0 +1,400 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "NativeProcessor.h"
+#include <algorithm>
+#include <vector>
+#include <boost/regex.hpp>
+#include <re2/re2.h>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include "common/Constants.h"
+#include "common/RegexCache.h"
+#include "common/StringTools.h"
+#include "logger/Logger.h"
+#include "parser/DelimiterModeBitmaskParser.h"
+#include "parser/LogParser.h"
+#include "processor/LogFilter.h"
+
+using namespace sls_logs;
+
+namespace logtail {
+
+namespace {
+
+    const std::string kProcessorRegex = "processor_regex";
+    const std::string kProcessorJson = "processor_json";
+    const std::string kProcessorDelimiter = "processor_delimiter";
+    const std::string kProcessorFilterRegex = "processor_filter_regex";
+
+    std::string GetString(const Json::Value& config, const char* key, const std::string& defaultValue = "") {
+        return config.isMember(key) && config[key].isString() ? config[key].asString() : defaultValue;
+    }
+
+    bool GetBool(const Json::Value& config, const char* key, bool defaultValue) {
+        return config.isMember(key) && config[key].isBool() ? config[key].asBool() : defaultValue;
+    }
+
+    bool GetStrings(const Json::Value& config, const char* key, std::vector<std::string>& values) {
+        if (!config.isMember(key) || !config[key].isArray()) {
+            return false;
+        }
+        for (const Json::Value& value : config[key]) {
+            if (!value.isString()) {
+                return false;
+            }
+            values.push_back(value.asString());
+        }
+        return true;
+    }
+
+    void RemoveContent(Log& log, int index) {
+        for (int i = index; i + 1 < log.contents_size(); ++i) {
+            log.mutable_contents()->SwapElements(i, i + 1);
+        }
+        log.mutable_contents()->RemoveLast();
+    }
+
+    // ParserProcessor parses the value of source key of each log, parsed fields are appended to the log.
+    class ParserProcessor : public NativeProcessor {
+    public:
+        explicit ParserProcessor(const Json::Value& config)
+            : mSourceKey(GetString(config, "SourceKey", DEFAULT_CONTENT_KEY)),
+              mKeepSource(GetBool(config, "KeepSource", false)),
+              mKeepSourceIfParseError(GetBool(config, "KeepSourceIfParseError", true)) {}
+
+        void Process(LogGroup& logGroup) override {
+            LogGroup parsed;
+            for (int i = 0; i < logGroup.logs_size(); ++i) {
+                Log& log = *logGroup.mutable_logs(i);
+                int sourceIndex = -1;
+                for (int j = 0; j < log.contents_size(); ++j) {
+                    if (log.contents(j).key() == mSourceKey) {
+                        sourceIndex = j;
+                        break;
+                    }
+                }
+                if (sourceIndex < 0) {
+                    continue;
+                }
+                parsed.Clear();
+                uint32_t size = 0;
+                const bool success = Parse(log.contents(sourceIndex).value(), log.time(), parsed, size)
+                    && parsed.logs_size() > 0;
+                if (success ? !mKeepSource : !mKeepSourceIfParseError) {
+                    RemoveContent(log, sourceIndex);
+                }
+                if (success) {
+                    Log& fields = *parsed.mutable_logs(0);
+                    for (int j = 0; j < fields.contents_size(); ++j) {
+                        log.add_contents()->Swap(fields.mutable_contents(j));
+                    }
+                }
+            }
+        }
+
+    protected:
+        // Parse adds one log with fields of @value into @parsed, returns false if @value does not match.
+        virtual bool Parse(const std::string& value, time_t logTime, LogGroup& parsed, uint32_t& size) = 0;
+
+        std::string mSourceKey;
+
+    private:
+        bool mKeepSource;
+        bool mKeepSourceIfParseError;
+    };
+
+    class RegexProcessor : public ParserProcessor {
+    public:
+        explicit RegexProcessor(const Json::Value& config) : ParserProcessor(config) {}
+
+        bool Init(const Json::Value& config, std::string& error) {
+            const std::string regex = GetString(config, "Regex");
+            if (regex.empty() || !GetStrings(config, "Keys", mKeys) || mKeys.empty()) {
+                error = "Regex and Keys are required";
+                return false;
+            }
+            try {
+                mRegex = RegexCache::GetInstance()->Get(regex);
+            } catch (const std::exception& e) {
+                error = std::string("invalid Regex: ") + e.what();
+                return false;
+            }
+            // The same as CommonRegLogFileReader, re2 is used if it supports the regex, '.' matches '\n'.
+            re2::RE2::Options options;
+            options.set_dot_nl(true);
+            options.set_log_errors(false);
+            mRe2Regex.reset(new re2::RE2(regex, options));
+            if (!mRe2Regex->ok()) {
+                mRe2Regex.reset();
+            }
+            return true;
+        }
+
+    protected:
+        bool Parse(const std::string& value, time_t logTime, LogGroup& parsed, uint32_t& size) override {
+            ParseLogError error;
+            return LogParser::RegexLogLineParser(value.c_str(),
+                                                 *mRegex,
+                                                 parsed,
+                                                 true,
+                                                 mKeys,
+                                                 "",
+                                                 logTime,
+                                                 "",
+                                                 "",
+                                                 "",
+                                                 error,
+                                                 size,
+                                                 mRe2Regex.get());
+        }
+
+    private:
+        RegexPtr mRegex;
+        std::unique_ptr<re2::RE2> mRe2Regex;
+        std::vector<std::string> mKeys;
+    };
+
+    class JsonProcessor : public ParserProcessor {
+    public:
+        explicit JsonProcessor(const Json::Value& config) : ParserProcessor(config) {}
+
+    protected:
+        bool Parse(const std::string& value, time_t logTime, LogGroup& parsed, uint32_t& size) override {
+            rapidjson::Document doc;
+            doc.Parse(value.c_str(), value.size());
+            if (doc.HasParseError() || !doc.IsObject()) {
+                return false;
+            }
+            Log* logPtr = parsed.add_logs();
+            for (rapidjson::Document::ConstMemberIterator itr = doc.MemberBegin(); itr != doc.MemberEnd(); ++itr) {
+                if (itr->value.IsString()) {
+                    LogParser::AddLog(logPtr,
+                                      itr->name.GetString(),
+                                      itr->name.GetStringLength(),
+                                      itr->value.GetString(),
+                                      itr->value.GetStringLength(),
+                                      size);
+                } else {
+                    rapidjson::StringBuffer buffer;
+                    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+                    itr->value.Accept(writer);
+                    LogParser::AddLog(logPtr,
+                                      itr->name.GetString(),
+                                      itr->name.GetStringLength(),
+                                      buffer.GetString(),
+                                      buffer.GetSize(),
+                                      size);
+                }
+            }
+            return true;
+        }
+    };
+
+    class DelimiterProcessor : public ParserProcessor {
+    public:
+        explicit DelimiterProcessor(const Json::Value& config) : ParserProcessor(config) {}
+
+        bool Init(const Json::Value& config, std::string& error) {
+            std::string separator = GetString(config, "Separator");
+            if (separator == "\\t") {
+                separator = "\t";
+            }
+            const std::string quote = GetString(config, "Quote", "\"");
+            if (separator.size() != 1 || quote.size() != 1 || !GetStrings(config, "Keys", mKeys)
+                || mKeys.empty()) {
+                error = "single char Separator and Quote, and Keys are required";
+                return false;
+            }
+            mParser.reset(new DelimiterModeBitmaskParser(quote[0], separator[0]));
+            return true;
+        }
+
+    protected:
+        bool Parse(const std::string& value, time_t logTime, LogGroup& parsed, uint32_t& size) override {
+            static thread_local std::vector<DelimiterColumnSpan> sColumns;
+            sColumns.clear();
+            if (!mParser->ParseDelimiterLine(value.data(), 0, static_cast<int32_t>(value.size()), sColumns)) {
+                return false;
+            }
+            Log* logPtr = parsed.add_logs();
+            std::string columnValue;
+            for (size_t i = 0; i < sColumns.size(); ++i) {
+                columnValue.clear();
+                mParser->AppendColumnValue(value.data(), sColumns[i], columnValue);
+                // Overflowed columns are extended as the Go processor does by default.
+                if (i < mKeys.size()) {
+                    LogParser::AddLog(logPtr, mKeys[i], columnValue, size);
+                } else {
+                    LogParser::AddLog(logPtr, "__column" + ToString(i) + "__", columnValue, size);
+                }
+            }
+            return true;
+        }
+
+    private:
+        std::unique_ptr<DelimiterModeBitmaskParser> mParser;
+        std::vector<std::string> mKeys;
+    };
+
+    // FilterRegexProcessor keeps logs matching all Include and none of Exclude by LogFilter.
+    class FilterRegexProcessor : public NativeProcessor {
+    public:
+        bool Init(const Json::Value& config, std::string& error) {
+            try {
+                if (config.isMember("Include") && config["Include"].isObject()) {
+                    mInclude.reset(new LogFilterRule());
+                    const Json::Value& include = config["Include"];
+                    for (const std::string& key : include.getMemberNames()) {
+                        mInclude->FilterKeys.push_back(key);
+                        mInclude->FilterRegs.push_back(*RegexCache::GetInstance()->Get(include[key].asString()));
+                    }
+                    mInclude->CompileProgram();
+                }
+                if (config.isMember("Exclude") && config["Exclude"].isObject()) {
+                    const Json::Value& exclude = config["Exclude"];
+                    for (const std::string& key : exclude.getMemberNames()) {
+                        std::unique_ptr<LogFilterRule> rule(new LogFilterRule());
+                        rule->FilterKeys.push_back(key);
+                        rule->FilterRegs.push_back(*RegexCache::GetInstance()->Get(exclude[key].asString()));
+                        rule->CompileProgram();
+                        mExclude.push_back(std::move(rule));
+                    }
+                }
+            } catch (const std::exception& e) {
+                error = std::string("invalid filter regex: ") + e.what();
+                return false;
+            }
+            return true;
+        }
+
+        void Process(LogGroup& logGroup) override {
+            if (logGroup.logs_size() == 0) {
+                return;
+            }
+            LogGroupContext context;
+            std::vector<bool> kept(logGroup.logs_size(), mInclude == nullptr);
+            if (mInclude) {
+                for (int32_t index : LogFilter::Instance()->Filter(logGroup, mInclude.get(), context)) {
+                    kept[index] = true;
+                }
+            }
+            for (const auto& rule : mExclude) {
+                for (int32_t index : LogFilter::Instance()->Filter(logGroup, rule.get(), context)) {
+                    kept[index] = false;
+                }
+            }
+            int count = 0;
+            for (int i = 0; i < logGroup.logs_size(); ++i) {
+                if (kept[i]) {
+                    if (i != count) {
+                        logGroup.mutable_logs()->SwapElements(i, count);
+                    }
+                    ++count;
+                }
+            }
+            while (logGroup.logs_size() > count) {
+                logGroup.mutable_logs()->RemoveLast();
+            }
+        }
+
+    private:
+        std::unique_ptr<LogFilterRule> mInclude;
+        std::vector<std::unique_ptr<LogFilterRule>> mExclude;
+    };
+
+    template <typename T>
+    NativeProcessor* CreateWithInit(T* processor, const Json::Value& config, std::string& error) {
+        std::unique_ptr<T> ptr(processor);
+        return ptr->Init(config, error) ? ptr.release() : NULL;
+    }
+
+} // namespace
+
+NativeProcessor* NativeProcessor::Create(const Json::Value& config, std::string& error) {
+    if (!config.isObject()) {
+        error = "config is not an object";
+        return NULL;
+    }
+    const std::string type = GetString(config, "type");
+    const Json::Value& detail = config["detail"];
+    if (type == kProcessorRegex) {
+        return CreateWithInit(new RegexProcessor(detail), detail, error);
+    }
+    if (type == kProcessorJson) {
+        return new JsonProcessor(detail);
+    }
+    if (type == kProcessorDelimiter) {
+        return CreateWithInit(new DelimiterProcessor(detail), detail, error);
+    }
+    if (type == kProcessorFilterRegex) {
+        return CreateWithInit(new FilterRegexProcessor(), detail, error);
+    }
+    error = "unsupported processor type: " + type;
+    return NULL;
+}
+
+int64_t NativeProcessorManager::Create(const std::string& config, std::string& error) {
+    Json::Value root;
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    std::string parseError;
+    if (!reader->parse(config.data(), config.data() + config.size(), &root, &parseError)) {
+        error = "invalid json: " + parseError;
+        return -1;
+    }
+    NativeProcessorPtr processor(NativeProcessor::Create(root, error));
+    if (processor == nullptr) {
+        LOG_WARNING(sLogger, ("create native processor failed", error)("config", config));
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    const int64_t id = mNextId++;
+    mProcessors[id] = processor;
+    LOG_INFO(sLogger, ("create native processor", id)("type", GetString(root, "type")));
+    return id;
+}
+
+bool NativeProcessorManager::Destroy(int64_t id) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mProcessors.erase(id) > 0;
+}
+
+bool NativeProcessorManager::Process(int64_t id, const char* pbBuffer, int32_t pbSize, std::string& output) {
+    NativeProcessorPtr processor;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto iter = mProcessors.find(id);
+        if (iter == mProcessors.end()) {
+            return false;
+        }
+        processor = iter->second;
+    }
+    LogGroup logGroup;
+    if (!logGroup.ParseFromArray(pbBuffer, pbSize)) {
+        LOG_WARNING(sLogger, ("parse log group of native processor failed, id", id)("size", pbSize));
+        return false;
+    }
+    // Processors are stateless after created, log groups of a pipeline can be processed concurrently.
+    processor->Process(logGroup);
+    return logGroup.SerializeToString(&output);
+}
+
+size_t NativeProcessorManager::GetProcessorCount() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mProcessors.size();
+}
+
+} // namespace logtail
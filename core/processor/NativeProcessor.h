@@ -0,0 +1,81 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <json/json.h>
+#include "log_pb/sls_logs.pb.h"
+
+namespace logtail {
+
+// NativeProcessor processes log groups of plugin pipelines with the parsers of core, so processors such as
+// processor_regex can run natively instead of in Go. It is created from the plugin processor config
+// {"type": "...", "detail": {...}}, a subset of the Go parameters is supported:
+//   processor_regex: SourceKey, Regex, Keys
+//   processor_json: SourceKey
+//   processor_delimiter: SourceKey, Separator, Quote, Keys
+//   processor_filter_regex: Include, Exclude
+// Parsers also take KeepSource (false) and KeepSourceIfParseError (true). Log time is not changed.
+class NativeProcessor {
+public:
+    virtual ~NativeProcessor() = default;
+
+    // Create returns the processor of @config or NULL with @error if the type is not supported or the config
+    // is invalid, the Go processor should be used then.
+    static NativeProcessor* Create(const Json::Value& config, std::string& error);
+
+    virtual void Process(sls_logs::LogGroup& logGroup) = 0;
+};
+
+typedef std::shared_ptr<NativeProcessor> NativeProcessorPtr;
+
+// NativeProcessorManager holds native processors created by plugin through the plugin adapter, an id is
+// returned for each one and log groups are passed with it as serialized pb.
+class NativeProcessorManager {
+public:
+    static NativeProcessorManager* GetInstance() {
+        static NativeProcessorManager* ptr = new NativeProcessorManager();
+        return ptr;
+    }
+
+    // Create returns the id of the processor created from @config, or -1 with @error.
+    int64_t Create(const std::string& config, std::string& error);
+    bool Destroy(int64_t id);
+
+    // Process parses the log group [@pbBuffer, @pbBuffer + @pbSize) and processes it by processor @id, the
+    // result is serialized to @output.
+    bool Process(int64_t id, const char* pbBuffer, int32_t pbSize, std::string& output);
+
+    size_t GetProcessorCount();
+
+private:
+    NativeProcessorManager() = default;
+    ~NativeProcessorManager() = default;
+
+    std::mutex mMutex;
+    int64_t mNextId = 1;
+    std::unordered_map<int64_t, NativeProcessorPtr> mProcessors;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class NativeProcessorUnittest;
+#endif
+};
+
+} // namespace logtail
@@ -0,0 +1,106 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ProcessPipeline.h"
+#include <algorithm>
+#include "common/Constants.h"
+#include "common/Flags.h"
+#include "config/Config.h"
+#include "processor/LogFilter.h"
+#include "processor/LogToMetric.h"
+#include "sdk/Client.h"
+
+DECLARE_FLAG_BOOL(plugin_raw_log_batch_enable);
+DECLARE_FLAG_BOOL(process_filter_pushdown_enable);
+DECLARE_FLAG_INT32(process_log_to_metric_max_groups);
+
+namespace logtail {
+
+namespace {
+
+    // GetRequiredLiterals returns literals which every line accepted by the filter of @config contains.
+    std::vector<std::string> GetRequiredLiterals(const Config& config) {
+        std::vector<std::string> literals;
+        // Values of these parsers are copied from lines, JSON values can be unescaped into other bytes.
+        if (config.mPluginProcessFlag
+            || (config.mLogType != REGEX_LOG && config.mLogType != DELIMITER_LOG && config.mLogType != APSARA_LOG)) {
+            return literals;
+        }
+        // Same order as Aggregator::FilterNoneUtf8Metric.
+        const LogFilterProgram* program = NULL;
+        if (config.mAdvancedConfig.mFilterExpressionProgram) {
+            program = config.mAdvancedConfig.mFilterExpressionProgram.get();
+        } else if (config.mAdvancedConfig.mFilterExpressionRoot.get() == NULL && config.mFilterRule) {
+            program = config.mFilterRule->Program.get();
+        }
+        if (program == NULL) {
+            return literals;
+        }
+        for (const auto& item : program->GetRequiredLiterals()) {
+            const std::string& key = item.first;
+            const std::string& literal = item.second;
+            // Values generated by processing rather than copied from lines.
+            if (key == LOG_RESERVED_KEY_FILE_OFFSET
+                || (config.mAdvancedConfig.mEnablePreciseTimestamp
+                    && key == config.mAdvancedConfig.mPreciseTimestampKey)
+                || (config.mLogType == APSARA_LOG && key == "microtime")) {
+                continue;
+            }
+            // Quoted delimiter values are unescaped, a literal without quote is still in one run of the line.
+            if (config.mLogType == DELIMITER_LOG && literal.find(config.mQuote) != std::string::npos) {
+                continue;
+            }
+            if (std::find(literals.begin(), literals.end(), literal) == literals.end()) {
+                literals.push_back(literal);
+            }
+        }
+        // Longer literals are rarer, they reject lines earlier.
+        std::sort(literals.begin(), literals.end(), [](const std::string& lhs, const std::string& rhs) {
+            return lhs.size() > rhs.size();
+        });
+        return literals;
+    }
+
+} // namespace
+
+std::shared_ptr<const ProcessPipeline> ProcessPipeline::Compile(const Config& config) {
+    std::shared_ptr<ProcessPipeline> pipeline = std::make_shared<ProcessPipeline>();
+    if (config.PassingTagsToPlugin()) {
+        pipeline->mPluginStage = BOOL_FLAG(plugin_raw_log_batch_enable) ? PLUGIN_STAGE_RAW_LOGS_V2
+                                                                         : PLUGIN_STAGE_RAW_LOG_V2;
+    }
+    pipeline->mAppendPositionMeta = config.mAdvancedConfig.mEnableLogPositionMeta;
+    pipeline->mKeepUnmatch = !config.mDiscardUnmatch;
+    pipeline->mAppendTruncateInfo = config.mIsFuseMode;
+    pipeline->mCompressType = sdk::Client::GetCompressType(config.mCompressType);
+
+    // Both are not modified after loaded, log groups share them with the config.
+    if (config.mIntegrityConfig && config.mIntegrityConfig->mIntegritySwitch) {
+        pipeline->mIntegrityConfig = config.mIntegrityConfig;
+    }
+    if (config.mLineCountConfig && config.mLineCountConfig->mLineCountSwitch) {
+        pipeline->mLineCountConfig = config.mLineCountConfig;
+    }
+    pipeline->mCollapseRepeatedLines = config.mAdvancedConfig.mCollapseRepeatedLines;
+    if (config.mAdvancedConfig.mLogToMetric) {
+        pipeline->mLogToMetric = std::make_shared<LogToMetricAggregator>(
+            *config.mAdvancedConfig.mLogToMetric, static_cast<size_t>(INT32_FLAG(process_log_to_metric_max_groups)));
+    }
+    if (BOOL_FLAG(process_filter_pushdown_enable)) {
+        pipeline->mRequiredLiterals = GetRequiredLiterals(config);
+    }
+    return pipeline;
+}
+
+} // namespace logtail
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "config/IntegrityConfig.h"
+#include "log_pb/sls_logs.pb.h"
+
+namespace logtail {
+
+class Config;
+class LogToMetricAggregator;
+
+// ProcessPipeline holds what LogProcess decides for every buffer of a config. It is compiled once when the
+// config is loaded, so buffers are processed without checking config switches or allocating per buffer.
+struct ProcessPipeline {
+    // How buffers of readers with plugin flag are passed to plugin.
+    enum PluginStage { PLUGIN_STAGE_RAW_LOG, PLUGIN_STAGE_RAW_LOG_V2, PLUGIN_STAGE_RAW_LOGS_V2 };
+
+    PluginStage mPluginStage = PLUGIN_STAGE_RAW_LOG;
+    // Append offset of buffer to tags passed to plugin.
+    bool mAppendPositionMeta = false;
+    // Keep the whole buffer as one log if it can not be split.
+    bool mKeepUnmatch = true;
+    // Append truncate info of buffer to log group tags.
+    bool mAppendTruncateInfo = false;
+    sls_logs::SlsCompressType mCompressType = sls_logs::SLS_CMP_LZ4;
+    // NULL if the switch is off.
+    IntegrityConfigPtr mIntegrityConfig;
+    LineCountConfigPtr mLineCountConfig;
+    // Lines which do not contain all of them are rejected by the filter of the config, they are dropped
+    // before parsed. Empty if the filter has no such literals or values are not always substrings of lines.
+    std::vector<std::string> mRequiredLiterals;
+    // Exact repeats of a line in the same buffer are dropped, the first one gets the repeat count.
+    bool mCollapseRepeatedLines = false;
+    // Logs accepted by the filter are aggregated here, NULL if log_to_metric is not set. Windows are kept
+    // until flushed by Aggregator::FlushLogToMetric, those still open when the config is reloaded are lost.
+    std::shared_ptr<LogToMetricAggregator> mLogToMetric;
+
+    static std::shared_ptr<const ProcessPipeline> Compile(const Config& config);
+};
+
+} // namespace logtail
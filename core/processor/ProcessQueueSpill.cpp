@@ -0,0 +1,236 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "ProcessQueueSpill.h"
+#include <errno.h>
+#include <string.h>
+#include <vector>
+#include "common/CompressTools.h"
+#include "common/FileSystemUtil.h"
+#include "common/MemoryBudget.h"
+#include "common/StringTools.h"
+#include "logger/Logger.h"
+#include "reader/LogBufferPool.h"
+#include "reader/LogFileReader.h"
+
+namespace logtail {
+
+namespace {
+
+const uint32_t kRecordMagic = 0x4c505153; // "SQPL"
+const char* const kSpillFileSuffix = ".spill";
+
+struct RecordHeader {
+    uint32_t mMagic;
+    uint32_t mRawSize;
+    uint32_t mSize;
+};
+
+} // namespace
+
+ProcessQueueSpill::ProcessQueueSpill(const std::string& dirPath, uint64_t maxBytes)
+    : mDirPath(dirPath), mMaxBytes(maxBytes) {
+    if (!Mkdirs(mDirPath)) {
+        LOG_ERROR(sLogger, ("create process queue spill dir fail", mDirPath)("errno", errno));
+        return;
+    }
+    std::vector<std::string> files;
+    if (GetAllFiles(mDirPath, std::string("*") + kSpillFileSuffix, files)) {
+        for (const auto& file : files) {
+            remove((mDirPath + PATH_SEPARATOR + file).c_str());
+        }
+    }
+}
+
+ProcessQueueSpill::~ProcessQueueSpill() {
+    std::lock_guard<std::mutex> lock(mStoreMapMutex);
+    for (auto& item : mStoreMap) {
+        Store& store = *item.second;
+        std::lock_guard<std::mutex> storeLock(store.mMutex);
+        for (const Record& record : store.mRecords) {
+            record.mBuffer->logFileReader->OnBufferRestored();
+            delete record.mBuffer;
+        }
+        store.mRecords.clear();
+        store.mRecordCount = 0;
+        CloseStore(store);
+    }
+}
+
+ProcessQueueSpill::Store* ProcessQueueSpill::FindStore(const LogstoreFeedBackKey& key) {
+    std::lock_guard<std::mutex> lock(mStoreMapMutex);
+    auto iter = mStoreMap.find(key);
+    return iter == mStoreMap.end() ? nullptr : iter->second.get();
+}
+
+ProcessQueueSpill::Store& ProcessQueueSpill::GetStore(const LogstoreFeedBackKey& key) {
+    std::lock_guard<std::mutex> lock(mStoreMapMutex);
+    std::unique_ptr<Store>& store = mStoreMap[key];
+    if (!store) {
+        store.reset(new Store);
+        store->mPath = mDirPath + PATH_SEPARATOR + ToString(key) + kSpillFileSuffix;
+    }
+    return *store;
+}
+
+bool ProcessQueueSpill::PushOrSpill(const LogstoreFeedBackKey& key,
+                                    LogBuffer* buffer,
+                                    bool valid,
+                                    const PushFunc& push) {
+    if (buffer->exactlyOnceCheckpoint || buffer->bufferSize <= 0) {
+        return push(buffer);
+    }
+    Store& store = GetStore(key);
+    std::lock_guard<std::mutex> lock(store.mMutex);
+    if (store.mRecords.empty()) {
+        if (valid && push(buffer)) {
+            return true;
+        }
+        // Pushed directly as before if it can not be spilled.
+        if (!CanSpill() || !Spill(store, buffer)) {
+            return push(buffer);
+        }
+        return true;
+    }
+    return CanSpill() && Spill(store, buffer);
+}
+
+bool ProcessQueueSpill::Spill(Store& store, LogBuffer* buffer) {
+    std::string data;
+    if (!CompressLz4(buffer->buffer, static_cast<uint32_t>(buffer->bufferSize), data)) {
+        LOG_WARNING(sLogger, ("compress spilled buffer fail, size", buffer->bufferSize));
+        return false;
+    }
+    if (store.mFile == nullptr) {
+        store.mFile = fopen(store.mPath.c_str(), "wb+");
+        if (store.mFile == nullptr) {
+            LOG_WARNING(sLogger, ("open spill file fail", store.mPath)("errno", errno));
+            return false;
+        }
+        store.mWriteOffset = 0;
+    }
+    RecordHeader header{kRecordMagic, static_cast<uint32_t>(buffer->bufferSize), static_cast<uint32_t>(data.size())};
+    if (fseek(store.mFile, static_cast<long>(store.mWriteOffset), SEEK_SET) != 0
+        || fwrite(&header, sizeof(header), 1, store.mFile) != 1
+        || fwrite(data.data(), data.size(), 1, store.mFile) != 1) {
+        LOG_WARNING(sLogger, ("write spill file fail", store.mPath)("errno", errno));
+        // The partial record is overwritten by next one.
+        clearerr(store.mFile);
+        return false;
+    }
+    const uint64_t recordBytes = sizeof(header) + data.size();
+    store.mRecords.push_back(Record{buffer, store.mWriteOffset, header.mSize});
+    ++store.mRecordCount;
+    store.mWriteOffset += recordBytes;
+    mSpilledBytes += recordBytes;
+    ++mSpilledCount;
+
+    buffer->logFileReader->OnBufferSpilled(static_cast<int64_t>(buffer->beginOffset));
+    // Only the data is released, the buffer keeps its size for restore.
+    MemoryBudget::Sub(MEMORY_COMPONENT_LOG_BUFFER, buffer->bufferSize);
+    buffer->slab.reset();
+    buffer->buffer = nullptr;
+    return true;
+}
+
+bool ProcessQueueSpill::Load(Store& store, const Record& record) {
+    LogBuffer* buffer = record.mBuffer;
+    RecordHeader header;
+    std::string data(record.mSize, '\0');
+    if (fflush(store.mFile) != 0 || fseek(store.mFile, static_cast<long>(record.mOffset), SEEK_SET) != 0
+        || fread(&header, sizeof(header), 1, store.mFile) != 1 || fread(&data[0], data.size(), 1, store.mFile) != 1) {
+        clearerr(store.mFile);
+        return false;
+    }
+    if (header.mMagic != kRecordMagic || header.mRawSize != static_cast<uint32_t>(buffer->bufferSize)
+        || header.mSize != record.mSize) {
+        return false;
+    }
+    // Readers append '\0' to the data, the slab padding leaves room for it.
+    LogBufferSlabPtr slab = LogBufferPool::GetInstance()->Acquire(buffer->bufferSize + 1);
+    if (!UncompressLz4(data, header.mRawSize, slab.get())) {
+        return false;
+    }
+    slab.get()[buffer->bufferSize] = '\0';
+    buffer->slab = slab;
+    buffer->buffer = slab.get();
+    MemoryBudget::Add(MEMORY_COMPONENT_LOG_BUFFER, buffer->bufferSize);
+    return true;
+}
+
+size_t ProcessQueueSpill::Restore(const LogstoreFeedBackKey& key, const CanPushFunc& canPush, const PushFunc& push) {
+    Store* store = FindStore(key);
+    if (store == nullptr || store->mRecordCount.load() == 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(store->mMutex);
+    size_t count = 0;
+    while (!store->mRecords.empty() && canPush()) {
+        const Record record = store->mRecords.front();
+        const bool loaded = Load(*store, record);
+        if (loaded && !push(record.mBuffer)) {
+            MemoryBudget::Sub(MEMORY_COMPONENT_LOG_BUFFER, record.mBuffer->bufferSize);
+            record.mBuffer->slab.reset();
+            record.mBuffer->buffer = nullptr;
+            break;
+        }
+        store->mRecords.pop_front();
+        --store->mRecordCount;
+        --mSpilledCount;
+        record.mBuffer->logFileReader->OnBufferRestored();
+        if (!loaded) {
+            // Dropped so that the logstore is not blocked by a broken record.
+            LOG_ERROR(sLogger,
+                      ("read spill file fail, buffer is discarded", store->mPath)("size", record.mBuffer->bufferSize)(
+                          "file", record.mBuffer->logFileReader->GetLogPath()));
+            delete record.mBuffer;
+            continue;
+        }
+        ++count;
+    }
+    if (store->mRecords.empty()) {
+        CloseStore(*store);
+    }
+    return count;
+}
+
+void ProcessQueueSpill::CloseStore(Store& store) {
+    if (store.mFile != nullptr) {
+        fclose(store.mFile);
+        store.mFile = nullptr;
+        remove(store.mPath.c_str());
+    }
+    mSpilledBytes -= store.mWriteOffset;
+    store.mWriteOffset = 0;
+}
+
+bool ProcessQueueSpill::HasSpilled(const LogstoreFeedBackKey& key) {
+    Store* store = FindStore(key);
+    return store != nullptr && store->mRecordCount.load() > 0;
+}
+
+bool ProcessQueueSpill::CanSpill() const {
+    return mSpilledBytes.load() < mMaxBytes;
+}
+
+uint64_t ProcessQueueSpill::GetSpilledBytes() const {
+    return mSpilledBytes.load();
+}
+
+uint64_t ProcessQueueSpill::GetSpilledCount() const {
+    return mSpilledCount.load();
+}
+
+} // namespace logtail
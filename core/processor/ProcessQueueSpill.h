@@ -0,0 +1,102 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "common/LogstoreFeedbackKey.h"
+
+namespace logtail {
+
+struct LogBuffer;
+
+// ProcessQueueSpill moves read buffers to local files when the process queue of their logstore is full, so
+// files rotated away quickly are still collected. Each logstore has one append-only file of LZ4 compressed
+// records, buffers are read back in order when the queue drains, and the file is removed once all are restored.
+//
+// While a logstore has spilled buffers, new buffers of it are spilled too to keep the order. The metadata of
+// spilled buffers stays in memory, only the data is on disk. Checkpoints of their readers stay at the first
+// spilled buffer (see LogFileReader::OnBufferSpilled), so the files are cleared on start. Buffers with exactly
+// once checkpoints are never spilled.
+class ProcessQueueSpill {
+public:
+    typedef std::function<bool(LogBuffer*)> PushFunc;
+    typedef std::function<bool()> CanPushFunc;
+
+    // @dirPath is created if absent, spill files left in it are removed.
+    ProcessQueueSpill(const std::string& dirPath, uint64_t maxBytes);
+    ~ProcessQueueSpill();
+
+    // PushOrSpill pushes @buffer by @push if nothing of @key is spilled and @valid (the queue is not full),
+    // otherwise spills it. It returns false if @buffer is neither pushed nor spilled, the caller still owns it.
+    bool PushOrSpill(const LogstoreFeedBackKey& key, LogBuffer* buffer, bool valid, const PushFunc& push);
+
+    // Restore pushes spilled buffers of @key in order by @push while @canPush, returns the count pushed.
+    size_t Restore(const LogstoreFeedBackKey& key, const CanPushFunc& canPush, const PushFunc& push);
+
+    bool HasSpilled(const LogstoreFeedBackKey& key);
+    // CanSpill returns false if spill files reach @maxBytes, a file is counted until all its records are restored.
+    bool CanSpill() const;
+    uint64_t GetSpilledBytes() const;
+    uint64_t GetSpilledCount() const;
+
+    ProcessQueueSpill(const ProcessQueueSpill&) = delete;
+    ProcessQueueSpill& operator=(const ProcessQueueSpill&) = delete;
+
+private:
+    struct Record {
+        LogBuffer* mBuffer;
+        uint64_t mOffset; // of the header
+        uint32_t mSize; // bytes of compressed data
+    };
+
+    struct Store {
+        std::mutex mMutex;
+        std::string mPath;
+        FILE* mFile = nullptr;
+        uint64_t mWriteOffset = 0; // size of the file, which is removed when all records are restored
+        std::deque<Record> mRecords;
+        std::atomic<size_t> mRecordCount{0}; // size of mRecords, read without mMutex
+    };
+
+    Store* FindStore(const LogstoreFeedBackKey& key);
+    Store& GetStore(const LogstoreFeedBackKey& key);
+    bool Spill(Store& store, LogBuffer* buffer);
+    bool Load(Store& store, const Record& record);
+    void CloseStore(Store& store);
+
+    const std::string mDirPath;
+    const uint64_t mMaxBytes;
+
+    mutable std::mutex mStoreMapMutex;
+    std::unordered_map<LogstoreFeedBackKey, std::unique_ptr<Store>> mStoreMap;
+
+    std::atomic<uint64_t> mSpilledBytes{0}; // total size of spill files
+    std::atomic<uint64_t> mSpilledCount{0};
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class ProcessQueueSpillUnittest;
+#endif
+};
+
+} // namespace logtail
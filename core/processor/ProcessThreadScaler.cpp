@@ -0,0 +1,69 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ProcessThreadScaler.h"
+#include <algorithm>
+#include "common/Flags.h"
+#include "logger/Logger.h"
+
+DEFINE_FLAG_BOOL(enable_process_thread_scaling, "scale count of active process threads by load", false);
+DEFINE_FLAG_INT32(process_thread_min_count, "min count of active process threads if scaling is enabled", 1);
+DEFINE_FLAG_INT32(process_thread_max_count,
+                  "max count of process threads if scaling is enabled, process_thread_count if not greater",
+                  0);
+DEFINE_FLAG_INT32(process_thread_scale_interval, "min interval to scale process threads, seconds", 5);
+DEFINE_FLAG_INT32(process_thread_scale_down_rounds, "idle intervals in a row before a process thread is removed", 3);
+DEFINE_FLAG_DOUBLE(process_thread_scale_up_full_ratio, "ratio of full process queues to add a process thread", 0.1);
+DEFINE_FLAG_DOUBLE(process_thread_scale_up_latency_ms, "buffer latency to add a process thread, milliseconds", 500);
+DEFINE_FLAG_DOUBLE(process_thread_scale_down_latency_ms,
+                   "buffer latency below which process threads are idle, milliseconds",
+                   50);
+DEFINE_FLAG_DOUBLE(process_thread_scale_cpu_level, "CPU level at or above which no process thread is added", 0.8);
+
+namespace logtail {
+
+ProcessThreadScaler::ProcessThreadScaler(int32_t minCount, int32_t maxCount, int32_t initCount)
+    : mMinCount(std::max(minCount, 1)), mMaxCount(std::max(maxCount, mMinCount)) {
+    mCount = std::min(std::max(initCount, mMinCount), mMaxCount);
+}
+
+int32_t ProcessThreadScaler::Update(
+    int32_t fullQueueCount, int32_t totalQueueCount, double latencyMs, double cpuLevel, int32_t curTime) {
+    if (curTime - mLastScaleTime < INT32_FLAG(process_thread_scale_interval)) {
+        return mCount;
+    }
+    mLastScaleTime = curTime;
+    const int32_t oldCount = mCount;
+    const bool queueFull
+        = fullQueueCount > 0 && fullQueueCount >= totalQueueCount * DOUBLE_FLAG(process_thread_scale_up_full_ratio);
+    const bool busy = queueFull || latencyMs >= DOUBLE_FLAG(process_thread_scale_up_latency_ms);
+    const bool idle = fullQueueCount == 0 && latencyMs < DOUBLE_FLAG(process_thread_scale_down_latency_ms);
+    mIdleRounds = idle ? mIdleRounds + 1 : 0;
+    if (cpuLevel > 1.0) {
+        mCount = std::max(mCount - 1, mMinCount);
+    } else if (busy && cpuLevel < DOUBLE_FLAG(process_thread_scale_cpu_level)) {
+        mCount = std::min(mCount + 1, mMaxCount);
+    } else if (mIdleRounds >= INT32_FLAG(process_thread_scale_down_rounds)) {
+        mCount = std::max(mCount - 1, mMinCount);
+        mIdleRounds = 0;
+    }
+    if (mCount != oldCount) {
+        LOG_INFO(sLogger,
+                 ("scale process threads from", oldCount)("to", mCount)("full queue count", fullQueueCount)(
+                     "latency ms", latencyMs)("cpu level", cpuLevel));
+    }
+    return mCount;
+}
+
+} // namespace logtail
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstdint>
+
+namespace logtail {
+
+// ProcessThreadScaler decides how many process threads are active, between @minCount and @maxCount.
+//
+// - A thread is added if many process queues are full or buffers wait long before processed, unless CPU usage
+//   is close to the limit.
+// - A thread is removed if CPU usage exceeds the limit, or if no queue is full and buffers are processed soon
+//   after read for process_thread_scale_down_rounds intervals in a row.
+//
+// Update is called by one thread periodically, the count changes at most once per process_thread_scale_interval.
+class ProcessThreadScaler {
+public:
+    ProcessThreadScaler(int32_t minCount, int32_t maxCount, int32_t initCount);
+
+    // Update returns the thread count by @fullQueueCount of @totalQueueCount process queues, the average
+    // latency from read to process of buffers since last call, and @cpuLevel (CPU usage relative to limit).
+    int32_t Update(int32_t fullQueueCount, int32_t totalQueueCount, double latencyMs, double cpuLevel, int32_t curTime);
+
+    int32_t GetCount() const { return mCount; }
+    int32_t GetMinCount() const { return mMinCount; }
+    int32_t GetMaxCount() const { return mMaxCount; }
+
+private:
+    const int32_t mMinCount;
+    const int32_t mMaxCount;
+    int32_t mCount;
+    int32_t mLastScaleTime = 0;
+    int32_t mIdleRounds = 0;
+};
+
+} // namespace logtail
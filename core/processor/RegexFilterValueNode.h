@@ -54,6 +54,9 @@ public:
         return false;
     }
 
+    const std::string& GetKey() const { return key; }
+    const boost::regex& GetRegex() const { return reg; }
+
 private:
     std::string key;
     boost::regex reg;
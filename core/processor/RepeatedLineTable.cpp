@@ -0,0 +1,65 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RepeatedLineTable.h"
+#include <cstring>
+#include "common/xxhash/xxhash.h"
+
+namespace logtail {
+
+RepeatedLineTable::RepeatedLineTable(size_t maxEntries) : mMaxEntries(maxEntries > 0 ? maxEntries : 1) {
+    // Keep the load factor under 1/2 so probing stays short.
+    size_t slotCount = 16;
+    while (slotCount < mMaxEntries * 2) {
+        slotCount <<= 1;
+    }
+    mSlots.assign(slotCount, -1);
+    mSlotMask = slotCount - 1;
+    mEntries.reserve(mMaxEntries);
+    mHashes.reserve(mMaxEntries);
+}
+
+bool RepeatedLineTable::IsRepeat(const char* data, size_t size, int32_t& entry) {
+    const uint64_t hash = XXH3_64bits(data, size);
+    size_t slot = static_cast<size_t>(hash) & mSlotMask;
+    while (mSlots[slot] >= 0) {
+        const int32_t index = mSlots[slot];
+        Entry& item = mEntries[index];
+        if (mHashes[index] == hash && item.mSize == size && memcmp(item.mData, data, size) == 0) {
+            ++item.mRepeats;
+            entry = index;
+            return true;
+        }
+        slot = (slot + 1) & mSlotMask;
+    }
+    if (mEntries.size() >= mMaxEntries || size > UINT32_MAX) {
+        entry = -1;
+        return false;
+    }
+    entry = static_cast<int32_t>(mEntries.size());
+    mSlots[slot] = entry;
+    mEntries.push_back(Entry{data, static_cast<uint32_t>(size), static_cast<uint32_t>(slot), 0, -1});
+    mHashes.push_back(hash);
+    return false;
+}
+
+void RepeatedLineTable::Clear() {
+    for (const Entry& item : mEntries) {
+        mSlots[item.mSlot] = -1;
+    }
+    mEntries.clear();
+    mHashes.clear();
+}
+
+} // namespace logtail
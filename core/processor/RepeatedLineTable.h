@@ -0,0 +1,58 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace logtail {
+
+// RepeatedLineTable finds exact repeats among lines of a window, such as a read buffer. The first line of
+// each content is kept and later copies are only counted on it, so a storm of the same line is parsed and
+// sent once. Lines are hashed by xxh3 and compared by bytes, they are not copied and must stay valid until
+// Clear. At most @maxEntries distinct lines are recorded, later new lines are kept without being recorded.
+class RepeatedLineTable {
+public:
+    struct Entry {
+        const char* mData;
+        uint32_t mSize;
+        // Slot index in mSlots, so Clear does not need to scan all slots.
+        uint32_t mSlot;
+        uint32_t mRepeats;
+        // Index of the log parsed from the line, -1 if it is not parsed into a log.
+        int32_t mLogIndex;
+    };
+
+    explicit RepeatedLineTable(size_t maxEntries);
+
+    // IsRepeat returns true if a line equal to @data has been added, the repeat is counted on its entry.
+    // Otherwise @data is added, @entry is its index, or -1 if the table is full.
+    bool IsRepeat(const char* data, size_t size, int32_t& entry);
+    void SetLogIndex(int32_t entry, int32_t logIndex) { mEntries[entry].mLogIndex = logIndex; }
+
+    const std::vector<Entry>& GetEntries() const { return mEntries; }
+    void Clear();
+
+private:
+    size_t mMaxEntries;
+    std::vector<Entry> mEntries;
+    std::vector<uint64_t> mHashes; // of entries
+    std::vector<int32_t> mSlots; // open addressing, entry index or -1
+    size_t mSlotMask;
+};
+
+} // namespace logtail
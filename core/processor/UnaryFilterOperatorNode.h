@@ -37,6 +37,8 @@ public:
         return false;
     }
 
+    const BaseFilterNodePtr& GetChild() const { return child; }
+
 private:
     FilterOperator op;
     BaseFilterNodePtr child;
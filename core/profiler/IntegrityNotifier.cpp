@@ -0,0 +1,226 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "IntegrityNotifier.h"
+#include <chrono>
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "common/Flags.h"
+#include "common/HashUtil.h"
+#include "common/LogstoreSenderQueue.h"
+#include "logger/Logger.h"
+#include "LogIntegrity.h"
+#include "LogLineCount.h"
+
+DEFINE_FLAG_BOOL(enable_async_integrity_notify,
+                 "handle line count and data integrity results in a dedicated thread instead of sender callbacks",
+                 false);
+DEFINE_FLAG_INT32(integrity_notify_queue_size, "max results waiting for the integrity notify thread", 65536);
+DEFINE_FLAG_INT32(integrity_notify_max_key_count, "interned keys are cleared if there are more of them", 100000);
+
+namespace logtail {
+
+IntegrityNotifier::IntegrityNotifier() : mQueue(INT32_FLAG(integrity_notify_queue_size)) {
+}
+
+void IntegrityNotifier::Start() {
+    if (!BOOL_FLAG(enable_async_integrity_notify) || IsStarted()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMux);
+        mStopped = false;
+    }
+    mThread = CreateThread([this]() { Run(); });
+    mStarted.store(true, std::memory_order_release);
+    LOG_INFO(sLogger, ("integrity notify thread", "start"));
+}
+
+void IntegrityNotifier::Stop() {
+    if (!IsStarted()) {
+        return;
+    }
+    // Results notified after this are handled by callers.
+    mStarted.store(false, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(mMux);
+        mStopped = true;
+    }
+    mStopCond.notify_one();
+    mThread.reset();
+}
+
+void IntegrityNotifier::Notify(LoggroupTimeValue* data, bool success) {
+    const LogGroupContext& context = data->mLogGroupContext;
+    uint32_t flags = success ? EVENT_SUCCESS : 0;
+    if (context.mIntegrityConfigPtr.get() != NULL && context.mIntegrityConfigPtr->mIntegritySwitch) {
+        flags |= EVENT_INTEGRITY;
+    }
+    if (success && context.mLineCountConfigPtr.get() != NULL && context.mLineCountConfigPtr->mLineCountSwitch) {
+        flags |= EVENT_LINE_COUNT;
+    }
+    if ((flags & (EVENT_INTEGRITY | EVENT_LINE_COUNT)) == 0) {
+        return;
+    }
+
+    if (IsStarted() && !data->mFilename.empty()) {
+        static const std::string sEmpty;
+        Event event;
+        if (flags & EVENT_LINE_COUNT) {
+            event.mKey = InternKey(data,
+                                   context.mLineCountConfigPtr->mLineCountProjectName,
+                                   context.mLineCountConfigPtr->mLineCountLogstore);
+        } else {
+            event.mKey = InternKey(data, sEmpty, sEmpty);
+        }
+        event.mSeqNum = context.mSeqNum;
+        event.mLines = data->mLogLines;
+        event.mLogTimeInMinute = data->mLogTimeInMinute;
+        event.mLastUpdateTime = data->mLastUpdateTime;
+        event.mFlags = flags;
+        ++mPending;
+        if (mQueue.TryPush(std::move(event))) {
+            return;
+        }
+        --mPending;
+    }
+
+    if (flags & EVENT_INTEGRITY) {
+        LogIntegrity::GetInstance()->Notify(data, success);
+    }
+    if (flags & EVENT_LINE_COUNT) {
+        LogLineCount::GetInstance()->NotifySuccess(data);
+    }
+}
+
+bool IntegrityNotifier::Drain(int32_t timeoutMs) {
+    std::unique_lock<std::mutex> lock(mMux);
+    return mEmptyCond.wait_for(
+        lock, std::chrono::milliseconds(timeoutMs), [this]() { return mPending.load() == 0; });
+}
+
+IntegrityNotifier::KeyPtr IntegrityNotifier::InternKey(const LoggroupTimeValue* data,
+                                                       const std::string& lineCountProject,
+                                                       const std::string& lineCountLogstore) {
+    struct KeyCache {
+        uint32_t mGeneration = 0;
+        std::unordered_multimap<int64_t, KeyPtr> mKeys;
+    };
+    static thread_local KeyCache sCache;
+
+    const uint32_t generation = mKeyGeneration.load(std::memory_order_acquire);
+    if (sCache.mGeneration != generation) {
+        sCache.mKeys.clear();
+        sCache.mGeneration = generation;
+    }
+    int64_t hash = HashString(data->mRegion.data(), data->mRegion.size(), kHashStringSeed);
+    hash = HashString(data->mProjectName.data(), data->mProjectName.size(), hash);
+    hash = HashString(data->mLogstore.data(), data->mLogstore.size(), hash);
+    hash = HashString(data->mFilename.data(), data->mFilename.size(), hash);
+    hash = HashString(lineCountProject.data(), lineCountProject.size(), hash);
+    hash = HashString(lineCountLogstore.data(), lineCountLogstore.size(), hash);
+    auto range = sCache.mKeys.equal_range(hash);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        const Key& key = *iter->second;
+        if (key.mFilename == data->mFilename && key.mLogstore == data->mLogstore
+            && key.mProjectName == data->mProjectName && key.mRegion == data->mRegion
+            && key.mLineCountProjectName == lineCountProject && key.mLineCountLogstore == lineCountLogstore) {
+            return iter->second;
+        }
+    }
+
+    KeyPtr key;
+    {
+        std::string keyStr = data->mRegion + "\n" + data->mProjectName + "\n" + data->mLogstore + "\n"
+            + data->mFilename + "\n" + lineCountProject + "\n" + lineCountLogstore;
+        PTScopedLock lock(mKeyMutex);
+        if (mKeys.size() >= static_cast<size_t>(INT32_FLAG(integrity_notify_max_key_count))) {
+            // Keys in queued events and caches are still valid, they are shared.
+            mKeys.clear();
+            mKeyGeneration.fetch_add(1, std::memory_order_release);
+        }
+        KeyPtr& item = mKeys[keyStr];
+        if (!item) {
+            item.reset(new Key{data->mRegion,
+                               data->mProjectName,
+                               data->mLogstore,
+                               data->mFilename,
+                               lineCountProject,
+                               lineCountLogstore});
+        }
+        key = item;
+    }
+    sCache.mKeys.insert(std::make_pair(hash, key));
+    return key;
+}
+
+void IntegrityNotifier::Handle(const Event& event) {
+    const Key& key = *event.mKey;
+    const bool success = (event.mFlags & EVENT_SUCCESS) != 0;
+    if (event.mFlags & EVENT_INTEGRITY) {
+        LogIntegrity::GetInstance()->Notify(key.mRegion,
+                                            key.mProjectName,
+                                            key.mLogstore,
+                                            key.mFilename,
+                                            event.mSeqNum,
+                                            event.mLines,
+                                            event.mLastUpdateTime,
+                                            success);
+    }
+    if (event.mFlags & EVENT_LINE_COUNT) {
+        LogLineCount::GetInstance()->NotifySuccess(key.mRegion,
+                                                   key.mProjectName,
+                                                   key.mLogstore,
+                                                   key.mFilename,
+                                                   key.mLineCountProjectName,
+                                                   key.mLineCountLogstore,
+                                                   event.mLogTimeInMinute,
+                                                   event.mLines);
+    }
+}
+
+void IntegrityNotifier::Run() {
+#if defined(__linux__)
+    // The results are only sent every several seconds, let hot paths go first.
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+    Event event;
+    while (true) {
+        while (mQueue.TryPop(event)) {
+            Handle(event);
+            event = Event();
+            if (--mPending == 0) {
+                std::lock_guard<std::mutex> lock(mMux);
+                mEmptyCond.notify_all();
+            }
+        }
+        LogIntegrity::GetInstance()->SendLogIntegrityInfo();
+        LogLineCount::GetInstance()->SendLineCountData();
+
+        std::unique_lock<std::mutex> lock(mMux);
+        if (mStopped) {
+            if (mPending.load() == 0) {
+                break;
+            }
+            continue;
+        }
+        mStopCond.wait_for(lock, std::chrono::milliseconds(100), [this]() { return mStopped; });
+    }
+    LOG_INFO(sLogger, ("integrity notify thread", "exit"));
+}
+
+} // namespace logtail
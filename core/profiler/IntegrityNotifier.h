@@ -0,0 +1,110 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <boost/thread.hpp>
+#include "common/Lock.h"
+#include "common/MpscRingQueue.h"
+#include "common/Thread.h"
+
+namespace logtail {
+// forward declaration
+struct LoggroupTimeValue;
+
+// IntegrityNotifier passes send results needed by line count and data integrity to a dedicated thread, so
+// sender callbacks never wait for their map locks. The thread also sends line count and integrity data
+// instead of process thread 0.
+//
+// Keys of the results are interned, each event only carries a pointer to the shared key. If it's not started
+// or the queue is full, results are handled in the caller thread as before.
+class IntegrityNotifier {
+public:
+    struct Key {
+        std::string mRegion;
+        std::string mProjectName;
+        std::string mLogstore;
+        std::string mFilename;
+        std::string mLineCountProjectName;
+        std::string mLineCountLogstore;
+    };
+    typedef std::shared_ptr<const Key> KeyPtr;
+
+    static IntegrityNotifier* GetInstance() {
+        static IntegrityNotifier* ptr = new IntegrityNotifier();
+        return ptr;
+    }
+
+    // Start starts the thread if enable_async_integrity_notify is true.
+    void Start();
+    void Stop();
+    bool IsStarted() const { return mStarted.load(std::memory_order_acquire); }
+
+    // Notify records the send result of @data for line count (success only) and data integrity.
+    void Notify(LoggroupTimeValue* data, bool success);
+
+    // Drain blocks until results queued are handled or @timeoutMs passes.
+    bool Drain(int32_t timeoutMs);
+
+private:
+    enum EventFlag { EVENT_LINE_COUNT = 1, EVENT_INTEGRITY = 2, EVENT_SUCCESS = 4 };
+
+    struct Event {
+        KeyPtr mKey;
+        int64_t mSeqNum = 0;
+        int32_t mLines = 0;
+        int32_t mLogTimeInMinute = 0;
+        int32_t mLastUpdateTime = 0;
+        uint32_t mFlags = 0;
+    };
+
+    IntegrityNotifier();
+    ~IntegrityNotifier() = default;
+
+    KeyPtr InternKey(const LoggroupTimeValue* data,
+                     const std::string& lineCountProject,
+                     const std::string& lineCountLogstore);
+    static void Handle(const Event& event);
+    void Run();
+
+    MpscRingQueue<Event> mQueue;
+    std::atomic_bool mStarted{false};
+    // Events pushed or being pushed but not handled yet.
+    std::atomic<size_t> mPending{0};
+
+    PTMutex mKeyMutex;
+    std::unordered_map<std::string, KeyPtr> mKeys;
+    // Increased when mKeys is cleared, so that threads drop their cached keys.
+    std::atomic<uint32_t> mKeyGeneration{0};
+
+    std::mutex mMux;
+    std::condition_variable mStopCond;
+    std::condition_variable mEmptyCond;
+    bool mStopped = false;
+    ThreadPtr mThread;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class IntegrityNotifierUnittest;
+#endif
+};
+
+} // namespace logtail
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "LogFileProfiler.h"
+#include "PipelineLatencyProfiler.h"
 #include <string>
 #include "common/version.h"
 #include "common/Constants.h"
@@ -27,6 +28,8 @@
 #include "config_manager/ConfigManager.h"
 #include "app_config/AppConfig.h"
 
+DECLARE_FLAG_BOOL(enable_pipeline_latency_profile);
+
 using namespace std;
 using namespace sls_logs;
 
@@ -113,6 +116,9 @@ bool LogFileProfiler::GetProfileData(LogGroup& logGroup, LogStoreStatistic* stat
     contentPtr->set_key("time_format_failures");
     contentPtr->set_value(ToString(statistic->mParseTimeFailures));
     contentPtr = logPtr->add_contents();
+    contentPtr->set_key("collapsed_lines");
+    contentPtr->set_value(ToString(statistic->mCollapsedLines));
+    contentPtr = logPtr->add_contents();
     contentPtr->set_key("file_dev");
     contentPtr->set_value(ToString(statistic->mFileDev));
     contentPtr = logPtr->add_contents();
@@ -133,6 +139,9 @@ bool LogFileProfiler::GetProfileData(LogGroup& logGroup, LogStoreStatistic* stat
     contentPtr = logPtr->add_contents();
     contentPtr->set_key("read_avg_delay");
     contentPtr->set_value(ToString(statistic->mReadCount == 0 ? 0 : statistic->mReadDelaySum / statistic->mReadCount));
+    contentPtr = logPtr->add_contents();
+    contentPtr->set_key("bytes_at_risk");
+    contentPtr->set_value(ToString(statistic->mBytesAtRisk));
 
     if (!statistic->mTags.empty()) {
         const std::vector<sls_logs::LogTag>& extraTags = statistic->mTags;
@@ -184,6 +193,9 @@ bool LogFileProfiler::GetProfileData(LogGroup& logGroup, LogStoreStatistic* stat
         contentPtr = logPtr->add_contents();
         contentPtr->set_key("sender_valid_flag");
         contentPtr->set_value(ToString(senderStatistics.mValidToSendFlag));
+        contentPtr = logPtr->add_contents();
+        contentPtr->set_key("send_queue_delay_ms");
+        contentPtr->set_value(senderStatistics.QueueDelayHistogramToString());
     }
 
     return true;
@@ -206,6 +218,10 @@ void LogFileProfiler::SendProfileData(bool forceSend) {
     int32_t curTime = time(NULL);
     if (!forceSend && (curTime - mLastSendTime < mSendInterval))
         return;
+    {
+        std::lock_guard<std::mutex> lock(mSlabLock);
+        MergeSlabsUnlocked();
+    }
     size_t sendRegionIndex = 0;
     Json::Value detail;
     Json::Value logstore;
@@ -248,6 +264,15 @@ void LogFileProfiler::SendProfileData(bool forceSend) {
         UpdateDumpData(logGroup, detail, logstore);
         mProfileSender.SendToProfileProject(region, logGroup);
     } while (true);
+    if (BOOL_FLAG(enable_pipeline_latency_profile)) {
+        std::map<std::string, LogGroup> latencyLogGroups;
+        PipelineLatencyProfiler::GetInstance()->Flush(latencyLogGroups);
+        for (auto& item : latencyLogGroups) {
+            item.second.set_category("shennong_log_profile");
+            item.second.set_source(LogFileProfiler::mIpAddr);
+            mProfileSender.SendToProfileProject(item.first, item.second);
+        }
+    }
     DumpToLocal(curTime, forceSend, detail, logstore);
     mLastSendTime = curTime;
 }
@@ -266,7 +291,8 @@ void LogFileProfiler::AddProfilingData(const std::string& configName,
                                        uint64_t parseTimeFailures,
                                        uint64_t historyFailures,
                                        uint64_t sendFailures,
-                                       const std::string& errorLine) {
+                                       const std::string& errorLine,
+                                       uint64_t collapsedLines) {
     if (!filename.empty()) {
         // logstore statistics
         AddProfilingData(configName,
@@ -283,7 +309,8 @@ void LogFileProfiler::AddProfilingData(const std::string& configName,
                          parseTimeFailures,
                          historyFailures,
                          sendFailures,
-                         "");
+                         "",
+                         collapsedLines);
     }
     string key = projectName + "_" + category + "_" + filename;
     std::lock_guard<std::mutex> lock(mStatisticLock);
@@ -298,6 +325,7 @@ void LogFileProfiler::AddProfilingData(const std::string& configName,
         (iter->second)->mParseTimeFailures += parseTimeFailures;
         (iter->second)->mHistoryFailures += historyFailures;
         (iter->second)->mSendFailures += sendFailures;
+        (iter->second)->mCollapsedLines += collapsedLines;
         if ((iter->second)->mErrorLine.empty())
             (iter->second)->mErrorLine = errorLine;
         (iter->second)->mLastUpdateTime = time(NULL);
@@ -335,10 +363,125 @@ void LogFileProfiler::AddProfilingData(const std::string& configName,
                                                 sendFailures,
                                                 errorLine);
         }
+        statistic->mCollapsedLines = collapsedLines;
         statisticsMap.insert(std::pair<string, LogStoreStatistic*>(key, statistic));  
     }    
 }
 
+LogFileProfilingEntryPtr LogFileProfiler::CreateProfilingEntry(const std::string& configName,
+                                                               const std::string& region,
+                                                               const std::string& projectName,
+                                                               const std::string& category,
+                                                               const std::string& filename,
+                                                               const std::vector<sls_logs::LogTag>& tags) {
+    LogFileProfilingEntryPtr entry(new LogFileProfilingEntry);
+    entry->mConfigName = configName;
+    entry->mRegion = region;
+    entry->mProjectName = projectName;
+    entry->mCategory = category;
+    entry->mFilename = filename;
+    entry->mTags = tags;
+    return entry;
+}
+
+void LogFileProfiler::AddProfilingData(const LogFileProfilingEntryPtr& entry,
+                                       uint64_t readBytes,
+                                       uint64_t skipBytes,
+                                       uint64_t splitLines,
+                                       uint64_t parseFailures,
+                                       uint64_t regexMatchFailures,
+                                       uint64_t parseTimeFailures,
+                                       uint64_t historyFailures,
+                                       uint64_t sendFailures,
+                                       const std::string& errorLine,
+                                       uint64_t collapsedLines) {
+    ProfilingSlab* slab = GetThreadSlab();
+    ScopedSpinLock lock(slab->mLock);
+    ProfilingCounters& counters = slab->mCounters[entry.get()];
+    if (!counters.mEntry) {
+        counters.mEntry = entry;
+    }
+    counters.mReadBytes += readBytes;
+    counters.mSkipBytes += skipBytes;
+    counters.mSplitLines += splitLines;
+    counters.mParseFailures += parseFailures;
+    counters.mRegexMatchFailures += regexMatchFailures;
+    counters.mParseTimeFailures += parseTimeFailures;
+    counters.mHistoryFailures += historyFailures;
+    counters.mSendFailures += sendFailures;
+    counters.mCollapsedLines += collapsedLines;
+    if (counters.mErrorLine.empty()) {
+        counters.mErrorLine = errorLine;
+    }
+}
+
+// ProfilingSlabHolder gives back the slab of a thread when the thread exits, so counters left are not lost.
+struct LogFileProfiler::ProfilingSlabHolder {
+    ~ProfilingSlabHolder() {
+        if (mSlab != NULL) {
+            LogFileProfiler::GetInstance()->ReleaseSlab(mSlab);
+        }
+    }
+
+    ProfilingSlab* mSlab = NULL;
+};
+
+LogFileProfiler::ProfilingSlab* LogFileProfiler::GetThreadSlab() {
+    static thread_local ProfilingSlabHolder sHolder;
+    if (sHolder.mSlab == NULL) {
+        sHolder.mSlab = new ProfilingSlab;
+        std::lock_guard<std::mutex> lock(mSlabLock);
+        mSlabs.push_back(sHolder.mSlab);
+    }
+    return sHolder.mSlab;
+}
+
+void LogFileProfiler::ReleaseSlab(ProfilingSlab* slab) {
+    std::lock_guard<std::mutex> lock(mSlabLock);
+    for (auto iter = mSlabs.begin(); iter != mSlabs.end(); ++iter) {
+        if (*iter == slab) {
+            mSlabs.erase(iter);
+            break;
+        }
+    }
+    MergeSlab(*slab);
+    delete slab;
+}
+
+void LogFileProfiler::MergeSlabsUnlocked() {
+    for (auto slab : mSlabs) {
+        MergeSlab(*slab);
+    }
+}
+
+void LogFileProfiler::MergeSlab(ProfilingSlab& slab) {
+    std::unordered_map<const LogFileProfilingEntry*, ProfilingCounters> counters;
+    {
+        ScopedSpinLock lock(slab.mLock);
+        counters.swap(slab.mCounters);
+    }
+    for (const auto& item : counters) {
+        const ProfilingCounters& c = item.second;
+        const LogFileProfilingEntry& entry = *c.mEntry;
+        AddProfilingData(entry.mConfigName,
+                         entry.mRegion,
+                         entry.mProjectName,
+                         entry.mCategory,
+                         entry.mFilename,
+                         entry.mTags,
+                         c.mReadBytes,
+                         c.mSkipBytes,
+                         c.mSplitLines,
+                         c.mParseFailures,
+                         c.mRegexMatchFailures,
+                         c.mParseTimeFailures,
+                         c.mHistoryFailures,
+                         c.mSendFailures,
+                         c.mErrorLine,
+                         c.mCollapsedLines);
+    }
+}
+
 void LogFileProfiler::AddProfilingSkipBytes(const std::string& configName,
                                             const std::string& region,
                                             const std::string& projectName,
@@ -380,18 +523,29 @@ void LogFileProfiler::AddProfilingReadBytes(const std::string& configName,
                                             uint64_t inode,
                                             uint64_t fileSize,
                                             uint64_t readOffset,
-                                            int32_t lastReadTime) {
+                                            int32_t lastReadTime,
+                                            uint64_t bytesAtRisk) {
     if (!filename.empty()) {
         // logstore statistics
-        AddProfilingReadBytes(
-            configName, region, projectName, category, "", tags, dev, inode, fileSize, readOffset, lastReadTime);
+        AddProfilingReadBytes(configName,
+                              region,
+                              projectName,
+                              category,
+                              "",
+                              tags,
+                              dev,
+                              inode,
+                              fileSize,
+                              readOffset,
+                              lastReadTime,
+                              bytesAtRisk);
     }
     string key = projectName + "_" + category + "_" + filename;
     std::lock_guard<std::mutex> lock(mStatisticLock);
     LogstoreSenderStatisticsMap& statisticsMap = *MakesureRegionStatisticsMapUnlocked(region);
     std::unordered_map<string, LogStoreStatistic*>::iterator iter = statisticsMap.find(key);
     if (iter != statisticsMap.end()) {
-        (iter->second)->UpdateReadInfo(dev, inode, fileSize, readOffset, lastReadTime);
+        (iter->second)->UpdateReadInfo(dev, inode, fileSize, readOffset, lastReadTime, bytesAtRisk);
     } else {
         LogStoreStatistic* statistic = NULL;
         if (filename.empty()) {
@@ -400,7 +554,7 @@ void LogFileProfiler::AddProfilingReadBytes(const std::string& configName,
         } else {
             statistic = new LogStoreStatistic(configName, projectName, category, filename, tags);
         }
-        statistic->UpdateReadInfo(dev, inode, fileSize, readOffset, lastReadTime);
+        statistic->UpdateReadInfo(dev, inode, fileSize, readOffset, lastReadTime, bytesAtRisk);
         statisticsMap.insert(std::pair<string, LogStoreStatistic*>(key, statistic));
     }
 }
@@ -480,6 +634,8 @@ void LogFileProfiler::UpdateDumpData(const sls_logs::LogGroup& logGroup, Json::V
                 category["read_offset"] = value;
             else if (key == "read_avg_delay")
                 category["read_avg_delay"] = value;
+            else if (key == "bytes_at_risk")
+                category["bytes_at_risk"] = value;
             else if (key == "max_unsend_time")
                 category["max_unsend_time"] = value;
             else if (key == "min_unsend_time")
@@ -513,6 +669,10 @@ void LogFileProfiler::UpdateDumpData(const sls_logs::LogGroup& logGroup, Json::V
 uint64_t LogFileProfiler::GetProfilingLines(const std::string& projectName,
                                             const std::string& category,
                                             const std::string& filename) {
+    {
+        std::lock_guard<std::mutex> lock(mSlabLock);
+        MergeSlabsUnlocked();
+    }
     std::string key = projectName + "_" + category + "_" + filename;
     std::lock_guard<std::mutex> lock(mStatisticLock);
     if (mAllStatisticsMap.size() != (size_t)1) {
@@ -527,6 +687,13 @@ uint64_t LogFileProfiler::GetProfilingLines(const std::string& projectName,
 }
 
 void LogFileProfiler::CleanEnviroments() {
+    {
+        std::lock_guard<std::mutex> lock(mSlabLock);
+        for (auto slab : mSlabs) {
+            ScopedSpinLock slabLock(slab->mLock);
+            slab->mCounters.clear();
+        }
+    }
     std::lock_guard<std::mutex> lock(mStatisticLock);
     // just for test, memory leaks
     mAllStatisticsMap.clear();
@@ -20,7 +20,10 @@
 #include <mutex>
 #include <unordered_map>
 #include <map>
+#include <memory>
+#include <vector>
 #include <json/json.h>
+#include "common/Lock.h"
 #include "profile_sender/ProfileSender.h"
 #include "log_pb/sls_logs.pb.h"
 
@@ -33,6 +36,27 @@ namespace logtail {
 class Config;
 struct LoggroupTimeValue;
 
+// LogFileProfilingEntry identifies the statistics of a file, it's created once per reader so that the
+// statistics key needs not be built on every call of AddProfilingData.
+struct LogFileProfilingEntry {
+    bool Match(const std::string& configName,
+               const std::string& region,
+               const std::string& projectName,
+               const std::string& category,
+               const std::string& filename) const {
+        return mFilename == filename && mCategory == category && mProjectName == projectName
+            && mConfigName == configName && mRegion == region;
+    }
+
+    std::string mConfigName;
+    std::string mRegion;
+    std::string mProjectName;
+    std::string mCategory;
+    std::string mFilename;
+    std::vector<sls_logs::LogTag> mTags;
+};
+typedef std::shared_ptr<LogFileProfilingEntry> LogFileProfilingEntryPtr;
+
 // Collect the log file's profile such as lines processed.
 class LogFileProfiler {
 public:
@@ -55,7 +79,30 @@ public:
                           uint64_t parseTimeFailures,
                           uint64_t historyFailures,
                           uint64_t sendFailures,
-                          const std::string& errorLine);
+                          const std::string& errorLine,
+                          uint64_t collapsedLines = 0);
+
+    LogFileProfilingEntryPtr CreateProfilingEntry(const std::string& configName,
+                                                  const std::string& region,
+                                                  const std::string& projectName,
+                                                  const std::string& category,
+                                                  const std::string& filename,
+                                                  const std::vector<sls_logs::LogTag>& tags);
+
+    // AddProfilingData adds data into the counters of current thread without the global lock, counters
+    // of all threads are merged when profile data is sent.
+    void AddProfilingData(const LogFileProfilingEntryPtr& entry,
+                          uint64_t readBytes,
+                          uint64_t skipBytes,
+                          uint64_t splitLines,
+                          uint64_t parseFailures,
+                          uint64_t regexMatchFailures,
+                          uint64_t parseTimeFailures,
+                          uint64_t historyFailures,
+                          uint64_t sendFailures,
+                          const std::string& errorLine,
+                          uint64_t collapsedLines = 0);
+
     void AddProfilingSkipBytes(const std::string& configName,
                                const std::string& region,
                                const std::string& projectName,
@@ -74,7 +121,8 @@ public:
                                uint64_t inode,
                                uint64_t fileSize,
                                uint64_t readOffset,
-                               int32_t lastReadTime);
+                               int32_t lastReadTime,
+                               uint64_t bytesAtRisk = 0);
 
     void SendProfileData(bool forceSend = false);
 
@@ -130,6 +178,8 @@ private:
             mLastReadTime = 0;
             mReadCount = 0;
             mReadDelaySum = 0;
+            mBytesAtRisk = 0;
+            mCollapsedLines = 0;
         }
 
         void Reset() {
@@ -140,6 +190,7 @@ private:
             mLastReadTime = 0;
             mReadCount = 0;
             mReadDelaySum = 0;
+            mBytesAtRisk = 0;
             mReadBytes = 0;
             mSkipBytes = 0;
             mSplitLines = 0;
@@ -148,11 +199,16 @@ private:
             mParseTimeFailures = 0;
             mHistoryFailures = 0;
             mSendFailures = 0;
+            mCollapsedLines = 0;
             mErrorLine.clear();
         }
 
-        void
-        UpdateReadInfo(uint64_t dev, uint64_t inode, uint64_t fileSize, uint64_t readOffset, int32_t lastReadTime) {
+        void UpdateReadInfo(uint64_t dev,
+                            uint64_t inode,
+                            uint64_t fileSize,
+                            uint64_t readOffset,
+                            int32_t lastReadTime,
+                            uint64_t bytesAtRisk) {
             mFileDev = dev;
             mFileInode = inode;
             mFileSize = fileSize;
@@ -160,6 +216,7 @@ private:
             mLastReadTime = lastReadTime;
             ++mReadCount;
             mReadDelaySum += fileSize > readOffset ? fileSize - readOffset : 0;
+            mBytesAtRisk = bytesAtRisk;
         }
 
         std::string mConfigName;
@@ -186,6 +243,8 @@ private:
         uint64_t mHistoryFailures;
         // how many lines send fails
         uint64_t mSendFailures;
+        // how many lines are dropped as repeats of a previous line, see collapse_repeated_lines
+        uint64_t mCollapsedLines;
         // one sample error line
         std::string mErrorLine;
         int32_t mLastUpdateTime;
@@ -200,8 +259,38 @@ private:
         // mReadDelaySum += mFileSize - mReadOffset every call
         // then average delay is mReadDelaySum / mReadCount
         uint64_t mReadDelaySum;
+        // unread bytes of a deleted, rotated or container stopped file at last read, see LogFileReader::GetBytesAtRisk
+        uint64_t mBytesAtRisk;
+    };
+
+    struct ProfilingCounters {
+        LogFileProfilingEntryPtr mEntry;
+        uint64_t mReadBytes = 0;
+        uint64_t mSkipBytes = 0;
+        uint64_t mSplitLines = 0;
+        uint64_t mParseFailures = 0;
+        uint64_t mRegexMatchFailures = 0;
+        uint64_t mParseTimeFailures = 0;
+        uint64_t mHistoryFailures = 0;
+        uint64_t mSendFailures = 0;
+        uint64_t mCollapsedLines = 0;
+        std::string mErrorLine;
     };
 
+    // ProfilingSlab keeps the counters of one thread, the lock is only contended when the slab is merged.
+    struct ProfilingSlab {
+        SpinLock mLock;
+        // entries are kept alive by counters, so their addresses are not reused before merged.
+        std::unordered_map<const LogFileProfilingEntry*, ProfilingCounters> mCounters;
+    };
+    struct ProfilingSlabHolder;
+
+    ProfilingSlab* GetThreadSlab();
+    void ReleaseSlab(ProfilingSlab* slab);
+    // MergeSlabsUnlocked moves counters of all slabs into mAllStatisticsMap, mSlabLock must be held.
+    void MergeSlabsUnlocked();
+    void MergeSlab(ProfilingSlab& slab);
+
     std::string mDumpFileName;
     std::string mBakDumpFileName;
     int32_t mLastSendTime;
@@ -211,6 +300,8 @@ private:
     // key : region, value :unordered_map<std::string, LogStoreStatistic*>
     std::map<std::string, LogstoreSenderStatisticsMap*> mAllStatisticsMap;
     std::mutex mStatisticLock;
+    std::mutex mSlabLock;
+    std::vector<ProfilingSlab*> mSlabs;
     ProfileSender mProfileSender;
 
     LogFileProfiler();
@@ -224,6 +315,7 @@ private:
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class EventDispatcherTest;
     friend class SenderUnittest;
+    friend class LogFileProfilerUnittest;
 
     uint64_t
     GetProfilingLines(const std::string& projectName, const std::string& category, const std::string& filename);
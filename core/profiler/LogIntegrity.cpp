@@ -251,11 +251,24 @@ void LogIntegrity::RecordIntegrityInfo(MergeItem* item) {
 }
 
 void LogIntegrity::Notify(LoggroupTimeValue* data, bool flag) {
-    const string& region = data->mRegion;
-    const string& projectName = data->mProjectName;
-    const string& logstore = data->mLogstore;
-    const string& filename = data->mFilename;
+    Notify(data->mRegion,
+           data->mProjectName,
+           data->mLogstore,
+           data->mFilename,
+           data->mLogGroupContext.mSeqNum,
+           data->mLogLines,
+           data->mLastUpdateTime,
+           flag);
+}
 
+void LogIntegrity::Notify(const std::string& region,
+                          const std::string& projectName,
+                          const std::string& logstore,
+                          const std::string& filename,
+                          int64_t seqNum,
+                          int32_t lines,
+                          int32_t lastUpdateTime,
+                          bool flag) {
     // empty filename, filter metric data and data-integrity data
     if (filename.empty()) {
         LOG_DEBUG(sLogger,
@@ -266,15 +279,15 @@ void LogIntegrity::Notify(LoggroupTimeValue* data, bool flag) {
     LOG_DEBUG(sLogger,
               (flag ? "notify success, region" : "notify fail, region",
                region)("project_name", projectName)("logstore", logstore)("filename", filename)(
-                  "seq num", data->mLogGroupContext.mSeqNum)("lines", data->mLogLines));
+                  "seq num", seqNum)("lines", lines));
 
     // lock
     PTScopedLock lock(mLogIntegrityMapLock);
     LogIntegrityInfo* info = NULL;
     if (FindLogIntegrityInfo(region, projectName, logstore, filename, info)) {
-        info->mLastUpdateTime = data->mLastUpdateTime;
-        info->SetStatus(data->mLogGroupContext.mSeqNum,
-                        data->mLogLines,
+        info->mLastUpdateTime = lastUpdateTime;
+        info->SetStatus(seqNum,
+                        lines,
                         flag ? LogTimeInfo::LogIntegrityStatus_SendOK : LogTimeInfo::LogIntegrityStatus_SendFail);
         if (!flag)
             info->mSendSucceededFlag = false;
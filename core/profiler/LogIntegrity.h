@@ -147,6 +147,14 @@ public:
 public:
     void RecordIntegrityInfo(MergeItem* item);
     void Notify(LoggroupTimeValue* data, bool flag);
+    void Notify(const std::string& region,
+                const std::string& projectName,
+                const std::string& logstore,
+                const std::string& filename,
+                int64_t seqNum,
+                int32_t lines,
+                int32_t lastUpdateTime,
+                bool flag);
     void SendLogIntegrityInfo();
     void EraseItemInMap(const std::string& region, const std::string& projectName, const std::string& logstore);
     void DumpIntegrityDataToLocal();
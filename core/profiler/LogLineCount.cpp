@@ -46,11 +46,24 @@ LogLineCount::~LogLineCount() {
 }
 
 void LogLineCount::NotifySuccess(LoggroupTimeValue* data) {
-    const std::string& region = data->mRegion;
-    const std::string& projectName = data->mProjectName;
-    const std::string& logStore = data->mLogstore;
-    const std::string& filename = data->mFilename;
+    NotifySuccess(data->mRegion,
+                  data->mProjectName,
+                  data->mLogstore,
+                  data->mFilename,
+                  data->mLogGroupContext.mLineCountConfigPtr->mLineCountProjectName,
+                  data->mLogGroupContext.mLineCountConfigPtr->mLineCountLogstore,
+                  data->mLogTimeInMinute,
+                  data->mLogLines);
+}
 
+void LogLineCount::NotifySuccess(const std::string& region,
+                                 const std::string& projectName,
+                                 const std::string& logStore,
+                                 const std::string& filename,
+                                 const std::string& cntProjectName,
+                                 const std::string& cntLogStore,
+                                 int32_t minuteTime,
+                                 int32_t logLines) {
     // empty filename, filter metric data and data-integrity data
     if (filename.empty()) {
         LOG_DEBUG(sLogger,
@@ -72,17 +85,11 @@ void LogLineCount::NotifySuccess(LoggroupTimeValue* data) {
     LogStoreLineCountMap::iterator projectLogStoreIter = logStoreLineCountMap->find(key);
     if (projectLogStoreIter == logStoreLineCountMap->end()) {
         LogStoreLineCount* lineCount
-            = new LogStoreLineCount(region,
-                                    projectName,
-                                    logStore,
-                                    data->mLogGroupContext.mLineCountConfigPtr->mLineCountProjectName,
-                                    data->mLogGroupContext.mLineCountConfigPtr->mLineCountLogstore);
+            = new LogStoreLineCount(region, projectName, logStore, cntProjectName, cntLogStore);
         projectLogStoreIter = logStoreLineCountMap->insert(std::make_pair(key, lineCount)).first;
     }
     LogStoreLineCount* lineCount = projectLogStoreIter->second;
 
-    const int32_t logLines = data->mLogLines;
-    const int32_t minuteTime = data->mLogTimeInMinute;
     LogStoreLineCount::LogCountPerMinuteMap::iterator minuteIter = lineCount->mLogCountPerMinuteMap.find(minuteTime);
     if (minuteIter == lineCount->mLogCountPerMinuteMap.end())
         lineCount->mLogCountPerMinuteMap.insert(std::make_pair(minuteTime, logLines));
@@ -37,6 +37,14 @@ public:
 
 public:
     void NotifySuccess(LoggroupTimeValue* data);
+    void NotifySuccess(const std::string& region,
+                       const std::string& projectName,
+                       const std::string& logStore,
+                       const std::string& filename,
+                       const std::string& cntProjectName,
+                       const std::string& cntLogStore,
+                       int32_t minuteTime,
+                       int32_t logLines);
     void InsertLineCountDataToLogGroup(sls_logs::LogGroup& logGroup,
                                        const std::string& region,
                                        const std::string& projectName,
@@ -105,6 +113,7 @@ private:
 
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class DataIntegrityUnittest;
+    friend class IntegrityNotifierUnittest;
 #endif
 };
 
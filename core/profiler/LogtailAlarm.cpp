@@ -19,6 +19,7 @@
 #include "common/LogtailCommonFlags.h"
 #include "common/version.h"
 #include "common/TimeUtil.h"
+#include "common/HashUtil.h"
 #include "log_pb/sls_logs.pb.h"
 #include "sender/Sender.h"
 #include "config_manager/ConfigManager.h"
@@ -27,6 +28,7 @@
 
 DEFINE_FLAG_INT32(logtail_alarm_interval, "the interval of two same type alarm message", 30);
 DEFINE_FLAG_INT32(logtail_low_level_alarm_speed, "the speed(count/second) which logtail's low level alarm allow", 100);
+DEFINE_FLAG_INT32(logtail_alarm_counter_idle_timeout, "remove alarm counters without alarm for so many seconds", 3600);
 
 using namespace std;
 using namespace logtail;
@@ -109,6 +111,7 @@ LogtailAlarm::~LogtailAlarm() {
 bool LogtailAlarm::SendAlarmLoop() {
     LogtailAlarmMessage* messagePtr = NULL;
     while (true) {
+        FlushAlarmCounters();
         int32_t currentTime = time(NULL);
 
         size_t sendRegionIndex = 0;
@@ -270,21 +273,137 @@ void LogtailAlarm::SendAlarm(const LogtailAlarmType alarmType,
     }
 
     // ignore logtail self alarm
-    string profileProject = ConfigManager::GetInstance()->GetProfileProjectName(region);
-    if (!profileProject.empty() && profileProject == projectName) {
+    if (IsSelfAlarm(projectName, region)) {
         return;
     }
     // LOG_DEBUG(sLogger, ("Add Alarm", region)("projectName", projectName)("alarm index",
     // mMessageType[alarmType])("msg", message));
     std::lock_guard<std::mutex> lock(mAlarmBufferMutex);
+    AddAlarmUnlocked(alarmType, message, projectName, category, region, 1);
+}
+
+bool LogtailAlarm::IsSelfAlarm(const std::string& projectName, const std::string& region) {
+    string profileProject = ConfigManager::GetInstance()->GetProfileProjectName(region);
+    return !profileProject.empty() && profileProject == projectName;
+}
+
+void LogtailAlarm::AddAlarmUnlocked(LogtailAlarmType alarmType,
+                                    const std::string& message,
+                                    const std::string& projectName,
+                                    const std::string& category,
+                                    const std::string& region,
+                                    int32_t count) {
     string key = projectName + "_" + category;
     LogtailAlarmVector& alarmBufferVec = *MakesureLogtailAlarmMapVecUnlocked(region);
     if (alarmBufferVec[alarmType].find(key) == alarmBufferVec[alarmType].end()) {
         LogtailAlarmMessage* messagePtr
-            = new LogtailAlarmMessage(mMessageType[alarmType], projectName, category, message, 1);
+            = new LogtailAlarmMessage(mMessageType[alarmType], projectName, category, message, count);
         alarmBufferVec[alarmType].insert(pair<string, LogtailAlarmMessage*>(key, messagePtr));
     } else
-        alarmBufferVec[alarmType][key]->IncCount();
+        alarmBufferVec[alarmType][key]->IncCount(count);
+}
+
+LogtailAlarmCounter* LogtailAlarm::GetAlarmCounter(LogtailAlarmType alarmType,
+                                                   const std::string& projectName,
+                                                   const std::string& category,
+                                                   const std::string& region) {
+    if (alarmType < 0 || alarmType >= ALL_LOGTAIL_ALARM_NUM) {
+        return NULL;
+    }
+    struct CounterCache {
+        uint32_t mGeneration = 0;
+        std::unordered_multimap<int64_t, LogtailAlarmCounterPtr> mCounters;
+    };
+    static thread_local CounterCache sCache;
+
+    const uint32_t generation = mAlarmCounterGeneration.load(std::memory_order_acquire);
+    if (sCache.mGeneration != generation) {
+        sCache.mCounters.clear();
+        sCache.mGeneration = generation;
+    }
+    int64_t hash = HashString(projectName.data(), projectName.size(), kHashStringSeed + alarmType);
+    hash = HashString(category.data(), category.size(), hash);
+    hash = HashString(region.data(), region.size(), hash);
+    auto range = sCache.mCounters.equal_range(hash);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        const LogtailAlarmCounter& counter = *iter->second;
+        if (counter.mType == alarmType && counter.mProjectName == projectName && counter.mCategory == category
+            && counter.mRegion == region) {
+            return iter->second.get();
+        }
+    }
+
+    LogtailAlarmCounterPtr counter;
+    {
+        string key = ToString(alarmType) + "_" + projectName + "_" + category + "_" + region;
+        PTScopedLock lock(mAlarmCounterMutex);
+        LogtailAlarmCounterPtr& item = mAlarmCounters[key];
+        if (!item) {
+            item.reset(new LogtailAlarmCounter(alarmType, projectName, category, region));
+            item->mLastAlarmTime = time(NULL);
+        }
+        counter = item;
+    }
+    sCache.mCounters.insert(std::make_pair(hash, counter));
+    return counter.get();
+}
+
+void LogtailAlarm::FlushAlarmCounters() {
+    struct AlarmCount {
+        LogtailAlarmCounterPtr mCounter;
+        std::string mMessage;
+        int32_t mCount;
+    };
+    std::vector<AlarmCount> alarmCounts;
+    int32_t curTime = time(NULL);
+    {
+        PTScopedLock lock(mAlarmCounterMutex);
+        bool removed = false;
+        for (auto iter = mAlarmCounters.begin(); iter != mAlarmCounters.end();) {
+            LogtailAlarmCounter& counter = *iter->second;
+            // take message before count, a thread which counts the first alarm sets message after counting
+            std::string message;
+            bool hasMessage = false;
+            {
+                ScopedSpinLock messageLock(counter.mMessageLock);
+                message.swap(counter.mMessage);
+                std::swap(hasMessage, counter.mHasMessage);
+            }
+            int32_t count = counter.mCount.exchange(0);
+            if (count > 0 && !hasMessage) {
+                // message of the first alarm is being built, flush them next time
+                counter.mCount.fetch_add(count);
+                ++iter;
+                continue;
+            }
+            if (count > 0) {
+                counter.mLastAlarmTime = curTime;
+                alarmCounts.push_back(AlarmCount{iter->second, std::move(message), count});
+            } else if (curTime - counter.mLastAlarmTime > INT32_FLAG(logtail_alarm_counter_idle_timeout)) {
+                iter = mAlarmCounters.erase(iter);
+                removed = true;
+                continue;
+            }
+            ++iter;
+        }
+        if (removed) {
+            mAlarmCounterGeneration.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    for (auto& alarmCount : alarmCounts) {
+        const LogtailAlarmCounter& counter = *alarmCount.mCounter;
+        if (IsSelfAlarm(counter.mProjectName, counter.mRegion)) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(mAlarmBufferMutex);
+        AddAlarmUnlocked(counter.mType,
+                         alarmCount.mMessage,
+                         counter.mProjectName,
+                         counter.mCategory,
+                         counter.mRegion,
+                         alarmCount.mCount);
+    }
 }
 
 void LogtailAlarm::ForceToSend() {
@@ -20,6 +20,8 @@
 #include <vector>
 #include <map>
 #include <atomic>
+#include <memory>
+#include <unordered_map>
 #include "common/Lock.h"
 #include "profile_sender/ProfileSender.h"
 
@@ -109,6 +111,28 @@ struct LogtailAlarmMessage {
     void IncCount(int32_t inc = 1) { mCount += inc; }
 };
 
+// LogtailAlarmCounter counts alarms of one (type, project, category, region) between two flushes of
+// SendAlarmLoop, only the message of the first alarm in a flush window is kept.
+struct LogtailAlarmCounter {
+    LogtailAlarmCounter(LogtailAlarmType type,
+                        const std::string& projectName,
+                        const std::string& category,
+                        const std::string& region)
+        : mType(type), mProjectName(projectName), mCategory(category), mRegion(region) {}
+
+    const LogtailAlarmType mType;
+    const std::string mProjectName;
+    const std::string mCategory;
+    const std::string mRegion;
+
+    std::atomic_int mCount{0};
+    SpinLock mMessageLock;
+    std::string mMessage;
+    bool mHasMessage = false;
+    int32_t mLastAlarmTime = 0; // protected by mAlarmCounterMutex of LogtailAlarm
+};
+typedef std::shared_ptr<LogtailAlarmCounter> LogtailAlarmCounterPtr;
+
 class LogtailAlarm {
 private:
     std::vector<std::string> mMessageType;
@@ -122,6 +146,27 @@ private:
     // without lock
     LogtailAlarmVector* MakesureLogtailAlarmMapVecUnlocked(const std::string& region);
 
+    // FlushAlarmCounters moves counts of alarm counters into alarm map, and removes counters idle for long.
+    void FlushAlarmCounters();
+    LogtailAlarmCounter* GetAlarmCounter(LogtailAlarmType alarmType,
+                                         const std::string& projectName,
+                                         const std::string& category,
+                                         const std::string& region);
+    bool IsSelfAlarm(const std::string& projectName, const std::string& region);
+    // without lock
+    void AddAlarmUnlocked(LogtailAlarmType alarmType,
+                          const std::string& message,
+                          const std::string& projectName,
+                          const std::string& category,
+                          const std::string& region,
+                          int32_t count);
+
+    // key: type + project + category + region, threads cache counters and drop the cache when
+    // generation changes, which happens when counters are removed.
+    std::unordered_map<std::string, LogtailAlarmCounterPtr> mAlarmCounters;
+    PTMutex mAlarmCounterMutex;
+    std::atomic<uint32_t> mAlarmCounterGeneration{0};
+
     std::atomic_int mLastLowLevelTime{0};
     std::atomic_int mLastLowLevelCount{0};
     ProfileSender mProfileSender;
@@ -132,6 +177,26 @@ public:
                    const std::string& projectName = "",
                    const std::string& category = "",
                    const std::string& region = "");
+    // CountAlarm works like SendAlarm for alarms on hot paths, it counts without lock, and calls
+    // @buildMessage only for the first alarm of the same type, project, category and region in a
+    // flush window, so the message is not built for alarms which are aggregated anyway.
+    template <typename MessageBuilder>
+    void CountAlarm(const LogtailAlarmType alarmType,
+                    const std::string& projectName,
+                    const std::string& category,
+                    const std::string& region,
+                    const MessageBuilder& buildMessage) {
+        LogtailAlarmCounter* counter = GetAlarmCounter(alarmType, projectName, category, region);
+        if (counter == NULL) {
+            return;
+        }
+        if (counter->mCount.fetch_add(1) == 0) {
+            std::string message = buildMessage();
+            ScopedSpinLock lock(counter->mMessageLock);
+            counter->mMessage.swap(message);
+            counter->mHasMessage = true;
+        }
+    }
     // only be called when prepare to exit
     void ForceToSend();
     bool IsLowLevelAlarmValid();
@@ -139,6 +204,10 @@ public:
         static LogtailAlarm* ptr = new LogtailAlarm();
         return ptr;
     }
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class LogtailAlarmUnittest;
+#endif
 };
 
 } // namespace logtail
@@ -0,0 +1,184 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "PipelineLatencyProfiler.h"
+#include "common/Flags.h"
+#include "common/LogstoreSenderQueue.h"
+#include "common/StringTools.h"
+#include "common/TimeUtil.h"
+#include "common/version.h"
+#include "app_config/AppConfig.h"
+#include "logger/Logger.h"
+#include "LogFileProfiler.h"
+
+DEFINE_FLAG_BOOL(enable_pipeline_latency_profile,
+                 "record per config latency of pipeline stages and send them to profile logstore",
+                 false);
+DEFINE_FLAG_INT32(pipeline_slow_trace_threshold_ms,
+                  "end to end latency in ms to sample a batch as slow trace, 0 to disable",
+                  60000);
+DEFINE_FLAG_INT32(pipeline_slow_trace_max_count, "max slow traces kept between two profile flushes", 10);
+
+using namespace std;
+using namespace sls_logs;
+
+namespace logtail {
+
+void PipelineLatencyProfiler::GetStageLatencies(const PipelineTimestamps& timestamps,
+                                                uint64_t ackTimeInMs,
+                                                int64_t* latencies) {
+    const uint64_t points[STAGE_END_TO_END + 1] = {timestamps.mReadTimeInMs,
+                                                   timestamps.mAggregateTimeInMs,
+                                                   timestamps.mEnqueueTimeInMs,
+                                                   timestamps.mSendTimeInMs,
+                                                   ackTimeInMs};
+    uint64_t first = 0;
+    for (int stage = STAGE_PROCESS; stage < STAGE_END_TO_END; ++stage) {
+        const uint64_t begin = points[stage], end = points[stage + 1];
+        latencies[stage] = (begin == 0 || end == 0 || end < begin) ? -1 : static_cast<int64_t>(end - begin);
+        if (first == 0) {
+            first = begin;
+        }
+    }
+    latencies[STAGE_END_TO_END]
+        = (first == 0 || ackTimeInMs < first) ? -1 : static_cast<int64_t>(ackTimeInMs - first);
+}
+
+const char* PipelineLatencyProfiler::GetStageName(Stage stage) {
+    switch (stage) {
+        case STAGE_PROCESS:
+            return "process_latency_ms";
+        case STAGE_AGGREGATE:
+            return "aggregate_latency_ms";
+        case STAGE_QUEUE:
+            return "queue_latency_ms";
+        case STAGE_SEND:
+            return "send_latency_ms";
+        case STAGE_END_TO_END:
+            return "end_to_end_latency_ms";
+        default:
+            return "unknown";
+    }
+}
+
+void PipelineLatencyProfiler::Record(const LoggroupTimeValue* data, uint64_t ackTimeInMs) {
+    // profile data and data from other sources without config are not traced
+    if (data->mConfigName.empty()) {
+        return;
+    }
+    int64_t latencies[STAGE_COUNT];
+    GetStageLatencies(data->mLogGroupContext.mTimestamps, ackTimeInMs, latencies);
+    if (latencies[STAGE_END_TO_END] < 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    ConfigLatency& configLatency = mConfigLatencies[data->mRegion + "_" + data->mConfigName];
+    if (configLatency.mConfigName.empty()) {
+        configLatency.mRegion = data->mRegion;
+        configLatency.mConfigName = data->mConfigName;
+        configLatency.mProjectName = data->mProjectName;
+        configLatency.mLogstore = data->mLogstore;
+    }
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        if (latencies[stage] >= 0) {
+            configLatency.mStages[stage].Record(static_cast<uint64_t>(latencies[stage]));
+        }
+    }
+
+    const int32_t threshold = INT32_FLAG(pipeline_slow_trace_threshold_ms);
+    if (threshold <= 0 || latencies[STAGE_END_TO_END] < threshold
+        || mSlowTraces.size() >= static_cast<size_t>(INT32_FLAG(pipeline_slow_trace_max_count))) {
+        return;
+    }
+    SlowTrace trace;
+    trace.mRegion = data->mRegion;
+    trace.mConfigName = data->mConfigName;
+    trace.mProjectName = data->mProjectName;
+    trace.mLogstore = data->mLogstore;
+    trace.mFilename = data->mFilename;
+    trace.mLogLines = data->mLogLines;
+    trace.mBytes = data->mLogData.size();
+    trace.mSendRetryTimes = data->mSendRetryTimes;
+    trace.mAckTime = time(NULL);
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        trace.mStages[stage] = latencies[stage];
+    }
+    mSlowTraces.push_back(trace);
+    LOG_DEBUG(sLogger,
+              ("slow pipeline batch", trace.mConfigName)("project", trace.mProjectName)("logstore", trace.mLogstore)(
+                  "file", trace.mFilename)("end to end latency ms", latencies[STAGE_END_TO_END]));
+}
+
+static void AddContent(Log* logPtr, const string& key, const string& value) {
+    Log_Content* contentPtr = logPtr->add_contents();
+    contentPtr->set_key(key);
+    contentPtr->set_value(value);
+}
+
+static Log* AddProfileLog(LogGroup& logGroup,
+                          const string& fileName,
+                          const string& configName,
+                          const string& projectName,
+                          const string& logstore) {
+    Log* logPtr = logGroup.add_logs();
+    logPtr->set_time(AppConfig::GetInstance()->EnableLogTimeAutoAdjust() ? time(NULL) + GetTimeDelta() : time(NULL));
+    AddContent(logPtr, "logreader_project_name", projectName);
+    AddContent(logPtr, "category", logstore);
+    AddContent(logPtr, "config_name", configName);
+    AddContent(logPtr, "file_name", fileName);
+    AddContent(logPtr, "logtail_version", ILOGTAIL_VERSION);
+    AddContent(logPtr, "source_ip", LogFileProfiler::mIpAddr);
+    return logPtr;
+}
+
+void PipelineLatencyProfiler::Flush(std::map<std::string, sls_logs::LogGroup>& regionLogGroups) {
+    std::unordered_map<std::string, ConfigLatency> configLatencies;
+    std::vector<SlowTrace> slowTraces;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        configLatencies.swap(mConfigLatencies);
+        slowTraces.swap(mSlowTraces);
+    }
+
+    for (auto& item : configLatencies) {
+        const ConfigLatency& configLatency = item.second;
+        Log* logPtr = AddProfileLog(regionLogGroups[configLatency.mRegion],
+                                    "pipeline_latency",
+                                    configLatency.mConfigName,
+                                    configLatency.mProjectName,
+                                    configLatency.mLogstore);
+        for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+            AddContent(logPtr, GetStageName(static_cast<Stage>(stage)), configLatency.mStages[stage].ToString());
+        }
+    }
+    for (auto& trace : slowTraces) {
+        Log* logPtr = AddProfileLog(regionLogGroups[trace.mRegion],
+                                    "pipeline_slow_trace",
+                                    trace.mConfigName,
+                                    trace.mProjectName,
+                                    trace.mLogstore);
+        AddContent(logPtr, "source_file", trace.mFilename);
+        AddContent(logPtr, "log_lines", ToString(trace.mLogLines));
+        AddContent(logPtr, "bytes", ToString(trace.mBytes));
+        AddContent(logPtr, "send_retry_times", ToString(trace.mSendRetryTimes));
+        AddContent(logPtr, "ack_time", ToString(trace.mAckTime));
+        for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+            AddContent(logPtr, GetStageName(static_cast<Stage>(stage)), ToString(trace.mStages[stage]));
+        }
+    }
+}
+
+} // namespace logtail
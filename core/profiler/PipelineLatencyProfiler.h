@@ -0,0 +1,98 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "common/Histogram.h"
+#include "log_pb/sls_logs.pb.h"
+
+namespace logtail {
+// forward declaration
+struct LoggroupTimeValue;
+struct PipelineTimestamps;
+
+// PipelineLatencyProfiler keeps per config latency distributions of the pipeline stages, from the
+// time a buffer is read from file to the time the log group holding it is acked by server.
+// The distributions are sent to the profile logstore with the file statistics, and batches slower
+// than pipeline_slow_trace_threshold_ms are sampled as trace records.
+class PipelineLatencyProfiler {
+public:
+    enum Stage {
+        STAGE_PROCESS, // read -> aggregate
+        STAGE_AGGREGATE, // aggregate -> enqueue
+        STAGE_QUEUE, // enqueue -> last send, including retries
+        STAGE_SEND, // last send -> ack
+        STAGE_END_TO_END, // first recorded stage -> ack
+        STAGE_COUNT
+    };
+
+    static PipelineLatencyProfiler* GetInstance() {
+        static PipelineLatencyProfiler* ptr = new PipelineLatencyProfiler();
+        return ptr;
+    }
+
+    // Record is called when @data is acked at @ackTimeInMs (GetSteadyTimeInMilliSeconds).
+    void Record(const LoggroupTimeValue* data, uint64_t ackTimeInMs);
+
+    // Flush appends statistics since last flush to log groups of their regions, then resets them.
+    void Flush(std::map<std::string, sls_logs::LogGroup>& regionLogGroups);
+
+    // GetStageLatencies fills latency of each stage in ms, -1 for stages not recorded.
+    static void GetStageLatencies(const PipelineTimestamps& timestamps, uint64_t ackTimeInMs, int64_t* latencies);
+
+    static const char* GetStageName(Stage stage);
+
+private:
+    struct ConfigLatency {
+        std::string mRegion;
+        std::string mConfigName;
+        std::string mProjectName;
+        std::string mLogstore;
+        Histogram mStages[STAGE_COUNT];
+    };
+
+    struct SlowTrace {
+        std::string mRegion;
+        std::string mConfigName;
+        std::string mProjectName;
+        std::string mLogstore;
+        std::string mFilename;
+        int32_t mLogLines;
+        size_t mBytes;
+        int32_t mSendRetryTimes;
+        time_t mAckTime;
+        int64_t mStages[STAGE_COUNT];
+    };
+
+    PipelineLatencyProfiler() {}
+
+    std::mutex mLock;
+    // key: region + "_" + config name
+    std::unordered_map<std::string, ConfigLatency> mConfigLatencies;
+    std::vector<SlowTrace> mSlowTraces;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class PipelineLatencyProfilerUnittest;
+#endif
+};
+
+} // namespace logtail
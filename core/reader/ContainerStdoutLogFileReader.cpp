@@ -0,0 +1,615 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ContainerStdoutLogFileReader.h"
+#include <string.h>
+#include <algorithm>
+#include <ctime>
+#include "app_config/AppConfig.h"
+#include "common/Constants.h"
+#include "common/LineFeedScanner.h"
+#include "log_pb/sls_logs.pb.h"
+#include "logger/HotLogger.h"
+#include "logger/Logger.h"
+#include "parser/LogParser.h"
+#include "profiler/LogtailAlarm.h"
+
+using namespace sls_logs;
+
+namespace logtail {
+
+const std::string ContainerStdoutLogFileReader::TIME_KEY = "_time_";
+const std::string ContainerStdoutLogFileReader::SOURCE_KEY = "_source_";
+
+namespace {
+
+    // Fields of a record, payload is the escaped JSON string of docker json-file.
+    struct Record {
+        const char* mTime = NULL;
+        size_t mTimeSize = 0;
+        const char* mStream = NULL;
+        size_t mStreamSize = 0;
+        const char* mPayload = NULL;
+        size_t mPayloadSize = 0;
+        bool mEscaped = false;
+        bool mPartial = false;
+    };
+
+    inline const char* SkipSpaces(const char* cur, const char* end) {
+        while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\r')) {
+            ++cur;
+        }
+        return cur;
+    }
+
+    // FindStringEnd returns the closing quote of the JSON string starting after @begin, or NULL.
+    const char* FindStringEnd(const char* begin, const char* end) {
+        for (const char* cur = FindQuoteOrBackslash(begin, end); cur < end; cur = FindQuoteOrBackslash(cur, end)) {
+            if (*cur == '"') {
+                return cur;
+            }
+            cur += 2;
+        }
+        return NULL;
+    }
+
+    // SkipValue skips a JSON value other than strings, such as attrs of docker log-opts.
+    const char* SkipValue(const char* cur, const char* end) {
+        int32_t depth = 0;
+        for (; cur < end; ++cur) {
+            const char c = *cur;
+            if (c == '"') {
+                cur = FindStringEnd(cur + 1, end);
+                if (cur == NULL) {
+                    return NULL;
+                }
+            } else if (c == '{' || c == '[') {
+                ++depth;
+            } else if (c == '}' || c == ']') {
+                if (depth == 0) {
+                    return cur;
+                }
+                --depth;
+            } else if (c == ',' && depth == 0) {
+                return cur;
+            }
+        }
+        return NULL;
+    }
+
+    // ParseDockerRecord parses {"log":"...","stream":"...","time":"..."} of docker json-file in any key order.
+    bool ParseDockerRecord(const char* cur, const char* end, Record& record) {
+        cur = SkipSpaces(cur + 1, end);
+        while (cur < end && *cur == '"') {
+            const char* keyEnd = FindStringEnd(cur + 1, end);
+            if (keyEnd == NULL) {
+                return false;
+            }
+            const char* key = cur + 1;
+            const size_t keySize = keyEnd - key;
+            cur = SkipSpaces(keyEnd + 1, end);
+            if (cur == end || *cur != ':') {
+                return false;
+            }
+            cur = SkipSpaces(cur + 1, end);
+            if (cur < end && *cur == '"') {
+                const char* valueEnd = FindStringEnd(cur + 1, end);
+                if (valueEnd == NULL) {
+                    return false;
+                }
+                const char* value = cur + 1;
+                const size_t valueSize = valueEnd - value;
+                if (keySize == 3 && memcmp(key, "log", 3) == 0) {
+                    record.mPayload = value;
+                    record.mPayloadSize = valueSize;
+                    record.mEscaped = true;
+                } else if (keySize == 6 && memcmp(key, "stream", 6) == 0) {
+                    record.mStream = value;
+                    record.mStreamSize = valueSize;
+                } else if (keySize == 4 && memcmp(key, "time", 4) == 0) {
+                    record.mTime = value;
+                    record.mTimeSize = valueSize;
+                }
+                cur = valueEnd + 1;
+            } else {
+                cur = SkipValue(cur, end);
+                if (cur == NULL) {
+                    return false;
+                }
+            }
+            cur = SkipSpaces(cur, end);
+            if (cur < end && *cur == ',') {
+                cur = SkipSpaces(cur + 1, end);
+            }
+        }
+        if (cur == end || *cur != '}' || record.mPayload == NULL) {
+            return false;
+        }
+        // The json-file driver splits lines longer than 16KB, a line is ended by the escaped line feed.
+        if (record.mPayloadSize >= 2 && record.mPayload[record.mPayloadSize - 2] == '\\'
+            && record.mPayload[record.mPayloadSize - 1] == 'n') {
+            // The backslash may be escaped itself, count the backslashes before 'n'.
+            size_t backslashes = 0;
+            while (backslashes + 1 < record.mPayloadSize
+                   && record.mPayload[record.mPayloadSize - 2 - backslashes] == '\\') {
+                ++backslashes;
+            }
+            if (backslashes % 2 == 1) {
+                record.mPayloadSize -= 2;
+                return true;
+            }
+        }
+        record.mPartial = true;
+        return true;
+    }
+
+    // ParseCRIRecord parses "time stream P|F payload" of CRI.
+    bool ParseCRIRecord(const char* cur, const char* end, Record& record) {
+        const char* timeEnd = static_cast<const char*>(memchr(cur, ' ', end - cur));
+        if (timeEnd == NULL) {
+            return false;
+        }
+        const char* streamEnd = static_cast<const char*>(memchr(timeEnd + 1, ' ', end - timeEnd - 1));
+        if (streamEnd == NULL || streamEnd + 2 > end || (streamEnd + 2 != end && streamEnd[2] != ' ')) {
+            return false;
+        }
+        const char tag = streamEnd[1];
+        if (tag != 'P' && tag != 'F') {
+            return false;
+        }
+        record.mTime = cur;
+        record.mTimeSize = timeEnd - cur;
+        record.mStream = timeEnd + 1;
+        record.mStreamSize = streamEnd - timeEnd - 1;
+        record.mPayload = streamEnd + 2 < end ? streamEnd + 3 : end;
+        record.mPayloadSize = end - record.mPayload;
+        record.mPartial = tag == 'P';
+        return record.mTimeSize > 0 && record.mStreamSize > 0;
+    }
+
+    inline int32_t HexValue(char c) {
+        if (c >= '0' && c <= '9') {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f') {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F') {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    bool ParseHex4(const char* cur, const char* end, uint32_t& value) {
+        if (end - cur < 4) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            const int32_t digit = HexValue(cur[i]);
+            if (digit < 0) {
+                return false;
+            }
+            value = (value << 4) | static_cast<uint32_t>(digit);
+        }
+        return true;
+    }
+
+    char* WriteUTF8(uint32_t codePoint, char* out) {
+        if (codePoint < 0x80) {
+            *out++ = static_cast<char>(codePoint);
+        } else if (codePoint < 0x800) {
+            *out++ = static_cast<char>(0xC0 | (codePoint >> 6));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else if (codePoint < 0x10000) {
+            *out++ = static_cast<char>(0xE0 | (codePoint >> 12));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        } else {
+            *out++ = static_cast<char>(0xF0 | (codePoint >> 18));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            *out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        return out;
+    }
+
+    // UnescapeJsonString writes the JSON string body [@cur, @end) to @out unescaped, runs without escape are
+    // copied in bulk. Escaped line feeds in the middle are kept escaped because a line is a record, docker never
+    // writes them. Output is never longer than input.
+    char* UnescapeJsonString(const char* cur, const char* end, char* out) {
+        while (cur < end) {
+            const char* special = FindQuoteOrBackslash(cur, end);
+            memcpy(out, cur, special - cur);
+            out += special - cur;
+            cur = special;
+            if (cur == end) {
+                break;
+            }
+            if (*cur != '\\' || cur + 1 == end) {
+                *out++ = *cur++;
+                continue;
+            }
+            const char c = cur[1];
+            cur += 2;
+            switch (c) {
+                case '"':
+                case '\\':
+                case '/':
+                    *out++ = c;
+                    break;
+                case 'b':
+                    *out++ = '\b';
+                    break;
+                case 'f':
+                    *out++ = '\f';
+                    break;
+                case 'r':
+                    *out++ = '\r';
+                    break;
+                case 't':
+                    *out++ = '\t';
+                    break;
+                case 'u': {
+                    uint32_t codePoint = 0;
+                    if (!ParseHex4(cur, end, codePoint)) {
+                        *out++ = '\\';
+                        *out++ = 'u';
+                        break;
+                    }
+                    cur += 4;
+                    uint32_t low = 0;
+                    if (codePoint >= 0xD800 && codePoint < 0xDC00 && end - cur >= 6 && cur[0] == '\\' && cur[1] == 'u'
+                        && ParseHex4(cur + 2, end, low) && low >= 0xDC00 && low < 0xE000) {
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                        cur += 6;
+                    }
+                    out = WriteUTF8(codePoint, out);
+                    break;
+                }
+                default:
+                    // \n and unknown escapes.
+                    *out++ = '\\';
+                    *out++ = c;
+                    break;
+            }
+        }
+        return out;
+    }
+
+    inline char* WriteField(const char* value, size_t size, char* out) {
+        if (size == 0) {
+            *out++ = '-';
+            return out;
+        }
+        memcpy(out, value, size);
+        return out + size;
+    }
+
+    bool ParseDigits(const char*& cur, const char* end, int32_t count, int32_t& value) {
+        if (end - cur < count) {
+            return false;
+        }
+        value = 0;
+        for (int32_t i = 0; i < count; ++i) {
+            if (cur[i] < '0' || cur[i] > '9') {
+                return false;
+            }
+            value = value * 10 + (cur[i] - '0');
+        }
+        cur += count;
+        return true;
+    }
+
+    inline bool Expect(const char*& cur, const char* end, char c) {
+        if (cur == end || *cur != c) {
+            return false;
+        }
+        ++cur;
+        return true;
+    }
+
+    // DaysFromCivil returns days since 1970-01-01 of the proleptic Gregorian date.
+    int64_t DaysFromCivil(int64_t year, int64_t month, int64_t day) {
+        year -= month <= 2;
+        const int64_t era = (year >= 0 ? year : year - 399) / 400;
+        const int64_t yoe = year - era * 400;
+        const int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+
+} // namespace
+
+ContainerStdoutLogFileReader::ContainerStdoutLogFileReader(const std::string& projectName,
+                                                           const std::string& category,
+                                                           const std::string& logPathDir,
+                                                           const std::string& logPathFile,
+                                                           int32_t tailLimit,
+                                                           const std::string& topicFormat,
+                                                           const std::string& groupTopic,
+                                                           bool discardUnmatch,
+                                                           bool dockerFileFlag)
+    : LogFileReader(projectName,
+                    category,
+                    logPathDir,
+                    logPathFile,
+                    tailLimit,
+                    topicFormat,
+                    groupTopic,
+                    ENCODING_UTF8,
+                    discardUnmatch,
+                    dockerFileFlag) {
+    mLogType = CONTAINER_STDOUT_LOG;
+    // Time and stream.
+    mLinePrefixFields = 2;
+}
+
+void ContainerStdoutLogFileReader::UnwrapRecords(
+    const char* raw, size_t size, char* output, bool flushPartial, UnwrapResult& result) {
+    result = UnwrapResult();
+    const char* const rawEnd = raw + size;
+    char* out = output;
+    // Begin of the line being joined from partial records, NULL if there is none.
+    char* pending = NULL;
+    for (const char* cur = raw; cur < rawEnd;) {
+        const char* lineEnd = FindLineFeed(cur, rawEnd);
+        const char* next = lineEnd == rawEnd ? rawEnd : lineEnd + 1;
+        const char* recordEnd = lineEnd > cur && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+        Record record;
+        bool valid = false;
+        if (cur < recordEnd) {
+            valid = *cur == '{' ? ParseDockerRecord(cur, recordEnd, record) : ParseCRIRecord(cur, recordEnd, record);
+        }
+        if (!valid) {
+            if (cur < recordEnd) {
+                ++result.mInvalidLines;
+            }
+            if (pending == NULL) {
+                result.mRawSize = next - raw;
+            }
+            cur = next;
+            continue;
+        }
+        if (pending == NULL) {
+            pending = out;
+            out = WriteField(record.mTime, record.mTimeSize, out);
+            *out++ = ' ';
+            out = WriteField(record.mStream, record.mStreamSize, out);
+            *out++ = ' ';
+        }
+        if (record.mEscaped) {
+            out = UnescapeJsonString(record.mPayload, record.mPayload + record.mPayloadSize, out);
+        } else {
+            memcpy(out, record.mPayload, record.mPayloadSize);
+            out += record.mPayloadSize;
+        }
+        if (!record.mPartial) {
+            *out++ = '\n';
+            pending = NULL;
+            result.mRawSize = next - raw;
+            result.mLineEnds.emplace_back(static_cast<int32_t>(out - output), static_cast<int32_t>(result.mRawSize));
+        }
+        cur = next;
+    }
+    if (pending != NULL) {
+        if (flushPartial) {
+            *out++ = '\n';
+            result.mRawSize = size;
+            result.mLineEnds.emplace_back(static_cast<int32_t>(out - output), static_cast<int32_t>(size));
+        } else {
+            out = pending;
+        }
+    }
+    result.mOutputSize = out - output;
+}
+
+bool ContainerStdoutLogFileReader::ParseRFC3339Time(const char* begin,
+                                                    const char* end,
+                                                    time_t& seconds,
+                                                    uint32_t& nanoseconds) {
+    const char* cur = begin;
+    int32_t year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    if (!ParseDigits(cur, end, 4, year) || !Expect(cur, end, '-') || !ParseDigits(cur, end, 2, month)
+        || !Expect(cur, end, '-') || !ParseDigits(cur, end, 2, day) || cur == end || (*cur != 'T' && *cur != ' ')
+        || !ParseDigits(++cur, end, 2, hour) || !Expect(cur, end, ':') || !ParseDigits(cur, end, 2, minute)
+        || !Expect(cur, end, ':') || !ParseDigits(cur, end, 2, second)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+    nanoseconds = 0;
+    if (cur < end && *cur == '.') {
+        ++cur;
+        uint32_t scale = 100000000;
+        for (; cur < end && *cur >= '0' && *cur <= '9'; ++cur) {
+            nanoseconds += (*cur - '0') * scale;
+            scale /= 10;
+        }
+    }
+    int32_t offset = 0;
+    if (cur < end && (*cur == '+' || *cur == '-')) {
+        const int32_t sign = *cur == '+' ? 1 : -1;
+        int32_t offsetHour = 0, offsetMinute = 0;
+        ++cur;
+        if (!ParseDigits(cur, end, 2, offsetHour) || !Expect(cur, end, ':')
+            || !ParseDigits(cur, end, 2, offsetMinute)) {
+            return false;
+        }
+        offset = sign * (offsetHour * 3600 + offsetMinute * 60);
+    } else if (!Expect(cur, end, 'Z')) {
+        return false;
+    }
+    if (cur != end) {
+        return false;
+    }
+    seconds = static_cast<time_t>(DaysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second
+                                  - offset);
+    return true;
+}
+
+void ContainerStdoutLogFileReader::ReadUTF8(
+    LogBufferSlabPtr& buffer, size_t* size, int64_t end, bool& moreData, TruncateInfo*& truncateInfo) {
+    *size = 0;
+    bool fromCpt = false;
+    size_t readLimit = 0;
+    const size_t readBytes = getNextReadSize(end, fromCpt, readLimit);
+    LogBufferSlabPtr rawSlab = LogBufferPool::GetInstance()->Acquire(readBytes + 1);
+    char* raw = rawSlab.get();
+    const size_t nbytes = ReadFile(mLogFileOp, raw, readBytes, mLastFilePos, &truncateInfo);
+    mLastReadPos = mLastFilePos + nbytes;
+    moreData = (nbytes == readLimit);
+
+    // Records are complete up to the last line feed.
+    const char* lastLineFeed = FindLastLineFeed(raw, raw + nbytes);
+    if (lastLineFeed == raw + nbytes) {
+        if (moreData) {
+            // Runtimes split records far below the read size, the file is not a stdout file.
+            LOG_WARNING(sLogger, ("skip container stdout without line feed, size", nbytes)("file", mLogPath));
+            mLastFilePos += nbytes;
+        }
+        return;
+    }
+    const size_t rawSize = lastLineFeed - raw + 1;
+    buffer = LogBufferPool::GetInstance()->Acquire(rawSize + 1);
+    char* bufferptr = buffer.get();
+    UnwrapResult result;
+    UnwrapRecords(raw, rawSize, bufferptr, false, result);
+    if (result.mOutputSize == 0 && moreData) {
+        // Partial records fill the read, they are ended as a line or the reader would stop here.
+        UnwrapRecords(raw, rawSize, bufferptr, true, result);
+    }
+    rawSlab.reset();
+    if (result.mInvalidLines > 0 && AppConfig::GetInstance()->IsLogParseAlarmValid()) {
+        const size_t invalidLines = result.mInvalidLines;
+        LogtailAlarm::GetInstance()->CountAlarm(
+            PARSE_LOG_FAIL_ALARM, mProjectName, mCategory, mRegion, [this, invalidLines]() {
+                return "skip lines neither docker json-file nor CRI, count:" + ToString(invalidLines)
+                    + ", file:" + mLogPath;
+            });
+    }
+
+    size_t outputSize = result.mOutputSize;
+    size_t consumed = result.mRawSize;
+    if (outputSize > 0 && mLogBeginRegPtr && (moreData || consumed < nbytes)) {
+        // Lines after the last begin line may be continued by the next read, same as LogFileReader::ReadUTF8,
+        // the rollback is mapped back to the raw end of the line before it.
+        int32_t rollbackLineFeedCount = 0;
+        const int32_t matched = LastMatchedLine(bufferptr, static_cast<int32_t>(outputSize), rollbackLineFeedCount);
+        auto iter = std::lower_bound(result.mLineEnds.begin(),
+                                     result.mLineEnds.end(),
+                                     std::make_pair(matched, static_cast<int32_t>(0)));
+        if (matched > 0 && iter != result.mLineEnds.end() && iter->first == matched) {
+            mCheckedLinesOffset = mLastFilePos + iter->second;
+            mCheckedLinesSize = static_cast<int32_t>(outputSize) - matched;
+            outputSize = matched;
+            consumed = iter->second;
+        } else if (!moreData) {
+            outputSize = 0;
+            consumed = 0;
+        }
+    }
+    if (outputSize == 0) {
+        buffer.reset();
+        mLastFilePos += consumed;
+        return;
+    }
+    bufferptr[outputSize - 1] = '\0';
+    if (!moreData && fromCpt && mLastReadPos < end) {
+        moreData = true;
+    }
+    *size = outputSize;
+    setExactlyOnceCheckpointAfterRead(consumed);
+    mLastFilePos += consumed;
+    LOG_HOT_DEBUG("read container stdout, raw size:{}\tsize:{}\tlast file pos:{}", consumed, *size, mLastFilePos);
+}
+
+void ContainerStdoutLogFileReader::ParseLogLines(const char* buffer,
+                                                 const int32_t* offsets,
+                                                 uint32_t count,
+                                                 sls_logs::LogGroup& logGroup,
+                                                 LogLineParseState& state,
+                                                 uint32_t& logGroupSize,
+                                                 LogLineParseResult* results) {
+    ParseLogLinesBy(
+        [this](const char* line,
+               sls_logs::LogGroup& group,
+               ParseLogError& error,
+               time_t& lastLogLineTime,
+               std::string& lastLogTimeStr,
+               uint32_t& size) {
+            return ContainerStdoutLogFileReader::ParseLogLine(
+                line, group, error, lastLogLineTime, lastLogTimeStr, size);
+        },
+        buffer,
+        offsets,
+        count,
+        logGroup,
+        state,
+        logGroupSize,
+        results);
+}
+
+bool ContainerStdoutLogFileReader::ParseLogLine(const char* buffer,
+                                                LogGroup& logGroup,
+                                                ParseLogError& error,
+                                                time_t& lastLogLineTime,
+                                                std::string& lastLogTimeStr,
+                                                uint32_t& logGroupSize) {
+    if (logGroup.logs_size() == 0) {
+        logGroup.set_category(mCategory);
+        logGroup.set_topic(mTopicName);
+    }
+    // Lines are written by UnwrapRecords as "time stream payload".
+    const char* timeEnd = strchr(buffer, ' ');
+    const char* streamEnd = timeEnd == NULL ? NULL : strchr(timeEnd + 1, ' ');
+    if (streamEnd == NULL) {
+        error = PARSE_LOG_FORMAT_ERROR;
+        return false;
+    }
+    time_t logTime = 0;
+    uint32_t nanoseconds = 0;
+    if (!ParseRFC3339Time(buffer, timeEnd, logTime, nanoseconds)) {
+        logTime = time(NULL);
+    }
+    Log* logPtr = logGroup.add_logs();
+    logPtr->set_time(logTime);
+    const char* payload = streamEnd + 1;
+    const char* lineFeed = strchr(payload, '\n');
+    if (lineFeed == NULL) {
+        LogParser::AddLog(logPtr, DEFAULT_CONTENT_KEY, payload, strlen(payload), logGroupSize);
+    } else {
+        // Lines joined by log begin regex, prefixes of the lines after the first one are dropped.
+        std::string content(payload, lineFeed - payload);
+        for (const char* line = lineFeed + 1; line != NULL;) {
+            content.push_back('\n');
+            const char* nextLineFeed = strchr(line, '\n');
+            const char* lineEnd = nextLineFeed == NULL ? line + strlen(line) : nextLineFeed;
+            const char* lineTimeEnd = static_cast<const char*>(memchr(line, ' ', lineEnd - line));
+            const char* lineStreamEnd = lineTimeEnd == NULL
+                ? NULL
+                : static_cast<const char*>(memchr(lineTimeEnd + 1, ' ', lineEnd - lineTimeEnd - 1));
+            const char* linePayload = lineStreamEnd == NULL ? line : lineStreamEnd + 1;
+            content.append(linePayload, lineEnd - linePayload);
+            line = nextLineFeed == NULL ? NULL : nextLineFeed + 1;
+        }
+        LogParser::AddLog(logPtr, DEFAULT_CONTENT_KEY, content, logGroupSize);
+    }
+    LogParser::AddLog(logPtr, TIME_KEY, buffer, timeEnd - buffer, logGroupSize);
+    LogParser::AddLog(logPtr, SOURCE_KEY, timeEnd + 1, streamEnd - timeEnd - 1, logGroupSize);
+    return true;
+}
+
+} // namespace logtail
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include "LogFileReader.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace logtail {
+
+// ContainerStdoutLogFileReader reads stdout files of containers natively, records of docker json-file
+// ({"log":"...","stream":"stdout","time":"..."}) and CRI ("time stream P|F payload") are unwrapped into
+// "time stream payload" lines while read, partial records are joined with the ones after them. The lines are
+// split by log begin regex on payloads and parsed into content, _time_ and _source_ as the stdout plugin does.
+class ContainerStdoutLogFileReader : public LogFileReader {
+public:
+    static const std::string TIME_KEY;
+    static const std::string SOURCE_KEY;
+
+    struct UnwrapResult {
+        // Bytes written to output, each line ends with '\n'.
+        size_t mOutputSize = 0;
+        // Raw bytes of the records in output, partial records at the end are not.
+        size_t mRawSize = 0;
+        // Lines neither docker json-file nor CRI, skipped.
+        size_t mInvalidLines = 0;
+        // Output end and raw end of each line.
+        std::vector<std::pair<int32_t, int32_t>> mLineEnds;
+    };
+
+    ContainerStdoutLogFileReader(const std::string& projectName,
+                                 const std::string& category,
+                                 const std::string& logPathDir,
+                                 const std::string& logPathFile,
+                                 int32_t tailLimit,
+                                 const std::string& topicFormat,
+                                 const std::string& groupTopic,
+                                 bool discardUnmatch,
+                                 bool dockerFileFlag = false);
+
+    // UnwrapRecords unwraps records of [@raw, @raw + @size), which ends with '\n', into @output of @size bytes
+    // at least, it never writes more than read. Partial records at the end are left to the next read unless
+    // @flushPartial, then they are ended as a line.
+    static void UnwrapRecords(const char* raw, size_t size, char* output, bool flushPartial, UnwrapResult& result);
+
+    // ParseRFC3339Time parses time of records, such as 2023-01-02T03:04:05.123456789Z and offsets like +08:00.
+    static bool ParseRFC3339Time(const char* begin, const char* end, time_t& seconds, uint32_t& nanoseconds);
+
+protected:
+    bool ParseLogLine(const char* buffer,
+                      sls_logs::LogGroup& logGroup,
+                      ParseLogError& error,
+                      time_t& lastLogLineTime,
+                      std::string& lastLogTimeStr,
+                      uint32_t& logGroupSize);
+    void ParseLogLines(const char* buffer,
+                       const int32_t* offsets,
+                       uint32_t count,
+                       sls_logs::LogGroup& logGroup,
+                       LogLineParseState& state,
+                       uint32_t& logGroupSize,
+                       LogLineParseResult* results) override;
+
+    void ReadUTF8(LogBufferSlabPtr& buffer, size_t* size, int64_t end, bool& moreData, TruncateInfo*& truncateInfo)
+        override;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class ContainerStdoutLogFileReaderUnittest;
+#endif
+};
+
+} // namespace logtail
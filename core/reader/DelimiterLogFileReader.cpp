@@ -17,7 +17,7 @@
 #include <ctime>
 #include "profiler/LogtailAlarm.h"
 #include "parser/LogParser.h"
-#include "parser/DelimiterModeFsmParser.h"
+#include "parser/DelimiterModeBitmaskParser.h"
 #include "log_pb/sls_logs.pb.h"
 #include "logger/Logger.h"
 
@@ -68,11 +68,11 @@ DelimiterLogFileReader::DelimiterLogFileReader(const std::string& projectName,
     mUseSystemTime = true;
     mAcceptNoEnoughKeys = acceptNoEnoughKeys;
     mExtractPartialFields = extractPartialFields;
-    mDelimiterModeFsmParserPtr = new DelimiterModeFsmParser(mQuote, mSeparatorChar);
+    mDelimiterModeBitmaskParserPtr = new DelimiterModeBitmaskParser(mQuote, mSeparatorChar);
 }
 
 DelimiterLogFileReader::~DelimiterLogFileReader() {
-    delete mDelimiterModeFsmParserPtr;
+    delete mDelimiterModeBitmaskParserPtr;
 }
 
 void DelimiterLogFileReader::SetColumnKeys(const std::vector<std::string>& columnKeys, const std::string& timeKey) {
@@ -91,6 +91,31 @@ void DelimiterLogFileReader::SetColumnKeys(const std::vector<std::string>& colum
     }
 }
 
+void DelimiterLogFileReader::ParseLogLines(const char* buffer,
+                                           const int32_t* offsets,
+                                           uint32_t count,
+                                           sls_logs::LogGroup& logGroup,
+                                           LogLineParseState& state,
+                                           uint32_t& logGroupSize,
+                                           LogLineParseResult* results) {
+    ParseLogLinesBy(
+        [this](const char* line,
+               sls_logs::LogGroup& group,
+               ParseLogError& error,
+               time_t& lastLogLineTime,
+               std::string& lastLogTimeStr,
+               uint32_t& size) {
+            return DelimiterLogFileReader::ParseLogLine(line, group, error, lastLogLineTime, lastLogTimeStr, size);
+        },
+        buffer,
+        offsets,
+        count,
+        logGroup,
+        state,
+        logGroupSize,
+        results);
+}
+
 bool DelimiterLogFileReader::ParseLogLine(const char* buffer,
                                           sls_logs::LogGroup& logGroup,
                                           ParseLogError& error,
@@ -123,28 +148,52 @@ bool DelimiterLogFileReader::ParseLogLine(const char* buffer,
         logGroup.set_topic(mTopicName);
     }
     size_t reserveSize = mAutoExtend ? (mColumnKeys.size() + 10) : (mColumnKeys.size() + 1);
-    vector<string> columnValues;
+    // Spans are reused by the processing thread to avoid allocation for each line.
+    static thread_local std::vector<DelimiterColumnSpan> sColumnSpans;
+    std::vector<DelimiterColumnSpan>& columnSpans = sColumnSpans;
+    std::string extraFields;
+    bool hasExtraFields = false;
     std::vector<size_t> colBegIdxs;
     std::vector<size_t> colLens;
     bool parseSuccess = false;
     uint64_t preciseTimestamp = 0;
     size_t parsedColCount = 0;
     bool useQuote = (mSeparator.size() == 1) && (mQuote != mSeparatorChar);
+    // Values are referenced in buffer if possible, others are built in columnValue.
+    std::string columnValue;
+    auto getColumnValue = [&](size_t idx, const char*& value, size_t& valueLen) {
+        if (!useQuote) {
+            value = buffer + colBegIdxs[idx];
+            valueLen = colLens[idx];
+        } else if (hasExtraFields && idx == mColumnKeys.size()) {
+            value = extraFields.data();
+            valueLen = extraFields.size();
+        } else if (columnSpans[idx].escaped) {
+            columnValue.clear();
+            mDelimiterModeBitmaskParserPtr->AppendColumnValue(buffer, columnSpans[idx], columnValue);
+            value = columnValue.data();
+            valueLen = columnValue.size();
+        } else {
+            value = buffer + columnSpans[idx].begin;
+            valueLen = columnSpans[idx].length;
+        }
+    };
     if (mColumnKeys.size() > 0) {
         if (useQuote) {
-            columnValues.reserve(reserveSize);
-            parseSuccess = mDelimiterModeFsmParserPtr->ParseDelimiterLine(buffer, begIdx, endIdx, columnValues);
+            columnSpans.clear();
+            columnSpans.reserve(reserveSize);
+            parseSuccess = mDelimiterModeBitmaskParserPtr->ParseDelimiterLine(buffer, begIdx, endIdx, columnSpans);
+            parsedColCount = columnSpans.size();
             // handle auto extend
-            if (!mAutoExtend && columnValues.size() > mColumnKeys.size()) {
-                std::string extraFields;
-                for (size_t i = mColumnKeys.size(); i < columnValues.size(); ++i) {
-                    extraFields.append(1, mSeparatorChar).append(columnValues[i]);
+            if (!mAutoExtend && columnSpans.size() > mColumnKeys.size()) {
+                for (size_t i = mColumnKeys.size(); i < columnSpans.size(); ++i) {
+                    extraFields.append(1, mSeparatorChar);
+                    mDelimiterModeBitmaskParserPtr->AppendColumnValue(buffer, columnSpans[i], extraFields);
                 }
-                // remove extra fields
-                columnValues.resize(mColumnKeys.size());
-                columnValues.push_back(extraFields);
+                // extra fields are merged into one column
+                hasExtraFields = true;
+                parsedColCount = mColumnKeys.size() + 1;
             }
-            parsedColCount = columnValues.size();
         } else {
             colBegIdxs.reserve(reserveSize);
             colLens.reserve(reserveSize);
@@ -169,12 +218,14 @@ bool DelimiterLogFileReader::ParseLogLine(const char* buffer,
                 error = PARSE_LOG_FORMAT_ERROR;
                 parseSuccess = false;
             } else if (!mUseSystemTime && parsedColCount > mTimeIndex) {
+                const char* timeValue = NULL;
+                size_t timeValueLen = 0;
+                getColumnValue(mTimeIndex, timeValue, timeValueLen);
                 if (!LogParser::ParseLogTime(buffer,
                                              lastLogTimeStr,
                                              lastLogLineTime,
                                              preciseTimestamp,
-                                             useQuote ? columnValues[mTimeIndex]
-                                                      : string(buffer + colBegIdxs[mTimeIndex], colLens[mTimeIndex]),
+                                             string(timeValue, timeValueLen),
                                              mTimeFormat.c_str(),
                                              mPreciseTimestampConfig,
                                              mSpecifiedYear,
@@ -210,27 +261,25 @@ bool DelimiterLogFileReader::ParseLogLine(const char* buffer,
 
     if (parseSuccess) {
         Log* logPtr = logGroup.add_logs();
-        logPtr->set_time(mUseSystemTime || lastLogLineTime <= 0 ? time(NULL) : lastLogLineTime);
+        logPtr->set_time(mUseSystemTime || lastLogLineTime <= 0 ? time(NULL) : lastLogLineTime - mTzOffsetSecond);
 
+        const char* value = NULL;
+        size_t valueLen = 0;
         for (uint32_t idx = 0; idx < parsedColCount; idx++) {
             if (mColumnKeys.size() > idx) {
                 if (mExtractPartialFields && mColumnKeys[idx] == s_mDiscardedFieldKey) {
                     continue;
                 }
 
-                LogParser::AddLog(logPtr,
-                                  mColumnKeys[idx],
-                                  useQuote ? columnValues[idx] : string(buffer + colBegIdxs[idx], colLens[idx]),
-                                  logGroupSize);
+                getColumnValue(idx, value, valueLen);
+                LogParser::AddLog(logPtr, mColumnKeys[idx], value, valueLen, logGroupSize);
             } else {
                 if (mExtractPartialFields) {
                     continue;
                 }
 
-                LogParser::AddLog(logPtr,
-                                  string("__column") + ToString(idx) + "__",
-                                  useQuote ? columnValues[idx] : string(buffer + colBegIdxs[idx], colLens[idx]),
-                                  logGroupSize);
+                getColumnValue(idx, value, valueLen);
+                LogParser::AddLog(logPtr, string("__column") + ToString(idx) + "__", value, valueLen, logGroupSize);
             }
         }
 
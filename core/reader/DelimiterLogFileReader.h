@@ -21,7 +21,7 @@
 
 namespace logtail {
 
-class DelimiterModeFsmParser;
+class DelimiterModeBitmaskParser;
 
 class DelimiterLogFileReader : public LogFileReader {
 public:
@@ -52,6 +52,13 @@ protected:
                       time_t& lastLogLineTime,
                       std::string& lastLogTimeStr,
                       uint32_t& logGroupSize);
+    void ParseLogLines(const char* buffer,
+                       const int32_t* offsets,
+                       uint32_t count,
+                       sls_logs::LogGroup& logGroup,
+                       LogLineParseState& state,
+                       uint32_t& logGroupSize,
+                       LogLineParseResult* results) override;
 
     bool SplitString(const char* buffer,
                      int32_t begIdx,
@@ -72,7 +79,7 @@ protected:
     uint32_t mTimeIndex;
     std::vector<std::string> mColumnKeys;
     bool mExtractPartialFields;
-    DelimiterModeFsmParser* mDelimiterModeFsmParserPtr;
+    DelimiterModeBitmaskParser* mDelimiterModeBitmaskParserPtr;
 
     static const std::string s_mDiscardedFieldKey;
 
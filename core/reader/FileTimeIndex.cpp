@@ -0,0 +1,195 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "FileTimeIndex.h"
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <climits>
+#include <vector>
+#include "common/Flags.h"
+#include "common/HashUtil.h"
+
+DEFINE_FLAG_INT32(file_time_index_cache_size, "max count of files whose time index is cached", 1000);
+
+namespace logtail {
+
+namespace {
+
+// Bytes read after the end of a range, enough for the time at the beginning of the last line.
+const int64_t kTimePrefixSize = 256;
+
+} // namespace
+
+const size_t FileTimeIndex::kHeadSize;
+const int64_t FileTimeIndex::kProbeSize;
+const int64_t FileTimeIndex::kScanSize;
+const size_t FileTimeIndex::kMaxSampleCount;
+
+int32_t FileTimeIndex::ParseTime(const char* line, const std::string& timeFormat) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    const char* result = strptime(line, timeFormat.c_str(), &tm);
+    tm.tm_isdst = -1;
+    if (result != NULL) {
+        return mktime(&tm);
+    }
+    return -1;
+}
+
+int64_t FileTimeIndex::Seek(const ReadFunc& read, int64_t fileSize, int32_t time) {
+    int64_t low = 0, bound = fileSize, result = fileSize;
+    bool parsed = false;
+    // Samples narrow the range, lines from low (before @time) to bound (not before it) are left to search.
+    for (auto iter = mSamples.begin(); iter != mSamples.end() && iter->first < fileSize; ++iter) {
+        parsed = true;
+        if (iter->second < time) {
+            low = iter->first;
+        } else {
+            result = bound = iter->first;
+            break;
+        }
+    }
+
+    int64_t lineOffset = 0;
+    int32_t lineTime = -1;
+    while (bound - low > kScanSize) {
+        const int64_t mid = low + (bound - low) / 2;
+        if (!FindLine(read, fileSize, mid, std::min(bound, mid + kProbeSize), INT_MIN, lineOffset, lineTime, parsed)) {
+            // Lines after mid are continuation lines or not read, the result is not after mid.
+            bound = mid;
+        } else if (lineTime < time) {
+            low = lineOffset;
+        } else {
+            result = bound = lineOffset;
+        }
+    }
+    if (low < bound && FindLine(read, fileSize, low, bound, time, lineOffset, lineTime, parsed)) {
+        return lineOffset;
+    }
+    return parsed ? result : -1;
+}
+
+bool FileTimeIndex::FindLine(const ReadFunc& read,
+                             int64_t fileSize,
+                             int64_t begin,
+                             int64_t end,
+                             int32_t minTime,
+                             int64_t& lineOffset,
+                             int32_t& lineTime,
+                             bool& parsed) {
+    // One byte before @begin tells if a line starts at @begin.
+    const int64_t readBegin = begin > 0 ? begin - 1 : 0;
+    const int64_t readEnd = std::min(fileSize, end + kTimePrefixSize);
+    if (readEnd <= readBegin) {
+        return false;
+    }
+    std::vector<char> buffer(static_cast<size_t>(readEnd - readBegin) + 1, '\0');
+    const size_t nbytes = std::min(read(buffer.data(), buffer.size() - 1, readBegin), buffer.size() - 1);
+    buffer[nbytes] = '\0';
+    for (size_t i = 0; i < nbytes; ++i) {
+        if (buffer[i] == '\n') {
+            buffer[i] = '\0';
+        }
+    }
+
+    for (size_t pos = begin > 0 ? 1 : 0; pos < nbytes && readBegin + static_cast<int64_t>(pos) < end; ++pos) {
+        if (pos > 0 && buffer[pos - 1] != '\0') {
+            continue;
+        }
+        const int32_t t = ParseTime(&buffer[pos], mTimeFormat);
+        if (t == -1) {
+            continue;
+        }
+        parsed = true;
+        if (t >= minTime) {
+            lineOffset = readBegin + static_cast<int64_t>(pos);
+            lineTime = t;
+            if (mSamples.size() < kMaxSampleCount) {
+                mSamples[lineOffset] = lineTime;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FileTimeIndex::ReadHead(const ReadFunc& read, int64_t fileSize, uint64_t& hash, size_t& size) {
+    char buffer[kHeadSize + 1];
+    size = read(buffer, static_cast<size_t>(std::min<int64_t>(fileSize, kHeadSize)), 0);
+    if (size > kHeadSize) {
+        return false;
+    }
+    hash = static_cast<uint64_t>(HashString(buffer, size, kHashStringSeed));
+    return true;
+}
+
+bool FileTimeIndex::IsHeadChanged(const ReadFunc& read, int64_t fileSize) {
+    uint64_t hash = 0;
+    size_t size = 0;
+    if (!ReadHead(read, fileSize, hash, size)) {
+        return true;
+    }
+    // An index of a file shorter than kHeadSize is rebuilt when the file grows, it has few samples anyway.
+    if (mSamples.empty() || size != mHeadSize || hash != mHeadHash) {
+        mSamples.clear();
+        mHeadHash = hash;
+        mHeadSize = size;
+        return true;
+    }
+    return false;
+}
+
+int64_t FileTimeIndexCache::Seek(const DevInode& devInode,
+                                 const std::string& timeFormat,
+                                 const FileTimeIndex::ReadFunc& read,
+                                 int64_t fileSize,
+                                 int32_t time) {
+    // Seeks are done when files are opened for the first time, they are rare enough to be serialized.
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto iter = mIndexes.find(devInode);
+    if (iter != mIndexes.end() && iter->second.mIndex->GetTimeFormat() != timeFormat) {
+        mLru.erase(iter->second.mLruPos);
+        mIndexes.erase(iter);
+        iter = mIndexes.end();
+    }
+    if (iter == mIndexes.end()) {
+        mLru.push_front(devInode);
+        Item item{std::make_shared<FileTimeIndex>(timeFormat), mLru.begin()};
+        iter = mIndexes.insert(std::make_pair(devInode, item)).first;
+        const size_t maxSize = static_cast<size_t>(std::max(INT32_FLAG(file_time_index_cache_size), 1));
+        while (mIndexes.size() > maxSize) {
+            mIndexes.erase(mLru.back());
+            mLru.pop_back();
+        }
+    } else {
+        mLru.splice(mLru.begin(), mLru, iter->second.mLruPos);
+    }
+    FileTimeIndex& index = *iter->second.mIndex;
+    index.IsHeadChanged(read, fileSize);
+    return index.Seek(read, fileSize, time);
+}
+
+size_t FileTimeIndexCache::Size() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mIndexes.size();
+}
+
+void FileTimeIndexCache::Clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mIndexes.clear();
+    mLru.clear();
+}
+
+} // namespace logtail
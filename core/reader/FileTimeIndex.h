@@ -0,0 +1,124 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "common/DevInode.h"
+
+namespace logtail {
+
+// FileTimeIndex finds the first line not before a given time in a file whose lines are in time order, by binary
+// searching offsets and parsing the time of the first timed line after each sampled offset. Lines without time,
+// e.g. continuation lines of multiline logs, are skipped. Sampled times are kept as a sparse index, so later
+// seeks of the same file start from a narrowed range and need fewer reads.
+//
+// The result may be before the exact line if a sample finds no timed line, it is never after it, so no log at
+// or after the time is skipped. It is not thread safe, FileTimeIndexCache serializes access.
+class FileTimeIndex {
+public:
+    // ReadFunc reads at most @size bytes at @offset into @buf, returns bytes read.
+    typedef std::function<size_t(char* buf, size_t size, int64_t offset)> ReadFunc;
+
+    explicit FileTimeIndex(const std::string& timeFormat) : mTimeFormat(timeFormat) {}
+
+    // Seek returns the offset of the first line with time not before @time in the first @fileSize bytes,
+    // @fileSize if all are before it, or -1 if no time can be parsed.
+    int64_t Seek(const ReadFunc& read, int64_t fileSize, int32_t time);
+
+    // IsHeadChanged returns true if the head of file is not the one indexed, samples are cleared then as the file
+    // is truncated or rewritten.
+    bool IsHeadChanged(const ReadFunc& read, int64_t fileSize);
+
+    const std::string& GetTimeFormat() const { return mTimeFormat; }
+    size_t GetSampleCount() const { return mSamples.size(); }
+
+    // ParseTime parses time in @timeFormat at the beginning of NUL-terminated @line, returns -1 if it fails.
+    static int32_t ParseTime(const char* line, const std::string& timeFormat);
+
+    static const size_t kHeadSize = 1024;
+    static const int64_t kProbeSize = 16 * 1024;
+    static const int64_t kScanSize = 64 * 1024;
+    static const size_t kMaxSampleCount = 4096;
+
+private:
+    // FindLine finds the first line starting in [@begin, @end) with time not before @minTime and samples it.
+    // @parsed is set if any time is parsed.
+    bool FindLine(const ReadFunc& read,
+                  int64_t fileSize,
+                  int64_t begin,
+                  int64_t end,
+                  int32_t minTime,
+                  int64_t& lineOffset,
+                  int32_t& lineTime,
+                  bool& parsed);
+    bool ReadHead(const ReadFunc& read, int64_t fileSize, uint64_t& hash, size_t& size);
+
+    const std::string mTimeFormat;
+    std::map<int64_t, int32_t> mSamples; // line offset -> time
+    uint64_t mHeadHash = 0;
+    size_t mHeadSize = 0;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class FileTimeIndexUnittest;
+#endif
+};
+
+// FileTimeIndexCache keeps indexes of recently seeked files by dev and inode, at most file_time_index_cache_size
+// of them. An index is rebuilt if the head of file or the time format is changed.
+class FileTimeIndexCache {
+public:
+    static FileTimeIndexCache* GetInstance() {
+        static FileTimeIndexCache* sCache = new FileTimeIndexCache;
+        return sCache;
+    }
+
+    // Seek seeks @time in file of @devInode, see FileTimeIndex::Seek.
+    int64_t Seek(const DevInode& devInode,
+                 const std::string& timeFormat,
+                 const FileTimeIndex::ReadFunc& read,
+                 int64_t fileSize,
+                 int32_t time);
+
+    size_t Size();
+    void Clear();
+
+private:
+    FileTimeIndexCache() = default;
+
+    struct Item {
+        std::shared_ptr<FileTimeIndex> mIndex;
+        std::list<DevInode>::iterator mLruPos;
+    };
+
+    std::mutex mMutex;
+    // Most recently used first.
+    std::list<DevInode> mLru;
+    std::unordered_map<DevInode, Item, DevInodeHash, DevInodeEqual> mIndexes;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class FileTimeIndexUnittest;
+#endif
+};
+
+} // namespace logtail
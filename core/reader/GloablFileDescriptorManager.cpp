@@ -0,0 +1,106 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "GloablFileDescriptorManager.h"
+#include <vector>
+#include "common/Flags.h"
+#include "common/LogFileCollectOffsetIndicator.h"
+#include "logger/Logger.h"
+#include "LogFileReader.h"
+
+DEFINE_FLAG_INT32(reader_fd_budget,
+                  "close fds of least recently read idle readers if opened fd count exceeds it, 0 means disabled",
+                  0);
+
+namespace logtail {
+
+void GloablFileDescriptorManager::OnFileOpen(LogFileReader* reader) {
+    ++mOpenFileSize;
+    if (reader->IsFdEvicted()) {
+        reader->SetFdEvicted(false);
+        ++mReopenCount;
+    }
+    if (INT32_FLAG(reader_fd_budget) <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mLruMutex);
+    if (mLruIndex.find(reader) == mLruIndex.end()) {
+        mLruIndex[reader] = mLruList.insert(mLruList.begin(), reader);
+    }
+}
+
+void GloablFileDescriptorManager::OnFileClose(LogFileReader* reader) {
+    --mOpenFileSize;
+    std::lock_guard<std::mutex> lock(mLruMutex);
+    auto iter = mLruIndex.find(reader);
+    if (iter != mLruIndex.end()) {
+        mLruList.erase(iter->second);
+        mLruIndex.erase(iter);
+    }
+}
+
+void GloablFileDescriptorManager::OnFileRead(LogFileReader* reader) {
+    if (INT32_FLAG(reader_fd_budget) <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mLruMutex);
+    auto iter = mLruIndex.find(reader);
+    if (iter != mLruIndex.end()) {
+        mLruList.splice(mLruList.begin(), mLruList, iter->second);
+    }
+}
+
+size_t GloablFileDescriptorManager::EvictIdleFiles(int32_t budget) {
+    const int32_t evictCount = mOpenFileSize - budget;
+    if (budget <= 0 || evictCount <= 0) {
+        return 0;
+    }
+    std::vector<LogFileReader*> victims;
+    {
+        std::lock_guard<std::mutex> lock(mLruMutex);
+        for (auto iter = mLruList.rbegin(); iter != mLruList.rend() && (int32_t)victims.size() < evictCount;
+             ++iter) {
+            LogFileReader* reader = *iter;
+            // Readers with pending data would be opened again soon, and a reader behind others in the
+            // queue may not be found again after its file is rotated, see ModifyHandler::HandleTimeOut.
+            if (reader->GetLastFilePos() < reader->GetFileSize()) {
+                continue;
+            }
+            if (reader->GetReaderArray() != NULL && reader->GetReaderArray()->size() > 1) {
+                continue;
+            }
+            victims.push_back(reader);
+        }
+    }
+    // CloseFilePtr calls OnFileClose, so close them without lock.
+    for (LogFileReader* reader : victims) {
+        reader->CloseFilePtr();
+        reader->SetFdEvicted(true);
+        LogFileCollectOffsetIndicator::GetInstance()->DeleteItem(reader->GetLogPath(), reader->GetDevInode());
+    }
+    mEvictCount += victims.size();
+    if (!victims.empty()) {
+        LOG_INFO(sLogger,
+                 ("close fds of idle readers, count", victims.size())("budget", budget)("opened", mOpenFileSize));
+    }
+    return victims.size();
+}
+
+void GloablFileDescriptorManager::GetEvictStatus(uint64_t& evictCount, uint64_t& reopenCount) {
+    evictCount = mEvictCount.exchange(0);
+    reopenCount = mReopenCount.exchange(0);
+}
+
+} // namespace logtail
@@ -16,11 +16,18 @@
 
 #pragma once
 #include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
 namespace logtail {
 
 class LogFileReader;
 
+// GloablFileDescriptorManager counts fds opened by readers. If reader_fd_budget is positive, it also
+// ranks opened readers by recent read activity, so that fds of idle readers can be closed before the
+// hard limit max_reader_open_files is reached.
 class GloablFileDescriptorManager {
 public:
     static GloablFileDescriptorManager* GetInstance() {
@@ -28,14 +35,32 @@ public:
         return &singleton;
     }
 
-    void OnFileOpen(LogFileReader*) { ++mOpenFileSize; }
+    void OnFileOpen(LogFileReader* reader);
 
-    void OnFileClose(LogFileReader*) { --mOpenFileSize; }
+    void OnFileClose(LogFileReader* reader);
+
+    // OnFileRead moves @reader to the most recently used end.
+    void OnFileRead(LogFileReader* reader);
 
     int32_t GetOpenedFilePtrSize() { return mOpenFileSize; }
 
+    // EvictIdleFiles closes fds of least recently read readers until opened count is not above @budget.
+    // Only readers which have read all known data and are alone in their log reader queue are evicted.
+    // Not thread-safe with reading, call it in LogInput thread when no event is being handled.
+    // @return the number of closed fds.
+    size_t EvictIdleFiles(int32_t budget);
+
+    // GetEvictStatus returns the number of evicted fds and the number of evicted readers opened again
+    // since last call.
+    void GetEvictStatus(uint64_t& evictCount, uint64_t& reopenCount);
+
 private:
     std::atomic_int mOpenFileSize{0};
+    std::mutex mLruMutex;
+    std::list<LogFileReader*> mLruList; // most recently read at front
+    std::unordered_map<LogFileReader*, std::list<LogFileReader*>::iterator> mLruIndex;
+    std::atomic<uint64_t> mEvictCount{0};
+    std::atomic<uint64_t> mReopenCount{0};
 };
 
-} // namespace logtail
\ No newline at end of file
+} // namespace logtail
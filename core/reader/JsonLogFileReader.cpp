@@ -14,6 +14,8 @@
 
 #include "JsonLogFileReader.h"
 #include <ctime>
+#include <memory>
+#include <rapidjson/reader.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include "profiler/LogtailAlarm.h"
@@ -25,6 +27,190 @@ using namespace sls_logs;
 using namespace logtail;
 using namespace std;
 
+namespace {
+    typedef rapidjson::MemoryPoolAllocator<> JsonAllocator;
+    typedef rapidjson::GenericDocument<rapidjson::UTF8<>, JsonAllocator, JsonAllocator> JsonDocument;
+
+    // JsonParseBuffer holds the value and parse stack memory of json documents for a
+    // process thread, lines smaller than the buffers are parsed without any allocation.
+    class JsonParseBuffer {
+    public:
+        static const size_t kValueBufferSize = 64 * 1024;
+        static const size_t kStackBufferSize = 16 * 1024;
+
+        JsonParseBuffer()
+            : mValueBuffer(new char[kValueBufferSize]),
+              mStackBuffer(new char[kStackBufferSize]),
+              mValueAllocator(mValueBuffer.get(), kValueBufferSize),
+              mStackAllocator(mStackBuffer.get(), kStackBufferSize) {}
+
+        static JsonParseBuffer& GetThreadBuffer() {
+            static thread_local JsonParseBuffer sBuffer;
+            return sBuffer;
+        }
+
+        // Reset releases memory of last document, it must not be used any more.
+        void Reset() {
+            mValueAllocator.Clear();
+            mStackAllocator.Clear();
+        }
+
+        JsonAllocator* GetValueAllocator() { return &mValueAllocator; }
+        JsonAllocator* GetStackAllocator() { return &mStackAllocator; }
+
+    private:
+        std::unique_ptr<char[]> mValueBuffer;
+        std::unique_ptr<char[]> mStackBuffer;
+        JsonAllocator mValueAllocator;
+        JsonAllocator mStackAllocator;
+    };
+
+    // TopLevelJsonHandler adds members of the top level json object to log while
+    // parsing, nested objects and arrays are added as raw text sliced from the line.
+    // Members not in @keptKeys are skipped without building their values.
+    class TopLevelJsonHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, TopLevelJsonHandler> {
+    public:
+        TopLevelJsonHandler(const char* buffer,
+                            const rapidjson::StringStream& stream,
+                            const std::string& timeKey,
+                            const KeyProjection& keptKeys,
+                            Log* logPtr,
+                            uint32_t& logGroupSize)
+            : mBuffer(buffer),
+              mStream(stream),
+              mTimeKey(timeKey),
+              mKeptKeys(keptKeys),
+              mLogPtr(logPtr),
+              mLogGroupSize(logGroupSize) {}
+
+        bool Null() { return SkipScalar() || AddScalar(""); }
+        bool Bool(bool value) { return SkipScalar() || AddScalar(ToString(value)); }
+        bool Int(int value) { return AddInteger(value); }
+        bool Uint(unsigned value) { return AddInteger(value); }
+        bool Int64(int64_t value) { return AddInteger(value); }
+        bool Uint64(uint64_t value) {
+            if (value > static_cast<uint64_t>(INT64_MAX)) {
+                return SkipScalar() || AddScalar(ToString(value));
+            }
+            return AddInteger(static_cast<int64_t>(value));
+        }
+        bool Double(double value) { return SkipScalar() || AddScalar(ToString(value)); }
+        bool String(const char* str, rapidjson::SizeType length, bool copy) {
+            if (mDepth != 1) {
+                return mDepth > 1 || SetNotObject();
+            }
+            if (IsFirstTimeKey()) {
+                mTimeValue.assign(str, length);
+                mHasTime = true;
+            }
+            if (mKeyKept) {
+                LogParser::AddLog(mLogPtr, mKey, str, length, mLogGroupSize);
+            }
+            return true;
+        }
+        bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+            if (mDepth == 1) {
+                mKey.assign(str, length);
+                mKeyKept = mKeptKeys.Contains(str, length);
+            }
+            return true;
+        }
+        bool StartObject() { return StartNested(); }
+        bool EndObject(rapidjson::SizeType memberCount) { return EndNested(); }
+        bool StartArray() { return mDepth == 0 ? SetNotObject() : StartNested(); }
+        bool EndArray(rapidjson::SizeType elementCount) { return EndNested(); }
+
+        bool IsNotObject() const { return mNotObject; }
+        bool HasTime() const { return mHasTime; }
+        const std::string& GetTime() const { return mTimeValue; }
+
+    private:
+        bool SetNotObject() {
+            mNotObject = true;
+            return false;
+        }
+
+        // Only the first member named time key is considered.
+        bool IsFirstTimeKey() {
+            if (mTimeChecked || mTimeKey.empty() || mKey != mTimeKey) {
+                return false;
+            }
+            mTimeChecked = true;
+            return true;
+        }
+
+        // SkipScalar returns true if the current top level member is not kept, the time key is still checked.
+        bool SkipScalar() {
+            if (mDepth != 1 || mKeyKept) {
+                return false;
+            }
+            IsFirstTimeKey();
+            return true;
+        }
+
+        bool AddScalar(const std::string& value) {
+            if (mDepth != 1) {
+                return mDepth > 1 || SetNotObject();
+            }
+            IsFirstTimeKey();
+            LogParser::AddLog(mLogPtr, mKey, value, mLogGroupSize);
+            return true;
+        }
+
+        bool AddInteger(int64_t value) {
+            if (mDepth != 1) {
+                return mDepth > 1 || SetNotObject();
+            }
+            const bool isTime = IsFirstTimeKey();
+            if (!isTime && !mKeyKept) {
+                return true;
+            }
+            std::string valueStr = ToString(value);
+            if (isTime) {
+                mTimeValue = valueStr;
+                mHasTime = true;
+            }
+            if (mKeyKept) {
+                LogParser::AddLog(mLogPtr, mKey, valueStr, mLogGroupSize);
+            }
+            return true;
+        }
+
+        // Reader has consumed the '{' or '[' when calling StartObject/StartArray,
+        // and the '}' or ']' when calling EndObject/EndArray.
+        bool StartNested() {
+            if (mDepth == 1) {
+                IsFirstTimeKey();
+                mNestedBegin = mStream.Tell() - 1;
+            }
+            ++mDepth;
+            return true;
+        }
+
+        bool EndNested() {
+            if (--mDepth == 1 && mKeyKept) {
+                LogParser::AddLog(mLogPtr, mKey, mBuffer + mNestedBegin, mStream.Tell() - mNestedBegin, mLogGroupSize);
+            }
+            return true;
+        }
+
+        const char* mBuffer;
+        const rapidjson::StringStream& mStream;
+        const std::string& mTimeKey;
+        const KeyProjection& mKeptKeys;
+        Log* mLogPtr;
+        uint32_t& mLogGroupSize;
+        int32_t mDepth = 0;
+        size_t mNestedBegin = 0;
+        std::string mKey;
+        bool mKeyKept = true;
+        bool mNotObject = false;
+        bool mTimeChecked = false;
+        bool mHasTime = false;
+        std::string mTimeValue;
+    };
+} // namespace
+
 JsonLogFileReader::JsonLogFileReader(const std::string& projectName,
                                      const std::string& category,
                                      const std::string& logPathDir,
@@ -50,6 +236,7 @@ JsonLogFileReader::JsonLogFileReader(const std::string& projectName,
     mTimeFormat = timeFormat;
     mTimeKey.clear();
     mUseSystemTime = true;
+    mRawNestedValue = false;
 }
 
 void JsonLogFileReader::SetTimeKey(const std::string& timeKey) {
@@ -60,6 +247,31 @@ void JsonLogFileReader::SetTimeKey(const std::string& timeKey) {
         mUseSystemTime = false;
 }
 
+void JsonLogFileReader::ParseLogLines(const char* buffer,
+                                      const int32_t* offsets,
+                                      uint32_t count,
+                                      sls_logs::LogGroup& logGroup,
+                                      LogLineParseState& state,
+                                      uint32_t& logGroupSize,
+                                      LogLineParseResult* results) {
+    ParseLogLinesBy(
+        [this](const char* line,
+               sls_logs::LogGroup& group,
+               ParseLogError& error,
+               time_t& lastLogLineTime,
+               std::string& lastLogTimeStr,
+               uint32_t& size) {
+            return JsonLogFileReader::ParseLogLine(line, group, error, lastLogLineTime, lastLogTimeStr, size);
+        },
+        buffer,
+        offsets,
+        count,
+        logGroup,
+        state,
+        logGroupSize,
+        results);
+}
+
 bool JsonLogFileReader::ParseLogLine(const char* buffer,
                                      sls_logs::LogGroup& logGroup,
                                      ParseLogError& error,
@@ -73,9 +285,14 @@ bool JsonLogFileReader::ParseLogLine(const char* buffer,
         logGroup.set_category(mCategory);
         logGroup.set_topic(mTopicName);
     }
+    if (mRawNestedValue) {
+        return ParseRawNestedLogLine(buffer, logGroup, error, lastLogLineTime, lastLogTimeStr, logGroupSize);
+    }
     bool parseSuccess = true;
     uint64_t preciseTimestamp = 0;
-    rapidjson::Document doc;
+    JsonParseBuffer& parseBuffer = JsonParseBuffer::GetThreadBuffer();
+    parseBuffer.Reset();
+    JsonDocument doc(parseBuffer.GetValueAllocator(), 1024, parseBuffer.GetStackAllocator());
     doc.Parse(buffer);
     if (doc.HasParseError()) {
         if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
@@ -102,7 +319,7 @@ bool JsonLogFileReader::ParseLogLine(const char* buffer,
         error = PARSE_LOG_FORMAT_ERROR;
         parseSuccess = false;
     } else if (!mUseSystemTime) {
-        rapidjson::Value::ConstMemberIterator itr = doc.FindMember(mTimeKey.c_str());
+        JsonDocument::ConstMemberIterator itr = doc.FindMember(mTimeKey.c_str());
         if (itr != doc.MemberEnd() && (itr->value.IsString() || itr->value.IsInt64())) {
             if (!LogParser::ParseLogTime(buffer,
                                          lastLogTimeStr,
@@ -142,12 +359,24 @@ bool JsonLogFileReader::ParseLogLine(const char* buffer,
 
     if (parseSuccess) {
         Log* logPtr = logGroup.add_logs();
-        logPtr->set_time(mUseSystemTime ? time(NULL) : lastLogLineTime);
-        for (rapidjson::Value::ConstMemberIterator itr = doc.MemberBegin(); itr != doc.MemberEnd(); ++itr) {
-            const rapidjson::Value& contentKey = itr->name;
-            const rapidjson::Value& contentValue = itr->value;
-            LogParser::AddLog(
-                logPtr, RapidjsonValueToString(contentKey), RapidjsonValueToString(contentValue), logGroupSize);
+        logPtr->set_time(mUseSystemTime ? time(NULL) : lastLogLineTime - mTzOffsetSecond);
+        for (JsonDocument::ConstMemberIterator itr = doc.MemberBegin(); itr != doc.MemberEnd(); ++itr) {
+            const JsonDocument::ValueType& contentKey = itr->name;
+            const JsonDocument::ValueType& contentValue = itr->value;
+            if (!mKeptKeys.Contains(contentKey.GetString(), contentKey.GetStringLength())) {
+                continue;
+            }
+            if (contentValue.IsString()) {
+                LogParser::AddLog(logPtr,
+                                  contentKey.GetString(),
+                                  contentKey.GetStringLength(),
+                                  contentValue.GetString(),
+                                  contentValue.GetStringLength(),
+                                  logGroupSize);
+            } else {
+                LogParser::AddLog(
+                    logPtr, RapidjsonValueToString(contentKey), RapidjsonValueToString(contentValue), logGroupSize);
+            }
         }
         if (!mUseSystemTime && mPreciseTimestampConfig.enabled) {
             LogParser::AddLog(logPtr, mPreciseTimestampConfig.key, std::to_string(preciseTimestamp), logGroupSize);
@@ -159,6 +388,108 @@ bool JsonLogFileReader::ParseLogLine(const char* buffer,
     return false;
 }
 
+bool JsonLogFileReader::ParseRawNestedLogLine(const char* buffer,
+                                              LogGroup& logGroup,
+                                              ParseLogError& error,
+                                              time_t& lastLogLineTime,
+                                              std::string& lastLogTimeStr,
+                                              uint32_t& logGroupSize) {
+    const uint32_t preLogGroupSize = logGroupSize;
+    Log* logPtr = logGroup.add_logs();
+    JsonParseBuffer& parseBuffer = JsonParseBuffer::GetThreadBuffer();
+    parseBuffer.Reset();
+    const string timeKey = mUseSystemTime ? string() : mTimeKey;
+    rapidjson::StringStream stream(buffer);
+    TopLevelJsonHandler handler(buffer, stream, timeKey, mKeptKeys, logPtr, logGroupSize);
+    rapidjson::GenericReader<rapidjson::UTF8<>, rapidjson::UTF8<>, JsonAllocator> reader(
+        parseBuffer.GetStackAllocator());
+    reader.Parse(stream, handler);
+
+    bool parseSuccess = true;
+    uint64_t preciseTimestamp = 0;
+    if (handler.IsNotObject()) {
+        if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
+            LOG_WARNING(
+                sLogger,
+                ("invalid json object, log", buffer)("project", mProjectName)("logstore", mCategory)("file", mLogPath));
+            LogtailAlarm::GetInstance()->SendAlarm(PARSE_LOG_FAIL_ALARM,
+                                                   string("invalid json object:") + string(buffer),
+                                                   mProjectName,
+                                                   mCategory,
+                                                   mRegion);
+        }
+        error = PARSE_LOG_FORMAT_ERROR;
+        parseSuccess = false;
+    } else if (reader.HasParseError()) {
+        if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
+            LOG_WARNING(sLogger,
+                        ("parse json log fail, log", buffer)("rapidjson offset", reader.GetErrorOffset())(
+                            "rapidjson error", reader.GetParseErrorCode())("project", mProjectName)(
+                            "logstore", mCategory)("file", mLogPath));
+            LogtailAlarm::GetInstance()->SendAlarm(PARSE_LOG_FAIL_ALARM,
+                                                   string("parse json fail:") + string(buffer),
+                                                   mProjectName,
+                                                   mCategory,
+                                                   mRegion);
+        }
+        error = PARSE_LOG_FORMAT_ERROR;
+        parseSuccess = false;
+    } else if (!mUseSystemTime) {
+        if (handler.HasTime()) {
+            if (!LogParser::ParseLogTime(buffer,
+                                         lastLogTimeStr,
+                                         lastLogLineTime,
+                                         preciseTimestamp,
+                                         handler.GetTime(),
+                                         mTimeFormat.c_str(),
+                                         mPreciseTimestampConfig,
+                                         mSpecifiedYear,
+                                         mProjectName,
+                                         mCategory,
+                                         mRegion,
+                                         mLogPath,
+                                         error,
+                                         mTzOffsetSecond)) {
+                parseSuccess = false;
+                if (error == PARSE_LOG_HISTORY_ERROR) {
+                    logGroup.mutable_logs()->RemoveLast();
+                    logGroupSize = preLogGroupSize;
+                    return false;
+                }
+            }
+        } else {
+            if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
+                LOG_WARNING(sLogger,
+                            ("parse json log fail, log", buffer)("invalid time key", mTimeKey)("project", mProjectName)(
+                                "logstore", mCategory)("file", mLogPath));
+                LogtailAlarm::GetInstance()->SendAlarm(PARSE_LOG_FAIL_ALARM,
+                                                       string("found no time_key: ") + mTimeKey
+                                                           + ", log:" + string(buffer),
+                                                       mProjectName,
+                                                       mCategory,
+                                                       mRegion);
+            }
+            error = PARSE_LOG_FORMAT_ERROR;
+            parseSuccess = false;
+        }
+    }
+
+    if (parseSuccess) {
+        logPtr->set_time(mUseSystemTime ? time(NULL) : lastLogLineTime - mTzOffsetSecond);
+        if (!mUseSystemTime && mPreciseTimestampConfig.enabled) {
+            LogParser::AddLog(logPtr, mPreciseTimestampConfig.key, std::to_string(preciseTimestamp), logGroupSize);
+        }
+        return true;
+    }
+    // Contents added before the error are dropped with the log.
+    logGroup.mutable_logs()->RemoveLast();
+    logGroupSize = preLogGroupSize;
+    if (!mDiscardUnmatch) {
+        LogParser::AddUnmatchLog(buffer, logGroup, logGroupSize);
+    }
+    return false;
+}
+
 std::string JsonLogFileReader::RapidjsonValueToString(const rapidjson::Value& value) {
     if (value.IsString())
         return value.GetString();
@@ -185,7 +516,7 @@ std::string JsonLogFileReader::RapidjsonValueToString(const rapidjson::Value& va
     }
 }
 
-vector<int32_t> JsonLogFileReader::LogSplit(char* buffer, int32_t size, int32_t& lineFeed) {
+vector<int32_t> JsonLogFileReader::LogSplit(char* buffer, int32_t size, int32_t& lineFeed, int32_t checkedSize) {
     vector<int32_t> index;
     int32_t i = 0;
     index.push_back(i);
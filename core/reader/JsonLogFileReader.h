@@ -38,7 +38,11 @@ public:
                       bool dockerFileFlag = false);
 
     void SetTimeKey(const std::string& timeKey);
-    std::vector<int32_t> LogSplit(char* buffer, int32_t size, int32_t& lineFeed);
+    // SetRawNestedValue makes nested objects and arrays kept as their raw json text
+    // instead of re-serialized, lines are then parsed by SAX without building document.
+    void SetRawNestedValue(bool rawNestedValue) { mRawNestedValue = rawNestedValue; }
+    std::vector<int32_t> LogSplit(char* buffer, int32_t size, int32_t& lineFeed, int32_t checkedSize = 0);
+    bool IsSingleLineSplit() const override { return false; }
 
 protected:
     bool ParseLogLine(const char* buffer,
@@ -47,16 +51,30 @@ protected:
                       time_t& lastLogLineTime,
                       std::string& lastLogTimeStr,
                       uint32_t& logGroupSize);
+    void ParseLogLines(const char* buffer,
+                       const int32_t* offsets,
+                       uint32_t count,
+                       sls_logs::LogGroup& logGroup,
+                       LogLineParseState& state,
+                       uint32_t& logGroupSize,
+                       LogLineParseResult* results) override;
 
     int32_t LastMatchedLine(char* buffer, int32_t size, int32_t& rollbackLineFeedCount);
 
 private:
+    bool ParseRawNestedLogLine(const char* buffer,
+                               sls_logs::LogGroup& logGroup,
+                               ParseLogError& error,
+                               time_t& lastLogLineTime,
+                               std::string& lastLogTimeStr,
+                               uint32_t& logGroupSize);
     bool FindJsonMatch(char* buffer, int32_t beginIdx, int32_t size, int32_t& endIdx, bool& startWithBlock);
     std::string RapidjsonValueToString(const rapidjson::Value& value);
 
     std::string mTimeKey;
     std::string mTimeFormat;
     bool mUseSystemTime;
+    bool mRawNestedValue;
 
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class LogFileReaderUnittest;
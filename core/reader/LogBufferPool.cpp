@@ -0,0 +1,206 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "LogBufferPool.h"
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+#include "common/Flags.h"
+#include "common/MemoryBudget.h"
+
+DEFINE_FLAG_INT32(read_buffer_pool_max_idle_bytes, "max bytes of idle read buffers cached by pool", 64 * 1024 * 1024);
+DEFINE_FLAG_BOOL(read_buffer_pool_huge_page,
+                 "map read buffers of 2MB and above with huge pages, THP is used if no huge page is reserved",
+                 false);
+
+namespace logtail {
+
+const size_t LogBufferPool::kMinSlabSize;
+const size_t LogBufferPool::kSlabPadding;
+const int32_t LogBufferPool::kSizeClassCount;
+const size_t LogBufferPool::kHugePageSize;
+
+#if defined(__linux__)
+namespace {
+
+    const size_t kNormalPageSize = 4096;
+
+    size_t RoundUp(size_t size, size_t unit) {
+        return (size + unit - 1) / unit * unit;
+    }
+
+    // MapAt maps @size bytes at @addr with @flags, NULL is returned if the range is taken by others.
+    char* MapAt(char* addr, size_t size, int flags) {
+        void* p = mmap(addr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+        if (p == MAP_FAILED) {
+            return NULL;
+        }
+        if (addr != NULL && p != addr) {
+            munmap(p, size);
+            return NULL;
+        }
+        return static_cast<char*>(p);
+    }
+
+} // namespace
+#endif
+
+LogBufferPool::LogBufferPool()
+    : mIdleSlabs(kSizeClassCount), mIdleBytes(0), mInUseBytes(0), mHitCount(0), mMissCount(0) {
+}
+
+int32_t LogBufferPool::GetSizeClass(size_t size) {
+    for (int32_t sizeClass = 0; sizeClass < kSizeClassCount; ++sizeClass) {
+        if (size <= GetSlabSize(sizeClass)) {
+            return sizeClass;
+        }
+    }
+    return -1;
+}
+
+LogBufferSlabPtr LogBufferPool::Acquire(size_t size) {
+    const int32_t sizeClass = GetSizeClass(size);
+    if (sizeClass < 0) {
+        ++mMissCount;
+        return LogBufferSlabPtr(new char[size], std::default_delete<char[]>());
+    }
+
+    const size_t slabSize = GetSlabSize(sizeClass);
+    Slab slab = {NULL, false};
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& idleSlabs = mIdleSlabs[sizeClass];
+        if (!idleSlabs.empty()) {
+            slab = idleSlabs.back();
+            idleSlabs.pop_back();
+            mIdleBytes -= slabSize;
+        }
+        mInUseBytes += slabSize;
+    }
+    if (slab.mData != NULL) {
+        ++mHitCount;
+    } else {
+        ++mMissCount;
+        slab.mData = AllocateSlab(slabSize, slab.mHugePage);
+    }
+    const bool hugePage = slab.mHugePage;
+    return LogBufferSlabPtr(slab.mData, [this, sizeClass, hugePage](char* p) {
+        Slab released = {p, hugePage};
+        Release(released, sizeClass);
+    });
+}
+
+char* LogBufferPool::AllocateSlab(size_t slabSize, bool& hugePage) {
+    hugePage = false;
+    if (BOOL_FLAG(read_buffer_pool_huge_page) && slabSize >= kHugePageSize) {
+        char* slab = MapHugePageSlab(slabSize);
+        if (slab != NULL) {
+            hugePage = true;
+            return slab;
+        }
+    }
+    return new char[slabSize];
+}
+
+void LogBufferPool::FreeSlab(const Slab& slab, size_t slabSize) {
+    if (!slab.mHugePage) {
+        delete[] slab.mData;
+        return;
+    }
+#if defined(__linux__)
+    munmap(slab.mData, RoundUp(slabSize, kNormalPageSize));
+#endif
+}
+
+char* LogBufferPool::MapHugePageSlab(size_t slabSize) {
+#if defined(__linux__)
+    // Head of the slab is [0, hugeSize) and takes whole huge pages, the padding
+    // tail takes normal pages, so no huge page is wasted for the padding.
+    const size_t hugeSize = slabSize / kHugePageSize * kHugePageSize;
+    const size_t mapSize = RoundUp(slabSize, kNormalPageSize);
+    const size_t tailSize = mapSize - hugeSize;
+#if defined(MAP_HUGETLB)
+    char* head = MapAt(NULL, hugeSize, MAP_HUGETLB);
+    if (head != NULL) {
+        if (tailSize == 0 || MapAt(head + hugeSize, tailSize, 0) != NULL) {
+            return head;
+        }
+        munmap(head, hugeSize);
+    }
+#endif
+
+    // No huge page reserved, map a range aligned to huge page and advise THP.
+    char* range = MapAt(NULL, mapSize + kHugePageSize, 0);
+    if (range == NULL) {
+        return NULL;
+    }
+    char* aligned = reinterpret_cast<char*>(RoundUp(reinterpret_cast<uintptr_t>(range), kHugePageSize));
+    if (aligned != range) {
+        munmap(range, aligned - range);
+    }
+    munmap(aligned + mapSize, range + kHugePageSize - aligned);
+#if defined(MADV_HUGEPAGE)
+    madvise(aligned, hugeSize, MADV_HUGEPAGE);
+#endif
+    return aligned;
+#else
+    return NULL;
+#endif
+}
+
+void LogBufferPool::Release(const Slab& slab, int32_t sizeClass) {
+    const size_t slabSize = GetSlabSize(sizeClass);
+    // Slabs are not cached while log buffers are over budget, huge pages are
+    // never swapped, so idle ones should not hold memory others are waiting for.
+    const bool overBudget = MemoryBudget::IsOverBudget(MEMORY_COMPONENT_LOG_BUFFER);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mInUseBytes -= slabSize;
+        if (!overBudget
+            && mIdleBytes + slabSize <= static_cast<size_t>(INT32_FLAG(read_buffer_pool_max_idle_bytes))) {
+            mIdleSlabs[sizeClass].push_back(slab);
+            mIdleBytes += slabSize;
+            return;
+        }
+    }
+    FreeSlab(slab, slabSize);
+}
+
+void LogBufferPool::GetStatus(uint64_t& hitCount, uint64_t& missCount, uint64_t& residentBytes) {
+    hitCount = mHitCount.exchange(0);
+    missCount = mMissCount.exchange(0);
+    std::lock_guard<std::mutex> lock(mMutex);
+    residentBytes = mIdleBytes + mInUseBytes;
+}
+
+size_t LogBufferPool::GetInUseBytes() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mInUseBytes;
+}
+
+void LogBufferPool::Clear() {
+    std::vector<std::vector<Slab> > idleSlabs(kSizeClassCount);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        idleSlabs.swap(mIdleSlabs);
+        mIdleBytes = 0;
+    }
+    for (size_t sizeClass = 0; sizeClass < idleSlabs.size(); ++sizeClass) {
+        for (auto& slab : idleSlabs[sizeClass]) {
+            FreeSlab(slab, GetSlabSize(static_cast<int32_t>(sizeClass)));
+        }
+    }
+}
+
+} // namespace logtail
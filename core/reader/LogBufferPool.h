@@ -0,0 +1,96 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace logtail {
+
+// LogBufferSlabPtr is the ref-counted handle of a read buffer, the slab goes
+// back to its pool when the last handle is released.
+typedef std::shared_ptr<char> LogBufferSlabPtr;
+
+// LogBufferPool caches read buffers of LogFileReader by size class, so that
+// reading busy files does not allocate and free a large block for each read.
+// Size class k holds slabs of (kMinSlabSize << k) + kSlabPadding bytes, the
+// padding leaves room for the terminating '\0' appended by readers.
+// With flag read_buffer_pool_huge_page, slabs of 2MB and above are mapped
+// with explicit huge pages (MAP_HUGETLB) for their 2MB aligned head and
+// normal pages for the padding tail, or with THP (madvise) if no huge page
+// is reserved, to cut page faults and TLB misses of large reads.
+class LogBufferPool {
+public:
+    static LogBufferPool* GetInstance() {
+        static LogBufferPool* sPool = new LogBufferPool;
+        return sPool;
+    }
+
+    // Acquire returns a slab with at least @size bytes, content is undefined.
+    LogBufferSlabPtr Acquire(size_t size);
+
+    // GetStatus returns hit/miss counts since last call and bytes currently
+    // held by the pool (idle and in use).
+    void GetStatus(uint64_t& hitCount, uint64_t& missCount, uint64_t& residentBytes);
+
+    // GetInUseBytes returns bytes of pooled slabs not released yet.
+    size_t GetInUseBytes();
+
+    // Clear frees all idle slabs.
+    void Clear();
+
+    static const size_t kMinSlabSize = 4 * 1024;
+    static const size_t kSlabPadding = 64;
+    static const int32_t kSizeClassCount = 12; // 4KB ~ 8MB
+    static const size_t kHugePageSize = 2 * 1024 * 1024;
+
+private:
+    LogBufferPool();
+
+    // @return -1 if @size is too large to be pooled.
+    static int32_t GetSizeClass(size_t size);
+    static size_t GetSlabSize(int32_t sizeClass) { return (kMinSlabSize << sizeClass) + kSlabPadding; }
+
+    struct Slab {
+        char* mData;
+        bool mHugePage;
+    };
+
+    // AllocateSlab returns a slab of @slabSize bytes, @hugePage is set if it is mapped by MapHugePageSlab.
+    static char* AllocateSlab(size_t slabSize, bool& hugePage);
+    static void FreeSlab(const Slab& slab, size_t slabSize);
+    // MapHugePageSlab returns NULL if huge pages are not supported, slab should be allocated from heap then.
+    static char* MapHugePageSlab(size_t slabSize);
+
+    void Release(const Slab& slab, int32_t sizeClass);
+
+    std::mutex mMutex;
+    std::vector<std::vector<Slab> > mIdleSlabs;
+    size_t mIdleBytes;
+    size_t mInUseBytes;
+    std::atomic<uint64_t> mHitCount;
+    std::atomic<uint64_t> mMissCount;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class LogBufferPoolUnittest;
+#endif
+};
+
+} // namespace logtail
@@ -31,23 +31,30 @@
 #include "common/FileSystemUtil.h"
 #include "common/RandomUtil.h"
 #include "common/Constants.h"
+#include "common/LineFeedScanner.h"
+#include "common/StageProfiler.h"
 #include "sdk/Common.h"
 #include "logger/Logger.h"
+#include "logger/HotLogger.h"
 #include "checkpoint/CheckPointManager.h"
 #include "checkpoint/CheckpointManagerV2.h"
 #include "profiler/LogtailAlarm.h"
 #include "profiler/LogFileProfiler.h"
 #include "event_handler/LogInput.h"
+#include "monitor/Monitor.h"
 #include "app_config/AppConfig.h"
 #include "config_manager/ConfigManager.h"
 #include "common/LogFileCollectOffsetIndicator.h"
 #include "fuse/UlogfsHandler.h"
 #include "sender/Sender.h"
 #include "GloablFileDescriptorManager.h"
+#include "FileTimeIndex.h"
 
 using namespace sls_logs;
 using namespace std;
 
+DECLARE_FLAG_BOOL(check_point_snapshot_dump_enable);
+
 DEFINE_FLAG_INT32(delay_bytes_upperlimit,
                   "if (total_file_size - current_readed_size) exceed uppperlimit, send READ_LOG_DELAY_ALARM, bytes",
                   200 * 1024 * 1024);
@@ -62,6 +69,31 @@ DEFINE_FLAG_INT32(max_fix_pos_bytes, "", 128 * 1024);
 DEFINE_FLAG_INT32(force_release_deleted_file_fd_timeout,
                   "force release fd if file is deleted after specified seconds, no matter read to end or not",
                   -1);
+DEFINE_FLAG_INT32(signature_recheck_interval,
+                  "seconds to trust the checked file signature while the file does not shrink, 0 means always check",
+                  0);
+DEFINE_FLAG_BOOL(adaptive_read_size_enable, "adapt max read size of each file to its backlog", false);
+DEFINE_FLAG_INT32(adaptive_read_max_size, "max read size of files with backlog, bytes", 8 * 1024 * 1024);
+DEFINE_FLAG_INT64(read_buffer_budget_bytes,
+                  "reads larger than default read buffer size are allowed only when in-use read buffers are under it",
+                  256 * 1024 * 1024);
+DEFINE_FLAG_INT32(read_ahead_max_bytes,
+                  "max bytes of a file with backlog advised to read ahead while the current read is processed, "
+                  "0 means only reads larger than default read buffer size are followed by read ahead",
+                  0);
+DEFINE_FLAG_INT32(batch_tail_read_size,
+                  "bytes read at the read position of each modified file in one batch before events are handled, "
+                  "only when events are handled by threads, 0 to disable",
+                  0);
+DEFINE_FLAG_BOOL(enable_compressed_rotated_file_read,
+                 "read the gzip or zstd archive of a rotated file if the file is compressed before read completely",
+                 false);
+DEFINE_FLAG_STRING(compressed_rotated_file_suffixes,
+                   "suffixes of compressed rotated files, separated by comma",
+                   ".gz,.zst");
+DEFINE_FLAG_BOOL(gbk_convert_by_table_enable,
+                 "convert GBK files by lookup table with ASCII fast path into pooled buffers",
+                 false);
 
 namespace logtail {
 
@@ -99,8 +131,12 @@ void LogFileReader::DumpMetaToMem(bool checkConfigFlag) {
                 "file signature", mLastFileSignatureHash)("real file path", mRealLogPath)("file size", mLastFileSize)(
                 "last file position", mLastFilePos)("is file opened", ToString(mLogFileOp.IsOpen())));
     }
+    CheckPointManager::Instance()->AddCheckPoint(MakeCheckPoint());
+}
+
+CheckPoint* LogFileReader::MakeCheckPoint() const {
     CheckPoint* checkPointPtr = new CheckPoint(mLogPath,
-                                               mLastFilePos,
+                                               GetCheckpointOffset(),
                                                mLastFileSignatureSize,
                                                mLastFileSignatureHash,
                                                mDevInode,
@@ -109,7 +145,21 @@ void LogFileReader::DumpMetaToMem(bool checkConfigFlag) {
                                                mLogFileOp.IsOpen() ? 1 : 0);
     // use last event time as checkpoint's last update time
     checkPointPtr->mLastUpdateTime = mLastEventTime;
-    CheckPointManager::Instance()->AddCheckPoint(checkPointPtr);
+    return checkPointPtr;
+}
+
+void LogFileReader::PublishCheckPoint() {
+    if (!BOOL_FLAG(check_point_snapshot_dump_enable)) {
+        return;
+    }
+    const CheckPointSnapshotTable::CheckPointSnapshot last = mCheckPointSlot.Get();
+    if (last && last->mOffset == GetCheckpointOffset() && last->mLastUpdateTime == mLastEventTime
+        && last->mFileOpenFlag == (mLogFileOp.IsOpen() ? 1 : 0) && last->mSignatureHash == mLastFileSignatureHash
+        && last->mSignatureSize == mLastFileSignatureSize && last->mDevInode == mDevInode
+        && last->mRealFileName == mRealLogPath) {
+        return;
+    }
+    mCheckPointSlot.Publish(CheckPointSnapshotTable::CheckPointSnapshot(MakeCheckPoint()));
 }
 
 void LogFileReader::SetFileDeleted(bool flag) {
@@ -138,6 +188,7 @@ void LogFileReader::InitReader(bool tailExisted, FileReadPolicy policy, uint32_t
     string buffer = LogFileProfiler::mIpAddr + "_" + mLogPath + "_" + CalculateRandomUUID();
     uint64_t cityHash = CityHash64(buffer.c_str(), buffer.size());
     mSourceId = ToHexString(cityHash);
+    mSourceIdKey = HashWithSeed(mSourceId);
 
     if (!tailExisted) {
         static CheckPointManager* checkPointManagerPtr = CheckPointManager::Instance();
@@ -179,6 +230,7 @@ void LogFileReader::InitReader(bool tailExisted, FileReadPolicy policy, uint32_t
     if (mFirstWatched) {
         CheckForFirstOpen(policy);
     }
+    PublishCheckPoint();
 }
 
 namespace detail {
@@ -250,6 +302,7 @@ void LogFileReader::initExactlyOnce(uint32_t concurrency) {
     std::random_shuffle(concurrencySequence.begin(), concurrencySequence.end());
     // Initialize range checkpoints (recover from local if have).
     mEOOption->rangeCheckpointPtrs.resize(mEOOption->concurrency);
+    mEOOption->watermark = std::make_shared<RangeCommitWatermark>();
     std::string baseHashKey;
     for (size_t idx = 0; idx < concurrencySequence.size(); ++idx) {
         const uint32_t partIdx = concurrencySequence[idx];
@@ -257,6 +310,7 @@ void LogFileReader::initExactlyOnce(uint32_t concurrency) {
         rangeCpt.reset(new RangeCheckpoint);
         rangeCpt->index = idx;
         rangeCpt->key = CheckpointManagerV2::MakeRangeKey(mEOOption->primaryCheckpointKey, partIdx);
+        rangeCpt->watermark = mEOOption->watermark;
 
         // No checkpoint, generate random hash key.
         bool newCpt = !hasCheckpoint || !sCptM->GetPB(rangeCpt->key, rangeCpt->data);
@@ -289,6 +343,7 @@ void LogFileReader::initExactlyOnce(uint32_t concurrency) {
     }
 
     adjustParametersByRangeCheckpoints();
+    mEOOption->watermark->Reset(static_cast<uint64_t>(mLastFilePos));
 }
 
 bool LogFileReader::validatePrimaryCheckpoint(const PrimaryCheckpointPB& cpt) {
@@ -337,6 +392,7 @@ bool LogFileReader::validatePrimaryCheckpoint(const PrimaryCheckpointPB& cpt) {
 
 void LogFileReader::adjustParametersByRangeCheckpoints() {
     auto& uncommittedCheckpoints = mEOOption->toReplayCheckpoints;
+    const uint64_t committedOffset = mEOOption->primaryCheckpoint.committed_offset();
     uint32_t maxOffsetIndex = mEOOption->concurrency;
     for (uint32_t idx = 0; idx < mEOOption->concurrency; ++idx) {
         auto& rangeCpt = mEOOption->rangeCheckpointPtrs[idx];
@@ -344,6 +400,11 @@ void LogFileReader::adjustParametersByRangeCheckpoints() {
             continue;
         } // Skip new checkpoint.
 
+        // Acknowledged but the commit is not persisted, it has been sent.
+        if (!rangeCpt->data.committed() && committedOffset > 0
+            && rangeCpt->data.read_offset() + rangeCpt->data.read_length() <= committedOffset) {
+            rangeCpt->data.set_committed(true);
+        }
         if (!rangeCpt->data.committed()) {
             uncommittedCheckpoints.push_back(rangeCpt);
         } else {
@@ -409,6 +470,21 @@ void LogFileReader::updatePrimaryCheckpointRealPath() {
     detail::updatePrimaryCheckpoint(mEOOption->primaryCheckpointKey, cpt, "real_path");
 }
 
+void LogFileReader::updatePrimaryCheckpointCommittedOffset() {
+    auto& cpt = mEOOption->primaryCheckpoint;
+    const uint64_t committedOffset = mEOOption->watermark->GetCommittedOffset();
+    if (committedOffset == cpt.committed_offset()) {
+        return;
+    }
+    cpt.set_committed_offset(committedOffset);
+    cpt.set_update_time(time(NULL));
+    if (!CheckpointManagerV2::GetInstance()->SetPB(mEOOption->primaryCheckpointKey, cpt)) {
+        LOG_WARNING(sLogger,
+                    ("update primary checkpoint error", mEOOption->primaryCheckpointKey)("field", "committed_offset")(
+                        "checkpoint", cpt.DebugString()));
+    }
+}
+
 LogFileReader::LogFileReader(const string& projectName,
                              const string& category,
                              const string& logPathDir,
@@ -425,7 +501,6 @@ LogFileReader::LogFileReader(const string& projectName,
     mTailLimit = tailLimit;
     mLastFilePos = 0;
     mLastFileSize = 0;
-    mLogBeginRegPtr = NULL;
     mDiscardUnmatch = discardUnmatch;
     mLastUpdateTime = time(NULL);
     mLastEventTime = mLastUpdateTime;
@@ -477,7 +552,6 @@ LogFileReader::LogFileReader(const std::string& projectName,
     else if (!dockerFileFlag) // if docker file, wait for reset topic format
         mTopicName = GetTopicName(topicFormat, mLogPath);
     mFileEncoding = fileEncoding;
-    mLogBeginRegPtr = NULL;
     mDiscardUnmatch = discardUnmatch;
     mLastUpdateTime = time(NULL);
     mLastEventTime = mLastUpdateTime;
@@ -511,6 +585,55 @@ void LogFileReader::SetDockerPath(const std::string& dockerBasePath, size_t dock
     }
 }
 
+std::shared_ptr<const std::string> LogFileReader::GetCachedPluginTags(const std::string& logPath,
+                                                                      const std::string& userDefinedId) {
+    ScopedSpinLock lock(mTagsCacheLock);
+    if (!mCachedPluginTags || !mCachedPluginTagsKey.Match(logPath, userDefinedId, mExtraTags.size())) {
+        return nullptr;
+    }
+    return mCachedPluginTags;
+}
+
+void LogFileReader::SetCachedPluginTags(const std::string& logPath,
+                                        const std::string& userDefinedId,
+                                        std::shared_ptr<const std::string> tags) {
+    ScopedSpinLock lock(mTagsCacheLock);
+    mCachedPluginTags = std::move(tags);
+    mCachedPluginTagsKey.mLogPath = logPath;
+    mCachedPluginTagsKey.mUserDefinedId = userDefinedId;
+    mCachedPluginTagsKey.mExtraTagCount = mExtraTags.size();
+}
+
+std::shared_ptr<const std::vector<sls_logs::LogTag>>
+LogFileReader::GetCachedLogTags(const std::string& logPath, const std::string& userDefinedId) {
+    ScopedSpinLock lock(mTagsCacheLock);
+    if (!mCachedLogTags || !mCachedLogTagsKey.Match(logPath, userDefinedId, mExtraTags.size())) {
+        return nullptr;
+    }
+    return mCachedLogTags;
+}
+
+void LogFileReader::SetCachedLogTags(const std::string& logPath,
+                                     const std::string& userDefinedId,
+                                     std::shared_ptr<const std::vector<sls_logs::LogTag>> tags) {
+    ScopedSpinLock lock(mTagsCacheLock);
+    mCachedLogTags = std::move(tags);
+    mCachedLogTagsKey.mLogPath = logPath;
+    mCachedLogTagsKey.mUserDefinedId = userDefinedId;
+    mCachedLogTagsKey.mExtraTagCount = mExtraTags.size();
+}
+
+Config* LogFileReader::GetConfig() {
+    // Read generation before the lookup, a config deleted during it is looked up again next time.
+    const int64_t generation = ConfigManager::GetInstance()->GetConfigGeneration();
+    ScopedSpinLock lock(mCachedConfigLock);
+    if (mCachedConfig == NULL || mCachedConfigGeneration != generation) {
+        mCachedConfig = ConfigManager::GetInstance()->FindConfigByName(mConfigName);
+        mCachedConfigGeneration = generation;
+    }
+    return mCachedConfig;
+}
+
 void LogFileReader::SetReadFromBeginning() {
     mLastFilePos = 0;
     mLastReadPos = 0;
@@ -689,15 +812,25 @@ int LogFileReader::ParseAllLines(
 }
 
 int32_t LogFileReader::ParseTime(const char* buffer, const std::string& timeFormat) {
-    struct tm tm;
-    memset(&tm, 0, sizeof(tm));
-    const char* result = strptime(buffer, timeFormat.c_str(), &tm);
-    tm.tm_isdst = -1;
-    if (result != NULL) {
-        time_t logTime = mktime(&tm);
-        return logTime;
+    return FileTimeIndex::ParseTime(buffer, timeFormat);
+}
+
+bool LogFileReader::SetReadPosByTime(LogFileOperator& op) {
+    if (mTimeFormat.empty() || mReadFromTime <= 0) {
+        LOG_WARNING(sLogger,
+                    ("time format or read from time is empty", "cannot set read pos by time")("file", mLogPath));
+        return false;
+    }
+    auto read = [this, &op](char* buf, size_t size, int64_t offset) { return ReadFile(op, buf, size, offset); };
+    const int64_t pos
+        = FileTimeIndexCache::GetInstance()->Seek(mDevInode, mTimeFormat, read, op.GetFileSize(), mReadFromTime);
+    if (pos < 0) {
+        LOG_WARNING(sLogger, ("failed to parse time", "cannot set read pos by time")("file", mLogPath));
+        return false;
     }
-    return -1;
+    mLastFilePos = pos;
+    mLastReadPos = pos;
+    return true;
 }
 
 bool LogFileReader::CheckForFirstOpen(FileReadPolicy policy) {
@@ -742,6 +875,10 @@ bool LogFileReader::CheckForFirstOpen(FileReadPolicy policy) {
             // fallback
             SetFilePosBackwardToFixedPos(op);
         }
+    } else if (policy == BACKWARD_TO_TIME) {
+        if (!SetReadPosByTime(op)) {
+            SetFilePosBackwardToFixedPos(op);
+        }
     } else if (policy == BACKWARD_TO_BEGINNING) {
         mLastFilePos = 0;
         mLastReadPos = 0;
@@ -779,7 +916,8 @@ void LogFileReader::FixLastFilePos(LogFileOperator& op, int64_t endOffset) {
     }
     for (size_t i = 0; i < readSizeReal - 1; ++i) {
         if (readBuf[i] == '\n') {
-            if (mLogBeginRegPtr == NULL) {
+            // Lines of the file are records to unwrap rather than logs if prefix fields are added, start at a record.
+            if (!mLogBeginRegPtr || mLinePrefixFields > 0) {
                 mLastFilePos += i + 1;
                 mLastReadPos = mLastFilePos;
                 free(readBuf);
@@ -790,9 +928,9 @@ void LogFileReader::FixLastFilePos(LogFileOperator& op, int64_t endOffset) {
         }
     }
     string exception;
-    if (mLogBeginRegPtr != NULL) {
+    if (mLogBeginRegPtr) {
         for (size_t i = 0; i < readSizeReal - 1; ++i) {
-            if (readBuf[i] == '\0' && BoostRegexMatch(readBuf + i + 1, *mLogBeginRegPtr, exception)) {
+            if (readBuf[i] == '\0' && IsLogBeginLine(readBuf + i + 1, exception)) {
                 mLastFilePos += i + 1;
                 mLastReadPos = mLastFilePos;
                 free(readBuf);
@@ -971,8 +1109,9 @@ bool LogFileReader::ReadLog(LogBuffer*& logBuffer) {
         }
         return false;
     }
-    if (AppConfig::GetInstance()->IsInputFlowControl())
+    if (AppConfig::GetInstance()->IsInputFlowControl() || LogtailMonitor::Instance()->GetDegradeLevel() > 0)
         LogInput::GetInstance()->FlowControl();
+    StageProfileScope profileScope(mConfigName, PROFILE_STAGE_READ);
 
     if (mFirstWatched && (mLastFilePos == 0))
         CheckForFirstOpen();
@@ -984,14 +1123,20 @@ bool LogFileReader::ReadLog(LogBuffer*& logBuffer) {
             mEOOption->selectedCheckpoint.reset(new RangeCheckpoint);
             mEOOption->selectedCheckpoint->fbKey = mEOOption->fbKey;
         }
+        updatePrimaryCheckpointCommittedOffset();
     }
 
-    char* buffer = NULL;
+    LogBufferSlabPtr buffer;
     size_t size = 0;
     FileInfo* fileInfo = NULL;
     TruncateInfo* truncateInfo = NULL;
     auto const beginOffset = mLastFilePos;
-    bool moreData = GetRawData(buffer, &size, mLastFileSize, fileInfo, truncateInfo);
+    // Lines checked by last read are only valid if this read starts where they were rolled back.
+    const int32_t checkedLinesSize = mCheckedLinesOffset == beginOffset ? mCheckedLinesSize : 0;
+    mCheckedLinesSize = 0;
+    const int64_t readEndPos = mReadEndPos > 0 ? std::min(mReadEndPos, mLastFileSize) : mLastFileSize;
+    bool moreData = GetRawData(buffer, &size, readEndPos, fileInfo, truncateInfo);
+    GloablFileDescriptorManager::GetInstance()->OnFileRead(this);
     if (size > 0) {
         FileInfoPtr fileInfoPtr(fileInfo);
         TruncateInfoPtr truncateInfoPtr(truncateInfo);
@@ -1005,14 +1150,13 @@ bool LogFileReader::ReadLog(LogBuffer*& logBuffer) {
             logBuffer->beginOffset = logBuffer->exactlyOnceCheckpoint->data.read_offset();
         } else {
             logBuffer->beginOffset = beginOffset;
+            if (truncateInfo == NULL && mFileEncoding == ENCODING_UTF8) {
+                logBuffer->checkedLinesSize = std::min(static_cast<int32_t>(size), checkedLinesSize);
+            }
         }
     } else {
         // if size == 0 and pointers below is not NULL(memory allocated in GetRawData),
-        // then we should delete pointers in case of memory leak
-        if (buffer != NULL) {
-            delete[] buffer;
-        }
-
+        // then we should delete pointers in case of memory leak, buffer is released by its slab handle.
         if (fileInfo != NULL) {
             delete fileInfo;
         }
@@ -1023,6 +1167,7 @@ bool LogFileReader::ReadLog(LogBuffer*& logBuffer) {
     LOG_DEBUG(sLogger,
               ("read log file", mRealLogPath)("last file pos", mLastFilePos)("last file size",
                                                                              mLastFileSize)("read size", size));
+    PublishCheckPoint();
     return moreData;
 }
 
@@ -1101,8 +1246,12 @@ bool LogFileReader::UpdateFilePtr() {
             if (mLogFileOp.IsOpen() == false) {
                 OnOpenFileError();
                 LOG_WARNING(sLogger, ("LogFileReader open real log file failed", mRealLogPath));
+                if (OpenCompressedRotatedFile()) {
+                    return true;
+                }
             } else if (CheckDevInode()) {
                 GloablFileDescriptorManager::GetInstance()->OnFileOpen(this);
+                mLastSignatureCheckTime = 0;
                 LOG_INFO(sLogger,
                          ("open file succeeded, project", mProjectName)("logstore", mCategory)("config", mConfigName)(
                              "log reader queue name", mLogPath)("file device", ToString(mDevInode.dev))(
@@ -1137,6 +1286,7 @@ bool LogFileReader::UpdateFilePtr() {
             // the mLogPath's dev inode equal to mDevInode, so real log path is mLogPath
             mRealLogPath = mLogPath;
             GloablFileDescriptorManager::GetInstance()->OnFileOpen(this);
+            mLastSignatureCheckTime = 0;
             LOG_INFO(sLogger,
                      ("open file succeeded, project", mProjectName)("logstore", mCategory)("config", mConfigName)(
                          "log reader queue name", mLogPath)("file device", ToString(mDevInode.dev))(
@@ -1153,6 +1303,50 @@ bool LogFileReader::UpdateFilePtr() {
     return true;
 }
 
+bool LogFileReader::OpenCompressedRotatedFile() {
+    if (!BOOL_FLAG(enable_compressed_rotated_file_read) || mIsFuseMode || mRealLogPath.empty()
+        || mRealLogPath == mLogPath) {
+        return false;
+    }
+    if (!mCompressedLogPath.empty()) {
+        return OpenCompressedFile(mCompressedLogPath);
+    }
+    for (const auto& suffix : SplitString(STRING_FLAG(compressed_rotated_file_suffixes), ",")) {
+        if (OpenCompressedFile(mRealLogPath + suffix)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LogFileReader::OpenCompressedFile(const std::string& path) {
+    if (mLastFileSignatureSize == 0 || mLogFileOp.Open(path.c_str(), mIsFuseMode) < 0) {
+        return false;
+    }
+    if (!mLogFileOp.EnableDecompression()) {
+        mLogFileOp.Close();
+        return false;
+    }
+    // Signature and offset are both of the uncompressed content, so the archive must hold the same file.
+    char head[1025];
+    const int nbytes = mLogFileOp.Pread(head, 1, std::min<uint32_t>(mLastFileSignatureSize, 1024), 0);
+    uint64_t sigHash = mLastFileSignatureHash;
+    uint32_t sigSize = mLastFileSignatureSize;
+    const int64_t size = nbytes > 0 ? mLogFileOp.GetFileSize() : -1;
+    if (nbytes <= 0 || !CheckAndUpdateSignature(string(head, nbytes), sigHash, sigSize) || size < mLastFilePos) {
+        mLogFileOp.Close();
+        return false;
+    }
+    mCompressedLogPath = path;
+    GloablFileDescriptorManager::GetInstance()->OnFileOpen(this);
+    mLastSignatureCheckTime = 0;
+    LOG_INFO(sLogger,
+             ("open compressed rotated file succeeded, project", mProjectName)("logstore", mCategory)(
+                 "config", mConfigName)("log reader queue name", mLogPath)("real file path", mRealLogPath)(
+                 "compressed file path", path)("uncompressed size", size)("last file position", mLastFilePos));
+    return true;
+}
+
 bool LogFileReader::CloseTimeoutFilePtr(int32_t curTime) {
     int32_t timeOut = (int32_t)(mCloseUnusedInterval / 100.f * (100 + rand() % 50));
     if (mLogFileOp.IsOpen() && curTime - mLastUpdateTime > timeOut) {
@@ -1160,7 +1354,8 @@ bool LogFileReader::CloseTimeoutFilePtr(int32_t curTime) {
         if (mLogFileOp.Stat(buf) != 0) {
             return false;
         }
-        if ((int64_t)buf.GetFileSize() == mLastFilePos) {
+        const int64_t size = mLogFileOp.IsDecompressing() ? mLogFileOp.GetFileSize() : (int64_t)buf.GetFileSize();
+        if (size == mLastFilePos) {
             LOG_INFO(sLogger,
                      ("close the file", "current log file has not been updated for some time and has been read")(
                          "project", mProjectName)("logstore", mCategory)("config", mConfigName)(
@@ -1177,11 +1372,14 @@ bool LogFileReader::CloseTimeoutFilePtr(int32_t curTime) {
 }
 
 void LogFileReader::CloseFilePtr() {
+    // The fd of a tail read might be reused by other files once closed.
+    mTailReadPending = false;
     if (mLogFileOp.IsOpen()) {
         LOG_DEBUG(sLogger, ("start close LogFileReader", mLogPath));
 
         // if mLogPath is symbolic link, then we should not update it accrding to /dev/fd/xx
-        if (!mSymbolicLinkFlag) {
+        // and the path of a compressed rotated file is kept in mCompressedLogPath.
+        if (!mSymbolicLinkFlag && !mLogFileOp.IsDecompressing()) {
             // retrieve file path from file descriptor in order to open it later
             // this is important when file is moved when rotating
             string curRealLogPath = mLogFileOp.GetFilePath();
@@ -1216,6 +1414,7 @@ void LogFileReader::CloseFilePtr() {
         }
         // always call OnFileClose
         GloablFileDescriptorManager::GetInstance()->OnFileClose(this);
+        PublishCheckPoint();
     }
 }
 
@@ -1224,6 +1423,9 @@ uint64_t LogFileReader::GetLogstoreKey() const {
 }
 
 bool LogFileReader::CheckDevInode() {
+    if (mLogFileOp.IsDecompressing()) {
+        return true;
+    }
     fsutil::PathStat statBuf;
     if (mLogFileOp.Stat(statBuf) != 0) {
         if (errno == ENOENT) {
@@ -1239,8 +1441,29 @@ bool LogFileReader::CheckDevInode() {
     }
 }
 
+bool LogFileReader::IsSignatureCacheValid(int64_t fileSize, int32_t curTime) const {
+    if (INT32_FLAG(signature_recheck_interval) <= 0 || mLastSignatureCheckTime <= 0
+        || curTime - mLastSignatureCheckTime >= INT32_FLAG(signature_recheck_interval)) {
+        return false;
+    }
+    // A shrunk file may be truncated and rewritten, and a signature shorter than 1024 bytes grows with the file.
+    if (fileSize < mLastFileSize || fileSize < mLastFilePos) {
+        return false;
+    }
+    return mLastFileSignatureSize >= 1024 || fileSize == mLastFileSize;
+}
+
 bool LogFileReader::CheckFileSignatureAndOffset(int64_t& fileSize) {
     mLastEventTime = time(NULL);
+    if (INT32_FLAG(signature_recheck_interval) > 0) {
+        // The fd is opened on the same dev inode, only size decides whether to read the header again.
+        const int64_t curSize = mLogFileOp.GetFileSize();
+        if (curSize >= 0 && IsSignatureCacheValid(curSize, mLastEventTime)) {
+            fileSize = curSize;
+            mLastFileSize = curSize;
+            return true;
+        }
+    }
     char firstLine[1025];
     int nbytes = mLogFileOp.Pread(firstLine, 1, 1024, 0);
     if (nbytes < 0) {
@@ -1272,6 +1495,7 @@ bool LogFileReader::CheckFileSignatureAndOffset(int64_t& fileSize) {
     fileSize = endSize;
     mLastFileSize = endSize;
     bool sigCheckRst = CheckAndUpdateSignature(string(firstLine), mLastFileSignatureHash, mLastFileSignatureSize);
+    mLastSignatureCheckTime = sigCheckRst ? mLastEventTime : 0;
     if (!sigCheckRst) {
         LOG_INFO(sLogger, ("Check file truncate by signature, read from begin", mLogPath));
         mLastFilePos = 0;
@@ -1337,44 +1561,61 @@ void LogFileReader::SetReadBufferSize(int32_t bufSize) {
     BUFFER_SIZE = bufSize;
 }
 
-vector<int32_t> LogFileReader::LogSplit(char* buffer, int32_t size, int32_t& lineFeed) {
+vector<int32_t> LogFileReader::LogSplit(char* buffer, int32_t size, int32_t& lineFeed, int32_t checkedSize) {
     vector<int32_t> index;
+    if (!mLogBeginRegPtr) {
+        // Fast path for single line log: every line feed is a log boundary, so collect
+        // all of them in bulk and convert them to begin offsets of logs.
+        index.push_back(0);
+        lineFeed = static_cast<int32_t>(FindAllLineFeeds(buffer, size, index)) + 1;
+        for (size_t i = 1; i < index.size(); ++i) {
+            buffer[index[i]] = '\0';
+            ++index[i];
+        }
+        return index;
+    }
+
     int begIndex = 0;
     int endIndex = 0;
     lineFeed = 0;
     string exception;
-    while (endIndex < size) {
-        if (buffer[endIndex] == '\n') {
-            lineFeed++;
-            buffer[endIndex] = '\0';
-            exception.clear();
-            if (mLogBeginRegPtr == NULL || BoostRegexMatch(buffer + begIndex, *mLogBeginRegPtr, exception)) {
-                index.push_back(begIndex);
-                if (begIndex > 0) {
-                    buffer[begIndex - 1] = '\0';
-                }
-            } else if (!exception.empty()) {
-                if (AppConfig::GetInstance()->IsLogParseAlarmValid()) {
-                    if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
-                        LOG_ERROR(sLogger,
-                                  ("regex_match in LogSplit fail, exception",
-                                   exception)("project", mProjectName)("logstore", mCategory)("file", mLogPath));
-                    }
-                    LogtailAlarm::GetInstance()->SendAlarm(REGEX_MATCH_ALARM,
-                                                           "regex_match in LogSplit fail:" + exception,
-                                                           mProjectName,
-                                                           mCategory,
-                                                           mRegion);
+    const char* bufferEnd = buffer + size;
+    for (const char* lf = FindLineFeed(buffer, bufferEnd); lf != bufferEnd; lf = FindLineFeed(lf + 1, bufferEnd)) {
+        endIndex = static_cast<int>(lf - buffer);
+        lineFeed++;
+        if (begIndex > 0 && begIndex < checkedSize) {
+            begIndex = endIndex + 1;
+            continue;
+        }
+        buffer[endIndex] = '\0';
+        exception.clear();
+        if (IsLogBeginLine(buffer + begIndex, exception)) {
+            index.push_back(begIndex);
+            if (begIndex > 0) {
+                buffer[begIndex - 1] = '\0';
+            }
+        } else if (!exception.empty()) {
+            if (AppConfig::GetInstance()->IsLogParseAlarmValid()) {
+                if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
+                    LOG_ERROR(sLogger,
+                              ("regex_match in LogSplit fail, exception",
+                               exception)("project", mProjectName)("logstore", mCategory)("file", mLogPath));
                 }
+                LogtailAlarm::GetInstance()->CountAlarm(
+                    REGEX_MATCH_ALARM, mProjectName, mCategory, mRegion, [&exception]() {
+                        return "regex_match in LogSplit fail:" + exception;
+                    });
             }
-            buffer[endIndex] = '\n';
-            begIndex = endIndex + 1;
         }
-        endIndex++;
+        buffer[endIndex] = '\n';
+        begIndex = endIndex + 1;
     }
     lineFeed++;
     exception.clear();
-    if (mLogBeginRegPtr == NULL || BoostRegexMatch(buffer + begIndex, *mLogBeginRegPtr, exception)) {
+    if (begIndex > 0 && begIndex < checkedSize) {
+        return index;
+    }
+    if (IsLogBeginLine(buffer + begIndex, exception)) {
         // the last second log should be terminated
         if (begIndex > 0) {
             buffer[begIndex - 1] = '\0';
@@ -1388,8 +1629,10 @@ vector<int32_t> LogFileReader::LogSplit(char* buffer, int32_t size, int32_t& lin
                           ("regex_match in LogSplit fail, exception",
                            exception)("project", mProjectName)("logstore", mCategory)("file", mLogPath));
             }
-            LogtailAlarm::GetInstance()->SendAlarm(
-                REGEX_MATCH_ALARM, "regex_match in LogSplit fail:" + exception, mProjectName, mCategory, mRegion);
+            LogtailAlarm::GetInstance()->CountAlarm(
+                REGEX_MATCH_ALARM, mProjectName, mCategory, mRegion, [&exception]() {
+                    return "regex_match in LogSplit fail:" + exception;
+                });
         }
     }
     return index;
@@ -1411,15 +1654,15 @@ bool LogFileReader::ParseLogTime(const char* buffer,
             // convert log time
             struct tm t;
             memset(&t, 0, sizeof(t));
-            if (strptime(timeStr.c_str(), timeFormat.c_str(), &t) == NULL) {
+            if (FastStrptime(timeStr.c_str(), timeFormat.c_str(), &t) == NULL
+                && strptime(timeStr.c_str(), timeFormat.c_str(), &t) == NULL) {
                 LOG_ERROR(sLogger,
                           ("convert time failed, time str", timeStr)("time format", timeFormat)("project", project)(
                               "logstore", logStore)("file", logPath));
                 return false;
             }
 
-            t.tm_isdst = -1;
-            logTime = mktime(&t);
+            logTime = MakeLocalTime(t);
             return true;
         }
     }
@@ -1429,8 +1672,9 @@ bool LogFileReader::ParseLogTime(const char* buffer,
                       ("parse regex log fail, exception",
                        exception)("buffer", buffer)("project", project)("logstore", logStore)("file", logPath));
         }
-        LogtailAlarm::GetInstance()->SendAlarm(
-            REGEX_MATCH_ALARM, "parse regex log fail:" + exception, project, logStore, region);
+        LogtailAlarm::GetInstance()->CountAlarm(REGEX_MATCH_ALARM, project, logStore, region, [&exception]() {
+            return "parse regex log fail:" + exception;
+        });
     }
     return false;
 }
@@ -1445,20 +1689,21 @@ bool LogFileReader::GetLogTimeByOffset(const char* buffer,
                                        const std::string& logPath) {
     struct tm t;
     memset(&t, 0, sizeof(t));
-    if (strptime(buffer + pos, timeFormat.c_str(), &t) == NULL) {
+    if (FastStrptime(buffer + pos, timeFormat.c_str(), &t) == NULL
+        && strptime(buffer + pos, timeFormat.c_str(), &t) == NULL) {
         if (AppConfig::GetInstance()->IsLogParseAlarmValid()) {
             if (LogtailAlarm::GetInstance()->IsLowLevelAlarmValid()) {
                 LOG_WARNING(sLogger,
                             ("get time by offset fail, region", region)("project", project)("logstore",
                                                                                             logStore)("file", logPath));
             }
-            LogtailAlarm::GetInstance()->SendAlarm(
-                PARSE_TIME_FAIL_ALARM, "errorlog:" + string(buffer), project, logStore, region);
+            LogtailAlarm::GetInstance()->CountAlarm(PARSE_TIME_FAIL_ALARM, project, logStore, region, [buffer]() {
+                return "errorlog:" + string(buffer);
+            });
         }
         return false;
     }
-    t.tm_isdst = -1;
-    logTime = mktime(&t);
+    logTime = MakeLocalTime(t);
     return true;
 }
 
@@ -1493,7 +1738,7 @@ bool LogFileReader::GetLogTimeByOffset(const char* buffer,
  * "SingleLineLog_1\nSingleLineLog_2\nxxx" -> "SingleLineLog_1\nSingleLineLog_2\0"
  */
 bool LogFileReader::GetRawData(
-    char*& bufferptr, size_t* size, int64_t fileSize, FileInfo*& fileInfo, TruncateInfo*& truncateInfo) {
+    LogBufferSlabPtr& buffer, size_t* size, int64_t fileSize, FileInfo*& fileInfo, TruncateInfo*& truncateInfo) {
     *size = 0;
 
     // Truncate, return false to indicate no more data.
@@ -1503,9 +1748,10 @@ bool LogFileReader::GetRawData(
 
     bool moreData = false;
     if (mFileEncoding == ENCODING_GBK)
-        ReadGBK(bufferptr, size, fileSize, moreData, truncateInfo);
+        ReadGBK(buffer, size, fileSize, moreData, truncateInfo);
     else
-        ReadUTF8(bufferptr, size, fileSize, moreData, truncateInfo);
+        ReadUTF8(buffer, size, fileSize, moreData, truncateInfo);
+    const char* bufferptr = buffer.get();
 
     int64_t delta = fileSize - mLastFilePos;
     if (delta > mReadDelayAlarmBytes && bufferptr != NULL) {
@@ -1580,8 +1826,28 @@ bool LogFileReader::GetRawData(
     return moreData;
 }
 
-size_t LogFileReader::getNextReadSize(int64_t fileEnd, bool& fromCpt) {
+size_t LogFileReader::getReadSizeLimit(int64_t backlog) {
+    if (!BOOL_FLAG(adaptive_read_size_enable)) {
+        return BUFFER_SIZE;
+    }
+    const size_t maxLimit = std::max(BUFFER_SIZE, static_cast<size_t>(std::max(INT32_FLAG(adaptive_read_max_size), 0)));
+    size_t limit = std::max(mAdaptiveReadLimit, BUFFER_SIZE);
+    if (backlog > static_cast<int64_t>(limit)) {
+        limit = std::min(limit * 2, maxLimit);
+    } else if (backlog < static_cast<int64_t>(limit / 4)) {
+        limit = std::max(limit / 2, BUFFER_SIZE);
+    }
+    mAdaptiveReadLimit = limit;
+    const size_t budget = static_cast<size_t>(std::max(INT64_FLAG(read_buffer_budget_bytes), (int64_t)0));
+    if (limit > BUFFER_SIZE && LogBufferPool::GetInstance()->GetInUseBytes() + limit > budget) {
+        return BUFFER_SIZE;
+    }
+    return limit;
+}
+
+size_t LogFileReader::getNextReadSize(int64_t fileEnd, bool& fromCpt, size_t& readLimit) {
     size_t readSize = static_cast<size_t>(fileEnd - mLastFilePos);
+    readLimit = getReadSizeLimit(static_cast<int64_t>(readSize));
     bool allowMoreBufferSize = false;
     fromCpt = false;
     if (mEOOption && mEOOption->selectedCheckpoint->IsComplete()) {
@@ -1591,12 +1857,40 @@ size_t LogFileReader::getNextReadSize(int64_t fileEnd, bool& fromCpt) {
         readSize = checkpoint.read_length();
         LOG_INFO(sLogger, ("read specified length", readSize)("offset", mLastFilePos));
     }
-    if (readSize > BUFFER_SIZE && !allowMoreBufferSize) {
-        readSize = BUFFER_SIZE;
+    if (readSize > readLimit && !allowMoreBufferSize) {
+        readSize = readLimit;
+        // Catching up, let the kernel read the next ones ahead while this one is processed.
+        int64_t offset = 0, length = 0;
+        if (getReadAheadRange(mLastFilePos + readSize, fileEnd, readLimit, offset, length)) {
+            mLogFileOp.WillNeed(offset, length);
+        }
     }
     return readSize;
 }
 
+bool LogFileReader::getReadAheadRange(
+    int64_t readEnd, int64_t fileEnd, size_t readLimit, int64_t& offset, int64_t& length) {
+    int64_t window = std::max(INT32_FLAG(read_ahead_max_bytes), 0);
+    if (readLimit > BUFFER_SIZE) {
+        window = std::max(window, static_cast<int64_t>(readLimit));
+    }
+    if (window == 0 || readEnd >= fileEnd) {
+        return false;
+    }
+    // The file is truncated or read from another position.
+    if (mReadAheadEnd < readEnd || mReadAheadEnd > fileEnd) {
+        mReadAheadEnd = readEnd;
+    }
+    const int64_t target = std::min(fileEnd, readEnd + window);
+    if (mReadAheadEnd >= target || mReadAheadEnd - readEnd >= window / 2) {
+        return false;
+    }
+    offset = mReadAheadEnd;
+    length = target - mReadAheadEnd;
+    mReadAheadEnd = target;
+    return true;
+}
+
 void LogFileReader::setExactlyOnceCheckpointAfterRead(size_t readSize) {
     if (!mEOOption || readSize == 0) {
         return;
@@ -1607,15 +1901,18 @@ void LogFileReader::setExactlyOnceCheckpointAfterRead(size_t readSize) {
     cpt.set_read_length(readSize);
 }
 
-void LogFileReader::ReadUTF8(char*& bufferptr, size_t* size, int64_t end, bool& moreData, TruncateInfo*& truncateInfo) {
+void LogFileReader::ReadUTF8(
+    LogBufferSlabPtr& buffer, size_t* size, int64_t end, bool& moreData, TruncateInfo*& truncateInfo) {
     bool fromCpt = false;
-    size_t READ_BYTE = getNextReadSize(end, fromCpt);
-    bufferptr = new char[READ_BYTE + 1];
+    size_t readLimit = 0;
+    size_t READ_BYTE = getNextReadSize(end, fromCpt, readLimit);
+    buffer = LogBufferPool::GetInstance()->Acquire(READ_BYTE + 1);
+    char* bufferptr = buffer.get();
     bufferptr[READ_BYTE] = '\0';
     size_t nbytes = ReadFile(mLogFileOp, bufferptr, READ_BYTE, mLastFilePos, &truncateInfo);
     mLastReadPos = mLastFilePos + nbytes;
-    LOG_DEBUG(sLogger, ("read bytes", nbytes)("last read pos", mLastReadPos));
-    moreData = (nbytes == BUFFER_SIZE);
+    LOG_HOT_DEBUG("read bytes:{}\tlast read pos:{}", nbytes, mLastReadPos);
+    moreData = (nbytes == readLimit);
     bool adjustFlag = false;
     while (nbytes > 0 && bufferptr[nbytes - 1] != '\n') {
         nbytes--;
@@ -1623,7 +1920,12 @@ void LogFileReader::ReadUTF8(char*& bufferptr, size_t* size, int64_t end, bool&
     }
     if ((nbytes > 0 && (adjustFlag || moreData) && mLogBeginRegPtr) || mLogType == JSON_LOG) {
         int32_t rollbackLineFeedCount;
+        size_t scannedBytes = nbytes;
         nbytes = LastMatchedLine(bufferptr, nbytes, rollbackLineFeedCount);
+        if (nbytes > 0 && mLogType != JSON_LOG) {
+            mCheckedLinesOffset = mLastFilePos + nbytes;
+            mCheckedLinesSize = static_cast<int32_t>(scannedBytes - nbytes);
+        }
     }
 
     if (moreData && nbytes == 0) {
@@ -1641,17 +1943,20 @@ void LogFileReader::ReadUTF8(char*& bufferptr, size_t* size, int64_t end, bool&
     setExactlyOnceCheckpointAfterRead(*size);
     mLastFilePos += nbytes;
 
-    LOG_DEBUG(sLogger, ("read size", *size)("last file pos", mLastFilePos));
+    LOG_HOT_DEBUG("read size:{}\tlast file pos:{}", *size, mLastFilePos);
 }
 
-void LogFileReader::ReadGBK(char*& bufferptr, size_t* size, int64_t end, bool& moreData, TruncateInfo*& truncateInfo) {
+void LogFileReader::ReadGBK(
+    LogBufferSlabPtr& buffer, size_t* size, int64_t end, bool& moreData, TruncateInfo*& truncateInfo) {
     bool fromCpt = false;
-    size_t READ_BYTE = getNextReadSize(end, fromCpt);
-    char* gbkBuffer = new char[READ_BYTE + 1];
+    size_t readLimit = 0;
+    size_t READ_BYTE = getNextReadSize(end, fromCpt, readLimit);
+    LogBufferSlabPtr gbkSlab = LogBufferPool::GetInstance()->Acquire(READ_BYTE + 1);
+    char* gbkBuffer = gbkSlab.get();
     size_t readCharCount = ReadFile(mLogFileOp, gbkBuffer, READ_BYTE, mLastFilePos, &truncateInfo);
     mLastReadPos = mLastFilePos + readCharCount;
     size_t originReadCount = readCharCount;
-    moreData = (readCharCount == BUFFER_SIZE);
+    moreData = (readCharCount == readLimit);
     bool adjustFlag = false;
     while (readCharCount > 0 && gbkBuffer[readCharCount - 1] != '\n') {
         readCharCount--;
@@ -1662,7 +1967,6 @@ void LogFileReader::ReadGBK(char*& bufferptr, size_t* size, int64_t end, bool& m
         if (moreData)
             readCharCount = READ_BYTE;
         else {
-            delete[] gbkBuffer;
             *size = 0;
             return;
         }
@@ -1676,13 +1980,31 @@ void LogFileReader::ReadGBK(char*& bufferptr, size_t* size, int64_t end, bool& m
     }
     lineFeedPos.push_back(readCharCount - 1);
 
-    size_t srcLength = readCharCount;
-    size_t desLength = 0;
-    bufferptr = NULL;
-    EncodingConverter::GetInstance()->ConvertGbk2Utf8(gbkBuffer, &srcLength, bufferptr, &desLength, lineFeedPos);
-    size_t resultCharCount = desLength;
+    size_t resultCharCount = 0;
+    char* bufferptr = NULL;
+    if (BOOL_FLAG(gbk_convert_by_table_enable)) {
+        if (EncodingConverter::IsAscii(gbkBuffer, readCharCount)) {
+            // ASCII is the same in GBK and UTF-8, use the read buffer as result, as well as lineFeedPos.
+            buffer = gbkSlab;
+            resultCharCount = readCharCount;
+        } else {
+            buffer = LogBufferPool::GetInstance()->Acquire(readCharCount * 2 + 1);
+            resultCharCount = EncodingConverter::GetInstance()->ConvertGbk2Utf8ByTable(
+                gbkBuffer, readCharCount, buffer.get(), lineFeedPos);
+        }
+        bufferptr = buffer.get();
+    } else {
+        size_t srcLength = readCharCount;
+        size_t desLength = 0;
+        EncodingConverter::GetInstance()->ConvertGbk2Utf8(gbkBuffer, &srcLength, bufferptr, &desLength, lineFeedPos);
+        resultCharCount = desLength;
+        // Output of converter is not pooled, wrap it so that LogBuffer can release it in the same way.
+        if (bufferptr != NULL) {
+            buffer.reset(bufferptr, std::default_delete<char[]>());
+        }
+    }
 
-    delete[] gbkBuffer;
+    gbkSlab.reset();
     if (resultCharCount == 0) {
         *size = 0;
         mLastFilePos += readCharCount;
@@ -1709,8 +2031,29 @@ void LogFileReader::ReadGBK(char*& bufferptr, size_t* size, int64_t end, bool& m
     *size = resultCharCount;
     setExactlyOnceCheckpointAfterRead(*size);
     mLastFilePos += readCharCount;
-    LOG_DEBUG(sLogger,
-              ("read gbk buffer, offset", mLastFilePos)("origin read", originReadCount)("at last read", readCharCount));
+    LOG_HOT_DEBUG("read gbk buffer, offset:{}\torigin read:{}\tat last read:{}",
+                  mLastFilePos,
+                  originReadCount,
+                  readCharCount);
+}
+
+BatchRead::Request* LogFileReader::PrepareTailRead() {
+    mTailReadPending = false;
+    const int32_t readSize = INT32_FLAG(batch_tail_read_size);
+    if (readSize <= 0 || mIsFuseMode || mEOOption || !mLogFileOp.IsBatchReadable()) {
+        return NULL;
+    }
+    mTailReadBuffer.resize(readSize);
+    mTailRead.fd = mLogFileOp.GetFd();
+#if defined(_MSC_VER)
+    mTailRead.handle = mLogFileOp.GetHandle();
+#endif
+    mTailRead.buffer = mTailReadBuffer.data();
+    mTailRead.size = mTailReadBuffer.size();
+    mTailRead.offset = mLastFilePos;
+    mTailRead.result = -1;
+    mTailReadPending = true;
+    return &mTailRead;
 }
 
 size_t
@@ -1720,6 +2063,18 @@ LogFileReader::ReadFile(LogFileOperator& op, void* buf, size_t size, int64_t& of
         return 0;
     }
 
+    // The tail read covers the range if it has all bytes to read, or all bytes to the file size checked after it.
+    if (mTailReadPending && &op == &mLogFileOp && offset == mTailRead.offset) {
+        mTailReadPending = false;
+        const int64_t tailSize = mTailRead.result;
+        if (tailSize >= 0 && (static_cast<int64_t>(size) <= tailSize || mLastFileSize <= offset + tailSize)) {
+            const size_t nbytes = std::min(size, static_cast<size_t>(tailSize));
+            memcpy(buf, mTailRead.buffer, nbytes);
+            *((char*)buf + nbytes) = '\0';
+            return nbytes;
+        }
+    }
+
     int nbytes = 0;
     if (mIsFuseMode) {
         int64_t oriOffset = offset;
@@ -1758,6 +2113,21 @@ LogFileReader::ReadFile(LogFileOperator& op, void* buf, size_t size, int64_t& of
 }
 
 LogFileReader::FileCompareResult LogFileReader::CompareToFile(const string& filePath) {
+    if (INT32_FLAG(signature_recheck_interval) > 0 && !mIsFuseMode && mLogFileOp.IsOpen()) {
+        // The file of the path is the one opened by this reader if dev inode is the same, so the cached
+        // signature can be used without opening the file and reading its header.
+        fsutil::PathStat pathStat;
+        if (fsutil::PathStat::stat(filePath, pathStat)) {
+            if (pathStat.GetDevInode() != mDevInode) {
+                return FileCompareResult_DevInodeChange;
+            }
+            const int64_t fileSize = static_cast<int64_t>(pathStat.GetFileSize());
+            if (IsSignatureCacheValid(fileSize, time(NULL))) {
+                return fileSize == mLastFilePos ? FileCompareResult_SigSameSizeSame
+                                                : FileCompareResult_SigSameSizeChange;
+            }
+        }
+    }
     LogFileOperator logFileOp;
     logFileOp.Open(filePath.c_str(), mIsFuseMode);
     if (logFileOp.IsOpen() == false) {
@@ -1795,33 +2165,31 @@ LogFileReader::FileCompareResult LogFileReader::CompareToFile(const string& file
 }
 
 int32_t LogFileReader::LastMatchedLine(char* buffer, int32_t size, int32_t& rollbackLineFeedCount) {
+    rollbackLineFeedCount = 0;
+    if (size < 2) {
+        return 0;
+    }
     int endPs = size - 1; // buffer[size] = 0 , buffer[size-1] = '\n'
-    int begPs = size - 2;
     string exception;
-    rollbackLineFeedCount = 0;
-    while (begPs >= 0) {
-        if (buffer[begPs] == '\n') {
-            rollbackLineFeedCount++;
-            char temp = buffer[endPs];
-            buffer[endPs] = '\0';
-            // ignore regex match fail, no need log here
-            if (BoostRegexMatch(buffer + begPs + 1, *mLogBeginRegPtr, exception)) {
-                buffer[begPs + 1] = '\0';
-                return begPs + 1;
-            }
-            buffer[endPs] = temp;
-            endPs = begPs;
-        }
-        begPs--;
+    // Line feeds are found backwards in vector blocks, the regex only runs at line starts.
+    for (const char* lf = FindLastLineFeed(buffer, buffer + endPs); lf != buffer + endPs;
+         lf = FindLastLineFeed(buffer, lf)) {
+        int begPs = static_cast<int>(lf - buffer);
+        rollbackLineFeedCount++;
+        char temp = buffer[endPs];
+        buffer[endPs] = '\0';
+        // ignore regex match fail, no need log here
+        if (IsLogBeginLine(buffer + begPs + 1, exception)) {
+            buffer[begPs + 1] = '\0';
+            return begPs + 1;
+        }
+        buffer[endPs] = temp;
+        endPs = begPs;
     }
     return 0;
 }
 
 LogFileReader::~LogFileReader() {
-    if (mLogBeginRegPtr != NULL) {
-        delete mLogBeginRegPtr;
-        mLogBeginRegPtr = NULL;
-    }
     LOG_INFO(sLogger,
              ("try to close the file and destruct the corresponding log reader, project",
               mProjectName)("logstore", mCategory)("config", mConfigName)("log reader queue name", mLogPath)(
@@ -1885,11 +2253,26 @@ void CommonRegLogFileReader::SetTimeKey(const std::string& timeKey) {
     }
 }
 
-bool CommonRegLogFileReader::AddUserDefinedFormat(const string& regStr, const string& keys) {
+bool CommonRegLogFileReader::AddUserDefinedFormat(const string& regStr, const string& keys, bool useRe2) {
     vector<string> keyParts = StringSpliter(keys, ",");
-    boost::regex reg(regStr);
+    RegexPtr reg = RegexCache::GetInstance()->Get(regStr);
     bool isWholeLineMode = regStr == "(.*)";
-    mUserDefinedFormat.push_back(UserDefinedFormat(reg, keyParts, isWholeLineMode));
+    std::shared_ptr<re2::RE2> re2Reg;
+    if (useRe2 && !isWholeLineMode) {
+        // Keep the semantics of boost perl syntax, '.' matches '\n' in multiline logs.
+        re2::RE2::Options options;
+        options.set_dot_nl(true);
+        options.set_log_errors(false);
+        re2Reg.reset(new re2::RE2(regStr, options));
+        if (!re2Reg->ok()) {
+            LOG_WARNING(sLogger,
+                        ("regex is not supported by re2, use boost instead", regStr)("error", re2Reg->error())(
+                            "project", mProjectName)("logstore", mCategory));
+            re2Reg.reset();
+        }
+    }
+    mUserDefinedFormat.push_back(UserDefinedFormat(reg, keyParts, isWholeLineMode, re2Reg));
+    UpdateKeptKeys(mUserDefinedFormat.back());
     int32_t index = -1;
     for (size_t i = 0; i < keyParts.size(); i++) {
         if (ToLowerCaseString(keyParts[i]) == mTimeKey) {
@@ -1901,6 +2284,75 @@ bool CommonRegLogFileReader::AddUserDefinedFormat(const string& regStr, const st
     return true;
 }
 
+void CommonRegLogFileReader::SetKeptKeys(const std::vector<std::string>& keys) {
+    LogFileReader::SetKeptKeys(keys);
+    for (auto& format : mUserDefinedFormat) {
+        UpdateKeptKeys(format);
+    }
+}
+
+void CommonRegLogFileReader::UpdateKeptKeys(UserDefinedFormat& format) const {
+    format.mKeptKeys.clear();
+    // The whole line is one capture, nothing to skip.
+    if (mKeptKeys.IsAll() || format.mIsWholeLineMode) {
+        return;
+    }
+    format.mKeptKeys.reserve(format.mKeys.size());
+    for (const auto& key : format.mKeys) {
+        format.mKeptKeys.push_back(mKeptKeys.Contains(key));
+    }
+}
+
+void LogFileReader::ParseLogLines(const char* buffer,
+                                  const int32_t* offsets,
+                                  uint32_t count,
+                                  sls_logs::LogGroup& logGroup,
+                                  LogLineParseState& state,
+                                  uint32_t& logGroupSize,
+                                  LogLineParseResult* results) {
+    ParseLogLinesBy(
+        [this](const char* line,
+               sls_logs::LogGroup& group,
+               ParseLogError& error,
+               time_t& lastLogLineTime,
+               std::string& lastLogTimeStr,
+               uint32_t& size) {
+            return ParseLogLine(line, group, error, lastLogLineTime, lastLogTimeStr, size);
+        },
+        buffer,
+        offsets,
+        count,
+        logGroup,
+        state,
+        logGroupSize,
+        results);
+}
+
+void CommonRegLogFileReader::ParseLogLines(const char* buffer,
+                                           const int32_t* offsets,
+                                           uint32_t count,
+                                           sls_logs::LogGroup& logGroup,
+                                           LogLineParseState& state,
+                                           uint32_t& logGroupSize,
+                                           LogLineParseResult* results) {
+    ParseLogLinesBy(
+        [this](const char* line,
+               sls_logs::LogGroup& group,
+               ParseLogError& error,
+               time_t& lastLogLineTime,
+               std::string& lastLogTimeStr,
+               uint32_t& size) {
+            return CommonRegLogFileReader::ParseLogLine(line, group, error, lastLogLineTime, lastLogTimeStr, size);
+        },
+        buffer,
+        offsets,
+        count,
+        logGroup,
+        state,
+        logGroupSize,
+        results);
+}
+
 bool CommonRegLogFileReader::ParseLogLine(const char* buffer,
                                           LogGroup& logGroup,
                                           ParseLogError& error,
@@ -1917,7 +2369,7 @@ bool CommonRegLogFileReader::ParseLogLine(const char* buffer,
         bool res = true;
         if (mTimeIndex[i] >= 0 && !mTimeFormat.empty()) {
             res = LogParser::RegexLogLineParser(buffer,
-                                                format.mReg,
+                                                *format.mReg,
                                                 logGroup,
                                                 mDiscardUnmatch,
                                                 format.mKeys,
@@ -1933,7 +2385,9 @@ bool CommonRegLogFileReader::ParseLogLine(const char* buffer,
                                                 mLogPath,
                                                 error,
                                                 logGroupSize,
-                                                mTzOffsetSecond);
+                                                mTzOffsetSecond,
+                                                format.mRe2Reg.get(),
+                                                format.mKeptKeys.empty() ? NULL : &format.mKeptKeys);
         } else {
             // if "time" field not exist in user config or timeformat empty, set current system time for logs
             if (format.mIsWholeLineMode) {
@@ -1944,7 +2398,7 @@ bool CommonRegLogFileReader::ParseLogLine(const char* buffer,
                                                      logGroupSize);
             } else {
                 res = LogParser::RegexLogLineParser(buffer,
-                                                    format.mReg,
+                                                    *format.mReg,
                                                     logGroup,
                                                     mDiscardUnmatch,
                                                     format.mKeys,
@@ -1954,7 +2408,9 @@ bool CommonRegLogFileReader::ParseLogLine(const char* buffer,
                                                     mRegion,
                                                     mLogPath,
                                                     error,
-                                                    logGroupSize);
+                                                    logGroupSize,
+                                                    format.mRe2Reg.get(),
+                                                    format.mKeptKeys.empty() ? NULL : &format.mKeptKeys);
             }
         }
         if (res) {
@@ -2009,6 +2465,31 @@ ApsaraLogFileReader::ApsaraLogFileReader(const std::string& projectName,
     mFileEncoding = fileEncoding;
 }
 
+void ApsaraLogFileReader::ParseLogLines(const char* buffer,
+                                        const int32_t* offsets,
+                                        uint32_t count,
+                                        sls_logs::LogGroup& logGroup,
+                                        LogLineParseState& state,
+                                        uint32_t& logGroupSize,
+                                        LogLineParseResult* results) {
+    ParseLogLinesBy(
+        [this](const char* line,
+               sls_logs::LogGroup& group,
+               ParseLogError& error,
+               time_t& lastLogLineTime,
+               std::string& lastLogTimeStr,
+               uint32_t& size) {
+            return ApsaraLogFileReader::ParseLogLine(line, group, error, lastLogLineTime, lastLogTimeStr, size);
+        },
+        buffer,
+        offsets,
+        count,
+        logGroup,
+        state,
+        logGroupSize,
+        results);
+}
+
 bool ApsaraLogFileReader::ParseLogLine(const char* buffer,
                                        sls_logs::LogGroup& logGroup,
                                        ParseLogError& error,
@@ -15,33 +15,61 @@
  */
 
 #pragma once
+#include <string.h>
 #include <utility>
 #include <string>
 #include <vector>
 #include <unordered_set>
 #include <deque>
 #include <atomic>
+#include <memory>
 #include "parser/LogParser.h"
 #include "common/TimeUtil.h"
 #include "common/GlobalPara.h"
 #include "common/StringTools.h"
 #include "common/EncodingConverter.h"
 #include "common/DevInode.h"
+#include "common/Lock.h"
+#include "common/MemoryBudget.h"
 #include "common/LogFileOperator.h"
+#include "common/BatchRead.h"
+#include "common/TokenBucket.h"
+#include "common/KeyProjection.h"
 #include "log_pb/sls_logs.pb.h"
 #include "config/LogType.h"
 #include "common/FileInfo.h"
+#include "common/RegexCache.h"
+#include "common/RegexPrefixFilter.h"
 #include "checkpoint/RangeCheckpoint.h"
+#include "checkpoint/CheckPointSnapshot.h"
+#include "reader/LogBufferPool.h"
 
 namespace logtail {
 
 struct LogBuffer;
 class LogFileReader;
+class Config;
 class DevInode;
+struct LogFileProfilingEntry;
 
 typedef std::shared_ptr<LogFileReader> LogFileReaderPtr;
 typedef std::deque<LogFileReaderPtr> LogFileReaderPtrArray;
 
+// LogLineParseState is kept between lines parsed into the same log group.
+struct LogLineParseState {
+    ParseLogError mError = PARSE_LOG_REGEX_ERROR;
+    time_t mLastLogLineTime = 0;
+    std::string mLastLogTimeStr;
+};
+
+// LogLineParseResult is the result of one line parsed by ParseLogLines.
+struct LogLineParseResult {
+    bool mSuccess;
+    ParseLogError mError;
+    // Count of logs in the log group after the line is parsed.
+    int32_t mLogEnd;
+};
+
 class LogFileReader {
 public:
     enum FileCompareResult {
@@ -56,6 +84,8 @@ public:
         BACKWARD_TO_BEGINNING,
         BACKWARD_TO_BOOT_TIME,
         BACKWARD_TO_FIXED_POS,
+        // Start at the first line not before the time set by SetReadFromTime, see FileTimeIndex.
+        BACKWARD_TO_TIME,
     };
 
     // for ApsaraLogFileReader
@@ -86,15 +116,16 @@ public:
     }
     // this function should only be called once
     void SetLogBeginRegex(const std::string& reg) {
-        if (mLogBeginRegPtr != NULL) {
-            delete mLogBeginRegPtr;
-            mLogBeginRegPtr = NULL;
-        }
+        mLogBeginRegPtr.reset();
         if (reg.empty() == false && reg != ".*") {
-            mLogBeginRegPtr = new boost::regex(reg.c_str());
+            mLogBeginRegPtr = RegexCache::GetInstance()->Get(reg);
         }
     }
 
+    // Prefilter extracted from log begin regex by config, lines fail to pass it
+    // are treated as unmatched without running the regex.
+    void SetLogBeginRegexPrefilter(const RegexPrefixFilterPtr& prefilter) { mLogBeginRegPrefilter = prefilter; }
+
     std::string GetTopicName(const std::string& topicConfig, const std::string& path);
 
     void SetTopicName(const std::string& topic) { mTopicName = topic; }
@@ -111,7 +142,11 @@ public:
 
     std::string GetConfigName() const { return mConfigName; }
 
-    void SetConfigName(const std::string& configName) { mConfigName = configName; }
+    void SetConfigName(const std::string& configName) {
+        mConfigName = configName;
+        ScopedSpinLock lock(mCachedConfigLock);
+        mCachedConfig = NULL;
+    }
 
     std::string GetProjectName() const { return mProjectName; }
 
@@ -146,12 +181,38 @@ public:
             mFirstWatched = false;
         mLastFilePos = pos;
     }
+    // OnBufferSpilled and OnBufferRestored are called by ProcessQueueSpill when a buffer of this reader is
+    // moved to disk and back, the checkpoint offset stays at or before the first spilled buffer until all are
+    // restored, so spilled data is read again after restart.
+    void OnBufferSpilled(int64_t beginOffset) {
+        if (mSpilledBufferCount.fetch_add(1) == 0) {
+            mSpilledBeginOffset = beginOffset;
+        }
+    }
+    void OnBufferRestored() {
+        if (mSpilledBufferCount.fetch_sub(1) == 1) {
+            mSpilledBeginOffset = -1;
+        }
+    }
+    // GetCheckpointOffset returns the offset dumped to checkpoint.
+    int64_t GetCheckpointOffset() const {
+        const int64_t spilledOffset = mSpilledBeginOffset.load();
+        return spilledOffset >= 0 && spilledOffset < mLastFilePos ? spilledOffset : mLastFilePos;
+    }
+    // SetReadEndPos stops reading at @pos, 0 means reading to the end of file. @pos must be at a line
+    // boundary, it is used to read a range of a history file.
+    void SetReadEndPos(int64_t pos) { mReadEndPos = pos; }
     void
     InitReader(bool tailExisted = false, FileReadPolicy policy = BACKWARD_TO_FIXED_POS, uint32_t eoConcurrency = 0);
 
     void DumpMetaToMem(bool checkConfigFlag = false);
+    // PublishCheckPoint stores the current checkpoint of the reader into CheckPointSnapshotTable if it is
+    // changed, it is called after reads, closes and init. Only when check_point_snapshot_dump_enable is set.
+    void PublishCheckPoint();
 
-    std::string GetSourceId() { return mSourceId; }
+    const std::string& GetSourceId() const { return mSourceId; }
+    // GetSourceIdKey returns the hash of source id, it is a part of merge keys in aggregator.
+    uint64_t GetSourceIdKey() const { return mSourceIdKey; }
 
     bool IsFileDeleted() const { return mFileDeleted; }
 
@@ -167,8 +228,33 @@ public:
 
     bool IsFileOpened() const { return mLogFileOp.IsOpen(); }
 
+    // Set by GloablFileDescriptorManager when the fd is closed to keep opened fds under budget.
+    void SetFdEvicted(bool evicted) { mFdEvicted = evicted; }
+    bool IsFdEvicted() const { return mFdEvicted; }
+
+    // Read through a sliding mmap window, only for files which are not truncated while reading.
+    bool EnableMmapRead(size_t windowSize) { return mLogFileOp.EnableMmapRead(windowSize); }
+
     bool ShouldForceReleaseDeletedFileFd();
 
+    // IsRotated returns true if newer files of the same path are queued after this one.
+    bool IsRotated() const {
+        return mReaderArray != NULL && !mReaderArray->empty() && mReaderArray->back().get() != this;
+    }
+    // GetBytesAtRisk returns unread bytes of the file if it is deleted, rotated or of a stopped container, which
+    // may be lost once the fd is force released or the file is removed by rotation, else 0.
+    uint64_t GetBytesAtRisk() const {
+        if (!mFileDeleted && !mContainerStopped && !IsRotated()) {
+            return 0;
+        }
+        return mLastFileSize > mLastFilePos ? static_cast<uint64_t>(mLastFileSize - mLastFilePos) : 0;
+    }
+
+    // SetReadRateLimit limits bytes read per second of this file, <= 0 means unlimited. The budget is checked
+    // and charged by ModifyHandler, only while other events are waiting.
+    void SetReadRateLimit(int64_t bytesPerSecond) { mReadRateBucket.SetRate(bytesPerSecond); }
+    TokenBucket& GetReadRateBucket() { return mReadRateBucket; }
+
     void SetPluginFlag(bool flag) { mPluginFlag = flag; }
 
     bool GetPluginFlag() const { return mPluginFlag; }
@@ -180,10 +266,16 @@ public:
 
     bool CloseTimeoutFilePtr(int32_t curTime);
 
+    // CheckDevInode returns true for a compressed rotated file, its dev inode is not the one of the reader.
     bool CheckDevInode();
 
     bool CheckFileSignatureAndOffset(int64_t& fileSize);
 
+    // IsSignatureCacheValid returns true if the signature checked last time still holds for the file of @fileSize,
+    // so the header is not read again. It holds within signature_recheck_interval if the file has never shrunk
+    // and the signature can not grow any more.
+    bool IsSignatureCacheValid(int64_t fileSize, int32_t curTime) const;
+
     void UpdateLogPath(const std::string& filePath) {
         if (mLogPath == filePath) {
             return;
@@ -215,11 +307,19 @@ public:
     const std::string& GetRealLogPath() const { return mRealLogPath; }
 
     void SetTimeFormat(const std::string& timeFormat) { mTimeFormat = timeFormat; }
+    // SetReadFromTime sets the time to seek to for BACKWARD_TO_TIME, in unix seconds.
+    void SetReadFromTime(int32_t time) { mReadFromTime = time; }
 
     std::string GetTimeFormat() const { return mTimeFormat; }
 
     bool IsReadToEnd() const { return mLastReadPos == mLastFileSize; }
 
+    // PrepareTailRead returns a request to read batch_tail_read_size bytes at the read position, so the reads
+    // of many modified files can be submitted at once by BatchRead. The next read at the same position takes
+    // bytes from it instead of reading the file if they cover the range to read. NULL if it is disabled or the
+    // file can not be read in batch.
+    BatchRead::Request* PrepareTailRead();
+
     LogFileReaderPtrArray* GetReaderArray();
 
     void SetReaderArray(LogFileReaderPtrArray* readerArray);
@@ -232,7 +332,23 @@ public:
                               std::string& lastLogTimeStr,
                               uint32_t& logGroupSize)
         = 0;
-    virtual std::vector<int32_t> LogSplit(char* buffer, int32_t size, int32_t& lineFeed);
+    // ParseLogLines parses @count NUL-terminated lines at @offsets of @buffer as ParseLogLine does, the result
+    // of each line is set to @results. Readers override it by ParseLogLinesBy with their own ParseLogLine, so
+    // the virtual call is made once per batch rather than once per line.
+    virtual void ParseLogLines(const char* buffer,
+                               const int32_t* offsets,
+                               uint32_t count,
+                               sls_logs::LogGroup& logGroup,
+                               LogLineParseState& state,
+                               uint32_t& logGroupSize,
+                               LogLineParseResult* results);
+    // Lines starting in (0, @checkedSize) are known not to be log begin lines (checked by LastMatchedLine of
+    // the previous read), so the begin regex is not run on them again.
+    virtual std::vector<int32_t>
+    LogSplit(char* buffer, int32_t size, int32_t& lineFeed, int32_t checkedSize = 0);
+    // IsSingleLineSplit returns true if every line feed is a log boundary, so lines can be parsed while
+    // they are split without building the index of LogSplit.
+    virtual bool IsSingleLineSplit() const { return !mLogBeginRegPtr; }
 
     // added by xianzhi(bowen.gbw@antfin.com)
     static bool ParseLogTime(const char* buffer,
@@ -253,6 +369,12 @@ public:
                                    const std::string& logPath = "");
 
     bool IsFromCheckPoint() { return mLastFileSignatureHash != 0 && mLastFileSignatureSize > (size_t)0; }
+    uint64_t GetSignatureHash() const { return mLastFileSignatureHash; }
+    uint32_t GetSignatureSize() const { return mLastFileSignatureSize; }
+    int32_t GetLastEventTime() const { return mLastEventTime; }
+    // IsHibernatable returns true if all state of the reader is in its checkpoint, so the reader can be
+    // released and created again from the checkpoint when the file is modified.
+    bool IsHibernatable() const { return !mEOOption && !mLogFileOp.IsOpen() && IsReadToEnd(); }
 
     void SetDelayAlarmBytes(int64_t value) { mReadDelayAlarmBytes = value; }
 
@@ -266,6 +388,33 @@ public:
         mExtraTags.insert(mExtraTags.end(), tags.begin(), tags.end());
     }
 
+    // Tags passed to plugin are the same for all buffers of the reader except the offset, they are built once and
+    // cached. The cache is missed (nullptr returned) once path, user defined id or extra tags change.
+    std::shared_ptr<const std::string> GetCachedPluginTags(const std::string& logPath,
+                                                           const std::string& userDefinedId);
+    void SetCachedPluginTags(const std::string& logPath,
+                             const std::string& userDefinedId,
+                             std::shared_ptr<const std::string> tags);
+    // Tags added to log groups of the reader, cached in the same way as tags passed to plugin.
+    std::shared_ptr<const std::vector<sls_logs::LogTag>> GetCachedLogTags(const std::string& logPath,
+                                                                         const std::string& userDefinedId);
+    void SetCachedLogTags(const std::string& logPath,
+                          const std::string& userDefinedId,
+                          std::shared_ptr<const std::vector<sls_logs::LogTag>> tags);
+    // Profiling entry of the reader, callers should check whether it matches the current path and config.
+    std::shared_ptr<LogFileProfilingEntry> GetProfilingEntry() {
+        ScopedSpinLock lock(mTagsCacheLock);
+        return mProfilingEntry;
+    }
+    void SetProfilingEntry(std::shared_ptr<LogFileProfilingEntry> entry) {
+        ScopedSpinLock lock(mTagsCacheLock);
+        mProfilingEntry = std::move(entry);
+    }
+
+    // GetConfig returns the config of the reader or NULL if it has been removed. The config found is cached with the
+    // config generation of ConfigManager, it is looked up by name again only after configs are deleted.
+    Config* GetConfig();
+
     void SetDelaySkipBytes(int64_t value) { mReadDelaySkipBytes = value; }
 
     void SetFuseMode(bool fusemode) { mIsFuseMode = fusemode; }
@@ -307,11 +456,39 @@ public:
         mAdjustApsaraMicroTimezone = adjustApsaraMicroTimezone;
     }
 
+    // SetKeptKeys makes parsers of JSON_LOG and REGEX_LOG add only @keys to logs, empty means all keys.
+    virtual void SetKeptKeys(const std::vector<std::string>& keys) { mKeptKeys = KeyProjection(keys); }
+
 protected:
-    virtual bool
-    GetRawData(char*& bufferptr, size_t* size, int64_t fileSize, FileInfo*& fileInfo, TruncateInfo*& trncateInfo);
-    void ReadUTF8(char*& bufferptr, size_t* size, int64_t end, bool& moreData, TruncateInfo*& truncateInfo);
-    void ReadGBK(char*& bufferptr, size_t* size, int64_t end, bool& moreData, TruncateInfo*& truncateInfo);
+    // ParseLogLinesBy runs @parseLine on each line, @parseLine is a lambda calling ParseLogLine of the reader
+    // class by its qualified name, so the call is resolved at compile time and can be inlined into the loop.
+    template <typename ParseLine>
+    static void ParseLogLinesBy(ParseLine&& parseLine,
+                                const char* buffer,
+                                const int32_t* offsets,
+                                uint32_t count,
+                                sls_logs::LogGroup& logGroup,
+                                LogLineParseState& state,
+                                uint32_t& logGroupSize,
+                                LogLineParseResult* results) {
+        for (uint32_t i = 0; i < count; ++i) {
+            LogLineParseResult& result = results[i];
+            result.mSuccess = parseLine(buffer + offsets[i],
+                                        logGroup,
+                                        state.mError,
+                                        state.mLastLogLineTime,
+                                        state.mLastLogTimeStr,
+                                        logGroupSize);
+            result.mError = state.mError;
+            result.mLogEnd = logGroup.logs_size();
+        }
+    }
+
+    virtual bool GetRawData(
+        LogBufferSlabPtr& buffer, size_t* size, int64_t fileSize, FileInfo*& fileInfo, TruncateInfo*& trncateInfo);
+    virtual void
+    ReadUTF8(LogBufferSlabPtr& buffer, size_t* size, int64_t end, bool& moreData, TruncateInfo*& truncateInfo);
+    void ReadGBK(LogBufferSlabPtr& buffer, size_t* size, int64_t end, bool& moreData, TruncateInfo*& truncateInfo);
 
     size_t
     ReadFile(LogFileOperator& logFileOp, void* buf, size_t size, int64_t& offset, TruncateInfo** truncateInfo = NULL);
@@ -326,10 +503,40 @@ protected:
         char* buffer, size_t size, int32_t bootTime, const std::string& timeFormat, int32_t& parsedTime, int& pos);
     static int32_t ParseTime(const char* buffer, const std::string& timeFormat);
     void SetFilePosBackwardToFixedPos(LogFileOperator& logFileOp);
+    // SetReadPosByTime seeks mReadFromTime by the time index of the file, returns false if no time is parsed.
+    bool SetReadPosByTime(LogFileOperator& logFileOp);
 
     bool CheckForFirstOpen(FileReadPolicy policy = BACKWARD_TO_FIXED_POS);
     void FixLastFilePos(LogFileOperator& logFileOp, int64_t endOffset);
 
+    // Return the size to read for following read.
+    //
+    // Complete selected checkpoint means that it is a replay checkpoint, so
+    //  next read size should be specified.
+    //
+    // @param fileEnd: file size, ie. tell(seek(end)).
+    // @param fromCpt: if the read size is recoveried from checkpoint, set it to true.
+    // @readLimit: the max size of a normal read, a read of this size means more data is pending.
+    size_t getNextReadSize(int64_t fileEnd, bool& fromCpt, size_t& readLimit);
+
+    // Update current checkpoint's read offset and length after success read.
+    void setExactlyOnceCheckpointAfterRead(size_t readSize);
+
+    // IsLogBeginLine checks if the NUL-terminated @line matches log begin regex.
+    bool IsLogBeginLine(const char* line, std::string& exception) const {
+        for (uint32_t i = 0; i < mLinePrefixFields; ++i) {
+            const char* space = strchr(line, ' ');
+            if (space == NULL) {
+                break;
+            }
+            line = space + 1;
+        }
+        if (mLogBeginRegPrefilter && !mLogBeginRegPrefilter->MayMatch(line)) {
+            return false;
+        }
+        return BoostRegexMatch(line, *mLogBeginRegPtr, exception);
+    }
+
     static size_t BUFFER_SIZE;
     std::string mRegion;
     std::string mCategory;
@@ -337,21 +544,34 @@ protected:
     std::string mLogPath;
     std::string mLogPathFile;
     std::string mRealLogPath; // real log path
+    // mCompressedLogPath is the gzip or zstd archive of mRealLogPath being read, see OpenCompressedRotatedFile.
+    std::string mCompressedLogPath;
     bool mSymbolicLinkFlag = false;
+    bool mFdEvicted = false;
+    int64_t mReadEndPos = 0;
     std::string mSourceId;
+    uint64_t mSourceIdKey = 0;
     int32_t mTailLimit; // KB
     uint64_t mLastFileSignatureHash;
     uint32_t mLastFileSignatureSize;
     int64_t mLastFilePos;
     int64_t mLastReadPos = 0;
+    std::atomic<int32_t> mSpilledBufferCount{0};
+    std::atomic<int64_t> mSpilledBeginOffset{-1};
+    TokenBucket mReadRateBucket;
+    int32_t mReadFromTime = 0;
     int64_t mLastFileSize;
     std::string mProjectName;
     std::string mTopicName;
     time_t mLastUpdateTime;
-    boost::regex* mLogBeginRegPtr;
+    RegexPtr mLogBeginRegPtr; // shared by readers with the same regex, see RegexCache
+    RegexPrefixFilterPtr mLogBeginRegPrefilter;
     FileEncoding mFileEncoding;
     bool mDiscardUnmatch;
     LogType mLogType;
+    // Space separated fields the reader prefixes to lines, such as container stdout, they are skipped by the
+    // log begin regex.
+    uint32_t mLinePrefixFields = 0;
     DevInode mDevInode;
     bool mFirstWatched;
     bool mFileDeleted;
@@ -366,6 +586,15 @@ protected:
     int64_t mPackId;
     int64_t mReadDelaySkipBytes; // if <=0, discard it, default 0.
     int32_t mLastEventTime; // last time when process modify event, updated in check file sig
+    size_t mAdaptiveReadLimit = 0; // 0 means BUFFER_SIZE
+    int64_t mReadAheadEnd = 0; // end of the range advised to read ahead
+    BatchRead::Request mTailRead; // valid if mTailReadPending, see PrepareTailRead
+    bool mTailReadPending = false;
+    std::vector<char> mTailReadBuffer;
+    // Range rolled back by LastMatchedLine in last read: it starts with a begin line, others are not begin lines.
+    int64_t mCheckedLinesOffset = 0;
+    int32_t mCheckedLinesSize = 0;
+    int32_t mLastSignatureCheckTime = 0; // 0 means the signature must be checked, reset when file is opened
     int32_t mSpecifiedYear; // Copied from corresponding Config, see more in Config.h
     bool mIsFuseMode = false;
     bool mMarkOffsetFlag = false;
@@ -378,14 +607,42 @@ protected:
     // `/home/admin/access.log` we should use mDockerPath to extract topic and set it to __tag__:__path__
     std::string mDockerPath;
     std::vector<sls_logs::LogTag> mExtraTags;
+    // Values cached tags are built from, extra tags only grow, so their count is enough to tell if they are changed.
+    struct TagsCacheKey {
+        std::string mLogPath;
+        std::string mUserDefinedId;
+        size_t mExtraTagCount = 0;
+
+        bool Match(const std::string& logPath, const std::string& userDefinedId, size_t extraTagCount) const {
+            return mExtraTagCount == extraTagCount && mLogPath == logPath && mUserDefinedId == userDefinedId;
+        }
+    };
+    SpinLock mTagsCacheLock;
+    std::shared_ptr<const std::string> mCachedPluginTags;
+    TagsCacheKey mCachedPluginTagsKey;
+    std::shared_ptr<const std::vector<sls_logs::LogTag>> mCachedLogTags;
+    TagsCacheKey mCachedLogTagsKey;
+    SpinLock mCachedConfigLock;
+    Config* mCachedConfig = NULL;
+    int64_t mCachedConfigGeneration = -1;
+    std::shared_ptr<LogFileProfilingEntry> mProfilingEntry;
     int32_t mCloseUnusedInterval;
 
     PreciseTimestampConfig mPreciseTimestampConfig;
 
     int32_t mTzOffsetSecond;
     bool mAdjustApsaraMicroTimezone;
+    KeyProjection mKeptKeys;
+    CheckPointSnapshotTable::Slot mCheckPointSlot;
 
 private:
+    CheckPoint* MakeCheckPoint() const;
+    // OpenCompressedRotatedFile opens the gzip or zstd archive of the rotated file mRealLogPath when it is gone,
+    // such as compressed by logrotate, reading continues at the same uncompressed offset if the decompressed
+    // content has the same signature. Only when enable_compressed_rotated_file_read is set.
+    bool OpenCompressedRotatedFile();
+    bool OpenCompressedFile(const std::string& path);
+
     // Initialized when the exactly once feature is enabled.
     struct ExactlyOnceOption {
         std::string primaryCheckpointKey;
@@ -402,6 +659,9 @@ private:
         std::deque<RangeCheckpointPtr> toReplayCheckpoints;
         // Recovered from checkpoints.
         int64_t lastComittedOffset = -1;
+        // Acknowledged prefix of the file, shared with range checkpoints, persisted
+        //  to primary checkpoint by updatePrimaryCheckpointCommittedOffset.
+        std::shared_ptr<RangeCommitWatermark> watermark;
 
         uint32_t concurrency = 8;
     };
@@ -426,17 +686,14 @@ private:
     // 2. No more checkpoint, but the last committed offset is bigger.
     void skipCheckpointRelayHole();
 
-    // Return the size to read for following read.
-    //
-    // Complete selected checkpoint means that it is a replay checkpoint, so
-    //  next read size should be specified.
-    //
-    // @param fileEnd: file size, ie. tell(seek(end)).
-    // @param fromCpt: if the read size is recoveried from checkpoint, set it to true.
-    size_t getNextReadSize(int64_t fileEnd, bool& fromCpt);
-
-    // Update current checkpoint's read offset and length after success read.
-    void setExactlyOnceCheckpointAfterRead(size_t readSize);
+    // getReadSizeLimit adapts the read limit to @backlog (bytes not read yet) if adaptive_read_size_enable.
+    // The limit doubles up to adaptive_read_max_size while backlog exceeds it, and halves back to BUFFER_SIZE
+    // when the file is caught up. Limits above BUFFER_SIZE are only used under read_buffer_budget_bytes.
+    size_t getReadSizeLimit(int64_t backlog);
+    // getReadAheadRange returns the range to advise the kernel to read ahead after a read ending at @readEnd
+    // that is truncated by @readLimit. At most read_ahead_max_bytes (or @readLimit if it is larger than
+    // BUFFER_SIZE) is kept ahead of the read, and a new range is returned only when half of it is consumed.
+    bool getReadAheadRange(int64_t readEnd, int64_t fileEnd, size_t readLimit, int64_t& offset, int64_t& length);
 
     // Return primary key of current reader by combining meta.
     //
@@ -502,6 +759,9 @@ private:
     // Update primary checkpoint when meta updated.
     void updatePrimaryCheckpointSignature();
     void updatePrimaryCheckpointRealPath();
+    // Persist the watermark if it has moved, called by ReadLog, so acks between two
+    //  reads are written once (and combined with other writes by CheckpointManagerV2).
+    void updatePrimaryCheckpointCommittedOffset();
 
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class EventDispatcherTest;
@@ -510,11 +770,14 @@ private:
     friend class SenderUnittest;
     friend class AppConfigUnittest;
     friend class ModifyHandlerUnittest;
+    friend class AdaptiveReadSizeUnittest;
+    friend class DeletedFileUnittest;
     void UpdateReaderManual();
 #endif
 };
 
 struct LogBuffer {
+    // Points to the data of slab, which is released with LogBuffer.
     char* buffer;
     int32_t bufferSize;
     LogFileReaderPtr logFileReader;
@@ -524,12 +787,25 @@ struct LogBuffer {
     RangeCheckpointPtr exactlyOnceCheckpoint;
     // Current buffer's offset in file, for log position meta feature.
     uint64_t beginOffset;
+    // Monotonic time in ms when the buffer is read, for pipeline latency tracing.
+    uint64_t readTimeInMs;
+    // Lines starting in (0, checkedLinesSize) are known not to be log begin lines, see LogSplit.
+    int32_t checkedLinesSize = 0;
+    LogBufferSlabPtr slab;
 
-    LogBuffer(char* buf,
+    LogBuffer(const LogBufferSlabPtr& slab,
               int32_t size,
               const FileInfoPtr& fileInfo = FileInfoPtr(),
               const TruncateInfoPtr& truncateInfo = TruncateInfoPtr())
-        : buffer(buf), bufferSize(size), fileInfo(fileInfo), truncateInfo(truncateInfo) {}
+        : buffer(slab.get()),
+          bufferSize(size),
+          fileInfo(fileInfo),
+          truncateInfo(truncateInfo),
+          readTimeInMs(GetSteadyTimeInMilliSeconds()),
+          slab(slab) {
+        MemoryBudget::Add(MEMORY_COMPONENT_LOG_BUFFER, bufferSize);
+    }
+    ~LogBuffer() { MemoryBudget::Sub(MEMORY_COMPONENT_LOG_BUFFER, bufferSize); }
     void SetDependecy(const LogFileReaderPtr& reader) { logFileReader = reader; }
 };
 
@@ -549,7 +825,11 @@ public:
 
     void SetTimeKey(const std::string& timeKey);
 
-    bool AddUserDefinedFormat(const std::string& regStr, const std::string& keys);
+    // AddUserDefinedFormat adds a regex with its keys, RE2 is used to match if @useRe2
+    // is true and @regStr can be compiled by RE2, otherwise boost::regex is used.
+    bool AddUserDefinedFormat(const std::string& regStr, const std::string& keys, bool useRe2 = false);
+
+    void SetKeptKeys(const std::vector<std::string>& keys) override;
 
 protected:
     bool ParseLogLine(const char* buffer,
@@ -558,12 +838,22 @@ protected:
                       time_t& lastLogLineTime,
                       std::string& lastLogTimeStr,
                       uint32_t& logGroupSize);
+    void ParseLogLines(const char* buffer,
+                       const int32_t* offsets,
+                       uint32_t count,
+                       sls_logs::LogGroup& logGroup,
+                       LogLineParseState& state,
+                       uint32_t& logGroupSize,
+                       LogLineParseResult* results) override;
 
     std::string mTimeKey;
     std::string mTimeFormat;
     std::vector<UserDefinedFormat> mUserDefinedFormat;
     std::vector<int32_t> mTimeIndex;
 
+private:
+    void UpdateKeptKeys(UserDefinedFormat& format) const;
+
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class LogFileReaderUnittest;
 #endif
@@ -589,6 +879,13 @@ private:
                       time_t& lastLogLineTime,
                       std::string& lastLogTimeStr,
                       uint32_t& logGroupSize);
+    void ParseLogLines(const char* buffer,
+                       const int32_t* offsets,
+                       uint32_t count,
+                       sls_logs::LogGroup& logGroup,
+                       LogLineParseState& state,
+                       uint32_t& logGroupSize,
+                       LogLineParseResult* results) override;
 
 #ifdef APSARA_UNIT_TEST_MAIN
     friend class LogFileReaderUnittest;
@@ -17,6 +17,7 @@
 #include "Exception.h"
 #include "Result.h"
 #include "CurlImp.h"
+#include <algorithm>
 
 namespace logtail {
 namespace sdk {
@@ -210,6 +211,25 @@ namespace sdk {
         return true;
     }
 
+    bool Client::WarmUp(const std::string& project) {
+        static string logstore = "logtail-warm-up-logstore";
+        try {
+            PingSLSServer(project, logstore);
+        } catch (const LOGException& e) {
+            const string& errorCode = e.GetErrorCode();
+            return errorCode != LOGE_REQUEST_ERROR && errorCode != LOGE_CLIENT_OPERATION_TIMEOUT
+                && errorCode != LOGE_REQUEST_TIMEOUT;
+        }
+        return true;
+    }
+
+    std::vector<std::string> Client::GetRecentProjects() {
+        mSpinLock.lock();
+        std::vector<std::string> projects = mRecentProjects;
+        mSpinLock.unlock();
+        return projects;
+    }
+
     PostLogStoreLogsResponse Client::PostLogStoreLogs(const std::string& project,
                                                       const std::string& logstore,
                                                       sls_logs::SlsCompressType compressType,
@@ -249,9 +269,10 @@ namespace sdk {
                                   uint32_t rawSize,
                                   PostLogStoreLogsClosure* callBack,
                                   const std::string& hashKey,
-                                  int64_t hashKeySeqID) {
+                                  int64_t hashKeySeqID,
+                                  bool columnar) {
         map<string, string> httpHeader;
-        httpHeader[CONTENT_TYPE] = TYPE_LOG_PROTOBUF;
+        httpHeader[CONTENT_TYPE] = columnar ? TYPE_LOG_COLUMNAR : TYPE_LOG_PROTOBUF;
         if (!mKeyProvider.empty()) {
             httpHeader[X_LOG_KEYPROVIDER] = mKeyProvider;
         }
@@ -333,6 +354,17 @@ namespace sdk {
         }
 
         string host = GetHost(project);
+        mSpinLock.lock();
+        if (mRecentProjects.empty() || mRecentProjects.back() != project) {
+            auto iter = std::find(mRecentProjects.begin(), mRecentProjects.end(), project);
+            if (iter != mRecentProjects.end()) {
+                mRecentProjects.erase(iter);
+            } else if (mRecentProjects.size() >= kMaxRecentProjects) {
+                mRecentProjects.erase(mRecentProjects.begin());
+            }
+            mRecentProjects.push_back(project);
+        }
+        mSpinLock.unlock();
         SetCommonHeader(httpHeader, (int32_t)(body.length()), project);
         string signature = GetUrlSignature(HTTP_POST, operation, httpHeader, parameterList, body, GetAccessKey());
         httpHeader[AUTHORIZATION] = LOG_HEADSIGNATURE_PREFIX + GetAccessKeyId() + ':' + signature;
@@ -351,12 +383,14 @@ namespace sdk {
                                                operation,
                                                queryString,
                                                httpHeader,
-                                               body,
+                                               std::string(),
                                                mTimeout,
                                                mInterface,
                                                mUsingHTTPS,
                                                callBack,
                                                response);
+        // The body is kept by caller until callBack is called, so it is not copied into request.
+        request->mBodyRef = &body;
         mClient->AsynSend(request);
     }
 
@@ -404,6 +438,33 @@ namespace sdk {
         return ret;
     }
 
+    ListShardsResponse Client::ListShards(const std::string& project, const std::string& logstore) {
+        string operation = LOGSTORES;
+        operation.append("/").append(logstore).append("/shards");
+        map<string, string> httpHeader;
+        map<string, string> parameterList;
+        HttpMessage httpResponse;
+        SendRequest(project, HTTP_GET, operation, "", parameterList, httpHeader, httpResponse);
+
+        ListShardsResponse ret;
+        ret.statusCode = httpResponse.statusCode;
+        ret.requestId = httpResponse.header[X_LOG_REQUEST_ID];
+        rapidjson::Document document;
+        ExtractJsonResult(httpResponse.content, document);
+        if (!document.IsArray()) {
+            throw JsonException("InvalidObjectException", "response is not valid JSON array");
+        }
+        for (rapidjson::SizeType i = 0; i < document.Size(); ++i) {
+            ShardInfo shard;
+            ExtractJsonResult(document[i], "shardID", shard.shardId);
+            ExtractJsonResult(document[i], "status", shard.status);
+            ExtractJsonResult(document[i], "inclusiveBeginKey", shard.inclusiveBeginKey);
+            ExtractJsonResult(document[i], "exclusiveEndKey", shard.exclusiveEndKey);
+            ret.shards.push_back(std::move(shard));
+        }
+        return ret;
+    }
+
     PostLogStoreLogsResponse Client::PostLogUsingWebTracking(const std::string& project,
                                                              const std::string& logstore,
                                                              sls_logs::SlsCompressType compressType,
@@ -17,6 +17,7 @@
 #pragma once
 #include <string>
 #include <map>
+#include <vector>
 #include "log_pb/sls_logs.pb.h"
 #include "Closure.h"
 #include "Common.h"
@@ -55,6 +56,14 @@ namespace sdk {
 
         GetRealIpResponse GetRealIp();
         bool TestNetwork();
+        // WarmUp connects to the host of @project on current endpoint so the TLS session is cached for clients
+        // switched to the endpoint later, the request itself is rejected by server. Returns false on network
+        // error.
+        bool WarmUp(const std::string& project);
+        // GetRecentProjects returns projects posted to recently, at most kMaxRecentProjects.
+        std::vector<std::string> GetRecentProjects();
+
+        static const size_t kMaxRecentProjects = 8;
 
         std::string GetHost(const std::string& project);
 
@@ -113,9 +122,10 @@ namespace sdk {
         /** Async Put data to LOG service. Unsuccessful opertaion will cause an LOGException.
          * @param project The project name
          * @param logstore The logstore name
-         * @param compressedLogGroup data of logGroup, LZ4 comressed
+         * @param compressedLogGroup data of logGroup, LZ4 comressed, must be valid until callBack is called
          * @param rawSize before compress
          * @param compressType compression type
+         * @param columnar data is encoded by ColumnarLogGroup rather than protobuf
          * @return request_id.
          */
         void PostLogStoreLogs(const std::string& project,
@@ -125,11 +135,13 @@ namespace sdk {
                               uint32_t rawSize,
                               PostLogStoreLogsClosure* callBack,
                               const std::string& hashKey = "",
-                              int64_t hashKeySeqID = kInvalidHashKeySeqID);
+                              int64_t hashKeySeqID = kInvalidHashKeySeqID,
+                              bool columnar = false);
         /** Async Put data to LOG service. Unsuccessful opertaion will cause an LOGException.
          * @param project The project name
          * @param logstore The logstore name
-         * @param packageListData data of logPackageList, consist of several LogGroup
+         * @param packageListData data of logPackageList, consist of several LogGroup, must be valid until
+         * callBack is called
          * @return request_id.
          */
         void PostLogStoreLogPackageList(const std::string& project,
@@ -139,6 +151,13 @@ namespace sdk {
                                         PostLogStoreLogsClosure* callBack,
                                         const std::string& hashKey = "");
 
+        /** Sync list shards of a logstore. Unsuccessful opertaion will cause an LOGException.
+         * @param project The project name
+         * @param logstore The logstore name
+         * @return shards with their hash key ranges.
+         */
+        ListShardsResponse ListShards(const std::string& project, const std::string& logstore);
+
         PostLogStoreLogsResponse PostLogUsingWebTracking(const std::string& project,
                                                          const std::string& logstore,
                                                          sls_logs::SlsCompressType compressType,
@@ -200,6 +219,8 @@ namespace sdk {
         std::string mInterface;
         int32_t mPort;
         bool mUsingHTTPS;
+        // Most recent last, guarded by mSpinLock.
+        std::vector<std::string> mRecentProjects;
 
         SpinLock mSpinLock;
 
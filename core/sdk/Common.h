@@ -128,6 +128,7 @@ namespace sdk {
     extern const char* const ACCEPT_ENCODING; // = "Accept-Encoding";
     extern const char* const ENCONDING_GZIP; // = "gzip";
     extern const char* const TYPE_LOG_PROTOBUF; //="application/x-protobuf";
+    extern const char* const TYPE_LOG_COLUMNAR; //="application/x-logtail-columnar";
     extern const char* const TYPE_LOG_JSON; //="application/json";
     extern const char* const LOG_MODE_BATCH_GROUP; //="batch_group";
     extern const char* const LOGITEM_TIME_STAMP_LABEL; //="__time__";
@@ -232,6 +233,18 @@ namespace sdk {
         std::string realIp;
     };
 
+    // ShardInfo is a shard of a logstore, hash keys in [inclusiveBeginKey, exclusiveEndKey) are written to it.
+    struct ShardInfo {
+        int32_t shardId = -1;
+        std::string status; // readwrite or readonly
+        std::string inclusiveBeginKey;
+        std::string exclusiveEndKey;
+    };
+
+    struct ListShardsResponse : public Response {
+        std::vector<ShardInfo> shards;
+    };
+
 #define SHA1_INPUT_WORDS 16
 #define SHA1_DIGEST_WORDS 5
 #define SHA1_INPUT_BYTES (SHA1_INPUT_WORDS * sizeof(uint32_t))
@@ -371,6 +384,9 @@ namespace sdk {
 
         ~AsynRequest() { delete mResponse; }
 
+        // GetBody returns the body referenced by mBodyRef if it is set, or mBody.
+        const std::string& GetBody() const { return mBodyRef != NULL ? *mBodyRef : mBody; }
+
         std::string mHTTPMethod;
         std::string mHost;
         int32_t mPort = 80;
@@ -378,6 +394,8 @@ namespace sdk {
         std::string mQueryString;
         std::map<std::string, std::string> mHeader;
         std::string mBody;
+        // Body owned by the caller instead of copied to mBody, it must be valid until mCallBack is called.
+        const std::string* mBodyRef = NULL;
         int32_t mTimeout = 15;
         std::string mInterface;
         bool mHTTPSFlag = false;
@@ -18,9 +18,26 @@
 #include "Result.h"
 #include <curl/curl.h>
 #include <curl/multi.h>
+#include <algorithm>
+#include <functional>
 #include "logger/Logger.h"
 #include "app_config/AppConfig.h"
 #include "common/TimeUtil.h"
+#include "common/Flags.h"
+#include "common/ThreadAffinity.h"
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+DEFINE_FLAG_INT32(sdk_curl_thread_count, "threads sending async requests", LOGTAIL_SDK_CURL_THREAD_POOL_SIZE);
+DEFINE_FLAG_BOOL(sdk_enable_http2, "multiplex async https requests to the same host over HTTP/2", false);
+DEFINE_FLAG_INT32(sdk_max_host_connections, "max connections to a host of each thread, 0 means no limit", 0);
+DEFINE_FLAG_BOOL(sdk_curl_event_loop,
+                 "drive async requests by curl_multi_socket_action on epoll instead of polling, linux only",
+                 true);
 
 using namespace std;
 
@@ -43,18 +60,31 @@ namespace sdk {
 
 
     CurlAsynInstance::CurlAsynInstance() {
-        for (int i = 0; i < LOGTAIL_SDK_CURL_THREAD_POOL_SIZE; ++i) {
-            mMainThreads.push_back(new boost::thread(boost::bind(&CurlAsynInstance::Run, this)));
+        const int32_t threadCount = std::max(1, INT32_FLAG(sdk_curl_thread_count));
+        for (int32_t i = 0; i < threadCount; ++i) {
+            mRequestQueues.emplace_back(new RequestQueue<AsynRequest*>());
+        }
+        for (int32_t i = 0; i < threadCount; ++i) {
+            mMainThreads.push_back(
+                new boost::thread(boost::bind(&CurlAsynInstance::Run, this, mRequestQueues[i].get(), i)));
         }
     }
 
     CurlAsynInstance::~CurlAsynInstance() {
-        for (int i = 0; i < LOGTAIL_SDK_CURL_THREAD_POOL_SIZE; ++i) {
+        for (size_t i = 0; i < mMainThreads.size(); ++i) {
             mMainThreads[i]->join();
             delete mMainThreads[i];
         }
     }
 
+    void CurlAsynInstance::AddRequest(AsynRequest* request) {
+        size_t index = 0;
+        if (mRequestQueues.size() > 1) {
+            index = std::hash<std::string>()(request->mHost) % mRequestQueues.size();
+        }
+        mRequestQueues[index]->push(request);
+    }
+
     static bool AddRequestToMultiHandler(CURLM* multi_handle, AsynRequest* request) {
         curl_slist* headers = NULL;
         CURL* curl = PackCurlRequest(request->mHTTPMethod,
@@ -63,7 +93,7 @@ namespace sdk {
                                      request->mUrl,
                                      request->mQueryString,
                                      request->mHeader,
-                                     request->mBody,
+                                     request->GetBody(),
                                      request->mTimeout,
                                      request->mCallBack->mHTTPMessage,
                                      request->mInterface,
@@ -76,6 +106,12 @@ namespace sdk {
         }
         request->mPrivateData = headers;
         curl_easy_setopt(curl, CURLOPT_PRIVATE, request);
+        if (BOOL_FLAG(sdk_enable_http2) && request->mHTTPSFlag) {
+            // Negotiated by ALPN, falls back to HTTP/1.1 if the server does not support it. Waits for
+            // an existing connection to multiplex on instead of opening a new one.
+            curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+            curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+        }
         auto addRst = curl_multi_add_handle(multi_handle, curl);
         if (addRst != CURLM_OK) {
             request->mCallBack->OnFail(
@@ -184,24 +220,35 @@ namespace sdk {
         }
     }
 
-    void CurlAsynInstance::Run() {
+    void CurlAsynInstance::Run(RequestQueue<AsynRequest*>* requestQueue, int32_t index) {
+        // Thread 0 of sender role is the daemon sender.
+        ThreadAffinity::GetInstance()->BindCurrentThread(THREAD_ROLE_SENDER, index + 1);
         CURLM* multi_handle = curl_multi_init();
         if (multi_handle == NULL) {
             LOG_ERROR(sLogger, ("Init multi curl error", ""));
             return;
         }
+        if (BOOL_FLAG(sdk_enable_http2)) {
+            curl_multi_setopt(multi_handle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        }
+        if (INT32_FLAG(sdk_max_host_connections) > 0) {
+            curl_multi_setopt(multi_handle, CURLMOPT_MAX_HOST_CONNECTIONS, (long)INT32_FLAG(sdk_max_host_connections));
+        }
+        if (BOOL_FLAG(sdk_curl_event_loop) && EventLoop(multi_handle, *requestQueue)) {
+            return;
+        }
         while (true) {
             AsynRequest* request = NULL;
-            if (mRequestQueue.wait_and_pop(request)) {
+            if (requestQueue->wait_and_pop(request)) {
                 if (!AddRequestToMultiHandler(multi_handle, request)) {
                     continue;
                 }
             }
-            MultiHandlerLoop(multi_handle);
+            MultiHandlerLoop(multi_handle, *requestQueue);
         }
     }
 
-    bool CurlAsynInstance::MultiHandlerLoop(CURLM* multi_handle) {
+    bool CurlAsynInstance::MultiHandlerLoop(CURLM* multi_handle, RequestQueue<AsynRequest*>& requestQueue) {
         int still_running = 1;
         /* we start some action by calling perform right away */
 
@@ -252,7 +299,7 @@ namespace sdk {
            to sleep 100ms, which is the minimum suggested value in the
            curl_multi_fdset() doc. */
             AsynRequest* request = NULL;
-            if (mRequestQueue.try_pop(request)) {
+            if (requestQueue.try_pop(request)) {
                 if (AddRequestToMultiHandler(multi_handle, request)) {
                     ++still_running;
                     continue;
@@ -288,6 +335,159 @@ namespace sdk {
         return true;
     }
 
+#if defined(__linux__)
+    namespace {
+
+        inline int64_t NowMs() {
+            return static_cast<int64_t>(GetSteadyTimeInMilliSeconds());
+        }
+
+        // CurlEventLoop keeps sockets wanted by curl in epoll and the deadline of the curl timer.
+        class CurlEventLoop {
+        public:
+            CurlEventLoop(CURLM* multiHandler, int epollFd) : mMultiHandler(multiHandler), mEpollFd(epollFd) {
+                curl_multi_setopt(mMultiHandler, CURLMOPT_SOCKETFUNCTION, OnSocket);
+                curl_multi_setopt(mMultiHandler, CURLMOPT_SOCKETDATA, this);
+                curl_multi_setopt(mMultiHandler, CURLMOPT_TIMERFUNCTION, OnTimer);
+                curl_multi_setopt(mMultiHandler, CURLMOPT_TIMERDATA, this);
+            }
+
+            // GetWaitMs returns ms to wait for the curl timer, -1 if there is none.
+            int GetWaitMs() const {
+                if (mTimerDeadlineMs < 0) {
+                    return -1;
+                }
+                const int64_t now = NowMs();
+                return mTimerDeadlineMs <= now ? 0 : static_cast<int>(std::min<int64_t>(mTimerDeadlineMs - now, 1000));
+            }
+
+            void Action(curl_socket_t fd, int events) {
+                int running = 0;
+                curl_multi_socket_action(mMultiHandler, fd, events, &running);
+            }
+
+            // CheckTimer runs the curl timer if it is expired, events of busy sockets must not delay it.
+            void CheckTimer() {
+                if (mTimerDeadlineMs >= 0 && mTimerDeadlineMs <= NowMs()) {
+                    mTimerDeadlineMs = -1;
+                    Action(CURL_SOCKET_TIMEOUT, 0);
+                }
+            }
+
+        private:
+            static int OnSocket(CURL* easy, curl_socket_t fd, int what, void* userp, void* socketp) {
+                CurlEventLoop* loop = static_cast<CurlEventLoop*>(userp);
+                if (what == CURL_POLL_REMOVE) {
+                    epoll_ctl(loop->mEpollFd, EPOLL_CTL_DEL, fd, NULL);
+                    return 0;
+                }
+                struct epoll_event event;
+                event.events = ((what & CURL_POLL_IN) ? EPOLLIN : 0) | ((what & CURL_POLL_OUT) ? EPOLLOUT : 0);
+                event.data.fd = fd;
+                if (socketp == NULL) {
+                    // Any non-NULL value marks that the socket is in epoll.
+                    curl_multi_assign(loop->mMultiHandler, fd, loop);
+                    if (epoll_ctl(loop->mEpollFd, EPOLL_CTL_ADD, fd, &event) == 0 || errno != EEXIST) {
+                        return 0;
+                    }
+                }
+                epoll_ctl(loop->mEpollFd, EPOLL_CTL_MOD, fd, &event);
+                return 0;
+            }
+
+            static int OnTimer(CURLM* multiHandler, long timeoutMs, void* userp) {
+                CurlEventLoop* loop = static_cast<CurlEventLoop*>(userp);
+                loop->mTimerDeadlineMs = timeoutMs < 0 ? -1 : NowMs() + timeoutMs;
+                return 0;
+            }
+
+            CURLM* mMultiHandler;
+            int mEpollFd;
+            int64_t mTimerDeadlineMs = -1;
+        };
+
+    } // namespace
+
+    void CurlAsynInstance::NotifyFd(int fd) {
+        uint64_t value = 1;
+        while (write(fd, &value, sizeof(value)) < 0 && errno == EINTR) {
+        }
+    }
+
+    bool CurlAsynInstance::EventLoop(CURLM* multi_handle, RequestQueue<AsynRequest*>& requestQueue) {
+        const int epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) {
+            LOG_WARNING(sLogger, ("create epoll fail, poll curl instead, errno", errno));
+            return false;
+        }
+        const int eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = eventFd;
+        if (eventFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, eventFd, &event) != 0) {
+            LOG_WARNING(sLogger, ("create eventfd fail, poll curl instead, errno", errno));
+            if (eventFd >= 0) {
+                close(eventFd);
+            }
+            close(epollFd);
+            return false;
+        }
+        CurlEventLoop loop(multi_handle, epollFd);
+        // Requests pushed before the fd is set are not signaled, they are drained in the first round.
+        requestQueue.set_notify_fd(eventFd);
+        LOG_INFO(sLogger, ("drive curl by epoll, eventfd", eventFd));
+
+        const int kMaxEvents = 256;
+        struct epoll_event events[kMaxEvents];
+        bool drainQueue = true;
+        while (true) {
+            if (drainQueue) {
+                AsynRequest* request = NULL;
+                while (requestQueue.try_pop(request)) {
+                    // Adding a handle sets the curl timer to start it.
+                    AddRequestToMultiHandler(multi_handle, request);
+                }
+                drainQueue = false;
+            }
+            const int count = epoll_wait(epollFd, events, kMaxEvents, loop.GetWaitMs());
+            if (count < 0 && errno != EINTR) {
+                LOG_ERROR(sLogger, ("epoll wait fail, errno", errno));
+                usleep(100 * 1000);
+            }
+            for (int i = 0; i < count; ++i) {
+                const int fd = events[i].data.fd;
+                if (fd == eventFd) {
+                    uint64_t value = 0;
+                    while (read(eventFd, &value, sizeof(value)) < 0 && errno == EINTR) {
+                    }
+                    drainQueue = true;
+                    continue;
+                }
+                int action = 0;
+                if (events[i].events & EPOLLIN) {
+                    action |= CURL_CSELECT_IN;
+                }
+                if (events[i].events & EPOLLOUT) {
+                    action |= CURL_CSELECT_OUT;
+                }
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    action |= CURL_CSELECT_ERR;
+                }
+                loop.Action(fd, action);
+            }
+            loop.CheckTimer();
+            check_multi_info(multi_handle);
+        }
+        return true;
+    }
+#else
+    void CurlAsynInstance::NotifyFd(int fd) {
+    }
+
+    bool CurlAsynInstance::EventLoop(CURLM* multi_handle, RequestQueue<AsynRequest*>& requestQueue) {
+        return false;
+    }
+#endif
 
 } // namespace sdk
 } // namespace logtail
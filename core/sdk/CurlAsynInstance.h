@@ -17,13 +17,14 @@
 #pragma once
 #include "Common.h"
 #include <queue>
+#include <memory>
 #include <boost/thread.hpp>
 #include <curl/curl.h>
 
 namespace logtail {
 namespace sdk {
 
-#define LOGTAIL_SDK_CURL_THREAD_POOL_SIZE (1)
+#define LOGTAIL_SDK_CURL_THREAD_POOL_SIZE (1) // default of sdk_curl_thread_count
 
     class CurlAsynInstance {
     public:
@@ -42,13 +43,30 @@ namespace sdk {
             std::queue<Data> the_queue;
             mutable boost::mutex the_mutex;
             boost::condition_variable the_condition_variable;
+            int the_notify_fd = -1;
 
         public:
             void push(Data const& data) {
                 boost::mutex::scoped_lock lock(the_mutex);
+                const bool wasEmpty = the_queue.empty();
                 the_queue.push(data);
+                const int notifyFd = the_notify_fd;
                 lock.unlock();
-                the_condition_variable.notify_one();
+                if (notifyFd >= 0) {
+                    // The consumer drains the queue after reading the fd, so only the first push wakes it.
+                    if (wasEmpty) {
+                        NotifyFd(notifyFd);
+                    }
+                } else {
+                    the_condition_variable.notify_one();
+                }
+            }
+
+            // set_notify_fd makes push signal the eventfd @fd instead of the condition variable, for the
+            // consumer waiting in epoll.
+            void set_notify_fd(int fd) {
+                boost::mutex::scoped_lock lock(the_mutex);
+                the_notify_fd = fd;
             }
 
             bool empty() const {
@@ -82,14 +100,23 @@ namespace sdk {
             }
         };
 
-        void AddRequest(AsynRequest* request) { mRequestQueue.push(request); }
+        // AddRequest dispatches @request to a thread by its host, so requests to the same endpoint
+        // share the connections cached by one multi handle.
+        void AddRequest(AsynRequest* request);
+
+        void Run(RequestQueue<AsynRequest*>* requestQueue, int32_t index);
+
+        bool MultiHandlerLoop(CURLM* multiHandler, RequestQueue<AsynRequest*>& requestQueue);
 
-        void Run();
+        // EventLoop drives @multiHandler by curl_multi_socket_action on epoll, requests are picked up when
+        // pushed through an eventfd. It returns false if epoll is not available, otherwise it never returns.
+        bool EventLoop(CURLM* multiHandler, RequestQueue<AsynRequest*>& requestQueue);
 
-        bool MultiHandlerLoop(CURLM* multiHandler);
+        // NotifyFd signals eventfd @fd.
+        static void NotifyFd(int fd);
 
     private:
-        RequestQueue<AsynRequest*> mRequestQueue;
+        std::vector<std::unique_ptr<RequestQueue<AsynRequest*>>> mRequestQueues;
         std::vector<boost::thread*> mMainThreads;
     };
 
@@ -17,8 +17,14 @@
 #include "CurlAsynInstance.h"
 #include "DNSCache.h"
 #include "app_config/AppConfig.h"
+#include "common/Flags.h"
+#include <mutex>
 #include <curl/curl.h>
 
+DEFINE_FLAG_BOOL(sdk_share_tls_session,
+                 "share TLS sessions and DNS of all sdk clients, new connections resume sessions of others",
+                 true);
+
 using namespace std;
 
 namespace logtail {
@@ -26,6 +32,42 @@ namespace sdk {
 
     static CURLcode globalInitCode = curl_global_init(CURL_GLOBAL_ALL);
 
+    // CurlShare holds TLS sessions and DNS shared by requests of all clients, so a connection opened after an
+    // endpoint is switched or an idle client is cleaned resumes the session cached by an earlier one instead of
+    // a full handshake. Connections are not shared, libcurl does not support sharing them between threads
+    // running requests concurrently, each async thread keeps its own in its multi handle.
+    class CurlShare {
+    public:
+        static CURLSH* Get() {
+            static CurlShare* sInstance = new CurlShare();
+            return sInstance->mShare;
+        }
+
+    private:
+        CurlShare() {
+            mShare = curl_share_init();
+            if (mShare == NULL) {
+                return;
+            }
+            curl_share_setopt(mShare, CURLSHOPT_LOCKFUNC, Lock);
+            curl_share_setopt(mShare, CURLSHOPT_UNLOCKFUNC, Unlock);
+            curl_share_setopt(mShare, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(mShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+            curl_share_setopt(mShare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        }
+
+        static void Lock(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr) {
+            static_cast<CurlShare*>(userptr)->mMutexes[data % CURL_LOCK_DATA_LAST].lock();
+        }
+
+        static void Unlock(CURL* handle, curl_lock_data data, void* userptr) {
+            static_cast<CurlShare*>(userptr)->mMutexes[data % CURL_LOCK_DATA_LAST].unlock();
+        }
+
+        CURLSH* mShare = NULL;
+        std::mutex mMutexes[CURL_LOCK_DATA_LAST];
+    };
+
     CurlClient::CurlClient() {
         // Initliaze sending threads.
         CurlAsynInstance::GetInstance();
@@ -120,6 +162,12 @@ namespace sdk {
         curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1);
         curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1);
         curl_easy_setopt(curl, CURLOPT_NETRC, CURL_NETRC_IGNORED);
+        if (BOOL_FLAG(sdk_share_tls_session)) {
+            CURLSH* share = CurlShare::Get();
+            if (share != NULL) {
+                curl_easy_setopt(curl, CURLOPT_SHARE, share);
+            }
+        }
 
         if (httpsFlag) {
             curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
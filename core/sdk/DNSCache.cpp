@@ -14,6 +14,7 @@
 
 #include "DNSCache.h"
 #include <cstring>
+#include "common/Flags.h"
 #if defined(__linux__)
 #include <arpa/inet.h>
 #include <netdb.h>
@@ -22,9 +23,115 @@
 #include <ws2tcpip.h>
 #endif
 
+DEFINE_FLAG_INT32(sdk_dns_cache_ttl, "seconds to resolve a cached host again", 60);
+DEFINE_FLAG_INT32(sdk_dns_cache_stale_ttl, "seconds to use an address after it expires while resolving again", 600);
+DEFINE_FLAG_INT32(sdk_dns_cache_negative_ttl, "seconds to cache a failed resolution", 5);
+
 namespace logtail {
 namespace sdk {
 
+    DnsCache::DnsCache(Resolver resolver) : mResolver(std::move(resolver)), mSnapshot(std::make_shared<EntryMap>()) {
+        if (!mResolver) {
+            mResolver = [](const std::string& host, std::string& address) { return ParseHost(host.c_str(), address); };
+        }
+    }
+
+    DnsCache::~DnsCache() {
+        {
+            std::lock_guard<std::mutex> lock(mPendingLock);
+            mStopped = true;
+        }
+        mPendingCond.notify_all();
+        mResolveThread.reset();
+    }
+
+    bool DnsCache::UpdateHostInDnsCache(const std::string& host, std::string& address) {
+        return Resolve(host, address);
+    }
+
+    bool DnsCache::GetIPFromDnsCache(const std::string& host, std::string& address) {
+        std::shared_ptr<const EntryMap> snapshot = std::atomic_load(&mSnapshot);
+        auto itr = snapshot->find(host);
+        if (itr == snapshot->end()) {
+            RequestResolve(host);
+            return false;
+        }
+        const Entry& entry = itr->second;
+        const int32_t currentTime = time(NULL);
+        if (currentTime >= entry.mExpireTime) {
+            RequestResolve(host);
+        }
+        if (!entry.mResolved || currentTime >= entry.mStaleTime) {
+            return false;
+        }
+        address = entry.mAddress;
+        return true;
+    }
+
+    bool DnsCache::Resolve(const std::string& host, std::string& address) {
+        const bool status = mResolver(host, address);
+        const int32_t currentTime = time(NULL);
+
+        std::lock_guard<std::mutex> lock(mUpdateLock);
+        std::shared_ptr<EntryMap> snapshot = std::make_shared<EntryMap>(*std::atomic_load(&mSnapshot));
+        Entry& entry = (*snapshot)[host];
+        if (status) {
+            entry.mAddress = address;
+            entry.mResolved = true;
+            entry.mExpireTime = currentTime + INT32_FLAG(sdk_dns_cache_ttl);
+            entry.mStaleTime = entry.mExpireTime + INT32_FLAG(sdk_dns_cache_stale_ttl);
+        } else {
+            // The last address is kept until it is stale, resolution is retried after negative ttl.
+            entry.mExpireTime = currentTime + INT32_FLAG(sdk_dns_cache_negative_ttl);
+            if (!entry.mResolved || currentTime >= entry.mStaleTime) {
+                entry.mAddress.clear();
+                entry.mResolved = false;
+                entry.mStaleTime = 0;
+            }
+        }
+        std::atomic_store(&mSnapshot, std::shared_ptr<const EntryMap>(std::move(snapshot)));
+        return status;
+    }
+
+    void DnsCache::RequestResolve(const std::string& host) {
+        {
+            std::lock_guard<std::mutex> lock(mPendingLock);
+            if (mStopped || !mPendingSet.insert(host).second) {
+                return;
+            }
+            mPendingHosts.push_back(host);
+            if (!mResolveThread) {
+                mResolveThread = CreateThread([this]() { ResolveThread(); });
+            }
+        }
+        mPendingCond.notify_one();
+    }
+
+    void DnsCache::ResolveThread() {
+        std::unique_lock<std::mutex> lock(mPendingLock);
+        while (true) {
+            mPendingCond.wait(lock, [this]() { return mStopped || !mPendingHosts.empty(); });
+            if (mStopped) {
+                return;
+            }
+            std::string host = mPendingHosts.front();
+            mPendingHosts.pop_front();
+            ++mResolvingCount;
+            lock.unlock();
+            std::string address;
+            Resolve(host, address);
+            lock.lock();
+            --mResolvingCount;
+            mPendingSet.erase(host);
+            mPendingCond.notify_all();
+        }
+    }
+
+    void DnsCache::WaitResolved() {
+        std::unique_lock<std::mutex> lock(mPendingLock);
+        mPendingCond.wait(lock, [this]() { return mStopped || (mPendingHosts.empty() && mResolvingCount == 0); });
+    }
+
     // ParseHost only supports IPv4 now.
     bool DnsCache::ParseHost(const char* host, std::string& ip) {
 #if defined(__linux__)
@@ -17,69 +17,62 @@
 #pragma once
 #include <ctime>
 #include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
-#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <boost/thread.hpp>
+#include "common/Thread.h"
 
 namespace logtail {
 namespace sdk {
 
+    // DnsCache caches addresses of hosts for the send path.
+    //
+    // Lookups read an immutable snapshot of the cache, which is replaced as a whole by the resolve thread,
+    // so they never wait for a resolution or a lock held by one. An expired address is still returned within
+    // the stale period while it is refreshed in background, and failed resolutions are cached for a short
+    // time so an unresolvable host is not resolved on every request.
     class DnsCache {
-        int32_t mUpdateTime;
-        int32_t mDnsTTL;
-        std::mutex mDnsCacheLock;
-        std::map<std::string, std::pair<std::string, int32_t>> mDnsCacheData;
-
     public:
+        typedef std::function<bool(const std::string& host, std::string& address)> Resolver;
+
         static DnsCache* GetInstance() {
             static DnsCache singleton;
             return &singleton;
         }
 
-        bool UpdateHostInDnsCache(const std::string& host, std::string& address) {
-            int32_t currentTime = time(NULL);
-            bool status = false;
-            std::lock_guard<std::mutex> lock(mDnsCacheLock);
-
-            auto itr = mDnsCacheData.find(host);
-            if (itr == mDnsCacheData.end() || currentTime - (itr->second).second >= 3) {
-                if (ParseHost(host.c_str(), address)) {
-                    status = true;
-                    mDnsCacheData[host] = std::make_pair(address, currentTime);
-                } else {
-                    if (itr == mDnsCacheData.end()) {
-                        mDnsCacheData[host] = std::make_pair(host, currentTime);
-                    } else {
-                        mDnsCacheData[host] = std::make_pair((itr->second).first, currentTime);
-                    }
-                }
-            }
+        // @resolver is used to resolve hosts, ParseHost by default.
+        explicit DnsCache(Resolver resolver = Resolver());
+        ~DnsCache();
 
-            return status;
-        }
+        // UpdateHostInDnsCache resolves @host synchronously and updates the cache.
+        bool UpdateHostInDnsCache(const std::string& host, std::string& address);
 
-        bool GetIPFromDnsCache(const std::string& host, std::string& address) {
-            bool found = false;
-            {
-                std::lock_guard<std::mutex> lock(mDnsCacheLock);
-                if (!RemoveTimeOutDnsCache()) // not time out
-                {
-                    auto itr = mDnsCacheData.find(host);
-                    if (itr != mDnsCacheData.end()) {
-                        address = (itr->second).first;
-                        found = true;
-                    }
-                }
-            }
-            if (!found) // time out or not found
-                return UpdateHostInDnsCache(host, address);
-            return found;
-        }
+        // GetIPFromDnsCache returns false if there is no usable address of @host now, the caller should use
+        // @host directly. A resolution is started in background if the address is missing or expired.
+        bool GetIPFromDnsCache(const std::string& host, std::string& address);
+
+        // WaitResolved blocks until no resolutions are pending, for test.
+        void WaitResolved();
+
+        DnsCache(const DnsCache&) = delete;
+        DnsCache& operator=(const DnsCache&) = delete;
 
     private:
-        DnsCache(const int32_t ttlSeconds = 60 * 10) : mUpdateTime(time(NULL)), mDnsTTL(ttlSeconds) {}
-        ~DnsCache() = default;
+        struct Entry {
+            std::string mAddress;
+            bool mResolved = false;
+            int32_t mExpireTime = 0; // resolve again after this time
+            int32_t mStaleTime = 0; // stop using mAddress after this time
+        };
+        typedef std::unordered_map<std::string, Entry> EntryMap;
 
-        bool IsRawIp(const char* host) {
+        static bool IsRawIp(const char* host) {
             unsigned char c, *p;
             p = (unsigned char*)host;
             while ((c = (*p++)) != '\0') {
@@ -89,19 +82,26 @@ namespace sdk {
             return true;
         }
 
-        bool ParseHost(const char* host, std::string& ip);
+        static bool ParseHost(const char* host, std::string& ip);
 
-        bool RemoveTimeOutDnsCache() {
-            int32_t currentTime = time(NULL);
-            bool isTimeOut = false;
-            if (currentTime - mUpdateTime >= mDnsTTL) {
-                isTimeOut = true;
-                mDnsCacheData.clear();
-                mUpdateTime = currentTime;
-            }
-            return isTimeOut;
-        }
+        bool Resolve(const std::string& host, std::string& address);
+        void RequestResolve(const std::string& host);
+        void ResolveThread();
+
+        Resolver mResolver;
+        // Snapshot read by lookups, accessed by std::atomic_load and std::atomic_store only.
+        std::shared_ptr<const EntryMap> mSnapshot;
+        // Serializes updates of snapshot.
+        std::mutex mUpdateLock;
+
+        std::mutex mPendingLock;
+        std::condition_variable mPendingCond;
+        std::deque<std::string> mPendingHosts;
+        std::unordered_set<std::string> mPendingSet;
+        size_t mResolvingCount = 0;
+        bool mStopped = false;
+        ThreadPtr mResolveThread;
     };
 
 } // namespace sdk
-} // namespace logtail
\ No newline at end of file
+} // namespace logtail
@@ -0,0 +1,111 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "AdaptiveBatchPolicy.h"
+#include <algorithm>
+#include "common/Flags.h"
+#include "logger/Logger.h"
+
+DEFINE_FLAG_BOOL(enable_adaptive_batch_size, "scale batch size limits of aggregator by send latency", false);
+DEFINE_FLAG_INT32(adaptive_batch_adjust_interval, "min interval to adjust batch size scale, seconds", 10);
+DEFINE_FLAG_INT32(adaptive_batch_rtt_window, "interval to reset the RTT estimate of a region, seconds", 300);
+DEFINE_FLAG_INT32(adaptive_batch_min_rtt_ms, "batches only grow if RTT is at least this, milliseconds", 20);
+DEFINE_FLAG_DOUBLE(adaptive_batch_rtt_dominated_ratio, "latency within RTT * ratio is dominated by RTT", 1.5);
+DEFINE_FLAG_DOUBLE(adaptive_batch_max_scale, "max scale of batch size limits", 4.0);
+DEFINE_FLAG_DOUBLE(adaptive_batch_min_scale, "min scale of batch size limits", 0.25);
+
+namespace logtail {
+
+namespace {
+
+    const double kLatencySmoothingFactor = 0.2;
+    const double kGrowFactor = 1.25;
+    const double kShrinkFactor = 0.5;
+
+} // namespace
+
+void AdaptiveBatchPolicy::OnSendSuccess(const std::string& region, int64_t latencyMs, int32_t curTime) {
+    if (!BOOL_FLAG(enable_adaptive_batch_size) || latencyMs < 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mMux);
+    RegionState& state = mRegionStates[region];
+    if (state.mMinLatencyMs < 0) {
+        state.mLatencyMs = latencyMs;
+        state.mLastAdjustTime = curTime;
+    } else {
+        state.mLatencyMs += kLatencySmoothingFactor * (latencyMs - state.mLatencyMs);
+    }
+    if (state.mMinLatencyMs < 0 || latencyMs < state.mMinLatencyMs
+        || curTime - state.mMinLatencyTime >= INT32_FLAG(adaptive_batch_rtt_window)) {
+        state.mMinLatencyMs = latencyMs;
+        state.mMinLatencyTime = curTime;
+    }
+    Adjust(state, curTime);
+}
+
+void AdaptiveBatchPolicy::OnSendBlocked(const std::string& region, int32_t curTime) {
+    if (!BOOL_FLAG(enable_adaptive_batch_size)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mMux);
+    RegionState& state = mRegionStates[region];
+    state.mBlocked = true;
+    Adjust(state, curTime);
+}
+
+void AdaptiveBatchPolicy::Adjust(RegionState& state, int32_t curTime) {
+    if (curTime - state.mLastAdjustTime < INT32_FLAG(adaptive_batch_adjust_interval)) {
+        return;
+    }
+    const double oldScale = state.mScale;
+    if (state.mBlocked) {
+        state.mScale = std::max(DOUBLE_FLAG(adaptive_batch_min_scale), state.mScale * kShrinkFactor);
+    } else if (state.mMinLatencyMs >= INT32_FLAG(adaptive_batch_min_rtt_ms)
+               && state.mLatencyMs <= state.mMinLatencyMs * DOUBLE_FLAG(adaptive_batch_rtt_dominated_ratio)) {
+        state.mScale = std::min(DOUBLE_FLAG(adaptive_batch_max_scale), state.mScale * kGrowFactor);
+    } else if (state.mScale > 1.0) {
+        state.mScale = std::max(1.0, state.mScale / kGrowFactor);
+    } else if (state.mScale < 1.0) {
+        state.mScale = std::min(1.0, state.mScale * kGrowFactor);
+    }
+    state.mBlocked = false;
+    state.mLastAdjustTime = curTime;
+    if (state.mScale != oldScale) {
+        LOG_DEBUG(sLogger,
+                  ("adjust batch size scale", state.mScale)("old scale", oldScale)("latency ms", state.mLatencyMs)(
+                      "rtt ms", state.mMinLatencyMs));
+    }
+}
+
+double AdaptiveBatchPolicy::GetScale(const std::string& region) {
+    const double resourceScale = mResourceScale.load(std::memory_order_relaxed);
+    if (!BOOL_FLAG(enable_adaptive_batch_size)) {
+        return resourceScale;
+    }
+    std::lock_guard<std::mutex> lock(mMux);
+    auto iter = mRegionStates.find(region);
+    return (iter == mRegionStates.end() ? 1.0 : iter->second.mScale) * resourceScale;
+}
+
+int32_t AdaptiveBatchPolicy::ScaleLimit(const std::string& region, int32_t limit, int32_t maxLimit) {
+    const double scale = GetScale(region);
+    if (scale == 1.0) {
+        return limit;
+    }
+    const double scaled = limit * scale;
+    return static_cast<int32_t>(std::max(1.0, std::min(scaled, static_cast<double>(std::max(limit, maxLimit)))));
+}
+
+} // namespace logtail
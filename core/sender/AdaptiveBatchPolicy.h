@@ -0,0 +1,74 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace logtail {
+
+// AdaptiveBatchPolicy scales the batch size limits of Aggregator for each region by send feedback.
+//
+// - If request latency stays close to the smallest one seen recently, the cost is dominated by
+//   RTT rather than transfer, so batches grow to send more data per request.
+// - If the sender queue is backing up, batches shrink to keep latency low.
+// - Otherwise the scale goes back to 1.
+//
+// The scale is adjusted at most once per adaptive_batch_adjust_interval seconds. It's multiplied by
+// the resource scale set by LogtailMonitor, which shrinks batches of all regions under resource pressure.
+class AdaptiveBatchPolicy {
+public:
+    static AdaptiveBatchPolicy* GetInstance() {
+        static AdaptiveBatchPolicy* instance = new AdaptiveBatchPolicy();
+        return instance;
+    }
+
+    // OnSendSuccess records a request to @region taking @latencyMs milliseconds.
+    void OnSendSuccess(const std::string& region, int64_t latencyMs, int32_t curTime);
+    // OnSendBlocked records that data of @region is held because the sender queue is full.
+    void OnSendBlocked(const std::string& region, int32_t curTime);
+
+    // SetResourceScale sets the factor applied to all regions, no greater than 1.
+    void SetResourceScale(double scale) { mResourceScale.store(std::min(scale, 1.0), std::memory_order_relaxed); }
+
+    // GetScale returns the factor to apply to batch size limits of @region.
+    double GetScale(const std::string& region);
+
+    // ScaleLimit returns @limit scaled for @region and bounded by @maxLimit.
+    int32_t ScaleLimit(const std::string& region, int32_t limit, int32_t maxLimit);
+
+private:
+    struct RegionState {
+        double mScale = 1.0;
+        double mLatencyMs = 0.0; // EWMA of request latency
+        int64_t mMinLatencyMs = -1; // RTT estimate, reset every adaptive_batch_rtt_window seconds
+        int32_t mMinLatencyTime = 0;
+        int32_t mLastAdjustTime = 0;
+        bool mBlocked = false;
+    };
+
+    void Adjust(RegionState& state, int32_t curTime);
+
+    std::mutex mMux;
+    std::unordered_map<std::string, RegionState> mRegionStates;
+    std::atomic<double> mResourceScale{1.0};
+};
+
+} // namespace logtail
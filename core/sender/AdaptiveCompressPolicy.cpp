@@ -0,0 +1,158 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "AdaptiveCompressPolicy.h"
+#include "common/CompressTools.h"
+#include "common/Flags.h"
+#include "common/util.h"
+
+DEFINE_FLAG_BOOL(enable_adaptive_compress,
+                 "select compress type of logstores sending to public endpoints by CPU usage",
+                 false);
+DEFINE_FLAG_INT32(adaptive_compress_zstd_low_level, "zstd level used if CPU is neither busy nor idle", 1);
+DEFINE_FLAG_INT32(adaptive_compress_zstd_high_level, "zstd level used if CPU is idle", 6);
+DEFINE_FLAG_DOUBLE(adaptive_compress_cpu_busy_level, "CPU level above which lz4 is used", 0.8);
+DEFINE_FLAG_DOUBLE(adaptive_compress_cpu_idle_level, "CPU level below which the high zstd level is used", 0.3);
+DEFINE_FLAG_DOUBLE(adaptive_compress_min_gain, "min ratio of size saved to step up from a cheaper option", 0.05);
+DEFINE_FLAG_DOUBLE(adaptive_compress_max_cost_ratio, "max cost ratio to a cheaper option if CPU is not idle", 8.0);
+DEFINE_FLAG_INT32(adaptive_compress_sample_interval, "interval to sample each option again, seconds", 60);
+
+namespace logtail {
+
+namespace {
+
+    const double kSampleWeight = 0.3;
+
+} // namespace
+
+sls_logs::SlsCompressType AdaptiveCompressPolicy::Select(LogstoreFeedBackKey key,
+                                                         const std::string& region,
+                                                         sls_logs::SlsCompressType configType,
+                                                         int32_t& level,
+                                                         int32_t curTime) {
+    level = ZSTD_DEFAULT_LEVEL;
+    if (configType != sls_logs::SLS_CMP_LZ4 && configType != sls_logs::SLS_CMP_ZSTD) {
+        return configType;
+    }
+    const double cpuLevel = mCpuLevel.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mMux);
+    auto iter = mRegionInfos.find(region);
+    if (iter == mRegionInfos.end() || !iter->second.mPublic) {
+        return configType;
+    }
+
+    LogstoreState& state = mLogstoreStates[key];
+    const Option target = ByCpuLevel(cpuLevel);
+    Option option = StepDown(state, target, cpuLevel);
+    // Options stepped over and the cheaper ones they are compared to are tried again when samples are stale.
+    for (int i = OPTION_LZ4; i <= target; ++i) {
+        Sample& sample = state.mSamples[i];
+        if (i != option && curTime - sample.mTime >= INT32_FLAG(adaptive_compress_sample_interval)) {
+            sample.mTime = curTime;
+            option = static_cast<Option>(i);
+            break;
+        }
+    }
+    if (option == OPTION_LZ4) {
+        return sls_logs::SLS_CMP_LZ4;
+    }
+    level = GetLevel(option);
+    return sls_logs::SLS_CMP_ZSTD;
+}
+
+void AdaptiveCompressPolicy::OnCompressed(LogstoreFeedBackKey key,
+                                          sls_logs::SlsCompressType type,
+                                          int32_t level,
+                                          uint32_t rawSize,
+                                          size_t compressedSize,
+                                          uint64_t costUs,
+                                          int32_t curTime) {
+    const Option option = ToOption(type, level);
+    if (option == OPTION_COUNT || rawSize == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mMux);
+    auto iter = mLogstoreStates.find(key);
+    if (iter == mLogstoreStates.end()) {
+        return;
+    }
+    Sample& sample = iter->second.mSamples[option];
+    const double ratio = static_cast<double>(compressedSize) / rawSize;
+    const double cost = costUs * 1024.0 / rawSize;
+    if (sample.mValid) {
+        sample.mRatio += (ratio - sample.mRatio) * kSampleWeight;
+        sample.mCostUsPerKB += (cost - sample.mCostUsPerKB) * kSampleWeight;
+    } else {
+        sample.mRatio = ratio;
+        sample.mCostUsPerKB = cost;
+        sample.mValid = true;
+    }
+    sample.mTime = curTime;
+}
+
+void AdaptiveCompressPolicy::OnSendSuccess(const std::string& region, const std::string& endpoint) {
+    std::lock_guard<std::mutex> lock(mMux);
+    RegionInfo& info = mRegionInfos[region];
+    if (info.mEndpoint != endpoint) {
+        info.mEndpoint = endpoint;
+        info.mPublic = GetEndpointAddressType(endpoint) == EndpointAddressType::PUBLIC;
+    }
+}
+
+AdaptiveCompressPolicy::Option AdaptiveCompressPolicy::ByCpuLevel(double cpuLevel) {
+    if (cpuLevel >= DOUBLE_FLAG(adaptive_compress_cpu_busy_level)) {
+        return OPTION_LZ4;
+    }
+    return cpuLevel <= DOUBLE_FLAG(adaptive_compress_cpu_idle_level) ? OPTION_ZSTD_HIGH : OPTION_ZSTD_LOW;
+}
+
+AdaptiveCompressPolicy::Option
+AdaptiveCompressPolicy::StepDown(const LogstoreState& state, Option option, double cpuLevel) {
+    const bool idle = cpuLevel <= DOUBLE_FLAG(adaptive_compress_cpu_idle_level);
+    while (option > OPTION_LZ4) {
+        const Sample& current = state.mSamples[option];
+        const Sample& cheaper = state.mSamples[option - 1];
+        if (!current.mValid || !cheaper.mValid) {
+            break;
+        }
+        const bool littleGain = current.mRatio > cheaper.mRatio * (1 - DOUBLE_FLAG(adaptive_compress_min_gain));
+        const bool tooCostly
+            = !idle && current.mCostUsPerKB > cheaper.mCostUsPerKB * DOUBLE_FLAG(adaptive_compress_max_cost_ratio);
+        if (!littleGain && !tooCostly) {
+            break;
+        }
+        option = static_cast<Option>(option - 1);
+    }
+    return option;
+}
+
+int32_t AdaptiveCompressPolicy::GetLevel(Option option) {
+    return option == OPTION_ZSTD_HIGH ? INT32_FLAG(adaptive_compress_zstd_high_level)
+                                      : INT32_FLAG(adaptive_compress_zstd_low_level);
+}
+
+AdaptiveCompressPolicy::Option AdaptiveCompressPolicy::ToOption(sls_logs::SlsCompressType type, int32_t level) {
+    if (type == sls_logs::SLS_CMP_LZ4) {
+        return OPTION_LZ4;
+    }
+    if (type != sls_logs::SLS_CMP_ZSTD) {
+        return OPTION_COUNT;
+    }
+    if (level == INT32_FLAG(adaptive_compress_zstd_low_level)) {
+        return OPTION_ZSTD_LOW;
+    }
+    return level == INT32_FLAG(adaptive_compress_zstd_high_level) ? OPTION_ZSTD_HIGH : OPTION_COUNT;
+}
+
+} // namespace logtail
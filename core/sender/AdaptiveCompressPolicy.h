@@ -0,0 +1,98 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "common/LogstoreFeedbackKey.h"
+#include "log_pb/sls_logs.pb.h"
+
+namespace logtail {
+
+// AdaptiveCompressPolicy picks the compress type and level of each logstore by CPU headroom and the network cost
+// of its region, only if LZ4 or ZSTD is configured.
+//
+// - Regions sending to intranet or inner endpoints keep the configured type.
+// - For public endpoints, LZ4 is used if CPU is busy, a high ZSTD level if CPU is idle, a low level otherwise.
+// - Compression ratio and cost are sampled for each option of a logstore, an option steps down if it saves
+//   little more size than the cheaper one, or costs much more CPU when CPU is not idle. Options with samples
+//   older than adaptive_compress_sample_interval seconds are tried again once, so samples follow the data.
+class AdaptiveCompressPolicy {
+public:
+    static AdaptiveCompressPolicy* GetInstance() {
+        static AdaptiveCompressPolicy* instance = new AdaptiveCompressPolicy();
+        return instance;
+    }
+
+    // Select returns the compress type for data of @key in @region and sets @level for ZSTD.
+    sls_logs::SlsCompressType Select(LogstoreFeedBackKey key,
+                                     const std::string& region,
+                                     sls_logs::SlsCompressType configType,
+                                     int32_t& level,
+                                     int32_t curTime);
+    // OnCompressed records that @rawSize bytes are compressed into @compressedSize bytes taking @costUs.
+    void OnCompressed(LogstoreFeedBackKey key,
+                      sls_logs::SlsCompressType type,
+                      int32_t level,
+                      uint32_t rawSize,
+                      size_t compressedSize,
+                      uint64_t costUs,
+                      int32_t curTime);
+
+    // OnSendSuccess records that data of @region is sent to @endpoint.
+    void OnSendSuccess(const std::string& region, const std::string& endpoint);
+    // SetCpuLevel sets the CPU usage relative to the limit, updated by LogtailMonitor.
+    void SetCpuLevel(double level) { mCpuLevel.store(level, std::memory_order_relaxed); }
+
+private:
+    enum Option { OPTION_LZ4 = 0, OPTION_ZSTD_LOW, OPTION_ZSTD_HIGH, OPTION_COUNT };
+
+    struct Sample {
+        double mRatio = 0.0; // EWMA of compressed size / raw size
+        double mCostUsPerKB = 0.0; // EWMA of compress time per KB of raw data
+        int32_t mTime = 0; // time of the latest sample, or of the latest try
+        bool mValid = false;
+    };
+
+    struct LogstoreState {
+        Sample mSamples[OPTION_COUNT];
+    };
+
+    static Option ByCpuLevel(double cpuLevel);
+    // StepDown returns the cheapest option not worse than @option by samples of @state.
+    static Option StepDown(const LogstoreState& state, Option option, double cpuLevel);
+    static int32_t GetLevel(Option option);
+    static Option ToOption(sls_logs::SlsCompressType type, int32_t level);
+
+    struct RegionInfo {
+        std::string mEndpoint;
+        bool mPublic = false;
+    };
+
+    std::mutex mMux;
+    std::unordered_map<LogstoreFeedBackKey, LogstoreState> mLogstoreStates;
+    std::unordered_map<std::string, RegionInfo> mRegionInfos; // endpoint of the latest success of each region
+    std::atomic<double> mCpuLevel{0.0};
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class AdaptiveCompressPolicyUnittest;
+#endif
+};
+
+} // namespace logtail
@@ -0,0 +1,73 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "BufferFileIndex.h"
+#include <cstring>
+#include "common/HashUtil.h"
+
+namespace logtail {
+
+namespace {
+
+    const uint64_t kIndexMagic = 0x5844494646554253ULL; // "SBUFFIDX"
+
+} // namespace
+
+std::string BufferFileIndex::Serialize(int64_t indexOffset) const {
+    const size_t offsetsSize = mBlockOffsets.size() * sizeof(int64_t);
+    std::string data(offsetsSize + sizeof(Trailer), '\0');
+    if (offsetsSize > 0) {
+        memcpy(&data[0], mBlockOffsets.data(), offsetsSize);
+    }
+    Trailer trailer;
+    trailer.mIndexOffset = indexOffset;
+    trailer.mChecksum = HashString(data.data(), offsetsSize, kHashStringSeed);
+    trailer.mBlockCount = static_cast<int32_t>(mBlockOffsets.size());
+    trailer.mReserved = 0;
+    trailer.mMagic = kIndexMagic;
+    memcpy(&data[offsetsSize], &trailer, sizeof(Trailer));
+    return data;
+}
+
+bool BufferFileIndex::CheckTrailer(const Trailer& trailer, int64_t fileSize, size_t blockMetaSize) {
+    if (trailer.mMagic != kIndexMagic || trailer.mBlockCount < 0 || trailer.mIndexOffset < 0) {
+        return false;
+    }
+    const int64_t indexSize = static_cast<int64_t>(blockMetaSize)
+        + static_cast<int64_t>(trailer.mBlockCount) * static_cast<int64_t>(sizeof(int64_t))
+        + static_cast<int64_t>(sizeof(Trailer));
+    return trailer.mIndexOffset + indexSize == fileSize;
+}
+
+bool BufferFileIndex::Parse(const char* data, size_t size, const Trailer& trailer) {
+    mBlockOffsets.clear();
+    if (size != static_cast<size_t>(trailer.mBlockCount) * sizeof(int64_t)
+        || HashString(data, size, kHashStringSeed) != trailer.mChecksum) {
+        return false;
+    }
+    mBlockOffsets.resize(trailer.mBlockCount);
+    if (size > 0) {
+        memcpy(mBlockOffsets.data(), data, size);
+    }
+    for (size_t i = 0; i < mBlockOffsets.size(); ++i) {
+        if (mBlockOffsets[i] < 0 || mBlockOffsets[i] >= trailer.mIndexOffset
+            || (i > 0 && mBlockOffsets[i] <= mBlockOffsets[i - 1])) {
+            mBlockOffsets.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace logtail
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace logtail {
+
+// BufferFileIndex is the block index appended to a buffer file when the file is sealed. It records
+// the offset of each block (meta, buffer meta and encrypted log data), so blocks can be replayed by
+// several readers without scanning the file first.
+//
+// The index is written as the data of a block marked as handled, which older versions skip, and the
+// data ends with a fixed size trailer to locate it from the end of file:
+//   | block meta | offset of block 0 | ... | offset of block n-1 | Trailer |
+// Files without a valid index, e.g. not sealed because of restart, are scanned block by block.
+class BufferFileIndex {
+public:
+    struct Trailer {
+        int64_t mIndexOffset; // offset of the index block
+        int64_t mChecksum; // checksum of block offsets
+        int32_t mBlockCount;
+        int32_t mReserved;
+        uint64_t mMagic;
+    };
+
+    void Reset() { mBlockOffsets.clear(); }
+    void AddBlock(int64_t offset) { mBlockOffsets.push_back(offset); }
+    const std::vector<int64_t>& GetBlockOffsets() const { return mBlockOffsets; }
+
+    // Serialize returns data of the index block, which is written at @indexOffset.
+    std::string Serialize(int64_t indexOffset) const;
+
+    // CheckTrailer returns true if @trailer read from the end of a file of @fileSize is valid,
+    // @blockMetaSize is the size of the meta before data of the index block.
+    static bool CheckTrailer(const Trailer& trailer, int64_t fileSize, size_t blockMetaSize);
+    // Parse loads block offsets from [@data, @data + @size), which is read right before @trailer.
+    bool Parse(const char* data, size_t size, const Trailer& trailer);
+
+private:
+    std::vector<int64_t> mBlockOffsets;
+};
+
+} // namespace logtail
@@ -0,0 +1,362 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ColumnarLogGroup.h"
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "common/Flags.h"
+#include "common/StringTools.h"
+
+DEFINE_FLAG_STRING(columnar_log_group_regions,
+                   "regions whose endpoints accept columnar log groups, separated by comma",
+                   "");
+
+namespace logtail {
+
+const char ColumnarLogGroup::kMagic[4] = {'S', 'L', 'C', '1'};
+
+namespace {
+
+    enum ColumnMode : uint8_t { COLUMN_PLAIN = 0, COLUMN_DICTIONARY = 1 };
+
+    // A column uses the dictionary if each distinct value appears this many times on average.
+    const size_t kDictionaryMinRepeat = 4;
+
+    void PutVarint(std::string& out, uint64_t value) {
+        char buf[10];
+        size_t len = 0;
+        while (value >= 0x80) {
+            buf[len++] = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        buf[len++] = static_cast<char>(value);
+        out.append(buf, len);
+    }
+
+    void PutString(std::string& out, const std::string& str) {
+        PutVarint(out, str.size());
+        out.append(str);
+    }
+
+    uint64_t ZigZag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+
+    int64_t UnZigZag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+    class Reader {
+    public:
+        Reader(const char* data, size_t size) : mPos(data), mEnd(data + size) {}
+
+        bool GetVarint(uint64_t& value) {
+            value = 0;
+            for (int shift = 0; shift < 64 && mPos < mEnd; shift += 7) {
+                uint8_t byte = static_cast<uint8_t>(*mPos++);
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // GetCount reads a count of items taking at least one byte each, so a corrupted count fails early.
+        bool GetCount(uint64_t& count) { return GetVarint(count) && count <= static_cast<uint64_t>(mEnd - mPos); }
+
+        bool GetString(const char*& data, size_t& size) {
+            uint64_t len = 0;
+            if (!GetVarint(len) || len > static_cast<uint64_t>(mEnd - mPos)) {
+                return false;
+            }
+            data = mPos;
+            size = static_cast<size_t>(len);
+            mPos += len;
+            return true;
+        }
+
+        bool GetString(std::string& str) {
+            const char* data = NULL;
+            size_t size = 0;
+            if (!GetString(data, size)) {
+                return false;
+            }
+            str.assign(data, size);
+            return true;
+        }
+
+        bool End() const { return mPos == mEnd; }
+
+    private:
+        const char* mPos;
+        const char* mEnd;
+    };
+
+    void PutColumn(std::string& out, const std::vector<const std::string*>& values) {
+        std::unordered_map<std::string, uint32_t> dictionary;
+        std::vector<uint32_t> indexes;
+        const size_t maxDictionarySize = values.size() / kDictionaryMinRepeat;
+        bool useDictionary = maxDictionarySize > 0;
+        if (useDictionary) {
+            indexes.reserve(values.size());
+            for (const std::string* value : values) {
+                auto iter = dictionary.insert(std::make_pair(*value, static_cast<uint32_t>(dictionary.size()))).first;
+                if (dictionary.size() > maxDictionarySize) {
+                    useDictionary = false;
+                    break;
+                }
+                indexes.push_back(iter->second);
+            }
+        }
+        if (!useDictionary) {
+            out.push_back(static_cast<char>(COLUMN_PLAIN));
+            for (const std::string* value : values) {
+                PutString(out, *value);
+            }
+            return;
+        }
+        out.push_back(static_cast<char>(COLUMN_DICTIONARY));
+        std::vector<const std::string*> entries(dictionary.size());
+        for (const auto& entry : dictionary) {
+            entries[entry.second] = &entry.first;
+        }
+        PutVarint(out, entries.size());
+        for (const std::string* entry : entries) {
+            PutString(out, *entry);
+        }
+        for (uint32_t index : indexes) {
+            PutVarint(out, index);
+        }
+    }
+
+    std::mutex sRegionMutex;
+    std::string sRegionsFlag;
+    std::unordered_set<std::string> sEnabledRegions;
+    std::unordered_set<std::string> sDisabledRegions;
+
+} // namespace
+
+bool ColumnarLogGroup::Encode(const sls_logs::LogGroup& logGroup, std::string& out) {
+    out.clear();
+    out.append(kMagic, sizeof(kMagic));
+
+    sls_logs::LogGroup header;
+    if (logGroup.has_category()) {
+        header.set_category(logGroup.category());
+    }
+    if (logGroup.has_topic()) {
+        header.set_topic(logGroup.topic());
+    }
+    if (logGroup.has_source()) {
+        header.set_source(logGroup.source());
+    }
+    if (logGroup.has_machineuuid()) {
+        header.set_machineuuid(logGroup.machineuuid());
+    }
+    header.mutable_logtags()->CopyFrom(logGroup.logtags());
+    PutString(out, header.SerializeAsString());
+
+    std::unordered_map<std::string, uint32_t> keyIndexes;
+    std::vector<const std::string*> keys;
+    std::vector<std::vector<const std::string*>> columns;
+    std::unordered_map<std::string, uint32_t> schemaIndexes;
+    std::vector<const std::string*> schemas;
+    std::vector<uint32_t> logSchemas(logGroup.logs_size());
+    std::string schema;
+    for (int i = 0; i < logGroup.logs_size(); ++i) {
+        const sls_logs::Log& log = logGroup.logs(i);
+        schema.clear();
+        PutVarint(schema, log.contents_size());
+        for (int k = 0; k < log.contents_size(); ++k) {
+            const sls_logs::Log_Content& content = log.contents(k);
+            auto iter = keyIndexes.find(content.key());
+            if (iter == keyIndexes.end()) {
+                iter = keyIndexes.insert(std::make_pair(content.key(), static_cast<uint32_t>(keys.size()))).first;
+                keys.push_back(&iter->first);
+                columns.emplace_back();
+            }
+            PutVarint(schema, iter->second);
+            columns[iter->second].push_back(&content.value());
+        }
+        auto iter = schemaIndexes.find(schema);
+        if (iter == schemaIndexes.end()) {
+            iter = schemaIndexes.insert(std::make_pair(schema, static_cast<uint32_t>(schemas.size()))).first;
+            schemas.push_back(&iter->first);
+        }
+        logSchemas[i] = iter->second;
+    }
+
+    PutVarint(out, keys.size());
+    for (const std::string* key : keys) {
+        PutString(out, *key);
+    }
+    PutVarint(out, schemas.size());
+    for (const std::string* item : schemas) {
+        out.append(*item);
+    }
+    PutVarint(out, logGroup.logs_size());
+    int64_t lastTime = 0;
+    for (int i = 0; i < logGroup.logs_size(); ++i) {
+        int64_t time = logGroup.logs(i).time();
+        PutVarint(out, logSchemas[i]);
+        PutVarint(out, ZigZag(time - lastTime));
+        lastTime = time;
+    }
+    for (const auto& column : columns) {
+        PutColumn(out, column);
+    }
+    return out.size() < logGroup.ByteSizeLong();
+}
+
+bool ColumnarLogGroup::Decode(const char* data, size_t size, sls_logs::LogGroup& logGroup) {
+    logGroup.Clear();
+    if (size < sizeof(kMagic) || memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+    Reader reader(data + sizeof(kMagic), size - sizeof(kMagic));
+    const char* headerData = NULL;
+    size_t headerSize = 0;
+    if (!reader.GetString(headerData, headerSize) || !logGroup.ParseFromArray(headerData, headerSize)) {
+        return false;
+    }
+
+    uint64_t keyCount = 0;
+    if (!reader.GetCount(keyCount)) {
+        return false;
+    }
+    std::vector<std::string> keys(keyCount);
+    for (std::string& key : keys) {
+        if (!reader.GetString(key)) {
+            return false;
+        }
+    }
+    uint64_t schemaCount = 0;
+    if (!reader.GetCount(schemaCount)) {
+        return false;
+    }
+    std::vector<std::vector<uint32_t>> schemas(schemaCount);
+    for (auto& schema : schemas) {
+        uint64_t count = 0;
+        if (!reader.GetCount(count)) {
+            return false;
+        }
+        schema.resize(count);
+        for (uint32_t& keyIndex : schema) {
+            uint64_t index = 0;
+            if (!reader.GetVarint(index) || index >= keyCount) {
+                return false;
+            }
+            keyIndex = static_cast<uint32_t>(index);
+        }
+    }
+
+    uint64_t logCount = 0;
+    if (!reader.GetCount(logCount)) {
+        return false;
+    }
+    std::vector<uint32_t> logSchemas(logCount);
+    std::vector<size_t> columnSizes(keyCount, 0);
+    int64_t time = 0;
+    logGroup.mutable_logs()->Reserve(static_cast<int>(logCount));
+    for (uint64_t i = 0; i < logCount; ++i) {
+        uint64_t schemaIndex = 0, timeDelta = 0;
+        if (!reader.GetVarint(schemaIndex) || schemaIndex >= schemaCount || !reader.GetVarint(timeDelta)) {
+            return false;
+        }
+        time += UnZigZag(timeDelta);
+        logSchemas[i] = static_cast<uint32_t>(schemaIndex);
+        sls_logs::Log* log = logGroup.add_logs();
+        log->set_time(static_cast<uint32_t>(time));
+        const std::vector<uint32_t>& schema = schemas[schemaIndex];
+        log->mutable_contents()->Reserve(static_cast<int>(schema.size()));
+        for (uint32_t keyIndex : schema) {
+            log->add_contents()->set_key(keys[keyIndex]);
+            ++columnSizes[keyIndex];
+        }
+    }
+
+    // Values of a column are filled into logs in order, positions are walked by per column cursors.
+    std::vector<std::vector<std::string*>> columns(keyCount);
+    for (uint64_t k = 0; k < keyCount; ++k) {
+        columns[k].reserve(columnSizes[k]);
+    }
+    for (uint64_t i = 0; i < logCount; ++i) {
+        sls_logs::Log* log = logGroup.mutable_logs(static_cast<int>(i));
+        const std::vector<uint32_t>& schema = schemas[logSchemas[i]];
+        for (size_t k = 0; k < schema.size(); ++k) {
+            columns[schema[k]].push_back(log->mutable_contents(static_cast<int>(k))->mutable_value());
+        }
+    }
+    for (auto& column : columns) {
+        uint64_t mode = 0;
+        if (!reader.GetVarint(mode)) {
+            return false;
+        }
+        if (mode == COLUMN_PLAIN) {
+            for (std::string* value : column) {
+                if (!reader.GetString(*value)) {
+                    return false;
+                }
+            }
+        } else if (mode == COLUMN_DICTIONARY) {
+            uint64_t dictionarySize = 0;
+            if (!reader.GetCount(dictionarySize)) {
+                return false;
+            }
+            std::vector<std::string> dictionary(dictionarySize);
+            for (std::string& entry : dictionary) {
+                if (!reader.GetString(entry)) {
+                    return false;
+                }
+            }
+            for (std::string* value : column) {
+                uint64_t index = 0;
+                if (!reader.GetVarint(index) || index >= dictionarySize) {
+                    return false;
+                }
+                *value = dictionary[index];
+            }
+        } else {
+            return false;
+        }
+    }
+    return reader.End();
+}
+
+bool ColumnarLogGroup::IsEnabled(const std::string& region) {
+    const std::string& regions = STRING_FLAG(columnar_log_group_regions);
+    if (regions.empty()) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(sRegionMutex);
+    if (sRegionsFlag != regions) {
+        sRegionsFlag = regions;
+        sEnabledRegions.clear();
+        for (const std::string& item : SplitString(regions, ",")) {
+            std::string name = TrimString(item);
+            if (!name.empty()) {
+                sEnabledRegions.insert(name);
+            }
+        }
+    }
+    return sEnabledRegions.find(region) != sEnabledRegions.end()
+        && sDisabledRegions.find(region) == sDisabledRegions.end();
+}
+
+void ColumnarLogGroup::Disable(const std::string& region) {
+    std::lock_guard<std::mutex> lock(sRegionMutex);
+    sDisabledRegions.insert(region);
+}
+
+} // namespace logtail
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstddef>
+#include <string>
+#include "log_pb/sls_logs.pb.h"
+
+namespace logtail {
+
+// ColumnarLogGroup is an optional wire format of LogGroup for endpoints accepting it. Keys are stored once
+// in a key table, each log refers to a schema (sequence of key indexes), and values are stored per key, with
+// a dictionary for columns of low cardinality. The layout is
+//
+//   magic | header | keys | schemas | logs (schema index, time delta) | columns
+//
+// where header is the serialized LogGroup without logs, and all integers are varints. Decode restores the
+// original LogGroup, including the order of contents in each log.
+//
+// Endpoints are opted in by columnar_log_group_regions. A region is disabled once its server rejects the
+// format, and the rejected data is converted back to rows and retried.
+class ColumnarLogGroup {
+public:
+    static const char kMagic[4];
+
+    // Encode writes @logGroup into @out, it returns false if the columnar format is not smaller.
+    static bool Encode(const sls_logs::LogGroup& logGroup, std::string& out);
+    // Decode parses @data written by Encode into @logGroup, it returns false if @data is malformed.
+    static bool Decode(const char* data, size_t size, sls_logs::LogGroup& logGroup);
+
+    static bool IsEnabled(const std::string& region);
+    static void Disable(const std::string& region);
+};
+
+} // namespace logtail
@@ -0,0 +1,103 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CompressWorkerPool.h"
+
+namespace logtail {
+
+CompressWorkerPool::CompressWorkerPool(size_t threadCount, size_t capacity)
+    : mCapacity(capacity > 0 ? capacity : 1) {
+    for (size_t i = 0; i < threadCount; ++i) {
+        mThreads.push_back(CreateThread([this]() { Run(); }));
+    }
+}
+
+CompressWorkerPool::~CompressWorkerPool() {
+    WaitEmpty();
+    {
+        std::lock_guard<std::mutex> lock(mMux);
+        mStopped = true;
+    }
+    mTaskCond.notify_all();
+    mThreads.clear();
+}
+
+void CompressWorkerPool::Submit(std::function<void()> compress, std::function<void()> emit) {
+    std::shared_ptr<Task> task(new Task);
+    task->mCompress = std::move(compress);
+    task->mEmit = std::move(emit);
+    if (mThreads.empty()) {
+        task->mCompress();
+        task->mEmit();
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mMux);
+    mSpaceCond.wait(lock, [this]() { return mTasks.size() < mCapacity; });
+    mTasks.push_back(task);
+    mWaitingTasks.push_back(task);
+    lock.unlock();
+    mTaskCond.notify_one();
+}
+
+size_t CompressWorkerPool::GetPendingCount() {
+    std::lock_guard<std::mutex> lock(mMux);
+    return mTasks.size();
+}
+
+void CompressWorkerPool::WaitEmpty() {
+    std::unique_lock<std::mutex> lock(mMux);
+    mSpaceCond.wait(lock, [this]() { return mTasks.empty(); });
+}
+
+void CompressWorkerPool::Run() {
+    std::unique_lock<std::mutex> lock(mMux);
+    while (true) {
+        mTaskCond.wait(lock, [this]() { return mStopped || !mWaitingTasks.empty(); });
+        if (mWaitingTasks.empty()) {
+            return;
+        }
+        std::shared_ptr<Task> task = mWaitingTasks.front();
+        mWaitingTasks.pop_front();
+        lock.unlock();
+        task->mCompress();
+        task->mCompress = nullptr;
+        lock.lock();
+        task->mDone = true;
+        EmitReady(lock);
+    }
+}
+
+void CompressWorkerPool::EmitReady(std::unique_lock<std::mutex>& lock) {
+    // The emitting thread checks the front again before it stops, finished tasks are never missed.
+    if (mEmitting) {
+        return;
+    }
+    mEmitting = true;
+    bool emitted = false;
+    while (!mTasks.empty() && mTasks.front()->mDone) {
+        // Popped after emitted, so WaitEmpty returns after the last emit is done.
+        std::shared_ptr<Task> task = mTasks.front();
+        lock.unlock();
+        task->mEmit();
+        lock.lock();
+        mTasks.pop_front();
+        emitted = true;
+    }
+    mEmitting = false;
+    if (emitted) {
+        mSpaceCond.notify_all();
+    }
+}
+
+} // namespace logtail
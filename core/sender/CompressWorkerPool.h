@@ -0,0 +1,71 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <boost/thread.hpp>
+#include "common/Thread.h"
+
+namespace logtail {
+
+// CompressWorkerPool runs the compress step of tasks on worker threads in parallel, and
+// the emit step of tasks one at a time in submit order, so data of the same logstore is
+// pushed into sender queue in the order it is merged.
+//
+// Submit blocks while the number of tasks not emitted yet reaches the capacity.
+class CompressWorkerPool {
+public:
+    CompressWorkerPool(size_t threadCount, size_t capacity);
+    ~CompressWorkerPool();
+
+    void Submit(std::function<void()> compress, std::function<void()> emit);
+
+    // GetPendingCount returns the number of tasks submitted but not emitted yet.
+    size_t GetPendingCount();
+
+    // WaitEmpty blocks until all submitted tasks are emitted.
+    void WaitEmpty();
+
+    size_t GetThreadCount() const { return mThreads.size(); }
+
+private:
+    struct Task {
+        std::function<void()> mCompress;
+        std::function<void()> mEmit;
+        bool mDone = false;
+    };
+
+    void Run();
+    // EmitReady emits finished tasks at the front, only one thread emits at a time.
+    void EmitReady(std::unique_lock<std::mutex>& lock);
+
+    const size_t mCapacity;
+    std::mutex mMux;
+    std::condition_variable mTaskCond;
+    std::condition_variable mSpaceCond;
+    std::deque<std::shared_ptr<Task>> mTasks; // tasks not emitted, in submit order
+    std::deque<std::shared_ptr<Task>> mWaitingTasks; // tasks not compressed
+    bool mEmitting = false;
+    bool mStopped = false;
+    std::vector<ThreadPtr> mThreads;
+};
+
+} // namespace logtail
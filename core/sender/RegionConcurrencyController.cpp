@@ -0,0 +1,137 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RegionConcurrencyController.h"
+#include <algorithm>
+#include "common/Flags.h"
+#include "logger/Logger.h"
+
+DEFINE_FLAG_BOOL(enable_region_concurrency_control,
+                 "control send concurrency of each region by latency and errors, instead of fixed steps",
+                 false);
+DEFINE_FLAG_INT32(region_concurrency_adjust_interval_ms, "min interval to adjust region concurrency", 1000);
+DEFINE_FLAG_INT32(region_concurrency_initial, "concurrency of a region before slow start", 8);
+DEFINE_FLAG_INT32(region_concurrency_rtt_window, "interval to reset the RTT estimate of a region, seconds", 300);
+DEFINE_FLAG_DOUBLE(region_concurrency_rtt_low_ratio, "concurrency grows if p90 latency is within RTT * ratio", 1.5);
+DEFINE_FLAG_DOUBLE(region_concurrency_rtt_high_ratio, "concurrency shrinks if p90 latency exceeds RTT * ratio", 3.0);
+DEFINE_FLAG_DOUBLE(region_concurrency_decrease_factor, "concurrency is multiplied by it on failures", 0.7);
+
+namespace logtail {
+
+namespace {
+
+    // Latencies are kept for the p90 of an interval, more samples do not change it much.
+    const size_t kMaxLatencySamples = 256;
+    const size_t kMinLatencySamples = 4;
+    const double kQueueingShrinkFactor = 0.9;
+
+} // namespace
+
+RegionConcurrencyController::RegionState& RegionConcurrencyController::GetState(const std::string& region,
+                                                                                const std::string& endpoint,
+                                                                                int32_t maxLimit,
+                                                                                int64_t nowMs) {
+    RegionState& state = mRegionStates[region];
+    if (state.mLimit <= 0.0) {
+        state.mLimit = std::max(1, std::min(INT32_FLAG(region_concurrency_initial), maxLimit));
+        state.mLastAdjustTimeMs = nowMs;
+    }
+    if (state.mEndpoint != endpoint) {
+        // RTT of another endpoint may be quite different.
+        state.mEndpoint = endpoint;
+        state.mMinRttMs = -1;
+        state.mLatencies.clear();
+    }
+    return state;
+}
+
+int32_t RegionConcurrencyController::OnSendSuccess(const std::string& region,
+                                                   const std::string& endpoint,
+                                                   int64_t latencyMs,
+                                                   int32_t maxLimit,
+                                                   int64_t nowMs) {
+    std::lock_guard<std::mutex> lock(mMux);
+    RegionState& state = GetState(region, endpoint, maxLimit, nowMs);
+    // The previous interval is closed before the sample is added.
+    Adjust(state, maxLimit, nowMs);
+    if (latencyMs >= 0) {
+        if (state.mMinRttMs < 0 || latencyMs < state.mMinRttMs
+            || nowMs - state.mMinRttTimeMs >= INT32_FLAG(region_concurrency_rtt_window) * 1000LL) {
+            state.mMinRttMs = latencyMs;
+            state.mMinRttTimeMs = nowMs;
+        }
+        if (state.mLatencies.size() < kMaxLatencySamples) {
+            state.mLatencies.push_back(static_cast<int32_t>(std::min<int64_t>(latencyMs, INT32_MAX)));
+        }
+    }
+    return ToLimit(state, maxLimit);
+}
+
+int32_t RegionConcurrencyController::OnSendFail(const std::string& region,
+                                                const std::string& endpoint,
+                                                int32_t maxLimit,
+                                                int64_t nowMs) {
+    std::lock_guard<std::mutex> lock(mMux);
+    RegionState& state = GetState(region, endpoint, maxLimit, nowMs);
+    // Unlike latencies, a failure counts for the interval being closed, so the limit drops at once.
+    ++state.mFailCount;
+    Adjust(state, maxLimit, nowMs);
+    return ToLimit(state, maxLimit);
+}
+
+int32_t RegionConcurrencyController::GetLimit(const std::string& region, int32_t maxLimit) {
+    std::lock_guard<std::mutex> lock(mMux);
+    auto iter = mRegionStates.find(region);
+    return iter == mRegionStates.end() ? -1 : ToLimit(iter->second, maxLimit);
+}
+
+void RegionConcurrencyController::Adjust(RegionState& state, int32_t maxLimit, int64_t nowMs) {
+    if (nowMs - state.mLastAdjustTimeMs < INT32_FLAG(region_concurrency_adjust_interval_ms)) {
+        return;
+    }
+    const double oldLimit = state.mLimit;
+    int64_t p90 = -1;
+    if (state.mFailCount > 0) {
+        state.mLimit *= DOUBLE_FLAG(region_concurrency_decrease_factor);
+        state.mSlowStart = false;
+    } else if (state.mLatencies.size() >= kMinLatencySamples && state.mMinRttMs >= 0) {
+        const size_t index = state.mLatencies.size() * 9 / 10;
+        std::nth_element(state.mLatencies.begin(), state.mLatencies.begin() + index, state.mLatencies.end());
+        p90 = state.mLatencies[index];
+        // RTT below 1ms is taken as 1ms, so jitter of local endpoints is not taken as queueing.
+        const double rtt = std::max<int64_t>(state.mMinRttMs, 1);
+        if (p90 > rtt * DOUBLE_FLAG(region_concurrency_rtt_high_ratio)) {
+            state.mLimit *= kQueueingShrinkFactor;
+            state.mSlowStart = false;
+        } else if (p90 <= rtt * DOUBLE_FLAG(region_concurrency_rtt_low_ratio)) {
+            state.mLimit = state.mSlowStart ? state.mLimit * 2 : state.mLimit + 1;
+        }
+    }
+    state.mLimit = std::max(1.0, std::min(state.mLimit, static_cast<double>(std::max(maxLimit, 1))));
+    state.mFailCount = 0;
+    state.mLatencies.clear();
+    state.mLastAdjustTimeMs = nowMs;
+    if (static_cast<int32_t>(state.mLimit) != static_cast<int32_t>(oldLimit)) {
+        LOG_DEBUG(sLogger,
+                  ("adjust region concurrency", state.mLimit)("old concurrency", oldLimit)("p90 latency ms", p90)(
+                      "rtt ms", state.mMinRttMs)("endpoint", state.mEndpoint));
+    }
+}
+
+int32_t RegionConcurrencyController::ToLimit(const RegionState& state, int32_t maxLimit) {
+    const int32_t limit = static_cast<int32_t>(state.mLimit);
+    return limit >= maxLimit ? -1 : limit;
+}
+
+} // namespace logtail
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace logtail {
+
+// RegionConcurrencyController finds the limit of in-flight requests of each region by AIMD with latency
+// signals, in the way of TCP Vegas.
+//
+// - RTT is estimated by the smallest latency seen recently, it's reset if the endpoint of a region changes.
+// - If a request fails for server error, network error or quota, the limit is multiplied by a factor below 1.
+// - If the p90 latency of an interval is far above RTT, requests are queueing in the server or the link, and
+//   the limit shrinks a little.
+// - If the p90 latency stays close to RTT, the limit grows by one each interval, or doubles before the first
+//   decrease (slow start).
+//
+// The limit is adjusted at most once per region_concurrency_adjust_interval_ms.
+class RegionConcurrencyController {
+public:
+    static RegionConcurrencyController* GetInstance() {
+        static RegionConcurrencyController* instance = new RegionConcurrencyController();
+        return instance;
+    }
+
+    // OnSendSuccess records a request to @endpoint of @region taking @latencyMs milliseconds, @maxLimit is the
+    // max concurrency. Returns the limit of @region, -1 if it's not less than @maxLimit.
+    int32_t OnSendSuccess(const std::string& region,
+                          const std::string& endpoint,
+                          int64_t latencyMs,
+                          int32_t maxLimit,
+                          int64_t nowMs);
+    // OnSendFail records a request failed for server error, network error or throttling.
+    int32_t OnSendFail(const std::string& region, const std::string& endpoint, int32_t maxLimit, int64_t nowMs);
+
+    // GetLimit returns the current limit of @region, -1 if unknown or not limited.
+    int32_t GetLimit(const std::string& region, int32_t maxLimit);
+
+private:
+    RegionConcurrencyController() = default;
+
+    struct RegionState {
+        std::string mEndpoint;
+        double mLimit = 0.0; // 0 before the first result
+        bool mSlowStart = true;
+        int64_t mMinRttMs = -1;
+        int64_t mMinRttTimeMs = 0;
+        int64_t mLastAdjustTimeMs = 0;
+        uint32_t mFailCount = 0;
+        std::vector<int32_t> mLatencies; // latencies of the current interval, bounded
+    };
+
+    RegionState& GetState(const std::string& region, const std::string& endpoint, int32_t maxLimit, int64_t nowMs);
+    void Adjust(RegionState& state, int32_t maxLimit, int64_t nowMs);
+    static int32_t ToLimit(const RegionState& state, int32_t maxLimit);
+
+    std::mutex mMux;
+    std::unordered_map<std::string, RegionState> mRegionStates;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class RegionConcurrencyControllerUnittest;
+#endif
+};
+
+} // namespace logtail
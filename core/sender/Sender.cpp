@@ -20,6 +20,9 @@
 #if defined(__linux__)
 #include <fcntl.h>
 #include <unistd.h>
+#include <climits>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #endif
 #include "common/Constants.h"
 #include "common/StringTools.h"
@@ -36,19 +39,31 @@
 #include "common/ErrorUtil.h"
 #include "common/RandomUtil.h"
 #include "common/SlidingWindowCounter.h"
+#include "common/StageProfiler.h"
+#include "common/StartupTimeline.h"
 #include "sdk/Client.h"
 #include "sdk/Exception.h"
+#include "log_pb/RawLogGroup.h"
 #include "config/Config.h"
 #include "processor/LogProcess.h"
 #include "processor/LogFilter.h"
 #include "profiler/LogtailAlarm.h"
 #include "profiler/LogIntegrity.h"
-#include "profiler/LogLineCount.h"
+#include "profiler/IntegrityNotifier.h"
 #include "profiler/LogFileProfiler.h"
+#include "profiler/PipelineLatencyProfiler.h"
 #include "app_config/AppConfig.h"
 #include "monitor/Monitor.h"
+#include "monitor/MetricRegistry.h"
 #include "config_manager/ConfigManager.h"
 #include "common/LogFileCollectOffsetIndicator.h"
+#include "AdaptiveBatchPolicy.h"
+#include "AdaptiveCompressPolicy.h"
+#include "ShardRouter.h"
+#include "RegionConcurrencyController.h"
+#include "ColumnarLogGroup.h"
+#include "common/MemoryBudget.h"
+#include "common/ThreadAffinity.h"
 #include "fuse/UlogfsHandler.h"
 
 #ifdef LOGTAIL_RUNTIME_PLUGIN
@@ -59,8 +74,16 @@ using namespace std;
 using namespace sls_logs;
 
 DECLARE_FLAG_INT32(buffer_check_period);
+DECLARE_FLAG_BOOL(enable_pipeline_latency_profile);
+DECLARE_FLAG_BOOL(enable_merge_item_schema_group);
+DECLARE_FLAG_BOOL(enable_region_concurrency_control);
+DECLARE_FLAG_BOOL(enable_adaptive_compress);
+DECLARE_FLAG_BOOL(enable_shard_route);
 DEFINE_FLAG_INT32(quota_exceed_wait_interval, "when daemon buffer thread get quotaExceed error, sleep 5 seconds", 5);
 DEFINE_FLAG_INT32(secondary_buffer_count_limit, "data ready for write buffer file", 20);
+DEFINE_FLAG_INT32(buffer_file_zstd_level,
+                  "zstd level to recompress lz4 log groups with before they are written to buffer file, 0 to disable",
+                  0);
 DEFINE_FLAG_BOOL(enable_mock_send, "if enable mock send in ut", false);
 DEFINE_FLAG_INT32(merge_log_count_limit, "log count in one logGroup at most", 4000);
 DEFINE_FLAG_INT32(buffer_file_alive_interval, "the max alive time of a bufferfile, 5 minutes", 300);
@@ -81,6 +104,16 @@ DEFINE_FLAG_DOUBLE(send_server_error_ratio_smoothing_factor, "", 5.0);
 DEFINE_FLAG_INT32(send_statistic_entry_timeout, "seconds", 7200);
 DEFINE_FLAG_INT32(sls_host_update_interval, "seconds", 5);
 DEFINE_FLAG_INT32(max_send_log_group_size, "bytes", 5 * 1024 * 1024);
+DEFINE_FLAG_INT32(sender_compress_thread_count,
+                  "threads to serialize and compress merged log groups, 0 means the caller thread, -1 means cpu cores",
+                  0);
+DEFINE_FLAG_INT32(sender_compress_queue_size, "max merged log groups waiting for compress threads", 64);
+DEFINE_FLAG_INT32(buffer_file_encrypt_thread_count,
+                  "threads to encrypt log groups written to buffer file, 0 means encrypt in dump thread",
+                  0);
+DEFINE_FLAG_BOOL(enable_buffer_file_fsync, "fsync buffer file after each batch of log groups is written", false);
+DEFINE_FLAG_BOOL(enable_buffer_file_index, "append block index to buffer file when it is sealed", false);
+DEFINE_FLAG_INT32(buffer_file_replay_thread_count, "threads to replay blocks of one buffer file", 1);
 DEFINE_FLAG_BOOL(dump_reduced_send_result, "for performance test", false);
 DEFINE_FLAG_INT32(test_network_normal_interval, "if last check is normal, test network again after seconds ", 30);
 DEFINE_FLAG_INT32(same_topic_merge_send_count,
@@ -100,6 +133,31 @@ DEFINE_FLAG_INT32(sending_cost_time_alarm_interval, "sending log group cost too
 DEFINE_FLAG_INT32(log_group_wait_in_queue_alarm_interval,
                   "log group wait in queue alarm interval, may blocked by concurrency or quota, second",
                   3);
+DEFINE_FLAG_BOOL(enable_sender_token_bucket,
+                 "limit send bytes by token buckets of global, region, project and logstore in sender queue",
+                 false);
+DEFINE_FLAG_INT32(sender_region_max_bytes_per_sec, "max send bytes per second of each region, <= 0 unlimited", 0);
+DEFINE_FLAG_INT32(sender_project_max_bytes_per_sec, "max send bytes per second of each project, <= 0 unlimited", 0);
+DEFINE_FLAG_INT32(sender_logstore_max_bytes_per_sec,
+                  "max send bytes per second of each logstore without its own flow control, <= 0 unlimited",
+                  0);
+DEFINE_FLAG_BOOL(enable_sender_fair_scheduling,
+                 "pop log groups of logstores by weighted deficit round robin in sender queue",
+                 false);
+DEFINE_FLAG_INT32(sender_scheduling_quantum_bytes,
+                  "bytes added to deficit of a logstore with weight 1 in each round of fair scheduling",
+                  64 * 1024);
+DEFINE_FLAG_BOOL(enable_endpoint_probe,
+                 "test all endpoints in background and choose endpoints by latency, only for designated_first",
+                 false);
+DEFINE_FLAG_INT32(endpoint_probe_interval, "interval to test all endpoints in background, seconds", 10);
+DEFINE_FLAG_INT32(endpoint_probe_timeout, "timeout of each background endpoint test, seconds", 3);
+DEFINE_FLAG_DOUBLE(endpoint_switch_latency_ratio,
+                   "switch from default endpoint if its latency is higher than this ratio of the fastest one",
+                   2.0);
+DEFINE_FLAG_BOOL(enable_endpoint_warm_up,
+                 "connect to hosts of recent projects on the new endpoint before switching https clients to it",
+                 true);
 DEFINE_FLAG_STRING(data_endpoint_policy, "policy for switching between data server endpoints, possible options include 'designated_first'(default) and 'designated_locked'", "designated_first");
 
 namespace logtail {
@@ -109,6 +167,9 @@ const int32_t Sender::BUFFER_META_BASE_SIZE = 65536;
 std::atomic_int gNetworkErrorCount{0};
 
 void SendClosure::OnSuccess(sdk::Response* response) {
+    if (!BOOL_FLAG(global_network_success)) {
+        StartupTimeline::GetInstance()->RecordMilestone("first_send_success");
+    }
     BOOL_FLAG(global_network_success) = true;
     Sender::Instance()->SubSendingBufferCount();
     Sender::Instance()->DescSendingCount();
@@ -129,13 +190,7 @@ void SendClosure::OnSuccess(sdk::Response* response) {
     if (BOOL_FLAG(e2e_send_throughput_test))
         Sender::Instance()->DumpDebugFile(mDataPtr, true);
 
-    if (mDataPtr->mLogGroupContext.mIntegrityConfigPtr.get() != NULL
-        && mDataPtr->mLogGroupContext.mIntegrityConfigPtr->mIntegritySwitch)
-        LogIntegrity::GetInstance()->Notify(mDataPtr, true);
-
-    if (mDataPtr->mLogGroupContext.mLineCountConfigPtr.get() != NULL
-        && mDataPtr->mLogGroupContext.mLineCountConfigPtr->mLineCountSwitch)
-        LogLineCount::GetInstance()->NotifySuccess(mDataPtr);
+    IntegrityNotifier::GetInstance()->Notify(mDataPtr, true);
 
     if (mDataPtr->mLogGroupContext.mMarkOffsetFlag) {
         LogFileCollectOffsetIndicator::GetInstance()->NotifySuccess(mDataPtr);
@@ -148,13 +203,81 @@ void SendClosure::OnSuccess(sdk::Response* response) {
         LOG_DEBUG(sLogger, ("increase sequence id", cpt->key)("checkpoint", cpt->data.DebugString()));
     }
 
-    Sender::Instance()->IncreaseRegionConcurrency(mDataPtr->mRegion);
+    Sender::Instance()->RecordSendHistograms(mDataPtr);
+    if (BOOL_FLAG(enable_pipeline_latency_profile)) {
+        PipelineLatencyProfiler::GetInstance()->Record(mDataPtr, GetSteadyTimeInMilliSeconds());
+    }
+    Sender::Instance()->IncreaseRegionConcurrency(mDataPtr->mRegion,
+                                                  mDataPtr->mCurrentEndpoint,
+                                                  GetCurrentTimeInMilliSeconds() - mDataPtr->mLastSendTimeInMs);
     Sender::Instance()->IncTotalSendStatistic(mDataPtr->mProjectName, mDataPtr->mLogstore, time(NULL));
+    AdaptiveBatchPolicy::GetInstance()->OnSendSuccess(
+        mDataPtr->mRegion, GetCurrentTimeInMilliSeconds() - mDataPtr->mLastSendTimeInMs, time(NULL));
+    if (BOOL_FLAG(enable_adaptive_compress)) {
+        AdaptiveCompressPolicy::GetInstance()->OnSendSuccess(mDataPtr->mRegion, mDataPtr->mCurrentEndpoint);
+    }
     Sender::Instance()->OnSendDone(mDataPtr, LogstoreSenderInfo::SendResult_OK); // mDataPtr is released here
 
     delete this;
 }
 
+// SerializeLogGroup serializes @logGroup into a scratch buffer owned by current thread,
+// the returned data is valid until next call in the same thread. Reusing the buffer saves
+// allocating and zero filling a new string of several MB for each log group before compression.
+static const char* SerializeLogGroup(const sls_logs::LogGroup& logGroup, uint32_t& size) {
+    static thread_local std::string sBuffer;
+    size = static_cast<uint32_t>(logGroup.ByteSizeLong());
+    if (sBuffer.size() > static_cast<size_t>(INT32_FLAG(max_send_log_group_size)) * 2
+        && size <= static_cast<uint32_t>(INT32_FLAG(max_send_log_group_size))) {
+        std::string().swap(sBuffer);
+    }
+    if (sBuffer.size() < size) {
+        sBuffer.resize(size);
+    }
+    logGroup.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t*>(&sBuffer[0]));
+    return sBuffer.data();
+}
+
+// ConvertColumnarToRow rewrites columnar data of @value as a compressed LogGroup, for endpoints
+// rejecting the columnar format and for buffer files, which are always replayed as LogGroup.
+static bool ConvertColumnarToRow(LoggroupTimeValue* value) {
+    std::string columnar;
+    sls_logs::LogGroup logGroup;
+    sls_logs::SlsCompressType compressType = value->mLogGroupContext.mCompressType;
+    if (!UncompressData(compressType, value->mLogData, value->mRawSize, columnar)
+        || !ColumnarLogGroup::Decode(columnar.data(), columnar.size(), logGroup)) {
+        return false;
+    }
+    uint32_t size = 0;
+    const char* data = SerializeLogGroup(logGroup, size);
+    if (!CompressData(compressType, data, size, value->mLogData)) {
+        return false;
+    }
+    value->mRawSize = size;
+    value->mColumnar = false;
+    return true;
+}
+
+// RecompressForBufferFile recompresses LZ4 log groups of @value with zstd of buffer_file_zstd_level, buffer files
+// keep the compress type of each log group, so fewer bytes are encrypted and written. The data is left unchanged
+// if zstd does not make it smaller.
+static void RecompressForBufferFile(LoggroupTimeValue* value) {
+    const int32_t level = INT32_FLAG(buffer_file_zstd_level);
+    if (level <= 0 || value->mDataType != LOGGROUP_COMPRESSED
+        || value->mLogGroupContext.mCompressType != sls_logs::SLS_CMP_LZ4) {
+        return;
+    }
+    std::string oriData;
+    std::string zstdData;
+    Compressor* compressor = GetThreadCompressor(sls_logs::SLS_CMP_ZSTD, level);
+    if (!UncompressData(sls_logs::SLS_CMP_LZ4, value->mLogData, value->mRawSize, oriData) || compressor == NULL
+        || !compressor->Compress(oriData, zstdData) || zstdData.size() >= value->mLogData.size()) {
+        return;
+    }
+    value->mLogData.swap(zstdData);
+    value->mLogGroupContext.mCompressType = sls_logs::SLS_CMP_ZSTD;
+}
+
 static const char* GetOperationString(OperationOnFail op) {
     switch (op) {
         case RETRY_ASYNC_WHEN_FAIL:
@@ -172,10 +295,9 @@ void SendClosure::OnFail(sdk::Response* response, const string& errorCode, const
     LOG_DEBUG(sLogger, ("send failed, error code", errorCode)("error msg", errorMessage));
 
     // added by xianzhi(bowen.gbw@antfin.com)
-    if (mDataPtr->mLogGroupContext.mIntegrityConfigPtr.get() != NULL
-        && mDataPtr->mLogGroupContext.mIntegrityConfigPtr->mIntegritySwitch)
-        LogIntegrity::GetInstance()->Notify(mDataPtr, false);
+    IntegrityNotifier::GetInstance()->Notify(mDataPtr, false);
 
+    Sender::Instance()->RecordSendHistograms(mDataPtr);
     mDataPtr->mSendRetryTimes++;
     int32_t curTime = time(NULL);
     OperationOnFail operation;
@@ -183,7 +305,20 @@ void SendClosure::OnFail(sdk::Response* response, const string& errorCode, const
     SendResult sendResult = ConvertErrorCode(errorCode);
     std::ostringstream failDetail, suggestion;
     std::string failEndpoint = mDataPtr->mCurrentEndpoint;
-    if (sendResult == SEND_NETWORK_ERROR || sendResult == SEND_SERVER_ERROR) {
+    if (mDataPtr->mColumnar && (sendResult == SEND_PARAMETER_INVALID || errorCode == sdk::LOGE_INVALID_CONTENTTYPE)) {
+        failDetail << "server does not support columnar log group, will retry with log group";
+        suggestion << "remove region from columnar_log_group_regions";
+        Sender::Instance()->IncTotalSendStatistic(mDataPtr->mProjectName, mDataPtr->mLogstore, curTime);
+        ColumnarLogGroup::Disable(mDataPtr->mRegion);
+        if (ConvertColumnarToRow(mDataPtr)) {
+            operation = RETRY_ASYNC_WHEN_FAIL;
+        } else {
+            LOG_ERROR(sLogger,
+                      ("convert columnar data fail",
+                       "discard data")("projectName", mDataPtr->mProjectName)("logstore", mDataPtr->mLogstore));
+            operation = DISCARD_WHEN_FAIL;
+        }
+    } else if (sendResult == SEND_NETWORK_ERROR || sendResult == SEND_SERVER_ERROR) {
         if (SEND_NETWORK_ERROR == sendResult) {
             gNetworkErrorCount++;
         }
@@ -220,7 +355,7 @@ void SendClosure::OnFail(sdk::Response* response, const string& errorCode, const
             }
             operation = mDataPtr->mBufferOrNot ? RECORD_ERROR_WHEN_FAIL : DISCARD_WHEN_FAIL;
         }
-        Sender::Instance()->ResetRegionConcurrency(mDataPtr->mRegion);
+        Sender::Instance()->ResetRegionConcurrency(mDataPtr->mRegion, mDataPtr->mCurrentEndpoint);
     } else if (sendResult == SEND_QUOTA_EXCEED) {
         BOOL_FLAG(global_network_success) = true;
         if (errorCode == sdk::LOGE_SHARD_WRITE_QUOTA_EXCEED) {
@@ -241,6 +376,7 @@ void SendClosure::OnFail(sdk::Response* response, const string& errorCode, const
         }
         operation = RECORD_ERROR_WHEN_FAIL;
         recordRst = LogstoreSenderInfo::SendResult_QuotaFail;
+        Sender::Instance()->ResetRegionConcurrency(mDataPtr->mRegion, mDataPtr->mCurrentEndpoint, true);
     } else if (sendResult == SEND_UNAUTHORIZED) {
         failDetail << "write unauthorized";
         suggestion << "check https connection to endpoint or access keys provided";
@@ -466,10 +602,26 @@ Sender::Sender() {
     mSenderQueue.SetParam((size_t)(concurrencyCount * 1.5), (size_t)(concurrencyCount * 2), 200);
     LOG_INFO(sLogger, ("Set sender queue param depend value", concurrencyCount));
     new Thread(bind(&Sender::TestNetwork, this)); // be careful: this thread will not stop until process exit
+    if (IsPickEndpointByLatency()) {
+        mProbeClient = new sdk::Client("",
+                                       STRING_FLAG(default_access_key_id),
+                                       STRING_FLAG(default_access_key),
+                                       INT32_FLAG(endpoint_probe_timeout),
+                                       LogFileProfiler::mIpAddr,
+                                       AppConfig::GetInstance()->GetBindInterface());
+        SLSControl::Instance()->SetSlsSendClientCommonParam(mProbeClient);
+        LOG_INFO(sLogger, ("start endpoint probe thread", ""));
+        // be careful: this thread will not stop until process exit
+        new Thread(bind(&Sender::EndpointProbeThread, this));
+    }
     if (BOOL_FLAG(send_prefer_real_ip)) {
         LOG_INFO(sLogger, ("start real ip update thread", ""));
         new Thread(bind(&Sender::RealIpUpdateThread, this)); // be careful: this thread will not stop until process exit
     }
+    if (BOOL_FLAG(enable_shard_route)) {
+        LOG_INFO(sLogger, ("start shard route thread", ""));
+        new Thread(bind(&Sender::ShardRouteThread, this)); // be careful: this thread will not stop until process exit
+    }
     new Thread(bind(&Sender::DaemonSender, this)); // be careful: this thread will not stop until process exit
     new Thread(bind(&Sender::WriteSecondary, this)); // be careful: this thread will not stop until process exit
 }
@@ -589,6 +741,9 @@ bool Sender::DumpDebugFile(LoggroupTimeValue* value, bool sendPerformance) {
     if (BOOL_FLAG(dump_reduced_send_result))
         return WriteToFile(value, sendPerformance);
     else {
+        if (value->mColumnar && !ConvertColumnarToRow(value)) {
+            return false;
+        }
         vector<LogGroup> logGroupVec;
         Sender::ParseLogGroupFromString(value->mLogData, value->mDataType, value->mRawSize, logGroupVec);
         for (vector<LogGroup>::iterator iter = logGroupVec.begin(); iter != logGroupVec.end(); ++iter) {
@@ -599,11 +754,41 @@ bool Sender::DumpDebugFile(LoggroupTimeValue* value, bool sendPerformance) {
     }
 }
 
+// CompressLoggroupData compresses @oriData into data of @value and records the compress time of @value.
+// The compress type of @value may be replaced by AdaptiveCompressPolicy.
+static bool CompressLoggroupData(LoggroupTimeValue* value, const char* oriData, uint32_t oriSize) {
+    StageProfileScope profileScope(value->mConfigName, PROFILE_STAGE_COMPRESS);
+    const uint64_t beginTime = GetCurrentTimeInMicroSeconds();
+    bool rst = false;
+    if (BOOL_FLAG(enable_adaptive_compress)) {
+        AdaptiveCompressPolicy* policy = AdaptiveCompressPolicy::GetInstance();
+        const int32_t curTime = time(NULL);
+        int32_t level = ZSTD_DEFAULT_LEVEL;
+        sls_logs::SlsCompressType& type = value->mLogGroupContext.mCompressType;
+        type = policy->Select(value->mLogstoreKey, value->mRegion, type, level, curTime);
+        Compressor* compressor = GetThreadCompressor(type, level);
+        rst = compressor != NULL && compressor->Compress(oriData, oriSize, value->mLogData);
+        if (rst) {
+            policy->OnCompressed(value->mLogstoreKey,
+                                 type,
+                                 level,
+                                 oriSize,
+                                 value->mLogData.size(),
+                                 GetCurrentTimeInMicroSeconds() - beginTime,
+                                 curTime);
+        }
+    } else {
+        rst = CompressData(value->mLogGroupContext.mCompressType, oriData, oriSize, value->mLogData);
+    }
+    value->mCompressTimeInUs = static_cast<uint32_t>(GetCurrentTimeInMicroSeconds() - beginTime);
+    return rst;
+}
+
 bool Sender::LZ4CompressLogGroup(const sls_logs::LogGroup& logGroup, std::string& compressed, int32_t& rawSize) {
-    string rawData;
-    logGroup.SerializeToString(&rawData);
-    rawSize = rawData.size();
-    if (!CompressLz4(rawData, compressed)) {
+    uint32_t size = 0;
+    const char* rawData = SerializeLogGroup(logGroup, size);
+    rawSize = size;
+    if (!CompressLz4(rawData, size, compressed)) {
         LOG_ERROR(sLogger, ("lz4 compress data", "fail")("logstore", logGroup.category()));
         return false;
     }
@@ -626,6 +811,17 @@ bool Sender::InitSender(void) {
     mBufferDivideTime = time(NULL);
     mCheckPeriod = INT32_FLAG(buffer_check_period);
     mSendBufferThreadId = CreateThread([this]() { DaemonBufferSender(); });
+    if (!mCompressPool) {
+        int32_t compressThreadCount = INT32_FLAG(sender_compress_thread_count);
+        if (compressThreadCount < 0) {
+            compressThreadCount = std::max(1U, boost::thread::hardware_concurrency());
+        }
+        mCompressPool.reset(new CompressWorkerPool(compressThreadCount, INT32_FLAG(sender_compress_queue_size)));
+    }
+    if (!mBufferEncryptPool) {
+        const int32_t encryptThreadCount = std::max(0, INT32_FLAG(buffer_file_encrypt_thread_count));
+        mBufferEncryptPool.reset(new CompressWorkerPool(encryptThreadCount, encryptThreadCount));
+    }
     mSendLastTime[0] = 0;
     mSendLastTime[1] = 0;
     mSendLastByte[0] = 0;
@@ -662,7 +858,8 @@ std::string Sender::GetRegionCurrentEndpoint(const std::string& region) {
     PTScopedLock lock(mRegionEndpointEntryMapLock);
     std::unordered_map<std::string, RegionEndpointEntry*>::iterator iter = mRegionEndpointEntryMap.find(region);
     if (iter != mRegionEndpointEntryMap.end())
-        return (iter->second)->GetCurrentEndpoint();
+        return (iter->second)->GetCurrentEndpoint(IsPickEndpointByLatency(),
+                                                  DOUBLE_FLAG(endpoint_switch_latency_ratio));
     else
         return "";
 }
@@ -756,7 +953,10 @@ sdk::Client* Sender::GetSendClient(const std::string& region, const std::string&
     return sendClient;
 }
 
-bool Sender::ResetSendClientEndpoint(const std::string aliuid, const std::string region, int32_t curTime) {
+bool Sender::ResetSendClientEndpoint(const std::string aliuid,
+                                     const std::string region,
+                                     int32_t curTime,
+                                     sdk::Client* warmUpClient) {
     sdk::Client* sendClient = GetSendClient(region, aliuid, false);
     if (sendClient == nullptr) {
         return false;
@@ -771,6 +971,16 @@ bool Sender::ResetSendClientEndpoint(const std::string aliuid, const std::string
     if (originalEndpoint == endpoint) {
         return false;
     }
+    if (warmUpClient != NULL && BOOL_FLAG(enable_endpoint_warm_up) && sendClient->IsUsingHTTPS()) {
+        warmUpClient->SetSlsHost(endpoint);
+        ResetPort(region, warmUpClient);
+        for (const auto& project : sendClient->GetRecentProjects()) {
+            if (!warmUpClient->WarmUp(project)) {
+                LOG_DEBUG(sLogger, ("warm up endpoint fail, region", region)("endpoint", endpoint)("project", project));
+                break;
+            }
+        }
+    }
     mSenderQueue.OnRegionRecover(region);
     sendClient->SetSlsHost(endpoint);
     ResetPort(region, sendClient);
@@ -866,7 +1076,9 @@ bool Sender::LoadFileToSend(time_t timeLine, std::vector<std::string>& filesToSe
     sort(filesToSend.begin(), filesToSend.end());
     return true;
 }
-bool Sender::ReadNextEncryption(int32_t& pos,
+bool Sender::ReadNextEncryption(FILE* fin,
+                                int64_t fileSize,
+                                int32_t& pos,
                                 const std::string& filename,
                                 std::string& encryption,
                                 EncryptionStateMeta& meta,
@@ -875,29 +1087,10 @@ bool Sender::ReadNextEncryption(int32_t& pos,
     bufferMeta.Clear();
     readResult = false;
     encryption.clear();
-    int retryTimes = 0;
-
-    FILE* fin = NULL;
-    while (true) {
-        retryTimes++;
-        fin = FileReadOnlyOpen(filename.c_str(), "rb");
-        if (fin)
-            break;
-        if (retryTimes >= 3) {
-            string errorStr = ErrnoToString(GetErrno());
-            LogtailAlarm::GetInstance()->SendAlarm(SECONDARY_READ_WRITE_ALARM,
-                                                   string("open file error:") + filename + ",error:" + errorStr);
-            LOG_ERROR(sLogger, ("open file error", filename)("error", errorStr));
-            return false;
-        }
-        usleep(5000);
-    }
-    fseek(fin, 0, SEEK_END);
-    auto const currentSize = ftell(fin);
-    if (currentSize == pos) {
-        fclose(fin);
+    if (pos >= fileSize) {
         return false;
     }
+    const int32_t blockPos = pos;
     fseek(fin, pos, SEEK_SET);
     auto nbytes = fread(static_cast<void*>(&meta), sizeof(char), sizeof(meta), fin);
     if (nbytes != sizeof(meta)) {
@@ -906,11 +1099,10 @@ bool Sender::ReadNextEncryption(int32_t& pos,
                                                string("read encryption file meta error:") + filename
                                                    + ", error:" + errorStr + ", meta.mEncryptionSize:"
                                                    + ToString(meta.mEncryptionSize) + ", nbytes: " + ToString(nbytes)
-                                                   + ", pos: " + ToString(pos) + ", ftell: " + ToString(currentSize));
+                                                   + ", pos: " + ToString(pos) + ", ftell: " + ToString(fileSize));
         LOG_ERROR(sLogger,
                   ("read encryption file meta error",
-                   filename)("error", errorStr)("nbytes", nbytes)("pos", pos)("ftell", currentSize));
-        fclose(fin);
+                   filename)("error", errorStr)("nbytes", nbytes)("pos", pos)("ftell", fileSize));
         return false;
     }
 
@@ -929,13 +1121,11 @@ bool Sender::ReadNextEncryption(int32_t& pos,
         LOG_ERROR(sLogger,
                   ("meta of encryption file invalid", filename)("meta.mEncryptionSize", meta.mEncryptionSize)(
                       "meta.mEncodedInfoSize", meta.mEncodedInfoSize));
-        fclose(fin);
         return false;
     }
 
     pos += sizeof(meta) + encodedInfoSize + meta.mEncryptionSize;
     if ((time(NULL) - meta.mTimeStamp) > INT32_FLAG(log_expire_time) || meta.mHandled == 1) {
-        fclose(fin);
         if (meta.mHandled != 1) {
             LOG_WARNING(sLogger, ("timeout buffer file, meta.mTimeStamp", meta.mTimeStamp));
             LogtailAlarm::GetInstance()->SendAlarm(DISCARD_SECONDARY_ALARM,
@@ -947,7 +1137,6 @@ bool Sender::ReadNextEncryption(int32_t& pos,
     char* buffer = new char[encodedInfoSize + 1];
     nbytes = fread(buffer, sizeof(char), encodedInfoSize, fin);
     if (nbytes != static_cast<size_t>(encodedInfoSize)) {
-        fclose(fin);
         string errorStr = ErrnoToString(GetErrno());
         LogtailAlarm::GetInstance()->SendAlarm(SECONDARY_READ_WRITE_ALARM,
                                                string("read projectname from file error:") + filename
@@ -963,7 +1152,6 @@ bool Sender::ReadNextEncryption(int32_t& pos,
     delete[] buffer;
     if (pbMeta) {
         if (!bufferMeta.ParseFromString(encodedInfo)) {
-            fclose(fin);
             LogtailAlarm::GetInstance()->SendAlarm(SECONDARY_READ_WRITE_ALARM,
                                                    string("parse buffer meta from file error:") + filename);
             LOG_ERROR(sLogger, ("parse buffer meta from file error", filename)("buffer meta", encodedInfo));
@@ -979,7 +1167,6 @@ bool Sender::ReadNextEncryption(int32_t& pos,
     buffer = new char[meta.mEncryptionSize + 1];
     nbytes = fread(buffer, sizeof(char), meta.mEncryptionSize, fin);
     if (nbytes != static_cast<size_t>(meta.mEncryptionSize)) {
-        fclose(fin);
         string errorStr = ErrnoToString(GetErrno());
         LogtailAlarm::GetInstance()->SendAlarm(SECONDARY_READ_WRITE_ALARM,
                                                string("read encryption from file error:") + filename
@@ -992,8 +1179,87 @@ bool Sender::ReadNextEncryption(int32_t& pos,
         return true;
     }
     encryption = string(buffer, meta.mEncryptionSize);
-    readResult = true;
     delete[] buffer;
+    if (bufferMeta.has_checksum() && HashString(encryption) != bufferMeta.checksum()) {
+        LogtailAlarm::GetInstance()->SendAlarm(SECONDARY_READ_WRITE_ALARM,
+                                               string("checksum of encryption mismatch:") + filename
+                                                   + ", pos:" + ToString(blockPos));
+        LOG_ERROR(sLogger, ("checksum of encryption mismatch", filename)("pos", blockPos));
+        encryption.clear();
+        return true;
+    }
+    readResult = true;
+    return true;
+}
+
+namespace {
+
+    FILE* OpenBufferFile(const std::string& filename) {
+        int retryTimes = 0;
+        while (true) {
+            retryTimes++;
+            FILE* fin = FileReadOnlyOpen(filename.c_str(), "rb");
+            if (fin)
+                return fin;
+            if (retryTimes >= 3) {
+                string errorStr = ErrnoToString(GetErrno());
+                LogtailAlarm::GetInstance()->SendAlarm(SECONDARY_READ_WRITE_ALARM,
+                                                       string("open file error:") + filename + ",error:" + errorStr);
+                LOG_ERROR(sLogger, ("open file error", filename)("error", errorStr));
+                return NULL;
+            }
+            usleep(5000);
+        }
+    }
+
+} // namespace
+
+bool Sender::LoadBufferFileBlocks(const std::string& filename, int64_t& fileSize, std::vector<int32_t>& blockOffsets) {
+    FILE* fin = OpenBufferFile(filename);
+    if (!fin)
+        return false;
+    fseek(fin, 0, SEEK_END);
+    fileSize = ftell(fin);
+    const int64_t headerSize = INT32_FLAG(file_encryption_header_length);
+
+    BufferFileIndex::Trailer trailer;
+    const int64_t minIndexedSize = headerSize + sizeof(EncryptionStateMeta) + sizeof(trailer);
+    if (fileSize >= minIndexedSize && fseek(fin, fileSize - sizeof(trailer), SEEK_SET) == 0
+        && fread(&trailer, 1, sizeof(trailer), fin) == sizeof(trailer)
+        && BufferFileIndex::CheckTrailer(trailer, fileSize, sizeof(EncryptionStateMeta))) {
+        string data(static_cast<size_t>(trailer.mBlockCount) * sizeof(int64_t), '\0');
+        BufferFileIndex index;
+        if (fseek(fin, trailer.mIndexOffset + sizeof(EncryptionStateMeta), SEEK_SET) == 0
+            && fread(&data[0], 1, data.size(), fin) == data.size() && index.Parse(data.data(), data.size(), trailer)) {
+            for (int64_t offset : index.GetBlockOffsets()) {
+                if (offset >= headerSize)
+                    blockOffsets.push_back(static_cast<int32_t>(offset));
+            }
+            fclose(fin);
+            return true;
+        }
+        LOG_WARNING(sLogger, ("invalid block index of buffer file", filename)("scan blocks", "instead"));
+    }
+
+    // Not sealed, scan metas of blocks and skip handled ones.
+    int64_t pos = headerSize;
+    EncryptionStateMeta meta;
+    while (pos < fileSize) {
+        int32_t encodedInfoSize = -1;
+        if (fseek(fin, pos, SEEK_SET) == 0 && fread(&meta, 1, sizeof(meta), fin) == sizeof(meta)) {
+            encodedInfoSize = meta.mEncodedInfoSize > BUFFER_META_BASE_SIZE
+                ? meta.mEncodedInfoSize - BUFFER_META_BASE_SIZE
+                : meta.mEncodedInfoSize;
+        }
+        if (encodedInfoSize < 0 || meta.mEncryptionSize < 0) {
+            // Left to ReadNextEncryption to report the error.
+            blockOffsets.push_back(static_cast<int32_t>(pos));
+            break;
+        }
+        if (meta.mHandled != 1)
+            blockOffsets.push_back(static_cast<int32_t>(pos));
+        pos += sizeof(meta) + encodedInfoSize + meta.mEncryptionSize;
+    }
     fclose(fin);
     return true;
 }
@@ -1065,100 +1331,40 @@ void Sender::DaemonBufferSender() {
 }
 
 void Sender::SendEncryptionBuffer(const std::string& filename, int32_t keyVersion) {
-    string encryption;
-    string logData;
-    EncryptionStateMeta meta;
-    bool readResult;
-    bool writeBack = false;
-    int32_t pos = INT32_FLAG(file_encryption_header_length);
-    LogtailBufferMeta bufferMeta;
-    int32_t discardCount = 0;
-    while (ReadNextEncryption(pos, filename, encryption, meta, readResult, bufferMeta)) {
-        logData.clear();
-        bool sendResult = false;
-        if (!readResult || bufferMeta.project().empty()) {
-            if (meta.mHandled == 1)
-                continue;
-            sendResult = true;
-            discardCount++;
+    int64_t fileSize = 0;
+    vector<int32_t> blockOffsets;
+    if (!LoadBufferFileBlocks(filename, fileSize, blockOffsets))
+        return;
+
+    // Blocks are independent of each other, so they can be replayed by several threads.
+    std::atomic_size_t nextBlock{0};
+    std::atomic_int discardCount{0};
+    std::atomic_bool writeBack{false};
+    auto replay = [&]() {
+        FILE* fin = OpenBufferFile(filename);
+        if (!fin) {
+            writeBack = true;
+            return;
         }
-        if (!sendResult) {
-            char* des = new char[meta.mLogDataSize];
-            if (!FileEncryption::GetInstance()->Decrypt(
-                    encryption.c_str(), meta.mEncryptionSize, des, meta.mLogDataSize, keyVersion)) {
-                sendResult = true;
-                discardCount++;
-                LOG_ERROR(sLogger,
-                          ("decrypt error, project_name",
-                           bufferMeta.project())("key_version", keyVersion)("meta.mLogDataSize", meta.mLogDataSize));
-                LogtailAlarm::GetInstance()->SendAlarm(ENCRYPT_DECRYPT_FAIL_ALARM,
-                                                       string("decrypt error, project_name:" + bufferMeta.project()
-                                                              + ", key_version:" + ToString(keyVersion)
-                                                              + ", meta.mLogDataSize:" + ToString(meta.mLogDataSize)));
-            } else {
-                if (bufferMeta.has_logstore())
-                    logData = string(des, meta.mLogDataSize);
-                else {
-                    // compatible to old buffer file (logGroup string), convert to LZ4 compressed
-                    string logGroupStr = string(des, meta.mLogDataSize);
-                    LogGroup logGroup;
-                    if (!logGroup.ParseFromString(logGroupStr)) {
-                        sendResult = true;
-                        LOG_ERROR(sLogger,
-                                  ("parse error from string to loggroup, projectName is", bufferMeta.project()));
-                        discardCount++;
-                        LogtailAlarm::GetInstance()->SendAlarm(
-                            LOG_GROUP_PARSE_FAIL_ALARM,
-                            string("projectName is:" + bufferMeta.project() + ", fileName is:" + filename));
-                    } else if (!CompressLz4(logGroupStr, logData)) {
-                        sendResult = true;
-                        LOG_ERROR(sLogger, ("LZ4 compress loggroup fail, projectName is", bufferMeta.project()));
-                        discardCount++;
-                        LogtailAlarm::GetInstance()->SendAlarm(
-                            SEND_COMPRESS_FAIL_ALARM,
-                            string("projectName is:" + bufferMeta.project() + ", fileName is:" + filename));
-                    } else {
-                        bufferMeta.set_logstore(logGroup.category());
-                        bufferMeta.set_datatype(LOGGROUP_COMPRESSED);
-                        bufferMeta.set_rawsize(meta.mLogDataSize);
-                        bufferMeta.set_compresstype(sls_logs::SLS_CMP_LZ4);
-                    }
-                }
-                if (!sendResult) {
-                    string errorCode;
-                    SendResult res = SendBufferFileData(bufferMeta, logData, errorCode);
-                    if (res == SEND_OK)
-                        sendResult = true;
-                    else if (res == SEND_DISCARD_ERROR || res == SEND_UNAUTHORIZED) {
-                        LogtailAlarm::GetInstance()->SendAlarm(SEND_DATA_FAIL_ALARM,
-                                                               string("send buffer file fail, rawsize:")
-                                                                   + ToString(bufferMeta.rawsize())
-                                                                   + "errorCode: " + errorCode,
-                                                               bufferMeta.project(),
-                                                               bufferMeta.logstore(),
-                                                               "");
-                        sendResult = true;
-                        discardCount++;
-                    } else if (res == SEND_QUOTA_EXCEED && INT32_FLAG(quota_exceed_wait_interval) > 0)
-                        sleep(INT32_FLAG(quota_exceed_wait_interval));
-                }
-            }
-            delete[] des;
+        int32_t discard = 0;
+        for (size_t idx = nextBlock++; idx < blockOffsets.size(); idx = nextBlock++) {
+            if (!SendEncryptionBlock(fin, fileSize, blockOffsets[idx], filename, keyVersion, discard))
+                writeBack = true;
         }
-        if (sendResult)
-            meta.mHandled = 1;
-        LOG_DEBUG(sLogger,
-                  ("send LogGroup from local buffer file", filename)("rawsize", bufferMeta.rawsize())("sendResult",
-                                                                                                      sendResult));
-        WriteBackMeta(pos - meta.mEncryptionSize - sizeof(meta)
-                          - (meta.mEncodedInfoSize > BUFFER_META_BASE_SIZE
-                                 ? (meta.mEncodedInfoSize - BUFFER_META_BASE_SIZE)
-                                 : meta.mEncodedInfoSize),
-                      (char*)&meta,
-                      sizeof(meta),
-                      filename);
-        if (!sendResult)
-            writeBack = true;
+        discardCount += discard;
+        fclose(fin);
+    };
+    const size_t threadCount = std::min(blockOffsets.size(),
+                                        static_cast<size_t>(std::max(1, INT32_FLAG(buffer_file_replay_thread_count))));
+    if (threadCount <= 1) {
+        replay();
+    } else {
+        vector<ThreadPtr> threads;
+        for (size_t i = 0; i < threadCount; ++i) {
+            threads.push_back(CreateThread(replay));
+        }
+        // Joined when released.
+        threads.clear();
     }
     if (!writeBack) {
         remove(filename.c_str());
@@ -1172,6 +1378,99 @@ void Sender::SendEncryptionBuffer(const std::string& filename, int32_t keyVersio
     }
 }
 
+bool Sender::SendEncryptionBlock(
+    FILE* fin, int64_t fileSize, int32_t pos, const std::string& filename, int32_t keyVersion, int32_t& discardCount) {
+    string encryption;
+    string logData;
+    EncryptionStateMeta meta;
+    bool readResult;
+    LogtailBufferMeta bufferMeta;
+    int32_t nextPos = pos;
+    if (!ReadNextEncryption(fin, fileSize, nextPos, filename, encryption, meta, readResult, bufferMeta)) {
+        discardCount++;
+        return true;
+    }
+    bool sendResult = false;
+    if (!readResult || bufferMeta.project().empty()) {
+        if (meta.mHandled == 1)
+            return true;
+        sendResult = true;
+        discardCount++;
+    }
+    if (!sendResult) {
+        // Decrypted in place, the size is not larger than encryption.
+        char* des = &encryption[0];
+        if (!FileEncryption::GetInstance()->Decrypt(
+                encryption.c_str(), meta.mEncryptionSize, des, meta.mLogDataSize, keyVersion)) {
+            sendResult = true;
+            discardCount++;
+            LOG_ERROR(sLogger,
+                      ("decrypt error, project_name",
+                       bufferMeta.project())("key_version", keyVersion)("meta.mLogDataSize", meta.mLogDataSize));
+            LogtailAlarm::GetInstance()->SendAlarm(ENCRYPT_DECRYPT_FAIL_ALARM,
+                                                   string("decrypt error, project_name:" + bufferMeta.project()
+                                                          + ", key_version:" + ToString(keyVersion)
+                                                          + ", meta.mLogDataSize:" + ToString(meta.mLogDataSize)));
+        } else {
+            encryption.resize(meta.mLogDataSize);
+            if (bufferMeta.has_logstore())
+                logData.swap(encryption);
+            else {
+                // compatible to old buffer file (logGroup string), convert to LZ4 compressed
+                // Only category is needed, logs are left as they are.
+                const string& logGroupStr = encryption;
+                string category;
+                if (!RawLogGroup::ReadCategory(logGroupStr.data(), logGroupStr.size(), category)) {
+                    sendResult = true;
+                    LOG_ERROR(sLogger,
+                              ("parse error from string to loggroup, projectName is", bufferMeta.project()));
+                    discardCount++;
+                    LogtailAlarm::GetInstance()->SendAlarm(
+                        LOG_GROUP_PARSE_FAIL_ALARM,
+                        string("projectName is:" + bufferMeta.project() + ", fileName is:" + filename));
+                } else if (!CompressLz4(logGroupStr, logData)) {
+                    sendResult = true;
+                    LOG_ERROR(sLogger, ("LZ4 compress loggroup fail, projectName is", bufferMeta.project()));
+                    discardCount++;
+                    LogtailAlarm::GetInstance()->SendAlarm(
+                        SEND_COMPRESS_FAIL_ALARM,
+                        string("projectName is:" + bufferMeta.project() + ", fileName is:" + filename));
+                } else {
+                    bufferMeta.set_logstore(category);
+                    bufferMeta.set_datatype(LOGGROUP_COMPRESSED);
+                    bufferMeta.set_rawsize(meta.mLogDataSize);
+                    bufferMeta.set_compresstype(sls_logs::SLS_CMP_LZ4);
+                }
+            }
+            if (!sendResult) {
+                string errorCode;
+                SendResult res = SendBufferFileData(bufferMeta, logData, errorCode);
+                if (res == SEND_OK)
+                    sendResult = true;
+                else if (res == SEND_DISCARD_ERROR || res == SEND_UNAUTHORIZED) {
+                    LogtailAlarm::GetInstance()->SendAlarm(SEND_DATA_FAIL_ALARM,
+                                                           string("send buffer file fail, rawsize:")
+                                                               + ToString(bufferMeta.rawsize())
+                                                               + "errorCode: " + errorCode,
+                                                           bufferMeta.project(),
+                                                           bufferMeta.logstore(),
+                                                           "");
+                    sendResult = true;
+                    discardCount++;
+                } else if (res == SEND_QUOTA_EXCEED && INT32_FLAG(quota_exceed_wait_interval) > 0)
+                    sleep(INT32_FLAG(quota_exceed_wait_interval));
+            }
+        }
+    }
+    if (sendResult)
+        meta.mHandled = 1;
+    LOG_DEBUG(sLogger,
+              ("send LogGroup from local buffer file", filename)("rawsize", bufferMeta.rawsize())("sendResult",
+                                                                                                  sendResult));
+    WriteBackMeta(pos, (char*)&meta, sizeof(meta), filename);
+    return sendResult;
+}
+
 // file is not really created when call CreateNewFile(), file created happened when SendToBufferFile() first called
 bool Sender::CreateNewFile() {
     vector<string> filesToSend;
@@ -1280,32 +1579,49 @@ void Sender::WriteSecondary() {
             mWriteSecondaryWait.wait(lock, INT32_FLAG(write_secondary_wait_timeout) * 1000000);
         }
         // update bufferDiveideTime to flush data; buffer file before bufferDiveideTime will be ready for read
-        if (time(NULL) - mBufferDivideTime > INT32_FLAG(buffer_file_alive_interval))
+        if (time(NULL) - mBufferDivideTime > INT32_FLAG(buffer_file_alive_interval)) {
+#if defined(__linux__)
+            SealBufferFile();
+#endif
             CreateNewFile();
+        }
 
         {
             PTScopedLock lock(mSecondaryMutexLock);
             if (mSecondaryBuffer.size() > 0) {
                 logGroupToDump.insert(logGroupToDump.end(), mSecondaryBuffer.begin(), mSecondaryBuffer.end());
                 mSecondaryBuffer.clear();
+                mSecondaryWriting = true;
             }
         }
 
         if (logGroupToDump.size() > 0) {
+            // Log groups may be recompressed while dumped, bytes added to budget are taken before.
+            size_t dumpBytes = 0;
+            for (LoggroupTimeValue* item : logGroupToDump) {
+                dumpBytes += item->mLogData.size();
+            }
+#if defined(__linux__)
+            SendToBufferFile(logGroupToDump);
+#endif
             for (vector<LoggroupTimeValue*>::iterator itr = logGroupToDump.begin(); itr != logGroupToDump.end();
                  ++itr) {
+#if !defined(__linux__)
                 SendToBufferFile(*itr);
+#endif
                 LOG_DEBUG(sLogger, ("Write LogGroup to Secondary File, logs", (*itr)->mLogLines));
                 delete *itr;
             }
+            MemoryBudget::Sub(MEMORY_COMPONENT_SECONDARY_BUFFER, dumpBytes);
             logGroupToDump.clear();
+            mSecondaryWriting = false;
         }
     }
     LOG_INFO(sLogger, ("DumpSecondaryThread", "exit"));
 }
 
 bool Sender::IsBatchMapEmpty() {
-    return mSenderQueue.IsEmpty();
+    return mSenderQueue.IsEmpty() && (!mCompressPool || mCompressPool->GetPendingCount() == 0);
 }
 
 bool Sender::IsSecondaryBufferEmpty() {
@@ -1317,6 +1633,7 @@ bool Sender::IsSecondaryBufferEmpty() {
 
 void Sender::DaemonSender() {
     LOG_INFO(sLogger, ("SendThread", "start"));
+    ThreadAffinity::GetInstance()->BindCurrentThread(THREAD_ROLE_SENDER, 0);
     int32_t lastUpdateMetricTime = time(NULL);
     int32_t sendBufferCount = 0;
     size_t sendBufferBytes = 0;
@@ -1327,7 +1644,22 @@ void Sender::DaemonSender() {
     Aggregator* aggregator = Aggregator::GetInstance();
     while (true) {
         vector<LoggroupTimeValue*> logGroupToSend;
-        mSenderQueue.Wait(1000);
+        const bool tokenBucketEnabled = BOOL_FLAG(enable_sender_token_bucket);
+        if (tokenBucketEnabled) {
+            // The global limit moves from FlowControl into the global bucket.
+            mSenderQueue.SetTokenBucketRates(
+                AppConfig::GetInstance()->IsSendFlowControl() ? AppConfig::GetInstance()->GetMaxBytePerSec() : 0,
+                INT32_FLAG(sender_region_max_bytes_per_sec),
+                INT32_FLAG(sender_project_max_bytes_per_sec),
+                INT32_FLAG(sender_logstore_max_bytes_per_sec));
+        } else {
+            mSenderQueue.SetTokenBucketRates(0, 0, 0, 0);
+        }
+        mSenderQueue.SetSchedulingQuantum(
+            BOOL_FLAG(enable_sender_fair_scheduling) ? INT32_FLAG(sender_scheduling_quantum_bytes) : 0);
+        // Held log groups are popped again once tokens are refilled, no new data is needed to wake up.
+        // Failed log groups become idle when their backoff is due.
+        mSenderQueue.Wait(mSenderQueue.GetRetryWaitMs(mSenderQueue.IsHeldByTokenBucket() ? 50 : 1000));
 
         uint32_t bufferPackageCount = 0;
         bool singleBatchMapFull = false;
@@ -1366,12 +1698,23 @@ void Sender::DaemonSender() {
 
         sendBufferCount += logGroupToSend.size();
         if (curTime - lastUpdateMetricTime >= 40) {
+            static MetricRegistry* sRegistry = MetricRegistry::GetInstance();
+            static MetricGauge* sSendTps = sRegistry->RegisterGauge("send_tps");
+            static MetricGauge* sSendBytesPs = sRegistry->RegisterGauge("send_bytes_ps");
+            static MetricGauge* sSendNetBytesPs = sRegistry->RegisterGauge("send_net_bytes_ps");
+            static MetricGauge* sSendLinesPs = sRegistry->RegisterGauge("send_lines_ps");
+            static MetricGauge* sSendQueueFull = sRegistry->RegisterGauge("send_queue_full");
+            static MetricGauge* sSendQueueTotal = sRegistry->RegisterGauge("send_queue_total");
+            static MetricGauge* sSenderInvalid = sRegistry->RegisterGauge("sender_invalid");
+            static MetricGauge* sRetryWaiting = sRegistry->RegisterGauge("send_retry_waiting_count");
+            static MetricCounter* sRetryPromoted = sRegistry->RegisterCounter("send_retry_promoted_count");
+            static uint64_t sLastRetryPromotedCount = 0;
             static auto sMonitor = LogtailMonitor::Instance();
 
-            sMonitor->UpdateMetric("send_tps", 1.0 * sendBufferCount / (curTime - lastUpdateMetricTime));
-            sMonitor->UpdateMetric("send_bytes_ps", 1.0 * sendBufferBytes / (curTime - lastUpdateMetricTime));
-            sMonitor->UpdateMetric("send_net_bytes_ps", 1.0 * sendNetBodyBytes / (curTime - lastUpdateMetricTime));
-            sMonitor->UpdateMetric("send_lines_ps", 1.0 * sendLines / (curTime - lastUpdateMetricTime));
+            sSendTps->Set(1.0 * sendBufferCount / (curTime - lastUpdateMetricTime));
+            sSendBytesPs->Set(1.0 * sendBufferBytes / (curTime - lastUpdateMetricTime));
+            sSendNetBytesPs->Set(1.0 * sendNetBodyBytes / (curTime - lastUpdateMetricTime));
+            sSendLinesPs->Set(1.0 * sendLines / (curTime - lastUpdateMetricTime));
             lastUpdateMetricTime = curTime;
             sendBufferCount = 0;
             sendLines = 0;
@@ -1387,15 +1730,31 @@ void Sender::DaemonSender() {
             int32_t eoTotalCount = 0;
             mSenderQueue.GetStatus(
                 invalidCount, invalidSenderCount, totalCount, eoInvalidCount, eoInvalidSenderCount, eoTotalCount);
-            sMonitor->UpdateMetric("send_queue_full", invalidCount);
-            sMonitor->UpdateMetric("send_queue_total", totalCount);
-            sMonitor->UpdateMetric("sender_invalid", invalidSenderCount);
+            sSendQueueFull->Set(invalidCount);
+            sSendQueueTotal->Set(totalCount);
+            sSenderInvalid->Set(invalidSenderCount);
+            size_t retryWaitingCount = 0;
+            uint64_t retryPromotedCount = 0;
+            mSenderQueue.GetRetryStatus(retryWaitingCount, retryPromotedCount);
+            sRetryWaiting->Set(retryWaitingCount);
+            sRetryPromoted->Add(retryPromotedCount - sLastRetryPromotedCount);
+            sLastRetryPromotedCount = retryPromotedCount;
             if (eoTotalCount > 0) {
                 sMonitor->UpdateMetric("eo_send_queue_full", eoInvalidCount);
                 sMonitor->UpdateMetric("eo_send_queue_total", eoTotalCount);
                 sMonitor->UpdateMetric("eo_sender_invalid", eoInvalidSenderCount);
             }
 
+            static MetricGauge* sMemoryUsages[MEMORY_COMPONENT_COUNT] = {};
+            for (int32_t i = 0; i < MEMORY_COMPONENT_COUNT; ++i) {
+                MemoryComponent component = static_cast<MemoryComponent>(i);
+                if (sMemoryUsages[i] == NULL) {
+                    sMemoryUsages[i] = sRegistry->RegisterGauge(std::string("memory_usage_")
+                                                                + MemoryBudget::GetName(component) + "_bytes");
+                }
+                sMemoryUsages[i]->Set(MemoryBudget::GetUsage(component));
+            }
+
             // Collect at most 15 stats, similar to Linux load 1,5,15.
             static SlidingWindowCounter sNetErrCounter = CreateLoadCounter();
             sMonitor->UpdateMetric("net_err_stat", sNetErrCounter.Add(gNetworkErrorCount.exchange(0)));
@@ -1443,7 +1802,7 @@ void Sender::DaemonSender() {
                 OnSendDone(data, LogstoreSenderInfo::SendResult_OK);
                 DescSendingCount();
             } else {
-                if (!IsFlush() && AppConfig::GetInstance()->IsSendFlowControl()) {
+                if (!IsFlush() && !tokenBucketEnabled && AppConfig::GetInstance()->IsSendFlowControl()) {
                     FlowControl(data->mRawSize, REALTIME_SEND_THREAD);
                 }
 
@@ -1501,6 +1860,7 @@ void Sender::PutIntoSecondaryBuffer(LoggroupTimeValue* dataPtr, int32_t retryTim
             PTScopedLock lock(mSecondaryMutexLock);
             if (IsFlush() || (mSecondaryBuffer.size() < (uint32_t)INT32_FLAG(secondary_buffer_count_limit))) {
                 mSecondaryBuffer.push_back(dataPtr);
+                MemoryBudget::Add(MEMORY_COMPONENT_SECONDARY_BUFFER, dataPtr->mLogData.size());
                 writeDone = true;
                 break;
             }
@@ -1571,41 +1931,17 @@ bool Sender::SendToBufferFile(LoggroupTimeValue* dataPtr) {
         }
     }
 
-    char* des;
-    int32_t desLength;
-    if (!FileEncryption::GetInstance()->Encrypt(dataPtr->mLogData.c_str(), dataPtr->mLogData.size(), des, desLength)) {
+    BufferFileRecord record;
+    if (!EncodeBufferFileRecord(dataPtr, record)) {
         fclose(fout);
-        LOG_ERROR(sLogger, ("encrypt error, project_name", dataPtr->mProjectName));
-        LogtailAlarm::GetInstance()->SendAlarm(ENCRYPT_DECRYPT_FAIL_ALARM,
-                                               string("encrypt error, project_name:" + dataPtr->mProjectName));
         return false;
     }
-
-    LogtailBufferMeta bufferMeta;
-    bufferMeta.set_project(dataPtr->mProjectName);
-    bufferMeta.set_endpoint(dataPtr->mRegion);
-    bufferMeta.set_aliuid(dataPtr->mAliuid);
-    bufferMeta.set_logstore(dataPtr->mLogstore);
-    bufferMeta.set_datatype(int32_t(dataPtr->mDataType));
-    bufferMeta.set_rawsize(dataPtr->mRawSize);
-    bufferMeta.set_shardhashkey(dataPtr->mShardHashKey);
-    bufferMeta.set_compresstype(dataPtr->mLogGroupContext.mCompressType);
-    string encodedInfo;
-    bufferMeta.SerializeToString(&encodedInfo);
-
-    EncryptionStateMeta meta;
-    int32_t encodedInfoSize = encodedInfo.size();
-    meta.mEncodedInfoSize = encodedInfoSize + BUFFER_META_BASE_SIZE;
-    meta.mLogDataSize = dataPtr->mLogData.size();
-    meta.mTimeStamp = time(NULL);
-    meta.mHandled = 0;
-    meta.mRetryTime = 0;
-    meta.mEncryptionSize = desLength;
+    const EncryptionStateMeta& meta = record.mMeta;
+    int32_t encodedInfoSize = record.mEncodedInfo.size();
     char* buffer = new char[sizeof(meta) + encodedInfoSize + meta.mEncryptionSize];
     memcpy(buffer, (char*)&meta, sizeof(meta));
-    memcpy(buffer + sizeof(meta), encodedInfo.c_str(), encodedInfoSize);
-    memcpy(buffer + sizeof(meta) + encodedInfoSize, des, desLength);
-    delete[] des;
+    memcpy(buffer + sizeof(meta), record.mEncodedInfo.c_str(), encodedInfoSize);
+    memcpy(buffer + sizeof(meta) + encodedInfoSize, record.mData.get(), meta.mEncryptionSize);
     const auto bytesToWrite = sizeof(meta) + encodedInfoSize + meta.mEncryptionSize;
     auto nbytes = fwrite(buffer, 1, bytesToWrite, fout);
     if (nbytes != bytesToWrite) {
@@ -1630,6 +1966,236 @@ bool Sender::SendToBufferFile(LoggroupTimeValue* dataPtr) {
     return true;
 }
 
+bool Sender::EncodeBufferFileRecord(LoggroupTimeValue* dataPtr, BufferFileRecord& record) {
+    if (dataPtr->mColumnar && !ConvertColumnarToRow(dataPtr)) {
+        LOG_ERROR(sLogger, ("convert columnar data fail, project_name", dataPtr->mProjectName));
+        return false;
+    }
+    RecompressForBufferFile(dataPtr);
+    FileEncryption* encryption = FileEncryption::GetInstance();
+    const int32_t desLength = encryption->GetEncryptedLength(dataPtr->mLogData.size());
+    if (desLength > 0) {
+        record.mData.reset(new char[desLength]);
+    }
+    if (desLength <= 0
+        || !encryption->EncryptTo(dataPtr->mLogData.c_str(), dataPtr->mLogData.size(), record.mData.get(), desLength)) {
+        LOG_ERROR(sLogger, ("encrypt error, project_name", dataPtr->mProjectName));
+        LogtailAlarm::GetInstance()->SendAlarm(ENCRYPT_DECRYPT_FAIL_ALARM,
+                                               string("encrypt error, project_name:" + dataPtr->mProjectName));
+        return false;
+    }
+    const char* des = record.mData.get();
+
+    LogtailBufferMeta bufferMeta;
+    bufferMeta.set_project(dataPtr->mProjectName);
+    bufferMeta.set_endpoint(dataPtr->mRegion);
+    bufferMeta.set_aliuid(dataPtr->mAliuid);
+    bufferMeta.set_logstore(dataPtr->mLogstore);
+    bufferMeta.set_datatype(int32_t(dataPtr->mDataType));
+    bufferMeta.set_rawsize(dataPtr->mRawSize);
+    bufferMeta.set_shardhashkey(dataPtr->mShardHashKey);
+    bufferMeta.set_compresstype(dataPtr->mLogGroupContext.mCompressType);
+    bufferMeta.set_checksum(HashString(des, desLength, kHashStringSeed));
+    bufferMeta.SerializeToString(&record.mEncodedInfo);
+
+    EncryptionStateMeta& meta = record.mMeta;
+    meta.mEncodedInfoSize = record.mEncodedInfo.size() + BUFFER_META_BASE_SIZE;
+    meta.mLogDataSize = dataPtr->mLogData.size();
+    meta.mTimeStamp = time(NULL);
+    meta.mHandled = 0;
+    meta.mRetryTime = 0;
+    meta.mEncryptionSize = desLength;
+    record.mValid = true;
+    return true;
+}
+
+#if defined(__linux__)
+namespace {
+
+    // WriteBufferFileVec writes all of @iov to @fd, partial writes are continued.
+    bool WriteBufferFileVec(int fd, std::vector<iovec>& iov) {
+        size_t idx = 0;
+        while (idx < iov.size()) {
+            ssize_t nbytes = writev(fd, &iov[idx], std::min(iov.size() - idx, static_cast<size_t>(IOV_MAX)));
+            if (nbytes < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            size_t n = static_cast<size_t>(nbytes);
+            while (idx < iov.size() && n >= iov[idx].iov_len) {
+                n -= iov[idx].iov_len;
+                ++idx;
+            }
+            if (n > 0) {
+                iov[idx].iov_base = static_cast<char*>(iov[idx].iov_base) + n;
+                iov[idx].iov_len -= n;
+            }
+        }
+        return true;
+    }
+
+} // namespace
+
+bool Sender::SendToBufferFile(const std::vector<LoggroupTimeValue*>& dataVec) {
+    // Encryption costs more than writing, it is split into chunks for encrypt threads.
+    std::vector<BufferFileRecord> records(dataVec.size());
+    const size_t threadCount = mBufferEncryptPool ? mBufferEncryptPool->GetThreadCount() : 0;
+    if (threadCount > 0 && dataVec.size() > 1) {
+        const size_t chunkSize = (dataVec.size() + threadCount - 1) / threadCount;
+        for (size_t begin = 0; begin < dataVec.size(); begin += chunkSize) {
+            const size_t end = std::min(dataVec.size(), begin + chunkSize);
+            mBufferEncryptPool->Submit(
+                [this, &dataVec, &records, begin, end]() {
+                    for (size_t i = begin; i < end; ++i) {
+                        EncodeBufferFileRecord(dataVec[i], records[i]);
+                    }
+                },
+                []() {});
+        }
+        mBufferEncryptPool->WaitEmpty();
+    } else {
+        for (size_t i = 0; i < dataVec.size(); ++i) {
+            EncodeBufferFileRecord(dataVec[i], records[i]);
+        }
+    }
+
+    // Records are appended to buffer file with one writev, while the file is not larger than the limit.
+    size_t lastValid = records.size();
+    for (size_t i = 0; i < records.size(); ++i) {
+        if (records[i].mValid) {
+            lastValid = i;
+        }
+    }
+    bool result = true;
+    string bufferFileName;
+    string header;
+    int fd = -1;
+    int64_t fileSize = 0;
+    size_t recordCount = 0;
+    std::vector<iovec> iov;
+    for (size_t i = 0; i < records.size(); ++i) {
+        BufferFileRecord& record = records[i];
+        if (!record.mValid) {
+            result = false;
+            continue;
+        }
+        if (fd < 0) {
+            bufferFileName = GetBufferFileName();
+            if (bufferFileName.empty()) {
+                CreateNewFile();
+                bufferFileName = GetBufferFileName();
+            }
+            fd = open(bufferFileName.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+            struct stat buf;
+            if (fd < 0 || fstat(fd, &buf) != 0) {
+                string errorStr = ErrnoToString(GetErrno());
+                LogtailAlarm::GetInstance()->SendAlarm(SECONDARY_READ_WRITE_ALARM,
+                                                       string("open file error:") + bufferFileName
+                                                           + ",error:" + errorStr);
+                LOG_ERROR(sLogger, ("open buffer file error", bufferFileName)("error", errorStr));
+                if (fd >= 0) {
+                    close(fd);
+                }
+                return false;
+            }
+            fileSize = buf.st_size;
+            if (bufferFileName != mIndexedBufferFileName) {
+                // Blocks written before, e.g. by a previous process, are unknown, so no index for the file.
+                mIndexedBufferFileName = bufferFileName;
+                mBufferFileIndex.Reset();
+                mBufferFileIndexValid = fileSize == 0;
+            }
+            if (fileSize == 0) {
+                header = GetBufferFileHeader();
+                iov.push_back({const_cast<char*>(header.data()), header.size()});
+                fileSize += header.size();
+            }
+        }
+        mBufferFileIndex.AddBlock(fileSize);
+        iov.push_back({&record.mMeta, sizeof(record.mMeta)});
+        iov.push_back({const_cast<char*>(record.mEncodedInfo.data()), record.mEncodedInfo.size()});
+        iov.push_back({record.mData.get(), static_cast<size_t>(record.mMeta.mEncryptionSize)});
+        fileSize += sizeof(record.mMeta) + record.mEncodedInfo.size() + record.mMeta.mEncryptionSize;
+        ++recordCount;
+
+        const bool rotate = fileSize > AppConfig::GetInstance()->GetLocalFileSize();
+        if (!rotate && i != lastValid) {
+            continue;
+        }
+        if (!WriteBufferFileVec(fd, iov)) {
+            string errorStr = ErrnoToString(GetErrno());
+            LogtailAlarm::GetInstance()->SendAlarm(SECONDARY_READ_WRITE_ALARM,
+                                                   string("write file error:") + bufferFileName + ", error:" + errorStr
+                                                       + ", log groups:" + ToString(recordCount));
+            LOG_ERROR(sLogger,
+                      ("write buffer file", "fail")("filename", bufferFileName)("errorStr", errorStr)("log groups",
+                                                                                                    recordCount));
+            result = false;
+            mBufferFileIndexValid = false;
+        } else {
+            if (rotate) {
+                WriteBufferFileIndex(fd, fileSize, bufferFileName);
+            }
+            if (BOOL_FLAG(enable_buffer_file_fsync) && fdatasync(fd) != 0) {
+                LOG_WARNING(sLogger, ("fsync buffer file error", bufferFileName)("error", ErrnoToString(GetErrno())));
+            }
+            LOG_DEBUG(sLogger, ("write buffer file", bufferFileName)("log groups", recordCount));
+        }
+        iov.clear();
+        recordCount = 0;
+        close(fd);
+        fd = -1;
+        if (rotate) {
+            CreateNewFile();
+        }
+    }
+    return result;
+}
+
+bool Sender::WriteBufferFileIndex(int fd, int64_t fileSize, const std::string& filename) {
+    const bool indexValid = mBufferFileIndexValid && filename == mIndexedBufferFileName;
+    mIndexedBufferFileName.clear();
+    mBufferFileIndexValid = false;
+    if (!BOOL_FLAG(enable_buffer_file_index) || !indexValid || mBufferFileIndex.GetBlockOffsets().empty()) {
+        return false;
+    }
+    // Marked as handled, so the index is skipped as a block when replaying.
+    string data = mBufferFileIndex.Serialize(fileSize);
+    EncryptionStateMeta meta;
+    meta.mLogDataSize = 0;
+    meta.mEncryptionSize = data.size();
+    meta.mEncodedInfoSize = 0;
+    meta.mTimeStamp = time(NULL);
+    meta.mHandled = 1;
+    meta.mRetryTime = 0;
+    std::vector<iovec> iov{{&meta, sizeof(meta)}, {const_cast<char*>(data.data()), data.size()}};
+    if (!WriteBufferFileVec(fd, iov)) {
+        LOG_WARNING(sLogger, ("write block index of buffer file error", filename)("error", ErrnoToString(GetErrno())));
+        return false;
+    }
+    return true;
+}
+
+void Sender::SealBufferFile() {
+    const string bufferFileName = GetBufferFileName();
+    if (!mBufferFileIndexValid || bufferFileName.empty() || bufferFileName != mIndexedBufferFileName) {
+        return;
+    }
+    int fd = open(bufferFileName.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    struct stat buf;
+    if (fd >= 0 && fstat(fd, &buf) == 0) {
+        WriteBufferFileIndex(fd, buf.st_size, bufferFileName);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+    mIndexedBufferFileName.clear();
+    mBufferFileIndexValid = false;
+}
+#endif
+
 void Sender::FlowControl(int32_t dataSize, SEND_THREAD_TYPE type) {
     int64_t curTime = GetCurrentTimeInMicroSeconds();
     int32_t idx = int32_t(type);
@@ -1677,7 +2243,7 @@ bool Sender::SendPb(Config* pConfig,
                                                      pConfig->mLogstoreKey,
                                                      logGroupContext);
     // apsara::timing::TimeInNsec startT = apsara::timing::GetCurrentTimeInNanoSeconds();
-    if (!CompressData(logGroupContext.mCompressType, pbBuffer, pbSize, pData->mLogData)) {
+    if (!CompressLoggroupData(pData, pbBuffer, pbSize)) {
         LOG_ERROR(sLogger,
                   ("compress data fail", "discard data")("projectName", pConfig->mProjectName)("logstore",
                                                                                                pConfig->mCategory));
@@ -1795,7 +2361,7 @@ void Sender::TestNetwork() {
                     if (!endpointChanged && priority != 10) {
                         if (TestEndpoint(region, endpoint)) {
                             for (const auto& uid : uids) {
-                                ResetSendClientEndpoint(uid, region, curTime);
+                                ResetSendClientEndpoint(uid, region, curTime, mTestNetworkClient);
                             }
                             endpointChanged = true;
                         }
@@ -1812,7 +2378,7 @@ void Sender::TestNetwork() {
                         mSenderQueue.OnRegionRecover(region);
                         if (!endpointChanged && priority != 10) {
                             for (const auto& uid : uids) {
-                                ResetSendClientEndpoint(uid, region, curTime);
+                                ResetSendClientEndpoint(uid, region, curTime, mTestNetworkClient);
                             }
                             endpointChanged = true;
                         }
@@ -1838,9 +2404,16 @@ bool Sender::TestEndpoint(const std::string& region, const std::string& endpoint
         return true;
     if (endpoint.size() == 0)
         return false;
-    static LogGroup logGroup;
-    mTestNetworkClient->SetSlsHost(endpoint);
-    ResetPort(region, mTestNetworkClient);
+    int32_t latency = 0;
+    bool status = ProbeHost(mTestNetworkClient, region, endpoint, latency);
+    LOG_DEBUG(sLogger, ("TestEndpoint, region", region)("endpoint", endpoint)("status", status)("latency", latency));
+    SetNetworkStat(region, endpoint, status, latency);
+    return status;
+}
+
+bool Sender::ProbeHost(sdk::Client* client, const std::string& region, const std::string& host, int32_t& latency) {
+    client->SetSlsHost(host);
+    ResetPort(region, client);
     bool status = true;
     int64_t beginTime = GetCurrentTimeInMicroSeconds();
     try {
@@ -1849,7 +2422,7 @@ bool Sender::TestEndpoint(const std::string& region, const std::string& endpoint
             MockTestEndpoint(
                 "logtail-test-network-project", "logtail-test-network-logstore", logData, LOGGROUP_COMPRESSED, 0);
         } else
-            status = mTestNetworkClient->TestNetwork();
+            status = client->TestNetwork();
     } catch (sdk::LOGException& ex) {
         const string& errorCode = ex.GetErrorCode();
         LOG_DEBUG(sLogger, ("test network", "send fail")("errorCode", errorCode)("errorMessage", ex.GetMessage()));
@@ -1860,12 +2433,95 @@ bool Sender::TestEndpoint(const std::string& region, const std::string& endpoint
         LOG_ERROR(sLogger, ("test network", "send fail")("exception", "unknown"));
     }
     int64_t endTime = GetCurrentTimeInMicroSeconds();
-    int32_t latency = int32_t((endTime - beginTime) / 1000); // ms
-    LOG_DEBUG(sLogger, ("TestEndpoint, region", region)("endpoint", endpoint)("status", status)("latency", latency));
-    SetNetworkStat(region, endpoint, status, latency);
+    latency = int32_t((endTime - beginTime) / 1000); // ms
     return status;
 }
 
+bool Sender::IsPickEndpointByLatency() const {
+    return BOOL_FLAG(enable_endpoint_probe) && mDataServerSwitchPolicy == dataServerSwitchPolicy::DESIGNATED_FIRST;
+}
+
+void Sender::ShardRouteThread() {
+    auto lister = [this](const std::string& project,
+                         const std::string& logstore,
+                         const std::string& region,
+                         const std::string& aliuid,
+                         std::vector<sdk::ShardInfo>& shards) {
+        try {
+            shards = GetSendClient(region, aliuid)->ListShards(project, logstore).shards;
+            return true;
+        } catch (const sdk::LOGException& ex) {
+            LOG_WARNING(sLogger,
+                        ("list shards fail, project", project)("logstore", logstore)("error", ex.GetErrorCode()));
+        } catch (const sdk::JsonException& ex) {
+            LOG_WARNING(sLogger,
+                        ("parse shards fail, project", project)("logstore", logstore)("error", ex.GetErrorCode()));
+        }
+        return false;
+    };
+    while (true) {
+        ShardRouter::GetInstance()->Refresh(lister, time(NULL));
+        sleep(1);
+    }
+}
+
+void Sender::EndpointProbeThread() {
+    vector<pair<string, string>> regionEndpoints;
+    while (true) {
+        sleep(INT32_FLAG(endpoint_probe_interval));
+        regionEndpoints.clear();
+        {
+            PTScopedLock lock(mRegionEndpointEntryMapLock);
+            for (auto iter = mRegionEndpointEntryMap.begin(); iter != mRegionEndpointEntryMap.end(); ++iter) {
+                for (auto epIter = iter->second->mEndpointDetailMap.begin();
+                     epIter != iter->second->mEndpointDetailMap.end();
+                     ++epIter) {
+                    regionEndpoints.push_back(std::make_pair(iter->first, epIter->first));
+                }
+            }
+        }
+
+        set<string> regions;
+        for (const auto& regionEndpoint : regionEndpoints) {
+            const string& region = regionEndpoint.first;
+            if (!ConfigManager::GetInstance()->GetRegionStatus(region)) {
+                continue;
+            }
+            int32_t latency = 0;
+            bool status = ProbeHost(mProbeClient, region, regionEndpoint.second, latency);
+            LOG_DEBUG(sLogger,
+                      ("probe endpoint, region", region)("endpoint", regionEndpoint.second)("status", status)(
+                          "latency", latency));
+            SetNetworkStat(region, regionEndpoint.second, status, latency);
+            regions.insert(region);
+        }
+
+        int32_t curTime = time(NULL);
+        for (const auto& region : regions) {
+            if (BOOL_FLAG(send_prefer_real_ip)) {
+                string realIp;
+                {
+                    PTScopedLock lock(mRegionRealIpLock);
+                    auto iter = mRegionRealIpMap.find(region);
+                    if (iter != mRegionRealIpMap.end()) {
+                        realIp = iter->second->mRealIp;
+                    }
+                }
+                int32_t latency = 0;
+                if (!realIp.empty() && !ProbeHost(mProbeClient, region, realIp, latency)) {
+                    LOG_INFO(sLogger, ("probe real ip fail, region", region)("real ip", realIp));
+                    ForceUpdateRealIp(region);
+                }
+            }
+            // Clients of region move to the endpoint chosen by new latencies, it is skipped if not changed.
+            set<string> uids = ConfigManager::GetInstance()->GetRegionAliuids(region);
+            for (const auto& uid : uids) {
+                ResetSendClientEndpoint(uid, region, curTime, mProbeClient);
+            }
+        }
+    }
+}
+
 bool Sender::IsProfileData(const string& region, const std::string& project, const std::string& logstore) {
     if ((logstore == "shennong_log_profile" || logstore == "logtail_alarm" || logstore == "logtail_status_profile"
          || logstore == "logtail_suicide_profile")
@@ -1877,7 +2533,10 @@ bool Sender::IsProfileData(const string& region, const std::string& project, con
 
 SendResult
 Sender::SendBufferFileData(const LogtailBufferMeta& bufferMeta, const std::string& logData, std::string& errorCode) {
-    FlowControl(bufferMeta.rawsize(), REPLAY_SEND_THREAD);
+    {
+        std::lock_guard<std::mutex> lock(mReplayFlowControlMux);
+        FlowControl(bufferMeta.rawsize(), REPLAY_SEND_THREAD);
+    }
     string region = bufferMeta.endpoint();
     if (region.find("http://") == 0) // old buffer file which record the endpoint
         region = GetRegionFromEndpoint(region);
@@ -2060,6 +2719,8 @@ void Sender::SendToNetAsync(LoggroupTimeValue* dataPtr) {
 
     SendClosure* sendClosure = new SendClosure;
     dataPtr->mLastSendTime = curTime;
+    dataPtr->mLastSendTimeInMs = GetCurrentTimeInMilliSeconds();
+    dataPtr->mLogGroupContext.mTimestamps.mSendTimeInMs = GetSteadyTimeInMilliSeconds();
     sendClosure->mDataPtr = dataPtr;
     LOG_DEBUG(sLogger,
               ("region", dataPtr->mRegion)("endpoint", dataPtr->mCurrentEndpoint)("project", dataPtr->mProjectName)(
@@ -2089,7 +2750,10 @@ void Sender::SendToNetAsync(LoggroupTimeValue* dataPtr) {
                                          dataPtr->mLogGroupContext.mCompressType,
                                          dataPtr->mLogData,
                                          dataPtr->mRawSize,
-                                         sendClosure);
+                                         sendClosure,
+                                         "",
+                                         sdk::kInvalidHashKeySeqID,
+                                         dataPtr->mColumnar);
         } else {
             int64_t hashKeySeqID = exactlyOnceCpt ? exactlyOnceCpt->data.sequence_id() : sdk::kInvalidHashKeySeqID;
             sendClient->PostLogStoreLogs(dataPtr->mProjectName,
@@ -2099,7 +2763,8 @@ void Sender::SendToNetAsync(LoggroupTimeValue* dataPtr) {
                                          dataPtr->mRawSize,
                                          sendClosure,
                                          hashKey,
-                                         hashKeySeqID);
+                                         hashKeySeqID,
+                                         dataPtr->mColumnar);
         }
     } else {
         if (dataPtr->mShardHashKey.empty())
@@ -2127,10 +2792,11 @@ bool Sender::Send(const std::string& projectName,
                   const uint32_t logGroupSize,
                   const string& defaultRegion,
                   const string& filename,
-                  const LogGroupContext& context) {
+                  const LogGroupContext& context,
+                  const std::shared_ptr<google::protobuf::Arena>& arena) {
     static Aggregator* aggregator = Aggregator::GetInstance();
     return aggregator->Add(
-        projectName, sourceId, logGroup, config, mergeType, logGroupSize, defaultRegion, filename, context);
+        projectName, sourceId, logGroup, config, mergeType, logGroupSize, defaultRegion, filename, context, arena);
 }
 
 bool Sender::SendInstantly(sls_logs::LogGroup& logGroup,
@@ -2154,8 +2820,8 @@ bool Sender::SendInstantly(sls_logs::LogGroup& logGroup,
     std::string shardHashKey = "";
     LogstoreFeedBackKey feedBackKey = GenerateLogstoreFeedBackKey(projectName, logstore);
 
-    std::string oriData;
-    logGroup.SerializeToString(&oriData);
+    uint32_t oriSize = 0;
+    const char* oriData = SerializeLogGroup(logGroup, oriSize);
     // filename is empty string
     LoggroupTimeValue* data = new LoggroupTimeValue(projectName,
                                                     logstore,
@@ -2166,12 +2832,12 @@ bool Sender::SendInstantly(sls_logs::LogGroup& logGroup,
                                                     region,
                                                     LOGGROUP_COMPRESSED,
                                                     logSize,
-                                                    oriData.size(),
+                                                    oriSize,
                                                     curTime,
                                                     shardHashKey,
                                                     feedBackKey);
 
-    if (!CompressData(data->mLogGroupContext.mCompressType, oriData, data->mLogData)) {
+    if (!CompressLoggroupData(data, oriData, oriSize)) {
         LOG_ERROR(sLogger, ("compress data fail", "discard data")("projectName", projectName)("logstore", logstore));
         LogtailAlarm::GetInstance()->SendAlarm(
             SEND_COMPRESS_FAIL_ALARM, string("lines :") + ToString(logSize), projectName, logstore, region);
@@ -2206,18 +2872,22 @@ void Sender::SendCompressed(const std::string& projectName,
         filteredLogGroup.set_source(logGroup.has_source() ? logGroup.source() : LogFileProfiler::mIpAddr);
         filteredLogGroup.mutable_logtags()->Swap(logGroup.mutable_logtags());
 
+        // Logs are borrowed from @logGroup without copy (AddAllocated copies logs on arena),
+        // and released before filteredLogGroup is destroyed, @logGroup still owns them.
         auto mutableLogPtr = logGroup.mutable_logs()->mutable_data();
+        filteredLogGroup.mutable_logs()->Reserve(neededLogLines);
         int32_t needIdx = 0;
         for (int32_t logIdx = 0; logIdx < lines; ++logIdx) {
             if (!(needIdx < neededLogLines && logIdx == neededLogIndex[needIdx])) {
                 continue;
             }
-            filteredLogGroup.mutable_logs()->AddAllocated(*(mutableLogPtr + logIdx));
+            filteredLogGroup.mutable_logs()->UnsafeArenaAddAllocated(*(mutableLogPtr + logIdx));
             needIdx++;
         }
         lines = neededLogLines;
         filteredLogGroup.SerializeToString(&oriData);
         logTimeInMinute = filteredLogGroup.logs(0).time() - filteredLogGroup.logs(0).time() % 60;
+        filteredLogGroup.mutable_logs()->UnsafeArenaExtractSubrange(0, filteredLogGroup.logs_size(), NULL);
     }
 
     auto& cpt = context.mExactlyOnceCheckpoint;
@@ -2238,7 +2908,7 @@ void Sender::SendCompressed(const std::string& projectName,
     data->mLogTimeInMinute = logTimeInMinute;
     data->mLogGroupContext.mSeqNum = ++mLogGroupContextSeq;
 
-    if (!CompressData(data->mLogGroupContext.mCompressType, oriData, data->mLogData)) {
+    if (!CompressLoggroupData(data, oriData.data(), oriData.size())) {
         LOG_ERROR(sLogger,
                   ("compress data fail", "discard data")("projectName", projectName)("logstore", logGroup.category()));
         LogtailAlarm::GetInstance()->SendAlarm(
@@ -2249,115 +2919,167 @@ void Sender::SendCompressed(const std::string& projectName,
     }
 }
 
-void Sender::SendCompressed(std::vector<MergeItem*>& sendDataVec) {
-    for (auto item : sendDataVec) {
-        string oriData;
-        item->mLogGroup.SerializeToString(&oriData);
-        mLogGroupContextSeq++;
-        auto& context = item->mLogGroupContext;
-        auto& cpt = context.mExactlyOnceCheckpoint;
-        context.mSeqNum = mLogGroupContextSeq;
-        LoggroupTimeValue* data = new LoggroupTimeValue(item->mProjectName,
-                                                        item->mLogGroup.category(),
-                                                        item->mConfigName,
-                                                        item->mFilename,
-                                                        cpt ? false : item->mBufferOrNot,
-                                                        item->mAliuid,
-                                                        item->mRegion,
-                                                        LOGGROUP_COMPRESSED,
-                                                        item->mLines,
-                                                        oriData.size(),
-                                                        item->mLastUpdateTime,
-                                                        cpt ? "" : item->mShardHashKey,
-                                                        cpt ? cpt->fbKey : item->mLogstoreKey,
-                                                        context);
-        data->mLogTimeInMinute = item->mLogTimeInMinute;
-
-        if (!CompressData(data->mLogGroupContext.mCompressType, oriData, data->mLogData)) {
-            LOG_ERROR(sLogger,
-                      ("compress data fail",
-                       "discard data")("projectName", item->mProjectName)("logstore", item->mLogGroup.category()));
-            LogtailAlarm::GetInstance()->SendAlarm(SEND_COMPRESS_FAIL_ALARM,
-                                                   string("lines :") + ToString(item->mLines),
-                                                   item->mProjectName,
-                                                   item->mLogGroup.category(),
-                                                   item->mRegion);
-            delete data;
-        } else {
-            if (data->mLogGroupContext.mMarkOffsetFlag) {
-                LogFileCollectOffsetIndicator::GetInstance()->RecordFileOffset(data);
-            }
+void Sender::SubmitCompressTask(std::function<void()> compress, std::function<void()> emit) {
+    if (!mCompressPool) {
+        compress();
+        emit();
+        return;
+    }
+    mCompressPool->Submit(std::move(compress), std::move(emit));
+}
 
-            // raw logs are merged, then pushed into sendDataVec, here we record integrity info and put it into list
-            LogIntegrity::GetInstance()->RecordIntegrityInfo(item);
+LoggroupTimeValue* Sender::CompressMergeItem(MergeItem* item) {
+    if (BOOL_FLAG(enable_merge_item_schema_group)) {
+        item->GroupLogsBySchema();
+    }
+    uint32_t oriSize = 0;
+    const char* oriData = SerializeLogGroup(item->mLogGroup, oriSize);
+    auto& context = item->mLogGroupContext;
+    auto& cpt = context.mExactlyOnceCheckpoint;
+    LoggroupTimeValue* data = new LoggroupTimeValue(item->mProjectName,
+                                                    item->mLogGroup.category(),
+                                                    item->mConfigName,
+                                                    item->mFilename,
+                                                    cpt ? false : item->mBufferOrNot,
+                                                    item->mAliuid,
+                                                    item->mRegion,
+                                                    LOGGROUP_COMPRESSED,
+                                                    item->mLines,
+                                                    oriSize,
+                                                    item->mLastUpdateTime,
+                                                    cpt ? "" : item->mShardHashKey,
+                                                    cpt ? cpt->fbKey : item->mLogstoreKey,
+                                                    context);
+    data->mLogTimeInMinute = item->mLogTimeInMinute;
+
+    // Columnar data is used only if it is smaller than the serialized log group.
+    static thread_local std::string sColumnar;
+    if (ColumnarLogGroup::IsEnabled(item->mRegion) && ColumnarLogGroup::Encode(item->mLogGroup, sColumnar)) {
+        oriData = sColumnar.data();
+        oriSize = static_cast<uint32_t>(sColumnar.size());
+        data->mRawSize = oriSize;
+        data->mColumnar = true;
+    }
+    if (!CompressLoggroupData(data, oriData, oriSize)) {
+        LOG_ERROR(sLogger,
+                  ("compress data fail",
+                   "discard data")("projectName", item->mProjectName)("logstore", item->mLogGroup.category()));
+        LogtailAlarm::GetInstance()->SendAlarm(SEND_COMPRESS_FAIL_ALARM,
+                                               string("lines :") + ToString(item->mLines),
+                                               item->mProjectName,
+                                               item->mLogGroup.category(),
+                                               item->mRegion);
+        delete data;
+        return NULL;
+    }
+    return data;
+}
 
-            PutIntoBatchMap(data);
+void Sender::EmitCompressedData(MergeItem* item, LoggroupTimeValue* data) {
+    if (data != NULL) {
+        // Sequence numbers are assigned in emit order, offsets and integrity info are recorded by them.
+        item->mLogGroupContext.mSeqNum = ++mLogGroupContextSeq;
+        data->mLogGroupContext.mSeqNum = item->mLogGroupContext.mSeqNum;
+        if (data->mLogGroupContext.mMarkOffsetFlag) {
+            LogFileCollectOffsetIndicator::GetInstance()->RecordFileOffset(data);
         }
-        delete item;
+
+        // raw logs are merged, then pushed into sendDataVec, here we record integrity info and put it into list
+        LogIntegrity::GetInstance()->RecordIntegrityInfo(item);
+
+        PutIntoBatchMap(data);
+    }
+    delete item;
+}
+
+void Sender::SendCompressed(std::vector<MergeItem*>& sendDataVec) {
+    for (auto item : sendDataVec) {
+        std::shared_ptr<LoggroupTimeValue*> data(new LoggroupTimeValue*(NULL));
+        SubmitCompressTask([this, item, data]() { *data = CompressMergeItem(item); },
+                           [this, item, data]() { EmitCompressedData(item, *data); });
     }
 }
 
 // all data in sendDataVec shoud have same key
 void Sender::SendLogPackageList(std::vector<MergeItem*>& sendDataVec) {
-    SlsLogPackageList logPackageList;
-    int32_t bytes = 0;
-    int32_t lines = 0;
-    uint32_t totalLogGroupCount = sendDataVec.size();
-    for (uint32_t idx = 0; idx < totalLogGroupCount; ++idx) {
-        string compressedData;
-        string oriData;
-        sendDataVec[idx]->mLogGroup.SerializeToString(&oriData);
-        if (!CompressData(sendDataVec[idx]->mLogGroupContext.mCompressType, oriData, compressedData)) {
-            LOG_ERROR(sLogger,
-                      ("compress data fail", "discard data")("projectName", sendDataVec[idx]->mProjectName)(
-                          "logstore", sendDataVec[idx]->mLogGroup.category()));
-            LogtailAlarm::GetInstance()->SendAlarm(SEND_COMPRESS_FAIL_ALARM,
-                                                   string("lines :") + ToString(sendDataVec[idx]->mLines),
-                                                   sendDataVec[idx]->mProjectName,
-                                                   sendDataVec[idx]->mLogGroup.category(),
-                                                   sendDataVec[idx]->mRegion);
-            delete sendDataVec[idx];
-            continue;
+    // Packages are compressed in compress pool, failed ones are left empty.
+    typedef std::vector<std::pair<bool, SlsLogPackage>> PackageVec;
+    std::shared_ptr<PackageVec> packages(new PackageVec(sendDataVec.size()));
+    std::vector<MergeItem*> items(sendDataVec);
+    auto compress = [this, items, packages]() {
+        for (uint32_t idx = 0; idx < items.size(); ++idx) {
+            if (BOOL_FLAG(enable_merge_item_schema_group)) {
+                items[idx]->GroupLogsBySchema();
+            }
+            uint32_t oriSize = 0;
+            const char* oriData = SerializeLogGroup(items[idx]->mLogGroup, oriSize);
+            SlsLogPackage& package = (*packages)[idx].second;
+            if (!CompressData(
+                    items[idx]->mLogGroupContext.mCompressType, oriData, oriSize, *package.mutable_data())) {
+                LOG_ERROR(sLogger,
+                          ("compress data fail", "discard data")("projectName", items[idx]->mProjectName)(
+                              "logstore", items[idx]->mLogGroup.category()));
+                LogtailAlarm::GetInstance()->SendAlarm(SEND_COMPRESS_FAIL_ALARM,
+                                                       string("lines :") + ToString(items[idx]->mLines),
+                                                       items[idx]->mProjectName,
+                                                       items[idx]->mLogGroup.category(),
+                                                       items[idx]->mRegion);
+                continue;
+            }
+            package.set_uncompress_size(oriSize);
+            (*packages)[idx].first = true;
         }
-        SlsLogPackage* package = logPackageList.add_packages();
-        package->set_data(compressedData);
-        package->set_uncompress_size(oriData.size());
-        lines += sendDataVec[idx]->mLines;
-        bytes += sendDataVec[idx]->mRawBytes;
-        if (bytes >= AppConfig::GetInstance()->GetMaxHoldedDataSize() || idx == totalLogGroupCount - 1) {
-            mLogGroupContextSeq++;
-            sendDataVec[idx]->mLogGroupContext.mSeqNum = mLogGroupContextSeq;
-            LoggroupTimeValue* data = new LoggroupTimeValue(sendDataVec[idx]->mProjectName,
-                                                            sendDataVec[idx]->mLogGroup.category(),
-                                                            sendDataVec[idx]->mConfigName,
-                                                            sendDataVec[idx]->mFilename,
-                                                            sendDataVec[idx]->mBufferOrNot,
-                                                            sendDataVec[idx]->mAliuid,
-                                                            sendDataVec[idx]->mRegion,
-                                                            LOG_PACKAGE_LIST,
-                                                            lines,
-                                                            bytes,
-                                                            sendDataVec[idx]->mLastUpdateTime,
-                                                            sendDataVec[idx]->mShardHashKey,
-                                                            sendDataVec[idx]->mLogstoreKey,
-                                                            sendDataVec[idx]->mLogGroupContext);
-            data->mLogTimeInMinute = sendDataVec[idx]->mLogTimeInMinute;
-            logPackageList.SerializeToString(&(data->mLogData));
-            logPackageList.Clear();
-            bytes = 0;
-            lines = 0;
-
-            if (data->mLogGroupContext.mMarkOffsetFlag) {
-                LogFileCollectOffsetIndicator::GetInstance()->RecordFileOffset(data);
+    };
+    auto emit = [this, items, packages]() {
+        SlsLogPackageList logPackageList;
+        int32_t bytes = 0;
+        int32_t lines = 0;
+        uint32_t totalLogGroupCount = items.size();
+        for (uint32_t idx = 0; idx < totalLogGroupCount; ++idx) {
+            if (!(*packages)[idx].first) {
+                delete items[idx];
+                continue;
             }
+            logPackageList.add_packages()->Swap(&(*packages)[idx].second);
+            lines += items[idx]->mLines;
+            bytes += items[idx]->mRawBytes;
+            if (bytes >= AppConfig::GetInstance()->GetMaxHoldedDataSize() || idx == totalLogGroupCount - 1) {
+                mLogGroupContextSeq++;
+                items[idx]->mLogGroupContext.mSeqNum = mLogGroupContextSeq;
+                LoggroupTimeValue* data = new LoggroupTimeValue(items[idx]->mProjectName,
+                                                                items[idx]->mLogGroup.category(),
+                                                                items[idx]->mConfigName,
+                                                                items[idx]->mFilename,
+                                                                items[idx]->mBufferOrNot,
+                                                                items[idx]->mAliuid,
+                                                                items[idx]->mRegion,
+                                                                LOG_PACKAGE_LIST,
+                                                                lines,
+                                                                bytes,
+                                                                items[idx]->mLastUpdateTime,
+                                                                items[idx]->mShardHashKey,
+                                                                items[idx]->mLogstoreKey,
+                                                                items[idx]->mLogGroupContext);
+                data->mLogTimeInMinute = items[idx]->mLogTimeInMinute;
+                logPackageList.SerializeToString(&(data->mLogData));
+                logPackageList.Clear();
+                bytes = 0;
+                lines = 0;
+
+                if (data->mLogGroupContext.mMarkOffsetFlag) {
+                    LogFileCollectOffsetIndicator::GetInstance()->RecordFileOffset(data);
+                }
 
-            // raw logs are merged, then pushed into sendDataVec, here we record integrity info and put it into list
-            LogIntegrity::GetInstance()->RecordIntegrityInfo(sendDataVec[idx]);
+                // raw logs are merged, then pushed into sendDataVec, here we record integrity info and put it into
+                // list
+                LogIntegrity::GetInstance()->RecordIntegrityInfo(items[idx]);
 
-            PutIntoBatchMap(data);
+                PutIntoBatchMap(data);
+            }
+            delete items[idx];
         }
-        delete sendDataVec[idx];
-    }
+    };
+    SubmitCompressTask(compress, emit);
 }
 
 void Sender::PutIntoBatchMap(LoggroupTimeValue* data) {
@@ -2438,7 +3160,7 @@ LogstoreSenderStatistics Sender::GetSenderStatistics(const LogstoreFeedBackKey&
     return mSenderQueue.GetSenderStatistics(key);
 }
 
-void Sender::IncreaseRegionConcurrency(const std::string& region) {
+void Sender::IncreaseRegionConcurrency(const std::string& region, const std::string& endpoint, int64_t latencyMs) {
     PTScopedLock lock(mRegionEndpointEntryMapLock);
     auto iter = mRegionEndpointEntryMap.find(region);
     if (mRegionEndpointEntryMap.end() == iter)
@@ -2446,6 +3168,12 @@ void Sender::IncreaseRegionConcurrency(const std::string& region) {
 
     auto regionInfo = iter->second;
     regionInfo->mContinuousErrorCount = 0;
+    if (BOOL_FLAG(enable_region_concurrency_control)) {
+        regionInfo->mConcurrency = RegionConcurrencyController::GetInstance()->OnSendSuccess(
+            region, endpoint, latencyMs, AppConfig::GetInstance()->GetSendRequestConcurrency(),
+            GetCurrentTimeInMilliSeconds());
+        return;
+    }
     if (-1 == regionInfo->mConcurrency)
         return;
     if (++regionInfo->mConcurrency >= AppConfig::GetInstance()->GetSendRequestConcurrency()) {
@@ -2454,13 +3182,22 @@ void Sender::IncreaseRegionConcurrency(const std::string& region) {
     }
 }
 
-void Sender::ResetRegionConcurrency(const std::string& region) {
+void Sender::ResetRegionConcurrency(const std::string& region, const std::string& endpoint, bool throttled) {
     PTScopedLock lock(mRegionEndpointEntryMapLock);
     auto iter = mRegionEndpointEntryMap.find(region);
     if (mRegionEndpointEntryMap.end() == iter)
         return;
 
     auto regionInfo = iter->second;
+    if (BOOL_FLAG(enable_region_concurrency_control)) {
+        regionInfo->mConcurrency = RegionConcurrencyController::GetInstance()->OnSendFail(
+            region, endpoint, AppConfig::GetInstance()->GetSendRequestConcurrency(), GetCurrentTimeInMilliSeconds());
+        return;
+    }
+    // Throttling is handled by the per logstore limiter without the controller.
+    if (throttled) {
+        return;
+    }
     if (++regionInfo->mContinuousErrorCount >= INT32_FLAG(reset_region_concurrency_error_count)) {
         auto oldConcurrency = regionInfo->mConcurrency;
         regionInfo->mConcurrency
@@ -2502,6 +3239,55 @@ bool Sender::FlushOut(int32_t time_interval_in_mili_seconds) {
     ResetFlush();
     return false;
 }
+bool Sender::SpillOut(int32_t timeoutMs) {
+    static Aggregator* aggregator = Aggregator::GetInstance();
+    const uint64_t deadline = GetCurrentTimeInMilliSeconds() + timeoutMs;
+    vector<LoggroupTimeValue*> logGroupToSpill;
+    bool drained = false;
+    // Idle log groups are buffered here like SendToNetAsync does in flush mode, until nothing is left in
+    // aggregator and compress pool.
+    while (GetCurrentTimeInMilliSeconds() < deadline) {
+        // deamon send thread may reset flush, so we should set flush every time
+        SetFlush();
+        aggregator->FlushReadyBuffer();
+        bool singleBatchMapFull = false;
+        mSenderQueue.PopAllItem(logGroupToSpill, time(NULL), singleBatchMapFull);
+        for (LoggroupTimeValue* item : logGroupToSpill) {
+            // Removed from sender queue first, the buffered item may be deleted by DumpSecondaryThread at once.
+            OnSendDone(item, LogstoreSenderInfo::SendResult_Buffered);
+            if (!item->mLogGroupContext.mExactlyOnceCheckpoint) {
+                PutIntoSecondaryBuffer(item, 3);
+            }
+        }
+        if (logGroupToSpill.empty() && aggregator->IsMergeMapEmpty()
+            && (!mCompressPool || mCompressPool->GetPendingCount() == 0)) {
+            drained = true;
+            break;
+        }
+        logGroupToSpill.clear();
+        usleep(10 * 1000);
+    }
+
+    // Requests in flight are not waited, their copies are buffered instead.
+    mSenderQueue.CopyAllSendingItem(logGroupToSpill);
+    for (LoggroupTimeValue* item : logGroupToSpill) {
+        PutIntoSecondaryBuffer(item, 3);
+    }
+    LOG_INFO(sLogger, ("spill log groups being sent to buffer file", logGroupToSpill.size()));
+
+    while (GetCurrentTimeInMilliSeconds() < deadline) {
+        {
+            WaitObject::Lock lock(mWriteSecondaryWait);
+            mWriteSecondaryWait.signal();
+        }
+        if (IsSecondaryBufferEmpty() && !mSecondaryWriting) {
+            return drained;
+        }
+        usleep(10 * 1000);
+    }
+    return false;
+}
+
 Sender::~Sender() {
     if (!FlushOut(3 * 1000)) {
         LogtailAlarm::GetInstance()->SendAlarm(DISCARD_DATA_ALARM,
@@ -2606,6 +3392,45 @@ void Sender::SetLogstoreFlowControl(const LogstoreFeedBackKey& logstoreKey,
     mSenderQueue.SetLogstoreFlowControl(logstoreKey, maxSendBytesPerSecond, expireTime);
 }
 
+void Sender::RecordSendHistograms(const LoggroupTimeValue* data) {
+    const uint64_t nowMs = GetCurrentTimeInMilliSeconds();
+    const std::string key = data->mRegion + "@" + data->mCurrentEndpoint;
+    ScopedSpinLock lock(mSendHistogramLock);
+    std::unique_ptr<SendHistograms>& histograms = mSendHistogramMap[key];
+    if (!histograms) {
+        histograms.reset(new SendHistograms);
+    }
+    if (data->mEnqueueTimeInMs > 0 && data->mLastSendTimeInMs >= data->mEnqueueTimeInMs) {
+        histograms->mQueueTimeInMs.Record(data->mLastSendTimeInMs - data->mEnqueueTimeInMs);
+    }
+    // Packages of a log package list are compressed together in batch, no time of each request.
+    if (data->mDataType == LOGGROUP_COMPRESSED) {
+        histograms->mCompressTimeInUs.Record(data->mCompressTimeInUs);
+    }
+    if (nowMs >= data->mLastSendTimeInMs) {
+        histograms->mRttInMs.Record(nowMs - data->mLastSendTimeInMs);
+    }
+    histograms->mRequestBytes.Record(data->mLogData.size());
+}
+
+void Sender::DumpSendHistograms(std::map<std::string, std::string>& summaries) {
+    std::unordered_map<std::string, std::unique_ptr<SendHistograms>> histogramMap;
+    {
+        ScopedSpinLock lock(mSendHistogramLock);
+        histogramMap.swap(mSendHistogramMap);
+    }
+    for (auto& item : histogramMap) {
+        const SendHistograms& histograms = *item.second;
+        summaries[item.first] = "queue_ms:{" + histograms.mQueueTimeInMs.ToString() + "};compress_us:{"
+            + histograms.mCompressTimeInUs.ToString() + "};rtt_ms:{" + histograms.mRttInMs.ToString() + "};bytes:{"
+            + histograms.mRequestBytes.ToString() + "}";
+    }
+}
+
+void Sender::SetLogstoreScheduling(const LogstoreFeedBackKey& logstoreKey, int32_t weight, int32_t priority) {
+    mSenderQueue.SetLogstoreScheduling(logstoreKey, weight, priority);
+}
+
 
 SlsClientInfo::SlsClientInfo(sdk::Client* client, int32_t updateTime) {
     sendClient = client;
@@ -2682,7 +3507,8 @@ void Sender::RealIpUpdateThread() {
                 PTScopedLock lock(mRegionEndpointEntryMapLock);
                 std::unordered_map<std::string, RegionEndpointEntry*>::iterator iter = mRegionEndpointEntryMap.begin();
                 for (; iter != mRegionEndpointEntryMap.end(); ++iter) {
-                    regionEndpointArray.push_back((iter->second)->GetCurrentEndpoint());
+                    regionEndpointArray.push_back((iter->second)->GetCurrentEndpoint(
+                        IsPickEndpointByLatency(), DOUBLE_FLAG(endpoint_switch_latency_ratio)));
                     regionArray.push_back(iter->first);
                 }
             }
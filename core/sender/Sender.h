@@ -15,13 +15,18 @@
  */
 
 #pragma once
+#include <map>
 #include <unordered_map>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include "common/LogstoreSenderQueue.h"
 #include "common/WaitObject.h"
+#include "common/Histogram.h"
 #include "common/Lock.h"
 #include "common/Thread.h"
 #include "sdk/Closure.h"
@@ -29,6 +34,8 @@
 #include "log_pb/logtail_buffer_meta.pb.h"
 #include "aggregator/Aggregator.h"
 #include "SenderQueueParam.h"
+#include "CompressWorkerPool.h"
+#include "BufferFileIndex.h"
 
 namespace logtail {
 
@@ -48,17 +55,23 @@ struct EndpointDetail {
     bool mStatus;
     bool mProxyFlag;
     int32_t mLatency; // ms
+    double mSmoothedLatency; // ms, moving average of latencies of succeeded tests
 
     EndpointDetail(bool status, int32_t latency, bool proxy) {
         mStatus = status;
         mLatency = latency >= 0 ? latency : 0;
+        mSmoothedLatency = mLatency;
         mProxyFlag = proxy;
     }
 
     void SetDetail(bool status, int32_t latency) {
         mStatus = status;
-        if (latency >= 0)
+        if (latency >= 0) {
             mLatency = latency;
+            if (status) {
+                mSmoothedLatency = mSmoothedLatency * 0.7 + latency * 0.3;
+            }
+        }
     }
 };
 
@@ -96,7 +109,16 @@ struct RegionEndpointEntry {
             mDefaultEndpoint.clear();
     }
 
-    std::string GetCurrentEndpoint() {
+    // GetCurrentEndpoint returns the endpoint to send, the default one is preferred if it is available.
+    // If @pickByLatency is true, the fastest available endpoint is chosen unless the default one is not
+    // much slower than it, see PickEndpointByLatency.
+    std::string GetCurrentEndpoint(bool pickByLatency = false, double switchLatencyRatio = 2.0) {
+        if (pickByLatency) {
+            std::string endpoint = PickEndpointByLatency(switchLatencyRatio);
+            if (!endpoint.empty()) {
+                return endpoint;
+            }
+        }
         if (mDefaultEndpoint.size() > 0) {
             std::unordered_map<std::string, EndpointDetail>::iterator iter = mEndpointDetailMap.find(mDefaultEndpoint);
             if (iter != mEndpointDetailMap.end() && (iter->second).mStatus)
@@ -123,6 +145,36 @@ struct RegionEndpointEntry {
             return mDefaultEndpoint;
     }
 
+    // PickEndpointByLatency returns the available endpoint with the lowest smoothed latency, proxy endpoints
+    // are used only if no other endpoints are available. The default endpoint is kept while its latency is
+    // within @switchLatencyRatio times of the lowest one, so endpoints are not switched for small changes.
+    std::string PickEndpointByLatency(double switchLatencyRatio) const {
+        const std::string* best = NULL;
+        const EndpointDetail* bestDetail = NULL;
+        for (auto iter = mEndpointDetailMap.begin(); iter != mEndpointDetailMap.end(); ++iter) {
+            const EndpointDetail& detail = iter->second;
+            if (!detail.mStatus) {
+                continue;
+            }
+            if (bestDetail == NULL || (bestDetail->mProxyFlag && !detail.mProxyFlag)
+                || (bestDetail->mProxyFlag == detail.mProxyFlag
+                    && detail.mSmoothedLatency < bestDetail->mSmoothedLatency)) {
+                best = &iter->first;
+                bestDetail = &detail;
+            }
+        }
+        if (best == NULL) {
+            return "";
+        }
+        auto defaultIter = mEndpointDetailMap.find(mDefaultEndpoint);
+        if (defaultIter != mEndpointDetailMap.end() && defaultIter->second.mStatus
+            && defaultIter->second.mProxyFlag == bestDetail->mProxyFlag
+            && defaultIter->second.mSmoothedLatency <= bestDetail->mSmoothedLatency * switchLatencyRatio) {
+            return mDefaultEndpoint;
+        }
+        return *best;
+    }
+
     void UpdateEndpointDetail(const std::string& endpoint, bool status, int32_t latency, bool createFlag = true) {
         std::unordered_map<std::string, EndpointDetail>::iterator iter = mEndpointDetailMap.find(endpoint);
         if (iter == mEndpointDetailMap.end()) {
@@ -179,6 +231,11 @@ private:
                                   const std::string& logData,
                                   std::string& errorCode);
     bool SendToBufferFile(LoggroupTimeValue* dataPtr);
+#if defined(__linux__)
+    // SendToBufferFile writes a batch of log groups to buffer file, log groups are encrypted
+    // in parallel and appended with one writev for each buffer file.
+    bool SendToBufferFile(const std::vector<LoggroupTimeValue*>& dataVec);
+#endif
     void FlowControl(int32_t dataSize, SEND_THREAD_TYPE type);
 
     bool IsValidToSend(const LogstoreFeedBackKey& logstoreKey);
@@ -189,6 +246,8 @@ private:
     WaitObject mWriteSecondaryWait; // semaphore between SendThreads & DumpSecondaryThread
     PTMutex mSecondaryMutexLock; // lock for mSecondaryBuffer
     std::vector<LoggroupTimeValue*> mSecondaryBuffer;
+    // true while DumpSecondaryThread writes log groups taken from mSecondaryBuffer
+    std::atomic_bool mSecondaryWriting{false};
 
     // for flow control: value[0] for realtime thread, value[1] for replay thread
     int64_t mSendLastTime[SEND_THREAD_TYPE_COUNT];
@@ -206,6 +265,27 @@ private:
         int32_t mRetryTime;
     };
 
+    // An encrypted log group ready to be appended to buffer file.
+    struct BufferFileRecord {
+        EncryptionStateMeta mMeta;
+        std::string mEncodedInfo;
+        std::unique_ptr<char[]> mData;
+        bool mValid = false;
+    };
+    bool EncodeBufferFileRecord(LoggroupTimeValue* dataPtr, BufferFileRecord& record);
+#if defined(__linux__)
+    // WriteBufferFileIndex appends block index to buffer file at @fileSize and seals the file.
+    bool WriteBufferFileIndex(int fd, int64_t fileSize, const std::string& filename);
+    void SealBufferFile();
+#endif
+
+    // Block index of the buffer file being written, only accessed by DumpSecondaryThread.
+    BufferFileIndex mBufferFileIndex;
+    std::string mIndexedBufferFileName;
+    bool mBufferFileIndexValid = false;
+    // Serializes flow control of replay threads.
+    std::mutex mReplayFlowControlMux;
+
     volatile bool mFlushLog;
     std::string mBufferFilePath;
     std::atomic_int mSendingLogGroupCount{0};
@@ -231,6 +311,16 @@ private:
     PTMutex mSendStatisticLock;
     std::unordered_map<std::string, std::vector<SendStatistic*> > mSendStatisticMap;
 
+    // Distributions of requests sent to one endpoint of region since last dump.
+    struct SendHistograms {
+        Histogram mQueueTimeInMs;
+        Histogram mCompressTimeInUs;
+        Histogram mRttInMs;
+        Histogram mRequestBytes;
+    };
+    SpinLock mSendHistogramLock;
+    std::unordered_map<std::string, std::unique_ptr<SendHistograms>> mSendHistogramMap;
+
     PTMutex mSendClientLock;
     std::unordered_map<std::string, SlsClientInfo*> mSendClientMap;
     int32_t mLastCheckSendClientTime;
@@ -245,6 +335,10 @@ private:
     std::atomic_int mLastDaemonRunTime{0};
     std::atomic_int mLastSendDataTime{0};
     std::atomic<int64_t> mLogGroupContextSeq{0};
+    // Serializes and compresses merge items, NULL before InitSender.
+    std::unique_ptr<CompressWorkerPool> mCompressPool;
+    // Encrypts log groups written to buffer file, NULL before InitSender.
+    std::unique_ptr<CompressWorkerPool> mBufferEncryptPool;
 
     int64_t mCheckPeriod;
     SpinLock mBufferFileLock; // get set bufferfilepath and buffer filename
@@ -265,6 +359,7 @@ private:
     typedef std::unordered_map<std::string, RealIpInfo*> RegionRealIpInfoMap;
     RegionRealIpInfoMap mRegionRealIpMap;
     sdk::Client* mUpdateRealIpClient;
+    sdk::Client* mProbeClient = NULL;
     PTMutex mRegionRealIpLock;
     bool mStopRealIpThread = false;
 
@@ -274,6 +369,13 @@ private:
     void ForceUpdateRealIp(const std::string& region);
     void UpdateSendClientRealIp(sdk::Client* client, const std::string& region);
     void RealIpUpdateThread();
+    // EndpointProbeThread tests all endpoints and real ips in background periodically, so unavailable or slow
+    // endpoints are switched before sending on them times out.
+    void EndpointProbeThread();
+    // ShardRouteThread lists shards of logstores looked up by ShardRouter in background periodically.
+    void ShardRouteThread();
+    // IsPickEndpointByLatency returns true if endpoints are chosen by latencies from background probes.
+    bool IsPickEndpointByLatency() const;
     EndpointStatus UpdateRealIp(const std::string& region, const std::string& endpoint);
     void SetRealIp(const std::string& region, const std::string& ip);
 
@@ -282,13 +384,21 @@ private:
     bool LoadFileToSend(time_t timeLine, std::vector<std::string>& filesToSend);
     bool CreateNewFile();
     bool WriteBackMeta(const int32_t pos, const void* buf, int32_t length, const std::string& filename);
-    bool ReadNextEncryption(int32_t& pos,
+    bool ReadNextEncryption(FILE* fin,
+                            int64_t fileSize,
+                            int32_t& pos,
                             const std::string& filename,
                             std::string& encryption,
                             EncryptionStateMeta& meta,
                             bool& readResult,
                             sls_logs::LogtailBufferMeta& bufferMeta);
+    // LoadBufferFileBlocks gets offsets of blocks to replay from the block index of a sealed buffer
+    // file, or by scanning block metas if the file has no valid index.
+    bool LoadBufferFileBlocks(const std::string& filename, int64_t& fileSize, std::vector<int32_t>& blockOffsets);
     void SendEncryptionBuffer(const std::string& filename, int32_t keyVersion);
+    // SendEncryptionBlock replays the block at @pos, returns false if it should be retried later.
+    bool SendEncryptionBlock(
+        FILE* fin, int64_t fileSize, int32_t pos, const std::string& filename, int32_t keyVersion, int32_t& discardCount);
 
     void ResetSendingCount();
     void IncSendingCount(int32_t val = 1);
@@ -312,7 +422,15 @@ private:
     std::string GetBufferFileHeader();
     void TestNetwork();
     bool TestEndpoint(const std::string& region, const std::string& endpoint);
+    // ProbeHost tests @host of @region with @client and returns false if it is unreachable, @latency is in ms.
+    bool ProbeHost(sdk::Client* client, const std::string& region, const std::string& host, int32_t& latency);
     void PutIntoBatchMap(LoggroupTimeValue* data);
+    // SubmitCompressTask runs @compress in compress pool and @emit in submit order.
+    void SubmitCompressTask(std::function<void()> compress, std::function<void()> emit);
+    // CompressMergeItem returns the compressed data of @item, or NULL if compression fails.
+    LoggroupTimeValue* CompressMergeItem(MergeItem* item);
+    // EmitCompressedData puts @data of @item into batch map, and releases @item.
+    void EmitCompressedData(MergeItem* item, LoggroupTimeValue* data);
 
     /*
      * only increase total count
@@ -354,7 +472,8 @@ public:
               const uint32_t logGroupSize,
               const std::string& defaultRegion = "",
               const std::string& filename = "",
-              const LogGroupContext& context = LogGroupContext());
+              const LogGroupContext& context = LogGroupContext(),
+              const std::shared_ptr<google::protobuf::Arena>& arena = nullptr);
 
     // bool LoadConfig(const Json::Value& secondary);
 
@@ -369,6 +488,10 @@ public:
 
     bool RemoveSender();
     bool FlushOut(int32_t time_interval_in_mili_seconds);
+    // SpillOut writes all data left in aggregator and sender queue into buffer files without waiting for
+    // network, log groups being sent are written too, so they may be sent twice after restart. Exactly once
+    // data is skipped. Returns false if buffer files are not written in @timeoutMs.
+    bool SpillOut(int32_t timeoutMs);
 
     ~Sender();
 
@@ -377,7 +500,13 @@ public:
 
     sdk::Client* GetSendClient(const std::string& region, const std::string& aliuid, bool createIfNotFound = true);
 
-    bool ResetSendClientEndpoint(const std::string aliuid, const std::string region, int32_t curTime);
+    // ResetSendClientEndpoint switches the client of @aliuid to the current endpoint of @region. If @warmUpClient
+    // is set, hosts of its recent projects are connected by it on the new endpoint first, so TLS sessions are
+    // resumed instead of handshaked when its requests move there. Only background threads pass it.
+    bool ResetSendClientEndpoint(const std::string aliuid,
+                                 const std::string region,
+                                 int32_t curTime,
+                                 sdk::Client* warmUpClient = NULL);
     void CleanTimeoutSendClient();
 
     // for debug & ut
@@ -422,8 +551,11 @@ public:
     void SetQueueUrgent();
     void ResetQueueUrgent();
 
-    void IncreaseRegionConcurrency(const std::string& region);
-    void ResetRegionConcurrency(const std::string& region);
+    // IncreaseRegionConcurrency and ResetRegionConcurrency update the concurrency of @region after a request to
+    // @endpoint is done, by RegionConcurrencyController if enable_region_concurrency_control is set.
+    void IncreaseRegionConcurrency(const std::string& region, const std::string& endpoint, int64_t latencyMs);
+    // @throttled means the request failed for quota, it only counts for RegionConcurrencyController.
+    void ResetRegionConcurrency(const std::string& region, const std::string& endpoint, bool throttled = false);
 
     int32_t GetSendingBufferCount();
 
@@ -441,6 +573,14 @@ public:
     LogstoreSenderStatistics GetSenderStatistics(const LogstoreFeedBackKey& key);
     void
     SetLogstoreFlowControl(const LogstoreFeedBackKey& logstoreKey, int32_t maxSendBytesPerSecond, int32_t expireTime);
+    void SetLogstoreScheduling(const LogstoreFeedBackKey& logstoreKey, int32_t weight, int32_t priority);
+
+    // RecordSendHistograms records time in queue, compress time, RTT and size of the request of @data,
+    // it is called when the response of @data is received.
+    void RecordSendHistograms(const LoggroupTimeValue* data);
+    // DumpSendHistograms moves summaries of histograms since last dump into @summaries, the key is
+    // "<region>@<endpoint>" and the value is like "queue_ms:{...};compress_us:{...};rtt_ms:{...};bytes:{...}".
+    void DumpSendHistograms(std::map<std::string, std::string>& summaries);
     bool SendPb(Config* pConfig,
                 char* pbBuffer,
                 int32_t pbSize,
@@ -467,6 +607,7 @@ public:
     friend class SenderUnittest;
     friend class ConfigUpdatorUnittest;
     friend class FuxiSceneUnittest;
+    friend class SenderBenchmark;
 #endif
 };
 
@@ -0,0 +1,122 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ShardRouter.h"
+#include <algorithm>
+#include <cctype>
+#include "common/Flags.h"
+#include "logger/Logger.h"
+
+DEFINE_FLAG_BOOL(enable_shard_route,
+                 "coalesce merge items with shard hash keys in the same shard by ranges listed from backend",
+                 false);
+DEFINE_FLAG_INT32(shard_route_refresh_interval, "interval to list shards of a logstore again, seconds", 300);
+DEFINE_FLAG_INT32(shard_route_retry_interval, "interval to list shards of a logstore after a failure, seconds", 30);
+DEFINE_FLAG_INT32(shard_route_expire_time, "shard ranges of a logstore not looked up for this are dropped", 3600);
+
+namespace logtail {
+
+namespace {
+
+    std::string ToUpperKey(const std::string& key) {
+        std::string result(key);
+        std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return std::toupper(c); });
+        return result;
+    }
+
+} // namespace
+
+int32_t ShardRouter::GetShardId(const std::string& project,
+                                const std::string& logstore,
+                                const std::string& region,
+                                const std::string& aliuid,
+                                const std::string& hashKey,
+                                int32_t curTime) {
+    std::lock_guard<std::mutex> lock(mMux);
+    LogstoreRoute& route = mRoutes[GetRouteKey(project, logstore)];
+    route.mLastUseTime = curTime;
+    if (!route.mLoaded) {
+        if (route.mProject.empty()) {
+            route.mProject = project;
+            route.mLogstore = logstore;
+        }
+        route.mRegion = region;
+        route.mAliuid = aliuid;
+        return -1;
+    }
+    auto iter = std::upper_bound(route.mRanges.begin(),
+                                 route.mRanges.end(),
+                                 hashKey,
+                                 [](const std::string& key, const Range& range) { return key < range.mBeginKey; });
+    if (iter == route.mRanges.begin()) {
+        return -1;
+    }
+    --iter;
+    return hashKey < iter->mEndKey ? iter->mShardId : -1;
+}
+
+void ShardRouter::Refresh(const ShardLister& lister, int32_t curTime) {
+    std::vector<LogstoreRoute> targets;
+    {
+        std::lock_guard<std::mutex> lock(mMux);
+        for (auto iter = mRoutes.begin(); iter != mRoutes.end();) {
+            LogstoreRoute& route = iter->second;
+            if (curTime - route.mLastUseTime >= INT32_FLAG(shard_route_expire_time)) {
+                iter = mRoutes.erase(iter);
+                continue;
+            }
+            const int32_t interval
+                = route.mLoaded ? INT32_FLAG(shard_route_refresh_interval) : INT32_FLAG(shard_route_retry_interval);
+            if (route.mUpdateTime == 0 || curTime - route.mUpdateTime >= interval) {
+                route.mUpdateTime = curTime;
+                targets.push_back(route);
+            }
+            ++iter;
+        }
+    }
+
+    for (LogstoreRoute& target : targets) {
+        std::vector<sdk::ShardInfo> shards;
+        if (!lister(target.mProject, target.mLogstore, target.mRegion, target.mAliuid, shards)) {
+            LOG_DEBUG(sLogger, ("list shards fail, project", target.mProject)("logstore", target.mLogstore));
+            continue;
+        }
+        std::vector<Range> ranges;
+        for (const sdk::ShardInfo& shard : shards) {
+            // Readonly shards are not written any more.
+            if (shard.status == "readwrite") {
+                ranges.push_back(
+                    Range{ToUpperKey(shard.inclusiveBeginKey), ToUpperKey(shard.exclusiveEndKey), shard.shardId});
+            }
+        }
+        std::sort(
+            ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.mBeginKey < b.mBeginKey; });
+
+        std::lock_guard<std::mutex> lock(mMux);
+        auto iter = mRoutes.find(GetRouteKey(target.mProject, target.mLogstore));
+        if (iter == mRoutes.end()) {
+            continue;
+        }
+        LogstoreRoute& route = iter->second;
+        if (!route.mLoaded || route.mRanges.size() != ranges.size()) {
+            LOG_INFO(sLogger,
+                     ("update shard ranges, project", target.mProject)("logstore", target.mLogstore)("shard count",
+                                                                                                   ranges.size()));
+        }
+        route.mRanges.swap(ranges);
+        route.mLoaded = true;
+    }
+}
+
+} // namespace logtail
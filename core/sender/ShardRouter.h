@@ -0,0 +1,93 @@
+/*
+ * Copyright 2022 iLogtail Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "sdk/Common.h"
+
+namespace logtail {
+
+// ShardRouter keeps hash key ranges of readwrite shards of logstores written with shard hash keys, so merge items
+// with different hash keys in the same shard can be sent in one request, which the backend writes to that shard
+// directly.
+//
+// Ranges are learned by Refresh in a background thread, a logstore is listed after it's first looked up, then
+// every shard_route_refresh_interval seconds to follow splits and merges of shards. Logstores not looked up for
+// a long time are dropped. Keys are compared in upper case, as hash keys are generated by sdk::CalcMD5.
+class ShardRouter {
+public:
+    // ShardLister lists shards of a logstore, returns false on failure.
+    typedef std::function<bool(const std::string& project,
+                               const std::string& logstore,
+                               const std::string& region,
+                               const std::string& aliuid,
+                               std::vector<sdk::ShardInfo>& shards)>
+        ShardLister;
+
+    static ShardRouter* GetInstance() {
+        static ShardRouter* instance = new ShardRouter();
+        return instance;
+    }
+
+    // GetShardId returns the shard of @hashKey in @logstore, -1 if ranges of @logstore are not learned yet.
+    int32_t GetShardId(const std::string& project,
+                       const std::string& logstore,
+                       const std::string& region,
+                       const std::string& aliuid,
+                       const std::string& hashKey,
+                       int32_t curTime);
+
+    // Refresh lists shards of logstores new or stale by @lister, it must not be called concurrently.
+    void Refresh(const ShardLister& lister, int32_t curTime);
+
+private:
+    ShardRouter() = default;
+
+    struct Range {
+        std::string mBeginKey;
+        std::string mEndKey;
+        int32_t mShardId;
+    };
+
+    struct LogstoreRoute {
+        std::string mProject;
+        std::string mLogstore;
+        std::string mRegion;
+        std::string mAliuid;
+        std::vector<Range> mRanges; // sorted by mBeginKey
+        bool mLoaded = false;
+        int32_t mUpdateTime = 0; // time of the latest list, successful or not
+        int32_t mLastUseTime = 0;
+    };
+
+    static std::string GetRouteKey(const std::string& project, const std::string& logstore) {
+        return project + "\n" + logstore;
+    }
+
+    std::mutex mMux;
+    std::unordered_map<std::string, LogstoreRoute> mRoutes;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class ShardRouterUnittest;
+#endif
+};
+
+} // namespace logtail
@@ -13,5 +13,137 @@
 // limitations under the License.
 
 #include "MetricSender.h"
+#include "common/Flags.h"
+#include "common/LogtailCommonFlags.h"
+#include "common/TimeUtil.h"
+#include "config_manager/ConfigManager.h"
+#include "log_pb/metric.pb.h"
+#include "logger/Logger.h"
+#include "profiler/LogFileProfiler.h"
+#include "profiler/LogtailAlarm.h"
+#include "sender/Sender.h"
 
-namespace logtail {}
+DECLARE_FLAG_BOOL(merge_shennong_metric);
+DEFINE_FLAG_INT32(metric_sender_batch_interval_ms, "max time a metric batch waits before it is sent", 1000);
+DEFINE_FLAG_INT32(metric_sender_batch_bytes, "metric batch is sent once its packets exceed it", 512 * 1024);
+DEFINE_FLAG_INT64(metric_sender_max_pending_bytes,
+                  "metric packets are dropped if the bytes waiting to be sent exceed it",
+                  32 * 1024 * 1024);
+
+namespace logtail {
+
+void MetricSender::AddMetric(const oas::MetricGroup& metricGroup, uint32_t packetSize) {
+    if (metricGroup.metrics_size() == 0) {
+        return;
+    }
+    if (mPendingBytes + packetSize > static_cast<size_t>(INT64_FLAG(metric_sender_max_pending_bytes))) {
+        LOG_ERROR(sLogger,
+                  ("metric sender pending bytes exceed limit, discard metrics",
+                   metricGroup.metrics_size())("category", metricGroup.metricname())("pending bytes", mPendingBytes));
+        LogtailAlarm::GetInstance()->SendAlarm(DISCARD_DATA_ALARM,
+                                               "metric sender pending bytes exceed limit, category: "
+                                                   + metricGroup.metricname());
+        return;
+    }
+
+    const std::string& source = metricGroup.metrics(0).source();
+    std::string key;
+    key.reserve(metricGroup.metricname().size() + metricGroup.key().size() + source.size() + 2);
+    key.append(metricGroup.metricname()).append(1, '\n').append(metricGroup.key()).append(1, '\n').append(source);
+    Batch& batch = mBatches[key];
+    sls_logs::LogGroup& logGroup = batch.mLogGroup;
+    if (batch.mCreateTimeMs == 0) {
+        batch.mCreateTimeMs = GetCurrentTimeInMilliSeconds();
+        logGroup.set_source(source);
+        logGroup.set_category(metricGroup.metricname());
+        logGroup.set_topic(metricGroup.key());
+        logGroup.set_machineuuid(ConfigManager::GetInstance()->GetUUID());
+    }
+    logGroup.mutable_logs()->Reserve(logGroup.logs_size() + metricGroup.metrics_size());
+    for (int i = 0; i < metricGroup.metrics_size(); ++i) {
+        const oas::Metric& metric = metricGroup.metrics(i);
+        sls_logs::Log* log = logGroup.add_logs();
+        log->set_time(metric.time());
+        log->mutable_contents()->Reserve(metric.contextgroup_size());
+        for (int j = 0; j < metric.contextgroup_size(); ++j) {
+            sls_logs::Log_Content* content = log->add_contents();
+            content->set_key(metric.contextgroup(j).key());
+            content->set_value(metric.contextgroup(j).value());
+        }
+    }
+    batch.mPacketBytes += packetSize;
+    mPendingBytes += packetSize;
+
+    if (batch.mPacketBytes >= static_cast<uint32_t>(INT32_FLAG(metric_sender_batch_bytes))
+        && SendBatch(batch, false)) {
+        mBatches.erase(key);
+    }
+}
+
+void MetricSender::Flush(bool force) {
+    if (mBatches.empty()) {
+        return;
+    }
+    const int64_t now = GetCurrentTimeInMilliSeconds();
+    for (auto iter = mBatches.begin(); iter != mBatches.end();) {
+        Batch& batch = iter->second;
+        if ((force || batch.mPacketBytes >= static_cast<uint32_t>(INT32_FLAG(metric_sender_batch_bytes))
+             || now - batch.mCreateTimeMs >= INT32_FLAG(metric_sender_batch_interval_ms))
+            && SendBatch(batch, force)) {
+            iter = mBatches.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+}
+
+bool MetricSender::SendBatch(Batch& batch, bool force) {
+    sls_logs::LogGroup& logGroup = batch.mLogGroup;
+    // The config is found when sent, batches do not keep configs which might be removed by config update.
+    Config* config = ConfigManager::GetInstance()->FindDSConfigByCategory(logGroup.category());
+    if (config != NULL && !force
+        && !Sender::Instance()->GetSenderFeedBackInterface()->IsValidToPush(config->mLogstoreKey)) {
+        return false;
+    }
+    mPendingBytes -= batch.mPacketBytes;
+    if (config == NULL) {
+        return true;
+    }
+
+    std::vector<sls_logs::LogTag> empty;
+    LogFileProfiler::GetInstance()->AddProfilingData(config->mConfigName,
+                                                     config->mRegion,
+                                                     config->mProjectName,
+                                                     config->mCategory,
+                                                     "",
+                                                     empty,
+                                                     batch.mPacketBytes,
+                                                     0,
+                                                     logGroup.logs_size(),
+                                                     0,
+                                                     0,
+                                                     0,
+                                                     0,
+                                                     0,
+                                                     "");
+    const int logCount = logGroup.logs_size();
+    // Sender::Send() will erase log group.
+    if (!Sender::Instance()->Send(config->mProjectName,
+                                  "",
+                                  logGroup,
+                                  config,
+                                  BOOL_FLAG(merge_shennong_metric) ? MERGE_BY_LOGSTORE : MERGE_BY_TOPIC,
+                                  (uint32_t)(batch.mPacketBytes * DOUBLE_FLAG(loggroup_bytes_inflation)))) {
+        LogtailAlarm::GetInstance()->SendAlarm(DISCARD_DATA_ALARM,
+                                               "push metric data into batch map fail",
+                                               config->mProjectName,
+                                               config->mCategory,
+                                               config->mRegion);
+        LOG_ERROR(sLogger,
+                  ("push metric data into batch map fail, discard logs",
+                   logCount)("project", config->mProjectName)("logstore", config->mCategory));
+    }
+    return true;
+}
+
+} // namespace logtail
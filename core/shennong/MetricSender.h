@@ -15,20 +15,54 @@
  */
 
 #pragma once
-#include <vector>
-#include "common/WaitObject.h"
-#include "common/Lock.h"
-#include "common/Thread.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include "log_pb/sls_logs.pb.h"
 
-namespace sls_logs {
-class LogGroup;
+namespace oas {
+class MetricGroup;
 }
 
 namespace logtail {
 
+// MetricSender batches metric groups read from DS packets before they are sent to the logstore of the DS
+// config. Logs of groups with the same category, topic and source are merged into one log group, which is
+// sent when it is large or old enough, so Sender handles one log group per batch rather than per packet.
+// A batch waits while its logstore is not valid to push, packets are dropped if too many bytes are waiting.
+//
+// It is only used by the dispatcher thread.
 class MetricSender {
 public:
-    static void SendMetric(const sls_logs::LogGroup& logGroup) {}
+    static MetricSender* GetInstance() {
+        static MetricSender* sPtr = new MetricSender();
+        return sPtr;
+    }
+
+    // AddMetric merges @metricGroup, parsed from a packet of @packetSize bytes, into its batch.
+    void AddMetric(const oas::MetricGroup& metricGroup, uint32_t packetSize);
+
+    // Flush sends batches that are full or older than metric_sender_batch_interval_ms, all batches are sent
+    // regardless of flow control if @force is set.
+    void Flush(bool force = false);
+
+    size_t GetPendingBytes() const { return mPendingBytes; }
+
+private:
+    MetricSender() = default;
+
+    struct Batch {
+        sls_logs::LogGroup mLogGroup;
+        uint32_t mPacketBytes = 0;
+        int64_t mCreateTimeMs = 0;
+    };
+
+    // SendBatch returns false if @batch should wait for flow control.
+    bool SendBatch(Batch& batch, bool force);
+
+    // Key is category, topic and source.
+    std::unordered_map<std::string, Batch> mBatches;
+    size_t mPendingBytes = 0;
 };
 
 } // namespace logtail
@@ -0,0 +1,114 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "StreamLogFormat.h"
+#include <cstring>
+#include <mutex>
+#include "logger/Logger.h"
+
+namespace logtail {
+
+const char* const StreamLogLine::DEFAULT_CONTENT_KEY = "content";
+
+static std::mutex sFormatsMux;
+static std::shared_ptr<const StreamLogLine::FormatMap> sFormats(new StreamLogLine::FormatMap);
+
+bool StreamLogLine::Parse(const char* record, size_t size) {
+    if (size > 0 && record[size - 1] == '\r') {
+        --size;
+    }
+    const char* tab = static_cast<const char*>(memchr(record, '\t', size));
+    if (tab == NULL || tab == record) {
+        return false;
+    }
+    mTag = StreamLogField(record, tab - record);
+    mPayload = StreamLogField(tab + 1, record + size - tab - 1);
+    return true;
+}
+
+void StreamLogLine::ToLog(const StreamLogFormat* format, sls_logs::Log& log) const {
+    if (format == NULL || format->mKeys.empty()) {
+        sls_logs::Log_Content* content = log.add_contents();
+        content->set_key(DEFAULT_CONTENT_KEY);
+        content->set_value(mPayload.mData, mPayload.mSize);
+        return;
+    }
+    const char* begin = mPayload.mData;
+    const char* end = mPayload.mData + mPayload.mSize;
+    for (size_t i = 0; i < format->mKeys.size(); ++i) {
+        const char* fieldEnd = end;
+        if (i + 1 < format->mKeys.size()) {
+            const char* separator = static_cast<const char*>(memchr(begin, format->mSeparator, end - begin));
+            if (separator != NULL) {
+                fieldEnd = separator;
+            }
+        }
+        sls_logs::Log_Content* content = log.add_contents();
+        content->set_key(format->mKeys[i]);
+        content->set_value(begin, fieldEnd - begin);
+        if (fieldEnd == end) {
+            // Missing fields are left out.
+            break;
+        }
+        begin = fieldEnd + 1;
+    }
+}
+
+std::shared_ptr<const StreamLogLine::FormatMap> StreamLogLine::GetFormats() {
+    std::lock_guard<std::mutex> lock(sFormatsMux);
+    return sFormats;
+}
+
+void StreamLogLine::ClearFormats() {
+    std::lock_guard<std::mutex> lock(sFormatsMux);
+    sFormats.reset(new FormatMap);
+}
+
+void StreamLogLine::AddDefaultFormats() {
+    // Tags without format put the whole payload into content, nothing to add.
+}
+
+const bool StreamLogLine::InitFormats(const Json::Value& json) {
+    std::shared_ptr<FormatMap> formats(new FormatMap(*GetFormats()));
+    bool result = true;
+    for (Json::ArrayIndex i = 0; i < json.size(); ++i) {
+        const Json::Value& item = json[i];
+        if (!item.isObject() || !item["tag"].isString() || !item["keys"].isArray() || item["keys"].empty()) {
+            LOG_ERROR(sLogger, ("invalid streamlog format, tag and keys are required", item.toStyledString()));
+            result = false;
+            continue;
+        }
+        StreamLogFormat format;
+        format.mTag = item["tag"].asString();
+        if (item.isMember("separator")) {
+            const std::string separator = item["separator"].isString() ? item["separator"].asString() : "";
+            if (separator.size() != 1) {
+                LOG_ERROR(sLogger, ("invalid streamlog format, separator must be one char", format.mTag));
+                result = false;
+                continue;
+            }
+            format.mSeparator = separator[0];
+        }
+        for (Json::ArrayIndex k = 0; k < item["keys"].size(); ++k) {
+            format.mKeys.push_back(item["keys"][k].asString());
+        }
+        LOG_INFO(sLogger, ("add streamlog format", format.mTag)("keys", format.mKeys.size()));
+        (*formats)[format.mTag] = format;
+    }
+    std::lock_guard<std::mutex> lock(sFormatsMux);
+    sFormats = formats;
+    return result;
+}
+
+} // namespace logtail
@@ -15,6 +15,9 @@
  */
 
 #pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include <json/json.h>
@@ -22,13 +25,60 @@
 
 namespace logtail {
 
+// StreamLogField points into the receive buffer, it is valid until the buffer is released.
+struct StreamLogField {
+    const char* mData = NULL;
+    size_t mSize = 0;
+
+    StreamLogField() {}
+    StreamLogField(const char* data, size_t size) : mData(data), mSize(size) {}
+    std::string ToString() const { return std::string(mData, mSize); }
+};
+
+// StreamLogFormat splits the payload of records with @mTag into fields by @mSeparator, fields are named by
+// @mKeys in order, the rest of the payload goes into the last key.
+struct StreamLogFormat {
+    std::string mTag;
+    char mSeparator = '\t';
+    std::vector<std::string> mKeys;
+};
+
+// StreamLogLine parses a record of stream log. Records are separated by '\n' and look like
+//     <tag>\t<payload>
+// where <tag> matches the "tag" of a streamlog config. Records of tags without a format in
+// "streamlog_formats" of app config put the whole payload into "content". For example,
+//     "streamlog_formats": [{"tag": "nginx", "separator": "|", "keys": ["ip", "status", "request"]}]
+// parses "nginx\t10.0.0.1|200|GET /" into ip, status and request.
+//
+// Parse does not copy, the record must outlive the fields.
 class StreamLogLine {
 public:
+    static const char* const DEFAULT_CONTENT_KEY;
+
     StreamLogLine() {}
 
-    static void ClearFormats() {}
-    static void AddDefaultFormats() {}
-    static const bool InitFormats(const Json::Value& json) { return true; }
+    // Parse splits @record (without the trailing '\n') into tag and payload, returns false if there
+    // is no tag. A trailing '\r' is dropped.
+    bool Parse(const char* record, size_t size);
+
+    const StreamLogField& GetTag() const { return mTag; }
+    const StreamLogField& GetPayload() const { return mPayload; }
+
+    // ToLog fills the contents of @log by @format, NULL format puts the payload into "content".
+    void ToLog(const StreamLogFormat* format, sls_logs::Log& log) const;
+
+    typedef std::unordered_map<std::string, StreamLogFormat> FormatMap;
+
+    // GetFormats returns a snapshot of formats, it stays valid when formats are reloaded.
+    static std::shared_ptr<const FormatMap> GetFormats();
+    static void ClearFormats();
+    static void AddDefaultFormats();
+    // InitFormats adds formats in @json array, invalid ones are skipped with error logs.
+    static const bool InitFormats(const Json::Value& json);
+
+private:
+    StreamLogField mTag;
+    StreamLogField mPayload;
 };
 
 } // namespace logtail
@@ -13,5 +13,432 @@
 // limitations under the License.
 
 #include "StreamLogManager.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#include "common/ErrorUtil.h"
+#include "common/Flags.h"
+#include "common/StringTools.h"
+#include "logger/Logger.h"
+#include "profiler/LogFileProfiler.h"
+#include "profiler/LogtailAlarm.h"
+#include "sender/Sender.h"
 
-namespace logtail {}
+DEFINE_FLAG_INT32(streamlog_max_blocks_per_read, "max blocks read from a connection before yielding to others", 8);
+DEFINE_FLAG_INT32(streamlog_push_retry_interval_ms, "interval to retry when sender queue of config is full", 10);
+
+namespace logtail {
+
+static const size_t kMinBlockSize = 4 * 1024;
+static const size_t kMaxBlockSize = 1024 * 1024;
+
+StreamLogBlockPool::StreamLogBlockPool(size_t poolSize, size_t blockSize)
+    : mBlockSize(blockSize), mMaxBlockCount(std::max(poolSize / blockSize, (size_t)2)) {
+}
+
+StreamLogBlockPool::~StreamLogBlockPool() {
+    for (size_t i = 0; i < mFreeBlocks.size(); ++i) {
+        delete[] mFreeBlocks[i];
+    }
+}
+
+char* StreamLogBlockPool::Acquire() {
+    std::lock_guard<std::mutex> lock(mMux);
+    if (!mFreeBlocks.empty()) {
+        char* block = mFreeBlocks.back();
+        mFreeBlocks.pop_back();
+        return block;
+    }
+    if (mAllocatedCount >= mMaxBlockCount) {
+        return NULL;
+    }
+    ++mAllocatedCount;
+    return new char[mBlockSize];
+}
+
+void StreamLogBlockPool::Release(char* block) {
+    std::lock_guard<std::mutex> lock(mMux);
+    mFreeBlocks.push_back(block);
+}
+
+size_t StreamLogSplitter::Prepare(char* block, size_t blockSize) {
+    if (mPending.size() >= blockSize) {
+        mPending.clear();
+        mDiscarding = true;
+        ++mDiscardCount;
+        return 0;
+    }
+    size_t size = mPending.size();
+    memcpy(block, mPending.data(), size);
+    mPending.clear();
+    return size;
+}
+
+size_t StreamLogSplitter::Split(const char* block, size_t size, size_t& begin) {
+    begin = 0;
+    if (mDiscarding) {
+        const char* newLine = static_cast<const char*>(memchr(block, '\n', size));
+        if (newLine == NULL) {
+            begin = size;
+            return size;
+        }
+        mDiscarding = false;
+        begin = newLine - block + 1;
+    }
+    size_t end = begin;
+    if (begin < size) {
+        const char* lastNewLine = static_cast<const char*>(memrchr(block + begin, '\n', size - begin));
+        if (lastNewLine != NULL) {
+            end = lastNewLine - block + 1;
+        }
+    }
+    mPending.assign(block + end, size - end);
+    return end;
+}
+
+StreamLogManager::StreamLogManager(const uint32_t poolSizeInMb,
+                                   const uint32_t colSize,
+                                   const int epollFd,
+                                   const int rcvThreaNum,
+                                   const int procThreadNum)
+    : mEpollFd(epollFd),
+      mPool((size_t)poolSizeInMb * 1024 * 1024,
+            std::min(std::max((size_t)colSize * 1024, kMinBlockSize), kMaxBlockSize)) {
+    LOG_INFO(sLogger,
+             ("start streamlog manager, pool size in mb", poolSizeInMb)("block size", mPool.GetBlockSize())(
+                 "receive threads", rcvThreaNum)("parse threads", procThreadNum));
+    for (int i = 0; i < std::max(procThreadNum, 1); ++i) {
+        mParseQueues.emplace_back(new ParseQueue);
+    }
+    for (size_t i = 0; i < mParseQueues.size(); ++i) {
+        mParseThreads.emplace_back(&StreamLogManager::ParseThread, this, mParseQueues[i].get());
+    }
+    for (int i = 0; i < std::max(rcvThreaNum, 1); ++i) {
+        mRcvThreads.emplace_back(&StreamLogManager::RcvThread, this);
+    }
+}
+
+StreamLogManager::~StreamLogManager() {
+    Shutdown();
+}
+
+void StreamLogManager::AwakenTimeoutFds() {
+    std::lock_guard<std::mutex> lock(mRcvMux);
+    if (mParkedFds.empty()) {
+        return;
+    }
+    LOG_WARNING(sLogger, ("streamlog pool is full, connections waiting for blocks", mParkedFds.size()));
+    mRcvTasks.insert(mRcvTasks.end(), mParkedFds.begin(), mParkedFds.end());
+    mParkedFds.clear();
+    mRcvCond.notify_all();
+}
+
+void StreamLogManager::ShutdownConfigUsage() {
+    std::unique_lock<std::mutex> lock(mConfigMux);
+    mConfigUsable = false;
+    mConfigCond.wait(lock, [this]() { return mConfigUsers == 0; });
+}
+
+void StreamLogManager::StartupConfigUsage() {
+    std::lock_guard<std::mutex> lock(mConfigMux);
+    mConfigUsable = true;
+    mConfigCond.notify_all();
+}
+
+bool StreamLogManager::AcquireConfigUsage() {
+    std::unique_lock<std::mutex> lock(mConfigMux);
+    mConfigCond.wait(lock, [this]() { return mConfigUsable || mShutdown; });
+    if (mShutdown) {
+        return false;
+    }
+    ++mConfigUsers;
+    return true;
+}
+
+void StreamLogManager::ReleaseConfigUsage() {
+    std::lock_guard<std::mutex> lock(mConfigMux);
+    if (--mConfigUsers == 0) {
+        mConfigCond.notify_all();
+    }
+}
+
+void StreamLogManager::AddRcvTask(const int fd) {
+    std::lock_guard<std::mutex> lock(mRcvMux);
+    mRcvTasks.push_back(fd);
+    mRcvCond.notify_one();
+}
+
+const bool StreamLogManager::AcceptedFdsContains(const int fd) {
+    std::lock_guard<std::mutex> lock(mFdsMux);
+    return mConnections.find(fd) != mConnections.end();
+}
+
+void StreamLogManager::InsertToAcceptedFds(const int fd) {
+    std::lock_guard<std::mutex> lock(mFdsMux);
+    mConnections[fd] = std::make_shared<Connection>();
+}
+
+void StreamLogManager::DeleteFd(const int fd) {
+    {
+        std::lock_guard<std::mutex> lock(mFdsMux);
+        if (mConnections.erase(fd) == 0) {
+            return;
+        }
+    }
+    close(fd);
+}
+
+void StreamLogManager::CloseFd(const int fd) {
+    int64_t discardCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(mFdsMux);
+        auto iter = mConnections.find(fd);
+        if (iter == mConnections.end()) {
+            return;
+        }
+        discardCount = iter->second->mSplitter.GetDiscardCount();
+        mConnections.erase(iter);
+    }
+    close(fd);
+    LOG_INFO(sLogger, ("streamlog connection closed", fd)("discarded records", discardCount));
+}
+
+std::shared_ptr<StreamLogManager::Connection> StreamLogManager::FindConnection(const int fd) {
+    std::lock_guard<std::mutex> lock(mFdsMux);
+    auto iter = mConnections.find(fd);
+    return iter == mConnections.end() ? std::shared_ptr<Connection>() : iter->second;
+}
+
+void StreamLogManager::RearmFd(const int fd) {
+#if defined(__linux__)
+    struct epoll_event ee;
+    ee.events = EPOLLIN;
+    ee.data.fd = fd;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &ee) != 0) {
+        LOG_WARNING(sLogger, ("add streamlog fd to epoll fail", fd)("errno", ErrnoToString(errno)));
+        CloseFd(fd);
+    }
+#endif
+}
+
+void StreamLogManager::RcvThread() {
+    LOG_INFO(sLogger, ("streamlog receive thread", "start"));
+    while (!mShutdown) {
+        int fd = -1;
+        {
+            std::unique_lock<std::mutex> lock(mRcvMux);
+            mRcvCond.wait(lock, [this]() { return !mRcvTasks.empty() || mShutdown; });
+            if (mShutdown) {
+                break;
+            }
+            fd = mRcvTasks.front();
+            mRcvTasks.pop_front();
+        }
+        std::shared_ptr<Connection> conn = FindConnection(fd);
+        if (conn) {
+            ReadFd(fd, conn);
+        }
+    }
+    LOG_INFO(sLogger, ("streamlog receive thread", "stop"));
+}
+
+bool StreamLogManager::ReadFd(const int fd, const std::shared_ptr<Connection>& conn) {
+    StreamLogSplitter& splitter = conn->mSplitter;
+    const size_t blockSize = mPool.GetBlockSize();
+    ParseQueue* queue = mParseQueues[fd % mParseQueues.size()].get();
+    for (int round = 0; round < INT32_FLAG(streamlog_max_blocks_per_read); ++round) {
+        char* block = mPool.Acquire();
+        if (block == NULL) {
+            // Parse threads move parked fds back to tasks after releasing blocks.
+            std::lock_guard<std::mutex> lock(mRcvMux);
+            mParkedFds.push_back(fd);
+            return true;
+        }
+        size_t prepared = splitter.Prepare(block, blockSize);
+        ssize_t n = 0;
+        do {
+            n = recv(fd, block + prepared, blockSize - prepared, 0);
+        } while (n < 0 && errno == EINTR);
+
+        Chunk chunk;
+        chunk.mBlock = block;
+        if (n > 0) {
+            chunk.mEnd = splitter.Split(block, prepared + n, chunk.mBegin);
+        } else if (n == 0) {
+            // The last record may have no '\n' before peer closes.
+            chunk.mEnd = prepared;
+        } else {
+            int savedErrno = errno;
+            // Keep the pending record for next read.
+            splitter.Split(block, prepared, chunk.mBegin);
+            mPool.Release(block);
+            if (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK) {
+                RearmFd(fd);
+                return true;
+            }
+            LOG_WARNING(sLogger, ("recv streamlog fail", fd)("errno", ErrnoToString(savedErrno)));
+            CloseFd(fd);
+            return false;
+        }
+
+        if (chunk.mEnd > chunk.mBegin) {
+            std::lock_guard<std::mutex> lock(queue->mMux);
+            queue->mChunks.push_back(chunk);
+            queue->mCond.notify_one();
+        } else {
+            mPool.Release(block);
+        }
+        if (n == 0) {
+            CloseFd(fd);
+            return false;
+        }
+    }
+    // Yield to other connections, the fd is still readable.
+    AddRcvTask(fd);
+    return true;
+}
+
+void StreamLogManager::ParseThread(ParseQueue* queue) {
+    LOG_INFO(sLogger, ("streamlog parse thread", "start"));
+    while (!mShutdown) {
+        Chunk chunk;
+        {
+            std::unique_lock<std::mutex> lock(queue->mMux);
+            queue->mCond.wait(lock, [this, queue]() { return !queue->mChunks.empty() || mShutdown; });
+            if (mShutdown) {
+                break;
+            }
+            chunk = queue->mChunks.front();
+            queue->mChunks.pop_front();
+        }
+        ParseChunk(chunk);
+        mPool.Release(chunk.mBlock);
+        std::lock_guard<std::mutex> lock(mRcvMux);
+        if (!mParkedFds.empty()) {
+            mRcvTasks.push_back(mParkedFds.back());
+            mParkedFds.pop_back();
+            mRcvCond.notify_one();
+        }
+    }
+    LOG_INFO(sLogger, ("streamlog parse thread", "stop"));
+}
+
+void StreamLogManager::ParseChunk(const Chunk& chunk) {
+    std::shared_ptr<const StreamLogLine::FormatMap> formats = StreamLogLine::GetFormats();
+    // Connections seldom mix many tags, linear search is cheaper than hashing each tag.
+    std::vector<std::pair<StreamLogField, sls_logs::LogGroup>> logGroups;
+    std::vector<const StreamLogFormat*> groupFormats;
+    const uint32_t now = time(NULL);
+    int64_t invalidCount = 0;
+
+    const char* data = chunk.mBlock;
+    size_t pos = chunk.mBegin;
+    while (pos < chunk.mEnd) {
+        const char* newLine = static_cast<const char*>(memchr(data + pos, '\n', chunk.mEnd - pos));
+        size_t lineEnd = newLine == NULL ? chunk.mEnd : newLine - data;
+        StreamLogLine line;
+        bool parsed = line.Parse(data + pos, lineEnd - pos);
+        pos = lineEnd + 1;
+        if (!parsed) {
+            ++invalidCount;
+            continue;
+        }
+
+        const StreamLogField& tag = line.GetTag();
+        size_t idx = 0;
+        for (; idx < logGroups.size(); ++idx) {
+            const StreamLogField& groupTag = logGroups[idx].first;
+            if (groupTag.mSize == tag.mSize && memcmp(groupTag.mData, tag.mData, tag.mSize) == 0) {
+                break;
+            }
+        }
+        if (idx == logGroups.size()) {
+            logGroups.emplace_back(tag, sls_logs::LogGroup());
+            auto iter = formats->find(tag.ToString());
+            groupFormats.push_back(iter == formats->end() ? NULL : &iter->second);
+        }
+        sls_logs::Log* log = logGroups[idx].second.add_logs();
+        log->set_time(now);
+        line.ToLog(groupFormats[idx], *log);
+    }
+    if (invalidCount > 0) {
+        LOG_WARNING(sLogger, ("discard streamlog records without tag", invalidCount));
+    }
+
+    for (size_t i = 0; i < logGroups.size(); ++i) {
+        SendLogGroup(logGroups[i].first.ToString(), logGroups[i].second);
+    }
+}
+
+void StreamLogManager::SendLogGroup(const std::string& tag, sls_logs::LogGroup& logGroup) {
+    std::string pb;
+    while (AcquireConfigUsage()) {
+        Config* config = ConfigManager::GetInstance()->FindStreamLogTagMatch(tag);
+        if (config == NULL) {
+            ReleaseConfigUsage();
+            LOG_DEBUG(sLogger, ("no streamlog config matches tag, discard logs", tag)("lines", logGroup.logs_size()));
+            LogtailAlarm::GetInstance()->CountAlarm(DISCARD_DATA_ALARM, "", "", "", [&tag]() {
+                return "no streamlog config matches tag, discard logs, tag: " + tag;
+            });
+            return;
+        }
+        if (!Sender::Instance()->GetSenderFeedBackInterface()->IsValidToPush(config->mLogstoreKey)) {
+            // Release configs so config update is not blocked by a full queue.
+            ReleaseConfigUsage();
+            usleep(INT32_FLAG(streamlog_push_retry_interval_ms) * 1000);
+            continue;
+        }
+        logGroup.set_category(config->mCategory);
+        logGroup.set_source(LogFileProfiler::mIpAddr);
+        if (pb.empty()) {
+            logGroup.SerializeToString(&pb);
+        }
+        Sender::Instance()->SendPb(config, const_cast<char*>(pb.data()), pb.size(), logGroup.logs_size());
+        ReleaseConfigUsage();
+        return;
+    }
+}
+
+void StreamLogManager::Shutdown() {
+    if (mShutdown.exchange(true)) {
+        return;
+    }
+    LOG_INFO(sLogger, ("streamlog manager", "shutdown"));
+    {
+        std::lock_guard<std::mutex> lock(mRcvMux);
+        mRcvCond.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mConfigMux);
+        mConfigCond.notify_all();
+    }
+    for (size_t i = 0; i < mParseQueues.size(); ++i) {
+        std::lock_guard<std::mutex> lock(mParseQueues[i]->mMux);
+        mParseQueues[i]->mCond.notify_all();
+    }
+    for (size_t i = 0; i < mRcvThreads.size(); ++i) {
+        mRcvThreads[i].join();
+    }
+    for (size_t i = 0; i < mParseThreads.size(); ++i) {
+        mParseThreads[i].join();
+    }
+    for (size_t i = 0; i < mParseQueues.size(); ++i) {
+        for (auto& chunk : mParseQueues[i]->mChunks) {
+            mPool.Release(chunk.mBlock);
+        }
+        mParseQueues[i]->mChunks.clear();
+    }
+    std::lock_guard<std::mutex> lock(mFdsMux);
+    for (auto& item : mConnections) {
+        close(item.first);
+    }
+    mConnections.clear();
+}
+
+} // namespace logtail
@@ -16,35 +16,149 @@
 
 #ifndef __STREAMLOG_MANAGER_H__
 #define __STREAMLOG_MANAGER_H__
-#include <queue>
-#include <iostream>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 #include <unordered_map>
 #include <unordered_set>
 #include "config_manager/ConfigManager.h"
 #include "common/Lock.h"
-#include "common/ThreadPool.h"
 #include "StreamLogFormat.h"
 
 namespace logtail {
 
+// StreamLogBlockPool holds fixed size receive blocks, blocks are allocated lazily until the pool size,
+// and are reused after parse threads release them.
+class StreamLogBlockPool {
+public:
+    StreamLogBlockPool(size_t poolSize, size_t blockSize);
+    ~StreamLogBlockPool();
+
+    // Acquire returns NULL if all blocks are in use.
+    char* Acquire();
+    void Release(char* block);
+
+    size_t GetBlockSize() const { return mBlockSize; }
+    size_t GetMaxBlockCount() const { return mMaxBlockCount; }
+
+private:
+    const size_t mBlockSize;
+    const size_t mMaxBlockCount;
+    std::mutex mMux;
+    std::vector<char*> mFreeBlocks;
+    size_t mAllocatedCount = 0;
+};
+
+// StreamLogSplitter cuts the byte stream of a connection into complete records, it keeps the partial
+// record at the end of a block and moves it to the front of the next block, so complete records are
+// parsed in place.
+class StreamLogSplitter {
+public:
+    // Prepare copies the pending bytes into @block, returns the size copied. The pending record is
+    // dropped if it fills the whole block, the rest of it is discarded until the next '\n'.
+    size_t Prepare(char* block, size_t blockSize);
+
+    // Split handles @size bytes in @block (including the prepared ones), returns the size of leading
+    // complete records, the rest is kept as pending. @begin is set to the first byte to parse, it is
+    // after the end of a discarded record.
+    size_t Split(const char* block, size_t size, size_t& begin);
+
+    // GetDiscardCount returns the count of records discarded because they are longer than a block.
+    int64_t GetDiscardCount() const { return mDiscardCount; }
+
+private:
+    std::string mPending;
+    bool mDiscarding = false;
+    int64_t mDiscardCount = 0;
+};
+
+// StreamLogManager receives stream logs from tcp connections accepted by event dispatcher. The dispatcher
+// removes a readable fd from its epoll and adds a receive task, receive threads read the fd into pooled
+// blocks until EAGAIN and add it back to the epoll. Complete records in a block are handed to the parse
+// thread chosen by fd, so records of a connection keep their order. Parse threads group records by tag
+// into log groups and send them with the streamlog config of the tag.
 class StreamLogManager {
 public:
+    // @colSize is the size of a receive block in KB, @poolSizeInMb limits the total size of blocks.
     StreamLogManager(const uint32_t poolSizeInMb,
                      const uint32_t colSize,
                      const int epollFd,
                      const int rcvThreaNum = 1,
-                     const int procThreadNum = 2) {}
-    virtual ~StreamLogManager() {}
+                     const int procThreadNum = 2);
+    virtual ~StreamLogManager();
 
 public:
-    void AwakenTimeoutFds() {}
-    void ShutdownConfigUsage() {}
-    void StartupConfigUsage() {}
-    void AddRcvTask(const int fd) {}
-    const bool AcceptedFdsContains(const int fd) { return true; }
-    void InsertToAcceptedFds(const int fd) {}
-    void DeleteFd(const int fd) {}
-    void Shutdown() {}
+    // AwakenTimeoutFds retries the fds waiting for free blocks, it is called by dispatcher periodically.
+    void AwakenTimeoutFds();
+    // ShutdownConfigUsage waits until parse threads stop using configs, it is called before config update.
+    void ShutdownConfigUsage();
+    void StartupConfigUsage();
+    void AddRcvTask(const int fd);
+    const bool AcceptedFdsContains(const int fd);
+    void InsertToAcceptedFds(const int fd);
+    // DeleteFd closes @fd, it is called when @fd is in the epoll of dispatcher.
+    void DeleteFd(const int fd);
+    void Shutdown();
+
+private:
+    struct Connection {
+        StreamLogSplitter mSplitter;
+    };
+
+    struct Chunk {
+        char* mBlock = NULL;
+        size_t mBegin = 0;
+        size_t mEnd = 0;
+    };
+
+    struct ParseQueue {
+        std::mutex mMux;
+        std::condition_variable mCond;
+        std::deque<Chunk> mChunks;
+    };
+
+    void RcvThread();
+    // ReadFd returns false if @fd is closed.
+    bool ReadFd(const int fd, const std::shared_ptr<Connection>& conn);
+    void RearmFd(const int fd);
+    void CloseFd(const int fd);
+    std::shared_ptr<Connection> FindConnection(const int fd);
+
+    void ParseThread(ParseQueue* queue);
+    void ParseChunk(const Chunk& chunk);
+    void SendLogGroup(const std::string& tag, sls_logs::LogGroup& logGroup);
+    bool AcquireConfigUsage();
+    void ReleaseConfigUsage();
+
+    const int mEpollFd;
+    StreamLogBlockPool mPool;
+    std::atomic_bool mShutdown{false};
+
+    std::mutex mFdsMux;
+    std::unordered_map<int, std::shared_ptr<Connection>> mConnections;
+
+    std::mutex mRcvMux;
+    std::condition_variable mRcvCond;
+    std::deque<int> mRcvTasks;
+    std::vector<int> mParkedFds;
+    std::vector<std::thread> mRcvThreads;
+
+    std::vector<std::unique_ptr<ParseQueue>> mParseQueues;
+    std::vector<std::thread> mParseThreads;
+
+    std::mutex mConfigMux;
+    std::condition_variable mConfigCond;
+    bool mConfigUsable = true;
+    int mConfigUsers = 0;
+
+#ifdef APSARA_UNIT_TEST_MAIN
+    friend class StreamLogUnittest;
+#endif
 };
 }; // namespace logtail
 
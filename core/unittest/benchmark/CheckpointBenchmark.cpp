@@ -0,0 +1,337 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// checkpoint_benchmark fills bench_checkpoint_files file checkpoints of real files into CheckPointManager and
+// bench_range_checkpoints exactly once range checkpoints into CheckpointManagerV2, and reports:
+//  - v1: time, size on disk and bytes written of a full dump and of a dump after bench_checkpoint_update_ratio
+//    of checkpoints are updated, the write amplification of the latter is bytes written per changed
+//    checkpoint byte, then the time to load the dump and to validate all checkpoints as on start;
+//  - v2: time and bytes written to put all primary and range checkpoints and to update all ranges once, the
+//    size of the database, and the time to scan it as on start.
+//
+// Usage: ./checkpoint_benchmark --bench_checkpoint_files=100000 --check_point_store_enable=true
+//
+// Bytes written are the write syscalls of the whole process, so logs written meanwhile are included.
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <json/json.h>
+#include "app_config/AppConfig.h"
+#include "checkpoint/CheckPointManager.h"
+#include "checkpoint/CheckpointManagerV2.h"
+#include "common/DevInode.h"
+#include "common/FileSystemUtil.h"
+#include "common/Flags.h"
+#include "common/HashUtil.h"
+#include "common/RuntimeUtil.h"
+#include "common/TimeUtil.h"
+#include "config/Config.h"
+#include "config_manager/ConfigManager.h"
+#include "controller/EventDispatcher.h"
+#include "log_pb/checkpoint.pb.h"
+#include "logger/Logger.h"
+
+DEFINE_FLAG_INT32(bench_checkpoint_files, "file checkpoints, each one of a real file", 100000);
+DEFINE_FLAG_INT32(bench_checkpoint_dirs, "directories the files are spread over", 1000);
+DEFINE_FLAG_DOUBLE(bench_checkpoint_update_ratio, "ratio of file checkpoints updated before the second dump", 0.1);
+DEFINE_FLAG_INT32(bench_range_checkpoints, "exactly once range checkpoints", 100000);
+DEFINE_FLAG_INT32(bench_range_concurrency, "range checkpoints of each primary checkpoint", 8);
+
+DECLARE_FLAG_STRING(ilogtail_config);
+DECLARE_FLAG_STRING(user_log_config);
+DECLARE_FLAG_STRING(check_point_filename);
+DECLARE_FLAG_BOOL(check_point_store_enable);
+DECLARE_FLAG_INT32(check_point_max_count);
+DECLARE_FLAG_INT32(max_watch_dir_count);
+DECLARE_FLAG_INT32(default_max_inotify_watch_num);
+
+namespace logtail {
+
+namespace bfs = boost::filesystem;
+
+static uint64_t GetWrittenBytes() {
+    std::ifstream in("/proc/self/io");
+    for (std::string line; std::getline(in, line);) {
+        if (line.compare(0, 6, "wchar:") == 0) {
+            return strtoull(line.c_str() + 6, NULL, 10);
+        }
+    }
+    return 0;
+}
+
+static uint64_t GetDiskBytes(const std::string& path) {
+    boost::system::error_code ec;
+    if (bfs::is_regular_file(path, ec)) {
+        return bfs::file_size(path, ec);
+    }
+    uint64_t bytes = 0;
+    for (bfs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+        if (bfs::is_regular_file(it->path(), ec)) {
+            bytes += bfs::file_size(it->path(), ec);
+        }
+    }
+    return bytes;
+}
+
+// Measure runs @func and prints its time and the bytes written by it.
+template <typename F>
+static uint64_t Measure(const char* name, F&& func) {
+    const uint64_t writtenBytes = GetWrittenBytes();
+    const uint64_t beginUs = GetCurrentTimeInMicroSeconds();
+    func();
+    const uint64_t written = GetWrittenBytes() - writtenBytes;
+    printf("%s: %.1f ms, written %llu KB\n",
+           name,
+           (GetCurrentTimeInMicroSeconds() - beginUs) / 1000.0,
+           static_cast<unsigned long long>(written / 1024));
+    return written;
+}
+
+// CheckpointBenchmark validates checkpoints with the dispatcher, it is a friend of it.
+class CheckpointBenchmark {
+public:
+    static size_t ValidateCheckpoints(std::vector<CheckPointPtr>& checkpoints) {
+        std::vector<EventDispatcherBase::ValidateCheckpointResult> results;
+        std::map<DevInode, SplitedFilePath> cachePathDevInodeMap;
+        std::vector<Event*> eventVec;
+        EventDispatcherBase* dispatcher = EventDispatcher::GetInstance();
+        dispatcher->validateCheckpoints(checkpoints, results, cachePathDevInodeMap, eventVec);
+        for (Event* event : eventVec) {
+            delete event;
+        }
+        size_t valid = 0;
+        for (auto result : results) {
+            valid += result == EventDispatcherBase::ValidateCheckpointResult::kNormal;
+        }
+        return valid;
+    }
+};
+
+static void WriteBenchConfig(const std::string& logDir) {
+    Json::Value config;
+    config["project_name"] = Json::Value("checkpoint_benchmark_proj");
+    config["category"] = Json::Value("checkpoint_benchmark_logstore");
+    config["log_type"] = Json::Value("common_reg_log");
+    config["log_path"] = Json::Value(logDir);
+    config["file_pattern"] = Json::Value("*.log");
+    config["max_depth"] = Json::Value(1);
+    config["enable"] = Json::Value(true);
+    config["preserve"] = Json::Value(true);
+    config["local_storage"] = Json::Value(true);
+    Json::Value regs, keys;
+    regs.append(Json::Value("(.*)"));
+    keys.append(Json::Value("content"));
+    config["regex"] = regs;
+    config["keys"] = keys;
+    Json::Value metrics;
+    metrics["checkpoint_benchmark"] = config;
+    Json::Value root;
+    root["metrics"] = metrics;
+    std::ofstream fout(STRING_FLAG(user_log_config).c_str());
+    fout << root << std::endl;
+}
+
+// CreateFileCheckpoints writes the files and adds a checkpoint at the end of each one. Returns the bytes of
+// checkpoints in FileCheckpointPB, which is their size without format overhead.
+static uint64_t CreateFileCheckpoints(const std::string& logDir, const std::string& configName) {
+    const int32_t dirCount = std::max(INT32_FLAG(bench_checkpoint_dirs), 1);
+    for (int32_t i = 0; i < dirCount; ++i) {
+        bfs::create_directory(logDir + PATH_SEPARATOR + "d" + std::to_string(i));
+    }
+    CheckPointManager* manager = CheckPointManager::Instance();
+    uint64_t bytes = 0;
+    const int32_t now = static_cast<int32_t>(time(NULL));
+    FileCheckpointPB filePB;
+    for (int32_t i = 0; i < INT32_FLAG(bench_checkpoint_files); ++i) {
+        const std::string path = logDir + PATH_SEPARATOR + "d" + std::to_string(i % dirCount) + PATH_SEPARATOR
+            + "bench_" + std::to_string(i) + ".log";
+        const std::string content = "checkpoint benchmark file " + std::to_string(i) + "\n";
+        std::ofstream(path.c_str()) << content;
+        uint64_t sigHash = 0;
+        uint32_t sigSize = 0;
+        CheckAndUpdateSignature(content, sigHash, sigSize);
+        CheckPoint* checkpoint
+            = new CheckPoint(path, content.size(), sigSize, sigHash, GetFileDevInode(path), configName);
+        checkpoint->mLastUpdateTime = now;
+        manager->AddCheckPoint(checkpoint);
+
+        filePB.Clear();
+        filePB.set_file_name(checkpoint->mFileName);
+        filePB.set_offset(checkpoint->mOffset);
+        filePB.set_sig_size(checkpoint->mSignatureSize);
+        filePB.set_sig_hash(checkpoint->mSignatureHash);
+        filePB.set_update_time(checkpoint->mLastUpdateTime);
+        filePB.set_dev(checkpoint->mDevInode.dev);
+        filePB.set_inode(checkpoint->mDevInode.inode);
+        filePB.set_config_name(checkpoint->mConfigName);
+        bytes += filePB.ByteSize();
+    }
+    for (int32_t i = 0; i < dirCount; ++i) {
+        manager->AddDirCheckPoint(logDir + PATH_SEPARATOR + "d" + std::to_string(i));
+    }
+    return bytes;
+}
+
+static void RunV1(const std::string& logDir, const std::string& configName) {
+    CheckPointManager* manager = CheckPointManager::Instance();
+    const uint64_t checkpointBytes = CreateFileCheckpoints(logDir, configName);
+    const auto& checkpointMap = manager->GetAllFileCheckPoint();
+    const std::string path = AppConfig::GetInstance()->GetCheckPointFilePath()
+        + (BOOL_FLAG(check_point_store_enable) ? "_store" : "");
+    printf("v1 %s: files %zu, dirs %d, checkpoint bytes %llu KB\n",
+           BOOL_FLAG(check_point_store_enable) ? "store" : "json",
+           checkpointMap.size(),
+           INT32_FLAG(bench_checkpoint_dirs),
+           static_cast<unsigned long long>(checkpointBytes / 1024));
+
+    Measure("v1 full dump", [&]() { manager->DumpCheckPointToLocal(); });
+    printf("v1 size on disk: %llu KB\n", static_cast<unsigned long long>(GetDiskBytes(path) / 1024));
+
+    // Readers move forward in a part of files between two dumps.
+    const size_t step = static_cast<size_t>(1.0 / std::max(DOUBLE_FLAG(bench_checkpoint_update_ratio), 1e-6));
+    size_t updated = 0, idx = 0;
+    for (auto it = checkpointMap.begin(); it != checkpointMap.end(); ++it, ++idx) {
+        if (idx % std::max<size_t>(step, 1) == 0) {
+            it->second->mOffset += 1;
+            ++it->second->mLastUpdateTime;
+            ++updated;
+        }
+    }
+    const uint64_t written = Measure("v1 incremental dump", [&]() { manager->DumpCheckPointToLocal(); });
+    const uint64_t updatedBytes = checkpointMap.empty() ? 0 : checkpointBytes * updated / checkpointMap.size();
+    printf("v1 incremental dump: %zu updated, write amplification %.1f\n",
+           updated,
+           updatedBytes > 0 ? static_cast<double>(written) / updatedBytes : 0.0);
+
+    manager->RemoveAllCheckPoint();
+    Measure("v1 restore", [&]() { manager->LoadCheckPoint(); });
+    std::vector<CheckPointPtr> checkpoints;
+    checkpoints.reserve(checkpointMap.size());
+    for (auto it = checkpointMap.begin(); it != checkpointMap.end(); ++it) {
+        checkpoints.push_back(it->second);
+    }
+    // Validation looks up handlers of log dirs, they are registered as on start.
+    ConfigManager* configManager = ConfigManager::GetInstance();
+    configManager->RegisterHandlers();
+    while (configManager->HasPendingRegisterDirs()) {
+        configManager->RegisterPendingDirs(1000);
+    }
+    size_t valid = 0;
+    Measure("v1 validate", [&]() { valid = CheckpointBenchmark::ValidateCheckpoints(checkpoints); });
+    printf("v1 validate: %zu of %zu valid\n", valid, checkpoints.size());
+}
+
+static void RunV2(const std::string& configName) {
+    CheckpointManagerV2* manager = CheckpointManagerV2::GetInstance();
+    const uint32_t concurrency = std::max(INT32_FLAG(bench_range_concurrency), 1);
+    const int32_t primaryCount = std::max(INT32_FLAG(bench_range_checkpoints) / static_cast<int32_t>(concurrency), 1);
+    const int32_t now = static_cast<int32_t>(time(NULL));
+    std::vector<std::string> primaryKeys;
+    for (int32_t i = 0; i < primaryCount; ++i) {
+        primaryKeys.push_back("checkpoint_benchmark_primary_" + std::to_string(i));
+    }
+    printf("v2: primary %d, range %d\n", primaryCount, primaryCount * static_cast<int32_t>(concurrency));
+
+    RangeCheckpointPB rangePB;
+    rangePB.set_hash_key("checkpoint_benchmark_hash_key");
+    rangePB.set_read_length(512 * 1024);
+    rangePB.set_committed(false);
+    rangePB.set_update_time(now);
+    Measure("v2 put", [&]() {
+        PrimaryCheckpointPB primaryPB;
+        for (int32_t i = 0; i < primaryCount; ++i) {
+            primaryPB.set_concurrency(concurrency);
+            primaryPB.set_sig_size(1024);
+            primaryPB.set_sig_hash(static_cast<uint64_t>(i));
+            primaryPB.set_config_name(configName);
+            primaryPB.set_log_path("/checkpoint/benchmark/bench_" + std::to_string(i) + ".log");
+            primaryPB.set_dev(1);
+            primaryPB.set_inode(static_cast<uint64_t>(i));
+            primaryPB.set_update_time(now);
+            manager->SetPB(primaryKeys[i], primaryPB);
+            for (uint32_t idx = 0; idx < concurrency; ++idx) {
+                rangePB.set_sequence_id(idx);
+                rangePB.set_read_offset(static_cast<uint64_t>(idx) * rangePB.read_length());
+                manager->SetPB(CheckpointManagerV2::MakeRangeKey(primaryKeys[i], idx), rangePB);
+            }
+        }
+        manager->Flush();
+    });
+    // Each range is committed once, as sender does when a request is acknowledged.
+    Measure("v2 update ranges", [&]() {
+        rangePB.set_committed(true);
+        for (int32_t i = 0; i < primaryCount; ++i) {
+            for (uint32_t idx = 0; idx < concurrency; ++idx) {
+                rangePB.set_sequence_id(concurrency + idx);
+                manager->SetPB(CheckpointManagerV2::MakeRangeKey(primaryKeys[i], idx), rangePB);
+            }
+        }
+        manager->Flush();
+    });
+    printf("v2 size on disk: %llu KB\n",
+           static_cast<unsigned long long>(
+               GetDiskBytes(AppConfig::GetInstance()->GetLogtailSysConfDir() + "checkpoint_v2") / 1024));
+
+    Config config;
+    config.mConfigName = configName;
+    size_t scanned = 0;
+    Measure("v2 scan", [&]() { scanned = manager->ScanCheckpoints(std::vector<Config*>{&config}).size(); });
+    printf("v2 scan: %zu primary checkpoints\n", scanned);
+}
+
+static int RunBenchmark() {
+    std::string rootDir = GetProcessExecutionDir() + "CheckpointBenchmark";
+    bfs::remove_all(rootDir);
+    const std::string logDir = rootDir + PATH_SEPARATOR + "logs";
+    const std::string sysConfDir = rootDir + PATH_SEPARATOR + ".ilogtail" + PATH_SEPARATOR;
+    bfs::create_directories(logDir);
+    bfs::create_directories(sysConfDir);
+
+    STRING_FLAG(check_point_filename) = sysConfDir + "logtail_check_point";
+    AppConfig::GetInstance()->SetLogtailSysConfDir(sysConfDir);
+    AppConfig::GetInstance()->LoadAppConfig(STRING_FLAG(ilogtail_config));
+    INT32_FLAG(check_point_max_count) = std::max(INT32_FLAG(check_point_max_count), INT32_FLAG(bench_checkpoint_files));
+    const int32_t maxDirs = INT32_FLAG(bench_checkpoint_dirs) + 1024;
+    INT32_FLAG(max_watch_dir_count) = std::max(INT32_FLAG(max_watch_dir_count), maxDirs);
+    INT32_FLAG(default_max_inotify_watch_num) = std::max(INT32_FLAG(default_max_inotify_watch_num), maxDirs);
+    WriteBenchConfig(logDir);
+    ConfigManager* configManager = ConfigManager::GetInstance();
+    if (!configManager->LoadConfig(STRING_FLAG(user_log_config)) || configManager->GetAllConfig().empty()) {
+        fprintf(stderr, "load config %s failed\n", STRING_FLAG(user_log_config).c_str());
+        return 1;
+    }
+    const std::string configName = configManager->GetAllConfig().begin()->first;
+
+    RunV1(logDir, configName);
+    RunV2(configName);
+    fflush(stdout);
+    bfs::remove_all(rootDir);
+    // Threads of checkpoint managers are never joined, skip the static destructors.
+    _exit(0);
+}
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    logtail::Logger::Instance().InitGlobalLoggers();
+    return logtail::RunBenchmark();
+}
@@ -0,0 +1,332 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// discovery_benchmark builds a synthetic directory tree, registers bench_config_count configs on it and
+// measures how long the dispatcher takes to discover all directories (inotify) or all files (polling), the
+// watch count and memory after discovery, and the CPU cost of the steady state while files are created and
+// deleted at bench_churn_files_per_sec.
+//
+// Usage: ./discovery_benchmark --bench_discovery_mode=polling --bench_tree_depth=4 --bench_tree_fanout=20
+//
+// Limits on watched directories and polling stats are raised to fit the tree, so the cost of the algorithms
+// is measured rather than the limits. Files are empty, readers never send, so no sender is involved.
+
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <json/json.h>
+#include "app_config/AppConfig.h"
+#include "common/FileSystemUtil.h"
+#include "common/Flags.h"
+#include "common/Lock.h"
+#include "common/RuntimeUtil.h"
+#include "common/TimeUtil.h"
+#include "config_manager/ConfigManager.h"
+#include "controller/EventDispatcher.h"
+#include "logger/Logger.h"
+#include "polling/PollingDirFile.h"
+
+DEFINE_FLAG_STRING(bench_discovery_mode, "inotify or polling", "inotify");
+DEFINE_FLAG_INT32(bench_tree_depth, "levels of directories under the root", 3);
+DEFINE_FLAG_INT32(bench_tree_fanout, "sub directories of each directory", 10);
+DEFINE_FLAG_INT32(bench_files_per_dir, "files in each directory including the root", 10);
+DEFINE_FLAG_INT32(bench_config_count, "configs registered on the tree, each one matches all files", 1);
+DEFINE_FLAG_INT32(bench_churn_files_per_sec, "files created and deleted per second in steady state", 100);
+DEFINE_FLAG_INT32(bench_discovery_timeout_sec, "give up waiting for discovery after it", 600);
+DEFINE_FLAG_INT32(bench_duration_sec, "seconds of steady state to measure", 30);
+
+DECLARE_FLAG_STRING(ilogtail_config);
+DECLARE_FLAG_STRING(user_log_config);
+DECLARE_FLAG_BOOL(enable_polling_discovery);
+DECLARE_FLAG_INT32(max_watch_dir_count);
+DECLARE_FLAG_INT32(default_max_inotify_watch_num);
+DECLARE_FLAG_INT32(polling_max_stat_count);
+DECLARE_FLAG_INT32(polling_max_stat_count_per_dir);
+DECLARE_FLAG_INT32(polling_max_stat_count_per_config);
+DECLARE_FLAG_INT32(polling_dir_upperlimit);
+DECLARE_FLAG_INT32(polling_file_upperlimit);
+
+namespace logtail {
+
+namespace bfs = boost::filesystem;
+
+static uint64_t GetThreadCpuTimeUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t GetProcessCpuTimeUs() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec
+        + usage.ru_stime.tv_usec;
+}
+
+static uint64_t GetRssKb() {
+    std::ifstream in("/proc/self/status");
+    for (std::string line; std::getline(in, line);) {
+        if (line.compare(0, 6, "VmRSS:") == 0) {
+            return strtoull(line.c_str() + 6, NULL, 10);
+        }
+    }
+    return 0;
+}
+
+// DiscoveryBenchmark reads the caches of the dispatcher and polling, it is their friend.
+class DiscoveryBenchmark {
+public:
+    static size_t GetHandlerCount() { return EventDispatcher::GetInstance()->GetHandlerCount(); }
+
+    static int32_t GetInotifyWatcherCount() { return EventDispatcher::GetInstance()->GetInotifyWatcherCount(); }
+
+    static void GetPollingCacheSize(size_t& dirCount, size_t& fileCount) {
+        PollingDirFile* polling = PollingDirFile::GetInstance();
+        ScopedSpinLock lock(polling->mCacheLock);
+        dirCount = polling->mDirCacheMap.size();
+        fileCount = polling->mFileCacheMap.size();
+    }
+};
+
+// TreeBuilder creates the synthetic tree, and replaces files in random directories in steady state.
+class TreeBuilder {
+public:
+    explicit TreeBuilder(const std::string& root) : mRoot(root) {}
+
+    void Build() {
+        mDirs.push_back(mRoot);
+        for (size_t begin = 0, level = 0; level < static_cast<size_t>(INT32_FLAG(bench_tree_depth)); ++level) {
+            const size_t end = mDirs.size();
+            for (size_t i = begin; i < end; ++i) {
+                for (int32_t k = 0; k < INT32_FLAG(bench_tree_fanout); ++k) {
+                    std::string dir = mDirs[i] + PATH_SEPARATOR + "d" + std::to_string(k);
+                    bfs::create_directory(dir);
+                    mDirs.push_back(dir);
+                }
+            }
+            begin = end;
+        }
+        for (const auto& dir : mDirs) {
+            for (int32_t k = 0; k < INT32_FLAG(bench_files_per_dir); ++k) {
+                Touch(dir + PATH_SEPARATOR + "bench_" + std::to_string(k) + ".log");
+            }
+        }
+    }
+
+    void StartChurn() { mThread = std::thread([this]() { Churn(); }); }
+
+    void StopChurn() {
+        mStopped = true;
+        if (mThread.joinable()) {
+            mThread.join();
+        }
+    }
+
+    size_t GetDirCount() const { return mDirs.size(); }
+    size_t GetFileCount() const { return mDirs.size() * INT32_FLAG(bench_files_per_dir); }
+    uint64_t GetChurnedFiles() const { return mChurnedFiles; }
+    uint64_t GetChurnCpuUs() const { return mChurnCpuUs; }
+
+private:
+    static void Touch(const std::string& path) {
+        FILE* file = fopen(path.c_str(), "w");
+        if (file != NULL) {
+            fclose(file);
+        }
+    }
+
+    // Churn creates files every 100ms, each one lives about one second.
+    void Churn() {
+        const uint64_t threadCpuBegin = GetThreadCpuTimeUs();
+        std::mt19937 random(1024);
+        std::deque<std::string> files;
+        const size_t filesPerRound = std::max(INT32_FLAG(bench_churn_files_per_sec) / 10, 1);
+        for (uint64_t seq = 0; !mStopped;) {
+            for (size_t i = 0; i < filesPerRound; ++i, ++seq) {
+                files.push_back(mDirs[random() % mDirs.size()] + PATH_SEPARATOR + "churn_" + std::to_string(seq)
+                                + ".log");
+                Touch(files.back());
+            }
+            while (files.size() > filesPerRound * 10) {
+                remove(files.front().c_str());
+                files.pop_front();
+            }
+            mChurnedFiles = seq;
+            mChurnCpuUs = GetThreadCpuTimeUs() - threadCpuBegin;
+            usleep(100 * 1000);
+        }
+        for (const auto& file : files) {
+            remove(file.c_str());
+        }
+    }
+
+    const std::string mRoot;
+    std::vector<std::string> mDirs;
+    std::atomic_bool mStopped{false};
+    std::atomic<uint64_t> mChurnedFiles{0};
+    std::atomic<uint64_t> mChurnCpuUs{0};
+    std::thread mThread;
+};
+
+static void WriteBenchConfigs(const std::string& logDir) {
+    Json::Value metrics;
+    for (int32_t i = 0; i < INT32_FLAG(bench_config_count); ++i) {
+        Json::Value config;
+        config["project_name"] = Json::Value("discovery_benchmark_proj");
+        config["category"] = Json::Value("discovery_benchmark_logstore_" + std::to_string(i));
+        config["log_type"] = Json::Value("common_reg_log");
+        config["log_path"] = Json::Value(logDir);
+        config["file_pattern"] = Json::Value("*.log");
+        config["max_depth"] = Json::Value(INT32_FLAG(bench_tree_depth));
+        config["enable"] = Json::Value(true);
+        config["preserve"] = Json::Value(true);
+        config["local_storage"] = Json::Value(true);
+        Json::Value regs, keys;
+        regs.append(Json::Value("(.*)"));
+        keys.append(Json::Value("content"));
+        config["regex"] = regs;
+        config["keys"] = keys;
+        metrics["discovery_benchmark_" + std::to_string(i)] = config;
+    }
+    Json::Value root;
+    root["metrics"] = metrics;
+    std::ofstream fout(STRING_FLAG(user_log_config).c_str());
+    fout << root << std::endl;
+}
+
+// IsDiscovered returns true when all directories have handlers, and all files are cached by polling in
+// polling mode.
+static bool IsDiscovered(const TreeBuilder& tree, bool polling) {
+    if (DiscoveryBenchmark::GetHandlerCount() < tree.GetDirCount()) {
+        return false;
+    }
+    if (!polling) {
+        return true;
+    }
+    size_t dirCount = 0, fileCount = 0;
+    DiscoveryBenchmark::GetPollingCacheSize(dirCount, fileCount);
+    return fileCount >= tree.GetFileCount();
+}
+
+static void PrintCounts(const char* stage) {
+    size_t dirCount = 0, fileCount = 0;
+    DiscoveryBenchmark::GetPollingCacheSize(dirCount, fileCount);
+    printf("%s: handlers %zu, inotify watchers %d, polled dirs %zu, polled files %zu, rss %llu KB\n",
+           stage,
+           DiscoveryBenchmark::GetHandlerCount(),
+           DiscoveryBenchmark::GetInotifyWatcherCount(),
+           dirCount,
+           fileCount,
+           static_cast<unsigned long long>(GetRssKb()));
+}
+
+static int RunBenchmark() {
+    const bool polling = STRING_FLAG(bench_discovery_mode) == "polling";
+    if (!polling && STRING_FLAG(bench_discovery_mode) != "inotify") {
+        fprintf(stderr, "unknown discovery mode %s\n", STRING_FLAG(bench_discovery_mode).c_str());
+        return 1;
+    }
+    std::string rootDir = GetProcessExecutionDir() + "DiscoveryBenchmark";
+    bfs::remove_all(rootDir);
+    const std::string logDir = rootDir + PATH_SEPARATOR + "logs";
+    const std::string sysConfDir = rootDir + PATH_SEPARATOR + ".ilogtail" + PATH_SEPARATOR;
+    bfs::create_directories(logDir);
+    bfs::create_directories(sysConfDir);
+
+    TreeBuilder tree(logDir);
+    uint64_t beginMs = GetCurrentTimeInMilliSeconds();
+    tree.Build();
+    printf("mode: %s, depth: %d, fanout: %d, dirs: %zu, files: %zu, configs: %d, churn: %d files/s\n",
+           STRING_FLAG(bench_discovery_mode).c_str(),
+           INT32_FLAG(bench_tree_depth),
+           INT32_FLAG(bench_tree_fanout),
+           tree.GetDirCount(),
+           tree.GetFileCount(),
+           INT32_FLAG(bench_config_count),
+           INT32_FLAG(bench_churn_files_per_sec));
+    printf("build tree: %llu ms\n", static_cast<unsigned long long>(GetCurrentTimeInMilliSeconds() - beginMs));
+
+    AppConfig::GetInstance()->SetLogtailSysConfDir(sysConfDir);
+    AppConfig::GetInstance()->LoadAppConfig(STRING_FLAG(ilogtail_config));
+    // Set after app config is loaded, which rescales some of them.
+    const int32_t maxDirs = static_cast<int32_t>(tree.GetDirCount()) + 1024;
+    const int32_t maxStats = static_cast<int32_t>(tree.GetDirCount() + tree.GetFileCount()) * 2 + 1024;
+    INT32_FLAG(max_watch_dir_count) = std::max(INT32_FLAG(max_watch_dir_count), maxDirs);
+    INT32_FLAG(default_max_inotify_watch_num) = polling ? 0 : maxDirs;
+    INT32_FLAG(polling_max_stat_count) = std::max(INT32_FLAG(polling_max_stat_count), maxStats);
+    INT32_FLAG(polling_max_stat_count_per_dir) = std::max(INT32_FLAG(polling_max_stat_count_per_dir), maxStats);
+    INT32_FLAG(polling_max_stat_count_per_config) = std::max(INT32_FLAG(polling_max_stat_count_per_config), maxStats);
+    INT32_FLAG(polling_dir_upperlimit) = std::max(INT32_FLAG(polling_dir_upperlimit), maxStats);
+    INT32_FLAG(polling_file_upperlimit) = std::max(INT32_FLAG(polling_file_upperlimit), maxStats);
+    BOOL_FLAG(enable_polling_discovery) = polling;
+    WriteBenchConfigs(logDir);
+    if (!ConfigManager::GetInstance()->LoadConfig(STRING_FLAG(user_log_config))) {
+        fprintf(stderr, "load config %s failed\n", STRING_FLAG(user_log_config).c_str());
+        return 1;
+    }
+    const uint64_t rssBeginKb = GetRssKb();
+
+    beginMs = GetCurrentTimeInMilliSeconds();
+    std::thread dispatcher([]() {
+        ConfigManager::GetInstance()->RegisterHandlers();
+        EventDispatcher::GetInstance()->Dispatch();
+    });
+    dispatcher.detach();
+    const uint64_t timeoutMs = beginMs + static_cast<uint64_t>(INT32_FLAG(bench_discovery_timeout_sec)) * 1000;
+    bool discovered = false;
+    while (!(discovered = IsDiscovered(tree, polling)) && GetCurrentTimeInMilliSeconds() < timeoutMs) {
+        usleep(10 * 1000);
+    }
+    printf("discovery: %llu ms%s\n",
+           static_cast<unsigned long long>(GetCurrentTimeInMilliSeconds() - beginMs),
+           discovered ? "" : " (timeout)");
+    PrintCounts("after discovery");
+    printf("rss of discovery: %lld KB\n", static_cast<long long>(GetRssKb()) - static_cast<long long>(rssBeginKb));
+
+    tree.StartChurn();
+    const uint64_t beginCpuUs = GetProcessCpuTimeUs() - tree.GetChurnCpuUs();
+    beginMs = GetCurrentTimeInMilliSeconds();
+    sleep(INT32_FLAG(bench_duration_sec));
+    const uint64_t endCpuUs = GetProcessCpuTimeUs() - tree.GetChurnCpuUs();
+    const uint64_t elapsedMs = std::max<uint64_t>(GetCurrentTimeInMilliSeconds() - beginMs, 1);
+    tree.StopChurn();
+    printf("steady state: cpu %.1f%% of one core, %llu files churned in %llu ms\n",
+           (endCpuUs > beginCpuUs ? endCpuUs - beginCpuUs : 0) / 10.0 / elapsedMs,
+           static_cast<unsigned long long>(tree.GetChurnedFiles()),
+           static_cast<unsigned long long>(elapsedMs));
+    PrintCounts("after steady state");
+    fflush(stdout);
+    bfs::remove_all(rootDir);
+    // Threads of the dispatcher are never joined, skip the static destructors.
+    _exit(0);
+}
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    logtail::Logger::Instance().InitGlobalLoggers();
+    return logtail::RunBenchmark();
+}
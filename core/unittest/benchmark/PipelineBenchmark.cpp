@@ -0,0 +1,462 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// pipeline_benchmark drives the real file pipeline (inotify/polling -> reader -> processor -> aggregator
+// -> sender) against a mocked SLS sink, and reports the sustained throughput, CPU cost and end-to-end
+// latency of it. Files are generated in process at a fixed rate, the sink replies after a configurable
+// latency and fails a configurable ratio of requests with a retryable error.
+//
+// Usage: ./pipeline_benchmark --bench_log_format=regex --bench_write_rate_mb=50 --bench_send_latency_ms=20
+//
+// Each line written carries its write time, the sink decodes every Nth request and records the
+// difference to its ack time, so the latency covers file discovery, read, parse, merge, queueing and send.
+
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <json/json.h>
+#include "app_config/AppConfig.h"
+#include "common/FileSystemUtil.h"
+#include "common/Flags.h"
+#include "common/Histogram.h"
+#include "common/RuntimeUtil.h"
+#include "common/TimeUtil.h"
+#include "config_manager/ConfigManager.h"
+#include "controller/EventDispatcher.h"
+#include "log_pb/sls_logs.pb.h"
+#include "logger/Logger.h"
+#include "sdk/Common.h"
+#include "sender/Sender.h"
+
+DEFINE_FLAG_INT32(bench_duration_sec, "seconds to measure after warm up", 30);
+DEFINE_FLAG_INT32(bench_warmup_sec, "seconds to run before measuring", 5);
+DEFINE_FLAG_INT32(bench_file_count, "number of files written in parallel", 4);
+DEFINE_FLAG_INT32(bench_write_rate_mb, "total write rate of all files in MB/s, 0 means as fast as possible", 20);
+DEFINE_FLAG_INT32(bench_line_size, "bytes of each line including the line feed", 256);
+DEFINE_FLAG_STRING(bench_log_format, "simple, regex, delimiter or json", "regex");
+DEFINE_FLAG_INT32(bench_send_latency_ms, "latency of the mock sink for each request", 10);
+DEFINE_FLAG_DOUBLE(bench_send_error_ratio, "ratio of requests failed by the mock sink with ServerBusy", 0.0);
+DEFINE_FLAG_INT32(bench_mock_send_threads, "threads replying requests in the mock sink", 4);
+DEFINE_FLAG_INT32(bench_latency_sample_interval, "decode one of every N requests to sample latency", 8);
+
+DECLARE_FLAG_BOOL(enable_mock_send);
+DECLARE_FLAG_STRING(ilogtail_config);
+DECLARE_FLAG_STRING(user_log_config);
+DECLARE_FLAG_STRING(profile_project_name);
+DECLARE_FLAG_STRING(default_region_name);
+DECLARE_FLAG_STRING(logtail_send_address);
+
+namespace logtail {
+
+namespace bfs = boost::filesystem;
+
+static const char* kBenchProject = "pipeline_benchmark_proj";
+static const char* kBenchLogstore = "pipeline_benchmark_logstore";
+
+static uint64_t GetThreadCpuTimeUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+static uint64_t GetProcessCpuTimeUs() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<uint64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec
+        + usage.ru_stime.tv_usec;
+}
+
+// Counters shared by the generator, the sink and the reporter.
+struct BenchStats {
+    std::atomic<uint64_t> mWrittenLines{0};
+    std::atomic<uint64_t> mAckedLines{0};
+    std::atomic<uint64_t> mAckedRequests{0};
+    std::atomic<uint64_t> mFailedRequests{0};
+    // CPU spent by the harness itself, excluded from the cost of the pipeline.
+    std::atomic<uint64_t> mGeneratorCpuUs{0};
+    std::atomic<uint64_t> mSinkCpuUs{0};
+
+    uint64_t GetHarnessCpuUs() const { return mGeneratorCpuUs + mSinkCpuUs; }
+
+    std::mutex mLatencyMux;
+    Histogram mLatencyMs;
+};
+
+static BenchStats sStats;
+
+// FileGenerator appends fixed size lines to bench_file_count files, paced to bench_write_rate_mb.
+class FileGenerator {
+public:
+    explicit FileGenerator(const std::string& dir) : mDir(dir) {}
+
+    void Start() { mThread = std::thread([this]() { Run(); }); }
+
+    void Stop() {
+        mStopped = true;
+        if (mThread.joinable()) {
+            mThread.join();
+        }
+    }
+
+    std::string FormatLine(uint64_t timeMs, uint64_t seq) const {
+        const std::string& format = STRING_FLAG(bench_log_format);
+        std::string ts = std::to_string(timeMs);
+        std::string seqStr = std::to_string(seq);
+        std::string prefix, suffix;
+        if (format == "json") {
+            prefix = "{\"ts\":\"" + ts + "\",\"seq\":\"" + seqStr + "\",\"msg\":\"";
+            suffix = "\"}\n";
+        } else if (format == "delimiter") {
+            prefix = ts + "|" + seqStr + "|";
+            suffix = "\n";
+        } else {
+            prefix = ts + " " + seqStr + " ";
+            suffix = "\n";
+        }
+        size_t lineSize = static_cast<size_t>(INT32_FLAG(bench_line_size));
+        size_t payloadSize = lineSize > prefix.size() + suffix.size() ? lineSize - prefix.size() - suffix.size() : 1;
+        std::string line;
+        line.reserve(prefix.size() + payloadSize + suffix.size());
+        line.append(prefix);
+        for (size_t i = 0; i < payloadSize; ++i) {
+            line.push_back(static_cast<char>('a' + (seq + i) % 26));
+        }
+        line.append(suffix);
+        return line;
+    }
+
+private:
+    void Run() {
+        const uint64_t threadCpuBegin = GetThreadCpuTimeUs();
+        std::vector<FILE*> files;
+        for (int32_t i = 0; i < INT32_FLAG(bench_file_count); ++i) {
+            std::string path = mDir + PATH_SEPARATOR + "bench_" + std::to_string(i) + ".log";
+            FILE* file = FileAppendOpen(path.c_str(), "ab");
+            if (file == NULL) {
+                fprintf(stderr, "open %s failed\n", path.c_str());
+                exit(1);
+            }
+            files.push_back(file);
+        }
+
+        const uint64_t rateBytesPerMs = static_cast<uint64_t>(INT32_FLAG(bench_write_rate_mb)) * 1024 * 1024 / 1000;
+        const uint64_t beginMs = GetCurrentTimeInMilliSeconds();
+        uint64_t writtenBytes = 0;
+        uint64_t seq = 0;
+        std::string batch;
+        while (!mStopped) {
+            uint64_t nowMs = GetCurrentTimeInMilliSeconds();
+            if (rateBytesPerMs > 0 && writtenBytes >= rateBytesPerMs * (nowMs - beginMs + 1)) {
+                usleep(1000);
+                continue;
+            }
+            // Write about 64KB to each file per round, lines of the same round share the write time.
+            for (FILE* file : files) {
+                batch.clear();
+                while (batch.size() < 64 * 1024) {
+                    batch.append(FormatLine(nowMs, seq++));
+                }
+                fwrite(batch.data(), 1, batch.size(), file);
+                fflush(file);
+                writtenBytes += batch.size();
+            }
+            sStats.mWrittenLines = seq;
+            sStats.mGeneratorCpuUs = GetThreadCpuTimeUs() - threadCpuBegin;
+        }
+        for (FILE* file : files) {
+            fclose(file);
+        }
+    }
+
+    const std::string mDir;
+    std::atomic_bool mStopped{false};
+    std::thread mThread;
+};
+
+// MockSink replaces the SLS client, requests are replied by worker threads after bench_send_latency_ms.
+class MockSink {
+public:
+    static MockSink* GetInstance() {
+        static MockSink* ptr = new MockSink();
+        return ptr;
+    }
+
+    void Start() {
+        for (int32_t i = 0; i < INT32_FLAG(bench_mock_send_threads); ++i) {
+            std::thread([this]() { Run(); }).detach();
+        }
+    }
+
+    static void AsyncSend(const std::string& projectName,
+                          const std::string& logstore,
+                          sls_logs::SlsCompressType compressType,
+                          const std::string& logData,
+                          SEND_DATA_TYPE dataType,
+                          int32_t rawSize,
+                          SendClosure* sendClosure) {
+        MockSink* sink = GetInstance();
+        Request request;
+        request.mDueTimeMs = GetCurrentTimeInMilliSeconds() + INT32_FLAG(bench_send_latency_ms);
+        request.mClosure = sendClosure;
+        request.mIsBench = projectName == kBenchProject;
+        // Only lz4 data can be decoded by Sender::ParseLogGroupFromString.
+        if (request.mIsBench && compressType == sls_logs::SLS_CMP_LZ4
+            && sink->mRequestCount++ % INT32_FLAG(bench_latency_sample_interval) == 0) {
+            request.mLogData = logData;
+            request.mDataType = dataType;
+            request.mRawSize = rawSize;
+            request.mSampled = true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sink->mMux);
+            sink->mRequests.push_back(std::move(request));
+        }
+        sink->mCond.notify_one();
+    }
+
+private:
+    struct Request {
+        uint64_t mDueTimeMs = 0;
+        SendClosure* mClosure = NULL;
+        bool mIsBench = false;
+        bool mSampled = false;
+        std::string mLogData;
+        SEND_DATA_TYPE mDataType = LOGGROUP_COMPRESSED;
+        int32_t mRawSize = 0;
+    };
+
+    MockSink() = default;
+
+    void Run() {
+        std::mt19937 random(static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())));
+        std::uniform_real_distribution<double> dist(0.0, 1.0);
+        while (true) {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(mMux);
+                mCond.wait(lock, [this]() { return !mRequests.empty(); });
+                // The latency is the same for all requests, so the front is always the first to be due.
+                uint64_t nowMs = GetCurrentTimeInMilliSeconds();
+                if (mRequests.front().mDueTimeMs > nowMs) {
+                    mCond.wait_for(lock, std::chrono::milliseconds(mRequests.front().mDueTimeMs - nowMs));
+                    continue;
+                }
+                request = std::move(mRequests.front());
+                mRequests.pop_front();
+            }
+            const uint64_t threadCpuBegin = GetThreadCpuTimeUs();
+            Reply(request, dist(random) < DOUBLE_FLAG(bench_send_error_ratio));
+            sStats.mSinkCpuUs += GetThreadCpuTimeUs() - threadCpuBegin;
+        }
+    }
+
+    void Reply(Request& request, bool injectError) {
+        sdk::PostLogStoreLogsResponse* sr = new sdk::PostLogStoreLogsResponse;
+        sr->requestId = "mock_request_id";
+        if (request.mIsBench && injectError) {
+            sr->statusCode = 500;
+            ++sStats.mFailedRequests;
+            request.mClosure->OnFail(sr, sdk::LOGE_SERVER_BUSY, "injected by pipeline benchmark");
+            return;
+        }
+        if (request.mIsBench) {
+            sStats.mAckedLines += request.mClosure->mDataPtr->mLogLines;
+            ++sStats.mAckedRequests;
+            if (request.mSampled) {
+                RecordLatency(request);
+            }
+        }
+        sr->statusCode = 200;
+        request.mClosure->OnSuccess(sr);
+    }
+
+    static void RecordLatency(const Request& request) {
+        std::vector<sls_logs::LogGroup> logGroups;
+        Sender::ParseLogGroupFromString(request.mLogData, request.mDataType, request.mRawSize, logGroups);
+        const uint64_t nowMs = GetCurrentTimeInMilliSeconds();
+        std::lock_guard<std::mutex> lock(sStats.mLatencyMux);
+        for (const auto& logGroup : logGroups) {
+            for (int i = 0; i < logGroup.logs_size(); ++i) {
+                const sls_logs::Log& log = logGroup.logs(i);
+                for (int j = 0; j < log.contents_size(); ++j) {
+                    // Simple mode puts the whole line into "content", the write time is still its prefix.
+                    const std::string& key = log.contents(j).key();
+                    if (key == "ts" || key == "content") {
+                        uint64_t writeMs = strtoull(log.contents(j).value().c_str(), NULL, 10);
+                        sStats.mLatencyMs.Record(nowMs > writeMs ? nowMs - writeMs : 0);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    std::mutex mMux;
+    std::condition_variable mCond;
+    std::deque<Request> mRequests;
+    std::atomic<uint64_t> mRequestCount{0};
+};
+
+static void WriteBenchConfig(const std::string& logDir) {
+    const std::string& format = STRING_FLAG(bench_log_format);
+    Json::Value config;
+    config["project_name"] = Json::Value(kBenchProject);
+    config["category"] = Json::Value(kBenchLogstore);
+    config["log_path"] = Json::Value(logDir);
+    config["file_pattern"] = Json::Value("*.log");
+    config["enable"] = Json::Value(true);
+    config["max_send_rate"] = Json::Value(-1);
+    config["send_rate_expire"] = Json::Value(0);
+    config["preserve"] = Json::Value(true);
+    config["local_storage"] = Json::Value(true);
+    Json::Value regs, keys;
+    if (format == "json") {
+        config["log_type"] = Json::Value("json_log");
+    } else if (format == "delimiter") {
+        config["log_type"] = Json::Value("delimiter_log");
+        config["delimiter_separator"] = Json::Value("|");
+        Json::Value columnKeys;
+        columnKeys.append(Json::Value("ts"));
+        columnKeys.append(Json::Value("seq"));
+        columnKeys.append(Json::Value("msg"));
+        config["column_keys"] = columnKeys;
+    } else if (format == "simple") {
+        config["log_type"] = Json::Value("common_reg_log");
+        regs.append(Json::Value("(.*)"));
+        keys.append(Json::Value("content"));
+    } else {
+        config["log_type"] = Json::Value("common_reg_log");
+        regs.append(Json::Value("(\\d+) (\\d+) (.*)"));
+        keys.append(Json::Value("ts,seq,msg"));
+    }
+    if (!regs.empty()) {
+        config["regex"] = regs;
+        config["keys"] = keys;
+    }
+
+    Json::Value metrics;
+    metrics["pipeline_benchmark"] = config;
+    Json::Value root;
+    root["metrics"] = metrics;
+    std::ofstream fout(STRING_FLAG(user_log_config).c_str());
+    fout << root << std::endl;
+}
+
+static void PrintReport(uint64_t lines, uint64_t cpuUs, uint64_t elapsedMs) {
+    const double seconds = elapsedMs / 1000.0;
+    const double bytes = static_cast<double>(lines) * INT32_FLAG(bench_line_size);
+    const double gigabytes = bytes / (1024.0 * 1024 * 1024);
+    Histogram latency;
+    {
+        std::lock_guard<std::mutex> lock(sStats.mLatencyMux);
+        latency = sStats.mLatencyMs;
+    }
+    printf("format: %s, files: %d, line size: %d, write rate: %d MB/s, sink latency: %d ms, error ratio: %.3f\n",
+           STRING_FLAG(bench_log_format).c_str(),
+           INT32_FLAG(bench_file_count),
+           INT32_FLAG(bench_line_size),
+           INT32_FLAG(bench_write_rate_mb),
+           INT32_FLAG(bench_send_latency_ms),
+           DOUBLE_FLAG(bench_send_error_ratio));
+    printf("throughput: %.2f MB/s, %.0f lines/s\n", bytes / (1024 * 1024) / seconds, lines / seconds);
+    printf("cpu: %.1f%% of one core, %.2f cpu seconds per GB\n",
+           cpuUs / 10000.0 / seconds,
+           gigabytes > 0 ? cpuUs / 1000000.0 / gigabytes : 0.0);
+    printf("latency ms: p50 %llu, p99 %llu, max %llu (%llu samples)\n",
+           static_cast<unsigned long long>(latency.GetPercentile(50)),
+           static_cast<unsigned long long>(latency.GetPercentile(99)),
+           static_cast<unsigned long long>(latency.GetMax()),
+           static_cast<unsigned long long>(latency.GetCount()));
+    printf("requests: %llu acked, %llu failed, lines written: %llu\n",
+           static_cast<unsigned long long>(sStats.mAckedRequests.load()),
+           static_cast<unsigned long long>(sStats.mFailedRequests.load()),
+           static_cast<unsigned long long>(sStats.mWrittenLines.load()));
+}
+
+static int RunBenchmark() {
+    std::string rootDir = GetProcessExecutionDir() + "PipelineBenchmark";
+    bfs::remove_all(rootDir);
+    const std::string logDir = rootDir + PATH_SEPARATOR + "logs";
+    const std::string sysConfDir = rootDir + PATH_SEPARATOR + ".ilogtail" + PATH_SEPARATOR;
+    bfs::create_directories(logDir);
+    bfs::create_directories(sysConfDir);
+
+    STRING_FLAG(profile_project_name) = "sls-admin";
+    BOOL_FLAG(enable_mock_send) = true;
+    Sender::Instance()->AddEndpointEntry(STRING_FLAG(default_region_name), STRING_FLAG(logtail_send_address), true);
+    AppConfig::GetInstance()->SetLogtailSysConfDir(sysConfDir);
+    AppConfig::GetInstance()->LoadAppConfig(STRING_FLAG(ilogtail_config));
+    WriteBenchConfig(logDir);
+    if (!ConfigManager::GetInstance()->LoadConfig(STRING_FLAG(user_log_config))) {
+        fprintf(stderr, "load config %s failed\n", STRING_FLAG(user_log_config).c_str());
+        return 1;
+    }
+    if (!Sender::Instance()->InitSender()) {
+        fprintf(stderr, "init sender failed\n");
+        return 1;
+    }
+    Sender::Instance()->MockIntegritySend = NULL;
+    Sender::Instance()->MockAsyncSend = MockSink::AsyncSend;
+    MockSink::GetInstance()->Start();
+
+    std::thread dispatcher([]() {
+        ConfigManager::GetInstance()->RegisterHandlers();
+        EventDispatcher::GetInstance()->Dispatch();
+    });
+    dispatcher.detach();
+    sleep(1);
+
+    FileGenerator generator(logDir);
+    generator.Start();
+    sleep(INT32_FLAG(bench_warmup_sec));
+
+    const uint64_t beginLines = sStats.mAckedLines;
+    const uint64_t beginCpuUs = GetProcessCpuTimeUs() - sStats.GetHarnessCpuUs();
+    const uint64_t beginMs = GetCurrentTimeInMilliSeconds();
+    {
+        std::lock_guard<std::mutex> lock(sStats.mLatencyMux);
+        sStats.mLatencyMs.Reset();
+    }
+    sleep(INT32_FLAG(bench_duration_sec));
+    const uint64_t endCpuUs = GetProcessCpuTimeUs() - sStats.GetHarnessCpuUs();
+    const uint64_t elapsedMs = GetCurrentTimeInMilliSeconds() - beginMs;
+    const uint64_t endLines = sStats.mAckedLines;
+    generator.Stop();
+
+    PrintReport(endLines - beginLines, endCpuUs > beginCpuUs ? endCpuUs - beginCpuUs : 0, elapsedMs);
+    fflush(stdout);
+    bfs::remove_all(logDir);
+    // Threads of the pipeline are never joined, skip the static destructors.
+    _exit(0);
+}
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    logtail::Logger::Instance().InitGlobalLoggers();
+    return logtail::RunBenchmark();
+}
@@ -0,0 +1,525 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// sender_benchmark measures the sender in isolation, each case prints one JSON object per line so results
+// of different builds can be compared by scripts:
+//  - queue: push and pop of LogstoreSenderQueue with one producer and one consumer over N logstores;
+//  - compress: Sender::CompressMergeItem in one thread, and Sender::SendCompressed through the compress pool
+//    and the daemon sender to a mocked sink;
+//  - buffer: spill log groups to buffer file with SendToBufferFile, and replay them with SendEncryptionBuffer;
+//  - region: IncreaseRegionConcurrency/ResetRegionConcurrency under N regions and M threads.
+//
+// Usage: ./sender_benchmark --bench_cases=queue,region --bench_queue_logstores=1,64,1024
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <json/json.h>
+#include "aggregator/Aggregator.h"
+#include "app_config/AppConfig.h"
+#include "common/FileEncryption.h"
+#include "common/FileSystemUtil.h"
+#include "common/Flags.h"
+#include "common/LogstoreSenderQueue.h"
+#include "common/MemoryBudget.h"
+#include "common/RuntimeUtil.h"
+#include "common/StringTools.h"
+#include "logger/Logger.h"
+#include "sdk/Common.h"
+#include "sender/Sender.h"
+#include "sender/SenderQueueParam.h"
+
+DEFINE_FLAG_STRING(bench_cases,
+                   "comma separated cases to run: queue, compress, buffer, region",
+                   "queue,compress,buffer,region");
+DEFINE_FLAG_STRING(bench_output, "file to append results to, empty means stdout", "");
+DEFINE_FLAG_STRING(bench_queue_logstores, "comma separated logstore counts of queue case", "1,16,256,1024");
+DEFINE_FLAG_INT32(bench_queue_items, "log groups pushed in each run of queue case", 200000);
+DEFINE_FLAG_INT32(bench_queue_fair_quantum, "scheduling quantum of queue case, <= 0 disables fair scheduling", 0);
+DEFINE_FLAG_INT32(bench_log_groups, "log groups of compress and buffer cases", 2000);
+DEFINE_FLAG_INT32(bench_logs_per_group, "logs in each log group", 256);
+DEFINE_FLAG_INT32(bench_log_size, "bytes of content of each log", 256);
+DEFINE_FLAG_STRING(bench_compress_type, "lz4 or zstd", "lz4");
+DEFINE_FLAG_INT32(bench_buffer_batch, "log groups written by each SendToBufferFile", 64);
+DEFINE_FLAG_STRING(bench_region_counts, "comma separated region counts of region case", "1,8,64");
+DEFINE_FLAG_INT32(bench_region_threads, "threads changing region concurrency", 4);
+DEFINE_FLAG_INT32(bench_region_ops, "concurrency changes by each thread", 200000);
+
+DECLARE_FLAG_BOOL(enable_mock_send);
+DECLARE_FLAG_STRING(ilogtail_config);
+DECLARE_FLAG_STRING(default_region_name);
+DECLARE_FLAG_STRING(logtail_send_address);
+DECLARE_FLAG_INT32(buffer_check_period);
+DECLARE_FLAG_INT32(default_max_send_byte_per_sec);
+DECLARE_FLAG_INT32(default_send_byte_per_sec);
+DECLARE_FLAG_INT32(reset_region_concurrency_error_count);
+DECLARE_FLAG_INT32(buffer_file_replay_thread_count);
+
+namespace logtail {
+
+namespace bfs = boost::filesystem;
+
+static const char* kBenchProject = "sender_benchmark_proj";
+static const char* kBenchLogstore = "sender_benchmark_logstore";
+
+class SenderBenchmark {
+public:
+    void Run() {
+        std::vector<std::string> cases = SplitString(STRING_FLAG(bench_cases), ",");
+        for (const auto& name : cases) {
+            if (name == "queue") {
+                BenchQueue();
+            } else if (name == "compress") {
+                InitSender();
+                BenchCompress();
+            } else if (name == "buffer") {
+                InitSender();
+                BenchBuffer();
+            } else if (name == "region") {
+                BenchRegion();
+            } else {
+                fprintf(stderr, "unknown case %s\n", name.c_str());
+            }
+        }
+    }
+
+private:
+    static double SecondsSince(std::chrono::steady_clock::time_point begin) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    static void Report(Json::Value& result, double seconds) {
+        result["seconds"] = seconds;
+        std::string line = Json::FastWriter().write(result);
+        if (STRING_FLAG(bench_output).empty()) {
+            fputs(line.c_str(), stdout);
+            fflush(stdout);
+        } else {
+            std::ofstream fout(STRING_FLAG(bench_output).c_str(), std::ios::app);
+            fout << line;
+        }
+    }
+
+    static LoggroupTimeValue* NewQueueItem(LogstoreFeedBackKey key) {
+        return new LoggroupTimeValue(kBenchProject,
+                                     kBenchLogstore + std::to_string(key),
+                                     "config",
+                                     "file",
+                                     false,
+                                     "",
+                                     STRING_FLAG(default_region_name),
+                                     LOGGROUP_COMPRESSED,
+                                     1,
+                                     600,
+                                     time(NULL),
+                                     "",
+                                     key);
+    }
+
+    // BenchQueue pushes bench_queue_items log groups round robin into @logstoreCount logstores in one thread,
+    // while another thread pops them like DaemonSender and acks them at once.
+    void BenchQueue() {
+        for (const auto& countStr : SplitString(STRING_FLAG(bench_queue_logstores), ",")) {
+            const int64_t logstoreCount = std::max(1, StringTo<int32_t>(countStr));
+            const int64_t total = INT32_FLAG(bench_queue_items);
+            LogstoreSenderQueue<SenderQueueParam> senderQueue;
+            senderQueue.SetSchedulingQuantum(INT32_FLAG(bench_queue_fair_quantum));
+            std::atomic_bool producerDone{false};
+            std::atomic<int64_t> pushFailCount{0};
+
+            const auto begin = std::chrono::steady_clock::now();
+            std::thread producer([&]() {
+                for (int64_t i = 0; i < total; ++i) {
+                    const LogstoreFeedBackKey key = i % logstoreCount;
+                    LoggroupTimeValue* item = NewQueueItem(key);
+                    while (!senderQueue.PushItem(key, item)) {
+                        ++pushFailCount;
+                        std::this_thread::yield();
+                    }
+                }
+                producerDone = true;
+            });
+
+            int64_t popped = 0;
+            int64_t popCalls = 0;
+            int64_t emptyPopCalls = 0;
+            double popSeconds = 0;
+            std::vector<LoggroupTimeValue*> items;
+            std::unordered_map<std::string, int32_t> regionConcurrencyLimits;
+            while (popped < total) {
+                items.clear();
+                bool singleQueueFullFlag = false;
+                const auto popBegin = std::chrono::steady_clock::now();
+                senderQueue.CheckAndPopAllItem(items, time(NULL), singleQueueFullFlag, regionConcurrencyLimits);
+                popSeconds += SecondsSince(popBegin);
+                ++popCalls;
+                if (items.empty()) {
+                    ++emptyPopCalls;
+                    if (!producerDone) {
+                        senderQueue.Wait(1);
+                    }
+                    continue;
+                }
+                for (auto item : items) {
+                    senderQueue.OnLoggroupSendDone(item, LogstoreSenderInfo::SendResult_OK);
+                }
+                popped += items.size();
+            }
+            producer.join();
+            const double seconds = SecondsSince(begin);
+
+            Json::Value result;
+            result["case"] = "queue";
+            result["logstores"] = Json::Int64(logstoreCount);
+            result["fair_quantum"] = INT32_FLAG(bench_queue_fair_quantum);
+            result["items"] = Json::Int64(total);
+            result["items_per_sec"] = total / seconds;
+            result["push_retries"] = Json::Int64(pushFailCount.load());
+            result["pop_calls"] = Json::Int64(popCalls);
+            result["empty_pop_calls"] = Json::Int64(emptyPopCalls);
+            result["items_per_pop"] = popCalls > 0 ? static_cast<double>(total) / popCalls : 0.0;
+            result["pop_us_avg"] = popCalls > 0 ? popSeconds * 1e6 / popCalls : 0.0;
+            Report(result, seconds);
+        }
+    }
+
+    // The sink of compress and buffer cases, requests are acked by one thread like the sdk callbacks.
+    static void MockAsyncSend(const std::string& projectName,
+                              const std::string& logstore,
+                              sls_logs::SlsCompressType compressType,
+                              const std::string& logData,
+                              SEND_DATA_TYPE dataType,
+                              int32_t rawSize,
+                              SendClosure* sendClosure) {
+        {
+            std::lock_guard<std::mutex> lock(sAckMux);
+            sAckQueue.push_back(sendClosure);
+        }
+        sAckCond.notify_one();
+    }
+
+    static void MockSyncSend(const std::string& projectName,
+                             const std::string& logstore,
+                             const std::string& logData,
+                             SEND_DATA_TYPE dataType,
+                             int32_t rawSize) {
+        if (projectName == kBenchProject) {
+            ++sReplayedGroups;
+            sReplayedBytes += rawSize;
+        }
+    }
+
+    static void AckLoop() {
+        while (true) {
+            SendClosure* sendClosure = NULL;
+            {
+                std::unique_lock<std::mutex> lock(sAckMux);
+                sAckCond.wait(lock, []() { return !sAckQueue.empty(); });
+                sendClosure = sAckQueue.front();
+                sAckQueue.pop_front();
+            }
+            if (sendClosure->mDataPtr->mProjectName == kBenchProject) {
+                ++sAckedGroups;
+            }
+            sdk::PostLogStoreLogsResponse* sr = new sdk::PostLogStoreLogsResponse;
+            sr->statusCode = 200;
+            sr->requestId = "mock_request_id";
+            sendClosure->OnSuccess(sr);
+        }
+    }
+
+    void InitSender() {
+        if (mSenderInited) {
+            return;
+        }
+        mSenderInited = true;
+        mRootDir = GetProcessExecutionDir() + "SenderBenchmark";
+        bfs::remove_all(mRootDir);
+        bfs::create_directories(mRootDir + PATH_SEPARATOR + "buffer");
+        AppConfig::GetInstance()->SetLogtailSysConfDir(mRootDir + PATH_SEPARATOR);
+        // Flow control and periodic replay would be measured instead of the sender itself.
+        INT32_FLAG(default_max_send_byte_per_sec) = INT32_MAX;
+        INT32_FLAG(default_send_byte_per_sec) = INT32_MAX;
+        INT32_FLAG(buffer_check_period) = 3600;
+        BOOL_FLAG(enable_mock_send) = true;
+        AppConfig::GetInstance()->LoadAppConfig(STRING_FLAG(ilogtail_config));
+
+        Sender* sender = Sender::Instance();
+        sender->AddEndpointEntry(STRING_FLAG(default_region_name), STRING_FLAG(logtail_send_address), true);
+        sender->InitSender();
+        sender->SetBufferFilePath(mRootDir + PATH_SEPARATOR + "buffer");
+        sender->MockAsyncSend = MockAsyncSend;
+        sender->MockSyncSend = MockSyncSend;
+        std::thread(AckLoop).detach();
+    }
+
+    MergeItem* NewMergeItem() {
+        LogGroupContext context(STRING_FLAG(default_region_name), kBenchProject, kBenchLogstore);
+        context.mCompressType
+            = STRING_FLAG(bench_compress_type) == "zstd" ? sls_logs::SLS_CMP_ZSTD : sls_logs::SLS_CMP_LZ4;
+        MergeItem* item = new MergeItem(kBenchProject,
+                                        "config",
+                                        "file",
+                                        true,
+                                        "",
+                                        STRING_FLAG(default_region_name),
+                                        0,
+                                        MERGE_BY_TOPIC,
+                                        "",
+                                        0,
+                                        INT32_FLAG(batch_send_interval),
+                                        context);
+        item->mLogGroup.set_category(kBenchLogstore);
+        item->mLastUpdateTime = time(NULL);
+        std::string content(INT32_FLAG(bench_log_size), 'a');
+        for (int32_t i = 0; i < INT32_FLAG(bench_logs_per_group); ++i) {
+            // Varied content so the compression ratio is not unrealistically high.
+            for (size_t j = 0; j < content.size(); j += 7) {
+                content[j] = static_cast<char>('a' + (i * 31 + j) % 26);
+            }
+            sls_logs::Log* log = item->mLogGroup.add_logs();
+            log->set_time(item->mLastUpdateTime);
+            sls_logs::Log_Content* logContent = log->add_contents();
+            logContent->set_key("content");
+            logContent->set_value(content);
+            item->mRawBytes += content.size();
+            ++item->mLines;
+        }
+        MemoryBudget::Add(MEMORY_COMPONENT_AGGREGATOR, item->mRawBytes);
+        return item;
+    }
+
+    std::vector<MergeItem*> NewMergeItems(int64_t& rawBytes) {
+        std::vector<MergeItem*> items;
+        rawBytes = 0;
+        for (int32_t i = 0; i < INT32_FLAG(bench_log_groups); ++i) {
+            items.push_back(NewMergeItem());
+            rawBytes += items.back()->mRawBytes;
+        }
+        return items;
+    }
+
+    void BenchCompress() {
+        Sender* sender = Sender::Instance();
+        int64_t rawBytes = 0;
+
+        std::vector<MergeItem*> items = NewMergeItems(rawBytes);
+        int64_t compressedBytes = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (auto item : items) {
+            LoggroupTimeValue* data = sender->CompressMergeItem(item);
+            if (data != NULL) {
+                compressedBytes += data->mLogData.size();
+                delete data;
+            }
+        }
+        double seconds = SecondsSince(begin);
+        for (auto item : items) {
+            delete item;
+        }
+        Json::Value result;
+        result["case"] = "compress_merge_item";
+        result["compress_type"] = STRING_FLAG(bench_compress_type);
+        result["log_groups"] = INT32_FLAG(bench_log_groups);
+        result["raw_mb_per_sec"] = rawBytes / 1048576.0 / seconds;
+        result["compress_ratio"] = compressedBytes > 0 ? static_cast<double>(rawBytes) / compressedBytes : 0.0;
+        Report(result, seconds);
+
+        // Through the compress pool, the sender queue and the daemon sender, until all are acked by the sink.
+        items = NewMergeItems(rawBytes);
+        const int64_t ackedBegin = sAckedGroups;
+        begin = std::chrono::steady_clock::now();
+        sender->SendCompressed(items);
+        while (sAckedGroups - ackedBegin < static_cast<int64_t>(items.size())) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        seconds = SecondsSince(begin);
+        result = Json::Value();
+        result["case"] = "send_compressed";
+        result["compress_type"] = STRING_FLAG(bench_compress_type);
+        result["log_groups"] = INT32_FLAG(bench_log_groups);
+        result["compress_threads"] = Json::UInt64(sender->mCompressPool ? sender->mCompressPool->GetThreadCount() : 0);
+        result["raw_mb_per_sec"] = rawBytes / 1048576.0 / seconds;
+        result["log_groups_per_sec"] = items.size() / seconds;
+        Report(result, seconds);
+    }
+
+    void BenchBuffer() {
+        Sender* sender = Sender::Instance();
+        std::vector<LoggroupTimeValue*> dataVec;
+        int64_t rawBytes = 0;
+        int64_t dataBytes = 0;
+        for (int32_t i = 0; i < INT32_FLAG(bench_log_groups); ++i) {
+            MergeItem* item = NewMergeItem();
+            LoggroupTimeValue* data = sender->CompressMergeItem(item);
+            rawBytes += item->mRawBytes;
+            delete item;
+            if (data != NULL) {
+                dataBytes += data->mLogData.size();
+                dataVec.push_back(data);
+            }
+        }
+
+        sender->CreateNewFile();
+        const size_t batchSize = std::max(1, INT32_FLAG(bench_buffer_batch));
+        auto begin = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < dataVec.size(); i += batchSize) {
+            std::vector<LoggroupTimeValue*> batch(dataVec.begin() + i,
+                                                  dataVec.begin() + std::min(dataVec.size(), i + batchSize));
+#if defined(__linux__)
+            sender->SendToBufferFile(batch);
+#else
+            for (auto data : batch) {
+                sender->SendToBufferFile(data);
+            }
+#endif
+        }
+#if defined(__linux__)
+        sender->SealBufferFile();
+#endif
+        double seconds = SecondsSince(begin);
+        for (auto data : dataVec) {
+            delete data;
+        }
+        Json::Value result;
+        result["case"] = "buffer_spill";
+        result["log_groups"] = Json::UInt64(dataVec.size());
+        result["batch"] = Json::UInt64(batchSize);
+        result["data_mb_per_sec"] = dataBytes / 1048576.0 / seconds;
+        result["raw_mb_per_sec"] = rawBytes / 1048576.0 / seconds;
+        Report(result, seconds);
+
+        // New data goes to another file, so all written files can be replayed.
+        sender->SetBufferFileName("");
+        std::vector<std::string> filesToSend;
+        sender->LoadFileToSend(time(NULL) + 3600, filesToSend);
+        const int64_t replayedBegin = sReplayedGroups;
+        const int64_t replayedBytesBegin = sReplayedBytes;
+        begin = std::chrono::steady_clock::now();
+        for (const auto& filename : filesToSend) {
+            sender->SendEncryptionBuffer(sender->GetBufferFilePath() + filename,
+                                         FileEncryption::GetInstance()->GetDefaultKeyVersion());
+        }
+        seconds = SecondsSince(begin);
+        result = Json::Value();
+        result["case"] = "buffer_replay";
+        result["files"] = Json::UInt64(filesToSend.size());
+        result["log_groups"] = Json::Int64(sReplayedGroups - replayedBegin);
+        result["replay_threads"] = INT32_FLAG(buffer_file_replay_thread_count);
+        result["raw_mb_per_sec"] = (sReplayedBytes - replayedBytesBegin) / 1048576.0 / seconds;
+        result["log_groups_per_sec"] = (sReplayedGroups - replayedBegin) / seconds;
+        Report(result, seconds);
+    }
+
+    // BenchRegion lowers and recovers the concurrency of regions from several threads, like OnFail and
+    // OnSuccess of concurrent requests do, while one thread snapshots limits like DaemonSender.
+    void BenchRegion() {
+        Sender* sender = Sender::Instance();
+        for (const auto& countStr : SplitString(STRING_FLAG(bench_region_counts), ",")) {
+            const int32_t regionCount = std::max(1, StringTo<int32_t>(countStr));
+            std::vector<std::string> regions;
+            for (int32_t i = 0; i < regionCount; ++i) {
+                regions.push_back("bench-region-" + std::to_string(i));
+                sender->AddEndpointEntry(regions.back(), "bench-region-" + std::to_string(i) + ".log.com");
+            }
+
+            std::atomic_bool stopped{false};
+            std::atomic<int64_t> snapshots{0};
+            std::thread snapshotThread([&]() {
+                while (!stopped) {
+                    std::unordered_map<std::string, int32_t> regionConcurrencyLimits;
+                    {
+                        PTScopedLock lock(sender->mRegionEndpointEntryMapLock);
+                        for (auto& entry : sender->mRegionEndpointEntryMap) {
+                            regionConcurrencyLimits.insert(std::make_pair(entry.first, entry.second->mConcurrency));
+                        }
+                    }
+                    ++snapshots;
+                    std::this_thread::yield();
+                }
+            });
+
+            const int32_t errorCount = std::max(1, INT32_FLAG(reset_region_concurrency_error_count));
+            const auto begin = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (int32_t t = 0; t < INT32_FLAG(bench_region_threads); ++t) {
+                threads.emplace_back([&, t]() {
+                    for (int32_t i = 0; i < INT32_FLAG(bench_region_ops); ++i) {
+                        const std::string& region = regions[(t + i) % regions.size()];
+                        // Errors in a row lower the concurrency, then successes recover it.
+                        if (i % (errorCount * 2) < errorCount) {
+                            sender->ResetRegionConcurrency(region, "");
+                        } else {
+                            sender->IncreaseRegionConcurrency(region, "", 1);
+                        }
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            const double seconds = SecondsSince(begin);
+            stopped = true;
+            snapshotThread.join();
+
+            const int64_t ops = static_cast<int64_t>(INT32_FLAG(bench_region_ops)) * INT32_FLAG(bench_region_threads);
+            Json::Value result;
+            result["case"] = "region";
+            result["regions"] = regionCount;
+            result["threads"] = INT32_FLAG(bench_region_threads);
+            result["ops"] = Json::Int64(ops);
+            result["ops_per_sec"] = ops / seconds;
+            result["snapshots_per_sec"] = snapshots / seconds;
+            Report(result, seconds);
+        }
+    }
+
+    bool mSenderInited = false;
+    std::string mRootDir;
+
+    static std::mutex sAckMux;
+    static std::condition_variable sAckCond;
+    static std::deque<SendClosure*> sAckQueue;
+    static std::atomic<int64_t> sAckedGroups;
+    static std::atomic<int64_t> sReplayedGroups;
+    static std::atomic<int64_t> sReplayedBytes;
+};
+
+std::mutex SenderBenchmark::sAckMux;
+std::condition_variable SenderBenchmark::sAckCond;
+std::deque<SendClosure*> SenderBenchmark::sAckQueue;
+std::atomic<int64_t> SenderBenchmark::sAckedGroups{0};
+std::atomic<int64_t> SenderBenchmark::sReplayedGroups{0};
+std::atomic<int64_t> SenderBenchmark::sReplayedBytes{0};
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    google::ParseCommandLineFlags(&argc, &argv, true);
+    logtail::Logger::Instance().InitGlobalLoggers();
+    // Logs of concurrency changes and buffer files would flood the output.
+    sLogger->set_level(spdlog::level::warn);
+    logtail::SenderBenchmark().Run();
+    fflush(stdout);
+    // Threads of the sender are never joined, skip the static destructors.
+    _exit(0);
+}
@@ -0,0 +1,73 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "unittest/Unittest.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "checkpoint/CheckPointSnapshot.h"
+
+namespace logtail {
+
+class CheckPointSnapshotUnittest : public ::testing::Test {
+public:
+    void TestCollect() {
+        CheckPointSnapshotTable* table = CheckPointSnapshotTable::GetInstance();
+        const size_t slotCount = table->GetSlotCount();
+        std::vector<CheckPointSnapshotTable::CheckPointSnapshot> checkPoints;
+        std::vector<std::string> dirs;
+        {
+            CheckPointSnapshotTable::Slot published;
+            CheckPointSnapshotTable::Slot empty;
+            APSARA_TEST_EQUAL(table->GetSlotCount(), slotCount + 2);
+            published.Publish(std::make_shared<CheckPoint>("/var/log/a.log", 100, 1024, 1, DevInode(1, 2), "c"));
+            // A newer checkpoint replaces the old one, the old one is still valid for who has got it.
+            CheckPointSnapshotTable::CheckPointSnapshot old = published.Get();
+            published.Publish(std::make_shared<CheckPoint>("/var/log/a.log", 200, 1024, 1, DevInode(1, 2), "c"));
+            APSARA_TEST_EQUAL(old->mOffset, 100);
+
+            table->Collect(checkPoints, dirs);
+            APSARA_TEST_EQUAL(checkPoints.size(), 1UL);
+            APSARA_TEST_EQUAL(checkPoints[0]->mOffset, 200);
+        }
+        APSARA_TEST_EQUAL(table->GetSlotCount(), slotCount);
+        checkPoints.clear();
+        table->Collect(checkPoints, dirs);
+        APSARA_TEST_TRUE(checkPoints.empty());
+    }
+
+    void TestDirs() {
+        CheckPointSnapshotTable* table = CheckPointSnapshotTable::GetInstance();
+        table->ClearDirs();
+        table->AddDir(1, "/var/log");
+        table->AddDir(2, "/var/log/nginx");
+        table->AddDir(1, "/home/admin/logs");
+        table->RemoveDir(2);
+        std::vector<CheckPointSnapshotTable::CheckPointSnapshot> checkPoints;
+        std::vector<std::string> dirs;
+        table->Collect(checkPoints, dirs);
+        APSARA_TEST_EQUAL(dirs, std::vector<std::string>({"/home/admin/logs"}));
+        table->ClearDirs();
+        dirs.clear();
+        table->Collect(checkPoints, dirs);
+        APSARA_TEST_TRUE(dirs.empty());
+    }
+};
+
+UNIT_TEST_CASE(CheckPointSnapshotUnittest, TestCollect);
+UNIT_TEST_CASE(CheckPointSnapshotUnittest, TestDirs);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
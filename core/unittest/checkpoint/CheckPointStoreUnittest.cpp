@@ -0,0 +1,71 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <algorithm>
+#include "common/RuntimeUtil.h"
+#include "checkpoint/CheckPointStore.h"
+
+namespace logtail {
+
+class CheckPointStoreUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mStorePath = (bfs::path(GetProcessExecutionDir()) / "CheckPointStoreUnittest").string();
+        bfs::remove_all(mStorePath);
+    }
+
+    void TearDown() override { bfs::remove_all(mStorePath); }
+
+    void TestDumpChangedOnly() {
+        CheckPointStore::EntryList entries{{"a", "1"}, {"b", "2"}, {"c", "3"}};
+        {
+            CheckPointStore store(mStorePath);
+            size_t writeCount = 0;
+            APSARA_TEST_TRUE(store.Dump(entries, &writeCount));
+            APSARA_TEST_EQUAL(writeCount, 3UL);
+            APSARA_TEST_TRUE(store.Dump(entries, &writeCount));
+            APSARA_TEST_EQUAL(writeCount, 0UL);
+
+            // Update b, delete c and add d.
+            entries = {{"a", "1"}, {"b", "22"}, {"d", "4"}};
+            APSARA_TEST_TRUE(store.Dump(entries, &writeCount));
+            APSARA_TEST_EQUAL(writeCount, 3UL);
+        }
+
+        CheckPointStore store(mStorePath);
+        CheckPointStore::EntryList loaded;
+        APSARA_TEST_TRUE(store.Load(loaded));
+        std::sort(loaded.begin(), loaded.end());
+        APSARA_TEST_TRUE(loaded == entries);
+        // Loaded entries are known to be dumped.
+        size_t writeCount = 0;
+        APSARA_TEST_TRUE(store.Dump(entries, &writeCount));
+        APSARA_TEST_EQUAL(writeCount, 0UL);
+        APSARA_TEST_TRUE(store.Dump(CheckPointStore::EntryList(), &writeCount));
+        APSARA_TEST_EQUAL(writeCount, 3UL);
+        loaded.clear();
+        APSARA_TEST_TRUE(store.Load(loaded));
+        APSARA_TEST_TRUE(loaded.empty());
+    }
+
+private:
+    std::string mStorePath;
+};
+
+UNIT_TEST_CASE(CheckPointStoreUnittest, TestDumpChangedOnly);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -22,6 +22,9 @@
 DECLARE_FLAG_INT32(logtail_checkpoint_check_gc_interval_sec);
 DECLARE_FLAG_INT32(logtail_checkpoint_expired_threshold_sec);
 DECLARE_FLAG_INT32(logtail_checkpoint_gc_threshold_sec);
+DECLARE_FLAG_INT32(logtail_checkpoint_write_batch_interval_ms);
+DECLARE_FLAG_INT32(logtail_checkpoint_compact_min_delete_count);
+DECLARE_FLAG_INT32(logtail_checkpoint_compact_idle_write_count);
 
 namespace logtail {
 
@@ -55,6 +58,10 @@ public:
     void TestExtractPrimaryKeyFromRangeKey();
 
     void TestMarkGC();
+
+    void TestWriteCombined();
+
+    void TestCompactIfIdle();
 };
 
 UNIT_TEST_CASE(CheckpointManagerV2Unittest, TestBaseMethod);
@@ -62,6 +69,8 @@ UNIT_TEST_CASE(CheckpointManagerV2Unittest, TestProtobufMethod);
 UNIT_TEST_CASE(CheckpointManagerV2Unittest, TestScanCheckpoints);
 UNIT_TEST_CASE(CheckpointManagerV2Unittest, TestExtractPrimaryKeyFromRangeKey);
 UNIT_TEST_CASE(CheckpointManagerV2Unittest, TestMarkGC);
+UNIT_TEST_CASE(CheckpointManagerV2Unittest, TestWriteCombined);
+UNIT_TEST_CASE(CheckpointManagerV2Unittest, TestCompactIfIdle);
 
 void CheckpointManagerV2Unittest::TestBaseMethod() {
     CheckpointManagerV2 m;
@@ -343,6 +352,74 @@ void CheckpointManagerV2Unittest::TestMarkGC() {
     }
 }
 
+void CheckpointManagerV2Unittest::TestWriteCombined() {
+    const std::string key = "combined";
+    const auto bakInterval = INT32_FLAG(logtail_checkpoint_write_batch_interval_ms);
+    // Long enough that flush thread does not flush during test.
+    INT32_FLAG(logtail_checkpoint_write_batch_interval_ms) = 3600 * 1000;
+    {
+        CheckpointManagerV2 m;
+        std::string value;
+        EXPECT_TRUE(m.write(key, "v1"));
+        // Visible to reads before written to database.
+        EXPECT_TRUE(m.read(key, value));
+        EXPECT_EQ(value, "v1");
+        EXPECT_FALSE(m.mDatabase->Get(leveldb::ReadOptions(), key, &value).ok());
+        m.Flush();
+        EXPECT_TRUE(m.mDatabase->Get(leveldb::ReadOptions(), key, &value).ok());
+        EXPECT_EQ(value, "v1");
+
+        // Deletes drop pending writes.
+        EXPECT_TRUE(m.write(key, "v2"));
+        m.DeleteCheckpoints(std::vector<std::string>{key});
+        m.Flush();
+        EXPECT_FALSE(m.read(key, value));
+
+        // Pending writes are flushed when destructed.
+        EXPECT_TRUE(m.write(key, "v3"));
+    }
+    INT32_FLAG(logtail_checkpoint_write_batch_interval_ms) = bakInterval;
+
+    CheckpointManagerV2 m;
+    std::string value;
+    EXPECT_TRUE(m.read(key, value));
+    EXPECT_EQ(value, "v3");
+    m.DeleteCheckpoints(std::vector<std::string>{key});
+}
+
+void CheckpointManagerV2Unittest::TestCompactIfIdle() {
+    const auto bakDeleteCount = INT32_FLAG(logtail_checkpoint_compact_min_delete_count);
+    const auto bakIdleWriteCount = INT32_FLAG(logtail_checkpoint_compact_idle_write_count);
+    INT32_FLAG(logtail_checkpoint_compact_min_delete_count) = 10;
+    INT32_FLAG(logtail_checkpoint_compact_idle_write_count) = 5;
+
+    CheckpointManagerV2 m;
+    // Stop GC thread, compactIfIdle is called by test only.
+    m.mStopGCThread = true;
+    m.mGCThreadPtr->join();
+    m.mGCThreadPtr.reset();
+    m.rebuild();
+
+    std::vector<std::string> keys;
+    for (int idx = 0; idx < 10; ++idx) {
+        keys.push_back("compact" + std::to_string(idx));
+        EXPECT_TRUE(m.write(keys.back(), "value"));
+    }
+    // Too few keys deleted.
+    EXPECT_FALSE(m.compactIfIdle(time(NULL)));
+    // Enough keys deleted, but deletes are writes of this round.
+    m.DeleteCheckpoints(keys);
+    EXPECT_FALSE(m.compactIfIdle(time(NULL)));
+    // No write in this round.
+    EXPECT_TRUE(m.compactIfIdle(time(NULL)));
+    EXPECT_EQ(m.mDeleteCountSinceCompact.load(), 0UL);
+    std::string value;
+    EXPECT_FALSE(m.read(keys[0], value));
+
+    INT32_FLAG(logtail_checkpoint_compact_min_delete_count) = bakDeleteCount;
+    INT32_FLAG(logtail_checkpoint_compact_idle_write_count) = bakIdleWriteCount;
+}
+
 } // namespace logtail
 
 UNIT_TEST_MAIN
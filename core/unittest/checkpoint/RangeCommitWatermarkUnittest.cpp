@@ -0,0 +1,77 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "checkpoint/RangeCheckpoint.h"
+
+namespace logtail {
+
+class RangeCommitWatermarkUnittest : public ::testing::Test {
+public:
+    void TestOutOfOrderAck() {
+        RangeCommitWatermark watermark(100);
+        watermark.Dispatch(100, 10);
+        watermark.Dispatch(110, 20);
+        watermark.Dispatch(130, 5);
+        watermark.Ack(130, 5);
+        watermark.Ack(110, 20);
+        // The first range is not acknowledged.
+        APSARA_TEST_EQUAL(watermark.GetCommittedOffset(), 100UL);
+        APSARA_TEST_EQUAL(watermark.GetPendingAckCount(), 2UL);
+        watermark.Ack(100, 10);
+        APSARA_TEST_EQUAL(watermark.GetCommittedOffset(), 135UL);
+        APSARA_TEST_EQUAL(watermark.GetPendingAckCount(), 0UL);
+        // Acked twice.
+        watermark.Ack(110, 20);
+        APSARA_TEST_EQUAL(watermark.GetCommittedOffset(), 135UL);
+        APSARA_TEST_EQUAL(watermark.GetPendingAckCount(), 0UL);
+    }
+
+    void TestSkippedData() {
+        RangeCommitWatermark watermark(0);
+        // Data before the first range and between ranges is never sent.
+        watermark.Dispatch(50, 10);
+        watermark.Dispatch(80, 10);
+        APSARA_TEST_EQUAL(watermark.GetCommittedOffset(), 50UL);
+        watermark.Ack(80, 10);
+        APSARA_TEST_EQUAL(watermark.GetCommittedOffset(), 50UL);
+        watermark.Ack(50, 10);
+        APSARA_TEST_EQUAL(watermark.GetCommittedOffset(), 90UL);
+    }
+
+    void TestReadAgain() {
+        RangeCommitWatermark watermark(0);
+        watermark.Dispatch(0, 100);
+        watermark.Dispatch(100, 100);
+        watermark.Ack(100, 100);
+        // File is truncated and read again from 0.
+        watermark.Dispatch(0, 50);
+        APSARA_TEST_EQUAL(watermark.GetCommittedOffset(), 0UL);
+        APSARA_TEST_EQUAL(watermark.GetPendingAckCount(), 0UL);
+        watermark.Ack(0, 50);
+        APSARA_TEST_EQUAL(watermark.GetCommittedOffset(), 50UL);
+
+        watermark.Reset(1000);
+        watermark.Ack(0, 100);
+        APSARA_TEST_EQUAL(watermark.GetCommittedOffset(), 1000UL);
+    }
+};
+
+UNIT_TEST_CASE(RangeCommitWatermarkUnittest, TestOutOfOrderAck);
+UNIT_TEST_CASE(RangeCommitWatermarkUnittest, TestSkippedData);
+UNIT_TEST_CASE(RangeCommitWatermarkUnittest, TestReadAgain);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,95 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common/BatchRead.h"
+
+namespace logtail {
+
+class BatchReadUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mDir = "/tmp/BatchReadUnittest." + std::to_string(getpid());
+        mkdir(mDir.c_str(), 0755);
+    }
+
+    void TearDown() override {
+        for (int fd : mFds) {
+            close(fd);
+        }
+        for (const auto& path : mFiles) {
+            unlink(path.c_str());
+        }
+        rmdir(mDir.c_str());
+    }
+
+    void TestRead() {
+        // A small queue depth makes requests read in several batches.
+        BatchRead batchRead(4);
+        std::vector<std::string> contents;
+        std::vector<BatchRead::Request> requests(10);
+        std::vector<std::vector<char>> buffers(requests.size(), std::vector<char>(16));
+        std::vector<BatchRead::Request*> requestPtrs;
+        for (size_t i = 0; i < requests.size(); ++i) {
+            std::string path = mDir + "/" + std::to_string(i);
+            contents.push_back(std::string(i * 3, static_cast<char>('a' + i)));
+            std::ofstream(path) << contents.back();
+            mFiles.push_back(path);
+            int fd = open(path.c_str(), O_RDONLY);
+            APSARA_TEST_TRUE(fd >= 0);
+            mFds.push_back(fd);
+            requests[i].fd = fd;
+            requests[i].buffer = buffers[i].data();
+            requests[i].size = buffers[i].size();
+            requests[i].offset = 2;
+            requestPtrs.push_back(&requests[i]);
+        }
+        // Bad fd fails alone.
+        BatchRead::Request bad;
+        bad.fd = -1;
+        bad.buffer = buffers[0].data();
+        bad.size = buffers[0].size();
+        requestPtrs.push_back(&bad);
+
+        batchRead.Read(requestPtrs);
+        for (size_t i = 0; i < requests.size(); ++i) {
+            std::string expected = contents[i].size() > 2 ? contents[i].substr(2, 16) : std::string();
+            APSARA_TEST_EQUAL_FATAL(requests[i].result, static_cast<int64_t>(expected.size()));
+            APSARA_TEST_EQUAL(std::string(requests[i].buffer, requests[i].result), expected);
+        }
+        APSARA_TEST_EQUAL(bad.result, -EBADF);
+    }
+
+    void TestEmpty() {
+        BatchRead batchRead;
+        batchRead.Read(std::vector<BatchRead::Request*>());
+    }
+
+private:
+    std::string mDir;
+    std::vector<std::string> mFiles;
+    std::vector<int> mFds;
+};
+
+UNIT_TEST_CASE(BatchReadUnittest, TestRead);
+UNIT_TEST_CASE(BatchReadUnittest, TestEmpty);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
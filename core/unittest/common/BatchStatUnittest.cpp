@@ -0,0 +1,91 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cerrno>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "common/BatchStat.h"
+
+namespace logtail {
+
+class BatchStatUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mDir = "/tmp/BatchStatUnittest." + std::to_string(getpid());
+        mkdir(mDir.c_str(), 0755);
+    }
+
+    void TearDown() override {
+        for (const auto& path : mFiles) {
+            unlink(path.c_str());
+        }
+        rmdir(mDir.c_str());
+    }
+
+    void TestStat() {
+        // A small queue depth makes paths stat'ed in several batches.
+        BatchStat batchStat(4);
+        std::vector<std::string> paths;
+        for (int i = 0; i < 10; ++i) {
+            std::string path = mDir + "/" + std::to_string(i);
+            if (i % 3 != 0) {
+                std::ofstream(path) << std::string(i, 'a');
+                mFiles.push_back(path);
+            }
+            paths.push_back(path);
+        }
+        paths.push_back(mDir);
+
+        std::vector<fsutil::PathStat> stats;
+        std::vector<int> errnos;
+        batchStat.Stat(paths, stats, errnos);
+        APSARA_TEST_EQUAL_FATAL(stats.size(), paths.size());
+        APSARA_TEST_EQUAL_FATAL(errnos.size(), paths.size());
+        for (size_t i = 0; i < paths.size(); ++i) {
+            fsutil::PathStat expected;
+            if (!fsutil::PathStat::stat(paths[i], expected)) {
+                APSARA_TEST_EQUAL(errnos[i], ENOENT);
+                continue;
+            }
+            APSARA_TEST_EQUAL(errnos[i], 0);
+            APSARA_TEST_EQUAL(stats[i].GetDevInode(), expected.GetDevInode());
+            APSARA_TEST_EQUAL(stats[i].GetFileSize(), expected.GetFileSize());
+            APSARA_TEST_EQUAL(stats[i].GetMtime(), expected.GetMtime());
+            APSARA_TEST_EQUAL(stats[i].IsDir(), expected.IsDir());
+            APSARA_TEST_EQUAL(stats[i].IsRegFile(), expected.IsRegFile());
+        }
+    }
+
+    void TestEmpty() {
+        BatchStat batchStat;
+        std::vector<fsutil::PathStat> stats(1);
+        std::vector<int> errnos(1);
+        batchStat.Stat(std::vector<std::string>(), stats, errnos);
+        APSARA_TEST_TRUE(stats.empty());
+        APSARA_TEST_TRUE(errnos.empty());
+    }
+
+private:
+    std::string mDir;
+    std::vector<std::string> mFiles;
+};
+
+UNIT_TEST_CASE(BatchStatUnittest, TestStat);
+UNIT_TEST_CASE(BatchStatUnittest, TestEmpty);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
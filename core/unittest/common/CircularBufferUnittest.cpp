@@ -0,0 +1,128 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/CircularBuffer.h"
+
+namespace logtail {
+
+class CircularBufferUnittest : public ::testing::Test {
+public:
+    void TestPushPop() {
+        CircularBuffer<std::string, 3> buffer;
+        APSARA_TEST_EQUAL(buffer.Capacity(), 4UL);
+        std::string item;
+        APSARA_TEST_FALSE(buffer.TryPopItem(item));
+        for (int i = 0; i < 4; ++i) {
+            APSARA_TEST_TRUE(buffer.TryPushItem(std::to_string(i)));
+        }
+        APSARA_TEST_FALSE(buffer.TryPushItem(std::string("full")));
+        APSARA_TEST_EQUAL(buffer.GetItemNumber(), 4UL);
+        // Positions wrap around the ring.
+        for (int round = 0; round < 3; ++round) {
+            for (int i = 0; i < 4; ++i) {
+                APSARA_TEST_TRUE(buffer.TryPopItem(item));
+                APSARA_TEST_EQUAL(item, std::to_string(round * 4 + i));
+                APSARA_TEST_TRUE(buffer.TryPushItem(std::to_string((round + 1) * 4 + i)));
+            }
+        }
+        APSARA_TEST_EQUAL(buffer.GetItemNumber(), 4UL);
+    }
+
+    void TestBatch() {
+        CircularBuffer<int, 8> buffer;
+        int items[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+        APSARA_TEST_EQUAL(buffer.PushBatch(items, 5), 5UL);
+        // Only the free part is pushed.
+        APSARA_TEST_EQUAL(buffer.PushBatch(items + 5, 5), 3UL);
+        APSARA_TEST_EQUAL(buffer.PushBatch(items, 1), 0UL);
+
+        int popped[10] = {0};
+        APSARA_TEST_EQUAL(buffer.PopBatch(popped, 6), 6UL);
+        for (int i = 0; i < 6; ++i) {
+            APSARA_TEST_EQUAL(popped[i], i);
+        }
+        APSARA_TEST_EQUAL(buffer.PushBatch(items, 4), 4UL);
+        APSARA_TEST_EQUAL(buffer.PopBatch(popped, 10), 6UL);
+        int expected[6] = {6, 7, 0, 1, 2, 3};
+        for (int i = 0; i < 6; ++i) {
+            APSARA_TEST_EQUAL(popped[i], expected[i]);
+        }
+        APSARA_TEST_EQUAL(buffer.PopBatch(popped, 10), 0UL);
+    }
+
+    void TestProducerConsumer() {
+        const int kItemCount = 20000;
+        CircularBuffer<int, 64> buffer;
+        std::thread producer([&buffer, kItemCount]() {
+            int batch[16];
+            int next = 0;
+            while (next < kItemCount) {
+                if (next % 3 == 0) {
+                    buffer.PushItem(next++);
+                    continue;
+                }
+                size_t count = 0;
+                while (count < 16 && next + static_cast<int>(count) < kItemCount) {
+                    batch[count] = next + static_cast<int>(count);
+                    ++count;
+                }
+                next += static_cast<int>(buffer.PushBatch(batch, count));
+            }
+        });
+        int expected = 0;
+        int batch[8];
+        while (expected < kItemCount) {
+            size_t count = buffer.PopBatch(batch, 8);
+            if (count == 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                APSARA_TEST_EQUAL_FATAL(batch[i], expected);
+                ++expected;
+            }
+        }
+        producer.join();
+        APSARA_TEST_EQUAL(buffer.GetItemNumber(), 0UL);
+    }
+
+    void TestSemaphore() {
+        CircularBufferSem<int, 5> buffer;
+        std::thread producer([&buffer]() {
+            for (int i = 0; i < 1000; ++i) {
+                buffer.PushItem(i);
+            }
+        });
+        for (int i = 0; i < 1000; ++i) {
+            int item = -1;
+            buffer.PopItem(item);
+            APSARA_TEST_EQUAL_FATAL(item, i);
+            APSARA_TEST_TRUE(buffer.GetItemNumber() <= 5UL);
+        }
+        producer.join();
+    }
+};
+
+UNIT_TEST_CASE(CircularBufferUnittest, TestPushPop);
+UNIT_TEST_CASE(CircularBufferUnittest, TestBatch);
+UNIT_TEST_CASE(CircularBufferUnittest, TestProducerConsumer);
+UNIT_TEST_CASE(CircularBufferUnittest, TestSemaphore);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,85 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstdlib>
+#include "common/CompressTools.h"
+
+namespace logtail {
+
+class CompressToolsUnittest : public ::testing::Test {
+public:
+    // Contexts reused across calls must not leak state between packets.
+    void TestZstdReuseContext() {
+        srand(0);
+        for (int round = 0; round < 200; ++round) {
+            std::string src;
+            const int size = rand() % 4096;
+            for (int i = 0; i < size; ++i) {
+                src += static_cast<char>('a' + rand() % (round % 2 == 0 ? 4 : 26));
+            }
+            std::string compressed;
+            APSARA_TEST_TRUE_FATAL(CompressZstd(src, compressed, ZSTD_DEFAULT_LEVEL));
+            std::string dst;
+            APSARA_TEST_TRUE_FATAL(UncompressZstd(compressed, src.size(), dst));
+            APSARA_TEST_TRUE_FATAL(dst == src);
+        }
+    }
+
+    void TestZstdInvalidData() {
+        std::string compressed;
+        APSARA_TEST_TRUE(CompressZstd(std::string(1000, 'x'), compressed, ZSTD_DEFAULT_LEVEL));
+        std::string dst;
+        APSARA_TEST_TRUE(!UncompressZstd(compressed, 999, dst));
+        APSARA_TEST_TRUE(!UncompressZstd(std::string("not zstd data"), 1000, dst));
+        // The context is still usable after errors.
+        APSARA_TEST_TRUE(UncompressZstd(compressed, 1000, dst));
+        APSARA_TEST_TRUE(dst == std::string(1000, 'x'));
+    }
+
+    // Thread compressors reusing states and buffers must compress the same as new ones.
+    void TestCompressorReuse() {
+        const sls_logs::SlsCompressType types[]
+            = {sls_logs::SLS_CMP_NONE, sls_logs::SLS_CMP_DEFLATE, sls_logs::SLS_CMP_LZ4, sls_logs::SLS_CMP_ZSTD};
+        srand(0);
+        for (int round = 0; round < 100; ++round) {
+            // Large and small packets in turn.
+            std::string src(round % 2 == 0 ? 100000 + rand() % 100000 : rand() % 100, 'a');
+            for (size_t i = 0; i < src.size(); ++i) {
+                src[i] += rand() % 8;
+            }
+            for (sls_logs::SlsCompressType type : types) {
+                Compressor* compressor = GetThreadCompressor(type);
+                APSARA_TEST_TRUE_FATAL(compressor != NULL);
+                APSARA_TEST_EQUAL(compressor->GetType(), type);
+                std::string compressed;
+                APSARA_TEST_TRUE_FATAL(compressor->Compress(src, compressed));
+                std::string expected;
+                APSARA_TEST_TRUE_FATAL(Compressor(type).Compress(src, expected));
+                APSARA_TEST_TRUE_FATAL(compressed == expected);
+                std::string dst;
+                APSARA_TEST_TRUE_FATAL(UncompressData(type, compressed, src.size(), dst));
+                APSARA_TEST_TRUE_FATAL(dst == src);
+            }
+        }
+    }
+};
+
+UNIT_TEST_CASE(CompressToolsUnittest, TestZstdReuseContext);
+UNIT_TEST_CASE(CompressToolsUnittest, TestZstdInvalidData);
+UNIT_TEST_CASE(CompressToolsUnittest, TestCompressorReuse);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
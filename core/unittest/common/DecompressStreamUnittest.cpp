@@ -0,0 +1,184 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <zlib/zlib.h>
+#include <zstd/zstd.h>
+#include <string.h>
+#include <string>
+#include "common/DecompressStream.h"
+
+namespace logtail {
+
+class DecompressStreamUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mData.clear();
+        for (int i = 0; i < 100000; ++i) {
+            mData.append("2023-01-01 00:00:00 INFO line ").append(std::to_string(i)).append("\n");
+        }
+        mReadCount = 0;
+    }
+
+    void TestDetectFormat();
+    void TestGzip();
+    void TestConcatenatedGzip();
+    void TestZstd();
+    void TestReadBackward();
+    void TestTruncated();
+    void TestBroken();
+
+private:
+    static std::string Gzip(const std::string& data) {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        std::string out(deflateBound(&stream, data.size()), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = data.size();
+        stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+        stream.avail_out = out.size();
+        deflate(&stream, Z_FINISH);
+        out.resize(stream.total_out);
+        deflateEnd(&stream);
+        return out;
+    }
+
+    static std::string Zstd(const std::string& data) {
+        std::string out(ZSTD_compressBound(data.size()), '\0');
+        out.resize(ZSTD_compress(&out[0], out.size(), data.data(), data.size(), 1));
+        return out;
+    }
+
+    DecompressStream::ReadFunc Reader() {
+        return [this](char* buf, size_t size, int64_t offset) {
+            ++mReadCount;
+            if (offset >= static_cast<int64_t>(mFile.size())) {
+                return 0;
+            }
+            const size_t nbytes = std::min(size, mFile.size() - static_cast<size_t>(offset));
+            memcpy(buf, mFile.data() + offset, nbytes);
+            return static_cast<int>(nbytes);
+        };
+    }
+
+    // ReadAll reads the stream forward in chunks of @chunkSize.
+    static std::string ReadAll(DecompressStream& stream, size_t chunkSize) {
+        std::string result;
+        std::string buf(chunkSize, '\0');
+        while (true) {
+            const int nbytes = stream.Read(&buf[0], chunkSize, result.size());
+            if (nbytes <= 0) {
+                break;
+            }
+            result.append(buf.data(), nbytes);
+        }
+        return result;
+    }
+
+    std::string mData;
+    std::string mFile;
+    int32_t mReadCount = 0;
+};
+
+UNIT_TEST_CASE(DecompressStreamUnittest, TestDetectFormat);
+UNIT_TEST_CASE(DecompressStreamUnittest, TestGzip);
+UNIT_TEST_CASE(DecompressStreamUnittest, TestConcatenatedGzip);
+UNIT_TEST_CASE(DecompressStreamUnittest, TestZstd);
+UNIT_TEST_CASE(DecompressStreamUnittest, TestReadBackward);
+UNIT_TEST_CASE(DecompressStreamUnittest, TestTruncated);
+UNIT_TEST_CASE(DecompressStreamUnittest, TestBroken);
+
+void DecompressStreamUnittest::TestDetectFormat() {
+    const std::string gzip = Gzip("abc"), zstd = Zstd("abc");
+    APSARA_TEST_EQUAL(DecompressStream::DetectFormat(gzip.data(), gzip.size()), DecompressStream::FORMAT_GZIP);
+    APSARA_TEST_EQUAL(DecompressStream::DetectFormat(zstd.data(), zstd.size()), DecompressStream::FORMAT_ZSTD);
+    APSARA_TEST_EQUAL(DecompressStream::DetectFormat("abcd", 4), DecompressStream::FORMAT_NONE);
+    APSARA_TEST_EQUAL(DecompressStream::DetectFormat(gzip.data(), 1), DecompressStream::FORMAT_NONE);
+}
+
+void DecompressStreamUnittest::TestGzip() {
+    mFile = Gzip(mData);
+    DecompressStream stream(DecompressStream::FORMAT_GZIP, Reader());
+    APSARA_TEST_EQUAL(stream.GetSize(), static_cast<int64_t>(mData.size()));
+    APSARA_TEST_TRUE(ReadAll(stream, 100000) == mData);
+}
+
+void DecompressStreamUnittest::TestConcatenatedGzip() {
+    const size_t half = mData.size() / 2;
+    mFile = Gzip(mData.substr(0, half)) + Gzip(mData.substr(half));
+    DecompressStream stream(DecompressStream::FORMAT_GZIP, Reader());
+    APSARA_TEST_EQUAL(stream.GetSize(), static_cast<int64_t>(mData.size()));
+    APSARA_TEST_TRUE(ReadAll(stream, 65536) == mData);
+
+    // Padding after the last member is ignored.
+    mFile.append(16, '\0');
+    DecompressStream padded(DecompressStream::FORMAT_GZIP, Reader());
+    APSARA_TEST_EQUAL(padded.GetSize(), static_cast<int64_t>(mData.size()));
+}
+
+void DecompressStreamUnittest::TestZstd() {
+    const size_t half = mData.size() / 2;
+    mFile = Zstd(mData.substr(0, half)) + Zstd(mData.substr(half));
+    DecompressStream stream(DecompressStream::FORMAT_ZSTD, Reader());
+    APSARA_TEST_EQUAL(stream.GetSize(), static_cast<int64_t>(mData.size()));
+    APSARA_TEST_TRUE(ReadAll(stream, 300000) == mData);
+}
+
+void DecompressStreamUnittest::TestReadBackward() {
+    mFile = Zstd(mData);
+    DecompressStream stream(DecompressStream::FORMAT_ZSTD, Reader());
+    char buf[100];
+    // Skipped forward.
+    const int64_t offset = static_cast<int64_t>(mData.size()) - 1000;
+    APSARA_TEST_EQUAL(stream.Read(buf, sizeof(buf), offset), 100);
+    APSARA_TEST_TRUE(memcmp(buf, mData.data() + offset, sizeof(buf)) == 0);
+
+    // Reads in head are served without decompressing again.
+    mReadCount = 0;
+    APSARA_TEST_EQUAL(stream.Read(buf, sizeof(buf), 10), 100);
+    APSARA_TEST_TRUE(memcmp(buf, mData.data() + 10, sizeof(buf)) == 0);
+    APSARA_TEST_EQUAL(mReadCount, 0);
+
+    // Others restart from the beginning.
+    APSARA_TEST_EQUAL(stream.Read(buf, sizeof(buf), 5000), 100);
+    APSARA_TEST_TRUE(memcmp(buf, mData.data() + 5000, sizeof(buf)) == 0);
+    APSARA_TEST_TRUE(mReadCount > 0);
+    APSARA_TEST_EQUAL(stream.Read(buf, sizeof(buf), static_cast<int64_t>(mData.size())), 0);
+}
+
+void DecompressStreamUnittest::TestTruncated() {
+    mFile = Gzip(mData);
+    mFile.resize(mFile.size() / 2);
+    DecompressStream stream(DecompressStream::FORMAT_GZIP, Reader());
+    const int64_t size = stream.GetSize();
+    APSARA_TEST_TRUE(size > 0);
+    APSARA_TEST_TRUE(size < static_cast<int64_t>(mData.size()));
+    const std::string data = ReadAll(stream, 4096);
+    APSARA_TEST_EQUAL(static_cast<int64_t>(data.size()), size);
+    APSARA_TEST_TRUE(mData.compare(0, data.size(), data) == 0);
+}
+
+void DecompressStreamUnittest::TestBroken() {
+    mFile = Gzip(mData);
+    for (size_t i = 100; i < 200; ++i) {
+        mFile[i] = static_cast<char>(~mFile[i]);
+    }
+    DecompressStream stream(DecompressStream::FORMAT_GZIP, Reader());
+    APSARA_TEST_EQUAL(stream.GetSize(), -1);
+}
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
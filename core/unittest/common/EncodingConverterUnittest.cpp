@@ -0,0 +1,111 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <string>
+#include <vector>
+#include "common/EncodingConverter.h"
+
+namespace logtail {
+
+class EncodingConverterUnittest : public ::testing::Test {
+public:
+    void TestIsAscii() {
+        std::string ascii;
+        for (int i = 0; i < 100; ++i) {
+            ascii.push_back(static_cast<char>('a' + i % 26));
+        }
+        APSARA_TEST_TRUE(EncodingConverter::IsAscii(ascii.data(), ascii.size()));
+        APSARA_TEST_TRUE(EncodingConverter::IsAscii(ascii.data(), 0));
+        // Non-ASCII byte at each position, covering the vector and the tail part.
+        for (size_t pos = 0; pos < ascii.size(); ++pos) {
+            std::string s = ascii;
+            s[pos] = '\xD6';
+            APSARA_TEST_FALSE(EncodingConverter::IsAscii(s.data(), s.size()));
+            APSARA_TEST_TRUE(EncodingConverter::IsAscii(s.data(), pos));
+        }
+    }
+
+    void TestConvertByTable() {
+        // "中文" in GBK.
+        const std::string gbkWord("\xD6\xD0\xCE\xC4");
+        const std::string utf8Word("\xE4\xB8\xAD\xE6\x96\x87");
+        std::string src;
+        std::string expected;
+        for (int i = 0; i < 10; ++i) {
+            const std::string ascii(i * 7, 'x');
+            src += ascii + gbkWord + ascii + "\n";
+            expected += ascii + utf8Word + ascii + "\n";
+        }
+        APSARA_TEST_EQUAL(Convert(src), expected);
+        APSARA_TEST_EQUAL(Convert(src), ConvertByIconv(src));
+    }
+
+    void TestConvertInvalidLine() {
+        // Single lead byte at the end of the first line, it is copied as ConvertGbk2Utf8.
+        const std::string src("abc\xD6\nabc\xD6\xD0\n");
+        APSARA_TEST_EQUAL(Convert(src), ConvertByIconv(src));
+        APSARA_TEST_EQUAL(Convert(src), std::string("abc\xD6\nabc\xE4\xB8\xAD\n"));
+    }
+
+    void TestConvertAllChars() {
+        std::string src;
+        for (int lead = 0x81; lead <= 0xFE; ++lead) {
+            for (int trail = 0x40; trail <= 0xFE; ++trail) {
+                src.push_back(static_cast<char>(lead));
+                src.push_back(static_cast<char>(trail));
+                src.push_back('\n');
+            }
+        }
+        APSARA_TEST_EQUAL(Convert(src), ConvertByIconv(src));
+    }
+
+private:
+    static std::vector<size_t> LinePos(const std::string& src) {
+        std::vector<size_t> linePos;
+        for (size_t i = 0; i < src.size(); ++i) {
+            if (src[i] == '\n') {
+                linePos.push_back(i);
+            }
+        }
+        return linePos;
+    }
+
+    static std::string Convert(const std::string& src) {
+        std::vector<char> des(src.size() * 2 + 1);
+        size_t length
+            = EncodingConverter::GetInstance()->ConvertGbk2Utf8ByTable(src.data(), src.size(), des.data(), LinePos(src));
+        return std::string(des.data(), length);
+    }
+
+    static std::string ConvertByIconv(const std::string& src) {
+        std::string copy = src;
+        size_t srcLength = copy.size();
+        char* des = NULL;
+        size_t desLength = 0;
+        EncodingConverter::GetInstance()->ConvertGbk2Utf8(&copy[0], &srcLength, des, &desLength, LinePos(src));
+        std::string result(des, desLength);
+        delete[] des;
+        return result;
+    }
+};
+
+UNIT_TEST_CASE(EncodingConverterUnittest, TestIsAscii);
+UNIT_TEST_CASE(EncodingConverterUnittest, TestConvertByTable);
+UNIT_TEST_CASE(EncodingConverterUnittest, TestConvertInvalidLine);
+UNIT_TEST_CASE(EncodingConverterUnittest, TestConvertAllChars);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,123 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstdlib>
+#include <string>
+#include "common/FileEncryption.h"
+#include "common/TimeUtil.h"
+
+namespace logtail {
+
+class FileEncryptionUnittest : public ::testing::Test {
+    // Key of version 1, which is the default key.
+    static const std::string& GetKey() {
+        static const std::string key = "b394d709b96949bb3ca6f7b2f2d9a493";
+        return key;
+    }
+
+    static std::string MakeData(size_t size) {
+        std::string data(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<char>(rand() % 256);
+        }
+        return data;
+    }
+
+    // Byte by byte xor before vectorization, kept here as the baseline.
+    static void LegacyXor(const char* src, char* des, int32_t length, const std::string& key) {
+        for (int32_t pos = 0; pos < length; ++pos) {
+            des[pos] = src[pos] ^ key[pos % key.size()];
+        }
+    }
+
+public:
+    void TestCompatibility() {
+        FileEncryption* encryption = FileEncryption::GetInstance();
+        APSARA_TEST_EQUAL(encryption->GetDefaultKeyVersion(), 1);
+        srand(0);
+        for (int32_t size = 1; size < 1200; size += (size < 100 ? 1 : 37)) {
+            const std::string data = MakeData(size);
+            char* des = NULL;
+            int32_t desLength = 0;
+            APSARA_TEST_TRUE_FATAL(encryption->Encrypt(data.data(), size, des, desLength));
+            APSARA_TEST_EQUAL(desLength, encryption->GetEncryptedLength(size));
+            APSARA_TEST_EQUAL(desLength % static_cast<int32_t>(GetKey().size()), 0);
+            APSARA_TEST_TRUE(desLength >= size && desLength < size + static_cast<int32_t>(GetKey().size()));
+            // Same as encrypted byte by byte.
+            std::string expected(size, '\0');
+            LegacyXor(data.data(), &expected[0], size, GetKey());
+            APSARA_TEST_EQUAL(std::string(des, size), expected);
+
+            std::string decrypted(size, '\0');
+            APSARA_TEST_TRUE(encryption->Decrypt(des, desLength, &decrypted[0], size, 1));
+            APSARA_TEST_EQUAL(decrypted, data);
+            // In place.
+            APSARA_TEST_TRUE(encryption->Decrypt(des, desLength, des, size, 1));
+            APSARA_TEST_EQUAL(std::string(des, size), data);
+            delete[] des;
+        }
+    }
+
+    void TestEncryptTo() {
+        FileEncryption* encryption = FileEncryption::GetInstance();
+        const std::string data = MakeData(100);
+        std::string des(encryption->GetEncryptedLength(data.size()), '\0');
+        APSARA_TEST_EQUAL(des.size(), 128UL);
+        APSARA_TEST_TRUE(encryption->EncryptTo(data.data(), data.size(), &des[0], des.size()));
+        std::string decrypted(data.size(), '\0');
+        APSARA_TEST_TRUE(encryption->Decrypt(des.data(), des.size(), &decrypted[0], decrypted.size(), 1));
+        APSARA_TEST_EQUAL(decrypted, data);
+
+        APSARA_TEST_FALSE(encryption->EncryptTo(data.data(), data.size(), &des[0], des.size() - 1));
+        APSARA_TEST_FALSE(encryption->EncryptTo(data.data(), 0, &des[0], des.size()));
+        APSARA_TEST_FALSE(encryption->EncryptTo(data.data(), data.size(), &des[0], des.size(), 100));
+        APSARA_TEST_EQUAL(encryption->GetEncryptedLength(data.size(), 100), -1);
+    }
+
+    void TestBenchmark() {
+        const size_t kDataSize = 4 * 1024 * 1024;
+        const int kRound = 16;
+        FileEncryption* encryption = FileEncryption::GetInstance();
+        const std::string data = MakeData(kDataSize);
+        std::string legacy(encryption->GetEncryptedLength(kDataSize), '\0');
+        std::string vectorized(legacy.size(), '\0');
+
+        uint64_t legacyBegin = GetCurrentTimeInMicroSeconds();
+        for (int round = 0; round < kRound; ++round) {
+            LegacyXor(data.data(), &legacy[0], kDataSize, GetKey());
+        }
+        uint64_t legacyCost = GetCurrentTimeInMicroSeconds() - legacyBegin;
+
+        uint64_t vectorizedBegin = GetCurrentTimeInMicroSeconds();
+        for (int round = 0; round < kRound; ++round) {
+            encryption->EncryptTo(data.data(), kDataSize, &vectorized[0], vectorized.size());
+        }
+        uint64_t vectorizedCost = GetCurrentTimeInMicroSeconds() - vectorizedBegin;
+
+        APSARA_TEST_EQUAL(legacy.substr(0, kDataSize), vectorized.substr(0, kDataSize));
+        double totalMB = 1.0 * kDataSize * kRound / 1024 / 1024;
+        LOG_INFO(sLogger,
+                 ("encryption benchmark, total MB", totalMB)("byte by byte MB/s", totalMB * 1000000 / (legacyCost + 1))(
+                     "vectorized MB/s", totalMB * 1000000 / (vectorizedCost + 1)));
+    }
+};
+
+UNIT_TEST_CASE(FileEncryptionUnittest, TestCompatibility);
+UNIT_TEST_CASE(FileEncryptionUnittest, TestEncryptTo);
+UNIT_TEST_CASE(FileEncryptionUnittest, TestBenchmark);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
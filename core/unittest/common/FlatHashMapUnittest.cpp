@@ -0,0 +1,122 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <memory>
+#include <unordered_map>
+#include "common/FlatHashMap.h"
+
+namespace logtail {
+
+class FlatHashMapUnittest : public ::testing::Test {
+public:
+    void TestInsertAndFind() {
+        FlatHashMap<uint32_t, int> map;
+        APSARA_TEST_TRUE(map.empty());
+        APSARA_TEST_TRUE(map.find(1) == map.end());
+        APSARA_TEST_TRUE(map.insert(std::make_pair(1U, 10)).second);
+        APSARA_TEST_FALSE(map.insert(std::make_pair(1U, 11)).second);
+        map[2] = 20;
+        APSARA_TEST_EQUAL(map.size(), 2UL);
+        APSARA_TEST_EQUAL(map.find(1)->second, 10);
+        APSARA_TEST_EQUAL(map[2], 20);
+        APSARA_TEST_EQUAL(map.count(3), 0UL);
+        APSARA_TEST_EQUAL(map[3], 0);
+        APSARA_TEST_EQUAL(map.size(), 3UL);
+    }
+
+    void TestEraseWhileIterating() {
+        FlatHashMap<uint32_t, uint32_t> map;
+        for (uint32_t i = 0; i < 1000; ++i) {
+            map[i] = i;
+        }
+        for (auto iter = map.begin(); iter != map.end();) {
+            if (iter->first % 2 == 0) {
+                iter = map.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+        APSARA_TEST_EQUAL(map.size(), 500UL);
+        size_t visited = 0;
+        for (const auto& item : map) {
+            APSARA_TEST_EQUAL_FATAL(item.first % 2, 1U);
+            APSARA_TEST_EQUAL_FATAL(item.second, item.first);
+            ++visited;
+        }
+        APSARA_TEST_EQUAL(visited, 500UL);
+        APSARA_TEST_EQUAL(map.erase(1), 1UL);
+        APSARA_TEST_EQUAL(map.erase(1), 0UL);
+        APSARA_TEST_TRUE(map.find(1) == map.end());
+    }
+
+    void TestTombstonesRehash() {
+        // insert and erase keep the size small, tombstones must not grow the table.
+        FlatHashMap<uint32_t, std::shared_ptr<int>> map;
+        std::shared_ptr<int> value = std::make_shared<int>(1);
+        for (uint32_t i = 0; i < 100000; ++i) {
+            map[i] = value;
+            if (i >= 8) {
+                APSARA_TEST_EQUAL_FATAL(map.erase(i - 8), 1UL);
+            }
+        }
+        APSARA_TEST_EQUAL(map.size(), 8UL);
+        APSARA_TEST_TRUE(map.capacity() <= 32UL);
+        // erased slots release their values.
+        APSARA_TEST_EQUAL(value.use_count(), 9L);
+        map.clear();
+        APSARA_TEST_EQUAL(value.use_count(), 1L);
+        APSARA_TEST_EQUAL(map.capacity(), 0UL);
+    }
+
+    void TestRandomAgainstUnorderedMap() {
+        FlatHashMap<uint32_t, uint32_t> map;
+        std::unordered_map<uint32_t, uint32_t> expected;
+        srand(0);
+        for (int i = 0; i < 200000; ++i) {
+            uint32_t key = rand() % 5000;
+            if (rand() % 3 == 0) {
+                APSARA_TEST_EQUAL_FATAL(map.erase(key), expected.erase(key));
+            } else {
+                map[key] = i;
+                expected[key] = i;
+            }
+        }
+        APSARA_TEST_EQUAL(map.size(), expected.size());
+        for (const auto& item : expected) {
+            auto iter = map.find(item.first);
+            APSARA_TEST_TRUE_FATAL(iter != map.end());
+            APSARA_TEST_EQUAL_FATAL(iter->second, item.second);
+        }
+    }
+
+    void TestMemoryUsage() {
+        FlatHashMap<uint32_t, void*> map;
+        size_t empty = map.GetMemoryUsage();
+        map.reserve(1000);
+        APSARA_TEST_TRUE(map.capacity() >= 2000UL);
+        APSARA_TEST_EQUAL(map.GetMemoryUsage(),
+                          empty + map.capacity() * (1 + sizeof(std::pair<uint32_t, void*>)));
+    }
+};
+
+UNIT_TEST_CASE(FlatHashMapUnittest, TestInsertAndFind);
+UNIT_TEST_CASE(FlatHashMapUnittest, TestEraseWhileIterating);
+UNIT_TEST_CASE(FlatHashMapUnittest, TestTombstonesRehash);
+UNIT_TEST_CASE(FlatHashMapUnittest, TestRandomAgainstUnorderedMap);
+UNIT_TEST_CASE(FlatHashMapUnittest, TestMemoryUsage);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
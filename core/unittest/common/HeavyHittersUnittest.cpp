@@ -0,0 +1,69 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "common/HeavyHitters.h"
+
+namespace logtail {
+
+class HeavyHittersUnittest : public ::testing::Test {
+public:
+    void TestCount() {
+        HeavyHitters heavyHitters(4);
+        APSARA_TEST_EQUAL(heavyHitters.Add(1), 1UL);
+        APSARA_TEST_EQUAL(heavyHitters.Add(1), 2UL);
+        APSARA_TEST_EQUAL(heavyHitters.Add(2, 5), 5UL);
+        APSARA_TEST_EQUAL(heavyHitters.Estimate(1), 2UL);
+        APSARA_TEST_EQUAL(heavyHitters.Estimate(2), 5UL);
+        APSARA_TEST_EQUAL(heavyHitters.Estimate(3), 0UL);
+        APSARA_TEST_EQUAL(heavyHitters.Size(), 2UL);
+        heavyHitters.Clear();
+        APSARA_TEST_EQUAL(heavyHitters.Size(), 0UL);
+        APSARA_TEST_EQUAL(heavyHitters.Estimate(1), 0UL);
+    }
+
+    void TestReplace() {
+        HeavyHitters heavyHitters(2);
+        heavyHitters.Add(1, 3);
+        heavyHitters.Add(2, 1);
+        // 3 replaces 2, the minimum, and inherits its count as error.
+        APSARA_TEST_EQUAL(heavyHitters.Add(3), 1UL);
+        APSARA_TEST_EQUAL(heavyHitters.Estimate(2), 0UL);
+        APSARA_TEST_EQUAL(heavyHitters.Estimate(3), 2UL);
+        APSARA_TEST_EQUAL(heavyHitters.Add(3), 2UL);
+        APSARA_TEST_EQUAL(heavyHitters.Estimate(1), 3UL);
+        APSARA_TEST_EQUAL(heavyHitters.Size(), 2UL);
+    }
+
+    void TestFrequentKeysTracked() {
+        HeavyHitters heavyHitters(10);
+        // Keys 0-2 take most of the stream, others appear once.
+        for (uint64_t i = 0; i < 3000; ++i) {
+            heavyHitters.Add(i % 3);
+            heavyHitters.Add(1000 + i);
+        }
+        for (uint64_t key = 0; key < 3; ++key) {
+            APSARA_TEST_TRUE(heavyHitters.Estimate(key) >= 1000UL);
+        }
+        APSARA_TEST_EQUAL(heavyHitters.Size(), 10UL);
+    }
+};
+
+UNIT_TEST_CASE(HeavyHittersUnittest, TestCount)
+UNIT_TEST_CASE(HeavyHittersUnittest, TestReplace)
+UNIT_TEST_CASE(HeavyHittersUnittest, TestFrequentKeysTracked)
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,82 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include "common/Histogram.h"
+
+namespace logtail {
+
+class HistogramUnittest : public ::testing::Test {
+public:
+    void TestBucketIndex() {
+        uint64_t lastUpperBound = 0;
+        for (size_t i = 0; i < Histogram::BUCKET_COUNT; ++i) {
+            const uint64_t upperBound = Histogram::GetBucketUpperBound(i);
+            if (i > 0) {
+                APSARA_TEST_TRUE_FATAL(upperBound > lastUpperBound);
+                APSARA_TEST_EQUAL_FATAL(Histogram::GetBucketIndex(lastUpperBound + 1), i);
+            }
+            APSARA_TEST_EQUAL_FATAL(Histogram::GetBucketIndex(upperBound), i);
+            lastUpperBound = upperBound;
+        }
+        for (uint64_t value = 0; value < 32; ++value) {
+            APSARA_TEST_EQUAL(Histogram::GetBucketUpperBound(Histogram::GetBucketIndex(value)), value);
+        }
+        APSARA_TEST_EQUAL(Histogram::GetBucketIndex(UINT64_MAX), Histogram::BUCKET_COUNT - 1);
+    }
+
+    void TestPercentile() {
+        Histogram histogram;
+        APSARA_TEST_EQUAL(histogram.GetPercentile(50), 0UL);
+        for (uint64_t value = 1; value <= 1000; ++value) {
+            histogram.Record(value);
+        }
+        APSARA_TEST_EQUAL(histogram.GetCount(), 1000UL);
+        APSARA_TEST_EQUAL(histogram.GetSum(), 500500UL);
+        APSARA_TEST_EQUAL(histogram.GetMax(), 1000UL);
+        const double percentiles[] = {50, 90, 99};
+        for (double percentile : percentiles) {
+            // Relative error is within one sub bucket.
+            const double expected = percentile * 10;
+            const double actual = static_cast<double>(histogram.GetPercentile(percentile));
+            APSARA_TEST_TRUE(actual >= expected);
+            APSARA_TEST_TRUE(actual <= expected * (1 + 1.0 / Histogram::SUB_BUCKET_COUNT));
+        }
+        APSARA_TEST_EQUAL(histogram.GetPercentile(100), 1000UL);
+    }
+
+    void TestMergeAndReset() {
+        Histogram histogram;
+        histogram.Record(10);
+        Histogram other;
+        other.Record(20);
+        other.Record(30);
+        histogram.Merge(other);
+        APSARA_TEST_EQUAL(histogram.GetCount(), 3UL);
+        APSARA_TEST_EQUAL(histogram.GetMax(), 30UL);
+        APSARA_TEST_EQUAL(histogram.ToString(), "count:3,avg:20,p50:20,p90:30,p99:30,max:30");
+        histogram.Reset();
+        APSARA_TEST_EQUAL(histogram.GetCount(), 0UL);
+        APSARA_TEST_EQUAL(histogram.ToString(), "count:0,avg:0,p50:0,p90:0,p99:0,max:0");
+    }
+};
+
+UNIT_TEST_CASE(HistogramUnittest, TestBucketIndex);
+UNIT_TEST_CASE(HistogramUnittest, TestPercentile);
+UNIT_TEST_CASE(HistogramUnittest, TestMergeAndReset);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
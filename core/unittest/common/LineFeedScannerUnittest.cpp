@@ -0,0 +1,190 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "common/LineFeedScanner.h"
+#include "common/TimeUtil.h"
+
+namespace logtail {
+
+class LineFeedScannerUnittest : public ::testing::Test {
+    // Builds a buffer which looks like single line access logs.
+    static std::string MakeLogBuffer(size_t size, size_t avgLineLength) {
+        std::string buffer;
+        buffer.reserve(size);
+        srand(0);
+        while (buffer.size() < size) {
+            size_t lineLength = avgLineLength / 2 + rand() % avgLineLength;
+            for (size_t i = 0; i < lineLength && buffer.size() < size; ++i) {
+                buffer.push_back('a' + rand() % 26);
+            }
+            if (buffer.size() < size) {
+                buffer.push_back('\n');
+            }
+        }
+        return buffer;
+    }
+
+    // Split loop before vectorization, kept here as the benchmark baseline.
+    static std::vector<int32_t> LegacySplit(char* buffer, int32_t size, int32_t& lineFeed) {
+        std::vector<int32_t> index;
+        int begIndex = 0;
+        int endIndex = 0;
+        lineFeed = 0;
+        while (endIndex < size) {
+            if (buffer[endIndex] == '\n') {
+                lineFeed++;
+                index.push_back(begIndex);
+                if (begIndex > 0) {
+                    buffer[begIndex - 1] = '\0';
+                }
+                begIndex = endIndex + 1;
+            }
+            endIndex++;
+        }
+        lineFeed++;
+        if (begIndex > 0) {
+            buffer[begIndex - 1] = '\0';
+        }
+        index.push_back(begIndex);
+        return index;
+    }
+
+    static std::vector<int32_t> BulkSplit(char* buffer, int32_t size, int32_t& lineFeed) {
+        std::vector<int32_t> index;
+        index.push_back(0);
+        lineFeed = static_cast<int32_t>(FindAllLineFeeds(buffer, size, index)) + 1;
+        for (size_t i = 1; i < index.size(); ++i) {
+            buffer[index[i]] = '\0';
+            ++index[i];
+        }
+        return index;
+    }
+
+public:
+    void TestFindLineFeed() {
+        LOG_INFO(sLogger, ("line feed scanner", GetLineFeedScannerName()));
+        std::string buffer = MakeLogBuffer(4096, 20);
+        const char* end = buffer.data() + buffer.size();
+        // Unaligned begin/end to cover vector body and scalar tail.
+        for (size_t offset = 0; offset < 64; ++offset) {
+            const char* begin = buffer.data() + offset;
+            for (size_t tail = 0; tail < 64; tail += 7) {
+                APSARA_TEST_TRUE(FindLineFeed(begin, end - tail) == FindLineFeedScalar(begin, end - tail));
+            }
+        }
+        std::string noLineFeed(100, 'x');
+        const char* noLineFeedEnd = noLineFeed.data() + noLineFeed.size();
+        APSARA_TEST_TRUE(FindLineFeed(noLineFeed.data(), noLineFeedEnd) == noLineFeedEnd);
+        APSARA_TEST_TRUE(FindLineFeed(noLineFeed.data(), noLineFeed.data()) == noLineFeed.data());
+    }
+
+    void TestFindLastLineFeed() {
+        std::string buffer = MakeLogBuffer(4096, 20);
+        const char* end = buffer.data() + buffer.size();
+        for (size_t offset = 0; offset < 64; ++offset) {
+            const char* begin = buffer.data() + offset;
+            for (size_t tail = 0; tail < 64; tail += 7) {
+                APSARA_TEST_TRUE(FindLastLineFeed(begin, end - tail) == FindLastLineFeedScalar(begin, end - tail));
+            }
+        }
+        // Line feed only at the beginning, found by the scalar head after vector blocks.
+        std::string head = "\n" + std::string(100, 'x');
+        APSARA_TEST_TRUE(FindLastLineFeed(head.data(), head.data() + head.size()) == head.data());
+        std::string noLineFeed(100, 'x');
+        const char* noLineFeedEnd = noLineFeed.data() + noLineFeed.size();
+        APSARA_TEST_TRUE(FindLastLineFeed(noLineFeed.data(), noLineFeedEnd) == noLineFeedEnd);
+        APSARA_TEST_TRUE(FindLastLineFeed(noLineFeed.data(), noLineFeed.data()) == noLineFeed.data());
+    }
+
+    void TestFindAllLineFeeds() {
+        for (size_t size : {0, 1, 15, 16, 17, 31, 32, 33, 1000, 65536}) {
+            std::string buffer = MakeLogBuffer(size, 10);
+            std::vector<int32_t> expected;
+            std::vector<int32_t> result;
+            APSARA_TEST_EQUAL(FindAllLineFeeds(buffer.data(), buffer.size(), result),
+                              FindAllLineFeedsScalar(buffer.data(), buffer.size(), expected));
+            APSARA_TEST_TRUE(expected == result);
+        }
+        // Every byte is a line feed.
+        std::string allLineFeed(100, '\n');
+        std::vector<int32_t> result;
+        APSARA_TEST_EQUAL(FindAllLineFeeds(allLineFeed.data(), allLineFeed.size(), result), 100UL);
+        for (int32_t i = 0; i < 100; ++i) {
+            APSARA_TEST_EQUAL(result[i], i);
+        }
+        // Appending keeps existing items.
+        std::vector<int32_t> appended{-1};
+        FindAllLineFeeds("a\nb\n", 4, appended);
+        APSARA_TEST_TRUE(appended == std::vector<int32_t>({-1, 1, 3}));
+    }
+
+    void TestSplitEquivalence() {
+        std::string origin = MakeLogBuffer(100 * 1024, 100);
+        // Reader terminates the buffer instead of the last line feed.
+        origin[origin.size() - 1] = '\0';
+        std::string legacyBuffer = origin;
+        std::string bulkBuffer = origin;
+        int32_t legacyLineFeed = 0;
+        int32_t bulkLineFeed = 0;
+        auto legacyIndex = LegacySplit(&legacyBuffer[0], legacyBuffer.size(), legacyLineFeed);
+        auto bulkIndex = BulkSplit(&bulkBuffer[0], bulkBuffer.size(), bulkLineFeed);
+        APSARA_TEST_EQUAL(legacyLineFeed, bulkLineFeed);
+        APSARA_TEST_TRUE(legacyIndex == bulkIndex);
+        APSARA_TEST_TRUE(legacyBuffer == bulkBuffer);
+    }
+
+    void TestBenchmark() {
+        const size_t kBufferSize = 512 * 1024;
+        const int kRound = 200;
+        std::string origin = MakeLogBuffer(kBufferSize, 200);
+        std::string buffer;
+        int32_t lineFeed = 0;
+        size_t lines = 0;
+
+        uint64_t legacyBegin = GetCurrentTimeInMicroSeconds();
+        for (int round = 0; round < kRound; ++round) {
+            buffer = origin;
+            lines += LegacySplit(&buffer[0], buffer.size(), lineFeed).size();
+        }
+        uint64_t legacyCost = GetCurrentTimeInMicroSeconds() - legacyBegin;
+
+        uint64_t bulkBegin = GetCurrentTimeInMicroSeconds();
+        for (int round = 0; round < kRound; ++round) {
+            buffer = origin;
+            lines -= BulkSplit(&buffer[0], buffer.size(), lineFeed).size();
+        }
+        uint64_t bulkCost = GetCurrentTimeInMicroSeconds() - bulkBegin;
+
+        APSARA_TEST_EQUAL(lines, 0UL);
+        double totalMB = 1.0 * kBufferSize * kRound / 1024 / 1024;
+        LOG_INFO(sLogger,
+                 ("split benchmark, scanner", GetLineFeedScannerName())("total MB", totalMB)(
+                     "scalar MB/s", totalMB * 1000000 / (legacyCost + 1))("vectorized MB/s",
+                                                                          totalMB * 1000000 / (bulkCost + 1)));
+    }
+};
+
+UNIT_TEST_CASE(LineFeedScannerUnittest, TestFindLineFeed);
+UNIT_TEST_CASE(LineFeedScannerUnittest, TestFindLastLineFeed);
+UNIT_TEST_CASE(LineFeedScannerUnittest, TestFindAllLineFeeds);
+UNIT_TEST_CASE(LineFeedScannerUnittest, TestSplitEquivalence);
+UNIT_TEST_CASE(LineFeedScannerUnittest, TestBenchmark);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,66 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "common/LogFileCollectOffsetIndicator.h"
+
+namespace logtail {
+
+class LogFileOffsetInfoUnittest : public ::testing::Test {
+public:
+    static LogFileOffsetInfoNode MakeNode(int64_t seq) { return LogFileOffsetInfoNode(seq, seq * 100, 100, 0, 0, 0); }
+
+    void TestCalcOffset() {
+        LogFileInfo info("project", "logstore", "config", "/tmp/a.log", DevInode(1, 2), true);
+        LogFileOffsetInfo offsetInfo(info, -1, 0);
+        int64_t offset = -1, len = -1, filePos = 0, readPos = 0, size = 0;
+        APSARA_TEST_FALSE(offsetInfo.CalcOffset(offset, len, filePos, readPos, size));
+
+        // Nodes might be recorded out of order.
+        for (int64_t seq : {1, 2, 4, 3, 5}) {
+            offsetInfo.AddNode(MakeNode(seq));
+        }
+        offsetInfo.SetSendFlag(2);
+        offsetInfo.SetSendFlag(4);
+        APSARA_TEST_TRUE(offsetInfo.CalcOffset(offset, len, filePos, readPos, size));
+        // Node 1 is not sent, nothing is advanced.
+        APSARA_TEST_EQUAL(offset, -1);
+        APSARA_TEST_EQUAL(offsetInfo.mLogFileOffsetInfoNodes.size(), 5UL);
+
+        offsetInfo.SetSendFlag(1);
+        offsetInfo.SetSendFlag(3);
+        APSARA_TEST_TRUE(offsetInfo.CalcOffset(offset, len, filePos, readPos, size));
+        APSARA_TEST_EQUAL(offset, 400);
+        APSARA_TEST_EQUAL(len, 100);
+        APSARA_TEST_EQUAL(offsetInfo.mLogFileOffsetInfoNodes.size(), 1UL);
+        APSARA_TEST_EQUAL(offsetInfo.mLogFileOffsetInfoNodes.begin()->first, 5);
+    }
+
+    void TestLogFileInfoKey() {
+        LogFileInfo a("project", "logstore", "config", "/tmp/a.log", DevInode(1, 2), false);
+        LogFileInfo b(std::string("project"), std::string("logstore"), "config", "/tmp/a.log", DevInode(3, 4), true);
+        LogFileInfo c("project", "logstore", "config", "/tmp/b.log", DevInode(1, 2), false);
+        APSARA_TEST_TRUE(a == b);
+        APSARA_TEST_EQUAL(LogFileInfo::LogFileInfoHash()(a), LogFileInfo::LogFileInfoHash()(b));
+        APSARA_TEST_FALSE(a == c);
+        APSARA_TEST_EQUAL(a.ToString(), "project_logstore_config_/tmp/a.log_1_2");
+    }
+};
+
+UNIT_TEST_CASE(LogFileOffsetInfoUnittest, TestCalcOffset);
+UNIT_TEST_CASE(LogFileOffsetInfoUnittest, TestLogFileInfoKey);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
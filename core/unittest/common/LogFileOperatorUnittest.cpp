@@ -15,6 +15,7 @@
 #include "unittest/Unittest.h"
 #include <string>
 #include <cstdlib>
+#include <algorithm>
 #if defined(__linux__)
 #include <unistd.h>
 #endif
@@ -46,6 +47,7 @@ public:
     void TestSeek();
     void TestStat();
     void TestPread();
+    void TestMmapPread();
     void TestSkipHoleRead();
     void TestTell();
     void TestClose();
@@ -61,6 +63,7 @@ APSARA_UNIT_TEST_CASE(LogFileOperatorUnittest, TestSkipHoleRead, 5);
 APSARA_UNIT_TEST_CASE(LogFileOperatorUnittest, TestTell, 6);
 APSARA_UNIT_TEST_CASE(LogFileOperatorUnittest, TestClose, 7);
 APSARA_UNIT_TEST_CASE(LogFileOperatorUnittest, TestFuseTruncate, 8);
+APSARA_UNIT_TEST_CASE(LogFileOperatorUnittest, TestMmapPread, 9);
 
 std::string LogFileOperatorUnittest::gRootDir = "";
 
@@ -349,6 +352,39 @@ void LogFileOperatorUnittest::TestPread() {
     delete[] buf;
 }
 
+void LogFileOperatorUnittest::TestMmapPread() {
+#if defined(__linux__)
+    std::string file = gRootDir + PATH_SEPARATOR + gTestFile;
+    std::string logData = GenerateData(10240, 9);
+    FILE* pFile = fopen(file.c_str(), "wb");
+    fwrite(logData.c_str(), 1, logData.size(), pFile);
+    fclose(pFile);
+
+    LogFileOperator logFileOp;
+    // Small window to cover remapping and reads across windows.
+    APSARA_TEST_TRUE(logFileOp.EnableMmapRead(8192));
+    logFileOp.Open(file.c_str());
+    APSARA_TEST_EQUAL(logFileOp.IsOpen(), true);
+
+    const size_t kReadSize = 3000;
+    std::string buf(kReadSize, '\0');
+    for (size_t offset = 0; offset < logData.size(); offset += 1234) {
+        int bytes = logFileOp.Pread(&buf[0], 1, kReadSize, offset);
+        size_t expected = std::min(kReadSize, logData.size() - offset);
+        APSARA_TEST_EQUAL(static_cast<size_t>(bytes), expected);
+        APSARA_TEST_TRUE(buf.compare(0, expected, logData, offset, expected) == 0);
+    }
+    // Read backward to a previous window.
+    int bytes = logFileOp.Pread(&buf[0], 1, kReadSize, 0);
+    APSARA_TEST_EQUAL(static_cast<size_t>(bytes), kReadSize);
+    APSARA_TEST_TRUE(buf.compare(0, kReadSize, logData, 0, kReadSize) == 0);
+    APSARA_TEST_EQUAL(logFileOp.Pread(&buf[0], 1, kReadSize, logData.size()), 0);
+
+    logFileOp.Close();
+    APSARA_TEST_TRUE(logFileOp.mMapAddr == NULL);
+#endif
+}
+
 void LogFileOperatorUnittest::TestSkipHoleRead() {
 #if defined(ENABLE_FUSE)
     int mainVersion = 0, subVersion = 0;
@@ -0,0 +1,126 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <vector>
+#include "common/LogstoreFeedbackQueue.h"
+#include "common/ShardedLogstoreFeedbackQueue.h"
+
+namespace logtail {
+
+class MockFeedBack : public LogstoreFeedBackInterface {
+public:
+    void FeedBack(const LogstoreFeedBackKey& key) override { feedBackKeys.push_back(key); }
+    bool IsValidToPush(const LogstoreFeedBackKey& key) override { return true; }
+
+    std::vector<LogstoreFeedBackKey> feedBackKeys;
+};
+
+class LogstoreFeedbackQueueUnittest : public ::testing::Test {
+public:
+    void TestCheckAndPopNextItems() {
+        MockFeedBack feedBack;
+        LogstoreFeedbackQueue<int> queue;
+        queue.SetFeedBackObject(&feedBack);
+        // Default param: high size 20, low size 10.
+        for (int i = 0; i < 20; ++i) {
+            APSARA_TEST_TRUE(queue.PushItem(1, i));
+        }
+        APSARA_TEST_TRUE(queue.PushItem(2, 100));
+        APSARA_TEST_FALSE(queue.IsValid(1));
+
+        LogstoreFeedBackKey key = 0;
+        std::vector<int> items;
+        // Items are popped from one logstore in order.
+        std::vector<int> popped;
+        size_t popCount = 0;
+        while (queue.CheckAndPopNextItems(key, items, 8, &feedBack, 0, 1)) {
+            APSARA_TEST_TRUE(items.size() <= 8UL);
+            if (key == 1) {
+                popped.insert(popped.end(), items.begin(), items.end());
+            } else {
+                APSARA_TEST_EQUAL(key, 2);
+                APSARA_TEST_TRUE(items == std::vector<int>({100}));
+            }
+            ++popCount;
+        }
+        APSARA_TEST_TRUE(items.empty());
+        APSARA_TEST_EQUAL(popCount, 4UL);
+        APSARA_TEST_EQUAL(popped.size(), 20UL);
+        for (int i = 0; i < 20; ++i) {
+            APSARA_TEST_EQUAL(popped[i], i);
+        }
+        // Queue 1 becomes valid again in a batch, feedback once.
+        APSARA_TEST_TRUE(queue.IsValid(1));
+        APSARA_TEST_TRUE(feedBack.feedBackKeys == std::vector<LogstoreFeedBackKey>({1}));
+    }
+
+    void TestCpuQuotaTable() {
+        CpuQuotaTable quotas;
+        APSARA_TEST_TRUE(quotas.Empty());
+        quotas.Charge(1, 2000000000ULL, 1000);
+        APSARA_TEST_FALSE(quotas.IsExceeded(1, 1000));
+
+        // 10% of one core, debt of 2s is paid back to quota of one second (0.1s) after 19s.
+        quotas.Set(1, 10);
+        APSARA_TEST_FALSE(quotas.Empty());
+        quotas.Charge(1, 2000000000ULL, 1000);
+        APSARA_TEST_TRUE(quotas.IsExceeded(1, 1000));
+        APSARA_TEST_TRUE(quotas.IsExceeded(1, 19999));
+        APSARA_TEST_FALSE(quotas.IsExceeded(1, 20000));
+        APSARA_TEST_FALSE(quotas.IsExceeded(2, 1000));
+        APSARA_TEST_EQUAL(quotas.GetThrottledCount(), 2UL);
+        APSARA_TEST_EQUAL(quotas.GetThrottledCount(), 0UL);
+
+        quotas.Charge(1, 2000000000ULL, 20000);
+        quotas.Set(1, 0);
+        APSARA_TEST_TRUE(quotas.Empty());
+        APSARA_TEST_FALSE(quotas.IsExceeded(1, 20000));
+    }
+
+    template <class Queue>
+    void CheckCpuQuotaPop(Queue& queue) {
+        MockFeedBack feedBack;
+        APSARA_TEST_TRUE(queue.PushItem(1, 1));
+        APSARA_TEST_TRUE(queue.PushItem(2, 2));
+        queue.GetCpuQuotas().Set(1, 10);
+        queue.GetCpuQuotas().Charge(1, 2000000000ULL, GetSteadyTimeInMilliSeconds());
+
+        // Queue 1 is skipped until its debt is paid back.
+        LogstoreFeedBackKey key = 0;
+        std::vector<int> items;
+        APSARA_TEST_TRUE(queue.CheckAndPopNextItems(key, items, 8, &feedBack, 0, 1));
+        APSARA_TEST_TRUE(items == std::vector<int>({2}));
+        APSARA_TEST_FALSE(queue.CheckAndPopNextItems(key, items, 8, &feedBack, 0, 1));
+
+        queue.GetCpuQuotas().Set(1, 0);
+        APSARA_TEST_TRUE(queue.CheckAndPopNextItems(key, items, 8, &feedBack, 0, 1));
+        APSARA_TEST_TRUE(items == std::vector<int>({1}));
+    }
+
+    void TestCpuQuotaPop() {
+        LogstoreFeedbackQueue<int> queue;
+        CheckCpuQuotaPop(queue);
+        ShardedLogstoreFeedbackQueue<int> shardedQueue;
+        CheckCpuQuotaPop(shardedQueue);
+    }
+};
+
+UNIT_TEST_CASE(LogstoreFeedbackQueueUnittest, TestCheckAndPopNextItems);
+UNIT_TEST_CASE(LogstoreFeedbackQueueUnittest, TestCpuQuotaTable);
+UNIT_TEST_CASE(LogstoreFeedbackQueueUnittest, TestCpuQuotaPop);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,97 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "common/MemoryBudget.h"
+#include "common/LogstoreSenderQueue.h"
+#include "sender/SenderQueueParam.h"
+
+DECLARE_FLAG_INT32(sender_queue_memory_budget_mb);
+DECLARE_FLAG_INT32(process_queue_memory_budget_mb);
+
+namespace logtail {
+
+class MemoryBudgetUnittest : public ::testing::Test {
+public:
+    void TearDown() override {
+        INT32_FLAG(sender_queue_memory_budget_mb) = 0;
+        INT32_FLAG(process_queue_memory_budget_mb) = 0;
+    }
+
+    void TestOverBudget() {
+        const int64_t kMb = 1024 * 1024;
+        const int64_t usage = MemoryBudget::GetUsage(MEMORY_COMPONENT_PROCESS_QUEUE);
+        // Unlimited by default.
+        MemoryBudget::Add(MEMORY_COMPONENT_PROCESS_QUEUE, 2 * kMb);
+        APSARA_TEST_EQUAL(MemoryBudget::GetUsage(MEMORY_COMPONENT_PROCESS_QUEUE), usage + 2 * kMb);
+        APSARA_TEST_FALSE(MemoryBudget::IsOverBudget(MEMORY_COMPONENT_PROCESS_QUEUE));
+        APSARA_TEST_FALSE(MemoryBudget::IsReadBlocked());
+
+        INT32_FLAG(process_queue_memory_budget_mb) = 3;
+        APSARA_TEST_EQUAL(MemoryBudget::GetBudget(MEMORY_COMPONENT_PROCESS_QUEUE), 3 * kMb);
+        APSARA_TEST_FALSE(MemoryBudget::IsOverBudget(MEMORY_COMPONENT_PROCESS_QUEUE));
+        MemoryBudget::Add(MEMORY_COMPONENT_PROCESS_QUEUE, kMb - usage);
+        APSARA_TEST_TRUE(MemoryBudget::IsOverBudget(MEMORY_COMPONENT_PROCESS_QUEUE));
+        APSARA_TEST_TRUE(MemoryBudget::IsReadBlocked());
+        APSARA_TEST_FALSE(MemoryBudget::IsSendBlocked());
+
+        MemoryBudget::Sub(MEMORY_COMPONENT_PROCESS_QUEUE, 3 * kMb - usage);
+        APSARA_TEST_EQUAL(MemoryBudget::GetUsage(MEMORY_COMPONENT_PROCESS_QUEUE), usage);
+        APSARA_TEST_FALSE(MemoryBudget::IsReadBlocked());
+    }
+
+    void TestSenderQueueBackPressure() {
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        const LogstoreFeedBackKey kFbKey = 0;
+        const int64_t usage = MemoryBudget::GetUsage(MEMORY_COMPONENT_SENDER_QUEUE);
+        auto data = new LoggroupTimeValue();
+        data->mLogstoreKey = kFbKey;
+        data->mLogData.assign(1024 * 1024, 'a');
+        APSARA_TEST_TRUE(senderQueue.PushItem(kFbKey, data));
+        APSARA_TEST_TRUE(data->mQueuedBytes >= 1024 * 1024 + sizeof(LoggroupTimeValue));
+        APSARA_TEST_EQUAL(MemoryBudget::GetUsage(MEMORY_COMPONENT_SENDER_QUEUE),
+                          usage + static_cast<int64_t>(data->mQueuedBytes));
+        APSARA_TEST_TRUE(senderQueue.IsValidToPush(kFbKey));
+
+        INT32_FLAG(sender_queue_memory_budget_mb) = 1;
+        APSARA_TEST_TRUE(MemoryBudget::IsSendBlocked());
+        APSARA_TEST_FALSE(senderQueue.IsValidToPush(kFbKey));
+        // Urgent flag is set before exit, data has to be flushed out regardless of budget.
+        senderQueue.SetUrgent();
+        APSARA_TEST_TRUE(senderQueue.IsValidToPush(kFbKey));
+        senderQueue.ResetUrgent();
+
+        senderQueue.OnLoggroupSendDone(data, LogstoreSenderInfo::SendResult_OK);
+        APSARA_TEST_EQUAL(MemoryBudget::GetUsage(MEMORY_COMPONENT_SENDER_QUEUE), usage);
+        APSARA_TEST_TRUE(senderQueue.IsValidToPush(kFbKey));
+    }
+
+    void TestSenderQueueShrinkLogData() {
+        LoggroupTimeValue data;
+        data.mLogData.reserve(1024 * 1024);
+        data.mLogData.assign(1024, 'a');
+        data.ShrinkLogData();
+        APSARA_TEST_TRUE(data.mLogData.capacity() < 1024 * 1024);
+        APSARA_TEST_EQUAL(data.mLogData, std::string(1024, 'a'));
+        APSARA_TEST_TRUE(data.MemoryUsage() >= sizeof(LoggroupTimeValue) + 1024);
+    }
+};
+
+UNIT_TEST_CASE(MemoryBudgetUnittest, TestOverBudget);
+UNIT_TEST_CASE(MemoryBudgetUnittest, TestSenderQueueBackPressure);
+UNIT_TEST_CASE(MemoryBudgetUnittest, TestSenderQueueShrinkLogData);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,88 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include <string>
+#include <thread>
+#include <vector>
+#include "common/MpscRingQueue.h"
+
+namespace logtail {
+
+class MpscRingQueueUnittest : public ::testing::Test {
+public:
+    void TestPushPop() {
+        MpscRingQueue<std::string> queue(3);
+        APSARA_TEST_EQUAL(queue.Capacity(), 4UL);
+        std::string item;
+        APSARA_TEST_FALSE(queue.TryPop(item));
+        for (int i = 0; i < 4; ++i) {
+            APSARA_TEST_TRUE(queue.TryPush(std::to_string(i)));
+        }
+        std::string full = "full";
+        APSARA_TEST_FALSE(queue.TryPush(std::move(full)));
+        APSARA_TEST_EQUAL(full, "full");
+        for (int round = 0; round < 3; ++round) {
+            for (int i = 0; i < 4; ++i) {
+                APSARA_TEST_TRUE(queue.TryPop(item));
+                APSARA_TEST_EQUAL(item, std::to_string(round * 4 + i));
+                APSARA_TEST_TRUE(queue.TryPush(std::to_string((round + 1) * 4 + i)));
+            }
+        }
+    }
+
+    void TestMultipleProducers() {
+        const int kProducerCount = 4;
+        const int kItemCount = 10000;
+        MpscRingQueue<int> queue(64);
+        std::vector<std::thread> producers;
+        for (int p = 0; p < kProducerCount; ++p) {
+            producers.emplace_back([&queue, p, kItemCount]() {
+                for (int i = 0; i < kItemCount; ++i) {
+                    int item = p * kItemCount + i;
+                    while (!queue.TryPush(std::move(item))) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        // Items of the same producer are popped in order.
+        std::vector<int> next(kProducerCount, 0);
+        int popped = 0;
+        while (popped < kProducerCount * kItemCount) {
+            int item = 0;
+            if (!queue.TryPop(item)) {
+                std::this_thread::yield();
+                continue;
+            }
+            int p = item / kItemCount;
+            APSARA_TEST_EQUAL_FATAL(item % kItemCount, next[p]);
+            ++next[p];
+            ++popped;
+        }
+        for (auto& producer : producers) {
+            producer.join();
+        }
+        int item = 0;
+        APSARA_TEST_FALSE(queue.TryPop(item));
+    }
+};
+
+UNIT_TEST_CASE(MpscRingQueueUnittest, TestPushPop);
+UNIT_TEST_CASE(MpscRingQueueUnittest, TestMultipleProducers);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,109 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "common/PathTrie.h"
+
+namespace logtail {
+
+class PathTrieUnittest : public ::testing::Test {
+public:
+    void TestFindAndErase() {
+        PathTrie trie('/');
+        trie.Insert("/a/b", 1);
+        trie.Insert("/a/b/c", 2);
+        trie.Insert("/a/bc", 3);
+        int value = 0;
+        APSARA_TEST_TRUE(trie.Find("/a/b", value));
+        APSARA_TEST_EQUAL(value, 1);
+        // Nodes without value are not paths.
+        APSARA_TEST_FALSE(trie.Find("/a", value));
+        APSARA_TEST_FALSE(trie.Find("/a/b/", value));
+        APSARA_TEST_FALSE(trie.Find("a/b", value));
+        trie.Insert("/a/b", 4);
+        APSARA_TEST_TRUE(trie.Find("/a/b", value));
+        APSARA_TEST_EQUAL(value, 4);
+        APSARA_TEST_EQUAL(trie.Size(), 3UL);
+
+        APSARA_TEST_TRUE(trie.Erase("/a/b"));
+        APSARA_TEST_FALSE(trie.Erase("/a/b"));
+        APSARA_TEST_FALSE(trie.Find("/a/b", value));
+        APSARA_TEST_TRUE(trie.Find("/a/b/c", value));
+        APSARA_TEST_TRUE(trie.Erase("/a/b/c"));
+        APSARA_TEST_TRUE(trie.Find("/a/bc", value));
+        APSARA_TEST_EQUAL(trie.Size(), 1UL);
+        trie.Clear();
+        APSARA_TEST_EQUAL(trie.Size(), 0UL);
+        APSARA_TEST_FALSE(trie.Find("/a/bc", value));
+    }
+
+    void TestSubtree() {
+        PathTrie trie('/');
+        trie.Insert("/base0/1", 1);
+        trie.Insert("/base0/2", 2);
+        trie.Insert("/base1/log", 3);
+        trie.Insert("/base1/log/4", 4);
+        trie.Insert("/", 5);
+        std::vector<std::pair<std::string, int> > result;
+        // A prefix of a dir name is not a parent.
+        trie.FindSubtree("/base", result);
+        APSARA_TEST_TRUE(result.empty());
+        trie.FindSubtree("/base0/", result);
+        APSARA_TEST_TRUE(result.empty());
+        trie.FindSubtree("/base0", result);
+        std::sort(result.begin(), result.end());
+        APSARA_TEST_TRUE(result == (std::vector<std::pair<std::string, int> >{{"/base0/1", 1}, {"/base0/2", 2}}));
+        result.clear();
+        trie.FindSubtree("/base1/log", result);
+        std::sort(result.begin(), result.end());
+        APSARA_TEST_TRUE(result
+                         == (std::vector<std::pair<std::string, int> >{{"/base1/log", 3}, {"/base1/log/4", 4}}));
+        result.clear();
+        trie.FindSubtree("/", result);
+        APSARA_TEST_TRUE(result == (std::vector<std::pair<std::string, int> >{{"/", 5}}));
+
+        std::vector<std::pair<std::string, int> > all;
+        trie.ForEach([&all](const std::string& path, int value) { all.emplace_back(path, value); });
+        APSARA_TEST_EQUAL(all.size(), 5UL);
+        APSARA_TEST_TRUE(std::find(all.begin(), all.end(), std::make_pair(std::string("/base1/log/4"), 4))
+                         != all.end());
+    }
+
+    void TestAncestors() {
+        PathTrie trie('/');
+        trie.Insert("/a", 1);
+        trie.Insert("/a/b/c", 3);
+        trie.Insert("/a/b/c/d", 4);
+        std::vector<int> values;
+        trie.FindAncestors("/a/b/c/d", values);
+        // Stops at /a/b which is not registered.
+        APSARA_TEST_TRUE(values == std::vector<int>({4, 3}));
+        values.clear();
+        trie.FindAncestors("/a/b", values);
+        APSARA_TEST_TRUE(values.empty());
+    }
+};
+
+UNIT_TEST_CASE(PathTrieUnittest, TestFindAndErase);
+UNIT_TEST_CASE(PathTrieUnittest, TestSubtree);
+UNIT_TEST_CASE(PathTrieUnittest, TestAncestors);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -13,7 +13,13 @@
 // limitations under the License.
 
 #include "unittest/Unittest.h"
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "common/LogstoreFeedbackKey.h"
+#include "common/LogstoreFeedbackQueue.h"
+#include "common/ShardedLogstoreFeedbackQueue.h"
+#include "common/TimeUtil.h"
 #include "common/Flags.h"
 #include "processor/LogProcess.h"
 #include "sender/Sender.h"
@@ -48,10 +54,13 @@ public:
     void TestInitializeExactlyOnceQueues();
 
     void TestMarkGC();
+
+    void TestFeedbackQueueContention();
 };
 
 UNIT_TEST_CASE(QueueManagerUnittest, TestInitializeExactlyOnceQueues);
 UNIT_TEST_CASE(QueueManagerUnittest, TestMarkGC);
+UNIT_TEST_CASE(QueueManagerUnittest, TestFeedbackQueueContention);
 
 decltype(QueueManagerUnittest::sProcessQueueMap) QueueManagerUnittest::sProcessQueueMap = nullptr;
 decltype(QueueManagerUnittest::sSenderQueueMap) QueueManagerUnittest::sSenderQueueMap = nullptr;
@@ -206,6 +215,87 @@ void QueueManagerUnittest::TestMarkGC() {
     INT32_FLAG(logtail_queue_gc_threshold_sec) = bakThreshold;
 }
 
+namespace {
+
+    class AlwaysValidFeedBack : public LogstoreFeedBackInterface {
+    public:
+        void FeedBack(const LogstoreFeedBackKey& key) override {}
+        bool IsValidToPush(const LogstoreFeedBackKey& key) override { return true; }
+    };
+
+    // Producers push items to their own logstores, consumers pop them in batch,
+    // @return cost in microseconds, or 0 if some items are lost.
+    template <class Queue>
+    uint64_t RunFeedbackQueueContention(
+        Queue& queue, int32_t producerCount, int32_t consumerCount, int32_t keyCount, int32_t itemPerProducer) {
+        AlwaysValidFeedBack checker;
+        queue.SetFeedBackObject(&checker);
+        const int64_t total = static_cast<int64_t>(producerCount) * itemPerProducer;
+        std::atomic<int64_t> popped{0};
+        std::atomic<int64_t> sum{0};
+
+        uint64_t begin = GetCurrentTimeInMicroSeconds();
+        std::vector<std::thread> threads;
+        for (int32_t p = 0; p < producerCount; ++p) {
+            threads.emplace_back([&, p]() {
+                for (int32_t i = 0; i < itemPerProducer; ++i) {
+                    LogstoreFeedBackKey key = (p * keyCount / producerCount) + i % (keyCount / producerCount);
+                    while (!queue.PushItem(key, 1)) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (int32_t c = 0; c < consumerCount; ++c) {
+            threads.emplace_back([&, c]() {
+                LogstoreFeedBackKey startKey = 0;
+                std::vector<int> items;
+                while (popped.load() < total) {
+                    if (!queue.CheckAndPopNextItems(startKey, items, 8, &checker, c, consumerCount)) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    for (auto item : items) {
+                        sum += item;
+                    }
+                    popped += items.size();
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        uint64_t cost = GetCurrentTimeInMicroSeconds() - begin;
+        return sum.load() == total ? cost + 1 : 0;
+    }
+
+} // namespace
+
+void QueueManagerUnittest::TestFeedbackQueueContention() {
+    const int32_t kProducerCount = 4;
+    const int32_t kConsumerCount = 8;
+    const int32_t kKeyCount = 16;
+    const int32_t kItemPerProducer = 200000;
+
+    LogstoreFeedbackQueue<int, LogstoreFeedbackQueueParam> mutexQueue;
+    uint64_t mutexCost
+        = RunFeedbackQueueContention(mutexQueue, kProducerCount, kConsumerCount, kKeyCount, kItemPerProducer);
+    ShardedLogstoreFeedbackQueue<int, LogstoreFeedbackQueueParam> shardedQueue;
+    uint64_t shardedCost
+        = RunFeedbackQueueContention(shardedQueue, kProducerCount, kConsumerCount, kKeyCount, kItemPerProducer);
+    APSARA_TEST_TRUE(mutexCost > 0);
+    APSARA_TEST_TRUE(shardedCost > 0);
+    APSARA_TEST_TRUE(mutexQueue.IsEmpty());
+    APSARA_TEST_TRUE(shardedQueue.IsEmpty());
+
+    double totalItems = 1.0 * kProducerCount * kItemPerProducer;
+    LOG_INFO(sLogger,
+             ("feedback queue contention, producers", kProducerCount)("consumers", kConsumerCount)("logstores",
+                                                                                                   kKeyCount)(
+                 "mutex queue items/s", totalItems * 1000000 / mutexCost)("sharded queue items/s",
+                                                                          totalItems * 1000000 / shardedCost));
+}
+
 } // namespace logtail
 
 UNIT_TEST_MAIN
\ No newline at end of file
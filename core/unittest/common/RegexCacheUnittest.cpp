@@ -0,0 +1,71 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <string>
+#include <vector>
+#include "common/RegexCache.h"
+
+namespace logtail {
+
+class RegexCacheUnittest : public ::testing::Test {
+public:
+    void TestShared() {
+        RegexCache cache;
+        RegexPtr a = cache.Get("\\d+ \\w+");
+        RegexPtr b = cache.Get("\\d+ \\w+");
+        APSARA_TEST_TRUE(a == b);
+        APSARA_TEST_TRUE(boost::regex_match("12 ab", *a));
+        // Flags are part of the key.
+        RegexPtr c = cache.Get("\\d+ \\w+", boost::regex::icase);
+        APSARA_TEST_TRUE(a != c);
+        APSARA_TEST_EQUAL(cache.Size(), 2UL);
+    }
+
+    void TestReleased() {
+        RegexCache cache;
+        cache.Get("abc");
+        // Compiled again after the last user is gone.
+        RegexPtr b = cache.Get("abc");
+        APSARA_TEST_TRUE(b != nullptr);
+        APSARA_TEST_TRUE(boost::regex_match("abc", *b));
+
+        // Released entries are purged as the cache grows.
+        b.reset();
+        for (int i = 0; i < 200; ++i) {
+            cache.Get("pattern" + std::to_string(i));
+        }
+        APSARA_TEST_TRUE(cache.Size() < 200UL);
+    }
+
+    void TestInvalidPattern() {
+        RegexCache cache;
+        bool thrown = false;
+        try {
+            cache.Get("(abc");
+        } catch (const boost::regex_error&) {
+            thrown = true;
+        }
+        APSARA_TEST_TRUE(thrown);
+        APSARA_TEST_EQUAL(cache.Size(), 0UL);
+    }
+};
+
+UNIT_TEST_CASE(RegexCacheUnittest, TestShared);
+UNIT_TEST_CASE(RegexCacheUnittest, TestReleased);
+UNIT_TEST_CASE(RegexCacheUnittest, TestInvalidPattern);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,108 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <boost/regex.hpp>
+#include "common/RegexPrefixFilter.h"
+
+namespace logtail {
+
+class RegexPrefixFilterUnittest : public ::testing::Test {
+public:
+    void TestPrefixLength() {
+        struct Case {
+            std::string regex;
+            size_t prefixLength;
+        };
+        std::vector<Case> cases = {
+            {"^\\d{4}-\\d{2}-\\d{2}.*", 10},
+            {"^\\[", 1},
+            {"\\[\\d+\\].*", 2},
+            {"^[A-Z][a-z]+ \\d+.*", 2},
+            {"abc*d.*", 2},
+            {"x{2,3}y.*", 2},
+            {"\\d{2,2}:.*", 3},
+            {"^\\tat.*", 3},
+            {"[]a]b.*", 2},
+            {"^2023(?i)abc.*", 4},
+            // No useful prefix.
+            {"", 0},
+            {".*", 0},
+            {"(a|b).*", 0},
+            {"a.*|b.*", 0},
+            {"^\\x41.*", 0},
+            {"\\s*.*", 0},
+        };
+        for (auto& c : cases) {
+            auto filter = RegexPrefixFilter::Create(c.regex);
+            APSARA_TEST_EQUAL_DESC(filter ? filter->GetPrefixLength() : 0UL, c.prefixLength, c.regex);
+        }
+    }
+
+    void TestMayMatch() {
+        auto filter = RegexPrefixFilter::Create("^\\d{4}-\\d{2}-\\d{2} \\d{2}:\\d{2}:\\d{2}.*");
+        APSARA_TEST_TRUE_FATAL(filter != nullptr);
+        APSARA_TEST_TRUE(filter->MayMatch("2023-01-02 10:00:00 INFO begin"));
+        APSARA_TEST_FALSE(filter->MayMatch("\tat com.example.Main.main(Main.java:10)"));
+        APSARA_TEST_FALSE(filter->MayMatch("java.lang.NullPointerException"));
+        APSARA_TEST_FALSE(filter->MayMatch("2023-01-02"));
+        APSARA_TEST_FALSE(filter->MayMatch(""));
+
+        std::string line = "2023-01-02 10:00:00";
+        APSARA_TEST_TRUE(filter->MayMatch(line.data(), line.size()));
+        APSARA_TEST_FALSE(filter->MayMatch(line.data(), line.size() - 1));
+    }
+
+    // Lines matching the regex must always pass the prefilter.
+    void TestNoFalseNegative() {
+        std::vector<std::string> regexs = {"^\\d{4}-\\d{2}-\\d{2}.*",
+                                           "^\\[\\d+\\].*",
+                                           "^[A-Z][a-z]+ \\d+.*",
+                                           "ab+c.*",
+                                           "[^\\s].*",
+                                           "\\w{3}\\.\\d?.*",
+                                           "^[-a-c\\]]x.*",
+                                           "^\\d{1,}x.*"};
+        const char alphabet[] = "0123456789-:[] \tabcxyzABC.\xe4";
+        srand(0);
+        for (auto& regex : regexs) {
+            auto filter = RegexPrefixFilter::Create(regex);
+            APSARA_TEST_TRUE_FATAL(filter != nullptr);
+            boost::regex reg(regex);
+            size_t falseNegative = 0;
+            for (int i = 0; i < 20000; ++i) {
+                std::string line;
+                int length = rand() % 16;
+                for (int k = 0; k < length; ++k) {
+                    line.push_back(alphabet[rand() % (sizeof(alphabet) - 1)]);
+                }
+                if (boost::regex_match(line.c_str(), reg) && !filter->MayMatch(line.c_str())) {
+                    ++falseNegative;
+                }
+            }
+            APSARA_TEST_EQUAL_DESC(falseNegative, 0UL, regex);
+        }
+    }
+};
+
+UNIT_TEST_CASE(RegexPrefixFilterUnittest, TestPrefixLength);
+UNIT_TEST_CASE(RegexPrefixFilterUnittest, TestMayMatch);
+UNIT_TEST_CASE(RegexPrefixFilterUnittest, TestNoFalseNegative);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -13,12 +13,17 @@
 // limitations under the License.
 
 #include "unittest/Unittest.h"
+#include <map>
 #include "common/LogstoreSenderQueue.h"
+#include "common/TokenBucket.h"
 #include "common/FileSystemUtil.h"
 #include "sender/SenderQueueParam.h"
 #include "aggregator/Aggregator.h"
 #include "app_config/AppConfig.h"
 
+DECLARE_FLAG_INT32(send_retry_backoff_base_ms);
+DECLARE_FLAG_INT32(send_retry_backoff_max_ms);
+
 namespace logtail {
 
 std::string kTestRootDir;
@@ -35,9 +40,24 @@ public:
     }
 
     void TestExactlyOnceQueue();
+    void TestTokenBucket();
+    void TestTokenBucketFlowControl();
+    void TestFairScheduling();
+    void TestRetryBackoff();
+
+private:
+    size_t PushAndPop(LogstoreSenderQueue<SenderQueueParam>& senderQueue,
+                      const std::vector<std::pair<std::string, int>>& projectItemCounts,
+                      std::map<LogstoreFeedBackKey, size_t>& popCounts,
+                      int regionConcurrency = -1,
+                      std::vector<LoggroupTimeValue*>* popped = NULL);
 };
 
 UNIT_TEST_CASE(SenderQueueUnittest, TestExactlyOnceQueue);
+UNIT_TEST_CASE(SenderQueueUnittest, TestTokenBucket);
+UNIT_TEST_CASE(SenderQueueUnittest, TestTokenBucketFlowControl);
+UNIT_TEST_CASE(SenderQueueUnittest, TestFairScheduling);
+UNIT_TEST_CASE(SenderQueueUnittest, TestRetryBackoff);
 
 void SenderQueueUnittest::TestExactlyOnceQueue() {
     {
@@ -88,21 +108,262 @@ void SenderQueueUnittest::TestExactlyOnceQueue() {
         auto data = new LoggroupTimeValue();
         data->mLogstoreKey = kFbKey;
         data->mLogGroupContext.mExactlyOnceCheckpoint = checkpoints[0];
+        EXPECT_EQ(senderQueue.GetPushCredit(kFbKey), 2UL);
         EXPECT_TRUE(senderQueue.PushItem(kFbKey, data));
         EXPECT_TRUE(senderQueue.IsValidToPush(kFbKey));
+        EXPECT_EQ(senderQueue.GetPushCredit(kFbKey), 1UL);
         EXPECT_FALSE(senderQueue.IsEmpty(kFbKey));
         auto data2 = new LoggroupTimeValue();
         data2->mLogstoreKey = kFbKey;
         data2->mLogGroupContext.mExactlyOnceCheckpoint = checkpoints[1];
         EXPECT_TRUE(senderQueue.PushItem(kFbKey, data2));
         EXPECT_FALSE(senderQueue.IsValidToPush(kFbKey));
+        EXPECT_EQ(senderQueue.GetPushCredit(kFbKey), 0UL);
         EXPECT_FALSE(senderQueue.IsEmpty(kFbKey));
         senderQueue.OnLoggroupSendDone(data, LogstoreSenderInfo::SendResult_OK);
         EXPECT_TRUE(senderQueue.IsValidToPush(kFbKey));
+        EXPECT_EQ(senderQueue.GetPushCredit(kFbKey), 1UL);
         EXPECT_FALSE(senderQueue.IsEmpty(kFbKey));
     }
 }
 
+void SenderQueueUnittest::TestTokenBucket() {
+    TokenBucket bucket;
+    EXPECT_FALSE(bucket.IsLimited());
+    bucket.Consume(1000);
+    EXPECT_TRUE(bucket.HasToken());
+
+    bucket.SetRate(1000);
+    bucket.Refill(10000);
+    EXPECT_EQ(bucket.GetTokens(), 1000);
+    // An item larger than the remaining tokens is still allowed, the debt is paid by refills.
+    bucket.Consume(1500);
+    EXPECT_FALSE(bucket.HasToken());
+    bucket.Refill(10400);
+    EXPECT_FALSE(bucket.HasToken());
+    bucket.Refill(10600);
+    EXPECT_TRUE(bucket.HasToken());
+    // Burst is limited to one second of rate.
+    bucket.Refill(20000);
+    EXPECT_EQ(bucket.GetTokens(), 1000);
+    // Time going back only resets the refill time.
+    bucket.Refill(5000);
+    EXPECT_EQ(bucket.GetTokens(), 1000);
+
+    bucket.SetRate(500);
+    EXPECT_EQ(bucket.GetTokens(), 500);
+    bucket.SetRate(0);
+    bucket.Consume(1000);
+    EXPECT_TRUE(bucket.HasToken());
+    // A bucket starts full when it becomes limited again.
+    bucket.SetRate(2000);
+    EXPECT_EQ(bucket.GetTokens(), 2000);
+}
+
+size_t SenderQueueUnittest::PushAndPop(LogstoreSenderQueue<SenderQueueParam>& senderQueue,
+                                       const std::vector<std::pair<std::string, int>>& projectItemCounts,
+                                       std::map<LogstoreFeedBackKey, size_t>& popCounts,
+                                       int regionConcurrency,
+                                       std::vector<LoggroupTimeValue*>* popped) {
+    for (size_t key = 0; key < projectItemCounts.size(); ++key) {
+        for (int i = 0; i < projectItemCounts[key].second; ++i) {
+            auto data = new LoggroupTimeValue(projectItemCounts[key].first,
+                                              "logstore" + std::to_string(key),
+                                              "config",
+                                              "file",
+                                              false,
+                                              "",
+                                              "region",
+                                              LOGGROUP_COMPRESSED,
+                                              1,
+                                              600,
+                                              time(NULL),
+                                              "",
+                                              key);
+            EXPECT_TRUE(senderQueue.PushItem(key, data));
+        }
+    }
+
+    std::vector<LoggroupTimeValue*> items;
+    bool singleQueueFullFlag = false;
+    std::unordered_map<std::string, int> regionConcurrencyLimits;
+    if (regionConcurrency >= 0) {
+        regionConcurrencyLimits["region"] = regionConcurrency;
+    }
+    senderQueue.CheckAndPopAllItem(items, time(NULL), singleQueueFullFlag, regionConcurrencyLimits);
+    popCounts.clear();
+    for (auto item : items) {
+        ++popCounts[item->mLogstoreKey];
+    }
+    if (popped != NULL) {
+        *popped = items;
+    }
+    return items.size();
+}
+
+void SenderQueueUnittest::TestTokenBucketFlowControl() {
+    std::map<LogstoreFeedBackKey, size_t> popCounts;
+    // Without limits, everything is popped.
+    {
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        senderQueue.SetTokenBucketRates(0, 0, 0, 0);
+        EXPECT_EQ(PushAndPop(senderQueue, {{"project", 5}, {"project", 2}}, popCounts), 7UL);
+        EXPECT_FALSE(senderQueue.IsHeldByTokenBucket());
+    }
+    // A busy logstore does not hold the others.
+    {
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        senderQueue.SetTokenBucketRates(0, 0, 0, 1000);
+        EXPECT_EQ(PushAndPop(senderQueue, {{"project", 5}, {"project", 2}}, popCounts), 4UL);
+        EXPECT_EQ(popCounts[0], 2UL);
+        EXPECT_EQ(popCounts[1], 2UL);
+        EXPECT_TRUE(senderQueue.IsHeldByTokenBucket());
+    }
+    // Logstores of the same project share the bucket of project.
+    {
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        senderQueue.SetTokenBucketRates(0, 0, 1000, 0);
+        EXPECT_EQ(PushAndPop(senderQueue, {{"project1", 5}, {"project1", 5}, {"project2", 5}}, popCounts), 4UL);
+        EXPECT_EQ(popCounts[0] + popCounts[1], 2UL);
+        EXPECT_EQ(popCounts[2], 2UL);
+    }
+    // All logstores share the bucket of region and the global bucket.
+    {
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        senderQueue.SetTokenBucketRates(0, 1000, 0, 0);
+        EXPECT_EQ(PushAndPop(senderQueue, {{"project1", 5}, {"project2", 5}}, popCounts), 2UL);
+        EXPECT_TRUE(senderQueue.IsHeldByTokenBucket());
+    }
+    {
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        senderQueue.SetTokenBucketRates(1000, 0, 0, 0);
+        EXPECT_EQ(PushAndPop(senderQueue, {{"project1", 5}, {"project2", 5}}, popCounts), 2UL);
+        EXPECT_TRUE(senderQueue.IsHeldByTokenBucket());
+    }
+}
+
+void SenderQueueUnittest::TestFairScheduling() {
+    std::map<LogstoreFeedBackKey, size_t> popCounts;
+    // Without fair scheduling, the first logstore takes all concurrency.
+    {
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        EXPECT_EQ(PushAndPop(senderQueue, {{"project", 10}, {"project", 10}}, popCounts, 8), 8UL);
+        EXPECT_TRUE(popCounts[0] == 8UL || popCounts[1] == 8UL);
+    }
+    // Concurrency is shared by weight.
+    {
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        senderQueue.SetSchedulingQuantum(600);
+        senderQueue.SetLogstoreScheduling(0, 1, 0);
+        senderQueue.SetLogstoreScheduling(1, 3, 0);
+        EXPECT_EQ(PushAndPop(senderQueue, {{"project", 10}, {"project", 10}}, popCounts, 8), 8UL);
+        EXPECT_EQ(popCounts[0], 2UL);
+        EXPECT_EQ(popCounts[1], 6UL);
+
+        // Every popped log group is recorded in the queueing delay histogram.
+        uint32_t recorded = 0;
+        LogstoreSenderStatistics statistics = senderQueue.GetSenderStatistics(1);
+        for (size_t i = 0; i < LogstoreSenderStatistics::QUEUE_DELAY_BUCKET_COUNT; ++i) {
+            recorded += statistics.mQueueDelayHistogram[i];
+        }
+        EXPECT_EQ(recorded, 6U);
+        // Statistics are reset once read.
+        EXPECT_EQ(senderQueue.GetSenderStatistics(1).QueueDelayHistogramToString(),
+                  "<=10:0,<=100:0,<=500:0,<=1000:0,<=5000:0,<=30000:0,+inf:0");
+    }
+    // A log group larger than the quantum is popped after its deficit is saved up.
+    {
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        senderQueue.SetSchedulingQuantum(100);
+        EXPECT_EQ(PushAndPop(senderQueue, {{"project", 3}, {"project", 3}}, popCounts), 6UL);
+    }
+    // Logstores with higher priority are served first.
+    {
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        senderQueue.SetSchedulingQuantum(600);
+        senderQueue.SetLogstoreScheduling(0, 1, 0);
+        senderQueue.SetLogstoreScheduling(1, 1, 1);
+        EXPECT_EQ(PushAndPop(senderQueue, {{"project", 10}, {"project", 10}}, popCounts, 4), 4UL);
+        EXPECT_EQ(popCounts[1], 4UL);
+    }
+}
+
+void SenderQueueUnittest::TestRetryBackoff() {
+    const int32_t defaultBase = INT32_FLAG(send_retry_backoff_base_ms);
+    const int32_t defaultMax = INT32_FLAG(send_retry_backoff_max_ms);
+    INT32_FLAG(send_retry_backoff_base_ms) = 100;
+    INT32_FLAG(send_retry_backoff_max_ms) = 400;
+    std::map<LogstoreFeedBackKey, size_t> popCounts;
+    std::vector<LoggroupTimeValue*> items;
+    std::unordered_map<std::string, int> regionConcurrencyLimits;
+    bool singleQueueFullFlag = false;
+    size_t waitingCount = 0;
+    uint64_t promotedCount = 0;
+    {
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        std::vector<LoggroupTimeValue*> sent;
+        EXPECT_EQ(PushAndPop(senderQueue, {{"project", 3}}, popCounts, -1, &sent), 3UL);
+
+        // Backoff of the logstore is doubled by each failure: 50~100ms, 100~200ms, 200~400ms.
+        senderQueue.OnLoggroupSendDone(sent[0], LogstoreSenderInfo::SendResult_OtherFail);
+        senderQueue.OnLoggroupSendDone(sent[1], LogstoreSenderInfo::SendResult_NetworkFail);
+        senderQueue.OnLoggroupSendDone(sent[2], LogstoreSenderInfo::SendResult_OtherFail);
+        int32_t waitMs = senderQueue.GetRetryWaitMs(1000);
+        EXPECT_TRUE(waitMs > 0 && waitMs <= 100);
+        senderQueue.CheckAndPopAllItem(items, time(NULL), singleQueueFullFlag, regionConcurrencyLimits);
+        EXPECT_TRUE(items.empty());
+        senderQueue.GetRetryStatus(waitingCount, promotedCount);
+        EXPECT_EQ(waitingCount, 3UL);
+        EXPECT_EQ(promotedCount, 0UL);
+
+        // Only due log groups are popped.
+        usleep(110 * 1000);
+        senderQueue.CheckAndPopAllItem(items, time(NULL), singleQueueFullFlag, regionConcurrencyLimits);
+        EXPECT_TRUE(std::find(items.begin(), items.end(), sent[0]) != items.end());
+        EXPECT_TRUE(std::find(items.begin(), items.end(), sent[2]) == items.end());
+        for (auto item : items) {
+            senderQueue.OnLoggroupSendDone(item, LogstoreSenderInfo::SendResult_OK);
+        }
+        items.clear();
+
+        usleep(400 * 1000);
+        senderQueue.CheckAndPopAllItem(items, time(NULL), singleQueueFullFlag, regionConcurrencyLimits);
+        EXPECT_TRUE(std::find(items.begin(), items.end(), sent[2]) != items.end());
+        senderQueue.GetRetryStatus(waitingCount, promotedCount);
+        EXPECT_EQ(waitingCount, 0UL);
+        EXPECT_EQ(promotedCount, 3UL);
+
+        // Backoff is not waited when flushing.
+        senderQueue.OnLoggroupSendDone(sent[2], LogstoreSenderInfo::SendResult_OtherFail);
+        for (auto item : items) {
+            if (item != sent[2]) {
+                senderQueue.OnLoggroupSendDone(item, LogstoreSenderInfo::SendResult_OK);
+            }
+        }
+        items.clear();
+        senderQueue.PopAllItem(items, time(NULL), singleQueueFullFlag);
+        EXPECT_EQ(items.size(), 1UL);
+        EXPECT_TRUE(items[0] == sent[2]);
+        senderQueue.OnLoggroupSendDone(sent[2], LogstoreSenderInfo::SendResult_OK);
+        items.clear();
+        EXPECT_TRUE(senderQueue.IsEmpty());
+    }
+    // Failed log groups are retried at once if backoff is disabled.
+    {
+        INT32_FLAG(send_retry_backoff_base_ms) = 0;
+        LogstoreSenderQueue<SenderQueueParam> senderQueue;
+        std::vector<LoggroupTimeValue*> sent;
+        EXPECT_EQ(PushAndPop(senderQueue, {{"project", 1}}, popCounts, -1, &sent), 1UL);
+        senderQueue.OnLoggroupSendDone(sent[0], LogstoreSenderInfo::SendResult_OtherFail);
+        senderQueue.CheckAndPopAllItem(items, time(NULL), singleQueueFullFlag, regionConcurrencyLimits);
+        EXPECT_EQ(items.size(), 1UL);
+        items.clear();
+        senderQueue.OnLoggroupSendDone(sent[0], LogstoreSenderInfo::SendResult_OK);
+    }
+    INT32_FLAG(send_retry_backoff_base_ms) = defaultBase;
+    INT32_FLAG(send_retry_backoff_max_ms) = defaultMax;
+}
+
 } // namespace logtail
 
 UNIT_TEST_MAIN
\ No newline at end of file
@@ -0,0 +1,92 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "common/ShardedClockCache.h"
+
+namespace logtail {
+
+class ShardedClockCacheUnittest : public ::testing::Test {
+public:
+    void TestGetAndPut() {
+        ShardedClockCache<int> cache(100, 4);
+        int value = 0;
+        APSARA_TEST_FALSE(cache.Get("/var/log", "a.log", value));
+        cache.Put("/var/log", "a.log", 1);
+        cache.Put("/var/log", "b.log", 2);
+        APSARA_TEST_TRUE(cache.Get("/var/log", "a.log", value));
+        APSARA_TEST_EQUAL(value, 1);
+        APSARA_TEST_TRUE(cache.Get("/var/log", "b.log", value));
+        APSARA_TEST_EQUAL(value, 2);
+        cache.Put("/var/log", "a.log", 4);
+        APSARA_TEST_TRUE(cache.Get("/var/log", "a.log", value));
+        APSARA_TEST_EQUAL(value, 4);
+        APSARA_TEST_FALSE(cache.Get("/var", "log/a.log", value));
+    }
+
+    void TestBounded() {
+        ShardedClockCache<int> cache(64, 4);
+        APSARA_TEST_EQUAL(cache.GetCapacity(), 64UL);
+        for (int i = 0; i < 10000; ++i) {
+            cache.Put("/dir" + std::to_string(i), "file", i);
+        }
+        APSARA_TEST_EQUAL(cache.Size(), 64UL);
+        int value = 0;
+        APSARA_TEST_TRUE(cache.Get("/dir9999", "file", value));
+        APSARA_TEST_EQUAL(value, 9999);
+    }
+
+    void TestClockKeepsReferenced() {
+        ShardedClockCache<int> cache(8, 1);
+        for (int i = 0; i < 8; ++i) {
+            cache.Put("/dir", std::to_string(i), i);
+        }
+        // The hand clears all reference bits set by Put and evicts entry 0, then entry 1.
+        cache.Put("/dir", "new0", 100);
+        int value = 0;
+        APSARA_TEST_TRUE(cache.Get("/dir", "2", value));
+        cache.Put("/dir", "new1", 101);
+        cache.Put("/dir", "new2", 102);
+        APSARA_TEST_FALSE(cache.Get("/dir", "0", value));
+        APSARA_TEST_FALSE(cache.Get("/dir", "1", value));
+        APSARA_TEST_TRUE(cache.Get("/dir", "2", value));
+        APSARA_TEST_FALSE(cache.Get("/dir", "3", value));
+        APSARA_TEST_TRUE(cache.Get("/dir", "new0", value));
+        APSARA_TEST_EQUAL(value, 100);
+    }
+
+    void TestInvalidate() {
+        ShardedClockCache<int> cache(100, 4);
+        cache.Put("/var/log", "a.log", 1);
+        cache.Invalidate();
+        int value = 0;
+        APSARA_TEST_FALSE(cache.Get("/var/log", "a.log", value));
+        cache.Put("/var/log", "a.log", 2);
+        APSARA_TEST_TRUE(cache.Get("/var/log", "a.log", value));
+        APSARA_TEST_EQUAL(value, 2);
+        APSARA_TEST_EQUAL(cache.Size(), 1UL);
+        cache.Clear();
+        APSARA_TEST_EQUAL(cache.Size(), 0UL);
+        APSARA_TEST_FALSE(cache.Get("/var/log", "a.log", value));
+    }
+};
+
+UNIT_TEST_CASE(ShardedClockCacheUnittest, TestGetAndPut);
+UNIT_TEST_CASE(ShardedClockCacheUnittest, TestBounded);
+UNIT_TEST_CASE(ShardedClockCacheUnittest, TestClockKeepsReferenced);
+UNIT_TEST_CASE(ShardedClockCacheUnittest, TestInvalidate);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
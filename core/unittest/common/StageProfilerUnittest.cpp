@@ -0,0 +1,63 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include <string>
+#include "common/StageProfiler.h"
+
+DECLARE_FLAG_INT32(stage_profile_sample_interval);
+
+namespace logtail {
+
+class StageProfilerUnittest : public ::testing::Test {
+public:
+    void SetUp() override { StageProfiler::GetInstance()->GetStats(true); }
+
+    void TearDown() override { INT32_FLAG(stage_profile_sample_interval) = 0; }
+
+    void TestDisabled() {
+        const std::string configName = "config";
+        for (int i = 0; i < 10; ++i) {
+            StageProfileScope scope(configName, PROFILE_STAGE_PARSE);
+        }
+        APSARA_TEST_TRUE(StageProfiler::GetInstance()->GetStats(false).empty());
+    }
+
+    void TestSampled() {
+        INT32_FLAG(stage_profile_sample_interval) = 4;
+        const std::string configName = "config";
+        for (int i = 0; i < 40; ++i) {
+            StageProfileScope scope(configName, PROFILE_STAGE_PARSE);
+        }
+        auto stats = StageProfiler::GetInstance()->GetStats(true);
+        APSARA_TEST_EQUAL(stats.size(), 1UL);
+        APSARA_TEST_EQUAL(stats[configName][PROFILE_STAGE_PARSE].mSampleCount, 10UL);
+        APSARA_TEST_EQUAL(stats[configName][PROFILE_STAGE_READ].mSampleCount, 0UL);
+        APSARA_TEST_TRUE(StageProfiler::GetInstance()->GetStats(false).empty());
+    }
+
+    void TestStageName() {
+        APSARA_TEST_EQUAL(std::string(StageProfiler::GetStageName(PROFILE_STAGE_READ)), "read");
+        APSARA_TEST_EQUAL(std::string(StageProfiler::GetStageName(PROFILE_STAGE_COMPRESS)), "compress");
+    }
+};
+
+UNIT_TEST_CASE(StageProfilerUnittest, TestDisabled);
+UNIT_TEST_CASE(StageProfilerUnittest, TestSampled);
+UNIT_TEST_CASE(StageProfilerUnittest, TestStageName);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
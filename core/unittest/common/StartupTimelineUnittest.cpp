@@ -0,0 +1,84 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <string>
+#include <vector>
+#include "common/StartupTimeline.h"
+
+namespace logtail {
+
+class StartupTimelineUnittest : public ::testing::Test {
+public:
+    void TestRecordPhase() {
+        StartupTimeline timeline;
+        timeline.RecordPhase("config_load", 5000, 3000, 1000);
+        timeline.RecordPhase("app_config_load", 1000, 2000, 2000);
+        // Same phase is summed and keeps its first begin time.
+        timeline.RecordPhase("config_load", 9000, 4000, 3000);
+        std::vector<StartupTimeline::Phase> phases = timeline.GetPhases();
+        APSARA_TEST_EQUAL(phases.size(), 2UL);
+        APSARA_TEST_EQUAL(phases[0].mName, "app_config_load");
+        APSARA_TEST_EQUAL(phases[1].mName, "config_load");
+        APSARA_TEST_EQUAL(phases[1].mBeginMs, 5UL);
+        APSARA_TEST_EQUAL(phases[1].mWallUs, 7000UL);
+        APSARA_TEST_EQUAL(phases[1].mCpuUs, 4000UL);
+        APSARA_TEST_EQUAL(phases[1].mCount, 2U);
+        APSARA_TEST_EQUAL(timeline.ToString(), "app_config_load:1:2:2,config_load:5:7:4");
+    }
+
+    void TestFinish() {
+        StartupTimeline timeline;
+        timeline.RecordPhase("config_load", 0, 1000, 1000);
+        timeline.Finish();
+        APSARA_TEST_TRUE(timeline.IsFinished());
+        // Phases after startup are ignored, milestones are not.
+        timeline.RecordPhase("config_load", 0, 1000, 1000);
+        timeline.RecordPhase("config_yaml_to_json", 0, 1000, 1000);
+        timeline.RecordMilestone("first_send_success");
+        timeline.RecordMilestone("first_send_success");
+        std::vector<StartupTimeline::Phase> phases = timeline.GetPhases();
+        APSARA_TEST_EQUAL(phases.size(), 3UL);
+        APSARA_TEST_EQUAL(phases[0].mName, "config_load");
+        APSARA_TEST_EQUAL(phases[0].mWallUs, 1000UL);
+        APSARA_TEST_EQUAL(phases[1].mName, "startup_finished");
+        APSARA_TEST_EQUAL(phases[2].mName, "first_send_success");
+        APSARA_TEST_TRUE(phases[2].mBeginMs >= phases[1].mBeginMs);
+    }
+
+    void TestScope() {
+        StartupTimeline* timeline = StartupTimeline::GetInstance();
+        {
+            StartupPhaseScope phase("scope_test");
+            usleep(10 * 1000);
+        }
+        bool found = false;
+        for (const auto& phase : timeline->GetPhases()) {
+            if (phase.mName == "scope_test") {
+                found = true;
+                APSARA_TEST_TRUE(phase.mWallUs >= 10000UL);
+                APSARA_TEST_EQUAL(phase.mCount, 1U);
+            }
+        }
+        APSARA_TEST_TRUE(found);
+    }
+};
+
+UNIT_TEST_CASE(StartupTimelineUnittest, TestRecordPhase);
+UNIT_TEST_CASE(StartupTimelineUnittest, TestFinish);
+UNIT_TEST_CASE(StartupTimelineUnittest, TestScope);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,93 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "common/StringInterner.h"
+
+namespace logtail {
+
+class StringInternerUnittest : public ::testing::Test {
+public:
+    void TestIntern() {
+        std::string project = "test_project";
+        InternedString a(project);
+        InternedString b("test_project");
+        InternedString c(std::string("test_logstore"));
+        APSARA_TEST_TRUE(a == b);
+        APSARA_TEST_TRUE(a != c);
+        APSARA_TEST_EQUAL(a.Id(), b.Id());
+        APSARA_TEST_TRUE(a.Id() != c.Id());
+        // Both handles refer to the same storage.
+        APSARA_TEST_TRUE(a.c_str() == b.c_str());
+        APSARA_TEST_EQUAL(a.Str(), project);
+
+        InternedString empty;
+        APSARA_TEST_TRUE(empty.empty());
+        APSARA_TEST_EQUAL(empty.Id(), 0U);
+        APSARA_TEST_TRUE(empty == InternedString(""));
+    }
+
+    void TestStringCompatible() {
+        InternedString region("cn-hangzhou");
+        APSARA_TEST_TRUE(region == "cn-hangzhou");
+        APSARA_TEST_TRUE(region == std::string("cn-hangzhou"));
+        APSARA_TEST_TRUE(std::string("cn-shanghai") != region);
+        APSARA_TEST_EQUAL(region + "#1", std::string("cn-hangzhou#1"));
+        APSARA_TEST_EQUAL("region:" + region, std::string("region:cn-hangzhou"));
+        APSARA_TEST_EQUAL(ToString(region), std::string("cn-hangzhou"));
+        const std::string& str = region;
+        APSARA_TEST_EQUAL(str.size(), region.size());
+
+        std::unordered_map<InternedString, int> counts;
+        ++counts[InternedString("a")];
+        ++counts[InternedString(std::string("a"))];
+        APSARA_TEST_EQUAL(counts.size(), 1UL);
+        APSARA_TEST_EQUAL(counts[InternedString("a")], 2);
+    }
+
+    void TestConcurrentIntern() {
+        const int kThreadCount = 4;
+        const int kStringCount = 1000;
+        std::vector<std::vector<InternedString>> results(kThreadCount);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < kThreadCount; ++t) {
+            threads.emplace_back([t, &results]() {
+                for (int i = 0; i < kStringCount; ++i) {
+                    results[t].emplace_back("concurrent_" + std::to_string(i));
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (int t = 1; t < kThreadCount; ++t) {
+            for (int i = 0; i < kStringCount; ++i) {
+                APSARA_TEST_EQUAL_FATAL(results[t][i].Id(), results[0][i].Id());
+            }
+        }
+    }
+};
+
+UNIT_TEST_CASE(StringInternerUnittest, TestIntern);
+UNIT_TEST_CASE(StringInternerUnittest, TestStringCompatible);
+UNIT_TEST_CASE(StringInternerUnittest, TestConcurrentIntern);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,66 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include <vector>
+#include "common/Flags.h"
+#include "common/ThreadAffinity.h"
+
+DECLARE_FLAG_STRING(process_thread_cpus);
+
+namespace logtail {
+
+class ThreadAffinityUnittest : public ::testing::Test {
+public:
+    void TestParseCpuList() {
+        APSARA_TEST_TRUE(ParseCpuList("0-3, 8,10-11") == std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+        APSARA_TEST_TRUE(ParseCpuList("") == std::vector<int>());
+        // Invalid parts are skipped.
+        APSARA_TEST_TRUE(ParseCpuList("a,3-1,-2,5,6x") == std::vector<int>({5}));
+    }
+
+    void TestNumaPlan() {
+        std::vector<std::vector<int>> nodes = {{0, 1, 2}, {3, 4, 5, 6}};
+        ThreadAffinity::Plan plan = ThreadAffinity::MakeNumaPlan(nodes);
+        // Node 1 has most cpus, input and sender threads stay there.
+        APSARA_TEST_TRUE(plan.mRoleCpus[THREAD_ROLE_INPUT] == std::vector<std::vector<int>>({nodes[1]}));
+        APSARA_TEST_TRUE(plan.mRoleCpus[THREAD_ROLE_SENDER] == std::vector<std::vector<int>>({nodes[1]}));
+        // Two process threads fit on node 1 beside them, the next three go to node 0.
+        const std::vector<std::vector<int>>& process = plan.mRoleCpus[THREAD_ROLE_PROCESS];
+        APSARA_TEST_EQUAL(process.size(), 5UL);
+        APSARA_TEST_TRUE(process[0] == nodes[1]);
+        APSARA_TEST_TRUE(process[1] == nodes[1]);
+        APSARA_TEST_TRUE(process[2] == nodes[0]);
+        APSARA_TEST_TRUE(process[4] == nodes[0]);
+    }
+
+    void TestCpuListFlag() {
+        STRING_FLAG(process_thread_cpus) = "2,5";
+        ThreadAffinity affinity;
+        APSARA_TEST_TRUE(affinity.GetCpus(THREAD_ROLE_PROCESS, 0) == std::vector<int>({2}));
+        APSARA_TEST_TRUE(affinity.GetCpus(THREAD_ROLE_PROCESS, 1) == std::vector<int>({5}));
+        APSARA_TEST_TRUE(affinity.GetCpus(THREAD_ROLE_PROCESS, 2) == std::vector<int>({2}));
+        APSARA_TEST_TRUE(affinity.GetCpus(THREAD_ROLE_INPUT, 0).empty());
+        STRING_FLAG(process_thread_cpus) = "";
+    }
+};
+
+UNIT_TEST_CASE(ThreadAffinityUnittest, TestParseCpuList);
+UNIT_TEST_CASE(ThreadAffinityUnittest, TestNumaPlan);
+UNIT_TEST_CASE(ThreadAffinityUnittest, TestCpuListFlag);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
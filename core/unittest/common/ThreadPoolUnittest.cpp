@@ -0,0 +1,99 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "common/ThreadPool.h"
+#include "monitor/MetricRegistry.h"
+
+namespace logtail {
+
+class ThreadPoolUnittest : public ::testing::Test {
+public:
+    static void WaitFor(const std::atomic<int>& value, int expected) {
+        for (int i = 0; i < 5000 && value.load() != expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void TestMoveOnlyTask() {
+        ThreadPool pool(2);
+        APSARA_TEST_FALSE(pool.Add([]() {}));
+        pool.Start();
+        std::atomic<int> sum{0};
+        for (int i = 1; i <= 100; ++i) {
+            std::unique_ptr<int> value(new int(i));
+            // unique_ptr makes the lambda move-only.
+            auto func = [&sum](std::unique_ptr<int>& v) { sum += *v; };
+            APSARA_TEST_TRUE(pool.Add(std::bind(func, std::move(value))));
+        }
+        WaitFor(sum, 5050);
+        APSARA_TEST_EQUAL(sum.load(), 5050);
+        pool.Stop();
+        APSARA_TEST_FALSE(pool.Add([]() {}));
+    }
+
+    void TestAddBatch() {
+        ThreadPool pool(3);
+        pool.Start();
+        std::atomic<int> count{0};
+        std::vector<ThreadPool::Task> tasks;
+        for (int i = 0; i < 10; ++i) {
+            tasks.emplace_back([&count]() { ++count; });
+        }
+        APSARA_TEST_TRUE(pool.AddBatch(tasks));
+        APSARA_TEST_TRUE(tasks.empty());
+        WaitFor(count, 10);
+        APSARA_TEST_EQUAL(count.load(), 10);
+    }
+
+    void TestSteal() {
+        ThreadPool pool(2, "thread_pool_unittest");
+        pool.Start();
+        std::atomic<int> count{0};
+        std::atomic<bool> blocked{true};
+        // The first task blocks worker 0, tasks added to worker 0 later are stolen by worker 1.
+        pool.Add([&blocked]() {
+            while (blocked) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        for (int i = 0; i < 10; ++i) {
+            pool.Add([&count]() { ++count; });
+        }
+        WaitFor(count, 10);
+        APSARA_TEST_EQUAL(count.load(), 10);
+        APSARA_TEST_TRUE(pool.GetStealCount() > 0);
+        blocked = false;
+
+        std::map<std::string, std::string> metrics;
+        MetricRegistry::GetInstance()->ExportTo(metrics);
+        APSARA_TEST_TRUE(metrics.find("thread_pool_task_latency_ms_count{pool=thread_pool_unittest}")
+                         != metrics.end());
+    }
+};
+
+UNIT_TEST_CASE(ThreadPoolUnittest, TestMoveOnlyTask);
+UNIT_TEST_CASE(ThreadPoolUnittest, TestAddBatch);
+UNIT_TEST_CASE(ThreadPoolUnittest, TestSteal);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
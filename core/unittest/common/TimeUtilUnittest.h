@@ -30,12 +30,16 @@ public:
     void TestStrptime();
     void TestNativeStrptimeFormat();
     void TestGetPreciseTimestamp();
+    void TestFastStrptime();
+    void TestMakeLocalTime();
 };
 
 APSARA_UNIT_TEST_CASE(TimeUtilUnittest, TestDeduceYear, 0);
 APSARA_UNIT_TEST_CASE(TimeUtilUnittest, TestStrptime, 0);
 APSARA_UNIT_TEST_CASE(TimeUtilUnittest, TestNativeStrptimeFormat, 0);
 APSARA_UNIT_TEST_CASE(TimeUtilUnittest, TestGetPreciseTimestamp, 0);
+APSARA_UNIT_TEST_CASE(TimeUtilUnittest, TestFastStrptime, 0);
+APSARA_UNIT_TEST_CASE(TimeUtilUnittest, TestMakeLocalTime, 0);
 
 void TimeUtilUnittest::TestDeduceYear() {
     struct Case {
@@ -177,4 +181,51 @@ void TimeUtilUnittest::TestGetPreciseTimestamp() {
     EXPECT_EQ(1640970061000000000, GetPreciseTimestamp(1640970061, " -0700", preciseTimestampConfig, 0));
 }
 
+void TimeUtilUnittest::TestFastStrptime() {
+    struct Case {
+        std::string format;
+        std::string input;
+        bool fixedWidth;
+    };
+    std::vector<Case> cases{
+        {"%Y-%m-%d %H:%M:%S", "2022-02-28 23:59:07.123", true},
+        {"%Y-%m-%dT%H:%M:%S", "2022-02-28T23:59:07+08:00", true},
+        {"[%F %T]", "[2022-02-28 23:59:07]", true},
+        {"%Y%m%d%H%M%S", "20220228235907", true},
+        {"%Y-%m-%d %H:%M:%S", "2022-2-28 23:59:07", false},
+        {"%Y-%m-%d %H:%M:%S", "2022-13-28 23:59:07", false},
+        {"%d/%b/%Y:%H:%M:%S", "28/Feb/2022:23:59:07", false},
+        {"%m-%d %H:%M:%S", "02-28 23:59:07", false},
+    };
+    for (size_t i = 0; i < cases.size(); ++i) {
+        auto& c = cases[i];
+        struct tm fastTm = {0};
+        const char* fastRet = FastStrptime(c.input.c_str(), c.format.c_str(), &fastTm);
+        EXPECT_EQ(c.fixedWidth, fastRet != NULL) << i;
+        if (fastRet == NULL) {
+            continue;
+        }
+        struct tm stdTm = {0};
+        const char* stdRet = strptime(c.input.c_str(), c.format.c_str(), &stdTm);
+        EXPECT_EQ(stdRet, fastRet) << i;
+        EXPECT_EQ(stdTm.tm_year, fastTm.tm_year) << i;
+        EXPECT_EQ(stdTm.tm_mon, fastTm.tm_mon) << i;
+        EXPECT_EQ(stdTm.tm_mday, fastTm.tm_mday) << i;
+        EXPECT_EQ(stdTm.tm_hour, fastTm.tm_hour) << i;
+        EXPECT_EQ(stdTm.tm_min, fastTm.tm_min) << i;
+        EXPECT_EQ(stdTm.tm_sec, fastTm.tm_sec) << i;
+    }
+}
+
+void TimeUtilUnittest::TestMakeLocalTime() {
+    // Sequential times across hours and days, the result must be the same as mktime.
+    for (time_t t = 1640970061; t < 1640970061 + 3 * 24 * 3600; t += 97) {
+        struct tm timeInfo = {0};
+        localtime_r(&t, &timeInfo);
+        struct tm stdTm = timeInfo;
+        stdTm.tm_isdst = -1;
+        EXPECT_EQ(mktime(&stdTm), MakeLocalTime(timeInfo));
+    }
+}
+
 } // namespace logtail
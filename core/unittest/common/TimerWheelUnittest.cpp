@@ -0,0 +1,121 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+#include "common/TimerWheel.h"
+
+namespace logtail {
+
+class TimerWheelUnittest : public ::testing::Test {
+public:
+    void TestExpire() {
+        TimerWheel wheel(1000);
+        wheel.Schedule(1, 1005);
+        wheel.Schedule(2, 1003);
+        wheel.Schedule(3, 900); // already passed
+        std::vector<int64_t> expired;
+        wheel.Advance(1002, expired);
+        APSARA_TEST_TRUE(expired == std::vector<int64_t>({3}));
+        expired.clear();
+        wheel.Advance(1005, expired);
+        APSARA_TEST_TRUE(expired == std::vector<int64_t>({2, 1}));
+        APSARA_TEST_EQUAL(wheel.Size(), 0UL);
+        // Clock going backward does nothing.
+        wheel.Schedule(4, 1006);
+        expired.clear();
+        wheel.Advance(10, expired);
+        APSARA_TEST_TRUE(expired.empty());
+        APSARA_TEST_EQUAL(wheel.GetCurrentTick(), 1005);
+    }
+
+    void TestCancelAndReschedule() {
+        TimerWheel wheel(0);
+        wheel.Schedule(1, 10);
+        wheel.Schedule(2, 10);
+        APSARA_TEST_TRUE(wheel.Cancel(1));
+        APSARA_TEST_FALSE(wheel.Cancel(1));
+        APSARA_TEST_FALSE(wheel.IsScheduled(1));
+        // Moved from a low level to a high one.
+        wheel.Schedule(2, 100000);
+        std::vector<int64_t> expired;
+        wheel.Advance(99999, expired);
+        APSARA_TEST_TRUE(expired.empty());
+        wheel.Advance(100000, expired);
+        APSARA_TEST_TRUE(expired == std::vector<int64_t>({2}));
+    }
+
+    void TestBeyondSpan() {
+        TimerWheel wheel(0);
+        const int64_t deadline = TimerWheel::kMaxSpan * 2 + 7;
+        wheel.Schedule(1, deadline);
+        std::vector<int64_t> expired;
+        wheel.Advance(deadline - 1, expired);
+        APSARA_TEST_TRUE(expired.empty());
+        APSARA_TEST_TRUE(wheel.IsScheduled(1));
+        wheel.Advance(deadline, expired);
+        APSARA_TEST_TRUE(expired == std::vector<int64_t>({1}));
+    }
+
+    // Compared with a map of deadlines, all timers expire at exactly their tick.
+    void TestRandom() {
+        std::mt19937 rng(7);
+        const int64_t start = 1600000000;
+        TimerWheel wheel(start);
+        std::map<int64_t, int64_t> deadlines;
+        int64_t now = start;
+        for (int round = 0; round < 2000; ++round) {
+            for (int i = 0; i < 20; ++i) {
+                int64_t id = rng() % 3000;
+                int64_t deadline = now + static_cast<int64_t>(rng() % (1 << (6 * (1 + rng() % 4))));
+                if (rng() % 10 == 0) {
+                    wheel.Cancel(id);
+                    deadlines.erase(id);
+                } else {
+                    wheel.Schedule(id, deadline);
+                    deadlines[id] = deadline;
+                }
+            }
+            int64_t next = now + 1 + static_cast<int64_t>(rng() % 4000);
+            std::vector<int64_t> expired;
+            wheel.Advance(next, expired);
+            std::vector<int64_t> expected;
+            for (auto iter = deadlines.begin(); iter != deadlines.end();) {
+                if (iter->second <= next) {
+                    expected.push_back(iter->first);
+                    iter = deadlines.erase(iter);
+                } else {
+                    ++iter;
+                }
+            }
+            std::sort(expired.begin(), expired.end());
+            APSARA_TEST_TRUE(expired == expected);
+            now = next;
+        }
+        APSARA_TEST_EQUAL(wheel.Size(), deadlines.size());
+    }
+};
+
+UNIT_TEST_CASE(TimerWheelUnittest, TestExpire);
+UNIT_TEST_CASE(TimerWheelUnittest, TestCancelAndReschedule);
+UNIT_TEST_CASE(TimerWheelUnittest, TestBeyondSpan);
+UNIT_TEST_CASE(TimerWheelUnittest, TestRandom);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
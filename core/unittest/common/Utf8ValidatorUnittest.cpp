@@ -0,0 +1,148 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "common/Utf8Validator.h"
+#include "common/TimeUtil.h"
+
+namespace logtail {
+
+class Utf8ValidatorUnittest : public ::testing::Test {
+    static std::string MakeText(size_t size) {
+        static const char* const kWords[] = {"hello ", "\xe4\xbd\xa0\xe5\xa5\xbd ", "\xc3\xa9t\xc3\xa9 ",
+                                             "\xf0\x9f\x98\x80 ", "logtail ", "\xd0\xbf\xd1\x80\xd0\xb8 "};
+        std::string text;
+        srand(0);
+        while (text.size() < size) {
+            text.append(kWords[rand() % (sizeof(kWords) / sizeof(kWords[0]))]);
+        }
+        return text;
+    }
+
+    // Checks @seq at every position around vector block boundaries, with ASCII or valid text around.
+    static void CheckEverywhere(const std::string& seq, bool expected) {
+        for (size_t prefix = 0; prefix < 70; ++prefix) {
+            for (const std::string& suffix : {std::string(), std::string("a"), std::string(40, 'b')}) {
+                const std::string text = std::string(prefix, 'x') + seq + suffix;
+                APSARA_TEST_EQUAL_FATAL(IsValidUtf8(text.data(), text.size()), expected);
+                APSARA_TEST_EQUAL_FATAL(IsValidUtf8Scalar(text.data(), text.size()), expected);
+            }
+        }
+    }
+
+public:
+    void TestValid() {
+        LOG_INFO(sLogger, ("utf8 validator", GetUtf8ValidatorName()));
+        APSARA_TEST_TRUE(IsValidUtf8("", 0));
+        for (const char* seq : {"a", "\x7f", "\xc2\x80", "\xdf\xbf", "\xe0\xa0\x80", "\xed\x9f\xbf", "\xee\x80\x80",
+                                "\xef\xbf\xbf", "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbf"}) {
+            CheckEverywhere(seq, true);
+        }
+        const std::string text = MakeText(10000);
+        for (size_t size = 0; size < 200; ++size) {
+            // Cut at a character boundary.
+            size_t end = size;
+            while (end > 0 && (static_cast<uint8_t>(text[end]) & 0xc0) == 0x80) {
+                --end;
+            }
+            APSARA_TEST_TRUE_FATAL(IsValidUtf8(text.data(), end));
+        }
+        APSARA_TEST_TRUE(IsValidUtf8(text.data(), text.size()));
+    }
+
+    void TestInvalid() {
+        for (const char* seq : {"\x80",
+                                "\xbf",
+                                "\xc0\x80", // overlong
+                                "\xc1\xbf",
+                                "\xe0\x80\x80",
+                                "\xe0\x9f\xbf",
+                                "\xf0\x80\x80\x80",
+                                "\xf0\x8f\xbf\xbf",
+                                "\xed\xa0\x80", // surrogate
+                                "\xed\xbf\xbf",
+                                "\xf4\x90\x80\x80", // too large
+                                "\xf5\x80\x80\x80",
+                                "\xf8\x88\x80\x80\x80",
+                                "\xff",
+                                "\xc2", // truncated
+                                "\xe4\xbd",
+                                "\xf0\x9f\x98",
+                                "\xc2\x41",
+                                "\xe4\x41\xa0",
+                                "\xc2\x80\x80", // extra continuation
+                                "\xf0\x9f\x98\x80\x80"}) {
+            CheckEverywhere(seq, false);
+        }
+    }
+
+    void TestRandom() {
+        // Mostly valid text with a few random bytes replaced, both implementations must agree.
+        const std::string text = MakeText(4096);
+        srand(1);
+        for (int round = 0; round < 2000; ++round) {
+            std::string mutated = text.substr(rand() % 64, 64 + rand() % 512);
+            for (int i = rand() % 3; i > 0; --i) {
+                mutated[rand() % mutated.size()] = static_cast<char>(rand() % 256);
+            }
+            APSARA_TEST_EQUAL_FATAL(IsValidUtf8(mutated.data(), mutated.size()),
+                                    IsValidUtf8Scalar(mutated.data(), mutated.size()));
+        }
+        // Every 2 bytes and 3 bytes value after a lead byte.
+        for (int first = 0x80; first < 0x100; ++first) {
+            for (int second = 0; second < 0x100; ++second) {
+                std::string seq(std::string(37, 'x') + static_cast<char>(first) + static_cast<char>(second) + '\x80');
+                APSARA_TEST_EQUAL_FATAL(IsValidUtf8(seq.data(), seq.size()),
+                                        IsValidUtf8Scalar(seq.data(), seq.size()));
+                seq.pop_back();
+                APSARA_TEST_EQUAL_FATAL(IsValidUtf8(seq.data(), seq.size()),
+                                        IsValidUtf8Scalar(seq.data(), seq.size()));
+            }
+        }
+    }
+
+    void TestBenchmark() {
+        const std::string text = MakeText(1024 * 1024);
+        const int kRound = 100;
+        bool valid = true;
+        uint64_t scalarBegin = GetCurrentTimeInMicroSeconds();
+        for (int round = 0; round < kRound; ++round) {
+            valid = IsValidUtf8Scalar(text.data(), text.size()) && valid;
+        }
+        uint64_t scalarCost = GetCurrentTimeInMicroSeconds() - scalarBegin;
+        uint64_t vectorBegin = GetCurrentTimeInMicroSeconds();
+        for (int round = 0; round < kRound; ++round) {
+            valid = IsValidUtf8(text.data(), text.size()) && valid;
+        }
+        uint64_t vectorCost = GetCurrentTimeInMicroSeconds() - vectorBegin;
+        APSARA_TEST_TRUE(valid);
+        double totalMB = 1.0 * text.size() * kRound / 1024 / 1024;
+        LOG_INFO(sLogger,
+                 ("utf8 validation benchmark, validator", GetUtf8ValidatorName())("total MB", totalMB)(
+                     "scalar MB/s", totalMB * 1000000 / (scalarCost + 1))("vectorized MB/s",
+                                                                          totalMB * 1000000 / (vectorCost + 1)));
+    }
+};
+
+UNIT_TEST_CASE(Utf8ValidatorUnittest, TestValid);
+UNIT_TEST_CASE(Utf8ValidatorUnittest, TestInvalid);
+UNIT_TEST_CASE(Utf8ValidatorUnittest, TestRandom);
+UNIT_TEST_CASE(Utf8ValidatorUnittest, TestBenchmark);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
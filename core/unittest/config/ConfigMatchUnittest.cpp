@@ -261,7 +261,7 @@ public:
             ConfigManager::GetInstance()->FindMatchWithForceFlag(allConfig, gRootDir + PS + "A" + PS + "B", "test.Log");
             APSARA_TEST_EQUAL(allConfig.size(), (size_t)2);
         }
-        ConfigManager::GetInstance()->mCacheFileAllConfigMap.clear();
+        ConfigManager::GetInstance()->mCacheFileAllConfigMap.Clear();
         {
             vector<Config*> allConfig;
             ConfigManager::GetInstance()->FindAllMatch(allConfig, gRootDir + PS + "A" + PS + "B", "test.Log");
@@ -311,12 +311,11 @@ public:
         sleep(1);
         for (size_t i = 0; i < 7; i++) {
             string dir = gRootDir + path[i];
-            std::unordered_map<std::string, int>::iterator pwItr
-                = (EventDispatcher::GetInstance()->mPathWdMap).find(dir);
-            APSARA_TEST_TRUE_DESC(pwItr != EventDispatcher::GetInstance()->mPathWdMap.end(), dir);
-            if (pwItr != EventDispatcher::GetInstance()->mPathWdMap.end()) {
-                unordered_map<int, time_t>::iterator wuItr
-                    = EventDispatcher::GetInstance()->mWdUpdateTimeMap.find(pwItr->second);
+            int wd;
+            bool registered = EventDispatcher::GetInstance()->mPathTrie.Find(dir, wd);
+            APSARA_TEST_TRUE_DESC(registered, dir);
+            if (registered) {
+                unordered_map<int, time_t>::iterator wuItr = EventDispatcher::GetInstance()->mWdUpdateTimeMap.find(wd);
                 APSARA_TEST_EQUAL_DESC(wuItr != EventDispatcher::GetInstance()->mWdUpdateTimeMap.end(), result[i], dir);
             }
         }
@@ -509,8 +508,7 @@ public:
 #endif
         for (idx = 0; idx < 12; ++idx) {
             string dir = gRootDir + path[idx];
-            bool registered = EventDispatcher::GetInstance()->mPathWdMap.find(dir)
-                != EventDispatcher::GetInstance()->mPathWdMap.end();
+            bool registered = EventDispatcher::GetInstance()->IsRegistered(dir.c_str());
             APSARA_TEST_EQUAL_DESC(registered, result[idx], dir);
         }
         int32_t bakInterval = LogInput::GetInstance()->mCheckBaseDirInterval;
@@ -526,8 +524,7 @@ public:
         sleep(1);
         for (idx = 0; idx < 12; ++idx) {
             string dir = gRootDir + path[idx];
-            bool registered = EventDispatcher::GetInstance()->mPathWdMap.find(dir)
-                == EventDispatcher::GetInstance()->mPathWdMap.end();
+            bool registered = !EventDispatcher::GetInstance()->IsRegistered(dir.c_str());
             APSARA_TEST_TRUE_DESC(registered, dir);
         }
 
@@ -547,8 +544,7 @@ public:
         sleep(1);
         for (idx = 0; idx < 12; ++idx) {
             string dir = gRootDir + path[idx];
-            bool registered = EventDispatcher::GetInstance()->mPathWdMap.find(dir)
-                != EventDispatcher::GetInstance()->mPathWdMap.end();
+            bool registered = EventDispatcher::GetInstance()->IsRegistered(dir.c_str());
             APSARA_TEST_EQUAL_DESC(registered, result[idx], dir);
         }
 
@@ -0,0 +1,157 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <algorithm>
+#include <memory>
+#include "config/Config.h"
+#include "config/ConfigPathIndex.h"
+
+namespace logtail {
+
+class ConfigPathIndexUnittest : public ::testing::Test {
+public:
+    void TearDown() override { mConfigs.clear(); }
+
+    void TestCandidates() {
+        ConfigPathIndex index;
+        Config* root = AddConfig(index, "/", "*.log");
+        Config* varLog = AddConfig(index, "/var/log", "*.log");
+        Config* varLogApp = AddConfig(index, "/var/log/app", "app.log");
+        Config* wildcard = AddConfig(index, "/var/log/svc*/logs", "*.log");
+        Config* home = AddConfig(index, "/home/admin", "*.log");
+        APSARA_TEST_EQUAL(index.Size(), 5UL);
+
+        std::vector<Config*> candidates;
+        index.GetCandidates("/var/log/app", "app.log", candidates);
+        APSARA_TEST_EQUAL(candidates.size(), 4UL);
+        APSARA_TEST_TRUE(Contains(candidates, root));
+        APSARA_TEST_TRUE(Contains(candidates, varLog));
+        APSARA_TEST_TRUE(Contains(candidates, varLogApp));
+        APSARA_TEST_TRUE(Contains(candidates, wildcard));
+
+        // Literal file pattern is only a candidate for the same name.
+        candidates.clear();
+        index.GetCandidates("/var/log/app", "other.log", candidates);
+        APSARA_TEST_FALSE(Contains(candidates, varLogApp));
+
+        // All configs on the path are candidates for directories.
+        candidates.clear();
+        index.GetCandidates("/var/log/app/sub", "", candidates);
+        APSARA_TEST_TRUE(Contains(candidates, varLogApp));
+
+        candidates.clear();
+        index.GetCandidates("/var/log/svc1/logs", "a.log", candidates);
+        APSARA_TEST_TRUE(Contains(candidates, wildcard));
+        APSARA_TEST_TRUE(wildcard->IsMatch("/var/log/svc1/logs", "a.log"));
+
+        candidates.clear();
+        index.GetCandidates("/home/admin", "a.log", candidates);
+        APSARA_TEST_EQUAL(candidates.size(), 2UL);
+        APSARA_TEST_TRUE(Contains(candidates, home));
+        APSARA_TEST_FALSE(Contains(candidates, varLog));
+    }
+
+    void TestDockerConfigAlwaysCandidate() {
+        ConfigPathIndex index;
+        Config* docker = AddConfig(index, "/var/log", "*.log", true);
+        std::vector<Config*> candidates;
+        index.GetCandidates("/host/containers/abc/var/log", "a.log", candidates);
+        APSARA_TEST_TRUE(Contains(candidates, docker));
+    }
+
+    void TestRemove() {
+        ConfigPathIndex index;
+        Config* varLog = AddConfig(index, "/var/log", "*.log");
+        Config* varLogApp = AddConfig(index, "/var/log/app", "app.log");
+        index.Remove(varLogApp);
+        APSARA_TEST_EQUAL(index.Size(), 1UL);
+        std::vector<Config*> candidates;
+        index.GetCandidates("/var/log/app", "app.log", candidates);
+        APSARA_TEST_EQUAL(candidates.size(), 1UL);
+        APSARA_TEST_TRUE(Contains(candidates, varLog));
+
+        index.Remove(varLog);
+        index.Remove(varLog);
+        APSARA_TEST_EQUAL(index.Size(), 0UL);
+        candidates.clear();
+        index.GetCandidates("/var/log/app", "app.log", candidates);
+        APSARA_TEST_TRUE(candidates.empty());
+    }
+
+    void TestContainerPathIndex() {
+        ConfigPathIndex index;
+        Config* docker = AddConfig(index, "/var/log", "*.log", true);
+        for (int i = 0; i < 3; ++i) {
+            APSARA_TEST_TRUE(docker->UpdateDockerContainerPath(ContainerJson("id" + std::to_string(i)), false));
+        }
+        DockerContainerPath* containerPath = docker->GetContainerPathByLogPath("/host/id1/var/log/app");
+        APSARA_TEST_TRUE(containerPath != NULL);
+        APSARA_TEST_EQUAL(containerPath->mContainerID, "id1");
+        APSARA_TEST_TRUE(docker->GetContainerPathByLogPath("/host/id10/var/log") == NULL);
+        APSARA_TEST_TRUE(docker->IsMatch("/host/id2/var/log", "a.log"));
+        APSARA_TEST_FALSE(docker->IsMatch("/host/id3/var/log", "a.log"));
+        APSARA_TEST_TRUE(docker->IsSameDockerContainerPath(ContainerJson("id2"), false));
+
+        // Update path of id0 and delete it, id2 is moved to its position.
+        APSARA_TEST_TRUE(docker->UpdateDockerContainerPath(ContainerJson("id0", "/other/var/log"), false));
+        APSARA_TEST_FALSE(docker->IsMatch("/host/id0/var/log", "a.log"));
+        APSARA_TEST_TRUE(docker->IsMatch("/other/var/log", "a.log"));
+        APSARA_TEST_TRUE(docker->DeleteDockerContainerPath(ContainerJson("id0")));
+        APSARA_TEST_EQUAL(docker->mDockerContainerPaths->size(), 2UL);
+        APSARA_TEST_TRUE(docker->GetContainerPathByID("id0") == NULL);
+        APSARA_TEST_FALSE(docker->IsMatch("/other/var/log", "a.log"));
+        APSARA_TEST_EQUAL(docker->GetContainerPathByID("id2")->mContainerPath, "/host/id2/var/log");
+        APSARA_TEST_TRUE(docker->IsMatch("/host/id2/var/log", "a.log"));
+        APSARA_TEST_TRUE(docker->IsMatch("/host/id1/var/log", "a.log"));
+    }
+
+private:
+    static std::string ContainerJson(const std::string& id, const std::string& path = "") {
+        Json::Value value;
+        value["ID"] = id;
+        value["Path"] = path.empty() ? "/host/" + id + "/var/log" : path;
+        return value.toStyledString();
+    }
+
+    Config* AddConfig(ConfigPathIndex& index,
+                      const std::string& basePath,
+                      const std::string& filePattern,
+                      bool docker = false) {
+        const std::string name = "config-" + std::to_string(mConfigs.size());
+        mConfigs.emplace_back(
+            new Config(basePath, filePattern, REGEX_LOG, name, "", "project", false, 0, -1, "logstore"));
+        Config* config = mConfigs.back().get();
+        if (docker) {
+            config->SetDockerFileFlag();
+        }
+        index.Add(config);
+        return config;
+    }
+
+    static bool Contains(const std::vector<Config*>& configs, Config* config) {
+        return std::find(configs.begin(), configs.end(), config) != configs.end();
+    }
+
+    std::vector<std::unique_ptr<Config>> mConfigs;
+};
+
+UNIT_TEST_CASE(ConfigPathIndexUnittest, TestCandidates);
+UNIT_TEST_CASE(ConfigPathIndexUnittest, TestDockerConfigAlwaysCandidate);
+UNIT_TEST_CASE(ConfigPathIndexUnittest, TestRemove);
+UNIT_TEST_CASE(ConfigPathIndexUnittest, TestContainerPathIndex);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -458,11 +458,11 @@ void ConfigUpdatorUnittest::TestDirCheckPoint() {
     auto eventDispatcher = EventDispatcher::GetInstance();
     // before update config, check the inotify and timeout?
     for (int i = 0; i < 5; i++) {
-        unordered_map<std::string, int>::iterator pwItr = (eventDispatcher->mPathWdMap).find(mRootDir + dirs[i]);
-        APSARA_TEST_TRUE_DESC((pwItr != eventDispatcher->mPathWdMap.end()) == isInotify[i],
-                              "Inotify error:" + mRootDir + dirs[i]);
-        if (pwItr != eventDispatcher->mPathWdMap.end()) {
-            unordered_map<int, time_t>::iterator wuItr = eventDispatcher->mWdUpdateTimeMap.find(pwItr->second);
+        int wd;
+        bool registered = eventDispatcher->mPathTrie.Find(mRootDir + dirs[i], wd);
+        APSARA_TEST_TRUE_DESC(registered == isInotify[i], "Inotify error:" + mRootDir + dirs[i]);
+        if (registered) {
+            unordered_map<int, time_t>::iterator wuItr = eventDispatcher->mWdUpdateTimeMap.find(wd);
             APSARA_TEST_TRUE_DESC((wuItr != eventDispatcher->mWdUpdateTimeMap.end()) == isTimeout[i],
                                   "watchout error:" + mRootDir + dirs[i]);
         } else {
@@ -484,11 +484,11 @@ void ConfigUpdatorUnittest::TestDirCheckPoint() {
 
     // after update config, check the inotify and timeout again
     for (int i = 0; i < 5; i++) {
-        unordered_map<std::string, int>::iterator pwItr = (eventDispatcher->mPathWdMap).find(mRootDir + dirs[i]);
-        APSARA_TEST_TRUE_DESC((pwItr != eventDispatcher->mPathWdMap.end()) == isInotify[i],
-                              "Inotify error:" + mRootDir + dirs[i]);
-        if (pwItr != eventDispatcher->mPathWdMap.end()) {
-            unordered_map<int, time_t>::iterator wuItr = eventDispatcher->mWdUpdateTimeMap.find(pwItr->second);
+        int wd;
+        bool registered = eventDispatcher->mPathTrie.Find(mRootDir + dirs[i], wd);
+        APSARA_TEST_TRUE_DESC(registered == isInotify[i], "Inotify error:" + mRootDir + dirs[i]);
+        if (registered) {
+            unordered_map<int, time_t>::iterator wuItr = eventDispatcher->mWdUpdateTimeMap.find(wd);
             APSARA_TEST_TRUE_DESC((wuItr != eventDispatcher->mWdUpdateTimeMap.end()) == isTimeout[i],
                                   "watchout error:" + mRootDir + dirs[i]);
         } else {
@@ -2487,14 +2487,14 @@ void ConfigUpdatorUnittest::TestValidWildcardPath() {
     sleep(LogInput::GetInstance()->mCheckBaseDirInterval);
 #endif
     usleep(100 * 1000);
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[0]) == eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[1]) == eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[2]) != eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[3]) != eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[4]) == eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[5]) != eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[6]) == eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[7]) == eventDispatcher->mPathWdMap.end());
+    APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[0]).c_str()));
+    APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[1]).c_str()));
+    APSARA_TEST_TRUE(eventDispatcher->IsRegistered((mRootDir + dirs[2]).c_str()));
+    APSARA_TEST_TRUE(eventDispatcher->IsRegistered((mRootDir + dirs[3]).c_str()));
+    APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[4]).c_str()));
+    APSARA_TEST_TRUE(eventDispatcher->IsRegistered((mRootDir + dirs[5]).c_str()));
+    APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[6]).c_str()));
+    APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[7]).c_str()));
     for (int i = 0; i < 20; ++i) {
         for (int j = 0; j < 8; ++j)
             DumpLog(10, mRootDir + dirs[j], APSARA_LOG);
@@ -2522,14 +2522,14 @@ void ConfigUpdatorUnittest::TestValidWildcardPath() {
     bfs::remove_all(mRootDir + dirs[3]);
 #endif
     // remove will not work when file is open
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[0]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[1]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[2]) != eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[3]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[4]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[5]) != eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[6]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[7]) == eventDispatcher->mPathWdMap.end());
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[0]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[1]).c_str()));
+    // APSARA_TEST_TRUE(eventDispatcher->IsRegistered((mRootDir + dirs[2]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[3]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[4]).c_str()));
+    // APSARA_TEST_TRUE(eventDispatcher->IsRegistered((mRootDir + dirs[5]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[6]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[7]).c_str()));
     for (int i = 0; i < 20; ++i) {
         for (int j = 0; j < 8; ++j)
             DumpLog(10, mRootDir + dirs[j], APSARA_LOG);
@@ -2563,14 +2563,14 @@ void ConfigUpdatorUnittest::TestValidWildcardPath() {
     }
     usleep(100 * 1000);
     // remove will not work when file is open
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[0]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[1]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[2]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[3]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[4]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[5]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[6]) == eventDispatcher->mPathWdMap.end());
-    // APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[7]) == eventDispatcher->mPathWdMap.end());
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[0]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[1]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[2]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[3]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[4]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[5]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[6]).c_str()));
+    // APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[7]).c_str()));
     for (int i = 0; i < 20; ++i) {
         for (int j = 0; j < 8; ++j)
             DumpLog(10, mRootDir + dirs[j], APSARA_LOG);
@@ -2600,14 +2600,14 @@ void ConfigUpdatorUnittest::TestValidWildcardPath() {
         }
     }
     sleep(INT32_FLAG(check_base_dir_interval) + 1);
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[0]) == eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[1]) == eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[2]) != eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[3]) != eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[4]) == eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[5]) != eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[6]) == eventDispatcher->mPathWdMap.end());
-    APSARA_TEST_TRUE(eventDispatcher->mPathWdMap.find(mRootDir + dirs[7]) == eventDispatcher->mPathWdMap.end());
+    APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[0]).c_str()));
+    APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[1]).c_str()));
+    APSARA_TEST_TRUE(eventDispatcher->IsRegistered((mRootDir + dirs[2]).c_str()));
+    APSARA_TEST_TRUE(eventDispatcher->IsRegistered((mRootDir + dirs[3]).c_str()));
+    APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[4]).c_str()));
+    APSARA_TEST_TRUE(eventDispatcher->IsRegistered((mRootDir + dirs[5]).c_str()));
+    APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[6]).c_str()));
+    APSARA_TEST_TRUE(!eventDispatcher->IsRegistered((mRootDir + dirs[7]).c_str()));
     for (int i = 0; i < 20; ++i) {
         for (int j = 0; j < 8; ++j)
             DumpLog(10, mRootDir + dirs[j], APSARA_LOG);
@@ -2673,22 +2673,14 @@ void ConfigUpdatorUnittest::TestValidWildcardPath2() {
     sleep(LogInput::GetInstance()->mCheckBaseDirInterval);
 #endif
     usleep(100 * 1000);
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mRootDir + dirs[0])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mRootDir + dirs[1])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mRootDir + dirs[2])
-                     != EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mRootDir + dirs[3])
-                     != EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mRootDir + dirs[4])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mRootDir + dirs[5])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mRootDir + dirs[6])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mRootDir + dirs[7])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered((mRootDir + dirs[0]).c_str()));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered((mRootDir + dirs[1]).c_str()));
+    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->IsRegistered((mRootDir + dirs[2]).c_str()));
+    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->IsRegistered((mRootDir + dirs[3]).c_str()));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered((mRootDir + dirs[4]).c_str()));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered((mRootDir + dirs[5]).c_str()));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered((mRootDir + dirs[6]).c_str()));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered((mRootDir + dirs[7]).c_str()));
     for (int i = 0; i < 20; ++i) {
         for (int j = 0; j < 8; ++j)
             DumpLog(10, mRootDir + dirs[j], APSARA_LOG);
@@ -2769,10 +2761,8 @@ void ConfigUpdatorUnittest::TestContainerModeNormal() {
     APSARA_TEST_EQUAL(sProjectNameCountMap["1000000_proj"], 100);
     APSARA_TEST_EQUAL(sProjectNameCountMap["8000000_proj"], 100);
 
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find("/apsara_log")
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find("comm")
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered("/apsara_log"));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered("comm"));
 
     // check app config
     AppConfig* pAppConfig = AppConfig::GetInstance();
@@ -2887,22 +2877,14 @@ void ConfigUpdatorUnittest::TestContainerModeWildcardConfig() {
     cout << "mkdir -p " << mountDirs[3] << endl;
     cout << "mkdir -p " << mountDirs[4] << endl;
     usleep(100 * 1000);
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mountDirs[0])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mountDirs[1])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mountDirs[2])
-                     != EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mountDirs[3])
-                     != EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mountDirs[4])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mountDirs[5])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mountDirs[6])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find(mountDirs[7])
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered(mountDirs[0].c_str()));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered(mountDirs[1].c_str()));
+    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->IsRegistered(mountDirs[2].c_str()));
+    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->IsRegistered(mountDirs[3].c_str()));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered(mountDirs[4].c_str()));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered(mountDirs[5].c_str()));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered(mountDirs[6].c_str()));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered(mountDirs[7].c_str()));
     for (int i = 0; i < 20; ++i) {
         for (int j = 0; j < 8; ++j)
             DumpLog(10, mountDirs[j], APSARA_LOG);
@@ -2979,10 +2961,8 @@ void ConfigUpdatorUnittest::TestContainerModeConfigUpdate() {
     APSARA_TEST_EQUAL(sProjectNameCountMap["1000000_proj"], 100);
     APSARA_TEST_EQUAL(sProjectNameCountMap["8000000_proj"], 100);
 
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find("/apsara_log")
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
-    APSARA_TEST_TRUE(EventDispatcher::GetInstance()->mPathWdMap.find("comm")
-                     == EventDispatcher::GetInstance()->mPathWdMap.end());
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered("/apsara_log"));
+    APSARA_TEST_TRUE(!EventDispatcher::GetInstance()->IsRegistered("comm"));
 
 
     // check config update
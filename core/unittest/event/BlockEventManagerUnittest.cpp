@@ -0,0 +1,117 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <vector>
+#include "common/Flags.h"
+#include "event/BlockEventManager.h"
+#include "polling/PollingEventQueue.h"
+
+DECLARE_FLAG_INT32(debug_logprocess_queue_flag);
+
+namespace logtail {
+
+class BlockEventManagerUnittest : public ::testing::Test {
+public:
+    static void ClearPollingEvents() {
+        std::vector<Event*> events;
+        PollingEventQueue::GetInstance()->PopAllEvents(events);
+        for (auto ev : events) {
+            delete ev;
+        }
+    }
+
+    void SetUp() override {
+        ClearPollingEvents();
+        mManager = BlockedEventManager::GetInstance();
+        // Drain the trigger left by other cases.
+        mManager->WaitFeedBack(0);
+    }
+
+    void TearDown() override {
+        INT32_FLAG(debug_logprocess_queue_flag) = 0;
+        ClearPollingEvents();
+    }
+
+    void TestFeedBackWakesBlockedEvents() {
+        INT32_FLAG(debug_logprocess_queue_flag) = 2; // queue is invalid
+        Event event("/source", "object", EVENT_MODIFY, 0);
+        mManager->UpdateBlockEvent(1, "config", event, DevInode(1, 1), time(NULL));
+        APSARA_TEST_FALSE(mManager->WaitFeedBack(0));
+        APSARA_TEST_EQUAL(mManager->mBlockEventMap.size(), 1UL);
+
+        // Event of other logstore is kept.
+        mManager->FeedBack(2);
+        APSARA_TEST_EQUAL(mManager->mBlockEventMap.size(), 1UL);
+
+        mManager->FeedBack(1);
+        APSARA_TEST_TRUE(mManager->WaitFeedBack(0));
+        APSARA_TEST_EQUAL(mManager->mBlockEventMap.size(), 0UL);
+        std::vector<Event*> events;
+        PollingEventQueue::GetInstance()->PopAllEvents(events);
+        APSARA_TEST_EQUAL(events.size(), 1UL);
+        for (auto ev : events) {
+            delete ev;
+        }
+    }
+
+    void TestFeedBackIfDrainedBeforeBlocked() {
+        // The queue drains before the event is added, it must not wait for timeout.
+        INT32_FLAG(debug_logprocess_queue_flag) = 1;
+        Event event("/source", "object", EVENT_MODIFY, 0);
+        mManager->UpdateBlockEvent(1, "config", event, DevInode(1, 2), time(NULL));
+        APSARA_TEST_TRUE(mManager->WaitFeedBack(0));
+        APSARA_TEST_EQUAL(mManager->mBlockEventMap.size(), 0UL);
+        std::vector<Event*> events;
+        PollingEventQueue::GetInstance()->PopAllEvents(events);
+        APSARA_TEST_EQUAL(events.size(), 1UL);
+        for (auto ev : events) {
+            delete ev;
+        }
+    }
+
+    void TestMemoryRecoveredEvents() {
+        INT32_FLAG(debug_logprocess_queue_flag) = 2;
+        Event event("/source", "object", EVENT_MODIFY, 0);
+        mManager->UpdateBlockEvent(1, "config", event, DevInode(1, 3), time(NULL));
+        mManager->mMemoryBlocked = true;
+
+        std::vector<Event*> events;
+        mManager->GetMemoryRecoveredEvent(events);
+        // Queue is still invalid.
+        APSARA_TEST_EQUAL(events.size(), 0UL);
+        APSARA_TEST_EQUAL(mManager->mBlockEventMap.size(), 1UL);
+
+        INT32_FLAG(debug_logprocess_queue_flag) = 1;
+        mManager->mMemoryBlocked = true;
+        mManager->GetMemoryRecoveredEvent(events);
+        APSARA_TEST_EQUAL(events.size(), 1UL);
+        APSARA_TEST_EQUAL(mManager->mBlockEventMap.size(), 0UL);
+        APSARA_TEST_FALSE(mManager->mMemoryBlocked.load());
+        for (auto ev : events) {
+            delete ev;
+        }
+    }
+
+private:
+    BlockedEventManager* mManager = NULL;
+};
+
+UNIT_TEST_CASE(BlockEventManagerUnittest, TestFeedBackWakesBlockedEvents);
+UNIT_TEST_CASE(BlockEventManagerUnittest, TestFeedBackIfDrainedBeforeBlocked);
+UNIT_TEST_CASE(BlockEventManagerUnittest, TestMemoryRecoveredEvents);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -29,6 +29,8 @@ using namespace std;
 DECLARE_FLAG_STRING(ilogtail_config);
 DECLARE_FLAG_STRING(user_log_config);
 DECLARE_FLAG_INT32(batch_send_interval);
+DECLARE_FLAG_BOOL(event_priority_enable);
+DECLARE_FLAG_BOOL(at_risk_read_priority_enable);
 
 namespace logtail {
 class LogInputUnittest : public ::testing::Test {
@@ -38,6 +40,12 @@ protected:
         LogInput::GetInstance()->mModifyEventSet.clear();
         std::queue<Event*> empty;
         std::swap(LogInput::GetInstance()->mInotifyEventQueue, empty);
+        std::queue<Event*> emptyPriority;
+        std::swap(LogInput::GetInstance()->mPriorityEventQueue, emptyPriority);
+        std::queue<Event*> emptyAtRisk;
+        std::swap(LogInput::GetInstance()->mAtRiskEventQueue, emptyAtRisk);
+        BOOL_FLAG(event_priority_enable) = false;
+        BOOL_FLAG(at_risk_read_priority_enable) = false;
     }
 
 public:
@@ -65,10 +73,64 @@ public:
         Event* ev = LogInput::GetInstance()->PopEventQueue();
         delete ev;
     }
+
+    void TestEventPriority() {
+        LOG_INFO(sLogger, ("TestEventPriority() begin", time(NULL)));
+        BOOL_FLAG(event_priority_enable) = true;
+        std::vector<Event*> events;
+        events.push_back(new Event("/source", "object1", EVENT_MODIFY, 0));
+        events.push_back(new Event("/source", "object2", EVENT_CREATE, 0));
+        events.push_back(new Event("/source", "object1", EVENT_MODIFY, 0));
+        events.push_back(new Event("/source", "object3", EVENT_MODIFY, 0));
+        events.push_back(new Event("/source", "object1", EVENT_DELETE, 0));
+        std::vector<Event*> expected = {events[1], events[4], events[0], events[3]};
+        LogInput::GetInstance()->PushEventQueue(events);
+        // The duplicated MODIFY event is deleted.
+        APSARA_TEST_TRUE(events[2] == NULL);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            Event* ev = LogInput::GetInstance()->PopEventQueue();
+            APSARA_TEST_EQUAL_FATAL(ev, expected[i]);
+            delete ev;
+        }
+        APSARA_TEST_TRUE(LogInput::GetInstance()->PopEventQueue() == NULL);
+        APSARA_TEST_TRUE(LogInput::GetInstance()->mModifyEventSet.empty());
+    }
+
+    void TestAtRiskEventPriority() {
+        LOG_INFO(sLogger, ("TestAtRiskEventPriority() begin", time(NULL)));
+        BOOL_FLAG(event_priority_enable) = true;
+        BOOL_FLAG(at_risk_read_priority_enable) = true;
+        std::vector<Event*> events;
+        events.push_back(new Event("/source", "object1", EVENT_MODIFY, 0));
+        events.push_back(new Event("/source", "object2", EVENT_MODIFY, 0));
+        events[1]->SetAtRisk(true);
+        events.push_back(new Event("/source", "object3", EVENT_CREATE, 0));
+        std::vector<Event*> expected = {events[2], events[1], events[0]};
+        LogInput::GetInstance()->PushEventQueue(events);
+        for (size_t i = 0; i < expected.size(); ++i) {
+            Event* ev = LogInput::GetInstance()->PopEventQueue();
+            APSARA_TEST_EQUAL_FATAL(ev, expected[i]);
+            delete ev;
+        }
+
+        // At risk events are queued as others if it is disabled.
+        BOOL_FLAG(at_risk_read_priority_enable) = false;
+        Event* normal = new Event("/source", "object1", EVENT_MODIFY, 0);
+        Event* atRisk = new Event("/source", "object2", EVENT_MODIFY, 0);
+        atRisk->SetAtRisk(true);
+        LogInput::GetInstance()->PushEventQueue(normal);
+        LogInput::GetInstance()->PushEventQueue(atRisk);
+        APSARA_TEST_EQUAL_FATAL(LogInput::GetInstance()->PopEventQueue(), normal);
+        APSARA_TEST_EQUAL_FATAL(LogInput::GetInstance()->PopEventQueue(), atRisk);
+        delete normal;
+        delete atRisk;
+    }
 };
 
 APSARA_UNIT_TEST_CASE(LogInputUnittest, TestTryReadEventsPollingEvents, 0);
 APSARA_UNIT_TEST_CASE(LogInputUnittest, TestTryReadEventsDuplicatedEvents, 0);
+APSARA_UNIT_TEST_CASE(LogInputUnittest, TestEventPriority, 0);
+APSARA_UNIT_TEST_CASE(LogInputUnittest, TestAtRiskEventPriority, 0);
 } // end of namespace logtail
 
 int main(int argc, char** argv) {
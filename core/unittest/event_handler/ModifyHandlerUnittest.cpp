@@ -23,11 +23,14 @@
 #include "common/FileSystemUtil.h"
 #include "event/Event.h"
 #include "event_handler/EventHandler.h"
+#include "checkpoint/CheckPointManager.h"
 using namespace std;
 
 DECLARE_FLAG_STRING(ilogtail_config);
 DECLARE_FLAG_STRING(user_log_config);
 DECLARE_FLAG_INT32(batch_send_interval);
+DECLARE_FLAG_INT32(logreader_hibernate_interval);
+DECLARE_FLAG_INT32(read_rate_limit_max_delay);
 
 namespace logtail {
 class ModifyHandlerUnittest : public ::testing::Test {
@@ -64,7 +67,7 @@ protected:
         mHandlerPtr.reset(new ModifyHandler("", nullptr));
         mHandlerPtr->mNameReaderMap[gLogName] = readerPtrArray;
         mReaderPtr->SetReaderArray(&mHandlerPtr->mNameReaderMap[gLogName]);
-        mHandlerPtr->mDevInodeReaderMap[mReaderPtr->mDevInode] = mReaderPtr;
+        mHandlerPtr->AddActiveReader(mReaderPtr->mDevInode, mReaderPtr);
     }
     void TearDown() override { bfs::remove_all(gRootDir); }
     static std::string gRootDir;
@@ -108,6 +111,114 @@ public:
         APSARA_TEST_TRUE_FATAL(mReaderPtr->IsReadToEnd());
         APSARA_TEST_TRUE_FATAL(!mReaderPtr->mLogFileOp.IsOpen());
     }
+
+    void TestHibernateIdleReader() {
+        LogBuffer* logbuf = nullptr;
+        APSARA_TEST_TRUE_FATAL(!mReaderPtr->ReadLog(logbuf));
+        delete logbuf;
+        mReaderPtr->CloseFilePtr();
+        const DevInode devInode = mReaderPtr->mDevInode;
+        const int64_t filePos = mReaderPtr->GetLastFilePos();
+        mReaderPtr->mLastUpdateTime = time(NULL) - INT32_FLAG(logreader_hibernate_interval) - 1;
+        // Not hibernated if others still hold the reader.
+        mHandlerPtr->HandleTimeOut();
+        APSARA_TEST_EQUAL(mHandlerPtr->mHibernatedReaderMap.size(), 0UL);
+        mReaderPtr.reset();
+        mHandlerPtr->HandleTimeOut();
+        APSARA_TEST_EQUAL(mHandlerPtr->mHibernatedReaderMap.size(), 1UL);
+        APSARA_TEST_EQUAL(mHandlerPtr->mDevInodeReaderMap.size(), 0UL);
+        APSARA_TEST_EQUAL(mHandlerPtr->mNameReaderMap.size(), 0UL);
+        APSARA_TEST_EQUAL(FileReaderIndex::GetInstance()->GetStates(devInode, mHandlerPtr.get()),
+                          (uint32_t)FileReaderIndex::READER_HIBERNATED);
+
+        // Hibernated readers are dumped as checkpoints.
+        CheckPointManager* checkPointManager = CheckPointManager::Instance();
+        CheckPointPtr checkPoint;
+        mHandlerPtr->DumpReaderMeta(false, false);
+        APSARA_TEST_TRUE_FATAL(checkPointManager->GetCheckPoint(devInode, "", checkPoint));
+        APSARA_TEST_EQUAL(checkPoint->mOffset, filePos);
+        APSARA_TEST_EQUAL(checkPoint->mFileName, gRootDir + PATH_SEPARATOR + gLogName);
+        checkPointManager->DeleteCheckPoint(devInode, "");
+
+        // Woken up by event of the file.
+        APSARA_TEST_TRUE(mHandlerPtr->WakeUpReader(devInode));
+        APSARA_TEST_EQUAL(mHandlerPtr->mHibernatedReaderMap.size(), 0UL);
+        APSARA_TEST_EQUAL(FileReaderIndex::GetInstance()->GetStates(devInode, mHandlerPtr.get()), 0U);
+        APSARA_TEST_TRUE_FATAL(checkPointManager->GetCheckPoint(devInode, "", checkPoint));
+        APSARA_TEST_EQUAL(checkPoint->mOffset, filePos);
+        APSARA_TEST_EQUAL(checkPoint->mFileOpenFlag, 1);
+        checkPointManager->DeleteCheckPoint(devInode, "");
+        APSARA_TEST_FALSE(mHandlerPtr->WakeUpReader(devInode));
+    }
+
+    void TestReaderIndex() {
+        FileReaderIndex* index = FileReaderIndex::GetInstance();
+        const DevInode devInode = mReaderPtr->mDevInode;
+        APSARA_TEST_EQUAL(index->GetStates(devInode, mHandlerPtr.get()), (uint32_t)FileReaderIndex::READER_ACTIVE);
+
+        // Another config reads the same file.
+        std::unique_ptr<ModifyHandler> otherHandler(new ModifyHandler("other", nullptr));
+        otherHandler->AddActiveReader(devInode, mReaderPtr);
+        otherHandler->MoveToRotatorReader(mReaderPtr);
+        APSARA_TEST_EQUAL(index->GetStates(devInode, otherHandler.get()), (uint32_t)FileReaderIndex::READER_ROTATOR);
+        APSARA_TEST_EQUAL(index->GetStates(devInode, mHandlerPtr.get()), (uint32_t)FileReaderIndex::READER_ACTIVE);
+        APSARA_TEST_EQUAL(index->mEntries[devInode].size(), 2UL);
+
+        // Entries are removed with their handler.
+        otherHandler.reset();
+        APSARA_TEST_EQUAL(index->mEntries[devInode].size(), 1UL);
+        mHandlerPtr->EraseActiveReader(devInode);
+        APSARA_TEST_EQUAL(index->GetStates(devInode, mHandlerPtr.get()), 0U);
+        APSARA_TEST_EQUAL(index->GetFileCount(), 0UL);
+    }
+
+    void TestParallelRotatedRead() {
+        // A rotated file waits before the live one in the queue.
+        const std::string rotatedName = gLogName + ".1";
+        std::ofstream writer((gRootDir + PATH_SEPARATOR + rotatedName).c_str(), fstream::out);
+        writer << "a rotated log\n";
+        writer.close();
+        LogFileReaderPtr rotatedReader = std::make_shared<CommonRegLogFileReader>(
+            "project-0", "logstore-0", gRootDir, rotatedName, INT32_FLAG(default_tail_limit_kb), "", "", "");
+        rotatedReader->UpdateReaderManual();
+        LogFileReaderPtrArray& readerArray = mHandlerPtr->mNameReaderMap[gLogName];
+        readerArray.push_front(rotatedReader);
+        rotatedReader->SetReaderArray(&readerArray);
+        mHandlerPtr->AddActiveReader(rotatedReader->mDevInode, rotatedReader);
+        mHandlerPtr->mParallelRotatedRead = true;
+
+        // The live file is read at once, and a catch-up lane is started for the rotated one.
+        Event event(gRootDir, gLogName, EVENT_MODIFY, 0, 0, mReaderPtr->mDevInode.dev, mReaderPtr->mDevInode.inode);
+        mHandlerPtr->Handle(event);
+        APSARA_TEST_TRUE(mReaderPtr->IsReadToEnd());
+        APSARA_TEST_EQUAL(rotatedReader->GetLastFilePos(), (int64_t)0);
+        APSARA_TEST_EQUAL(readerArray.size(), 2UL);
+        APSARA_TEST_EQUAL(mHandlerPtr->mCatchUpLaneTimes.count(rotatedReader->mDevInode), 1UL);
+    }
+
+    void TestReadRateDelay() {
+        // Unlimited by default.
+        APSARA_TEST_EQUAL(mHandlerPtr->GetReadRateDelay(*mReaderPtr, 1000), 0UL);
+
+        TokenBucket& fileBucket = mReaderPtr->GetReadRateBucket();
+        mReaderPtr->SetReadRateLimit(1000);
+        fileBucket.Refill(1000);
+        fileBucket.Consume(1500);
+        // 500 bytes of debt are paid back in 500ms.
+        APSARA_TEST_EQUAL(mHandlerPtr->GetReadRateDelay(*mReaderPtr, 1000), 501UL);
+        APSARA_TEST_EQUAL(mHandlerPtr->GetReadRateDelay(*mReaderPtr, 1499), 10UL);
+        APSARA_TEST_EQUAL(mHandlerPtr->GetReadRateDelay(*mReaderPtr, 1501), 0UL);
+
+        // The config budget is shared by all files, the longer delay is used.
+        mHandlerPtr->mConfigReadRateBucket.SetRate(100);
+        mHandlerPtr->mConfigReadRateBucket.Refill(1501);
+        mHandlerPtr->mConfigReadRateBucket.Consume(150);
+        APSARA_TEST_EQUAL(mHandlerPtr->GetReadRateDelay(*mReaderPtr, 1501), 501UL);
+        // Capped by read_rate_limit_max_delay.
+        mHandlerPtr->mConfigReadRateBucket.Consume(1000);
+        APSARA_TEST_EQUAL(mHandlerPtr->GetReadRateDelay(*mReaderPtr, 1501),
+                          static_cast<uint64_t>(INT32_FLAG(read_rate_limit_max_delay)));
+    }
 };
 
 std::string ModifyHandlerUnittest::gRootDir;
@@ -116,6 +227,10 @@ std::string ModifyHandlerUnittest::gLogName;
 APSARA_UNIT_TEST_CASE(ModifyHandlerUnittest, TestHandleContainerStoppedEventWhenReadToEnd, 0);
 APSARA_UNIT_TEST_CASE(ModifyHandlerUnittest, TestHandleContainerStoppedEventWhenNotReadToEnd, 0);
 APSARA_UNIT_TEST_CASE(ModifyHandlerUnittest, TestHandleModifyEventWhenContainerStopped, 0);
+APSARA_UNIT_TEST_CASE(ModifyHandlerUnittest, TestHibernateIdleReader, 0);
+APSARA_UNIT_TEST_CASE(ModifyHandlerUnittest, TestReaderIndex, 0);
+APSARA_UNIT_TEST_CASE(ModifyHandlerUnittest, TestParallelRotatedRead, 0);
+APSARA_UNIT_TEST_CASE(ModifyHandlerUnittest, TestReadRateDelay, 0);
 } // end of namespace logtail
 
 int main(int argc, char** argv) {
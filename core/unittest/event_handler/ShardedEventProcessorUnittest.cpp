@@ -0,0 +1,88 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include "event/Event.h"
+#include "event_handler/EventHandler.h"
+#include "event_handler/ShardedEventProcessor.h"
+
+namespace logtail {
+
+class RecordEventHandler : public EventHandler {
+public:
+    void Handle(const Event& event) override {
+        std::lock_guard<std::mutex> lock(mMux);
+        mObjects.push_back(event.GetObject());
+        mThreadIds.insert(std::this_thread::get_id());
+        mInWorkerThread = mInWorkerThread && ShardedEventProcessor::IsWorkerThread();
+    }
+    void HandleTimeOut() override {}
+    bool DumpReaderMeta(bool isRotatorReader, bool checkConfigFlag) override { return true; }
+
+    std::mutex mMux;
+    std::vector<std::string> mObjects;
+    std::set<std::thread::id> mThreadIds;
+    bool mInWorkerThread = true;
+};
+
+class ShardedEventProcessorUnittest : public ::testing::Test {
+public:
+    void TestProcess() {
+        ShardedEventProcessor processor(4);
+        APSARA_TEST_EQUAL(processor.GetThreadCount(), 4UL);
+        APSARA_TEST_FALSE(ShardedEventProcessor::IsWorkerThread());
+
+        std::vector<std::unique_ptr<RecordEventHandler>> handlers;
+        for (int i = 0; i < 16; ++i) {
+            handlers.emplace_back(new RecordEventHandler);
+        }
+        for (int round = 0; round < 3; ++round) {
+            std::vector<std::unique_ptr<Event>> events;
+            std::vector<ShardedEventProcessor::Task> tasks;
+            for (int i = 0; i < 320; ++i) {
+                events.emplace_back(new Event("/source", std::to_string(i), EVENT_MODIFY, 0));
+                tasks.push_back(std::make_pair(handlers[i % handlers.size()].get(), events.back().get()));
+            }
+            processor.Process(tasks);
+        }
+
+        for (size_t i = 0; i < handlers.size(); ++i) {
+            RecordEventHandler& handler = *handlers[i];
+            APSARA_TEST_TRUE(handler.mInWorkerThread);
+            // Events of a handler are handled by one thread in order.
+            APSARA_TEST_EQUAL(handler.mThreadIds.size(), 1UL);
+            APSARA_TEST_EQUAL_FATAL(handler.mObjects.size(), 60UL);
+            for (size_t j = 0; j < handler.mObjects.size(); ++j) {
+                APSARA_TEST_EQUAL(handler.mObjects[j], std::to_string(i + (j % 20) * handlers.size()));
+            }
+        }
+    }
+
+    void TestProcessEmpty() {
+        ShardedEventProcessor processor(2);
+        processor.Process(std::vector<ShardedEventProcessor::Task>());
+    }
+};
+
+UNIT_TEST_CASE(ShardedEventProcessorUnittest, TestProcess);
+UNIT_TEST_CASE(ShardedEventProcessorUnittest, TestProcessEmpty);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -386,6 +386,37 @@ public:
         printf("%d %d \n", (int)(c3 - c2), (int)(c2 - c1));
         EXPECT_EQ(rawLogStr, logStr);
     }
+
+    void TestWireLogGroup() {
+        LogGroup loggroup;
+        Log* log = loggroup.add_logs();
+        log->set_time(time(NULL));
+        Log_Content* kv = log->add_contents();
+        kv->set_key("key1");
+        kv->set_value("value");
+        loggroup.set_topic("topic");
+        string logStr;
+        EXPECT_EQ(loggroup.AppendToString(&logStr), true);
+
+        string category = "none";
+        EXPECT_EQ(RawLogGroup::ReadCategory(logStr.data(), logStr.size(), category), true);
+        EXPECT_EQ(category, "");
+        loggroup.set_category("logstore");
+        logStr.clear();
+        loggroup.AppendToString(&logStr);
+        EXPECT_EQ(RawLogGroup::ReadCategory(logStr.data(), logStr.size(), category), true);
+        EXPECT_EQ(category, "logstore");
+        EXPECT_EQ(RawLogGroup::ReadCategory(logStr.data(), logStr.size() - 1, category), false);
+
+        RawLogGroup::AppendLogTag(&logStr, "tagkey1", "tagvalue1");
+        LogGroup parsed;
+        EXPECT_EQ(parsed.ParseFromString(logStr), true);
+        EXPECT_EQ(parsed.category(), "logstore");
+        EXPECT_EQ(parsed.logs_size(), 1);
+        EXPECT_EQ(parsed.logtags_size(), 1);
+        EXPECT_EQ(parsed.logtags(0).key(), "tagkey1");
+        EXPECT_EQ(parsed.logtags(0).value(), "tagvalue1");
+    }
 };
 
 APSARA_UNIT_TEST_CASE(PBUnittest, TestFullWrite, 0);
@@ -396,6 +427,7 @@ APSARA_UNIT_TEST_CASE(PBUnittest, TestBigLog, 0);
 APSARA_UNIT_TEST_CASE(PBUnittest, TestLogGroup, 0);
 APSARA_UNIT_TEST_CASE(PBUnittest, TestNoOptionLogGroup, 0);
 APSARA_UNIT_TEST_CASE(PBUnittest, TestMultiLog, 0);
+APSARA_UNIT_TEST_CASE(PBUnittest, TestWireLogGroup, 0);
 
 } // namespace logtail
 
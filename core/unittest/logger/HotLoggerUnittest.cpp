@@ -0,0 +1,138 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <thread>
+#include <vector>
+#include "logger/HotLogger.h"
+
+DECLARE_FLAG_INT32(hot_log_ring_size);
+
+namespace logtail {
+
+class HotLoggerUnittest : public ::testing::Test {
+public:
+    void SetUp() override { HotLogger::SetMinLevel(HOT_LOG_DEBUG); }
+    void TearDown() override { HotLogger::SetMinLevel(HOT_LOG_INFO); }
+
+    void TestFormat() {
+        std::string path = "/var/log/a.log";
+        int64_t offset = -1;
+        size_t size = 4096;
+        LOG_HOT_DEBUG("read file:{}\tsize:{}\toffset:{}\tratio:{}\tok:{}", path, size, offset, 0.5, true);
+        // Arguments without placeholder are appended, placeholders without argument are kept.
+        LOG_HOT_INFO("extra", 1, "two");
+        LOG_HOT_INFO("missing:{}");
+        // Compiled out by LOGTAIL_HOT_LOG_MIN_LEVEL.
+        LOG_HOT_TRACE("trace:{}", 1);
+
+        std::vector<std::pair<HotLogLevel, std::string> > lines;
+        APSARA_TEST_EQUAL(Flush(lines), 3UL);
+        APSARA_TEST_EQUAL(lines[0].first, HOT_LOG_DEBUG);
+        APSARA_TEST_EQUAL(GetMessage(lines[0].second),
+                          std::string("read file:/var/log/a.log\tsize:4096\toffset:-1\tratio:0.5\tok:true"));
+        APSARA_TEST_EQUAL(lines[1].first, HOT_LOG_INFO);
+        APSARA_TEST_EQUAL(GetMessage(lines[1].second), std::string("extra 1 two"));
+        APSARA_TEST_EQUAL(GetMessage(lines[2].second), std::string("missing:{}"));
+        APSARA_TEST_TRUE(lines[0].second.find("HotLoggerUnittest.cpp:") == 0);
+
+        // Disabled at runtime.
+        HotLogger::SetMinLevel(HOT_LOG_INFO);
+        LOG_HOT_DEBUG("debug:{}", 1);
+        APSARA_TEST_EQUAL(Flush(lines), 0UL);
+    }
+
+    void TestLongString() {
+        std::string value(1000, 'a');
+        LOG_HOT_DEBUG("value:{}", value);
+        std::vector<std::pair<HotLogLevel, std::string> > lines;
+        APSARA_TEST_EQUAL(Flush(lines), 1UL);
+        APSARA_TEST_EQUAL(GetMessage(lines[0].second), "value:" + value.substr(0, HotLogArg::kMaxStringSize));
+    }
+
+    void TestRingWrap() {
+        HotLogRing ring(1024);
+        static const HotLogFormat sFormat = {HOT_LOG_DEBUG, __FILE__, __LINE__, "index:{}\tname:{}"};
+        std::vector<std::string> messages;
+        auto reader = [&messages](const HotLogFormat*, uint64_t, const std::string& message) {
+            messages.push_back(message);
+        };
+        int written = 0;
+        int dropped = 0;
+        for (int round = 0; round < 20; ++round) {
+            for (int i = 0; i < 30; ++i) {
+                if (ring.Write(&sFormat, 0, {written, "name"})) {
+                    ++written;
+                } else {
+                    ++dropped;
+                }
+            }
+            ring.Read(reader);
+        }
+        // Records of a round can not fit in the ring, the rest are dropped.
+        APSARA_TEST_TRUE(dropped > 0);
+        APSARA_TEST_TRUE(ring.IsEmpty());
+        APSARA_TEST_EQUAL(messages.size(), static_cast<size_t>(written));
+        for (int i = 0; i < written; ++i) {
+            APSARA_TEST_EQUAL_FATAL(messages[i], "index:" + std::to_string(i) + "\tname:name");
+        }
+    }
+
+    void TestMultiThreads() {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([t]() {
+                for (int i = 0; i < 100; ++i) {
+                    LOG_HOT_DEBUG("thread:{}\tindex:{}", t, i);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::vector<std::pair<HotLogLevel, std::string> > lines;
+        APSARA_TEST_EQUAL(Flush(lines) + HotLogger::GetInstance()->GetDroppedCount(), 400UL);
+        // Rings of exited threads are removed after read.
+        APSARA_TEST_EQUAL(Flush(lines), 0UL);
+        std::lock_guard<std::mutex> lock(HotLogger::GetInstance()->mRingMux);
+        APSARA_TEST_EQUAL(HotLogger::GetInstance()->mRings.size(), 1UL);
+    }
+
+private:
+    size_t Flush(std::vector<std::pair<HotLogLevel, std::string> >& lines) {
+        lines.clear();
+        return HotLogger::GetInstance()->Flush(
+            [&lines](HotLogLevel level, const std::string& line) { lines.push_back(std::make_pair(level, line)); });
+    }
+
+    // GetMessage strips the location and the log time of @line.
+    static std::string GetMessage(const std::string& line) {
+        size_t begin = line.find('\t') + 1;
+        size_t end = line.rfind("\tlog_time_us:");
+        return line.substr(begin, end - begin);
+    }
+};
+
+APSARA_UNIT_TEST_CASE(HotLoggerUnittest, TestFormat, 0);
+APSARA_UNIT_TEST_CASE(HotLoggerUnittest, TestLongString, 1);
+APSARA_UNIT_TEST_CASE(HotLoggerUnittest, TestRingWrap, 2);
+APSARA_UNIT_TEST_CASE(HotLoggerUnittest, TestMultiThreads, 3);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
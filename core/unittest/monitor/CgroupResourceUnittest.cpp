@@ -0,0 +1,168 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include <fstream>
+#include "common/FileSystemUtil.h"
+#include "common/RuntimeUtil.h"
+#include "monitor/CgroupResource.h"
+#include "monitor/Monitor.h"
+#include "sender/AdaptiveBatchPolicy.h"
+
+DECLARE_FLAG_BOOL(enable_resource_degradation);
+DECLARE_FLAG_INT32(resource_degradation_recover_interval);
+
+namespace logtail {
+
+static void WriteFile(const std::string& path, const std::string& content) {
+    bfs::create_directories(bfs::path(path).parent_path());
+    std::ofstream fout(path);
+    fout << content;
+}
+
+class CgroupResourceUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mRootDir = (bfs::path(GetProcessExecutionDir()) / "CgroupResourceUnittest").string();
+        if (bfs::exists(mRootDir)) {
+            bfs::remove_all(mRootDir);
+        }
+        bfs::create_directories(mRootDir);
+    }
+
+    void TearDown() override { bfs::remove_all(mRootDir); }
+
+    void TestCgroupV1() {
+        WriteFile(mRootDir + "/self_cgroup", "12:memory:/kubepods/pod1\n4:cpu,cpuacct:/kubepods/pod1\n");
+        const std::string cpuDir = mRootDir + "/fs/cpu,cpuacct/kubepods/pod1";
+        WriteFile(cpuDir + "/cpu.cfs_quota_us", "150000\n");
+        WriteFile(cpuDir + "/cpu.cfs_period_us", "100000\n");
+        // cgroup namespace, the cgroup is mounted at the root.
+        WriteFile(mRootDir + "/fs/memory/memory.limit_in_bytes", "536870912\n");
+        WriteFile(mRootDir + "/fs/memory/memory.usage_in_bytes", "314572800\n");
+        WriteFile(mRootDir + "/fs/memory/memory.stat", "cache 1024\ntotal_inactive_file 104857600\n");
+
+        CgroupResource cgroup;
+        APSARA_TEST_TRUE(cgroup.Init(mRootDir + "/fs", mRootDir + "/self_cgroup"));
+        APSARA_TEST_EQUAL(cgroup.GetVersion(), CgroupResource::CGROUP_V1);
+        APSARA_TEST_EQUAL(cgroup.GetCpuQuotaCores(), 1.5);
+        APSARA_TEST_EQUAL(cgroup.GetMemLimitMb(), 512);
+        APSARA_TEST_EQUAL(cgroup.GetMemUsageMb(), 200);
+
+        // unlimited
+        WriteFile(cpuDir + "/cpu.cfs_quota_us", "-1\n");
+        WriteFile(mRootDir + "/fs/memory/memory.limit_in_bytes", "9223372036854771712\n");
+        APSARA_TEST_TRUE(cgroup.GetCpuQuotaCores() <= 0);
+        APSARA_TEST_EQUAL(cgroup.GetMemLimitMb(), -1);
+    }
+
+    void TestCgroupV2() {
+        WriteFile(mRootDir + "/self_cgroup", "0::/system.slice/ilogtail.service\n");
+        WriteFile(mRootDir + "/fs/cgroup.controllers", "cpu memory\n");
+        const std::string dir = mRootDir + "/fs/system.slice/ilogtail.service";
+        WriteFile(dir + "/cpu.max", "50000 100000\n");
+        WriteFile(dir + "/memory.max", "268435456\n");
+        WriteFile(dir + "/memory.current", "209715200\n");
+        WriteFile(dir + "/memory.stat", "anon 1024\ninactive_file 52428800\n");
+
+        CgroupResource cgroup;
+        APSARA_TEST_TRUE(cgroup.Init(mRootDir + "/fs", mRootDir + "/self_cgroup"));
+        APSARA_TEST_EQUAL(cgroup.GetVersion(), CgroupResource::CGROUP_V2);
+        APSARA_TEST_EQUAL(cgroup.GetCpuQuotaCores(), 0.5);
+        APSARA_TEST_EQUAL(cgroup.GetMemLimitMb(), 256);
+        APSARA_TEST_EQUAL(cgroup.GetMemUsageMb(), 150);
+
+        WriteFile(dir + "/cpu.max", "max 100000\n");
+        WriteFile(dir + "/memory.max", "max\n");
+        APSARA_TEST_TRUE(cgroup.GetCpuQuotaCores() <= 0);
+        APSARA_TEST_EQUAL(cgroup.GetMemLimitMb(), -1);
+    }
+
+    void TestNoCgroup() {
+        CgroupResource cgroup;
+        APSARA_TEST_FALSE(cgroup.Init(mRootDir + "/fs", mRootDir + "/not_exist"));
+        APSARA_TEST_EQUAL(cgroup.GetVersion(), CgroupResource::CGROUP_NONE);
+        APSARA_TEST_TRUE(cgroup.GetCpuQuotaCores() <= 0);
+        APSARA_TEST_EQUAL(cgroup.GetMemLimitMb(), -1);
+        APSARA_TEST_EQUAL(cgroup.GetMemUsageMb(), -1);
+    }
+
+private:
+    std::string mRootDir;
+};
+
+class MonitorDegradeUnittest : public ::testing::Test {
+public:
+    void TestDegradeLevel() {
+        BOOL_FLAG(enable_resource_degradation) = true;
+        INT32_FLAG(resource_degradation_recover_interval) = 10;
+        LogtailMonitor* monitor = LogtailMonitor::Instance();
+        monitor->mCgroupCpuLimit = 0.01;
+        monitor->mCgroupMemLimitMb = 100;
+        monitor->mRealtimeCpuStat.mCpuUsage = 0;
+        monitor->mDegradeLevel = 0;
+
+        // over the soft limit of memory.
+        monitor->mMemStat.mRss = 90;
+        monitor->UpdateDegradeLevel(100);
+        APSARA_TEST_EQUAL(monitor->GetDegradeLevel(), 1);
+        APSARA_TEST_EQUAL(AdaptiveBatchPolicy::GetInstance()->GetScale("region"), 0.5);
+
+        // over the limit, one level per check up to the max.
+        monitor->mMemStat.mRss = 200;
+        for (int32_t i = 0; i < 5; ++i) {
+            monitor->UpdateDegradeLevel(101 + i);
+        }
+        APSARA_TEST_EQUAL(monitor->GetDegradeLevel(), LogtailMonitor::MAX_DEGRADE_LEVEL);
+        APSARA_TEST_TRUE(monitor->GetResourcePressure() >= 2.0);
+
+        // restart is only considered at the max level.
+        monitor->mMemStat.mViolateNum = 0;
+        APSARA_TEST_FALSE(monitor->CheckMemLimit());
+        APSARA_TEST_EQUAL(monitor->mMemStat.mViolateNum, 1);
+
+        // recovers one level per interval below the soft limit.
+        monitor->mMemStat.mRss = 10;
+        monitor->UpdateDegradeLevel(106);
+        APSARA_TEST_EQUAL(monitor->GetDegradeLevel(), LogtailMonitor::MAX_DEGRADE_LEVEL);
+        monitor->UpdateDegradeLevel(115);
+        APSARA_TEST_EQUAL(monitor->GetDegradeLevel(), LogtailMonitor::MAX_DEGRADE_LEVEL - 1);
+        monitor->UpdateDegradeLevel(125);
+        monitor->UpdateDegradeLevel(135);
+        APSARA_TEST_EQUAL(monitor->GetDegradeLevel(), 0);
+        APSARA_TEST_EQUAL(AdaptiveBatchPolicy::GetInstance()->GetScale("region"), 1.0);
+
+        // cpu pressure works in the same way.
+        monitor->mRealtimeCpuStat.mCpuUsage = 0.05;
+        monitor->UpdateDegradeLevel(136);
+        APSARA_TEST_EQUAL(monitor->GetDegradeLevel(), 1);
+
+        monitor->mRealtimeCpuStat.mCpuUsage = 0;
+        monitor->mDegradeLevel = 0;
+        AdaptiveBatchPolicy::GetInstance()->SetResourceScale(1.0);
+        monitor->mCgroupCpuLimit = 0;
+        monitor->mCgroupMemLimitMb = -1;
+        BOOL_FLAG(enable_resource_degradation) = false;
+    }
+};
+
+UNIT_TEST_CASE(CgroupResourceUnittest, TestCgroupV1);
+UNIT_TEST_CASE(CgroupResourceUnittest, TestCgroupV2);
+UNIT_TEST_CASE(CgroupResourceUnittest, TestNoCgroup);
+UNIT_TEST_CASE(MonitorDegradeUnittest, TestDegradeLevel);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
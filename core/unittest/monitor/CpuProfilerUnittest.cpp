@@ -0,0 +1,116 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include <algorithm>
+#include <fstream>
+#include "app_config/AppConfig.h"
+#include "common/FileSystemUtil.h"
+#include "common/RuntimeUtil.h"
+#include "monitor/CpuProfiler.h"
+
+DECLARE_FLAG_STRING(cpu_profiler_control_file);
+
+namespace logtail {
+
+class CpuProfilerUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mRootDir = (bfs::path(GetProcessExecutionDir()) / "CpuProfilerUnittest").string();
+        if (bfs::exists(mRootDir)) {
+            bfs::remove_all(mRootDir);
+        }
+        bfs::create_directories(mRootDir);
+        AppConfig::GetInstance()->SetLogtailSysConfDir(mRootDir + PATH_SEPARATOR);
+    }
+
+    void TearDown() override { bfs::remove_all(mRootDir); }
+
+    void TestProfile() {
+        std::string error;
+        APSARA_TEST_TRUE_FATAL(CpuProfiler::GetInstance()->Start(1, 500, false, error));
+        APSARA_TEST_FALSE(CpuProfiler::GetInstance()->Start(1, 500, false, error));
+        APSARA_TEST_FALSE(error.empty());
+        BusyWait();
+
+        CpuProfiler::Result result = CpuProfiler::GetInstance()->GetLastResult();
+        APSARA_TEST_TRUE(result.mSampleCount > 0);
+        APSARA_TEST_TRUE(result.mStackCount > 0);
+        APSARA_TEST_EQUAL(result.mDroppedCount, 0UL);
+        APSARA_TEST_TRUE_FATAL(bfs::exists(result.mPath));
+        std::ifstream in(result.mPath);
+        std::string line;
+        APSARA_TEST_TRUE(bool(std::getline(in, line)));
+        // Lines are "thread;frames count".
+        APSARA_TEST_TRUE(line.find(';') != std::string::npos);
+        APSARA_TEST_TRUE(line.find(' ') != std::string::npos);
+
+        APSARA_TEST_FALSE(CpuProfiler::GetInstance()->Start(0, 500, false, error));
+        APSARA_TEST_FALSE(CpuProfiler::GetInstance()->Start(1, 5000, false, error));
+    }
+
+    void TestControlFile() {
+        const std::string path = mRootDir + PATH_SEPARATOR + STRING_FLAG(cpu_profiler_control_file);
+        OverwriteFile(path, "invalid");
+        CpuProfiler::GetInstance()->CheckControlFile();
+        APSARA_TEST_FALSE(bfs::exists(path));
+        APSARA_TEST_FALSE(CpuProfiler::GetInstance()->IsRunning());
+
+        OverwriteFile(path, "1 200\n");
+        CpuProfiler::GetInstance()->CheckControlFile();
+        APSARA_TEST_FALSE(bfs::exists(path));
+        APSARA_TEST_TRUE(CpuProfiler::GetInstance()->IsRunning());
+        BusyWait();
+        APSARA_TEST_TRUE(CpuProfiler::GetInstance()->GetLastResult().mSampleCount > 0);
+    }
+
+    void TestFoldStacks() {
+        int a = 0, b = 0, c = 0;
+        std::vector<std::pair<std::string, std::vector<void*>>> stacks{
+            {"t1", {&a, &b}}, {"t2", {&c, &b}}, {"t1", {&a, &b}}, {"t1", {&c}}};
+        CpuProfiler::FoldedStacks folded = CpuProfiler::FoldStacks(stacks);
+        APSARA_TEST_EQUAL_FATAL(folded.size(), 3UL);
+        APSARA_TEST_EQUAL(folded[0].second, 2UL);
+        APSARA_TEST_EQUAL(folded[0].first.find("t1;"), 0UL);
+        APSARA_TEST_EQUAL(std::count(folded[0].first.begin(), folded[0].first.end(), ';'), 2);
+        APSARA_TEST_EQUAL(folded[1].second, 1UL);
+        for (const auto& stack : folded) {
+            APSARA_TEST_EQUAL(stack.first.find(' '), std::string::npos);
+        }
+    }
+
+private:
+    // BusyWait burns CPU on the main thread until the profile is done.
+    void BusyWait() {
+        volatile uint64_t sum = 0;
+        const time_t deadline = time(NULL) + 10;
+        while (CpuProfiler::GetInstance()->IsRunning() && time(NULL) < deadline) {
+            for (int i = 0; i < 100000; ++i) {
+                sum = sum + i;
+            }
+        }
+        APSARA_TEST_FALSE(CpuProfiler::GetInstance()->IsRunning());
+    }
+
+    std::string mRootDir;
+};
+
+UNIT_TEST_CASE(CpuProfilerUnittest, TestProfile);
+UNIT_TEST_CASE(CpuProfilerUnittest, TestControlFile);
+UNIT_TEST_CASE(CpuProfilerUnittest, TestFoldStacks);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,93 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <map>
+#include <thread>
+#include <vector>
+#include "monitor/MetricRegistry.h"
+
+namespace logtail {
+
+class MetricRegistryUnittest : public ::testing::Test {
+public:
+    void TestRegister() {
+        MetricRegistry* registry = MetricRegistry::GetInstance();
+        MetricCounter* counter = registry->RegisterCounter("test_register_total", {{"kind", "a"}});
+        APSARA_TEST_TRUE(counter != nullptr);
+        APSARA_TEST_TRUE(registry->RegisterCounter("test_register_total", {{"kind", "a"}}) == counter);
+        APSARA_TEST_TRUE(registry->RegisterCounter("test_register_total", {{"kind", "b"}}) != counter);
+        // the same name and labels with another type is refused.
+        APSARA_TEST_TRUE(registry->RegisterGauge("test_register_total", {{"kind", "a"}}) == nullptr);
+    }
+
+    void TestConcurrentUpdate() {
+        MetricCounter* counter = MetricRegistry::GetInstance()->RegisterCounter("test_concurrent_total");
+        MetricHistogram* histogram
+            = MetricRegistry::GetInstance()->RegisterHistogram("test_concurrent_latency", {1.0, 10.0});
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([counter, histogram]() {
+                for (int j = 0; j < 1000; ++j) {
+                    counter->Add();
+                    histogram->Observe(j % 20);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        APSARA_TEST_EQUAL(counter->Get(), 4000UL);
+        APSARA_TEST_EQUAL(histogram->GetCount(), 4000UL);
+        // 0 and 1 fall into the first bucket, 2..10 the second and 11..19 the +Inf one.
+        APSARA_TEST_EQUAL(histogram->GetBucketCount(0), 400UL);
+        APSARA_TEST_EQUAL(histogram->GetBucketCount(1), 1800UL);
+        APSARA_TEST_EQUAL(histogram->GetBucketCount(2), 1800UL);
+        APSARA_TEST_EQUAL(histogram->GetSum(), 4 * 50 * 190.0);
+    }
+
+    void TestExport() {
+        MetricRegistry* registry = MetricRegistry::GetInstance();
+        registry->RegisterGauge("test_export_gauge")->Set(1.5);
+        registry->RegisterGauge("test_export_gauge", {{"path", "a\"b"}})->Set(3);
+        MetricHistogram* histogram = registry->RegisterHistogram("test_export_histogram", {5.0});
+        histogram->Observe(1);
+        histogram->Observe(7);
+
+        const std::string text = registry->ToPrometheusText();
+        APSARA_TEST_TRUE(text.find("# TYPE test_export_gauge gauge\ntest_export_gauge 1.500000\n"
+                                   "test_export_gauge{path=\"a\\\"b\"} 3\n")
+                         != std::string::npos);
+        APSARA_TEST_TRUE(text.find("test_export_histogram_bucket{le=\"5\"} 1\n"
+                                   "test_export_histogram_bucket{le=\"+Inf\"} 2\n"
+                                   "test_export_histogram_sum 8\n"
+                                   "test_export_histogram_count 2\n")
+                         != std::string::npos);
+
+        std::map<std::string, std::string> metrics;
+        registry->ExportTo(metrics);
+        APSARA_TEST_EQUAL(metrics["test_export_gauge"], "1.500000");
+        APSARA_TEST_EQUAL(metrics["test_export_gauge{path=a\"b}"], "3");
+        APSARA_TEST_EQUAL(metrics["test_export_histogram"], "5:1,+Inf:1");
+        APSARA_TEST_EQUAL(metrics["test_export_histogram_count"], "2");
+    }
+};
+
+UNIT_TEST_CASE(MetricRegistryUnittest, TestRegister);
+UNIT_TEST_CASE(MetricRegistryUnittest, TestConcurrentUpdate);
+UNIT_TEST_CASE(MetricRegistryUnittest, TestExport);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
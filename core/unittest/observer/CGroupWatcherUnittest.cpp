@@ -0,0 +1,95 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <algorithm>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "metas/CGroupWatcher.h"
+
+namespace logtail {
+
+class CGroupWatcherUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        char dir[] = "/tmp/cgroup_watcher_XXXXXX";
+        APSARA_TEST_TRUE_FATAL(mkdtemp(dir) != nullptr);
+        mRootDir = dir;
+        mkdir((mRootDir + "/kubepods").c_str(), 0755);
+    }
+
+    void TearDown() override {
+        APSARA_TEST_EQUAL(system(("rm -rf " + mRootDir).c_str()), 0);
+    }
+
+    static bool Contains(const std::vector<std::string>& dirs, const std::string& dir) {
+        return std::find(dirs.begin(), dirs.end(), dir) != dirs.end();
+    }
+
+    void TestCreateAndRemove() {
+        CGroupWatcher watcher;
+        APSARA_TEST_TRUE_FATAL(watcher.Init(mRootDir, 100));
+        APSARA_TEST_EQUAL(watcher.GetWatchCount(), 2UL);
+        std::vector<std::string> createdDirs;
+        std::vector<std::string> removedDirs;
+        APSARA_TEST_TRUE(watcher.Poll(createdDirs, removedDirs));
+        APSARA_TEST_TRUE(createdDirs.empty());
+
+        const std::string podDir = mRootDir + "/kubepods/pod1";
+        mkdir(podDir.c_str(), 0755);
+        // created before the pod dir is watched, it's reported by scanning the pod dir.
+        mkdir((podDir + "/container1").c_str(), 0755);
+        APSARA_TEST_TRUE(watcher.Poll(createdDirs, removedDirs));
+        APSARA_TEST_TRUE(Contains(createdDirs, podDir));
+        APSARA_TEST_TRUE(Contains(createdDirs, podDir + "/container1"));
+        APSARA_TEST_EQUAL(watcher.GetWatchCount(), 4UL);
+
+        createdDirs.clear();
+        rmdir((podDir + "/container1").c_str());
+        rmdir(podDir.c_str());
+        APSARA_TEST_TRUE(watcher.Poll(createdDirs, removedDirs));
+        APSARA_TEST_TRUE(Contains(removedDirs, podDir + "/container1"));
+        APSARA_TEST_TRUE(Contains(removedDirs, podDir));
+        // watches of removed dirs are released.
+        APSARA_TEST_EQUAL(watcher.GetWatchCount(), 2UL);
+    }
+
+    void TestMaxWatches() {
+        CGroupWatcher watcher;
+        APSARA_TEST_FALSE(watcher.Init(mRootDir, 1));
+        APSARA_TEST_FALSE(watcher.IsOpen());
+
+        APSARA_TEST_TRUE_FATAL(watcher.Init(mRootDir, 2));
+        mkdir((mRootDir + "/kubepods/pod1").c_str(), 0755);
+        std::vector<std::string> createdDirs;
+        std::vector<std::string> removedDirs;
+        // the new dir cannot be watched, callers must rescan.
+        APSARA_TEST_FALSE(watcher.Poll(createdDirs, removedDirs));
+    }
+
+private:
+    std::string mRootDir;
+};
+
+APSARA_UNIT_TEST_CASE(CGroupWatcherUnittest, TestCreateAndRemove, 0);
+APSARA_UNIT_TEST_CASE(CGroupWatcherUnittest, TestMaxWatches, 0);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
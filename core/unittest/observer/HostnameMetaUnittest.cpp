@@ -34,11 +34,46 @@ public:
             auto key = std::to_string(i);
             APSARA_TEST_TRUE(!cache.Get(key).Host.empty());
         }
-        APSARA_TEST_EQUAL(cache.mData.begin()->first, "6");
+        APSARA_TEST_TRUE(front(cache).Key == ServiceMetaKey::FromString("6"));
         cache.Get("2");
-        APSARA_TEST_EQUAL(cache.mData.begin()->first, "2");
+        APSARA_TEST_TRUE(front(cache).Key == ServiceMetaKey::FromString("2"));
+        APSARA_TEST_EQUAL(cache.Size(), 5UL);
+        APSARA_TEST_EQUAL(cache.mNodes.size(), 5UL);
     }
 
+    void testServiceMetaKey() {
+        ServiceMetaKey v4 = ServiceMetaKey::FromString("10.0.0.1");
+        APSARA_TEST_EQUAL(v4.KeyType, ServiceMetaKey::kIPV4);
+        APSARA_TEST_TRUE(v4 == ServiceMetaKey::FromString("10.0.0.1"));
+        APSARA_TEST_FALSE(v4 == ServiceMetaKey::FromString("10.0.0.2"));
+        ServiceMetaKey v6 = ServiceMetaKey::FromString("fe80::1");
+        APSARA_TEST_EQUAL(v6.KeyType, ServiceMetaKey::kIPV6);
+        APSARA_TEST_TRUE(v6 == ServiceMetaKey::FromString("fe80:0:0::1"));
+        ServiceMetaKey other = ServiceMetaKey::FromString("ip");
+        APSARA_TEST_EQUAL(other.KeyType, ServiceMetaKey::kHashed);
+        APSARA_TEST_FALSE(other == ServiceMetaKey::FromString("ip2"));
+    }
+
+    void testLazyExpiration() {
+        int64_t timeout = INT64_FLAG(sls_observer_network_hostname_timeout);
+        INT64_FLAG(sls_observer_network_hostname_timeout) = 100;
+        ServiceMetaCache cache(3);
+        cache.Put("10.0.0.1", "a", ProtocolType_HTTP);
+        cache.Put("10.0.0.2", "b", ProtocolType_HTTP);
+        cache.mNodes[cache.mIndexMap[ServiceMetaKey::FromString("10.0.0.1")]].Meta.time -= 200;
+        // The expired one is removed when looked up, and its node is reused.
+        APSARA_TEST_TRUE(cache.Get("10.0.0.1").Empty());
+        APSARA_TEST_EQUAL(cache.Size(), 1UL);
+        cache.Put("10.0.0.3", "c", ProtocolType_HTTP);
+        APSARA_TEST_EQUAL(cache.mNodes.size(), 2UL);
+        APSARA_TEST_EQUAL(cache.Get("10.0.0.3").Host, "c");
+        APSARA_TEST_FALSE(cache.IsExpired(time(nullptr)));
+        APSARA_TEST_TRUE(cache.IsExpired(time(nullptr) + 100));
+        INT64_FLAG(sls_observer_network_hostname_timeout) = timeout;
+    }
+
+    static const ServiceMetaCache::Node& front(const ServiceMetaCache& cache) { return cache.mNodes[cache.mHead]; }
+
     void testHostnameMetaManager() {
         auto instance = ServiceMetaManager::GetInstance();
         instance->AddHostName(1, "host", "ip");
@@ -50,8 +85,7 @@ public:
         instance->AddHostName(1, "host2", "ip2");
         instance->AddHostName(1, "host3", "ip3");
 
-        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->mData.size(), 3);
-        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->mIndexMap.size(), 3);
+        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->Size(), 3);
         INT64_FLAG(sls_observer_network_hostname_timeout) = 1;
         sleep(2);
         instance->GarbageTimeoutHostname(time(NULL));
@@ -59,22 +93,20 @@ public:
         APSARA_TEST_EQUAL(instance->mHostnameMetas.size(), 0);
 
         instance->GetOrPutServiceMeta(1, "ip", ProtocolType_MySQL);
-        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->mData.size(), 1);
-        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->mIndexMap.size(), 1);
-        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->mData.front().first, "ip");
-        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->mData.front().second.Host, "");
-        APSARA_TEST_EQUAL(ServiceCategoryToString(instance->mHostnameMetas[1]->mData.front().second.Category),
+        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->Size(), 1);
+        APSARA_TEST_TRUE(front(*instance->mHostnameMetas[1]).Key == ServiceMetaKey::FromString("ip"));
+        APSARA_TEST_EQUAL(front(*instance->mHostnameMetas[1]).Meta.Host, "");
+        APSARA_TEST_EQUAL(ServiceCategoryToString(front(*instance->mHostnameMetas[1]).Meta.Category),
                           ServiceCategoryToString(DetectRemoteServiceCategory(ProtocolType_MySQL)));
-        APSARA_TEST_TRUE(instance->mHostnameMetas[1]->mData.front().second.time != 0);
+        APSARA_TEST_TRUE(front(*instance->mHostnameMetas[1]).Meta.time != 0);
 
         instance->GetOrPutServiceMeta(1, "ip2", ProtocolType_DNS);
-        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->mData.size(), 2);
-        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->mIndexMap.size(), 2);
-        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->mData.front().first, "ip2");
-        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->mData.front().second.Host, "");
-        APSARA_TEST_EQUAL(ServiceCategoryToString(instance->mHostnameMetas[1]->mData.front().second.Category),
+        APSARA_TEST_EQUAL(instance->mHostnameMetas[1]->Size(), 2);
+        APSARA_TEST_TRUE(front(*instance->mHostnameMetas[1]).Key == ServiceMetaKey::FromString("ip2"));
+        APSARA_TEST_EQUAL(front(*instance->mHostnameMetas[1]).Meta.Host, "");
+        APSARA_TEST_EQUAL(ServiceCategoryToString(front(*instance->mHostnameMetas[1]).Meta.Category),
                           ServiceCategoryToString(DetectRemoteServiceCategory(ProtocolType_DNS)));
-        APSARA_TEST_TRUE(instance->mHostnameMetas[1]->mData.front().second.time != 0);
+        APSARA_TEST_TRUE(front(*instance->mHostnameMetas[1]).Meta.time != 0);
         APSARA_TEST_TRUE(instance->GetServiceMeta(1, "ip3").Empty());
         APSARA_TEST_EQUAL(ServiceCategoryToString(instance->GetServiceMeta(1, "ip2").Category),
                           ServiceCategoryToString(DetectRemoteServiceCategory(ProtocolType_DNS)));
@@ -83,6 +115,10 @@ public:
 
 APSARA_UNIT_TEST_CASE(HostnameMetaUnittest, testLRUCache, 0);
 
+APSARA_UNIT_TEST_CASE(HostnameMetaUnittest, testServiceMetaKey, 0);
+
+APSARA_UNIT_TEST_CASE(HostnameMetaUnittest, testLazyExpiration, 0);
+
 APSARA_UNIT_TEST_CASE(HostnameMetaUnittest, testHostnameMetaManager, 0);
 } // namespace logtail
 
@@ -0,0 +1,114 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "observer/interface/metricbatch.h"
+#include "network/protocols/mysql/type.h"
+
+namespace logtail {
+
+class MetricBatchUnittest : public ::testing::Test {
+public:
+    void TestAddLabels() {
+        MetricBatch batch(1000000000ULL);
+        MetricBatch::Labels labels{{"b", "2"}, {"a", "x|y"}};
+        uint32_t id = batch.AddLabels(labels);
+        APSARA_TEST_EQUAL(id, 0U);
+        MetricBatch::Labels same{{"a", "x|y"}, {"b", "2"}};
+        APSARA_TEST_EQUAL(batch.AddLabels(same), 0U);
+        MetricBatch::Labels other{{"a", "1"}};
+        APSARA_TEST_EQUAL(batch.AddLabels(other), 1U);
+        APSARA_TEST_EQUAL(batch.GetLabelsCount(), 2UL);
+
+        uint32_t nameId = batch.AddName("count");
+        APSARA_TEST_EQUAL(batch.AddName("count"), nameId);
+        batch.AddPoint(nameId, id, 3);
+        batch.AddPoint(nameId, 1, 0.5);
+        APSARA_TEST_EQUAL(batch.GetPointCount(), 2UL);
+        APSARA_TEST_EQUAL(batch.GetLabels(0), "a#$#x_y|b#$#2");
+        APSARA_TEST_EQUAL(batch.GetLabels(1), "a#$#1");
+    }
+
+    void TestToLogs() {
+        MetricBatch batch(1500000000123ULL);
+        MetricBatch::Labels labels{{"k", "v"}};
+        uint32_t labelsId = batch.AddLabels(labels);
+        batch.AddPoint(batch.AddName("l4_send_bytes"), labelsId, 1024);
+        batch.AddPoint(batch.AddName("l7_req_latency_p99_ns"), labelsId, 1.25);
+        std::vector<sls_logs::Log> logs;
+        batch.ToLogs(logs);
+        APSARA_TEST_EQUAL(logs.size(), 2UL);
+        APSARA_TEST_EQUAL(logs[0].time(), 1500U);
+        APSARA_TEST_EQUAL(logs[0].contents_size(), 4);
+        APSARA_TEST_EQUAL(logs[0].contents(0).key(), "__name__");
+        APSARA_TEST_EQUAL(logs[0].contents(0).value(), "l4_send_bytes");
+        APSARA_TEST_EQUAL(logs[0].contents(1).key(), "__labels__");
+        APSARA_TEST_EQUAL(logs[0].contents(1).value(), "k#$#v");
+        APSARA_TEST_EQUAL(logs[0].contents(2).key(), "__time_nano__");
+        APSARA_TEST_EQUAL(logs[0].contents(2).value(), "1500000000123");
+        APSARA_TEST_EQUAL(logs[0].contents(3).key(), "__value__");
+        APSARA_TEST_EQUAL(logs[0].contents(3).value(), "1024");
+        APSARA_TEST_EQUAL(logs[1].contents(3).value(), "1.25");
+
+        batch.Clear();
+        APSARA_TEST_EQUAL(batch.GetPointCount(), 0UL);
+        APSARA_TEST_EQUAL(batch.GetLabelsCount(), 0UL);
+    }
+
+    void TestFlushAggregator() {
+        MySQLProtocolEventAggregator aggregator(100, 100);
+        for (int i = 0; i < 3; ++i) {
+            MySQLProtocolEvent event;
+            event.Key.ConnKey.Role = PacketRoleType::Client;
+            event.Key.ConnKey.RemoteIp = "10.0.0.1";
+            event.Key.Query = "select 1";
+            event.Info.LatencyNs = 100;
+            event.Info.ReqBytes = 10;
+            event.Info.RespBytes = 20;
+            APSARA_TEST_TRUE(aggregator.AddEvent(std::move(event)));
+        }
+        MetricBatch batch(1000000000ULL);
+        MetricBatch::Labels commonLabels{{"cluster", "test"}};
+        aggregator.FlushMetrics(batch, commonLabels);
+        APSARA_TEST_EQUAL(batch.GetPointCount(), 6UL);
+        APSARA_TEST_EQUAL(batch.GetLabelsCount(), 1UL);
+        APSARA_TEST_EQUAL(batch.GetName(0), "l7_db_count");
+        APSARA_TEST_EQUAL(batch.GetValue(0), 3.0);
+        APSARA_TEST_EQUAL(batch.GetName(1), "l7_db_latency_ns");
+        APSARA_TEST_EQUAL(batch.GetValue(1), 300.0);
+        APSARA_TEST_EQUAL(batch.GetName(3), "l7_db_resp_bytes");
+        APSARA_TEST_EQUAL(batch.GetValue(3), 60.0);
+        const std::string& labels = batch.GetLabels(0);
+        APSARA_TEST_TRUE(labels.find("cluster#$#test") != std::string::npos);
+        APSARA_TEST_TRUE(labels.find("query#$#select 1") != std::string::npos);
+        APSARA_TEST_TRUE(labels.find("protocol#$#mysql") != std::string::npos);
+
+        // items are cleared after flushed, and empty items are released at the next flush.
+        MetricBatch next(2000000000ULL);
+        aggregator.FlushMetrics(next, commonLabels);
+        APSARA_TEST_EQUAL(next.GetPointCount(), 0UL);
+    }
+};
+
+APSARA_UNIT_TEST_CASE(MetricBatchUnittest, TestAddLabels, 0);
+APSARA_UNIT_TEST_CASE(MetricBatchUnittest, TestToLogs, 0);
+APSARA_UNIT_TEST_CASE(MetricBatchUnittest, TestFlushAggregator, 0);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
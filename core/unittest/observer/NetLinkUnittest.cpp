@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <unistd.h>
 
 #include "unittest/Unittest.h"
 #include "metas/ConnectionMetaManager.h"
@@ -66,7 +68,7 @@ public:
     void TestFetchInetConnections() {
         NetLinkProber prober(594114, 1, "/dev/proc/");
         ASSERT_TRUE(prober.Status() == 0);
-        std::unordered_map<uint32_t, ConnectionInfoPtr> infos;
+        ConnectionInfoMap infos;
         prober.FetchInetConnections(infos);
         for (const auto& item : infos) {
             std::cout << "inode:" << item.first << std::endl;
@@ -77,7 +79,7 @@ public:
     void TestFetchUnixConnections() {
         NetLinkProber prober(594114, 1, "/dev/proc/");
         ASSERT_TRUE(prober.Status() == 0);
-        std::unordered_map<uint32_t, ConnectionInfoPtr> infos;
+        ConnectionInfoMap infos;
         prober.FetchUnixConnections(infos);
         for (const auto& item : infos) {
             std::cout << "inode:" << item.first << std::endl;
@@ -100,6 +102,34 @@ public:
             info->Print();
         }
     }
+
+    void TestRefresher() {
+        APSARA_TEST_TRUE(logtail::glibc::LoadGlibcFunc());
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        APSARA_TEST_TRUE(fd >= 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        APSARA_TEST_EQUAL(bind(fd, (sockaddr*)&addr, sizeof(addr)), 0);
+        APSARA_TEST_EQUAL(listen(fd, 1), 0);
+
+        auto instance = ConnectionMetaManager::GetInstance();
+        APSARA_TEST_TRUE(instance->Init("/proc/"));
+        instance->StartRefresher(1);
+        // the first miss only asks the refresher to dump the namespace.
+        ConnectionInfoPtr info = instance->GetConnectionInfo(getpid(), fd);
+        for (int i = 0; i < 300 && info == nullptr; ++i) {
+            usleep(10 * 1000);
+            info = instance->GetConnectionInfo(getpid(), fd);
+        }
+        APSARA_TEST_TRUE(info != nullptr);
+        APSARA_TEST_TRUE(instance->GetGeneration() > 0);
+        if (info != nullptr) {
+            APSARA_TEST_EQUAL(info->stat, TCPConnectionStat::Listening);
+        }
+        instance->StopRefresher();
+        close(fd);
+    }
 };
 
 
@@ -109,6 +139,7 @@ public:
 //    APSARA_UNIT_TEST_CASE(ConnectionMetaUnitTest, TestFetchInetConnections, 0);
 //    APSARA_UNIT_TEST_CASE(ConnectionMetaUnitTest, TestFetchUnixConnections, 0);
 APSARA_UNIT_TEST_CASE(ConnectionMetaUnitTest, TestReadFdLink, 0);
+APSARA_UNIT_TEST_CASE(ConnectionMetaUnitTest, TestRefresher, 0);
 //    APSARA_UNIT_TEST_CASE(ConnectionMetaUnitTest, TestIPV6, 0);
 
 } // namespace logtail
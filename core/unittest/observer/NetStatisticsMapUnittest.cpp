@@ -0,0 +1,103 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <map>
+#include "observer/interface/layerfour.h"
+
+namespace logtail {
+
+class NetStatisticsMapUnittest : public ::testing::Test {
+public:
+    static NetStatisticsKey MakeKey(uint32_t pid, uint32_t sockHash) {
+        NetStatisticsKey key{};
+        key.PID = pid;
+        key.SockHash = sockHash;
+        return key;
+    }
+
+    static std::map<uint64_t, int64_t> Collect(const NetStaticticsMap& statisticsMap) {
+        std::map<uint64_t, int64_t> result;
+        statisticsMap.ForEach([&result](const NetStatisticsKey& key, const NetStatisticsTCP& value) {
+            result[(uint64_t(key.PID) << 32) | key.SockHash] += value.Base.SendBytes;
+        });
+        return result;
+    }
+
+    void TestGetAndForEach() {
+        NetStaticticsMap statisticsMap;
+        statisticsMap.GetStatisticsItem(MakeKey(1, 10)).Base.SendBytes += 5;
+        statisticsMap.GetStatisticsItem(MakeKey(1, 10)).Base.SendBytes += 6;
+        statisticsMap.GetStatisticsItem(MakeKey(2, 10)).Base.SendBytes += 7;
+        APSARA_TEST_EQUAL(statisticsMap.Size(), 2UL);
+        std::map<uint64_t, int64_t> result = Collect(statisticsMap);
+        APSARA_TEST_EQUAL(result.size(), 2UL);
+        APSARA_TEST_EQUAL(result[(uint64_t(1) << 32) | 10], 11);
+        APSARA_TEST_EQUAL(result[(uint64_t(2) << 32) | 10], 7);
+    }
+
+    void TestClearKeepsSlots() {
+        NetStaticticsMap statisticsMap;
+        for (uint32_t i = 0; i < 500; ++i) {
+            statisticsMap.GetStatisticsItem(MakeKey(i, i)).Base.SendBytes = 1;
+        }
+        const size_t capacity = statisticsMap.Capacity();
+        statisticsMap.Clear();
+        APSARA_TEST_EQUAL(statisticsMap.Size(), 0UL);
+        APSARA_TEST_EQUAL(statisticsMap.Capacity(), capacity);
+        APSARA_TEST_TRUE(Collect(statisticsMap).empty());
+
+        // Only entries touched after Clear are flushed, and they start from zero.
+        statisticsMap.GetStatisticsItem(MakeKey(3, 3)).Base.SendBytes += 2;
+        statisticsMap.GetStatisticsItem(MakeKey(1000, 1)).Base.SendBytes += 4;
+        std::map<uint64_t, int64_t> result = Collect(statisticsMap);
+        APSARA_TEST_EQUAL(result.size(), 2UL);
+        APSARA_TEST_EQUAL(result[(uint64_t(3) << 32) | 3], 2);
+        APSARA_TEST_EQUAL(result[(uint64_t(1000) << 32) | 1], 4);
+        APSARA_TEST_EQUAL(statisticsMap.Capacity(), capacity);
+    }
+
+    void TestGrowAndReuse() {
+        NetStaticticsMap statisticsMap;
+        for (uint32_t i = 0; i < 5000; ++i) {
+            statisticsMap.GetStatisticsItem(MakeKey(i % 7, i)).Base.SendBytes += i;
+        }
+        APSARA_TEST_EQUAL(statisticsMap.Size(), 5000UL);
+        std::map<uint64_t, int64_t> result = Collect(statisticsMap);
+        APSARA_TEST_EQUAL(result.size(), 5000UL);
+        for (uint32_t i = 0; i < 5000; ++i) {
+            APSARA_TEST_EQUAL(result[(uint64_t(i % 7) << 32) | i], int64_t(i));
+        }
+
+        // New connections of later intervals reuse stale slots instead of growing the table.
+        const size_t capacity = statisticsMap.Capacity();
+        for (uint32_t round = 1; round <= 5; ++round) {
+            statisticsMap.Clear();
+            for (uint32_t i = 0; i < 3000; ++i) {
+                statisticsMap.GetStatisticsItem(MakeKey(round, i)).Base.SendBytes += 1;
+            }
+            APSARA_TEST_EQUAL(statisticsMap.Size(), 3000UL);
+            APSARA_TEST_EQUAL(Collect(statisticsMap).size(), 3000UL);
+        }
+        APSARA_TEST_EQUAL(statisticsMap.Capacity(), capacity);
+    }
+};
+
+UNIT_TEST_CASE(NetStatisticsMapUnittest, TestGetAndForEach)
+UNIT_TEST_CASE(NetStatisticsMapUnittest, TestClearKeepsSlots)
+UNIT_TEST_CASE(NetStatisticsMapUnittest, TestGrowAndReuse)
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -73,6 +73,52 @@ public:
         APSARA_TEST_TRUE(UnitTestHelper::LogKeyMatched(log, "resp_bytes", "200"));
     }
 
+    void TestShardedToPB() {
+        mObserver->InitParseWorkers(2);
+        char packetType[sizeof(PacketEventHeader) + sizeof(PacketEventData)];
+        PacketEventHeader* header = (PacketEventHeader*)packetType;
+        header->EventType = PacketEventType_Data;
+        header->PID = 9;
+        header->SockHash = 3;
+        PacketEventData* data = (PacketEventData*)(packetType + sizeof(PacketEventHeader));
+        data->BufferLen = 0;
+        data->RealLen = 1024;
+        data->PtlType = ProtocolType_HTTP;
+        mObserver->OnPacketEvent(packetType, sizeof(PacketEventHeader) + sizeof(PacketEventData));
+        mObserver->mParseWorkers->WaitIdle();
+
+        APSARA_TEST_EQUAL_FATAL(mObserver->mAllProcesses.count(9), size_t(1));
+        APSARA_TEST_EQUAL_FATAL(mObserver->mAllProcesses[9]->mAllConnections.size(), size_t(0));
+        APSARA_TEST_EQUAL_FATAL(mObserver->mShardProcesses[0].size(), size_t(0));
+        APSARA_TEST_EQUAL_FATAL(mObserver->mShardProcesses[1].size(), size_t(1));
+        ProcessObserver* shardProcess = mObserver->mShardProcesses[1][9];
+        APSARA_TEST_EQUAL_FATAL(shardProcess->mAllConnections.size(), size_t(1));
+        APSARA_TEST_TRUE(shardProcess->GetAggregator() != mObserver->mAllProcesses[9]->GetAggregator());
+
+        // events of the same key in different shards are merged when flushed.
+        for (ProtocolEventAggregators* agg :
+             {shardProcess->GetAggregator(), mObserver->mAllProcesses[9]->GetProcessGroup()->GetShardAggregator(0)}) {
+            DNSProtocolEvent dnsEvent;
+            dnsEvent.Info.ReqBytes = 100;
+            dnsEvent.Info.RespBytes = 200;
+            dnsEvent.Info.LatencyNs = 300;
+            dnsEvent.Key.ReqResource = "cn-hangzhou.log.aliyuncs.com";
+            dnsEvent.Key.RespStatus = 1;
+            dnsEvent.Key.ConnKey.Role = PacketRoleType::Server;
+            agg->GetDNSAggregator()->AddEvent(std::move(dnsEvent));
+        }
+
+        std::vector<sls_logs::Log> allData;
+        mObserver->FlushOutMetrics(allData);
+        APSARA_TEST_EQUAL(allData.size(), size_t(1));
+        sls_logs::Log* log = &allData[0];
+        APSARA_TEST_TRUE(UnitTestHelper::LogKeyMatched(log, "req_resource", "cn-hangzhou.log.aliyuncs.com"));
+        APSARA_TEST_TRUE(UnitTestHelper::LogKeyMatched(log, "count", "2"));
+        APSARA_TEST_TRUE(UnitTestHelper::LogKeyMatched(log, "latency_ns", "600"));
+        APSARA_TEST_TRUE(UnitTestHelper::LogKeyMatched(log, "req_bytes", "200"));
+        mObserver->InitParseWorkers(0);
+        APSARA_TEST_TRUE(mObserver->mShardProcesses.empty());
+    }
 
     void TestJsonPacketToPB() {
         JsonNetPacketReader reader("/tmp/wireshark.json", "30.43.121.41", false, ProtocolType_DNS);
@@ -243,6 +289,7 @@ public:
 
 
 APSARA_UNIT_TEST_CASE(NetworkObserverUnittest, TestToPB, 0);
+APSARA_UNIT_TEST_CASE(NetworkObserverUnittest, TestShardedToPB, 0);
 //    APSARA_UNIT_TEST_CASE(NetworkObserverUnittest, TestJsonNetPacketReader, 0);
 //    APSARA_UNIT_TEST_CASE(NetworkObserverUnittest, TestJsonPacketToPB, 0);
 APSARA_UNIT_TEST_CASE(NetworkObserverUnittest, TestRawPacketUDPReader, 0);
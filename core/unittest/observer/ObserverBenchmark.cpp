@@ -0,0 +1,230 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <sys/resource.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "RawNetPacketReader.h"
+#include "common/Flags.h"
+#include "common/TimeUtil.h"
+#include "log_pb/sls_logs.pb.h"
+#include "observer/network/NetworkObserver.h"
+#include "observer/network/ProcessObserver.h"
+
+DEFINE_FLAG_INT32(observer_benchmark_rounds, "rounds over the capture of each protocol benchmark", 20000);
+DEFINE_FLAG_INT32(observer_benchmark_connections, "connections the rounds are spread over", 64);
+DEFINE_FLAG_INT32(observer_benchmark_flush_rounds, "rounds between two flushes of aggregators", 1000);
+DEFINE_FLAG_STRING(observer_benchmark_capture_file,
+                   "replay this capture rather than the builtin ones, one hex encoded ethernet frame per line",
+                   "");
+DEFINE_FLAG_STRING(observer_benchmark_capture_protocol, "protocol of capture file, http/mysql/pgsql/redis/dns", "http");
+DEFINE_FLAG_STRING(observer_benchmark_capture_local_address, "local address of capture file", "");
+DEFINE_FLAG_BOOL(observer_benchmark_capture_server, "whether local address of capture file is the server", false);
+
+namespace logtail {
+
+namespace {
+    // Captured in protocol unittests, each one is a request and its response.
+    const std::vector<std::string> kHTTPCapture{
+        "00749c945d39a07817a0852e080045000071000040004006a0581e2b7853dcb526fbcd4700506b7401eca591a5ce50181000"
+        "37ad0000474554202f20485454502f312e310d0a486f73743a2062616964752e636f6d0d0a557365722d4167656e743a2063"
+        "75726c2f372e37372e300d0a4163636570743a202a2f2a0d0a0d0a",
+        "a07817a0852e00749c945d390800450001598c7240002a0628fedcb526fb1e2b78530050cd47a591a5ce6b74023550180304"
+        "c2650000485454502f312e3120323030204f4b0d0a446174653a205468752c203237204a616e20323032322030393a34363a"
+        "313320474d540d0a5365727665723a204170616368650d0a4c6173742d4d6f6469666965643a205475652c203132204a616e"
+        "20323031302031333a34383a303020474d540d0a455461673a202235312d34376366376536656538343030220d0a41636365"
+        "70742d52616e6765733a2062797465730d0a436f6e74656e742d4c656e6774683a2038310d0a43616368652d436f6e74726f"
+        "6c3a206d61782d6167653d38363430300d0a457870697265733a204672692c203238204a616e20323032322030393a34363a"
+        "313320474d540d0a436f6e6e656374696f6e3a204b6565702d416c6976650d0a436f6e74656e742d547970653a2074657874"
+        "2f68746d6c0d0a0d0a"};
+
+    const std::vector<std::string> kMySQLCapture{
+        "00749c945d39a07817a0852e08004500004c00004000400637031e2b793d0b9f60a2cb7b0cea933e3190a670a97080180801"
+        "920c00000101080a08d1f5fd7fc82492140000000373656c656374202a2066726f6d2068656c6c6f",
+        "a07817a0852e00749c945d390800450000c330164000360610760b9f60a21e2b793d0ceacb7ba670a970933e31a880180039"
+        "dc6300000101080a7fc848ca08d1f5fd01000001022a00000203646566066d79746573740568656c6c6f0568656c6c6f0263"
+        "310263310c080020000000fd00000000002a00000303646566066d79746573740568656c6c6f0568656c6c6f026332026332"
+        "0c080020000000fd000000000005000004fe000022000a000005046161613104616161320a00000604626262310462626232"
+        "05000007fe00002200"};
+
+    const std::vector<std::string> kPgSQLCapture{
+        "00000000040088665a406acf080045000080000040004006c69b1ef0630d707c8163cbd31538ff44f48ea0c79df680180800"
+        "583100000101080a110926ce00c93c1650000000280053484f57205452414e53414354494f4e2049534f4c4154494f4e204c"
+        "4556454c000000420000000c000000000000000044000000065000450000000900000000005300000004",
+        "88665a406acf00000000040008004500009636e4400033069ca1707c81631ef0630d1538cbd3a0c79df6ff44f4da80180043"
+        "66df00000101080a00c93d1f1109277831000000043200000004540000002e00017472616e73616374696f6e5f69736f6c61"
+        "74696f6e0000000000000000000019ffffffffffff0000440000001800010000000e7265616420636f6d6d69747465644300"
+        "00000953484f57005a0000000549"};
+
+    const std::vector<std::string> kRedisCapture{
+        "00749c945d39a07817a0852e08004500005b000040004006375a1e2b78d70b9f60a2e2ae18ebeec9ad5886a8e17980180800"
+        "c6e800000101080a4d49243fd112ef9f2a330d0a24330d0a7365740d0a24310d0a610d0a2431320d0a686168616761736766"
+        "7361660d0a",
+        "a07817a0852e00749c945d39080045000039b7464000370689350b9f60a21e2b78d718ebe2ae86a8e179eec9ad7f80180039"
+        "a65a00000101080ad11409da4d49243f2b4f4b0d0a"};
+
+    const std::vector<std::string> kDNSCapture{
+        "00749c945d39a07817a0852e080045000042f72100004011b0cf1e2b78531e1e1e1ef7530035002ea4c43f2e012000010000"
+        "0000000105626169647503636f6d00000100010000291000000000000000",
+        "a07817a0852e00749c945d3908004500006286f500007a11e6db1e1e1e1e1e2b78530035f753004ec1f83f2e818000010002"
+        "0000000105626169647503636f6d0000010001c00c00010001000001210004dcb52694c00c00010001000001210004dcb526"
+        "fb0000290fa0000000000000",
+        "00749c945d39a07817a0852e080045000052ccbf00004011db211e2b78531e1e1e1ee0800035003e48f33e57012000010000"
+        "000000011578787878616177656661666164736661736661736603636f6d00000100010000291000000000000000",
+        "a07817a0852e00749c945d3908004500009b09bd00007a1163db1e1e1e1e1e2b78530035e08000874c1e3e57818300010000"
+        "000100011578787878616177656661666164736661736661736603636f6d0000010001c0220006000100000384003d01610c"
+        "67746c642d73657276657273036e657400056e73746c640c766572697369676e2d677273c02261f25b8e0000070800000384"
+        "00093a80000151800000290fa0000000000000"};
+
+    uint64_t GetProcessCpuTimeUs() {
+        struct rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<uint64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+            + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+    }
+
+    bool ParseProtocol(const std::string& name, ProtocolType& type) {
+        static const std::vector<std::pair<std::string, ProtocolType>> kProtocols{{"http", ProtocolType_HTTP},
+                                                                                 {"mysql", ProtocolType_MySQL},
+                                                                                 {"pgsql", ProtocolType_PgSQL},
+                                                                                 {"redis", ProtocolType_Redis},
+                                                                                 {"dns", ProtocolType_DNS}};
+        for (const auto& item : kProtocols) {
+            if (item.first == name) {
+                type = item.second;
+                return true;
+            }
+        }
+        return false;
+    }
+} // namespace
+
+class ObserverBenchmark : public ::testing::Test {
+public:
+    void TestHTTP() { Run("HTTP", ProtocolType_HTTP, "30.43.120.83", false, kHTTPCapture); }
+
+    void TestMySQL() { Run("MySQL", ProtocolType_MySQL, "30.43.121.61", false, kMySQLCapture); }
+
+    void TestPgSQL() { Run("PgSQL", ProtocolType_PgSQL, "30.240.99.13", false, kPgSQLCapture); }
+
+    void TestRedis() { Run("Redis", ProtocolType_Redis, "30.43.120.215", false, kRedisCapture); }
+
+    void TestDNS() { Run("DNS", ProtocolType_DNS, "30.43.120.83", false, kDNSCapture); }
+
+    void TestCaptureFile() {
+        const std::string& path = STRING_FLAG(observer_benchmark_capture_file);
+        if (path.empty()) {
+            return;
+        }
+        ProtocolType type = ProtocolType_None;
+        APSARA_TEST_TRUE_FATAL(ParseProtocol(STRING_FLAG(observer_benchmark_capture_protocol), type));
+        std::ifstream in(path);
+        APSARA_TEST_TRUE_FATAL(in.good());
+        std::vector<std::string> rawHexs;
+        for (std::string line; std::getline(in, line);) {
+            line.erase(std::remove_if(line.begin(), line.end(), ::isspace), line.end());
+            if (!line.empty()) {
+                rawHexs.push_back(line);
+            }
+        }
+        Run("CaptureFile/" + STRING_FLAG(observer_benchmark_capture_protocol),
+            type,
+            STRING_FLAG(observer_benchmark_capture_local_address),
+            BOOL_FLAG(observer_benchmark_capture_server),
+            rawHexs);
+    }
+
+private:
+    size_t GetAggregatorMemoryUsage() {
+        size_t bytes = 0;
+        for (const auto& item : mObserver->mAllProcesses) {
+            bytes += item.second->GetMemoryUsage();
+            if (item.second->GetAggregator() != nullptr) {
+                bytes += item.second->GetAggregator()->GetMemoryUsage();
+            }
+        }
+        return bytes;
+    }
+
+    // Run replays the capture on connections in turn through OnPacketEvent, and flushes aggregators every
+    // observer_benchmark_flush_rounds rounds as the event loop does. CPU and memory include all of them.
+    void Run(const std::string& name,
+             ProtocolType type,
+             const std::string& localAddress,
+             bool isServer,
+             const std::vector<std::string>& rawHexs) {
+        RawNetPacketReader reader(localAddress, isServer, type, rawHexs);
+        APSARA_TEST_TRUE_FATAL(reader.OK());
+        std::vector<std::string> packets;
+        reader.GetAllNetPackets(packets);
+        APSARA_TEST_TRUE_FATAL(!packets.empty());
+
+        std::vector<sls_logs::Log> allData;
+        mObserver->FlushOutMetrics(allData);
+        const int32_t rounds = std::max(INT32_FLAG(observer_benchmark_rounds), 1);
+        const uint32_t connections = std::max(INT32_FLAG(observer_benchmark_connections), 1);
+        const int32_t flushRounds = std::max(INT32_FLAG(observer_benchmark_flush_rounds), 1);
+        const uint32_t baseSockHash = reinterpret_cast<PacketEventHeader*>(&packets[0].at(0))->SockHash;
+        size_t events = 0, logs = 0, maxMemoryBytes = 0;
+
+        const uint64_t cpuBegin = GetProcessCpuTimeUs();
+        const uint64_t begin = GetCurrentTimeInMicroSeconds();
+        for (int32_t round = 0; round < rounds; ++round) {
+            const uint32_t sockHash = baseSockHash + round % connections;
+            for (auto& packet : packets) {
+                reinterpret_cast<PacketEventHeader*>(&packet.at(0))->SockHash = sockHash;
+                mObserver->OnPacketEvent(&packet.at(0), packet.size());
+            }
+            events += packets.size();
+            if ((round + 1) % flushRounds == 0 || round + 1 == rounds) {
+                maxMemoryBytes = std::max(maxMemoryBytes, GetAggregatorMemoryUsage());
+                allData.clear();
+                mObserver->FlushOutMetrics(allData);
+                logs += allData.size();
+            }
+        }
+        const uint64_t costUs = std::max<uint64_t>(GetCurrentTimeInMicroSeconds() - begin, 1);
+        const uint64_t cpuUs = GetProcessCpuTimeUs() - cpuBegin;
+        APSARA_TEST_TRUE(logs > 0);
+        Report(name, events, logs, costUs, cpuUs, maxMemoryBytes);
+    }
+
+    void Report(const std::string& name,
+                size_t events,
+                size_t logs,
+                uint64_t costUs,
+                uint64_t cpuUs,
+                size_t maxMemoryBytes) {
+        LOG_INFO(sLogger,
+                 ("benchmark", name)("events", events)("logs", logs)("cost_ms", costUs / 1000)(
+                     "events_per_sec", events * 1000000 / costUs)("cpu_ns_per_event", cpuUs * 1000 / events)(
+                     "max_observer_memory_kb", maxMemoryBytes / 1024));
+    }
+
+    NetworkObserver* mObserver = NetworkObserver::GetInstance();
+};
+
+UNIT_TEST_CASE(ObserverBenchmark, TestHTTP);
+UNIT_TEST_CASE(ObserverBenchmark, TestMySQL);
+UNIT_TEST_CASE(ObserverBenchmark, TestPgSQL);
+UNIT_TEST_CASE(ObserverBenchmark, TestRedis);
+UNIT_TEST_CASE(ObserverBenchmark, TestDNS);
+UNIT_TEST_CASE(ObserverBenchmark, TestCaptureFile);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,105 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstring>
+#include <vector>
+#include "observer/network/sources/pcap/PacketRingReader.h"
+
+
+namespace logtail {
+
+class PacketRingReaderUnittest : public ::testing::Test {
+public:
+    // builds a block the same way as the kernel, every packet is behind its tpacket3_hdr at tp_mac.
+    static void BuildBlock(std::vector<uint8_t>& block, const std::vector<std::string>& packets) {
+        block.assign(4096, 0);
+        tpacket_block_desc* desc = (tpacket_block_desc*)block.data();
+        desc->version = TPACKET_V3;
+        desc->hdr.bh1.num_pkts = packets.size();
+        desc->hdr.bh1.offset_to_first_pkt = TPACKET_ALIGN(sizeof(tpacket_block_desc));
+        uint32_t offset = desc->hdr.bh1.offset_to_first_pkt;
+        for (size_t i = 0; i < packets.size(); ++i) {
+            tpacket3_hdr* header = (tpacket3_hdr*)(block.data() + offset);
+            header->tp_mac = TPACKET_ALIGN(sizeof(tpacket3_hdr));
+            header->tp_snaplen = packets[i].size();
+            header->tp_len = packets[i].size() + 10;
+            header->tp_sec = i + 1;
+            header->tp_nsec = 100;
+            memcpy(block.data() + offset + header->tp_mac, packets[i].data(), packets[i].size());
+            uint32_t next = TPACKET_ALIGN(header->tp_mac + packets[i].size());
+            header->tp_next_offset = i + 1 == packets.size() ? 0 : next;
+            offset += next;
+        }
+    }
+
+    void TestWalkBlock() {
+        std::vector<uint8_t> block;
+        BuildBlock(block, {"first packet", "second", "the third packet"});
+        std::vector<std::string> datas;
+        std::vector<uint32_t> wireLens;
+        std::vector<uint64_t> times;
+        std::vector<const u_char*> pointers;
+        uint32_t count = PacketRingReader::WalkBlock(
+            (tpacket_block_desc*)block.data(),
+            [&](const u_char* data, uint32_t capLen, uint32_t wireLen, uint64_t timeNano) {
+                datas.push_back(std::string((const char*)data, capLen));
+                wireLens.push_back(wireLen);
+                times.push_back(timeNano);
+                pointers.push_back(data);
+            });
+        APSARA_TEST_EQUAL(count, 3U);
+        APSARA_TEST_EQUAL(datas.size(), 3UL);
+        APSARA_TEST_EQUAL(datas[0], "first packet");
+        APSARA_TEST_EQUAL(datas[1], "second");
+        APSARA_TEST_EQUAL(datas[2], "the third packet");
+        APSARA_TEST_EQUAL(wireLens[1], 16U);
+        APSARA_TEST_EQUAL(times[2], 3000000100ULL);
+        // packets are not copied, the data points into the block.
+        for (const u_char* p : pointers) {
+            APSARA_TEST_TRUE(p > block.data() && p < block.data() + block.size());
+        }
+    }
+
+    void TestWalkEmptyBlock() {
+        std::vector<uint8_t> block;
+        BuildBlock(block, {});
+        int called = 0;
+        uint32_t count = PacketRingReader::WalkBlock(
+            (tpacket_block_desc*)block.data(),
+            [&](const u_char*, uint32_t, uint32_t, uint64_t) { ++called; });
+        APSARA_TEST_EQUAL(count, 0U);
+        APSARA_TEST_EQUAL(called, 0);
+    }
+
+    void TestOpenInvalidSize() {
+        PacketRingReader reader;
+        APSARA_TEST_FALSE(reader.Open("", false, 1000, 4, 2048, 10));
+        APSARA_TEST_FALSE(reader.IsOpen());
+        APSARA_TEST_FALSE(reader.GetErrorMessage().empty());
+        APSARA_TEST_EQUAL(reader.ReadBlocks(10, 0, [](const u_char*, uint32_t, uint32_t, uint64_t) {}), -2);
+    }
+};
+
+APSARA_UNIT_TEST_CASE(PacketRingReaderUnittest, TestWalkBlock, 0);
+APSARA_UNIT_TEST_CASE(PacketRingReaderUnittest, TestWalkEmptyBlock, 0);
+APSARA_UNIT_TEST_CASE(PacketRingReaderUnittest, TestOpenInvalidSize, 0);
+} // namespace logtail
+
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
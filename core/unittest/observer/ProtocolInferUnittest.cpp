@@ -45,9 +45,31 @@ public:
                           "\x74\x61\x62\x61\x73\x65\x00\x70\x6f\x73\x74\x67\x72\x65\x73\x00\x00";
         APSARA_TEST_TRUE(is_pgsql_message(start_up, 97, 0, 0));
     }
+
+    void TestInferHTTP() {
+        const char* requests[] = {"GET / HTTP/1.1\r\n\r\n",
+                                  "HEAD / HTTP/1.1\r\n\r\n",
+                                  "POST /a HTTP/1.1\r\n\r\n",
+                                  "PUT /a HTTP/1.1\r\n\r\n",
+                                  "DELETE /a HTTP/1.1\r\n\r\n"};
+        for (const char* req : requests) {
+            APSARA_TEST_EQUAL(infer_http_message(req, strlen(req), 0, 0), MessageType_Request);
+        }
+        const char* resp = "HTTP/1.1 200 OK\r\n\r\n";
+        APSARA_TEST_EQUAL(infer_http_message(resp, strlen(resp), 0, 0), MessageType_Response);
+        const char* others[] = {"GEt / HTTP/1.1\r\n\r\n", "DELET /a HTTP/1.1\r\n\r\n", "+OK\r\n+OK\r\n+OK\r\n+OK\r\n"};
+        for (const char* other : others) {
+            APSARA_TEST_EQUAL(infer_http_message(other, strlen(other), 0, 0), MessageType_None);
+        }
+        // too short
+        APSARA_TEST_EQUAL(infer_http_message("GET / HTTP/1.1", 14, 0, 0), MessageType_None);
+        // decided by the port
+        APSARA_TEST_EQUAL(infer_http_message(others[2], strlen(others[2]), 80, 0), MessageType_Response);
+    }
 };
 
 APSARA_UNIT_TEST_CASE(ProtocolUtilUnittest, TestInferPgSql, 0);
+APSARA_UNIT_TEST_CASE(ProtocolUtilUnittest, TestInferHTTP, 0);
 } // namespace logtail
 
 
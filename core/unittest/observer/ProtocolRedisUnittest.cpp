@@ -17,6 +17,7 @@
 #include "unittest/Unittest.h"
 #include "network/protocols/utils.h"
 #include "network/protocols/redis/inner_parser.h"
+#include "network/protocols/redis/parser.h"
 #include "RawNetPacketReader.h"
 #include "unittest/UnittestHelper.h"
 #include "observer/network/ProcessObserver.h"
@@ -77,6 +78,53 @@ public:
         APSARA_TEST_EQUAL(redis.redisData.GetCommands(), "4");
     }
 
+    void TestPipelinedMessages() {
+        PacketEventHeader header;
+        memset(&header, 0, sizeof(header));
+        header.RoleType = PacketRoleType::Server;
+        auto aggregator = new RedisProtocolEventAggregator(200, 1001);
+        RedisProtocolParser* parser = RedisProtocolParser::Create(aggregator, &header);
+        // two pipelined requests and the half of the third one.
+        std::string reqs = "*2\r\n$3\r\nget\r\n$1\r\na\r\n*2\r\n$3\r\nget\r\n$1\r\nb\r\n*2\r\n$3\r\nge";
+        header.TimeNano = 1000;
+        APSARA_TEST_EQUAL(
+            parser->OnPacket(PacketType_In, MessageType_Request, &header, reqs.data(), reqs.size(), reqs.size()),
+            ParseResult_OK);
+        std::string left = "t\r\n$1\r\nc\r\n";
+        header.TimeNano = 2000;
+        APSARA_TEST_EQUAL(
+            parser->OnPacket(PacketType_In, MessageType_Request, &header, left.data(), left.size(), left.size()),
+            ParseResult_OK);
+        std::vector<std::string> resps{"$1\r\n1\r\n$1", "\r\n2\r\n", "-ERR\r\n"};
+        std::vector<ParseResult> expectRes{ParseResult_OK, ParseResult_OK, ParseResult_OK};
+        for (size_t i = 0; i < resps.size(); ++i) {
+            header.TimeNano = 3000 + i;
+            APSARA_TEST_EQUAL(parser->OnPacket(PacketType_Out,
+                                               MessageType_Response,
+                                               &header,
+                                               resps[i].data(),
+                                               resps[i].size(),
+                                               resps[i].size()),
+                              expectRes[i]);
+        }
+        APSARA_TEST_EQUAL(parser->GetCacheSize(), 0);
+
+        std::vector<sls_logs::Log> allData;
+        google::protobuf::RepeatedPtrField<sls_logs::Log_Content> tags;
+        aggregator->FlushLogs(allData, {}, tags, 1);
+        APSARA_TEST_EQUAL(allData.size(), size_t(2));
+        for (auto& log : allData) {
+            APSARA_TEST_TRUE(UnitTestHelper::LogKeyMatched(&log, "query_cmd", "get"));
+            if (UnitTestHelper::LogKeyMatched(&log, "status", "1")) {
+                APSARA_TEST_TRUE(UnitTestHelper::LogKeyMatched(&log, "count", "2"));
+            } else {
+                APSARA_TEST_TRUE(UnitTestHelper::LogKeyMatched(&log, "count", "1"));
+            }
+        }
+        RedisProtocolParser::Delete(parser);
+        delete aggregator;
+    }
+
     void TestRedisPacketReader() {
         std::vector<std::string> rawHexs{rawHex1, rawHex2};
         RawNetPacketReader reader("30.43.120.215", false, ProtocolType_Redis, rawHexs);
@@ -214,6 +262,8 @@ APSARA_UNIT_TEST_CASE(ProtocolRedisUnittest, TestRedisPacketReaderUnorder, 0);
 
 APSARA_UNIT_TEST_CASE(ProtocolRedisUnittest, TestRedisParserGC, 0);
 
+APSARA_UNIT_TEST_CASE(ProtocolRedisUnittest, TestPipelinedMessages, 0);
+
 
 } // namespace logtail
 
@@ -0,0 +1,176 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <string>
+#include "observer/network/protocols/StreamBuffer.h"
+#include "observer/network/protocols/http/inner_parser.h"
+#include "observer/network/protocols/redis/inner_parser.h"
+
+DECLARE_FLAG_INT32(sls_observer_network_stream_buffer_max_size);
+
+namespace logtail {
+
+class ProtocolStreamUnittest : public ::testing::Test {
+public:
+    void TestStreamBufferWithoutCopy() {
+        StreamBuffer buffer;
+        std::string data = "abcdef";
+        SlsStringPiece stream = buffer.Begin(data.data(), data.size(), data.size(), 10);
+        // the data of the event is used directly when nothing is kept.
+        APSARA_TEST_TRUE(stream.mPtr == data.data());
+        APSARA_TEST_EQUAL(stream.mLen, data.size());
+        APSARA_TEST_EQUAL(buffer.GetTimeNano(0), 10UL);
+        buffer.End(data.size());
+        APSARA_TEST_EQUAL(buffer.Size(), 0UL);
+    }
+
+    void TestStreamBufferKeepTail() {
+        StreamBuffer buffer;
+        std::string first = "msg1|ms";
+        SlsStringPiece stream = buffer.Begin(first.data(), first.size(), first.size(), 10);
+        buffer.End(5);
+        APSARA_TEST_EQUAL(buffer.Size(), 2UL);
+        APSARA_TEST_EQUAL(buffer.GetKeptTimeNano(), 10UL);
+
+        std::string second = "g2|msg3|";
+        stream = buffer.Begin(second.data(), second.size(), second.size(), 20);
+        APSARA_TEST_EQUAL(stream.ToString(), "msg2|msg3|");
+        // the kept message arrived with the first event.
+        APSARA_TEST_EQUAL(buffer.GetTimeNano(0), 10UL);
+        APSARA_TEST_EQUAL(buffer.GetTimeNano(5), 20UL);
+        buffer.End(stream.mLen);
+        APSARA_TEST_EQUAL(buffer.Size(), 0UL);
+    }
+
+    void TestStreamBufferDropTail() {
+        StreamBuffer buffer;
+        std::string data = "half message";
+        buffer.Begin(data.data(), data.size(), data.size() + 100, 10);
+        buffer.End(4);
+        // the data of truncated event could not be joined with the following data.
+        APSARA_TEST_EQUAL(buffer.Size(), 0UL);
+
+        int32_t maxSize = INT32_FLAG(sls_observer_network_stream_buffer_max_size);
+        INT32_FLAG(sls_observer_network_stream_buffer_max_size) = 8;
+        buffer.Begin(data.data(), data.size(), data.size(), 10);
+        buffer.End(0);
+        APSARA_TEST_EQUAL(buffer.Size(), 0UL);
+        buffer.Begin(data.data(), data.size(), data.size(), 10);
+        buffer.End(4);
+        APSARA_TEST_EQUAL(buffer.Size(), 8UL);
+        size_t freeCount = StreamBufferPool::GetInstance()->GetFreeCount();
+        buffer.Reset();
+        // released buffers are reused by other connections.
+        APSARA_TEST_EQUAL(StreamBufferPool::GetInstance()->GetFreeCount(), freeCount + 1);
+        INT32_FLAG(sls_observer_network_stream_buffer_max_size) = maxSize;
+    }
+
+    void TestRedisMessageLength() {
+        std::string set = "*3\r\n$3\r\nset\r\n$1\r\na\r\n$2\r\n12\r\n";
+        std::string ok = "+OK\r\n";
+        APSARA_TEST_EQUAL(RedisParser::MessageLength(set.data(), set.size()), (int64_t)set.size());
+        APSARA_TEST_EQUAL(RedisParser::MessageLength(ok.data(), ok.size()), (int64_t)ok.size());
+        std::string pipelined = set + "*1\r\n$4\r\nping\r\n";
+        APSARA_TEST_EQUAL(RedisParser::MessageLength(pipelined.data(), pipelined.size()), (int64_t)set.size());
+        for (size_t i = 0; i < set.size(); ++i) {
+            APSARA_TEST_EQUAL_FATAL(RedisParser::MessageLength(set.data(), i), 0);
+        }
+        std::string nullBulk = "$-1\r\n";
+        APSARA_TEST_EQUAL(RedisParser::MessageLength(nullBulk.data(), nullBulk.size()), 5);
+        std::string inlineCmd = "PING\r\n";
+        APSARA_TEST_EQUAL(RedisParser::MessageLength(inlineCmd.data(), inlineCmd.size()), 6);
+        std::string illegal = "$3\r\nabcd\r\n";
+        APSARA_TEST_EQUAL(RedisParser::MessageLength(illegal.data(), illegal.size()), -1);
+        illegal = "\x01\x02\r\n";
+        APSARA_TEST_EQUAL(RedisParser::MessageLength(illegal.data(), illegal.size()), -1);
+    }
+
+    void TestHTTPContentBody() {
+        HTTPBodySkipper skipper;
+        skipper.StartContent(10);
+        APSARA_TEST_TRUE(skipper.Active());
+        APSARA_TEST_EQUAL(skipper.Skip("0123456", 7), 7UL);
+        APSARA_TEST_TRUE(skipper.Active());
+        APSARA_TEST_EQUAL(skipper.Skip("789GET", 6), 3UL);
+        APSARA_TEST_FALSE(skipper.Active());
+
+        skipper.StartContent(10);
+        skipper.SkipLost(4);
+        APSARA_TEST_EQUAL(skipper.Skip("456789", 6), 6UL);
+        APSARA_TEST_FALSE(skipper.Active());
+        skipper.StartContent(0);
+        APSARA_TEST_FALSE(skipper.Active());
+    }
+
+    void TestHTTPChunkedBody() {
+        std::string body = "4\r\nwiki\r\n5;ext=1\r\npedia\r\n0\r\n\r\n";
+        std::string next = "HTTP/1.1 200 OK\r\n";
+        std::string data = body + next;
+        HTTPBodySkipper skipper;
+        skipper.StartChunked();
+        APSARA_TEST_EQUAL(skipper.Skip(data.data(), data.size()), body.size());
+        APSARA_TEST_FALSE(skipper.Active());
+
+        // the same body split in every position.
+        for (size_t i = 1; i < body.size(); ++i) {
+            skipper.StartChunked();
+            APSARA_TEST_EQUAL_FATAL(skipper.Skip(data.data(), i), i);
+            APSARA_TEST_TRUE_FATAL(skipper.Active());
+            APSARA_TEST_EQUAL_FATAL(skipper.Skip(data.data() + i, data.size() - i), body.size() - i);
+            APSARA_TEST_FALSE(skipper.Active());
+        }
+
+        std::string trailer = "0\r\nExpires: never\r\n\r\n";
+        skipper.StartChunked();
+        APSARA_TEST_EQUAL(skipper.Skip(trailer.data(), trailer.size()), trailer.size());
+        APSARA_TEST_FALSE(skipper.Active());
+
+        // not a chunked body
+        skipper.StartChunked();
+        APSARA_TEST_EQUAL(skipper.Skip(next.data(), next.size()), 0UL);
+        APSARA_TEST_FALSE(skipper.Active());
+    }
+
+    void TestHTTPContentLength() {
+        std::string resp = "HTTP/1.1 200 OK\r\nContent-Length: 53\r\nConnection: keep-alive\r\n\r\n";
+        HTTPParser parser;
+        parser.ParseResp(resp.data(), resp.size());
+        APSARA_TEST_EQUAL(parser.status, (int)resp.size());
+        APSARA_TEST_EQUAL(parser.ReadContentLength(), 53);
+        APSARA_TEST_FALSE(parser.IsChunked());
+
+        std::string chunked = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+        HTTPParser chunkedParser;
+        chunkedParser.ParseResp(chunked.data(), chunked.size());
+        APSARA_TEST_EQUAL(chunkedParser.ReadContentLength(), -1);
+        APSARA_TEST_TRUE(chunkedParser.IsChunked());
+    }
+};
+
+APSARA_UNIT_TEST_CASE(ProtocolStreamUnittest, TestStreamBufferWithoutCopy, 0);
+APSARA_UNIT_TEST_CASE(ProtocolStreamUnittest, TestStreamBufferKeepTail, 0);
+APSARA_UNIT_TEST_CASE(ProtocolStreamUnittest, TestStreamBufferDropTail, 0);
+APSARA_UNIT_TEST_CASE(ProtocolStreamUnittest, TestRedisMessageLength, 0);
+APSARA_UNIT_TEST_CASE(ProtocolStreamUnittest, TestHTTPContentBody, 0);
+APSARA_UNIT_TEST_CASE(ProtocolStreamUnittest, TestHTTPChunkedBody, 0);
+APSARA_UNIT_TEST_CASE(ProtocolStreamUnittest, TestHTTPContentLength, 0);
+} // namespace logtail
+
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,110 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include "common/TDigest.h"
+
+
+namespace logtail {
+
+class ProtocolTDigestUnittest : public ::testing::Test {
+public:
+    void TestQuantile() {
+        TDigest digest;
+        APSARA_TEST_TRUE(digest.IsEmpty());
+        APSARA_TEST_EQUAL(digest.Quantile(0.5), 0.0);
+        for (int i = 1; i <= 10000; ++i) {
+            digest.Add(i);
+        }
+        APSARA_TEST_EQUAL(digest.Count(), 10000UL);
+        APSARA_TEST_EQUAL(digest.Min(), 1.0);
+        APSARA_TEST_EQUAL(digest.Max(), 10000.0);
+        APSARA_TEST_TRUE(digest.CentroidCount() <= TDigest::kDefaultCompression);
+        APSARA_TEST_TRUE(std::fabs(digest.Quantile(0.5) - 5000) < 150);
+        APSARA_TEST_TRUE(std::fabs(digest.Quantile(0.99) - 9900) < 20);
+        APSARA_TEST_TRUE(std::fabs(digest.Quantile(0.999) - 9990) < 5);
+        APSARA_TEST_EQUAL(digest.Quantile(0), 1.0);
+        APSARA_TEST_EQUAL(digest.Quantile(1), 10000.0);
+    }
+
+    void TestMerge() {
+        TDigest whole;
+        TDigest merged;
+        std::vector<double> values;
+        srand(0);
+        for (int part = 0; part < 20; ++part) {
+            TDigest digest;
+            for (int i = 0; i < 1000; ++i) {
+                // Long tail latency, most values are small.
+                double value = std::exp((rand() % 10000) / 1000.0);
+                digest.Add(value);
+                whole.Add(value);
+                values.push_back(value);
+            }
+            merged.Merge(digest);
+        }
+        std::sort(values.begin(), values.end());
+        APSARA_TEST_EQUAL(merged.Count(), 20000UL);
+        APSARA_TEST_EQUAL(merged.Min(), whole.Min());
+        APSARA_TEST_EQUAL(merged.Max(), whole.Max());
+        APSARA_TEST_TRUE(merged.CentroidCount() <= TDigest::kDefaultCompression);
+        for (double q : {0.5, 0.9, 0.99}) {
+            const double expected = values[static_cast<size_t>(q * values.size())];
+            APSARA_TEST_TRUE(std::fabs(merged.Quantile(q) - expected) / expected < 0.03);
+            APSARA_TEST_TRUE(std::fabs(whole.Quantile(q) - expected) / expected < 0.03);
+        }
+        merged.Clear();
+        APSARA_TEST_TRUE(merged.IsEmpty());
+        APSARA_TEST_EQUAL(merged.CentroidCount(), 0UL);
+    }
+
+    void TestSerialize() {
+        TDigest digest;
+        APSARA_TEST_EQUAL(digest.Serialize(), "100,0,0,0");
+        digest.Add(3);
+        digest.Add(1);
+        digest.Add(2, 2);
+        APSARA_TEST_EQUAL(digest.Serialize(), "100,4,1,3;1:1;2:2;3:1");
+
+        for (int i = 0; i < 5000; ++i) {
+            digest.Add(i % 977);
+        }
+        TDigest parsed;
+        APSARA_TEST_TRUE(parsed.Deserialize(digest.Serialize()));
+        APSARA_TEST_EQUAL(parsed.Count(), digest.Count());
+        APSARA_TEST_EQUAL(parsed.Serialize(), digest.Serialize());
+        APSARA_TEST_TRUE(std::fabs(parsed.Quantile(0.99) - digest.Quantile(0.99)) < 1e-3);
+
+        APSARA_TEST_FALSE(parsed.Deserialize("xxxxx"));
+        APSARA_TEST_TRUE(parsed.IsEmpty());
+        APSARA_TEST_FALSE(parsed.Deserialize("64,3,1,2;1:1;2:1"));
+        APSARA_TEST_FALSE(parsed.Deserialize("64,1,1,1;1:1;"));
+    }
+};
+
+APSARA_UNIT_TEST_CASE(ProtocolTDigestUnittest, TestQuantile, 0);
+APSARA_UNIT_TEST_CASE(ProtocolTDigestUnittest, TestMerge, 0);
+APSARA_UNIT_TEST_CASE(ProtocolTDigestUnittest, TestSerialize, 0);
+} // namespace logtail
+
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
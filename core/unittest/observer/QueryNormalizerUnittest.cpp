@@ -0,0 +1,133 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <string>
+#include <vector>
+#include "network/protocols/QueryNormalizer.h"
+#include "network/protocols/mysql/type.h"
+
+namespace logtail {
+
+class QueryNormalizerUnittest : public ::testing::Test {
+public:
+    void TestNormalizeSQL() {
+        APSARA_TEST_EQUAL(NormalizeSQL("select * from t where id = 123 and name = 'a''b\\'c'", true),
+                          "select * from t where id = ? and name = ?");
+        APSARA_TEST_EQUAL(NormalizeSQL("SELECT a FROM t1 WHERE b IN (1, 2,3 , 'x') LIMIT 10, 20", true),
+                          "SELECT a FROM t1 WHERE b IN (?) LIMIT ?");
+        APSARA_TEST_EQUAL(NormalizeSQL("insert into t (a, b) values (1, 'x'), (2, 'y'),(3,'z')", true),
+                          "insert into t (a, b) values (?)");
+        APSARA_TEST_EQUAL(NormalizeSQL("  update  t\n\tset v = -1.5e+3 , w=0x1F -- note\n where k = \"s\"", true),
+                          "update t set v = ?, w=? where k = ?");
+        APSARA_TEST_EQUAL(NormalizeSQL("select /* hint */ a-1 from t2 where x = $1", false),
+                          "select a-? from t2 where x = $1");
+        // Identifiers quoted are kept.
+        APSARA_TEST_EQUAL(NormalizeSQL("select \"col 1\", `c2` from t where v1 = 'x'", false),
+                          "select \"col 1\", `c2` from t where v1 = ?");
+        APSARA_TEST_EQUAL(NormalizeSQL("select * from t where a in (-1, -2)", true), "select * from t where a in (?)");
+        APSARA_TEST_EQUAL(NormalizeSQL("", true), "");
+    }
+
+    void TestNormalizeRedisCommand() {
+        APSARA_TEST_EQUAL(NormalizeRedisCommand("get user:1"), "get ?");
+        APSARA_TEST_EQUAL(NormalizeRedisCommand("MSET a 1 b 2"), "MSET ?");
+        APSARA_TEST_EQUAL(NormalizeRedisCommand("PING"), "PING");
+        APSARA_TEST_EQUAL(NormalizeRedisCommand("config get maxmemory"), "config get ?");
+        APSARA_TEST_EQUAL(NormalizeRedisCommand("CLIENT LIST"), "CLIENT LIST");
+    }
+
+    static MySQLProtocolEvent makeEvent(const std::string& query) {
+        MySQLProtocolEvent event;
+        event.Key.ConnKey.Role = PacketRoleType::Client;
+        event.Key.QueryCmd = "select";
+        event.Key.Query = query;
+        event.Info.LatencyNs = 100;
+        return event;
+    }
+
+    static std::vector<sls_logs::Log> flush(MySQLProtocolEventAggregator& aggregator) {
+        std::vector<sls_logs::Log> logs;
+        google::protobuf::RepeatedPtrField<sls_logs::Log_Content> tags;
+        aggregator.FlushLogs(logs, "", tags, 1);
+        return logs;
+    }
+
+    static std::string getContent(const sls_logs::Log& log, const std::string& key) {
+        for (const auto& content : log.contents()) {
+            if (content.key() == key) {
+                return content.value();
+            }
+        }
+        return std::string();
+    }
+
+    void TestAggregatorCollapse() {
+        MySQLProtocolEventAggregator aggregator(4, 4);
+        for (int i = 0; i < 20; ++i) {
+            APSARA_TEST_TRUE(aggregator.AddEvent(makeEvent("select " + std::to_string(i))));
+        }
+        // Keys seen once go to the collapsed key, so no event is lost.
+        std::vector<sls_logs::Log> logs = flush(aggregator);
+        APSARA_TEST_EQUAL(logs.size(), 5UL);
+        int64_t total = 0;
+        int64_t other = 0;
+        for (const auto& log : logs) {
+            total += std::stoll(getContent(log, "count"));
+            if (getContent(log, "query") == kCollapsedQuery) {
+                other = std::stoll(getContent(log, "count"));
+            }
+        }
+        APSARA_TEST_EQUAL(total, 20);
+        APSARA_TEST_EQUAL(other, 16);
+    }
+
+    void TestAggregatorEvictLeast() {
+        MySQLProtocolEventAggregator aggregator(4, 4);
+        for (int i = 0; i < 4; ++i) {
+            APSARA_TEST_TRUE(aggregator.AddEvent(makeEvent("once " + std::to_string(i))));
+        }
+        // A hot key takes the place of one counted less and the evicted one is merged into the collapsed key.
+        for (int i = 0; i < 10; ++i) {
+            APSARA_TEST_TRUE(aggregator.AddEvent(makeEvent("hot")));
+        }
+        std::vector<sls_logs::Log> logs = flush(aggregator);
+        int64_t hot = 0;
+        int64_t other = 0;
+        int64_t total = 0;
+        for (const auto& log : logs) {
+            const int64_t count = std::stoll(getContent(log, "count"));
+            total += count;
+            if (getContent(log, "query") == "hot") {
+                hot = count;
+            } else if (getContent(log, "query") == kCollapsedQuery) {
+                other = count;
+            }
+        }
+        APSARA_TEST_EQUAL(total, 14);
+        // The first event of hot went to the collapsed key before it was counted more than once.
+        APSARA_TEST_EQUAL(hot, 9);
+        APSARA_TEST_EQUAL(other, 2);
+        APSARA_TEST_TRUE(logs.size() <= 5UL);
+    }
+};
+
+UNIT_TEST_CASE(QueryNormalizerUnittest, TestNormalizeSQL)
+UNIT_TEST_CASE(QueryNormalizerUnittest, TestNormalizeRedisCommand)
+UNIT_TEST_CASE(QueryNormalizerUnittest, TestAggregatorCollapse)
+UNIT_TEST_CASE(QueryNormalizerUnittest, TestAggregatorEvictLeast)
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
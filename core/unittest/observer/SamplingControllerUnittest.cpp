@@ -0,0 +1,71 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cmath>
+#include "observer/network/SamplingController.h"
+
+
+namespace logtail {
+
+static const uint64_t kSecondNs = 1000ULL * 1000ULL * 1000ULL;
+
+class SamplingControllerUnittest : public ::testing::Test {
+public:
+    void TestUpdate() {
+        SamplingController controller(5, 10, 0.7, 1.0);
+        controller.SetMaxRate(100, kSecondNs);
+        APSARA_TEST_EQUAL(controller.GetRate(), 100);
+        APSARA_TEST_EQUAL(controller.Update(1.2, 2 * kSecondNs), 50);
+        APSARA_TEST_EQUAL(controller.Update(0.8, 3 * kSecondNs), 50);
+        APSARA_TEST_EQUAL(controller.Update(1.0, 4 * kSecondNs), 25);
+        APSARA_TEST_EQUAL(controller.Update(1.5, 5 * kSecondNs), 12);
+        APSARA_TEST_EQUAL(controller.Update(1.5, 6 * kSecondNs), 6);
+        // keeps the min rate, processes are never dropped as a whole.
+        APSARA_TEST_EQUAL(controller.Update(1.5, 7 * kSecondNs), 5);
+        APSARA_TEST_EQUAL(controller.Update(0.1, 8 * kSecondNs), 15);
+        for (int i = 0; i < 20; ++i) {
+            controller.Update(0.1, (9 + i) * kSecondNs);
+        }
+        APSARA_TEST_EQUAL(controller.GetRate(), 100);
+
+        // never exceeds the rate configured by user.
+        controller.SetMaxRate(30, 30 * kSecondNs);
+        APSARA_TEST_EQUAL(controller.GetRate(), 30);
+        APSARA_TEST_EQUAL(controller.Update(0.1, 31 * kSecondNs), 30);
+        APSARA_TEST_EQUAL(controller.Update(1.1, 32 * kSecondNs), 15);
+    }
+
+    void TestSampleFactor() {
+        SamplingController controller(5, 10, 0.7, 1.0);
+        controller.SetMaxRate(100, 0);
+        APSARA_TEST_EQUAL(controller.TakeSampleFactor(10 * kSecondNs), 1.0);
+        // half of the period at 100 and the other half at 50.
+        controller.Update(1.1, 15 * kSecondNs);
+        APSARA_TEST_TRUE(std::fabs(controller.TakeSampleFactor(20 * kSecondNs) - 100.0 / 75) < 1e-9);
+        APSARA_TEST_EQUAL(controller.TakeSampleFactor(30 * kSecondNs), 2.0);
+        APSARA_TEST_EQUAL(controller.TakeSampleFactor(30 * kSecondNs), 2.0);
+    }
+};
+
+APSARA_UNIT_TEST_CASE(SamplingControllerUnittest, TestUpdate, 0);
+APSARA_UNIT_TEST_CASE(SamplingControllerUnittest, TestSampleFactor, 0);
+} // namespace logtail
+
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <atomic>
+#include <cstdlib>
+#include <unistd.h>
+#include "observer/network/ShardedWorkerPool.h"
+
+
+namespace logtail {
+
+class ShardedWorkerPoolUnittest : public ::testing::Test {
+public:
+    void TestRunInShardOrder() {
+        ShardedWorkerPool pool(4, 8);
+        APSARA_TEST_EQUAL(pool.GetShardCount(), 4UL);
+        std::vector<std::vector<int>> done(4);
+        std::atomic_int count{0};
+        srand(0);
+        for (int i = 0; i < 400; ++i) {
+            const size_t shard = rand() % 4;
+            const int sleepUs = rand() % 200;
+            // Each shard vector is only touched by its own worker.
+            pool.Submit(shard, [&done, &count, shard, sleepUs, i]() {
+                usleep(sleepUs);
+                done[shard].push_back(i);
+                ++count;
+            });
+        }
+        pool.WaitIdle();
+        APSARA_TEST_EQUAL(count.load(), 400);
+        APSARA_TEST_EQUAL(pool.GetPendingCount(), 0UL);
+        for (auto& items : done) {
+            for (size_t i = 1; i < items.size(); ++i) {
+                APSARA_TEST_TRUE_FATAL(items[i - 1] < items[i]);
+            }
+        }
+    }
+
+    void TestWaitIdle() {
+        std::atomic_int count{0};
+        {
+            ShardedWorkerPool pool(2, 1);
+            for (int i = 0; i < 10; ++i) {
+                pool.Submit(i, [&count]() {
+                    usleep(1000);
+                    ++count;
+                });
+            }
+            pool.WaitIdle();
+            APSARA_TEST_EQUAL(count.load(), 10);
+            pool.Submit(0, [&count]() {
+                usleep(1000);
+                ++count;
+            });
+        }
+        // Destructor runs the tasks left.
+        APSARA_TEST_EQUAL(count.load(), 11);
+    }
+};
+
+APSARA_UNIT_TEST_CASE(ShardedWorkerPoolUnittest, TestRunInShardOrder, 0);
+APSARA_UNIT_TEST_CASE(ShardedWorkerPoolUnittest, TestWaitIdle, 0);
+} // namespace logtail
+
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,90 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstdlib>
+#include "parser/DelimiterModeBitmaskParser.h"
+#include "parser/DelimiterModeFsmParser.h"
+
+namespace logtail {
+
+class DelimiterModeBitmaskParserUnittest : public ::testing::Test {
+public:
+    void TestParseDelimiterLine() {
+        DelimiterModeBitmaskParser parser('"', ',');
+        std::vector<std::string> values;
+        APSARA_TEST_TRUE(Parse(parser, "a,,\"b,c\",\"d\"\"e\",", values));
+        APSARA_TEST_EQUAL(values.size(), 5UL);
+        APSARA_TEST_EQUAL(values[0], "a");
+        APSARA_TEST_EQUAL(values[1], "");
+        APSARA_TEST_EQUAL(values[2], "b,c");
+        APSARA_TEST_EQUAL(values[3], "d\"e");
+        APSARA_TEST_EQUAL(values[4], "");
+
+        // Separators and quotes across 64 bytes blocks.
+        std::string longValue(100, 'x');
+        APSARA_TEST_TRUE(Parse(parser, "\"" + longValue + ",\"\"" + longValue + "\"," + longValue, values));
+        APSARA_TEST_EQUAL(values.size(), 2UL);
+        APSARA_TEST_EQUAL(values[0], longValue + ",\"" + longValue);
+        APSARA_TEST_EQUAL(values[1], longValue);
+
+        APSARA_TEST_TRUE(!Parse(parser, "a,\"b", values));
+        APSARA_TEST_TRUE(!Parse(parser, "a\"b\",c", values));
+        APSARA_TEST_TRUE(!Parse(parser, "\"a\"b,c", values));
+        APSARA_TEST_TRUE(!Parse(parser, "\"a\"b\"\",c", values));
+        APSARA_TEST_TRUE(values.empty());
+    }
+
+    // Random lines must be parsed the same as DelimiterModeFsmParser.
+    void TestSameAsFsmParser() {
+        const char chars[] = {'a', 'b', ',', '"', ' '};
+        DelimiterModeBitmaskParser parser('"', ',');
+        DelimiterModeFsmParser fsmParser('"', ',');
+        srand(0);
+        for (int round = 0; round < 100000; ++round) {
+            std::string line;
+            const int size = rand() % 160;
+            for (int i = 0; i < size; ++i) {
+                line += chars[rand() % sizeof(chars)];
+            }
+            std::vector<std::string> values;
+            std::vector<std::string> fsmValues;
+            bool result = Parse(parser, line, values);
+            bool fsmResult = fsmParser.ParseDelimiterLine(line.data(), 0, line.size(), fsmValues);
+            APSARA_TEST_EQUAL_FATAL(result, fsmResult);
+            APSARA_TEST_TRUE_FATAL(values == fsmValues);
+        }
+    }
+
+private:
+    bool Parse(const DelimiterModeBitmaskParser& parser, const std::string& line, std::vector<std::string>& values) {
+        std::vector<DelimiterColumnSpan> columns;
+        values.clear();
+        if (!parser.ParseDelimiterLine(line.data(), 0, line.size(), columns)) {
+            return false;
+        }
+        for (const auto& column : columns) {
+            values.push_back(std::string());
+            parser.AppendColumnValue(line.data(), column, values.back());
+        }
+        return true;
+    }
+};
+
+UNIT_TEST_CASE(DelimiterModeBitmaskParserUnittest, TestParseDelimiterLine);
+UNIT_TEST_CASE(DelimiterModeBitmaskParserUnittest, TestSameAsFsmParser);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
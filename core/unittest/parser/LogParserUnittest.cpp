@@ -260,6 +260,8 @@ public:
     void TestRegexLogLineParserWithTimeIndex();
     void TestLogParserParseLogTime();
     void TestLogParsingError();
+    void TestRegexLogLineParserWithRe2();
+    void TestAddLogFromBuffer();
 
     static void SetUpTestCase() // void Setup()
     {
@@ -282,6 +284,8 @@ APSARA_UNIT_TEST_CASE(LogParserUnittest, TestRegexLogLineParserWithTimeIndex, 5)
 APSARA_UNIT_TEST_CASE(LogParserUnittest, TestLogParserParseLogTime, 6);
 APSARA_UNIT_TEST_CASE(LogParserUnittest, TestAdjustLogTime, 7);
 APSARA_UNIT_TEST_CASE(LogParserUnittest, TestLogParsingError, 8);
+APSARA_UNIT_TEST_CASE(LogParserUnittest, TestRegexLogLineParserWithRe2, 9);
+APSARA_UNIT_TEST_CASE(LogParserUnittest, TestAddLogFromBuffer, 10);
 
 void LogParserUnittest::TestApsaraEasyReadLogTimeParser() {
     LOG_INFO(sLogger, ("TestApsaraEasyReadLogTimeParser() begin", time(NULL)));
@@ -348,6 +352,22 @@ void LogParserUnittest::TestApsaraEasyReadLogTimeParser() {
     APSARA_TEST_EQUAL(microTime, 1378995509819000);
     APSARA_TEST_EQUAL(dateTime, lastTime);
     APSARA_TEST_EQUAL(lastStr, "2013-09-12 22:18:29");
+
+    // next minute is parsed again, seconds of the same minute are computed from cached time.
+    buffer = "[2013-09-12 22:19:01.5]\tA:B";
+    microTime = 0;
+    dateTime = LogParser::ApsaraEasyReadLogTimeParser(buffer.c_str(), lastStr, lastTime, microTime);
+    APSARA_TEST_EQUAL(dateTime, 1378995541);
+    APSARA_TEST_EQUAL(microTime, 1378995541500000);
+    APSARA_TEST_EQUAL(lastStr, "2013-09-12 22:19:01");
+
+    buffer = "[2013-09-12 22:19:00]\tA:B";
+    microTime = 0;
+    dateTime = LogParser::ApsaraEasyReadLogTimeParser(buffer.c_str(), lastStr, lastTime, microTime);
+    APSARA_TEST_EQUAL(dateTime, 1378995540);
+    APSARA_TEST_EQUAL(microTime, 1378995540000000);
+    APSARA_TEST_EQUAL(dateTime, lastTime);
+    APSARA_TEST_EQUAL(lastStr, "2013-09-12 22:19:00");
     LOG_INFO(sLogger, ("TestApsaraEasyReadLogTimeParser() end", time(NULL)));
 }
 
@@ -597,6 +617,35 @@ void LogParserUnittest::TestRegexLogLineParser() {
     LogParser::AdjustLogTime(logGroup.mutable_logs(2), hawaiiTimeZoneOffsetSecond, localOffset);
     APSARA_TEST_EQUAL(thirdLog.time(), thirdLogTime + (localOffset - hawaiiTimeZoneOffsetSecond));
 
+    // Parsers adjust log time with the offset of reader, the same as AdjustLogTime.
+    {
+        string adjustTimeStr;
+        time_t adjustLogTime = 0;
+        flag = LogParser::RegexLogLineParser(bufferStr.c_str(),
+                                             rightReg,
+                                             logGroup,
+                                             true,
+                                             keys,
+                                             metricName,
+                                             timeFormat,
+                                             preciseTimestampConfig,
+                                             timeIndex,
+                                             adjustTimeStr,
+                                             adjustLogTime,
+                                             -1,
+                                             "",
+                                             "",
+                                             "",
+                                             error,
+                                             logGroupSize,
+                                             hawaiiTimeZoneOffsetSecond - localOffset);
+        APSARA_TEST_EQUAL(flag, true);
+        APSARA_TEST_EQUAL(logGroup.logs(3).time(), thirdLog.time());
+        // The cached time is not adjusted.
+        APSARA_TEST_EQUAL(adjustLogTime, thirdLogTime);
+        logGroup.mutable_logs()->RemoveLast();
+    }
+
     LOG_INFO(sLogger,
              ("hawaii time", timeStr)("local time", GetTimeStamp(thirdLog.time(), timeFormat))(
                  "UTC time", thirdLog.time())("local timezone offset", localOffset));
@@ -980,6 +1029,86 @@ void LogParserUnittest::TestLogParsingError() {
     LOG_INFO(sLogger, ("TestLogParsingError() end", time(NULL)));
 }
 
+void LogParserUnittest::TestRegexLogLineParserWithRe2() {
+    LOG_INFO(sLogger, ("TestRegexLogLineParserWithRe2() begin", time(NULL)));
+    const std::string regStr = "\\[([^\\]]+)\\]\\s(\\w+)(?:\\s(\\d+))?\\s(.*)";
+    boost::regex reg(regStr);
+    re2::RE2::Options options;
+    options.set_dot_nl(true);
+    re2::RE2 re2Reg(regStr, options);
+    APSARA_TEST_TRUE_FATAL(re2Reg.ok());
+    vector<string> keys = {"time", "level", "code", "message"};
+
+    // Results of boost and re2 must be the same, including unmatched optional group and
+    // multiline message.
+    vector<string> lines = {"[2013-10-31 21:03:49] INFO 200 request done",
+                            "[2013-10-31 21:03:49] WARN retry\n\tat line 2",
+                            "[2013-10-31 21:03:49]",
+                            "no time INFO message"};
+    for (auto& line : lines) {
+        LogGroup boostGroup, re2Group;
+        uint32_t boostSize = 0, re2Size = 0;
+        ParseLogError boostError, re2Error;
+        bool boostRes = LogParser::RegexLogLineParser(
+            line.c_str(), reg, boostGroup, true, keys, "", 1000, "", "", "", boostError, boostSize);
+        bool re2Res = LogParser::RegexLogLineParser(
+            line.c_str(), reg, re2Group, true, keys, "", 1000, "", "", "", re2Error, re2Size, &re2Reg);
+        APSARA_TEST_EQUAL_DESC(re2Res, boostRes, line);
+        APSARA_TEST_EQUAL_DESC(re2Size, boostSize, line);
+        APSARA_TEST_EQUAL_DESC(re2Group.SerializeAsString(), boostGroup.SerializeAsString(), line);
+    }
+
+    const char* timeFormat = "%Y-%m-%d %H:%M:%S";
+    string timeStr;
+    time_t logTime = 0;
+    LogGroup logGroup;
+    uint32_t logGroupSize = 0;
+    ParseLogError error;
+    PreciseTimestampConfig preciseTimestampConfig;
+    bool flag = LogParser::RegexLogLineParser(lines[0].c_str(),
+                                              reg,
+                                              logGroup,
+                                              true,
+                                              keys,
+                                              "",
+                                              timeFormat,
+                                              preciseTimestampConfig,
+                                              0,
+                                              timeStr,
+                                              logTime,
+                                              -1,
+                                              "",
+                                              "",
+                                              "",
+                                              error,
+                                              logGroupSize,
+                                              0,
+                                              &re2Reg);
+    APSARA_TEST_TRUE(flag);
+    APSARA_TEST_EQUAL(timeStr, "2013-10-31 21:03:49");
+    APSARA_TEST_EQUAL(logGroup.logs(0).contents(2).value(), "200");
+    APSARA_TEST_EQUAL(logGroup.logs(0).contents(3).value(), "request done");
+
+    LOG_INFO(sLogger, ("TestRegexLogLineParserWithRe2() end", time(NULL)));
+}
+
+void LogParserUnittest::TestAddLogFromBuffer() {
+    LOG_INFO(sLogger, ("TestAddLogFromBuffer() begin", time(NULL)));
+    const char* buffer = "key:value";
+    LogGroup logGroup;
+    Log* logPtr = logGroup.add_logs();
+    uint32_t logGroupSize = 0;
+    LogParser::AddLog(logPtr, buffer, 3, buffer + 4, 5, logGroupSize);
+    LogParser::AddLog(logPtr, buffer, 0, buffer, 0, logGroupSize);
+    APSARA_TEST_EQUAL(logPtr->contents_size(), 2);
+    APSARA_TEST_EQUAL(logPtr->contents(0).key(), "key");
+    APSARA_TEST_EQUAL(logPtr->contents(0).value(), "value");
+    APSARA_TEST_EQUAL(logPtr->contents(1).key(), "");
+    APSARA_TEST_EQUAL(logPtr->contents(1).value(), "");
+    APSARA_TEST_EQUAL(logGroupSize, 3U + 5U + 5U + 5U);
+    LOG_INFO(sLogger, ("TestAddLogFromBuffer() end", time(NULL)));
+}
+
 } // namespace logtail
 
 int main(int argc, char** argv) {
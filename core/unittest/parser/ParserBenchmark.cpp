@@ -0,0 +1,299 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <string>
+#include <vector>
+#include <re2/re2.h>
+#include "common/Flags.h"
+#include "common/RegexPrefixFilter.h"
+#include "common/TimeUtil.h"
+#include "log_pb/sls_logs.pb.h"
+#include "parser/DelimiterModeBitmaskParser.h"
+#include "parser/DelimiterModeFsmParser.h"
+#include "parser/LogParser.h"
+#include "reader/JsonLogFileReader.h"
+#include "reader/LogFileReader.h"
+
+DECLARE_FLAG_BOOL(ilogtail_discard_old_data);
+DEFINE_FLAG_INT32(parser_benchmark_rounds, "rounds over the corpus of each parser benchmark", 10);
+DEFINE_FLAG_INT32(parser_benchmark_corpus_size, "bytes of corpus of each parser benchmark", 4 * 1024 * 1024);
+
+using namespace sls_logs;
+
+namespace logtail {
+
+namespace {
+    // Lines parsed into one log group, close to a 512KB read buffer of short logs.
+    const size_t kLinesPerGroup = 4096;
+
+    const char* kNginxRegex = "([\\d\\.]+) \\S+ \\S+ \\[(\\S+) \\S+\\] \"(\\w+) ([^\\\"]*) ([^\\\"]*)\" (\\d+) (\\d+) "
+                              "\"([^\\\"]*)\" \"([^\\\"]*)\"";
+
+    std::string MakeTime(size_t idx) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "2023-10-14 10:%02d:%02d", (int)(idx / 60 % 60), (int)(idx % 60));
+        return buffer;
+    }
+
+    std::vector<std::string> MakeNginxLines(size_t bytes) {
+        static const char* kUrls[] = {"/index.html", "/api/v1/users?id=1024&detail=true", "/static/app.js"};
+        std::vector<std::string> lines;
+        for (size_t size = 0, idx = 0; size < bytes; ++idx) {
+            std::string line = "10.12." + std::to_string(idx % 256) + "." + std::to_string(idx * 7 % 256)
+                + " - - [14/Oct/2023:10:" + std::to_string(10 + idx % 50) + ":00 +0800] \"GET " + kUrls[idx % 3]
+                + " HTTP/1.1\" 200 " + std::to_string(512 + idx % 4096)
+                + " \"https://www.example.com/\" \"Mozilla/5.0 (X11; Linux x86_64) Chrome/117.0\"";
+            size += line.size() + 1;
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    std::vector<std::string> MakeApsaraLines(size_t bytes) {
+        std::vector<std::string> lines;
+        for (size_t size = 0, idx = 0; size < bytes; ++idx) {
+            std::string line = "[" + MakeTime(idx) + "." + std::to_string(100000 + idx % 900000) + "]\t[INFO]\t["
+                + std::to_string(1000 + idx % 64) + "]\t[/build/worker/request_handler.cpp:" + std::to_string(idx % 500)
+                + "]\tmethod:PostLogStoreLogs\tproject:project-" + std::to_string(idx % 16)
+                + "\tlatency_us:" + std::to_string(idx % 10000) + "\tmsg:request done";
+            size += line.size() + 1;
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    std::vector<std::string> MakeCsvLines(size_t bytes) {
+        std::vector<std::string> lines;
+        for (size_t size = 0, idx = 0; size < bytes; ++idx) {
+            std::string line = MakeTime(idx) + ",user-" + std::to_string(idx % 1000) + ",\"Beijing, China\","
+                + std::to_string(idx % 100) + ",\"said \"\"hello\"\" twice\",https://www.example.com/item/"
+                + std::to_string(idx);
+            size += line.size() + 1;
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    std::vector<std::string> MakeJsonLines(size_t bytes) {
+        std::vector<std::string> lines;
+        for (size_t size = 0, idx = 0; size < bytes; ++idx) {
+            std::string line = "{\"time\":\"" + MakeTime(idx) + "\",\"level\":\"INFO\",\"trace_id\":\""
+                + std::to_string(idx) + "abcdef0123456789\",\"latency\":" + std::to_string(idx % 1000)
+                + ",\"ok\":true,\"tags\":[\"a\",\"b\"],\"request\":{\"method\":\"GET\",\"path\":\"/api/v1/items/"
+                + std::to_string(idx % 997) + "\"},\"msg\":\"item fetched from cache\"}";
+            size += line.size() + 1;
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    // Java logs with an exception stack every 8 logs, lines are joined by '\n'.
+    std::string MakeJavaMultilineBuffer(size_t bytes) {
+        std::string buffer;
+        for (size_t idx = 0; buffer.size() < bytes; ++idx) {
+            buffer += MakeTime(idx) + ".123 INFO [http-nio-8080-exec-" + std::to_string(idx % 16)
+                + "] com.example.service.OrderService - order " + std::to_string(idx) + " created\n";
+            if (idx % 8 == 0) {
+                buffer += MakeTime(idx)
+                    + ".456 ERROR [http-nio-8080-exec-1] com.example.web.Controller - request failed\n"
+                      "java.lang.IllegalStateException: order not found\n";
+                for (int frame = 0; frame < 12; ++frame) {
+                    buffer += "\tat com.example.service.OrderService.find(OrderService.java:"
+                        + std::to_string(100 + frame) + ")\n";
+                }
+            }
+        }
+        return buffer;
+    }
+
+    size_t TotalBytes(const std::vector<std::string>& lines) {
+        size_t bytes = 0;
+        for (auto& line : lines) {
+            bytes += line.size() + 1;
+        }
+        return bytes;
+    }
+
+    void Report(const std::string& name, size_t bytes, size_t lines, uint64_t costUs) {
+        double seconds = (costUs + 1) / 1000000.0;
+        LOG_INFO(sLogger,
+                 ("parser benchmark", name)("MB", bytes / 1024.0 / 1024)("lines", lines)(
+                     "MB/s", bytes / 1024.0 / 1024 / seconds)("lines/s", lines / seconds));
+    }
+
+    // RunLines parses every line of @lines by @parse for parser_benchmark_rounds rounds,
+    // log group is reset every kLinesPerGroup lines as process thread does for each buffer.
+    // @return count of lines failed to parse.
+    template <typename ParseFunc>
+    size_t RunLines(const std::string& name, const std::vector<std::string>& lines, ParseFunc parse) {
+        const int32_t rounds = INT32_FLAG(parser_benchmark_rounds);
+        size_t failures = 0;
+        uint64_t begin = GetCurrentTimeInMicroSeconds();
+        for (int32_t round = 0; round < rounds; ++round) {
+            LogGroup logGroup;
+            uint32_t logGroupSize = 0;
+            for (size_t i = 0; i < lines.size(); ++i) {
+                if (!parse(lines[i].c_str(), logGroup, logGroupSize)) {
+                    ++failures;
+                }
+                if ((i + 1) % kLinesPerGroup == 0) {
+                    logGroup.Clear();
+                    logGroupSize = 0;
+                }
+            }
+        }
+        Report(name, TotalBytes(lines) * rounds, lines.size() * rounds, GetCurrentTimeInMicroSeconds() - begin);
+        return failures;
+    }
+} // namespace
+
+class ParserBenchmark : public ::testing::Test {
+public:
+    static void SetUpTestCase() { BOOL_FLAG(ilogtail_discard_old_data) = false; }
+
+    void TestApsaraEasyReadLogLineParser() {
+        auto lines = MakeApsaraLines(INT32_FLAG(parser_benchmark_corpus_size));
+        std::string timeStr;
+        time_t lastLogTime = 0;
+        ParseLogError error;
+        size_t failures
+            = RunLines("ApsaraEasyReadLogLineParser", lines, [&](const char* line, LogGroup& group, uint32_t& size) {
+                  return LogParser::ApsaraEasyReadLogLineParser(
+                      line, group, true, timeStr, lastLogTime, "", "", "", "", error, size, 0, false);
+              });
+        APSARA_TEST_EQUAL(failures, 0UL);
+    }
+
+    void TestRegexLogLineParser() {
+        auto lines = MakeNginxLines(INT32_FLAG(parser_benchmark_corpus_size));
+        boost::regex reg(kNginxRegex);
+        re2::RE2::Options options;
+        options.set_dot_nl(true);
+        re2::RE2 re2Reg(kNginxRegex, options);
+        APSARA_TEST_TRUE_FATAL(re2Reg.ok());
+        std::vector<std::string> keys
+            = {"ip", "time", "method", "url", "protocol", "status", "size", "referer", "user_agent"};
+        ParseLogError error;
+        time_t now = time(NULL);
+        size_t failures
+            = RunLines("RegexLogLineParser/boost", lines, [&](const char* line, LogGroup& group, uint32_t& size) {
+                  return LogParser::RegexLogLineParser(line, reg, group, true, keys, "", now, "", "", "", error, size);
+              });
+        APSARA_TEST_EQUAL(failures, 0UL);
+        failures = RunLines("RegexLogLineParser/re2", lines, [&](const char* line, LogGroup& group, uint32_t& size) {
+            return LogParser::RegexLogLineParser(
+                line, reg, group, true, keys, "", now, "", "", "", error, size, &re2Reg);
+        });
+        APSARA_TEST_EQUAL(failures, 0UL);
+    }
+
+    void TestWholeLineModeParser() {
+        auto lines = MakeNginxLines(INT32_FLAG(parser_benchmark_corpus_size));
+        time_t now = time(NULL);
+        size_t failures
+            = RunLines("WholeLineModeParser", lines, [&](const char* line, LogGroup& group, uint32_t& size) {
+                  return LogParser::WholeLineModeParser(line, group, "content", now, size);
+              });
+        APSARA_TEST_EQUAL(failures, 0UL);
+    }
+
+    void TestDelimiterModeFsmParser() {
+        auto lines = MakeCsvLines(INT32_FLAG(parser_benchmark_corpus_size));
+        DelimiterModeFsmParser parser('"', ',');
+        std::vector<std::string> columnValues;
+        size_t failures
+            = RunLines("DelimiterModeFsmParser", lines, [&](const char* line, LogGroup& group, uint32_t& size) {
+                  columnValues.clear();
+                  return parser.ParseDelimiterLine(line, 0, strlen(line), columnValues) && columnValues.size() == 6;
+              });
+        APSARA_TEST_EQUAL(failures, 0UL);
+    }
+
+    void TestDelimiterModeBitmaskParser() {
+        auto lines = MakeCsvLines(INT32_FLAG(parser_benchmark_corpus_size));
+        DelimiterModeBitmaskParser parser('"', ',');
+        std::vector<DelimiterColumnSpan> columns;
+        size_t failures = RunLines(std::string("DelimiterModeBitmaskParser ")
+                                       + DelimiterModeBitmaskParser::GetBlockScannerName(),
+                                   lines,
+                                   [&](const char* line, LogGroup& group, uint32_t& size) {
+                                       columns.clear();
+                                       return parser.ParseDelimiterLine(line, 0, strlen(line), columns)
+                                           && columns.size() == 6;
+                                   });
+        APSARA_TEST_EQUAL(failures, 0UL);
+    }
+
+    void TestJsonLogFileReaderParseLogLine() {
+        auto lines = MakeJsonLines(INT32_FLAG(parser_benchmark_corpus_size));
+        JsonLogFileReader jsonReader("project", "logstore", ".", "benchmark.log", 0, "", "", "", ENCODING_UTF8, true);
+        LogFileReader& reader = jsonReader;
+        ParseLogError error;
+        time_t lastLogLineTime = 0;
+        std::string lastLogTimeStr;
+        size_t failures = RunLines(
+            "JsonLogFileReader::ParseLogLine", lines, [&](const char* line, LogGroup& group, uint32_t& size) {
+                return reader.ParseLogLine(line, group, error, lastLogLineTime, lastLogTimeStr, size);
+            });
+        APSARA_TEST_EQUAL(failures, 0UL);
+
+        jsonReader.SetRawNestedValue(true);
+        failures = RunLines("JsonLogFileReader::ParseLogLine raw nested value",
+                            lines,
+                            [&](const char* line, LogGroup& group, uint32_t& size) {
+                                return reader.ParseLogLine(line, group, error, lastLogLineTime, lastLogTimeStr, size);
+                            });
+        APSARA_TEST_EQUAL(failures, 0UL);
+    }
+
+    void TestLogSplit() {
+        const std::string beginRegex = "\\d{4}-\\d{2}-\\d{2} \\d{2}:\\d{2}:\\d{2}.*";
+        const std::string origin = MakeJavaMultilineBuffer(INT32_FLAG(parser_benchmark_corpus_size));
+        const int32_t rounds = INT32_FLAG(parser_benchmark_rounds);
+        CommonRegLogFileReader reader("project", "logstore", ".", "benchmark.log", 0, "%Y-%m-%d %H:%M:%S", "");
+        reader.SetLogBeginRegex(beginRegex);
+
+        for (int prefilter = 0; prefilter < 2; ++prefilter) {
+            reader.SetLogBeginRegexPrefilter(prefilter ? RegexPrefixFilter::Create(beginRegex) : nullptr);
+            std::string buffer;
+            size_t logs = 0;
+            int32_t lineFeed = 0;
+            uint64_t cost = 0;
+            for (int32_t round = 0; round < rounds; ++round) {
+                buffer = origin;
+                uint64_t begin = GetCurrentTimeInMicroSeconds();
+                logs += reader.LogSplit(&buffer[0], buffer.size(), lineFeed).size();
+                cost += GetCurrentTimeInMicroSeconds() - begin;
+            }
+            APSARA_TEST_TRUE(logs > 0);
+            Report(prefilter ? "LogSplit/java_multiline/prefilter" : "LogSplit/java_multiline",
+                   origin.size() * rounds,
+                   static_cast<size_t>(lineFeed) * rounds,
+                   cost);
+        }
+    }
+};
+
+UNIT_TEST_CASE(ParserBenchmark, TestApsaraEasyReadLogLineParser);
+UNIT_TEST_CASE(ParserBenchmark, TestRegexLogLineParser);
+UNIT_TEST_CASE(ParserBenchmark, TestWholeLineModeParser);
+UNIT_TEST_CASE(ParserBenchmark, TestDelimiterModeFsmParser);
+UNIT_TEST_CASE(ParserBenchmark, TestDelimiterModeBitmaskParser);
+UNIT_TEST_CASE(ParserBenchmark, TestJsonLogFileReaderParseLogLine);
+UNIT_TEST_CASE(ParserBenchmark, TestLogSplit);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,114 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <string>
+#include <vector>
+#include "polling/DirSnapshot.h"
+
+namespace logtail {
+
+class DirSnapshotUnittest : public ::testing::Test {
+public:
+    static int Count(const std::vector<DirSnapshotChange>& changes, DirSnapshotChange::Type type) {
+        int count = 0;
+        for (const auto& change : changes) {
+            count += change.mType == type ? 1 : 0;
+        }
+        return count;
+    }
+
+    void TestEntrySize() { APSARA_TEST_EQUAL(sizeof(DirSnapshotEntry), 32UL); }
+
+    void TestDiffUnchanged() {
+        DirSnapshot oldSnapshot, newSnapshot;
+        for (int i = 0; i < 100; ++i) {
+            oldSnapshot.Add("file" + std::to_string(i), i, i * 10, i * 100);
+            newSnapshot.Add("file" + std::to_string(99 - i), 99 - i, (99 - i) * 10, (99 - i) * 100);
+        }
+        oldSnapshot.Seal();
+        newSnapshot.Seal();
+        std::vector<DirSnapshotChange> changes;
+        DirSnapshot::Diff(oldSnapshot, newSnapshot, changes);
+        APSARA_TEST_EQUAL(changes.size(), 0UL);
+    }
+
+    void TestDiffChanges() {
+        DirSnapshot oldSnapshot, newSnapshot;
+        oldSnapshot.Add("a.log", 1, 100, 1000);
+        oldSnapshot.Add("b.log", 2, 100, 1000);
+        oldSnapshot.Add("c.log", 3, 100, 1000);
+        oldSnapshot.Add("d.log", 4, 100, 1000);
+        oldSnapshot.Seal();
+        // a.log is modified, b.log is renamed to b.log.1, c.log is deleted, d.log is replaced, e.log is new.
+        newSnapshot.Add("a.log", 1, 200, 2000);
+        newSnapshot.Add("b.log.1", 2, 100, 1000);
+        newSnapshot.Add("d.log", 5, 0, 3000);
+        newSnapshot.Add("e.log", 6, 0, 3000);
+        newSnapshot.Seal();
+
+        std::vector<DirSnapshotChange> changes;
+        DirSnapshot::Diff(oldSnapshot, newSnapshot, changes);
+        APSARA_TEST_EQUAL(changes.size(), 6UL);
+        APSARA_TEST_EQUAL(Count(changes, DirSnapshotChange::MODIFY), 1);
+        APSARA_TEST_EQUAL(Count(changes, DirSnapshotChange::RENAME), 1);
+        APSARA_TEST_EQUAL(Count(changes, DirSnapshotChange::DELETE), 2);
+        APSARA_TEST_EQUAL(Count(changes, DirSnapshotChange::CREATE), 2);
+        for (const auto& change : changes) {
+            switch (change.mType) {
+                case DirSnapshotChange::MODIFY:
+                    APSARA_TEST_EQUAL(change.mNew->mNameHash, DirSnapshot::HashName("a.log"));
+                    APSARA_TEST_EQUAL(change.mOld->mSize, 100UL);
+                    APSARA_TEST_EQUAL(change.mNew->mSize, 200UL);
+                    break;
+                case DirSnapshotChange::RENAME:
+                    APSARA_TEST_EQUAL(change.mOld->mNameHash, DirSnapshot::HashName("b.log"));
+                    APSARA_TEST_EQUAL(change.mNew->mNameHash, DirSnapshot::HashName("b.log.1"));
+                    break;
+                case DirSnapshotChange::DELETE:
+                    APSARA_TEST_TRUE(change.mNew == NULL);
+                    APSARA_TEST_TRUE(change.mOld->mInode == 3UL || change.mOld->mInode == 4UL);
+                    break;
+                case DirSnapshotChange::CREATE:
+                    APSARA_TEST_TRUE(change.mOld == NULL);
+                    APSARA_TEST_TRUE(change.mNew->mInode == 5UL || change.mNew->mInode == 6UL);
+                    break;
+            }
+        }
+    }
+
+    void TestDiffEmpty() {
+        DirSnapshot oldSnapshot, newSnapshot;
+        newSnapshot.Add("a.log", 1, 0, 0);
+        newSnapshot.Seal();
+        std::vector<DirSnapshotChange> changes;
+        DirSnapshot::Diff(oldSnapshot, newSnapshot, changes);
+        APSARA_TEST_EQUAL(changes.size(), 1UL);
+        APSARA_TEST_EQUAL(changes[0].mType, DirSnapshotChange::CREATE);
+
+        changes.clear();
+        DirSnapshot::Diff(newSnapshot, oldSnapshot, changes);
+        APSARA_TEST_EQUAL(changes.size(), 1UL);
+        APSARA_TEST_EQUAL(changes[0].mType, DirSnapshotChange::DELETE);
+    }
+};
+
+UNIT_TEST_CASE(DirSnapshotUnittest, TestEntrySize);
+UNIT_TEST_CASE(DirSnapshotUnittest, TestDiffUnchanged);
+UNIT_TEST_CASE(DirSnapshotUnittest, TestDiffChanges);
+UNIT_TEST_CASE(DirSnapshotUnittest, TestDiffEmpty);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,198 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstdlib>
+#include "processor/LogFilter.h"
+#include "processor/LogFilterProgram.h"
+#include "processor/BinaryFilterOperatorNode.h"
+#include "processor/UnaryFilterOperatorNode.h"
+#include "processor/RegexFilterValueNode.h"
+
+namespace logtail {
+
+class LogFilterProgramUnittest : public ::testing::Test {
+public:
+    void TestCompileRule() {
+        LogFilterRule rule;
+        rule.FilterKeys = {"a", "b", "c"};
+        rule.FilterRegs = {boost::regex("\\d+"), boost::regex("abc"), boost::regex("ab.*")};
+        rule.CompileProgram();
+        APSARA_TEST_TRUE_FATAL(rule.Program.get() != NULL);
+        APSARA_TEST_EQUAL(rule.Program->GetSlotCount(), 3UL);
+
+        sls_logs::LogGroup logGroup;
+        AddLog(logGroup, {{"a", "123"}, {"b", "abc"}, {"c", "ab"}});
+        AddLog(logGroup, {{"c", "abd\nx"}, {"b", "abc"}, {"a", "0"}});
+        AddLog(logGroup, {{"a", "12a"}, {"b", "abc"}, {"c", "ab"}});
+        AddLog(logGroup, {{"a", "1"}, {"b", "abcd"}, {"c", "ab"}});
+        AddLog(logGroup, {{"a", "1"}, {"b", "abc"}, {"c", "a"}});
+        AddLog(logGroup, {{"a", "1"}, {"b", "abc"}});
+        AddLog(logGroup, {{"a", "1"}, {"b", "abc"}, {"c", "ab"}, {"b", "x"}});
+        AddLog(logGroup, {{"a", "1"}, {"b", std::string("abc\0d", 5)}, {"c", "ab"}});
+
+        LogGroupContext context;
+        std::vector<int32_t> expected = {0, 1, 6, 7};
+        APSARA_TEST_TRUE(rule.Program->Filter(logGroup, context) == expected);
+        APSARA_TEST_TRUE(LogFilter::Instance()->Filter(logGroup, &rule, context) == expected);
+    }
+
+    void TestCompileExpression() {
+        // a > 0 && !(b == x || c startswith y)
+        BaseFilterNodePtr orNode(new BinaryFilterOperatorNode(OR_OPERATOR, Value("b", "x"), Value("c", "y.*")));
+        BaseFilterNodePtr notNode(new UnaryFilterOperatorNode(NOT_OPERATOR, orNode));
+        BaseFilterNodePtr root(new BinaryFilterOperatorNode(AND_OPERATOR, Value("a", "[1-9]\\d*"), notNode));
+        LogFilterProgram program;
+        APSARA_TEST_TRUE_FATAL(program.Compile(root));
+        APSARA_TEST_EQUAL(program.GetInstructionCount(), 3UL);
+
+        sls_logs::LogGroup logGroup;
+        AddLog(logGroup, {{"a", "1"}, {"b", "z"}, {"c", "z"}});
+        AddLog(logGroup, {{"a", "1"}, {"b", "x"}, {"c", "z"}});
+        AddLog(logGroup, {{"a", "1"}, {"b", "z"}, {"c", "yy"}});
+        AddLog(logGroup, {{"a", "0"}, {"b", "z"}, {"c", "z"}});
+        AddLog(logGroup, {{"a", "10"}});
+        LogGroupContext context;
+        std::vector<int32_t> expected = {0, 4};
+        APSARA_TEST_TRUE(program.Filter(logGroup, context) == expected);
+
+        // Unknown nodes can not be compiled.
+        BaseFilterNodePtr unknown(new BinaryFilterOperatorNode(
+            AND_OPERATOR, Value("a", "1"), BaseFilterNodePtr(new BaseFilterNode(VALUE_NODE))));
+        APSARA_TEST_TRUE(!program.Compile(unknown));
+    }
+
+    // Random expressions must filter the same as the expression tree.
+    void TestSameAsExpressionTree() {
+        const char* keys[] = {"a", "b", "c"};
+        const char* values[] = {"", "x", "xy", "12", "x1", "y"};
+        srand(0);
+        LogGroupContext context;
+        for (int round = 0; round < 200; ++round) {
+            BaseFilterNodePtr root = RandomNode(4);
+            LogFilterProgram program;
+            APSARA_TEST_TRUE_FATAL(program.Compile(root));
+
+            sls_logs::LogGroup logGroup;
+            for (int i = 0; i < 50; ++i) {
+                sls_logs::Log* log = logGroup.add_logs();
+                for (int j = rand() % 4; j > 0; --j) {
+                    sls_logs::Log_Content* content = log->add_contents();
+                    content->set_key(keys[rand() % 3]);
+                    content->set_value(values[rand() % 6]);
+                }
+            }
+            std::vector<int32_t> expected = LogFilter::Instance()->Filter(logGroup, root, context);
+            APSARA_TEST_TRUE_FATAL(program.Filter(logGroup, context) == expected);
+            // Single log evaluation must be the same as the batch one.
+            std::vector<int32_t> slotIndexes(program.GetSlotCount());
+            std::vector<int32_t> matched;
+            for (int i = 0; i < logGroup.logs_size(); ++i) {
+                if (program.Match(logGroup.logs(i), context, slotIndexes)) {
+                    matched.push_back(i);
+                }
+            }
+            APSARA_TEST_TRUE_FATAL(matched == expected);
+            // Accepted logs always contain required literals.
+            for (const auto& item : program.GetRequiredLiterals()) {
+                for (int32_t i : expected) {
+                    const sls_logs::Log& log = logGroup.logs(i);
+                    int j = 0;
+                    while (j < log.contents_size() && log.contents(j).key() != item.first) {
+                        ++j;
+                    }
+                    APSARA_TEST_TRUE_FATAL(j < log.contents_size());
+                    APSARA_TEST_TRUE_FATAL(log.contents(j).value().find(item.second) != std::string::npos);
+                }
+            }
+        }
+    }
+
+    void TestRequiredLiterals() {
+        typedef std::vector<std::pair<std::string, std::string>> Literals;
+        LogFilterRule rule;
+        rule.FilterKeys = {"a", "b", "c"};
+        rule.FilterRegs = {boost::regex("\\d+"), boost::regex("abc"), boost::regex("ab.*")};
+        rule.CompileProgram();
+        APSARA_TEST_TRUE(rule.Program->GetRequiredLiterals() == Literals({{"b", "abc"}, {"c", "ab"}}));
+
+        // Matches under NOT are not required.
+        LogFilterProgram program;
+        BaseFilterNodePtr notNode(new UnaryFilterOperatorNode(NOT_OPERATOR, Value("b", "x")));
+        APSARA_TEST_TRUE(program.Compile(And(Value("a", "y"), notNode)));
+        APSARA_TEST_TRUE(program.GetRequiredLiterals() == Literals({{"a", "y"}}));
+
+        // Only the literal in both operands of OR is required.
+        BaseFilterNodePtr left = And(Value("level", "ERROR"), Value("a", "x"));
+        BaseFilterNodePtr right = And(Value("level", "ERROR.*"), Value("b", "y"));
+        APSARA_TEST_TRUE(program.Compile(Or(left, right)));
+        APSARA_TEST_TRUE(program.GetRequiredLiterals() == Literals({{"level", "ERROR"}}));
+        APSARA_TEST_TRUE(program.Compile(Or(Value("a", "x"), Value("a", "y"))));
+        APSARA_TEST_TRUE(program.GetRequiredLiterals().empty());
+
+        // Regexes and .* have no literals.
+        APSARA_TEST_TRUE(program.Compile(Value("a", "x|y")));
+        APSARA_TEST_TRUE(program.GetRequiredLiterals().empty());
+        APSARA_TEST_TRUE(program.Compile(Value("a", ".*")));
+        APSARA_TEST_TRUE(program.GetRequiredLiterals().empty());
+        APSARA_TEST_TRUE(program.Compile(BaseFilterNodePtr()));
+        APSARA_TEST_TRUE(program.GetRequiredLiterals().empty());
+    }
+
+private:
+    static BaseFilterNodePtr Value(const std::string& key, const std::string& exp) {
+        return BaseFilterNodePtr(new RegexFilterValueNode(key, exp));
+    }
+
+    static BaseFilterNodePtr And(const BaseFilterNodePtr& left, const BaseFilterNodePtr& right) {
+        return BaseFilterNodePtr(new BinaryFilterOperatorNode(AND_OPERATOR, left, right));
+    }
+
+    static BaseFilterNodePtr Or(const BaseFilterNodePtr& left, const BaseFilterNodePtr& right) {
+        return BaseFilterNodePtr(new BinaryFilterOperatorNode(OR_OPERATOR, left, right));
+    }
+
+    static BaseFilterNodePtr RandomNode(int depth) {
+        const char* keys[] = {"a", "b", "c"};
+        const char* exps[] = {".*", "x", "x.*", "\\d+", "x|y", ""};
+        int type = depth == 0 ? 0 : rand() % 4;
+        if (type == 0) {
+            return Value(keys[rand() % 3], exps[rand() % 6]);
+        }
+        if (type == 1) {
+            return BaseFilterNodePtr(new UnaryFilterOperatorNode(NOT_OPERATOR, RandomNode(depth - 1)));
+        }
+        return BaseFilterNodePtr(new BinaryFilterOperatorNode(
+            type == 2 ? AND_OPERATOR : OR_OPERATOR, RandomNode(depth - 1), RandomNode(depth - 1)));
+    }
+
+    static void AddLog(sls_logs::LogGroup& logGroup,
+                       const std::vector<std::pair<std::string, std::string>>& contents) {
+        sls_logs::Log* log = logGroup.add_logs();
+        for (const auto& kv : contents) {
+            sls_logs::Log_Content* content = log->add_contents();
+            content->set_key(kv.first);
+            content->set_value(kv.second);
+        }
+    }
+};
+
+UNIT_TEST_CASE(LogFilterProgramUnittest, TestCompileRule);
+UNIT_TEST_CASE(LogFilterProgramUnittest, TestCompileExpression);
+UNIT_TEST_CASE(LogFilterProgramUnittest, TestSameAsExpressionTree);
+UNIT_TEST_CASE(LogFilterProgramUnittest, TestRequiredLiterals);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
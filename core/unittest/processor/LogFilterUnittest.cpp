@@ -405,6 +405,57 @@ public:
         LOG_INFO(sLogger, ("TestCastSensWordMulti() end", time(NULL)));
     }
 
+    void TestCastSensWordSet() {
+        LOG_INFO(sLogger, ("TestCastSensWordSet() begin", time(NULL)));
+        Json::Value allVal;
+        const char* items[][5] = {{"const", "a=", "[^,]+", "secret", "true"},
+                                  {"md5", "card=", "\\d+", "", "false"},
+                                  {"const", "sec", "ret", "***", "false"},
+                                  {"const", "token=", "\\w+", "x", "true"}};
+        for (const auto& item : items) {
+            Json::Value val;
+            val["key"] = Json::Value("cast1");
+            val["type"] = Json::Value(item[0]);
+            val["regex_begin"] = Json::Value(item[1]);
+            val["regex_content"] = Json::Value(item[2]);
+            val["const"] = Json::Value(item[3]);
+            val["all"] = Json::Value(string(item[4]) == "true");
+            allVal.append(val);
+        }
+        Config* pConfig = new Config;
+        ConfigManager::GetInstance()->GetSensitiveKeys(allVal, pConfig);
+        APSARA_TEST_EQUAL(pConfig->mSensitiveWordCastOptions["cast1"].size(), 4UL);
+        APSARA_TEST_EQUAL(pConfig->mSensitiveWordCastSets.size(), 1UL);
+        Config* pPlainConfig = new Config;
+        pPlainConfig->mSensitiveWordCastOptions = pConfig->mSensitiveWordCastOptions;
+
+        const char* values[] = {"nothing to cast",
+                                "a=1,b=2",
+                                "card=1234,a=x,a=y",
+                                "token=abc token=def,secret",
+                                "a=1,card=2,token=3",
+                                ""};
+        for (const char* value : values) {
+            Log_Content content;
+            content.set_key("cast1");
+            content.set_value(value);
+            Log_Content plainContent = content;
+            LogFilter::CastOneSensitiveWord(&content, pConfig);
+            LogFilter::CastOneSensitiveWord(&plainContent, pPlainConfig);
+            APSARA_TEST_EQUAL_DESC(content.value(), plainContent.value(), value);
+        }
+        // The replacement of the first option enables the third one.
+        Log_Content content;
+        content.set_key("cast1");
+        content.set_value("a=1,b");
+        LogFilter::CastOneSensitiveWord(&content, pConfig);
+        APSARA_TEST_EQUAL(content.value(), "a=sec***,b");
+
+        delete pPlainConfig;
+        delete pConfig;
+        LOG_INFO(sLogger, ("TestCastSensWordSet() end", time(NULL)));
+    }
+
     void TestCastWholeKey() {
         LOG_INFO(sLogger, ("TestCastWholeKey() begin", time(NULL)));
         Config* pConfig = GetCastSensWordConfig("pwd", "().*", 1, false, "\\1********");
@@ -1337,6 +1388,7 @@ APSARA_UNIT_TEST_CASE(LogFilterUnittest, TestCastSensWordFail, 0);
 APSARA_UNIT_TEST_CASE(LogFilterUnittest, TestCastSensWordLoggroup, 0);
 APSARA_UNIT_TEST_CASE(LogFilterUnittest, TestCastSensWordMulti, 0);
 APSARA_UNIT_TEST_CASE(LogFilterUnittest, TestCastWholeKey, 0);
+APSARA_UNIT_TEST_CASE(LogFilterUnittest, TestCastSensWordSet, 0);
 APSARA_UNIT_TEST_CASE(LogFilterUnittest, TestInitFilter, 0);
 APSARA_UNIT_TEST_CASE(LogFilterUnittest, TestInitFilterFail, 0);
 APSARA_UNIT_TEST_CASE(LogFilterUnittest, TestInitFilterMissFieldFail, 0);
@@ -0,0 +1,155 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <map>
+#include <string>
+#include <vector>
+#include "unittest/Unittest.h"
+#include "common/TDigest.h"
+#include "processor/LogToMetric.h"
+
+namespace logtail {
+
+class LogToMetricUnittest : public ::testing::Test {
+public:
+    static void AddLog(sls_logs::LogGroup& logGroup,
+                       uint32_t time,
+                       const std::vector<std::pair<std::string, std::string>>& contents) {
+        sls_logs::Log* log = logGroup.add_logs();
+        log->set_time(time);
+        for (const auto& item : contents) {
+            sls_logs::Log_Content* content = log->add_contents();
+            content->set_key(item.first);
+            content->set_value(item.second);
+        }
+    }
+
+    static std::map<std::string, std::string> GetContents(const sls_logs::Log& log) {
+        std::map<std::string, std::string> contents;
+        for (int i = 0; i < log.contents_size(); ++i) {
+            contents[log.contents(i).key()] = log.contents(i).value();
+        }
+        return contents;
+    }
+
+    static std::vector<int32_t> AllLogs(const sls_logs::LogGroup& logGroup) {
+        std::vector<int32_t> indexes;
+        for (int32_t i = 0; i < logGroup.logs_size(); ++i) {
+            indexes.push_back(i);
+        }
+        return indexes;
+    }
+
+    static LogToMetricConfig MakeConfig() {
+        LogToMetricConfig config;
+        config.mGroupKeys = {"method"};
+        config.mValueKeys = {"latency"};
+        config.mWindowSeconds = 60;
+        config.mQuantiles = {0.5};
+        return config;
+    }
+
+    void TestAggregate() {
+        LogToMetricAggregator aggregator(MakeConfig(), 100);
+        sls_logs::LogGroup input;
+        for (int i = 1; i <= 100; ++i) {
+            AddLog(input, 1200 + i % 60, {{"method", "GET"}, {"latency", std::to_string(i)}});
+        }
+        AddLog(input, 1200, {{"method", "POST"}, {"latency", "12ms"}});
+        AddLog(input, 1200, {{"latency", "3"}});
+        AddLog(input, 1260, {{"method", "GET"}, {"latency", "7"}});
+        std::vector<int32_t> neededLogs = AllLogs(input);
+        aggregator.Add(input, neededLogs);
+        APSARA_TEST_TRUE(neededLogs.empty());
+
+        sls_logs::LogGroup output;
+        APSARA_TEST_EQUAL(aggregator.Flush(1259, false, output), 0U);
+        APSARA_TEST_EQUAL(aggregator.Flush(1260, false, output), 3U);
+        std::map<std::string, std::map<std::string, std::string>> metrics;
+        for (int i = 0; i < output.logs_size(); ++i) {
+            APSARA_TEST_EQUAL(output.logs(i).time(), 1200U);
+            auto contents = GetContents(output.logs(i));
+            metrics[contents.count("method") > 0 ? contents["method"] : "<missing>"] = contents;
+        }
+        auto& get = metrics["GET"];
+        APSARA_TEST_EQUAL(get["count"], "100");
+        APSARA_TEST_EQUAL(get["window_seconds"], "60");
+        APSARA_TEST_EQUAL(get["latency_count"], "100");
+        APSARA_TEST_EQUAL(get["latency_sum"], "5050");
+        APSARA_TEST_EQUAL(get["latency_min"], "1");
+        APSARA_TEST_EQUAL(get["latency_max"], "100");
+        APSARA_TEST_TRUE(std::abs(std::stod(get["latency_p50"]) - 50.5) <= 1);
+        TDigest digest;
+        APSARA_TEST_TRUE(digest.Deserialize(get["latency_sketch"]));
+        APSARA_TEST_EQUAL(digest.Count(), 100U);
+        // Values which are not numbers are not summarized, the log is still counted.
+        auto& post = metrics["POST"];
+        APSARA_TEST_EQUAL(post["count"], "1");
+        APSARA_TEST_EQUAL(post["latency_count"], "0");
+        APSARA_TEST_EQUAL(post.count("latency_sketch"), 0U);
+        // A missing key is not the same group as an empty value.
+        APSARA_TEST_EQUAL(metrics["<missing>"]["count"], "1");
+
+        output.Clear();
+        APSARA_TEST_EQUAL(aggregator.Flush(1260, true, output), 1U);
+        APSARA_TEST_EQUAL(output.logs(0).time(), 1260U);
+        APSARA_TEST_EQUAL(aggregator.Flush(2000, true, output), 0U);
+    }
+
+    void TestSample() {
+        LogToMetricConfig config = MakeConfig();
+        config.mRawLogSampleRatio = 0.25;
+        LogToMetricAggregator aggregator(config, 100);
+        sls_logs::LogGroup input;
+        for (int i = 0; i < 100; ++i) {
+            AddLog(input, 1200, {{"method", "GET"}, {"latency", "1"}});
+        }
+        std::vector<int32_t> neededLogs = AllLogs(input);
+        aggregator.Add(input, neededLogs);
+        APSARA_TEST_EQUAL(neededLogs.size(), 25U);
+        APSARA_TEST_EQUAL(neededLogs[0], 3);
+        // All logs are aggregated, sampled ones included.
+        sls_logs::LogGroup output;
+        aggregator.Flush(0, true, output);
+        APSARA_TEST_EQUAL(GetContents(output.logs(0))["count"], "100");
+    }
+
+    void TestMaxGroups() {
+        LogToMetricAggregator aggregator(MakeConfig(), 2);
+        sls_logs::LogGroup input;
+        for (int i = 0; i < 10; ++i) {
+            AddLog(input, 1200, {{"method", "m" + std::to_string(i)}, {"latency", "1"}});
+        }
+        std::vector<int32_t> neededLogs = AllLogs(input);
+        aggregator.Add(input, neededLogs);
+        sls_logs::LogGroup output;
+        APSARA_TEST_EQUAL(aggregator.Flush(0, true, output), 3U);
+        std::map<std::string, std::string> counts;
+        for (int i = 0; i < output.logs_size(); ++i) {
+            auto contents = GetContents(output.logs(i));
+            counts[contents["method"]] = contents["count"];
+        }
+        APSARA_TEST_EQUAL(counts["m0"], "1");
+        APSARA_TEST_EQUAL(counts["m1"], "1");
+        APSARA_TEST_EQUAL(counts["__other__"], "8");
+    }
+};
+
+UNIT_TEST_CASE(LogToMetricUnittest, TestAggregate);
+UNIT_TEST_CASE(LogToMetricUnittest, TestSample);
+UNIT_TEST_CASE(LogToMetricUnittest, TestMaxGroups);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,162 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <memory>
+#include <string>
+#include "log_pb/sls_logs.pb.h"
+#include "processor/NativeProcessor.h"
+
+namespace logtail {
+
+class NativeProcessorUnittest : public ::testing::Test {
+public:
+    void TestRegex() {
+        std::unique_ptr<NativeProcessor> processor(Create(R"json({"type":"processor_regex","detail":)json"
+                                                          R"json({"Regex":"(\\w+) (\\d+)","Keys":["a","b"]}})json"));
+        APSARA_TEST_TRUE_FATAL(processor != nullptr);
+        sls_logs::LogGroup logGroup;
+        AddLog(logGroup, {{"tag", "x"}, {"content", "hello 123"}});
+        AddLog(logGroup, {{"content", "unmatched"}});
+        AddLog(logGroup, {{"other", "value"}});
+        processor->Process(logGroup);
+
+        APSARA_TEST_EQUAL_FATAL(logGroup.logs_size(), 3);
+        APSARA_TEST_EQUAL(ToString(logGroup.logs(0)), "tag=x,a=hello,b=123,");
+        APSARA_TEST_EQUAL(logGroup.logs(0).time(), 1680000000U);
+        // Source is kept if it is not parsed.
+        APSARA_TEST_EQUAL(ToString(logGroup.logs(1)), "content=unmatched,");
+        APSARA_TEST_EQUAL(ToString(logGroup.logs(2)), "other=value,");
+
+        APSARA_TEST_TRUE(Create(R"json({"type":"processor_regex","detail":{"Regex":"(","Keys":["a"]}})json")
+                         == nullptr);
+        APSARA_TEST_TRUE(Create(R"json({"type":"processor_regex","detail":{"Regex":"(.*)"}})json") == nullptr);
+    }
+
+    void TestJson() {
+        std::unique_ptr<NativeProcessor> processor(
+            Create(R"({"type":"processor_json","detail":{"SourceKey":"content","KeepSource":true}})"));
+        APSARA_TEST_TRUE_FATAL(processor != nullptr);
+        sls_logs::LogGroup logGroup;
+        AddLog(logGroup, {{"content", R"({"s":"v","n":1,"o":{"k":[1,2]}})"}});
+        AddLog(logGroup, {{"content", "not json"}});
+        processor->Process(logGroup);
+
+        APSARA_TEST_EQUAL(ToString(logGroup.logs(0)),
+                          R"(content={"s":"v","n":1,"o":{"k":[1,2]}},s=v,n=1,o={"k":[1,2]},)");
+        APSARA_TEST_EQUAL(ToString(logGroup.logs(1)), "content=not json,");
+    }
+
+    void TestDelimiter() {
+        std::unique_ptr<NativeProcessor> processor(Create(R"({"type":"processor_delimiter","detail":)"
+                                                          R"({"Separator":",","Keys":["a","b"],)"
+                                                          R"("KeepSourceIfParseError":false}})"));
+        APSARA_TEST_TRUE_FATAL(processor != nullptr);
+        sls_logs::LogGroup logGroup;
+        AddLog(logGroup, {{"content", "1,\"x,\"\"y\"\"\",3"}});
+        AddLog(logGroup, {{"content", "1,\"x"}});
+        processor->Process(logGroup);
+
+        APSARA_TEST_EQUAL(ToString(logGroup.logs(0)), "a=1,b=x,\"y\",__column2__=3,");
+        APSARA_TEST_EQUAL(ToString(logGroup.logs(1)), "");
+
+        APSARA_TEST_TRUE(Create(R"({"type":"processor_delimiter","detail":{"Separator":"||","Keys":["a"]}})")
+                         == nullptr);
+    }
+
+    void TestFilterRegex() {
+        std::unique_ptr<NativeProcessor> processor(Create(R"({"type":"processor_filter_regex","detail":)"
+                                                          R"({"Include":{"level":"ERROR|WARN"},)"
+                                                          R"("Exclude":{"msg":".*ignored.*"}}})"));
+        APSARA_TEST_TRUE_FATAL(processor != nullptr);
+        sls_logs::LogGroup logGroup;
+        AddLog(logGroup, {{"level", "INFO"}, {"msg", "a"}});
+        AddLog(logGroup, {{"level", "ERROR"}, {"msg", "b"}});
+        AddLog(logGroup, {{"level", "WARN"}, {"msg", "this is ignored"}});
+        AddLog(logGroup, {{"msg", "d"}});
+        AddLog(logGroup, {{"level", "WARN"}, {"msg", "e"}});
+        processor->Process(logGroup);
+
+        APSARA_TEST_EQUAL_FATAL(logGroup.logs_size(), 2);
+        APSARA_TEST_EQUAL(ToString(logGroup.logs(0)), "level=ERROR,msg=b,");
+        APSARA_TEST_EQUAL(ToString(logGroup.logs(1)), "level=WARN,msg=e,");
+    }
+
+    void TestManager() {
+        NativeProcessorManager* manager = NativeProcessorManager::GetInstance();
+        std::string error;
+        APSARA_TEST_EQUAL(manager->Create("{", error), -1);
+        APSARA_TEST_EQUAL(manager->Create(R"({"type":"processor_unknown"})", error), -1);
+        APSARA_TEST_FALSE(error.empty());
+        const int64_t id = manager->Create(
+            R"json({"type":"processor_regex","detail":{"Regex":"(\\w+)=(\\w+)","Keys":["k","v"]}})json", error);
+        APSARA_TEST_TRUE_FATAL(id > 0);
+        APSARA_TEST_EQUAL(manager->GetProcessorCount(), 1UL);
+
+        sls_logs::LogGroup logGroup;
+        logGroup.set_category("logstore");
+        AddLog(logGroup, {{"content", "a=b"}});
+        const std::string input = logGroup.SerializeAsString();
+        std::string output;
+        APSARA_TEST_TRUE(manager->Process(id, input.data(), input.size(), output));
+        sls_logs::LogGroup result;
+        APSARA_TEST_TRUE_FATAL(result.ParseFromString(output));
+        APSARA_TEST_EQUAL(result.category(), "logstore");
+        APSARA_TEST_EQUAL(ToString(result.logs(0)), "k=a,v=b,");
+
+        APSARA_TEST_FALSE(manager->Process(id, "invalid", 7, output));
+        APSARA_TEST_TRUE(manager->Destroy(id));
+        APSARA_TEST_FALSE(manager->Destroy(id));
+        APSARA_TEST_FALSE(manager->Process(id, input.data(), input.size(), output));
+    }
+
+private:
+    NativeProcessor* Create(const std::string& config) {
+        Json::Value root;
+        Json::Reader reader;
+        if (!reader.parse(config, root)) {
+            return NULL;
+        }
+        std::string error;
+        return NativeProcessor::Create(root, error);
+    }
+
+    void AddLog(sls_logs::LogGroup& logGroup, const std::vector<std::pair<std::string, std::string>>& contents) {
+        sls_logs::Log* log = logGroup.add_logs();
+        log->set_time(1680000000);
+        for (const auto& content : contents) {
+            sls_logs::Log_Content* logContent = log->add_contents();
+            logContent->set_key(content.first);
+            logContent->set_value(content.second);
+        }
+    }
+
+    std::string ToString(const sls_logs::Log& log) {
+        std::string result;
+        for (const auto& content : log.contents()) {
+            result += content.key() + "=" + content.value() + ",";
+        }
+        return result;
+    }
+};
+
+UNIT_TEST_CASE(NativeProcessorUnittest, TestRegex);
+UNIT_TEST_CASE(NativeProcessorUnittest, TestJson);
+UNIT_TEST_CASE(NativeProcessorUnittest, TestDelimiter);
+UNIT_TEST_CASE(NativeProcessorUnittest, TestFilterRegex);
+UNIT_TEST_CASE(NativeProcessorUnittest, TestManager);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,98 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "common/Flags.h"
+#include "common/Constants.h"
+#include "config/Config.h"
+#include "processor/LogFilter.h"
+#include "processor/ProcessPipeline.h"
+
+DECLARE_FLAG_BOOL(plugin_raw_log_batch_enable);
+
+namespace logtail {
+
+class ProcessPipelineUnittest : public ::testing::Test {
+public:
+    void TestCompileDefault() {
+        Config config;
+        config.mDiscardUnmatch = false;
+        std::shared_ptr<const ProcessPipeline> pipeline = ProcessPipeline::Compile(config);
+        APSARA_TEST_EQUAL(pipeline->mPluginStage, ProcessPipeline::PLUGIN_STAGE_RAW_LOG);
+        APSARA_TEST_TRUE(pipeline->mKeepUnmatch);
+        APSARA_TEST_FALSE(pipeline->mAppendTruncateInfo);
+        APSARA_TEST_EQUAL(pipeline->mCompressType, sls_logs::SLS_CMP_LZ4);
+        APSARA_TEST_TRUE(pipeline->mIntegrityConfig.get() == NULL);
+        APSARA_TEST_TRUE(pipeline->mLineCountConfig.get() == NULL);
+    }
+
+    void TestCompileSwitches() {
+        Config config;
+        config.mDiscardUnmatch = true;
+        config.mIsFuseMode = true;
+        config.mCompressType = "zstd";
+        config.mAdvancedConfig.mPassTagsToPlugin = true;
+        config.mAdvancedConfig.mEnableLogPositionMeta = true;
+        config.mIntegrityConfig.reset(new IntegrityConfig("1", true, "project", "logstore", "", "", 0));
+        config.mLineCountConfig.reset(new LineCountConfig("1", false, "project", "logstore"));
+
+        bool batchEnable = BOOL_FLAG(plugin_raw_log_batch_enable);
+        BOOL_FLAG(plugin_raw_log_batch_enable) = true;
+        std::shared_ptr<const ProcessPipeline> pipeline = ProcessPipeline::Compile(config);
+        APSARA_TEST_EQUAL(pipeline->mPluginStage, ProcessPipeline::PLUGIN_STAGE_RAW_LOGS_V2);
+        BOOL_FLAG(plugin_raw_log_batch_enable) = false;
+        APSARA_TEST_EQUAL(ProcessPipeline::Compile(config)->mPluginStage, ProcessPipeline::PLUGIN_STAGE_RAW_LOG_V2);
+        BOOL_FLAG(plugin_raw_log_batch_enable) = batchEnable;
+
+        APSARA_TEST_FALSE(pipeline->mKeepUnmatch);
+        APSARA_TEST_TRUE(pipeline->mAppendTruncateInfo);
+        APSARA_TEST_TRUE(pipeline->mAppendPositionMeta);
+        APSARA_TEST_EQUAL(pipeline->mCompressType, sls_logs::SLS_CMP_ZSTD);
+        // Shared with the config, line count is off.
+        APSARA_TEST_TRUE(pipeline->mIntegrityConfig == config.mIntegrityConfig);
+        APSARA_TEST_TRUE(pipeline->mLineCountConfig.get() == NULL);
+    }
+
+    void TestCompileRequiredLiterals() {
+        Config config;
+        config.mLogType = REGEX_LOG;
+        config.mFilterRule.reset(new LogFilterRule);
+        config.mFilterRule->FilterKeys = {"level", "msg", "a", LOG_RESERVED_KEY_FILE_OFFSET};
+        config.mFilterRule->FilterRegs
+            = {boost::regex("ERROR"), boost::regex("timeout.*"), boost::regex("\\d+"), boost::regex("1")};
+        config.mFilterRule->CompileProgram();
+        // Longer first, the value of offset key is not from lines.
+        APSARA_TEST_TRUE(ProcessPipeline::Compile(config)->mRequiredLiterals
+                         == std::vector<std::string>({"timeout", "ERROR"}));
+
+        config.mLogType = DELIMITER_LOG;
+        config.mQuote = 'E';
+        APSARA_TEST_TRUE(ProcessPipeline::Compile(config)->mRequiredLiterals == std::vector<std::string>({"timeout"}));
+
+        // JSON values may be unescaped.
+        config.mLogType = JSON_LOG;
+        APSARA_TEST_TRUE(ProcessPipeline::Compile(config)->mRequiredLiterals.empty());
+        config.mLogType = REGEX_LOG;
+        config.mPluginProcessFlag = true;
+        APSARA_TEST_TRUE(ProcessPipeline::Compile(config)->mRequiredLiterals.empty());
+    }
+};
+
+UNIT_TEST_CASE(ProcessPipelineUnittest, TestCompileDefault);
+UNIT_TEST_CASE(ProcessPipelineUnittest, TestCompileSwitches);
+UNIT_TEST_CASE(ProcessPipelineUnittest, TestCompileRequiredLiterals);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,136 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cstring>
+#include <vector>
+#include "unittest/Unittest.h"
+#include "common/FileSystemUtil.h"
+#include "processor/ProcessQueueSpill.h"
+#include "reader/LogBufferPool.h"
+#include "reader/LogFileReader.h"
+
+namespace logtail {
+
+class ProcessQueueSpillUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mDirPath = "ProcessQueueSpillUnittestDir";
+        mReader.reset(new CommonRegLogFileReader("testProject", "testLogstore", ".", "test.log", 0, "", ""));
+        mReader->SetLastFilePos(1000);
+    }
+
+    void TearDown() override {
+        for (LogBuffer* buffer : mPushed) {
+            delete buffer;
+        }
+        mPushed.clear();
+        mReader.reset();
+        bfs::remove_all(mDirPath);
+    }
+
+    LogBuffer* NewBuffer(const std::string& data, uint64_t beginOffset) {
+        LogBufferSlabPtr slab = LogBufferPool::GetInstance()->Acquire(data.size() + 1);
+        memcpy(slab.get(), data.data(), data.size());
+        slab.get()[data.size()] = '\0';
+        LogBuffer* buffer = new LogBuffer(slab, data.size());
+        buffer->beginOffset = beginOffset;
+        buffer->SetDependecy(mReader);
+        return buffer;
+    }
+
+    ProcessQueueSpill::PushFunc Push(bool& accept) {
+        return [this, &accept](LogBuffer* buffer) {
+            if (!accept) {
+                return false;
+            }
+            mPushed.push_back(buffer);
+            return true;
+        };
+    }
+
+    void TestSpillAndRestoreInOrder() {
+        ProcessQueueSpill spill(mDirPath, 1024 * 1024);
+        bool accept = true;
+        APSARA_TEST_TRUE(spill.PushOrSpill(1, NewBuffer("a", 100), true, Push(accept)));
+        APSARA_TEST_EQUAL(mPushed.size(), 1U);
+
+        // Queue is full, buffers are spilled.
+        APSARA_TEST_TRUE(spill.PushOrSpill(1, NewBuffer("bb", 200), false, Push(accept)));
+        APSARA_TEST_TRUE(spill.HasSpilled(1));
+        APSARA_TEST_EQUAL(mReader->GetCheckpointOffset(), 200);
+        // Spilled before pushed even if the queue is valid again.
+        APSARA_TEST_TRUE(spill.PushOrSpill(1, NewBuffer("ccc", 300), true, Push(accept)));
+        APSARA_TEST_EQUAL(mPushed.size(), 1U);
+        APSARA_TEST_EQUAL(spill.GetSpilledCount(), 2U);
+        APSARA_TEST_TRUE(spill.GetSpilledBytes() > 0);
+        APSARA_TEST_FALSE(spill.HasSpilled(2));
+
+        size_t canPushCount = 1;
+        auto canPush = [&canPushCount]() { return canPushCount-- > 0; };
+        APSARA_TEST_EQUAL(spill.Restore(1, canPush, Push(accept)), 1U);
+        APSARA_TEST_EQUAL(mPushed.size(), 2U);
+        APSARA_TEST_EQUAL(std::string(mPushed[1]->buffer, mPushed[1]->bufferSize), std::string("bb"));
+        // The checkpoint stays at the first spilled buffer until all are restored.
+        APSARA_TEST_EQUAL(mReader->GetCheckpointOffset(), 200);
+
+        canPushCount = 10;
+        APSARA_TEST_EQUAL(spill.Restore(1, canPush, Push(accept)), 1U);
+        APSARA_TEST_EQUAL(std::string(mPushed[2]->buffer), std::string("ccc"));
+        APSARA_TEST_FALSE(spill.HasSpilled(1));
+        APSARA_TEST_EQUAL(spill.GetSpilledBytes(), 0U);
+        APSARA_TEST_EQUAL(mReader->GetCheckpointOffset(), 1000);
+    }
+
+    void TestRestoreRejected() {
+        ProcessQueueSpill spill(mDirPath, 1024 * 1024);
+        bool accept = true;
+        APSARA_TEST_TRUE(spill.PushOrSpill(1, NewBuffer("a", 100), false, Push(accept)));
+        accept = false;
+        auto canPush = []() { return true; };
+        APSARA_TEST_EQUAL(spill.Restore(1, canPush, Push(accept)), 0U);
+        APSARA_TEST_TRUE(spill.HasSpilled(1));
+        accept = true;
+        APSARA_TEST_EQUAL(spill.Restore(1, canPush, Push(accept)), 1U);
+        APSARA_TEST_EQUAL(std::string(mPushed[0]->buffer), std::string("a"));
+    }
+
+    void TestLimit() {
+        ProcessQueueSpill spill(mDirPath, 1);
+        bool accept = false;
+        APSARA_TEST_TRUE(spill.PushOrSpill(1, NewBuffer("a", 100), false, Push(accept)));
+        APSARA_TEST_FALSE(spill.CanSpill());
+        // Nothing of logstore 2 is spilled, it is pushed directly as if spill is disabled.
+        accept = true;
+        APSARA_TEST_TRUE(spill.PushOrSpill(2, NewBuffer("b", 200), false, Push(accept)));
+        APSARA_TEST_EQUAL(mPushed.size(), 1U);
+        // Logstore 1 has to wait, its buffers must not go before the spilled one.
+        LogBuffer* buffer = NewBuffer("c", 300);
+        APSARA_TEST_FALSE(spill.PushOrSpill(1, buffer, true, Push(accept)));
+        delete buffer;
+    }
+
+private:
+    std::string mDirPath;
+    LogFileReaderPtr mReader;
+    std::vector<LogBuffer*> mPushed;
+};
+
+UNIT_TEST_CASE(ProcessQueueSpillUnittest, TestSpillAndRestoreInOrder);
+UNIT_TEST_CASE(ProcessQueueSpillUnittest, TestRestoreRejected);
+UNIT_TEST_CASE(ProcessQueueSpillUnittest, TestLimit);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,90 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include "processor/ProcessThreadScaler.h"
+
+DECLARE_FLAG_INT32(process_thread_scale_interval);
+DECLARE_FLAG_INT32(process_thread_scale_down_rounds);
+
+namespace logtail {
+
+class ProcessThreadScalerUnittest : public ::testing::Test {
+public:
+    void TestBounds() {
+        ProcessThreadScaler scaler(0, 0, 4);
+        APSARA_TEST_EQUAL(scaler.GetMinCount(), 1);
+        APSARA_TEST_EQUAL(scaler.GetMaxCount(), 1);
+        APSARA_TEST_EQUAL(scaler.GetCount(), 1);
+
+        ProcessThreadScaler scaler2(2, 8, 10);
+        APSARA_TEST_EQUAL(scaler2.GetCount(), 8);
+    }
+
+    void TestScaleUpWhenBusy() {
+        const int32_t interval = INT32_FLAG(process_thread_scale_interval);
+        ProcessThreadScaler scaler(1, 3, 1);
+        int32_t now = 1000;
+        // Full queues.
+        APSARA_TEST_EQUAL(scaler.Update(5, 10, 0, 0.1, now), 2);
+        // Not changed within the interval.
+        APSARA_TEST_EQUAL(scaler.Update(5, 10, 0, 0.1, now + interval - 1), 2);
+        now += interval;
+        // Long latency.
+        APSARA_TEST_EQUAL(scaler.Update(0, 10, 1000, 0.1, now), 3);
+        now += interval;
+        APSARA_TEST_EQUAL(scaler.Update(5, 10, 1000, 0.1, now), 3);
+    }
+
+    void TestNoScaleUpOnHighCpu() {
+        const int32_t interval = INT32_FLAG(process_thread_scale_interval);
+        ProcessThreadScaler scaler(1, 4, 2);
+        int32_t now = 1000;
+        APSARA_TEST_EQUAL(scaler.Update(5, 10, 1000, 0.9, now), 2);
+        now += interval;
+        // CPU over limit removes a thread even if busy.
+        APSARA_TEST_EQUAL(scaler.Update(5, 10, 1000, 1.2, now), 1);
+        now += interval;
+        APSARA_TEST_EQUAL(scaler.Update(5, 10, 1000, 1.2, now), 1);
+    }
+
+    void TestScaleDownWhenIdle() {
+        const int32_t interval = INT32_FLAG(process_thread_scale_interval);
+        const int32_t rounds = INT32_FLAG(process_thread_scale_down_rounds);
+        ProcessThreadScaler scaler(1, 4, 3);
+        int32_t now = 1000;
+        for (int32_t i = 1; i < rounds; ++i, now += interval) {
+            APSARA_TEST_EQUAL(scaler.Update(0, 10, 1, 0.1, now), 3);
+        }
+        APSARA_TEST_EQUAL(scaler.Update(0, 10, 1, 0.1, now), 2);
+        now += interval;
+        // A busy interval resets idle rounds.
+        for (int32_t i = 1; i < rounds; ++i, now += interval) {
+            APSARA_TEST_EQUAL(scaler.Update(0, 10, 1, 0.1, now), 2);
+        }
+        APSARA_TEST_EQUAL(scaler.Update(0, 10, 100, 0.9, now), 2);
+        now += interval;
+        APSARA_TEST_EQUAL(scaler.Update(0, 10, 1, 0.1, now), 2);
+    }
+};
+
+UNIT_TEST_CASE(ProcessThreadScalerUnittest, TestBounds);
+UNIT_TEST_CASE(ProcessThreadScalerUnittest, TestScaleUpWhenBusy);
+UNIT_TEST_CASE(ProcessThreadScalerUnittest, TestNoScaleUpOnHighCpu);
+UNIT_TEST_CASE(ProcessThreadScalerUnittest, TestScaleDownWhenIdle);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,78 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+#include "unittest/Unittest.h"
+#include "processor/RepeatedLineTable.h"
+
+namespace logtail {
+
+class RepeatedLineTableUnittest : public ::testing::Test {
+public:
+    void TestRepeats() {
+        const std::vector<std::string> lines{"error: timeout", "ok", "error: timeout", "error: timeout ", "ok", ""};
+        RepeatedLineTable table(16);
+        std::vector<bool> repeats;
+        std::vector<int32_t> entries;
+        for (const auto& line : lines) {
+            int32_t entry = -1;
+            repeats.push_back(table.IsRepeat(line.data(), line.size(), entry));
+            entries.push_back(entry);
+        }
+        APSARA_TEST_EQUAL(repeats, std::vector<bool>({false, false, true, false, true, false}));
+        APSARA_TEST_EQUAL(entries, std::vector<int32_t>({0, 1, 0, 2, 1, 3}));
+        const auto& items = table.GetEntries();
+        APSARA_TEST_EQUAL(items.size(), 4U);
+        APSARA_TEST_EQUAL(items[0].mRepeats, 1U);
+        APSARA_TEST_EQUAL(items[1].mRepeats, 1U);
+        APSARA_TEST_EQUAL(items[2].mRepeats, 0U);
+        APSARA_TEST_EQUAL(items[0].mLogIndex, -1);
+        table.SetLogIndex(0, 5);
+        APSARA_TEST_EQUAL(table.GetEntries()[0].mLogIndex, 5);
+
+        table.Clear();
+        APSARA_TEST_EQUAL(table.GetEntries().size(), 0U);
+        int32_t entry = -1;
+        APSARA_TEST_FALSE(table.IsRepeat(lines[0].data(), lines[0].size(), entry));
+        APSARA_TEST_EQUAL(entry, 0);
+    }
+
+    void TestFull() {
+        RepeatedLineTable table(2);
+        std::vector<std::string> lines;
+        for (int i = 0; i < 100; ++i) {
+            lines.push_back("line " + std::to_string(i));
+        }
+        int32_t entry = -1;
+        APSARA_TEST_FALSE(table.IsRepeat(lines[0].data(), lines[0].size(), entry));
+        APSARA_TEST_FALSE(table.IsRepeat(lines[1].data(), lines[1].size(), entry));
+        // New lines are kept but not recorded once full, recorded ones are still found.
+        for (size_t i = 2; i < lines.size(); ++i) {
+            APSARA_TEST_FALSE(table.IsRepeat(lines[i].data(), lines[i].size(), entry));
+            APSARA_TEST_EQUAL(entry, -1);
+            APSARA_TEST_FALSE(table.IsRepeat(lines[i].data(), lines[i].size(), entry));
+        }
+        APSARA_TEST_TRUE(table.IsRepeat(lines[1].data(), lines[1].size(), entry));
+        APSARA_TEST_EQUAL(entry, 1);
+        APSARA_TEST_EQUAL(table.GetEntries().size(), 2U);
+    }
+};
+
+UNIT_TEST_CASE(RepeatedLineTableUnittest, TestRepeats);
+UNIT_TEST_CASE(RepeatedLineTableUnittest, TestFull);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,113 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "common/LogstoreSenderQueue.h"
+#include "config/IntegrityConfig.h"
+#include "profiler/IntegrityNotifier.h"
+#include "profiler/LogLineCount.h"
+
+DECLARE_FLAG_BOOL(enable_async_integrity_notify);
+
+namespace logtail {
+
+class IntegrityNotifierUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        LogLineCount* lineCount = LogLineCount::GetInstance();
+        // line count data is not sent by notify thread during tests.
+        lineCount->mLineCountLastSendTime = time(NULL);
+        lineCount->mLineCountSendInterval = 3600;
+        lineCount->ClearLineCountData();
+    }
+
+    void TearDown() override {
+        IntegrityNotifier::GetInstance()->Stop();
+        BOOL_FLAG(enable_async_integrity_notify) = false;
+        LogLineCount::GetInstance()->ClearLineCountData();
+    }
+
+    void TestInternKey() {
+        IntegrityNotifier* notifier = IntegrityNotifier::GetInstance();
+        LoggroupTimeValue data1, data2;
+        data1.mRegion = data2.mRegion = "region";
+        data1.mProjectName = data2.mProjectName = "project";
+        data1.mLogstore = data2.mLogstore = "logstore";
+        data1.mFilename = "/var/log/a.log";
+        data2.mFilename = "/var/log/b.log";
+
+        auto key1 = notifier->InternKey(&data1, "cnt_project", "cnt_logstore");
+        APSARA_TEST_TRUE(key1 == notifier->InternKey(&data1, "cnt_project", "cnt_logstore"));
+        APSARA_TEST_TRUE(key1 != notifier->InternKey(&data1, "", ""));
+        auto key2 = notifier->InternKey(&data2, "cnt_project", "cnt_logstore");
+        APSARA_TEST_TRUE(key1 != key2);
+        APSARA_TEST_EQUAL(key2->mFilename, data2.mFilename);
+        APSARA_TEST_EQUAL(key2->mLineCountLogstore, std::string("cnt_logstore"));
+    }
+
+    void TestNotifyLineCount() {
+        BOOL_FLAG(enable_async_integrity_notify) = true;
+        IntegrityNotifier* notifier = IntegrityNotifier::GetInstance();
+        notifier->Start();
+        APSARA_TEST_TRUE(notifier->IsStarted());
+
+        LoggroupTimeValue data;
+        data.mRegion = "region";
+        data.mProjectName = "project";
+        data.mLogstore = "logstore";
+        data.mFilename = "/var/log/a.log";
+        data.mLogTimeInMinute = 1680000000;
+        data.mLogGroupContext.mLineCountConfigPtr.reset(
+            new LineCountConfig("aliuid", true, "cnt_project", "cnt_logstore"));
+        for (int i = 1; i <= 10; ++i) {
+            data.mLogLines = i;
+            notifier->Notify(&data, true);
+        }
+        // failures are not counted as succeeded lines.
+        notifier->Notify(&data, false);
+        APSARA_TEST_TRUE(notifier->Drain(5000));
+        APSARA_TEST_EQUAL(GetLineCount("region", "project_logstore", data.mLogTimeInMinute), 55);
+
+        // handled in caller thread after stopped.
+        notifier->Stop();
+        APSARA_TEST_FALSE(notifier->IsStarted());
+        notifier->Notify(&data, true);
+        APSARA_TEST_EQUAL(GetLineCount("region", "project_logstore", data.mLogTimeInMinute), 65);
+    }
+
+private:
+    int32_t GetLineCount(const std::string& region, const std::string& key, int32_t minute) {
+        auto regionIter = LogLineCount::mRegionLineCountMap.find(region);
+        if (regionIter == LogLineCount::mRegionLineCountMap.end()) {
+            return -1;
+        }
+        auto iter = regionIter->second->find(key);
+        if (iter == regionIter->second->end()) {
+            return -1;
+        }
+        auto& counts = iter->second->mLogCountPerMinuteMap;
+        return counts.find(minute) == counts.end() ? -1 : counts[minute];
+    }
+};
+
+APSARA_UNIT_TEST_CASE(IntegrityNotifierUnittest, TestInternKey, 0);
+APSARA_UNIT_TEST_CASE(IntegrityNotifierUnittest, TestNotifyLineCount, 1);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
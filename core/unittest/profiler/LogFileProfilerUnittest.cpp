@@ -0,0 +1,64 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <thread>
+#include <vector>
+#include "profiler/LogFileProfiler.h"
+
+namespace logtail {
+
+class LogFileProfilerUnittest : public ::testing::Test {
+public:
+    void SetUp() override { LogFileProfiler::GetInstance()->CleanEnviroments(); }
+
+    void TestThreadCountersMerged() {
+        LogFileProfiler* profiler = LogFileProfiler::GetInstance();
+        std::vector<sls_logs::LogTag> tags;
+        LogFileProfilingEntryPtr entry
+            = profiler->CreateProfilingEntry("config", "region", "project", "logstore", "/var/log/a.log", tags);
+        APSARA_TEST_TRUE(entry->Match("config", "region", "project", "logstore", "/var/log/a.log"));
+        APSARA_TEST_FALSE(entry->Match("config", "region", "project", "logstore", "/var/log/b.log"));
+
+        // counters of exited threads are merged when the threads exit.
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([profiler, entry]() {
+                for (int j = 0; j < 100; ++j) {
+                    profiler->AddProfilingData(entry, 10, 0, 2, 1, 0, 0, 0, 0, "");
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        APSARA_TEST_EQUAL(profiler->GetProfilingLines("project", "logstore", "/var/log/a.log"), 400UL);
+        // logstore statistics are added too.
+        APSARA_TEST_EQUAL(profiler->GetProfilingLines("project", "logstore", ""), 400UL);
+
+        // counters of the current thread are merged when read.
+        profiler->AddProfilingData(entry, 10, 0, 5, 0, 0, 0, 0, 0, "bad line");
+        APSARA_TEST_EQUAL(profiler->GetProfilingLines("project", "logstore", "/var/log/a.log"), 405UL);
+    }
+};
+
+APSARA_UNIT_TEST_CASE(LogFileProfilerUnittest, TestThreadCountersMerged, 0);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
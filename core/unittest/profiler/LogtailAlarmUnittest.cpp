@@ -0,0 +1,115 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "profiler/LogtailAlarm.h"
+
+DECLARE_FLAG_INT32(logtail_alarm_interval);
+DECLARE_FLAG_INT32(logtail_alarm_counter_idle_timeout);
+
+namespace logtail {
+
+class LogtailAlarmUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mAlarmInterval = INT32_FLAG(logtail_alarm_interval);
+        // keep alarms in map, they are not sent by SendAlarmLoop during the test.
+        INT32_FLAG(logtail_alarm_interval) = 1000000;
+    }
+
+    void TearDown() override {
+        INT32_FLAG(logtail_alarm_interval) = mAlarmInterval;
+        LogtailAlarm* alarm = LogtailAlarm::GetInstance();
+        std::lock_guard<std::mutex> lock(alarm->mAlarmBufferMutex);
+        alarm->mAllAlarmMap.erase("test_region");
+    }
+
+    static int32_t GetAlarmCount(LogtailAlarmType type, std::string& message) {
+        LogtailAlarm* alarm = LogtailAlarm::GetInstance();
+        alarm->FlushAlarmCounters();
+        std::lock_guard<std::mutex> lock(alarm->mAlarmBufferMutex);
+        auto& alarmMap = (*alarm->MakesureLogtailAlarmMapVecUnlocked("test_region"))[type];
+        auto iter = alarmMap.find("project_logstore");
+        if (iter == alarmMap.end()) {
+            return 0;
+        }
+        message = iter->second->mMessage;
+        return iter->second->mCount;
+    }
+
+    void TestCountAlarm() {
+        LogtailAlarm* alarm = LogtailAlarm::GetInstance();
+        std::atomic_int buildCount{0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([alarm, &buildCount]() {
+                for (int j = 0; j < 100; ++j) {
+                    alarm->CountAlarm(REGEX_MATCH_ALARM, "project", "logstore", "test_region", [&buildCount]() {
+                        ++buildCount;
+                        return std::string("regex match fail");
+                    });
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        std::string message;
+        APSARA_TEST_EQUAL(GetAlarmCount(REGEX_MATCH_ALARM, message), 400);
+        APSARA_TEST_EQUAL(message, "regex match fail");
+        // the message is only built once per flush window.
+        APSARA_TEST_TRUE(buildCount.load() >= 1);
+        APSARA_TEST_TRUE(buildCount.load() < 10);
+
+        // alarms sent directly are aggregated with the counted ones.
+        alarm->SendAlarm(REGEX_MATCH_ALARM, "other message", "project", "logstore", "test_region");
+        APSARA_TEST_EQUAL(GetAlarmCount(REGEX_MATCH_ALARM, message), 401);
+    }
+
+    void TestIdleCounterRemoved() {
+        LogtailAlarm* alarm = LogtailAlarm::GetInstance();
+        alarm->CountAlarm(PARSE_TIME_FAIL_ALARM, "project", "logstore", "test_region", []() { return "parse fail"; });
+        std::string message;
+        APSARA_TEST_EQUAL(GetAlarmCount(PARSE_TIME_FAIL_ALARM, message), 1);
+
+        const int32_t idleTimeout = INT32_FLAG(logtail_alarm_counter_idle_timeout);
+        INT32_FLAG(logtail_alarm_counter_idle_timeout) = -1;
+        const uint32_t generation = alarm->mAlarmCounterGeneration.load();
+        alarm->FlushAlarmCounters();
+        INT32_FLAG(logtail_alarm_counter_idle_timeout) = idleTimeout;
+        APSARA_TEST_TRUE(alarm->mAlarmCounterGeneration.load() != generation);
+
+        // the cached counter is dropped, a new counter is registered.
+        alarm->CountAlarm(PARSE_TIME_FAIL_ALARM, "project", "logstore", "test_region", []() { return "parse fail"; });
+        APSARA_TEST_EQUAL(GetAlarmCount(PARSE_TIME_FAIL_ALARM, message), 2);
+    }
+
+private:
+    int32_t mAlarmInterval = 0;
+};
+
+APSARA_UNIT_TEST_CASE(LogtailAlarmUnittest, TestCountAlarm, 0);
+APSARA_UNIT_TEST_CASE(LogtailAlarmUnittest, TestIdleCounterRemoved, 0);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,128 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include <map>
+#include "common/LogstoreSenderQueue.h"
+#include "profiler/PipelineLatencyProfiler.h"
+
+DECLARE_FLAG_INT32(pipeline_slow_trace_threshold_ms);
+DECLARE_FLAG_INT32(pipeline_slow_trace_max_count);
+
+namespace logtail {
+
+class PipelineLatencyProfilerUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        std::map<std::string, sls_logs::LogGroup> logGroups;
+        PipelineLatencyProfiler::GetInstance()->Flush(logGroups);
+    }
+
+    static LoggroupTimeValue* NewData(const std::string& configName) {
+        LoggroupTimeValue* data = new LoggroupTimeValue("project",
+                                                        "logstore",
+                                                        configName,
+                                                        "/var/log/a.log",
+                                                        true,
+                                                        "",
+                                                        "region",
+                                                        LOGGROUP_COMPRESSED,
+                                                        10,
+                                                        100,
+                                                        0,
+                                                        "",
+                                                        0);
+        PipelineTimestamps& timestamps = data->mLogGroupContext.mTimestamps;
+        timestamps.mReadTimeInMs = 1000;
+        timestamps.mAggregateTimeInMs = 1002;
+        timestamps.mEnqueueTimeInMs = 1100;
+        timestamps.mSendTimeInMs = 1150;
+        return data;
+    }
+
+    static std::string GetContent(const sls_logs::Log& log, const std::string& key) {
+        for (int i = 0; i < log.contents_size(); ++i) {
+            if (log.contents(i).key() == key) {
+                return log.contents(i).value();
+            }
+        }
+        return "";
+    }
+
+    void TestStageLatencies() {
+        std::unique_ptr<LoggroupTimeValue> data(NewData("config"));
+        int64_t latencies[PipelineLatencyProfiler::STAGE_COUNT];
+        PipelineLatencyProfiler::GetStageLatencies(data->mLogGroupContext.mTimestamps, 1200, latencies);
+        APSARA_TEST_EQUAL(latencies[PipelineLatencyProfiler::STAGE_PROCESS], 2);
+        APSARA_TEST_EQUAL(latencies[PipelineLatencyProfiler::STAGE_AGGREGATE], 98);
+        APSARA_TEST_EQUAL(latencies[PipelineLatencyProfiler::STAGE_QUEUE], 50);
+        APSARA_TEST_EQUAL(latencies[PipelineLatencyProfiler::STAGE_SEND], 50);
+        APSARA_TEST_EQUAL(latencies[PipelineLatencyProfiler::STAGE_END_TO_END], 200);
+
+        // data not read from file starts from aggregator.
+        data->mLogGroupContext.mTimestamps.mReadTimeInMs = 0;
+        PipelineLatencyProfiler::GetStageLatencies(data->mLogGroupContext.mTimestamps, 1200, latencies);
+        APSARA_TEST_EQUAL(latencies[PipelineLatencyProfiler::STAGE_PROCESS], -1);
+        APSARA_TEST_EQUAL(latencies[PipelineLatencyProfiler::STAGE_END_TO_END], 198);
+    }
+
+    void TestFlush() {
+        const int32_t threshold = INT32_FLAG(pipeline_slow_trace_threshold_ms);
+        const int32_t maxCount = INT32_FLAG(pipeline_slow_trace_max_count);
+        INT32_FLAG(pipeline_slow_trace_threshold_ms) = 1000;
+        INT32_FLAG(pipeline_slow_trace_max_count) = 1;
+
+        PipelineLatencyProfiler* profiler = PipelineLatencyProfiler::GetInstance();
+        std::unique_ptr<LoggroupTimeValue> data(NewData("config"));
+        profiler->Record(data.get(), 1200);
+        profiler->Record(data.get(), 3000);
+        profiler->Record(data.get(), 4000);
+        // data without config is not recorded.
+        std::unique_ptr<LoggroupTimeValue> profileData(NewData(""));
+        profiler->Record(profileData.get(), 1200);
+
+        std::map<std::string, sls_logs::LogGroup> logGroups;
+        profiler->Flush(logGroups);
+        APSARA_TEST_EQUAL(logGroups.size(), 1UL);
+        const sls_logs::LogGroup& logGroup = logGroups["region"];
+        // one latency log and one slow trace limited by max count.
+        APSARA_TEST_EQUAL_FATAL(logGroup.logs_size(), 2);
+        APSARA_TEST_EQUAL(GetContent(logGroup.logs(0), "file_name"), "pipeline_latency");
+        APSARA_TEST_EQUAL(GetContent(logGroup.logs(0), "config_name"), "config");
+        APSARA_TEST_EQUAL(GetContent(logGroup.logs(0), "end_to_end_latency_ms").find("count:3"), 0UL);
+        APSARA_TEST_EQUAL(GetContent(logGroup.logs(1), "file_name"), "pipeline_slow_trace");
+        APSARA_TEST_EQUAL(GetContent(logGroup.logs(1), "end_to_end_latency_ms"), "2000");
+        APSARA_TEST_EQUAL(GetContent(logGroup.logs(1), "send_latency_ms"), "1850");
+
+        // statistics are reset after flush.
+        logGroups.clear();
+        profiler->Flush(logGroups);
+        APSARA_TEST_TRUE(logGroups.empty());
+
+        INT32_FLAG(pipeline_slow_trace_threshold_ms) = threshold;
+        INT32_FLAG(pipeline_slow_trace_max_count) = maxCount;
+    }
+};
+
+APSARA_UNIT_TEST_CASE(PipelineLatencyProfilerUnittest, TestStageLatencies, 0);
+APSARA_UNIT_TEST_CASE(PipelineLatencyProfilerUnittest, TestFlush, 0);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
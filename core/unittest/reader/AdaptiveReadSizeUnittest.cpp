@@ -0,0 +1,114 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "LogBufferPool.h"
+#include "LogFileReader.h"
+
+DECLARE_FLAG_BOOL(adaptive_read_size_enable);
+DECLARE_FLAG_INT32(adaptive_read_max_size);
+DECLARE_FLAG_INT64(read_buffer_budget_bytes);
+DECLARE_FLAG_INT32(read_ahead_max_bytes);
+
+namespace logtail {
+
+class AdaptiveReadSizeUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mReader.reset(new CommonRegLogFileReader(
+            "testProject", "testLogstore", ".", "AdaptiveReadSizeUnittest.txt", 0, "%Y-%m-%d %H:%M:%S", ""));
+        BOOL_FLAG(adaptive_read_size_enable) = true;
+        INT32_FLAG(adaptive_read_max_size) = 8 * 1024 * 1024;
+        INT64_FLAG(read_buffer_budget_bytes) = 256 * 1024 * 1024;
+    }
+
+    void TearDown() override { BOOL_FLAG(adaptive_read_size_enable) = false; }
+
+    void TestDisabled() {
+        BOOL_FLAG(adaptive_read_size_enable) = false;
+        APSARA_TEST_EQUAL(mReader->getReadSizeLimit(100 * 1024 * 1024), LogFileReader::BUFFER_SIZE);
+    }
+
+    void TestGrowAndShrink() {
+        const size_t base = LogFileReader::BUFFER_SIZE;
+        const int64_t backlog = 100 * 1024 * 1024;
+        size_t limit = base;
+        for (int i = 0; i < 10; ++i) {
+            const size_t next = mReader->getReadSizeLimit(backlog);
+            APSARA_TEST_TRUE(next >= limit);
+            limit = next;
+        }
+        APSARA_TEST_EQUAL(limit, 8UL * 1024 * 1024);
+        // Trickle file goes back to the default size.
+        for (int i = 0; i < 10; ++i) {
+            limit = mReader->getReadSizeLimit(1024);
+        }
+        APSARA_TEST_EQUAL(limit, base);
+        // Backlog between a quarter and the limit keeps it.
+        mReader->getReadSizeLimit(backlog);
+        const size_t kept = mReader->getReadSizeLimit(base);
+        APSARA_TEST_EQUAL(mReader->getReadSizeLimit(base), kept);
+    }
+
+    void TestBudget() {
+        // No room for larger reads, the default size is used while the wanted size still adapts.
+        INT64_FLAG(read_buffer_budget_bytes) = 0;
+        for (int i = 0; i < 10; ++i) {
+            APSARA_TEST_EQUAL(mReader->getReadSizeLimit(100 * 1024 * 1024), LogFileReader::BUFFER_SIZE);
+        }
+        INT64_FLAG(read_buffer_budget_bytes) = 256 * 1024 * 1024;
+        APSARA_TEST_EQUAL(mReader->getReadSizeLimit(100 * 1024 * 1024), 8UL * 1024 * 1024);
+    }
+
+    void TestReadAhead() {
+        const size_t base = LogFileReader::BUFFER_SIZE;
+        const int64_t fileEnd = 100 * 1024 * 1024;
+        int64_t offset = 0, length = 0;
+        INT32_FLAG(read_ahead_max_bytes) = 0;
+        APSARA_TEST_FALSE(mReader->getReadAheadRange(base, fileEnd, base, offset, length));
+
+        INT32_FLAG(read_ahead_max_bytes) = 4 * 1024 * 1024;
+        APSARA_TEST_TRUE(mReader->getReadAheadRange(base, fileEnd, base, offset, length));
+        APSARA_TEST_EQUAL(offset, static_cast<int64_t>(base));
+        APSARA_TEST_EQUAL(length, 4 * 1024 * 1024);
+        // More than half of the window is still ahead.
+        APSARA_TEST_FALSE(mReader->getReadAheadRange(2 * base, fileEnd, base, offset, length));
+        // Only the part not advised yet is returned.
+        const int64_t readEnd = base + 3 * 1024 * 1024;
+        APSARA_TEST_TRUE(mReader->getReadAheadRange(readEnd, fileEnd, base, offset, length));
+        APSARA_TEST_EQUAL(offset, static_cast<int64_t>(base + 4 * 1024 * 1024));
+        APSARA_TEST_EQUAL(offset + length, readEnd + 4 * 1024 * 1024);
+        // Bounded by file size, and restarted after truncate.
+        APSARA_TEST_TRUE(mReader->getReadAheadRange(base, 2 * base, base, offset, length));
+        APSARA_TEST_EQUAL(offset, static_cast<int64_t>(base));
+        APSARA_TEST_EQUAL(length, static_cast<int64_t>(base));
+        INT32_FLAG(read_ahead_max_bytes) = 0;
+    }
+
+private:
+    LogFileReaderPtr mReader;
+};
+
+UNIT_TEST_CASE(AdaptiveReadSizeUnittest, TestDisabled);
+UNIT_TEST_CASE(AdaptiveReadSizeUnittest, TestGrowAndShrink);
+UNIT_TEST_CASE(AdaptiveReadSizeUnittest, TestBudget);
+UNIT_TEST_CASE(AdaptiveReadSizeUnittest, TestReadAhead);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
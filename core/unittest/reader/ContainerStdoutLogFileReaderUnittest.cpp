@@ -0,0 +1,135 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <string>
+#include <vector>
+#include "common/Constants.h"
+#include "log_pb/sls_logs.pb.h"
+#include "reader/ContainerStdoutLogFileReader.h"
+
+namespace logtail {
+
+class ContainerStdoutLogFileReaderUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mReader.reset(new ContainerStdoutLogFileReader(
+            "testProject", "testLogstore", ".", "ContainerStdoutLogFileReaderUnittest.log", 0, "", "", false));
+    }
+
+    void TestUnwrapDocker() {
+        const std::string raw
+            = "{\"log\":\"hello \\\"world\\\"\\n\",\"stream\":\"stdout\",\"time\":\"2023-01-02T03:04:05Z\"}\n"
+              "{\"time\":\"t\",\"stream\":\"stderr\",\"log\":\"part1 \"}\n"
+              "{\"log\":\"part2 \\u4e2d\\n\",\"stream\":\"stderr\",\"time\":\"t\",\"attrs\":{\"a\":1}}\n"
+              "not a record\n"
+              "{\"log\":\"tail\",\"stream\":\"stdout\",\"time\":\"t\"}\n";
+        std::string output;
+        ContainerStdoutLogFileReader::UnwrapResult result = Unwrap(raw, false, output);
+        APSARA_TEST_EQUAL(output, "2023-01-02T03:04:05Z stdout hello \"world\"\nt stderr part1 part2 \xe4\xb8\xad\n");
+        APSARA_TEST_EQUAL(result.mInvalidLines, 1UL);
+        // The trailing partial record is left to the next read.
+        APSARA_TEST_EQUAL(result.mRawSize, raw.rfind("{\"log\":\"tail\""));
+        APSARA_TEST_EQUAL_FATAL(result.mLineEnds.size(), 2UL);
+        APSARA_TEST_EQUAL(static_cast<size_t>(result.mLineEnds[1].first), output.size());
+
+        result = Unwrap(raw, true, output);
+        APSARA_TEST_EQUAL(result.mRawSize, raw.size());
+        APSARA_TEST_EQUAL(output.substr(output.rfind("t stdout")), "t stdout tail\n");
+    }
+
+    void TestUnwrapCRI() {
+        const std::string raw = "2023-01-02T03:04:05.1Z stdout F full line\r\n"
+                                "2023-01-02T03:04:06Z stderr P first \n"
+                                "2023-01-02T03:04:06Z stderr F second\n"
+                                "2023-01-02T03:04:07Z stdout F\n"
+                                "2023-01-02T03:04:08Z stdout X bad\n"
+                                "2023-01-02T03:04:09Z stdout P pending\n";
+        std::string output;
+        ContainerStdoutLogFileReader::UnwrapResult result = Unwrap(raw, false, output);
+        APSARA_TEST_EQUAL(output,
+                          "2023-01-02T03:04:05.1Z stdout full line\n"
+                          "2023-01-02T03:04:06Z stderr first second\n"
+                          "2023-01-02T03:04:07Z stdout \n");
+        APSARA_TEST_EQUAL(result.mInvalidLines, 1UL);
+        APSARA_TEST_EQUAL(result.mRawSize, raw.rfind("2023-01-02T03:04:09Z"));
+        APSARA_TEST_EQUAL(result.mLineEnds.size(), 3UL);
+    }
+
+    void TestParseRFC3339Time() {
+        time_t seconds = 0;
+        uint32_t nanoseconds = 0;
+        std::string value = "2023-01-02T03:04:05Z";
+        APSARA_TEST_TRUE(ParseTime(value, seconds, nanoseconds));
+        APSARA_TEST_EQUAL(seconds, 1672628645);
+        APSARA_TEST_EQUAL(nanoseconds, 0U);
+        value = "2023-01-02T11:04:05.123456789+08:00";
+        APSARA_TEST_TRUE(ParseTime(value, seconds, nanoseconds));
+        APSARA_TEST_EQUAL(seconds, 1672628645);
+        APSARA_TEST_EQUAL(nanoseconds, 123456789U);
+        APSARA_TEST_FALSE(ParseTime("2023-01-02", seconds, nanoseconds));
+        APSARA_TEST_FALSE(ParseTime("2023-13-02T03:04:05Z", seconds, nanoseconds));
+        APSARA_TEST_FALSE(ParseTime("2023-01-02T03:04:05Zx", seconds, nanoseconds));
+    }
+
+    void TestParseLogLine() {
+        sls_logs::LogGroup logGroup;
+        ParseLogError error = PARSE_LOG_REGEX_ERROR;
+        time_t lastLogLineTime = 0;
+        std::string lastLogTimeStr;
+        uint32_t logGroupSize = 0;
+        const std::string line = "2023-01-02T03:04:05Z stderr panic: boom\n2023-01-02T03:04:05Z stderr \tat main";
+        APSARA_TEST_TRUE_FATAL(
+            mReader->ParseLogLine(line.c_str(), logGroup, error, lastLogLineTime, lastLogTimeStr, logGroupSize));
+        APSARA_TEST_EQUAL_FATAL(logGroup.logs_size(), 1);
+        const sls_logs::Log& log = logGroup.logs(0);
+        APSARA_TEST_EQUAL(log.time(), 1672628645U);
+        APSARA_TEST_EQUAL_FATAL(log.contents_size(), 3);
+        APSARA_TEST_EQUAL(log.contents(0).key(), DEFAULT_CONTENT_KEY);
+        APSARA_TEST_EQUAL(log.contents(0).value(), "panic: boom\n\tat main");
+        APSARA_TEST_EQUAL(log.contents(1).key(), ContainerStdoutLogFileReader::TIME_KEY);
+        APSARA_TEST_EQUAL(log.contents(1).value(), "2023-01-02T03:04:05Z");
+        APSARA_TEST_EQUAL(log.contents(2).key(), ContainerStdoutLogFileReader::SOURCE_KEY);
+        APSARA_TEST_EQUAL(log.contents(2).value(), "stderr");
+
+        APSARA_TEST_FALSE(
+            mReader->ParseLogLine("nofields", logGroup, error, lastLogLineTime, lastLogTimeStr, logGroupSize));
+        APSARA_TEST_EQUAL(error, PARSE_LOG_FORMAT_ERROR);
+    }
+
+private:
+    ContainerStdoutLogFileReader::UnwrapResult Unwrap(const std::string& raw, bool flushPartial, std::string& output) {
+        std::vector<char> buffer(raw.size());
+        ContainerStdoutLogFileReader::UnwrapResult result;
+        ContainerStdoutLogFileReader::UnwrapRecords(raw.data(), raw.size(), buffer.data(), flushPartial, result);
+        output.assign(buffer.data(), result.mOutputSize);
+        return result;
+    }
+
+    bool ParseTime(const std::string& value, time_t& seconds, uint32_t& nanoseconds) {
+        return ContainerStdoutLogFileReader::ParseRFC3339Time(
+            value.data(), value.data() + value.size(), seconds, nanoseconds);
+    }
+
+    std::unique_ptr<ContainerStdoutLogFileReader> mReader;
+};
+
+UNIT_TEST_CASE(ContainerStdoutLogFileReaderUnittest, TestUnwrapDocker);
+UNIT_TEST_CASE(ContainerStdoutLogFileReaderUnittest, TestUnwrapCRI);
+UNIT_TEST_CASE(ContainerStdoutLogFileReaderUnittest, TestParseRFC3339Time);
+UNIT_TEST_CASE(ContainerStdoutLogFileReaderUnittest, TestParseLogLine);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
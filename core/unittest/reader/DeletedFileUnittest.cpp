@@ -33,6 +33,7 @@ public:
     void TearDown() override { INT32_FLAG(force_release_deleted_file_fd_timeout) = -1; }
     void TestShouldForceReleaseDeletedFileFdDeleted();
     void TestShouldForceReleaseDeletedFileFdStopped();
+    void TestGetBytesAtRisk();
     LogFileReaderPtr reader;
     std::string logPathDir;
     std::string logPathFile;
@@ -52,8 +53,32 @@ void DeletedFileUnittest::TestShouldForceReleaseDeletedFileFdStopped() {
     APSARA_TEST_TRUE(reader->ShouldForceReleaseDeletedFileFd());
 }
 
+void DeletedFileUnittest::TestGetBytesAtRisk() {
+    reader->mLastFileSize = 1000;
+    reader->SetLastFilePos(400);
+    APSARA_TEST_EQUAL(reader->GetBytesAtRisk(), 0U);
+
+    // Rotated, a newer file of the same path is queued after it.
+    LogFileReaderPtrArray readerArray;
+    LogFileReaderPtr newReader(new CommonRegLogFileReader(
+        "testProject", "testLogstore", logPathDir, logPathFile, 0, "%Y-%m-%d %H:%M:%S", ""));
+    readerArray.push_back(reader);
+    reader->SetReaderArray(&readerArray);
+    APSARA_TEST_FALSE(reader->IsRotated());
+    readerArray.push_back(newReader);
+    APSARA_TEST_TRUE(reader->IsRotated());
+    APSARA_TEST_EQUAL(reader->GetBytesAtRisk(), 600U);
+    reader->SetReaderArray(NULL);
+
+    reader->SetFileDeleted(true);
+    APSARA_TEST_EQUAL(reader->GetBytesAtRisk(), 600U);
+    reader->SetLastFilePos(1000);
+    APSARA_TEST_EQUAL(reader->GetBytesAtRisk(), 0U);
+}
+
 UNIT_TEST_CASE(DeletedFileUnittest, TestShouldForceReleaseDeletedFileFdDeleted);
 UNIT_TEST_CASE(DeletedFileUnittest, TestShouldForceReleaseDeletedFileFdStopped);
+UNIT_TEST_CASE(DeletedFileUnittest, TestGetBytesAtRisk);
 
 
 } // namespace logtail
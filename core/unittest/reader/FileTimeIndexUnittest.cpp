@@ -0,0 +1,160 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <string.h>
+#include <time.h>
+#include <string>
+#include "reader/FileTimeIndex.h"
+
+DECLARE_FLAG_INT32(file_time_index_cache_size);
+
+namespace logtail {
+
+class FileTimeIndexUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mContent.clear();
+        mReadCount = 0;
+        FileTimeIndexCache::GetInstance()->Clear();
+    }
+
+    void TestSeek();
+    void TestSeekSkipsLinesWithoutTime();
+    void TestSeekReusesSamples();
+    void TestSeekUnparsedFile();
+    void TestCacheRebuildAndEvict();
+
+private:
+    static const int32_t kBaseTime = 1600000000;
+    static const char* const kTimeFormat;
+
+    // AppendLogs appends one log per second from @beginTime, each with @extraLines lines without time, and
+    // returns the offset of the log at @seekTime.
+    int64_t AppendLogs(int32_t beginTime, int32_t count, int32_t seekTime, int32_t extraLines = 0) {
+        int64_t seekPos = -1;
+        for (int32_t i = 0; i < count; ++i) {
+            const time_t t = beginTime + i;
+            if (t == seekTime) {
+                seekPos = static_cast<int64_t>(mContent.size());
+            }
+            struct tm tm;
+            localtime_r(&t, &tm);
+            char buf[64];
+            strftime(buf, sizeof(buf), kTimeFormat, &tm);
+            mContent.append(buf).append(" INFO some message of log ").append(std::to_string(i)).append("\n");
+            for (int32_t k = 0; k < extraLines; ++k) {
+                mContent.append("    at continuation line ").append(std::to_string(k)).append("\n");
+            }
+        }
+        return seekPos;
+    }
+
+    FileTimeIndex::ReadFunc Reader() {
+        return [this](char* buf, size_t size, int64_t offset) {
+            ++mReadCount;
+            if (offset >= static_cast<int64_t>(mContent.size())) {
+                return static_cast<size_t>(0);
+            }
+            const size_t nbytes = std::min(size, mContent.size() - static_cast<size_t>(offset));
+            memcpy(buf, mContent.data() + offset, nbytes);
+            return nbytes;
+        };
+    }
+
+    int64_t Size() const { return static_cast<int64_t>(mContent.size()); }
+
+    std::string mContent;
+    int32_t mReadCount = 0;
+};
+
+const int32_t FileTimeIndexUnittest::kBaseTime;
+const char* const FileTimeIndexUnittest::kTimeFormat = "%Y-%m-%d %H:%M:%S";
+
+UNIT_TEST_CASE(FileTimeIndexUnittest, TestSeek);
+UNIT_TEST_CASE(FileTimeIndexUnittest, TestSeekSkipsLinesWithoutTime);
+UNIT_TEST_CASE(FileTimeIndexUnittest, TestSeekReusesSamples);
+UNIT_TEST_CASE(FileTimeIndexUnittest, TestSeekUnparsedFile);
+UNIT_TEST_CASE(FileTimeIndexUnittest, TestCacheRebuildAndEvict);
+
+void FileTimeIndexUnittest::TestSeek() {
+    const int64_t expected = AppendLogs(kBaseTime, 200000, kBaseTime + 123456);
+    FileTimeIndex index(kTimeFormat);
+    APSARA_TEST_EQUAL(index.Seek(Reader(), Size(), kBaseTime + 123456), expected);
+    // O(log n) reads for about 10MB.
+    APSARA_TEST_TRUE(mReadCount <= 20);
+
+    APSARA_TEST_EQUAL(index.Seek(Reader(), Size(), kBaseTime - 10), 0);
+    APSARA_TEST_EQUAL(index.Seek(Reader(), Size(), kBaseTime + 200000), Size());
+    // Only the first @fileSize bytes are searched.
+    APSARA_TEST_EQUAL(index.Seek(Reader(), expected, kBaseTime + 200000), expected);
+}
+
+void FileTimeIndexUnittest::TestSeekSkipsLinesWithoutTime() {
+    const int64_t expected = AppendLogs(kBaseTime, 20000, kBaseTime + 7777, 5);
+    FileTimeIndex index(kTimeFormat);
+    APSARA_TEST_EQUAL(index.Seek(Reader(), Size(), kBaseTime + 7777), expected);
+}
+
+void FileTimeIndexUnittest::TestSeekReusesSamples() {
+    AppendLogs(kBaseTime, 200000, -1);
+    FileTimeIndex index(kTimeFormat);
+    index.Seek(Reader(), Size(), kBaseTime + 100000);
+    const size_t sampleCount = index.GetSampleCount();
+    APSARA_TEST_TRUE(sampleCount > 0);
+    const int32_t firstReadCount = mReadCount;
+
+    // A nearby time is in the range narrowed by samples.
+    mReadCount = 0;
+    index.Seek(Reader(), Size(), kBaseTime + 100001);
+    APSARA_TEST_TRUE(mReadCount < firstReadCount);
+    APSARA_TEST_TRUE(mReadCount <= 2);
+}
+
+void FileTimeIndexUnittest::TestSeekUnparsedFile() {
+    for (int i = 0; i < 10000; ++i) {
+        mContent.append("no time in this line\n");
+    }
+    FileTimeIndex index(kTimeFormat);
+    APSARA_TEST_EQUAL(index.Seek(Reader(), Size(), kBaseTime), -1);
+    APSARA_TEST_EQUAL(index.Seek(Reader(), 0, kBaseTime), -1);
+}
+
+void FileTimeIndexUnittest::TestCacheRebuildAndEvict() {
+    FileTimeIndexCache* cache = FileTimeIndexCache::GetInstance();
+    const int64_t expected = AppendLogs(kBaseTime, 100000, kBaseTime + 5000);
+    const DevInode devInode(1, 1);
+    APSARA_TEST_EQUAL(cache->Seek(devInode, kTimeFormat, Reader(), Size(), kBaseTime + 5000), expected);
+    APSARA_TEST_TRUE(cache->mIndexes.find(devInode)->second.mIndex->GetSampleCount() > 0);
+
+    // The file is rewritten, samples of the old one are not used.
+    mContent.clear();
+    const int64_t expectedAfterRewrite = AppendLogs(kBaseTime + 1, 50000, kBaseTime + 5000);
+    APSARA_TEST_EQUAL(cache->Seek(devInode, kTimeFormat, Reader(), Size(), kBaseTime + 5000), expectedAfterRewrite);
+
+    const int32_t oldSize = INT32_FLAG(file_time_index_cache_size);
+    INT32_FLAG(file_time_index_cache_size) = 2;
+    cache->Seek(DevInode(1, 2), kTimeFormat, Reader(), Size(), kBaseTime);
+    cache->Seek(devInode, kTimeFormat, Reader(), Size(), kBaseTime);
+    cache->Seek(DevInode(1, 3), kTimeFormat, Reader(), Size(), kBaseTime);
+    // The least recently used one is evicted.
+    APSARA_TEST_EQUAL(cache->Size(), 2UL);
+    APSARA_TEST_TRUE(cache->mIndexes.find(DevInode(1, 2)) == cache->mIndexes.end());
+    APSARA_TEST_TRUE(cache->mIndexes.find(devInode) != cache->mIndexes.end());
+    INT32_FLAG(file_time_index_cache_size) = oldSize;
+}
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,107 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstdio>
+#include <fstream>
+#include "GloablFileDescriptorManager.h"
+#include "LogFileReader.h"
+#include "common/DevInode.h"
+
+DECLARE_FLAG_INT32(reader_fd_budget);
+
+namespace logtail {
+
+class GloablFileDescriptorManagerUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        INT32_FLAG(reader_fd_budget) = 100;
+        uint64_t ignore = 0;
+        GloablFileDescriptorManager::GetInstance()->GetEvictStatus(ignore, ignore);
+        for (int i = 0; i < 3; ++i) {
+            const std::string fileName = "GloablFileDescriptorManagerUnittest" + std::to_string(i) + ".txt";
+            std::ofstream(fileName) << "";
+            LogFileReaderPtr reader(
+                new CommonRegLogFileReader("testProject", "testLogstore", ".", fileName, 0, "%Y-%m-%d %H:%M:%S", ""));
+            reader->SetDevInode(GetFileDevInode(fileName));
+            mReaders.push_back(reader);
+            mFileNames.push_back(fileName);
+        }
+    }
+
+    void TearDown() override {
+        mReaders.clear();
+        for (auto& fileName : mFileNames) {
+            remove(fileName.c_str());
+        }
+        INT32_FLAG(reader_fd_budget) = 0;
+    }
+
+    void TestEvictLeastRecentlyRead() {
+        auto manager = GloablFileDescriptorManager::GetInstance();
+        const int32_t baseOpened = manager->GetOpenedFilePtrSize();
+        for (auto& reader : mReaders) {
+            APSARA_TEST_TRUE(reader->UpdateFilePtr());
+        }
+        APSARA_TEST_EQUAL(manager->GetOpenedFilePtrSize(), baseOpened + 3);
+        // Read order: 1, 0, 2, so reader 1 is the least recently read.
+        manager->OnFileRead(mReaders[1].get());
+        manager->OnFileRead(mReaders[0].get());
+        manager->OnFileRead(mReaders[2].get());
+
+        APSARA_TEST_EQUAL(manager->EvictIdleFiles(baseOpened + 3), 0UL);
+        APSARA_TEST_EQUAL(manager->EvictIdleFiles(baseOpened + 2), 1UL);
+        APSARA_TEST_FALSE(mReaders[1]->IsFileOpened());
+        APSARA_TEST_TRUE(mReaders[1]->IsFdEvicted());
+        APSARA_TEST_TRUE(mReaders[0]->IsFileOpened());
+        APSARA_TEST_TRUE(mReaders[2]->IsFileOpened());
+
+        // Reopen is accounted.
+        APSARA_TEST_TRUE(mReaders[1]->UpdateFilePtr());
+        APSARA_TEST_FALSE(mReaders[1]->IsFdEvicted());
+        uint64_t evictCount = 0;
+        uint64_t reopenCount = 0;
+        manager->GetEvictStatus(evictCount, reopenCount);
+        APSARA_TEST_EQUAL(evictCount, 1UL);
+        APSARA_TEST_EQUAL(reopenCount, 1UL);
+
+        // Reader 0 becomes the least recently read one.
+        APSARA_TEST_EQUAL(manager->EvictIdleFiles(baseOpened + 2), 1UL);
+        APSARA_TEST_FALSE(mReaders[0]->IsFileOpened());
+    }
+
+    void TestDisabled() {
+        INT32_FLAG(reader_fd_budget) = 0;
+        auto manager = GloablFileDescriptorManager::GetInstance();
+        const int32_t baseOpened = manager->GetOpenedFilePtrSize();
+        APSARA_TEST_TRUE(mReaders[0]->UpdateFilePtr());
+        APSARA_TEST_EQUAL(manager->GetOpenedFilePtrSize(), baseOpened + 1);
+        APSARA_TEST_EQUAL(manager->EvictIdleFiles(0), 0UL);
+        APSARA_TEST_TRUE(mReaders[0]->IsFileOpened());
+    }
+
+    std::vector<LogFileReaderPtr> mReaders;
+    std::vector<std::string> mFileNames;
+};
+
+UNIT_TEST_CASE(GloablFileDescriptorManagerUnittest, TestEvictLeastRecentlyRead);
+UNIT_TEST_CASE(GloablFileDescriptorManagerUnittest, TestDisabled);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
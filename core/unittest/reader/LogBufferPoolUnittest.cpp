@@ -0,0 +1,160 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstring>
+#include "reader/LogBufferPool.h"
+#include "common/Flags.h"
+#include "common/MemoryBudget.h"
+
+DECLARE_FLAG_INT32(read_buffer_pool_max_idle_bytes);
+DECLARE_FLAG_BOOL(read_buffer_pool_huge_page);
+DECLARE_FLAG_INT32(log_buffer_memory_budget_mb);
+
+namespace logtail {
+
+class LogBufferPoolUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        LogBufferPool::GetInstance()->Clear();
+        uint64_t hit, miss, resident;
+        LogBufferPool::GetInstance()->GetStatus(hit, miss, resident);
+    }
+
+    void TestSizeClass() {
+        APSARA_TEST_EQUAL(LogBufferPool::GetSizeClass(1), 0);
+        APSARA_TEST_EQUAL(LogBufferPool::GetSizeClass(LogBufferPool::kMinSlabSize + 1), 0);
+        APSARA_TEST_EQUAL(LogBufferPool::GetSizeClass(LogBufferPool::kMinSlabSize + LogBufferPool::kSlabPadding + 1),
+                          1);
+        // Default read size 512KB + '\0' stays in the 512KB class.
+        APSARA_TEST_EQUAL(LogBufferPool::GetSizeClass(512 * 1024 + 1), 7);
+        APSARA_TEST_EQUAL(LogBufferPool::GetSizeClass(64 * 1024 * 1024), -1);
+    }
+
+    void TestReuse() {
+        auto pool = LogBufferPool::GetInstance();
+        char* first = NULL;
+        {
+            LogBufferSlabPtr slab = pool->Acquire(512 * 1024 + 1);
+            first = slab.get();
+            memset(first, 'a', 512 * 1024 + 1);
+            LogBufferSlabPtr copy = slab;
+        }
+        LogBufferSlabPtr slab = pool->Acquire(300 * 1024);
+        APSARA_TEST_EQUAL(slab.get(), first);
+
+        uint64_t hit, miss, resident;
+        pool->GetStatus(hit, miss, resident);
+        APSARA_TEST_EQUAL(hit, 1UL);
+        APSARA_TEST_EQUAL(miss, 1UL);
+        APSARA_TEST_EQUAL(resident, 512 * 1024 + LogBufferPool::kSlabPadding);
+        // Counters are reset by GetStatus.
+        pool->GetStatus(hit, miss, resident);
+        APSARA_TEST_EQUAL(hit, 0UL);
+        APSARA_TEST_EQUAL(miss, 0UL);
+
+        // Large size is not pooled.
+        {
+            LogBufferSlabPtr large = pool->Acquire(16 * 1024 * 1024);
+            APSARA_TEST_TRUE(large.get() != NULL);
+        }
+        pool->GetStatus(hit, miss, resident);
+        APSARA_TEST_EQUAL(miss, 1UL);
+        APSARA_TEST_EQUAL(resident, 512 * 1024 + LogBufferPool::kSlabPadding);
+    }
+
+    void TestIdleLimit() {
+        auto pool = LogBufferPool::GetInstance();
+        int32_t oldLimit = INT32_FLAG(read_buffer_pool_max_idle_bytes);
+        INT32_FLAG(read_buffer_pool_max_idle_bytes) = 64 * 1024;
+        {
+            std::vector<LogBufferSlabPtr> slabs;
+            for (int i = 0; i < 4; ++i) {
+                slabs.push_back(pool->Acquire(32 * 1024));
+            }
+        }
+        uint64_t hit, miss, resident;
+        pool->GetStatus(hit, miss, resident);
+        APSARA_TEST_EQUAL(miss, 4UL);
+        APSARA_TEST_TRUE(resident <= 64 * 1024UL);
+        APSARA_TEST_EQUAL(pool->mIdleSlabs[LogBufferPool::GetSizeClass(32 * 1024)].size(), 1UL);
+
+        pool->Clear();
+        pool->GetStatus(hit, miss, resident);
+        APSARA_TEST_EQUAL(resident, 0UL);
+        INT32_FLAG(read_buffer_pool_max_idle_bytes) = oldLimit;
+    }
+
+    void TestHugePage() {
+        auto pool = LogBufferPool::GetInstance();
+        BOOL_FLAG(read_buffer_pool_huge_page) = true;
+        const int32_t sizeClass = LogBufferPool::GetSizeClass(4 * 1024 * 1024 + 1);
+        const size_t slabSize = LogBufferPool::GetSlabSize(sizeClass);
+        char* first = NULL;
+        {
+            LogBufferSlabPtr slab = pool->Acquire(4 * 1024 * 1024 + 1);
+            first = slab.get();
+            // Whole slab including the padding tail is writable.
+            memset(first, 'a', slabSize);
+        }
+        APSARA_TEST_EQUAL(pool->mIdleSlabs[sizeClass].size(), 1UL);
+#if defined(__linux__)
+        APSARA_TEST_TRUE(pool->mIdleSlabs[sizeClass].back().mHugePage);
+        APSARA_TEST_EQUAL(reinterpret_cast<uintptr_t>(first) % LogBufferPool::kHugePageSize, 0UL);
+#endif
+        // Small slabs are never mapped with huge pages.
+        {
+            LogBufferSlabPtr slab = pool->Acquire(512 * 1024);
+        }
+        APSARA_TEST_FALSE(pool->mIdleSlabs[LogBufferPool::GetSizeClass(512 * 1024)].back().mHugePage);
+
+        // Mapped slab is reused even if the flag is off.
+        BOOL_FLAG(read_buffer_pool_huge_page) = false;
+        {
+            LogBufferSlabPtr slab = pool->Acquire(4 * 1024 * 1024 + 1);
+            APSARA_TEST_EQUAL(slab.get(), first);
+        }
+        pool->Clear();
+        uint64_t hit, miss, resident;
+        pool->GetStatus(hit, miss, resident);
+        APSARA_TEST_EQUAL(resident, 0UL);
+    }
+
+    void TestOverBudget() {
+        auto pool = LogBufferPool::GetInstance();
+        int32_t oldBudget = INT32_FLAG(log_buffer_memory_budget_mb);
+        INT32_FLAG(log_buffer_memory_budget_mb) = 1;
+        MemoryBudget::Add(MEMORY_COMPONENT_LOG_BUFFER, 2 * 1024 * 1024);
+        {
+            LogBufferSlabPtr slab = pool->Acquire(32 * 1024);
+        }
+        APSARA_TEST_EQUAL(pool->mIdleSlabs[LogBufferPool::GetSizeClass(32 * 1024)].size(), 0UL);
+        MemoryBudget::Sub(MEMORY_COMPONENT_LOG_BUFFER, 2 * 1024 * 1024);
+        {
+            LogBufferSlabPtr slab = pool->Acquire(32 * 1024);
+        }
+        APSARA_TEST_EQUAL(pool->mIdleSlabs[LogBufferPool::GetSizeClass(32 * 1024)].size(), 1UL);
+        INT32_FLAG(log_buffer_memory_budget_mb) = oldBudget;
+    }
+};
+
+UNIT_TEST_CASE(LogBufferPoolUnittest, TestSizeClass);
+UNIT_TEST_CASE(LogBufferPoolUnittest, TestReuse);
+UNIT_TEST_CASE(LogBufferPoolUnittest, TestIdleLimit);
+UNIT_TEST_CASE(LogBufferPoolUnittest, TestHugePage);
+UNIT_TEST_CASE(LogBufferPoolUnittest, TestOverBudget);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
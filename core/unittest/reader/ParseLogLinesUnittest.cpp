@@ -0,0 +1,142 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <ctime>
+#include <string>
+#include <vector>
+#include "LogFileReader.h"
+#include "JsonLogFileReader.h"
+
+namespace logtail {
+
+class ParseLogLinesUnittest : public ::testing::Test {
+public:
+    void TestSameAsParseLogLine() {
+        CommonRegLogFileReader reader(
+            "testProject", "testLogstore", ".", "ParseLogLinesUnittest.txt", 0, "%Y-%m-%d %H:%M:%S", "");
+        APSARA_TEST_TRUE(reader.AddUserDefinedFormat("(\\w+) (\\d+)", "name,value"));
+        std::string buffer("a 1", 4);
+        int32_t offsets[3];
+        offsets[0] = 0;
+        offsets[1] = static_cast<int32_t>(buffer.size());
+        buffer.append("bad line", 9);
+        offsets[2] = static_cast<int32_t>(buffer.size());
+        buffer.append("c 3", 4);
+
+        LogFileReader& base = reader;
+        sls_logs::LogGroup batchGroup;
+        LogLineParseState state;
+        uint32_t batchSize = 0;
+        LogLineParseResult results[3];
+        base.ParseLogLines(buffer.data(), offsets, 3, batchGroup, state, batchSize, results);
+        APSARA_TEST_TRUE(results[0].mSuccess);
+        APSARA_TEST_EQUAL(results[0].mLogEnd, 1);
+        APSARA_TEST_FALSE(results[1].mSuccess);
+        APSARA_TEST_EQUAL(results[1].mError, PARSE_LOG_REGEX_ERROR);
+        APSARA_TEST_EQUAL(results[1].mLogEnd, 1);
+        APSARA_TEST_TRUE(results[2].mSuccess);
+        APSARA_TEST_EQUAL(results[2].mLogEnd, 2);
+
+        sls_logs::LogGroup lineGroup;
+        uint32_t lineSize = 0;
+        ParseLogError error;
+        time_t lastLogLineTime = 0;
+        std::string lastLogTimeStr;
+        for (int i = 0; i < 3; ++i) {
+            const char* line = buffer.data() + offsets[i];
+            APSARA_TEST_EQUAL(base.ParseLogLine(line, lineGroup, error, lastLogLineTime, lastLogTimeStr, lineSize),
+                              results[i].mSuccess);
+        }
+        APSARA_TEST_EQUAL(lineGroup.logs_size(), batchGroup.logs_size());
+        APSARA_TEST_EQUAL(lineSize, batchSize);
+        APSARA_TEST_EQUAL(batchGroup.logs(1).contents(1).value(), "3");
+    }
+
+    void TestRegexKeptKeys() {
+        CommonRegLogFileReader reader("testProject", "testLogstore", ".", "ParseLogLinesUnittest.txt", 0, "%s", "");
+        reader.SetTimeKey("time");
+        APSARA_TEST_TRUE(reader.AddUserDefinedFormat("(\\d+) (\\w+) (\\d+)", "time,name,value"));
+        const std::string now = std::to_string(time(NULL));
+        // Keys not kept are still used for time.
+        reader.SetKeptKeys(std::vector<std::string>{"value"});
+        sls_logs::LogGroup logGroup;
+        ParseLines(reader, {now + " a 1"}, logGroup);
+        APSARA_TEST_EQUAL(logGroup.logs_size(), 1);
+        const sls_logs::Log& log = logGroup.logs(0);
+        APSARA_TEST_EQUAL(log.contents_size(), 1);
+        APSARA_TEST_EQUAL(log.contents(0).key(), "value");
+        APSARA_TEST_EQUAL(log.contents(0).value(), "1");
+        APSARA_TEST_EQUAL(std::to_string(log.time()), now);
+
+        // Formats added later follow the kept keys.
+        APSARA_TEST_TRUE(reader.AddUserDefinedFormat("(\\w+)=(\\d+)", "name,value"));
+        reader.SetKeptKeys(std::vector<std::string>());
+        logGroup.Clear();
+        ParseLines(reader, {"b=2"}, logGroup);
+        APSARA_TEST_EQUAL(logGroup.logs_size(), 1);
+        APSARA_TEST_EQUAL(logGroup.logs(0).contents_size(), 2);
+    }
+
+    void TestJsonKeptKeys() {
+        const std::string now = std::to_string(time(NULL));
+        for (bool rawNestedValue : {false, true}) {
+            JsonLogFileReader reader(
+                "testProject", "testLogstore", ".", "ParseLogLinesUnittest.txt", 0, "%s", "", "", ENCODING_UTF8, true);
+            reader.SetTimeKey("time");
+            reader.SetRawNestedValue(rawNestedValue);
+            reader.SetKeptKeys(std::vector<std::string>{"b", "nested", "missing"});
+            sls_logs::LogGroup logGroup;
+            ParseLines(reader,
+                       {"{\"time\":\"" + now + "\",\"a\":1,\"b\":\"x\",\"c\":{\"d\":[1,2]},\"nested\":{\"e\":true},"
+                        "\"f\":1.5,\"g\":null}"},
+                       logGroup);
+            APSARA_TEST_EQUAL(logGroup.logs_size(), 1);
+            const sls_logs::Log& log = logGroup.logs(0);
+            APSARA_TEST_EQUAL(std::to_string(log.time()), now);
+            APSARA_TEST_EQUAL(log.contents_size(), 2);
+            APSARA_TEST_EQUAL(log.contents(0).key(), "b");
+            APSARA_TEST_EQUAL(log.contents(0).value(), "x");
+            APSARA_TEST_EQUAL(log.contents(1).key(), "nested");
+            APSARA_TEST_EQUAL(log.contents(1).value(), "{\"e\":true}");
+        }
+    }
+
+private:
+    static void
+    ParseLines(LogFileReader& reader, const std::vector<std::string>& lines, sls_logs::LogGroup& logGroup) {
+        std::string buffer;
+        std::vector<int32_t> offsets;
+        for (const auto& line : lines) {
+            offsets.push_back(static_cast<int32_t>(buffer.size()));
+            buffer.append(line.c_str(), line.size() + 1);
+        }
+        LogLineParseState state;
+        uint32_t size = 0;
+        std::vector<LogLineParseResult> results(lines.size());
+        reader.ParseLogLines(buffer.data(), offsets.data(), offsets.size(), logGroup, state, size, results.data());
+    }
+};
+
+UNIT_TEST_CASE(ParseLogLinesUnittest, TestSameAsParseLogLine);
+UNIT_TEST_CASE(ParseLogLinesUnittest, TestRegexKeptKeys);
+UNIT_TEST_CASE(ParseLogLinesUnittest, TestJsonKeptKeys);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
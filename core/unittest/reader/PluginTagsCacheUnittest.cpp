@@ -0,0 +1,96 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include "LogFileReader.h"
+#include "config_manager/ConfigManager.h"
+
+namespace logtail {
+
+class PluginTagsCacheUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mReader.reset(new CommonRegLogFileReader(
+            "testProject", "testLogstore", ".", "PluginTagsCacheUnittest.txt", 0, "%Y-%m-%d %H:%M:%S", ""));
+    }
+
+    void TearDown() override { mReader.reset(); }
+
+    void TestCacheHit() {
+        APSARA_TEST_TRUE(mReader->GetCachedPluginTags("/a.log", "id") == nullptr);
+        auto tags = std::make_shared<const std::string>("tags");
+        mReader->SetCachedPluginTags("/a.log", "id", tags);
+        APSARA_TEST_TRUE(mReader->GetCachedPluginTags("/a.log", "id") == tags);
+    }
+
+    void TestCacheMiss() {
+        mReader->SetCachedPluginTags("/a.log", "id", std::make_shared<const std::string>("tags"));
+        APSARA_TEST_TRUE(mReader->GetCachedPluginTags("/b.log", "id") == nullptr);
+        APSARA_TEST_TRUE(mReader->GetCachedPluginTags("/a.log", "id2") == nullptr);
+
+        sls_logs::LogTag tag;
+        tag.set_key("key");
+        tag.set_value("value");
+        mReader->AddExtraTags(std::vector<sls_logs::LogTag>{tag});
+        APSARA_TEST_TRUE(mReader->GetCachedPluginTags("/a.log", "id") == nullptr);
+        mReader->SetCachedPluginTags("/a.log", "id", std::make_shared<const std::string>("tags with extra"));
+        APSARA_TEST_EQUAL(*mReader->GetCachedPluginTags("/a.log", "id"), "tags with extra");
+    }
+
+    void TestLogTagsCache() {
+        APSARA_TEST_TRUE(mReader->GetCachedLogTags("/a.log", "id") == nullptr);
+        auto tags = std::make_shared<const std::vector<sls_logs::LogTag>>(1);
+        mReader->SetCachedLogTags("/a.log", "id", tags);
+        APSARA_TEST_TRUE(mReader->GetCachedLogTags("/a.log", "id") == tags);
+        APSARA_TEST_TRUE(mReader->GetCachedLogTags("/a.log", "id2") == nullptr);
+        // Caches of plugin tags and log tags are independent.
+        APSARA_TEST_TRUE(mReader->GetCachedPluginTags("/a.log", "id") == nullptr);
+
+        mReader->AddExtraTags(std::vector<sls_logs::LogTag>(1));
+        APSARA_TEST_TRUE(mReader->GetCachedLogTags("/a.log", "id") == nullptr);
+    }
+
+    void TestConfigCache() {
+        ConfigManager* manager = ConfigManager::GetInstance();
+        mReader->SetConfigName("PluginTagsCacheUnittest");
+        APSARA_TEST_TRUE(mReader->GetConfig() == NULL);
+
+        Config* config = new Config;
+        manager->mNameConfigMap["PluginTagsCacheUnittest"] = config;
+        APSARA_TEST_TRUE(mReader->GetConfig() == config);
+        // Cached until configs are deleted.
+        manager->mNameConfigMap.erase("PluginTagsCacheUnittest");
+        APSARA_TEST_TRUE(mReader->GetConfig() == config);
+        manager->mNameConfigMap["PluginTagsCacheUnittest"] = config;
+        manager->RemoveAllConfigs();
+        APSARA_TEST_TRUE(mReader->GetConfig() == NULL);
+    }
+
+private:
+    LogFileReaderPtr mReader;
+};
+
+UNIT_TEST_CASE(PluginTagsCacheUnittest, TestCacheHit);
+UNIT_TEST_CASE(PluginTagsCacheUnittest, TestCacheMiss);
+UNIT_TEST_CASE(PluginTagsCacheUnittest, TestLogTagsCache);
+UNIT_TEST_CASE(PluginTagsCacheUnittest, TestConfigCache);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
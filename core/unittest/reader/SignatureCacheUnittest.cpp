@@ -0,0 +1,106 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstdio>
+#include <fstream>
+#include "LogFileReader.h"
+#include "common/DevInode.h"
+
+DECLARE_FLAG_INT32(signature_recheck_interval);
+
+namespace logtail {
+
+class SignatureCacheUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mFileName = "SignatureCacheUnittest.txt";
+        WriteFile(std::string(2048, 'a'), std::ios::trunc);
+        mReader.reset(
+            new CommonRegLogFileReader("testProject", "testLogstore", ".", mFileName, 0, "%Y-%m-%d %H:%M:%S", ""));
+        mReader->SetDevInode(GetFileDevInode(mFileName));
+        APSARA_TEST_TRUE_FATAL(mReader->UpdateFilePtr());
+    }
+
+    void TearDown() override {
+        mReader.reset();
+        remove(mFileName.c_str());
+        INT32_FLAG(signature_recheck_interval) = 0;
+    }
+
+    void TestAlwaysCheck() {
+        int64_t fileSize = 0;
+        APSARA_TEST_TRUE(mReader->CheckFileSignatureAndOffset(fileSize));
+        APSARA_TEST_FALSE(mReader->IsSignatureCacheValid(fileSize, time(NULL)));
+        OverwriteHeader();
+        APSARA_TEST_FALSE(mReader->CheckFileSignatureAndOffset(fileSize));
+    }
+
+    void TestCachedUntilShrink() {
+        INT32_FLAG(signature_recheck_interval) = 3600;
+        int64_t fileSize = 0;
+        APSARA_TEST_TRUE(mReader->CheckFileSignatureAndOffset(fileSize));
+        APSARA_TEST_EQUAL(fileSize, 2048);
+        APSARA_TEST_TRUE(mReader->IsSignatureCacheValid(fileSize, time(NULL)));
+        APSARA_TEST_FALSE(mReader->IsSignatureCacheValid(fileSize, time(NULL) + 3600));
+
+        // Header is not read again while the file grows.
+        OverwriteHeader();
+        WriteFile(std::string(100, 'c'), std::ios::app);
+        APSARA_TEST_TRUE(mReader->CheckFileSignatureAndOffset(fileSize));
+        APSARA_TEST_EQUAL(fileSize, 2148);
+
+        // Shrunk file is checked.
+        WriteFile(std::string(1500, 'd'), std::ios::trunc);
+        APSARA_TEST_FALSE(mReader->IsSignatureCacheValid(1500, time(NULL)));
+        APSARA_TEST_FALSE(mReader->CheckFileSignatureAndOffset(fileSize));
+        APSARA_TEST_EQUAL(mReader->GetLastFilePos(), 0);
+    }
+
+    void TestShortSignatureGrows() {
+        INT32_FLAG(signature_recheck_interval) = 3600;
+        WriteFile("short\n", std::ios::trunc);
+        int64_t fileSize = 0;
+        mReader->CheckFileSignatureAndOffset(fileSize);
+        APSARA_TEST_TRUE(mReader->IsSignatureCacheValid(fileSize, time(NULL)));
+        // The signature is shorter than 1024 bytes, it must be read again to grow with the file.
+        APSARA_TEST_FALSE(mReader->IsSignatureCacheValid(fileSize + 1, time(NULL)));
+    }
+
+private:
+    void WriteFile(const std::string& content, std::ios::openmode mode) {
+        std::ofstream(mFileName, std::ios::out | std::ios::binary | mode) << content;
+    }
+
+    void OverwriteHeader() {
+        std::fstream file(mFileName, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(0);
+        file << std::string(16, 'b');
+    }
+
+    std::string mFileName;
+    LogFileReaderPtr mReader;
+};
+
+UNIT_TEST_CASE(SignatureCacheUnittest, TestAlwaysCheck);
+UNIT_TEST_CASE(SignatureCacheUnittest, TestCachedUntilShrink);
+UNIT_TEST_CASE(SignatureCacheUnittest, TestShortSignatureGrows);
+
+} // namespace logtail
+
+int main(int argc, char** argv) {
+    logtail::Logger::Instance().InitGlobalLoggers();
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
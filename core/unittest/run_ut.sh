@@ -52,6 +52,32 @@ echo "============== common =============" >> $output
 cd common
 ./common_simple_utils_unittest >> $output 2>&1
 ./common_util_unittest >> $output 2>&1
+./common_line_feed_scanner_unittest >> $output 2>&1
+./common_regex_prefix_filter_unittest >> $output 2>&1
+./common_logstore_feedback_queue_unittest >> $output 2>&1
+./common_compress_tools_unittest >> $output 2>&1
+./common_file_encryption_unittest >> $output 2>&1
+./common_histogram_unittest >> $output 2>&1
+./common_sharded_clock_cache_unittest >> $output 2>&1
+./common_batch_stat_unittest >> $output 2>&1
+./common_batch_read_unittest >> $output 2>&1
+./common_log_file_offset_info_unittest >> $output 2>&1
+./common_encoding_converter_unittest >> $output 2>&1
+./common_mpsc_ring_queue_unittest >> $output 2>&1
+./common_stage_profiler_unittest >> $output 2>&1
+./common_flat_hash_map_unittest >> $output 2>&1
+./common_memory_budget_unittest >> $output 2>&1
+./common_thread_pool_unittest >> $output 2>&1
+./common_circular_buffer_unittest >> $output 2>&1
+./common_string_interner_unittest >> $output 2>&1
+./common_thread_affinity_unittest >> $output 2>&1
+./common_regex_cache_unittest >> $output 2>&1
+./common_timer_wheel_unittest >> $output 2>&1
+./common_path_trie_unittest >> $output 2>&1
+./common_startup_timeline_unittest >> $output 2>&1
+./common_decompress_stream_unittest >> $output 2>&1
+./common_utf8_validator_unittest >> $output 2>&1
+./common_heavy_hitters_unittest >> $output 2>&1
 cd ..
 echo "====================================" >> $output
 
@@ -59,24 +85,34 @@ echo "============== config ==============" >> $output
 cd config
 ./config_match_unittest >> $output 2>&1
 ./config_updator_unittest >> $output 2>&1
+./config_path_index_unittest >> $output 2>&1
 cd ..
 echo "====================================" >> $output
 
 echo "============== parser ==============" >> $output
 cd parser
 ./parser_unittest >> $output 2>&1
+./delimiter_mode_bitmask_parser_unittest >> $output 2>&1
 cd ..
 echo "====================================" >> $output
 
 echo "============== polling ==============" >> $output
 cd polling
 ./polling_unittest >> $output 2>&1
+./polling_dir_snapshot_unittest >> $output 2>&1
 cd ..
 echo "====================================" >> $output
 
 echo "============== processor ==============" >> $output
 cd processor
 ./processor_filter_unittest >> $output 2>&1
+./processor_filter_program_unittest >> $output 2>&1
+./processor_pipeline_unittest >> $output 2>&1
+./processor_process_thread_scaler_unittest >> $output 2>&1
+./processor_process_queue_spill_unittest >> $output 2>&1
+./processor_repeated_line_table_unittest >> $output 2>&1
+./processor_log_to_metric_unittest >> $output 2>&1
+./processor_native_processor_unittest >> $output 2>&1
 cd ..
 echo "====================================" >> $output
 
@@ -86,17 +122,54 @@ if [ ! -d testDataSet ]; then
 	cp -r $CURRENT_DIR/reader/testDataSet ./
 fi
 ./reader_unittest >> $output 2>&1
+./log_buffer_pool_unittest >> $output 2>&1
+./log_file_reader_fd_manager_unittest >> $output 2>&1
+./log_file_reader_signature_cache_unittest >> $output 2>&1
+./log_file_reader_adaptive_read_size_unittest >> $output 2>&1
+./log_file_reader_plugin_tags_cache_unittest >> $output 2>&1
+./log_file_reader_parse_log_lines_unittest >> $output 2>&1
+./log_file_reader_file_time_index_unittest >> $output 2>&1
+./log_file_reader_container_stdout_unittest >> $output 2>&1
 cd ..
 echo "====================================" >> $output
 
 echo "============== sender ==============" >> $output
 cd sender
 ./sender_unittest >> $output 2>&1
+./sender_adaptive_batch_policy_unittest >> $output 2>&1
+./sender_adaptive_compress_policy_unittest >> $output 2>&1
+./sender_compress_worker_pool_unittest >> $output 2>&1
+./sender_buffer_file_index_unittest >> $output 2>&1
+./sender_merge_item_coalesce_unittest >> $output 2>&1
+./sender_shard_router_unittest >> $output 2>&1
+./sender_region_endpoint_entry_unittest >> $output 2>&1
+./sender_region_concurrency_controller_unittest >> $output 2>&1
+cd ..
+
+echo "============== streamlog ==============" >> $output
+cd streamlog
+./streamlog_unittest >> $output 2>&1
 cd ..
 
 echo "============== profiler ==============" >> $output
 cd profiler
 ./profiler_data_integrity_unittest >> $output 2>&1
+./profiler_log_file_profiler_unittest >> $output 2>&1
+./profiler_pipeline_latency_profiler_unittest >> $output 2>&1
+./profiler_logtail_alarm_unittest >> $output 2>&1
+./profiler_integrity_notifier_unittest >> $output 2>&1
+cd ..
+
+echo "============== monitor ==============" >> $output
+cd monitor
+./monitor_metric_registry_unittest >> $output 2>&1
+./monitor_cgroup_resource_unittest >> $output 2>&1
+./monitor_cpu_profiler_unittest >> $output 2>&1
+cd ..
+
+echo "============== logger ==============" >> $output
+cd logger
+./logger_hot_logger_unittest >> $output 2>&1
 cd ..
 echo "====================================" >> $output
 echo "====================================" >> $output
@@ -0,0 +1,123 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <atomic>
+#include "sdk/DNSCache.h"
+
+DECLARE_FLAG_INT32(sdk_dns_cache_ttl);
+DECLARE_FLAG_INT32(sdk_dns_cache_stale_ttl);
+DECLARE_FLAG_INT32(sdk_dns_cache_negative_ttl);
+
+namespace logtail {
+namespace sdk {
+
+    class DNSCacheUnittest : public ::testing::Test {
+    public:
+        void SetUp() override {
+            mTTL = INT32_FLAG(sdk_dns_cache_ttl);
+            mStaleTTL = INT32_FLAG(sdk_dns_cache_stale_ttl);
+            mNegativeTTL = INT32_FLAG(sdk_dns_cache_negative_ttl);
+        }
+
+        void TearDown() override {
+            INT32_FLAG(sdk_dns_cache_ttl) = mTTL;
+            INT32_FLAG(sdk_dns_cache_stale_ttl) = mStaleTTL;
+            INT32_FLAG(sdk_dns_cache_negative_ttl) = mNegativeTTL;
+        }
+
+        void TestResolveInBackground() {
+            std::atomic_int resolveCount{0};
+            DnsCache cache([&resolveCount](const std::string& host, std::string& address) {
+                ++resolveCount;
+                address = "10.0.0.1";
+                return true;
+            });
+            std::string address;
+            // A miss does not wait for the resolution.
+            APSARA_TEST_FALSE(cache.GetIPFromDnsCache("example.com", address));
+            cache.WaitResolved();
+            APSARA_TEST_TRUE(cache.GetIPFromDnsCache("example.com", address));
+            APSARA_TEST_EQUAL(address, std::string("10.0.0.1"));
+            APSARA_TEST_TRUE(cache.GetIPFromDnsCache("example.com", address));
+            cache.WaitResolved();
+            APSARA_TEST_EQUAL(resolveCount.load(), 1);
+        }
+
+        void TestServeStaleWhileRefreshing() {
+            INT32_FLAG(sdk_dns_cache_ttl) = 0;
+            INT32_FLAG(sdk_dns_cache_stale_ttl) = 600;
+            std::atomic_int resolveCount{0};
+            DnsCache cache([&resolveCount](const std::string& host, std::string& address) {
+                address = ++resolveCount == 1 ? "10.0.0.1" : "10.0.0.2";
+                return true;
+            });
+            std::string address;
+            APSARA_TEST_TRUE(cache.UpdateHostInDnsCache("example.com", address));
+            // Expired at once, the old address is used while the host is resolved again.
+            APSARA_TEST_TRUE(cache.GetIPFromDnsCache("example.com", address));
+            APSARA_TEST_EQUAL(address, std::string("10.0.0.1"));
+            cache.WaitResolved();
+            APSARA_TEST_TRUE(cache.GetIPFromDnsCache("example.com", address));
+            APSARA_TEST_EQUAL(address, std::string("10.0.0.2"));
+        }
+
+        void TestNegativeCache() {
+            INT32_FLAG(sdk_dns_cache_negative_ttl) = 600;
+            std::atomic_int resolveCount{0};
+            DnsCache cache([&resolveCount](const std::string& host, std::string& address) {
+                ++resolveCount;
+                return false;
+            });
+            std::string address;
+            APSARA_TEST_FALSE(cache.UpdateHostInDnsCache("example.com", address));
+            for (int i = 0; i < 10; ++i) {
+                APSARA_TEST_FALSE(cache.GetIPFromDnsCache("example.com", address));
+            }
+            cache.WaitResolved();
+            APSARA_TEST_EQUAL(resolveCount.load(), 1);
+        }
+
+        void TestKeepAddressOnFailure() {
+            INT32_FLAG(sdk_dns_cache_ttl) = 0;
+            INT32_FLAG(sdk_dns_cache_stale_ttl) = 600;
+            std::atomic_bool fail{false};
+            DnsCache cache([&fail](const std::string& host, std::string& address) {
+                address = "10.0.0.1";
+                return !fail.load();
+            });
+            std::string address;
+            APSARA_TEST_TRUE(cache.UpdateHostInDnsCache("example.com", address));
+            fail = true;
+            APSARA_TEST_FALSE(cache.UpdateHostInDnsCache("example.com", address));
+            address.clear();
+            APSARA_TEST_TRUE(cache.GetIPFromDnsCache("example.com", address));
+            APSARA_TEST_EQUAL(address, std::string("10.0.0.1"));
+        }
+
+    private:
+        int32_t mTTL = 0;
+        int32_t mStaleTTL = 0;
+        int32_t mNegativeTTL = 0;
+    };
+
+    UNIT_TEST_CASE(DNSCacheUnittest, TestResolveInBackground);
+    UNIT_TEST_CASE(DNSCacheUnittest, TestServeStaleWhileRefreshing);
+    UNIT_TEST_CASE(DNSCacheUnittest, TestNegativeCache);
+    UNIT_TEST_CASE(DNSCacheUnittest, TestKeepAddressOnFailure);
+
+} // namespace sdk
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -42,6 +42,29 @@ void HttpMessageUnittest::TestGetServerTimeFromHeader() {
     EXPECT_EQ(kTimestamp, httpMsg.GetServerTimeFromHeader());
 }
 
+class SDKCommonUnittest : public ::testing::Test {};
+
+TEST_F(SDKCommonUnittest, TestDigests) {
+    EXPECT_EQ(sdk::CalcMD5("hello"), "5D41402ABC4B2A76B9719D911017C592");
+    EXPECT_EQ(sdk::CalcMD5(""), "D41D8CD98F00B204E9800998ECF8427E");
+    EXPECT_EQ(sdk::Base64Enconde(sdk::CalcSHA1("hello", "key")), "s0zqxFFv8joUPmHXnQ+npPvl8mY=");
+    EXPECT_EQ(sdk::Base64Enconde(""), "");
+    EXPECT_EQ(sdk::Base64Enconde("a"), "YQ==");
+    EXPECT_EQ(sdk::Base64Enconde("ab"), "YWI=");
+    EXPECT_EQ(sdk::Base64Enconde("abc"), "YWJj");
+    EXPECT_EQ(sdk::Base64Enconde("\xff\xfe\x01\x80\x7f"), "//4BgH8=");
+}
+
+TEST_F(SDKCommonUnittest, TestUrlSignatureUsesContentMd5Header) {
+    std::map<std::string, std::string> header;
+    header[sdk::DATE] = "Thu, 18 Feb 2021 10:11:10 GMT";
+    std::map<std::string, std::string> parameters;
+    const std::string body = "body";
+    const std::string expected = sdk::GetUrlSignature(sdk::HTTP_POST, "/logstores", header, parameters, body, "key");
+    header[sdk::CONTENT_MD5] = sdk::CalcMD5(body);
+    EXPECT_EQ(sdk::GetUrlSignature(sdk::HTTP_POST, "/logstores", header, parameters, body, "key"), expected);
+}
+
 class SDKClientUnittest : public ::testing::Test {};
 
 TEST_F(SDKClientUnittest, TestNetwork) {
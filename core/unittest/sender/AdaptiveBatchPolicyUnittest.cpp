@@ -0,0 +1,114 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "sender/AdaptiveBatchPolicy.h"
+
+DECLARE_FLAG_BOOL(enable_adaptive_batch_size);
+DECLARE_FLAG_INT32(adaptive_batch_adjust_interval);
+
+namespace logtail {
+
+class AdaptiveBatchPolicyUnittest : public ::testing::Test {
+public:
+    void SetUp() override { BOOL_FLAG(enable_adaptive_batch_size) = true; }
+    void TearDown() override { BOOL_FLAG(enable_adaptive_batch_size) = false; }
+
+    void TestGrowWhenRttDominated() {
+        AdaptiveBatchPolicy policy;
+        const int32_t interval = INT32_FLAG(adaptive_batch_adjust_interval);
+        int32_t curTime = 1000;
+        policy.OnSendSuccess("remote", 100, curTime);
+        APSARA_TEST_EQUAL(policy.GetScale("remote"), 1.0);
+        // Not adjusted within the interval.
+        policy.OnSendSuccess("remote", 100, curTime + interval - 1);
+        APSARA_TEST_EQUAL(policy.GetScale("remote"), 1.0);
+        curTime += interval;
+        policy.OnSendSuccess("remote", 110, curTime);
+        APSARA_TEST_EQUAL(policy.GetScale("remote"), 1.25);
+        for (int i = 0; i < 8; ++i) {
+            curTime += interval;
+            policy.OnSendSuccess("remote", 100, curTime);
+        }
+        APSARA_TEST_EQUAL(policy.GetScale("remote"), 4.0);
+        APSARA_TEST_EQUAL(policy.ScaleLimit("remote", 1000, 10000), 4000);
+        APSARA_TEST_EQUAL(policy.ScaleLimit("remote", 1000, 2000), 2000);
+        APSARA_TEST_EQUAL(policy.ScaleLimit("remote", 1000, 1000), 1000);
+
+        // Transfer dominated latency brings the scale back to 1.
+        for (int i = 0; i < 8; ++i) {
+            curTime += interval;
+            policy.OnSendSuccess("remote", 1000, curTime);
+        }
+        APSARA_TEST_EQUAL(policy.GetScale("remote"), 1.0);
+
+        // Local endpoints with small RTT never grow.
+        curTime = 1000;
+        for (int i = 0; i < 5; ++i) {
+            policy.OnSendSuccess("local", 2, curTime);
+            curTime += interval;
+        }
+        APSARA_TEST_EQUAL(policy.GetScale("local"), 1.0);
+    }
+
+    void TestShrinkWhenBlocked() {
+        AdaptiveBatchPolicy policy;
+        const int32_t interval = INT32_FLAG(adaptive_batch_adjust_interval);
+        int32_t curTime = 1000;
+        policy.OnSendSuccess("region", 100, curTime);
+        curTime += interval;
+        policy.OnSendBlocked("region", curTime);
+        APSARA_TEST_EQUAL(policy.GetScale("region"), 0.5);
+        curTime += interval;
+        policy.OnSendBlocked("region", curTime);
+        curTime += interval;
+        policy.OnSendBlocked("region", curTime);
+        APSARA_TEST_EQUAL(policy.GetScale("region"), 0.25);
+        APSARA_TEST_EQUAL(policy.ScaleLimit("region", 1000, 10000), 250);
+
+        // Not blocked anymore, the scale goes back to 1.
+        curTime += interval;
+        policy.OnSendSuccess("region", 1000, curTime);
+        APSARA_TEST_EQUAL(policy.GetScale("region"), 0.3125);
+        for (int i = 0; i < 10; ++i) {
+            curTime += interval;
+            policy.OnSendSuccess("region", 1000, curTime);
+        }
+        APSARA_TEST_EQUAL(policy.GetScale("region"), 1.0);
+
+        // Blocked within the interval takes effect at the next adjustment.
+        policy.OnSendBlocked("region", curTime + 1);
+        APSARA_TEST_EQUAL(policy.GetScale("region"), 1.0);
+        curTime += interval;
+        policy.OnSendSuccess("region", 1000, curTime);
+        APSARA_TEST_EQUAL(policy.GetScale("region"), 0.5);
+    }
+
+    void TestDisabled() {
+        AdaptiveBatchPolicy policy;
+        BOOL_FLAG(enable_adaptive_batch_size) = false;
+        policy.OnSendBlocked("region", 1000);
+        policy.OnSendBlocked("region", 2000);
+        APSARA_TEST_EQUAL(policy.GetScale("region"), 1.0);
+        APSARA_TEST_EQUAL(policy.ScaleLimit("region", 1000, 10000), 1000);
+    }
+};
+
+UNIT_TEST_CASE(AdaptiveBatchPolicyUnittest, TestGrowWhenRttDominated);
+UNIT_TEST_CASE(AdaptiveBatchPolicyUnittest, TestShrinkWhenBlocked);
+UNIT_TEST_CASE(AdaptiveBatchPolicyUnittest, TestDisabled);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
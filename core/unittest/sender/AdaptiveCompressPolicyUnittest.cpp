@@ -0,0 +1,128 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "common/util.h"
+#include "sender/AdaptiveCompressPolicy.h"
+
+DECLARE_FLAG_INT32(adaptive_compress_sample_interval);
+
+namespace logtail {
+
+class AdaptiveCompressPolicyUnittest : public ::testing::Test {
+public:
+    typedef AdaptiveCompressPolicy::Option Option;
+
+    static const LogstoreFeedBackKey kKey = 1;
+
+    // Send selects the option for kKey and records a result by mRatios and mCosts of it.
+    Option Send(AdaptiveCompressPolicy& policy, int32_t curTime) {
+        int32_t level = 0;
+        sls_logs::SlsCompressType type = policy.Select(kKey, "region", sls_logs::SLS_CMP_LZ4, level, curTime);
+        Option option = AdaptiveCompressPolicy::ToOption(type, level);
+        if (option != AdaptiveCompressPolicy::OPTION_COUNT) {
+            policy.OnCompressed(
+                kKey, type, level, 1024, static_cast<size_t>(1024 * mRatios[option]), mCosts[option], curTime);
+        }
+        return option;
+    }
+
+    void TestEndpointAddressType() {
+        APSARA_TEST_TRUE(GetEndpointAddressType("cn-hangzhou-intranet.log.aliyuncs.com")
+                         == EndpointAddressType::INTRANET);
+        APSARA_TEST_TRUE(GetEndpointAddressType("http://cn-hangzhou-share.log.aliyuncs.com")
+                         == EndpointAddressType::INNER);
+        APSARA_TEST_TRUE(GetEndpointAddressType("https://cn-hangzhou.log.aliyuncs.com:443/")
+                         == EndpointAddressType::PUBLIC);
+        APSARA_TEST_TRUE(GetEndpointAddressType("http://log-global.aliyuncs.com") == EndpointAddressType::PUBLIC);
+        APSARA_TEST_TRUE(GetEndpointAddressType("http://10.0.0.1:80") == EndpointAddressType::INNER);
+    }
+
+    void TestKeepConfigType() {
+        AdaptiveCompressPolicy policy;
+        policy.SetCpuLevel(0.1);
+        int32_t level = 0;
+        // Regions without a success, or with intranet endpoints keep the configured type.
+        APSARA_TEST_EQUAL(policy.Select(kKey, "region", sls_logs::SLS_CMP_LZ4, level, 1000), sls_logs::SLS_CMP_LZ4);
+        policy.OnSendSuccess("region", "http://cn-hangzhou-intranet.log.aliyuncs.com");
+        APSARA_TEST_EQUAL(policy.Select(kKey, "region", sls_logs::SLS_CMP_LZ4, level, 1000), sls_logs::SLS_CMP_LZ4);
+        policy.OnSendSuccess("region", "http://cn-hangzhou.log.aliyuncs.com");
+        APSARA_TEST_EQUAL(policy.Select(kKey, "region", sls_logs::SLS_CMP_DEFLATE, level, 1000),
+                          sls_logs::SLS_CMP_DEFLATE);
+        APSARA_TEST_TRUE(policy.mLogstoreStates.empty());
+    }
+
+    void TestSelectByCpuLevel() {
+        AdaptiveCompressPolicy policy;
+        policy.OnSendSuccess("region", "http://cn-hangzhou.log.aliyuncs.com");
+        policy.SetCpuLevel(0.9);
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_LZ4);
+        policy.SetCpuLevel(0.5);
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_ZSTD_LOW);
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_ZSTD_LOW);
+        policy.SetCpuLevel(0.1);
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_ZSTD_HIGH);
+    }
+
+    void TestStepDownByGain() {
+        AdaptiveCompressPolicy policy;
+        policy.OnSendSuccess("region", "http://cn-hangzhou.log.aliyuncs.com");
+        policy.SetCpuLevel(0.1);
+        // The cheaper options are sampled first.
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_LZ4);
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_ZSTD_LOW);
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_ZSTD_HIGH);
+        // The high level saves little more than the low one.
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_ZSTD_LOW);
+        APSARA_TEST_EQUAL(Send(policy, 1010), AdaptiveCompressPolicy::OPTION_ZSTD_LOW);
+
+        // It's tried again when its sample is stale, and taken back if data changes.
+        const int32_t curTime = 1000 + INT32_FLAG(adaptive_compress_sample_interval);
+        mRatios[AdaptiveCompressPolicy::OPTION_ZSTD_HIGH] = 0.1;
+        APSARA_TEST_EQUAL(Send(policy, curTime), AdaptiveCompressPolicy::OPTION_LZ4);
+        APSARA_TEST_EQUAL(Send(policy, curTime), AdaptiveCompressPolicy::OPTION_ZSTD_HIGH);
+        for (int i = 0; i < 5; ++i) {
+            Send(policy, curTime);
+        }
+        APSARA_TEST_EQUAL(Send(policy, curTime), AdaptiveCompressPolicy::OPTION_ZSTD_HIGH);
+    }
+
+    void TestStepDownByCost() {
+        AdaptiveCompressPolicy policy;
+        policy.OnSendSuccess("region", "http://cn-hangzhou.log.aliyuncs.com");
+        policy.SetCpuLevel(0.5);
+        mCosts[AdaptiveCompressPolicy::OPTION_ZSTD_LOW] = 1000;
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_LZ4);
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_ZSTD_LOW);
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_LZ4);
+        policy.SetCpuLevel(0.1);
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_ZSTD_HIGH);
+        // The cost of the low level is accepted if CPU is idle.
+        APSARA_TEST_EQUAL(Send(policy, 1000), AdaptiveCompressPolicy::OPTION_ZSTD_LOW);
+    }
+
+private:
+    double mRatios[AdaptiveCompressPolicy::OPTION_COUNT] = {0.3, 0.2, 0.195};
+    uint64_t mCosts[AdaptiveCompressPolicy::OPTION_COUNT] = {10, 30, 100};
+};
+
+UNIT_TEST_CASE(AdaptiveCompressPolicyUnittest, TestEndpointAddressType);
+UNIT_TEST_CASE(AdaptiveCompressPolicyUnittest, TestKeepConfigType);
+UNIT_TEST_CASE(AdaptiveCompressPolicyUnittest, TestSelectByCpuLevel);
+UNIT_TEST_CASE(AdaptiveCompressPolicyUnittest, TestStepDownByGain);
+UNIT_TEST_CASE(AdaptiveCompressPolicyUnittest, TestStepDownByCost);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
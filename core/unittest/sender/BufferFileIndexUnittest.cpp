@@ -0,0 +1,88 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstring>
+#include "sender/BufferFileIndex.h"
+
+namespace logtail {
+
+class BufferFileIndexUnittest : public ::testing::Test {
+public:
+    // The size of block meta before data of the index block, any size works for the index.
+    static const size_t kBlockMetaSize = 24;
+
+    // MakeFile returns content of a file with @blockCount blocks of 100 bytes and the index.
+    std::string MakeFile(size_t blockCount) {
+        BufferFileIndex index;
+        std::string file(1024, 'h');
+        for (size_t i = 0; i < blockCount; ++i) {
+            index.AddBlock(file.size());
+            file.append(100, 'b');
+        }
+        const int64_t indexOffset = file.size();
+        file.append(kBlockMetaSize, 'm');
+        file.append(index.Serialize(indexOffset));
+        return file;
+    }
+
+    bool LoadIndex(const std::string& file, BufferFileIndex& index) {
+        BufferFileIndex::Trailer trailer;
+        if (file.size() < sizeof(trailer)) {
+            return false;
+        }
+        memcpy(&trailer, file.data() + file.size() - sizeof(trailer), sizeof(trailer));
+        if (!BufferFileIndex::CheckTrailer(trailer, file.size(), kBlockMetaSize)) {
+            return false;
+        }
+        const size_t dataOffset = trailer.mIndexOffset + kBlockMetaSize;
+        return index.Parse(file.data() + dataOffset, file.size() - sizeof(trailer) - dataOffset, trailer);
+    }
+
+    void TestSerializeAndParse() {
+        BufferFileIndex index;
+        APSARA_TEST_TRUE(LoadIndex(MakeFile(10), index));
+        APSARA_TEST_EQUAL(index.GetBlockOffsets().size(), 10UL);
+        for (size_t i = 0; i < 10; ++i) {
+            APSARA_TEST_EQUAL(index.GetBlockOffsets()[i], static_cast<int64_t>(1024 + i * 100));
+        }
+        APSARA_TEST_TRUE(LoadIndex(MakeFile(0), index));
+        APSARA_TEST_EQUAL(index.GetBlockOffsets().size(), 0UL);
+    }
+
+    void TestInvalidIndex() {
+        BufferFileIndex index;
+        const std::string file = MakeFile(10);
+        // Not sealed.
+        APSARA_TEST_FALSE(LoadIndex(file.substr(0, 1024 + 500), index));
+        // Appended after sealed.
+        APSARA_TEST_FALSE(LoadIndex(file + "more", index));
+        // Corrupted offsets.
+        std::string corrupted = file;
+        corrupted[1024 + 1000 + kBlockMetaSize + 3] ^= 0x1;
+        APSARA_TEST_FALSE(LoadIndex(corrupted, index));
+        APSARA_TEST_EQUAL(index.GetBlockOffsets().size(), 0UL);
+        // Corrupted magic.
+        corrupted = file;
+        corrupted[corrupted.size() - 1] ^= 0x1;
+        APSARA_TEST_FALSE(LoadIndex(corrupted, index));
+    }
+};
+
+UNIT_TEST_CASE(BufferFileIndexUnittest, TestSerializeAndParse);
+UNIT_TEST_CASE(BufferFileIndexUnittest, TestInvalidIndex);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
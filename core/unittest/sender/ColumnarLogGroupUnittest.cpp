@@ -0,0 +1,101 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include <string>
+#include "common/Flags.h"
+#include "sender/ColumnarLogGroup.h"
+
+DECLARE_FLAG_STRING(columnar_log_group_regions);
+
+namespace logtail {
+
+class ColumnarLogGroupUnittest : public ::testing::Test {
+public:
+    void TestRoundTrip() {
+        sls_logs::LogGroup logGroup = NewLogGroup(100);
+        // Some logs have another schema and repeated keys.
+        sls_logs::Log* log = logGroup.add_logs();
+        log->set_time(1600000000);
+        AddContent(log, "message", "a");
+        AddContent(log, "message", "b");
+        logGroup.add_logs()->set_time(1500000000);
+
+        std::string encoded;
+        APSARA_TEST_TRUE(ColumnarLogGroup::Encode(logGroup, encoded));
+        APSARA_TEST_TRUE(encoded.size() < logGroup.ByteSizeLong());
+        sls_logs::LogGroup decoded;
+        APSARA_TEST_TRUE(ColumnarLogGroup::Decode(encoded.data(), encoded.size(), decoded));
+        APSARA_TEST_EQUAL(decoded.SerializeAsString(), logGroup.SerializeAsString());
+    }
+
+    void TestMalformed() {
+        sls_logs::LogGroup logGroup = NewLogGroup(10);
+        std::string encoded;
+        ColumnarLogGroup::Encode(logGroup, encoded);
+        sls_logs::LogGroup decoded;
+        for (size_t size = 0; size < encoded.size(); ++size) {
+            APSARA_TEST_FALSE(ColumnarLogGroup::Decode(encoded.data(), size, decoded));
+        }
+        encoded[0] = 'X';
+        APSARA_TEST_FALSE(ColumnarLogGroup::Decode(encoded.data(), encoded.size(), decoded));
+    }
+
+    void TestRegion() {
+        STRING_FLAG(columnar_log_group_regions) = "region1, region2";
+        APSARA_TEST_TRUE(ColumnarLogGroup::IsEnabled("region1"));
+        APSARA_TEST_TRUE(ColumnarLogGroup::IsEnabled("region2"));
+        APSARA_TEST_FALSE(ColumnarLogGroup::IsEnabled("region3"));
+        ColumnarLogGroup::Disable("region1");
+        APSARA_TEST_FALSE(ColumnarLogGroup::IsEnabled("region1"));
+        STRING_FLAG(columnar_log_group_regions) = "";
+        APSARA_TEST_FALSE(ColumnarLogGroup::IsEnabled("region2"));
+    }
+
+private:
+    static void AddContent(sls_logs::Log* log, const std::string& key, const std::string& value) {
+        sls_logs::Log_Content* content = log->add_contents();
+        content->set_key(key);
+        content->set_value(value);
+    }
+
+    static sls_logs::LogGroup NewLogGroup(int count) {
+        sls_logs::LogGroup logGroup;
+        logGroup.set_category("logstore");
+        logGroup.set_topic("topic");
+        logGroup.set_source("127.0.0.1");
+        sls_logs::LogTag* tag = logGroup.add_logtags();
+        tag->set_key("__path__");
+        tag->set_value("/var/log/app.log");
+        const char* levels[] = {"INFO", "WARNING", "ERROR"};
+        for (int i = 0; i < count; ++i) {
+            sls_logs::Log* log = logGroup.add_logs();
+            log->set_time(1600000000 + i / 10);
+            AddContent(log, "__time__", std::to_string(1600000000 + i / 10));
+            AddContent(log, "level", levels[i % 3]);
+            AddContent(log, "request_id", "req-" + std::to_string(i * 7919));
+            AddContent(log, "message", "handled request " + std::to_string(i));
+        }
+        return logGroup;
+    }
+};
+
+UNIT_TEST_CASE(ColumnarLogGroupUnittest, TestRoundTrip);
+UNIT_TEST_CASE(ColumnarLogGroupUnittest, TestMalformed);
+UNIT_TEST_CASE(ColumnarLogGroupUnittest, TestRegion);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,72 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <unistd.h>
+#include "sender/CompressWorkerPool.h"
+
+namespace logtail {
+
+class CompressWorkerPoolUnittest : public ::testing::Test {
+public:
+    void TestEmitInSubmitOrder() {
+        CompressWorkerPool pool(4, 8);
+        APSARA_TEST_EQUAL(pool.GetThreadCount(), 4UL);
+        std::vector<int> emitted;
+        std::atomic_int compressed{0};
+        std::atomic_int maxPending{0};
+        srand(0);
+        for (int i = 0; i < 200; ++i) {
+            const int sleepUs = rand() % 1000;
+            pool.Submit(
+                [&compressed, sleepUs]() {
+                    usleep(sleepUs);
+                    ++compressed;
+                },
+                [&emitted, &maxPending, &pool, i]() {
+                    emitted.push_back(i);
+                    maxPending = std::max(maxPending.load(), static_cast<int>(pool.GetPendingCount()));
+                });
+        }
+        pool.WaitEmpty();
+        APSARA_TEST_EQUAL(compressed.load(), 200);
+        APSARA_TEST_EQUAL(emitted.size(), 200UL);
+        for (int i = 0; i < 200; ++i) {
+            APSARA_TEST_EQUAL_FATAL(emitted[i], i);
+        }
+        APSARA_TEST_TRUE(maxPending.load() <= 8);
+        APSARA_TEST_EQUAL(pool.GetPendingCount(), 0UL);
+    }
+
+    void TestWithoutThreads() {
+        CompressWorkerPool pool(0, 8);
+        int compressed = 0;
+        int emitted = 0;
+        pool.Submit([&compressed]() { ++compressed; }, [&emitted, &compressed]() { emitted = compressed; });
+        // Runs in the caller thread.
+        APSARA_TEST_EQUAL(compressed, 1);
+        APSARA_TEST_EQUAL(emitted, 1);
+        APSARA_TEST_EQUAL(pool.GetPendingCount(), 0UL);
+    }
+};
+
+UNIT_TEST_CASE(CompressWorkerPoolUnittest, TestEmitInSubmitOrder);
+UNIT_TEST_CASE(CompressWorkerPoolUnittest, TestWithoutThreads);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,160 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include "aggregator/Aggregator.h"
+#include "sender/ShardRouter.h"
+
+DECLARE_FLAG_BOOL(enable_shard_route);
+
+namespace logtail {
+
+class MergeItemCoalesceUnittest : public ::testing::Test {
+public:
+    void TestCoalesce() {
+        std::vector<MergeItem*> items;
+        items.push_back(NewItem("project", "logstore1"));
+        items.push_back(NewItem("project", "logstore2"));
+        items.push_back(NewItem("project", "logstore1"));
+        items.push_back(NewItem("project2", "logstore1"));
+        items.push_back(NewItem("project", "logstore1"));
+        std::vector<MergeItem*> allItems(items);
+
+        std::vector<std::vector<MergeItem*>> packageLists;
+        Aggregator::CoalesceMergeItems(items, packageLists);
+        APSARA_TEST_EQUAL(packageLists.size(), 1UL);
+        APSARA_TEST_EQUAL(packageLists[0].size(), 3UL);
+        // Order of items in the same logstore is kept.
+        APSARA_TEST_EQUAL(packageLists[0][0], allItems[0]);
+        APSARA_TEST_EQUAL(packageLists[0][1], allItems[2]);
+        APSARA_TEST_EQUAL(packageLists[0][2], allItems[4]);
+        APSARA_TEST_EQUAL(items.size(), 2UL);
+        APSARA_TEST_EQUAL(items[0], allItems[1]);
+        APSARA_TEST_EQUAL(items[1], allItems[3]);
+        Release(allItems);
+    }
+
+    void TestNotCoalesced() {
+        std::vector<MergeItem*> items;
+        items.push_back(NewItem("project", "logstore"));
+        items.push_back(NewItem("project", "logstore", "hash"));
+        items.push_back(NewItem("project", "logstore", "", "region2"));
+        MergeItem* markOffsetItem = NewItem("project", "logstore");
+        markOffsetItem->mLogGroupContext.mMarkOffsetFlag = true;
+        items.push_back(markOffsetItem);
+        MergeItem* exactlyOnceItem = NewItem("project", "logstore");
+        exactlyOnceItem->mLogGroupContext.mExactlyOnceCheckpoint = std::make_shared<RangeCheckpoint>();
+        items.push_back(exactlyOnceItem);
+        std::vector<MergeItem*> allItems(items);
+
+        std::vector<std::vector<MergeItem*>> packageLists;
+        Aggregator::CoalesceMergeItems(items, packageLists);
+        APSARA_TEST_EQUAL(packageLists.size(), 0UL);
+        APSARA_TEST_EQUAL(items.size(), allItems.size());
+        Release(allItems);
+    }
+
+    void TestCoalesceByShard() {
+        const std::string key1 = "1" + std::string(31, '0');
+        const std::string key2 = "2" + std::string(31, '0');
+        const std::string key3 = "9" + std::string(31, '0');
+        BOOL_FLAG(enable_shard_route) = true;
+        ShardRouter* router = ShardRouter::GetInstance();
+        router->GetShardId("project", "logstore", "region", "aliuid", key1, time(NULL));
+        auto lister = [](const std::string&,
+                         const std::string&,
+                         const std::string&,
+                         const std::string&,
+                         std::vector<sdk::ShardInfo>& shards) {
+            shards.resize(2);
+            shards[0].shardId = 0;
+            shards[0].status = "readwrite";
+            shards[0].inclusiveBeginKey = std::string(32, '0');
+            shards[0].exclusiveEndKey = "8" + std::string(31, '0');
+            shards[1].shardId = 1;
+            shards[1].status = "readwrite";
+            shards[1].inclusiveBeginKey = "8" + std::string(31, '0');
+            shards[1].exclusiveEndKey = std::string(32, 'f');
+            return true;
+        };
+        router->Refresh(lister, time(NULL));
+
+        std::vector<MergeItem*> items;
+        items.push_back(NewItem("project", "logstore", key1));
+        items.push_back(NewItem("project", "logstore", key2));
+        items.push_back(NewItem("project", "logstore", key3));
+        items.push_back(NewItem("project", "logstore"));
+        std::vector<MergeItem*> allItems(items);
+        std::vector<std::vector<MergeItem*>> packageLists;
+        Aggregator::CoalesceMergeItems(items, packageLists);
+        BOOL_FLAG(enable_shard_route) = false;
+        // Only keys in the same shard share a request.
+        APSARA_TEST_EQUAL(packageLists.size(), 1UL);
+        APSARA_TEST_EQUAL(packageLists[0].size(), 2UL);
+        APSARA_TEST_EQUAL(packageLists[0][0], allItems[0]);
+        APSARA_TEST_EQUAL(packageLists[0][1], allItems[1]);
+        APSARA_TEST_EQUAL(items.size(), 2UL);
+        Release(allItems);
+    }
+
+    void TestGroupLogsBySchema() {
+        MergeItem* item = NewItem("project", "logstore");
+        const char* schemas[] = {"a,b", "c", "a,b", "b,a", "c", "a,b"};
+        for (int i = 0; i < 6; ++i) {
+            sls_logs::Log* log = item->mLogGroup.add_logs();
+            log->set_time(i);
+            std::string keys = schemas[i];
+            for (size_t pos = 0; pos < keys.size(); pos += 2) {
+                sls_logs::Log_Content* content = log->add_contents();
+                content->set_key(keys.substr(pos, 1));
+                content->set_value(std::to_string(i));
+            }
+        }
+        item->GroupLogsBySchema();
+        // Groups follow first appearance, and order in a group is kept.
+        const uint32_t expected[] = {0, 2, 5, 1, 4, 3};
+        APSARA_TEST_EQUAL(item->mLogGroup.logs_size(), 6);
+        for (int i = 0; i < 6; ++i) {
+            APSARA_TEST_EQUAL(item->mLogGroup.logs(i).time(), expected[i]);
+        }
+        delete item;
+    }
+
+private:
+    static MergeItem* NewItem(const std::string& project,
+                              const std::string& logstore,
+                              const std::string& shardHashKey = "",
+                              const std::string& region = "region") {
+        MergeItem* item = new MergeItem(
+            project, "config", "file", true, "aliuid", region, 0, MERGE_BY_TOPIC, shardHashKey, 0);
+        item->mLogGroup.set_category(logstore);
+        return item;
+    }
+
+    static void Release(std::vector<MergeItem*>& items) {
+        for (MergeItem* item : items) {
+            delete item;
+        }
+    }
+};
+
+UNIT_TEST_CASE(MergeItemCoalesceUnittest, TestCoalesce);
+UNIT_TEST_CASE(MergeItemCoalesceUnittest, TestNotCoalesced);
+UNIT_TEST_CASE(MergeItemCoalesceUnittest, TestCoalesceByShard);
+UNIT_TEST_CASE(MergeItemCoalesceUnittest, TestGroupLogsBySchema);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
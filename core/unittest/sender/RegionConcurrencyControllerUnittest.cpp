@@ -0,0 +1,124 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "sender/RegionConcurrencyController.h"
+
+DECLARE_FLAG_INT32(region_concurrency_adjust_interval_ms);
+DECLARE_FLAG_INT32(region_concurrency_initial);
+
+namespace logtail {
+
+class RegionConcurrencyControllerUnittest : public ::testing::Test {
+public:
+    static const int32_t kMaxLimit = 64;
+
+    // Run sends @count requests of @latencyMs within one interval, and returns the limit after it, which is
+    // adjusted by samples of the previous Run.
+    static int32_t Run(RegionConcurrencyController& controller, int64_t& nowMs, int64_t latencyMs, int count = 8) {
+        int32_t limit = -1;
+        for (int i = 0; i < count; ++i) {
+            limit = controller.OnSendSuccess("region", "endpoint", latencyMs, kMaxLimit, nowMs);
+        }
+        nowMs += INT32_FLAG(region_concurrency_adjust_interval_ms);
+        return limit;
+    }
+
+    void TestSlowStartAndAdditiveIncrease() {
+        RegionConcurrencyController controller;
+        int64_t nowMs = 1000;
+        const int32_t initial = INT32_FLAG(region_concurrency_initial);
+        APSARA_TEST_EQUAL(controller.GetLimit("region", kMaxLimit), -1);
+        APSARA_TEST_EQUAL(Run(controller, nowMs, 10), initial);
+        // Latency stays at RTT, the limit doubles before the first decrease.
+        APSARA_TEST_EQUAL(Run(controller, nowMs, 10), initial * 2);
+        APSARA_TEST_EQUAL(Run(controller, nowMs, 10), initial * 4);
+
+        controller.OnSendFail("region", "endpoint", kMaxLimit, nowMs);
+        const int32_t decreased = controller.GetLimit("region", kMaxLimit);
+        APSARA_TEST_TRUE(decreased < initial * 4);
+        nowMs += INT32_FLAG(region_concurrency_adjust_interval_ms);
+        // Then it grows by one each interval.
+        APSARA_TEST_EQUAL(Run(controller, nowMs, 10), decreased);
+        APSARA_TEST_EQUAL(Run(controller, nowMs, 10), decreased + 1);
+        APSARA_TEST_EQUAL(Run(controller, nowMs, 10), decreased + 2);
+    }
+
+    void TestDecreaseWhenQueueing() {
+        RegionConcurrencyController controller;
+        int64_t nowMs = 1000;
+        const int32_t initial = INT32_FLAG(region_concurrency_initial);
+        Run(controller, nowMs, 10);
+        Run(controller, nowMs, 10);
+        APSARA_TEST_EQUAL(Run(controller, nowMs, 100), initial * 4);
+        // p90 far above RTT shrinks the limit.
+        const int32_t limit = Run(controller, nowMs, 100);
+        APSARA_TEST_EQUAL(limit, static_cast<int32_t>(initial * 4 * 0.9));
+        // Latency between the two ratios keeps the limit.
+        const int32_t shrunk = Run(controller, nowMs, 20);
+        APSARA_TEST_TRUE(shrunk < limit);
+        APSARA_TEST_EQUAL(Run(controller, nowMs, 20), shrunk);
+        APSARA_TEST_EQUAL(Run(controller, nowMs, 20), shrunk);
+    }
+
+    void TestFailuresDownToOne() {
+        RegionConcurrencyController controller;
+        int64_t nowMs = 1000;
+        Run(controller, nowMs, 10);
+        for (int i = 0; i < 20; ++i) {
+            controller.OnSendFail("region", "endpoint", kMaxLimit, nowMs);
+            nowMs += INT32_FLAG(region_concurrency_adjust_interval_ms);
+        }
+        APSARA_TEST_EQUAL(controller.GetLimit("region", kMaxLimit), 1);
+    }
+
+    void TestUnlimitedAtMax() {
+        RegionConcurrencyController controller;
+        int64_t nowMs = 1000;
+        int32_t limit = 0;
+        for (int i = 0; i < 10; ++i) {
+            limit = Run(controller, nowMs, 10);
+        }
+        APSARA_TEST_EQUAL(limit, -1);
+        APSARA_TEST_EQUAL(controller.GetLimit("region", kMaxLimit), -1);
+        // Other regions are not affected.
+        APSARA_TEST_EQUAL(controller.OnSendFail("other", "endpoint", kMaxLimit, nowMs),
+                          INT32_FLAG(region_concurrency_initial));
+    }
+
+    void TestRttResetOnEndpointChange() {
+        RegionConcurrencyController controller;
+        int64_t nowMs = 1000;
+        Run(controller, nowMs, 10);
+        APSARA_TEST_EQUAL(controller.mRegionStates["region"].mMinRttMs, 10);
+        // A farther endpoint is not taken as queueing.
+        const int32_t limit = controller.GetLimit("region", kMaxLimit);
+        for (int i = 0; i < 8; ++i) {
+            controller.OnSendSuccess("region", "far", 100, kMaxLimit, nowMs);
+        }
+        APSARA_TEST_EQUAL(controller.mRegionStates["region"].mMinRttMs, 100);
+        nowMs += INT32_FLAG(region_concurrency_adjust_interval_ms);
+        APSARA_TEST_EQUAL(controller.OnSendSuccess("region", "far", 100, kMaxLimit, nowMs), limit * 2);
+    }
+};
+
+UNIT_TEST_CASE(RegionConcurrencyControllerUnittest, TestSlowStartAndAdditiveIncrease);
+UNIT_TEST_CASE(RegionConcurrencyControllerUnittest, TestDecreaseWhenQueueing);
+UNIT_TEST_CASE(RegionConcurrencyControllerUnittest, TestFailuresDownToOne);
+UNIT_TEST_CASE(RegionConcurrencyControllerUnittest, TestUnlimitedAtMax);
+UNIT_TEST_CASE(RegionConcurrencyControllerUnittest, TestRttResetOnEndpointChange);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -0,0 +1,63 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "unittest/Unittest.h"
+#include "sender/Sender.h"
+
+namespace logtail {
+
+class RegionEndpointEntryUnittest : public ::testing::Test {
+public:
+    void TestPickByLatency() {
+        RegionEndpointEntry entry;
+        entry.AddDefaultEndpoint("default");
+        entry.AddEndpoint("fast", true, 10);
+        entry.AddEndpoint("proxy", true, 1, true);
+        entry.UpdateEndpointDetail("default", true, 15);
+        // Default endpoint is kept while it is not much slower.
+        APSARA_TEST_EQUAL(entry.GetCurrentEndpoint(true, 2.0), "default");
+        for (int i = 0; i < 20; ++i) {
+            entry.UpdateEndpointDetail("default", true, 100);
+        }
+        APSARA_TEST_EQUAL(entry.GetCurrentEndpoint(true, 2.0), "fast");
+        APSARA_TEST_EQUAL(entry.GetCurrentEndpoint(), "default");
+
+        // Unavailable endpoints are skipped, proxy endpoints are the last choice.
+        entry.UpdateEndpointDetail("fast", false, -1);
+        APSARA_TEST_EQUAL(entry.GetCurrentEndpoint(true, 2.0), "default");
+        entry.UpdateEndpointDetail("default", false, -1);
+        APSARA_TEST_EQUAL(entry.GetCurrentEndpoint(true, 2.0), "proxy");
+        entry.UpdateEndpointDetail("proxy", false, -1);
+        APSARA_TEST_EQUAL(entry.PickEndpointByLatency(2.0), "");
+        APSARA_TEST_EQUAL(entry.GetCurrentEndpoint(true, 2.0), "default");
+    }
+
+    void TestSmoothedLatency() {
+        EndpointDetail detail(true, 100, false);
+        detail.SetDetail(true, 0);
+        APSARA_TEST_EQUAL(detail.mLatency, 0);
+        APSARA_TEST_TRUE(detail.mSmoothedLatency > 60 && detail.mSmoothedLatency < 80);
+        // Latencies of failed tests are not smoothed.
+        detail.SetDetail(false, 1000);
+        APSARA_TEST_TRUE(detail.mSmoothedLatency < 80);
+    }
+};
+
+UNIT_TEST_CASE(RegionEndpointEntryUnittest, TestPickByLatency);
+UNIT_TEST_CASE(RegionEndpointEntryUnittest, TestSmoothedLatency);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -47,6 +47,7 @@
 #include "profiler/LogIntegrity.h"
 #include "event_handler/LogInput.h"
 #include "common/FileEncryption.h"
+#include "common/CompressTools.h"
 #include "processor/LogProcess.h"
 #include "common/WaitObject.h"
 #include "common/Lock.h"
@@ -69,6 +70,7 @@ using namespace std;
 using namespace sls_logs;
 
 DECLARE_FLAG_INT32(buffer_file_alive_interval);
+DECLARE_FLAG_INT32(buffer_file_zstd_level);
 DECLARE_FLAG_STRING(profile_project_name);
 DECLARE_FLAG_BOOL(enable_mock_send);
 DECLARE_FLAG_INT32(max_holded_data_size);
@@ -104,6 +106,7 @@ DECLARE_FLAG_INT32(file_eliminate_interval);
 DECLARE_FLAG_INT32(dirfile_check_interval_ms);
 DECLARE_FLAG_INT32(send_request_concurrency);
 DECLARE_FLAG_INT32(test_unavailable_endpoint_interval);
+DECLARE_FLAG_INT32(send_retry_backoff_base_ms);
 
 DECLARE_FLAG_STRING(alipay_zone);
 
@@ -849,6 +852,8 @@ public:
         INT32_FLAG(sls_host_update_interval) = 1;
         INT32_FLAG(logtail_alarm_interval) = 600;
         BOOL_FLAG(enable_mock_send) = true;
+        // Timings of these cases assume failed log groups are retried at once.
+        INT32_FLAG(send_retry_backoff_base_ms) = 0;
         gRootDir = GetProcessExecutionDir();
         if (PATH_SEPARATOR[0] == gRootDir.at(gRootDir.size() - 1))
             gRootDir.resize(gRootDir.size() - 1);
@@ -3033,6 +3038,36 @@ public:
         LOG_INFO(sLogger, ("TestLogGroupAlipayZoneInfo() end", time(NULL)));
     }
 
+    void TestBufferFileZstdRecompress() {
+        LOG_INFO(sLogger, ("TestBufferFileZstdRecompress() begin", time(NULL)));
+        std::string rawData;
+        for (int i = 0; i < 1000; ++i) {
+            rawData += "2023-01-02 03:04:05 [INFO] request done, latency:" + ToString(i % 7) + "ms\n";
+        }
+        LoggroupTimeValue data;
+        data.mDataType = LOGGROUP_COMPRESSED;
+        data.mRawSize = rawData.size();
+        data.mLogGroupContext.mCompressType = sls_logs::SLS_CMP_LZ4;
+        APSARA_TEST_TRUE(CompressData(sls_logs::SLS_CMP_LZ4, rawData, data.mLogData));
+        const size_t lz4Size = data.mLogData.size();
+
+        Sender::BufferFileRecord record;
+        INT32_FLAG(buffer_file_zstd_level) = 0;
+        APSARA_TEST_TRUE(Sender::Instance()->EncodeBufferFileRecord(&data, record));
+        APSARA_TEST_EQUAL(data.mLogGroupContext.mCompressType, sls_logs::SLS_CMP_LZ4);
+
+        INT32_FLAG(buffer_file_zstd_level) = 3;
+        APSARA_TEST_TRUE(Sender::Instance()->EncodeBufferFileRecord(&data, record));
+        INT32_FLAG(buffer_file_zstd_level) = 0;
+        APSARA_TEST_EQUAL(data.mLogGroupContext.mCompressType, sls_logs::SLS_CMP_ZSTD);
+        APSARA_TEST_TRUE(data.mLogData.size() < lz4Size);
+        APSARA_TEST_EQUAL(record.mMeta.mLogDataSize, static_cast<int32_t>(data.mLogData.size()));
+        std::string uncompressed;
+        APSARA_TEST_TRUE(UncompressData(sls_logs::SLS_CMP_ZSTD, data.mLogData, data.mRawSize, uncompressed));
+        APSARA_TEST_EQUAL(uncompressed, rawData);
+        LOG_INFO(sLogger, ("TestBufferFileZstdRecompress() end", time(NULL)));
+    }
+
     static void MockExactlyOnceSend(LoggroupTimeValue* data);
 
     void TestExactlyOnceDataSendSequence();
@@ -3071,6 +3106,7 @@ APSARA_UNIT_TEST_CASE(SenderUnittest, TestEmptyRealIp, gCaseID);
 APSARA_UNIT_TEST_CASE(SenderUnittest, TestRealIpSendFailAndRecover, gCaseID);
 APSARA_UNIT_TEST_CASE(SenderUnittest, TestRegionConcurreny, gCaseID);
 APSARA_UNIT_TEST_CASE(SenderUnittest, TestLogGroupAlipayZoneInfo, gCaseID);
+APSARA_UNIT_TEST_CASE(SenderUnittest, TestBufferFileZstdRecompress, gCaseID);
 UNIT_TEST_CASE(SenderUnittest, TestExactlyOnceDataSendSequence);
 UNIT_TEST_CASE(SenderUnittest, TestExactlyOncePartialBlockConcurrentSend);
 UNIT_TEST_CASE(SenderUnittest, TestExactlyOnceCompleteBlockConcurrentSend);
@@ -3134,10 +3170,9 @@ void SenderUnittest::TestExactlyOnceDataSendSequence() {
     LOG_INFO(sLogger, ("test sequence", ""));
     ModifyHandler* handler = nullptr;
     {
-        auto& pathMap = sEventDispatcher->mPathWdMap;
-        auto iter = pathMap.find(dir);
-        ASSERT_TRUE(iter != pathMap.end());
-        auto dirHandler = static_cast<CreateModifyHandler*>(sEventDispatcher->mWdDirInfoMap[iter->second]->mHandler);
+        int wd;
+        ASSERT_TRUE(sEventDispatcher->mPathTrie.Find(dir, wd));
+        auto dirHandler = static_cast<CreateModifyHandler*>(sEventDispatcher->mWdDirInfoMap[wd]->mHandler);
         EXPECT_EQ(dirHandler->mModifyHandlerPtrMap.size(), 1);
         handler = dirHandler->mModifyHandlerPtrMap.begin()->second;
     }
@@ -0,0 +1,118 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include "sender/ShardRouter.h"
+
+DECLARE_FLAG_INT32(shard_route_refresh_interval);
+DECLARE_FLAG_INT32(shard_route_retry_interval);
+DECLARE_FLAG_INT32(shard_route_expire_time);
+
+namespace logtail {
+
+class ShardRouterUnittest : public ::testing::Test {
+public:
+    void SetUp() override {
+        mListCount = 0;
+        mListOk = true;
+        mShards.clear();
+        AddShard(0, "readwrite", "00000000000000000000000000000000", "40000000000000000000000000000000");
+        AddShard(1, "readwrite", "40000000000000000000000000000000", "80000000000000000000000000000000");
+        AddShard(2, "readwrite", "80000000000000000000000000000000", "ffffffffffffffffffffffffffffffff");
+        AddShard(3, "readonly", "00000000000000000000000000000000", "80000000000000000000000000000000");
+    }
+
+    void AddShard(int32_t id, const std::string& status, const std::string& begin, const std::string& end) {
+        sdk::ShardInfo shard;
+        shard.shardId = id;
+        shard.status = status;
+        shard.inclusiveBeginKey = begin;
+        shard.exclusiveEndKey = end;
+        mShards.push_back(shard);
+    }
+
+    ShardRouter::ShardLister Lister() {
+        return [this](const std::string& project,
+                      const std::string& logstore,
+                      const std::string& region,
+                      const std::string& aliuid,
+                      std::vector<sdk::ShardInfo>& shards) {
+            ++mListCount;
+            mLastRegion = region;
+            shards = mShards;
+            return mListOk;
+        };
+    }
+
+    int32_t GetShardId(ShardRouter& router, const std::string& hashKey, int32_t curTime) {
+        return router.GetShardId("project", "logstore", "region", "aliuid", hashKey, curTime);
+    }
+
+    void TestLookup() {
+        ShardRouter router;
+        // Unknown before the first refresh.
+        APSARA_TEST_EQUAL(GetShardId(router, "3F000000000000000000000000000000", 1000), -1);
+        router.Refresh(Lister(), 1000);
+        APSARA_TEST_EQUAL(mListCount, 1);
+        APSARA_TEST_EQUAL(mLastRegion, "region");
+        APSARA_TEST_EQUAL(GetShardId(router, "3F000000000000000000000000000000", 1000), 0);
+        APSARA_TEST_EQUAL(GetShardId(router, "40000000000000000000000000000000", 1000), 1);
+        APSARA_TEST_EQUAL(GetShardId(router, "7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF", 1000), 1);
+        APSARA_TEST_EQUAL(GetShardId(router, "C0000000000000000000000000000000", 1000), 2);
+        // Out of all ranges.
+        APSARA_TEST_EQUAL(GetShardId(router, "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFF", 1000), -1);
+    }
+
+    void TestRefresh() {
+        ShardRouter router;
+        GetShardId(router, std::string(32, '0'), 1000);
+        mListOk = false;
+        router.Refresh(Lister(), 1000);
+        router.Refresh(Lister(), 1001);
+        APSARA_TEST_EQUAL(mListCount, 1);
+        // Failures are retried after a short interval.
+        mListOk = true;
+        int32_t curTime = 1000 + INT32_FLAG(shard_route_retry_interval);
+        router.Refresh(Lister(), curTime);
+        APSARA_TEST_EQUAL(mListCount, 2);
+        APSARA_TEST_EQUAL(GetShardId(router, std::string(32, '0'), curTime), 0);
+
+        // Shards split are learned on next refresh.
+        mShards.clear();
+        AddShard(4, "readwrite", "00000000000000000000000000000000", "20000000000000000000000000000000");
+        AddShard(5, "readwrite", "20000000000000000000000000000000", "ffffffffffffffffffffffffffffffff");
+        router.Refresh(Lister(), curTime + INT32_FLAG(shard_route_refresh_interval) - 1);
+        APSARA_TEST_EQUAL(GetShardId(router, "3" + std::string(31, '0'), curTime), 0);
+        curTime += INT32_FLAG(shard_route_refresh_interval);
+        router.Refresh(Lister(), curTime);
+        APSARA_TEST_EQUAL(GetShardId(router, "3" + std::string(31, '0'), curTime), 5);
+
+        // Logstores not looked up are dropped.
+        router.Refresh(Lister(), curTime + INT32_FLAG(shard_route_expire_time));
+        APSARA_TEST_TRUE(router.mRoutes.empty());
+    }
+
+private:
+    std::vector<sdk::ShardInfo> mShards;
+    int mListCount = 0;
+    bool mListOk = true;
+    std::string mLastRegion;
+};
+
+UNIT_TEST_CASE(ShardRouterUnittest, TestLookup);
+UNIT_TEST_CASE(ShardRouterUnittest, TestRefresh);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
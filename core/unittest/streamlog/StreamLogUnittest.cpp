@@ -0,0 +1,157 @@
+// Copyright 2022 iLogtail Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "unittest/Unittest.h"
+#include <cstring>
+#include <string>
+#include <vector>
+#include <json/json.h>
+#include "streamlog/StreamLogFormat.h"
+#include "streamlog/StreamLogManager.h"
+
+namespace logtail {
+
+class StreamLogUnittest : public ::testing::Test {
+public:
+    void TearDown() override { StreamLogLine::ClearFormats(); }
+
+    // Feed writes @data into blocks of @blockSize like a receive thread, and returns records parsed.
+    static std::vector<std::string> Feed(StreamLogSplitter& splitter, const std::string& data, size_t blockSize) {
+        std::vector<std::string> records;
+        std::vector<char> block(blockSize);
+        size_t pos = 0;
+        while (pos < data.size()) {
+            size_t prepared = splitter.Prepare(block.data(), blockSize);
+            size_t n = std::min(blockSize - prepared, data.size() - pos);
+            memcpy(block.data() + prepared, data.data() + pos, n);
+            pos += n;
+            size_t begin = 0;
+            size_t end = splitter.Split(block.data(), prepared + n, begin);
+            std::string chunk(block.data() + begin, end - begin);
+            size_t start = 0;
+            for (size_t i = 0; i < chunk.size(); ++i) {
+                if (chunk[i] == '\n') {
+                    records.push_back(chunk.substr(start, i - start));
+                    start = i + 1;
+                }
+            }
+        }
+        return records;
+    }
+
+    void TestSplitKeepsPartialRecord() {
+        StreamLogSplitter splitter;
+        std::string data;
+        std::vector<std::string> expected;
+        for (int i = 0; i < 100; ++i) {
+            expected.push_back("tag\trecord " + std::to_string(i * 7919));
+            data += expected.back() + "\n";
+        }
+        // Records cross block boundaries everywhere.
+        APSARA_TEST_TRUE(Feed(splitter, data, 37) == expected);
+        APSARA_TEST_EQUAL(splitter.GetDiscardCount(), 0);
+    }
+
+    void TestSplitDiscardsLongRecord() {
+        StreamLogSplitter splitter;
+        std::string data = "tag\tshort\n" + std::string("tag\t") + std::string(100, 'x') + "\ntag\tafter\n";
+        std::vector<std::string> records = Feed(splitter, data, 32);
+        APSARA_TEST_EQUAL(records.size(), 2UL);
+        APSARA_TEST_EQUAL(records[0], "tag\tshort");
+        APSARA_TEST_EQUAL(records[1], "tag\tafter");
+        APSARA_TEST_EQUAL(splitter.GetDiscardCount(), 1);
+    }
+
+    void TestBlockPool() {
+        StreamLogBlockPool pool(4096 * 3, 4096);
+        APSARA_TEST_EQUAL(pool.GetMaxBlockCount(), 3UL);
+        char* blocks[3];
+        for (int i = 0; i < 3; ++i) {
+            blocks[i] = pool.Acquire();
+            APSARA_TEST_TRUE(blocks[i] != NULL);
+        }
+        APSARA_TEST_TRUE(pool.Acquire() == NULL);
+        pool.Release(blocks[1]);
+        APSARA_TEST_TRUE(pool.Acquire() == blocks[1]);
+        for (int i = 0; i < 3; ++i) {
+            pool.Release(blocks[i]);
+        }
+    }
+
+    void TestParseLine() {
+        StreamLogLine line;
+        std::string record = "nginx\t10.0.0.1|200|GET / HTTP/1.1\r";
+        APSARA_TEST_TRUE(line.Parse(record.data(), record.size()));
+        APSARA_TEST_EQUAL(line.GetTag().ToString(), "nginx");
+        APSARA_TEST_EQUAL(line.GetPayload().ToString(), "10.0.0.1|200|GET / HTTP/1.1");
+        // Fields point into the record.
+        APSARA_TEST_TRUE(line.GetTag().mData == record.data());
+
+        APSARA_TEST_FALSE(line.Parse("no tag", 6));
+        APSARA_TEST_FALSE(line.Parse("\tempty tag", 10));
+
+        sls_logs::Log log;
+        line.ToLog(NULL, log);
+        APSARA_TEST_EQUAL(log.contents_size(), 1);
+        APSARA_TEST_EQUAL(log.contents(0).key(), StreamLogLine::DEFAULT_CONTENT_KEY);
+        APSARA_TEST_EQUAL(log.contents(0).value(), "10.0.0.1|200|GET / HTTP/1.1");
+    }
+
+    void TestFormats() {
+        Json::Value formats;
+        Json::Reader reader;
+        APSARA_TEST_TRUE(reader.parse("[{\"tag\": \"nginx\", \"separator\": \"|\", \"keys\": [\"ip\", \"status\", "
+                                      "\"request\"]}, {\"tag\": \"bad\", \"separator\": \"||\", \"keys\": [\"a\"]}, "
+                                      "{\"keys\": [\"a\"]}]",
+                                      formats));
+        APSARA_TEST_FALSE(StreamLogLine::InitFormats(formats));
+        std::shared_ptr<const StreamLogLine::FormatMap> formatMap = StreamLogLine::GetFormats();
+        APSARA_TEST_EQUAL(formatMap->size(), 1UL);
+        const StreamLogFormat& format = formatMap->at("nginx");
+
+        StreamLogLine line;
+        std::string record = "nginx\t10.0.0.1|200|GET /a|b";
+        APSARA_TEST_TRUE(line.Parse(record.data(), record.size()));
+        sls_logs::Log log;
+        line.ToLog(&format, log);
+        APSARA_TEST_EQUAL(log.contents_size(), 3);
+        APSARA_TEST_EQUAL(log.contents(0).key(), "ip");
+        APSARA_TEST_EQUAL(log.contents(0).value(), "10.0.0.1");
+        APSARA_TEST_EQUAL(log.contents(1).value(), "200");
+        // The last key takes the rest of payload.
+        APSARA_TEST_EQUAL(log.contents(2).value(), "GET /a|b");
+
+        // Missing fields are left out.
+        record = "nginx\t10.0.0.1";
+        APSARA_TEST_TRUE(line.Parse(record.data(), record.size()));
+        sls_logs::Log shortLog;
+        line.ToLog(&format, shortLog);
+        APSARA_TEST_EQUAL(shortLog.contents_size(), 1);
+
+        // Snapshots are kept after clear.
+        StreamLogLine::ClearFormats();
+        APSARA_TEST_EQUAL(formatMap->size(), 1UL);
+        APSARA_TEST_EQUAL(StreamLogLine::GetFormats()->size(), 0UL);
+    }
+};
+
+UNIT_TEST_CASE(StreamLogUnittest, TestSplitKeepsPartialRecord);
+UNIT_TEST_CASE(StreamLogUnittest, TestSplitDiscardsLongRecord);
+UNIT_TEST_CASE(StreamLogUnittest, TestBlockPool);
+UNIT_TEST_CASE(StreamLogUnittest, TestParseLine);
+UNIT_TEST_CASE(StreamLogUnittest, TestFormats);
+
+} // namespace logtail
+
+UNIT_TEST_MAIN
@@ -121,6 +121,28 @@ func ProcessRawLogV2(configName string, rawLog []byte, packID string, topic stri
 	return config.ProcessRawLogV2(rawLog, packID, util.StringDeepCopy(topic), tags)
 }
 
+// ProcessRawLogsV2 is the batched ProcessRawLogV2, the i-th raw log is processed with the i-th packID, topic and tags,
+// so that logtail crosses the CGO boundary once for multiple raw logs.
+//
+//export ProcessRawLogsV2
+func ProcessRawLogsV2(configName string, rawLogs [][]byte, packIDs []string, topics []string, tags [][]byte) int {
+	config, exists := pluginmanager.LogtailConfig[configName]
+	if !exists {
+		return -1
+	}
+	if len(packIDs) != len(rawLogs) || len(topics) != len(rawLogs) || len(tags) != len(rawLogs) {
+		logger.Error(context.Background(), "PLUGIN_ALARM", "process raw logs error", "length mismatch", "config", configName)
+		return -1
+	}
+	rst := 0
+	for i := range rawLogs {
+		if r := config.ProcessRawLogV2(rawLogs[i], packIDs[i], util.StringDeepCopy(topics[i]), tags[i]); r != 0 {
+			rst = r
+		}
+	}
+	return rst
+}
+
 //export ProcessLog
 func ProcessLog(configName string, logBytes []byte, packID string, topic string, tags []byte) int {
 	config, exists := pluginmanager.LogtailConfig[configName]